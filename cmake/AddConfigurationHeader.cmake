@@ -11,6 +11,7 @@ endif()
 
 include(CheckIncludeFiles)
 check_include_files(unistd.h SOLARUS_HAVE_UNISTD_H)
+check_include_files("sys/mman.h;sys/stat.h;fcntl.h" SOLARUS_HAVE_SYS_MMAN_H)
 
 # Define SOLARUS_HAVE_OPENGL to indicate if OpenGL is supported.
 # Otherwise OpenGL ES is used.
@@ -29,6 +29,20 @@ if(SOLARUS_FILE_LOGGING)
   add_definitions(-DSOLARUS_FILE_LOGGING)
 endif()
 
+if(SOLARUS_ASSERT_LEVEL STREQUAL "off")
+  add_definitions(-DSOLARUS_ASSERT_LEVEL=0)
+elseif(SOLARUS_ASSERT_LEVEL STREQUAL "cheap")
+  add_definitions(-DSOLARUS_ASSERT_LEVEL=1)
+elseif(SOLARUS_ASSERT_LEVEL STREQUAL "full")
+  add_definitions(-DSOLARUS_ASSERT_LEVEL=2)
+elseif(SOLARUS_ASSERT_LEVEL)
+  message(FATAL_ERROR "Invalid SOLARUS_ASSERT_LEVEL '${SOLARUS_ASSERT_LEVEL}': expected off, cheap or full")
+endif()
+
+if(SOLARUS_HOT_COUNTERS)
+  add_definitions(-DSOLARUS_HOT_COUNTERS)
+endif()
+
 if(SOLARUS_LUA_WIN_UNICODE_WORKAROUND AND WIN32)
   add_definitions(-DSOLARUS_LUA_WIN_UNICODE_WORKAROUND)
 endif()
@@ -37,6 +37,13 @@ set(SOLARUS_GL_ES "OFF" CACHE BOOL "Use OpenGL ES implementation.")
 # Enable logging of errors to file.
 set(SOLARUS_FILE_LOGGING "ON" CACHE BOOL "Enable logging of errors to file.")
 
+# Internal consistency checks compiled: off, cheap or full.
+# If blank, full checks are compiled in debug builds and cheap ones otherwise.
+set(SOLARUS_ASSERT_LEVEL "" CACHE STRING "Internal consistency checks compiled: off, cheap or full (blank: full in debug builds, cheap otherwise).")
+
+# Count calls of hot paths (quadtree queries, collision tests, Lua calls) for frame statistics.
+set(SOLARUS_HOT_COUNTERS "ON" CACHE BOOL "Count calls of hot paths for frame statistics.")
+
 # Workaround for Lua to open files using _wfopen() instead of fopen() on Windows
 # for Unicode filenames support. Systems other than Windows do not need this and
 # can just call fopen() directly with UTF-8 filenames.
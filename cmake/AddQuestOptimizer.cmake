@@ -0,0 +1,15 @@
+# Whether the user wants to build the offline quest optimizer,
+# a tool that packs a quest into an archive optimized for loading.
+option(SOLARUS_QUEST_OPTIMIZER "Generate the quest optimizer tool" OFF)
+
+if(SOLARUS_QUEST_OPTIMIZER)
+  add_executable(solarus-quest-optimizer "")
+  target_sources(solarus-quest-optimizer
+    PRIVATE
+      "${CMAKE_CURRENT_SOURCE_DIR}/tools/quest_optimizer/QuestOptimizer.cpp"
+  )
+  target_link_libraries(solarus-quest-optimizer
+    PUBLIC
+      solarus
+  )
+endif()
@@ -1,18 +1,33 @@
 # This file was autogenerated by 'gen_cmake_sources.sh' - DO NOT EDIT
 target_sources(solarus
   PUBLIC
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/AudioThread.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/ItDecoder.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/Music.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/MusicQuality.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/MusicQualityInfo.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/OggDecoder.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/PcmCache.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/Sound.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/SpcDecoder.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/FlatQuadtree.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/FlatStringMap.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/Grid.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/MonotonicArena.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/MpscQueue.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/PoolAllocator.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/Quadtree.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/SpscQueue.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Ability.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/AbilityInfo.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/AndroidConfig.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/AppleInterface.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Arguments.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/AssetWatcher.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/AsyncFileWriter.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/BinaryData.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/CatchUpMode.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/CatchUpModeInfo.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/CommandsEffects.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Common.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/CurrentQuest.h"
@@ -27,36 +42,51 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/FontResource.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/GameCommand.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/GameCommands.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/FrameStats.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Game.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Geometry.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/HitchDetector.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/HotCounters.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/InputEvent.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/InputReplay.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/JobSystem.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/LanguageTexts.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/LauncherChannel.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Logger.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/MainLoop.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/MapData.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Map.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/MemoryUsage.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/PerfCounter.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/PerfTrace.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/PixelBits.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Point.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestDatabase.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestFileIndex.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestFiles.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestProperties.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Random.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/RandomStream.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Rectangle.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/ResourceProvider.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/ResourceType.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/SavegameConverterV1.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Savegame.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/SavegameValueHandle.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Scale.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Settings.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Size.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/SolarusFatal.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/StartupTasks.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/String.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/StringResources.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Symbol.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/System.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Timer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/TimerPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Transform.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Treasure.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/AnimatedRegions.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/AnimatedTilePattern.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Arrow.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Block.h"
@@ -90,10 +120,12 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Fire.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Ground.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/GroundInfo.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/GroundObservers.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Hero.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/HeroPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Hookshot.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Jumper.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/MovementSystem.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/NonAnimatedRegions.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Npc.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/ParallaxScrollingTilePattern.h"
@@ -102,11 +134,13 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Sensor.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Separator.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/SeparatorPtr.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/SeparatorRegions.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/ShopTreasure.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/SimpleTilePattern.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Stairs.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/StartingLocationMode.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/StreamAction.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/StreamField.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Stream.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Switch.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Teletransporter.h"
@@ -117,20 +151,35 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/TilesetData.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Tileset.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/TraversableInfo.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/WalkabilityGrid.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Wall.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/AnimationLod.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/BlendMode.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/BlendModeInfo.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Color.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/DefaultShaders.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Drawable.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/DrawablePtr.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/DrawList.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/DrawProxies.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/DrawRecording.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/FrameDamage.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/FrameRecorder.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/glrenderer/GlDrawRecording.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/glrenderer/GlRenderer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/glrenderer/GlShader.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/glrenderer/GlTexture.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/glrenderer/GlTextureAtlas.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/glrenderer/GlTileMesh.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/GlyphAtlas.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Hq2xFilter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Hq3xFilter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Hq4xFilter.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/ImageCache.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/KtxImage.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/PixelBitsCache.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/PixelBuffer.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/PixelFilterExecutor.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/quest_icon.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Renderer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Scale2xFilter.h"
@@ -138,6 +187,9 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/sdlrenderer/SDLRenderer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/sdlrenderer/SDLShader.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/sdlrenderer/SDLSurfaceImpl.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/softwarerenderer/SoftwareRenderer.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/softwarerenderer/SoftwareShader.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/softwarerenderer/SoftwareSurfaceImpl.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/ShaderData.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Shader.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/ShaderPtr.h"
@@ -154,13 +206,17 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/SurfaceImpl.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/SurfacePtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/TextSurface.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/TileMesh.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/TransitionFade.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Transition.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/TransitionImmediate.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/TransitionScrolling.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/TransitionShader.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/VertexArray.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/VertexArrayPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Video.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/VsyncMode.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/VsyncModeInfo.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/BackToSolidGroundState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/BoomerangState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/BowState.h"
@@ -171,6 +227,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/FreeState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/FrozenState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/GrabbingState.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/HeroSpriteComposite.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/HeroSprites.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/HeroState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/HookshotState.h"
@@ -193,18 +250,25 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/VictoryState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/ExportableToLua.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/ExportableToLuaPtr.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/FfiAccessors.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaAllocator.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaContext.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaData.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaException.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaProfiler.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaTools.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaWorkers.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/ScopedLuaRef.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/CircleMovement.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/FallingHeight.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/FallingOnFloorMovement.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/FlowField.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/JumpMovement.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/MotionIntegrator.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/Movement.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/PathFinding.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/PathFindingMovement.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/PathFindingScheduler.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/PathMovement.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/PixelMovement.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/movements/PlayerMovement.h"
@@ -228,13 +292,20 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/third_party/snes_spc/SPC_Filter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/third_party/snes_spc/spc.h"
   PRIVATE
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/AudioThread.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/ItDecoder.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/Music.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/MusicQualityInfo.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/OggDecoder.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/PcmCache.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/Sound.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/SpcDecoder.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/AbilityInfo.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Arguments.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/AssetWatcher.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/AsyncFileWriter.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/BinaryData.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/CatchUpModeInfo.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/CommandsEffects.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/CurrentQuest.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Debug.cpp"
@@ -246,20 +317,31 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/EquipmentItemUsage.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/FontResource.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/GameCommands.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/FrameStats.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Game.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Geometry.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/HitchDetector.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/HotCounters.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/InputEvent.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/InputReplay.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/JobSystem.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/LanguageTexts.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/LauncherChannel.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Logger.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/MainLoop.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Map.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/MapData.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/MemoryUsage.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/PerfCounter.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/PerfTrace.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/PixelBits.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Point.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestDatabase.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestFileIndex.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestFiles.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestProperties.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Random.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/RandomStream.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Rectangle.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/ResourceProvider.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/SavegameConverterV1.cpp"
@@ -267,11 +349,14 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Settings.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Size.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/SolarusFatal.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/StartupTasks.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/String.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/StringResources.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Symbol.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/System.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Timer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Treasure.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/AnimatedRegions.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/AnimatedTilePattern.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Arrow.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Block.cpp"
@@ -299,9 +384,11 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Explosion.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Fire.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/GroundInfo.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/GroundObservers.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Hero.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Hookshot.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Jumper.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/MovementSystem.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/NonAnimatedRegions.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Npc.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/ParallaxScrollingTilePattern.cpp"
@@ -309,11 +396,13 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/SelfScrollingTilePattern.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Sensor.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Separator.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/SeparatorRegions.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/ShopTreasure.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/SimpleTilePattern.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Stairs.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/StartingLocationMode.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/StreamAction.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/StreamField.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Stream.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Switch.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Teletransporter.cpp"
@@ -322,21 +411,37 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Tileset.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/TilesetData.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/TraversableInfo.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/WalkabilityGrid.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Wall.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/BlendModeInfo.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Color.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Drawable.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/DrawList.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/FrameDamage.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/FrameRecorder.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/glrenderer/GlDrawRecording.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/glrenderer/GlRenderer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/glrenderer/GlShader.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/glrenderer/GlTexture.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/glrenderer/GlTextureAtlas.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/glrenderer/GlTileMesh.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/GlyphAtlas.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Hq2xFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Hq3xFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Hq4xFilter.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/ImageCache.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/KtxImage.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/PixelBitsCache.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/PixelBuffer.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/PixelFilterExecutor.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Renderer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Scale2xFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/sdlrenderer/SDLRenderer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/sdlrenderer/SDLShader.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/sdlrenderer/SDLSurfaceImpl.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/softwarerenderer/SoftwareRenderer.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/softwarerenderer/SoftwareShader.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/softwarerenderer/SoftwareSurfaceImpl.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Shader.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/ShaderData.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/SoftwarePixelFilter.cpp"
@@ -353,8 +458,10 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/TransitionFade.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/TransitionImmediate.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/TransitionScrolling.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/TransitionShader.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/VertexArray.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Video.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/VsyncModeInfo.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/BackToSolidGroundState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/BoomerangState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/BowState.cpp"
@@ -365,6 +472,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/FreeState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/FrozenState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/GrabbingState.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/HeroSpriteComposite.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/HeroSprites.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/HeroState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/HookshotState.cpp"
@@ -387,35 +495,47 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/VictoryState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/AudioApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/DrawableApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/DrawListApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/EntityApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/ExportableToLua.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/FfiAccessors.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/FileApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/GameApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/InputApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/ItemApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LanguageApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaAllocator.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaContext.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaData.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaException.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaProfiler.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaTools.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/LuaWorkers.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/MainApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/MapApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/MenuApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/MovementApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/PixelBufferApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/RandomApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/ScopedLuaRef.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/ShaderApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/SpriteApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/StateApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/SurfaceApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/TaskApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/TextSurfaceApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/TimerApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/VideoApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/WorkerApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/CircleMovement.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/FallingOnFloorMovement.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/FlowField.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/JumpMovement.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/MotionIntegrator.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/Movement.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/PathFinding.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/PathFindingMovement.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/PathFindingScheduler.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/PathMovement.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/PixelMovement.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/movements/PlayerMovement.cpp"
@@ -429,6 +549,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/hqx/hq3x.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/hqx/hq4x.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/hqx/init.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/hqx/pattern.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/snes_spc/dsp.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/snes_spc/SNES_SPC.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/third_party/snes_spc/SNES_SPC_misc.cpp"
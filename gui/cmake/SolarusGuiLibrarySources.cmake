@@ -11,14 +11,18 @@ target_sources(solarus-gui
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/console.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/console_line_edit.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/main_window.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/performance_graph.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/quest_runner.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/quest_scanner.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/gui/quests_model.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/about_dialog.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/console.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/console_line_edit.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/gui_tools.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/main_window.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/performance_graph.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/quest_runner.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/quest_scanner.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/quests_item_delegate.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/quests_model.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/quests_view.cpp"
@@ -58,6 +58,7 @@ private slots:
   void on_action_about_triggered();
 
   void selected_quest_changed();
+  void quest_data_changed(const QModelIndex& top_left, const QModelIndex& bottom_right);
   void update_run_quest();
 
   void setting_changed_in_quest(const QString& key, const QVariant& value);
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GUI_PERFORMANCE_GRAPH_H
+#define SOLARUS_GUI_PERFORMANCE_GRAPH_H
+
+#include "solarus/core/LauncherChannel.h"
+#include "solarus/gui/gui_common.h"
+#include <QWidget>
+#include <deque>
+#include <vector>
+
+namespace SolarusGui {
+
+/**
+ * @brief Live graph of the frame times of the running quest.
+ *
+ * Shows the update, draw and present times of the last frames
+ * received through the launcher channel, stacked, with the duration
+ * of a 60 FPS frame as reference.
+ */
+class SOLARUS_GUI_API PerformanceGraph : public QWidget {
+  Q_OBJECT
+
+public:
+
+  explicit PerformanceGraph(QWidget* parent = nullptr);
+
+  QSize sizeHint() const override;
+
+public slots:
+
+  void clear();
+  void add_frames(const std::vector<Solarus::LauncherChannel::TelemetryRecord>& frames);
+
+protected:
+
+  void paintEvent(QPaintEvent* event) override;
+
+private:
+
+  std::deque<Solarus::LauncherChannel::TelemetryRecord>
+      frames;            /**< The last frames received, oldest first. */
+
+};
+
+}
+
+#endif
@@ -17,8 +17,13 @@
 #ifndef SOLARUS_GUI_QUEST_RUNNER_H
 #define SOLARUS_GUI_QUEST_RUNNER_H
 
+#include "solarus/core/LauncherChannel.h"
 #include "solarus/gui/gui_common.h"
 #include <QProcess>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <vector>
 
 namespace SolarusGui {
 
@@ -49,19 +54,29 @@ signals:
   void finished();
   void solarus_fatal(const QString& what);
   void output_produced(const QStringList& lines);
+  void frames_received(const std::vector<Solarus::LauncherChannel::TelemetryRecord>& frames);
 
 private slots:
 
   void standard_output_data_available();
   void on_finished();
+  void read_telemetry();
 
 private:
 
   QStringList create_arguments(const QString& quest_path) const;
   QStringList get_quest_lua_commands_from_settings() const;
+  bool open_channel();
+  void close_channel();
 
   QProcess process;     /**< The Solarus process. */
   int last_command_id;  /**< Id of the last command executed (-1 if none). */
+  QScopedPointer<QTemporaryFile>
+      channel_file;     /**< File shared with the process, if any. */
+  Solarus::LauncherChannel::Layout*
+      channel;          /**< The shared file mapped in memory, or nullptr. */
+  quint32 next_frame;   /**< Number of the next frame to read from the channel. */
+  QTimer telemetry_timer;  /**< Reads the channel periodically. */
 };
 
 }
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GUI_QUEST_SCANNER_H
+#define SOLARUS_GUI_QUEST_SCANNER_H
+
+#include "solarus/gui/gui_common.h"
+#include "solarus/core/QuestProperties.h"
+#include <QImage>
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+
+namespace SolarusGui {
+
+/**
+ * @brief Reads the properties, logo and icons of quests in background.
+ *
+ * Quests are scanned on a thread pool. Images are decoded there too,
+ * so that the launcher stays responsive with many quests.
+ *
+ * What is read from a quest is also copied into a persistent cache,
+ * keyed by the quest path and its modification date, so that the next
+ * scans of an unchanged quest do not open it at all.
+ */
+class SOLARUS_GUI_API QuestScanner : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief What was read from a quest.
+   */
+  struct Result {
+    QString path;                 /**< Path of the quest. */
+    bool valid = false;           /**< Whether the quest could be read. */
+    Solarus::QuestProperties
+        properties;               /**< All properties from quest.dat. */
+    QImage logo;                  /**< Logo of the quest, or a null image. */
+    QList<QImage> icons;          /**< Icons of the quest in each size available. */
+  };
+
+  explicit QuestScanner(QObject* parent = nullptr);
+  ~QuestScanner();
+
+  void scan(const QString& quest_path);
+
+  static QMutex& get_quest_files_mutex();
+
+signals:
+
+  void quest_scanned(const SolarusGui::QuestScanner::Result& result);
+
+private:
+
+  QThreadPool thread_pool;      /**< Threads scanning quests. */
+};
+
+}
+
+// Allow to send results through queued connections.
+Q_DECLARE_METATYPE(SolarusGui::QuestScanner::Result)
+
+#endif
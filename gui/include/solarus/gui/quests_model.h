@@ -18,6 +18,7 @@
 #define SOLARUS_GUI_QUESTS_MODEL_H
 
 #include "solarus/gui/gui_common.h"
+#include "solarus/gui/quest_scanner.h"
 #include "solarus/core/QuestProperties.h"
 #include <QAbstractTableModel>
 #include <QIcon>
@@ -27,6 +28,9 @@ namespace SolarusGui {
 
 /**
  * @brief List of quests added to Solarus.
+ *
+ * Properties, logos and icons are read in background by a QuestScanner:
+ * quests appear immediately and their info is filled when ready.
  */
 class SOLARUS_GUI_API QuestsModel : public QAbstractTableModel {
   Q_OBJECT
@@ -46,6 +50,7 @@ public:
     QPixmap logo;               /**< Logo of the quest (recommended: 200x140). */
     Solarus::QuestProperties
         properties;             /**< All properties from quest.dat. */
+    bool loaded = false;        /**< Whether properties were read. */
   };
 
   explicit QuestsModel(QObject* parent = nullptr);
@@ -64,6 +69,7 @@ public:
 
   bool has_quest(const QString& quest_path);
   bool add_quest(const QString& quest_path);
+  void add_quests(const QStringList& quest_paths);
   bool remove_quest(int index);
   QStringList get_paths() const;
 
@@ -74,12 +80,17 @@ public:
 
   const QIcon& get_quest_default_icon() const;
 
+private slots:
+
+  void quest_scanned(const SolarusGui::QuestScanner::Result& result);
+
 private:
 
-  void load_icon(int quest_index) const;
+  void insert_quest(const QuestInfo& info);
 
-  mutable std::vector<QuestInfo>
+  std::vector<QuestInfo>
       quests;                   /**< Info of each quest in the list. */
+  QuestScanner scanner;         /**< Reads quests in background. */
 };
 
 }
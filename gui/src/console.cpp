@@ -122,6 +122,8 @@ void Console::set_quest_runner(QuestRunner& quest_runner) {
           this, SLOT(quest_finished()));
   connect(&quest_runner, SIGNAL(output_produced(QStringList)),
           this, SLOT(quest_output_produced(QStringList)));
+  connect(&quest_runner, &QuestRunner::frames_received,
+          ui.performance_graph, &PerformanceGraph::add_frames);
 
 }
 
@@ -131,6 +133,7 @@ void Console::set_quest_runner(QuestRunner& quest_runner) {
 void Console::quest_running() {
 
   clear();
+  ui.performance_graph->clear();
 
   // Apply settings to the running quest as Lua commands,
   // for quests that don't read the settings.dat file.
@@ -54,9 +54,7 @@ MainWindow::MainWindow(QWidget* parent) :
   // Show recent quests.
   Settings settings;
   const QStringList& quest_paths = settings.value("quests_paths").toStringList();
-  for (const QString& path : quest_paths) {
-    ui.quests_view->add_quest(path);
-  }
+  ui.quests_view->add_quests(quest_paths);
 
   // Select the last quest played.
   QString last_quest = settings.value("last_quest").toString();
@@ -78,6 +76,8 @@ MainWindow::MainWindow(QWidget* parent) :
   // Make connections.
   connect(ui.quests_view->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
           this, SLOT(selected_quest_changed()));
+  connect(ui.quests_view->model(), &QAbstractItemModel::dataChanged,
+          this, &MainWindow::quest_data_changed);
   connect(ui.play_button, SIGNAL(clicked()),
           this, SLOT(on_action_play_quest_triggered()));
   connect(ui.quests_view, SIGNAL(activated(QModelIndex)),
@@ -469,6 +469,24 @@ void MainWindow::update_run_quest() {
   ui.action_suspend_unfocused->setEnabled(!playing);
 }
 
+/**
+ * @brief Slot called when the info of quests in the list changes.
+ *
+ * Quests are read in background, so the info of the selected quest
+ * may arrive after it was selected.
+ *
+ * @param top_left First item changed.
+ * @param bottom_right Last item changed.
+ */
+void MainWindow::quest_data_changed(
+    const QModelIndex& top_left, const QModelIndex& bottom_right) {
+
+  const int selected_index = ui.quests_view->get_selected_index();
+  if (selected_index >= top_left.row() && selected_index <= bottom_right.row()) {
+    selected_quest_changed();
+  }
+}
+
 /**
  * @brief Slot called when the selection changes in the quest list.
  */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/gui/performance_graph.h"
+#include <QPainter>
+#include <algorithm>
+
+namespace SolarusGui {
+
+namespace {
+
+constexpr size_t max_frames = 240;       /**< Number of frames shown. */
+constexpr int reference_time = 16667;    /**< Duration of a 60 FPS frame in microseconds. */
+
+}
+
+/**
+ * @brief Creates a performance graph.
+ * @param parent Parent object or nullptr.
+ */
+PerformanceGraph::PerformanceGraph(QWidget* parent) :
+  QWidget(parent),
+  frames() {
+
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+/**
+ * @brief Returns the preferred size of the graph.
+ * @return The size hint.
+ */
+QSize PerformanceGraph::sizeHint() const {
+
+  return QSize(static_cast<int>(max_frames), 80);
+}
+
+/**
+ * @brief Removes all frames from the graph.
+ */
+void PerformanceGraph::clear() {
+
+  frames.clear();
+  update();
+}
+
+/**
+ * @brief Adds frames to the graph.
+ *
+ * The oldest frames are dropped when there are too many.
+ *
+ * @param frames The frames, oldest first.
+ */
+void PerformanceGraph::add_frames(
+    const std::vector<Solarus::LauncherChannel::TelemetryRecord>& frames) {
+
+  this->frames.insert(this->frames.end(), frames.begin(), frames.end());
+  while (this->frames.size() > max_frames) {
+    this->frames.pop_front();
+  }
+  update();
+}
+
+/**
+ * @brief Draws the graph.
+ * @param event The paint event.
+ */
+void PerformanceGraph::paintEvent(QPaintEvent* /* event */) {
+
+  QPainter painter(this);
+  painter.fillRect(rect(), QColor(32, 32, 32));
+
+  // Scale so that twice the reference time fills the height.
+  const int height = this->height();
+  const double bar_width = static_cast<double>(width()) / max_frames;
+  const double scale = height / (2.0 * reference_time);
+
+  const QColor update_color(80, 160, 255);
+  const QColor draw_color(255, 180, 60);
+  const QColor present_color(160, 220, 100);
+
+  double x = width() - frames.size() * bar_width;
+  for (const Solarus::LauncherChannel::TelemetryRecord& frame : frames) {
+    const Solarus::FrameStats::Frame& stats = frame.stats;
+    double bottom = height;
+    const int times[] = { stats.update_time, stats.draw_time, stats.present_time };
+    const QColor* colors[] = { &update_color, &draw_color, &present_color };
+    for (int i = 0; i < 3; ++i) {
+      const double bar_height = std::min(times[i] * scale, bottom);
+      painter.fillRect(QRectF(x, bottom - bar_height, bar_width, bar_height), *colors[i]);
+      bottom -= bar_height;
+    }
+    x += bar_width;
+  }
+
+  // Reference line.
+  const int reference_y = height - static_cast<int>(reference_time * scale);
+  painter.setPen(QColor(255, 80, 80));
+  painter.drawLine(0, reference_y, width(), reference_y);
+
+  // Summary of the last frames.
+  if (!frames.empty()) {
+    const Solarus::LauncherChannel::TelemetryRecord& first = frames.front();
+    const Solarus::LauncherChannel::TelemetryRecord& last = frames.back();
+    QString text = tr("Update %1 ms  Draw %2 ms  Present %3 ms")
+        .arg(last.stats.update_time / 1000.0, 0, 'f', 2)
+        .arg(last.stats.draw_time / 1000.0, 0, 'f', 2)
+        .arg(last.stats.present_time / 1000.0, 0, 'f', 2);
+    const quint32 duration = last.date - first.date;
+    if (frames.size() > 1 && duration > 0) {
+      const double fps = (frames.size() - 1) * 1000.0 / duration;
+      text = tr("%1 FPS  ").arg(fps, 0, 'f', 1) + text;
+    }
+    painter.setPen(Qt::white);
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop, text);
+  }
+}
+
+}
@@ -17,9 +17,11 @@
 #include "solarus/gui/quest_runner.h"
 #include "solarus/gui/settings.h"
 #include <QApplication>
+#include <QDir>
 #include <QMessageBox>
 #include <QSize>
 #include <QTimer>
+#include <cstring>
 
 namespace SolarusGui {
 
@@ -30,7 +32,11 @@ namespace SolarusGui {
 QuestRunner::QuestRunner(QObject* parent) :
   QObject(parent),
   process(this),
-  last_command_id(-1) {
+  last_command_id(-1),
+  channel_file(),
+  channel(nullptr),
+  next_frame(0),
+  telemetry_timer(this) {
 
   // Set the process channel mode to merged (stdout + stderr)
   process.setProcessChannelMode(QProcess::MergedChannels);
@@ -54,6 +60,11 @@ QuestRunner::QuestRunner(QObject* parent) :
     }
   });
   timer->start(100);
+
+  // Read frame statistics a few times per second.
+  connect(&telemetry_timer, SIGNAL(timeout()),
+          this, SLOT(read_telemetry()));
+  telemetry_timer.setInterval(100);
 }
 
 /**
@@ -71,6 +82,7 @@ QuestRunner::~QuestRunner() {
       process.kill();
     }
   }
+  close_channel();
 }
 
 /**
@@ -169,6 +181,12 @@ void QuestRunner::start(const QString& quest_path) {
   QString program_name = editor_arguments.at(0);
   QStringList arguments = create_arguments(quest_path);
 
+  // Exchange frame statistics and Lua commands through a shared file
+  // rather than parsing the standard output.
+  if (open_channel()) {
+    arguments.insert(arguments.size() - 1, "-launcher-channel=" + channel_file->fileName());
+  }
+
   process.start(program_name, arguments);
 
 }
@@ -224,6 +242,15 @@ int QuestRunner::execute_command(const QString& command) {
   }
 
   QByteArray command_utf8 = command.toUtf8();
+  if (channel != nullptr) {
+    if (!Solarus::LauncherChannel::push_command(
+          *channel, std::string(command_utf8.constData(), command_utf8.size()))) {
+      return -1;
+    }
+    ++last_command_id;
+    return last_command_id;
+  }
+
   command_utf8.append("\n");
   qint64 bytes_written = process.write(command_utf8);
   if (bytes_written != command_utf8.size()) {
@@ -239,8 +266,68 @@ int QuestRunner::execute_command(const QString& command) {
  */
 void QuestRunner::on_finished() {
 
+  read_telemetry();
+  close_channel();
   last_command_id = -1;
   emit finished();
 }
 
+/**
+ * @brief Creates the file shared with the quest process and maps it.
+ * @return @c true in case of success.
+ */
+bool QuestRunner::open_channel() {
+
+  close_channel();
+
+  const qint64 size = sizeof(Solarus::LauncherChannel::Layout);
+  channel_file.reset(new QTemporaryFile(QDir::tempPath() + "/solarus-channel-XXXXXX"));
+  if (!channel_file->open() || !channel_file->resize(size)) {
+    channel_file.reset();
+    return false;
+  }
+
+  uchar* memory = channel_file->map(0, size);
+  if (memory == nullptr) {
+    channel_file.reset();
+    return false;
+  }
+  std::memset(memory, 0, size);
+  channel = reinterpret_cast<Solarus::LauncherChannel::Layout*>(memory);
+  Solarus::LauncherChannel::initialize_layout(*channel);
+  next_frame = 0;
+  telemetry_timer.start();
+  return true;
+}
+
+/**
+ * @brief Unmaps and removes the file shared with the quest process if any.
+ */
+void QuestRunner::close_channel() {
+
+  telemetry_timer.stop();
+  if (channel != nullptr) {
+    channel_file->unmap(reinterpret_cast<uchar*>(channel));
+    channel = nullptr;
+  }
+  channel_file.reset();
+}
+
+/**
+ * @brief Slot called periodically to read the frame statistics sent by the
+ * quest process.
+ */
+void QuestRunner::read_telemetry() {
+
+  if (channel == nullptr) {
+    return;
+  }
+
+  std::vector<Solarus::LauncherChannel::TelemetryRecord> frames;
+  next_frame = Solarus::LauncherChannel::pop_frames(*channel, next_frame, frames);
+  if (!frames.empty()) {
+    emit frames_received(frames);
+  }
+}
+
 }
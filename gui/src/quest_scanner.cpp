@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/gui/quest_scanner.h"
+#include "solarus/core/QuestFiles.h"
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace SolarusGui {
+
+namespace {
+
+/**
+ * @brief Image files read from quests, relative to their data directory.
+ */
+const QStringList logo_file_names = {
+  "logos/logo.png",
+};
+
+const QStringList icon_file_names = {
+  "logos/icon_16.png",
+  "logos/icon_24.png",
+  "logos/icon_32.png",
+  "logos/icon_48.png",
+  "logos/icon_64.png",
+  "logos/icon_128.png",
+  "logos/icon_256.png",
+  "logos/icon_512.png",
+  "logos/icon_1024.png",
+};
+
+/**
+ * @brief Returns the last modification date of what the scanner reads
+ * from a quest.
+ * @param quest_path Path of a quest.
+ * @return The modification date in milliseconds since the epoch.
+ */
+qint64 get_quest_modification_time(const QString& quest_path) {
+
+  const QStringList file_names = {
+    "",
+    "data",
+    "data/quest.dat",
+    "data/logos",
+    "data.solarus",
+    "data.solarus.zip",
+  };
+  qint64 modification_time = 0;
+  for (const QString& file_name : file_names) {
+    const QFileInfo info(quest_path + '/' + file_name);
+    if (info.exists()) {
+      modification_time = std::max(
+            modification_time, info.lastModified().toMSecsSinceEpoch());
+    }
+  }
+  return modification_time;
+}
+
+/**
+ * @brief Returns the cache directory of a quest.
+ *
+ * The directory changes when the quest is modified.
+ *
+ * @param quest_path Path of a quest.
+ * @return The cache directory of this version of the quest,
+ * or an empty string if there is no cache location.
+ */
+QString get_cache_directory(const QString& quest_path) {
+
+  const QString& cache_root = QStandardPaths::writableLocation(
+        QStandardPaths::CacheLocation);
+  if (cache_root.isEmpty()) {
+    return QString();
+  }
+
+  const QByteArray key = quest_path.toUtf8() + '\n' +
+      QByteArray::number(get_quest_modification_time(quest_path));
+  const QString& hash = QString::fromLatin1(QCryptographicHash::hash(
+        key, QCryptographicHash::Sha1).toHex());
+  return cache_root + "/quest_thumbnails/" + hash;
+}
+
+/**
+ * @brief Reads files from the persistent cache.
+ * @param cache_directory Cache directory of a quest.
+ * @param[out] files The cached files, by file name in the quest.
+ * @return @c true if the quest is in the cache.
+ */
+bool read_cache(const QString& cache_directory, QMap<QString, QByteArray>& files) {
+
+  if (cache_directory.isEmpty()) {
+    return false;
+  }
+
+  // quest.dat is written last: if it is there, everything is.
+  QStringList file_names = logo_file_names + icon_file_names;
+  file_names.prepend("quest.dat");
+  for (const QString& file_name : file_names) {
+    QFile file(cache_directory + '/' + QFileInfo(file_name).fileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+      if (file_name == "quest.dat") {
+        return false;
+      }
+      continue;
+    }
+    files.insert(file_name, file.readAll());
+  }
+  return true;
+}
+
+/**
+ * @brief Writes files to the persistent cache.
+ * @param cache_directory Cache directory of a quest.
+ * @param files The files to cache, by file name in the quest.
+ */
+void write_cache(const QString& cache_directory, const QMap<QString, QByteArray>& files) {
+
+  if (cache_directory.isEmpty() ||
+      !QDir().mkpath(cache_directory)) {
+    return;
+  }
+
+  for (auto it = files.begin(); it != files.end(); ++it) {
+    if (it.key() == "quest.dat") {
+      continue;
+    }
+    QFile file(cache_directory + '/' + QFileInfo(it.key()).fileName());
+    if (file.open(QIODevice::WriteOnly)) {
+      file.write(it.value());
+    }
+  }
+
+  QFile file(cache_directory + "/quest.dat");
+  if (file.open(QIODevice::WriteOnly)) {
+    file.write(files.value("quest.dat"));
+  }
+}
+
+/**
+ * @brief Reads the files of interest from a quest through the engine.
+ * @param program_name Name of the program.
+ * @param quest_path Path of a quest.
+ * @param[out] files The files read, by file name in the quest.
+ * @return @c true if the quest could be opened.
+ */
+bool read_quest(
+    const QString& program_name,
+    const QString& quest_path,
+    QMap<QString, QByteArray>& files) {
+
+  // The quest file layer of the engine is global: one quest at a time.
+  QMutexLocker lock(&QuestScanner::get_quest_files_mutex());
+
+  if (Solarus::QuestFiles::is_open()) {
+    Solarus::QuestFiles::close_quest();
+  }
+  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
+                                       quest_path.toStdString())) {
+    Solarus::QuestFiles::close_quest();
+    return false;
+  }
+
+  QStringList file_names = logo_file_names + icon_file_names;
+  file_names.prepend("quest.dat");
+  for (const QString& file_name : file_names) {
+    const std::string& std_file_name = file_name.toLocal8Bit().toStdString();
+    if (Solarus::QuestFiles::data_file_exists(std_file_name) &&
+        !Solarus::QuestFiles::data_file_is_dir(std_file_name)) {
+      const std::string& buffer = Solarus::QuestFiles::data_file_read(std_file_name);
+      files.insert(file_name, QByteArray(buffer.data(), static_cast<int>(buffer.size())));
+    }
+  }
+  Solarus::QuestFiles::close_quest();
+  return files.contains("quest.dat");
+}
+
+/**
+ * @brief Job that scans one quest.
+ */
+class ScanJob : public QRunnable {
+
+public:
+
+  ScanJob(QuestScanner& scanner,
+          const QString& program_name,
+          const QString& quest_path) :
+    scanner(scanner),
+    program_name(program_name),
+    quest_path(quest_path) {
+  }
+
+  void run() override {
+
+    QuestScanner::Result result;
+    result.path = quest_path;
+
+    const QString& cache_directory = get_cache_directory(quest_path);
+    QMap<QString, QByteArray> files;
+    if (!read_cache(cache_directory, files)) {
+      files.clear();
+      if (read_quest(program_name, quest_path, files)) {
+        write_cache(cache_directory, files);
+      }
+    }
+
+    // Parse and decode outside the lock, in parallel.
+    const QByteArray& quest_dat = files.value("quest.dat");
+    result.valid = !quest_dat.isEmpty() &&
+        result.properties.import_from_buffer(
+          quest_dat.constData(), quest_dat.size(), "quest.dat");
+    if (result.valid) {
+      for (const QString& file_name : logo_file_names) {
+        if (files.contains(file_name)) {
+          result.logo.loadFromData(files.value(file_name));
+        }
+      }
+      for (const QString& file_name : icon_file_names) {
+        if (files.contains(file_name)) {
+          QImage icon;
+          if (icon.loadFromData(files.value(file_name))) {
+            result.icons << icon;
+          }
+        }
+      }
+    }
+
+    emit scanner.quest_scanned(result);
+  }
+
+private:
+
+  QuestScanner& scanner;        /**< The scanner, alive until jobs finish. */
+  QString program_name;         /**< Name of the program, to open quests. */
+  QString quest_path;           /**< Path of the quest to scan. */
+};
+
+}
+
+/**
+ * @brief Creates a quest scanner.
+ * @param parent Parent object or nullptr.
+ */
+QuestScanner::QuestScanner(QObject* parent) :
+  QObject(parent),
+  thread_pool() {
+
+  qRegisterMetaType<SolarusGui::QuestScanner::Result>();
+}
+
+/**
+ * @brief Destroys the scanner after waiting for the scans in progress.
+ */
+QuestScanner::~QuestScanner() {
+
+  thread_pool.clear();
+  thread_pool.waitForDone();
+}
+
+/**
+ * @brief Starts scanning a quest in background.
+ *
+ * The signal quest_scanned() is emitted from a worker thread when done,
+ * so receivers in the GUI thread get it through a queued connection.
+ *
+ * @param quest_path Path of the quest to scan.
+ */
+void QuestScanner::scan(const QString& quest_path) {
+
+  QStringList arguments = QApplication::arguments();
+  QString program_name = arguments.isEmpty() ? QString() : arguments.first();
+  thread_pool.start(new ScanJob(*this, program_name, quest_path));
+}
+
+/**
+ * @brief Returns the mutex to lock while using Solarus::QuestFiles.
+ *
+ * The quest file layer of the engine can only have one quest open,
+ * so the GUI thread and the scanner threads take turns.
+ *
+ * @return The mutex.
+ */
+QMutex& QuestScanner::get_quest_files_mutex() {
+
+  static QMutex mutex;
+  return mutex;
+}
+
+}
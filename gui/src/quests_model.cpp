@@ -19,6 +19,7 @@
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
 #include <QApplication>
+#include <QMutexLocker>
 #include <algorithm>
 
 namespace SolarusGui {
@@ -29,8 +30,11 @@ namespace SolarusGui {
  */
 QuestsModel::QuestsModel(QObject* parent) :
   QAbstractTableModel(parent),
-  quests() {
+  quests(),
+  scanner() {
 
+  connect(&scanner, &QuestScanner::quest_scanned,
+          this, &QuestsModel::quest_scanned);
 }
 
 /**
@@ -101,7 +105,6 @@ QVariant QuestsModel::data(const QModelIndex& index, int role) const {
     switch (index.column()) {
 
     case QUEST_COLUMN:
-      load_icon(index.row());
       return QVariant::fromValue(quest_info);
 
     case FORMAT_COLUMN:
@@ -181,27 +184,105 @@ bool QuestsModel::add_quest(const QString& quest_path) {
 
   QuestInfo info;
 
-  // Open the quest to get its quest.dat file.
-  QStringList arguments = QApplication::arguments();
-  QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                       quest_path.toStdString())) {
+  {
+    // Open the quest to get its quest.dat file.
+    QMutexLocker lock(&QuestScanner::get_quest_files_mutex());
+    QStringList arguments = QApplication::arguments();
+    QString program_name = arguments.isEmpty() ? QString() : arguments.first();
+    if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
+                                         quest_path.toStdString())) {
+      Solarus::QuestFiles::close_quest();
+      return false;
+    }
+    info.properties = Solarus::CurrentQuest::get_properties();
+    info.loaded = true;
     Solarus::QuestFiles::close_quest();
-    return false;
   }
-  info.properties = Solarus::CurrentQuest::get_properties();
-  Solarus::QuestFiles::close_quest();
+
+  info.path = quest_path;
+  insert_quest(info);
+
+  // Images are read in background.
+  scanner.scan(quest_path);
+
+  return true;
+}
+
+/**
+ * @brief Adds quests to the model without waiting for them to be read.
+ *
+ * The quests appear immediately with default images, and their info is
+ * filled when the scanner is done with them.
+ * Paths that turn out not to be quests are removed from the model then.
+ *
+ * @param quest_paths Paths of the quests to add.
+ */
+void QuestsModel::add_quests(const QStringList& quest_paths) {
+
+  for (const QString& quest_path : quest_paths) {
+    if (has_quest(quest_path)) {
+      continue;
+    }
+    QuestInfo info;
+    info.path = quest_path;
+    insert_quest(info);
+    scanner.scan(quest_path);
+  }
+}
+
+/**
+ * @brief Adds a row for a quest at the end of the model.
+ * @param info Info of the quest. Missing images are set to defaults.
+ */
+void QuestsModel::insert_quest(const QuestInfo& info) {
 
   const int num_quests = rowCount();
   beginInsertRows(QModelIndex(), num_quests, num_quests);
 
-  info.path = quest_path;
-  info.directory_name = quest_path.section('/', -1, -1, QString::SectionSkipEmpty);
   quests.push_back(info);
+  QuestInfo& quest = quests.back();
+  quest.directory_name = quest.path.section('/', -1, -1, QString::SectionSkipEmpty);
+  quest.icon = get_quest_default_icon();
+  quest.logo = get_quest_default_logo();
 
   endInsertRows();
+}
 
-  return true;
+/**
+ * @brief Slot called when a quest was read in background.
+ * @param result What was read from the quest.
+ */
+void QuestsModel::quest_scanned(const QuestScanner::Result& result) {
+
+  const int quest_index = path_to_index(result.path);
+  if (quest_index == -1) {
+    // Removed in the meantime.
+    return;
+  }
+
+  QuestInfo& quest = quests[quest_index];
+  if (!result.valid) {
+    if (!quest.loaded) {
+      // Not a quest.
+      remove_quest(quest_index);
+    }
+    return;
+  }
+
+  quest.properties = result.properties;
+  quest.loaded = true;
+  if (!result.logo.isNull()) {
+    quest.logo = QPixmap::fromImage(result.logo);
+  }
+  if (!result.icons.isEmpty()) {
+    QIcon icon;
+    for (const QImage& image : result.icons) {
+      icon.addPixmap(QPixmap::fromImage(image));
+    }
+    quest.icon = icon;
+  }
+
+  emit dataChanged(index(quest_index, QUEST_COLUMN), index(quest_index, FORMAT_COLUMN));
 }
 
 /**
@@ -271,29 +352,7 @@ const QPixmap& QuestsModel::get_quest_logo(int quest_index) const {
     return get_quest_default_logo();
   }
 
-  QuestInfo& quest = quests[quest_index];
-  if (quest.logo.isNull()) {
-    // Lazily load the logo.
-    quest.logo = get_quest_default_logo();
-
-    QStringList arguments = QApplication::arguments();
-    QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-    if (Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                        quest.path.toStdString())) {
-      std::string file_name = "logos/logo.png";
-      if (Solarus::QuestFiles::data_file_exists(file_name) &&
-          !Solarus::QuestFiles::data_file_is_dir(file_name)) {
-        std::string buffer = Solarus::QuestFiles::data_file_read(file_name);
-        QPixmap pixmap;
-        if (pixmap.loadFromData((const uchar*) buffer.data(), (uint) buffer.size())) {
-          quests[quest_index].logo = pixmap;
-        }
-      }
-    }
-    Solarus::QuestFiles::close_quest();
-  }
-
-  return quest.logo;
+  return quests[quest_index].logo;
 }
 
 /**
@@ -307,58 +366,4 @@ const QIcon& QuestsModel::get_quest_default_icon() const {
   return default_icon;
 }
 
-/**
- * @brief Loads the icon of the given quest.
- * @param quest_index Index of a quest.
- */
-void QuestsModel::load_icon(int quest_index) const {
-
-  if (quest_index < 0 || quest_index > rowCount()) {
-    return;
-  }
-
-  QuestInfo& quest = quests[quest_index];
-  QIcon& icon = quest.icon;
-  if (!icon.isNull()) {
-    // Already loaded.
-    return;
-  }
-
-  QStringList arguments = QApplication::arguments();
-  QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                       quest.path.toStdString())) {
-    Solarus::QuestFiles::close_quest();
-    icon = get_quest_default_icon();
-    return;
-  }
-
-  QStringList file_names = {
-    "logos/icon_16.png",
-    "logos/icon_24.png",
-    "logos/icon_32.png",
-    "logos/icon_48.png",
-    "logos/icon_64.png",
-    "logos/icon_128.png",
-    "logos/icon_256.png",
-    "logos/icon_512.png",
-    "logos/icon_1024.png",
-  };
-  for (const QString& file_name : file_names) {
-    if (Solarus::QuestFiles::data_file_exists(file_name.toLocal8Bit().toStdString())) {
-      std::string buffer = Solarus::QuestFiles::data_file_read(file_name.toLocal8Bit().toStdString());
-      QPixmap pixmap;
-      if (!pixmap.loadFromData((const uchar*) buffer.data(), (uint) buffer.size())) {
-        continue;
-      }
-      icon.addPixmap(pixmap);
-    }
-  }
-  Solarus::QuestFiles::close_quest();
-
-  if (icon.isNull()) {
-    icon = get_quest_default_icon();
-  }
-}
-
 } // namespace SolarusGui
@@ -103,6 +103,16 @@ bool QuestsView::add_quest(const QString& path) {
   return quests_model->add_quest(path);
 }
 
+/**
+ * @brief Adds quests to the model of this view without waiting for them
+ * to be read.
+ * @param paths Paths of the quests to add.
+ */
+void QuestsView::add_quests(const QStringList& paths) {
+
+  quests_model->add_quests(paths);
+}
+
 /**
  * @brief Removes a quest from the model of this view.
  * @param index Index of the quest to remove.
@@ -14,10 +14,12 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/gui/quest_scanner.h"
 #include "solarus/gui/settings.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Settings.h"
 #include <QApplication>
+#include <QMutexLocker>
 
 namespace SolarusGui {
 
@@ -40,6 +42,9 @@ Settings::Settings(Scope scope) :
  */
 void Settings::export_to_quest(const QString& quest_path) const {
 
+  // Quests may be being scanned in background.
+  QMutexLocker lock(&QuestScanner::get_quest_files_mutex());
+
   if (Solarus::QuestFiles::is_open()) {
     Solarus::QuestFiles::close_quest();
   }
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_AUDIO_THREAD_H
+#define SOLARUS_AUDIO_THREAD_H
+
+#include "solarus/core/Common.h"
+#include "solarus/audio/Sound.h"
+#include "solarus/containers/SpscQueue.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Runs the audio system on its own thread.
+ *
+ * The OpenAL device, the sounds and the current music belong to the audio
+ * thread: it refills the streaming buffers, watches the device connection
+ * and executes the commands posted by the main thread through a lock-free
+ * queue. What the main thread needs to know in return, like the end of the
+ * music, comes back as events through another queue, so that Lua callbacks
+ * are always called from the main thread.
+ *
+ * When the thread is not started, commands are executed immediately and
+ * update() does the work of the audio thread on the main thread.
+ */
+class SOLARUS_API AudioThread {
+
+  public:
+
+    /**
+     * \brief Kinds of commands sent to the audio thread.
+     */
+    enum class CommandType {
+      NONE,
+      PLAY_SOUND,             /**< Play sound id. */
+      PAUSE_SOUNDS,           /**< Pause (flag true) or resume all sounds. */
+      SET_SOUND_VOLUME,       /**< Set the volume of sounds to value. */
+      LOAD_SOUNDS,            /**< Decode the sounds in ids. */
+      ADD_PRELOADED_SOUND,    /**< Put the samples of sound id in cache. */
+      SET_SOUND_VOICES,       /**< Set the max instances (value) and priority (value2) of sound id. */
+      RELOAD_SOUND,           /**< Forget the samples of sound id. */
+      PLAY_MUSIC,             /**< Play music id from file name data, or stop if id is none. */
+      PAUSE_MUSIC,            /**< Pause (flag true) or resume the music. */
+      SET_MUSIC_VOLUME,       /**< Set the volume of musics to value. */
+      SET_CHANNEL_VOLUME,     /**< Set the volume of channel value to value2. */
+      SET_TEMPO,              /**< Set the tempo of the music to value. */
+      SET_MUSIC_FADE,         /**< Set the crossfade duration of musics to value ms. */
+      ADD_PRELOADED_MUSIC     /**< Keep the content data of music file id. */
+    };
+
+    /**
+     * \brief A command sent by the main thread.
+     */
+    struct Command {
+      CommandType type = CommandType::NONE;
+      std::string id;                   /**< Sound or music id, or file name. */
+      std::string data;                 /**< File name or file content. */
+      std::vector<std::string> ids;     /**< Several sound ids. */
+      Sound::DecodedSound decoded;      /**< Samples of a sound decoded in advance. */
+      int value = 0;                    /**< Volume, format, channel, tempo or duration. */
+      int value2 = 0;                   /**< Second integer argument. */
+      bool flag = false;                /**< Pause or loop. */
+      uint32_t serial = 0;              /**< Number of the music request. */
+    };
+
+    /**
+     * \brief Kinds of events sent back to the main thread.
+     */
+    enum class EventType {
+      NONE,
+      MUSIC_STARTED,          /**< The requested music is playing. */
+      MUSIC_FAILED,           /**< The requested music could not be played. */
+      MUSIC_FINISHED          /**< The music reached its end. */
+    };
+
+    /**
+     * \brief An event sent by the audio thread.
+     */
+    struct Event {
+      EventType type = EventType::NONE;
+      uint32_t serial = 0;              /**< Number of the music request. */
+      int num_channels = 0;             /**< Channels of an .it music. */
+      std::vector<int> channel_volumes; /**< Initial volume of each channel. */
+    };
+
+    static void start();
+    static void stop();
+    static bool is_running();
+
+    static void post(Command&& command);
+    static bool poll_event(Event& event);
+    static void update();
+
+    // Called from the audio side.
+    static void post_event(Event&& event);
+
+  private:
+
+    static void run();
+    static void send(Command&& command);
+    static void send_pending_sounds();
+    static void execute(Command& command);
+    static void update_audio();
+
+    static constexpr size_t max_commands = 256;
+    static constexpr size_t max_events = 64;
+    static constexpr int period = 5;       /**< Milliseconds between two updates. */
+
+    static SpscQueue<Command> commands;    /**< Commands from the main thread. */
+    static SpscQueue<Event> events;        /**< Events to the main thread. */
+    static std::thread thread;             /**< The audio thread if started. */
+    static std::atomic<bool> running;      /**< Whether the audio thread should continue. */
+    static std::vector<Command>
+        pending_sounds;                    /**< Sounds played since the last update,
+                                            * one command per sound id. */
+
+};
+
+}
+
+#endif
+
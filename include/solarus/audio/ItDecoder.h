@@ -18,9 +18,12 @@
 #define SOLARUS_IT_DECODER_H
 
 #include "solarus/core/Common.h"
+#include "solarus/audio/MusicQuality.h"
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 #include <modplug.h>
 
 namespace Solarus {
@@ -29,15 +32,33 @@ namespace Solarus {
  * \brief Encapsulates the Impulse Tracker music decoding.
  *
  * This class allows the Music class to be independent of the Impulse Tracker decoding library.
+ *
+ * libmodplug keeps its settings and its mixing buffers in global variables:
+ * all calls to the library are serialized so that several decoders can be
+ * used from different threads.
+ *
+ * Decoded data is always 44100 Hz 16-bit stereo. Lower quality tiers mix
+ * at a lower rate or in mono, and the result is expanded to this format.
  */
 class ItDecoder {
 
   public:
 
+    /**
+     * \brief Interpolation used to resample the instruments.
+     */
+    enum class Resampling {
+      NEAREST,            /**< No interpolation: fastest, worst quality. */
+      LINEAR,             /**< Linear interpolation (the default). */
+      SPLINE,             /**< Cubic spline interpolation. */
+      FIR                 /**< 8-tap FIR filter: slowest, best quality. */
+    };
+
     ItDecoder();
 
-    void load(const std::string& sound_buffer);
+    void load(const char* sound_data, size_t sound_size);
     void unload();
+    bool is_loaded() const;
     int decode(void* decoded_data, int nb_samples);
 
     int get_num_channels() const;
@@ -45,9 +66,15 @@ class ItDecoder {
     void set_channel_volume(int channel, int volume);
     int get_tempo() const;
     void set_tempo(int tempo);
+    void seek(int milliseconds);
     bool loops() const;
     void set_loops(bool loops);
 
+    static Resampling get_resampling();
+    static void set_resampling(Resampling resampling);
+    static MusicQuality get_quality();
+    static void set_quality(MusicQuality quality);
+
   private:
 
     struct ModPlugFileDeleter {
@@ -57,7 +84,22 @@ class ItDecoder {
     };
     using ModPlugFileUniquePtr = std::unique_ptr<ModPlugFile, ModPlugFileDeleter>;
 
+    static MusicQuality get_tier();
+    static void apply_tier(MusicQuality tier);
+    int decode_expanded(int16_t* decoded_data, int nb_frames, MusicQuality tier);
+    static void measure_decoding(double seconds, int nb_frames);
+
     ModPlugFileUniquePtr modplug_file;
+    bool loop;                           /**< Whether the next file loaded loops forever. */
+    std::vector<int16_t> mix_buffer;     /**< Mixed data of lower tiers before expansion. */
+    int16_t last_frame[2];               /**< Last mixed frame, to interpolate the next one. */
+
+    static Resampling resampling;        /**< Interpolation of all decoders. */
+    static MusicQuality quality;         /**< Quality setting of all decoders. */
+    static MusicQuality auto_tier;       /**< Tier currently used by the auto quality. */
+    static MusicQuality applied_tier;    /**< Tier of the current libmodplug settings. */
+    static double decoding_time;         /**< Seconds spent decoding since the last auto check. */
+    static int decoded_frames;           /**< Frames decoded since the last auto check. */
 
 };
 
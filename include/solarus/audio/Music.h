@@ -18,14 +18,24 @@
 #define SOLARUS_MUSIC_H
 
 #include "solarus/core/Common.h"
+#include "solarus/audio/MusicQuality.h"
+#include "solarus/audio/PcmCache.h"
 #include "solarus/audio/Sound.h"
+#include "solarus/core/QuestFiles.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
 
+class Arguments;
+class AudioThread;
 class ItDecoder;
 class OggDecoder;
 class SpcDecoder;
@@ -40,6 +50,21 @@ class SpcDecoder;
  * initialized, by calling Sound::initialize().
  * Sound and Music are the only classes that depends on audio libraries.
  *
+ * The music is decoded on the audio thread. The main thread keeps a copy of
+ * what it requested and of what the audio thread reported back, and the
+ * callback of the music is called from the main thread by update().
+ *
+ * With -music-prerender=yes, SPC and IT musics are rendered in advance by
+ * the PcmCache and played from it as soon as they are complete.
+ *
+ * When the audio thread runs, a new OGG or SPC music is loaded by a
+ * background task: the file is read, the decoder opened and the first
+ * buffers filled while the previous music keeps playing, which is only
+ * replaced once everything is ready. IT musics are still loaded by the
+ * audio thread because the IT library has global state.
+ * If a fade duration is set, the previous music fades out while the new one
+ * fades in. Both are mixed by OpenAL.
+ *
  * TODO move the non-static parts to an internal private class.
  * TODO make a subclass for each format?
  */
@@ -47,6 +72,8 @@ class SOLARUS_API Music {
 
   public:
 
+    ~Music();
+
     /**
      * The music file formats recognized.
      */
@@ -62,7 +89,7 @@ class SOLARUS_API Music {
     static const std::vector<std::string>
         format_names;                            /**< Name of each format. */
 
-    static void initialize();
+    static void initialize(const Arguments& args);
     static void quit();
     static bool is_initialized();
     static void update();
@@ -75,10 +102,16 @@ class SOLARUS_API Music {
     static void set_channel_volume(int channel, int volume);
     static int get_tempo();
     static void set_tempo(int tempo);
+    static int get_fade_duration();
+    static void set_fade_duration(int fade_duration);
+    static MusicQuality get_quality();
+    static void set_quality(MusicQuality quality);
+    static void set_quest_quality(MusicQuality quality);
 
     static void find_music_file(const std::string& music_id,
         std::string& file_name, Format& format);
     static bool exists(const std::string& music_id);
+    static void add_preloaded_file(const std::string& file_name, std::string&& data);
     static void play(
         const std::string& music_id,
         bool loop
@@ -90,6 +123,7 @@ class SOLARUS_API Music {
     );
     static void stop_playing();
     static const std::string& get_current_music_id();
+    static int get_buffer_fill_level();
     static void pause_playing();
     static void resume_playing();
     static void notify_device_disconnected_all();
@@ -97,22 +131,69 @@ class SOLARUS_API Music {
 
   private:
 
+    friend class AudioThread;
+
+    /**
+     * \brief The current music as seen by the main thread.
+     */
+    struct State {
+      std::string id = none;              /**< Id of the requested music. */
+      Format format = NO_FORMAT;          /**< Format of its file. */
+      uint32_t serial = 0;                /**< Number of the request, 0 if no music. */
+      bool started = false;               /**< Whether the audio thread reported the start. */
+      int num_channels = 0;               /**< Channels of an .it music. */
+      std::vector<int> channel_volumes;   /**< Volume of each channel of an .it music. */
+      ScopedLuaRef callback_ref;          /**< Lua function to call when the music finishes. */
+    };
+
     Music();
     Music(
         const std::string& music_id,
+        const std::string& file_name,
+        Format format,
         bool loop,
-        const ScopedLuaRef& callback_ref
+        uint32_t serial
     );
 
     bool start();
+    bool load();
+    bool start_streaming();
     void stop();
     bool is_paused();
     void set_paused(bool pause);
-    void set_callback(const ScopedLuaRef& callback_ref);
+
+    static void handle_events();
+    static void wait_for_start();
+
+    static void play_file(
+        const std::string& music_id,
+        const std::string& file_name,
+        Format format,
+        bool loop,
+        uint32_t serial
+    );
+    static void set_current_paused(bool pause);
+    static void apply_volume(int volume);
+    static void apply_channel_volume(int channel, int volume);
+    static void apply_tempo(int tempo);
+    static void apply_fade_duration(int fade_duration);
+    static void store_preloaded_file(const std::string& file_name, std::string&& data);
+    static void update_music();
+    static void finish_pending_music();
+    static void retire_current_music();
+    static void notify_started(bool success);
+
+    void take_file_data();
+    void start_fade(bool fade_in);
+    float get_gain() const;
+    void update_gain();
+    bool is_faded_out() const;
 
     void decode_spc(ALuint destination_buffer, ALsizei nb_samples);
     void decode_it(ALuint destination_buffer, ALsizei nb_samples);
     void decode_ogg(ALuint destination_buffer, ALsizei nb_samples);
+    bool decode_cached(ALuint destination_buffer, size_t nb_frames);
+    void leave_cache();
 
     bool update_playing();
     void notify_device_disconnected();
@@ -122,22 +203,53 @@ class SOLARUS_API Music {
     std::string file_name;                       /**< name of the file to play */
     Format format;                               /**< format of the music, detected from the file name */
     bool loop;                                   /**< Whether the music should loop. */
-    ScopedLuaRef callback_ref;                   /**< Lua ref to a function to call when the music finishes. */
+    uint32_t serial;                             /**< Number of the request that started this music. */
+    PcmCache::TrackPtr track;                    /**< Music rendered in advance if any. */
+    uint64_t position;                           /**< Number of frames decoded so far. */
+    bool playing_cached;                         /**< Whether frames now come from the track. */
+    bool live_only;                              /**< Whether the track must not be used. */
+    QuestFiles::DataFileView file_data;          /**< Content of the file, once taken. */
+    bool file_data_taken;                        /**< Whether file_data holds a preloaded file. */
+    uint32_t fade_start_date;                    /**< When the current fade started. */
+    bool fading_in;                              /**< Whether the volume is rising from zero. */
+    bool fading_out;                             /**< Whether the volume is falling to zero. */
+
+    std::unique_ptr<SpcDecoder>
+        spc_decoder;                             /**< The SPC decoder of this music if any. */
+    std::unique_ptr<ItDecoder>
+        it_decoder;                              /**< The IT decoder of this music if any. */
+    std::unique_ptr<OggDecoder>
+        ogg_decoder;                             /**< The OGG decoder of this music if any. */
 
     static constexpr int nb_buffers = 8;
     static constexpr int buffer_size = 4096;
     ALuint buffers[nb_buffers];                  /**< multiple buffers used to stream the music */
     ALuint source;                               /**< the OpenAL source streaming the buffers */
 
-    static std::unique_ptr<SpcDecoder>
-        spc_decoder;                             /**< The SPC decoder. */
-    static std::unique_ptr<ItDecoder>
-        it_decoder;                              /**< The IT decoder. */
-    static std::unique_ptr<OggDecoder>
-        ogg_decoder;                             /**< The OGG decoder. */
+    static bool initialized;                     /**< Whether initialize() was called. */
     static float volume;                         /**< volume of musics (0.0 to 1.0) */
+    static int volume_setting;                   /**< Volume as seen by the main thread (0 to 100). */
+    static std::atomic<int> tempo;               /**< Current tempo of an .it music. */
+    static std::atomic<int> buffer_fill_level;   /**< Percentage of buffers queued when the music
+                                                  * was last updated by the audio thread. */
 
     static std::unique_ptr<Music> current_music; /**< the music currently played (if any) */
+    static std::unique_ptr<Music> fading_music;  /**< The previous music while it fades out. */
+    static std::unique_ptr<Music> pending_music; /**< The next music while it is loaded. */
+    static std::future<bool> pending_load;       /**< Background loading of pending_music. */
+    static bool pending_paused;                  /**< Whether to pause pending_music once started. */
+    static int fade_duration;                    /**< Crossfade length in ms, on the audio side. */
+    static int fade_duration_setting;            /**< Crossfade length as seen by the main thread. */
+    static bool quality_from_arguments;          /**< Whether -music-quality overrides quest.dat. */
+    static State state;                          /**< Current music on the main thread. */
+    static uint32_t last_serial;                 /**< Number of the last music request. */
+    static std::vector<ScopedLuaRef>
+        finished_callbacks;                      /**< Callbacks of finished musics still to call. */
+
+    static constexpr size_t max_preloaded_files = 4;
+    static std::deque<std::pair<std::string, std::string>>
+        preloaded_files;                         /**< Content of music files read in advance,
+                                                  * most recent last. */
 
 };
 
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MUSIC_QUALITY_H
+#define SOLARUS_MUSIC_QUALITY_H
+
+namespace Solarus {
+
+/**
+ * \brief Rendering tier of module musics (.it files).
+ *
+ * Lower tiers reduce the mixing rate, the interpolation and the effects
+ * to save processor time.
+ */
+enum class MusicQuality {
+
+  LOW,        /**< 22050 Hz mono, no interpolation, no effects. */
+  MEDIUM,     /**< 22050 Hz stereo, linear interpolation at most, no effects. */
+  HIGH,       /**< 44100 Hz stereo with the configured interpolation (default). */
+  AUTO        /**< Starts high and drops a tier while decoding is too slow. */
+};
+
+}
+
+#endif
+
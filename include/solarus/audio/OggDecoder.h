@@ -33,9 +33,9 @@ class OggDecoder {
 
     OggDecoder();
 
-    bool load(std::string&& ogg_data, bool loop);
+    bool load(QuestFiles::DataFileView&& ogg_data, bool loop);
     void unload();
-    void decode(ALuint destination_buffer, ALsizei nb_samples);
+    bool decode(ALuint destination_buffer, ALsizei nb_samples);
 
   private:
 
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PCM_CACHE_H
+#define SOLARUS_PCM_CACHE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/MemoryUsage.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Musics rendered in advance by a background worker.
+ *
+ * Emulating SPC files and mixing IT modules is expensive. When the cache is
+ * enabled, the first time such a music is played, a worker thread renders
+ * the whole track with its own decoder while the music is decoded live as
+ * usual. Once the track is complete, the music continues from the cache at
+ * the same position, and the next times it is played, nothing is decoded.
+ *
+ * Tracks are stored as IMA ADPCM, four times smaller than 16-bit PCM,
+ * in independent blocks so that they can be read from anywhere.
+ * The least recently used tracks are dropped to respect a memory budget.
+ */
+class SOLARUS_API PcmCache {
+
+  public:
+
+    /**
+     * \brief Kinds of music files that can be rendered.
+     */
+    enum class Source {
+      SPC,                /**< Rendered for the length of its ID666 tag. */
+      IT                  /**< Rendered until the end of the module. */
+    };
+
+    /**
+     * \brief A rendered music.
+     *
+     * A track is written by one thread, the worker of the cache.
+     * It can be read from any thread once it is complete.
+     */
+    class Track {
+
+      public:
+
+        explicit Track(int sample_rate);
+
+        int get_sample_rate() const;
+        bool is_complete() const;
+        size_t get_num_frames() const;
+        size_t get_size() const;
+
+        void read(size_t first_frame, int16_t* frames, size_t num_frames) const;
+
+        void append(const int16_t* frames, size_t num_frames);
+        void finish();
+
+        static constexpr size_t block_frames = 1024;   /**< Stereo frames in a block. */
+        static constexpr size_t block_size =
+            2 * 4 + block_frames;                      /**< Bytes of a block. */
+
+      private:
+
+        void encode_block();
+
+        int sample_rate;                   /**< Frames per second. */
+        std::vector<uint8_t> blocks;       /**< Encoded blocks. */
+        std::vector<int16_t> pending;      /**< Samples of the block being filled. */
+        std::array<int, 2> step_indexes;   /**< Step index of each channel after the last block. */
+        size_t num_frames;                 /**< Number of frames appended so far. */
+        std::atomic<bool> complete;        /**< Whether the whole music is rendered. */
+        MemoryUsage::Tracker
+            memory_tracker;                /**< Memory of the encoded blocks. */
+
+    };
+
+    using TrackPtr = std::shared_ptr<const Track>;
+
+    static void initialize(size_t max_bytes);
+    static void quit();
+    static bool is_enabled();
+
+    static TrackPtr get_track(
+        const std::string& file_name,
+        Source source,
+        const char* data,
+        size_t size
+    );
+
+  private:
+
+    /**
+     * \brief A music to render.
+     */
+    struct Job {
+      std::string file_name;             /**< Key of the track in the cache. */
+      Source source;                     /**< Format of the file. */
+      std::string data;                  /**< Copy of the content of the file. */
+      std::shared_ptr<Track> track;      /**< The track to fill. */
+    };
+
+    static void run();
+    static void render(Job& job);
+    static bool render_spc(Job& job);
+    static bool render_it(Job& job);
+    static void release_unused_tracks();
+
+    static constexpr int max_track_seconds = 600;  /**< Longer musics are not cached. */
+
+    static bool enabled;                           /**< Whether initialize() was called. */
+    static size_t max_bytes;                       /**< Budget of the complete tracks. */
+    static std::thread worker;                     /**< Thread rendering the tracks. */
+    static std::atomic<bool> stopping;             /**< Asks the worker to stop. */
+    static std::mutex mutex;                       /**< Protects what follows. */
+    static std::condition_variable jobs_changed;   /**< Wakes up the worker. */
+    static std::deque<Job> jobs;                   /**< Musics waiting to be rendered. */
+    static std::map<std::string, std::shared_ptr<Track>>
+        tracks;                                    /**< Tracks complete or being rendered. */
+    static std::map<std::string, uint64_t>
+        last_uses;                                 /**< When each track was last requested. */
+    static std::set<std::string> failed_files;     /**< Musics that could not be rendered. */
+    static uint64_t num_uses;                      /**< Number of requests so far. */
+
+};
+
+}
+
+#endif
+
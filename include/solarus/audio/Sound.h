@@ -18,9 +18,14 @@
 #define SOLARUS_SOUND_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/QuestFiles.h"
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 #include <al.h>
 #include <alc.h>
 #include <vorbis/vorbisfile.h>
@@ -28,11 +33,29 @@
 namespace Solarus {
 
 class Arguments;
+class AudioThread;
+class OggDecoder;
 
 /**
  * \brief Represents a sound effect that can be played in the program.
  *
+ * Short sounds are decoded once into an OpenAL buffer that stays resident
+ * while the total size of resident buffers fits in a budget: beyond it, the
+ * least recently played sounds are released and decoded again when needed.
+ * Long sounds are never decoded entirely: each time they are played, they
+ * are streamed through a small ring of buffers like musics.
+ *
+ * All instances play on OpenAL sources taken from a pool created with the
+ * device, so the number of voices is bounded. A sound can limit its number
+ * of simultaneous instances, and when no source is free, a new instance
+ * takes the source of the oldest instance of lowest priority, provided that
+ * this priority is not higher than its own.
+ *
  * This class also handles the initialization of the whole audio system.
+ * Unless -audio-thread=no is passed, the audio system runs on its own
+ * thread: the static functions below are called from the main thread and
+ * send commands to the AudioThread, and the values they return are copies
+ * kept by the main thread.
  * To create a sound, prefer the Sound::play() method
  * rather than calling directly the constructor of Sound.
  * This class is the only one that depends on the sound decoding library (libsndfile).
@@ -48,23 +71,49 @@ class SOLARUS_API Sound {
      * \brief Buffer containing an encoded sound file.
      */
     struct SoundFromMemory {
-      std::string data;         /**< The OGG encded data. */
-      size_t position;          /**< Current position in the buffer. */
-      bool loop;                /**< \c true to restart the sound if it finishes. */
+      QuestFiles::DataFileView data;  /**< The OGG encoded data. */
+      size_t position;                /**< Current position in the buffer. */
+      bool loop;                      /**< \c true to restart the sound if it finishes. */
     };
 
     // functions to load the encoded sound from memory
     static ov_callbacks ogg_callbacks;           /**< vorbisfile object used to load the encoded sound from memory */
 
+    /**
+     * \brief PCM samples of a decoded sound file.
+     */
+    struct DecodedSound {
+      std::vector<char> samples;  /**< Stereo 16-bit samples. */
+      ALsizei sample_rate = 0;    /**< Samples per second. */
+      bool streamed = false;      /**< \c true if the sound is too long to be
+                                   * decoded in advance: samples is empty. */
+    };
+
+    /**
+     * \brief How instances of a sound share the voices.
+     */
+    struct VoiceSettings {
+      int max_instances = 0;      /**< Instances playing at the same time, 0 for no limit. */
+      int priority = 0;           /**< Instances of higher priority steal voices first. */
+    };
+
     Sound();
     explicit Sound(const std::string& sound_id);
     ~Sound();
+
+    Sound(const Sound& other) = delete;
+    Sound& operator=(const Sound& other) = delete;
+
     void load();
-    bool start();
+    bool start(int num_plays = 1);
     void set_paused(bool pause);
 
     static void load_all();
     static bool exists(const std::string& sound_id);
+    static std::string get_file_name(const std::string& sound_id);
+    static bool decode_samples(const std::string& file_name, DecodedSound& decoded);
+    static void add_preloaded(const std::string& sound_id, DecodedSound&& decoded);
+    static void reload(const std::string& sound_id);
     static void play(const std::string& sound_id);
     static void pause_all();
     static void resume_all();
@@ -77,28 +126,98 @@ class SOLARUS_API Sound {
     static int get_volume();
     static void set_volume(int volume);
 
+    static const VoiceSettings& get_voice_settings(const std::string& sound_id);
+    static void set_voice_settings(const std::string& sound_id, const VoiceSettings& settings);
+
   private:
 
-    ALuint decode_file(const std::string& file_name);
+    friend class AudioThread;
+
+    /**
+     * \brief A playing instance of a decoded sound.
+     */
+    struct Voice {
+      ALuint source = AL_NONE;                /**< The source playing this instance. */
+      uint64_t start = 0;                     /**< When this instance started, in plays. */
+    };
+
+    /**
+     * \brief A playing instance of a streamed sound.
+     */
+    struct Stream {
+      static constexpr int nb_buffers = 4;
+      static constexpr int buffer_size = 8192;
+
+      std::unique_ptr<OggDecoder> decoder;    /**< Decodes the sound while it plays. */
+      ALuint source = AL_NONE;                /**< The source playing this instance. */
+      std::array<ALuint, nb_buffers> buffers; /**< Buffers queued to the source in turn. */
+      bool finished = false;                  /**< Whether the end of the file was decoded. */
+      uint64_t start = 0;                     /**< When this instance started, in plays. */
+    };
+
+    static Sound& get_sound(const std::string& sound_id);
+    static void load_sounds(const std::vector<std::string>& sound_ids);
+    static void store_preloaded(const std::string& sound_id, const DecodedSound& decoded);
+    static void forget_decoded(const std::string& sound_id);
+    static void set_all_paused(bool pause);
+    static void update_sounds();
+    void decode_file(const std::string& file_name);
+    void set_decoded(const std::string& file_name, const DecodedSound& decoded);
+    static ALuint create_buffer(const std::string& file_name, const DecodedSound& decoded);
+    static void release_unused_buffers(const Sound* sound_to_keep);
+    void clear_buffer();
+    bool start_stream();
+    bool update_stream(Stream& stream);
+    void destroy_stream(Stream& stream);
     bool update_playing();
+    int get_num_instances() const;
+    uint64_t get_oldest_start() const;
+    void stop_oldest_instance();
+
+    static void create_source_pool();
+    static void destroy_source_pool();
+    static ALuint acquire_source(int priority);
+    static void release_source(ALuint source);
+    static void apply_voice_settings(const std::string& sound_id, const VoiceSettings& settings);
 
     static void update_device_connection();
 
+    static constexpr float max_grouped_gain = 2.0f;  /**< Maximum volume factor of a sound
+                                                      * played several times in one tick. */
+
     static bool audio_enabled;                   /**< \c true unless -no-audio was passed. */
     static ALCdevice* device;                    /**< OpenAL device, nullptr if disconnected. */
     static ALCcontext* context;                  /**< OpenAL context. */
 
     std::string id;                              /**< id of this sound */
     ALuint buffer;                               /**< the OpenAL buffer containing the PCM decoded data of this sound */
-    std::list<ALuint> sources;                   /**< the sources currently playing this sound */
+    size_t buffer_bytes;                         /**< Size of the decoded data in the buffer. */
+    bool streamed;                               /**< Whether this sound is too long to stay decoded. */
+    uint64_t last_use;                           /**< When this sound was last played, in plays. */
+    VoiceSettings settings;                      /**< How instances of this sound share voices. */
+    std::list<Voice> voices;                     /**< the decoded instances currently playing */
+    std::list<Stream> streams;                   /**< the streamed instances currently playing */
     static std::list<Sound*> current_sounds;     /**< the sounds currently playing */
     static std::map<std::string, Sound> all_sounds;   /**< all sounds created before */
 
     static bool sounds_preloaded;                /**< true if load_all() was called */
     static float volume;                         /**< the volume of sound effects (0.0 to 1.0) */
+    static int volume_setting;                   /**< Volume as seen by the main thread (0 to 100). */
     static uint32_t next_device_detection_date;  /**< Date of the next attempt to detect an audio device. */
 
     static bool pc_play;                         /**< Whether playing performance counter is used. */
+
+    static size_t stream_threshold;              /**< Decoded size above which a sound is streamed. */
+    static size_t max_resident_bytes;            /**< Budget of the decoded data in buffers. */
+    static size_t resident_bytes;                /**< Size of the decoded data in buffers. */
+    static uint64_t num_uses;                    /**< Number of plays so far. */
+
+    static size_t num_voices;                    /**< Number of sources in the pool. */
+    static std::vector<ALuint> free_sources;     /**< Sources of the pool not playing. */
+    static std::map<std::string, VoiceSettings>
+        voice_settings;                          /**< Settings of sounds on the audio side. */
+    static std::map<std::string, VoiceSettings>
+        requested_voice_settings;                /**< Settings as seen by the main thread. */
 };
 
 }
@@ -36,15 +36,17 @@ namespace Solarus {
  * The source code of Solarus include the fast version of Snes_SPC, which I recommend
  * since the sound generated is good enough.
  */
-class SpcDecoder {
+class SOLARUS_API SpcDecoder {
 
   public:
 
     SpcDecoder();
 
-    void load(int16_t* sound_data, size_t sound_size);
+    void load(const int16_t* sound_data, size_t sound_size);
     void decode(int16_t* decoded_data, int nb_samples);
 
+    static void set_simd_enabled(bool enabled);
+
   private:
 
     struct SNES_SPC_Deleter {
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FLAT_QUADTREE_H
+#define SOLARUS_FLAT_QUADTREE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A quadtree whose nodes and elements are stored in flat arrays.
+ *
+ * This container has the same splitting and merging policy as Quadtree,
+ * but it is designed to make queries allocation-free:
+ * - nodes are stored in a pool and children of a node are contiguous,
+ * - elements are stored in a contiguous array of slots reused after removal,
+ * - queries write into a buffer provided by the caller and use a visit
+ *   stamp instead of a std::set to avoid duplicates.
+ *
+ * Results of queries are not sorted: callers that need an order have to
+ * sort the buffer themselves.
+ *
+ * Moving an element within the leaf cell that already contains it only
+ * updates its bounding box. Other moves postpone merging cells until
+ * rebalance() is called, typically once per tick.
+ *
+ * \param T Type of objects. Must be hashable with \c Hash.
+ */
+template <typename T, typename Hash = std::hash<T>>
+class FlatQuadtree {
+
+  public:
+
+    FlatQuadtree();
+    explicit FlatQuadtree(const Rectangle& space);
+
+    void clear();
+    void initialize(const Rectangle& space);
+
+    Rectangle get_space() const;
+
+    bool add(const T& element, const Rectangle& bounding_box);
+    int add_elements(const std::vector<std::pair<T, Rectangle>>& elements);
+    bool remove(const T& element);
+    bool move(const T& element, const Rectangle& bounding_box);
+    void rebalance();
+
+    void get_elements(
+        const Rectangle& where,
+        std::vector<T>& result
+    ) const;
+    template<typename Visitor>
+    bool visit_elements(
+        const Rectangle& where,
+        Visitor&& visitor
+    ) const;
+
+    int get_num_elements() const;
+    bool contains(const T& element) const;
+
+    void draw(const SurfacePtr& dst_surface, const Point& dst_position);
+
+    static constexpr int
+        min_cell_size = 16;  /**< Don't split more if a cell is smaller than
+                              * this size. */
+    static constexpr int
+        max_in_cell = 8;     /**< A cell is split if it exceeds this number
+                              * when adding an element, unless the cell is
+                              * too small. */
+    static constexpr int
+        min_in_4_cells = 4;  /**< 4 sibling cells are merged if their total
+                              * is below this number when removing an element. */
+
+    static constexpr bool debug_quadtrees = false;
+
+  private:
+
+    static constexpr uint32_t no_index = static_cast<uint32_t>(-1);
+    static constexpr int max_depth = 31;  /**< Levels in Morton codes. */
+
+    /**
+     * \brief An element stored in the quadtree.
+     */
+    struct Slot {
+        T element;                      /**< The element, or a default value
+                                         * if the slot is free. */
+        Rectangle bounding_box;         /**< Bounding box of the element. */
+        mutable uint32_t visit_stamp;   /**< Stamp of the last query that
+                                         * returned this element. */
+        bool outside;                   /**< Whether the element is outside
+                                         * the quadtree space. */
+    };
+
+    /**
+     * \brief A cell of the quadtree.
+     */
+    struct Node {
+        Rectangle cell;                 /**< Rectangle of this cell. */
+        uint32_t first_child;           /**< Index of the first of the
+                                         * 4 contiguous children, or no_index
+                                         * if this node is a leaf. */
+        std::vector<uint32_t> slots;    /**< Slots of elements in this leaf. */
+        Color color;                    /**< Color for debugging. */
+    };
+
+    bool is_split(uint32_t node_index) const;
+    uint32_t allocate_slot(const T& element, const Rectangle& bounding_box);
+    void add_to_leaves(uint32_t node_index, uint32_t slot_index, std::vector<uint32_t>& leaves);
+    uint32_t allocate_children();
+    uint32_t create_children(uint32_t node_index);
+    static Rectangle get_child_cell(const Rectangle& cell, uint32_t child);
+    void build(const std::vector<uint32_t>& slot_indexes_to_add);
+    void build_node(
+        uint32_t node_index,
+        const std::vector<std::pair<uint64_t, uint32_t>>& codes,
+        size_t begin,
+        size_t end,
+        int depth
+    );
+    uint64_t get_morton_code(const Rectangle& bounding_box) const;
+    void add_to_node(uint32_t node_index, uint32_t slot_index);
+    bool remove_from_node(uint32_t node_index, uint32_t slot_index, bool defer_merge);
+    uint32_t find_leaf(const Rectangle& bounding_box) const;
+    void split(uint32_t node_index);
+    void merge(uint32_t node_index);
+    bool is_main_cell(uint32_t node_index, const Rectangle& bounding_box) const;
+    Point get_main_point(const Rectangle& bounding_box) const;
+    int get_num_elements(uint32_t node_index) const;
+    uint32_t next_visit_stamp() const;
+
+    template<typename Visitor>
+    bool visit_node(
+        uint32_t node_index,
+        const Rectangle& where,
+        uint32_t stamp,
+        Visitor& visitor
+    ) const;
+
+    void draw_node(
+        uint32_t node_index,
+        const SurfacePtr& dst_surface,
+        const Point& dst_position
+    );
+    void draw_rectangle(
+        const Rectangle& rectangle,
+        const Color& line_color,
+        const SurfacePtr& dst_surface,
+        const Point& dst_position
+    );
+
+    std::vector<Slot> slots;                /**< Contiguous storage of elements. */
+    std::vector<uint32_t> free_slots;       /**< Indexes of unused slots. */
+    std::unordered_map<T, uint32_t, Hash>
+        slot_indexes;                       /**< Slot of each element. */
+    std::vector<Node> nodes;                /**< Node pool. The root is at index 0. */
+    std::vector<uint32_t> free_children;    /**< Indexes of unused blocks
+                                             * of 4 children in the pool. */
+    std::vector<uint32_t> pending_merges;   /**< Nodes that may need to be
+                                             * merged at the next rebalance(). */
+    mutable uint32_t visit_stamp;           /**< Stamp of the current query. */
+
+};
+
+}
+
+#include "solarus/containers/FlatQuadtree.inl"
+
+#endif
@@ -0,0 +1,1023 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Random.h"
+#include "solarus/graphics/Surface.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a quadtree with a default space size.
+ *
+ * Call initialize() later to specify the size.
+ */
+template<typename T, typename Hash>
+FlatQuadtree<T, Hash>::FlatQuadtree() :
+    FlatQuadtree(Rectangle(0, 0, 256, 256)) {
+
+}
+
+/**
+ * \brief Creates a quadtree and initializes with the given size.
+ * \param space Rectangle representing the space to create partitions of.
+ */
+template<typename T, typename Hash>
+FlatQuadtree<T, Hash>::FlatQuadtree(const Rectangle& space) :
+    slots(),
+    free_slots(),
+    slot_indexes(),
+    nodes(),
+    free_children(),
+    pending_merges(),
+    visit_stamp(0) {
+
+  initialize(space);
+}
+
+/**
+ * \brief Removes all elements of the quadtree.
+ *
+ * The space of the quadtree is kept.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::clear() {
+
+  Rectangle space = nodes.empty() ? Rectangle(0, 0, 256, 256) : get_space();
+
+  slots.clear();
+  free_slots.clear();
+  slot_indexes.clear();
+  nodes.clear();
+  free_children.clear();
+  pending_merges.clear();
+  visit_stamp = 0;
+
+  Node root;
+  root.cell = space;
+  root.first_child = no_index;
+  root.slots.reserve(max_in_cell);
+  if (debug_quadtrees) {
+    root.color = Color(Random::get_number(256), Random::get_number(256), Random::get_number(256));
+  }
+  nodes.push_back(std::move(root));
+}
+
+/**
+ * \brief Clears the quadtree and initializes it with a new size.
+ * \param space Rectangle representing the space to create partitions of.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::initialize(const Rectangle& space) {
+
+  // Expand the space so that it is square.
+  Rectangle square = space;
+  if (space.get_width() > space.get_height()) {
+    square.set_y(square.get_center().y - square.get_width() / 2);
+    square.set_height(square.get_width());
+  }
+  else {
+    square.set_x(square.get_center().x - square.get_height() / 2);
+    square.set_width(square.get_height());
+  }
+
+  nodes.clear();
+  clear();
+  nodes[0].cell = square;
+}
+
+/**
+ * \brief Returns the space partitioned by this quadtree.
+ * \return The partitioned space.
+ */
+template<typename T, typename Hash>
+Rectangle FlatQuadtree<T, Hash>::get_space() const {
+  return nodes[0].cell;
+}
+
+/**
+ * \brief Adds an element to the quadtree.
+ *
+ * It is allowed to add it outside the space delimited by the quadtree,
+ * for example if it can move inside later.
+ *
+ * \param element The element to add.
+ * \param bounding_box Bounding box of the element.
+ * \return \c true in case of success.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::add(const T& element, const Rectangle& bounding_box) {
+
+  if (contains(element)) {
+    // Element already in the quadtree.
+    return false;
+  }
+
+  const uint32_t slot_index = allocate_slot(element, bounding_box);
+  if (!slots[slot_index].outside) {
+    add_to_node(0, slot_index);
+  }
+
+  return true;
+}
+
+/**
+ * \brief Adds several elements to the quadtree.
+ *
+ * The result is the same as calling add() for each element.
+ * If the quadtree is empty, like at map initialization, the elements are
+ * sorted by the Morton code of their main cell and the whole tree is built
+ * in one pass.
+ * Otherwise, elements first go to the existing leaves, and each leaf that
+ * becomes too full is split once at the end instead of being counted at
+ * each addition.
+ *
+ * \param elements The elements to add and their bounding boxes.
+ * \return The number of elements added, not counting the ones that were
+ * already in the quadtree.
+ */
+template<typename T, typename Hash>
+int FlatQuadtree<T, Hash>::add_elements(const std::vector<std::pair<T, Rectangle>>& elements) {
+
+  slot_indexes.reserve(slot_indexes.size() + elements.size());
+
+  const bool empty = !is_split(0) && nodes[0].slots.empty();
+  int num_added = 0;
+  std::vector<uint32_t> new_slots;
+  std::vector<uint32_t> leaves;
+  for (const std::pair<T, Rectangle>& element : elements) {
+    if (contains(element.first)) {
+      continue;
+    }
+    const uint32_t slot_index = allocate_slot(element.first, element.second);
+    if (!slots[slot_index].outside) {
+      if (empty) {
+        new_slots.push_back(slot_index);
+      }
+      else {
+        add_to_leaves(0, slot_index, leaves);
+      }
+    }
+    ++num_added;
+  }
+
+  if (empty) {
+    build(new_slots);
+    return num_added;
+  }
+
+  // Split the leaves that received too many elements.
+  std::sort(leaves.begin(), leaves.end());
+  leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+  for (uint32_t node_index : leaves) {
+    const Size& cell_size = nodes[node_index].cell.get_size();
+    if (!is_split(node_index) &&
+        cell_size.width > min_cell_size &&
+        cell_size.height > min_cell_size &&
+        get_num_elements(node_index) > max_in_cell) {
+      split(node_index);
+    }
+  }
+
+  return num_added;
+}
+
+/**
+ * \brief Removes an element from the quadtree.
+ * \param element The element to remove.
+ * \return \c true in case of success.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::remove(const T& element) {
+
+  const auto& it = slot_indexes.find(element);
+  if (it == slot_indexes.end()) {
+    // Unknown element.
+    return false;
+  }
+
+  const uint32_t slot_index = it->second;
+  slot_indexes.erase(it);
+
+  bool removed = true;
+  if (!slots[slot_index].outside) {
+    removed = remove_from_node(0, slot_index, false);
+  }
+
+  // Release the element now and recycle the slot.
+  slots[slot_index].element = T();
+  free_slots.push_back(slot_index);
+  return removed;
+}
+
+/**
+ * \brief Moves the element in the quadtree.
+ *
+ * This function should be called when the position or size or the element
+ * is changed.
+ *
+ * It is allowed for an element to go to or come from outside the space of the
+ * quadtree.
+ *
+ * If the old and new bounding boxes fit in the same leaf cell, which is the
+ * case of most small displacements, only the stored box is updated.
+ * Otherwise, merging cells that become almost empty is postponed to the
+ * next call to rebalance().
+ *
+ * \param element The element to move. If the element is not in the quadtree,
+ * does nothing and returns \c false.
+ * \param bounding_box New bounding box of the element.
+ * \return \c true in case of success.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::move(const T& element, const Rectangle& bounding_box) {
+
+  const auto& it = slot_indexes.find(element);
+  if (it == slot_indexes.end()) {
+    // Not in the quadtree: error.
+    return false;
+  }
+
+  const uint32_t slot_index = it->second;
+  Slot& slot = slots[slot_index];
+  if (slot.bounding_box == bounding_box) {
+    // Already in the quadtree and no change.
+    return true;
+  }
+
+  if (!slot.outside) {
+    const uint32_t leaf_index = find_leaf(slot.bounding_box);
+    if (leaf_index != no_index &&
+        nodes[leaf_index].cell.contains(bounding_box)) {
+      // Still in the same leaf: the element stays where it is.
+      slot.bounding_box = bounding_box;
+      return true;
+    }
+  }
+
+  // Keep the same slot: only the nodes referencing it change.
+  if (!slot.outside) {
+    if (!remove_from_node(0, slot_index, true)) {
+      // Failed to remove.
+      return false;
+    }
+  }
+
+  slot.bounding_box = bounding_box;
+  slot.outside = !bounding_box.overlaps(get_space());
+  if (!slot.outside) {
+    add_to_node(0, slot_index);
+  }
+  return true;
+}
+
+/**
+ * \brief Merges the cells left almost empty by previous moves.
+ *
+ * Call this function once the elements have stopped moving for now,
+ * for example at the end of each tick.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::rebalance() {
+
+  for (size_t i = 0; i < pending_merges.size(); ++i) {
+    const uint32_t node_index = pending_merges[i];
+    if (!is_split(node_index)) {
+      // Already merged, or released meanwhile.
+      continue;
+    }
+    const uint32_t first_child = nodes[node_index].first_child;
+    bool children_are_leaves = true;
+    for (uint32_t j = first_child; j < first_child + 4; ++j) {
+      children_are_leaves &= !is_split(j);
+    }
+    if (children_are_leaves &&
+        get_num_elements(node_index) < min_in_4_cells) {
+      merge(node_index);
+    }
+  }
+  pending_merges.clear();
+}
+
+/**
+ * \brief Returns the total number of elements in the quadtree.
+ * \return The number of elements, including elements outside the quadtree
+ * space.
+ */
+template<typename T, typename Hash>
+int FlatQuadtree<T, Hash>::get_num_elements() const {
+  return static_cast<int>(slot_indexes.size());
+}
+
+/**
+ * \brief Returns whether an element is in the quadtree.
+ * \param element The element to check.
+ * \return \c true if it is in the quadtree, even if it is
+ * outside the quadtree space.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::contains(const T& element) const {
+
+  return slot_indexes.find(element) != slot_indexes.end();
+}
+
+/**
+ * \brief Gets the elements intersecting the given rectangle.
+ *
+ * No memory is allocated if the result buffer is already big enough.
+ *
+ * \param[in] region The rectangle to check.
+ * The rectangle should be entirely contained in the quadtree space.
+ * Elements outside the quadtree space are not added there.
+ * \param[out] result Buffer where to append elements intersecting the
+ * rectangle, each one only once and in no particular order.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::get_elements(
+    const Rectangle& region,
+    std::vector<T>& result
+) const {
+
+  visit_elements(region, [&result](const T& element) {
+    result.push_back(element);
+    return true;
+  });
+}
+
+/**
+ * \brief Calls a function on each element intersecting the given rectangle.
+ *
+ * Each element is visited only once, in no particular order.
+ * The visitor must not modify the quadtree nor make other queries
+ * on it while it is being called.
+ *
+ * \param region The rectangle to check.
+ * \param visitor A function taking a <tt>const T&</tt> and returning
+ * \c false to stop the iteration.
+ * \return \c false if the visitor stopped the iteration.
+ */
+template<typename T, typename Hash>
+template<typename Visitor>
+bool FlatQuadtree<T, Hash>::visit_elements(
+    const Rectangle& region,
+    Visitor&& visitor
+) const {
+
+  const uint32_t stamp = next_visit_stamp();
+  return visit_node(0, region, stamp, visitor);
+}
+
+/**
+ * \brief Draws the quadtree on a surface for debugging purposes.
+ * \param dst_surface The destination surface.
+ * \param dst_position Where to draw on that surface.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::draw(const SurfacePtr& dst_surface, const Point& dst_position) {
+
+  draw_node(0, dst_surface, dst_position);
+}
+
+/**
+ * \brief Returns whether a node is split or is a leaf cell.
+ * \param node_index Index of a node in the pool.
+ * \return \c true if the node is split.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::is_split(uint32_t node_index) const {
+
+  return nodes[node_index].first_child != no_index;
+}
+
+/**
+ * \brief Gets a block of 4 contiguous unused nodes from the pool.
+ *
+ * Existing references to nodes may be invalidated.
+ *
+ * \return Index of the first node of the block.
+ */
+template<typename T, typename Hash>
+uint32_t FlatQuadtree<T, Hash>::allocate_children() {
+
+  if (!free_children.empty()) {
+    const uint32_t first_child = free_children.back();
+    free_children.pop_back();
+    return first_child;
+  }
+
+  const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+  nodes.resize(nodes.size() + 4);
+  for (uint32_t i = first_child; i < first_child + 4; ++i) {
+    nodes[i].first_child = no_index;
+    nodes[i].slots.reserve(max_in_cell);
+  }
+  return first_child;
+}
+
+/**
+ * \brief Adds an element to a node if its bounding box intersects it.
+ *
+ * Splits the node if necessary when the threshold is exceeded.
+ *
+ * \param node_index Index of a node in the pool.
+ * \param slot_index Slot of the element to add.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::add_to_node(uint32_t node_index, uint32_t slot_index) {
+
+  const Rectangle& bounding_box = slots[slot_index].bounding_box;
+  if (!nodes[node_index].cell.overlaps(bounding_box)) {
+    // Nothing to do.
+    return;
+  }
+
+  if (!is_split(node_index)) {
+
+    // See if it is time to split.
+    if (is_main_cell(node_index, bounding_box)) {
+      // We are the main cell of this element: it counts in the total.
+      const Size& cell_size = nodes[node_index].cell.get_size();
+      if (get_num_elements(node_index) >= max_in_cell &&
+          cell_size.width > min_cell_size &&
+          cell_size.height > min_cell_size) {
+        split(node_index);
+      }
+    }
+  }
+
+  if (!is_split(node_index)) {
+    // Add it to the current node.
+    nodes[node_index].slots.push_back(slot_index);
+    return;
+  }
+
+  // Add it to children cells.
+  const uint32_t first_child = nodes[node_index].first_child;
+  for (uint32_t i = first_child; i < first_child + 4; ++i) {
+    add_to_node(i, slot_index);
+  }
+}
+
+/**
+ * \brief Removes an element from a node if its bounding box intersects it.
+ *
+ * Merges nodes when necessary.
+ *
+ * \param node_index Index of a node in the pool.
+ * \param slot_index Slot of the element to remove.
+ * \param defer_merge \c true to only remember the nodes to merge
+ * until the next rebalance().
+ * \return \c true in the element was found and removed.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::remove_from_node(uint32_t node_index, uint32_t slot_index, bool defer_merge) {
+
+  Node& node = nodes[node_index];
+  if (!node.cell.overlaps(slots[slot_index].bounding_box)) {
+    // Nothing to do.
+    return false;
+  }
+
+  if (!is_split(node_index)) {
+    // Remove from this cell. The order of elements in a leaf does not matter.
+    const auto& it = std::find(node.slots.begin(), node.slots.end(), slot_index);
+    if (it == node.slots.end()) {
+      // The element was not here.
+      return false;
+    }
+    *it = node.slots.back();
+    node.slots.pop_back();
+    return true;
+  }
+
+  // Remove from children cells.
+  bool removed = false;
+  const uint32_t first_child = node.first_child;
+  for (uint32_t i = first_child; i < first_child + 4; ++i) {
+    removed |= remove_from_node(i, slot_index, defer_merge);
+  }
+
+  if (removed && defer_merge) {
+    // Children are added before their parent,
+    // so that rebalance() can merge them in a single pass.
+    pending_merges.push_back(node_index);
+  }
+  else if (removed &&
+      !is_split(first_child)  // We are the parent node of where the element was removed.
+  ) {
+    // See if it is time to merge.
+    if (get_num_elements(node_index) < min_in_4_cells) {
+      merge(node_index);
+    }
+  }
+  return removed;
+}
+
+/**
+ * \brief Returns the leaf cell that entirely contains a box.
+ * \param bounding_box The box to search.
+ * \return Index of the leaf, or no_index if the box is not entirely
+ * contained in a single leaf.
+ */
+template<typename T, typename Hash>
+uint32_t FlatQuadtree<T, Hash>::find_leaf(const Rectangle& bounding_box) const {
+
+  if (!nodes[0].cell.contains(bounding_box)) {
+    return no_index;
+  }
+
+  uint32_t node_index = 0;
+  while (is_split(node_index)) {
+    const uint32_t first_child = nodes[node_index].first_child;
+    uint32_t child_index = no_index;
+    for (uint32_t i = first_child; i < first_child + 4; ++i) {
+      if (nodes[i].cell.contains(bounding_box)) {
+        child_index = i;
+        break;
+      }
+    }
+    if (child_index == no_index) {
+      // The box overlaps several children.
+      return no_index;
+    }
+    node_index = child_index;
+  }
+  return node_index;
+}
+
+/**
+ * \brief Takes a free slot for a new element and fills it.
+ * \param element The element to add.
+ * \param bounding_box Bounding box of the element.
+ * \return Index of the slot.
+ */
+template<typename T, typename Hash>
+uint32_t FlatQuadtree<T, Hash>::allocate_slot(const T& element, const Rectangle& bounding_box) {
+
+  uint32_t slot_index;
+  if (!free_slots.empty()) {
+    slot_index = free_slots.back();
+    free_slots.pop_back();
+  }
+  else {
+    slot_index = static_cast<uint32_t>(slots.size());
+    slots.emplace_back();
+  }
+
+  Slot& slot = slots[slot_index];
+  slot.element = element;
+  slot.bounding_box = bounding_box;
+  slot.visit_stamp = 0;
+  slot.outside = !bounding_box.overlaps(get_space());
+  slot_indexes.emplace(element, slot_index);
+  return slot_index;
+}
+
+/**
+ * \brief Adds an element to the leaves its bounding box intersects
+ * without splitting them.
+ * \param node_index Index of a node in the pool.
+ * \param slot_index Slot of the element to add.
+ * \param[in,out] leaves Receives the leaves modified.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::add_to_leaves(
+    uint32_t node_index, uint32_t slot_index, std::vector<uint32_t>& leaves) {
+
+  if (!nodes[node_index].cell.overlaps(slots[slot_index].bounding_box)) {
+    return;
+  }
+
+  if (!is_split(node_index)) {
+    nodes[node_index].slots.push_back(slot_index);
+    leaves.push_back(node_index);
+    return;
+  }
+
+  const uint32_t first_child = nodes[node_index].first_child;
+  for (uint32_t i = first_child; i < first_child + 4; ++i) {
+    add_to_leaves(i, slot_index, leaves);
+  }
+}
+
+/**
+ * \brief Builds the nodes of an empty quadtree and fills them with elements.
+ *
+ * Elements are sorted by the Morton code of their main cell, so that the
+ * main elements of each node are contiguous.
+ * Nodes are then created from the root, splitting each one that has too
+ * many main elements, before placing every element in its leaves.
+ *
+ * \param slot_indexes_to_add Slots of the elements to add.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::build(const std::vector<uint32_t>& slot_indexes_to_add) {
+
+  Debug::check_assertion(!is_split(0) && nodes[0].slots.empty(), "Quadtree is not empty");
+
+  std::vector<std::pair<uint64_t, uint32_t>> codes;
+  codes.reserve(slot_indexes_to_add.size());
+  for (uint32_t slot_index : slot_indexes_to_add) {
+    codes.emplace_back(get_morton_code(slots[slot_index].bounding_box), slot_index);
+  }
+  std::sort(codes.begin(), codes.end());
+
+  build_node(0, codes, 0, codes.size(), 0);
+
+  std::vector<uint32_t> leaves;
+  for (const std::pair<uint64_t, uint32_t>& code : codes) {
+    add_to_leaves(0, code.second, leaves);
+  }
+}
+
+/**
+ * \brief Splits a node and its descendants according to sorted elements.
+ * \param node_index Index of a node in the pool.
+ * \param codes Morton codes and slots of all elements, sorted.
+ * \param begin Index in codes of the first element whose main cell is
+ * under this node.
+ * \param end Index in codes after the last one.
+ * \param depth Depth of the node.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::build_node(
+    uint32_t node_index,
+    const std::vector<std::pair<uint64_t, uint32_t>>& codes,
+    size_t begin,
+    size_t end,
+    int depth
+) {
+  const Size cell_size = nodes[node_index].cell.get_size();
+  if (depth >= max_depth ||
+      end - begin <= static_cast<size_t>(max_in_cell) ||
+      cell_size.width <= min_cell_size ||
+      cell_size.height <= min_cell_size) {
+    return;
+  }
+
+  const uint32_t first_child = create_children(node_index);
+  const int shift = 2 * (max_depth - 1 - depth);
+  size_t child_begin = begin;
+  for (uint32_t i = 0; i < 4; ++i) {
+    size_t child_end = child_begin;
+    while (child_end < end && ((codes[child_end].first >> shift) & 3) == i) {
+      ++child_end;
+    }
+    build_node(first_child + i, codes, child_begin, child_end, depth + 1);
+    child_begin = child_end;
+  }
+}
+
+/**
+ * \brief Returns the Morton code of the main cell of a box.
+ *
+ * The code has two bits per level of the quadtree, telling which child
+ * contains the clamped center of the box, in the order of split().
+ * Levels below the smallest cells are zero.
+ *
+ * \param bounding_box A box inside the quadtree space.
+ * \return The Morton code.
+ */
+template<typename T, typename Hash>
+uint64_t FlatQuadtree<T, Hash>::get_morton_code(const Rectangle& bounding_box) const {
+
+  const Point center = get_main_point(bounding_box);
+  Rectangle cell = get_space();
+  uint64_t code = 0;
+  for (int depth = 0; depth < max_depth; ++depth) {
+    uint32_t child = 0;
+    if (cell.get_width() > min_cell_size && cell.get_height() > min_cell_size) {
+      const Point& middle = cell.get_center();
+      child = (center.x >= middle.x ? 1 : 0) + (center.y >= middle.y ? 2 : 0);
+      cell = get_child_cell(cell, child);
+    }
+    code = (code << 2) | child;
+  }
+  return code;
+}
+
+/**
+ * \brief Returns the rectangle of a child of a cell.
+ * \param cell The parent cell.
+ * \param child Index of the child between 0 and 3: top-left, top-right,
+ * bottom-left, bottom-right.
+ * \return The child cell.
+ */
+template<typename T, typename Hash>
+Rectangle FlatQuadtree<T, Hash>::get_child_cell(const Rectangle& cell, uint32_t child) {
+
+  const Point& center = cell.get_center();
+  switch (child) {
+
+  case 0:
+    return Rectangle(cell.get_top_left(), center);
+
+  case 1:
+    return Rectangle(Point(center.x, cell.get_top()), Point(cell.get_right(), center.y));
+
+  case 2:
+    return Rectangle(Point(cell.get_left(), center.y), Point(center.x, cell.get_bottom()));
+
+  default:
+    return Rectangle(center, cell.get_bottom_right());
+  }
+}
+
+/**
+ * \brief Creates the 4 empty children of a leaf.
+ * \param node_index Index of a node in the pool.
+ * \return Index of the first child.
+ */
+template<typename T, typename Hash>
+uint32_t FlatQuadtree<T, Hash>::create_children(uint32_t node_index) {
+
+  const uint32_t first_child = allocate_children();
+  const Rectangle cell = nodes[node_index].cell;
+  for (uint32_t i = 0; i < 4; ++i) {
+    Node& child = nodes[first_child + i];
+    child.cell = get_child_cell(cell, i);
+    child.first_child = no_index;
+    child.slots.clear();
+    if (debug_quadtrees) {
+      child.color = Color(Random::get_number(256), Random::get_number(256), Random::get_number(256));
+    }
+  }
+  nodes[node_index].first_child = first_child;
+  return first_child;
+}
+
+/**
+ * \brief Splits a cell in four parts and moves its elements to them.
+ * \param node_index Index of a node in the pool.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::split(uint32_t node_index) {
+
+  Debug::check_assertion(!is_split(node_index), "Quadtree node already split");
+
+  // Create 4 children cells.
+  const uint32_t first_child = create_children(node_index);
+
+  // Move existing elements into them.
+  // Children may split in turn and grow the pool, so don't keep references.
+  std::vector<uint32_t> moved_slots;
+  moved_slots.swap(nodes[node_index].slots);
+  for (uint32_t slot_index : moved_slots) {
+    for (uint32_t i = first_child; i < first_child + 4; ++i) {
+      add_to_node(i, slot_index);
+    }
+  }
+
+  Debug::check_assertion(is_split(node_index), "Quadtree node split failed");
+}
+
+/**
+ * \brief Merges the four children cell of a node into it and releases them.
+ *
+ * The children must already be leaves.
+ *
+ * \param node_index Index of a node in the pool.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::merge(uint32_t node_index) {
+
+  Debug::check_assertion(is_split(node_index), "Quadtree node already merged");
+
+  // Avoid duplicates with a visit stamp while preserving a deterministic order.
+  const uint32_t stamp = next_visit_stamp();
+  Node& node = nodes[node_index];
+  const uint32_t first_child = node.first_child;
+  for (uint32_t i = first_child; i < first_child + 4; ++i) {
+    Node& child = nodes[i];
+    Debug::check_assertion(!is_split(i), "Quadtree node child is not a leaf");
+    for (uint32_t slot_index : child.slots) {
+      const Slot& slot = slots[slot_index];
+      if (slot.visit_stamp != stamp) {
+        slot.visit_stamp = stamp;
+        node.slots.push_back(slot_index);
+      }
+    }
+    child.slots.clear();
+  }
+
+  node.first_child = no_index;
+  free_children.push_back(first_child);
+
+  Debug::check_assertion(!is_split(node_index), "Quadtree node merge failed");
+}
+
+/**
+ * \brief Returns whether a cell contains a box and is also its main cell.
+ *
+ * The main cell is used to ensure uniqueness, for example when counting
+ * elements.
+ *
+ * \param node_index Index of a node in the pool.
+ * \param bounding_box The box to test.
+ */
+template<typename T, typename Hash>
+bool FlatQuadtree<T, Hash>::is_main_cell(uint32_t node_index, const Rectangle& bounding_box) const {
+
+  const Rectangle& cell = nodes[node_index].cell;
+  if (!cell.overlaps(bounding_box)) {
+    // Not overlapping this cell.
+    return false;
+  }
+
+  // The bounding box is in this cell. See if this is the main cell.
+  return cell.contains(get_main_point(bounding_box));
+}
+
+/**
+ * \brief Returns the point that determines the main cell of a box.
+ * \param bounding_box A box.
+ * \return The center of the box, clamped to the quadtree space.
+ */
+template<typename T, typename Hash>
+Point FlatQuadtree<T, Hash>::get_main_point(const Rectangle& bounding_box) const {
+
+  const Point& center = bounding_box.get_center();
+
+  // Clamp the center to the quadtree space,
+  // in case the center it actually outside.
+  const Rectangle& quadtree_space = get_space();
+  return {
+      std::max(quadtree_space.get_left(), std::min(quadtree_space.get_right() - 1, center.x)),
+      std::max(quadtree_space.get_top(), std::min(quadtree_space.get_bottom() - 1, center.y))
+  };
+}
+
+/**
+ * \brief Returns the number of elements whose center is under a node.
+ * \param node_index Index of a node in the pool.
+ * \return The number of elements under this node.
+ */
+template<typename T, typename Hash>
+int FlatQuadtree<T, Hash>::get_num_elements(uint32_t node_index) const {
+
+  int num_elements = 0;
+  if (!is_split(node_index)) {
+    // Some elements can overlap several cells.
+    // To avoid duplicates, we count an element if this cell is its main cell.
+    for (uint32_t slot_index : nodes[node_index].slots) {
+      if (is_main_cell(node_index, slots[slot_index].bounding_box)) {
+        ++num_elements;
+      }
+    }
+  }
+  else {
+    // Ask children.
+    const uint32_t first_child = nodes[node_index].first_child;
+    for (uint32_t i = first_child; i < first_child + 4; ++i) {
+      num_elements += get_num_elements(i);
+    }
+  }
+  return num_elements;
+}
+
+/**
+ * \brief Starts a new visit and returns its stamp.
+ *
+ * When the stamp wraps around, the stamps of all slots are reset.
+ *
+ * \return The new visit stamp, never zero.
+ */
+template<typename T, typename Hash>
+uint32_t FlatQuadtree<T, Hash>::next_visit_stamp() const {
+
+  ++visit_stamp;
+  if (visit_stamp == 0) {
+    for (const Slot& slot : slots) {
+      slot.visit_stamp = 0;
+    }
+    visit_stamp = 1;
+  }
+  return visit_stamp;
+}
+
+/**
+ * \brief Calls a visitor on elements intersecting a rectangle under a node.
+ * \param node_index Index of a node in the pool.
+ * \param region The rectangle to check.
+ * \param stamp Stamp of the current visit.
+ * \param visitor The function to call.
+ * \return \c false if the visitor stopped the iteration.
+ */
+template<typename T, typename Hash>
+template<typename Visitor>
+bool FlatQuadtree<T, Hash>::visit_node(
+    uint32_t node_index,
+    const Rectangle& region,
+    uint32_t stamp,
+    Visitor& visitor
+) const {
+
+  const Node& node = nodes[node_index];
+  if (!node.cell.overlaps(region)) {
+    // Nothing here.
+    return true;
+  }
+
+  if (!is_split(node_index)) {
+    for (uint32_t slot_index : node.slots) {
+      const Slot& slot = slots[slot_index];
+      if (slot.visit_stamp != stamp &&
+          slot.bounding_box.overlaps(region)) {
+        slot.visit_stamp = stamp;
+        if (!visitor(slot.element)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Get from from children cells.
+  const uint32_t first_child = node.first_child;
+  for (uint32_t i = first_child; i < first_child + 4; ++i) {
+    if (!visit_node(i, region, stamp, visitor)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Draws a node on a surface for debugging purposes.
+ * \param node_index Index of a node in the pool.
+ * \param dst_surface The destination surface.
+ * \param dst_position Where to draw on that surface.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::draw_node(
+    uint32_t node_index,
+    const SurfacePtr& dst_surface,
+    const Point& dst_position
+) {
+  const Node& node = nodes[node_index];
+  if (!is_split(node_index)) {
+    // Draw the rectangle of the node.
+    draw_rectangle(node.cell, node.color, dst_surface, dst_position);
+
+    // Draw bounding boxes of elements.
+    for (uint32_t slot_index : node.slots) {
+      const Rectangle& bounding_box = slots[slot_index].bounding_box;
+      if (is_main_cell(node_index, bounding_box)) {
+        draw_rectangle(bounding_box, node.color, dst_surface, dst_position);
+      }
+    }
+  }
+  else {
+    // Draw children nodes.
+    const uint32_t first_child = node.first_child;
+    for (uint32_t i = first_child; i < first_child + 4; ++i) {
+      draw_node(i, dst_surface, dst_position);
+    }
+  }
+}
+
+/**
+ * \brief Draws the border of a rectangle on a surface for debugging purposes.
+ * \param rectangle The rectangle to draw.
+ * \param line_color The color to use.
+ * \param dst_surface The destination surface.
+ * \param dst_position Where to draw on that surface.
+ */
+template<typename T, typename Hash>
+void FlatQuadtree<T, Hash>::draw_rectangle(
+    const Rectangle& rectangle,
+    const Color& line_color,
+    const SurfacePtr& dst_surface,
+    const Point& dst_position
+) {
+  Rectangle where = rectangle;
+  where.set_xy(where.get_xy() + dst_position);
+  dst_surface->fill_with_color(line_color, Rectangle(
+      where.get_top_left(), Size(where.get_width(), 1)
+  ));
+  dst_surface->fill_with_color(line_color, Rectangle(
+      where.get_bottom_left() + Point(0, -1), Size(where.get_width(), 1)
+  ));
+  dst_surface->fill_with_color(line_color, Rectangle(
+      where.get_top_left(), Size(1, where.get_height())
+  ));
+  dst_surface->fill_with_color(line_color, Rectangle(
+      where.get_top_right() + Point(-1, 0), Size(1, where.get_height())
+  ));
+}
+
+}  // namespace Solarus
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FLAT_STRING_MAP_H
+#define SOLARUS_FLAT_STRING_MAP_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/BinaryData.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Immutable map from strings to values, stored contiguously.
+ *
+ * Entries are kept in one vector, in the order they were given, and found
+ * through an open addressing hash table of entry indexes. Lookups compute
+ * one hash and usually compare a single key, and iterating the entries
+ * touches contiguous memory, unlike std::map.
+ *
+ * The map is built once and never modified, so it can be built by a
+ * thread and then read by others without locking.
+ *
+ * \tparam T Type of values.
+ */
+template<typename T>
+class FlatStringMap {
+
+  public:
+
+    using Entry = std::pair<std::string, T>;
+
+    FlatStringMap() = default;
+
+    /**
+     * \brief Builds a map from its entries.
+     *
+     * If several entries have the same key, the first one is found.
+     *
+     * \param entries The entries.
+     */
+    explicit FlatStringMap(std::vector<Entry> entries):
+      entries(std::move(entries)) {
+
+      size_t num_slots = 1;
+      while (num_slots < this->entries.size() * 2) {
+        num_slots *= 2;
+      }
+      slots.assign(num_slots, 0);
+      hashes.reserve(this->entries.size());
+      for (size_t i = 0; i < this->entries.size(); ++i) {
+        const uint32_t hash = get_hash(this->entries[i].first);
+        hashes.push_back(hash);
+        size_t slot = hash & (num_slots - 1);
+        while (slots[slot] != 0) {
+          slot = (slot + 1) & (num_slots - 1);
+        }
+        slots[slot] = static_cast<uint32_t>(i + 1);
+      }
+    }
+
+    /**
+     * \brief Returns the number of entries.
+     * \return The size of the map.
+     */
+    size_t size() const {
+      return entries.size();
+    }
+
+    /**
+     * \brief Returns whether the map has no entries.
+     * \return \c true if the map is empty.
+     */
+    bool empty() const {
+      return entries.empty();
+    }
+
+    /**
+     * \brief Returns all entries, in the order they were given.
+     * \return The entries.
+     */
+    const std::vector<Entry>& get_entries() const {
+      return entries;
+    }
+
+    /**
+     * \brief Returns the value of a key.
+     * \param key The key to find.
+     * \return The value, or nullptr if there is no such key.
+     */
+    const T* find(const std::string& key) const {
+
+      if (entries.empty()) {
+        return nullptr;
+      }
+      const uint32_t hash = get_hash(key);
+      const size_t mask = slots.size() - 1;
+      for (size_t slot = hash & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+        const size_t index = slots[slot] - 1;
+        if (hashes[index] == hash && entries[index].first == key) {
+          return &entries[index].second;
+        }
+      }
+      return nullptr;
+    }
+
+  private:
+
+    /**
+     * \brief Hashes a key.
+     * \param key The key.
+     * \return Its hash.
+     */
+    static uint32_t get_hash(const std::string& key) {
+      const uint64_t hash = get_fnv1a_hash(key.data(), key.size());
+      return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    std::vector<Entry> entries;     /**< Keys and values. */
+    std::vector<uint32_t> hashes;   /**< Hash of the key of each entry. */
+    std::vector<uint32_t> slots;    /**< Hash table: index of an entry plus one,
+                                     * or 0 for an empty slot. */
+};
+
+}
+
+#endif
+
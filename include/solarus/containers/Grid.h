@@ -21,6 +21,7 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -30,13 +31,22 @@ namespace Solarus {
  * \brief A collection of objects spatially located in a grid.
  *
  * In the current implementation, objects cannot move or be resized.
+ *
+ * \tparam T Type of objects.
+ * \tparam Allocator Allocator of the cells.
  */
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>>
 class Grid {
 
   public:
 
-    Grid(const Size& grid_size, const Size& cell_size);
+    using Cell = std::vector<T, Allocator>;   /**< Elements of a cell. */
+
+    Grid(
+        const Size& grid_size,
+        const Size& cell_size,
+        const Allocator& allocator = Allocator()
+    );
 
     const Size& get_grid_size() const;
     const Size& get_cell_size() const;
@@ -47,7 +57,7 @@ class Grid {
     void clear();
     void add(const T& element, const Rectangle& bounding_box);
 
-    const std::vector<T>& get_elements(size_t cell_index) const;
+    const Cell& get_elements(size_t cell_index) const;
     void get_elements(const Rectangle& where,
         std::vector<T>& elements) const;
 
@@ -57,7 +67,9 @@ class Grid {
     const Size cell_size;
     size_t num_rows;
     size_t num_columns;
-    std::vector<std::vector<T>> elements;     /**< Two-dimensional array of cells. */
+    Allocator allocator;
+    std::vector<Cell, typename std::allocator_traits<Allocator>::template rebind_alloc<Cell>>
+        elements;                             /**< Two-dimensional array of cells. */
 
 };
 
@@ -66,13 +78,20 @@ class Grid {
  * \param grid_size Size of the grid to create.
  * \param cell_size Size of a cell of the grid. It is allowed that the size of
  * the grid is not a multiple of the cell size.
+ * \param allocator Allocator of the cells.
  */
-template <typename T>
-Grid<T>::Grid(const Size& grid_size, const Size& cell_size):
+template <typename T, typename Allocator>
+Grid<T, Allocator>::Grid(
+    const Size& grid_size,
+    const Size& cell_size,
+    const Allocator& allocator
+):
     grid_size(grid_size),
     cell_size(cell_size),
     num_rows(0),
-    num_columns(0) {
+    num_columns(0),
+    allocator(allocator),
+    elements(allocator) {
 
   Debug::check_assertion(grid_size.width > 0 && grid_size.height > 0,
       "Invalid grid size");
@@ -88,15 +107,15 @@ Grid<T>::Grid(const Size& grid_size, const Size& cell_size):
   if (grid_size.width % cell_size.width != 0) {
     ++num_columns;
   }
-  elements.resize(num_rows * num_columns);
+  elements.assign(num_rows * num_columns, Cell(allocator));
 }
 
 /**
  * \brief Returns the size of the grid.
  * \return The size of the grid.
  */
-template <typename T>
-const Size& Grid<T>::get_grid_size() const {
+template <typename T, typename Allocator>
+const Size& Grid<T, Allocator>::get_grid_size() const {
   return grid_size;
 }
 
@@ -104,8 +123,8 @@ const Size& Grid<T>::get_grid_size() const {
  * \brief Returns the size of a cell of the grid.
  * \return The size of a cell.
  */
-template <typename T>
-const Size& Grid<T>::get_cell_size() const {
+template <typename T, typename Allocator>
+const Size& Grid<T, Allocator>::get_cell_size() const {
   return cell_size;
 }
 
@@ -113,8 +132,8 @@ const Size& Grid<T>::get_cell_size() const {
  * \brief Returns the number of rows in the grid.
  * \return The number of rows.
  */
-template <typename T>
-size_t Grid<T>::get_num_rows() const {
+template <typename T, typename Allocator>
+size_t Grid<T, Allocator>::get_num_rows() const {
   return num_rows;
 }
 
@@ -122,8 +141,8 @@ size_t Grid<T>::get_num_rows() const {
  * \brief Returns the number of columns in the grid.
  * \return The number of columns.
  */
-template <typename T>
-size_t Grid<T>::get_num_columns() const {
+template <typename T, typename Allocator>
+size_t Grid<T, Allocator>::get_num_columns() const {
   return num_columns;
 }
 
@@ -131,8 +150,8 @@ size_t Grid<T>::get_num_columns() const {
  * \brief Returns the total number of cells in the grid.
  * \return The number of cells.
  */
-template <typename T>
-size_t Grid<T>::get_num_cells() const {
+template <typename T, typename Allocator>
+size_t Grid<T, Allocator>::get_num_cells() const {
   return elements.size();
 }
 
@@ -141,8 +160,8 @@ size_t Grid<T>::get_num_cells() const {
  * \param cell_index Index of a cell in the grid.
  * \return The elements in this cell.
  */
-template <typename T>
-const std::vector<T>& Grid<T>::get_elements(size_t cell_index) const {
+template <typename T, typename Allocator>
+const typename Grid<T, Allocator>::Cell& Grid<T, Allocator>::get_elements(size_t cell_index) const {
 
   Debug::check_assertion(cell_index < get_num_cells(),
       "Invalid index");
@@ -158,8 +177,8 @@ const std::vector<T>& Grid<T>::get_elements(size_t cell_index) const {
  * \param where The area to get.
  * \param[out] elements The vector to fill.
  */
-template <typename T>
-void Grid<T>::get_elements(
+template <typename T, typename Allocator>
+void Grid<T, Allocator>::get_elements(
     const Rectangle& where,
     std::vector<T>& elements) const {
 
@@ -184,7 +203,7 @@ void Grid<T>::get_elements(
         continue;
       }
 
-      const std::vector<T>& in_cell = this->elements[i * num_columns + j];
+      const Cell& in_cell = this->elements[i * num_columns + j];
       for (const T& element: in_cell) {
         if (elements_added.find(element) == elements_added.end()) {
           elements_added.insert(element);
@@ -198,11 +217,11 @@ void Grid<T>::get_elements(
 /**
  * \brief Removes all elements in the grid.
  */
-template <typename T>
-void Grid<T>::clear() {
+template <typename T, typename Allocator>
+void Grid<T, Allocator>::clear() {
 
   elements.clear();
-  elements.resize(num_rows * num_columns);
+  elements.assign(num_rows * num_columns, Cell(allocator));
 }
 
 /**
@@ -213,8 +232,8 @@ void Grid<T>::clear() {
  * \param element The element to add.
  * \param bounding_box Bounding box of the element.
  */
-template <typename T>
-void Grid<T>::add(const T& element, const Rectangle& bounding_box) {
+template <typename T, typename Allocator>
+void Grid<T, Allocator>::add(const T& element, const Rectangle& bounding_box) {
 
   const int row1 = bounding_box.get_y() / cell_size.height;
   const int row2 = (bounding_box.get_y() + bounding_box.get_height()) / cell_size.height;
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MONOTONIC_ARENA_H
+#define SOLARUS_MONOTONIC_ARENA_H
+
+#include "solarus/core/Common.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Memory that is only released all at once.
+ *
+ * Allocations take the next bytes of a big block, and deallocations do
+ * nothing: everything is released when the arena is destroyed or when
+ * release() is called. This suits data that lives exactly as long as
+ * its owner, like the containers of a map, which are then freed in a
+ * few calls instead of one per element.
+ *
+ * Allocations are thread-safe, because some map data is built on
+ * several threads.
+ */
+class MonotonicArena {
+
+  public:
+
+    static constexpr size_t
+        default_block_size = 64 * 1024;  /**< Size of the blocks allocated. */
+
+    /**
+     * \brief Creates an empty arena.
+     * \param block_size Size of the blocks to allocate.
+     */
+    explicit MonotonicArena(size_t block_size = default_block_size):
+      block_size(block_size),
+      blocks(),
+      current(nullptr),
+      remaining(0),
+      num_bytes_used(0) {
+    }
+
+    MonotonicArena(const MonotonicArena& other) = delete;
+    MonotonicArena& operator=(const MonotonicArena& other) = delete;
+
+    /**
+     * \brief Returns some memory.
+     * \param size Number of bytes.
+     * \param alignment Alignment of the memory, a power of two.
+     * \return The memory.
+     */
+    void* allocate(size_t size, size_t alignment) {
+
+      std::lock_guard<std::mutex> lock(mutex);
+      const size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+      if (current == nullptr || padding + size > remaining) {
+        // Start a new block, bigger than usual for big requests.
+        const size_t new_block_size = std::max(block_size, size + alignment);
+        blocks.emplace_back(new char[new_block_size]);
+        current = blocks.back().get();
+        remaining = new_block_size;
+      }
+      return allocate_in_block(size, alignment);
+    }
+
+    /**
+     * \brief Frees all the memory given by this arena.
+     *
+     * Objects stored there must already be destroyed.
+     */
+    void release() {
+
+      std::lock_guard<std::mutex> lock(mutex);
+      blocks.clear();
+      current = nullptr;
+      remaining = 0;
+      num_bytes_used = 0;
+    }
+
+    /**
+     * \brief Returns the number of bytes given by this arena.
+     * \return The number of bytes allocated since the last release().
+     */
+    size_t get_num_bytes_used() const {
+
+      std::lock_guard<std::mutex> lock(mutex);
+      return num_bytes_used;
+    }
+
+    /**
+     * \brief Returns the number of blocks allocated.
+     * \return The number of blocks.
+     */
+    size_t get_num_blocks() const {
+
+      std::lock_guard<std::mutex> lock(mutex);
+      return blocks.size();
+    }
+
+  private:
+
+    /**
+     * \brief Takes memory from the current block.
+     * \param size Number of bytes.
+     * \param alignment Alignment of the memory.
+     * \return The memory.
+     */
+    void* allocate_in_block(size_t size, size_t alignment) {
+
+      const size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+      char* result = current + padding;
+      current = result + size;
+      remaining -= padding + size;
+      num_bytes_used += size;
+      return result;
+    }
+
+    const size_t block_size;                       /**< Size of new blocks. */
+    std::vector<std::unique_ptr<char[]>> blocks;   /**< All blocks allocated. */
+    char* current;                                 /**< Free part of the last block. */
+    size_t remaining;                              /**< Free bytes in the last block. */
+    size_t num_bytes_used;                         /**< Bytes given to callers. */
+    mutable std::mutex mutex;                      /**< Protects allocations. */
+};
+
+/**
+ * \brief Standard allocator that takes its memory from a MonotonicArena.
+ *
+ * A default-constructed allocator uses the global heap instead,
+ * so that containers can exist before the arena.
+ * Containers using an arena must be destroyed before it.
+ *
+ * \tparam T Type of objects allocated.
+ */
+template<typename T>
+class ArenaAllocator {
+
+  public:
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    /**
+     * \brief Creates an allocator that uses the global heap.
+     */
+    ArenaAllocator():
+      arena(nullptr) {
+    }
+
+    /**
+     * \brief Creates an allocator that uses an arena.
+     * \param arena The arena.
+     */
+    explicit ArenaAllocator(MonotonicArena& arena):
+      arena(&arena) {
+    }
+
+    /**
+     * \brief Conversion from an allocator of another type.
+     * \param other The other allocator.
+     */
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other):
+      arena(other.get_arena()) {
+    }
+
+    /**
+     * \brief Allocates memory for some objects.
+     * \param n Number of objects.
+     * \return The memory allocated.
+     */
+    T* allocate(size_t n) {
+
+      if (arena == nullptr) {
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+      return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * \brief Releases memory obtained with allocate().
+     *
+     * Does nothing if the memory comes from an arena.
+     *
+     * \param ptr The memory to release.
+     */
+    void deallocate(T* ptr, size_t /* n */) {
+
+      if (arena == nullptr) {
+        ::operator delete(ptr);
+      }
+    }
+
+    /**
+     * \brief Returns the arena used by this allocator.
+     * \return The arena, or nullptr for the global heap.
+     */
+    MonotonicArena* get_arena() const {
+      return arena;
+    }
+
+  private:
+
+    MonotonicArena* arena;     /**< The arena, or nullptr. */
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& first, const ArenaAllocator<U>& second) {
+  return first.get_arena() == second.get_arena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& first, const ArenaAllocator<U>& second) {
+  return first.get_arena() != second.get_arena();
+}
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MPSC_QUEUE_H
+#define SOLARUS_MPSC_QUEUE_H
+
+#include "solarus/core/Common.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Solarus {
+
+/**
+ * \brief A bounded lock-free queue fed by several threads.
+ *
+ * Any number of threads may push elements but only one thread may pop them.
+ * Each slot of the ring has a sequence number telling whether it is free
+ * or holds an element, so that producers only compete for the position
+ * where they write and never wait for each other.
+ */
+template <typename T>
+class MpscQueue {
+
+  public:
+
+    explicit MpscQueue(size_t capacity);
+
+    MpscQueue(const MpscQueue& other) = delete;
+    MpscQueue& operator=(const MpscQueue& other) = delete;
+
+    size_t get_capacity() const;
+    size_t get_num_pushed() const;
+    size_t get_num_popped() const;
+
+    bool push(T&& element);
+    bool pop(T& element);
+
+  private:
+
+    /**
+     * \brief A slot of the ring.
+     */
+    struct Slot {
+      std::atomic<size_t> sequence;    /**< Position this slot is ready for. */
+      T element;                       /**< The element if the slot is full. */
+    };
+
+    std::unique_ptr<Slot[]> slots;     /**< Ring of slots, of a power of two size. */
+    size_t size;                       /**< Number of slots. */
+    size_t mask;                       /**< Size of the ring minus one. */
+    alignas(64) std::atomic<size_t>
+        head;                          /**< Number of elements popped so far. */
+    alignas(64) std::atomic<size_t>
+        tail;                          /**< Number of positions taken by producers. */
+
+};
+
+/**
+ * \brief Creates an empty queue.
+ * \param capacity Minimum number of elements the queue can hold.
+ * It is rounded up to a power of two.
+ */
+template <typename T>
+MpscQueue<T>::MpscQueue(size_t capacity):
+    slots(),
+    size(1),
+    mask(0),
+    head(0),
+    tail(0) {
+
+  while (size < capacity) {
+    size *= 2;
+  }
+  slots.reset(new Slot[size]);
+  mask = size - 1;
+  for (size_t i = 0; i < size; ++i) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * \brief Returns the number of elements the queue can hold.
+ * \return The capacity.
+ */
+template <typename T>
+size_t MpscQueue<T>::get_capacity() const {
+  return size;
+}
+
+/**
+ * \brief Returns the number of positions taken by producers so far.
+ *
+ * Once get_num_popped() reaches this value, every element whose push
+ * had returned before the call has been popped.
+ *
+ * \return The number of elements pushed or being pushed.
+ */
+template <typename T>
+size_t MpscQueue<T>::get_num_pushed() const {
+  return tail.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Returns the number of elements popped so far.
+ * \return The number of elements popped.
+ */
+template <typename T>
+size_t MpscQueue<T>::get_num_popped() const {
+  return head.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Adds an element at the end of the queue.
+ *
+ * May be called from any thread.
+ *
+ * \param element The element to move into the queue.
+ * It is left unchanged if the queue is full.
+ * \return \c false if the queue is full.
+ */
+template <typename T>
+bool MpscQueue<T>::push(T&& element) {
+
+  size_t position = tail.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots[position & mask];
+    const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == position) {
+      // The slot is free: try to take this position.
+      if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        slot.element = std::move(element);
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+      // Another producer took it: position now holds the new tail.
+    }
+    else if (sequence < position) {
+      // The slot still holds the element pushed one lap before.
+      return false;
+    }
+    else {
+      position = tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * \brief Removes the element at the front of the queue.
+ *
+ * Must only be called from the consumer thread.
+ * An element whose push is still in progress is not popped yet, and
+ * neither are the ones after it.
+ *
+ * \param element Receives the element if there is one.
+ * \return \c false if there is no element ready.
+ */
+template <typename T>
+bool MpscQueue<T>::pop(T& element) {
+
+  const size_t position = head.load(std::memory_order_relaxed);
+  Slot& slot = slots[position & mask];
+  if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+    return false;
+  }
+
+  element = std::move(slot.element);
+  slot.element = T();  // Release what the slot holds now.
+  slot.sequence.store(position + size, std::memory_order_release);
+  head.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+}
+
+#endif
+
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_POOL_ALLOCATOR_H
+#define SOLARUS_POOL_ALLOCATOR_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace Solarus {
+
+/**
+ * \brief Released memory blocks of a given size, kept for reuse.
+ *
+ * At most max_free_blocks are kept: beyond that, blocks go back to the
+ * system allocator.
+ *
+ * Free lists are not thread-safe: pooled objects must be created and
+ * destroyed by the main thread.
+ *
+ * \tparam block_size Size of the blocks in bytes.
+ */
+template<size_t block_size>
+class PoolFreeList {
+
+  public:
+
+    static constexpr size_t max_free_blocks = 256;  /**< Maximum number of blocks kept. */
+
+    /**
+     * \brief Returns a block, reusing a released one if any.
+     * \return The block.
+     */
+    static void* allocate() {
+
+      State& state = get_state();
+      if (state.free_list == nullptr) {
+        return ::operator new(block_size);
+      }
+      FreeBlock* block = state.free_list;
+      state.free_list = block->next;
+      --state.num_free_blocks;
+      return block;
+    }
+
+    /**
+     * \brief Releases a block obtained with allocate().
+     * \param ptr The block.
+     */
+    static void free(void* ptr) {
+
+      State& state = get_state();
+      if (state.num_free_blocks >= max_free_blocks) {
+        ::operator delete(ptr);
+        return;
+      }
+      FreeBlock* block = static_cast<FreeBlock*>(ptr);
+      block->next = state.free_list;
+      state.free_list = block;
+      ++state.num_free_blocks;
+    }
+
+    /**
+     * \brief Returns the number of released blocks kept for reuse.
+     * \return The number of free blocks.
+     */
+    static size_t get_num_free_blocks() {
+      return get_state().num_free_blocks;
+    }
+
+  private:
+
+    static_assert(block_size >= sizeof(void*), "Blocks too small for the free list");
+
+    /**
+     * \brief A released block, linked to the next one.
+     */
+    struct FreeBlock {
+      FreeBlock* next;                  /**< Next free block or nullptr. */
+    };
+
+    /**
+     * \brief Free blocks of this size.
+     *
+     * Released blocks stay allocated until the program exits.
+     */
+    struct State {
+      FreeBlock* free_list = nullptr;   /**< Released blocks. */
+      size_t num_free_blocks = 0;       /**< Length of the free list. */
+    };
+
+    static State& get_state() {
+      static State state;
+      return state;
+    }
+};
+
+/**
+ * \brief Standard allocator that recycles the memory of single objects.
+ *
+ * Single objects are taken from the PoolFreeList of their size,
+ * arrays go to the system allocator.
+ * Use it with std::allocate_shared() for objects created and destroyed
+ * often, like short-lived map entities: the object and its reference
+ * counts are then allocated as one block of the pool.
+ *
+ * \tparam T Type of objects allocated.
+ */
+template<typename T>
+class PoolAllocator {
+
+  public:
+
+    using value_type = T;
+
+    PoolAllocator() = default;
+
+    /**
+     * \brief Conversion from an allocator of another type.
+     */
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& /* other */) {
+    }
+
+    /**
+     * \brief Allocates memory for some objects.
+     * \param n Number of objects.
+     * \return The memory allocated.
+     */
+    T* allocate(size_t n) {
+
+      static_assert(alignof(T) <= alignof(std::max_align_t), "Overaligned type");
+      if (n != 1) {
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+      return static_cast<T*>(PoolFreeList<block_size>::allocate());
+    }
+
+    /**
+     * \brief Releases memory obtained with allocate().
+     * \param ptr The memory to release.
+     * \param n Number of objects.
+     */
+    void deallocate(T* ptr, size_t n) {
+
+      if (n != 1) {
+        ::operator delete(ptr);
+        return;
+      }
+      PoolFreeList<block_size>::free(ptr);
+    }
+
+  private:
+
+    static constexpr size_t block_size =
+        sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>& /* first */, const PoolAllocator<U>& /* second */) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>& /* first */, const PoolAllocator<U>& /* second */) {
+  return false;
+}
+
+/**
+ * \brief Like std::make_shared(), but recycles the memory of objects
+ * of the same size previously destroyed.
+ * \param args Arguments of the constructor.
+ * \return The object created.
+ */
+template<typename T, typename... Args>
+std::shared_ptr<T> make_pooled(Args&&... args) {
+  return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}
+
+#endif
+
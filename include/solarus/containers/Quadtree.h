@@ -18,6 +18,7 @@
 #define SOLARUS_QUADTREE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/HotCounters.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
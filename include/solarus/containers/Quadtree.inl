@@ -210,6 +210,7 @@ template<typename T, typename Comparator>
 std::vector<T> Quadtree<T, Comparator>::get_elements(
     const Rectangle& region
 ) const {
+  SOLARUS_HOT_COUNT(QUADTREE_QUERIES);
   Set element_set;
   root.get_elements(region, element_set);
   return std::vector<T>(element_set.begin(), element_set.end());
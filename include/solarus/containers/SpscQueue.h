@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SPSC_QUEUE_H
+#define SOLARUS_SPSC_QUEUE_H
+
+#include "solarus/core/Common.h"
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A bounded lock-free queue between two threads.
+ *
+ * Only one thread may push elements and only one other thread may pop them.
+ * Elements stay in a fixed ring of slots: pushing moves an element into a
+ * free slot and popping moves it out, so no allocation happens once the
+ * queue is created (apart from what moving T may do).
+ */
+template <typename T>
+class SpscQueue {
+
+  public:
+
+    explicit SpscQueue(size_t capacity);
+
+    SpscQueue(const SpscQueue& other) = delete;
+    SpscQueue& operator=(const SpscQueue& other) = delete;
+
+    size_t get_capacity() const;
+    bool is_empty() const;
+
+    bool push(T&& element);
+    bool pop(T& element);
+
+  private:
+
+    std::vector<T> slots;              /**< Ring of elements, of a power of two size. */
+    size_t mask;                       /**< Size of the ring minus one. */
+    alignas(64) std::atomic<size_t>
+        head;                          /**< Number of elements popped so far. */
+    alignas(64) std::atomic<size_t>
+        tail;                          /**< Number of elements pushed so far. */
+
+};
+
+/**
+ * \brief Creates an empty queue.
+ * \param capacity Minimum number of elements the queue can hold.
+ * It is rounded up to a power of two.
+ */
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity):
+    slots(),
+    mask(0),
+    head(0),
+    tail(0) {
+
+  size_t size = 1;
+  while (size < capacity) {
+    size *= 2;
+  }
+  slots.resize(size);
+  mask = size - 1;
+}
+
+/**
+ * \brief Returns the number of elements the queue can hold.
+ * \return The capacity.
+ */
+template <typename T>
+size_t SpscQueue<T>::get_capacity() const {
+  return slots.size();
+}
+
+/**
+ * \brief Returns whether the queue is empty.
+ *
+ * The result is only reliable from the consumer thread.
+ *
+ * \return \c true if there is nothing to pop.
+ */
+template <typename T>
+bool SpscQueue<T>::is_empty() const {
+  return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Adds an element at the end of the queue.
+ *
+ * Must only be called from the producer thread.
+ *
+ * \param element The element to move into the queue.
+ * It is left unchanged if the queue is full.
+ * \return \c false if the queue is full.
+ */
+template <typename T>
+bool SpscQueue<T>::push(T&& element) {
+
+  const size_t current_tail = tail.load(std::memory_order_relaxed);
+  if (current_tail - head.load(std::memory_order_acquire) == slots.size()) {
+    return false;
+  }
+
+  slots[current_tail & mask] = std::move(element);
+  tail.store(current_tail + 1, std::memory_order_release);
+  return true;
+}
+
+/**
+ * \brief Removes the element at the front of the queue.
+ *
+ * Must only be called from the consumer thread.
+ *
+ * \param element Receives the element if there is one.
+ * \return \c false if the queue is empty.
+ */
+template <typename T>
+bool SpscQueue<T>::pop(T& element) {
+
+  const size_t current_head = head.load(std::memory_order_relaxed);
+  if (current_head == tail.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  element = std::move(slots[current_head & mask]);
+  slots[current_head & mask] = T();  // Release what the slot holds now.
+  head.store(current_head + 1, std::memory_order_release);
+  return true;
+}
+
+}
+
+#endif
+
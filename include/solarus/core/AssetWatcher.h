@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ASSET_WATCHER_H
+#define SOLARUS_ASSET_WATCHER_H
+
+#include "solarus/core/Common.h"
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Detects changes of quest asset files on a background thread.
+ *
+ * The watcher periodically compares the modification dates of the files
+ * of some data directories (sprites, tilesets, images, sounds and shaders)
+ * with the ones it saw before. This only needs PhysFS, so it works the same
+ * way on all systems, with a data directory or with an archive.
+ * Files created after the watcher started are not reported, since the quest
+ * does not know about them anyway.
+ *
+ * The main thread collects the files that changed with take_changed_files()
+ * and reloads the corresponding resources.
+ */
+class SOLARUS_API AssetWatcher {
+
+  public:
+
+    AssetWatcher();
+    ~AssetWatcher();
+    AssetWatcher(const AssetWatcher& other) = delete;
+    AssetWatcher& operator=(const AssetWatcher& other) = delete;
+
+    void start(uint32_t period);
+    void stop();
+    bool is_started() const;
+
+    std::vector<std::string> take_changed_files();
+
+    static constexpr uint32_t
+        default_period = 500;      /**< Default milliseconds between two scans. */
+
+  private:
+
+    void run();
+    void scan_directory(const std::string& dir_name, std::map<std::string, int64_t>& dates) const;
+
+    std::thread thread;            /**< Thread scanning the files. */
+    std::mutex mutex;              /**< Protects what follows. */
+    std::condition_variable
+        stop_condition;            /**< Notified when stopping. */
+    bool stopping;                 /**< Whether the thread should stop. */
+    uint32_t period;               /**< Milliseconds between two scans. */
+    std::set<std::string>
+        changed_files;             /**< Files modified since the last take_changed_files(). */
+
+    // Only used by the thread.
+    std::map<std::string, int64_t>
+        modification_dates;        /**< Last modification date of each file seen. */
+};
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ASYNC_FILE_WRITER_H
+#define SOLARUS_ASYNC_FILE_WRITER_H
+
+#include "solarus/core/Common.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Writes files of the quest write directory on a background thread.
+ *
+ * Each file is first written to a temporary file, flushed to the disk
+ * and then renamed, so that a crash during the write never leaves a
+ * truncated file.
+ *
+ * A write requested while another one of the same file is still waiting
+ * replaces it: only the most recent content is written, and the callbacks
+ * of both requests are called.
+ * Callbacks are called by the main thread, from update().
+ */
+class SOLARUS_API AsyncFileWriter {
+
+  public:
+
+    /**
+     * \brief Function called when a write is finished.
+     *
+     * The parameter tells whether the write was successful.
+     */
+    using Callback = std::function<void(bool)>;
+
+    static void initialize();
+    static void quit();
+    static bool is_initialized();
+
+    static void write(
+        const std::string& file_name,
+        const std::string& content,
+        const Callback& callback
+    );
+    static void flush();
+    static void update();
+    static void cancel_callbacks();
+
+    static bool save_file(const std::string& path, const std::string& content);
+
+  private:
+
+    /**
+     * \brief A file to write.
+     */
+    struct Job {
+      uint64_t id;              /**< Identifies the callbacks of this job. */
+      std::string file_name;    /**< Name relative to the quest write directory. */
+      std::string path;         /**< Full path of the file. */
+      std::string content;      /**< Content to write. */
+    };
+
+    /**
+     * \brief A file written or that could not be written.
+     */
+    struct Result {
+      uint64_t id;              /**< Identifies the callbacks of the job. */
+      std::string file_name;    /**< Name relative to the quest write directory. */
+      bool success;             /**< Whether the file was written. */
+    };
+
+    static void run();
+
+    static bool initialized;                      /**< Whether initialize() was called. */
+    static std::thread worker;                    /**< Thread writing the files. */
+    static std::mutex mutex;                      /**< Protects what follows. */
+    static std::condition_variable jobs_changed;  /**< Wakes up the worker. */
+    static std::condition_variable jobs_done;     /**< Wakes up flush(). */
+    static std::deque<Job> jobs;                  /**< Files waiting to be written. */
+    static bool writing;                          /**< Whether the worker is writing a file. */
+    static bool stopping;                         /**< Asks the worker to stop once idle. */
+    static std::vector<Result> results;           /**< Jobs finished since the last update(). */
+
+    // Only used by the main thread.
+    static uint64_t next_id;                      /**< Id of the next job. */
+    static std::map<uint64_t, std::vector<Callback>>
+        callbacks;                                /**< Callbacks of each job. */
+};
+
+}
+
+#endif
+
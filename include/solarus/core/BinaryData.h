@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BINARY_DATA_H
+#define SOLARUS_BINARY_DATA_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+class Point;
+class Rectangle;
+class Size;
+
+/**
+ * \brief Writes values into a compact binary buffer.
+ *
+ * Integers are stored as variable-length little-endian sequences of 7 bits,
+ * signed ones after zigzag encoding, so that small values take one byte.
+ * Strings are stored as their length followed by their bytes.
+ */
+class SOLARUS_API BinaryWriter {
+
+  public:
+
+    void write_uint(uint32_t value);
+    void write_int(int value);
+    void write_bool(bool value);
+    void write_uint64(uint64_t value);
+    void write_string(const std::string& value);
+    void write_point(const Point& value);
+    void write_size(const Size& value);
+    void write_rectangle(const Rectangle& value);
+
+    const std::string& get_buffer() const;
+
+  private:
+
+    std::string buffer;           /**< The bytes written so far. */
+
+};
+
+/**
+ * \brief Reads values written by BinaryWriter.
+ *
+ * Reading past the end of the buffer or reading a malformed value puts the
+ * reader in an error state: all further reads return zero or empty values,
+ * so callers can check has_failed() once at the end.
+ */
+class SOLARUS_API BinaryReader {
+
+  public:
+
+    BinaryReader(const std::string& buffer, size_t position = 0);
+
+    uint32_t read_uint();
+    int read_int();
+    bool read_bool();
+    uint64_t read_uint64();
+    std::string read_string();
+    Point read_point();
+    Size read_size();
+    Rectangle read_rectangle();
+    size_t read_count();
+
+    size_t get_position() const;
+    bool is_at_end() const;
+    bool has_failed() const;
+
+  private:
+
+    const std::string& buffer;    /**< The bytes to read. */
+    size_t position;              /**< Index of the next byte to read. */
+    bool failed;                  /**< Whether a read went wrong. */
+
+};
+
+SOLARUS_API uint64_t get_fnv1a_hash(const char* data, size_t size);
+
+}
+
+#endif
@@ -21,14 +21,15 @@
 #include "solarus/core/Dialog.h"
 #include "solarus/core/ResourceType.h"
 #include <map>
+#include <memory>
 #include <string>
 
 namespace Solarus {
 
-class DialogResources;
+class LanguageTexts;
 class QuestProperties;
 class QuestDatabase;
-class StringResources;
+class Symbol;
 
 /**
  * \brief Provides access to resources and properties of the current quest.
@@ -43,18 +44,19 @@ SOLARUS_API QuestProperties& get_properties();
 
 SOLARUS_API QuestDatabase& get_database();
 SOLARUS_API bool resource_exists(ResourceType resource_type, const std::string& id);
+SOLARUS_API bool resource_exists(ResourceType resource_type, const Symbol& id);
 SOLARUS_API const std::map<std::string, std::string>& get_resources(ResourceType resource_type);
 
 SOLARUS_API bool has_language(const std::string& language_code);
 SOLARUS_API void set_language(const std::string& language_code);
+SOLARUS_API void preload_language(const std::string& language_code);
+SOLARUS_API void preload_language_async(const std::string& language_code);
 SOLARUS_API std::string& get_language();
 SOLARUS_API std::string get_language_name(const std::string& language_code);
 
-SOLARUS_API StringResources& get_strings();
+SOLARUS_API std::shared_ptr<const LanguageTexts> get_texts();
 SOLARUS_API bool string_exists(const std::string& key);
 SOLARUS_API const std::string& get_string(const std::string& key);
-
-SOLARUS_API std::map<std::string, Dialog>& get_dialogs();
 SOLARUS_API bool dialog_exists(const std::string& dialog_id);
 SOLARUS_API const Dialog& get_dialog(const std::string& dialog_id);
 
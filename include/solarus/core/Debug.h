@@ -20,10 +20,57 @@
 #include "solarus/core/Common.h"
 #include <string>
 
-#ifndef NDEBUG
-#define SOLARUS_ASSERT(condition, message) Debug::check_assertion(condition, message)
+/*
+ * Internal consistency checks, chosen at build time with SOLARUS_ASSERT_LEVEL:
+ * - 0 (off): SOLARUS_CHECK and SOLARUS_ASSERT are compiled away,
+ * - 1 (cheap): only SOLARUS_CHECK is checked (default with NDEBUG),
+ * - 2 (full): SOLARUS_CHECK, SOLARUS_ASSERT and Debug::execute_if_debug()
+ *   are checked (default otherwise).
+ *
+ * The message of a check is only evaluated when the condition fails, and
+ * the condition of a disabled check is not evaluated at all.
+ * Errors that depend on quest data or scripts must keep using
+ * Debug::check_assertion() or Debug::die(), which are always active.
+ */
+#define SOLARUS_ASSERT_LEVEL_OFF 0
+#define SOLARUS_ASSERT_LEVEL_CHEAP 1
+#define SOLARUS_ASSERT_LEVEL_FULL 2
+
+#ifndef SOLARUS_ASSERT_LEVEL
+#  ifdef NDEBUG
+#    define SOLARUS_ASSERT_LEVEL SOLARUS_ASSERT_LEVEL_CHEAP
+#  else
+#    define SOLARUS_ASSERT_LEVEL SOLARUS_ASSERT_LEVEL_FULL
+#  endif
+#endif
+
+#define SOLARUS_ENABLED_CHECK(condition, message) \
+  do { \
+    if (!(condition)) { \
+      ::Solarus::Debug::die(message); \
+    } \
+  } while (false)
+
+// Still type-checks the condition, without evaluating it.
+#define SOLARUS_DISABLED_CHECK(condition, message) \
+  static_cast<void>(sizeof((condition) ? 1 : 0))
+
+/**
+ * \brief Checks an invariant cheap enough to be kept in release builds.
+ */
+#if SOLARUS_ASSERT_LEVEL >= SOLARUS_ASSERT_LEVEL_CHEAP
+#  define SOLARUS_CHECK(condition, message) SOLARUS_ENABLED_CHECK(condition, message)
+#else
+#  define SOLARUS_CHECK(condition, message) SOLARUS_DISABLED_CHECK(condition, message)
+#endif
+
+/**
+ * \brief Checks an invariant only in debug builds.
+ */
+#if SOLARUS_ASSERT_LEVEL >= SOLARUS_ASSERT_LEVEL_FULL
+#  define SOLARUS_ASSERT(condition, message) SOLARUS_ENABLED_CHECK(condition, message)
 #else
-#define SOLARUS_ASSERT(condition, message)
+#  define SOLARUS_ASSERT(condition, message) SOLARUS_DISABLED_CHECK(condition, message)
 #endif
 
 namespace Solarus {
@@ -47,11 +94,13 @@ SOLARUS_API void check_assertion(bool assertion, const std::string& error_messag
 
 /**
  * \brief Execute an arbitrary function in debug mode.
+ *
+ * The function is only called if SOLARUS_ASSERT_LEVEL is full.
  */
 template<typename Function>
 void execute_if_debug(Function&& func)
 {
-#ifndef NDEBUG
+#if SOLARUS_ASSERT_LEVEL >= SOLARUS_ASSERT_LEVEL_FULL
     func();
 #else
     (void) func;
@@ -23,9 +23,9 @@
 #include "solarus/core/Point.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
-#include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -63,6 +63,7 @@ class DialogBoxSystem {
 
     bool has_more_lines() const;
     void show_more_lines();
+    TextSurface* get_visible_line(int index);
 
     Game& game;                                     /**< The game this dialog box belongs to. */
     std::string dialog_id;                          /**< Id of the current dialog or an empty string. */
@@ -72,9 +73,11 @@ class DialogBoxSystem {
     // Fields only used by the built-in dialog box.
     bool built_in;                                  /**< Whether we are using the built-in dialog box. */
     static constexpr int nb_visible_lines = 3;      /**< Maximum number of visible lines. */
-    std::list<std::string> remaining_lines;         /**< Text of each line still to be displayed. */
-    std::shared_ptr<TextSurface>
-        line_surfaces[nb_visible_lines];            /**< Text surface of each visible line. */
+    std::vector<std::shared_ptr<TextSurface>>
+        line_surfaces;                              /**< Text surface of each line of the dialog,
+                                                     * laid out once when the dialog opens. */
+    size_t first_visible_line;                      /**< Index of the first line currently displayed. */
+    size_t next_line;                               /**< Index of the first line still to be displayed. */
     Point text_position;                            /**< Destination position of the first line. */
     bool is_question;                               /**< Whether the dialog is a question with two possible answers. */
     bool selected_first_answer;                     /**< If there is a question: whether the first or second answer is selected. */
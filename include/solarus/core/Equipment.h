@@ -19,9 +19,11 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Ability.h"
+#include "solarus/core/SavegameValueHandle.h"
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 struct lua_State;
 
@@ -107,10 +109,24 @@ class SOLARUS_API Equipment {
     Savegame& savegame;                          /**< The savegame encapsulated by this equipment object. */
     bool suspended;                              /**< Indicates that the game is suspended. */
 
+    // values read often
+    SavegameValueHandle max_money_value;         /**< Handle of the maximum money. */
+    SavegameValueHandle money_value;             /**< Handle of the current money. */
+    SavegameValueHandle max_life_value;          /**< Handle of the maximum life. */
+    SavegameValueHandle life_value;              /**< Handle of the current life. */
+    SavegameValueHandle max_magic_value;         /**< Handle of the maximum magic. */
+    SavegameValueHandle magic_value;             /**< Handle of the current magic. */
+
     // items
     std::map<std::string, std::shared_ptr<EquipmentItem>>
         items;                                   /**< Each item (properties loaded from item scripts). */
+    std::vector<EquipmentItem*>
+        updatable_items;                         /**< Items whose script may define on_update(). */
+    bool updatable_items_valid;                  /**< Whether updatable_items is up to date. */
+    uint32_t updatable_items_version;            /**< Lua events version when updatable_items
+                                                  * was computed. */
 
+    void update_updatable_items();
     std::string get_ability_savegame_variable(Ability ability) const;
 
 };
@@ -18,17 +18,21 @@
 #define SOLARUS_FONT_RESOURCE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/graphics/GlyphAtlas.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/TextSurface.h"
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <SDL_ttf.h>
 
 namespace Solarus {
 
 using HintingSetting = TextSurface::HintingSetting;
+using RenderingMode = TextSurface::RenderingMode;
 
 /**
  * \brief Provides access to font files.
@@ -39,12 +43,21 @@ class FontResource {
 
     static void initialize();
     static void quit();
+    static void preload_files();
 
     static std::string get_default_font_id();
     static bool exists(const std::string& font_id);
     static bool is_bitmap_font(const std::string& font_id);
     static SurfacePtr get_bitmap_font(const std::string& font_id);
     static TTF_Font& get_outline_font(const std::string& font_id, int size, HintingSetting hinting, bool kerning);
+    static std::shared_ptr<GlyphAtlas> get_glyph_atlas(
+        const std::string& font_id,
+        int size,
+        HintingSetting hinting,
+        bool kerning,
+        RenderingMode rendering_mode,
+        const Color& color
+    );
 
   private:
 
@@ -67,12 +80,19 @@ class FontResource {
      */
     using OutlineFontProperties = std::tuple<int, HintingSetting, bool>;
 
+    /**
+     * Properties of a glyph atlas: rendering mode and color as 0xRRGGBBAA.
+     */
+    using GlyphAtlasProperties = std::pair<RenderingMode, uint32_t>;
+
     /**
      * Reading an outline font for a given font size, hinting and kerning.
      */
     struct OutlineFontReader {
         SDL_RWops_UniquePtr rw;
         TTF_Font_UniquePtr outline_font;
+        std::map<GlyphAtlasProperties, std::shared_ptr<GlyphAtlas>>
+            glyph_atlases;                            /**< Glyphs rendered with this font so far. */
     };
 
     /**
@@ -88,10 +108,23 @@ class FontResource {
                                                        * Only used for outline fonts. */
     };
 
+    /**
+     * \brief A font file found and read in advance by preload_files().
+     */
+    struct PreloadedFont {
+      std::string file_name;                          /**< Name of the font file, relative to the data directory. */
+      std::string buffer;                             /**< Content of the file. Only read for outline fonts. */
+      bool bitmap_font = false;                       /**< Whether this is a bitmap font. */
+    };
+
+    static bool find_font_file(const std::string& font_id, std::string& file_name, bool& bitmap_font);
     static void load_fonts();
 
     static bool fonts_loaded;
     static std::map<std::string, FontFile> fonts;
+    static std::mutex preloaded_fonts_mutex;          /**< Protects preloaded_fonts. */
+    static std::map<std::string, PreloadedFont>
+        preloaded_fonts;                              /**< Font files read by preload_files(). */
 
 };
 
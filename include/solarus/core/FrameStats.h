@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FRAME_STATS_H
+#define SOLARUS_FRAME_STATS_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Measures what happens during each iteration of the main loop.
+ *
+ * The main loop, the renderer, the entities, Lua and the audio system fill
+ * the current frame, which is added to the history when the iteration
+ * ends. The last frames are shown by the debug overlay and returned by
+ * sol.main.get_frame_stats().
+ */
+namespace FrameStats {
+
+/**
+ * \brief Statistics of one iteration of the main loop.
+ */
+struct Frame {
+  int num_updates = 0;        /**< Updates of the simulation. */
+  int update_time = 0;        /**< Time spent updating, in microseconds. */
+  int draw_time = 0;          /**< Time spent drawing, in microseconds. */
+  int present_time = 0;       /**< Time spent presenting, in microseconds. */
+  int dropped_time = 0;       /**< Lag dropped without catching up, in milliseconds. */
+  int draw_calls = 0;         /**< Draw calls of the renderer. */
+  int texture_uploads = 0;    /**< Pixel uploads to textures. */
+  int entities_updated = 0;   /**< Map entities updated. */
+  int entities_drawn = 0;     /**< Map entities drawn. */
+  int lua_memory = 0;         /**< Memory used by Lua, in KiB. */
+  int audio_buffer_fill = -1; /**< Percentage of music buffers queued,
+                               * or -1 if no music is playing. */
+  int quadtree_queries = 0;   /**< Quadtree queries. */
+  int obstacle_tests = 0;     /**< Collision tests with map obstacles. */
+  int detector_checks = 0;    /**< Collision checks with detectors. */
+  int lua_calls = 0;          /**< Calls from C++ to Lua functions. */
+  int input_latency = 0;      /**< Longest delay between an input event and
+                               * its handling, in milliseconds. */
+};
+
+constexpr size_t history_size = 120;  /**< Number of frames kept. */
+
+SOLARUS_API Frame& get_current_frame();
+SOLARUS_API void finish_frame();
+SOLARUS_API std::vector<Frame> get_last_frames(size_t num_frames);
+
+SOLARUS_API bool is_overlay_enabled();
+SOLARUS_API void set_overlay_enabled(bool enabled);
+
+}
+
+}
+
+#endif
+
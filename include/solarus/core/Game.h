@@ -27,6 +27,7 @@
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/Transition.h"
 #include <memory>
+#include <set>
 #include <string>
 
 namespace Solarus {
@@ -91,7 +92,7 @@ class SOLARUS_API Game {
     bool has_current_map() const;
     Map& get_current_map();
     void set_current_map(const std::string& map_id, const std::string& destination_name,
-        Transition::Style transition_style);
+        Transition::Style transition_style, const std::string& transition_effect = "");
     Transition::Style get_default_transition_style() const;
     void set_default_transition_style(Transition::Style default_transition_style);
 
@@ -154,6 +155,11 @@ private:
     CommandsEffects
         commands_effects;      /**< current effect associated to the main game keys
                                 * (represented on the HUD by the action icon, the objects icons, etc.) */
+    bool has_sword_ability;    /**< Whether the hero has the sword ability, updated when it changes. */
+
+    // savegame values
+    std::set<std::string>
+        changed_keys;          /**< Savegame values changed during this cycle. */
 
     // map
     std::shared_ptr<Map>
@@ -162,10 +168,12 @@ private:
         next_map;              /**< the map where the hero is going to; if not nullptr, it means that the hero
                                 * is changing from current_map to next_map */
     SurfacePtr
-        previous_map_surface;  /**< a copy of the previous map surface for transition effects that display two maps */
+        previous_map_surface;  /**< the last image of the previous map for transition effects that display two maps */
 
     Transition::Style
         current_transition_style; /**< The transition style between the current map and the next one. */
+    std::string
+        current_transition_effect; /**< Name of the transition effect replacing the style, or an empty string. */
     std::unique_ptr<Transition>
         transition;            /**< the transition currently shown, or nullptr if no transition is playing */
 
@@ -174,8 +182,10 @@ private:
 
     // update functions
     void update_tilesets();
+    void update_changed_values();
     void update_commands_effects();
     void update_transitions();
+    Transition* create_transition(Transition::Direction direction);
     void update_gameover_sequence();
     void notify_map_changed();
 
@@ -21,9 +21,11 @@
 #include "solarus/core/GameCommand.h"
 #include "solarus/core/InputEvent.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <array>
+#include <bitset>
 #include <map>
-#include <set>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -73,6 +75,18 @@ class GameCommands {
 
   private:
 
+    static constexpr size_t num_commands =
+        static_cast<size_t>(GameCommand::DOWN) + 1;
+
+    /**
+     * \brief Kinds of joypad elements that can be bound to a game command.
+     */
+    enum class JoypadElement {
+      BUTTON,                            /**< Indexed by button. */
+      AXIS,                              /**< Indexed by 2 * axis, + 1 for "-". */
+      HAT                                /**< Indexed by 4 * hat + direction4. */
+    };
+
     Savegame& get_savegame();
     const Savegame& get_savegame() const;
 
@@ -83,6 +97,7 @@ class GameCommands {
     InputEvent::KeyboardKey get_saved_keyboard_binding(GameCommand command) const;
     void set_saved_keyboard_binding(GameCommand command, InputEvent::KeyboardKey key);
     GameCommand get_command_from_keyboard(InputEvent::KeyboardKey key) const;
+    void map_keyboard_key(InputEvent::KeyboardKey key, GameCommand command);
 
     // Joypad mapping.
     void joypad_button_pressed(int button);
@@ -92,18 +107,36 @@ class GameCommands {
     const std::string& get_joypad_binding_savegame_variable(GameCommand command) const;
     std::string get_saved_joypad_binding(GameCommand command) const;
     void set_saved_joypad_binding(GameCommand command, const std::string& joypad_string);
+    GameCommand get_command_from_joypad(JoypadElement element, int index) const;
     GameCommand get_command_from_joypad(const std::string& joypad_string) const;
+    void map_joypad_string(const std::string& joypad_string, GameCommand command);
+    std::vector<GameCommand>& get_joypad_mapping(JoypadElement element);
+    const std::vector<GameCommand>& get_joypad_mapping(JoypadElement element) const;
+    static bool parse_joypad_string(
+        const std::string& joypad_string, JoypadElement& element, int& index);
+    static std::string get_joypad_string(JoypadElement element, int index);
 
     void do_customization_callback();
 
     Game& game;                          /**< The game we are controlling. */
-    std::map<InputEvent::KeyboardKey, GameCommand>
-        keyboard_mapping;                /**< Associates each game command to the
-                                          * keyboard key that triggers it. */
-    std::map<std::string, GameCommand>
-        joypad_mapping;                  /**< Associates each game command to the
-                                          * joypad action that triggers it. */
-    std::set<GameCommand>
+    std::vector<GameCommand>
+        keyboard_mapping;                /**< Game command triggered by each
+                                          * keyboard key, indexed by key code. */
+    std::array<InputEvent::KeyboardKey, num_commands>
+        keyboard_bindings;               /**< Keyboard key of each game command. */
+    std::vector<GameCommand>
+        joypad_button_mapping;           /**< Game command triggered by each
+                                          * joypad button. */
+    std::vector<GameCommand>
+        joypad_axis_mapping;             /**< Game command triggered by each
+                                          * joypad axis direction. */
+    std::vector<GameCommand>
+        joypad_hat_mapping;              /**< Game command triggered by each
+                                          * joypad hat direction. */
+    std::array<std::string, num_commands>
+        joypad_bindings;                 /**< Joypad action of each game command,
+                                          * as saved in the savegame. */
+    std::bitset<num_commands>
         commands_pressed;                /**< Memorizes the state of each game command. */
 
     bool customizing;                    /**< Indicates that the next keyboard or
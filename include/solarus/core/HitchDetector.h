@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_HITCH_DETECTOR_H
+#define SOLARUS_HITCH_DETECTOR_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class ResourceProvider;
+
+/**
+ * \brief Reports iterations of the main loop that take too long.
+ *
+ * The main loop drops the lag of long frames without catching up, which
+ * hides hitches. When an iteration takes more than the threshold, the
+ * detector logs where the time went: input, each simulation step, draw
+ * and present, and inside them Lua calls and map loading. It also logs
+ * the slowest Lua callback of the frame with its file and line, and the
+ * resources being preloaded in background.
+ *
+ * The last reports are kept in the file hitches.log of the quest write
+ * directory, one per line, for diagnostics on players' machines.
+ *
+ * The threshold is set with the -hitch-threshold=ms command-line option.
+ * 0 disables the detector: a scope then only costs a boolean test.
+ * Scopes can only be measured from the main thread.
+ */
+class SOLARUS_API HitchDetector {
+
+  public:
+
+    /**
+     * \brief Parts of an iteration of the main loop.
+     */
+    enum class Phase {
+      INPUT,      /**< Handling input events. */
+      STEP,       /**< One update of the simulation. */
+      LUA,        /**< Calls from C++ to Lua, during any other phase. */
+      MAP_LOAD,   /**< Loading and starting maps, during a step. */
+      DRAW,       /**< Drawing the frame. */
+      PRESENT,    /**< Presenting the frame. */
+      NUM_PHASES
+    };
+
+    /**
+     * \brief Measures the time between its creation and its destruction.
+     */
+    class Scope {
+
+      public:
+
+        inline explicit Scope(Phase phase);
+        inline ~Scope();
+
+        Scope(const Scope& other) = delete;
+        Scope& operator=(const Scope& other) = delete;
+
+      private:
+
+        Phase phase;          /**< The phase measured. */
+        uint64_t start;       /**< Start date in microseconds, or 0 if not measured. */
+    };
+
+    static inline bool is_enabled();
+    static int get_threshold();
+    static void set_threshold(int threshold);
+    static int get_log_size();
+    static void set_log_size(int log_size);
+
+    static void start_frame();
+    static void finish_frame(ResourceProvider* resource_provider);
+    static void add_time(Phase phase, uint64_t time);
+    static inline bool is_slowest_lua_call(uint64_t time);
+    static void set_slowest_lua_call(
+        uint64_t time, const char* event_name, const std::string& location);
+
+    static std::vector<std::string> get_last_hitches();
+
+    static constexpr int
+        default_threshold = 50;    /**< Default threshold in milliseconds. */
+    static constexpr int
+        default_log_size = 20;     /**< Default number of reports kept. */
+    static constexpr size_t
+        max_steps = 16;            /**< Steps detailed in a report. */
+
+  private:
+
+    static std::string get_report(uint64_t frame_time, ResourceProvider* resource_provider);
+    static void load_log();
+    static void save_log();
+
+    static bool enabled;                   /**< Whether frames are measured. */
+    static int threshold;                  /**< Threshold in milliseconds. */
+    static int log_size;                   /**< Maximum number of reports kept. */
+    static uint64_t frame_start;           /**< Start date of the current frame. */
+    static uint64_t phase_times[
+        static_cast<size_t>(Phase::NUM_PHASES)];  /**< Time of each phase. */
+    static std::vector<uint64_t> step_times;      /**< Time of each step. */
+    static uint64_t slowest_lua_call_time;        /**< Time of the slowest Lua call. */
+    static std::string slowest_lua_call;          /**< Event and location of the slowest Lua call. */
+    static bool log_loaded;                       /**< Whether the reports of the file were read. */
+    static std::deque<std::string> hitches;       /**< Last reports. */
+};
+
+}  // namespace Solarus
+
+#include "HitchDetector.inl"
+
+#endif
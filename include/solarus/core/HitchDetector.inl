@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/System.h"
+
+namespace Solarus {
+
+/**
+ * \brief Starts measuring a phase if the detector is enabled.
+ * \param phase The phase to measure.
+ */
+inline HitchDetector::Scope::Scope(Phase phase):
+  phase(phase),
+  start(0) {
+
+  if (enabled) {
+    start = System::get_real_time_us();
+  }
+}
+
+/**
+ * \brief Adds the time of the scope to its phase if the detector is enabled.
+ */
+inline HitchDetector::Scope::~Scope() {
+
+  if (start != 0 && enabled) {
+    add_time(phase, System::get_real_time_us() - start);
+  }
+}
+
+/**
+ * \brief Returns whether frames are measured.
+ * \return \c true if the detector is enabled.
+ */
+inline bool HitchDetector::is_enabled() {
+  return enabled;
+}
+
+/**
+ * \brief Returns whether a Lua call is the slowest one of the frame so far.
+ *
+ * Callers only need to find the location of the slowest call.
+ *
+ * \param time Duration of the call in microseconds.
+ * \return \c true if no call of the frame took longer.
+ */
+inline bool HitchDetector::is_slowest_lua_call(uint64_t time) {
+  return time > slowest_lua_call_time;
+}
+
+}
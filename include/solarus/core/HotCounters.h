@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_HOT_COUNTERS_H
+#define SOLARUS_HOT_COUNTERS_H
+
+#include "solarus/core/Common.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Solarus {
+
+/**
+ * \brief Counts how often hot paths of the engine run.
+ *
+ * Each thread increments its own accumulators, without locks and without
+ * contention. The main loop takes a snapshot after each frame: it sums
+ * the accumulators of all threads and stores the counts of the frame in
+ * the frame statistics and in the performance trace.
+ *
+ * Counters are compiled only if SOLARUS_HOT_COUNTERS is defined
+ * (the default). Otherwise, SOLARUS_HOT_COUNT() expands to nothing.
+ */
+namespace HotCounters {
+
+/**
+ * \brief The hot paths counted.
+ */
+enum class Counter {
+  QUADTREE_QUERIES,         /**< Quadtree::get_elements() calls. */
+  OBSTACLE_TESTS,           /**< Map::test_collision_with_obstacles() calls. */
+  DETECTOR_CHECKS,          /**< Collision checks between an entity and a detector. */
+  LUA_CALLS,                /**< Calls from C++ to Lua functions, including events. */
+  NUM_COUNTERS
+};
+
+constexpr size_t num_counters = static_cast<size_t>(Counter::NUM_COUNTERS);
+
+using Snapshot = std::array<uint32_t, num_counters>;
+
+/**
+ * \brief Accumulators of one thread.
+ *
+ * Only their thread writes them. They are atomic so that the main thread
+ * can read them safely, but increments are plain relaxed loads and stores.
+ */
+struct ThreadCounters {
+  std::array<std::atomic<uint32_t>, num_counters> counts;  /**< Totals since the thread started. */
+  ThreadCounters* next = nullptr;                          /**< Accumulators of another thread. */
+};
+
+SOLARUS_API ThreadCounters& register_thread();
+inline void increment(Counter counter);
+
+SOLARUS_API Snapshot take_snapshot();
+SOLARUS_API const char* get_counter_name(Counter counter);
+
+}
+
+}
+
+#include "solarus/core/HotCounters.inl"
+
+#ifdef SOLARUS_HOT_COUNTERS
+#define SOLARUS_HOT_COUNT(counter) \
+    ::Solarus::HotCounters::increment(::Solarus::HotCounters::Counter::counter)
+#else
+#define SOLARUS_HOT_COUNT(counter) ((void) 0)
+#endif
+
+#endif
+
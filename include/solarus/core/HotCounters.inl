@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Solarus {
+namespace HotCounters {
+
+/**
+ * \brief Increments a counter of the current thread.
+ * \param counter The counter to increment.
+ */
+inline void increment(Counter counter) {
+
+  static thread_local ThreadCounters* thread_counters = nullptr;
+  if (thread_counters == nullptr) {
+    thread_counters = &register_thread();
+  }
+  std::atomic<uint32_t>& count = thread_counters->counts[static_cast<size_t>(counter)];
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+}
+}
+
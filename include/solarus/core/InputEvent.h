@@ -210,6 +210,7 @@ class InputEvent {
 
     // retrieve the current event
     static std::unique_ptr<InputEvent> get_event();
+    static std::unique_ptr<InputEvent> make_event(const SDL_Event& internal_event);
 
     // global information
     static void set_key_repeat(bool repeat);
@@ -235,6 +236,8 @@ class InputEvent {
     bool is_mouse_event() const;
     bool is_finger_event() const;
     bool is_window_event() const;
+    const SDL_Event& get_internal_event() const;
+    uint32_t get_timestamp() const;
 
     // keyboard
     bool is_keyboard_key_pressed() const;
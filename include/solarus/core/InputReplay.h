@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_INPUT_REPLAY_H
+#define SOLARUS_INPUT_REPLAY_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <SDL_events.h>
+
+namespace Solarus {
+
+class InputEvent;
+
+/**
+ * \brief Records input events with their tick, or replays them.
+ *
+ * A recording stores the seed of the random number generator and every
+ * input event with the simulated time when it was received.
+ * Replaying it feeds the events back at the same ticks, which makes a
+ * playthrough deterministic: for example, a headless replay is a
+ * repeatable benchmark.
+ *
+ * Optionally, a hash of the entity positions is stored after each tick.
+ * When replaying, a different hash means that the simulation diverged.
+ *
+ * Recordings are text files: one line per event or hash.
+ * They are written with the -record-input=file command-line option
+ * and replayed with -replay-input=file.
+ */
+class SOLARUS_API InputReplay {
+
+  public:
+
+    InputReplay();
+
+    bool start_recording(const std::string& file_name, uint32_t seed, bool record_hashes);
+    bool start_replaying(const std::string& file_name);
+    void stop();
+
+    bool is_recording() const;
+    bool is_replaying() const;
+    bool is_hashing() const;
+    uint32_t get_seed() const;
+
+    static bool is_recordable(const InputEvent& event);
+    void record_event(uint32_t tick, const InputEvent& event);
+    bool pop_event(uint32_t tick, SDL_Event& event);
+    void check_hash(uint32_t tick, uint64_t hash);
+    bool has_diverged() const;
+
+  private:
+
+    std::ofstream output;             /**< The recording being written. */
+    bool recording;                   /**< Whether events are being recorded. */
+    bool replaying;                   /**< Whether events are being replayed. */
+    bool hashing;                     /**< Whether hashes are recorded or compared. */
+    uint32_t seed;                    /**< Seed of the random number generator. */
+    std::deque<std::pair<uint32_t, SDL_Event>>
+        events;                       /**< Events left to replay, by tick. */
+    std::deque<std::pair<uint32_t, uint64_t>>
+        hashes;                       /**< Hashes left to compare, by tick. */
+    bool diverged;                    /**< Whether a replayed hash was different. */
+
+};
+
+}
+
+#endif
+
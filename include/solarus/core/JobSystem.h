@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_JOB_SYSTEM_H
+#define SOLARUS_JOB_SYSTEM_H
+
+#include "solarus/core/Common.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+class Arguments;
+
+/**
+ * \brief Pool of threads shared by all subsystems of the engine.
+ *
+ * Jobs have a priority:
+ * - FRAME jobs are needed by the current frame, like bands of a pixel
+ *   filter or layers of a map being built,
+ * - BACKGROUND jobs compute things that will be needed later,
+ * - IO jobs mostly wait for files and run on their own threads
+ *   so that they never hold a core.
+ *
+ * FRAME and BACKGROUND jobs run on one worker per core, minus the main
+ * thread. Each worker has its own queues and takes jobs from the queues
+ * of other workers when it has nothing left to do.
+ *
+ * A job can depend on other jobs: it only starts when they are finished.
+ * Jobs created with add_main_thread() run on the main thread, from
+ * update(), which makes them suitable as continuations of background work.
+ *
+ * The number of workers is set with the -job-threads=N command-line
+ * option. 0 (the default) uses the number of cores minus one.
+ */
+class SOLARUS_API JobSystem {
+
+  public:
+
+    /**
+     * \brief How urgent a job is.
+     */
+    enum class Priority {
+      FRAME,         /**< Needed by the current frame. */
+      BACKGROUND,    /**< Needed later. */
+      IO             /**< Mostly waits for files. */
+    };
+
+    struct Job;
+    using JobPtr = std::shared_ptr<Job>;
+    using Function = std::function<void()>;
+
+    /**
+     * \brief Processes some consecutive items of a loop.
+     * \param first_item Index of the first item.
+     * \param num_items Number of items.
+     */
+    using BandFunction = std::function<void(int first_item, int num_items)>;
+
+    static void initialize(const Arguments& args);
+    static void quit();
+    static int get_num_workers();
+
+    static JobPtr add(
+        Priority priority,
+        const Function& function,
+        const std::vector<JobPtr>& dependencies = {}
+    );
+    static JobPtr add_main_thread(
+        const Function& function,
+        const std::vector<JobPtr>& dependencies = {}
+    );
+    static bool is_done(const JobPtr& job);
+    static void wait(const JobPtr& job);
+    static void update();
+
+    static void parallel_for(
+        int num_items,
+        int min_items_per_band,
+        const BandFunction& band_function
+    );
+
+    /**
+     * \brief Runs a function in a job and returns a future of its result.
+     * \param priority Priority of the job.
+     * \param function The function to run.
+     * \return The future result.
+     */
+    template<typename F>
+    static auto async(Priority priority, F&& function)
+        -> std::future<decltype(function())> {
+
+      using Result = decltype(function());
+      auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+      std::future<Result> future = task->get_future();
+      add(priority, [task]() {
+        (*task)();
+      });
+      return future;
+    }
+
+    static constexpr int num_io_threads = 2;  /**< Threads running IO jobs. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LANGUAGE_TEXTS_H
+#define SOLARUS_LANGUAGE_TEXTS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/containers/FlatStringMap.h"
+#include "solarus/core/Dialog.h"
+#include <memory>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief Strings and dialogs of a language, ready to be used.
+ *
+ * The texts are parsed from text/strings.dat and text/dialogs.dat and
+ * stored in hashed tables. Once loaded, they are never modified:
+ * a language can be loaded by any thread and then shared.
+ */
+class SOLARUS_API LanguageTexts {
+
+  public:
+
+    static std::shared_ptr<const LanguageTexts> load(const std::string& language_code);
+
+    const std::string& get_language_code() const;
+
+    const FlatStringMap<std::string>& get_strings() const;
+    const std::string* find_string(const std::string& key) const;
+
+    const FlatStringMap<Dialog>& get_dialogs() const;
+    const Dialog* find_dialog(const std::string& dialog_id) const;
+
+  private:
+
+    std::string language_code;            /**< Code of the language. */
+    FlatStringMap<std::string> strings;   /**< Strings by key. */
+    FlatStringMap<Dialog> dialogs;        /**< Dialogs by id. */
+};
+
+}
+
+#endif
+
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LAUNCHER_CHANNEL_H
+#define SOLARUS_LAUNCHER_CHANNEL_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/FrameStats.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Binary channel between the engine and the launcher that runs it.
+ *
+ * The launcher creates a file of sizeof(Layout) bytes and passes it with
+ * the -launcher-channel=file command-line option. Both processes map
+ * the file in memory, which contains two single-producer, single-consumer
+ * ring buffers:
+ * - the statistics of each frame, written by the engine,
+ * - Lua commands to run, written by the launcher.
+ *
+ * This avoids formatting and parsing text on the standard output for
+ * data produced at every frame. Logs and command results still go
+ * through the standard output.
+ *
+ * The static functions that take a layout are used by both sides;
+ * the other ones manage the mapping of the engine process.
+ */
+class SOLARUS_API LauncherChannel {
+
+  public:
+
+    static constexpr uint32_t magic = 0x534c4348;  /**< "SLCH". */
+    static constexpr uint32_t version = 1;         /**< Version of the layout. */
+    static constexpr uint32_t
+        telemetry_capacity = 256;                  /**< Number of frames kept. */
+    static constexpr uint32_t
+        command_buffer_size = 1 << 16;             /**< Size of the command ring in bytes. */
+
+    /**
+     * \brief Statistics of a frame sent to the launcher.
+     */
+    struct TelemetryRecord {
+      uint32_t frame_number;     /**< Number of the frame since the engine started. */
+      uint32_t date;             /**< Real time when the frame ended, in milliseconds. */
+      FrameStats::Frame stats;   /**< Statistics of the frame. */
+    };
+
+    /**
+     * \brief Content of the shared file.
+     *
+     * Counters only increase and wrap at 2^32: indexes in the rings are
+     * counters modulo the capacity.
+     */
+    struct Layout {
+      uint32_t magic;                                  /**< Must be LauncherChannel::magic. */
+      uint32_t version;                                /**< Must be LauncherChannel::version. */
+      uint32_t size;                                   /**< Must be sizeof(Layout). */
+      std::atomic<uint32_t> num_frames;                /**< Frames written by the engine. */
+      TelemetryRecord frames[telemetry_capacity];      /**< Ring of the last frames. */
+      std::atomic<uint32_t> command_write_offset;      /**< Bytes written by the launcher. */
+      std::atomic<uint32_t> command_read_offset;       /**< Bytes read by the engine. */
+      char commands[command_buffer_size];              /**< Ring of length-prefixed commands. */
+    };
+
+    static void initialize_layout(Layout& layout);
+    static bool is_layout_valid(const Layout& layout);
+    static void push_frame(Layout& layout, const FrameStats::Frame& stats, uint32_t date);
+    static uint32_t pop_frames(
+        const Layout& layout, uint32_t next_frame, std::vector<TelemetryRecord>& frames);
+    static bool push_command(Layout& layout, const std::string& command);
+    static std::vector<std::string> pop_commands(Layout& layout);
+
+    static bool open(const std::string& file_name);
+    static void close();
+    static bool is_open();
+    static void publish_frame(const FrameStats::Frame& stats);
+    static std::vector<std::string> take_commands();
+
+  private:
+
+    static_assert(ATOMIC_INT_LOCK_FREE == 2,
+        "Shared counters must be lock-free");
+    static_assert((command_buffer_size & (command_buffer_size - 1)) == 0,
+        "The command ring size must be a power of two");
+
+    static Layout* layout;          /**< The mapped file in the engine, or nullptr. */
+    static void* mapping_handle;    /**< Platform handle of the mapping, if any. */
+};
+
+}  // namespace Solarus
+
+#endif
+
@@ -18,11 +18,14 @@
 #define SOLARUS_LOGGER_H
 
 #include "solarus/core/Common.h"
+#include <cstdint>
 #include <iostream>
 #include <string>
 
 namespace Solarus {
 
+class Arguments;
+
 /**
  * \brief Provides features for logging output and errors.
  *
@@ -30,9 +33,37 @@ namespace Solarus {
  * simulated time.
  * This allows to better distinguish messages from the engine and messages
  * from the quest.
+ *
+ * Once initialize() is called, messages are queued in a lock-free ring and
+ * written by a background thread, so that logging never waits for the
+ * console or the disk.
+ * Identical warnings repeated in a short time are only counted, and the
+ * error log file is rotated when it gets too big.
  */
 namespace Logger {
 
+/**
+ * \brief Minimum severity of messages logged.
+ */
+enum class Level {
+  LEVEL_DEBUG,
+  LEVEL_INFO,
+  LEVEL_WARNING,
+  LEVEL_ERROR,
+  LEVEL_FATAL,
+  LEVEL_NONE        /**< Nothing is logged. */
+};
+
+SOLARUS_API void initialize(const Arguments& args);
+SOLARUS_API void quit();
+SOLARUS_API bool is_initialized();
+SOLARUS_API void flush();
+
+SOLARUS_API Level get_level();
+SOLARUS_API void set_level(Level level);
+SOLARUS_API bool is_enabled(Level level);
+SOLARUS_API uint64_t get_num_dropped_messages();
+
 SOLARUS_API void print(const std::string& message, std::ostream& out = std::cerr);
 
 SOLARUS_API void debug(const std::string& message);
@@ -18,6 +18,9 @@
 #define SOLARUS_MAIN_LOOP_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/AssetWatcher.h"
+#include "solarus/core/CatchUpMode.h"
+#include "solarus/core/InputReplay.h"
 #include "solarus/core/ResourceProvider.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include <atomic>
@@ -32,6 +35,7 @@ class Arguments;
 class Game;
 class InputEvent;
 class LuaContext;
+class TextSurface;
 
 /**
  * \brief Main class of the game engine.
@@ -63,10 +67,17 @@ class SOLARUS_API MainLoop {
 
   private:
 
+    void run_headless();
     void check_input();
+    void check_lua_commands();
     void notify_input(const InputEvent& event);
+    void dispatch_input(const InputEvent& event);
+    void replay_input();
+    void reload_changed_assets();
     void draw();
+    void draw_frame_stats();
     void update();
+    int get_max_catch_up_updates(uint32_t frame_period) const;
 
     void setup_game_icon();
     void load_quest_properties();
@@ -77,6 +88,7 @@ class SOLARUS_API MainLoop {
         lua_context;              /**< The Lua world where scripts are run. */
     ResourceProvider
         resource_provider;        /**< Resource cache of the quest. */
+    AssetWatcher asset_watcher;   /**< Detects asset files modified while running. */
     SurfacePtr root_surface;      /**< The surface where everything is drawn. */
     std::unique_ptr<Game> game;   /**< The current game if any, nullptr otherwise. */
     Game* next_game;              /**< The game to start at next cycle (nullptr means resetting the game). */
@@ -88,6 +100,23 @@ class SOLARUS_API MainLoop {
     bool suspended;               /**< Indicates that the simulation is suspended. */
     bool turbo;                   /**< Whether to run the simulation as fast as possible
                                    * rather than following real time. */
+    bool interpolation;           /**< Whether to draw frames between updates,
+                                   * with moving entities at interpolated positions. */
+    bool headless;                /**< Whether to simulate as fast as possible without
+                                   * window, audio, input or drawing. */
+    uint32_t max_ticks;           /**< Number of updates after which the simulation
+                                   * stops, or 0 for no limit. */
+    CatchUpMode catch_up_mode;    /**< How to catch up when updates are late. */
+    int max_catch_up_updates;     /**< Maximum number of updates before drawing. */
+    uint32_t lag_drop_threshold;  /**< Lag in milliseconds that is dropped
+                                   * instead of caught up. */
+    uint32_t average_step_cost;   /**< Recent cost of an update in microseconds,
+                                   * measured in adaptive catch-up mode. */
+    bool draw_skipped;            /**< Whether the last frame was not drawn
+                                   * because the system is overloaded. */
+    InputReplay input_replay;     /**< Records or replays input events. */
+    std::vector<std::shared_ptr<TextSurface>>
+        frame_stats_lines;        /**< Lines of text of the frame statistics overlay. */
 
     std::thread stdin_thread;     /**< Separate thread that reads Lua commands on stdin. */
     std::vector<std::string>
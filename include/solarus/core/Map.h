@@ -17,6 +17,7 @@
 #ifndef SOLARUS_MAP_H
 #define SOLARUS_MAP_H
 
+#include "solarus/containers/MonotonicArena.h"
 #include "solarus/core/Common.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/MapData.h"
@@ -29,6 +30,9 @@
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/ExportableToLua.h"
+#include "solarus/movements/FlowField.h"
+#include "solarus/movements/PathFindingScheduler.h"
+#include <set>
 
 namespace Solarus {
 
@@ -91,6 +95,7 @@ class SOLARUS_API Map: public ExportableToLua {
     const std::shared_ptr<Savegame>& get_savegame();
     bool is_game_running() const;
     LuaContext& get_lua_context();
+    MonotonicArena& get_arena();
     virtual const std::string& get_lua_type_name() const override;
 
     void notify_opening_transition_finished();
@@ -98,6 +103,15 @@ class SOLARUS_API Map: public ExportableToLua {
     // entities
     Entities& get_entities();
     const Entities& get_entities() const;
+    PathFindingScheduler& get_path_finding_scheduler();
+    FlowField& get_flow_field(const EntityPtr& target, Entity& source);
+
+    // chunks
+    bool is_chunked() const;
+    const Size& get_chunk_size() const;
+    int get_chunk_margin() const;
+    void set_chunk_size(const Size& chunk_size, int chunk_margin);
+    bool is_chunk_active(int column, int row) const;
 
     // presence of the hero
     bool is_started() const;
@@ -121,6 +135,11 @@ class SOLARUS_API Map: public ExportableToLua {
         const Entity& entity_to_check,
         bool& found_diagonal_wall
     ) const;
+    bool test_collision_with_ground(
+        int layer,
+        const Rectangle& collision_box,
+        const Entity& entity_to_check
+    );
     bool test_collision_with_entities(
         int layer,
         const Rectangle& collision_box,
@@ -142,6 +161,13 @@ class SOLARUS_API Map: public ExportableToLua {
         const Point& point,
         Entity& entity_to_check
     );
+    int get_free_distance(
+        int layer,
+        const Rectangle& collision_box,
+        const Point& step,
+        int max_steps,
+        Entity& entity_to_check
+    );
     bool has_empty_ground(
         int layer,
         const Rectangle& collision_box
@@ -164,6 +190,7 @@ class SOLARUS_API Map: public ExportableToLua {
     // collisions with detectors (checked after a move)
     void check_collision_with_detectors(Entity& entity);
     void check_collision_with_detectors(Entity& entity, Sprite& sprite);
+    void check_sprite_collisions_with_detectors(Entity& entity);
     void check_collision_from_detector(Entity& detector);
     void check_collision_from_detector(Entity& detector, Sprite& detector_sprite);
 
@@ -183,6 +210,13 @@ class SOLARUS_API Map: public ExportableToLua {
   private:
 
     void set_suspended(bool suspended);
+    void check_sprite_collisions_with_detectors(
+        Entity& entity,
+        const std::vector<EntityPtr>& entities_nearby
+    );
+    void remove_unused_flow_fields();
+    void update_chunks();
+    void deactivate_chunks();
     void build_background_surface();
     void build_foreground_surface();
     void draw_background(const SurfacePtr& dst_surface);
@@ -231,8 +265,23 @@ class SOLARUS_API Map: public ExportableToLua {
                                    * to place the hero on a side of the map,
                                    * or an empty string to use the one saved. */
 
+    std::unique_ptr<MonotonicArena>
+        arena;                    /**< Memory of data that lives until the map is unloaded.
+                                   * Declared before the entities that use it. */
     std::unique_ptr<Entities>
         entities;                 /**< The entities on the map. */
+    PathFindingScheduler
+        path_finding_scheduler;   /**< Paths being computed for entities. */
+    std::vector<std::unique_ptr<FlowField>>
+        flow_fields;              /**< Flow fields used recently. */
+
+    // chunks
+    Size chunk_size;              /**< Size of the spatial chunks of the map,
+                                   * or an empty size if the map is not chunked. */
+    int chunk_margin;             /**< Number of chunks kept active around the
+                                   * ones visible by the camera. */
+    std::set<int> active_chunks;  /**< Index (row * columns + column) of each
+                                   * chunk currently active. */
     bool suspended;               /**< Whether the game is suspended. */
 };
 
@@ -289,6 +338,26 @@ inline Entities& Map::get_entities() {
   return *entities;
 }
 
+/**
+ * \brief Returns the memory of data that lives until the map is unloaded.
+ *
+ * This function should not be called before the map is loaded into a game.
+ *
+ * \return The arena of the map.
+ */
+inline MonotonicArena& Map::get_arena() {
+  SOLARUS_ASSERT(arena != nullptr, "Map is not loaded");
+  return *arena;
+}
+
+/**
+ * \brief Returns the object that computes paths for the entities of the map.
+ * \return The path finding scheduler.
+ */
+inline PathFindingScheduler& Map::get_path_finding_scheduler() {
+  return path_finding_scheduler;
+}
+
 /**
  * \brief Returns the camera of the map.
  * \return The camera, or nullptr if there is no camera.
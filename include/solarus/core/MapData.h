@@ -18,6 +18,7 @@
 #define SOLARUS_MAP_DATA_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/Size.h"
 #include "solarus/entities/EntityData.h"
 #include <array>
@@ -187,6 +188,8 @@ class SOLARUS_API MapData : public LuaData {
 
     virtual bool import_from_lua(lua_State* l) override;
     virtual bool export_to_lua(std::ostream& out) const override;
+    virtual bool import_from_binary(BinaryReader& reader) override;
+    virtual bool export_to_binary(BinaryWriter& writer) const override;
 
     static constexpr int NO_FLOOR = -9999;  /**< Represents a non-existent floor (nil in Lua data files). */
 
@@ -194,6 +197,7 @@ class SOLARUS_API MapData : public LuaData {
 
     const std::deque<EntityData>& get_entities(int layer) const;
     std::deque<EntityData>& get_entities(int layer);
+    void update_memory_usage();
 
     int min_layer;                /**< Lowest layer of the map (0 or less). */
     int max_layer;                /**< Highest layer of the map (0 or more). */
@@ -208,6 +212,9 @@ class SOLARUS_API MapData : public LuaData {
         entities;                 /**< The entities on each layer. */
     std::map<std::string, EntityIndex>
         named_entities;           /**< Entities indexed by their name. */
+    MemoryUsage::Tracker memory_tracker{
+        MemoryUsage::Category::MAP_DATA
+    };                            /**< Estimated memory of the parsed data. */
 
 };
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MEMORY_USAGE_H
+#define SOLARUS_MEMORY_USAGE_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief Memory taken by each subsystem of the engine.
+ *
+ * Subsystems report what they allocate in their category, either with
+ * add() or by owning a Tracker. Sizes are those of the data that matter
+ * (pixels, samples, parsed files, objects), not the exact heap usage,
+ * and memory allocated inside third-party libraries is not counted.
+ * Counters can be updated from any thread.
+ */
+namespace MemoryUsage {
+
+/**
+ * \brief Subsystems whose memory is counted.
+ */
+enum class Category {
+  TEXTURES,       /**< Pixels of textures, in video memory. */
+  SOUNDS,         /**< Decoded sound effects. */
+  MUSICS,         /**< Music files read in advance and musics rendered in advance. */
+  LUA,            /**< Heap of the Lua state. */
+  MAP_DATA,       /**< Parsed map data files. */
+  TILESET_DATA,   /**< Parsed tileset data files. */
+  ENTITIES,       /**< Map entity objects. */
+  NUM_CATEGORIES
+};
+
+/**
+ * \brief Memory taken by a category.
+ */
+struct Usage {
+  int64_t bytes = 0;          /**< Bytes currently taken. */
+  int64_t peak_bytes = 0;     /**< Maximum bytes taken so far. */
+  int64_t num_objects = 0;    /**< Number of trackers of this category alive. */
+};
+
+/**
+ * \brief Counts the memory of an object in a category.
+ *
+ * Copying a tracker counts the copied object too, and destroying it
+ * removes its bytes from the category.
+ */
+class SOLARUS_API Tracker {
+
+  public:
+
+    explicit Tracker(Category category, int64_t bytes = 0);
+    Tracker(const Tracker& other);
+    Tracker& operator=(const Tracker& other);
+    ~Tracker();
+
+    int64_t get_bytes() const;
+    void set_bytes(int64_t bytes);
+
+  private:
+
+    Category category;        /**< Category of the object. */
+    int64_t bytes;            /**< Bytes counted for the object. */
+};
+
+SOLARUS_API void add(Category category, int64_t bytes);
+SOLARUS_API void set(Category category, int64_t bytes);
+SOLARUS_API Usage get(Category category);
+SOLARUS_API int64_t get_total_bytes();
+SOLARUS_API const std::string& get_category_name(Category category);
+
+SOLARUS_API void set_log_period(uint32_t log_period);
+SOLARUS_API void update();
+
+}
+
+}
+
+#endif
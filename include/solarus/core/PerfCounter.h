@@ -28,7 +28,7 @@ class SOLARUS_API PerfCounter {
 
   public:
 
-    static inline void update(const std::string& name);
+    static inline void update(const std::string& name, uint32_t amount = 1);
 
     static constexpr uint32_t interval = 1000;  /**< Time interval for reporting in milliseconds. */
 
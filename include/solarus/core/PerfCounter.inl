@@ -20,9 +20,9 @@
 
 namespace Solarus {
 
-inline void PerfCounter::update(const std::string& name) {
+inline void PerfCounter::update(const std::string& name, uint32_t amount) {
   uint32_t current_time = System::get_real_time();
-  ++count[name];
+  count[name] += amount;
   if (current_time - last_time >= interval) {
     last_time = current_time;
     std::ostringstream oss;
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PERF_TRACE_H
+#define SOLARUS_PERF_TRACE_H
+
+#include "solarus/core/Common.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Records how long each subsystem takes, frame after frame.
+ *
+ * Timed scopes are stored in a ring buffer: only the most recent ones are
+ * kept. When the trace is stopped, the buffer is written as a JSON file in
+ * the Chrome trace event format, that can be opened with chrome://tracing
+ * or https://ui.perfetto.dev.
+ *
+ * Counters sampled once per frame, like the hot path counts, are stored
+ * in the same buffer and shown as graphs.
+ *
+ * Tracing is disabled by default and is enabled with the -perf-trace=file
+ * command-line option. When disabled, a scope only costs a boolean test.
+ * Scopes can only be recorded from the main thread.
+ */
+class SOLARUS_API PerfTrace {
+
+  public:
+
+    /**
+     * \brief Measures the time between its creation and its destruction.
+     */
+    class Scope {
+
+      public:
+
+        inline explicit Scope(const char* name);
+        inline ~Scope();
+
+        Scope(const Scope& other) = delete;
+        Scope& operator=(const Scope& other) = delete;
+
+      private:
+
+        const char* name;     /**< Name of the scope, or nullptr if not traced. */
+        int64_t start;        /**< Start date in microseconds. */
+    };
+
+    static void start(const std::string& file_name);
+    static void stop();
+    static inline bool is_enabled();
+    static void record_counter(const char* name, int64_t value);
+
+    static constexpr size_t
+        capacity = 1 << 17;     /**< Number of scopes kept in the ring buffer. */
+    static constexpr size_t
+        max_name_length = 31;   /**< Scope names are truncated to this length. */
+
+  private:
+
+    /**
+     * \brief A scope that was measured.
+     */
+    struct Event {
+      char name[max_name_length + 1];  /**< Name of the scope. */
+      int64_t start;                   /**< Start date in microseconds. */
+      int64_t duration;                /**< Duration in microseconds,
+                                        * or value of a counter. */
+      bool counter;                    /**< Whether this is a counter sample. */
+    };
+
+    static inline int64_t get_time();
+    static void record(const char* name, int64_t start, int64_t end);
+    static Event& add_event(const char* name);
+
+    static bool enabled;                   /**< Whether scopes are recorded. */
+    static std::string file_name;          /**< File to write when stopping. */
+    static std::chrono::steady_clock::time_point
+        start_time;                        /**< Origin of dates. */
+    static std::vector<Event> events;      /**< Ring buffer of recorded scopes. */
+    static size_t next_event;              /**< Index where to write the next scope. */
+    static bool wrapped;                   /**< Whether old scopes were overwritten. */
+};
+
+}  // namespace Solarus
+
+#include "PerfTrace.inl"
+
+#endif
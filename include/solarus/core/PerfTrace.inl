@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Solarus {
+
+/**
+ * \brief Starts measuring a scope if tracing is enabled.
+ * \param name Name of the scope. Only the pointer is kept until the
+ * destruction of the scope.
+ */
+inline PerfTrace::Scope::Scope(const char* name):
+  name(nullptr),
+  start(0) {
+
+  if (enabled) {
+    this->name = name;
+    start = get_time();
+  }
+}
+
+/**
+ * \brief Records the scope if tracing is enabled.
+ */
+inline PerfTrace::Scope::~Scope() {
+
+  if (name != nullptr && enabled) {
+    record(name, start, get_time());
+  }
+}
+
+/**
+ * \brief Returns whether scopes are being recorded.
+ * \return \c true if tracing is enabled.
+ */
+inline bool PerfTrace::is_enabled() {
+  return enabled;
+}
+
+/**
+ * \brief Returns the current date of the trace.
+ * \return Microseconds since the trace was started.
+ */
+inline int64_t PerfTrace::get_time() {
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time
+  ).count();
+}
+
+}
@@ -18,6 +18,7 @@
 #define SOLARUS_PIXEL_BITS_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/core/Transform.h"
 #include <cstdint>
 #include <vector>
@@ -25,8 +26,8 @@
 namespace Solarus {
 
 class Point;
-class Rectangle;
 class Surface;
+class SurfaceImpl;
 
 /**
  * \brief Provides pixel-perfect collision checks for a surface.
@@ -34,12 +35,23 @@ class Surface;
  * This class stores efficiently the location of the non-transparent pixels of a surface.
  * For each pixel of the image, a bit indicates whether this pixel is transparent.
  * This class perform fast pixel-perfect collision checks.
+ *
+ * The bounding box of opaque pixels and a coarse mask with one bit per
+ * block of 8x8 pixels are computed once, so that most tests that miss are
+ * rejected before looking at individual pixels.
+ *
+ * Oriented collisions (with rotation or scaling) are checked row by row:
+ * each row of opaque pixels is clipped to the other image, and the pixels
+ * of the other image under it are sampled into 64-bit words that are
+ * compared with the row.
  */
-class PixelBits {
+class SOLARUS_API PixelBits {
 
   public:
 
     PixelBits(const Surface& surface, const Rectangle& image_position);
+    PixelBits(const SurfaceImpl& surface, const Rectangle& image_position);
+    PixelBits(const Size& size, const std::vector<bool>& opaque_pixels);
 
     bool test_aligned_collision(const PixelBits& other,
         const Point& location1, const Point& location2) const;
@@ -49,8 +61,26 @@ class PixelBits {
 
     bool test_oriented_collision(const PixelBits &other,
                                  const Transform& transform1, const Transform& transform2) const;
+    bool test_oriented_collision_per_pixel(const PixelBits &other,
+                                           const Transform& transform1, const Transform& transform2) const;
   private:
+    /**
+     * \brief Range of opaque pixels of a row.
+     */
+    struct RowExtent {
+      int first = 0;         /**< X coordinate of the first opaque pixel. */
+      int last = -1;         /**< X coordinate of the last opaque pixel,
+                              * or -1 if the row is fully transparent. */
+    };
+
+    void compute_extents();
     bool at(int x, int y) const;
+    bool block_at(int block_x, int block_y) const;
+    bool test_blocks(const PixelBits& other, const Point& location1,
+        const Point& location2, const Rectangle& intersection) const;
+    uint64_t get_word(int y, int word_index) const;
+    uint64_t sample_word(const PixelBits& other, int y, int first_x, uint64_t mask,
+        const glm::vec2& origin, const glm::vec2& vx, const glm::vec2& vy) const;
     void print() const;
     void print_mask(uint32_t mask) const;
 
@@ -62,6 +92,12 @@ class PixelBits {
     std::vector<std::vector<uint32_t>>
         bits;                /**< A two-dimensional array representing the
                               * transparency bit of each pixel in the image. */
+    std::vector<RowExtent>
+        row_extents;         /**< Opaque pixels of each row. */
+    std::vector<std::vector<uint32_t>>
+        block_bits;          /**< One bit per block of 8x8 pixels,
+                              * set if the block has an opaque pixel. */
+    Rectangle opaque_box;    /**< Bounding box of the opaque pixels. */
 
 };
 
@@ -20,10 +20,14 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/EnumInfo.h"
 #include "solarus/core/ResourceType.h"
+#include "solarus/core/Symbol.h"
 #include "solarus/lua/LuaData.h"
+#include <array>
 #include <iosfwd>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace Solarus {
 
@@ -40,6 +44,10 @@ struct SOLARUS_API EnumInfoTraits<ResourceType> {
  * This class stores the content of a quest database file
  * project_db.dat.
  * It does not create, remove or rename any file.
+ *
+ * Besides the sorted lists of elements, the ids of each resource type are
+ * indexed as symbols in a hash table. Callers that check the same id often
+ * can keep its symbol and test it without any string work.
  */
 class SOLARUS_API QuestDatabase : public LuaData {
 
@@ -68,12 +76,10 @@ class SOLARUS_API QuestDatabase : public LuaData {
     void clear();
 
     bool resource_exists(ResourceType resource_type, const std::string& id) const;
+    bool resource_exists(ResourceType resource_type, const Symbol& id) const;
     const ResourceMap& get_resource_elements(
         ResourceType resource_type
     ) const;
-    ResourceMap& get_resource_elements(
-        ResourceType resource_type
-    );
 
     bool add(
         ResourceType resource_type,
@@ -110,8 +116,17 @@ class SOLARUS_API QuestDatabase : public LuaData {
 
   private:
 
-    std::map<ResourceType, ResourceMap> resource_maps;
-    std::map<std::string, FileInfo> files;
+    static constexpr size_t num_resource_types =
+        static_cast<size_t>(ResourceType::SHADER) + 1;
+
+    ResourceMap& get_resource_map(ResourceType resource_type);
+
+    std::array<ResourceMap, num_resource_types>
+        resource_maps;                  /**< Elements of each type, sorted by id. */
+    std::array<std::unordered_set<Symbol>, num_resource_types>
+        resource_ids;                   /**< Ids of each type, for fast lookups. */
+    std::unordered_map<std::string, FileInfo>
+        files;                          /**< File information by path. */
 
 };
 
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_QUEST_FILE_INDEX_H
+#define SOLARUS_QUEST_FILE_INDEX_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief In-memory index of the read-only files of the quest.
+ *
+ * The index is built once from the PhysFS search path when the quest is
+ * opened, before the quest write directory is added to it.
+ * It answers existence and location queries without going through PhysFS.
+ *
+ * Files of data directories and files stored without compression in
+ * zip archives can be read directly from the disk, without taking the
+ * global PhysFS lock, so that several threads can read them in parallel.
+ *
+ * Once built, the index is never modified until clear() is called:
+ * const functions can be called by any thread.
+ */
+class SOLARUS_API QuestFileIndex {
+
+  public:
+
+    /**
+     * \brief A file or directory of the index.
+     */
+    struct Entry {
+      size_t source = 0;            /**< Index of the search path element containing it. */
+      bool directory = false;       /**< Whether this is a directory. */
+      bool stored = false;          /**< Whether this is an uncompressed archive entry. */
+      uint64_t size = 0;            /**< Size of an archive entry, 0 if unknown. */
+      uint64_t offset = 0;          /**< Offset of the local header of an archive entry. */
+    };
+
+    QuestFileIndex() = default;
+
+    void build();
+    void clear();
+    bool is_built() const;
+    size_t get_num_entries() const;
+
+    static bool normalize_file_name(const std::string& file_name, std::string& normalized);
+
+    const Entry* find(const std::string& file_name) const;
+    const std::string& get_source_path(const Entry& entry) const;
+    bool is_in_archive(const Entry& entry) const;
+    bool read(const std::string& file_name, const Entry& entry, std::string& buffer) const;
+
+  private:
+
+    /**
+     * \brief An element of the search path.
+     */
+    struct Source {
+      std::string path;             /**< Real path of the directory or archive. */
+      bool archive;                 /**< Whether this is a zip archive. */
+    };
+
+    /**
+     * \brief An entry of the central directory of a zip archive.
+     */
+    struct ArchiveEntry {
+      bool stored;                  /**< Whether the entry is not compressed. */
+      uint64_t size;                /**< Uncompressed size. */
+      uint64_t offset;              /**< Offset of the local header. */
+    };
+
+    using ArchiveEntries = std::unordered_map<std::string, ArchiveEntry>;
+
+    void add_directory(const std::string& dir_name, std::vector<ArchiveEntries>& archives);
+    size_t get_source(const std::string& path, std::vector<ArchiveEntries>& archives);
+    static bool read_archive_entries(const std::string& path, ArchiveEntries& archive_entries);
+
+    bool built = false;                              /**< Whether build() was called. */
+    std::vector<Source> sources;                     /**< Search path elements found. */
+    std::unordered_map<std::string, Entry> entries;  /**< Files and directories by name. */
+};
+
+}
+
+#endif
+
@@ -50,6 +50,54 @@ enum class DataFileLocation {
   LOCATION_WRITE_DIRECTORY,
 };
 
+/**
+ * \brief Read-only access to the content of a data file without copying it.
+ *
+ * When the file is a regular file of a directory (the quest data directory
+ * or the quest write directory) and the system supports it, the file is
+ * mapped in memory. Otherwise, for example in a data archive, its content is
+ * read into a buffer owned by the view. This buffer is reused when the same
+ * view opens other files.
+ *
+ * The content stays valid until the view is closed, opened again or
+ * destroyed.
+ * A mapping is only safe while the file is not truncated or rewritten,
+ * for example by hot reload or by an external editor: views kept for a long
+ * time, like streamed audio, must call copy_to_buffer() first.
+ */
+class SOLARUS_API DataFileView {
+
+  public:
+
+    DataFileView();
+    explicit DataFileView(std::string&& buffer);
+    DataFileView(DataFileView&& other);
+    DataFileView& operator=(DataFileView&& other);
+    ~DataFileView();
+
+    DataFileView(const DataFileView& other) = delete;
+    DataFileView& operator=(const DataFileView& other) = delete;
+
+    bool open(const std::string& file_name, bool language_specific = false);
+    void close();
+    void copy_to_buffer();
+
+    const char* get_data() const;
+    size_t get_size() const;
+    bool is_mapped() const;
+
+  private:
+
+    bool map(const std::string& file_name);
+    void unmap();
+
+    const char* data;           /**< Content of the file. */
+    size_t size;                /**< Size of the content in bytes. */
+    void* mapping;              /**< Memory mapping of the file or nullptr. */
+    std::string buffer;         /**< Content of the file when it is not mapped. */
+
+};
+
 // Initialization.
 SOLARUS_API bool open_quest(
     const std::string& program_name,
@@ -71,6 +119,11 @@ SOLARUS_API std::string get_actual_file_name(
     const std::string& file_name,
     bool language_specific
 );
+SOLARUS_API std::string get_actual_file_name(
+    const std::string& file_name,
+    bool language_specific,
+    const std::string& language
+);
 SOLARUS_API std::string data_file_read(
     const std::string& file_name
 );
@@ -82,6 +135,14 @@ SOLARUS_API void data_file_save(
     const std::string& file_name,
     const std::string& buffer
 );
+SOLARUS_API bool data_file_try_save(
+    const std::string& file_name,
+    const std::string& buffer
+);
+SOLARUS_API bool data_file_append(
+    const std::string& file_name,
+    const std::string& buffer
+);
 SOLARUS_API bool data_file_delete(const std::string& file_name);
 SOLARUS_API bool data_file_mkdir(const std::string& dir_name);
 SOLARUS_API bool data_file_is_dir(
@@ -19,6 +19,8 @@
 #define SOLARUS_QUEST_PROPERTIES_H
 
 #include "solarus/core/Common.h"
+#include "solarus/audio/MusicQuality.h"
+#include "solarus/core/CatchUpMode.h"
 #include "solarus/core/Size.h"
 #include "solarus/lua/LuaData.h"
 #include <iosfwd>
@@ -72,6 +74,14 @@ class SOLARUS_API QuestProperties : public LuaData {
     void set_min_quest_size(const Size& min_quest_size);
     Size get_max_quest_size() const;
     void set_max_quest_size(const Size& max_quest_size);
+    CatchUpMode get_catch_up_mode() const;
+    void set_catch_up_mode(CatchUpMode catch_up_mode);
+    int get_max_catch_up_updates() const;
+    void set_max_catch_up_updates(int max_catch_up_updates);
+    int get_lag_drop_threshold() const;
+    void set_lag_drop_threshold(int lag_drop_threshold);
+    MusicQuality get_music_quality() const;
+    void set_music_quality(MusicQuality music_quality);
 
   private:
 
@@ -91,6 +101,13 @@ class SOLARUS_API QuestProperties : public LuaData {
     Size normal_quest_size;            /**< Default quest size. */
     Size min_quest_size;               /**< Minimum quest size. */
     Size max_quest_size;               /**< Maximum quest size. */
+    CatchUpMode catch_up_mode;         /**< How the main loop catches up
+                                        * when updates are late. */
+    int max_catch_up_updates;          /**< Maximum number of updates
+                                        * before drawing a frame. */
+    int lag_drop_threshold;            /**< Lag in milliseconds beyond which
+                                        * the simulation gives up catching up. */
+    MusicQuality music_quality;        /**< Rendering tier of .it musics. */
 
 };
 
@@ -18,17 +18,41 @@
 #define SOLARUS_RANDOM_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/RandomStream.h"
+#include <cstdint>
 
 namespace Solarus {
 
 /**
  * \brief Provides some functions to compute random numbers.
+ *
+ * Each subsystem draws from its own stream, all derived from the same
+ * seed. Numbers drawn by one subsystem then do not change the numbers
+ * of the others, so the order in which subsystems are updated, possibly
+ * on several threads, does not matter for input replays.
  */
 namespace Random {
 
+/**
+ * \brief Subsystems that have their own random stream.
+ */
+enum class Subsystem {
+  GENERAL,        /**< Everything else. */
+  MOVEMENTS,      /**< Random movements and path recomputations. */
+  ENEMIES,        /**< Enemy behavior and effects. */
+  EFFECTS,        /**< Purely visual effects. */
+  SCRIPTS,        /**< The sol.random Lua API. */
+  NUM_SUBSYSTEMS
+};
+
 void initialize();
 void quit();
 
+uint32_t get_seed();
+void set_seed(uint32_t seed);
+
+RandomStream& get_stream(Subsystem subsystem);
+
 int get_number(unsigned int x);
 int get_number(int x, int y);
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_RANDOM_STREAM_H
+#define SOLARUS_RANDOM_STREAM_H
+
+#include "solarus/core/Common.h"
+#include "solarus/lua/ExportableToLua.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief An independent sequence of pseudo-random numbers.
+ *
+ * The generator is xoshiro128**: 16 bytes of state and a few integer
+ * operations per number. The same seed always produces the same sequence.
+ *
+ * A stream is not thread-safe: code running on several threads should
+ * give each thread its own stream.
+ */
+class SOLARUS_API RandomStream: public ExportableToLua {
+
+  public:
+
+    explicit RandomStream(uint64_t seed = 0);
+
+    uint64_t get_seed() const;
+    void set_seed(uint64_t seed);
+
+    /**
+     * \brief Returns the next 32 random bits.
+     * \return A random integer.
+     */
+    uint32_t next() {
+
+      const uint32_t result = rotl(state[1] * 5, 7) * 9;
+      const uint32_t t = state[1] << 9;
+      state[2] ^= state[0];
+      state[3] ^= state[1];
+      state[1] ^= state[2];
+      state[0] ^= state[3];
+      state[2] ^= t;
+      state[3] = rotl(state[3], 11);
+      return result;
+    }
+
+    /**
+     * \brief Returns a random integer number in [0, x[ with a uniform distribution.
+     * \param x The superior bound. Must be positive.
+     * \return A random integer number in [0, x[.
+     */
+    int get_number(unsigned int x) {
+      return static_cast<int>(get_bounded(x));
+    }
+
+    /**
+     * \brief Returns a random integer number in [x, y[ with a uniform distribution.
+     * \param x The inferior bound.
+     * \param y The superior bound. Must be greater than x.
+     * \return A random integer number in [x, y[.
+     */
+    int get_number(int x, int y) {
+      return static_cast<int>(static_cast<uint32_t>(x) +
+          get_bounded(static_cast<uint32_t>(y) - static_cast<uint32_t>(x)));
+    }
+
+    double get_real();
+
+    void get_numbers(int* numbers, size_t count, int x, int y);
+    void get_reals(double* reals, size_t count);
+
+    const std::string& get_lua_type_name() const override;
+
+  private:
+
+    static uint32_t rotl(uint32_t value, int shift) {
+      return (value << shift) | (value >> (32 - shift));
+    }
+
+    /**
+     * \brief Returns a random integer in [0, bound[ without modulo bias.
+     *
+     * Uses the multiply-and-shift method, which rejects a number only
+     * in rare cases.
+     *
+     * \param bound The superior bound. Must be positive.
+     * \return A random integer in [0, bound[.
+     */
+    uint32_t get_bounded(uint32_t bound) {
+
+      uint64_t product = static_cast<uint64_t>(next()) * bound;
+      uint32_t low = static_cast<uint32_t>(product);
+      if (low < bound) {
+        const uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+          product = static_cast<uint64_t>(next()) * bound;
+          low = static_cast<uint32_t>(product);
+        }
+      }
+      return static_cast<uint32_t>(product >> 32);
+    }
+
+    uint64_t seed;                /**< Seed of the sequence. */
+    uint32_t state[4];            /**< Current state of the generator. */
+
+};
+
+}
+
+#endif
+
@@ -21,44 +21,140 @@
 #include "solarus/core/ResourceType.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/entities/TilePattern.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
-#include <thread>
+#include <mutex>
+#include <queue>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
+class MapData;
+
 /**
  * \brief Provides fast access to quest resources.
  *
  * Maintains a cache of already loaded quest resources
  * so that next accesses are faster.
+ *
+ * Resources can also be preloaded in background by IO jobs of the JobSystem.
+ * Jobs only read files, decode images and sounds and parse data files.
+ * Their results are handed back to the main thread by update(), which
+ * uploads them to the renderer and the audio device and puts them in the
+ * cache of their class (Sprite, Surface, Sound, Music) or in this provider
+ * (tilesets, maps).
  */
 class SOLARUS_API ResourceProvider {
 
   public:
 
+    /**
+     * \brief How soon a resource to preload will be needed.
+     */
+    enum class PreloadPriority {
+      LOW,     /**< Might be needed some day. */
+      NORMAL,  /**< Will probably be needed soon, e.g. maps adjacent to the current one. */
+      HIGH     /**< Needed as soon as possible, e.g. the destination of a
+                * teletransporter the hero is approaching. */
+    };
+
     ResourceProvider();
+    ~ResourceProvider();
+    ResourceProvider(const ResourceProvider& other) = delete;
+    ResourceProvider& operator=(const ResourceProvider& other) = delete;
     void clear();
 
     Tileset& get_tileset(const std::string& tileset_id);
     const std::map<std::string, std::shared_ptr<Tileset>>& get_loaded_tilesets();
+    std::shared_ptr<MapData> take_map_data(const std::string& map_id);
+    void keep_recent_map_data(const std::string& map_id, const std::shared_ptr<MapData>& map_data);
+    int get_map_cache_size() const;
+    void set_map_cache_size(int map_cache_size);
 
-    // TODO other types of resources
     // TODO clear/update when the resource list changes dynamically
 
     void invalidate_resource_element(ResourceType resource_type, const std::string& element_id);
 
     void start_preloading_resources();
+    void preload(
+        ResourceType resource_type,
+        const std::string& element_id,
+        PreloadPriority priority = PreloadPriority::NORMAL
+    );
+    void preload_map_neighbors(const MapData& map_data);
+    void update();
+    std::vector<std::string> get_active_preloads();
+
+    static constexpr uint32_t
+        update_time_budget = 4;    /**< Milliseconds update() may spend uploading
+                                    * preloaded resources. */
 
   private:
 
-    std::thread preloader_thread;  /**< Thread that loads resources in background. */
+    struct PreloadResult;
+
+    /**
+     * \brief A resource waiting to be preloaded.
+     */
+    struct PreloadJob {
+      ResourceType resource_type;        /**< Type of resource. */
+      std::string element_id;            /**< Id of the resource element. */
+      PreloadPriority priority;          /**< Jobs with higher priority run first. */
+      uint64_t order;                    /**< Jobs with the same priority run in this order. */
+      std::shared_ptr<Tileset> tileset;  /**< The tileset to load, for tileset jobs. */
+      std::string file_name;             /**< Data file of the element, resolved on the
+                                          * main thread. */
+      std::string language;              /**< Current language when the job was queued. */
+
+      bool operator<(const PreloadJob& other) const;
+    };
+
+    /**
+     * \brief Preloading state of a resource element.
+     */
+    struct PreloadState {
+      PreloadPriority priority;   /**< Highest priority requested. */
+      bool started;               /**< Whether a job took it. */
+    };
+
+    using ElementKey = std::pair<ResourceType, std::string>;
+
+    void stop_preloading();
+    void run_next_job();
+    std::unique_ptr<PreloadResult> run_job(const PreloadJob& job);
+    void finish_job(PreloadResult& result);
+
+    std::mutex preload_mutex;      /**< Protects the jobs, the results and the states. */
+    std::condition_variable
+        preload_condition;         /**< Notified when a job given to the job system
+                                    * is finished. */
+    std::priority_queue<PreloadJob>
+        preload_jobs;              /**< Resources waiting to be preloaded. */
+    std::deque<std::unique_ptr<PreloadResult>>
+        preload_results;           /**< Preloaded resources to finish on the main thread. */
+    std::map<ElementKey, PreloadState>
+        preload_states;            /**< Resources already requested. */
+    std::vector<ElementKey>
+        running_preloads;          /**< Resources being read by jobs. */
+    uint64_t next_job_order;       /**< Order of the next job. */
+    int num_scheduled_jobs;        /**< Jobs given to the job system and not
+                                    * finished yet. */
+    bool stopping;                 /**< Whether preload jobs should do nothing. */
+
     std::map<std::string, std::shared_ptr<Tileset>>
         tileset_cache;             /**< Cache of loaded tilesets. */
+    std::map<std::string, std::shared_ptr<MapData>>
+        map_data_cache;            /**< Preloaded map data not used yet. */
+    std::deque<std::pair<std::string, std::shared_ptr<MapData>>>
+        recent_map_data;           /**< Data of the maps used recently, most recent first. */
+    int map_cache_size;            /**< Number of recent maps whose data and drawings are kept. */
 };
 
 }
 
 #endif
-
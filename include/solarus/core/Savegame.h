@@ -18,16 +18,22 @@
 #define SOLARUS_SAVEGAME_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/EnumInfo.h"
 #include "solarus/core/Equipment.h"
+#include "solarus/core/SavegameValueHandle.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/ExportableToLua.h"
+#include <functional>
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 struct lua_State;
 
 namespace Solarus {
 
+class BinaryReader;
 class LuaContext;
 class MainLoop;
 
@@ -42,6 +48,14 @@ class SOLARUS_API Savegame: public ExportableToLua {
 
     static const int SAVEGAME_VERSION;  /**< Version number of the savegame file format. */
 
+    /**
+     * \brief Encodings of savegame files.
+     */
+    enum class Format {
+      TEXT,     /**< Lua assignments, one per value. */
+      BINARY    /**< Binary snapshot followed by a journal of changes. */
+    };
+
     // Keys to built-in values saved.
     static const std::string KEY_SAVEGAME_VERSION;
     static const std::string KEY_STARTING_MAP;
@@ -93,7 +107,10 @@ class SOLARUS_API Savegame: public ExportableToLua {
     bool is_empty() const;
     void initialize();
     void save();
+    void save_async(const std::function<void(bool)>& callback);
     const std::string& get_file_name() const;
+    Format get_format() const;
+    void set_format(Format format);
 
     // data
     bool is_string(const std::string& key) const;
@@ -108,6 +125,23 @@ class SOLARUS_API Savegame: public ExportableToLua {
     bool is_set(const std::string& key) const;
     void unset(const std::string& key);
 
+    SavegameValueHandle get_value_handle(const std::string& key);
+    bool is_value_handle(SavegameValueHandle handle) const;
+    const std::string& get_value_key(SavegameValueHandle handle) const;
+    bool is_string(SavegameValueHandle handle) const;
+    std::string get_string(SavegameValueHandle handle) const;
+    void set_string(SavegameValueHandle handle, const std::string& value);
+    bool is_integer(SavegameValueHandle handle) const;
+    int get_integer(SavegameValueHandle handle) const;
+    void set_integer(SavegameValueHandle handle, int value);
+    bool is_boolean(SavegameValueHandle handle) const;
+    bool get_boolean(SavegameValueHandle handle) const;
+    void set_boolean(SavegameValueHandle handle, bool value);
+    bool is_set(SavegameValueHandle handle) const;
+    void unset(SavegameValueHandle handle);
+
+    void take_changed_keys(std::set<std::string>& keys);
+
     void set_initial_values();
     void set_default_keyboard_controls();
     void set_default_joypad_controls();
@@ -130,9 +164,18 @@ class SOLARUS_API Savegame: public ExportableToLua {
 
   private:
 
+    std::string export_to_buffer();
+    std::string export_to_text() const;
+    std::string export_to_binary();
+    bool import_from_binary(const std::string& buffer);
+    bool import_binary_value(BinaryReader& reader, const std::string& key);
+    bool append_journal();
+    void notify_value_changed(const std::string& key);
+
     struct SavedValue {
 
       enum {
+        VALUE_UNSET,
         VALUE_STRING,
         VALUE_INTEGER,
         VALUE_BOOLEAN
@@ -142,7 +185,19 @@ class SOLARUS_API Savegame: public ExportableToLua {
       int int_data;  // Also used for boolean
     };
 
-    std::map<std::string, SavedValue> saved_values;
+    const SavedValue* find_value(const std::string& key) const;
+    const SavedValue& get_value(SavegameValueHandle handle) const;
+    SavedValue& get_value(SavegameValueHandle handle);
+
+    // Declared before the equipment, which gets handles when it is created.
+    std::vector<SavedValue>
+        values;                    /**< Values indexed by the slot of their key.
+                                    * Unset ones keep their slot. */
+    std::vector<std::string>
+        value_keys;                /**< Key of each slot. */
+    std::map<std::string, uint32_t>
+        value_slots;               /**< Slot of each key, in key order for
+                                    * serialization. */
 
     bool empty;
     std::string file_name;         /**< Savegame file name relative to the quest write directory. */
@@ -152,11 +207,31 @@ class SOLARUS_API Savegame: public ExportableToLua {
     Transition::Style
         default_transition_style;  /**< Transition style to use by default. */
 
+    // Binary format.
+    Format format;                 /**< Encoding of the file. */
+    std::set<std::string>
+        dirty_keys;                /**< Keys set or unset since the file was written. */
+    std::set<std::string>
+        changed_keys;              /**< Keys whose value changed during the game
+                                    * since the last take_changed_keys(). */
+    std::map<std::string, uint32_t>
+        key_indexes;               /**< Index of each key in the string table of the file. */
+    size_t snapshot_size;          /**< Size in bytes of the binary snapshot of the file,
+                                    * 0 if changes cannot be appended to the file. */
+    size_t journal_size;           /**< Size in bytes of the changes appended to the file. */
+
     void import_from_file();
     static int l_newindex(lua_State* l);
 
 };
 
+template <>
+struct SOLARUS_API EnumInfoTraits<Savegame::Format> {
+  static const std::string pretty_name;
+
+  static const EnumInfo<Savegame::Format>::names_type names;
+};
+
 }
 
 #endif
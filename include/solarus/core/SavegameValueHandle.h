@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SAVEGAME_VALUE_HANDLE_H
+#define SOLARUS_SAVEGAME_VALUE_HANDLE_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+
+namespace Solarus {
+
+/**
+ * \brief Pre-resolved key of a value of a savegame.
+ *
+ * Obtained from Savegame::get_value_handle(), a handle gives access to its
+ * value with an array access instead of a string lookup.
+ * It stays valid as long as the savegame exists, even if the value is unset.
+ */
+class SavegameValueHandle {
+
+  public:
+
+    static constexpr uint32_t invalid_slot = UINT32_MAX;
+
+    /**
+     * \brief Creates an invalid handle.
+     */
+    SavegameValueHandle():
+      slot(invalid_slot) {
+    }
+
+    /**
+     * \brief Creates a handle to a slot of a savegame.
+     * \param slot Index of the value in the savegame.
+     */
+    explicit SavegameValueHandle(uint32_t slot):
+      slot(slot) {
+    }
+
+    /**
+     * \brief Returns whether this handle refers to a value.
+     * \return \c false if this handle was created with no slot.
+     */
+    bool is_valid() const {
+      return slot != invalid_slot;
+    }
+
+    /**
+     * \brief Returns the index of the value in the savegame.
+     * \return The slot.
+     */
+    uint32_t get_slot() const {
+      return slot;
+    }
+
+  private:
+
+    uint32_t slot;     /**< Index of the value in the savegame. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_STARTUP_TASKS_H
+#define SOLARUS_STARTUP_TASKS_H
+
+#include "solarus/core/Common.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Runs the initialization steps of the engine, in parallel when
+ * they are independent.
+ *
+ * Each task declares the tasks it depends on. Tasks that must run on the
+ * main thread, like the ones using the OpenGL context, are run by the
+ * thread calling run(). The other ones are run by worker threads that
+ * only exist during run().
+ *
+ * If a task throws an exception, no other task is started and the
+ * exception is thrown again by run() once running tasks are finished.
+ */
+class SOLARUS_API StartupTasks {
+
+  public:
+
+    /**
+     * \brief Threads that can run a task.
+     */
+    enum class Affinity {
+      MAIN_THREAD,    /**< Only the thread calling run(). */
+      ANY_THREAD      /**< Any thread. */
+    };
+
+    using Function = std::function<void()>;
+
+    explicit StartupTasks(int num_threads);
+
+    static int get_default_num_threads();
+
+    void add(
+        const std::string& name,
+        Affinity affinity,
+        const std::vector<std::string>& dependencies,
+        const Function& function
+    );
+    void run();
+
+    std::vector<std::string> get_report() const;
+
+  private:
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * \brief A step of the initialization.
+     */
+    struct Task {
+      std::string name;                   /**< Name shown in the report. */
+      Affinity affinity;                  /**< Threads allowed to run it. */
+      std::vector<size_t> dependencies;   /**< Tasks to finish before this one. */
+      Function function;                  /**< What to do. */
+      bool started;                       /**< Whether a thread took this task. */
+      bool done;                          /**< Whether the task is finished. */
+      int thread;                         /**< Thread that ran it: 0 for the main thread. */
+      Clock::time_point start_time;       /**< When the task started. */
+      Clock::time_point end_time;         /**< When the task finished. */
+    };
+
+    int find_ready_task(bool main_thread) const;
+    void run_task(size_t index, int thread, std::unique_lock<std::mutex>& lock);
+    void run_worker(int thread);
+
+    int num_threads;                      /**< Number of worker threads, 0 to run everything
+                                           * on the main thread. */
+    int num_workers_started;              /**< Worker threads actually used by the last run(). */
+    std::vector<Task> tasks;              /**< All tasks, in the order they were added. */
+    Clock::time_point start_time;         /**< When run() was called. */
+    Clock::time_point end_time;           /**< When run() finished. */
+
+    std::mutex mutex;                     /**< Protects the state of tasks during run(). */
+    std::condition_variable
+        tasks_changed;                    /**< Notified when a task finishes. */
+    size_t num_tasks_done;                /**< Number of finished tasks. */
+    std::exception_ptr error;             /**< First exception thrown by a task. */
+};
+
+}
+
+#endif
+
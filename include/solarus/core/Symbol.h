@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SYMBOL_H
+#define SOLARUS_SYMBOL_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief An interned string.
+ *
+ * Each distinct string is stored once for the whole program, so symbols
+ * are compared and hashed as pointers, without looking at the characters.
+ * Use them for names that come from a small set and are compared often,
+ * like animation names.
+ *
+ * Interned strings are never freed: do not create symbols from unbounded
+ * user input. Use find() to look up a name without interning it.
+ */
+class SOLARUS_API Symbol {
+
+  public:
+
+    Symbol();
+    explicit Symbol(const std::string& name);
+
+    static Symbol find(const std::string& name);
+
+    /**
+     * \brief Returns the string of this symbol.
+     * \return The string. The reference remains valid until the program exits.
+     */
+    const std::string& get_name() const {
+      return *name;
+    }
+
+    /**
+     * \brief Returns whether this is the symbol of the empty string.
+     * \return \c true if the string is empty.
+     */
+    bool is_empty() const {
+      return name->empty();
+    }
+
+    bool operator==(const Symbol& other) const {
+      return name == other.name;
+    }
+
+    bool operator!=(const Symbol& other) const {
+      return name != other.name;
+    }
+
+    /**
+     * \brief Arbitrary but consistent order, for ordered containers.
+     */
+    bool operator<(const Symbol& other) const {
+      return std::less<const std::string*>()(name, other.name);
+    }
+
+    /**
+     * \brief Returns a hash value of this symbol.
+     * \return The hash value.
+     */
+    size_t hash() const {
+      return std::hash<const std::string*>()(name);
+    }
+
+  private:
+
+    explicit Symbol(const std::string* name);
+
+    static const std::string* intern(const std::string& name);
+    static const std::string* get_empty_string();
+
+    const std::string* name;      /**< The unique copy of the string. */
+
+};
+
+}
+
+namespace std {
+
+/**
+ * \brief Hashes symbols by identity, for unordered containers.
+ */
+template<>
+struct hash<Solarus::Symbol> {
+  size_t operator()(const Solarus::Symbol& symbol) const {
+    return symbol.hash();
+  }
+};
+
+}
+
+#endif
+
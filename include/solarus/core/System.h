@@ -24,6 +24,7 @@
 namespace Solarus {
 
 class Arguments;
+class StartupTasks;
 
 /**
  * \brief Provides low-level functions and initialization.
@@ -35,6 +36,7 @@ class SOLARUS_API System {
   public:
 
     static void initialize(const Arguments& args);
+    static void initialize(const Arguments& args, StartupTasks& tasks);
     static void quit();
     static void update();
 
@@ -43,13 +45,22 @@ class SOLARUS_API System {
     static uint32_t now();
     static uint32_t get_real_time();
     static void sleep(uint32_t duration);
+    static uint64_t get_real_time_us();
+    static void sleep_until_us(uint64_t date);
+
+    static float get_interpolation_factor();
+    static void set_interpolation_factor(float interpolation_factor);
 
     static constexpr uint32_t timestep = 10;  /**< Timestep added to the simulated time at each update. */
 
   private:
 
+    static void initialize_sdl(const Arguments& args);
+
     static uint32_t initial_time;         /**< Initial real time in milliseconds. */
     static uint32_t ticks;                /**< Simulated time in milliseconds. */
+    static float interpolation_factor;    /**< Fraction of the next timestep already elapsed
+                                           * when drawing, or 1 to draw the last update. */
 
 };
 
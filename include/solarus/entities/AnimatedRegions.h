@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ANIMATED_REGIONS_H
+#define SOLARUS_ANIMATED_REGIONS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Size.h"
+#include "solarus/entities/TilePtr.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include "solarus/graphics/TileMesh.h"
+#include <cstddef>
+#include <vector>
+
+namespace Solarus {
+
+class Map;
+class Tile;
+class TilePattern;
+
+/**
+ * \brief Manages the tiles that are in animated regions.
+ *
+ * These are the animated tiles and the tiles that overlap them: they are
+ * drawn at each frame, in their order of creation.
+ *
+ * When the renderer supports tile meshes, consecutive tiles of the same image
+ * are uploaded once in a mesh and drawn in a single call. Only the current
+ * frame of each animated pattern is sent at each frame.
+ * Rectangles repeating the same scrolling pattern, like parallax
+ * backgrounds, become a single quad of the mesh.
+ * Other tiles are drawn one by one.
+ */
+class AnimatedRegions {
+
+  public:
+
+    explicit AnimatedRegions(Map& map);
+
+    void add_tile(const TilePtr& tile);
+    void build();
+    void notify_tileset_changed();
+    void draw_on_map();
+
+  private:
+
+    /**
+     * \brief Tiles of the same image drawn in one call.
+     */
+    struct Mesh {
+      SurfacePtr image;                     /**< Image of the tiles. */
+      TileMeshPtr mesh;                     /**< The mesh, or nullptr if the renderer does not
+                                             * support tile meshes. */
+      std::vector<const TilePattern*>
+          animated_patterns;                /**< Pattern of each slot, starting at slot 1. */
+      std::vector<std::vector<Tile*>>
+          quad_tiles;                       /**< Tiles covered by each quad of the mesh. */
+      int num_repeats = 0;                  /**< Number of quads that repeat a pattern. */
+    };
+
+    /**
+     * \brief Consecutive tiles drawn the same way.
+     */
+    struct Run {
+      int mesh_index;                       /**< Mesh of the tiles, or -1 to draw a single tile. */
+      size_t first_tile;                    /**< Index of the first quad in the mesh
+                                             * or of the first tile in tiles. */
+      size_t num_tiles;                     /**< Number of quads or tiles. */
+    };
+
+    size_t find_repeated_rectangle(size_t first_tile, Size& size) const;
+    bool add_to_mesh(
+        size_t first_tile,
+        size_t num_tiles,
+        const Size& size,
+        std::vector<std::vector<TileMesh::Quad>>& quads);
+    void draw_tiles(const Run& run);
+
+    Map& map;                               /**< The map. */
+    std::vector<TilePtr> tiles;             /**< Tiles in animated regions of the layer. */
+    std::vector<Mesh> meshes;               /**< Meshes of the tiles. */
+    std::vector<Run> runs;                  /**< All tiles in drawing order. */
+
+};
+
+}
+
+#endif
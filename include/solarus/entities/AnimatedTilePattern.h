@@ -52,9 +52,13 @@ class AnimatedTilePattern: public TilePattern {
         const Point& viewport
     ) const override;
     bool is_drawn_at_its_position() const override;
+    bool get_mesh_quad(TileMesh::Quad& quad) const override;
+    bool get_frame_offset(Point& offset) const override;
 
   private:
 
+    const Rectangle& get_current_frame() const;
+
     std::vector<Rectangle> frames;    /**< List of rectangles representing the animation frames
                                        * of this tile pattern in the tileset image.
                                        * The frames should have the same width and height. */
@@ -65,7 +69,6 @@ class AnimatedTilePattern: public TilePattern {
     int frame_index;                  /**< Index of the current frame.
                                        * - if no mirror loop: between 0 and frames.size() - 1
                                        * - if mirror loop: between 0 and 2 * frames.size() - 3 */
-    uint32_t next_frame_date;         /**< Date of the next frame change. */
 
 
 };
@@ -40,6 +40,37 @@ class SOLARUS_API CustomEntity: public Entity {
 
     static constexpr EntityType ThisType = EntityType::CUSTOM;
 
+    /**
+     * \brief Shapes of collision tests computed without calling Lua.
+     */
+    enum class CollisionShape {
+      CIRCLE,    /**< The circles around both centers intersect. */
+      DISTANCE,  /**< The origins are close enough. */
+      CONE       /**< The other center is in a cone from this center. */
+    };
+
+    /**
+     * \brief Parameters of a collision test computed without calling Lua.
+     */
+    struct NativeCollisionTest {
+
+      bool test(const CustomEntity& entity, const Entity& other) const;
+
+      CollisionShape shape = CollisionShape::CIRCLE;
+      int radius = 0;                 /**< Circle: radius around this center.
+                                       * Distance and cone: maximum distance. */
+      int other_radius = 0;           /**< Circle: radius around the other center. */
+      double angle = -1.0;            /**< Cone: direction in radians,
+                                       * or negative to follow the sprites direction. */
+      double aperture = 0.0;          /**< Cone: opening angle in radians. */
+      std::vector<int> layers;        /**< Layers of other entities to detect
+                                       * (empty means all). */
+      bool filter_type = false;       /**< Whether only entities of a type are detected. */
+      EntityType type = EntityType::CUSTOM;  /**< The type to detect if filter_type is set. */
+      bool same_model = false;        /**< Whether only custom entities with the
+                                       * same model are detected. */
+    };
+
     CustomEntity(
         Game& game,
         const std::string& name,
@@ -127,6 +158,10 @@ class SOLARUS_API CustomEntity: public Entity {
         const ScopedLuaRef& collision_test_ref,
         const ScopedLuaRef& callback_ref
     );
+    void add_collision_test(
+        const NativeCollisionTest& collision_test,
+        const ScopedLuaRef& callback_ref
+    );
     void clear_collision_tests();
 
     bool test_collision_custom(Entity& entity) override;
@@ -188,9 +223,14 @@ class SOLARUS_API CustomEntity: public Entity {
             const ScopedLuaRef& custom_test_ref,
             const ScopedLuaRef& callback_ref
         );
+        CollisionInfo(
+            const NativeCollisionTest& native_test,
+            const ScopedLuaRef& callback_ref
+        );
 
         CollisionMode get_built_in_test() const;
         const ScopedLuaRef& get_custom_test_ref() const;
+        const NativeCollisionTest& get_native_test() const;
         const ScopedLuaRef& get_callback_ref() const;
 
       private:
@@ -199,6 +239,8 @@ class SOLARUS_API CustomEntity: public Entity {
                                           * or COLLISION_CUSTOM. */
         ScopedLuaRef custom_test_ref;    /**< Ref to a custom collision test
                                           * or LUA_REFNIL. */
+        NativeCollisionTest native_test; /**< Custom collision test used
+                                          * when there is no Lua ref. */
         ScopedLuaRef callback_ref;       /**< Ref to the function to called when
                                           * a collision is detected. */
 
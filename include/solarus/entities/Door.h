@@ -18,6 +18,7 @@
 #define SOLARUS_DOOR_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/SavegameValueHandle.h"
 #include "solarus/entities/Entity.h"
 #include <map>
 #include <string>
@@ -75,6 +76,7 @@ class Door: public Entity {
     void set_suspended(bool suspended) override;
     void update() override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
     std::string get_sword_tapping_sound() override;
     bool notify_action_command_pressed() override;
     void notify_collision(Entity& entity_overlapping, CollisionMode collision_mode) override;
@@ -126,6 +128,7 @@ class Door: public Entity {
 
     // Properties.
     const std::string savegame_variable;          /**< Boolean variable that saves the door state. */
+    const SavegameValueHandle savegame_value;     /**< Handle of savegame_variable if any. */
     OpeningMethod opening_method;                 /**< How this door can be opened. */
     std::string opening_condition;                /**< Condition required to open the door: a savegame variable if
                                                    * the opening mode is \c OPENING_BY_INTERACTION_IF_SAVEGAME_VARIABLE,
@@ -60,6 +60,7 @@ class DynamicTile: public Entity {
     void set_tileset(const std::string& tileset_id);
     bool is_drawn_at_its_position() const override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
     void notify_tileset_changed() override;
 
   private:
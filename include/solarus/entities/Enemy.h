@@ -24,6 +24,7 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/entities/EntityPtr.h"
 #include "solarus/entities/Explosion.h"
+#include <array>
 #include <map>
 #include <string>
 
@@ -125,7 +126,7 @@ class Enemy: public Entity {
     void set_can_hurt_hero_running(bool can_hurt_hero_running);
     int get_minimum_shield_needed() const;
     void set_minimum_shield_needed(int minimum_shield_needed);
-    EnemyReaction::Reaction get_attack_consequence(
+    const EnemyReaction::Reaction& get_attack_consequence(
         EnemyAttack attack,
         const Sprite* this_sprite) const;
     void set_attack_consequence(
@@ -156,6 +157,7 @@ class Enemy: public Entity {
     bool is_raised_block_obstacle(CrystalBlock& raised_block) override;
     bool is_stream_obstacle(Stream& stream) override;
 
+    bool are_ground_obstacles_cacheable() const override;
     bool is_low_wall_obstacle() const override;
     bool is_deep_water_obstacle() const override;
     bool is_shallow_water_obstacle() const override;
@@ -201,6 +203,10 @@ class Enemy: public Entity {
 
   private:
 
+    // reactions to attacks
+    const EnemyReaction& get_attack_reaction(EnemyAttack attack) const;
+    EnemyReaction& get_attack_reaction(EnemyAttack attack);
+
     // hurt the enemy
     void play_hurt_sound();
     bool is_sprite_finished_or_looping() const;
@@ -228,9 +234,9 @@ class Enemy: public Entity {
     bool can_hurt_hero_running;        /**< indicates that the enemy can attack the hero even when the hero is running */
     int minimum_shield_needed;         /**< shield number needed by the hero to avoid the attack of this enemy,
                                         * or 0 to make the attack unavoidable (default: 0) */
-    std::map<EnemyAttack, EnemyReaction>
-        attack_reactions;              /**< how the enemy reacts to each attack
-                                           * (by default, it depends on the attacks) */
+    std::array<EnemyReaction, num_enemy_attacks>
+        attack_reactions;              /**< how the enemy reacts to each attack, indexed by attack
+                                        * (by default, it depends on the attacks) */
     std::string savegame_variable;     /**< name of the boolean variable indicating whether this enemy is killed,
                                         * or an empty string if it is not saved */
     bool traversable;                  /**< Whether this enemy can be traversed by other entities. */
@@ -17,6 +17,8 @@
 #ifndef SOLARUS_ENEMY_ATTACK_H
 #define SOLARUS_ENEMY_ATTACK_H
 
+#include <cstddef>
+
 namespace Solarus {
 
 /**
@@ -33,6 +35,11 @@ enum class EnemyAttack {
   SCRIPT       /**< a script decided to hurt the enemy */
 };
 
+/**
+ * \brief Number of attacks, to index arrays with an EnemyAttack.
+ */
+constexpr size_t num_enemy_attacks = static_cast<size_t>(EnemyAttack::SCRIPT) + 1;
+
 }
 
 #endif
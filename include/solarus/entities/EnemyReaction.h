@@ -20,8 +20,9 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/EnumInfo.h"
 #include "solarus/lua/ScopedLuaRef.h"
-#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
@@ -74,8 +75,12 @@ class SOLARUS_API EnemyReaction {
 
   private:
 
+    Reaction& get_sprite_reaction(const Sprite* sprite);
+
     Reaction general_reaction;                             /**< Reaction to make unless there are sprite-specific overrides. */
-    std::map<const Sprite*, Reaction> sprite_reactions;    /**< Sprite-specific reaction (overrides the default one). */
+    std::vector<std::pair<const Sprite*, Reaction>>
+        sprite_reactions;                                  /**< Sprite-specific reactions (override the default one),
+                                                            * sorted by sprite. Enemies have few sprites. */
 
 };
 
@@ -18,24 +18,34 @@
 #define SOLARUS_ENTITIES_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/EnumInfo.h"
+#include "solarus/containers/FlatQuadtree.h"
+#include "solarus/containers/MonotonicArena.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/entities/CameraPtr.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/entities/EntityPtr.h"
 #include "solarus/entities/EntityType.h"
 #include "solarus/entities/Ground.h"
+#include "solarus/entities/GroundObservers.h"
 #include "solarus/entities/HeroPtr.h"
+#include "solarus/entities/MovementSystem.h"
+#include "solarus/entities/SeparatorRegions.h"
+#include "solarus/entities/StreamField.h"
 #include "solarus/entities/TilePtr.h"
-#include <list>
+#include "solarus/entities/WalkabilityGrid.h"
+#include <functional>
+#include <iterator>
 #include <map>
 #include <memory>
-#include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
 
+class AnimatedRegions;
 class Camera;
 class Destination;
 class Hero;
@@ -43,18 +53,16 @@ class Map;
 class MapData;
 class NonAnimatedRegions;
 class Rectangle;
+class Shader;
+class Sprite;
+class Stream;
 class Tileset;
 class TilePattern;
 struct TileInfo;
 
-using EntityList = std::list<EntityPtr>;
-using EntitySet = std::set<EntityPtr>;
 using EntityVector = std::vector<EntityPtr>;
 using ConstEntityVector = std::vector<ConstEntityPtr>;
 
-template <typename T, typename Comparator>
-class Quadtree;
-
 /**
  * \brief Comparator that sorts entities according to their stacking order
  * on the map (layer and then Z index).
@@ -76,21 +84,140 @@ class EntityZOrderComparator {
      * \return \c true if the first entity's Z index is lower than the second one's.
      */
     bool operator()(const ConstEntityPtr& first, const ConstEntityPtr& second) const {
+      return compare(*first, *second);
+    }
+
+    /**
+     * \overload Non-const version, to avoid creating temporary pointers.
+     */
+    bool operator()(const EntityPtr& first, const EntityPtr& second) const {
+      return compare(*first, *second);
+    }
 
-      if (first->get_layer() < second->get_layer()) {
+  private:
+
+    static bool compare(const Entity& first, const Entity& second) {
+
+      if (first.get_layer() < second.get_layer()) {
         return true;
       }
 
-      if (first->get_layer() > second->get_layer()) {
+      if (first.get_layer() > second.get_layer()) {
         return false;
       }
 
       // Same layer.
-      return first->get_z() < second->get_z();
+      return first.get_z() < second.get_z();
     }
 };
 
-using EntityTree = Quadtree<EntityPtr, EntityZOrderComparator>;
+/**
+ * \brief Iterable view of map entities of a type, cast to their class.
+ *
+ * The view copies nothing: it iterates directly on the per-layer lists
+ * of Entities.
+ * It is invalidated when an entity of this type is added to the map or
+ * changes its layer. Removing entities is always safe because removals are
+ * deferred to the end of the cycle.
+ *
+ * \tparam T The entity class, possibly const.
+ */
+template<typename T>
+class EntityTypeView {
+
+  public:
+
+    using Layers = std::map<int, EntityVector>;
+
+    /**
+     * \brief Forward iterator on the entities of the view.
+     */
+    class Iterator {
+
+      public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::shared_ptr<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        Iterator(Layers::const_iterator layer_it, Layers::const_iterator layer_end):
+          layer_it(layer_it),
+          layer_end(layer_end),
+          index(0) {
+          skip_empty_layers();
+        }
+
+        std::shared_ptr<T> operator*() const {
+          return std::static_pointer_cast<T>(layer_it->second[index]);
+        }
+
+        Iterator& operator++() {
+          ++index;
+          skip_empty_layers();
+          return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+          return layer_it == other.layer_it && index == other.index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+          return !(*this == other);
+        }
+
+      private:
+
+        void skip_empty_layers() {
+          while (layer_it != layer_end && index >= layer_it->second.size()) {
+            ++layer_it;
+            index = 0;
+          }
+        }
+
+        Layers::const_iterator layer_it;   /**< Current layer. */
+        Layers::const_iterator layer_end;  /**< End of the layers of the view. */
+        size_t index;                      /**< Current index in the layer. */
+    };
+
+    /**
+     * \brief Creates a view of some layers.
+     * \param first First layer of the view.
+     * \param last End of the layers of the view.
+     */
+    EntityTypeView(Layers::const_iterator first, Layers::const_iterator last):
+      first(first),
+      last(last) {
+    }
+
+    Iterator begin() const {
+      return Iterator(first, last);
+    }
+
+    Iterator end() const {
+      return Iterator(last, last);
+    }
+
+    bool empty() const {
+      return begin() == end();
+    }
+
+    size_t size() const {
+      size_t size = 0;
+      for (auto it = first; it != last; ++it) {
+        size += it->second.size();
+      }
+      return size;
+    }
+
+  private:
+
+    Layers::const_iterator first;          /**< First layer of the view. */
+    Layers::const_iterator last;           /**< End of the layers of the view. */
+};
+
+using EntityTree = FlatQuadtree<EntityPtr, std::hash<EntityPtr>>;
 
 /**
  * \brief Manages the whole content of a map.
@@ -104,6 +231,16 @@ class SOLARUS_API Entities {
 
   public:
 
+    /**
+     * \brief Which entities are updated when the map is split into rooms
+     * by separators.
+     */
+    enum class RoomActivation {
+      NONE,             /**< All entities are updated as usual. */
+      ROOM,             /**< Only entities in rooms overlapping the camera. */
+      ADJACENT_ROOMS    /**< Also entities in rooms next to these ones. */
+    };
+
     // Creation and destruction.
     Entities(Game& game, Map& map);
     ~Entities();
@@ -112,8 +249,12 @@ class SOLARUS_API Entities {
     Hero& get_hero();
     const CameraPtr& get_camera() const;
     Ground get_tile_ground(int layer, int x, int y) const;
+    WalkabilityGrid& get_walkability_grid();
+    GroundObservers& get_ground_observers();
+    const SeparatorRegions& get_separator_regions() const;
     EntityVector get_entities();
     const std::shared_ptr<Destination>& get_default_destination();
+    uint64_t get_positions_hash() const;
 
     // By name.
     EntityPtr get_entity(const std::string& name);
@@ -124,25 +265,29 @@ class SOLARUS_API Entities {
     EntityVector get_entities_with_prefix(EntityType type, const std::string& prefix);
     EntityVector get_entities_with_prefix_z_sorted(EntityType type, const std::string& prefix);
     bool has_entity_with_prefix(const std::string& prefix) const;
+    int get_num_entities_with_prefix(const std::string& prefix) const;
 
     // By type.
-    EntitySet get_entities_by_type(EntityType type);
-    EntityVector get_entities_by_type_z_sorted(EntityType type);
-    EntitySet get_entities_by_type(EntityType type, int layer);
+    EntityVector get_entities_by_type(EntityType type) const;
+    EntityVector get_entities_by_type_z_sorted(EntityType type) const;
+    const EntityVector& get_entities_by_type(EntityType type, int layer) const;
 
-    // By type, template versions to avoid casts.
+    // By type, template versions to avoid casts and copies.
     template<typename T>
-    std::set<std::shared_ptr<const T>> get_entities_by_type() const;
+    EntityTypeView<const T> get_entities_by_type() const;
     template<typename T>
-    std::set<std::shared_ptr<T>> get_entities_by_type();
+    EntityTypeView<T> get_entities_by_type();
     template<typename T>
-    std::set<std::shared_ptr<const T>> get_entities_by_type(int layer) const;
+    EntityTypeView<const T> get_entities_by_type(int layer) const;
     template<typename T>
-    std::set<std::shared_ptr<T>> get_entities_by_type(int layer);
+    EntityTypeView<T> get_entities_by_type(int layer);
 
     // By coordinates.
     void get_entities_in_rectangle_z_sorted(const Rectangle& rectangle, ConstEntityVector& result) const;
     void get_entities_in_rectangle_z_sorted(const Rectangle& rectangle, EntityVector& result);
+    void get_entities_in_rectangle(const Rectangle& rectangle, EntityVector& result);
+    template<typename Visitor>
+    bool visit_entities_in_rectangle(const Rectangle& rectangle, Visitor&& visitor) const;
 
     // By separator region.
     void get_entities_in_region_z_sorted(const Point& xy, EntityVector& result);
@@ -151,6 +296,7 @@ class SOLARUS_API Entities {
     // Handle entities.
     void create_entities(const MapData& data);
     void add_tile_info(const TileInfo& tile);
+    void add_tile_infos(const TileInfo& tile, const Size& size);
     void add_entity(const EntityPtr& entity);
     void add_tile(const TilePtr& entity);
     void remove_entity(Entity& entity);
@@ -160,6 +306,33 @@ class SOLARUS_API Entities {
     void bring_to_back(Entity& entity);
     void set_entity_layer(Entity& entity, int layer);
     void notify_entity_bounding_box_changed(Entity& entity);
+    void notify_entity_hot_state_changed(Entity& entity);
+    void notify_entity_draw_order_changed(Entity& entity);
+
+    // Collisions.
+    bool is_collision_batching_enabled() const;
+    void set_collision_batching_enabled(bool collision_batching_enabled);
+    bool defer_collision_check_with_detectors(Entity& entity);
+
+    // Streams.
+    bool is_stream_field_enabled() const;
+    void set_stream_field_enabled(bool stream_field_enabled);
+    const StreamField& get_stream_field() const;
+    void notify_stream_changed(Stream& stream);
+    void check_stream_field(Entity& entity);
+
+    // Parallel update.
+    bool is_parallel_update_enabled() const;
+    void set_parallel_update_enabled(bool parallel_update_enabled);
+
+    // Occlusion culling.
+    bool is_occlusion_culling_enabled() const;
+    void set_occlusion_culling_enabled(bool occlusion_culling_enabled);
+
+    // Rooms.
+    RoomActivation get_room_activation() const;
+    void set_room_activation(RoomActivation room_activation);
+    bool is_in_active_room(const Rectangle& bounding_box) const;
 
     // Specific to some entity types.
     bool overlaps_raised_blocks(int layer, const Rectangle& rectangle) ;
@@ -171,11 +344,13 @@ class SOLARUS_API Entities {
     void notify_map_opening_transition_finished(Map& map, const std::shared_ptr<Destination>& destination);
     void notify_tileset_changed();
     void notify_map_finished();
+    void save_non_animated_cells();
 
     // Game loop.
     void set_suspended(bool suspended);
     void update();
     void draw();
+    void destroy_removed_entities(uint32_t idle_time);
 
   private:
 
@@ -186,9 +361,67 @@ class SOLARUS_API Entities {
     using ByLayer = std::map<int, T>;
 
     /**
-     * \brief Ordered list of entities to be drawn.
+     * \brief Grounds of 8x8 squares, stored in the arena of the map.
+     */
+    using GroundVector = std::vector<Ground, ArenaAllocator<Ground>>;
+
+    /**
+     * \brief Ordered list of entities to be drawn on a layer.
+     *
+     * The list is kept from one frame to the next and only sorted again
+     * when the drawing order of its entities may have changed.
      */
-    using EntitiesToDraw = std::vector<EntityPtr>;
+    struct EntitiesToDraw {
+      EntityVector entities;          /**< Entities to draw. */
+      bool sorted = true;             /**< Whether entities are in drawing order. */
+    };
+
+    /**
+     * \brief An entity to draw that only draws sprites.
+     *
+     * Such entities may be drawn before others that they do not overlap,
+     * so that entities with the same shader and blend mode are drawn
+     * one after the other.
+     */
+    struct DrawItem {
+      Entity* entity;                 /**< The entity. */
+      Rectangle box;                  /**< Rectangle of the map where it draws. */
+      const Shader* shader;           /**< Shader of its sprites or nullptr. */
+      BlendMode blend_mode;           /**< Blend mode of its sprites. */
+      bool drawn;                     /**< Whether it was already drawn. */
+    };
+
+    /**
+     * \brief State of an entity read by the loops over all entities.
+     *
+     * These states are stored contiguously, in the order of all_entities,
+     * so that loops only dereference the entities that need work.
+     */
+    struct HotState {
+
+      /**
+       * \brief Boolean properties of the entity.
+       */
+      enum Flag : uint16_t {
+        ENABLED = 0x0001,
+        VISIBLE = 0x0002,
+        SUSPENDED = 0x0004,
+        HAS_MOVEMENT = 0x0008,
+        HAS_SPRITES = 0x0010,
+        DETECTOR = 0x0020,
+        BEING_REMOVED = 0x0040,
+        UPDATE_NEEDED = 0x0080,       /**< Entity::update() would do something. */
+        UPDATED_SEPARATELY = 0x0100,  /**< The camera, updated after the others. */
+        NEAR_CAMERA_ONLY = 0x0200,    /**< Only updated near the camera. */
+        ON_DEMAND = 0x0400,           /**< Only updated when awake or near the camera. */
+        AWAKE = 0x0800,               /**< Entity::is_awake(), for ON_DEMAND entities. */
+      };
+
+      Entity* entity;                 /**< The entity, kept alive by all_entities. */
+      Rectangle bounding_box;         /**< Maximum bounding box of the entity. */
+      int layer;                      /**< Layer of the entity. */
+      uint16_t flags;                 /**< Combination of Flag values. */
+    };
 
     /**
      * \brief Internal information about the entity insertion order.
@@ -211,10 +444,43 @@ class SOLARUS_API Entities {
     };
 
     void initialize_layers();
+    ByLayer<std::vector<bool>> add_tiles(const MapData& data);
+    static bool extend_tile_rectangle(
+        const TileInfo& tile_info,
+        Size& size,
+        const Point& xy,
+        const Size& next_size,
+        const std::string& pattern_id,
+        const Tileset* tileset);
+    void add_tile_infos_to_layer(const TileInfo& tile, const Size& size);
+    void add_tile_info_to_layer(const TileInfo& tile);
+    void preload_sprites(const MapData& data);
     void set_tile_ground(int layer, int x8, int y8, Ground ground);
+    void set_pattern_ground(int layer, const Rectangle& box, Ground ground);
     void remove_marked_entities();
+    void add_pending_entities_to_quadtree() const;
     void notify_entity_removed(Entity& entity);
     void update_crystal_blocks();
+    void check_deferred_collisions_with_detectors();
+    void advance_sprite_frames(
+        const std::function<bool(const HotState&)>& is_update_wanted);
+    template<typename Function>
+    void for_each_entity_with_prefix(const std::string& prefix, Function function) const;
+    void update_hot_flags(HotState& hot_state);
+    void update_active_rooms();
+    void remove_hot_states();
+    void remove_drawn_not_at_their_position();
+    bool is_in_draw_region(const Entity& entity, const Rectangle& bounding_box) const;
+    void add_entity_to_draw(const EntityPtr& entity);
+    void remove_entity_to_draw(Entity& entity, int layer);
+    void rebuild_entities_to_draw();
+    void sort_entities_to_draw();
+    int draw_entities(int layer, Camera& camera);
+    int draw_grouped_items(Camera& camera);
+    void update_occluded_squares();
+    bool is_occluded(int layer, const Rectangle& box) const;
+    void add_to_type_list(const EntityPtr& entity, int layer);
+    void remove_from_type_list(const EntityPtr& entity, int layer);
 
     // map
     Game& game;                                     /**< The game running this map */
@@ -225,35 +491,95 @@ class SOLARUS_API Entities {
     // tiles
     int tiles_grid_size;                            /**< Number of 8x8 squares in the map
                                                      * (tiles_grid_size = map_width8 * map_height8) */
-    ByLayer<std::vector<Ground>> tiles_ground;      /**< For each layer, list of size tiles_grid_size
+    ByLayer<GroundVector> tiles_ground;             /**< For each layer, list of size tiles_grid_size
                                                      * representing the ground property
                                                      * of each 8x8 square. */
     ByLayer<std::unique_ptr<NonAnimatedRegions>>
         non_animated_regions;                       /**< For each layer, all non-animated tiles are managed
                                                      * here for performance. */
-    ByLayer<std::vector<TilePtr>>
-        tiles_in_animated_regions;                  /**< For each layer, animated tiles and tiles overlapping them. */
+    ByLayer<std::unique_ptr<AnimatedRegions>>
+        animated_regions;                           /**< For each layer, animated tiles and tiles overlapping them. */
+    WalkabilityGrid walkability_grid;               /**< Obstacles of the terrain at 8x8 granularity. */
+    GroundObservers ground_observers;               /**< Entities sensible to their ground
+                                                     * and entities that modify it. */
+    StreamField stream_field;                       /**< Non-blocking streams baked at 8x8 granularity. */
+    MovementSystem movement_system;                 /**< Updates the running movements
+                                                     * before their entities. */
+    mutable SeparatorRegions separator_regions;     /**< Separators indexed for the camera
+                                                     * and the rooms they make. */
+    mutable bool separator_regions_dirty;           /**< Whether separator_regions must be rebuilt. */
 
     // dynamic entities
     HeroPtr hero;                                   /**< The hero, also stored in Game because
                                                      * it is kept when changing maps. */
     CameraPtr camera;                               /**< The visible area of the map. */
 
-    std::map<std::string, EntityPtr>
+    std::unordered_map<std::string, EntityPtr>
         named_entities;                             /**< Entities identified by a name. */
-    EntityList all_entities;                        /**< All map entities except tiles and the hero. */
-    std::map<EntityType, ByLayer<EntitySet>>
-        entities_by_type;                           /**< All map entities except tiles, by type and then layer. */
+    std::map<std::string, EntityPtr>
+        sorted_named_entities;                      /**< The same entities sorted by name,
+                                                     * for prefix queries. */
+    EntityVector all_entities;                      /**< All map entities except tiles and the hero,
+                                                     * in creation order. */
+    std::vector<HotState> hot_states;               /**< State of each entity of all_entities,
+                                                     * in the same order. */
+    uint32_t lua_events_version;                    /**< Version of the Lua events when the
+                                                     * AWAKE flags were last checked. */
+    std::vector<ByLayer<EntityVector>>
+        entities_by_type;                           /**< All map entities except tiles, indexed by type
+                                                     * and then by layer, in arbitrary order. */
+    static const EntityVector no_entities;          /**< Empty list, for queries of unused layers. */
 
     std::unique_ptr<EntityTree> quadtree;           /**< All map entities except tiles.
                                                      * Optimized for fast spatial search. */
+    mutable EntityVector
+        entities_to_add_to_quadtree;                /**< Entities added since the last use of the
+                                                     * quadtree, inserted together before it. */
     ByLayer<ZOrderInfo> z_orders;                   /**< For each layer, tracks the relative Z order of entities. */
     ByLayer<EntityVector>
         entities_drawn_not_at_their_position;       /**< For each layer, entities to draw even if there position
                                                      * is outside the camera. */
-    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, entities to be drawn at this cycle. */
-
-    EntityList entities_to_remove;                  /**< List of entities that need to be removed right now. */
+    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, entities to be drawn: the ones
+                                                     * in draw_region and the ones drawn not at their position. */
+    Rectangle draw_region;                          /**< Area of the map whose entities are in entities_to_draw,
+                                                     * or an empty rectangle if the lists are not built. */
+    bool drawing_entities;                          /**< Whether the lists of entities to draw are being
+                                                     * iterated: they must not change meanwhile. */
+    std::vector<DrawItem> draw_items;               /**< Consecutive entities that only draw sprites,
+                                                     * waiting to be drawn. */
+    std::vector<size_t> skipped_draw_items;         /**< Items that a grouped item would be drawn before. */
+    static constexpr size_t
+        max_draw_lookahead = 32;                    /**< Items looked at to group with a drawn one. */
+    bool occlusion_culling_enabled;                 /**< Whether drawings hidden by opaque tiles
+                                                     * of higher layers are skipped. */
+    bool occluded_squares_outdated;                 /**< Whether occluded_squares must be computed again. */
+    ByLayer<std::vector<bool>> occluded_squares;    /**< For each layer, whether each 8x8 square is hidden
+                                                     * by opaque tiles of higher layers, empty if none is. */
+
+    EntityVector entities_to_remove;                /**< List of entities that need to be removed right now. */
+    EntityVector entities_to_destroy;               /**< Entities removed from the map but not destroyed yet. */
+    static constexpr size_t
+        min_destroyed_per_cycle = 16;               /**< Removed entities destroyed at least at each cycle. */
+
+    bool collision_batching_enabled;                /**< Whether collisions of entities moved during
+                                                     * update() are checked in a single broad phase. */
+    bool collision_batching_active;                 /**< Whether collision checks are currently deferred. */
+    EntityVector entities_to_check;                 /**< Entities whose collisions with detectors
+                                                     * are deferred to the broad phase. */
+
+    bool stream_field_enabled;                      /**< Whether non-blocking streams are baked
+                                                     * in stream_field instead of being detectors. */
+
+    bool parallel_update_enabled;                   /**< Whether due sprite frames are advanced
+                                                     * on several threads before the serial update. */
+    std::vector<Sprite*> sprites_to_advance;        /**< Sprites whose frames are advanced by
+                                                     * the parallel phase of this cycle. */
+    static constexpr int
+        min_sprites_per_job_band = 64;              /**< Smallest chunk of sprites given to a thread. */
+
+    RoomActivation room_activation;                 /**< Which rooms have their entities updated. */
+    std::vector<Rectangle> active_rooms;            /**< Rooms whose entities are updated during
+                                                     * this cycle, if room_activation is not NONE. */
 
     std::shared_ptr<Destination>
         default_destination;                        /**< Default destination of this map or nullptr. */
@@ -290,105 +616,87 @@ inline const CameraPtr& Entities::get_camera() const {
 }
 
 /**
- * \brief Returns all entities of a type.
- * \return All entities of the type.
+ * \brief Calls a function on entities whose bounding box overlaps the given
+ * rectangle, until it returns \c false.
+ *
+ * Entities are visited in no particular order and without any allocation.
+ * This is the fastest query but the visitor must not create, remove or move
+ * entities, nor make other spatial queries, and therefore must not call Lua.
+ * Use get_entities_in_rectangle() in that case.
+ *
+ * \param rectangle A rectangle.
+ * \param visitor A function taking a <tt>const EntityPtr&</tt>
+ * and returning \c false to stop the iteration.
+ * \return \c false if the visitor stopped the iteration.
  */
-template<typename T>
-std::set<std::shared_ptr<const T>> Entities::get_entities_by_type() const {
+template<typename Visitor>
+bool Entities::visit_entities_in_rectangle(const Rectangle& rectangle, Visitor&& visitor) const {
 
-  std::set<std::shared_ptr<const T>> result;
+  add_pending_entities_to_quadtree();
+  return quadtree->visit_elements(rectangle, std::forward<Visitor>(visitor));
+}
 
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
+/**
+ * \brief Returns all entities of a type.
+ * \return A view of the entities of the type.
+ */
+template<typename T>
+EntityTypeView<const T> Entities::get_entities_by_type() const {
 
-  for (const auto& kvp : it->second) {
-    for (const ConstEntityPtr& entity : kvp.second) {
-      result.insert(std::static_pointer_cast<const T>(entity));
-    }
-  }
-  return result;
+  const ByLayer<EntityVector>& layers = entities_by_type[static_cast<size_t>(T::ThisType)];
+  return EntityTypeView<const T>(layers.begin(), layers.end());
 }
 
 /**
  * \brief Returns all entities of a type (non-const version).
- * \return All entities of the type.
+ * \return A view of the entities of the type.
  */
 template<typename T>
-std::set<std::shared_ptr<T>> Entities::get_entities_by_type() {
-
-  std::set<std::shared_ptr<T>> result;
-
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
+EntityTypeView<T> Entities::get_entities_by_type() {
 
-  for (const auto& kvp : it->second) {
-    for (const EntityPtr& entity : kvp.second) {
-      result.insert(std::static_pointer_cast<T>(entity));
-    }
-  }
-  return result;
+  const ByLayer<EntityVector>& layers = entities_by_type[static_cast<size_t>(T::ThisType)];
+  return EntityTypeView<T>(layers.begin(), layers.end());
 }
 
 /**
  * \brief Returns all entities of a type on the given layer.
  * \param layer The layer to get entities from.
- * \return All entities of the type on this layer.
+ * \return A view of the entities of the type on this layer.
  */
 template<typename T>
-std::set<std::shared_ptr<const T>> Entities::get_entities_by_type(int layer) const {
+EntityTypeView<const T> Entities::get_entities_by_type(int layer) const {
 
-  std::set<std::shared_ptr<const T>> result;
-
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
-
-  const ByLayer<EntitySet>& sets = it->second;
-  const auto& layer_it = sets.find(layer);
-  if (layer_it == sets.end()) {
-    return result;
+  const ByLayer<EntityVector>& layers = entities_by_type[static_cast<size_t>(T::ThisType)];
+  const auto& it = layers.find(layer);
+  if (it == layers.end()) {
+    return EntityTypeView<const T>(it, it);
   }
-  for (const EntityPtr& entity : layer_it->second) {
-    result.insert(std::static_pointer_cast<const T>(entity));
-  }
-  return result;
+  return EntityTypeView<const T>(it, std::next(it));
 }
 
 /**
  * \brief Returns all entities of a type on the given layer (non-const version).
  * \param layer The layer to get entities from.
- * \return All entities of the type on this layer.
+ * \return A view of the entities of the type on this layer.
  */
 template<typename T>
-std::set<std::shared_ptr<T>> Entities::get_entities_by_type(int layer) {
-
-  std::set<std::shared_ptr<T>> result;
+EntityTypeView<T> Entities::get_entities_by_type(int layer) {
 
-  const EntityType type = T::ThisType;
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
+  const ByLayer<EntityVector>& layers = entities_by_type[static_cast<size_t>(T::ThisType)];
+  const auto& it = layers.find(layer);
+  if (it == layers.end()) {
+    return EntityTypeView<T>(it, it);
   }
-
-  const ByLayer<EntitySet>& sets = it->second;
-  const auto& layer_it = sets.find(layer);
-  if (layer_it == sets.end()) {
-    return result;
-  }
-  for (const EntityPtr& entity : layer_it->second) {
-    result.insert(std::static_pointer_cast<T>(entity));
-  }
-  return result;
+  return EntityTypeView<T>(it, std::next(it));
 }
 
+template <>
+struct SOLARUS_API EnumInfoTraits<Entities::RoomActivation> {
+  static const std::string pretty_name;
+
+  static const EnumInfo<Entities::RoomActivation>::names_type names;
+};
+
 }
 
 #endif
@@ -20,13 +20,18 @@
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/GameCommand.h"
 #include "solarus/core/Common.h"
+#include "solarus/core/EnumInfo.h"
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/entities/EntityType.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/CollisionMode.h"
 #include "solarus/entities/EnemyAttack.h"
 #include "solarus/entities/EnemyReaction.h"
+#include "solarus/graphics/AnimationLod.h"
+#include "solarus/graphics/BlendMode.h"
 #include "solarus/graphics/SpritePtr.h"
 #include "solarus/lua/ExportableToLua.h"
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <set>
@@ -64,6 +69,7 @@ class Movement;
 class Npc;
 class Savegame;
 class Separator;
+class Shader;
 class Sensor;
 class Sprite;
 class Stairs;
@@ -95,6 +101,15 @@ class SOLARUS_API Entity: public ExportableToLua {
       bool removed = false;
     };
 
+    /**
+     * \brief When the engine calls update() on this entity.
+     */
+    enum class UpdatePolicy {
+      ALWAYS,          /**< Updated at each cycle. */
+      NEAR_CAMERA,     /**< Updated only when close to the visible area. */
+      ON_DEMAND        /**< Updated when active or close to the visible area. */
+    };
+
     // Destruction.
     virtual ~Entity();
     void remove_from_map();
@@ -147,6 +162,10 @@ class SOLARUS_API Entity: public ExportableToLua {
     void set_xy(const Point& xy);
     void set_xy(int x, int y);
     Point get_displayed_xy() const;
+    void save_previous_xy();
+    Point get_interpolation_offset() const;
+    bool is_interpolated() const;
+    void set_interpolated(bool interpolated);
 
     int get_width() const;
     int get_height() const;
@@ -187,6 +206,17 @@ class SOLARUS_API Entity: public ExportableToLua {
 
     int get_z() const;
     void set_z(int z);
+    int get_hot_state_index() const;
+    void set_hot_state_index(int hot_state_index);
+    int get_by_type_index() const;
+    void set_by_type_index(int by_type_index);
+    bool is_in_draw_list() const;
+    void set_in_draw_list(bool in_draw_list);
+    bool is_update_needed() const;
+    UpdatePolicy get_update_policy() const;
+    void set_update_policy(UpdatePolicy update_policy);
+    bool is_awake() const;
+    void notify_hot_state_changed();
 
     bool is_enabled() const;
     void set_enabled(bool enable);
@@ -212,7 +242,7 @@ class SOLARUS_API Entity: public ExportableToLua {
     bool has_sprite() const;
     SpritePtr get_sprite(const std::string& sprite_name = "") const;
     std::vector<SpritePtr> get_sprites() const;
-    std::vector<NamedSprite> get_named_sprites() const;
+    const std::vector<NamedSprite>& get_named_sprites() const;
     SpritePtr create_sprite(
         const std::string& animation_set_id,
         const std::string& sprite_name = "",
@@ -237,6 +267,9 @@ class SOLARUS_API Entity: public ExportableToLua {
     void set_sprites_suspended(bool suspended);
     void update_sprites();
     void update_sprite(Sprite& sprite);
+    virtual AnimationLod get_default_animation_lod() const;
+    AnimationLod get_animation_lod(const Sprite& sprite) const;
+    bool is_sprite_update_deferrable(Sprite& sprite, uint32_t now) const;
     ScopedLuaRef get_draw_override() const;
     void set_draw_override(const ScopedLuaRef& draw_override);
 
@@ -247,6 +280,9 @@ class SOLARUS_API Entity: public ExportableToLua {
     void clear_movement();
     bool are_movement_notifications_enabled() const;
     void set_movement_notifications_enabled(bool notify);
+    void update_movement_early();
+    bool is_movement_updated_early() const;
+    void clear_movement_updated_early();
     bool has_stream_action() const;
     const StreamAction* get_stream_action() const;
     StreamAction* get_stream_action();
@@ -301,6 +337,11 @@ class SOLARUS_API Entity: public ExportableToLua {
 
     bool has_layer_independent_collisions() const;
     void set_layer_independent_collisions(bool independent);
+    uint32_t get_collision_category() const;
+    void set_collision_category(uint32_t collision_category);
+    uint32_t get_collision_mask() const;
+    void set_collision_mask(uint32_t collision_mask);
+    bool can_detect(const Entity& other) const;
 
     // Detecting other entities.
     void check_collision(Entity& other);
@@ -326,6 +367,8 @@ class SOLARUS_API Entity: public ExportableToLua {
     // Being detected by other entities.
     void check_collision_with_detectors();
     void check_collision_with_detectors(Sprite& sprite);
+    void check_sprite_collisions_with_detectors();
+    void check_collisions_along_path(const std::vector<Point>& path);
 
     virtual void check_position();
     virtual void notify_collision_with_destructible(Destructible& destructible, CollisionMode collision_mode);
@@ -368,6 +411,8 @@ class SOLARUS_API Entity: public ExportableToLua {
     virtual bool is_obstacle_for(Entity& other);
     virtual bool is_obstacle_for(Entity& other, const Rectangle& candidate_position);
     bool is_ground_obstacle(Ground ground) const;
+    uint32_t get_ground_obstacles() const;
+    void notify_ground_obstacles_changed();
     virtual bool is_hero_obstacle(Hero& hero);
     virtual bool is_block_obstacle(Block& block);
     virtual bool is_teletransporter_obstacle(Teletransporter& teletransporter);
@@ -392,6 +437,9 @@ class SOLARUS_API Entity: public ExportableToLua {
     void draw(Camera& camera);
     virtual void built_in_draw(Camera& camera);
     void draw_sprites(Camera& camera, const Rectangle& clipping_area = Rectangle());
+    virtual bool is_drawn_with_sprites_only() const;
+    bool get_sprites_draw_state(
+        Rectangle& box, const Shader*& shader, BlendMode& blend_mode) const;
 
     // Easy access to various game objects.
     Entities& get_entities();
@@ -448,6 +496,7 @@ class SOLARUS_API Entity: public ExportableToLua {
     void update_stream_action();
 
     // Obstacles.
+    virtual bool are_ground_obstacles_cacheable() const;
     virtual bool is_traversable_obstacle() const;
     virtual bool is_wall_obstacle() const;
     virtual bool is_low_wall_obstacle() const;
@@ -475,6 +524,12 @@ class SOLARUS_API Entity: public ExportableToLua {
 
     int z;                                      /**< Z order of this entity on its layer.
                                                  * This value is abitrary, it can be negative and the sequence can have holes. */
+    int hot_state_index;                        /**< Index of this entity in the hot states of
+                                                 * the map entities, or -1. */
+    int by_type_index;                          /**< Index of this entity in the list of entities
+                                                 * of its type and layer, or -1. */
+    bool in_draw_list;                          /**< Whether this entity is in the list of entities
+                                                 * to draw of its layer. */
 
     Rectangle bounding_box;                     /**< This rectangle represents the position of the entity of the map and is
                                                  * used for the collision tests. It corresponds to the bounding box of the entity.
@@ -512,10 +567,16 @@ class SOLARUS_API Entity: public ExportableToLua {
     std::vector<std::shared_ptr<Movement>>
         old_movements;                          /**< Old movements to destroy as soon as possible. */
     bool movement_notifications_enabled;        /**< Whether entity:on_position_changed() and friends should be called. */
+    const Movement* movement_updated_early;     /**< Movement already updated at this cycle
+                                                 * by the MovementSystem, or nullptr. */
     Entity* facing_entity;                      /**< The detector in front of this entity if any. */
     int collision_modes;                        /**< Collision modes detected by entity
                                                  * (can be an OR combination of CollisionMode values). */
     bool layer_independent_collisions;          /**< Whether this entity detects collisions on all layers. */
+    uint32_t collision_category;                /**< Categories of this entity as a bitfield,
+                                                 * tested against the mask of detectors. */
+    uint32_t collision_mask;                    /**< Categories of entities this detector
+                                                 * can collide with. */
 
     int weight;                                 /**< Weight of this entity (level of "lift" ability required).
                                                  * -1 means an entity that cannot be lifted. */
@@ -542,6 +603,18 @@ class SOLARUS_API Entity: public ExportableToLua {
     int optimization_distance2;                 /**< Square of optimization_distance. */
     static constexpr int
         default_optimization_distance = 0;      /**< Default value. */
+    UpdatePolicy update_policy;                 /**< When the engine calls update(). */
+    Point previous_xy;                          /**< Position before the last update,
+                                                 * to draw the entity in between. */
+    uint32_t previous_xy_date;                  /**< Simulated date when previous_xy was saved. */
+    bool interpolated;                          /**< Whether the entity is drawn between its
+                                                 * previous and current positions. */
+    mutable uint32_t ground_obstacles;          /**< Cached result of get_ground_obstacles(). */
+    mutable bool ground_obstacles_known;        /**< Whether ground_obstacles is up to date. */
+    MemoryUsage::Tracker memory_tracker;        /**< Counts this entity in the memory usage. */
+    static constexpr int
+        max_interpolated_distance = 32;         /**< Moves longer than this in one update
+                                                 * are teleportations and not interpolated. */
 
 };
 
@@ -573,6 +646,140 @@ inline void Entity::set_z(int z) {
   this->z = z;
 }
 
+/**
+ * \brief Returns the collision categories of this entity.
+ * \return The categories as a bitfield.
+ */
+inline uint32_t Entity::get_collision_category() const {
+  return collision_category;
+}
+
+/**
+ * \brief Sets the collision categories of this entity.
+ * \param collision_category The categories as a bitfield.
+ */
+inline void Entity::set_collision_category(uint32_t collision_category) {
+  this->collision_category = collision_category;
+}
+
+/**
+ * \brief Returns the categories of entities this detector can collide with.
+ * \return The mask as a bitfield.
+ */
+inline uint32_t Entity::get_collision_mask() const {
+  return collision_mask;
+}
+
+/**
+ * \brief Sets the categories of entities this detector can collide with.
+ * \param collision_mask The mask as a bitfield.
+ */
+inline void Entity::set_collision_mask(uint32_t collision_mask) {
+  this->collision_mask = collision_mask;
+}
+
+/**
+ * \brief Returns whether this detector may collide with another entity.
+ *
+ * Pairs rejected here are skipped before any collision test.
+ *
+ * \param other Another entity.
+ * \return \c true if a category of the other entity is in the mask of
+ * this one.
+ */
+inline bool Entity::can_detect(const Entity& other) const {
+  return (other.collision_category & collision_mask) != 0;
+}
+
+/**
+ * \brief Returns the index of this entity in the hot states of the
+ * map entities.
+ * \return The index, or -1 if the entity has no hot state.
+ */
+inline int Entity::get_hot_state_index() const {
+  return hot_state_index;
+}
+
+/**
+ * \brief Sets the index of this entity in the hot states of the
+ * map entities.
+ *
+ * This function is called by Entities.
+ *
+ * \param hot_state_index The index, or -1.
+ */
+inline void Entity::set_hot_state_index(int hot_state_index) {
+  this->hot_state_index = hot_state_index;
+}
+
+/**
+ * \brief Returns the index of this entity in the list of map entities
+ * of its type and layer.
+ * \return The index, or -1 if the entity is not on a map.
+ */
+inline int Entity::get_by_type_index() const {
+  return by_type_index;
+}
+
+/**
+ * \brief Sets the index of this entity in the list of map entities
+ * of its type and layer.
+ *
+ * This function is called by Entities.
+ *
+ * \param by_type_index The index, or -1.
+ */
+inline void Entity::set_by_type_index(int by_type_index) {
+  this->by_type_index = by_type_index;
+}
+
+/**
+ * \brief Returns whether this entity is in the list of map entities
+ * to draw of its layer.
+ * \return \c true if the entity is in the list.
+ */
+inline bool Entity::is_in_draw_list() const {
+  return in_draw_list;
+}
+
+/**
+ * \brief Sets whether this entity is in the list of map entities to draw
+ * of its layer.
+ *
+ * This function is called by Entities.
+ *
+ * \param in_draw_list \c true if the entity is in the list.
+ */
+inline void Entity::set_in_draw_list(bool in_draw_list) {
+  this->in_draw_list = in_draw_list;
+}
+
+/**
+ * \brief Returns when the engine calls update() on this entity.
+ * \return The update policy.
+ */
+inline Entity::UpdatePolicy Entity::get_update_policy() const {
+  return update_policy;
+}
+
+/**
+ * \brief Returns whether this entity is drawn between its previous and
+ * current positions when drawing interpolated frames.
+ * \return \c true if the entity is interpolated.
+ */
+inline bool Entity::is_interpolated() const {
+  return interpolated;
+}
+
+/**
+ * \brief Sets whether this entity is drawn between its previous and
+ * current positions when drawing interpolated frames.
+ * \param interpolated \c true to interpolate the entity.
+ */
+inline void Entity::set_interpolated(bool interpolated) {
+  this->interpolated = interpolated;
+}
+
 /**
  * \brief Returns whether this entity is enabled.
  * \return true if this entity is enabled
@@ -631,6 +838,13 @@ inline bool Entity::overlaps(const Entity& other) const {
   return overlaps(other.get_bounding_box());
 }
 
+template <>
+struct SOLARUS_API EnumInfoTraits<Entity::UpdatePolicy> {
+  static const std::string pretty_name;
+
+  static const EnumInfo<Entity::UpdatePolicy>::names_type names;
+};
+
 }
 
 #endif
@@ -130,7 +130,7 @@ class SOLARUS_API EntityData : public LuaData {
 
     // Specific properties.
     void initialize_specific_properties();
-    const std::map<std::string, FieldValue>& get_specific_properties() const;
+    std::map<std::string, FieldValue> get_specific_properties() const;
     FieldValue get_specific_property(const std::string& key) const;
     bool is_string(const std::string& key) const;
     const std::string& get_string(const std::string& key) const;
@@ -147,6 +147,8 @@ class SOLARUS_API EntityData : public LuaData {
 
     bool import_from_lua(lua_State* l) override;
     bool export_to_lua(std::ostream& out) const override;
+    bool import_from_binary(BinaryReader& reader) override;
+    bool export_to_binary(BinaryWriter& writer) const override;
 
     static EntityData check_entity_data(lua_State* l, int index, EntityType type);
     static const std::map<EntityType, const EntityTypeDescription> get_entity_type_descriptions();
@@ -155,6 +157,9 @@ class SOLARUS_API EntityData : public LuaData {
 
     void export_user_properties(std::ostream& out) const;
     void export_specific_properties(std::ostream& out) const;
+    int find_specific_property(const std::string& key) const;
+    const FieldValue& get_field(const std::string& key, EntityFieldType value_type) const;
+    FieldValue& get_field(const std::string& key, EntityFieldType value_type);
 
     EntityType type;              /**< Type of entity. */
 
@@ -167,8 +172,12 @@ class SOLARUS_API EntityData : public LuaData {
         user_properties;          /**< User-defined properties. */
 
     // Specific properties.
-    std::map<std::string, FieldValue>
-        specific_properties;      /**< Additional properties specific to the entity type. */
+    const EntityTypeDescription*
+        type_description;         /**< Fields of the entity type, in the order of specific_values. */
+    std::vector<FieldValue>
+        specific_values;          /**< Additional properties specific to the entity type:
+                                   * one allocation per entity instead of a tree of nodes
+                                   * and keys. */
 
 };
 
@@ -20,6 +20,7 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/EnumInfo.h"
 #include "solarus/entities/EntityType.h"
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -38,6 +39,8 @@ class SOLARUS_API EntityTypeInfo : public EnumInfo<EntityType> {
 
     static bool can_be_stored_in_map_file(EntityType type);
     static bool can_be_created_from_lua_api(EntityType type);
+    static uint32_t get_collision_category(EntityType type);
+    static uint32_t get_default_collision_mask(EntityType type);
 
 };
 
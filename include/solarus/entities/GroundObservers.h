@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GROUND_OBSERVERS_H
+#define SOLARUS_GROUND_OBSERVERS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/EntityPtr.h"
+#include "solarus/entities/Ground.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+class Point;
+
+/**
+ * \brief Spatial index of the entities sensible to their ground and of the
+ * entities that modify the ground.
+ *
+ * Ground observers are stored in buckets of the map according to their
+ * ground point. For each ground modifier, the rectangle, layer and ground
+ * last notified are remembered, so that when a modifier moves or
+ * disappears, only observers whose ground point entered or left it
+ * need to recompute their ground.
+ */
+class SOLARUS_API GroundObservers {
+
+  public:
+
+    GroundObservers();
+
+    void notify_entity_added(Entity& entity);
+    void notify_entity_changed(Entity& entity);
+    void notify_entity_removed(const Entity& entity);
+    void notify_modifier_changed(
+        const Entity& modifier,
+        std::vector<EntityPtr>& observers
+    );
+
+  private:
+
+    /**
+     * \brief What a ground modifier covered when it was last notified.
+     */
+    struct ModifierState {
+      int layer;
+      Rectangle box;
+      Ground ground;     /**< Ground::EMPTY if it modifies nothing. */
+    };
+
+    static ModifierState get_modifier_state(const Entity& modifier);
+    static uint64_t get_bucket_key(int layer, const Point& xy);
+    void get_observers_in_rectangle(
+        int layer,
+        const Rectangle& box,
+        std::vector<Entity*>& observers
+    ) const;
+
+    static constexpr int bucket_shift = 6;  /**< Buckets are 64x64 pixels. */
+
+    std::unordered_map<uint64_t, std::vector<Entity*>>
+        buckets;                            /**< Ground observers by bucket. */
+    std::unordered_map<const Entity*, uint64_t>
+        observer_buckets;                   /**< Bucket of each ground observer. */
+    std::unordered_map<const Entity*, ModifierState>
+        modifiers;                          /**< Last state of each ground modifier. */
+
+};
+
+}
+
+#endif
+
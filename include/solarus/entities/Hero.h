@@ -62,6 +62,7 @@ class Hero: public Entity {
      * the main properties of this type of entity.
      */
     EntityType get_type() const override;
+    AnimationLod get_default_animation_lod() const override;
 
     /**
      * \name Game loop.
@@ -70,6 +71,7 @@ class Hero: public Entity {
      */
     void update() override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
     void set_suspended(bool suspended) override;
     bool notify_input(const InputEvent& event);
     void notify_command_pressed(GameCommand command) override;
@@ -51,6 +51,7 @@ class Hookshot: public Entity {
     // state
     void update() override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
     bool is_flying() const;
     bool is_going_back() const;
     void go_back();
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MOVEMENT_SYSTEM_H
+#define SOLARUS_MOVEMENT_SYSTEM_H
+
+#include "solarus/core/Common.h"
+#include "solarus/entities/EntityType.h"
+#include <typeinfo>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+class Movement;
+
+/**
+ * \brief Updates the movements of map entities in one pass, grouped by
+ * concrete movement type.
+ *
+ * At each cycle, the entities to update add their movement if it is
+ * running, that is, neither suspended nor finished. The movements are then
+ * updated type after type, before the entities themselves. Entity::update()
+ * skips a movement already updated this way. Other movements are still
+ * updated by their entity.
+ */
+class SOLARUS_API MovementSystem {
+
+  public:
+
+    static bool is_early_update_allowed(EntityType type);
+
+    void add(Entity& entity);
+    int update();
+    void finish();
+
+  private:
+
+    /**
+     * \brief A movement to update and its entity.
+     */
+    struct Entry {
+      Entity* entity;                   /**< The entity, alive until the end of the cycle. */
+      Movement* movement;               /**< Its movement when it was added. */
+    };
+
+    /**
+     * \brief The movements of a concrete type.
+     */
+    struct Group {
+      const std::type_info* type;       /**< Concrete type of the movements. */
+      std::vector<Entry> entries;       /**< Movements of this cycle. */
+    };
+
+    std::vector<Group> groups;          /**< Groups of all types ever seen,
+                                         * kept to reuse their memory. */
+    size_t last_group = 0;              /**< Index of the group of the last
+                                         * movement added. */
+
+};
+
+}
+
+#endif
+
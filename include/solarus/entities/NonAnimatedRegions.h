@@ -19,9 +19,14 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/containers/Grid.h"
+#include "solarus/containers/MonotonicArena.h"
+#include "solarus/core/Point.h"
 #include "solarus/entities/TileInfo.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include <list>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace Solarus {
@@ -35,6 +40,24 @@ class Map;
  * tile. The tiles in such rectangles of the map can be pre-drawn once for all
  * on an intermediate surface for performance. Furthermore, this intermediate
  * surface is drawn lazily when the camera moves.
+ *
+ * When the tileset of the map changes, only the cells that have tiles of
+ * this tileset are redrawn, and no more than a few cells per frame:
+ * outdated cells are still displayed until they are redrawn.
+ *
+ * Drawn cells stay in a cache when the camera leaves them, until the cache
+ * exceeds its video memory budget: then the least recently visible cells
+ * are forgotten first. Cells ahead of the camera in its direction of motion
+ * are drawn in advance within a time budget per frame, so that scrolling
+ * rarely has to draw a cell before showing it.
+ *
+ * When a map is left, its drawn cells are saved for a few maps, so that
+ * coming back to a recently left map does not draw its cells again as long
+ * as its tiles are the same.
+ *
+ * The 8x8 squares fully covered by opaque non-animated tiles can be
+ * computed on demand, and cells hidden by opaque tiles of higher layers
+ * are not drawn.
  */
 class NonAnimatedRegions {
 
@@ -44,27 +67,92 @@ class NonAnimatedRegions {
 
     void add_tile(const TileInfo& tile);
     void build(std::vector<TileInfo>& rejected_tiles);
+    void restore_cells();
+    void save_cells();
     void notify_tileset_changed();
-    void update();
+    const std::vector<bool>& get_opaque_squares();
+    void set_occluded_squares(const std::vector<bool>& occluded_squares);
     void draw_on_map();
 
+    static int get_max_saved_maps();
+    static void set_max_saved_maps(int max_saved_maps);
+    static void clear_saved_cells();
+
+    static constexpr int
+        max_cell_rebuilds_per_frame = 2;    /**< Outdated cells redrawn at most by draw_on_map(). */
+    static constexpr size_t
+        cell_cache_budget = 16 * 1024 * 1024; /**< Bytes of cell surfaces kept for this layer
+                                             * before hidden cells are forgotten. */
+    static constexpr uint64_t
+        prefetch_time_budget = 1000;        /**< Microseconds spent at most per frame
+                                             * to draw cells ahead of the camera. */
+    static constexpr size_t
+        saved_cells_budget = 32 * 1024 * 1024;  /**< Bytes of cell surfaces kept
+                                             * for maps that were left. */
+
   private:
 
+    /**
+     * \brief A drawn cell.
+     */
+    struct CachedCell {
+      SurfacePtr surface;                   /**< Non-animated tiles of the cell. */
+      uint64_t last_visible_frame = 0;      /**< Last frame where the cell was visible. */
+    };
+
     bool overlaps_animated_tile(const TileInfo& tile) const;
+    void reject_overlapping_parts(
+        const TileInfo& tile, std::vector<TileInfo>& rejected_tiles) const;
     void build_cell(int cell_index);
+    void build_opaque_squares();
+    Rectangle get_cell_box(int cell_index) const;
+    void prefetch_cells(const Rectangle& camera_position);
+    void remove_old_cells();
+    size_t get_cell_bytes() const;
+
+    /**
+     * \brief Drawn cells of a layer of a map that was left.
+     */
+    struct SavedCells {
+      std::string map_id;                   /**< Id of the map. */
+      int layer;                            /**< Layer of the map. */
+      uint64_t tiles_hash;                  /**< Identifies the tiles that were drawn. */
+      size_t bytes;                         /**< Size of the cell surfaces. */
+      std::unordered_map<int, CachedCell>
+          cells;                            /**< The drawn cells. */
+    };
+
+    static std::list<SavedCells> saved_cells;   /**< Saved cells, most recent first. */
+    static int max_saved_maps;              /**< Number of maps whose cells are saved. */
 
     Map& map;                               /**< The map. */
     int layer;                              /**< Layer of the map managed by this object. */
     std::vector<TileInfo> tiles;            /**< All tiles contained in this layer and candidates to
                                              * be optimized. This list is cleared after build() is called. */
     std::vector<bool> are_squares_animated; /**< Whether each 8x8 square of the map has animated tiles. */
+    uint64_t tiles_hash;                    /**< Identifies the non-animated tiles and their tileset. */
+    std::string built_tileset_id;           /**< Tileset of the map when the tiles were built. */
 
     // Handle the lazy drawing.
-    Grid<TileInfo> non_animated_tiles;      /**< All non-animated tiles. Stored in a grid so that
+    Grid<TileInfo, ArenaAllocator<TileInfo>>
+        non_animated_tiles;                 /**< All non-animated tiles. Stored in a grid so that
                                              * we can quickly find the ones to draw lazily later when the
                                              * camera moves. */
-    std::unordered_map<int, SurfacePtr>
+    std::unordered_map<int, CachedCell>
         optimized_tiles_surfaces;           /**< Cache of drawn non-animated tiles for each cell. */
+    uint64_t num_frames;                    /**< Number of calls to draw_on_map(). */
+    Point previous_camera_xy;               /**< Camera position at the previous frame. */
+    bool previous_camera_xy_known;          /**< Whether previous_camera_xy is set. */
+    std::vector<bool>
+        are_cells_using_map_tileset;        /**< Whether each cell has tiles of the map tileset. */
+    std::unordered_set<int> outdated_cells; /**< Cached cells to redraw because the tileset changed. */
+
+    // Occlusion.
+    std::vector<bool> are_squares_opaque;   /**< Whether each 8x8 square of the map is fully covered
+                                             * by opaque non-animated tiles, empty if not computed yet. */
+    bool opaque_squares_outdated;           /**< Whether are_squares_opaque must be computed again. */
+    std::vector<bool> are_cells_occluded;   /**< Whether each cell is hidden by opaque tiles of
+                                             * higher layers, empty if no cell is hidden. */
 
 };
 
@@ -51,6 +51,7 @@ class ParallaxScrollingTilePattern: public SimpleTilePattern {
 
     virtual bool is_animated() const override;
     virtual bool is_drawn_at_its_position() const override;
+    virtual bool get_mesh_quad(TileMesh::Quad& quad) const override;
 
     static constexpr int ratio = 2;  /**< Distance made by the viewport to move the tile pattern of 1 pixel. */
 
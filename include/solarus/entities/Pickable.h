@@ -84,6 +84,7 @@ class Pickable: public Entity {
     void notify_collision_with_stream(Stream& stream, int dx, int dy) override;
     void update() override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
 
   private:
 
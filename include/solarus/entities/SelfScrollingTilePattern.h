@@ -48,6 +48,7 @@ class SelfScrollingTilePattern: public SimpleTilePattern {
     ) const override;
 
     virtual bool is_animated() const override;
+    virtual bool get_mesh_quad(TileMesh::Quad& quad) const override;
 
 };
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SEPARATOR_REGIONS_H
+#define SOLARUS_SEPARATOR_REGIONS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include <vector>
+
+namespace Solarus {
+
+class Point;
+class Separator;
+
+/**
+ * \brief Separators of a map, indexed for the camera, and the partition of
+ * the map into rooms that they make.
+ *
+ * Separation lines are sorted by position so that the camera only looks
+ * at the ones crossing its area. The map is cut into a grid along all
+ * separation lines and separator ends; cells not separated by a
+ * separator are merged into rooms.
+ * Finding the room of a point is then a binary search on each axis.
+ */
+class SOLARUS_API SeparatorRegions {
+
+  public:
+
+    SeparatorRegions();
+
+    void build(const Size& map_size, const std::vector<const Separator*>& separators);
+
+    Rectangle apply_separators(const Rectangle& area) const;
+
+    int get_num_regions() const;
+    int get_region_index_at(const Point& xy) const;
+    void get_region_indices_in(const Rectangle& area, std::vector<int>& result) const;
+    Rectangle get_region(int index) const;
+
+  private:
+
+    /**
+     * \brief A separation line.
+     */
+    struct Line {
+      int position;     /**< X of a vertical line or Y of an horizontal one. */
+      int start;        /**< Where the separator starts on the other axis. */
+      int end;          /**< Where the separator ends on the other axis. */
+
+      bool operator<(const Line& other) const;
+    };
+
+    static std::vector<Line>::const_iterator first_line_after(
+        const std::vector<Line>& lines,
+        int position
+    );
+    void build_regions(const Size& map_size);
+    int get_cell_index(int i, int j) const;
+
+    std::vector<Line> vertical_lines;       /**< Vertical separation lines sorted by x. */
+    std::vector<Line> horizontal_lines;     /**< Horizontal separation lines sorted by y. */
+
+    std::vector<int> grid_xs;               /**< X coordinates of the grid lines, map limits included. */
+    std::vector<int> grid_ys;               /**< Y coordinates of the grid lines, map limits included. */
+    std::vector<int> cell_regions;          /**< Region of each cell of the grid, row by row. */
+    std::vector<Rectangle> regions;         /**< Bounding box of each region. */
+
+};
+
+}
+
+#endif
+
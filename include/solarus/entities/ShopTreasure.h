@@ -77,6 +77,7 @@ class ShopTreasure: public Entity {
 
     void update() override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
 
   private:
 
@@ -20,6 +20,8 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/entities/TilePattern.h"
+#include <memory>
+#include <vector>
 
 namespace Solarus {
 
@@ -43,11 +45,20 @@ class SimpleTilePattern: public TilePattern {
     ) const override;
 
     virtual bool is_animated() const override;
+    virtual bool get_mesh_quad(TileMesh::Quad& quad) const override;
+    virtual const std::vector<bool>* get_opaque_squares(const Tileset& tileset) const override;
 
   protected:
 
     Rectangle position_in_tileset; /**< position of the tile pattern in the tileset image */
 
+  private:
+
+    mutable std::weak_ptr<Surface>
+        opaque_squares_image;      /**< Tileset image opaque_squares were computed from. */
+    mutable std::vector<bool>
+        opaque_squares;            /**< Whether each 8x8 square of the pattern is opaque. */
+
 };
 
 }
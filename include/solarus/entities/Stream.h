@@ -54,6 +54,8 @@ class Stream: public Entity {
     void set_allow_attack(bool allow_attack);
     bool get_allow_item() const;
     void set_allow_item(bool allow_item);
+    bool is_in_field() const;
+    void set_in_field(bool in_field);
     virtual void notify_direction_changed() override;
 
     virtual bool is_obstacle_for(Entity& other) override;
@@ -69,6 +71,8 @@ class Stream: public Entity {
     bool allow_movement;          /**< Whether the player can move the hero in this stream. */
     bool allow_attack;            /**< Whether the player can use the sword in this stream. */
     bool allow_item;              /**< Whether the player can use equipment items in this stream. */
+    bool in_field;                /**< Whether this stream is baked in the stream field of the map
+                                   * instead of detecting entities. */
 
 };
 
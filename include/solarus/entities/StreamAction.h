@@ -54,6 +54,7 @@ class StreamAction {
 
     void recompute_movement();
     bool test_obstacles(int dx, int dy);
+    bool follow_stream_field(const Point& ground_point);
     bool has_reached_target() const;
 
     std::shared_ptr<Stream>
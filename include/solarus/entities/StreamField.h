@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_STREAM_FIELD_H
+#define SOLARUS_STREAM_FIELD_H
+
+#include "solarus/core/Common.h"
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Point;
+class Stream;
+
+/**
+ * \brief Non-blocking streams baked into a grid of 8x8 squares.
+ *
+ * For each layer, each square covered by a stream knows that stream,
+ * so that the stream under a point is found without collision tests.
+ * The direction and speed are still read from the stream itself.
+ *
+ * Only streams whose bounding box is aligned on the 8x8 grid can be
+ * added. When streams overlap, a square keeps the first one added.
+ */
+class SOLARUS_API StreamField {
+
+  public:
+
+    StreamField(int map_width8, int map_height8);
+
+    bool add_stream(Stream& stream);
+    void remove_stream(const Stream& stream);
+    void clear();
+    bool is_empty() const;
+
+    Stream* get_stream(int layer, const Point& xy) const;
+
+  private:
+
+    /**
+     * \brief Squares covered by a stream.
+     */
+    struct Footprint {
+      Stream* stream;
+      int layer;
+      int x8;
+      int y8;
+      int width8;
+      int height8;
+    };
+
+    void fill(const Footprint& footprint);
+
+    int map_width8;                       /**< Number of squares in a row. */
+    int map_height8;                      /**< Number of squares in a column. */
+    std::map<int, std::vector<Stream*>>
+        squares;                          /**< For each layer, stream of each
+                                           * square or nullptr. */
+    std::unordered_map<const Stream*, Footprint>
+        footprints;                       /**< Squares of each stream added. */
+
+};
+
+}
+
+#endif
+
@@ -51,6 +51,7 @@ class Teletransporter: public Entity {
 
     virtual EntityType get_type() const override;
     virtual void notify_creating() override;
+    virtual void update() override;
 
     const std::string& get_sound_id() const;
     void set_sound_id(const std::string& sound_id);
@@ -70,8 +71,16 @@ class Teletransporter: public Entity {
     ) override;
     void transport_hero(Hero& hero);
 
+    static int get_prefetch_distance();
+    static void set_prefetch_distance(int prefetch_distance);
+
   private:
 
+    void prefetch_destination_map();
+
+    static int prefetch_distance;         /**< Distance from the hero below which
+                                           * the destination map is preloaded (0 means never). */
+
     std::string sound_id;                 /**< Sound played when this teletransporter is used
                                            * (an empty string means no sound). */
     Transition::Style transition_style;   /**< Style of transition between the two maps. */
@@ -88,6 +97,8 @@ class Teletransporter: public Entity {
                                            * direction of destination_side). */
     bool transporting_hero;               /**< Whether the hero is currently being transported
                                            * by this teletransporter. */
+    bool destination_prefetched;          /**< Whether the destination map was already
+                                           * requested to be preloaded. */
 
 };
 
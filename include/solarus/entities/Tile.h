@@ -54,10 +54,13 @@ class Tile: public Entity {
     EntityType get_type() const override;
     bool is_drawn_at_its_position() const override;
     void built_in_draw(Camera& camera) override;
+    bool is_drawn_with_sprites_only() const override;
     void draw_on_surface(const SurfacePtr& dst_surface, const Point& viewport);
     void notify_tileset_changed() override;
+    bool has_tile_pattern() const;
     const TilePattern& get_tile_pattern() const;
     const std::string& get_tile_pattern_id() const;
+    const Tileset& get_tileset() const;
     bool is_animated() const;
 
   private:
@@ -21,6 +21,8 @@
 #include "solarus/core/Size.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include "solarus/graphics/TileMesh.h"
+#include <vector>
 
 namespace Solarus {
 
@@ -72,6 +74,9 @@ class TilePattern {
     ) const = 0;
     virtual bool is_animated() const;
     virtual bool is_drawn_at_its_position() const;
+    virtual bool get_mesh_quad(TileMesh::Quad& quad) const;
+    virtual bool get_frame_offset(Point& offset) const;
+    virtual const std::vector<bool>* get_opaque_squares(const Tileset& tileset) const;
 
   protected:
 
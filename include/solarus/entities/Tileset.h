@@ -48,6 +48,7 @@ class Tileset {
     bool is_loaded() const;
     void load();
     void unload();
+    void reload();
 
     const std::string& get_id() const;
     const Color& get_background_color() const;
@@ -19,6 +19,7 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/EnumInfo.h"
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/entities/BorderSet.h"
 #include "solarus/entities/Ground.h"
@@ -150,14 +151,21 @@ class SOLARUS_API TilesetData : public LuaData {
 
     virtual bool import_from_lua(lua_State* l) override;
     virtual bool export_to_lua(std::ostream& out) const override;
+    virtual bool import_from_binary(BinaryReader& reader) override;
+    virtual bool export_to_binary(BinaryWriter& writer) const override;
 
   private:
 
+    void update_memory_usage();
+
     Color background_color;       /**< Background color of the tileset. */
     std::map<std::string, TilePatternData>
         patterns;                 /**< The tile patterns indexed by their id. */
     std::map<std::string, BorderSet>
         border_sets;              /**< The border sets indexes by their id. */
+    MemoryUsage::Tracker memory_tracker{
+        MemoryUsage::Category::TILESET_DATA
+    };                            /**< Estimated memory of the parsed data. */
 
 };
 
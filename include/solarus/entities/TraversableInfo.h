@@ -18,6 +18,9 @@
 #define SOLARUS_TRAVERSABLE_INFO_H
 
 #include "solarus/lua/ScopedLuaRef.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
@@ -28,6 +31,10 @@ class LuaContext;
 /**
  * \brief Stores whether a custom entity can be traversed by or can traverse
  * other entities.
+ *
+ * A Lua test function declared as pure is assumed to always give the same
+ * result for the same entity during a tick: it is then called at most once
+ * per entity and per tick.
  */
 class TraversableInfo {
 
@@ -40,7 +47,8 @@ class TraversableInfo {
     );
     TraversableInfo(
         LuaContext& lua_context,
-        const ScopedLuaRef& traversable_test_ref
+        const ScopedLuaRef& traversable_test_ref,
+        bool pure = false
     );
 
     bool is_empty() const;
@@ -58,6 +66,12 @@ class TraversableInfo {
                                     * that decides, or LUA_REFNIL. */
     bool traversable;              /**< Traversable property (unused if
                                     * there is a Lua function). */
+    bool pure;                     /**< Whether results of the Lua function
+                                    * can be reused during a tick. */
+    mutable uint32_t cache_date;   /**< Simulated time of the cached results. */
+    mutable std::vector<std::pair<const Entity*, bool>>
+        cached_results;            /**< Results of the Lua function during the
+                                    * current tick if it is pure. */
 };
 
 }
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_WALKABILITY_GRID_H
+#define SOLARUS_WALKABILITY_GRID_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Entities;
+class Entity;
+class Rectangle;
+
+/**
+ * \brief Cache of the obstacles of the map terrain at 8x8 granularity.
+ *
+ * For each layer, the tiles ground is split into one bitmap per kind of
+ * ground, with one bit per 8x8 square.
+ * For each set of grounds considered as obstacles, the bitmaps of these
+ * grounds are merged on demand, so that testing a whole row of squares
+ * only takes a few word operations.
+ *
+ * Squares overlapped by dynamic entities that modify the ground
+ * (dynamic tiles, destructibles, custom entities...) are tracked
+ * incrementally when these entities move, and are reported as unknown:
+ * callers then have to do the full collision test on them.
+ *
+ * Squares overlapped by raised crystal blocks are tracked the same way,
+ * when blocks move or are raised or lowered.
+ */
+class SOLARUS_API WalkabilityGrid {
+
+  public:
+
+    /**
+     * \brief Result of a collision test with the grid.
+     */
+    enum class Result {
+      FREE,      /**< No obstacle in the terrain. */
+      OBSTACLE,  /**< The terrain is an obstacle. */
+      UNKNOWN    /**< A full collision test is needed. */
+    };
+
+    WalkabilityGrid(Entities& entities, int map_width8, int map_height8);
+
+    static uint32_t compute_ground_obstacles(const Entity& entity);
+
+    Result test_collision(
+        int layer,
+        const Rectangle& collision_box,
+        uint32_t ground_obstacles
+    );
+
+    bool may_overlap_raised_blocks(int layer, const Rectangle& rectangle) const;
+    bool may_overlap_ground_modifiers(int layer, const Rectangle& rectangle) const;
+
+    void notify_ground_modifier_changed(const Entity& entity);
+    void notify_entity_removed(const Entity& entity);
+    void notify_tiles_ground_changed();
+    uint32_t get_version() const;
+
+  private:
+
+    /**
+     * \brief Bitmap with one bit per 8x8 square, row by row.
+     *
+     * Each row starts on a new word.
+     */
+    using Bits = std::vector<uint64_t>;
+
+    /**
+     * \brief Squares where an entity modifies the ground.
+     */
+    struct Footprint {
+      int layer;
+      int x8;
+      int y8;
+      int width8;
+      int height8;
+
+      bool operator==(const Footprint& other) const;
+    };
+
+    /**
+     * \brief Squares of each kind of ground in the static tiles of a layer.
+     */
+    struct LayerGrounds {
+      int layer;
+      std::vector<Bits> ground_bits;   /**< Squares of each uniform ground,
+                                        * indexed by ground (empty if none). */
+      Bits diagonal_bits;              /**< Squares with a diagonal ground. */
+    };
+
+    /**
+     * \brief Obstacle squares of a layer for a set of obstacle grounds.
+     */
+    struct ObstacleBits {
+      int layer;
+      uint32_t ground_obstacles;
+      Bits bits;
+    };
+
+    const LayerGrounds& get_layer_grounds(int layer);
+    /**
+     * \brief Number of entities of some kind on each square of each layer.
+     */
+    struct SquareCounts {
+      std::map<int, std::vector<uint16_t>>
+          counts;                         /**< For each layer, number of
+                                           * entities on each square. */
+      std::map<int, Bits> bits;           /**< For each layer, squares with
+                                           * at least one entity. */
+      std::unordered_map<const Entity*, Footprint>
+          footprints;                     /**< Squares counted for each entity. */
+    };
+
+    const Bits& get_obstacle_bits(int layer, uint32_t ground_obstacles);
+    bool may_overlap(const SquareCounts& squares, int layer, const Rectangle& rectangle) const;
+    Footprint get_footprint(const Entity& entity, const Rectangle& box) const;
+    bool set_footprint(SquareCounts& squares, const Entity& entity, const Footprint& footprint);
+    bool remove_footprint(SquareCounts& squares, const Entity& entity);
+    void add_footprint(SquareCounts& squares, const Footprint& footprint, int delta);
+    void update_raised_block(const Entity& entity);
+
+    Entities& entities;                   /**< The entities of the map. */
+    int map_width8;                       /**< Number of squares in a row. */
+    int map_height8;                      /**< Number of squares in a column. */
+    int words_per_row;                    /**< Number of words in a row of bits. */
+    std::vector<LayerGrounds>
+        layer_grounds;                    /**< Ground bitmaps built so far. */
+    std::vector<ObstacleBits>
+        obstacle_bits;                    /**< Obstacle bitmaps built so far. */
+    SquareCounts ground_modifiers;        /**< Squares of dynamic entities
+                                           * that modify the ground. */
+    SquareCounts raised_blocks;           /**< Squares of raised crystal blocks. */
+    uint32_t version;                     /**< Incremented when ground
+                                           * modifiers change. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ANIMATION_LOD_H
+#define SOLARUS_ANIMATION_LOD_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/EnumInfo.h"
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief How the animation of a sprite advances while it is off-screen.
+ */
+enum class AnimationLod {
+  DEFAULT,         /**< Policy of the entity type of the owner. */
+  FULL,            /**< Frames change on time even when not visible. */
+  LAZY             /**< Off-screen frames catch up when visible again. */
+};
+
+template <>
+struct SOLARUS_API EnumInfoTraits<AnimationLod> {
+  static const std::string pretty_name;
+
+  static const EnumInfo<AnimationLod>::names_type names;
+};
+
+}
+
+#endif
+
@@ -136,6 +136,92 @@ void main() {
   return source;
 }
 
+/**
+ * \brief Gets the fragment shader program source that draws indexed images.
+ *
+ * The red channel of each pixel of the image is an index in the palette
+ * texture \c sol_palette, whose width is \c sol_palette_size.
+ * The index of the first color is 0. Pixels should be fully opaque or
+ * fully transparent.
+ */
+inline const std::string& get_palette_fragment_source() {
+
+static const std::string source = get_default_fragment_compat_header() +
+R"(
+uniform sampler2D sol_texture;
+uniform sampler2D sol_palette;
+uniform float sol_palette_size;
+uniform bool sol_vcolor_only;
+uniform bool sol_alpha_mult;
+COMPAT_VARYING vec2 sol_vtex_coord;
+COMPAT_VARYING vec4 sol_vcolor;
+
+void main() {
+    if (!sol_vcolor_only) {
+        vec4 index_color = COMPAT_TEXTURE(sol_texture, sol_vtex_coord);
+        float index = floor(index_color.r * 255.0 + 0.5);
+        vec4 tex_color = COMPAT_TEXTURE(sol_palette, vec2((index + 0.5) / sol_palette_size, 0.5));
+        FragColor = tex_color * index_color.a * sol_vcolor;
+        if (sol_alpha_mult) {
+            FragColor.rgb *= sol_vcolor.a; //Premultiply by opacity too
+        }
+    } else {
+        FragColor = sol_vcolor;
+    }
+}
+)";
+  return source;
+}
+
+/**
+ * \brief Gets the fragment shader program source of the Scale2x algorithm.
+ *
+ * It gives the same result as Scale2xFilter when the output is twice
+ * as large as \c sol_input_size.
+ */
+inline const std::string& get_scale2x_fragment_source() {
+
+static const std::string source = get_default_fragment_compat_header() +
+R"(
+uniform sampler2D sol_texture;
+uniform vec2 sol_input_size;
+COMPAT_VARYING vec2 sol_vtex_coord;
+COMPAT_VARYING vec4 sol_vcolor;
+
+void main() {
+    vec2 texel = 1.0 / sol_input_size;
+    vec2 pixel = sol_vtex_coord * sol_input_size;
+    vec2 center = (floor(pixel) + 0.5) * texel;
+    bool left = fract(pixel.x) < 0.5;
+    bool top = fract(pixel.y) < 0.5;
+
+    // Neighbors outside the image are replaced by the pixel itself.
+    vec2 first = 0.5 * texel;
+    vec2 last = 1.0 - 0.5 * texel;
+    vec4 b = COMPAT_TEXTURE(sol_texture, clamp(center - vec2(0.0, texel.y), first, last));
+    vec4 d = COMPAT_TEXTURE(sol_texture, clamp(center - vec2(texel.x, 0.0), first, last));
+    vec4 e = COMPAT_TEXTURE(sol_texture, center);
+    vec4 f = COMPAT_TEXTURE(sol_texture, clamp(center + vec2(texel.x, 0.0), first, last));
+    vec4 h = COMPAT_TEXTURE(sol_texture, clamp(center + vec2(0.0, texel.y), first, last));
+
+    // Neighbors on the side of this quarter of the pixel, and opposite ones.
+    vec4 horizontal = left ? d : f;
+    vec4 vertical = top ? b : h;
+    vec4 opposite_horizontal = left ? f : d;
+    vec4 opposite_vertical = top ? h : b;
+
+    vec4 color = e;
+    if (horizontal == vertical &&
+        vertical != opposite_horizontal &&
+        horizontal != opposite_vertical) {
+        color = horizontal;
+    }
+    FragColor = color * sol_vcolor;
+}
+)";
+  return source;
+}
+
 }  // namespace DefaultShaders
 
 }  // namespace Solarus
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_DRAW_LIST_H
+#define SOLARUS_DRAW_LIST_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Scale.h"
+#include "solarus/graphics/BlendMode.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/DrawRecording.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include "solarus/lua/ExportableToLua.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class Shader;
+
+/**
+ * \brief Surfaces drawn together at the same place every frame.
+ *
+ * The surfaces of the list are recorded by the renderer the first time the
+ * list is drawn, and the recording is then replayed at each draw without
+ * recomputing the vertices of each surface.
+ * The list is recorded again when it is drawn on another surface, or when
+ * the position, the origin, the blend mode, the opacity, the rotation,
+ * the scale, the color modulation or the shader of one of its surfaces
+ * has changed.
+ * The pixels of the surfaces are not part of the recording: modifying them
+ * does not require to record again.
+ *
+ * Surfaces with a transition are never recorded, and neither are lists drawn
+ * by renderers that do not support recordings:
+ * their surfaces are then drawn one by one.
+ */
+class SOLARUS_API DrawList: public ExportableToLua {
+
+  public:
+
+    DrawList();
+
+    void add_surface(const SurfacePtr& surface, const Point& position);
+    void clear();
+    int get_num_surfaces() const;
+
+    void draw(const SurfacePtr& dst_surface, const Point& dst_position);
+
+    const std::string& get_lua_type_name() const override;
+
+  private:
+
+    /**
+     * \brief Properties of a surface that change how it is drawn.
+     */
+    struct DrawState {
+      Point xy;                   /**< Position of the surface. */
+      Point origin;               /**< Origin of its transformations. */
+      BlendMode blend_mode;       /**< Blend mode. */
+      uint8_t opacity;            /**< Opacity. */
+      double rotation;            /**< Rotation. */
+      Scale scale;                /**< Scale. */
+      Color color;                /**< Color modulation. */
+      const Shader* shader;       /**< Shader or nullptr. */
+
+      bool operator==(const DrawState& other) const;
+    };
+
+    /**
+     * \brief A surface of the list.
+     */
+    struct Entry {
+      SurfacePtr surface;         /**< The surface. */
+      Point position;             /**< Where to draw it, relative to the list. */
+      DrawState state;            /**< How it was drawn in the recording. */
+    };
+
+    static bool get_draw_state(Surface& surface, DrawState& state);
+    bool is_recording_up_to_date(const Surface& dst_surface) const;
+    void record(const SurfacePtr& dst_surface);
+    void draw_surfaces(const SurfacePtr& dst_surface, const Point& dst_position) const;
+
+    std::vector<Entry> entries;   /**< Surfaces in drawing order. */
+    DrawRecordingPtr recording;   /**< Recorded draws of the surfaces or nullptr. */
+    std::weak_ptr<Surface>
+        recording_dst;            /**< Destination of the recording. */
+
+};
+
+}
+
+#endif
+
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "solarus/core/Point.h"
+
+#include <memory>
+
+namespace Solarus {
+
+class Surface;
+
+/**
+ * @brief Draws of surfaces recorded once by the rendering device
+ *
+ * A recording stores the vertices of the surfaces drawn on a destination
+ * between Renderer::begin_recording() and Renderer::end_recording(), so that
+ * they can be drawn again each frame without recomputing the transform and
+ * the corners of every quad.
+ *
+ * A recording only refers to the textures of the surfaces drawn: the owner
+ * must keep these surfaces alive and record again when one of them is
+ * drawn differently.
+ */
+class DrawRecording
+{
+public:
+  virtual ~DrawRecording() = default;
+
+  /**
+   * @brief draw the recorded surfaces again
+   * @param dst_surface the surface that was the destination of the recording
+   * @param offset translation to add to the recorded positions
+   * @return false if the recording is outdated: nothing is drawn then
+   */
+  virtual bool draw(Surface& dst_surface, const Point& offset) = 0;
+};
+
+using DrawRecordingPtr = std::unique_ptr<DrawRecording>;
+
+}
@@ -137,6 +137,9 @@ class Drawable: public ExportableToLua {
 
     Point get_full_origin() const;
 
+    int get_lua_index() const;
+    void set_lua_index(int lua_index);
+
     virtual Rectangle get_region() const = 0;
   protected:
     Drawable();
@@ -160,6 +163,8 @@ class Drawable: public ExportableToLua {
     Scale scale;                  /**< Scale of the object around transform_origin*/
     Point transformation_origin;       /**< pivot for the transformations (rot,scale) of the object*/
     Color color_mod = Color::white;
+    int lua_index = -1;           /**< Position in the drawables updated by Lua,
+                                   * or -1 if it was not created by Lua. */
 };
 
 }
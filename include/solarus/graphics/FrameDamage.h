@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FRAME_DAMAGE_H
+#define SOLARUS_FRAME_DAMAGE_H
+
+#include "solarus/core/Common.h"
+
+namespace Solarus {
+
+/**
+ * \brief Tracks whether the next frame can differ from the last one drawn.
+ *
+ * Anything that changes what is visible notifies a damage:
+ * sprite frames, entity positions and states, transitions, movements
+ * of drawables, tile animations, input events and any Lua code
+ * run outside drawing.
+ * When lazy redraw is enabled, the main loop skips drawing and presenting
+ * frames without damage and the window keeps showing the last one.
+ *
+ * Lua code run while drawing does not damage the frame: on_draw()
+ * callbacks are expected to only depend on state changed
+ * outside drawing.
+ */
+namespace FrameDamage {
+
+SOLARUS_API bool is_lazy_redraw_enabled();
+SOLARUS_API void set_lazy_redraw_enabled(bool enabled);
+
+SOLARUS_API void notify();
+SOLARUS_API void notify_lua_call();
+SOLARUS_API bool is_damaged();
+
+SOLARUS_API void start_drawing();
+SOLARUS_API void finish_drawing();
+
+}
+
+}
+
+#endif
+
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FRAME_RECORDER_H
+#define SOLARUS_FRAME_RECORDER_H
+
+#include "solarus/core/Common.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Solarus {
+
+class Surface;
+
+/**
+ * \brief Records the frames drawn by the engine to a video or to images.
+ *
+ * Each frame is read back from the quest surface asynchronously by the
+ * renderer and handed to a background thread that encodes it, so that
+ * recording costs the main thread almost nothing.
+ *
+ * The target decides the output:
+ * - a name ending with ".png" gives a sequence of PNG images, numbered
+ *   after the name ("shot.png" gives "shot_000000.png", ...),
+ * - a name starting with "|" is a command receiving a Y4M stream
+ *   on its standard input, for example "|ffmpeg -i - video.mp4",
+ * - any other name is a Y4M video file.
+ *
+ * The output has a constant frame rate: frames not redrawn by the engine
+ * are repeated, and frames drawn faster than the frame rate are skipped.
+ * If the encoder cannot keep up, new frames are dropped.
+ */
+class SOLARUS_API FrameRecorder {
+
+  public:
+
+    static constexpr int default_frame_rate = 60;  /**< Frames per second of the output. */
+
+    static bool start(const std::string& target, int frame_rate);
+    static void stop();
+    static bool is_recording();
+
+    static void capture(const Surface& quest_surface);
+
+  private:
+
+    /**
+     * \brief Kind of output of a recording.
+     */
+    enum class Output {
+      Y4M_FILE,       /**< Y4M video file. */
+      Y4M_PIPE,       /**< Y4M stream to the standard input of a command. */
+      PNG_SEQUENCE    /**< One PNG file per frame. */
+    };
+
+    /**
+     * \brief A frame read back from the renderer.
+     */
+    struct Frame {
+      uint64_t date;        /**< Real time of the capture in microseconds. */
+      int width;            /**< Width in pixels. */
+      int height;           /**< Height in pixels. */
+      std::string pixels;   /**< RGBA bytes, rows from top to bottom. */
+    };
+
+    static void push_frame(uint64_t session, Frame&& frame);
+    static void run();
+    static void encode(const Frame& frame);
+    static bool write_y4m(const Frame& frame);
+    static bool write_png(const Frame& frame);
+
+    static constexpr size_t max_queued_frames = 16;  /**< Frames waiting for the encoder
+                                                      * beyond which new ones are dropped. */
+
+    static std::thread worker;                      /**< Thread encoding the frames. */
+    static std::mutex mutex;                        /**< Protects the queue and stopping. */
+    static std::condition_variable frames_changed;  /**< Wakes up the worker. */
+    static std::deque<Frame> frames;                /**< Frames waiting to be encoded. */
+    static bool stopping;                           /**< Asks the worker to stop once idle. */
+    static uint64_t num_dropped_frames;             /**< Frames dropped because the queue was full. */
+
+    // Only used by the main thread.
+    static bool recording;                          /**< Whether a recording is in progress. */
+    static uint64_t session;                        /**< Identifies the current recording,
+                                                     * to ignore reads of a previous one. */
+
+    // Only used by the worker while recording.
+    static Output output;                           /**< Kind of output. */
+    static std::string target;                      /**< File name, command or file name pattern. */
+    static int frame_rate;                          /**< Frames per second of the output. */
+    static std::FILE* file;                         /**< Y4M file or pipe. */
+    static uint64_t first_date;                     /**< Date of the first frame. */
+    static uint64_t num_written_frames;             /**< Frames written so far, repeated ones included. */
+    static Frame last_frame;                        /**< Last frame written, repeated if needed. */
+    static bool failed;                             /**< Whether writing failed, to stop writing. */
+};
+
+}
+
+#endif
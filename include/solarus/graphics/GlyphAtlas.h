@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_GLYPH_ATLAS_H
+#define SOLARUS_GLYPH_ATLAS_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include "solarus/graphics/TextSurface.h"
+#include <cstdint>
+#include <unordered_map>
+#include <SDL_ttf.h>
+
+namespace Solarus {
+
+/**
+ * \brief Glyphs of an outline font rasterized once into a shared surface.
+ *
+ * Each glyph is rendered with SDL_ttf the first time it is needed and
+ * copied into the atlas surface, packed in rows. Text surfaces then draw
+ * regions of this surface instead of rendering their whole text again,
+ * so changing a text only rasterizes the glyphs never seen before.
+ *
+ * An atlas is specific to a font, a size, a hinting and kerning setting,
+ * a rendering mode and a color.
+ */
+class GlyphAtlas {
+
+  public:
+
+    /**
+     * \brief A glyph of the atlas.
+     */
+    struct Glyph {
+      Rectangle region;     /**< Region of the atlas surface, empty for blank glyphs. */
+      int min_x;            /**< Horizontal bearing of the glyph. */
+      int max_x;            /**< Right edge of the glyph from its origin. */
+      int advance;          /**< Distance to the origin of the next glyph. */
+    };
+
+    GlyphAtlas(
+        TTF_Font& font,
+        TextSurface::RenderingMode rendering_mode,
+        const Color& color
+    );
+
+    TTF_Font& get_font() const;
+    const SurfacePtr& get_surface() const;
+    const Glyph* get_glyph(uint16_t code_point);
+    int get_kerning(uint16_t previous_code_point, uint16_t code_point) const;
+
+    static constexpr int width = 512;             /**< Width of atlas surfaces. */
+    static constexpr int initial_height = 64;     /**< Height of new atlas surfaces. */
+    static constexpr int max_height = 2048;       /**< Maximum height of atlas surfaces. */
+
+  private:
+
+    bool add_glyph(uint16_t code_point, Glyph& glyph);
+    bool reserve(const Size& size, Point& position);
+
+    TTF_Font& font;                               /**< The font to render. */
+    TextSurface::RenderingMode rendering_mode;    /**< How glyphs are rendered. */
+    Color color;                                  /**< Color of the glyphs. */
+    SurfacePtr surface;                           /**< Surface with all glyphs rendered so far. */
+    std::unordered_map<uint16_t, Glyph> glyphs;   /**< Glyphs rendered so far or known as missing. */
+    Point row_position;                           /**< Where the next glyph of the current row goes. */
+    int row_height;                               /**< Height of the tallest glyph of the current row. */
+
+};
+
+}
+
+#endif
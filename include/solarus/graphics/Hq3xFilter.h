@@ -26,20 +26,26 @@ namespace Solarus {
 /**
  * \brief Wrapper to the hq3x algorithm.
  */
-class Hq3xFilter: public SoftwarePixelFilter {
+class SOLARUS_API Hq3xFilter: public SoftwarePixelFilter {
 
   public:
 
     Hq3xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int num_rows
     ) const override;
 
+  protected:
+
+    virtual void prepare_filter() const override;
+
 };
 
 }
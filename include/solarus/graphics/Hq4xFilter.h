@@ -26,22 +26,28 @@ namespace Solarus {
 /**
  * \brief Wrapper to the hq4x algorithm.
  */
-class Hq4xFilter: public SoftwarePixelFilter {
+class SOLARUS_API Hq4xFilter: public SoftwarePixelFilter {
 
   public:
 
     Hq4xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int num_rows
     ) const override;
 
     static void initialize_hqx();
 
+  protected:
+
+    virtual void prepare_filter() const override;
+
 };
 
 }
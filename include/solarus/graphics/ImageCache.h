@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_IMAGE_CACHE_H
+#define SOLARUS_IMAGE_CACHE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/graphics/SurfaceImpl.h"
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * \brief Textures of the image files loaded, shared by all surfaces.
+ *
+ * An image is referenced while a surface, a sprite or a tileset uses its
+ * texture. Unreferenced images stay in the cache in case they are needed
+ * again, until the video or main memory they take exceeds the budget:
+ * the least recently used ones are then evicted.
+ *
+ * The budgets are checked when an image is added and when the map
+ * changes. A budget of zero means no limit.
+ */
+namespace ImageCache {
+
+/**
+ * \brief Statistics of the cache.
+ */
+struct Stats {
+  int64_t hits = 0;            /**< Images found in the cache. */
+  int64_t misses = 0;          /**< Images that had to be loaded. */
+  int64_t evictions = 0;       /**< Unreferenced images removed. */
+  int num_images = 0;          /**< Images in the cache. */
+  int num_unreferenced = 0;    /**< Images only kept by the cache. */
+  int64_t vram_bytes = 0;      /**< Video memory taken by the images. */
+  int64_t ram_bytes = 0;       /**< Main memory taken by software copies. */
+  int64_t vram_budget = 0;     /**< Maximum video memory, or 0. */
+  int64_t ram_budget = 0;      /**< Maximum main memory, or 0. */
+};
+
+SOLARUS_API SurfaceImplPtr get(const std::string& file_name);
+SOLARUS_API void add(const std::string& file_name, const SurfaceImplPtr& texture);
+SOLARUS_API bool has(const std::string& file_name);
+SOLARUS_API void remove(const std::string& file_name);
+SOLARUS_API void trim();
+SOLARUS_API void clear();
+
+SOLARUS_API void set_budgets(int64_t vram_budget, int64_t ram_budget);
+SOLARUS_API Stats get_stats();
+
+}
+
+}
+
+#endif
+
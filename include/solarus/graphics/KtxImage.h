@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_KTX_IMAGE_H
+#define SOLARUS_KTX_IMAGE_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A GPU-compressed image read from a KTX2 file.
+ *
+ * Quests may provide precompressed versions of their images next to the
+ * PNG files, with the same name and the .ktx2 extension. They are used
+ * instead of the PNG when the renderer supports their format.
+ *
+ * Only the first mipmap level of 2D images with block-compressed formats
+ * is read. Supercompressed files (Basis Universal, Zstandard) are not
+ * supported: they must be transcoded offline.
+ */
+class SOLARUS_API KtxImage {
+
+  public:
+
+    /**
+     * \brief Vulkan formats supported, as stored in KTX2 files.
+     */
+    enum Format : uint32_t {
+      FORMAT_UNDEFINED = 0,
+      FORMAT_BC1_RGBA = 133,    /**< VK_FORMAT_BC1_RGBA_UNORM_BLOCK (DXT1). */
+      FORMAT_BC3 = 137,         /**< VK_FORMAT_BC3_UNORM_BLOCK (DXT5). */
+      FORMAT_BC7 = 145,         /**< VK_FORMAT_BC7_UNORM_BLOCK. */
+      FORMAT_ETC2_RGBA = 151,   /**< VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK. */
+      FORMAT_ASTC_4x4 = 157     /**< VK_FORMAT_ASTC_4x4_UNORM_BLOCK. */
+    };
+
+    KtxImage();
+
+    bool load(const void* data, size_t size);
+
+    Format get_format() const;
+    int get_width() const;
+    int get_height() const;
+    const std::vector<uint8_t>& get_data() const;
+
+    static std::string get_file_name(const std::string& image_file_name);
+    static size_t get_block_size(Format format);
+    static std::string get_format_name(Format format);
+
+  private:
+
+    Format format;                /**< Compression format of the pixels. */
+    int width;                    /**< Width in pixels. */
+    int height;                   /**< Height in pixels. */
+    std::vector<uint8_t> data;    /**< Compressed blocks of the first level. */
+};
+
+}
+
+#endif
+
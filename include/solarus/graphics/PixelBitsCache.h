@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PIXEL_BITS_CACHE_H
+#define SOLARUS_PIXEL_BITS_CACHE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/PixelBits.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/SurfaceImpl.h"
+#include <map>
+#include <memory>
+#include <tuple>
+
+namespace Solarus {
+
+/**
+ * \brief Collision masks of image regions, shared by all sprites.
+ *
+ * Several animation sets often use the same image, and all sprites of an
+ * animation set use the same frames. Instead of computing the pixel bits
+ * of each frame for each of them, they are computed once per image and
+ * frame rectangle, the first time they are needed.
+ *
+ * The cache only keeps weak references: a mask is freed when no sprite
+ * direction uses it anymore.
+ * Masks are read from the pixels kept on the CPU side, so images loaded
+ * from files need no read-back from the GPU.
+ *
+ * This class must only be used from the main thread.
+ */
+class PixelBitsCache {
+
+  public:
+
+    static std::shared_ptr<const PixelBits> get(
+        const SurfaceImplPtr& image,
+        const Rectangle& frame
+    );
+
+  private:
+
+    using Key = std::tuple<const SurfaceImpl*, int, int, int, int>;
+
+    /**
+     * \brief A mask of the cache.
+     */
+    struct Entry {
+      std::weak_ptr<SurfaceImpl> image;       /**< The image, to detect
+                                               * addresses reused by a new one. */
+      std::weak_ptr<const PixelBits> bits;    /**< The mask if still used. */
+    };
+
+    static void remove_expired();
+
+    static std::map<Key, Entry> entries;      /**< Masks by image and frame. */
+    static size_t max_entries;                /**< Size above which expired
+                                               * entries are removed. */
+
+};
+
+}
+
+#endif
+
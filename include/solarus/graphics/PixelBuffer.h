@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PIXEL_BUFFER_H
+#define SOLARUS_PIXEL_BUFFER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include "solarus/lua/ExportableToLua.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class Color;
+class Surface;
+
+/**
+ * \brief A mutable rectangle of RGBA pixels in main memory.
+ *
+ * Pixels are stored row after row, 4 bytes per pixel in the order
+ * red, green, blue, alpha, like the buffers of Surface::get_pixels().
+ * Scripts can modify them directly without intermediate strings,
+ * and then upload the modified region to a surface.
+ *
+ * Modifications made by methods of this class are accumulated in a
+ * dirty region. Code writing pixels directly through get_data()
+ * must add the modified region with add_dirty_region().
+ */
+class SOLARUS_API PixelBuffer: public ExportableToLua {
+
+  public:
+
+    PixelBuffer(int width, int height);
+
+    int get_width() const;
+    int get_height() const;
+    Size get_size() const;
+    uint8_t* get_data();
+    const uint8_t* get_data() const;
+    int get_pitch() const;
+
+    bool contains(int x, int y) const;
+    Color get_pixel(int x, int y) const;
+    void set_pixel(int x, int y, const Color& color);
+    void fill(const Color& color);
+    void fill(const Color& color, const Rectangle& where);
+    void blit(const PixelBuffer& src, const Rectangle& src_region, const Point& dst_position);
+
+    void read_from_surface(const Surface& surface, const Point& src_position);
+    void upload_to_surface(Surface& surface, const Rectangle& src_region, const Point& dst_position) const;
+
+    const Rectangle& get_dirty_region() const;
+    void add_dirty_region(const Rectangle& region);
+    void clear_dirty_region();
+
+    const std::string& get_lua_type_name() const override;
+
+  private:
+
+    Rectangle clip(const Rectangle& region) const;
+
+    int width;                    /**< Width in pixels. */
+    int height;                   /**< Height in pixels. */
+    std::vector<uint8_t> pixels;  /**< RGBA pixels, row after row. */
+    Rectangle dirty_region;       /**< Region modified since the last
+                                   * clear_dirty_region(), or an empty rectangle. */
+
+};
+
+}
+
+#endif
+
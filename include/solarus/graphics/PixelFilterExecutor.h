@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PIXEL_FILTER_EXECUTOR_H
+#define SOLARUS_PIXEL_FILTER_EXECUTOR_H
+
+#include "solarus/core/Common.h"
+#include <functional>
+
+namespace Solarus {
+
+/**
+ * \brief Runs software pixel filters on several threads.
+ *
+ * The rows of the source image are split into bands of consecutive rows,
+ * and each band is filtered by a FRAME job of the JobSystem.
+ * The calling thread filters a band too.
+ *
+ * The source image is only read, so a band can read the rows of its
+ * neighbours. Each band only writes the destination rows of its own
+ * source rows.
+ *
+ * The number of bands is set with the -filter-threads=N command-line
+ * option. 0 (the default) uses the number of cores, up to 4.
+ * There are never more bands than job system workers plus one.
+ * Filters can only be run from the main thread.
+ *
+ * The executor also runs other loops whose iterations are independent,
+ * like the layers of a map being loaded: rows are then any kind of items.
+ */
+class SOLARUS_API PixelFilterExecutor {
+
+  public:
+
+    /**
+     * \brief Filters some consecutive rows of the source image.
+     * \param first_row Index of the first row to filter.
+     * \param num_rows Number of rows to filter.
+     */
+    using BandFunction = std::function<void(int first_row, int num_rows)>;
+
+    static void run(int num_rows, const BandFunction& band_function);
+    static void run(int num_rows, int min_rows_per_job_band, const BandFunction& band_function);
+
+    static int get_num_threads();
+    static void set_num_threads(int num_threads);
+
+    static constexpr int
+        min_rows_per_band = 16;    /**< Smaller images are split in fewer bands. */
+
+};
+
+}
+
+#endif
+
@@ -1,10 +1,17 @@
 #pragma once
+#include <functional>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 #include <solarus/graphics/SurfaceImpl.h>
 #include <solarus/graphics/DrawProxies.h>
 #include <solarus/graphics/SDLPtrs.h>
 #include <solarus/graphics/Color.h>
+#include <solarus/graphics/DrawRecording.h>
 #include <solarus/graphics/Drawable.h>
+#include <solarus/graphics/KtxImage.h>
+#include <solarus/graphics/TileMesh.h>
 
 namespace Solarus {
 
@@ -33,6 +40,33 @@ public:
    */
   virtual SurfaceImplPtr create_texture(SDL_Surface_UniquePtr&& surface) = 0;
 
+  /**
+   * @brief create a read-only texture from a SDL_Surface
+   *
+   * The renderer may store it together with other images to draw them in
+   * fewer batches. Such a texture is moved to its own storage the first time
+   * it is drawn on or its pixels are modified.
+   *
+   * @param surface the surface
+   * @return a texture
+   */
+  virtual SurfaceImplPtr create_packed_texture(SDL_Surface_UniquePtr&& surface) {
+    return create_texture(std::move(surface));
+  }
+
+  /**
+   * @brief create a read-only texture from GPU-compressed pixels
+   *
+   * Renderers that do not support the format of the image return nullptr:
+   * the uncompressed image file is then used.
+   *
+   * @param image the compressed image
+   * @return the texture, or nullptr
+   */
+  virtual SurfaceImplPtr create_compressed_texture(const KtxImage& /* image */) {
+    return nullptr;
+  }
+
   /**
    * @brief Create a special surface impl that represent the screen
    * @param window the window
@@ -58,6 +92,40 @@ public:
    */
   virtual ShaderPtr create_shader(const std::string& vertex_source, const std::string& fragment_source, double scaling_factor) = 0;
 
+  /**
+   * @brief create a mesh of tiles that can be drawn in one call
+   *
+   * Renderers that do not support tile meshes return nullptr: tiles are then
+   * drawn one by one.
+   *
+   * @param image the image of the tiles
+   * @param quads the tiles, at most TileMesh::max_quads
+   * @return the mesh, or nullptr
+   */
+  virtual TileMeshPtr create_tile_mesh(const SurfacePtr& /* image */, const std::vector<TileMesh::Quad>& /* quads */) {
+    return nullptr;
+  }
+
+  /**
+   * @brief start recording the draws made on a surface
+   *
+   * Until end_recording(), surfaces drawn on dst are not drawn but stored in
+   * the recording returned. Renderers that do not support recordings return
+   * nullptr: surfaces are then drawn one by one every time.
+   *
+   * @param dst the destination surface
+   * @return the recording, or nullptr
+   */
+  virtual DrawRecordingPtr begin_recording(SurfaceImpl& /* dst */) {
+    return nullptr;
+  }
+
+  /**
+   * @brief stop the recording started by begin_recording()
+   */
+  virtual void end_recording() {
+  }
+
 
   /**
    * @brief draw a surface on another
@@ -82,6 +150,16 @@ public:
    */
   virtual void fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode = BlendMode::BLEND) = 0;
 
+  /**
+   * @brief draw a one pixel wide line
+   * @param dst surface to draw on
+   * @param color color of the line
+   * @param from first pixel of the line
+   * @param to last pixel of the line
+   * @param mode mode to use when blitting color
+   */
+  virtual void draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode = BlendMode::BLEND) = 0;
+
   /**
    * @brief get this renderer name
    * @return the name
@@ -100,6 +178,22 @@ public:
    */
   virtual void present(SDL_Window* window) = 0;
 
+  /**
+   * @brief copy a render target to the whole window surface with nearest
+   * neighbour scaling, without drawing it
+   *
+   * Fast path of Video::render() for integer scales without shader.
+   *
+   * @param window the window surface
+   * @param src the render target to copy
+   * @return false if this renderer has no such fast path: nothing is done then
+   */
+  virtual bool blit_to_window(SurfaceImpl& window, const SurfaceImpl& src) {
+    (void) window;
+    (void) src;
+    return false;
+  }
+
   /**
    * @brief event called when the window is resized
    * @param viewport the region of the window that should be the renderer output
@@ -132,7 +226,89 @@ public:
   virtual bool needs_window_workaround() const {
     return false;
   }
+
+  /**
+   * @brief Statistics about the commands sent to the graphics backend
+   * during one frame
+   */
+  struct FrameStats {
+    int draw_calls = 0;     /**< Number of draw calls issued. */
+    int buffer_flushes = 0; /**< Number of batches interrupted because the
+                             * sprite buffer was full rather than because
+                             * the state changed. */
+    int sprites = 0;        /**< Number of sprites drawn. */
+    int texture_uploads = 0; /**< Number of pixel uploads to textures. */
+  };
+
+  /**
+   * @brief get the statistics of the last presented frame
+   * @return the statistics, or zeros if this renderer does not count them
+   */
+  virtual FrameStats get_last_frame_stats() const {
+    return FrameStats();
+  }
+
+  /**
+   * @brief start measuring the GPU time of the commands that follow
+   *
+   * Measurements are asynchronous: their result is available with
+   * get_gpu_time() once the GPU has executed them, a few frames later.
+   *
+   * @return false if no measurement was started, because this renderer
+   * cannot measure GPU time or too many measurements are in progress
+   */
+  virtual bool begin_gpu_timer() {
+    return false;
+  }
+
+  /**
+   * @brief stop the measurement started by begin_gpu_timer()
+   */
+  virtual void end_gpu_timer() {
+  }
+
+  /**
+   * @brief get the result of the last finished GPU time measurement
+   * @return the GPU time in milliseconds, or a negative value if unknown
+   */
+  virtual double get_gpu_time() const {
+    return -1.0;
+  }
+
+  /**
+   * @brief Function receiving the pixels of a surface, in the format of
+   * SurfaceImpl::get_pixels()
+   */
+  using PixelsCallback = std::function<void(const std::string& pixels)>;
+
+  /**
+   * @brief read the pixels of a surface without stalling the current frame
+   *
+   * The callback is called by a later update_pixel_reads(), once the pixels
+   * are available. By default, the pixels are read synchronously then.
+   *
+   * @param surf the surface to read
+   * @param callback function receiving the pixels
+   */
+  virtual void read_pixels_async(const SurfaceImplPtr& surf, const PixelsCallback& callback);
+
+  /**
+   * @brief call the callbacks of asynchronous pixel reads that are complete
+   *
+   * Called once per simulation update.
+   */
+  virtual void update_pixel_reads();
+
+  /**
+   * @brief forget the asynchronous pixel reads in progress without calling
+   * their callbacks
+   */
+  virtual void cancel_pixel_reads();
+
   virtual ~Renderer();
+private:
+  std::vector<std::pair<SurfaceImplPtr, PixelsCallback>>
+      pending_pixel_reads;  /**< Reads to do at the next update. */
 };
 
 using RendererPtr = std::unique_ptr<Renderer>;
@@ -20,6 +20,7 @@
 #include "solarus/core/Common.h"
 #include "solarus/graphics/SoftwarePixelFilter.h"
 #include <cstdint>
+#include <string>
 
 namespace Solarus {
 
@@ -28,19 +29,22 @@ namespace Solarus {
  *
  * See http://scale2x.sourceforge.net/algorithm.html
  */
-class Scale2xFilter: public SoftwarePixelFilter {
+class SOLARUS_API Scale2xFilter: public SoftwarePixelFilter {
 
   public:
 
     Scale2xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int num_rows
     ) const override;
+    virtual std::string get_fragment_shader_source() const override;
 
 };
 
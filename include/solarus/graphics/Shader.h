@@ -30,6 +30,7 @@
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace Solarus {
 
@@ -66,19 +67,31 @@ class SOLARUS_API Shader : public DrawProxy, public ExportableToLua {
     double get_scaling_factor() const;
     void set_scaling_factor(double scaling_factor);
 
-    virtual void set_uniform_1b(
-        const std::string& uniform_name, bool value) = 0;
-    virtual void set_uniform_1i(
-        const std::string& uniform_name, int value) = 0;
-    virtual void set_uniform_1f(
-        const std::string& uniform_name, float value) = 0;
-    virtual void set_uniform_2f(
-        const std::string& uniform_name, float value_1, float value_2) = 0;
-    virtual void set_uniform_3f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3) = 0;
-    virtual void set_uniform_4f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) = 0;
-    virtual bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) = 0;
+    int get_uniform_handle(const std::string& uniform_name);
+    bool is_uniform_handle(int handle) const;
+    const std::string& get_uniform_name(int handle) const;
+
+    void set_uniform_1b(
+        const std::string& uniform_name, bool value);
+    void set_uniform_1i(
+        const std::string& uniform_name, int value);
+    void set_uniform_1f(
+        const std::string& uniform_name, float value);
+    void set_uniform_2f(
+        const std::string& uniform_name, float value_1, float value_2);
+    void set_uniform_3f(
+        const std::string& uniform_name, float value_1, float value_2, float value_3);
+    void set_uniform_4f(
+        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4);
+    bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value);
+
+    virtual void set_uniform_1b(int handle, bool value) = 0;
+    virtual void set_uniform_1i(int handle, int value) = 0;
+    virtual void set_uniform_1f(int handle, float value) = 0;
+    virtual void set_uniform_2f(int handle, float value_1, float value_2) = 0;
+    virtual void set_uniform_3f(int handle, float value_1, float value_2, float value_3) = 0;
+    virtual void set_uniform_4f(int handle, float value_1, float value_2, float value_3, float value_4) = 0;
+    virtual bool set_uniform_texture(int handle, const SurfacePtr& value) = 0;
 
     template<class T> const T& as() const {
       return *reinterpret_cast<const T*>(this);
@@ -97,6 +110,14 @@ class SOLARUS_API Shader : public DrawProxy, public ExportableToLua {
     static void setup_version_string();
     std::string get_sanitized_vertex_source() const;
     std::string get_sanitized_fragment_source() const;
+
+    /**
+     * \brief Called when a uniform gets a handle, to find it in the program.
+     * \param handle The new handle, equal to the number of previous handles.
+     * \param uniform_name Name of the uniform.
+     */
+    virtual void resolve_uniform(int handle, const std::string& uniform_name) = 0;
+
   private:
     static std::string sanitize_shader_source(const std::string& source);
     static std::string version_string;
@@ -107,6 +128,10 @@ class SOLARUS_API Shader : public DrawProxy, public ExportableToLua {
     std::string fragment_source;  /**< Fragment shader code. */
     bool valid;                   /**< \c true if the compilation succedeed. */
     std::string error;            /**< Error message of the last operation if any. */
+    std::unordered_map<std::string, int>
+        uniform_handles;          /**< Handle of each uniform name resolved. */
+    std::vector<std::string>
+        uniform_names;            /**< Name of each uniform handle. */
 };
 
 }
@@ -19,19 +19,34 @@
 
 #include "solarus/core/Common.h"
 #include <cstdint>
+#include <string>
 
 namespace Solarus {
 
 /**
  * \brief Abstract class for software pixel filtering algorithms.
  *
+ * Filters can use the SIMD instructions of the CPU, detected at runtime.
+ * SIMD versions give exactly the same result as the scalar ones.
+ * Bands of rows are filtered in parallel by PixelFilterExecutor.
+ *
  * \deprecated Software pixel filters are deprecated since Solarus 1.6.
  * The new recommended way is to use shaders instead.
  */
-class SoftwarePixelFilter {
+class SOLARUS_API SoftwarePixelFilter {
 
   public:
 
+    /**
+     * \brief SIMD instruction sets that filters can use.
+     */
+    enum class Simd {
+      NONE,   /**< Scalar code only. */
+      SSE2,
+      AVX2,
+      NEON
+    };
+
     SoftwarePixelFilter();
     virtual ~SoftwarePixelFilter();
 
@@ -41,23 +56,47 @@ class SoftwarePixelFilter {
      */
     virtual int get_scaling_factor() const = 0;
 
+    void filter(
+        const uint32_t* src,
+        int src_width,
+        int src_height,
+        uint32_t* dst
+    ) const;
+
     /**
-     * \brief Applies the algorithm on a rectangle of pixels.
+     * \brief Applies the algorithm on some rows of a rectangle of pixels.
+     *
+     * Only the destination pixels of the given source rows are written,
+     * so that bands of rows can be filtered in parallel.
+     *
      * \param src The rectangle of pixels in RGBA format.
-     * Must be a buffer of size src_width * dst_width.
+     * Must be a buffer of size src_width * src_height.
      * \param src_width Width of the rectangle.
      * \param src_height Height of the rectangle.
      * \param dst The destination rectangle to write.
      * Must be a buffer of size
-     * src_width * dst_width * get_scaling_factor().
+     * src_width * src_height * get_scaling_factor() * get_scaling_factor().
+     * \param first_row First source row to filter.
+     * \param num_rows Number of source rows to filter.
      */
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
-        uint32_t* dst
+        uint32_t* dst,
+        int first_row,
+        int num_rows
     ) const = 0;
 
+    virtual std::string get_fragment_shader_source() const;
+
+    static Simd get_simd();
+    static void set_simd_enabled(bool enabled);
+
+  protected:
+
+    virtual void prepare_filter() const;
+
 };
 
 }
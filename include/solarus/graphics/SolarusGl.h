@@ -4,6 +4,9 @@
 #include <SDL_opengles2.h>
 #include <stdio.h>
 #define SOLARUS_GL_ES
+// Types of OpenGL ES 3.0 sync objects, not declared by OpenGL ES 2 headers.
+typedef khronos_uint64_t GLuint64;
+typedef struct __GLsync* GLsync;
 #else
 #include "solarus/third_party/glad/glad.h" // Only include glad to have GL work
 #include <SDL_video.h>
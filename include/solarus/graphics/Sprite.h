@@ -18,17 +18,23 @@
 #define SOLARUS_SPRITE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Symbol.h"
+#include "solarus/graphics/AnimationLod.h"
 #include "solarus/graphics/Drawable.h"
 #include "solarus/graphics/SpritePtr.h"
+#include "solarus/graphics/SurfacePtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <map>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
+class Entity;
 class Size;
 class SpriteAnimation;
 class SpriteAnimationSet;
+class SpriteData;
 class Tileset;
 
 /**
@@ -51,10 +57,18 @@ class Sprite: public Drawable {
     // initialization
     static void initialize();
     static void quit();
+    static void add_preloaded_animation_set(const std::string& id, const SpriteData& data);
+    static bool is_animation_set_loaded(const std::string& id);
+    static void reload_animation_set(const std::string& id);
+    static void preload_animations(const std::string& id,
+        const std::vector<std::string>& animation_names);
 
     // creation and destruction
     explicit Sprite(const std::string& id);
 
+    Entity* get_owner() const;
+    void set_owner(Entity* owner);
+
     void set_tileset(const Tileset& tileset);
 
     // animation set
@@ -71,8 +85,11 @@ class Sprite: public Drawable {
 
     // animation state
     const std::string& get_current_animation() const;
+    const Symbol& get_current_animation_symbol() const;
     void set_current_animation(const std::string& animation_name);
+    void set_current_animation(const Symbol& animation_name);
     bool has_animation(const std::string& animation_name) const;
+    bool has_animation(const Symbol& animation_name) const;
     int get_current_direction() const;
     int get_nb_directions() const;
     void set_current_direction(int current_direction);
@@ -86,6 +103,8 @@ class Sprite: public Drawable {
     void set_synchronized_to(const SpritePtr& other);
 
     bool is_animation_started() const;
+    AnimationLod get_animation_lod() const;
+    void set_animation_lod(AnimationLod animation_lod);
     void start_animation();
     void restart_animation();
     void stop_animation();
@@ -103,12 +122,21 @@ class Sprite: public Drawable {
     // effects
     bool is_blinking() const;
     void set_blinking(uint32_t blink_delay);
+    const SurfacePtr& get_palette() const;
+    void set_palette(const SurfacePtr& palette);
 
     // collisions
     bool test_collision(const Sprite& other, int x1, int y1, int x2, int y2) const;
 
     // update and draw
     virtual void update() override;
+    bool is_update_needed(uint32_t now);
+    uint32_t get_next_change_date() const;
+    bool is_frame_advance_native(uint32_t now) const;
+    void advance_frames(uint32_t now);
+    bool is_update_deferrable(uint32_t now);
+    bool is_update_deferred() const;
+    void set_update_deferred();
     void draw_intermediate() const;
 
     Rectangle clamp_region(const Rectangle& region) const;
@@ -130,15 +158,22 @@ class Sprite: public Drawable {
     Surface& get_intermediate_surface() const ;
     void set_frame_changed(bool frame_changed);
     void notify_finished();
+    void notify_animation_set_reloaded();
+    void reschedule();
+    void skip_animation_loops(uint32_t now);
+    void notify_animation_started();
 
     // animation set
     static std::map<std::string, SpriteAnimationSet*> all_animation_sets;
     const std::string animation_set_id;  /**< id of this sprite's animation set */
     SpriteAnimationSet& animation_set;   /**< animation set of this sprite */
+    uint32_t animation_set_revision;     /**< revision of the animation set when
+                                          * current_animation was found */
+    Entity* owner;                       /**< entity that displays this sprite, or nullptr */
 
     // current state of the sprite
 
-    std::string current_animation_name;  /**< name of the current animation */
+    Symbol current_animation_name;     /**< interned name of the current animation */
     SpriteAnimation* current_animation;  /**< the current animation or nullptr if the sprite sheet has no animation */
     int current_direction;             /**< current direction of the animation (the first one is number 0);
                                         * it can be different from the movement direction
@@ -146,9 +181,14 @@ class Sprite: public Drawable {
                                         * go backwards. */
     int current_frame;                 /**< current frame of the animation (the first one is number 0) */
     bool frame_changed;                /**< indicates that the frame has just changed */
+    bool frames_advanced_early;        /**< indicates that advance_frames() changed the frame
+                                        * since the last update() */
 
     uint32_t frame_delay;              /**< delay between two frames in milliseconds */
     uint32_t next_frame_date;          /**< date of the next frame */
+    AnimationLod animation_lod;        /**< how frames advance while off-screen */
+    bool update_deferred;              /**< indicates that the owner skipped update()
+                                        * because the sprite is off-screen */
 
     bool ignore_suspend;               /**< true to continue playing the animation even when the game is suspended */
     bool paused;                       /**< true if the animation is paused */
@@ -163,6 +203,9 @@ class Sprite: public Drawable {
     uint32_t blink_delay;              /**< blink delay of the sprite, or zero if the sprite is not blinking */
     bool blink_is_sprite_visible;      /**< when blinking, true if the sprite is visible or false if it is invisible */
     uint32_t blink_next_change_date;   /**< date of the next change when blinking: visible or not */
+    SurfacePtr palette;                /**< colors of the indexed sprite sheet, or nullptr */
+    uint32_t next_update_date;         /**< date before which update() has no frame or blinking
+                                        * to change, 0 to check them at the next update() */
 
     ScopedLuaRef
         finished_callback_ref;         /**< Lua ref to an action to do when this movement finishes.
@@ -51,17 +51,22 @@ class SpriteAnimation {
     int get_next_frame(int current_direction, int current_frame) const;
     void draw(Surface& dst_surface, const Point& dst_position,
         int current_direction, int current_frame, const DrawInfos& infos) const;
+    void draw_region(Surface& dst_surface, const Point& dst_position,
+        int current_direction, int current_frame, const Rectangle& region,
+        const DrawInfos& infos) const;
 
     int get_nb_directions() const;
     const SpriteAnimationDirection& get_direction(int direction) const;
     uint32_t get_frame_delay() const;
     bool is_looping() const;
+    int get_loop_on_frame() const;
 
     void enable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
 
   private:
 
+    void check_direction(int direction) const;
     void do_enable_pixel_collisions();
     void disable_pixel_collisions();
 
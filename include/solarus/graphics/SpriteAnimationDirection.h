@@ -22,6 +22,8 @@
 #include "solarus/core/PixelBits.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/graphics/Drawable.h"
+#include "solarus/graphics/SurfaceImpl.h"
+#include <memory>
 #include <vector>
 
 namespace Solarus {
@@ -53,22 +55,29 @@ class SpriteAnimationDirection {
     const Rectangle& get_frame(int frame) const;
     void draw(Surface& dst_surface, const Point& dst_position,
         int current_frame, Surface& src_image, const DrawInfos &infos) const;
+    void draw_region(Surface& dst_surface, const Point& dst_position,
+        int current_frame, const Rectangle& region, Surface& src_image,
+        const DrawInfos &infos) const;
 
     // pixel collisions
-    void enable_pixel_collisions(Surface& src_image);
+    void enable_pixel_collisions(const Surface& src_image);
     void disable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
     const PixelBits& get_pixel_bits(int frame) const;
 
   private:
 
+    std::shared_ptr<const PixelBits> get_frame_pixel_bits(int frame) const;
+
     std::vector<Rectangle> frames;      /**< position of each frame of the sequence on the image */
     Point origin;                       /**< coordinates of the sprite's origin from the
                                          * upper-left corner of its image. */
 
-    std::vector<PixelBits>
-        pixel_bits;                    /**< bit masks representing the non-transparent pixels of each frame,
-                                         * computed only if enable_pixel_collisions() is called */
+    SurfaceImplPtr pixel_bits_image;    /**< image to compute the bit masks from,
+                                         * set only if enable_pixel_collisions() is called */
+    mutable std::vector<std::shared_ptr<const PixelBits>>
+        pixel_bits;                     /**< bit masks representing the non-transparent pixels of each frame,
+                                         * shared with other sprites and computed on first use */
 };
 
 /**
@@ -84,6 +93,7 @@ inline const Point& SpriteAnimationDirection::get_origin() const {
  *
  * It represents the transparent bits of the frame and permits to detect
  * pixel-precise collisions.
+ * It is computed the first time it is needed.
  * The pixel collisions must be enabled.
  *
  * \param frame A frame of the animation.
@@ -95,7 +105,10 @@ inline const PixelBits& SpriteAnimationDirection::get_pixel_bits(int frame) cons
       "Pixel-precise collisions are not enabled for this sprite");
   SOLARUS_ASSERT(frame >= 0 && frame < get_nb_frames(), "Invalid frame number");
 
-  return pixel_bits[frame];
+  if (pixel_bits[frame] == nullptr) {
+    pixel_bits[frame] = get_frame_pixel_bits(frame);
+  }
+  return *pixel_bits[frame];
 }
 
 }
@@ -20,15 +20,18 @@
 #include "solarus/core/Common.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
-#include <map>
+#include "solarus/core/Symbol.h"
+#include "solarus/graphics/SpriteData.h"
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 struct lua_State;
 
 namespace Solarus {
 
 class SpriteAnimation;
-class SpriteAnimationData;
 class Tileset;
 
 /**
@@ -38,19 +41,32 @@ class Tileset;
  * and is an instance of SpriteAnimation.
  * For example, an NPC usually has an animation "stopped"
  * and an animation "walking".
+ *
+ * Animations are created lazily: the source image and the pixel masks of an
+ * animation are only loaded the first time this animation is used, unless
+ * it is preloaded.
  */
 class SpriteAnimationSet {
 
   public:
 
     explicit SpriteAnimationSet(const std::string& id);
+    SpriteAnimationSet(const std::string& id, const SpriteData& data);
+
+    void reload();
+    uint32_t get_revision() const;
 
     void set_tileset(const Tileset& tileset);
 
     bool has_animation(const std::string& animation_name) const;
+    bool has_animation(const Symbol& animation_name) const;
     const SpriteAnimation& get_animation(const std::string& animation_name) const;
     SpriteAnimation& get_animation(const std::string& animation_name);
+    SpriteAnimation& get_animation(const Symbol& animation_name);
     const std::string& get_default_animation() const;
+    bool is_animation_loaded(const std::string& animation_name) const;
+    void preload_animation(const std::string& animation_name);
+    void preload_animations();
 
     void enable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
@@ -60,13 +76,27 @@ class SpriteAnimationSet {
   private:
 
     void load();
+    void load(const SpriteData& data);
 
     void add_animation(const std::string& animation_name,
         const SpriteAnimationData& animation_data);
+    SpriteAnimation* load_animation(const Symbol& animation_name) const;
 
     std::string id;                          /**< Id of this animation set. */
-    std::map<std::string, SpriteAnimation>
-            animations;                      /**< The animations. */
+    mutable std::unordered_map<Symbol, SpriteAnimationData>
+            unloaded_animations;             /**< Animations not created yet
+                                              * by interned name. */
+    mutable std::unordered_map<Symbol, SpriteAnimation>
+            animations;                      /**< The animations created
+                                              * by interned name. */
+    std::vector<std::unordered_map<Symbol, SpriteAnimation>>
+            retired_animations;              /**< Animations created before a reload,
+                                              * kept because sprites may still
+                                              * point to them. */
+    uint32_t revision;                       /**< Number of reloads so far. */
+    const Tileset* tileset;                  /**< Tileset of the current map or nullptr. */
+    bool pixel_collisions_enabled;           /**< Whether pixel-perfect collisions
+                                              * are enabled for these animations. */
     std::string default_animation_name;      /**< Name of the default animation. */
     Size max_size;                           /**< Size of this biggest frame. */
     Rectangle max_bounding_box;              /**< Rectangle big enough to contain any frame.
@@ -25,6 +25,7 @@
 #include "solarus/graphics/SDLPtrs.h"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -70,16 +71,34 @@ class Surface: public Drawable {
         ImageDirectory base_directory = DIR_SPRITES, bool premultiplied = false);
     static SurfacePtr create(SurfaceImplPtr impl, bool premultiplied = false);
     static SurfacePtr create(SDL_Surface_UniquePtr surf, bool premultiplied = false);
+    static SurfacePtr create_packed(SDL_Surface_UniquePtr surf, bool premultiplied = false);
 
     static SDL_Surface_UniquePtr create_sdl_surface_from_file(
         const std::string& file_name
     );
 
+    static void premultiply_alpha(SDL_Surface& surface);
+
     static SDL_Surface_UniquePtr create_sdl_surface_from_memory(
         void* data,
         size_t data_len
     );
 
+    static std::string get_image_file_name(
+        const std::string& file_name,
+        ImageDirectory base_directory
+    );
+    static std::string get_image_file_name(
+        const std::string& file_name,
+        ImageDirectory base_directory,
+        const std::string& language
+    );
+    static void add_preloaded_image(
+        const std::string& actual_file_name,
+        SDL_Surface_UniquePtr surface
+    );
+    static bool reload_image(const std::string& actual_file_name);
+
     int get_width() const;
     int get_height() const;
     virtual Size get_size() const override;
@@ -88,13 +107,17 @@ class Surface: public Drawable {
     void clear(const Rectangle& where);
     void fill_with_color(const Color& color);
     void fill_with_color(const Color& color, const Rectangle& where);
+    void draw_line(const Color& color, const Point& from, const Point& to);
+    void draw_rectangle(const Color& color, const Rectangle& where);
 
     SurfaceImpl& get_impl();
     const SurfaceImpl& get_impl() const;
+    const SurfaceImplPtr& get_shared_impl() const;
 
     bool is_pixel_transparent(int index) const;
 
     std::string get_pixels() const;
+    void get_pixels_async(const std::function<void(const std::string&)>& callback) const;
     void set_pixels(const std::string& buffer);
 
     // Implementation from Drawable.
@@ -123,6 +146,8 @@ class Surface: public Drawable {
     static SurfaceImplPtr get_surface_from_file(
         const std::string& file_name,
         ImageDirectory base_directory);
+    static SurfaceImplPtr create_compressed_texture_from_file(
+        const std::string& actual_file_name);
 
     SurfaceImplPtr internal_surface;                 /**< The SDL_Surface encapsulated. */
 };
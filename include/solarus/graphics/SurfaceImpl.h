@@ -6,6 +6,8 @@
 
 #include <SDL_render.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -35,6 +37,27 @@ public:
    */
   virtual void upload_surface() = 0;
 
+  /**
+   * @brief upload a region of the surface back to the accelerated storage
+   * @param region the region to upload, inside the surface
+   */
+  virtual void upload_region(const Rectangle& region) = 0;
+
+  /**
+   * @brief mark a region of the surface as modified
+   *
+   * The region is uploaded by the next upload_dirty_regions(). Regions
+   * are merged when uploading them together wastes few pixels.
+   *
+   * @param region the modified region
+   */
+  void add_dirty_region(const Rectangle& region);
+
+  /**
+   * @brief upload the regions modified since the last upload
+   */
+  void upload_dirty_regions();
+
   /**
      * @brief get texture width
      * @return width
@@ -60,6 +83,22 @@ public:
    */
   void set_pixels(const std::string& buffer);
 
+  /**
+   * @brief copy a region of this surface into a RGBA buffer
+   * @param pixels where to write the first pixel of the region
+   * @param pitch number of bytes between two rows of the buffer
+   * @param region the region to read, inside the surface
+   */
+  void get_pixels(uint8_t* pixels, int pitch, const Rectangle& region) const;
+
+  /**
+   * @brief set a region of this surface from a RGBA buffer and upload it
+   * @param pixels first pixel of the region in the buffer
+   * @param pitch number of bytes between two rows of the buffer
+   * @param region the region to set, inside the surface
+   */
+  void set_pixels(const uint8_t* pixels, int pitch, const Rectangle& region);
+
   /**
    * @brief Apply a pixel filter to this surface
    * @param pixel_filter the pixel filter
@@ -74,6 +113,23 @@ public:
    */
   bool is_pixel_transparent(int index) const;
 
+  /**
+   * @brief Tell which image file the pixels were loaded from
+   *
+   * Implementations may then free their software copy of the pixels and
+   * decode the file again the first time get_surface() needs them.
+   * Does nothing by default.
+   *
+   * @param file_name name of the image file, relative to the data directory
+   */
+  virtual void set_source_file(const std::string& file_name);
+
+  /**
+   * @brief Tell whether the pixels are also stored in main memory
+   * @return true by default
+   */
+  virtual bool has_software_copy() const;
+
   /**
      * @brief ~SurfaceImpl
      */
@@ -105,7 +161,10 @@ public:
     return *static_cast<const T*>(this);
   }
 private:
+  static constexpr size_t max_dirty_regions = 8;  /**< Beyond this, regions are all merged. */
+
   bool premultiplied = false;
+  std::vector<Rectangle> dirty_regions;  /**< Regions to upload. */
 };
 
 using SurfaceImplPtr = std::shared_ptr<SurfaceImpl>;
@@ -19,20 +19,27 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Drawable.h"
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
-class Size;
+class GlyphAtlas;
 
 /**
  * \brief Draws a line of text on a surface.
  *
- * This class encapsulates a graphic surface and handles text rendering,
- * horizontal and vertical text alignment, color and other properties.
+ * This class handles text rendering, horizontal and vertical text alignment,
+ * color and other properties. The text is drawn as one quad per glyph,
+ * taken from the bitmap font or from the glyph atlas of the outline font,
+ * so that changing the text does not render it again.
  * This is the only class related to a font library (SDL_ttf).
  *
  * Two types of fonts are supported:
@@ -113,6 +120,8 @@ class TextSurface: public Drawable {
     void set_text(const std::string& text);
     bool is_empty() const;
     void add_char(char c);
+    int get_visible_characters() const;
+    void set_visible_characters(int visible_characters);
 
     int get_width() const;
     int get_height() const;
@@ -129,9 +138,22 @@ class TextSurface: public Drawable {
 
   private:
 
+    /**
+     * \brief A glyph to draw: a region of the glyph surface and where it goes.
+     */
+    struct GlyphQuad {
+      Rectangle region;                               /**< Region of the glyph surface. */
+      Point position;                                 /**< Position relative to the top-left corner of the text. */
+      int character;                                  /**< Index of its character in the text. */
+    };
+
     void rebuild();
-    void rebuild_bitmap();
     void rebuild_ttf();
+    void update_text_position();
+    bool append_glyphs();
+    bool append_bitmap_glyphs();
+    bool append_ttf_glyphs();
+    const SurfacePtr& get_glyph_surface() const;
 
     std::string font_id;                              /**< id of the font of the current text surface */
     HorizontalAlignment horizontal_alignment;         /**< horizontal alignment of the current text surface */
@@ -145,8 +167,19 @@ class TextSurface: public Drawable {
     int x;                                            /**< x coordinate of where the text is aligned */
     int y;                                            /**< y coordinate of where the text is aligned */
 
-    SurfacePtr surface;                               /**< the surface to draw */
-    Point text_position;                              /**< position of the top-left corner of the surface on the screen */
+    SurfacePtr glyph_surface;                         /**< surface containing the glyphs when there is no glyph atlas:
+                                                       * the bitmap font, or the whole text rendered at once */
+    std::shared_ptr<GlyphAtlas> glyph_atlas;          /**< glyph atlas of the outline font, if any */
+    std::vector<GlyphQuad> glyph_quads;               /**< glyphs to draw */
+    Size size;                                        /**< size of the text */
+    size_t laid_out_bytes;                            /**< number of bytes of the text already laid out */
+    int num_characters;                               /**< number of characters already laid out */
+    int pen_x;                                        /**< where the next glyph goes, relative to the origin of the line */
+    int line_min_x;                                   /**< leftmost pixel of the line, relative to its origin */
+    int line_max_x;                                   /**< rightmost pixel of the line, relative to its origin */
+    uint16_t last_code_point;                         /**< last character laid out, for kerning */
+    int visible_characters;                           /**< number of characters to draw, -1 means all */
+    Point text_position;                              /**< position of the top-left corner of the text on the screen */
 
     std::string text;                                 /**< the string to draw (only one line) */
 
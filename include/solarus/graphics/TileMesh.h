@@ -0,0 +1,69 @@
+#pragma once
+
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Solarus {
+
+class Surface;
+
+/**
+ * @brief Tiles uploaded once to the rendering device
+ *
+ * A tile mesh stores the position and the image region of many tiles of the
+ * same image so that they can be drawn in one call. Tiles whose image changes
+ * over time refer to a slot: the offset of the current animation frame is
+ * given for each slot before drawing, and the device moves the image regions
+ * of all tiles of that slot by this offset.
+ *
+ * A quad may also cover a rectangle where the same scrolling pattern repeats:
+ * the device then wraps its image region over the whole rectangle, so that
+ * a parallax background is a single quad rather than one quad per tile.
+ */
+class TileMesh
+{
+public:
+  /**
+   * @brief A tile of the mesh
+   */
+  struct Quad {
+    Point position;         /**< Top-left corner of the tile in the map. */
+    Size size;              /**< Size of the quad in the map: the size of the region,
+                             * or a multiple of it to repeat the region. */
+    Rectangle region;       /**< Region of the image when the offset of the slot is zero. */
+    int slot;               /**< Slot giving the animation offset, 0 if the tile is not animated. */
+    bool parallax;          /**< Whether the tile moves at half speed with the viewport. */
+    bool self_scrolling;    /**< Whether the image scrolls with the position on the destination. */
+  };
+
+  virtual ~TileMesh() = default;
+
+  /**
+   * @brief set the current animation offset of the tiles of a slot
+   * @param slot the slot, between 1 and max_slots excluded
+   * @param offset offset to add to the image regions of its tiles
+   */
+  virtual void set_slot_offset(int slot, const Point& offset) = 0;
+
+  /**
+   * @brief draw some consecutive tiles of the mesh
+   * @param dst_surface the surface to draw on
+   * @param viewport position of the top-left corner of dst_surface in the map
+   * @param first_quad index of the first tile to draw
+   * @param num_quads number of tiles to draw
+   */
+  virtual void draw(Surface& dst_surface, const Point& viewport, size_t first_quad, size_t num_quads) = 0;
+
+  static constexpr size_t max_quads = 16384;  /**< Maximum number of tiles of a mesh. */
+  static constexpr int max_slots = 64;        /**< Number of slots, including the static slot 0. */
+  static constexpr int max_tile_size = 2040;  /**< Maximum width and height of a tile. */
+  static constexpr int max_repeats = 32;      /**< Maximum number of repeated quads of a mesh. */
+};
+
+using TileMeshPtr = std::unique_ptr<TileMesh>;
+
+}
@@ -57,10 +57,27 @@ class SOLARUS_API Transition : public DrawProxy {
       CLOSING = 1
     };
 
+    /**
+     * \brief A named transition effect drawn by a shader.
+     */
+    struct Effect {
+      ShaderPtr shader;             /**< The shader that draws the effect. */
+      uint32_t closing_duration;    /**< Duration of closing transitions in milliseconds. */
+      uint32_t opening_duration;    /**< Duration of opening transitions in milliseconds. */
+    };
+
     virtual ~Transition();
     static Transition* create(Style style,
         Direction direction,
         Game* game = nullptr);
+    static Transition* create(const std::string& effect_name,
+        Direction direction,
+        Game* game = nullptr);
+
+    static const Effect* get_effect(const std::string& effect_name);
+    static void set_effect(const std::string& effect_name, const Effect& effect);
+    static void remove_effect(const std::string& effect_name);
+    static void clear_effects();
 
     Game* get_game() const;
     Direction get_direction() const;
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_TRANSITION_SHADER_H
+#define SOLARUS_TRANSITION_SHADER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/graphics/ShaderPtr.h"
+#include "solarus/graphics/Transition.h"
+#include <cstdint>
+
+namespace Solarus {
+
+/**
+ * \brief Transition effect drawn by a shader.
+ *
+ * The surface is drawn directly through the shader, without any
+ * intermediate surface. The shader receives the progress of the transition
+ * and, during an opening transition that follows a closing one,
+ * the surface that was displayed before.
+ */
+class TransitionShader: public Transition {
+
+  public:
+
+    constexpr static const char* PROGRESS_NAME = "sol_transition_progress";
+    constexpr static const char* OPENING_NAME = "sol_transition_opening";
+    constexpr static const char* PREVIOUS_TEXTURE_NAME = "sol_previous_texture";
+
+    TransitionShader(Direction direction, const ShaderPtr& shader, uint32_t duration);
+
+    virtual bool needs_previous_surface() const override;
+
+    virtual void start() override;
+    virtual bool is_started() const override;
+    virtual bool is_finished() const override;
+    virtual void notify_suspended(bool suspended) override;
+    virtual void update() override;
+    virtual void draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const override;
+
+  private:
+
+    ShaderPtr shader;             /**< The shader that draws the effect. */
+    uint32_t duration;            /**< Duration of the transition in milliseconds. */
+    uint32_t start_date;          /**< Date when the transition started. */
+    bool started;                 /**< Whether start() was called. */
+    float progress;               /**< Progress of the transition between 0 and 1. */
+
+};
+
+}
+
+#endif
+
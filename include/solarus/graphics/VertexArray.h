@@ -47,6 +47,15 @@ enum PrimitiveType {
     //Don't put quad as it is deprecated
 };
 
+/**
+ * @brief Hint on how often the vertices of an array change
+ */
+enum BufferUsage {
+    STATIC = GL_STATIC_DRAW, /**< Set once and drawn many times: uploaded only after modifications */
+    DYNAMIC = GL_DYNAMIC_DRAW, /**< Modified from time to time: the buffer storage is reused */
+    STREAM = GL_STREAM_DRAW /**< Modified before almost every draw: the buffer storage is renewed */
+};
+
 /**
  * @brief View on a Vertex array, allowing to modify it
  *
@@ -91,6 +100,8 @@ public:
     static VertexArrayPtr create(PrimitiveType type,size_t vertex_count);
     void set_primitive_type(PrimitiveType type);
     PrimitiveType get_primitive_type() const;
+    void set_usage(BufferUsage usage);
+    BufferUsage get_usage() const;
     Vertex* data();
     const Vertex* data() const;
     void add_vertex(const Vertex& v);
@@ -101,8 +112,10 @@ public:
     const Vertex& operator [](size_t index) const;
 private:
     std::vector <Vertex> vertices; /**< actual vertices storage*/
-    mutable GLuint vertex_buffer; /**< buffer object where vertices are uploaded in GPU*/
+    mutable GLuint vertex_buffer = 0; /**< buffer object where vertices are uploaded in GPU*/
+    mutable size_t buffer_capacity = 0; /**< number of vertices the buffer object can hold*/
     PrimitiveType type; /**< Primitive type the VertexArray should be drawn with*/
+    BufferUsage usage = DYNAMIC; /**< How often vertices are expected to change*/
     mutable bool buffer_dirty = true; /**< dirty bit stating that array needs to be reuploaded*/
 };
 
@@ -22,6 +22,7 @@
 #include "solarus/graphics/ShaderPtr.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include "solarus/graphics/Renderer.h"
+#include "solarus/graphics/VsyncMode.h"
 #include <vector>
 #include <string>
 
@@ -59,6 +60,13 @@ namespace Video {
     bool is_initialized();
 
     SDL_Window* get_window();
+    int get_refresh_rate();
+
+    VsyncMode get_vsync_mode();
+    void set_vsync_mode(VsyncMode vsync_mode);
+    bool is_premultiplied_alpha();
+    double get_present_interval();
+    double get_present_jitter();
     Renderer& get_renderer();
 
     SDL_PixelFormat* get_pixel_format();
@@ -83,6 +91,11 @@ namespace Video {
 
     const ShaderPtr& get_shader();
     void set_shader(const ShaderPtr& shader);
+    void get_shader_resolution_bounds(double& min_resolution, double& max_resolution);
+    void set_shader_resolution_bounds(double min_resolution, double max_resolution);
+    double get_shader_resolution();
+    const std::vector<ShaderPtr>& get_post_effects();
+    void set_post_effects(const std::vector<ShaderPtr>& shaders);
 
     const SoftwareVideoMode& get_video_mode();
     std::vector<const SoftwareVideoMode*> get_video_modes();
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "solarus/graphics/DrawRecording.h"
+#include "solarus/graphics/glrenderer/GlRenderer.h"
+#include "solarus/graphics/VertexArray.h"
+
+#include <vector>
+
+namespace Solarus {
+
+struct DrawInfos;
+class GlShader;
+class GlTexture;
+
+/**
+ * @brief Draws recorded as vertices ready to be copied to the sprite ring
+ *
+ * Consecutive quads sharing the same texture, shader and blend mode form a
+ * run. Drawing the recording sets the state of each run once and copies the
+ * vertices of its quads to the ring of the renderer, adding the offset.
+ */
+class GlDrawRecording : public DrawRecording
+{
+public:
+  explicit GlDrawRecording(GlTexture& target);
+
+  GlTexture& get_target() const;
+  void add_sprite(const GlTexture& src, GlShader& shader, const DrawInfos& infos);
+  void set_incomplete();
+
+  bool draw(Surface& dst_surface, const Point& offset) override;
+
+private:
+  /**
+   * @brief Consecutive quads drawn with the same state
+   */
+  struct Run {
+    const GlTexture* texture;               /**< Texture of the quads. */
+    GlShader* shader;                       /**< Shader of the quads. */
+    GlRenderer::GLBlendMode blend_mode;     /**< Blend mode of the quads. */
+    size_t num_quads;                       /**< Number of quads. */
+  };
+
+  /**
+   * @brief Texture drawn and whether it was in the atlas when recorded
+   */
+  struct Source {
+    const GlTexture* texture;               /**< The texture. */
+    bool packed;                            /**< Whether it was drawn from its atlas page. */
+  };
+
+  GlTexture& target;                        /**< Destination of the recording. */
+  std::vector<Run> runs;                    /**< State changes of the recording. */
+  std::vector<Source> sources;              /**< Textures drawn. */
+  std::vector<Vertex> vertices;             /**< Four vertices per quad, in the order of the runs. */
+  bool complete = true;                     /**< False if something else than a surface
+                                             * was drawn on the target during the recording. */
+};
+
+}
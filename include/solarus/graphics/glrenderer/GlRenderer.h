@@ -4,10 +4,14 @@
 #include <solarus/graphics/glrenderer/GlShader.h>
 #include <solarus/graphics/VertexArray.h>
 
+#include <array>
+
 namespace Solarus {
 
+class GlDrawRecording;
 class GlShader;
 class GlTexture;
+class GlTextureAtlas;
 
 /**
  * @brief Opengl Renderer
@@ -15,10 +19,23 @@ class GlTexture;
  * This renderer implements batch rendering. This minimize the state changes in
  * the opengl driver. Sprites are accumulated in a buffer before being rendered
  * all at once.
+ *
+ * The sprite buffer is used as a ring: consecutive batches are written one
+ * after the other, so a batch interrupted by a state change does not have to
+ * wait for the previous one to be consumed. When ARB_buffer_storage is
+ * available, the ring is persistently mapped and split in sections guarded
+ * by fences. Otherwise it is filled with glBufferSubData and orphaned when
+ * it wraps around.
+ *
+ * With OpenGL 3.3 or OpenGL ES 3, sprites drawn with the default shader are
+ * written as one instance record each instead of four vertices: the vertex
+ * shader expands the quads and applies their transformation.
  */
 class GlRenderer : public Renderer {
+  friend class GlDrawRecording;
   friend class GlTexture;
   friend class GlShader;
+  friend class GlTileMesh;
 
 public:
   typedef void (APIENTRY *DEBUGPROC)(GLenum source,
@@ -41,9 +58,14 @@ public:
   static RendererPtr create(SDL_Window* window, bool force_software);
   SurfaceImplPtr create_texture(int width, int height) override;
   SurfaceImplPtr create_texture(SDL_Surface_UniquePtr &&surface) override;
+  SurfaceImplPtr create_packed_texture(SDL_Surface_UniquePtr &&surface) override;
+  SurfaceImplPtr create_compressed_texture(const KtxImage& image) override;
   SurfaceImplPtr create_window_surface(SDL_Window* w, int width, int height) override;
   ShaderPtr create_shader(const std::string& shader_id) override;
   ShaderPtr create_shader(const std::string& vertex_source, const std::string& fragment_source, double scaling_factor) override;
+  TileMeshPtr create_tile_mesh(const SurfacePtr& image, const std::vector<TileMesh::Quad>& quads) override;
+  DrawRecordingPtr begin_recording(SurfaceImpl& dst) override;
+  void end_recording() override;
   //void set_render_target(SurfaceImpl& texture) override;
   void set_render_target(GlTexture* target);
   void bind_as_gl_target(SurfaceImpl &surf) override;
@@ -51,18 +73,44 @@ public:
   void draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos) override;
   void clear(SurfaceImpl& dst) override;
   void fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode = BlendMode::BLEND) override;
+  void draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode = BlendMode::BLEND) override;
   void invalidate(const SurfaceImpl& surf) override;
   std::string get_name() const override;
   void present(SDL_Window* window) override;
   void on_window_size_changed(const Rectangle& viewport) override;
+  bool blit_to_window(SurfaceImpl& window, const SurfaceImpl& src) override;
   static GlRenderer& get(){
     return *instance;
   }
 
   const DrawProxy& default_terminal() const override;
+  FrameStats get_last_frame_stats() const override;
+  bool begin_gpu_timer() override;
+  void end_gpu_timer() override;
+  double get_gpu_time() const override;
+  void read_pixels_async(const SurfaceImplPtr& surf, const PixelsCallback& callback) override;
+  void update_pixel_reads() override;
+  void cancel_pixel_reads() override;
   ~GlRenderer() override;
+
+  static void set_sprite_batch_size(size_t num_sprites);
+  static size_t get_sprite_batch_size();
+  static void set_texture_atlas_enabled(bool enabled);
+  static bool is_texture_atlas_enabled();
+  static void set_image_copies_kept(bool kept);
+  static bool are_image_copies_kept();
+  static void set_sprite_instancing_enabled(bool enabled);
+  static bool is_sprite_instancing_enabled();
+  static void set_swap_interval(int swap_interval);
+  static int get_swap_interval();
+
+  static constexpr size_t default_sprite_batch_size = 4096;  /**< Default number of sprites in the ring. */
+  static constexpr size_t max_sprite_batch_size = 16384;     /**< Sprites addressable with 16-bit indices. */
+  static constexpr int atlas_page_size = 2048;               /**< Size of the texture atlas pages. */
+  static constexpr int atlas_max_image_size = 1024;          /**< Larger images get their own texture. */
+  static constexpr size_t max_pooled_targets = 8;           /**< Released render targets kept per size. */
+  static constexpr uint64_t pooled_target_lifetime = 120;   /**< Frames before an unused pooled target is deleted. */
 private:
-  static constexpr const char* VCOLOR_ONLY_NAME = "sol_vcolor_only";
   void draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos, GlShader& shader);
 
   /**
@@ -70,16 +118,52 @@ private:
    */
   using GLBlendMode = std::tuple<GLenum,GLenum,GLenum,GLenum,bool>;
 
+  /**
+   * @brief Compact description of a sprite drawn with instancing
+   */
+  struct SpriteInstance {
+    glm::vec2 position;               /**< Destination of the transformation origin. */
+    glm::vec2 corner;                 /**< Scaled top-left corner, relative to the origin. */
+    glm::vec2 extent;                 /**< Scaled size of the quad. */
+    GLushort region[4];               /**< Source rectangle in texels. */
+    GLfloat rotation;                 /**< Rotation around the origin in radians. */
+    Color color;                      /**< Color of the sprite, premultiplied if the renderer is. */
+  };
+
 
   bool use_vao() const;
 
   void read_pixels(GlTexture* from, void* to);
   void put_pixels(GlTexture* to, void* data);
+  void put_pixels(GlTexture* to, const void* data, int pitch, const Rectangle& region);
 
   void restart_batch();
+  void discard_batch();
+  void reserve_sprite();
+  size_t reserve_sprites(size_t num_sprites);
+  Vertex* get_vertex_base();
+  bool is_ring_fenced() const;
+  void upload_ring_range(GLintptr offset, GLsizeiptr size, const void* data);
+  bool init_buffer_storage();
+  bool init_unsynchronized_mapping();
+  bool init_async_reads();
+  bool init_window_blits();
+  bool init_gpu_timers();
+  bool init_instancing();
+  void create_instance_buffer();
+  bool is_instanced(const GlShader* shader) const;
+  GlShader& get_sprite_shader();
+  void enable_instance_attributes(bool enable);
+  void set_instance_attributes(size_t first_instance);
+#ifndef SOLARUS_GL_ES
+  void collect_gpu_timers();
+#endif
+  void init_compressed_formats();
+  GLenum get_compressed_format(KtxImage::Format format) const;
+  void enter_section(size_t section);
   void set_shader(GlShader* shader);
   void set_texture(const GlTexture* texture);
-  void set_state(const GlTexture* src, GlShader* shad, GlTexture* dst, const GLBlendMode& mode, bool force = false);
+  bool set_state(const GlTexture* src, GlShader* shad, GlTexture* dst, const GLBlendMode& mode, bool force = false);
   void rebind_texture();
   void rebind_shader();
   void set_blend_mode(GLBlendMode mode);
@@ -87,20 +171,44 @@ private:
   GLBlendMode make_gl_blend_modes(BlendMode mode);
   void create_vbo(size_t num_sprites);
   void add_sprite(const DrawInfos& infos);
+  void write_sprite(Vertex* vertices, const DrawInfos& infos) const;
+  void write_instance(SpriteInstance& instance, const DrawInfos& infos) const;
+  void add_line(const Point& from, const Point& to, const Color& color, BlendMode mode);
+  Color make_vertex_color(const Color& color, uint8_t opacity, BlendMode mode) const;
+  const GlTexture& get_white_texture();
   size_t buffered_indices() const;
   size_t buffered_vertices() const;
   Fbo* get_fbo(int width, int height, bool screen = false);
+  GLuint acquire_target_texture(int width, int height);
+  void recycle_target_texture(const GlTexture& texture);
+  void reclaim_target_textures();
+  static uint_fast64_t get_size_key(int width, int height);
 
   void shader_about_to_change(GlShader* shader);
+  static void apply_swap_interval();
 
   static GlRenderer* instance;
+  static size_t sprite_batch_size;
+  static bool texture_atlas_enabled;
+  static bool image_copies_kept;
+  static bool sprite_instancing_enabled;
+  static int swap_interval;
+  static constexpr size_t num_sections = 3;  /**< Sections of the fenced ring. */
   SDL_GLContext sdl_gl_context;
   GlShader* current_shader = nullptr;
   const GlTexture* current_texture = nullptr;
   GlTexture* current_target = nullptr;
   GLBlendMode current_blend_mode =
     GLBlendMode{GL_ONE,GL_ONE,GL_ONE,GL_ONE,false};
+  bool premultiplied_alpha = false;       /**< Whether all textures are premultiplied. */
   ShaderPtr main_shader;
+  ShaderPtr sprite_shader;                /**< Draws sprites of the default shader from instance
+                                           * records, if instancing is supported. */
+  ShaderPtr tile_shader;                  /**< Draws tile meshes, created with the first one. */
+  std::unique_ptr<GlTextureAtlas> atlas;  /**< Packs images loaded from files, if enabled. */
+  SurfaceImplPtr white_texture;           /**< White texels for untextured quads when no atlas
+                                           * page is bound, created on demand. */
+  GlDrawRecording* recording = nullptr;   /**< Recording in progress, if any. */
 
   GLuint vao = 0;
   GLuint vbo = 0;
@@ -109,13 +217,79 @@ private:
   const GlTexture* test_texture = nullptr;
 
   Vertex* current_vertex = nullptr;
+  size_t batch_start = 0;         /**< Index in the ring of the first sprite of the batch. */
   size_t buffered_sprites = 0;
   size_t buffer_size = 0;
 
-  std::vector<Vertex> vertex_buffer;
+  std::vector<Vertex> vertex_buffer;  /**< CPU side copy of the ring when it is not mapped. */
+
+  GLuint instance_vbo = 0;            /**< Instance ring, parallel to the sprite ring. */
+  std::vector<SpriteInstance> instances; /**< CPU side copy of the instance ring. */
+  std::array<GLint, 6> instance_locations; /**< Attributes of the sprite shader,
+                                            * in the order of SpriteInstance. */
+
+  bool persistent_mapping = false;    /**< Whether the ring is persistently mapped. */
+  bool unsynchronized_mapping = false; /**< Whether batches are written to the ring with
+                                       * unsynchronized mappings, protected by section fences. */
+  Vertex* mapped_vertices = nullptr;
+  size_t section_size = 0;            /**< Number of sprites in a section of the ring. */
+  size_t current_section = 0;
+  std::array<GLsync, num_sections> section_fences;
+#ifndef SOLARUS_GL_ES
+
+  /**
+   * @brief Pixels of a render target being copied to a pixel buffer object
+   */
+  struct PixelRead {
+    GLuint pbo;                       /**< Buffer receiving the pixels. */
+    GLsync fence;                     /**< Signaled when the copy is done. */
+    size_t size;                      /**< Size of the pixels in bytes. */
+    PixelsCallback callback;          /**< Function receiving the pixels. */
+  };
+  std::vector<PixelRead> pixel_reads; /**< Asynchronous reads in progress. */
+
+  /**
+   * @brief Pixel buffer object kept for the next reads of the same size
+   */
+  struct PixelBuffer {
+    GLuint pbo;                       /**< The buffer. */
+    size_t size;                      /**< Its size in bytes. */
+  };
+  static constexpr size_t max_free_pixel_buffers = 4;
+  std::vector<PixelBuffer> free_pixel_buffers; /**< Buffers of finished reads, reused
+                                                * by repeated reads like frame captures. */
+  void delete_free_pixel_buffers();
+
+  static constexpr size_t num_gpu_timers = 4;
+  std::array<GLuint, num_gpu_timers> gpu_timers; /**< Time elapsed queries, used in turn. */
+  size_t next_gpu_timer = 0;          /**< Index of the next query to begin. */
+  size_t pending_gpu_timers = 0;      /**< Queries ended but whose result is not read yet. */
+  bool gpu_timer_running = false;     /**< Whether a query is between begin and end. */
+#endif
+  bool gpu_timers_supported = false;  /**< Whether time elapsed queries are available. */
+  double gpu_time = -1.0;             /**< Result of the last finished query in milliseconds. */
+  bool unpack_row_length = false;     /**< Whether GL_UNPACK_ROW_LENGTH is supported. */
+  bool window_blits = false;          /**< Whether render targets can be blitted to the window. */
+  std::vector<GLenum> compressed_formats; /**< Compressed texture formats supported. */
+  bool async_reads = false;           /**< Whether pixel buffer objects and fences
+                                       * are available for asynchronous reads. */
+
+  FrameStats frame_stats;             /**< Statistics of the frame being drawn. */
+  FrameStats last_frame_stats;        /**< Statistics of the last presented frame. */
 
   Fbo screen_fbo = {0,glm::mat4(1.f)};
   std::unordered_map<uint_fast64_t,Fbo> fbos;
+
+  /**
+   * @brief GL texture of a destroyed render target, kept for reuse
+   */
+  struct PooledTarget {
+    GLuint id;                        /**< The texture. */
+    uint64_t released_frame;          /**< Frame when it was released. */
+  };
+  std::unordered_map<uint_fast64_t,std::vector<PooledTarget>> target_pool; /**< Released render
+                                                                            * targets by size. */
+  uint64_t frame_number = 0;          /**< Number of frames presented. */
   Rectangle window_viewport;
 
   bool is_es_context;
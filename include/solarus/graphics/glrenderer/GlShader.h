@@ -40,6 +40,7 @@ namespace Solarus {
  */
 class SOLARUS_API GlShader : public Shader {
   friend class GlRenderer;
+  friend class GlTileMesh;
   public:
     explicit GlShader(const std::string& shader_id);
     GlShader(const std::string& vertex_source,
@@ -50,25 +51,32 @@ class SOLARUS_API GlShader : public Shader {
     static bool initialize();
     static void quit();
 
-    void set_uniform_1b(
-        const std::string& uniform_name, bool value) override;
-    void set_uniform_1i(
-        const std::string& uniform_name, int value) override;
-     void set_uniform_1f(
-        const std::string& uniform_name, float value) override;
-     void set_uniform_2f(
-        const std::string& uniform_name, float value_1, float value_2) override;
-     void set_uniform_3f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3) override;
-     void set_uniform_4f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) override;
-     bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) override;
+    using Shader::set_uniform_1b;
+    using Shader::set_uniform_1i;
+    using Shader::set_uniform_1f;
+    using Shader::set_uniform_2f;
+    using Shader::set_uniform_3f;
+    using Shader::set_uniform_4f;
+    using Shader::set_uniform_texture;
+
+    void set_uniform_1b(int handle, bool value) override;
+    void set_uniform_1i(int handle, int value) override;
+    void set_uniform_1f(int handle, float value) override;
+    void set_uniform_2f(int handle, float value_1, float value_2) override;
+    void set_uniform_3f(int handle, float value_1, float value_2, float value_3) override;
+    void set_uniform_4f(int handle, float value_1, float value_2, float value_3, float value_4) override;
+    bool set_uniform_texture(int handle, const SurfacePtr& value) override;
 
     void draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const override;
 
     void bind();
     void unbind();
 
+    static bool has_uniform_buffers();
+    static bool has_program_binaries();
+    static bool is_program_cache_enabled();
+    static void set_program_cache_enabled(bool enabled);
+
     struct Uniform {
       enum class Type {
         U1B,
@@ -78,35 +86,32 @@ class SOLARUS_API GlShader : public Shader {
         U3F,
         U4F
       };
-      std::string name;
       Type t;
-      Uniform(const std::string& name, const glm::vec2& v) :
-        name(name),
+      Uniform() :
+        t(Type::U1I),
+        i(0)
+      {}
+      explicit Uniform(const glm::vec2& v) :
         t(Type::U2F),
         ff(v)
       {}
-      Uniform(const std::string& name, const glm::vec3& v) :
-        name(name),
+      explicit Uniform(const glm::vec3& v) :
         t(Type::U3F),
         fff(v)
       {}
-      Uniform(const std::string& name, const glm::vec4& v) :
-        name(name),
+      explicit Uniform(const glm::vec4& v) :
         t(Type::U4F),
         ffff(v)
       {}
-      Uniform(const std::string& name, float f) :
-        name(name),
+      explicit Uniform(float f) :
         t(Type::U1F),
         f(f)
       {}
-      Uniform(const std::string& name, int i) :
-        name(name),
+      explicit Uniform(int i) :
         t(Type::U1I),
         i(i)
       {}
-      Uniform(const std::string& name, bool b) :
-        name(name),
+      explicit Uniform(bool b) :
         t(Type::U1B),
         b(b)
       {}
@@ -120,18 +125,68 @@ class SOLARUS_API GlShader : public Shader {
       };
     };
 
+    /**
+     * \brief Locations of the uniforms set by the renderer, found once.
+     */
+    struct BuiltinLocations {
+      GLint mvp_matrix = -1;
+      GLint uv_matrix = -1;
+      GLint input_size = -1;
+      GLint output_size = -1;
+      GLint time = -1;
+      GLint alpha_mult = -1;
+      GLint vcolor_only = -1;
+    };
+
+    const BuiltinLocations& get_builtin_locations() const;
+
+  protected:
+    void resolve_uniform(int handle, const std::string& uniform_name) override;
+
   private:
     void compile();
+    bool link_program(const std::string& vertex_source,
+                      const std::string& fragment_source,
+                      bool retrievable);
+    bool load_program_binary(const std::string& cache_file_name);
+    void save_program_binary(const std::string& cache_file_name) const;
+    void find_uniform_blocks();
 
+    static std::string get_program_cache_file_name(
+        const std::string& vertex_source,
+        const std::string& fragment_source);
 
-    void set_uniform(const Uniform& uniform);
-    void upload_uniform(const Uniform& uniform);
+    /**
+     * \brief What a uniform handle refers to.
+     *
+     * Uniforms of the default block have a location and their value is kept
+     * until the shader is bound. Uniforms of a uniform block are written
+     * to its buffer instead.
+     */
+    struct UniformSlot {
+      GLint location = -1;                /**< Location, -1 if none. */
+      int block = -1;                     /**< Index of the uniform block, -1 if none. */
+      GLint offset = 0;                   /**< Offset in the buffer of the block. */
+      bool pending = false;               /**< Whether value must be uploaded at the next bind. */
+      Uniform value;                      /**< Value waiting for the next bind. */
+      SurfacePtr texture;                 /**< Surface of a sampler uniform. */
+      GLuint texture_unit = 0;            /**< Texture unit of a sampler uniform, 0 if none. */
+    };
 
-    struct TextureUniform{
-      SurfacePtr surface;
-      GLuint unit;
+    /**
+     * \brief A uniform block of the program backed by a buffer.
+     */
+    struct UniformBlock {
+      GLuint buffer = 0;                  /**< The uniform buffer. */
+      GLuint binding = 0;                 /**< Binding point of the block. */
+      std::vector<unsigned char> data;    /**< Content of the buffer. */
+      bool dirty = false;                 /**< Whether data changed since the last upload. */
     };
 
+    void set_uniform(int handle, const Uniform& uniform);
+    void upload_uniform(GLint location, const Uniform& uniform);
+    void write_block_uniform(const UniformSlot& slot, const Uniform& uniform);
+
     GLuint create_shader(unsigned int type, const char* source);
     GLint get_uniform_location(const std::string& uniform_name) const;
 
@@ -142,13 +197,19 @@ class SOLARUS_API GlShader : public Shader {
     GLint position_location;                     /**< The location of the position attrib. */
     GLint tex_coord_location;                    /**< The location of the tex_coord attrib. */
     GLint color_location;                        /**< The location of the color attrib. */
-    mutable std::map<std::string, GLint>
+    BuiltinLocations builtin_locations;          /**< Locations of the uniforms set by the renderer. */
+    mutable std::unordered_map<std::string, GLint>
         uniform_locations;                       /**< Cache of uniform locations. */
-    mutable std::map<std::string, TextureUniform>
-        uniform_textures;                        /**< Uniform texture value of surfaces. */
+    std::vector<UniformSlot> uniform_slots;      /**< What each uniform handle refers to. */
+    std::vector<int> pending_uniforms;           /**< Handles whose value waits for the next bind. */
+    std::vector<int> texture_uniforms;           /**< Handles of sampler uniforms. */
+    std::vector<UniformBlock> uniform_blocks;    /**< Uniform blocks backed by buffers. */
+    std::unordered_map<std::string, std::pair<int, GLint>>
+        block_uniforms;                          /**< Block index and offset of uniforms of blocks. */
     std::unordered_map<GLuint, GLint> attribute_states;    /**< Previous attrib states. */
-    std::vector<Uniform> pending_uniforms;
     GLuint current_texture_unit = 0;
+
+    static bool program_cache_enabled;           /**< Whether linked programs are cached on disk. */
 };
 
 }
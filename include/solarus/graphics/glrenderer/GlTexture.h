@@ -1,5 +1,6 @@
 #pragma once
 
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Point.h"
 #include "solarus/graphics/SDLPtrs.h"
@@ -7,6 +8,7 @@
 #include "solarus/graphics/glrenderer/GlRenderer.h"
 
 #include <memory>
+#include <string>
 
 namespace Solarus {
 
@@ -16,12 +18,21 @@ namespace Solarus {
 class GlTexture : public SurfaceImpl
 {
   friend class GlRenderer;
+  friend class GlTextureAtlas;
 public:
   GlTexture(int width, int height, bool screen_tex = false);
   GlTexture(SDL_Surface_UniquePtr surface);
 
   GLuint get_texture() const;
+  bool is_packed() const;
+  bool is_atlas_page() const;
+  const GlTexture& get_atlas_page() const;
+  const Point& get_atlas_position() const;
+  bool contains_region(const Rectangle& region) const;
+  void unpack() const;
   SDL_Surface* get_surface() const override;
+  void set_source_file(const std::string& file_name) override;
+  bool has_software_copy() const override;
 
   GlTexture& targetable();
 
@@ -35,15 +46,32 @@ public:
    * to upload it to the texture for changes to be reflected
    */
   void upload_surface() override;
+  void upload_region(const Rectangle& region) override;
 private:
+  GlTexture(int page_size);
+  GlTexture(SDL_Surface_UniquePtr surface, const std::shared_ptr<GlTexture>& page, const Point& position);
+  GlTexture(const KtxImage& image, GLenum internal_format);
+  void decompress() const;
+
   bool target = false;
   void release() const;
-  void set_texture_params();
+  static void set_texture_params(GLenum wrap = GL_REPEAT);
   glm::mat3 uv_transform;
   mutable bool surface_dirty = true;
-  GLuint tex_id = 0;
+  mutable GLuint tex_id = 0;
   GlRenderer::Fbo* fbo = nullptr;
   mutable SDL_Surface_UniquePtr surface = nullptr;
+  int width = 0;
+  int height = 0;
+  std::string source_file;                                  /**< Image file to decode again
+                                                             * if the surface was freed. */
+  mutable std::shared_ptr<GlTexture> atlas_page = nullptr; /**< Page containing the pixels if packed. */
+  Point atlas_position;                                     /**< Position in the atlas page. */
+  bool page = false;                                        /**< Whether this texture is an atlas page. */
+  mutable bool compressed = false;                          /**< Whether the texture holds GPU-compressed
+                                                             * pixels, which cannot be drawn on or modified. */
+  mutable MemoryUsage::Tracker memory_tracker{
+      MemoryUsage::Category::TEXTURES};                     /**< Video memory of the GL texture. */
 };
 
 }
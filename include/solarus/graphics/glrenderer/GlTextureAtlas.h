@@ -0,0 +1,71 @@
+#pragma once
+
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/SurfaceImpl.h"
+
+#include <memory>
+#include <vector>
+
+namespace Solarus {
+
+class GlTexture;
+
+/**
+ * @brief Packs read-only images into a few large textures
+ *
+ * Images loaded from files (sprite sheets, tilesets, fonts) are copied into
+ * shared pages. Textures created by the atlas are sub-rectangles of a page,
+ * so the renderer can draw sprites from different images in the same batch.
+ *
+ * Pages are owned by the textures packed in them and are destroyed with the
+ * last one. Space freed by a texture is only reused when its whole page is
+ * destroyed.
+ *
+ * Each page starts with a block of white pixels, so that the renderer can
+ * draw untextured quads (fills, lines) in the same batch as the images.
+ */
+class GlTextureAtlas {
+public:
+  GlTextureAtlas(int page_size, int max_image_size);
+
+  SurfaceImplPtr pack(SDL_Surface_UniquePtr&& surface);
+
+  int get_page_size() const;
+  int get_max_image_size() const;
+
+  static Rectangle get_white_texel();
+
+  static constexpr int padding = 1;    /**< Transparent pixels between two images. */
+  static constexpr int white_size = 3; /**< Side of the white block at the
+                                        * top-left corner of each page. */
+private:
+  /**
+   * @brief A row of images of a page
+   */
+  struct Shelf {
+    int y;      /**< Top of the shelf in the page. */
+    int height; /**< Height of the tallest image of the shelf. */
+    int width;  /**< Width used by the images of the shelf. */
+  };
+
+  /**
+   * @brief A texture shared by several images
+   */
+  struct Page {
+    std::weak_ptr<GlTexture> texture; /**< Texture of the page, alive while
+                                       * some image uses it. */
+    std::vector<Shelf> shelves;       /**< Rows of images. */
+    int height;                       /**< Height used by the shelves. */
+  };
+
+  bool allocate(Page& page, const Size& size, Point& position);
+
+  int page_size;
+  int max_image_size;
+  std::vector<Page> pages;
+};
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "solarus/graphics/SurfacePtr.h"
+#include "solarus/graphics/TileMesh.h"
+#include "solarus/graphics/SolarusGl.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * @brief Tile mesh stored in an OpenGL vertex buffer
+ *
+ * The vertices of all tiles are uploaded once. Each vertex knows its corner
+ * in the tile, the size of the tile, its slot and whether the tile has
+ * parallax or self scrolling: the tile shader computes the position on the
+ * destination and the image coordinates from the viewport and the slot
+ * offsets, which are the only data sent at each frame.
+ */
+class GlTileMesh : public TileMesh
+{
+public:
+  GlTileMesh(const SurfacePtr& image, const std::vector<Quad>& quads);
+  ~GlTileMesh() override;
+
+  void set_slot_offset(int slot, const Point& offset) override;
+  void draw(Surface& dst_surface, const Point& viewport, size_t first_quad, size_t num_quads) override;
+
+  static const std::string& get_vertex_source();
+  static const std::string& get_fragment_source();
+
+private:
+  SurfacePtr image;                               /**< Image of the tiles. */
+  size_t num_quads;                               /**< Number of tiles in the buffers. */
+  GLuint vbo = 0;                                 /**< Vertices of the tiles. */
+  GLuint ibo = 0;                                 /**< Indices of the tiles. */
+  std::array<GLfloat, 2 * max_slots> slot_offsets; /**< Offset of the current frame of each slot. */
+  std::array<GLfloat, 4 * max_repeats> repeats;    /**< Image origin and map position of each
+                                                    * repeated quad. */
+};
+
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <SDL_render.h>
+#include <SDL_version.h>
 #include <solarus/graphics/Renderer.h>
+#include <vector>
 
 
 namespace Solarus {
@@ -14,8 +16,15 @@ namespace Solarus {
 
 #define SOLARUS_CHECK_SDL(expr) SOLARUS_CHECK_SDL_HIGHER(expr,0)
 
+class SDLSurfaceImpl;
+
 /**
  * @brief Legacy SDL renderer, used for window-less tests
+ *
+ * With SDL 2.0.18 or later, consecutive draws of the same texture with the
+ * same blend mode are accumulated and submitted at once with
+ * SDL_RenderGeometry. Rotated draws and regions outside of the source
+ * still use one SDL_RenderCopyEx each.
  */
 class SDLRenderer : public Renderer {
   friend class SDLSurfaceImpl;
@@ -40,10 +49,15 @@ public:
   void draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos) override;
   void clear(SurfaceImpl& dst) override;
   void fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode = BlendMode::BLEND) override;
+  void draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode = BlendMode::BLEND) override;
   void invalidate(const SurfaceImpl& surf) override;
   std::string get_name() const override;
   void present(SDL_Window* window) override;
   void on_window_size_changed(const Rectangle& viewport) override;
+  void flush_batch();
+  static void on_texture_destroyed(const SDLSurfaceImpl& surf);
+  static void set_batching_enabled(bool enabled);
+  static bool is_batching_enabled();
   static SDLRenderer& get(){
     return *instance;
   }
@@ -56,9 +70,11 @@ public:
   ~SDLRenderer() override;
 private:
   static SDLRenderer* instance;
+  static bool batching_enabled;
 
   SDL_BlendMode make_sdl_blend_mode(const SurfaceImpl &dst_surface, const SurfaceImpl &src_surface, BlendMode blend_mode);
   SDL_BlendMode make_sdl_blend_mode(BlendMode blend_mode);
+  void set_draw_color(const Color& color, BlendMode mode);
 
   SDL_Surface_UniquePtr software_screen;
   SDL_Texture*  render_target = nullptr;
@@ -66,5 +82,14 @@ private:
   SDL_Renderer* renderer;
   bool shaders = false;
   SurfaceDraw surface_draw;
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+  bool add_to_batch(const SDLSurfaceImpl& src, const DrawInfos& infos, SDL_BlendMode mode);
+
+  const SDLSurfaceImpl* batch_source = nullptr;      /**< Surface read by the pending batch. */
+  SDL_BlendMode batch_blend_mode = SDL_BLENDMODE_NONE; /**< Blend mode of the pending batch. */
+  std::vector<SDL_Vertex> batch_vertices;            /**< Corners of the pending sprites. */
+  std::vector<int> batch_indices;                    /**< Two triangles per pending sprite. */
+#endif
 };
 }
@@ -29,6 +29,7 @@
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "../SolarusGl.h"
 
@@ -49,19 +50,21 @@ class SOLARUS_API SDLShader : public Shader {
     static bool initialize();
     static void quit();
 
-    void set_uniform_1b(
-        const std::string& uniform_name, bool value) override;
-    void set_uniform_1i(
-        const std::string& uniform_name, int value) override;
-     void set_uniform_1f(
-        const std::string& uniform_name, float value) override;
-     void set_uniform_2f(
-        const std::string& uniform_name, float value_1, float value_2) override;
-     void set_uniform_3f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3) override;
-     void set_uniform_4f(
-        const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) override;
-     bool set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) override;
+    using Shader::set_uniform_1b;
+    using Shader::set_uniform_1i;
+    using Shader::set_uniform_1f;
+    using Shader::set_uniform_2f;
+    using Shader::set_uniform_3f;
+    using Shader::set_uniform_4f;
+    using Shader::set_uniform_texture;
+
+    void set_uniform_1b(int handle, bool value) override;
+    void set_uniform_1i(int handle, int value) override;
+    void set_uniform_1f(int handle, float value) override;
+    void set_uniform_2f(int handle, float value_1, float value_2) override;
+    void set_uniform_3f(int handle, float value_1, float value_2, float value_3) override;
+    void set_uniform_4f(int handle, float value_1, float value_2, float value_3, float value_4) override;
+    bool set_uniform_texture(int handle, const SurfacePtr& value) override;
 
     void render(const Surface& surface, const Rectangle& region, const Size& dst_size, const Point& dst_position = Point(), bool flip_y = false);
     void draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const override;
@@ -78,6 +81,9 @@ class SOLARUS_API SDLShader : public Shader {
                         const glm::mat4& mvp_matrix = glm::mat4(1.f),
                         const glm::mat3& uv_matrix = glm::mat3(1.f));
 
+  protected:
+    void resolve_uniform(int handle, const std::string& uniform_name) override;
+
   private:
     void compile();
     static std::string sanitize_shader_source(const std::string source);
@@ -119,6 +125,7 @@ class SOLARUS_API SDLShader : public Shader {
         uniform_locations;                       /**< Cache of uniform locations. */
     mutable std::map<std::string, TextureUniform>
         uniform_textures;                        /**< Uniform texture value of surfaces. */
+    std::vector<GLint> handle_locations;         /**< Location of each uniform handle. */
     std::unordered_map<GLuint, GLint> attribute_states;    /**< Previous attrib states. */
     GLuint current_texture_unit = 0;
 };
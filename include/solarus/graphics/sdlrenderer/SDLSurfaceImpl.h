@@ -1,5 +1,6 @@
 #pragma once
 
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Point.h"
 #include "solarus/graphics/SDLPtrs.h"
@@ -20,9 +21,13 @@ class SDLSurfaceImpl : public SurfaceImpl
 public:
   SDLSurfaceImpl(SDL_Renderer* renderer, int width, int height, bool screen_tex = false);
   SDLSurfaceImpl(SDL_Renderer* renderer, SDL_Surface_UniquePtr surface);
+  ~SDLSurfaceImpl() override;
 
   SDL_Texture* get_texture() const;
   SDL_Surface* get_surface() const override;
+  void set_blend_mode(SDL_BlendMode mode) const;
+  void set_alpha_mod(Uint8 alpha) const;
+  void set_color_mod(Uint8 color) const;
 
   SDLSurfaceImpl& targetable();
 
@@ -36,11 +41,20 @@ public:
    * to upload it to the texture for changes to be reflected
    */
   void upload_surface() override;
+  void upload_region(const Rectangle& region) override;
 private:
   bool target = false;
   mutable bool surface_dirty = true;
   mutable SDL_Texture_UniquePtr texture;
   mutable SDL_Surface_UniquePtr surface;
+  mutable bool blend_mode_known = false;              /**< Whether blend_mode is the one of the texture. */
+  mutable SDL_BlendMode blend_mode = SDL_BLENDMODE_NONE; /**< Last blend mode set on the texture. */
+  mutable bool alpha_mod_known = false;               /**< Whether alpha_mod is the one of the texture. */
+  mutable Uint8 alpha_mod = 255;                      /**< Last alpha modulation set on the texture. */
+  mutable bool color_mod_known = false;               /**< Whether color_mod is the one of the texture. */
+  mutable Uint8 color_mod = 255;                      /**< Last gray color modulation set on the texture. */
+  MemoryUsage::Tracker memory_tracker{
+      MemoryUsage::Category::TEXTURES};               /**< Memory of the SDL texture. */
 };
 
 }
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <solarus/graphics/Renderer.h>
+#include <SDL_surface.h>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+class SoftwareSurfaceImpl;
+
+/**
+ * @brief Renderer drawing with the CPU only, used when software rendering
+ * is forced
+ *
+ * Draws, fills and lines made on the same surface are accumulated in a
+ * batch. When the batch is flushed, the rows of the surface are split into
+ * bands drawn in parallel by the PixelFilterExecutor, each band executing
+ * all commands of the batch in order. Blended rows use SSE2 when SIMD is
+ * enabled, and scaled draws use nearest neighbour sampling like
+ * SDL_RenderCopy. The result is copied to the window surface by present().
+ */
+class SoftwareRenderer : public Renderer {
+  friend class SoftwareSurfaceImpl;
+  friend class SoftwareShader;
+  /**
+   * @brief terminal DrawProxy for simple surface draw
+   */
+  struct SurfaceDraw : public DrawProxy {
+    virtual void draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& params) const override;
+  };
+public:
+  SoftwareRenderer();
+  static RendererPtr create(SDL_Window* window, bool force_software);
+  SurfaceImplPtr create_texture(int width, int height) override;
+  SurfaceImplPtr create_texture(SDL_Surface_UniquePtr &&surface) override;
+  SurfaceImplPtr create_window_surface(SDL_Window* w, int width, int height) override;
+  ShaderPtr create_shader(const std::string& shader_id) override;
+  ShaderPtr create_shader(const std::string& vertex_source, const std::string& fragment_source, double scaling_factor) override;
+  void bind_as_gl_target(SurfaceImpl& surf) override;
+  void bind_as_gl_texture(const SurfaceImpl& surf) override;
+  void draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos) override;
+  void clear(SurfaceImpl& dst) override;
+  void fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode = BlendMode::BLEND) override;
+  void draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode = BlendMode::BLEND) override;
+  void invalidate(const SurfaceImpl& surf) override;
+  std::string get_name() const override;
+  void present(SDL_Window* window) override;
+  void on_window_size_changed(const Rectangle& viewport) override;
+  FrameStats get_last_frame_stats() const override;
+  void flush_batch();
+  static void on_surface_destroyed(const SoftwareSurfaceImpl& surf);
+  static void set_enabled(bool enabled);
+  static bool is_enabled();
+  static SoftwareRenderer& get(){
+    return *instance;
+  }
+  const DrawProxy& default_terminal() const override {
+    return surface_draw;
+  }
+  ~SoftwareRenderer() override;
+private:
+  /**
+   * @brief how a source pixel is combined with a destination pixel,
+   * like the SDL blend mode chosen by SDLRenderer
+   */
+  enum class PixelOp {
+    COPY,                   /**< dst = src */
+    BLEND,                  /**< dst = src * srcA + dst * (1 - srcA) */
+    PREMULTIPLIED_BLEND,    /**< dst = src + dst * (1 - srcA) */
+    ADD,                    /**< dstRGB = dstRGB + srcRGB * srcA */
+    MULTIPLY,               /**< dstRGB = srcRGB * dstRGB */
+    PREMULTIPLIED_MULTIPLY  /**< dst = src * dst + dst * (1 - srcA) */
+  };
+
+  /**
+   * @brief a pending draw, fill or line
+   */
+  struct Command {
+    const SoftwareSurfaceImpl* source = nullptr; /**< Surface drawn, or nullptr for a solid color. */
+    Rectangle region;           /**< Region of the source drawn. */
+    Rectangle dst;              /**< Destination of the region, or rectangle filled. */
+    Rectangle bounds;           /**< Pixels possibly written, inside the target. */
+    bool line = false;          /**< Whether this is a line from dst's corner to line_end. */
+    Point line_end;             /**< Last pixel of the line. */
+    bool flip_x = false;        /**< Whether the source is read from right to left. */
+    bool flip_y = false;        /**< Whether the source is read from bottom to top. */
+    bool rotated = false;       /**< Whether dst is rotated around center. */
+    double center_x = 0.0;      /**< Center of the rotation. */
+    double center_y = 0.0;
+    double cos_angle = 1.0;     /**< Cosine of the clockwise rotation. */
+    double sin_angle = 0.0;     /**< Sine of the clockwise rotation. */
+    uint32_t color = 0;         /**< Pixel of a solid color. */
+    PixelOp op = PixelOp::BLEND;
+    uint8_t color_mod = 255;    /**< Modulation of the source color. */
+    uint8_t alpha_mod = 255;    /**< Modulation of the source alpha. */
+  };
+
+  static SoftwareRenderer* instance;
+  static bool enabled;
+
+  void set_target(const SoftwareSurfaceImpl& target);
+  void add_to_batch(const SoftwareSurfaceImpl* source);
+  void discard_batch();
+  void set_pixel_op(Command& command, const SurfaceImpl& dst, const SurfaceImpl& src, BlendMode mode, uint8_t opacity) const;
+  void set_color(Command& command, const Color& color, BlendMode mode) const;
+  void execute(const Command& command, int first_row, int end_row, std::vector<uint32_t>& row_buffer) const;
+  void execute_rotated(const Command& command, int first_row, int end_row, std::vector<uint32_t>& row_buffer) const;
+  void execute_line(const Command& command, int first_row, int end_row) const;
+  void blend_row(const Command& command, uint32_t* dst, const uint32_t* src, int num_pixels) const;
+  void blend_pixels(const Command& command, uint32_t* dst, const uint32_t* src, int num_pixels) const;
+
+  static constexpr int
+      min_pixels_per_job = 16384;  /**< Smaller batches are drawn by the calling thread only. */
+
+  const SoftwareSurfaceImpl* batch_target = nullptr;     /**< Surface written by the pending batch. */
+  std::vector<Command> batch;                            /**< Pending commands. */
+  std::vector<const SoftwareSurfaceImpl*> batch_sources; /**< Surfaces read by the pending batch. */
+  std::vector<SurfaceImplPtr> batch_copies;              /**< Copies of surfaces drawn on themselves. */
+  int64_t batch_pixels = 0;                              /**< Area of the pending commands. */
+  const SoftwareSurfaceImpl* window_surface = nullptr;   /**< Surface copied to the window. */
+  Rectangle viewport;                                    /**< Where the window surface goes in the window. */
+  int alpha_shift = 24;                                  /**< Position of the alpha byte in pixels. */
+  bool simd = false;                                     /**< Whether blended rows use SSE2. */
+  FrameStats frame_stats;                                /**< Statistics of the current frame. */
+  FrameStats last_frame_stats;                           /**< Statistics of the last presented frame. */
+  SurfaceDraw surface_draw;
+};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "solarus/core/Common.h"
+#include "solarus/graphics/Shader.h"
+#include <string>
+
+namespace Solarus {
+
+/**
+ * @brief Shader of the software renderer
+ *
+ * The software renderer cannot run GLSL programs: its shaders are never
+ * valid and draw surfaces like the default terminal.
+ */
+class SOLARUS_API SoftwareShader : public Shader {
+  public:
+    explicit SoftwareShader(const std::string& shader_id);
+    SoftwareShader(const std::string& vertex_source,
+                   const std::string& fragment_source,
+                   double scaling_factor);
+
+    using Shader::set_uniform_1b;
+    using Shader::set_uniform_1i;
+    using Shader::set_uniform_1f;
+    using Shader::set_uniform_2f;
+    using Shader::set_uniform_3f;
+    using Shader::set_uniform_4f;
+    using Shader::set_uniform_texture;
+
+    void set_uniform_1b(int handle, bool value) override;
+    void set_uniform_1i(int handle, int value) override;
+    void set_uniform_1f(int handle, float value) override;
+    void set_uniform_2f(int handle, float value_1, float value_2) override;
+    void set_uniform_3f(int handle, float value_1, float value_2, float value_3) override;
+    void set_uniform_4f(int handle, float value_1, float value_2, float value_3, float value_4) override;
+    bool set_uniform_texture(int handle, const SurfacePtr& value) override;
+
+    void draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const override;
+
+  protected:
+    void resolve_uniform(int handle, const std::string& uniform_name) override;
+};
+
+}
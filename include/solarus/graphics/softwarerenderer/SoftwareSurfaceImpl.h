@@ -0,0 +1,43 @@
+#pragma once
+
+#include "solarus/core/MemoryUsage.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/SurfaceImpl.h"
+
+#include <SDL_surface.h>
+#include <cstdint>
+
+namespace Solarus {
+
+/**
+ * @brief Surface of the software renderer, whose pixels are only in main memory
+ *
+ * Draws on the surface are executed later by the renderer: get_surface()
+ * executes them first if the pending batch reads or writes this surface.
+ */
+class SoftwareSurfaceImpl : public SurfaceImpl
+{
+  friend class SoftwareRenderer;
+public:
+  SoftwareSurfaceImpl(int width, int height);
+  explicit SoftwareSurfaceImpl(SDL_Surface_UniquePtr surface);
+  ~SoftwareSurfaceImpl() override;
+
+  SDL_Surface* get_surface() const override;
+
+  int get_width() const override;
+  int get_height() const override;
+
+  void upload_surface() override;
+  void upload_region(const Rectangle& region) override;
+private:
+  uint32_t* get_row(int y) const;
+
+  SDL_Surface_UniquePtr surface;    /**< The pixels, in the format of Video::get_pixel_format(). */
+  mutable bool in_batch = false;    /**< Whether the pending batch reads or writes this surface. */
+  MemoryUsage::Tracker memory_tracker{
+      MemoryUsage::Category::TEXTURES};  /**< Memory of the pixels. */
+};
+
+}
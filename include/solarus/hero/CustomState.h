@@ -18,9 +18,11 @@
 #define SOLARUS_HERO_CUSTOM_STATE_H
 
 #include "solarus/core/Common.h"
+#include "solarus/entities/EntityType.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/TraversableInfo.h"
 #include "solarus/hero/HeroState.h"
+#include <array>
 #include <set>
 
 namespace Solarus {
@@ -74,12 +76,16 @@ class CustomState: public HeroState {
     bool get_can_control_movement() const override;
 
     void set_can_traverse_entities(bool traversable);
-    void set_can_traverse_entities(const ScopedLuaRef& traversable_test_ref);
+    void set_can_traverse_entities(
+        const ScopedLuaRef& traversable_test_ref,
+        bool pure
+    );
     void reset_can_traverse_entities();
     void set_can_traverse_entities(EntityType type, bool traversable);
     void set_can_traverse_entities(
         EntityType type,
-        const ScopedLuaRef& traversable_test_ref
+        const ScopedLuaRef& traversable_test_ref,
+        bool pure
     );
     void reset_can_traverse_entities(EntityType type);
 
@@ -244,9 +250,15 @@ class CustomState: public HeroState {
         carried_object;                    /**< Object carried by the entity if any. */
     TraversableInfo
         can_traverse_entities_general;     /**< Whether the entity can traverse other entities by default. */
-    std::map<EntityType, TraversableInfo>
-        can_traverse_entities_type;        /**< Whether the entity can traverse entities of a type. */
-    std::map<Ground, bool>
+    static constexpr size_t num_entity_types =
+        static_cast<size_t>(EntityType::HOOKSHOT) + 1;
+    static constexpr size_t num_grounds =
+        static_cast<size_t>(Ground::LAVA) + 1;
+
+    std::array<TraversableInfo, num_entity_types>
+        can_traverse_entities_type;        /**< Whether the entity can traverse entities of a type.
+                                            * Empty infos use the general setting. */
+    std::array<bool, num_grounds>
         can_traverse_grounds;              /**< Whether the entity can traverse each kind of ground. */
 };
 
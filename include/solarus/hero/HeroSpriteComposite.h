@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_HERO_SPRITE_COMPOSITE_H
+#define SOLARUS_HERO_SPRITE_COMPOSITE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Symbol.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Camera;
+class Map;
+class Sprite;
+class SpriteAnimationSet;
+
+/**
+ * \brief Frames of the hero's sprites merged into one image.
+ *
+ * Each combination of visible sprites, animations, directions and frames
+ * is drawn once into a shared surface. The hero is then drawn as a single
+ * region of this surface instead of drawing each of its sprites.
+ *
+ * Only sprites drawn without any effect can be merged: when a sprite
+ * blinks or has a blend mode, an opacity, a color modulation,
+ * a transformation, a shader or a transition, the sprites are drawn
+ * separately as usual.
+ */
+class HeroSpriteComposite {
+
+  public:
+
+    HeroSpriteComposite();
+
+    bool draw(
+        Map& map,
+        const std::vector<Entity::NamedSprite>& sprites,
+        const Point& xy,
+        const Rectangle& clipping_area
+    );
+    void clear();
+
+    static constexpr int width = 512;             /**< Width of the surface. */
+    static constexpr int initial_height = 64;     /**< Height of a new surface. */
+    static constexpr int max_height = 1024;       /**< Maximum height of the surface. */
+
+  private:
+
+    /**
+     * \brief State of a visible sprite in a merged frame.
+     */
+    struct Layer {
+      const SpriteAnimationSet* animation_set;    /**< Animation set of the sprite. */
+      Symbol animation;                           /**< Current animation. */
+      int direction;                              /**< Current direction. */
+      int frame;                                  /**< Current frame. */
+      Point xy;                                   /**< Offset of the sprite. */
+
+      bool operator==(const Layer& other) const;
+    };
+
+    /**
+     * \brief Hash function of lists of layers.
+     */
+    struct LayersHash {
+      size_t operator()(const std::vector<Layer>& layers) const;
+    };
+
+    /**
+     * \brief A merged frame.
+     */
+    struct Frame {
+      Rectangle region;                           /**< Region of the surface. */
+      Point offset;                               /**< Position of the region
+                                                   * relative to the hero. */
+    };
+
+    static bool is_mergeable(Sprite& sprite);
+    const Frame* get_frame();
+    bool add_frame(Frame& frame);
+    bool reserve(const Size& size, Point& position);
+
+    SurfacePtr surface;                           /**< Frames merged so far. */
+    std::unordered_map<std::vector<Layer>, Frame, LayersHash>
+        frames;                                   /**< Frames merged so far. */
+    std::vector<Layer> layers;                    /**< Layers of the current frame. */
+    std::vector<const Sprite*> layer_sprites;     /**< Sprites of the current frame. */
+    Point row_position;                           /**< Where the next frame of the
+                                                   * current row goes. */
+    int row_height;                               /**< Height of the tallest frame
+                                                   * of the current row. */
+
+};
+
+}
+
+#endif
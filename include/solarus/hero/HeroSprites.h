@@ -21,6 +21,7 @@
 #include "solarus/core/Rectangle.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/graphics/SpritePtr.h"
+#include "solarus/hero/HeroSpriteComposite.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <memory>
 #include <string>
@@ -74,6 +75,8 @@ class HeroSprites {
     void set_clipping_rectangle(
         const Rectangle& clipping_rectangle = Rectangle()
     );
+    bool is_composition_enabled() const;
+    void set_composition_enabled(bool composition_enabled);
 
     int get_animation_direction(
         int keys_direction, int real_movement_direction) const;
@@ -210,6 +213,9 @@ class HeroSprites {
                                              * (usually, the whole map is considered and this rectangle's values are all 0) */
     std::shared_ptr<CarriedObject>
         lifted_item;                        /**< if not nullptr, an item to display above the hero */
+    std::unique_ptr<HeroSpriteComposite>
+        composite;                          /**< Merged frames of the sprites,
+                                             * nullptr if sprites are drawn separately. */
 
     ScopedLuaRef animation_callback_ref;    /**< Lua ref of a function to call when a custom animation ends. */
 };
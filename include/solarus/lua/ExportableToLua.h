@@ -18,6 +18,7 @@
 #define SOLARUS_EXPORTABLE_TO_LUA_H
 
 #include "solarus/core/Common.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -25,6 +26,22 @@ namespace Solarus {
 
 class LuaContext;
 
+/**
+ * \brief Events that the engine tries to call on userdata very often.
+ *
+ * The Lua context keeps track of which userdata and which types define
+ * them, so that it does not have to look them up in Lua every time.
+ */
+enum class LuaEvent {
+  ON_UPDATE,
+  ON_SUSPENDED,
+  ON_PRE_DRAW,
+  ON_DRAW,
+  ON_POST_DRAW,
+  ON_POSITION_CHANGED,
+  ON_MOVEMENT_CHANGED
+};
+
 /**
  * \brief Interface of a C++ type that can also exist as a Lua userdata.
  *
@@ -45,6 +62,11 @@ class ExportableToLua:
     void set_known_to_lua(bool known_to_lua);
     bool is_with_lua_table() const;
     void set_with_lua_table(bool with_lua_table);
+    bool has_lua_event(LuaEvent event) const;
+    void set_lua_event(LuaEvent event, bool defined);
+    void clear_lua_events();
+    int get_lua_slot() const;
+    void set_lua_slot(int lua_slot);
     virtual const std::string& get_lua_type_name() const;
 
   private:
@@ -56,6 +78,10 @@ class ExportableToLua:
                                   * at least once. */
     bool with_lua_table;         /**< Whether a Lua table was created to make
                                   * this userdata indexable like a table. */
+    uint32_t lua_events;         /**< Bit mask of the events defined in the
+                                  * Lua table of this userdata. */
+    int lua_slot;                /**< Index of this userdata in the userdata
+                                  * slots of the Lua context, or 0. */
 
 };
 
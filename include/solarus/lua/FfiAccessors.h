@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FFI_ACCESSORS_H
+#define SOLARUS_FFI_ACCESSORS_H
+
+#include "solarus/core/Common.h"
+#include <stdint.h>
+
+/**
+ * \file FfiAccessors.h
+ * \brief C functions that read hot properties of objects exported to Lua.
+ *
+ * With LuaJIT, the engine binds them through the FFI library so that
+ * JIT-compiled scripts can call them without leaving traces.
+ * They take the address of the userdata block of an object, which is what
+ * the FFI passes for a userdata given as a <tt>const void*</tt> argument.
+ * The caller must make sure that the userdata has the expected type,
+ * for example by checking its metatable.
+ *
+ * These functions never call Lua and never throw.
+ * This interface is stable: new functions may be added but existing ones
+ * keep their signature.
+ */
+
+extern "C" {
+
+/**
+ * \brief A position on the map.
+ */
+typedef struct solarus_position {
+  int x;
+  int y;
+  int layer;
+} solarus_position;
+
+/**
+ * \brief A rectangle on the map.
+ */
+typedef struct solarus_rectangle {
+  int x;
+  int y;
+  int width;
+  int height;
+} solarus_rectangle;
+
+SOLARUS_API void solarus_entity_get_position(const void* entity, solarus_position* position);
+SOLARUS_API void solarus_entity_get_center_position(const void* entity, solarus_position* position);
+SOLARUS_API void solarus_entity_get_bounding_box(const void* entity, solarus_rectangle* bounding_box);
+SOLARUS_API int solarus_straight_movement_get_speed(const void* movement);
+SOLARUS_API double solarus_straight_movement_get_angle(const void* movement);
+SOLARUS_API uint8_t* solarus_pixel_buffer_get_data(const void* pixel_buffer);
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LUA_ALLOCATOR_H
+#define SOLARUS_LUA_ALLOCATOR_H
+
+#include "solarus/core/Common.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Memory allocator of a Lua state.
+ *
+ * Small blocks, which are most of the tables, closures, strings and userdata
+ * created by scripts, are taken from pools of fixed size classes. Each class
+ * has a free list of released blocks and carves new ones from big chunks.
+ * Larger blocks go to the system allocator.
+ *
+ * An allocator belongs to one Lua state, and a Lua state is only used by
+ * one thread at a time: free lists need no lock. Chunks are only released
+ * when the allocator is destroyed, after the Lua state is closed.
+ *
+ * The allocator also counts allocations and live bytes.
+ */
+class SOLARUS_API LuaAllocator {
+
+  public:
+
+    /**
+     * \brief Counters of the allocator.
+     */
+    struct Stats {
+      int64_t live_bytes = 0;         /**< Bytes currently allocated by Lua. */
+      int64_t pool_bytes = 0;         /**< Bytes of the chunks of all pools. */
+      int64_t large_bytes = 0;        /**< Bytes of the blocks from the system allocator. */
+      int64_t num_allocations = 0;    /**< Total number of allocations. */
+      int64_t frame_allocations = 0;  /**< Allocations during the previous frame. */
+    };
+
+    LuaAllocator();
+    ~LuaAllocator();
+
+    LuaAllocator(const LuaAllocator& other) = delete;
+    LuaAllocator& operator=(const LuaAllocator& other) = delete;
+
+    const Stats& get_stats() const;
+    void start_frame();
+
+    static void* allocate(void* ud, void* ptr, size_t old_size, size_t new_size);
+
+    static constexpr size_t
+        granularity = 16;             /**< Difference between two size classes,
+                                       * and alignment of blocks. */
+    static constexpr size_t
+        max_small_size = 256;         /**< Larger blocks use the system allocator. */
+    static constexpr size_t
+        chunk_size = 64 * 1024;       /**< Bytes of the chunks where blocks are carved. */
+
+  private:
+
+    /**
+     * \brief A released block, linked to the next free block of its class.
+     */
+    struct FreeBlock {
+      FreeBlock* next;                /**< Next free block or nullptr. */
+    };
+
+    /**
+     * \brief Blocks of one size class.
+     */
+    struct Pool {
+      FreeBlock* free_list = nullptr; /**< Released blocks. */
+      char* next_block = nullptr;     /**< Next never used block of the current chunk. */
+      char* chunk_end = nullptr;      /**< End of the current chunk. */
+    };
+
+    static constexpr size_t
+        num_classes = max_small_size / granularity;
+
+    static size_t get_class(size_t size);
+    void* allocate_small(size_t size);
+    void free_small(void* ptr, size_t size);
+    void* reallocate(void* ptr, size_t old_size, size_t new_size);
+
+    std::array<Pool, num_classes> pools;  /**< Pool of each size class. */
+    std::vector<char*> chunks;            /**< All chunks of all pools. */
+    Stats stats;                          /**< Counters. */
+    int64_t frame_start_allocations;      /**< Allocations when the frame started. */
+};
+
+}
+
+#endif
@@ -34,14 +34,17 @@
 #include "solarus/graphics/ShaderPtr.h"
 #include "solarus/graphics/SpritePtr.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include "solarus/lua/ExportableToLua.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <array>
 #include <list>
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 #include <string>
 #include <vector>
 #include <queue>
@@ -62,6 +65,7 @@ class Destructible;
 class Dialog;
 class Door;
 class Drawable;
+class DrawList;
 class DynamicTile;
 class Enemy;
 class EnemyReaction;
@@ -77,11 +81,14 @@ class Movement;
 class Npc;
 class PathFindingMovement;
 class PathMovement;
+class PixelBuffer;
 class PixelMovement;
 class Pickable;
 class Point;
 class RandomMovement;
+class RandomStream;
 class RandomPathMovement;
+class SavegameValueHandle;
 class Sensor;
 class Separator;
 class Shader;
@@ -98,6 +105,7 @@ class Timer;
 class Treasure;
 
 class Arguments;
+class LuaAllocator;
 
 using EntityVector = std::vector<EntityPtr>;
 
@@ -136,7 +144,12 @@ class LuaContext {
     static const std::string menu_module_name;
     static const std::string language_module_name;
     static const std::string shader_module_name;
+    static const std::string pixel_buffer_module_name;
+    static const std::string draw_list_module_name;
+    static const std::string random_module_name;
     static const std::string state_module_name;
+    static const std::string task_module_name;
+    static const std::string worker_module_name;
     static const std::string movement_module_name;
     static const std::string movement_straight_module_name;
     static const std::string movement_random_module_name;
@@ -195,6 +208,10 @@ class LuaContext {
     bool is_luajit() const;
     std::string get_lua_version() const;
 
+    // Garbage collection.
+    void step_garbage_collector(uint32_t idle_time);
+    int get_memory_usage() const;
+
     // Lua refs.
     ScopedLuaRef create_ref();
     static void push_ref(lua_State* current_l, const ScopedLuaRef& ref);
@@ -254,6 +271,11 @@ class LuaContext {
         const ExportableToLua& userdata,
         const std::string& key
     ) const;
+    bool userdata_has_field(
+        const ExportableToLua& userdata,
+        LuaEvent event
+    ) const;
+    uint32_t get_lua_events_version() const;
     void notify_userdata_destroyed(ExportableToLua& userdata);
     void userdata_close_lua();
 
@@ -271,6 +293,11 @@ class LuaContext {
     void set_entity_timers_suspended_as_map(Entity& entity, bool suspended);
     void do_timer_callback(const TimerPtr& timer);
 
+    // Tasks.
+    void remove_tasks(int context_index);
+    void destroy_tasks();
+    void update_tasks();
+
     // Menus.
     void add_menu(
         const ScopedLuaRef& menu_ref,
@@ -297,8 +324,13 @@ class LuaContext {
     void stop_movement_on_point(const std::shared_ptr<Movement>& movement);
     void update_movements();
 
+    // Batched events.
+    void deliver_batched_events();
+    void clear_batched_events();
+
     // Maps.
     static void check_map_has_game(lua_State* current_l, const Map& map);
+    static std::string opt_transition_effect(lua_State* current_l, int index);
 
     // Entities.
     static const std::string& get_entity_internal_type_name(EntityType entity_type);
@@ -360,17 +392,11 @@ class LuaContext {
     // Menu events.
     void menu_on_started(const ScopedLuaRef& menu_ref);
     void menu_on_finished(const ScopedLuaRef& menu_ref);
-    void menu_on_update(const ScopedLuaRef& menu_ref);
-    void menu_on_draw(const ScopedLuaRef& menu_ref, const SurfacePtr& dst_surface);
-    bool menu_on_input(const ScopedLuaRef& menu_ref, const InputEvent& event);
-    bool menu_on_command_pressed(
-        const ScopedLuaRef& menu_ref,
-        GameCommand command
-    );
-    bool menu_on_command_released(
-        const ScopedLuaRef& menu_ref,
-        GameCommand command
-    );
+    void menu_on_update(size_t menu_index);
+    void menu_on_draw(size_t menu_index, const SurfacePtr& dst_surface);
+    bool menu_on_input(size_t menu_index, const InputEvent& event);
+    bool menu_on_command_pressed(size_t menu_index, GameCommand command);
+    bool menu_on_command_released(size_t menu_index, GameCommand command);
     void menus_on_update(int context_index);
     void menus_on_draw(int context_index, const SurfacePtr& dst_surface);
     bool menus_on_input(int context_index, const InputEvent& event);
@@ -386,12 +412,14 @@ class LuaContext {
         Sprite& sprite, const std::string& animation, int direction);
     void sprite_on_frame_changed(
         Sprite& sprite, const std::string& animation, int frame);
+    bool is_sprite_frame_change_observed(const Sprite& sprite);
 
     // Movement events.
     void movement_on_position_changed(Movement& movement, const Point& xy);
     void movement_on_obstacle_reached(Movement& movement);
     void movement_on_changed(Movement& movement);
     void movement_on_finished(Movement& movement);
+    void movement_on_path_ready(Movement& movement, const std::string& path);
 
     // Equipment item events.
     void item_on_created(EquipmentItem& item);
@@ -416,6 +444,7 @@ class LuaContext {
     void game_on_started(Game& game);
     void game_on_finished(Game& game);
     void game_on_update(Game& game);
+    void game_on_values_changed(Game& game, const std::set<std::string>& keys);
     void game_on_draw(Game& game, const SurfacePtr& dst_surface);
     void game_on_map_changed(Game& game, Map& map);
     void game_on_world_changed(
@@ -450,6 +479,8 @@ class LuaContext {
     bool map_on_input(Map& map, const InputEvent& event);
     bool map_on_command_pressed(Map& map, GameCommand command);
     bool map_on_command_released(Map& map, GameCommand command);
+    void map_on_chunk_activated(Map& map, int column, int row);
+    void map_on_chunk_deactivated(Map& map, int column, int row);
 
     // Map entity events.
     void entity_on_update(Entity& entity);
@@ -582,16 +613,38 @@ class LuaContext {
       main_api_get_metatable,
       main_api_get_os,
       main_api_get_game,
+      main_api_preload_map,
+      main_api_start_profiler,
+      main_api_stop_profiler,
+      main_api_get_profiler_report,
+      main_api_get_gc_stats,
+      main_api_get_memory_stats,
+      main_api_get_frame_stats,
+      main_api_get_image_cache_stats,
+      main_api_get_memory_report,
+      main_api_get_map_cache_size,
+      main_api_set_map_cache_size,
+      main_api_get_event_batch_handler,
+      main_api_set_event_batch_handler,
 
       // Audio API.
       audio_api_get_sound_volume,
       audio_api_set_sound_volume,
       audio_api_play_sound,
       audio_api_preload_sounds,
+      audio_api_get_sound_max_instances,
+      audio_api_set_sound_max_instances,
+      audio_api_get_sound_priority,
+      audio_api_set_sound_priority,
       audio_api_get_music_volume,
       audio_api_set_music_volume,
       audio_api_play_music,
       audio_api_stop_music,
+      audio_api_preload_music,
+      audio_api_get_music_fade_duration,
+      audio_api_set_music_fade_duration,
+      audio_api_get_music_quality,
+      audio_api_set_music_quality,
       audio_api_get_music,
       audio_api_get_music_format,
       audio_api_get_music_num_channels,
@@ -618,6 +671,19 @@ class LuaContext {
       video_api_reset_window_size,
       video_api_get_shader,
       video_api_set_shader,
+      video_api_get_shader_resolution_bounds,
+      video_api_set_shader_resolution_bounds,
+      video_api_get_shader_resolution,
+      video_api_get_post_effects,
+      video_api_set_post_effects,
+      video_api_get_transition_effect,
+      video_api_set_transition_effect,
+      video_api_get_vsync_mode,
+      video_api_set_vsync_mode,
+      video_api_get_present_jitter,
+      video_api_start_recording,
+      video_api_stop_recording,
+      video_api_is_recording,
 
       // Input API.
       input_api_is_joypad_enabled,
@@ -642,6 +708,12 @@ class LuaContext {
       file_api_mkdir,
       file_api_is_dir,
       file_api_list_dir,
+      file_api_read_async,
+      file_api_write_async,
+
+      // Worker API.
+      worker_api_run,
+      worker_api_get_num_threads,
 
       // Menu API.
       menu_api_start,
@@ -663,6 +735,16 @@ class LuaContext {
       timer_api_set_suspended_with_map,
       timer_api_get_remaining_time,
       timer_api_set_remaining_time,
+
+      // Task API.
+      task_api_start,
+      task_api_stop,
+      task_api_is_running,
+      task_api_wait,
+      task_api_wait_frames,
+      task_api_wait_movement,
+      task_api_wait_animation,
+      task_api_wait_dialog,
       // TODO deprecate is_with_sound, set_with_sound (do this in pure Lua, possibly with a second timer)
 
       // Language API.
@@ -672,6 +754,7 @@ class LuaContext {
       language_api_get_languages,
       language_api_get_string,
       language_api_get_dialog,
+      language_api_preload_language,
 
       // Drawable API (i.e. common to surfaces, text surfaces and sprites).
       drawable_api_draw,
@@ -703,9 +786,12 @@ class LuaContext {
       surface_api_get_size,
       surface_api_clear,
       surface_api_fill_color,
+      surface_api_draw_line,
+      surface_api_draw_rectangle,
       surface_api_get_opacity,
       surface_api_set_opacity,
       surface_api_get_pixels,
+      surface_api_get_pixels_async,
       surface_api_set_pixels,
       surface_api_gl_bind_as_texture,
       surface_api_gl_bind_as_target,
@@ -729,6 +815,8 @@ class LuaContext {
       text_surface_api_set_text,
       text_surface_api_set_text_key,
       text_surface_api_get_size,
+      text_surface_api_get_visible_characters,
+      text_surface_api_set_visible_characters,
 
       // Sprite API.
       sprite_api_create,
@@ -754,11 +842,16 @@ class LuaContext {
       sprite_api_get_ignore_suspend,
       sprite_api_set_ignore_suspend,
       sprite_api_synchronize,
+      sprite_api_get_animation_lod,
+      sprite_api_set_animation_lod,
+      sprite_api_get_palette,
+      sprite_api_set_palette,
 
       // Shader API.
       shader_api_create,
       shader_api_get_opengl_version,
       shader_api_get_shading_language_version,
+      shader_api_preload,
       shader_api_get_id,
       shader_api_get_vertex_file,
       shader_api_get_vertex_source,
@@ -766,8 +859,39 @@ class LuaContext {
       shader_api_get_fragment_source,
       shader_api_get_scaling_factor,
       shader_api_set_scaling_factor,
+      shader_api_get_uniform_handle,
       shader_api_set_uniform,
 
+      // Pixel buffer API.
+      pixel_buffer_api_create,
+      pixel_buffer_api_get_size,
+      pixel_buffer_api_get_pixel,
+      pixel_buffer_api_set_pixel,
+      pixel_buffer_api_fill,
+      pixel_buffer_api_blit,
+      pixel_buffer_api_read,
+      pixel_buffer_api_upload,
+      pixel_buffer_api_get_dirty_region,
+      pixel_buffer_api_mark_dirty,
+      pixel_buffer_api_get_pointer,
+
+      // Draw list API.
+      draw_list_api_create,
+      draw_list_api_add,
+      draw_list_api_clear,
+      draw_list_api_get_num_surfaces,
+      draw_list_api_draw,
+
+      // Random API.
+      random_api_create,
+      random_api_get_number,
+      random_api_get_real,
+      random_api_stream_get_seed,
+      random_api_stream_set_seed,
+      random_api_stream_get_number,
+      random_api_stream_get_real,
+      random_api_stream_get_numbers,
+
       // Movement API.
       movement_api_create,
       movement_api_get_xy,
@@ -777,6 +901,8 @@ class LuaContext {
       movement_api_set_ignore_suspend,
       movement_api_get_ignore_obstacles,
       movement_api_set_ignore_obstacles,
+      movement_api_get_coalesce_moves,
+      movement_api_set_coalesce_moves,
       movement_api_start,
       movement_api_stop,
       movement_api_get_direction4,
@@ -801,6 +927,8 @@ class LuaContext {
       target_movement_api_get_angle,
       target_movement_api_is_smooth,
       target_movement_api_set_smooth,
+      target_movement_api_get_use_flow_field,
+      target_movement_api_set_use_flow_field,
       path_movement_api_get_path,
       path_movement_api_set_path,
       path_movement_api_get_speed,
@@ -817,6 +945,8 @@ class LuaContext {
       path_finding_movement_api_get_speed,
       path_finding_movement_api_set_speed,
       path_finding_movement_api_get_angle,
+      path_finding_movement_api_get_use_flow_field,
+      path_finding_movement_api_set_use_flow_field,
       circle_movement_api_get_center,
       circle_movement_api_set_center,
       circle_movement_api_get_radius,
@@ -857,6 +987,9 @@ class LuaContext {
       game_api_delete,
       game_api_load,
       game_api_save,  // TODO allow to change the file name (e.g. to copy)
+      game_api_save_async,
+      game_api_get_save_format,
+      game_api_set_save_format,
       game_api_start,
       game_api_is_started,
       game_api_is_suspended,
@@ -875,6 +1008,7 @@ class LuaContext {
       game_api_get_hero,
       game_api_get_value,
       game_api_set_value,
+      game_api_get_value_handle,
       game_api_get_starting_location,
       game_api_set_starting_location,
       game_api_get_transition_style,
@@ -969,6 +1103,8 @@ class LuaContext {
       map_api_get_camera_position,
       map_api_move_camera,
       map_api_get_ground,
+      map_api_get_ground_region,
+      map_api_get_obstacle_region,
       map_api_draw_visual,
       map_api_draw_sprite,
       map_api_get_crystal_state,
@@ -985,10 +1121,30 @@ class LuaContext {
       map_api_get_entities_by_type,
       map_api_get_entities_in_rectangle,
       map_api_get_entities_in_region,
+      map_api_get_entities_in_rectangle_count,
+      map_api_has_entities_in_rectangle,
+      map_api_get_first_entity_in_rectangle,
+      map_api_foreach_entity_in_rectangle,
+      map_api_get_region_at,
       map_api_get_hero,
       map_api_set_entities_enabled,
       map_api_remove_entities,
+      map_api_is_collision_batching_enabled,
+      map_api_set_collision_batching_enabled,
+      map_api_is_stream_field_enabled,
+      map_api_set_stream_field_enabled,
+      map_api_is_parallel_update_enabled,
+      map_api_set_parallel_update_enabled,
+      map_api_is_occlusion_culling_enabled,
+      map_api_set_occlusion_culling_enabled,
+      map_api_get_room_activation,
+      map_api_set_room_activation,
+      map_api_get_chunk_size,
+      map_api_set_chunk_size,
+      map_api_is_chunk_active,
+      map_api_preload_sprite_animations,
       map_api_create_entity,  // Same function used for all entity types.
+      map_api_create_entities,
 
       // Map entity API.
       entity_api_get_type,
@@ -1041,9 +1197,17 @@ class LuaContext {
       entity_api_stop_movement,
       entity_api_has_layer_independent_collisions,
       entity_api_set_layer_independent_collisions,
+      entity_api_get_collision_category,
+      entity_api_set_collision_category,
+      entity_api_get_collision_mask,
+      entity_api_set_collision_mask,
       entity_api_test_obstacles,
       entity_api_get_optimization_distance,
       entity_api_set_optimization_distance,
+      entity_api_get_update_policy,
+      entity_api_set_update_policy,
+      entity_api_is_interpolated,
+      entity_api_set_interpolated,
       entity_api_is_in_same_region,
       entity_api_get_state,
       entity_api_get_property,
@@ -1070,6 +1234,8 @@ class LuaContext {
       hero_api_set_shield_sprite_id,
       hero_api_is_blinking,
       hero_api_set_blinking,
+      hero_api_is_sprite_composition_enabled,
+      hero_api_set_sprite_composition_enabled,
       hero_api_is_invincible,
       hero_api_set_invincible,
       hero_api_get_carried_object,
@@ -1296,6 +1462,8 @@ class LuaContext {
       userdata_meta_gc,
       userdata_meta_newindex_as_table,
       userdata_meta_index_as_table,
+      metatable_meta_newindex,
+      menu_meta_newindex,
 
       // Lua backtrace error function
       l_backtrace;
@@ -1307,6 +1475,92 @@ class LuaContext {
     std::string lua_version;   /**< Holds the version of the current Lua runtime. */
     void find_lua_version();
 
+    // Compiled scripts.
+    int load_script_source(const std::string& file_name, const std::string& source);
+    std::string get_script_cache_file_name(
+        const std::string& file_name,
+        const std::string& source
+    ) const;
+    static bool read_script_cache(const std::string& cache_file_name, std::string& bytecode);
+    static void write_script_cache(const std::string& cache_file_name, const std::string& bytecode);
+    bool dump_function(std::string& bytecode);
+
+    bool script_cache_enabled = true;  /**< Whether compiled scripts are cached
+                                        * in memory and in the quest write directory. */
+    std::map<std::string, std::string>
+        compiled_scripts;              /**< Bytecode of each script file already
+                                        * compiled during this run. */
+
+    /**
+     * \brief How the Lua garbage collector is scheduled.
+     */
+    enum class GcMode {
+      AUTO,           /**< Only when the allocator decides to. */
+      FRAME,          /**< Also incremental steps in the idle time of frames. */
+      GENERATIONAL    /**< Generational collector, also stepped in the idle
+                       * time of frames (Lua 5.4 and later). */
+    };
+
+    /**
+     * \brief Time spent in garbage collection steps run by the main loop.
+     */
+    struct GcStats {
+      int64_t frame_time = 0;       /**< Time of the last frame in microseconds. */
+      int64_t max_frame_time = 0;   /**< Longest frame in microseconds. */
+      int64_t total_time = 0;       /**< Total time in microseconds. */
+      int num_steps = 0;            /**< Number of steps run. */
+      int num_cycles = 0;           /**< Number of cycles completed by these steps. */
+    };
+
+    void initialize_garbage_collector(const Arguments& args);
+    static const char* get_gc_mode_name(GcMode mode);
+
+    static constexpr int64_t
+        max_gc_frame_time = 4000;   /**< Maximum time of collection per frame in microseconds. */
+
+    GcMode gc_mode = GcMode::AUTO;  /**< How the garbage collector is scheduled. */
+    GcStats gc_stats;               /**< Time spent in steps of the main loop. */
+    int gc_memory_after_cycle = 0;  /**< Memory in KiB when the last cycle finished,
+                                     * 0 if a cycle is running. */
+
+    /**
+     * \brief High-frequency events that can be delivered in batches.
+     */
+    enum class BatchedEventType {
+      POSITION_CHANGED,           /**< entity:on_position_changed(). */
+      MOVEMENT_CHANGED,           /**< entity:on_movement_changed(). */
+      OBSTACLE_REACHED,           /**< entity:on_obstacle_reached(). */
+      FRAME_CHANGED               /**< sprite:on_frame_changed(). */
+    };
+
+    static constexpr int num_batched_event_types = 4;
+
+    /**
+     * \brief An occurrence of a batched event, waiting to be delivered.
+     */
+    struct BatchedEvent {
+      ExportableToLuaPtr object;            /**< Entity or sprite concerned. */
+      std::shared_ptr<Movement> movement;   /**< Movement argument if any. */
+      std::string animation;                /**< Animation argument if any. */
+      int x = 0;                            /**< X coordinate argument if any. */
+      int y = 0;                            /**< Y coordinate argument if any. */
+      int value = 0;                        /**< Layer or frame argument if any. */
+    };
+
+    /**
+     * \brief Handler of a batched event and its occurrences of this cycle.
+     */
+    struct EventBatch {
+      ScopedLuaRef handler;                 /**< Function receiving the batch,
+                                             * empty if the event is not batched. */
+      std::vector<BatchedEvent> events;     /**< Occurrences not delivered yet. */
+    };
+
+    static const std::map<BatchedEventType, std::string> batched_event_names;
+
+    EventBatch* get_event_batch(BatchedEventType type);
+    void deliver_event_batch(BatchedEventType type);
+
     /**
      * \brief Data associated to any Lua menu.
      */
@@ -1314,26 +1568,126 @@ class LuaContext {
       ScopedLuaRef ref;      /**< Lua ref of the table of the menu.
                               * LUA_REFNIL means that the menu will be removed. */
       ScopedLuaRef context;   /**< Lua table or userdata the menu is attached to. */
+      const void* pointer;    /**< Address of the menu table,
+                               * nullptr if the menu will be removed. */
+      const void* context_pointer;  /**< Address of the context,
+                               * nullptr if the menu will be removed. */
+      uint32_t events;        /**< MenuEvent bits of the callbacks the menu may have. */
       bool recently_added;   /**< Used to avoid elements added during an iteration. */
 
-      LuaMenuData(const ScopedLuaRef& ref, const ScopedLuaRef& context):
+      LuaMenuData(
+          const ScopedLuaRef& ref,
+          const ScopedLuaRef& context,
+          const void* pointer,
+          const void* context_pointer,
+          uint32_t events
+      ):
         ref(ref),
         context(context),
+        pointer(pointer),
+        context_pointer(context_pointer),
+        events(events),
         recently_added(true) {
       }
     };
 
+    /**
+     * \brief Callbacks of menus called by the engine.
+     *
+     * Menus that don't define a callback are not pushed to Lua to call it.
+     */
+    enum MenuEvent : uint32_t {
+      MENU_ON_UPDATE = 1 << 0,
+      MENU_ON_DRAW = 1 << 1,
+      MENU_ON_INPUT = 1 << 2,             /**< Any keyboard, joypad, mouse or finger callback. */
+      MENU_ON_COMMAND_PRESSED = 1 << 3,
+      MENU_ON_COMMAND_RELEASED = 1 << 4,
+      MENU_ALL_EVENTS = (1 << 5) - 1
+    };
+
+    /**
+     * \brief Solarus type of a userdata metatable.
+     */
+    struct UserdataType {
+      std::string module_name;    /**< Name of the metatable in the registry. */
+      bool is_entity;             /**< Whether this is the type of an entity. */
+    };
+
     /**
      * \brief Data associated to any Lua timer.
      */
     struct LuaTimerData {
       ScopedLuaRef callback_ref;  /**< Lua ref of the function to call after the timer. */
       ScopedLuaRef context;       /**< Lua table or userdata the timer is attached to. */
+      uint64_t order = 0;         /**< Creation order of the timer. */
+      bool scheduled = false;     /**< Whether the timer queue has a valid entry for it. */
+      uint32_t scheduled_date = 0;  /**< Expiration date of that entry. */
+    };
+
+    /**
+     * \brief An element of the timer queue.
+     *
+     * Entries are not removed when their timer changes: an entry whose date
+     * is not the scheduled date of its timer is skipped.
+     */
+    struct TimerQueueEntry {
+      uint32_t expiration_date;   /**< Expiration date of the timer when it was pushed. */
+      uint64_t order;             /**< Timers created first come first among equal dates. */
+      std::weak_ptr<Timer> timer; /**< The timer. */
+
+      bool operator<(const TimerQueueEntry& other) const;
+    };
+
+    /**
+     * \brief What a Lua task is waiting for.
+     */
+    enum class TaskWait {
+      NONE,                       /**< Running or ready to be resumed. */
+      TIME,                       /**< A date. */
+      FRAMES,                     /**< A number of updates. */
+      MOVEMENT,                   /**< The end of a movement. */
+      ANIMATION,                  /**< The end of a sprite animation. */
+      DIALOG                      /**< The end of the dialog of a game. */
+    };
+
+    /**
+     * \brief Data associated to a Lua task.
+     *
+     * Tasks are stored in reusable slots: waiting does not allocate anything.
+     */
+    struct LuaTaskData {
+      ScopedLuaRef thread_ref;    /**< The coroutine, empty if the slot is free. */
+      lua_State* thread = nullptr;  /**< The coroutine state. */
+      ScopedLuaRef context;       /**< Lua table or userdata the task is attached to. */
+      TaskWait wait = TaskWait::NONE;  /**< What the task is waiting for. */
+      uint64_t wait_id = 0;       /**< Identifies the current wait of the task. */
+      uint32_t wake_date = 0;     /**< Date or update number to wait for. */
+      std::shared_ptr<Movement> movement;  /**< Movement to wait for. */
+      SpritePtr sprite;           /**< Sprite to wait for. */
+      std::shared_ptr<Savegame> game;  /**< Game whose dialog to wait for. */
+    };
+
+    /**
+     * \brief A wait of a task in the task queues.
+     *
+     * Entries are not removed when their task stops or waits for something
+     * else: an entry whose wait id is not the one of its task is skipped.
+     */
+    struct TaskQueueEntry {
+      uint32_t wake_date;         /**< Date or update number to wait for. */
+      uint64_t wait_id;           /**< Waits started first come first among equal dates. */
+      int slot;                   /**< Index of the task. */
+
+      bool operator<(const TaskQueueEntry& other) const;
     };
 
     // Executing Lua code.
     bool userdata_has_metafield(
         const ExportableToLua& userdata, const char* key) const;
+    bool userdata_has_inherited_metafield(
+        const ExportableToLua& userdata, const char* key) const;
+    static bool get_lua_event(const char* key, LuaEvent& event);
+    static const char* get_lua_event_name(LuaEvent event);
     bool find_method(int index, const char* function_name);
     bool find_method(const char* function_name);
 
@@ -1355,11 +1709,31 @@ class LuaContext {
     void register_input_module();
     void register_file_module();
     void register_timer_module();
+    void schedule_timer(const TimerPtr& timer);
+    void compact_timer_queue();
+    static uint32_t get_menu_events(lua_State* l, int index);
+    void move_menu(const void* menu, bool to_front);
+    void end_menus_iteration();
+    void menus_on_update(const void* context);
+    void menus_on_draw(const void* context, const SurfacePtr& dst_surface);
+    bool menus_on_input(const void* context, const InputEvent& event);
+    bool menus_on_command_pressed(const void* context, GameCommand command);
+    bool menus_on_command_released(const void* context, GameCommand command);
+    void register_task_module();
+    void start_task(int context_index, int function_index, int nb_arguments);
+    void resume_task(int slot, int nb_arguments);
+    void release_task(int slot);
+    int get_task_slot(lua_State* thread) const;
+    void schedule_task(int slot, TaskWait wait, uint32_t wake_date);
+    int wait_task(lua_State* l, TaskWait wait, uint32_t wake_date);
     void register_item_module();
     void register_surface_module();
     void register_text_surface_module();
     void register_sprite_module();
     void register_shader_module();
+    void register_pixel_buffer_module();
+    void register_draw_list_module();
+    void register_random_module();
     void register_movement_module();
     void register_menu_module();
     void register_language_module();
@@ -1367,28 +1741,39 @@ class LuaContext {
     void register_map_module();
     void register_entity_module();
     void register_state_module();
+    void register_worker_module();
+    void register_ffi_accessors();
 
     // Pushing objects to Lua.
     static void push_main(lua_State* current_l);
     static void push_video(lua_State* current_l);
     static void push_string(lua_State* current_l, const std::string& text);
+    static void push_interned_string(lua_State* current_l, const char* text);
+    static void push_interned_string(lua_State* current_l, const std::string& text);
     static void push_color(lua_State* current_l, const Color& color);
 public:
     static void push_userdata(lua_State* current_l, ExportableToLua& userdata);
 private:
+    void set_userdata_slot(lua_State* main, ExportableToLua& userdata);
     static void push_dialog(lua_State* current_l, const Dialog& dialog);
     static void push_timer(lua_State* current_l, const TimerPtr& timer);
     static void push_surface(lua_State* current_l, Surface& surface);
     static void push_text_surface(lua_State* current_l, TextSurface& text_surface);
     static void push_sprite(lua_State* current_l, Sprite& sprite);
     static void push_shader(lua_State* current_l, Shader& shader);
+    static void push_pixel_buffer(lua_State* current_l, PixelBuffer& pixel_buffer);
+    static void push_draw_list(lua_State* current_l, DrawList& draw_list);
+    static void push_random_stream(lua_State* current_l, RandomStream& random_stream);
     static void push_item(lua_State* current_l, EquipmentItem& item);
     static void push_movement(lua_State* current_l, Movement& movement);
     static void push_game(lua_State* current_l, Savegame& game);
+    static void push_savegame_value(lua_State* current_l, const Savegame& savegame, const std::string& key);
+    static void push_savegame_value(lua_State* current_l, const Savegame& savegame, SavegameValueHandle handle);
     static void push_map(lua_State* current_l, Map& map);
     static void push_state(lua_State* current_l, CustomState& state);
     static void push_entity(lua_State* current_l, Entity& entity);
     static void push_entity_iterator(lua_State* current_l, const EntityVector& entities);
+    static void release_entity_iterator_table(lua_State* current_l, int table_index, int size);
     static void push_named_sprite_iterator(
         lua_State* current_l,
         const std::vector<Entity::NamedSprite>& sprites
@@ -1415,6 +1800,7 @@ private:
     // Getting objects from Lua.
     static bool is_main(lua_State* current_l, int index);
     static bool is_menu(lua_State* current_l, int index);
+    static const UserdataType* get_userdata_type(lua_State* current_l, int index);
     static void* test_userdata(lua_State* current_l, int index,
         const char* module_name);
     static bool is_userdata(lua_State* current_l, int index,
@@ -1436,6 +1822,12 @@ private:
     static SpritePtr check_sprite(lua_State* current_l, int index);
     static bool is_shader(lua_State* current_l, int index);
     static ShaderPtr check_shader(lua_State* current_l, int index);
+    static bool is_pixel_buffer(lua_State* current_l, int index);
+    static std::shared_ptr<PixelBuffer> check_pixel_buffer(lua_State* current_l, int index);
+    static bool is_draw_list(lua_State* current_l, int index);
+    static std::shared_ptr<DrawList> check_draw_list(lua_State* current_l, int index);
+    static bool is_random_stream(lua_State* current_l, int index);
+    static std::shared_ptr<RandomStream> check_random_stream(lua_State* current_l, int index);
     static bool is_item(lua_State* current_l, int index);
     static std::shared_ptr<EquipmentItem> check_item(lua_State* current_l, int index);
     static bool is_movement(lua_State* current_l, int index);
@@ -1541,10 +1933,13 @@ private:
     void on_position_changed(const Point& xy);
     void on_obstacle_reached();
     void on_changed();
+    void on_path_ready(const std::string& path);
     void on_started(const std::shared_ptr<Destination>& destination);
     void on_opening_transition_finished(const std::shared_ptr<Destination>& destination);
     void on_obtaining_treasure(const Treasure& treasure);
     void on_obtained_treasure(const Treasure& treasure);
+    void on_chunk_activated(int column, int row);
+    void on_chunk_deactivated(int column, int row);
     void on_state_changing(const std::string& state_name, const std::string& next_state_name);
     void on_state_changed(const std::string& new_state_name);
     bool on_taking_damage(int damage);
@@ -1578,6 +1973,7 @@ private:
     void on_pickable_created(Pickable& pickable);
     void on_variant_changed(int variant);
     void on_amount_changed(int amount);
+    void on_value_changed(const Savegame& savegame, const std::string& key);
     void on_obtaining(const Treasure& treasure);
     void on_obtained(const Treasure& treasure);
     void on_using();
@@ -1625,6 +2021,8 @@ private:
     static FunctionExportedToLua
       l_panic,
       l_loader,
+      l_setmetatable,
+      l_rawset,
       l_get_map_entity_or_global,
       l_easy_index,
       l_hero_teleport,
@@ -1660,22 +2058,57 @@ private:
       l_create_fire;
 
     // Script data.
+    std::unique_ptr<LuaAllocator>
+        allocator;                     /**< Allocator of the Lua state,
+                                        * nullptr if it uses the default one. */
     lua_State* main_l;                 /**< The MAIN Lua state encapsulated. */
     lua_State* current_l;              /**< The  presumed current Lua state running */
     MainLoop& main_loop;               /**< The Solarus main loop. */
 
-    std::list<LuaMenuData> menus;      /**< The menus currently running in their context.
+    std::vector<LuaMenuData> menus;    /**< The menus currently running in their context,
+                                        * from back to front.
                                         * Invalid ones are to be removed at the next cycle. */
+    int menus_iteration_depth;         /**< Number of loops on menus in progress. */
+    std::vector<std::pair<const void*, bool>>
+        pending_menu_moves;            /**< Menus to move to the front (true) or
+                                        * back (false) once no loop is in progress. */
+    int menu_metatable_ref;            /**< Registry ref of the metatable that tracks
+                                        * callbacks defined on menus. */
     std::map<TimerPtr, LuaTimerData>
         timers;                        /**< The timers currently running, with
                                         * their context and callback. */
     std::list<TimerPtr>
         timers_to_remove;              /**< Timers to be removed at the next cycle. */
-
-    std::set<DrawablePtr>
+    std::vector<TimerQueueEntry>
+        timer_queue;                   /**< Binary heap of the running timers,
+                                        * the first one to expire on top. */
+    std::set<TimerPtr>
+        timers_with_sound;             /**< Timers that play a clock sound and
+                                        * need to be updated at each cycle. */
+    uint64_t next_timer_order;         /**< Creation order of the next timer. */
+
+    std::vector<LuaTaskData> tasks;    /**< Slots of the tasks currently running. */
+    std::vector<int> free_task_slots;  /**< Indexes of the unused slots in tasks. */
+    std::unordered_map<lua_State*, int>
+        task_slots;                    /**< Slot of each task by coroutine. */
+    std::vector<TaskQueueEntry>
+        task_time_queue;               /**< Binary heap of tasks waiting for a date. */
+    std::vector<TaskQueueEntry>
+        task_frame_queue;              /**< Binary heap of tasks waiting for updates. */
+    std::vector<TaskQueueEntry>
+        task_event_waits;              /**< Tasks waiting for a movement, an animation
+                                        * or a dialog, checked at each update. */
+    std::vector<TaskQueueEntry>
+        tasks_to_resume;               /**< Tasks woken up during an update. */
+    uint32_t task_frame;               /**< Number of task updates so far. */
+    uint64_t next_task_wait_id;        /**< Id of the next wait of a task. */
+    lua_State* running_task;           /**< Coroutine of the task being resumed. */
+
+    std::vector<DrawablePtr>
         drawables;                     /**< All drawable objects created by
-                                        * this script. */
-    std::set<DrawablePtr>
+                                        * this script, in creation order.
+                                        * Each one knows its index. */
+    std::vector<DrawablePtr>
         drawables_to_remove;           /**< Drawable objects to be removed at the
                                         * next cycle. */
     std::map<const ExportableToLua*, std::set<std::string>>
@@ -1683,12 +2116,40 @@ private:
                                         * userdata with our __newindex. This is
                                         * only for performance, to avoid Lua
                                         * lookups for callbacks like on_update. */
+    std::unordered_map<const void*, UserdataType>
+        userdata_types;                /**< Solarus type of each metatable, by address,
+                                        * to check userdata without registry lookups. */
+    std::unordered_map<const void*, int>
+        interned_strings;              /**< Registry refs of constant strings already
+                                        * pushed, by address of their C++ storage. */
+    std::map<std::string, uint32_t>
+        metatable_events;              /**< Bit mask of the events that may be
+                                        * defined in the metatable of each type. */
+    std::set<std::string>
+        untracked_metatables;          /**< Types whose metatable got another
+                                        * metatable from scripts: their events
+                                        * are looked up in Lua. */
+    uint32_t lua_events_version;       /**< Incremented whenever events are set or
+                                        * removed on a userdata or a metatable. */
+    int userdata_slots_ref;            /**< Registry ref of a weak array of
+                                        * userdata indexed by their Lua slot. */
+    int num_userdata_slots;            /**< Number of slots reserved so far. */
+    std::vector<int>
+        free_userdata_slots;           /**< Slots of destroyed objects, to reuse. */
+    int entity_iterator_tables_ref;    /**< Registry ref of an array of empty
+                                        * tables to reuse in entity iterators. */
     std::set<std::string>
         warning_deprecated_functions;  /**< Names of deprecated functions of
                                         * the API for which a warning was emitted. */
+    std::map<uint64_t, ScopedLuaRef>
+        file_read_callbacks;           /**< Callbacks of the asynchronous file
+                                        * reads in progress, by id. */
 
     std::queue<std::function<void(lua_State*)>>
         cross_state_callbacks;         /**< Callbacks that must be executed on main from other coroutines */
+    std::array<EventBatch, num_batched_event_types>
+        event_batches;                 /**< Handler and pending occurrences
+                                        * of each batched event type. */
 
     static const std::map<EntityType, lua_CFunction>
         entity_creation_functions;     /**< Creation function of each entity type. */
@@ -18,6 +18,7 @@
 #define SOLARUS_LUA_DATA_FILE_H
 
 #include "solarus/core/Common.h"
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 
@@ -25,8 +26,17 @@ struct lua_State;
 
 namespace Solarus {
 
+class BinaryReader;
+class BinaryWriter;
+
 /**
  * \brief Abstract class for data the can be loaded and optionally saved as Lua.
+ *
+ * Data can also optionally be converted to a compact binary form.
+ * When it can, quest files are cached in binary in the quest write directory
+ * and loaded from there as long as the original file content does not change.
+ * Cache files can also be shipped in the quest data, for example by the
+ * quest optimizer.
  */
 class SOLARUS_API LuaData {
 
@@ -37,8 +47,11 @@ class SOLARUS_API LuaData {
 
     virtual bool import_from_lua(lua_State* l) = 0;
     virtual bool export_to_lua(std::ostream& out) const;  // Optional.
+    virtual bool import_from_binary(BinaryReader& reader);  // Optional.
+    virtual bool export_to_binary(BinaryWriter& writer) const;  // Optional.
 
     bool import_from_buffer(const std::string& buffer, const std::string& file_name);
+    bool import_from_buffer(const char* data, size_t size, const std::string& file_name);
     bool import_from_file(const std::string& file_name);
     bool import_from_quest_file(
         const std::string& quest_file_name,
@@ -48,6 +61,11 @@ class SOLARUS_API LuaData {
     bool export_to_buffer(std::string& buffer) const;
     bool export_to_file(const std::string& file_name) const;
 
+    bool export_to_binary_cache(std::string& buffer, uint64_t source_hash) const;
+    static std::string get_binary_cache_file_name(const std::string& actual_file_name);
+    static bool is_binary_cache_enabled();
+    static void set_binary_cache_enabled(bool enabled);
+
     static std::string escape_string(std::string value);
     static std::string escape_multiline_string(std::string value);
     static std::string unescape_multiline_string(std::string value);
@@ -57,6 +75,19 @@ class SOLARUS_API LuaData {
         const std::string& value,
         std::ostream& out) const;
 
+  private:
+
+    bool import_from_binary_cache(
+        const std::string& cache_file_name,
+        uint64_t source_hash
+    );
+    void export_to_binary_cache(
+        const std::string& cache_file_name,
+        uint64_t source_hash
+    ) const;
+
+    static bool binary_cache_enabled;   /**< Whether quest files are cached in binary. */
+
 };
 
 }
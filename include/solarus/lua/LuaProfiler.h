@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LUA_PROFILER_H
+#define SOLARUS_LUA_PROFILER_H
+
+#include "solarus/core/Common.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct lua_State;
+struct lua_Debug;
+
+namespace Solarus {
+
+/**
+ * \brief Measures where Lua scripts spend their time.
+ *
+ * The profiler installs a Lua count hook that samples the running line
+ * every few virtual machine instructions. The time and the memory allocated
+ * since the previous sample are attributed to the sampled location
+ * (script file and line) and to the engine event whose call led there
+ * (for example "on_update" or "collision callback").
+ *
+ * Events are tracked by LuaTools::call_function(), which all calls from
+ * C++ to Lua go through.
+ *
+ * With LuaJIT, code compiled to machine code does not call hooks:
+ * lines that run in compiled traces are attributed to the last
+ * interpreted line.
+ */
+class SOLARUS_API LuaProfiler {
+
+  public:
+
+    /**
+     * \brief Marks the execution of an engine event for the profiler.
+     */
+    class EventScope {
+
+      public:
+
+        inline explicit EventScope(const char* event_name);
+        inline ~EventScope();
+
+        EventScope(const EventScope& other) = delete;
+        EventScope& operator=(const EventScope& other) = delete;
+
+      private:
+
+        bool entered;    /**< Whether the event was pushed to the profiler. */
+    };
+
+    static void start(lua_State* l, int instruction_count = default_instruction_count);
+    static void stop();
+    static inline bool is_running();
+    static std::string get_report(int max_lines = default_max_lines);
+
+    static constexpr int
+        default_instruction_count = 1000;   /**< Default number of instructions
+                                             * between two samples. */
+    static constexpr int
+        default_max_lines = 30;             /**< Default number of locations in
+                                             * the report. */
+
+  private:
+
+    /**
+     * \brief Time and memory attributed to a location.
+     */
+    struct Stats {
+      int64_t time;         /**< Time spent in microseconds. */
+      int64_t allocated;    /**< Bytes allocated. */
+      uint32_t samples;     /**< Number of samples. */
+    };
+
+    /**
+     * \brief An engine event being executed.
+     */
+    struct Frame {
+      std::string event;       /**< Name of the event. */
+      std::string location;    /**< Last location sampled in this event. */
+    };
+
+    using Key = std::pair<std::string, std::string>;
+
+    static void hook(lua_State* l, lua_Debug* ar);
+    static void enter_event(const char* event_name);
+    static void leave_event();
+    static void add_sample(bool count_sample);
+    static int64_t get_memory();
+
+    static bool running;                      /**< Whether the hook is installed. */
+    static lua_State* profiled_l;             /**< The Lua state being profiled. */
+    static std::vector<Frame> frames;         /**< Stack of events being executed. */
+    static std::map<Key, Stats> stats;        /**< Stats of each event and location. */
+    static std::chrono::steady_clock::time_point
+        last_sample_time;                     /**< Date of the previous sample. */
+    static int64_t last_memory;               /**< Memory used at the previous sample. */
+};
+
+}
+
+#include "solarus/lua/LuaProfiler.inl"
+
+#endif
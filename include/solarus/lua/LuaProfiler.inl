@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+namespace Solarus {
+
+/**
+ * \brief Tells the profiler that an event starts if it is running.
+ * \param event_name Name of the event.
+ */
+inline LuaProfiler::EventScope::EventScope(const char* event_name):
+  entered(false) {
+
+  if (running) {
+    enter_event(event_name);
+    entered = true;
+  }
+}
+
+/**
+ * \brief Tells the profiler that the event is finished.
+ */
+inline LuaProfiler::EventScope::~EventScope() {
+
+  if (entered && running) {
+    leave_event();
+  }
+}
+
+/**
+ * \brief Returns whether the profiler is running.
+ * \return \c true if samples are being taken.
+ */
+inline bool LuaProfiler::is_running() {
+  return running;
+}
+
+}
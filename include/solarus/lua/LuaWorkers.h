@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_LUA_WORKERS_H
+#define SOLARUS_LUA_WORKERS_H
+
+#include "solarus/core/Common.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct lua_State;
+
+namespace Solarus {
+
+/**
+ * \brief Runs pure Lua functions in background threads.
+ *
+ * Each worker thread has its own Lua state, isolated from the engine:
+ * it only has the standard libraries that don't access files or the
+ * system. Jobs give it the code of a function and a message, and get
+ * back the value returned by the function.
+ *
+ * Messages and results are serialized: they can only be made of nil,
+ * booleans, numbers, strings and tables of these.
+ *
+ * Threads are started when the first job is submitted.
+ * Callbacks are called by the main thread, from update().
+ */
+class SOLARUS_API LuaWorkers {
+
+  public:
+
+    /**
+     * \brief Function called when a job is finished.
+     *
+     * The parameters tell whether the function succeeded, and give the
+     * serialized value it returned or an error message.
+     */
+    using Callback = std::function<void(bool, const std::string&)>;
+
+    static void quit();
+    static int get_num_threads();
+
+    static void run(
+        const std::string& code,
+        const std::string& message,
+        const Callback& callback
+    );
+    static void update();
+    static void cancel_callbacks();
+
+    static bool serialize(lua_State* l, int index, std::string& buffer, std::string& error);
+    static bool deserialize(lua_State* l, const std::string& buffer);
+
+  private:
+
+    /**
+     * \brief A function to call with a message.
+     */
+    struct Job {
+      uint64_t id;              /**< Identifies the callback of this job. */
+      std::string code;         /**< Lua source code or bytecode of the function. */
+      std::string message;      /**< Serialized argument of the function. */
+    };
+
+    /**
+     * \brief The outcome of a job.
+     */
+    struct Result {
+      uint64_t id;              /**< Identifies the callback of the job. */
+      bool success;             /**< Whether the function returned normally. */
+      std::string value;        /**< Serialized return value or error message. */
+    };
+
+    static void start();
+    static void run_thread();
+    static Result run_job(lua_State* l, std::map<std::string, int>& functions, const Job& job);
+
+    static bool started;                          /**< Whether the threads are started. */
+    static std::vector<std::thread> threads;      /**< Threads running the jobs. */
+    static std::mutex mutex;                      /**< Protects what follows. */
+    static std::condition_variable jobs_changed;  /**< Wakes up the threads. */
+    static std::deque<Job> jobs;                  /**< Jobs waiting for a thread. */
+    static bool stopping;                         /**< Asks the threads to stop. */
+    static std::vector<Result> results;           /**< Jobs finished since the last update(). */
+
+    // Only used by the main thread.
+    static uint64_t next_id;                      /**< Id of the next job. */
+    static std::map<uint64_t, Callback>
+        callbacks;                                /**< Callback of each job. */
+};
+
+}
+
+#endif
@@ -19,6 +19,7 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/entities/EntityPtr.h"
+#include "solarus/movements/MotionIntegrator.h"
 #include "solarus/movements/Movement.h"
 #include <cstdint>
 #include <string>
@@ -88,8 +89,7 @@ class CircleMovement: public Movement {
     double current_angle;                           /**< Current angle in the circle in radians. */
     double initial_angle;                           /**< The first circle starts from this angle in radians. */
     int angle_increment;                            /**< Number of degrees to add when the angle changes (1 or -1). */
-    double next_angle_change_date;                  /**< Date when the angle changes. */
-    double angle_change_delay;                      /**< If not zero, time interval of an angle change of 1 degree. */
+    MotionIntegrator angle_motion;                  /**< Number of 1-degree increments to make. */
     double angular_speed;                           /**< Speed of the angle change in radians per second. */
 
     // Radius.
@@ -97,8 +97,8 @@ class CircleMovement: public Movement {
     int wanted_radius;                              /**< The current radius changes gradually towards this wanted value. */
     int previous_radius;                            /**< Radius before the movement stops. */
     int radius_increment;                           /**< Number of pixels to add when the radius is changing (1 or -1). */
-    uint32_t next_radius_change_date;               /**< Date of the next radius change. */
-    uint32_t radius_change_delay;                   /**< If not zero, time interval between two radius changes. */
+    int radius_speed;                               /**< If not zero, speed of the radius changes in pixels per second. */
+    MotionIntegrator radius_motion;                 /**< Number of 1-pixel radius changes to make. */
 
     // Stop after an amount of time.
     uint32_t duration;                              /**< If not zero, the movement will stop after this delay. */
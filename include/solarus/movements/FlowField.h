@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FLOW_FIELD_H
+#define SOLARUS_FLOW_FIELD_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/entities/EntityPtr.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+class Map;
+
+/**
+ * \brief Directions to follow to reach an entity from every node around it.
+ *
+ * Nodes are the same 16x16 squares aligned on the 8x8 grid as in PathFinding.
+ * The field is computed with Dijkstra's algorithm from the target, in a
+ * square window around it, for a given set of obstacle grounds.
+ * Only the terrain is taken into account: dynamic entities that are
+ * obstacles are ignored.
+ *
+ * Many entities chasing the same target can share a field and
+ * sample it in constant time.
+ * It is only computed again when the target reaches another node
+ * or when the terrain changes.
+ */
+class SOLARUS_API FlowField {
+
+  public:
+
+    FlowField(const EntityPtr& target, uint32_t ground_obstacles);
+
+    const EntityPtr& get_target() const;
+    uint32_t get_ground_obstacles() const;
+    uint32_t get_last_use_date() const;
+
+    void update(Map& map, Entity& source);
+
+    int get_direction8(const Point& xy) const;
+    std::string get_path(const Point& xy) const;
+
+    static constexpr int radius = 25;     /**< Number of nodes computed on each
+                                           * side of the target. */
+
+  private:
+
+    bool get_node_index(const Point& xy, int& index) const;
+    Point get_node_location(int index) const;
+    void compute(Map& map, Entity& source);
+
+    static constexpr int size = 2 * radius + 1;  /**< Nodes in a row of the window. */
+    static constexpr uint16_t unreached = UINT16_MAX;
+
+    EntityPtr target;                     /**< The entity to reach. */
+    uint32_t ground_obstacles;            /**< Grounds that are obstacles. */
+    Point target_node;                    /**< Node of the target when computed. */
+    int layer;                            /**< Layer of the target when computed. */
+    uint32_t grid_version;                /**< Version of the walkability grid
+                                           * when computed. */
+    bool computed;                        /**< Whether the field was computed. */
+    uint32_t last_use_date;               /**< Last time update() was called. */
+    std::vector<uint16_t> costs;          /**< Cost to the target from each node. */
+    std::vector<int8_t> directions;       /**< Direction to follow from each node,
+                                           * or -1. */
+
+};
+
+}
+
+#endif
+
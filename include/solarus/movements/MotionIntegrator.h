@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MOTION_INTEGRATOR_H
+#define SOLARUS_MOTION_INTEGRATOR_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+
+namespace Solarus {
+
+/**
+ * \brief Converts a constant speed into whole units of motion.
+ *
+ * Movements advance the integrator once per cycle and get the number of
+ * whole units (pixels, degrees...) made since the previous cycle.
+ * The speed and the sub-unit progress are kept in 16.16 fixed point,
+ * so no time is lost to rounding and the result only depends on dates.
+ *
+ * Speeds are magnitudes: the movement applies the direction itself.
+ */
+class SOLARUS_API MotionIntegrator {
+
+  public:
+
+    using Fixed = int64_t;                          /**< A 16.16 fixed-point value. */
+
+    static constexpr int fraction_bits = 16;        /**< Bits after the point. */
+    static constexpr Fixed one = Fixed(1) << fraction_bits;  /**< 1.0 in fixed point. */
+
+    static Fixed to_fixed(double value);
+    static double to_double(Fixed value);
+
+    MotionIntegrator();
+
+    double get_speed() const;
+    void set_speed(double speed);
+    uint32_t get_date() const;
+
+    void restart(uint32_t date);
+    int advance(uint32_t now);
+    void shift(uint32_t delay);
+
+  private:
+
+    Fixed speed;                /**< Units per second. */
+    Fixed progress;             /**< Units made and not returned yet,
+                                 * in thousandths (the speed is per second
+                                 * and dates are in milliseconds). */
+    uint32_t date;              /**< Date up to which the progress is computed. */
+
+};
+
+}
+
+#endif
+
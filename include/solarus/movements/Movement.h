@@ -23,6 +23,7 @@
 #include "solarus/lua/ScopedLuaRef.h"
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -91,6 +92,10 @@ class SOLARUS_API Movement: public ExportableToLua {
     void set_ignore_obstacles(bool ignore_obstacles);
     void restore_default_ignore_obstacles();
 
+    // coalesced moves (only when the movement is applied to an entity)
+    bool are_moves_coalesced() const;
+    void set_coalesce_moves(bool coalesce_moves);
+
     // displaying moving objects
     virtual int get_displayed_direction4() const;
     virtual Point get_displayed_xy() const;
@@ -113,6 +118,11 @@ class SOLARUS_API Movement: public ExportableToLua {
     // obstacles (only when the movement is applied to an entity)
     void set_default_ignore_obstacles(bool ignore_obstacles);
 
+    // coalesced moves
+    void begin_coalesced_moves();
+    void end_coalesced_moves();
+    void find_free_run(const Point& step, int max_steps);
+
   private:
 
     // Object to move (can be an entity, a drawable or a point).
@@ -138,6 +148,15 @@ class SOLARUS_API Movement: public ExportableToLua {
     bool default_ignore_obstacles;               /**< Indicates that this movement normally ignores obstacles. */
     bool current_ignore_obstacles;               /**< Indicates that this movement currently ignores obstacles. */
 
+    // coalesced moves (only when the movement is applied to an entity)
+    bool coalesce_moves;                         /**< Whether the moves of an update are notified only once. */
+    bool coalescing;                             /**< Whether moves are being coalesced now. */
+    std::vector<Point> coalesced_path;           /**< Positions taken since begin_coalesced_moves(). */
+    Point free_run_start;                        /**< Position where the free run starts. */
+    Point free_run_step;                         /**< Translation of each step of the free run. */
+    int free_run_length;                         /**< Number of steps known to have no obstacle
+                                                  * from free_run_start, or 0. */
+
     ScopedLuaRef finished_callback_ref;          /**< Lua ref to a function to call when this movement finishes. */
 
 };
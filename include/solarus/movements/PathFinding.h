@@ -19,9 +19,9 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
-#include <list>
-#include <map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
@@ -35,19 +35,44 @@ class Rectangle;
  * In the current implementation, the computed path always corresponds to a
  * shape of 16*16. If the entity to move is bigger, some obstacles may prevent
  * it from following the computed path.
+ *
+ * Nodes are stored in a flat array covering the map, reused from one search
+ * to the next thanks to generation stamps, and the open list is a binary
+ * heap. When several targets are tried, the validity of each transition
+ * between nodes is only tested once.
+ *
+ * The search can also be run incrementally: call start(), then step() with
+ * a budget of node expansions until it returns \c true, and get the result
+ * with get_path(). Searches that are interleaved in time must use different
+ * workspaces.
  */
 class SOLARUS_API PathFinding {
 
   public:
 
+    struct Workspace;
+
     PathFinding(
         Map& map,
         Entity& source_entity,
         Entity& target_entity);
+    PathFinding(
+        Map& map,
+        Entity& source_entity,
+        Entity& target_entity,
+        Workspace& workspace);
 
     std::string compute_path();
     std::string compute_path(const Point& offset);
 
+    void start();
+    bool step(int& max_expansions);
+    bool is_finished() const;
+    const std::string& get_path() const;
+
+    static const Point& get_neighbour_offset(int direction);
+    static const Rectangle& get_transition_collision_box(int direction);
+
   private:
 
     /**
@@ -56,39 +81,86 @@ class SOLARUS_API PathFinding {
      * A node is the location of a 16*16 square of the map.
      * The algorithm tries to find the best sequence of nodes leading to the target.
      */
-    class Node {
+    struct Node {
+      uint32_t search;              /**< Search that last reached this node. */
+      uint32_t transitions_search;  /**< Call to start() that last
+                                     * tested transitions from this node. */
+      uint8_t known_transitions;    /**< Directions whose validity was tested. */
+      uint8_t valid_transitions;    /**< Directions that are not blocked. */
+      bool closed;                  /**< Whether this node is in the closed list. */
+      char direction;               /**< direction from the parent node to this node (0 to 7) */
 
-     public:
+      // total_cost = previous_cost + heuristic
+      int previous_cost;            /**< cost of the best path that leads to this node */
+      int heuristic;                /**< estimation of the remaining cost to the target */
+      int total_cost;               /**< total cost of this node */
 
-      Point location;     /**< location of this node on the map */
-      int index;          /**< index of this node's square on the map (depends on the location) */
+      int parent_index;             /**< index of the best node leading to this node */
+    };
 
-      // total_cost = previous_cost + heuristic
-      int previous_cost;  /**< cost of the best path that leads to this node */
-      int heuristic;      /**< estimation of the remaining cost to the target */
-      int total_cost;     /**< total cost of this node */
+    /**
+     * \brief An element of the open list.
+     *
+     * A node whose cost decreases is pushed again in the heap:
+     * entries that no longer match their node are skipped.
+     */
+    struct OpenEntry {
+      int total_cost;               /**< Total cost of the node when it was pushed. */
+      uint32_t order;               /**< Entries pushed later come first among equal costs. */
+      int index;                    /**< Index of the node. */
+
+      bool operator<(const OpenEntry& other) const;
+    };
 
-      int parent_index;   /**< index of the square containing the best node leading to this node */
-      char direction;     /**< direction from the parent node to this node (0 to 7) */
+  public:
 
-      bool operator<(const Node& other) const;
+    /**
+     * \brief Memory used by searches.
+     *
+     * Nodes are kept from one search to the next to avoid allocations.
+     */
+    struct Workspace {
+      std::vector<Node> nodes;              /**< Nodes of the map. */
+      std::vector<OpenEntry> open_list;     /**< The open list, as a binary heap. */
+      uint32_t current_search = 0;          /**< Stamp of the current search. */
+      uint32_t current_transitions_search = 0;  /**< Stamp of the current call to start(). */
+      uint32_t next_order = 0;              /**< Order of the next entry of the open list. */
     };
 
-    int get_square_index(const Point& location) const;
-    bool is_node_transition_valid(const Node& node, int direction) const;
-    void add_index_sorted(Node* node);
-    std::string rebuild_path(const Node* final_node);
+  private:
+
+    void start(const std::vector<Point>& offsets);
+    void prepare_nodes();
+    bool begin_search(const Point& offset);
+    void expand_next_node();
+    bool get_node_index(const Point& location, int& index) const;
+    Point get_node_location(int index) const;
+    bool is_node_transition_valid(int index, int direction);
+    std::string rebuild_path(int final_index) const;
 
     static const Point neighbours_locations[];
     static const Rectangle transition_collision_boxes[];
-
-    Map& map;                          /**< the map */
-    Entity& source_entity;             /**< the entity to move */
-    Entity& target_entity;             /**< the target point */
-
-    std::map<int, Node> closed_list;   /**< the closed list, indexed by the node locations on the map */
-    std::map<int, Node> open_list;     /**< the open list, indexed by the node locations on the map */
-    std::list<int> open_list_indices;  /**< indices of the open list elements, sorted by priority */
+    static constexpr int margin = 2;      /**< Number of nodes outside the map on each side. */
+
+    Map& map;                             /**< the map */
+    Entity& source_entity;                /**< the entity to move */
+    Entity& target_entity;                /**< the target point */
+    Workspace& workspace;                 /**< Nodes and open list of the search. */
+    int columns;                          /**< Number of nodes in a row, margins included. */
+    int rows;                             /**< Number of nodes in a column, margins included. */
+    uint32_t ground_obstacles;            /**< Grounds that are obstacles for the source entity. */
+
+    Point source;                         /**< Source position when the search started. */
+    Point target;                         /**< Target position when the search started. */
+    std::vector<Point> offsets;           /**< Offsets of the target still to try. */
+    size_t next_offset;                   /**< Index of the next offset to try. */
+    bool searching;                       /**< Whether a search towards an offset is running. */
+    bool finished;                        /**< Whether all offsets were tried. */
+    Point search_target;                  /**< Target location of the current search. */
+    int search_target_index;              /**< Node index of search_target. */
+    std::string best_path;                /**< Shortest path found so far. */
+
+    static Workspace default_workspace;   /**< Workspace of synchronous searches. */
 
 };
 
@@ -32,6 +32,12 @@ namespace Solarus {
  * The entity tries to find a path and to avoid the obstacles on the way.
  * To this end, the PathFinding class (i.e. an implementation of the A* algorithm) is used.
  * If the target entity is too far or not reachable, the movement is a random walk.
+ *
+ * Paths are computed by the PathFindingScheduler of the map, possibly over
+ * several cycles. The entity stays still while it waits for a path.
+ * Alternatively, paths can be read immediately from a FlowField of the map
+ * toward the target, which is cheaper when many entities chase the same one
+ * but ignores dynamic obstacles.
  */
 class SOLARUS_API PathFindingMovement: public PathMovement {
 
@@ -39,9 +45,15 @@ class SOLARUS_API PathFindingMovement: public PathMovement {
 
     explicit PathFindingMovement(int speed);
 
+    const EntityPtr& get_target() const;
     void set_target(const EntityPtr& target);
+    bool get_use_flow_field() const;
+    void set_use_flow_field(bool use_flow_field);
     virtual bool is_finished() const override;
 
+    void notify_path_ready(const std::string& path);
+    void notify_path_cancelled();
+
     virtual const std::string& get_lua_type_name() const override;
 
   protected:
@@ -53,6 +65,10 @@ class SOLARUS_API PathFindingMovement: public PathMovement {
 
     EntityPtr target;               /**< the entity targeted by this movement (usually the hero) */
     uint32_t next_recomputation_date;
+    bool path_requested;            /**< Whether the path finding scheduler
+                                     * is computing a path for this movement. */
+    bool use_flow_field;            /**< Whether paths are sampled from a flow
+                                     * field shared with other entities. */
 
 };
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PATH_FINDING_SCHEDULER_H
+#define SOLARUS_PATH_FINDING_SCHEDULER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/entities/EntityPtr.h"
+#include "solarus/movements/PathFinding.h"
+#include <deque>
+#include <memory>
+
+namespace Solarus {
+
+class Map;
+class PathFindingMovement;
+
+/**
+ * \brief Runs the path finding requests of a map over several cycles.
+ *
+ * Requests are processed one at a time, in the order they were made.
+ * At each cycle, at most max_expansions_per_cycle nodes are expanded,
+ * so that many entities looking for a path at the same time
+ * don't make a frame last longer than the others.
+ * Results are delivered to the movement that made the request.
+ */
+class SOLARUS_API PathFindingScheduler {
+
+  public:
+
+    explicit PathFindingScheduler(Map& map);
+
+    void request(
+        const std::shared_ptr<PathFindingMovement>& movement,
+        const EntityPtr& source,
+        const EntityPtr& target);
+    void clear();
+    void update();
+
+    int get_num_requests() const;
+
+    static constexpr int
+        max_expansions_per_cycle = 2048;  /**< Nodes expanded at each cycle
+                                           * by all searches. */
+
+  private:
+
+    /**
+     * \brief A path to compute.
+     */
+    struct Request {
+      std::weak_ptr<PathFindingMovement>
+          movement;                       /**< The movement to notify. */
+      EntityPtr source;                   /**< The entity to move. */
+      EntityPtr target;                   /**< The entity to reach. */
+    };
+
+    bool is_request_valid(const Request& request) const;
+
+    Map& map;                             /**< The map. */
+    std::deque<Request> requests;         /**< Requests not delivered yet.
+                                           * The first one is the current one. */
+    std::unique_ptr<PathFinding>
+        current_search;                   /**< Search of the first request,
+                                           * or nullptr if not started. */
+    PathFinding::Workspace workspace;     /**< Memory of the current search. */
+
+};
+
+}
+
+#endif
+
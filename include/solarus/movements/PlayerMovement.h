@@ -43,9 +43,13 @@ class PlayerMovement: public StraightMovement {
     int get_wanted_direction8() const;
     void compute_movement();
 
+    static bool is_late_latch_enabled();
+    static void set_late_latch_enabled(bool late_latch_enabled);
+
   protected:
 
     void set_wanted_direction();
+    void update_wanted_direction();
 
     int moving_speed;        /**< Speed of the entity when it is moving. */
     int direction8;          /**< Current direction of the movement (0 to 7),
@@ -54,6 +58,9 @@ class PlayerMovement: public StraightMovement {
                               * movement allows them) or -1. */
     bool blocked_by_stream;  /**< Whether on a blocking stream. */
 
+    static bool late_latch_enabled;  /**< Whether to read the wanted direction
+                                      * before moving. */
+
 };
 
 }
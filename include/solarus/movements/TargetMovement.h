@@ -57,6 +57,8 @@ class TargetMovement: public StraightMovement {
 
     int get_moving_speed() const;
     void set_moving_speed(int moving_speed);
+    bool get_use_flow_field() const;
+    void set_use_flow_field(bool use_flow_field);
 
     void notify_object_controlled() override;
     void notify_position_changed() override;
@@ -82,6 +84,8 @@ class TargetMovement: public StraightMovement {
     uint32_t next_recomputation_date;  /**< Date when the movement is recalculated. */
     bool finished;                     /**< \c true if the target is reached. */
     bool recomputing_movement;         /**< Whether we are in \c recompute_movement(). */
+    bool use_flow_field;               /**< Whether the direction is taken from
+                                        * a flow field toward the target entity. */
 
 };
 
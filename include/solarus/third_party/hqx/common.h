@@ -53,6 +53,9 @@ static inline int yuv_diff(uint32_t yuv1, uint32_t yuv2) {
             ( abs((yuv1 & Vmask) - (yuv2 & Vmask)) > trV ) );
 }
 
+/* Computes the pattern of each pixel of some rows of an image, to be freed by the caller */
+uint8_t *hqx_patterns(const uint32_t *sp, int spL, int Xres, int Yres, int first_row, int num_rows);
+
 static inline int Diff(uint32_t c1, uint32_t c2)
 {
     return yuv_diff(rgb_to_yuv(c1), rgb_to_yuv(c2));
@@ -38,7 +38,13 @@ extern "C" {
 
 #define HQX_API
 
+#define HQX_SIMD_NONE 0
+#define HQX_SIMD_SSE2 1
+#define HQX_SIMD_AVX2 2
+#define HQX_SIMD_NEON 3
+
 HQX_API void HQX_CALLCONV hqxInit(void);
+HQX_API int HQX_CALLCONV hqxSetSimd(int simd);
 HQX_API void HQX_CALLCONV hq2x_32( uint32_t * src, uint32_t * dest, int width, int height );
 HQX_API void HQX_CALLCONV hq3x_32( uint32_t * src, uint32_t * dest, int width, int height );
 HQX_API void HQX_CALLCONV hq4x_32( uint32_t * src, uint32_t * dest, int width, int height );
@@ -47,6 +53,11 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * src, uint32_t src_rowBytes, uin
 HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 
+/* Only write the destination rows of some source rows: several calls on different rows can run in parallel */
+HQX_API void HQX_CALLCONV hq2x_32_rb_rows( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height, int first_row, int num_rows );
+HQX_API void HQX_CALLCONV hq3x_32_rb_rows( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height, int first_row, int num_rows );
+HQX_API void HQX_CALLCONV hq4x_32_rb_rows( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height, int first_row, int num_rows );
+
 #endif
 
 #ifdef __cplusplus
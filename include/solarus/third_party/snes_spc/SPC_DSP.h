@@ -52,6 +52,10 @@ public:
 	// If true, prevents channels and global volumes from being phase-negated
 	void disable_surround( bool disable = true );
 
+	// If false, uses the portable echo FIR even where a vectorized one exists.
+	// Both generate the same samples.
+	static void set_simd_enabled( bool enabled );
+
 // State
 	
 	// Resets DSP and uses supplied values to initialize registers
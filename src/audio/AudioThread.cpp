@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/AudioThread.h"
+#include "solarus/audio/Music.h"
+#include "solarus/audio/Sound.h"
+#include <chrono>
+#include <utility>
+
+namespace Solarus {
+
+constexpr size_t AudioThread::max_commands;
+constexpr size_t AudioThread::max_events;
+constexpr int AudioThread::period;
+SpscQueue<AudioThread::Command> AudioThread::commands(max_commands);
+SpscQueue<AudioThread::Event> AudioThread::events(max_events);
+std::thread AudioThread::thread;
+std::atomic<bool> AudioThread::running(false);
+std::vector<AudioThread::Command> AudioThread::pending_sounds;
+
+/**
+ * \brief Starts the audio thread.
+ *
+ * From now on, the audio system must only be used through commands.
+ */
+void AudioThread::start() {
+
+  if (is_running()) {
+    return;
+  }
+
+  running = true;
+  thread = std::thread(&AudioThread::run);
+}
+
+/**
+ * \brief Stops the audio thread and waits for it to finish.
+ *
+ * Commands and events still in the queues are dropped.
+ * Afterwards, the audio system belongs to the main thread again.
+ */
+void AudioThread::stop() {
+
+  if (is_running()) {
+    running = false;
+    thread.join();
+  }
+
+  pending_sounds.clear();
+  Command command;
+  while (commands.pop(command)) {
+  }
+  Event event;
+  while (events.pop(event)) {
+  }
+}
+
+/**
+ * \brief Returns whether the audio thread is started.
+ * \return \c true if audio runs on its own thread.
+ */
+bool AudioThread::is_running() {
+  return running;
+}
+
+/**
+ * \brief Sends a command to the audio system.
+ *
+ * Must be called from the main thread.
+ * Sounds to play are kept until the next update(), so that identical
+ * sounds played during the same tick, like the ones of many bushes cut
+ * at once, make a single louder instance instead of using many voices.
+ * Other commands are sent after the pending sounds to keep their order.
+ *
+ * \param command The command to send.
+ */
+void AudioThread::post(Command&& command) {
+
+  if (command.type == CommandType::PLAY_SOUND) {
+    for (Command& pending_sound : pending_sounds) {
+      if (pending_sound.id == command.id) {
+        ++pending_sound.value;
+        return;
+      }
+    }
+    command.value = 1;
+    pending_sounds.push_back(std::move(command));
+    return;
+  }
+
+  send_pending_sounds();
+  send(std::move(command));
+}
+
+/**
+ * \brief Sends the sounds played since the last update.
+ *
+ * The value of each command is the number of times its sound was played.
+ */
+void AudioThread::send_pending_sounds() {
+
+  for (Command& pending_sound : pending_sounds) {
+    send(std::move(pending_sound));
+  }
+  pending_sounds.clear();
+}
+
+/**
+ * \brief Sends a command to the audio system without delay.
+ *
+ * If the audio thread is not started, the command is executed now.
+ * Otherwise, waits for a free slot in the unlikely case where the queue
+ * is full.
+ *
+ * \param command The command to send.
+ */
+void AudioThread::send(Command&& command) {
+
+  if (!is_running()) {
+    execute(command);
+    return;
+  }
+
+  while (!commands.push(std::move(command))) {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Sends an event to the main thread.
+ *
+ * Must be called from the audio side. If the queue is full, waits for the
+ * main thread to make room, unless the audio thread is not started,
+ * in which case the event is dropped.
+ *
+ * \param event The event to send.
+ */
+void AudioThread::post_event(Event&& event) {
+
+  while (!events.push(std::move(event))) {
+    if (!is_running()) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * \brief Gets the next event sent by the audio system.
+ *
+ * Must be called from the main thread.
+ *
+ * \param event Receives the event if any.
+ * \return \c false if there is no pending event.
+ */
+bool AudioThread::poll_event(Event& event) {
+  return events.pop(event);
+}
+
+/**
+ * \brief Updates the audio system from the main thread.
+ *
+ * Sends the sounds played during this tick. The rest of the work is done
+ * here only if the audio thread is not started.
+ */
+void AudioThread::update() {
+
+  send_pending_sounds();
+  if (!is_running()) {
+    update_audio();
+  }
+}
+
+/**
+ * \brief Main function of the audio thread.
+ *
+ * Executes the pending commands and updates the playing sounds and music
+ * periodically until stop() is called.
+ */
+void AudioThread::run() {
+
+  Command command;
+  while (running) {
+    while (commands.pop(command)) {
+      execute(command);
+    }
+    update_audio();
+    std::this_thread::sleep_for(std::chrono::milliseconds(period));
+  }
+}
+
+/**
+ * \brief Executes a command on the audio side.
+ * \param command The command to execute. Its data may be moved.
+ */
+void AudioThread::execute(Command& command) {
+
+  switch (command.type) {
+
+    case CommandType::NONE:
+      break;
+
+    case CommandType::PLAY_SOUND:
+      Sound::get_sound(command.id).start(command.value);
+      break;
+
+    case CommandType::PAUSE_SOUNDS:
+      Sound::set_all_paused(command.flag);
+      break;
+
+    case CommandType::SET_SOUND_VOLUME:
+      Sound::volume = command.value / 100.0;
+      break;
+
+    case CommandType::LOAD_SOUNDS:
+      Sound::load_sounds(command.ids);
+      break;
+
+    case CommandType::ADD_PRELOADED_SOUND:
+      Sound::store_preloaded(command.id, command.decoded);
+      break;
+
+    case CommandType::SET_SOUND_VOICES:
+    {
+      Sound::VoiceSettings settings;
+      settings.max_instances = command.value;
+      settings.priority = command.value2;
+      Sound::apply_voice_settings(command.id, settings);
+      break;
+    }
+
+    case CommandType::RELOAD_SOUND:
+      Sound::forget_decoded(command.id);
+      break;
+
+    case CommandType::PLAY_MUSIC:
+      Music::play_file(
+          command.id,
+          command.data,
+          static_cast<Music::Format>(command.value),
+          command.flag,
+          command.serial
+      );
+      break;
+
+    case CommandType::PAUSE_MUSIC:
+      Music::set_current_paused(command.flag);
+      break;
+
+    case CommandType::SET_MUSIC_VOLUME:
+      Music::apply_volume(command.value);
+      break;
+
+    case CommandType::SET_CHANNEL_VOLUME:
+      Music::apply_channel_volume(command.value, command.value2);
+      break;
+
+    case CommandType::SET_TEMPO:
+      Music::apply_tempo(command.value);
+      break;
+
+    case CommandType::SET_MUSIC_FADE:
+      Music::apply_fade_duration(command.value);
+      break;
+
+    case CommandType::ADD_PRELOADED_MUSIC:
+      Music::store_preloaded_file(command.id, std::move(command.data));
+      break;
+  }
+}
+
+/**
+ * \brief Does the periodic work of the audio side.
+ *
+ * Checks the device connection and continues streaming the sounds and
+ * the music.
+ */
+void AudioThread::update_audio() {
+
+  Sound::update_device_connection();
+  Sound::update_sounds();
+  Music::update_music();
+}
+
+}
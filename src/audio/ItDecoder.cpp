@@ -15,18 +15,55 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/ItDecoder.h"
+#include "solarus/audio/MusicQualityInfo.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
 #include <stdafx.h>  // These two headers are with the libmodplug ones.
 #include <sndfile.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
 
 namespace Solarus {
 
+ItDecoder::Resampling ItDecoder::resampling = ItDecoder::Resampling::LINEAR;
+MusicQuality ItDecoder::quality = MusicQuality::HIGH;
+MusicQuality ItDecoder::auto_tier = MusicQuality::HIGH;
+MusicQuality ItDecoder::applied_tier = MusicQuality::HIGH;
+double ItDecoder::decoding_time = 0.0;
+int ItDecoder::decoded_frames = 0;
+
+namespace {
+
+constexpr int output_rate = 44100;               /**< Rate of decoded data. */
+constexpr int low_rate = output_rate / 2;        /**< Mixing rate of lower tiers. */
+constexpr int auto_check_frames = 2 * output_rate;  /**< Audio decoded between two auto checks. */
+constexpr double auto_budget = 0.15;             /**< Maximum share of real time spent decoding
+                                                  * before the auto quality drops a tier. */
+
+/**
+ * \brief Returns the lock that serializes the calls to libmodplug.
+ * \return The lock.
+ */
+std::mutex& get_modplug_mutex() {
+
+  static std::mutex mutex;
+  return mutex;
+}
+
+}
+
 /**
  * \brief Creates an Impulse Tracker decoder.
  */
 ItDecoder::ItDecoder():
-  modplug_file(nullptr) {
+  modplug_file(nullptr),
+  loop(true),
+  mix_buffer(),
+  last_frame() {
 
+  std::lock_guard<std::mutex> lock(get_modplug_mutex());
   ModPlug_Settings settings;
   ModPlug_GetSettings(&settings);
   settings.mChannels = 2;     // stereo
@@ -37,18 +74,33 @@ ItDecoder::ItDecoder():
 
 /**
  * \brief Loads an IT file from memory.
- * \param sound_buffer The memory area to read
+ * \param sound_data The memory area to read.
+ * \param sound_size Size of the memory area in bytes.
  */
-void ItDecoder::load(const std::string& sound_buffer) {
+void ItDecoder::load(const char* sound_data, size_t sound_size) {
 
   Debug::check_assertion(modplug_file == nullptr,
       "IT data is already loaded"
   );
 
+  std::lock_guard<std::mutex> lock(get_modplug_mutex());
+
+  // The loop count and the resampling are taken into account when loading.
+  ModPlug_Settings settings;
+  ModPlug_GetSettings(&settings);
+  settings.mLoopCount = loop ? -1 : 0;  // -1 means looping forever.
+  settings.mResamplingMode = static_cast<int>(resampling);
+  ModPlug_SetSettings(&settings);
+
   // Load the IT data into the IT library.
   modplug_file = ModPlugFileUniquePtr(
-      ModPlug_Load((const void*) sound_buffer.data(), (int) sound_buffer.size())
+      ModPlug_Load((const void*) sound_data, (int) sound_size)
   );
+
+  // Loading resets the mixer to the settings above.
+  applied_tier = MusicQuality::HIGH;
+  last_frame[0] = 0;
+  last_frame[1] = 0;
 }
 
 /**
@@ -63,16 +115,87 @@ void ItDecoder::unload() {
   modplug_file = nullptr;
 }
 
+/**
+ * \brief Returns whether an IT file is loaded.
+ * \return \c true if a file was successfully loaded.
+ */
+bool ItDecoder::is_loaded() const {
+
+  return modplug_file != nullptr;
+}
+
 /**
  * \brief Decodes a chunk of the previously loaded IT data into PCM data.
+ *
+ * The data is mixed with the tier of the current quality setting.
+ *
  * \param decoded_data Pointer to where you want the decoded data to be written.
  * \param nb_samples Number of samples to write.
  * \return The number of bytes read, or 0 if the end is reached.
  */
 int ItDecoder::decode(void* decoded_data, int nb_samples) {
 
-  // Decode from the IT data the specified number of PCM samples.
-  return ModPlug_Read(modplug_file.get(), decoded_data, nb_samples);
+  std::lock_guard<std::mutex> lock(get_modplug_mutex());
+
+  const MusicQuality tier = get_tier();
+  if (tier != applied_tier) {
+    apply_tier(tier);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  int bytes_read = 0;
+  if (tier == MusicQuality::HIGH) {
+    // Decode from the IT data the specified number of PCM samples.
+    bytes_read = ModPlug_Read(modplug_file.get(), decoded_data, nb_samples);
+  }
+  else {
+    bytes_read = decode_expanded(
+        static_cast<int16_t*>(decoded_data), nb_samples / 4, tier
+    ) * 4;
+  }
+
+  if (quality == MusicQuality::AUTO) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    measure_decoding(elapsed.count(), bytes_read / 4);
+  }
+  return bytes_read;
+}
+
+/**
+ * \brief Decodes data at the mixing rate of a lower tier and expands it
+ * to 44100 Hz stereo.
+ *
+ * Lower tiers mix at half the output rate: each mixed frame gives the
+ * midpoint with the previous one, then itself.
+ *
+ * \param decoded_data Where to write the expanded frames.
+ * \param nb_frames Number of stereo frames to write.
+ * \param tier The tier currently applied.
+ * \return The number of frames written, or 0 if the end is reached.
+ */
+int ItDecoder::decode_expanded(int16_t* decoded_data, int nb_frames, MusicQuality tier) {
+
+  const int num_channels = (tier == MusicQuality::LOW) ? 1 : 2;
+  const int nb_mixed_frames = nb_frames / 2;
+  mix_buffer.resize(nb_mixed_frames * num_channels);
+
+  CSoundFile* sound_file = reinterpret_cast<CSoundFile*>(modplug_file.get());
+  const int nb_read = static_cast<int>(sound_file->Read(
+      mix_buffer.data(), nb_mixed_frames * num_channels * sizeof(int16_t)
+  ));
+
+  for (int i = 0; i < nb_read; ++i) {
+    const int16_t left = mix_buffer[i * num_channels];
+    const int16_t right = mix_buffer[i * num_channels + num_channels - 1];
+    int16_t* frames = &decoded_data[i * 4];
+    frames[0] = static_cast<int16_t>((last_frame[0] + left) / 2);
+    frames[1] = static_cast<int16_t>((last_frame[1] + right) / 2);
+    frames[2] = left;
+    frames[3] = right;
+    last_frame[0] = left;
+    last_frame[1] = right;
+  }
+  return nb_read * 2;
 }
 
 /**
@@ -146,26 +269,153 @@ void ItDecoder::set_tempo(int tempo) {
   reinterpret_cast<CSoundFile*>(modplug_file.get())->SetTempo(tempo);
 }
 
+/**
+ * \brief Moves to another position in the music.
+ * \param milliseconds The new position.
+ */
+void ItDecoder::seek(int milliseconds) {
+
+  std::lock_guard<std::mutex> lock(get_modplug_mutex());
+  ModPlug_Seek(modplug_file.get(), milliseconds);
+}
+
 /**
  * \brief Returns whether the decoder loops when reaching the end.
  */
 bool ItDecoder::loops() const {
 
-  ModPlug_Settings settings;
-  ModPlug_GetSettings(&settings);
-  return settings.mLoopCount == -1;  // -1 means looping forever.
+  return loop;
 }
 
 /**
  * \brief Sets whether the decoder should loop when reaching the end.
+ *
+ * This applies to the next file loaded.
+ *
  * \param loops \c true to make the decoder loop.
  */
 void ItDecoder::set_loops(bool loops) {
 
-  ModPlug_Settings settings;
-  ModPlug_GetSettings(&settings);
-  settings.mLoopCount = loops ? -1 : 0;
-  ModPlug_SetSettings(&settings);
+  loop = loops;
+}
+
+/**
+ * \brief Returns the interpolation used to resample instruments.
+ * \return The resampling mode.
+ */
+ItDecoder::Resampling ItDecoder::get_resampling() {
+
+  return resampling;
+}
+
+/**
+ * \brief Sets the interpolation used to resample instruments.
+ *
+ * This applies to the files loaded afterwards.
+ *
+ * \param resampling The resampling mode.
+ */
+void ItDecoder::set_resampling(Resampling resampling) {
+
+  ItDecoder::resampling = resampling;
+}
+
+/**
+ * \brief Returns the quality setting of module musics.
+ * \return The quality setting.
+ */
+MusicQuality ItDecoder::get_quality() {
+
+  std::lock_guard<std::mutex> lock(get_modplug_mutex());
+  return quality;
+}
+
+/**
+ * \brief Sets the quality of module musics.
+ *
+ * This applies to the next data decoded, including by decoders already
+ * playing. The auto quality starts again from the high tier.
+ *
+ * \param quality The quality setting.
+ */
+void ItDecoder::set_quality(MusicQuality quality) {
+
+  std::lock_guard<std::mutex> lock(get_modplug_mutex());
+  ItDecoder::quality = quality;
+  auto_tier = MusicQuality::HIGH;
+  decoding_time = 0.0;
+  decoded_frames = 0;
+}
+
+/**
+ * \brief Returns the tier to decode with.
+ *
+ * The modplug mutex must be locked.
+ *
+ * \return The tier: low, medium or high.
+ */
+MusicQuality ItDecoder::get_tier() {
+
+  return (quality == MusicQuality::AUTO) ? auto_tier : quality;
+}
+
+/**
+ * \brief Changes the global mixing settings of libmodplug to a tier.
+ *
+ * The high tier matches what ModPlug_Load() sets.
+ * The modplug mutex must be locked.
+ *
+ * \param tier The tier to apply: low, medium or high.
+ */
+void ItDecoder::apply_tier(MusicQuality tier) {
+
+  const bool high = (tier == MusicQuality::HIGH);
+  int resampling_mode = static_cast<int>(resampling);
+  if (tier == MusicQuality::MEDIUM) {
+    resampling_mode = std::min(resampling_mode, static_cast<int>(Resampling::LINEAR));
+  }
+  else if (tier == MusicQuality::LOW) {
+    resampling_mode = static_cast<int>(Resampling::NEAREST);
+  }
+
+  CSoundFile::SetWaveConfig(high ? output_rate : low_rate, 16, (tier == MusicQuality::LOW) ? 1 : 2);
+  // Surround, reverb and bass expansion stay off.
+  // Oversampling and noise reduction are only kept in the high tier.
+  CSoundFile::SetWaveConfigEx(false, !high, false, true, false, high, false);
+  CSoundFile::SetResamplingMode(resampling_mode);
+  applied_tier = tier;
+}
+
+/**
+ * \brief Accounts the time spent decoding for the auto quality.
+ *
+ * Every two seconds of audio, drops a tier if decoding took more than
+ * its budget of real time.
+ * The modplug mutex must be locked.
+ *
+ * \param seconds Time spent decoding.
+ * \param nb_frames Number of 44100 Hz frames decoded in this time.
+ */
+void ItDecoder::measure_decoding(double seconds, int nb_frames) {
+
+  decoding_time += seconds;
+  decoded_frames += nb_frames;
+  if (decoded_frames < auto_check_frames) {
+    return;
+  }
+
+  const double load = decoding_time * output_rate / decoded_frames;
+  decoding_time = 0.0;
+  decoded_frames = 0;
+  if (load <= auto_budget || auto_tier == MusicQuality::LOW) {
+    return;
+  }
+
+  auto_tier = (auto_tier == MusicQuality::HIGH) ? MusicQuality::MEDIUM : MusicQuality::LOW;
+  std::ostringstream oss;
+  oss << "Decoding .it musics takes " << static_cast<int>(load * 100)
+      << "% of real time: switching to " << enum_to_name(auto_tier) << " quality";
+  Logger::info(oss.str());
 }
 
 }
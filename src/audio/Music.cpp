@@ -14,27 +14,49 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/audio/AudioThread.h"
 #include "solarus/audio/ItDecoder.h"
 #include "solarus/audio/Music.h"
+#include "solarus/audio/MusicQualityInfo.h"
 #include "solarus/audio/OggDecoder.h"
 #include "solarus/audio/SpcDecoder.h"
+#include "solarus/core/Arguments.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/JobSystem.h"
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/String.h"
+#include "solarus/core/System.h"
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
 #include <algorithm>
+#include <chrono>
 #include <sstream>
+#include <thread>
+#include <utility>
 
 namespace Solarus {
 
 constexpr int Music::nb_buffers;
 constexpr int Music::buffer_size;
-std::unique_ptr<SpcDecoder> Music::spc_decoder = nullptr;
-std::unique_ptr<ItDecoder> Music::it_decoder = nullptr;
-std::unique_ptr<OggDecoder> Music::ogg_decoder = nullptr;
+bool Music::initialized = false;
 float Music::volume = 1.0;
+int Music::volume_setting = 100;
+std::atomic<int> Music::tempo(0);
+std::atomic<int> Music::buffer_fill_level(0);
 std::unique_ptr<Music> Music::current_music = nullptr;
+std::unique_ptr<Music> Music::fading_music = nullptr;
+std::unique_ptr<Music> Music::pending_music = nullptr;
+std::future<bool> Music::pending_load;
+bool Music::pending_paused = false;
+int Music::fade_duration = 0;
+int Music::fade_duration_setting = 0;
+bool Music::quality_from_arguments = false;
+Music::State Music::state;
+uint32_t Music::last_serial = 0;
+std::vector<ScopedLuaRef> Music::finished_callbacks;
+constexpr size_t Music::max_preloaded_files;
+std::deque<std::pair<std::string, std::string>> Music::preloaded_files;
 
 const std::string Music::none = "none";
 const std::string Music::unchanged = "same";
@@ -56,7 +78,19 @@ Music::Music():
   id(none),
   format(NO_FORMAT),
   loop(false),
-  callback_ref(),
+  serial(0),
+  track(),
+  position(0),
+  playing_cached(false),
+  live_only(false),
+  file_data(),
+  file_data_taken(false),
+  fade_start_date(0),
+  fading_in(false),
+  fading_out(false),
+  spc_decoder(),
+  it_decoder(),
+  ogg_decoder(),
   source(AL_NONE) {
 
   for (int i = 0; i < nb_buffers; i++) {
@@ -67,39 +101,101 @@ Music::Music():
 /**
  * \brief Creates a new music.
  * \param music_id Id of the music (file name without extension).
+ * \param file_name File of the music, as found by find_music_file().
+ * \param format Format of the file.
  * \param loop Whether the music should loop when reaching its end.
- * \param callback_ref Lua function to call when the music ends
- * or an empty ref.
- * There cannot be both a loop and a callback at the same time.
+ * \param serial Number of the request that plays this music.
  */
 Music::Music(
     const std::string& music_id,
+    const std::string& file_name,
+    Format format,
     bool loop,
-    const ScopedLuaRef& callback_ref):
+    uint32_t serial):
   id(music_id),
-  format(OGG),
+  file_name(file_name),
+  format(format),
   loop(loop),
-  callback_ref(callback_ref),
+  serial(serial),
+  track(),
+  position(0),
+  playing_cached(false),
+  live_only(false),
+  file_data(),
+  file_data_taken(false),
+  fade_start_date(0),
+  fading_in(false),
+  fading_out(false),
+  spc_decoder(),
+  it_decoder(),
+  ogg_decoder(),
   source(AL_NONE) {
 
-  Debug::check_assertion(!loop || callback_ref.is_empty(),
-      "Attempt to set both a loop and a callback to music"
-  );
-
   for (int i = 0; i < nb_buffers; i++) {
     buffers[i] = AL_NONE;
   }
 }
 
+/**
+ * \brief Destroys a music and its decoder.
+ */
+Music::~Music() {
+}
+
 /**
  * \brief Initializes the music system.
+ *
+ * If the argument -music-resampling is provided, it sets the interpolation
+ * of .it musics: "nearest", "linear" (the default), "spline" or "fir".
+ * If the argument -music-quality is provided, it sets the rendering tier of
+ * .it musics instead of quest.dat: "low", "medium", "high" or "auto".
+ * If the argument -music-prerender is provided and is "yes", .spc and .it
+ * musics are rendered in advance into a cache whose size in MiB is given by
+ * -music-cache-size (32 by default).
+ *
+ * \param args Command-line arguments.
  */
-void Music::initialize() {
+void Music::initialize(const Arguments& args) {
+
+  const std::string& resampling_arg = args.get_argument_value("-music-resampling");
+  if (resampling_arg == "nearest") {
+    ItDecoder::set_resampling(ItDecoder::Resampling::NEAREST);
+  }
+  else if (resampling_arg == "linear") {
+    ItDecoder::set_resampling(ItDecoder::Resampling::LINEAR);
+  }
+  else if (resampling_arg == "spline") {
+    ItDecoder::set_resampling(ItDecoder::Resampling::SPLINE);
+  }
+  else if (resampling_arg == "fir") {
+    ItDecoder::set_resampling(ItDecoder::Resampling::FIR);
+  }
+
+  const std::string& quality_arg = args.get_argument_value("-music-quality");
+  if (!quality_arg.empty()) {
+    bool success = false;
+    const MusicQuality quality = name_to_enum(quality_arg, MusicQuality::HIGH, success);
+    if (success) {
+      ItDecoder::set_quality(quality);
+      quality_from_arguments = true;
+    }
+  }
+
+  if (args.get_argument_value("-music-prerender") == "yes") {
+    size_t cache_size = 32 * 1024 * 1024;
+    const std::string& cache_size_arg = args.get_argument_value("-music-cache-size");
+    if (!cache_size_arg.empty()) {
+      std::istringstream iss(cache_size_arg);
+      int mebibytes = 0;
+      if (iss >> mebibytes && mebibytes >= 0) {
+        cache_size = static_cast<size_t>(mebibytes) * 1024 * 1024;
+      }
+    }
+    PcmCache::initialize(cache_size);
+  }
 
-  // initialize the decoding features
-  spc_decoder = std::unique_ptr<SpcDecoder>(new SpcDecoder());
-  it_decoder = std::unique_ptr<ItDecoder>(new ItDecoder());
-  ogg_decoder = std::unique_ptr<OggDecoder>(new OggDecoder());
+  // Decoders are created by each music.
+  initialized = true;
 
   set_volume(100);
 }
@@ -110,10 +206,22 @@ void Music::initialize() {
 void Music::quit() {
 
   if (is_initialized()) {
+    if (pending_music != nullptr) {
+      pending_load.wait();
+      pending_music = nullptr;
+    }
     current_music = nullptr;
-    spc_decoder = nullptr;
-    it_decoder = nullptr;
+    fading_music = nullptr;
+    initialized = false;
     volume = 1.0;
+    volume_setting = 100;
+    fade_duration = 0;
+    fade_duration_setting = 0;
+    ItDecoder::set_quality(MusicQuality::HIGH);
+    quality_from_arguments = false;
+    state = State();
+    finished_callbacks.clear();
+    PcmCache::quit();
   }
 }
 
@@ -122,7 +230,7 @@ void Music::quit() {
  * \return \c true if the music system is initialized.
  */
 bool Music::is_initialized() {
-  return spc_decoder != nullptr;
+  return initialized;
 }
 
 /**
@@ -131,11 +239,8 @@ bool Music::is_initialized() {
  */
 Music::Format Music::get_format() {
 
-  if (current_music == nullptr) {
-    return NO_FORMAT;
-  }
-
-  return current_music->format;
+  wait_for_start();
+  return state.format;
 }
 
 /**
@@ -144,7 +249,7 @@ Music::Format Music::get_format() {
  */
 int Music::get_volume() {
 
-  return (int) (volume * 100.0 + 0.5);
+  return volume_setting;
 }
 
 /**
@@ -153,11 +258,27 @@ int Music::get_volume() {
  */
 void Music::set_volume(int volume) {
 
-  volume = std::min(100, std::max(0, volume));
+  volume_setting = std::min(100, std::max(0, volume));
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::SET_MUSIC_VOLUME;
+  command.value = volume_setting;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Sets the volume of musics, on the audio side.
+ * \param volume the new volume (0 to 100)
+ */
+void Music::apply_volume(int volume) {
+
   Music::volume = volume / 100.0;
 
-  if (current_music != nullptr && current_music->source != AL_NONE) {
-    alSourcef(current_music->source, AL_GAIN, Music::volume);
+  if (current_music != nullptr) {
+    current_music->update_gain();
+  }
+  if (fading_music != nullptr) {
+    fading_music->update_gain();
   }
 }
 
@@ -173,7 +294,7 @@ int Music::get_num_channels() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
-  return it_decoder->get_num_channels();
+  return state.num_channels;
 }
 
 /**
@@ -188,8 +309,10 @@ int Music::get_channel_volume(int channel) {
 
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
+  Debug::check_assertion(channel >= 0 && channel < state.num_channels,
+      "Invalid channel number");
 
-  return it_decoder->get_channel_volume(channel);
+  return state.channel_volumes[channel];
 }
 
 /**
@@ -204,8 +327,30 @@ void Music::set_channel_volume(int channel, int volume) {
 
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
+  Debug::check_assertion(channel >= 0 && channel < state.num_channels,
+      "Invalid channel number");
 
-  it_decoder->set_channel_volume(channel, volume);
+  state.channel_volumes[channel] = volume;
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::SET_CHANNEL_VOLUME;
+  command.value = channel;
+  command.value2 = volume;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Sets the volume of a channel of the current music, on the audio side.
+ * \param channel Index of a channel.
+ * \param volume The volume to set.
+ */
+void Music::apply_channel_volume(int channel, int volume) {
+
+  if (current_music != nullptr && current_music->format == IT) {
+    // The rendered track no longer matches the music.
+    current_music->leave_cache();
+    current_music->it_decoder->set_channel_volume(channel, volume);
+  }
 }
 
 /**
@@ -220,7 +365,7 @@ int Music::get_tempo() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
-  return it_decoder->get_tempo();
+  return tempo;
 }
 
 /**
@@ -235,7 +380,92 @@ void Music::set_tempo(int tempo) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
-  it_decoder->set_tempo(tempo);
+  Music::tempo = tempo;
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::SET_TEMPO;
+  command.value = tempo;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Sets the tempo of the current music, on the audio side.
+ * \param tempo The tempo to set.
+ */
+void Music::apply_tempo(int tempo) {
+
+  if (current_music != nullptr && current_music->format == IT) {
+    current_music->leave_cache();
+    current_music->it_decoder->set_tempo(tempo);
+    Music::tempo = current_music->it_decoder->get_tempo();
+  }
+}
+
+/**
+ * \brief Returns the duration of crossfades between musics.
+ * \return The duration in milliseconds, 0 if musics are switched at once.
+ */
+int Music::get_fade_duration() {
+  return fade_duration_setting;
+}
+
+/**
+ * \brief Sets the duration of crossfades between musics.
+ *
+ * When the music changes, the previous one fades out during this time while
+ * the new one fades in. Stopping the music also fades it out.
+ *
+ * \param fade_duration The duration in milliseconds, 0 to switch at once.
+ */
+void Music::set_fade_duration(int fade_duration) {
+
+  fade_duration_setting = std::max(0, fade_duration);
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::SET_MUSIC_FADE;
+  command.value = fade_duration_setting;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Sets the duration of crossfades between musics, on the audio side.
+ * \param fade_duration The duration in milliseconds.
+ */
+void Music::apply_fade_duration(int fade_duration) {
+  Music::fade_duration = fade_duration;
+}
+
+/**
+ * \brief Returns the rendering tier of .it musics.
+ * \return The quality setting.
+ */
+MusicQuality Music::get_quality() {
+  return ItDecoder::get_quality();
+}
+
+/**
+ * \brief Sets the rendering tier of .it musics.
+ *
+ * This also applies to the music currently playing.
+ *
+ * \param quality The quality setting.
+ */
+void Music::set_quality(MusicQuality quality) {
+  ItDecoder::set_quality(quality);
+}
+
+/**
+ * \brief Sets the rendering tier of .it musics requested by quest.dat.
+ *
+ * Ignored if the -music-quality argument was provided.
+ *
+ * \param quality The quality setting.
+ */
+void Music::set_quest_quality(MusicQuality quality) {
+
+  if (!quality_from_arguments) {
+    set_quality(quality);
+  }
 }
 
 /**
@@ -243,7 +473,24 @@ void Music::set_tempo(int tempo) {
  * \return the id of the current music, or "none" if no music is being played
  */
 const std::string& Music::get_current_music_id() {
-  return current_music != nullptr ? current_music->id : none;
+  return state.id;
+}
+
+/**
+ * \brief Returns how full the streaming buffers of the current music are.
+ *
+ * A level that often drops low means that the audio thread has trouble
+ * decoding in time.
+ *
+ * \return Percentage of buffers queued before the last refill,
+ * or -1 if no music is playing.
+ */
+int Music::get_buffer_fill_level() {
+
+  if (state.serial == 0) {
+    return -1;
+  }
+  return buffer_fill_level;
 }
 
 /**
@@ -275,6 +522,66 @@ void Music::find_music_file(const std::string& music_id,
   }
 }
 
+/**
+ * \brief Keeps the content of a music file read in advance.
+ *
+ * The next time this file is played, it will not be read again.
+ * Only the most recent files are kept.
+ *
+ * \param file_name Name of the music file, as found by find_music_file().
+ * \param data Content of the file.
+ */
+void Music::add_preloaded_file(const std::string& file_name, std::string&& data) {
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::ADD_PRELOADED_MUSIC;
+  command.id = file_name;
+  command.data = std::move(data);
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Keeps the content of a music file read in advance, on the audio side.
+ * \param file_name Name of the music file, as found by find_music_file().
+ * \param data Content of the file.
+ */
+void Music::store_preloaded_file(const std::string& file_name, std::string&& data) {
+
+  for (const auto& preloaded_file : preloaded_files) {
+    if (preloaded_file.first == file_name) {
+      return;
+    }
+  }
+  MemoryUsage::add(MemoryUsage::Category::MUSICS, static_cast<int64_t>(data.size()));
+  preloaded_files.emplace_back(file_name, std::move(data));
+  if (preloaded_files.size() > max_preloaded_files) {
+    MemoryUsage::add(MemoryUsage::Category::MUSICS,
+        -static_cast<int64_t>(preloaded_files.front().second.size()));
+    preloaded_files.pop_front();
+  }
+}
+
+/**
+ * \brief Takes the content of the file of this music if it was read
+ * in advance.
+ *
+ * Must be called on the audio side, before load().
+ * Otherwise, load() reads the file itself.
+ */
+void Music::take_file_data() {
+
+  for (auto it = preloaded_files.begin(); it != preloaded_files.end(); ++it) {
+    if (it->first == file_name) {
+      MemoryUsage::add(MemoryUsage::Category::MUSICS,
+          -static_cast<int64_t>(it->second.size()));
+      file_data = QuestFiles::DataFileView(std::move(it->second));
+      file_data_taken = true;
+      preloaded_files.erase(it);
+      return;
+    }
+  }
+}
+
 /**
  * \brief Returns whether a music exists.
  * \param music_id Id of the music to test. Music::none and Music::unchanged
@@ -324,26 +631,181 @@ void Music::play(
     bool loop,
     const ScopedLuaRef& callback_ref
 ) {
-  if (music_id != unchanged && music_id != get_current_music_id()) {
-    // The music is changed.
+  if (!is_initialized()) {
+    return;
+  }
 
-    if (current_music != nullptr) {
-      // Stop the music that was played.
-      current_music->stop();
-      current_music = nullptr;
-    }
+  if (music_id == unchanged || music_id == get_current_music_id()) {
+    return;
+  }
 
-    if (music_id != none) {
-      // Play another music.
-      current_music = std::unique_ptr<Music>(
-          new Music(music_id, loop, callback_ref)
+  // The music is changed: the previous one is stopped and its callback dropped.
+  Debug::check_assertion(!loop || callback_ref.is_empty(),
+      "Attempt to set both a loop and a callback to music"
+  );
+  state = State();
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::PLAY_MUSIC;
+  command.id = none;
+
+  if (music_id != none) {
+    // Play another music.
+    std::string file_name;
+    Format format;
+    find_music_file(music_id, file_name, format);
+
+    if (file_name.empty()) {
+      Debug::error(std::string("Cannot find music file 'musics/")
+          + music_id + "' (tried with extensions .ogg, .it and .spc)"
       );
-      if (!current_music->start()) {
-        // Could not play the music.
-        current_music = nullptr;
+    }
+    else {
+      state.id = music_id;
+      state.format = format;
+      state.serial = ++last_serial;
+      state.callback_ref = callback_ref;
+
+      command.id = music_id;
+      command.data = file_name;
+      command.value = format;
+      command.flag = loop;
+      command.serial = state.serial;
+    }
+  }
+
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Replaces the music played, on the audio side.
+ *
+ * Sends MUSIC_STARTED or MUSIC_FAILED back to the main thread, at once or
+ * from update_music() if the new music is loaded in background.
+ *
+ * \param music_id Id of the music to play, or Music::none to only stop the
+ * current one.
+ * \param file_name File of the music.
+ * \param format Format of the file.
+ * \param loop Whether the music should loop when reaching its end.
+ * \param serial Number of the request.
+ */
+void Music::play_file(
+    const std::string& music_id,
+    const std::string& file_name,
+    Format format,
+    bool loop,
+    uint32_t serial
+) {
+  if (pending_music != nullptr) {
+    // The previous request is replaced before it could start.
+    pending_load.wait();
+    pending_music->stop();
+    pending_music = nullptr;
+  }
+
+  if (music_id == none) {
+    retire_current_music();
+    return;
+  }
+
+  std::unique_ptr<Music> music(new Music(music_id, file_name, format, loop, serial));
+  music->take_file_data();
+
+  if (AudioThread::is_running() && format != IT) {
+    // Load it in background while the current music continues.
+    pending_music = std::move(music);
+    pending_paused = false;
+    Music* loading_music = pending_music.get();
+    pending_load = JobSystem::async(JobSystem::Priority::IO, [loading_music]() {
+      return loading_music->load();
+    });
+    return;
+  }
+
+  retire_current_music();
+  current_music = std::move(music);
+  if (fading_music != nullptr) {
+    current_music->start_fade(true);
+  }
+  notify_started(current_music->start());
+}
+
+/**
+ * \brief Replaces the current music by the pending one once it is loaded.
+ *
+ * Does nothing if there is no pending music or if it is still loading.
+ */
+void Music::finish_pending_music() {
+
+  if (pending_music == nullptr ||
+      pending_load.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return;
+  }
+
+  const bool loaded = pending_load.get();
+  retire_current_music();
+  current_music = std::move(pending_music);
+  if (fading_music != nullptr) {
+    current_music->start_fade(true);
+  }
+  const bool success = current_music->start_streaming() && loaded;
+  if (success && pending_paused) {
+    current_music->set_paused(true);
+  }
+  notify_started(success);
+}
+
+/**
+ * \brief Stops the current music, or makes it fade out if there is
+ * a fade duration.
+ */
+void Music::retire_current_music() {
+
+  if (current_music == nullptr) {
+    return;
+  }
+
+  if (fade_duration <= 0 || current_music->is_paused()) {
+    current_music->stop();
+    current_music = nullptr;
+    return;
+  }
+
+  if (fading_music != nullptr) {
+    // Only one music fades out at a time.
+    fading_music->stop();
+  }
+  fading_music = std::move(current_music);
+  fading_music->start_fade(false);
+}
+
+/**
+ * \brief Tells the main thread whether the current music could start.
+ * \param success Whether the current music is playing.
+ * It is destroyed otherwise.
+ */
+void Music::notify_started(bool success) {
+
+  AudioThread::Event event;
+  event.serial = current_music->serial;
+  if (!success) {
+    // Could not play the music.
+    current_music = nullptr;
+    event.type = AudioThread::EventType::MUSIC_FAILED;
+  }
+  else {
+    event.type = AudioThread::EventType::MUSIC_STARTED;
+    if (current_music->format == IT) {
+      const ItDecoder& it_decoder = *current_music->it_decoder;
+      event.num_channels = it_decoder.get_num_channels();
+      for (int i = 0; i < event.num_channels; ++i) {
+        event.channel_volumes.push_back(it_decoder.get_channel_volume(i));
       }
+      tempo = it_decoder.get_tempo();
     }
   }
+  AudioThread::post_event(std::move(event));
 }
 
 /**
@@ -363,9 +825,10 @@ void Music::stop_playing() {
  */
 void Music::pause_playing() {
 
-  if (current_music != nullptr) {
-    current_music->set_paused(true);
-  }
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::PAUSE_MUSIC;
+  command.flag = true;
+  AudioThread::post(std::move(command));
 }
 
 /**
@@ -375,15 +838,36 @@ void Music::pause_playing() {
  */
 void Music::resume_playing() {
 
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::PAUSE_MUSIC;
+  command.flag = false;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Pauses or resumes the current music, on the audio side.
+ * \param pause true to pause the music, false to resume it
+ */
+void Music::set_current_paused(bool pause) {
+
+  if (pending_music != nullptr) {
+    pending_paused = pause;
+  }
   if (current_music != nullptr) {
-    current_music->set_paused(false);
+    current_music->set_paused(pause);
+  }
+  if (fading_music != nullptr && pause) {
+    // No need to finish fading out a paused music.
+    fading_music->stop();
+    fading_music = nullptr;
   }
 }
 
 /**
- * \brief Updates the music system.
+ * \brief Updates the music system from the main thread.
  *
- * When a music is playing, this function continues the streaming.
+ * Handles the events sent by the audio thread and calls the callback
+ * of the music if it is finished.
  */
 void Music::update() {
 
@@ -391,14 +875,106 @@ void Music::update() {
     return;
   }
 
+  handle_events();
+
+  std::vector<ScopedLuaRef> callbacks;
+  callbacks.swap(finished_callbacks);
+  for (ScopedLuaRef& callback_ref : callbacks) {
+    callback_ref.call("music callback");
+  }
+}
+
+/**
+ * \brief Applies the events sent by the audio thread to the state
+ * of the main thread.
+ *
+ * Events about a music that was replaced since then are ignored.
+ * Callbacks of finished musics are only stored: update() calls them.
+ */
+void Music::handle_events() {
+
+  AudioThread::Event event;
+  while (AudioThread::poll_event(event)) {
+
+    if (event.serial == 0 || event.serial != state.serial) {
+      continue;
+    }
+
+    switch (event.type) {
+
+      case AudioThread::EventType::NONE:
+        break;
+
+      case AudioThread::EventType::MUSIC_STARTED:
+        state.started = true;
+        state.num_channels = event.num_channels;
+        state.channel_volumes = std::move(event.channel_volumes);
+        break;
+
+      case AudioThread::EventType::MUSIC_FAILED:
+        state = State();
+        break;
+
+      case AudioThread::EventType::MUSIC_FINISHED:
+        finished_callbacks.push_back(state.callback_ref);
+        state = State();
+        break;
+    }
+  }
+}
+
+/**
+ * \brief Waits until the audio thread reports the start of an .it music.
+ *
+ * The properties of .it musics are only known once the file is loaded.
+ * Returns immediately for other formats.
+ */
+void Music::wait_for_start() {
+
+  while (state.format == IT && !state.started) {
+    handle_events();
+    if (!AudioThread::is_running()) {
+      // The music was started synchronously: there is nothing to wait for.
+      break;
+    }
+    if (state.format == IT && !state.started) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+/**
+ * \brief Continues streaming the current music, on the audio side.
+ *
+ * Sends MUSIC_FINISHED to the main thread when the music reaches its end.
+ */
+void Music::update_music() {
+
+  if (!is_initialized()) {
+    return;
+  }
+
+  finish_pending_music();
+
+  if (fading_music != nullptr) {
+    fading_music->update_gain();
+    if (fading_music->is_faded_out() || !fading_music->update_playing()) {
+      fading_music->stop();
+      fading_music = nullptr;
+    }
+  }
+
   if (current_music != nullptr) {
+    current_music->update_gain();
     bool playing = current_music->update_playing();
     if (!playing) {
       // Music is finished.
-      ScopedLuaRef callback_ref = current_music->callback_ref;
+      AudioThread::Event event;
+      event.type = AudioThread::EventType::MUSIC_FINISHED;
+      event.serial = current_music->serial;
       current_music->stop();
       current_music = nullptr;
-      callback_ref.call("music callback");
+      AudioThread::post_event(std::move(event));
     }
   }
 }
@@ -420,6 +996,9 @@ bool Music::update_playing() {
   // Get the empty buffers.
   ALint nb_empty;
   alGetSourcei(source, AL_BUFFERS_PROCESSED, &nb_empty);
+  if (this == current_music.get()) {
+    buffer_fill_level = (nb_buffers - nb_empty) * 100 / nb_buffers;
+  }
 
   // Refill them.
   for (int i = 0; i < nb_empty; i++) {
@@ -466,6 +1045,16 @@ bool Music::update_playing() {
  */
 void Music::notify_device_disconnected_all() {
 
+  if (pending_music != nullptr) {
+    // Let it start so that it is restored like the current music.
+    pending_load.wait();
+    finish_pending_music();
+  }
+  if (fading_music != nullptr) {
+    // Its sources and buffers are gone: no need to fade it out.
+    fading_music->notify_device_disconnected();
+    fading_music = nullptr;
+  }
   if (current_music != nullptr) {
     current_music->notify_device_disconnected();
   }
@@ -499,7 +1088,7 @@ void Music::notify_device_reconnected() {
     // Recreate a source and buffers.
     alGenBuffers(nb_buffers, buffers);
     alGenSources(1, &source);
-    alSourcef(source, AL_GAIN, volume);
+    alSourcef(source, AL_GAIN, get_gain());
 
     // Continue playing music.
     // Buffer data that was already decoded to buffers before the
@@ -533,6 +1122,11 @@ void Music::notify_device_reconnected() {
  */
 void Music::decode_spc(ALuint destination_buffer, ALsizei nb_samples) {
 
+  if (decode_cached(destination_buffer, nb_samples / 2)) {
+    return;
+  }
+  position += nb_samples / 2;
+
   // decode the SPC data
   std::vector<ALushort> raw_data(nb_samples);
   spc_decoder->decode((int16_t*) raw_data.data(), nb_samples);
@@ -558,7 +1152,11 @@ void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
 
   // Decode the IT data.
   std::vector<ALushort> raw_data(nb_samples);
+  if (decode_cached(destination_buffer, nb_samples / 4)) {
+    return;
+  }
   int bytes_read = it_decoder->decode(raw_data.data(), nb_samples);
+  position += bytes_read / 4;
 
   if (bytes_read == 0) {
     // End of file.
@@ -568,6 +1166,9 @@ void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
     // Put this decoded data into the buffer.
     alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples, 44100);
   }
+  if (this == current_music.get()) {
+    tempo = it_decoder->get_tempo();
+  }
   int error = alGetError();
   if (error != AL_NO_ERROR) {
     std::ostringstream oss;
@@ -577,6 +1178,61 @@ void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
   }
 }
 
+/**
+ * \brief Fills a buffer from the rendered track of this music if possible.
+ *
+ * The track is used once it is complete, unless the live decoding already
+ * went past its end: switching then would jump back in the music.
+ *
+ * \param destination_buffer The destination buffer to write.
+ * \param nb_frames Number of stereo frames to write.
+ * \return \c false if the music must be decoded live.
+ */
+bool Music::decode_cached(ALuint destination_buffer, size_t nb_frames) {
+
+  if (live_only || track == nullptr || !track->is_complete()) {
+    return false;
+  }
+
+  if (!playing_cached && position >= track->get_num_frames()) {
+    live_only = true;
+    track = nullptr;
+    return false;
+  }
+
+  std::vector<int16_t> frames(nb_frames * 2);
+  track->read(position, frames.data(), nb_frames);
+  position += nb_frames;
+  playing_cached = true;
+
+  alBufferData(destination_buffer, AL_FORMAT_STEREO16, frames.data(),
+      nb_frames * 2 * sizeof(int16_t), track->get_sample_rate());
+  int error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Failed to fill the audio buffer with rendered data for music file '"
+        << file_name << ": error " << error;
+    Debug::error(oss.str());
+  }
+  return true;
+}
+
+/**
+ * \brief Stops using the rendered track and decodes this music live again.
+ *
+ * The live decoder continues from the position reached in the track.
+ */
+void Music::leave_cache() {
+
+  if (playing_cached && format == IT) {
+    position %= track->get_num_frames();
+    it_decoder->seek(static_cast<int>(position * 1000 / 44100));
+  }
+  playing_cached = false;
+  live_only = true;
+  track = nullptr;
+}
+
 /**
  * \brief Decodes a chunk of OGG data into PCM data for the current music.
  * \param destination_buffer The destination buffer to write.
@@ -590,12 +1246,24 @@ void Music::decode_ogg(ALuint destination_buffer, ALsizei nb_samples) {
 /**
  * \brief Loads the file and starts playing this music.
  *
- * No other music should be playing.
- *
  * \return true if the music was loaded successfully
  */
 bool Music::start() {
 
+  const bool success = load();
+  return start_streaming() && success;
+}
+
+/**
+ * \brief Loads the file of this music and fills its first buffers.
+ *
+ * For OGG and SPC musics, this may be called from a background thread,
+ * after take_file_data() was called on the audio side.
+ *
+ * \return true if the music was loaded successfully
+ */
+bool Music::load() {
+
   if (!is_initialized()) {
     return false;
   }
@@ -617,18 +1285,22 @@ bool Music::start() {
   // create the buffers and the source
   alGenBuffers(nb_buffers, buffers);
   alGenSources(1, &source);
-  alSourcef(source, AL_GAIN, volume);
+  alSourcef(source, AL_GAIN, get_gain());
 
   // load the music into memory
-  std::string sound_buffer;
+  if (!file_data_taken) {
+    file_data.open(file_name);
+  }
+  QuestFiles::DataFileView sound_buffer = std::move(file_data);
   switch (format) {
 
     case SPC:
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
-
       // Give the SPC data into the SPC decoder.
-      spc_decoder->load((int16_t*) sound_buffer.data(), sound_buffer.size());
+      spc_decoder = std::unique_ptr<SpcDecoder>(new SpcDecoder());
+      spc_decoder->load((const int16_t*) sound_buffer.get_data(), sound_buffer.get_size());
+      track = PcmCache::get_track(file_name, PcmCache::Source::SPC,
+          sound_buffer.get_data(), sound_buffer.get_size());
 
       for (int i = 0; i < nb_buffers; i++) {
         decode_spc(buffers[i], buffer_size);
@@ -637,10 +1309,11 @@ bool Music::start() {
 
     case IT:
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
-
       // Give the IT data to the IT decoder
-      it_decoder->load(sound_buffer);
+      it_decoder = std::unique_ptr<ItDecoder>(new ItDecoder());
+      it_decoder->load(sound_buffer.get_data(), sound_buffer.get_size());
+      track = PcmCache::get_track(file_name, PcmCache::Source::IT,
+          sound_buffer.get_data(), sound_buffer.get_size());
 
       for (int i = 0; i < nb_buffers; i++) {
         decode_it(buffers[i], buffer_size);
@@ -649,9 +1322,8 @@ bool Music::start() {
 
     case OGG:
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
-
       // Give the OGG data to the OGG decoder.
+      ogg_decoder = std::unique_ptr<OggDecoder>(new OggDecoder());
       success = ogg_decoder->load(std::move(sound_buffer), this->loop);
       if (success) {
         for (int i = 0; i < nb_buffers; i++) {
@@ -668,6 +1340,24 @@ bool Music::start() {
   if (!success) {
     Debug::error("Cannot load music file '" + file_name + "'");
   }
+  return success;
+}
+
+/**
+ * \brief Starts playing the buffers filled by load().
+ *
+ * Must be called on the audio side.
+ *
+ * \return true if the music is playing.
+ */
+bool Music::start_streaming() {
+
+  if (source == AL_NONE) {
+    // The file was not found.
+    return false;
+  }
+
+  bool success = true;
 
   // start the streaming
   alSourceQueueBuffers(source, nb_buffers, buffers);
@@ -698,9 +1388,6 @@ void Music::stop() {
     return;
   }
 
-  // Release the callback if any.
-  callback_ref.clear();
-
   // empty the source
   alSourceStop(source);
 
@@ -723,11 +1410,15 @@ void Music::stop() {
       break;
 
     case IT:
-      it_decoder->unload();
+      if (it_decoder != nullptr) {
+        it_decoder->unload();
+      }
       break;
 
     case OGG:
-      ogg_decoder->unload();
+      if (ogg_decoder != nullptr) {
+        ogg_decoder->unload();
+      }
       break;
 
     case NO_FORMAT:
@@ -770,15 +1461,59 @@ void Music::set_paused(bool pause) {
 }
 
 /**
- * \brief Sets a Lua function to call when the music ends.
+ * \brief Starts fading this music in or out.
  *
- * The previous callback if any is discarded.
+ * The fade lasts the current fade duration.
  *
- * \param callback_ref Lua ref to a function to call when the music ends
- * or an empty ref.
+ * \param fade_in \c true to fade in from silence, \c false to fade out.
  */
-void Music::set_callback(const ScopedLuaRef& callback_ref) {
-  this->callback_ref = callback_ref;
+void Music::start_fade(bool fade_in) {
+
+  fade_start_date = System::get_real_time();
+  fading_in = fade_in;
+  fading_out = !fade_in;
+  update_gain();
+}
+
+/**
+ * \brief Returns the gain to apply to the source of this music now.
+ * \return The music volume, reduced if this music is fading.
+ */
+float Music::get_gain() const {
+
+  if ((!fading_in && !fading_out) || fade_duration <= 0) {
+    return volume;
+  }
+
+  const uint32_t elapsed = System::get_real_time() - fade_start_date;
+  const float progress = std::min(1.0f, static_cast<float>(elapsed) / fade_duration);
+  return volume * (fading_in ? progress : 1.0f - progress);
+}
+
+/**
+ * \brief Applies the current gain to the source of this music.
+ *
+ * Ends the fade in once it is complete.
+ */
+void Music::update_gain() {
+
+  if (source != AL_NONE) {
+    alSourcef(source, AL_GAIN, get_gain());
+  }
+  if (fading_in && (fade_duration <= 0 ||
+      System::get_real_time() - fade_start_date >= static_cast<uint32_t>(fade_duration))) {
+    fading_in = false;
+  }
+}
+
+/**
+ * \brief Returns whether this music has finished fading out.
+ * \return \c true if it can be stopped.
+ */
+bool Music::is_faded_out() const {
+
+  return fading_out && (fade_duration <= 0 ||
+      System::get_real_time() - fade_start_date >= static_cast<uint32_t>(fade_duration));
 }
 
 }
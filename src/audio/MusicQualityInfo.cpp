@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/MusicQualityInfo.h"
+
+namespace Solarus {
+
+const std::string EnumInfoTraits<MusicQuality>::pretty_name = "music quality";
+
+const EnumInfo<MusicQuality>::names_type EnumInfoTraits<MusicQuality>::names = {
+    { MusicQuality::LOW, "low" },
+    { MusicQuality::MEDIUM, "medium" },
+    { MusicQuality::HIGH, "high" },
+    { MusicQuality::AUTO, "auto" },
+};
+
+}
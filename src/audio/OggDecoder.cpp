@@ -41,13 +41,16 @@ OggDecoder::OggDecoder():
  * \param loop Whether the music should loop if reaching the end.
  * \return \c true in case of success.
  */
-bool OggDecoder::load(std::string&& ogg_data, bool loop) {
+bool OggDecoder::load(QuestFiles::DataFileView&& ogg_data, bool loop) {
 
   ogg_file = OggFileUniquePtr(new OggVorbis_File());
 
   ogg_mem.position = 0;
   ogg_mem.loop = loop;
-  ogg_mem.data = ogg_data;
+  ogg_mem.data = std::move(ogg_data);
+  // The data is read during the whole stream: don't keep it mapped,
+  // the file may change meanwhile.
+  ogg_mem.data.copy_to_buffer();
   // Now, ogg_mem contains the encoded data.
 
   int error = ov_open_callbacks(&ogg_mem, ogg_file.get(), nullptr, 0, Sound::ogg_callbacks);
@@ -103,7 +106,7 @@ bool OggDecoder::load(std::string&& ogg_data, bool loop) {
  */
 void OggDecoder::unload() {
   ogg_file = nullptr;
-  ogg_mem.data.clear();
+  ogg_mem.data.close();
   ogg_info = nullptr;
   loop_start_pcm = -1;
   loop_end_pcm = -1;
@@ -114,11 +117,13 @@ void OggDecoder::unload() {
  * and plays it.
  * \param decoded_data Pointer to where you want the decoded data to be written.
  * \param nb_samples Number of samples to write.
+ * \return \c true if some data was decoded, \c false if the end of the
+ * data was reached or in case of error.
  */
-void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
+bool OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
 
   if (ogg_info == nullptr) {
-    return;
+    return false;
   }
 
   // Read the encoded music properties.
@@ -167,7 +172,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
         std::ostringstream oss;
         oss << "Error while decoding ogg chunk: " << bytes_read;
         Debug::error(oss.str());
-        return;
+        return false;
       }
     }
     else {
@@ -199,7 +204,10 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
     std::ostringstream oss;
     oss << "Failed to fill the audio buffer with decoded OGG data: error " << error;
     Debug::error(oss.str());
+    return false;
   }
+
+  return total_bytes_read > 0;
 }
 
 }
@@ -0,0 +1,593 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/ItDecoder.h"
+#include "solarus/audio/PcmCache.h"
+#include "solarus/audio/SpcDecoder.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace Solarus {
+
+constexpr size_t PcmCache::Track::block_frames;
+constexpr size_t PcmCache::Track::block_size;
+constexpr int PcmCache::max_track_seconds;
+bool PcmCache::enabled = false;
+size_t PcmCache::max_bytes = 0;
+std::thread PcmCache::worker;
+std::atomic<bool> PcmCache::stopping(false);
+std::mutex PcmCache::mutex;
+std::condition_variable PcmCache::jobs_changed;
+std::deque<PcmCache::Job> PcmCache::jobs;
+std::map<std::string, std::shared_ptr<PcmCache::Track>> PcmCache::tracks;
+std::map<std::string, uint64_t> PcmCache::last_uses;
+std::set<std::string> PcmCache::failed_files;
+uint64_t PcmCache::num_uses = 0;
+
+namespace {
+
+constexpr int spc_sample_rate = 32000;
+constexpr int it_sample_rate = 44100;
+constexpr int default_spc_seconds = 180;  /**< Length of SPC files without ID666 tag. */
+constexpr size_t render_frames = 2048;    /**< Frames rendered at once. */
+
+const std::array<int, 89> step_table = {{
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+  45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190,
+  209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724,
+  796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272,
+  2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132,
+  7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+  22385, 24623, 27086, 29794, 32767
+}};
+
+const std::array<int, 16> index_table = {{
+  -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+}};
+
+/**
+ * \brief State of an IMA ADPCM channel.
+ */
+struct AdpcmState {
+  int predictor = 0;
+  int index = 0;
+
+  /**
+   * \brief Applies a nibble to the state.
+   * \param nibble A 4-bit code.
+   * \return The decoded sample.
+   */
+  int16_t decode(uint8_t nibble) {
+
+    const int step = step_table[index];
+    int delta = step >> 3;
+    if (nibble & 4) {
+      delta += step;
+    }
+    if (nibble & 2) {
+      delta += step >> 1;
+    }
+    if (nibble & 1) {
+      delta += step >> 2;
+    }
+    predictor += (nibble & 8) ? -delta : delta;
+    predictor = std::min(32767, std::max(-32768, predictor));
+    index = std::min(88, std::max(0, index + index_table[nibble]));
+    return static_cast<int16_t>(predictor);
+  }
+
+  /**
+   * \brief Encodes a sample and applies the result to the state.
+   * \param sample The sample to encode.
+   * \return The 4-bit code.
+   */
+  uint8_t encode(int16_t sample) {
+
+    int diff = sample - predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) {
+      nibble = 8;
+      diff = -diff;
+    }
+    int step = step_table[index];
+    if (diff >= step) {
+      nibble |= 4;
+      diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+      nibble |= 2;
+      diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+      nibble |= 1;
+    }
+    decode(nibble);  // Follow exactly what the decoder will do.
+    return nibble;
+  }
+};
+
+/**
+ * \brief Returns the play time declared by the ID666 tag of an SPC file.
+ * \param data Content of the SPC file.
+ * \return The length in seconds, or 0 if unknown.
+ */
+int get_spc_length(const std::string& data) {
+
+  constexpr size_t has_tag_offset = 0x23;
+  constexpr size_t length_offset = 0xA9;
+  if (data.size() < length_offset + 3 || data[has_tag_offset] != 26) {
+    return 0;
+  }
+
+  // The tag is either in text or in binary format.
+  bool text = true;
+  for (size_t i = 0; i < 3; ++i) {
+    const char c = data[length_offset + i];
+    if (c != '\0' && (c < '0' || c > '9')) {
+      text = false;
+    }
+  }
+
+  int seconds = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    const uint8_t byte = data[length_offset + i];
+    if (text) {
+      if (byte != '\0') {
+        seconds = seconds * 10 + (byte - '0');
+      }
+    }
+    else {
+      seconds |= byte << (8 * i);
+    }
+  }
+  return seconds;
+}
+
+}
+
+/**
+ * \brief Creates an empty track.
+ * \param sample_rate Frames per second of the music.
+ */
+PcmCache::Track::Track(int sample_rate):
+  sample_rate(sample_rate),
+  blocks(),
+  pending(),
+  step_indexes(),
+  num_frames(0),
+  complete(false),
+  memory_tracker(MemoryUsage::Category::MUSICS) {
+
+  pending.reserve(2 * block_frames);
+  step_indexes.fill(0);
+}
+
+/**
+ * \brief Returns the sample rate of this track.
+ * \return Frames per second.
+ */
+int PcmCache::Track::get_sample_rate() const {
+  return sample_rate;
+}
+
+/**
+ * \brief Returns whether this track is fully rendered.
+ *
+ * Other functions can only be used from other threads after this returns
+ * \c true.
+ *
+ * \return \c true if the track is complete.
+ */
+bool PcmCache::Track::is_complete() const {
+  return complete.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Returns the length of this track.
+ * \return The number of stereo frames.
+ */
+size_t PcmCache::Track::get_num_frames() const {
+  return num_frames;
+}
+
+/**
+ * \brief Returns the memory used by this track.
+ * \return The size of the encoded data in bytes.
+ */
+size_t PcmCache::Track::get_size() const {
+  return blocks.size();
+}
+
+/**
+ * \brief Decodes frames of this track.
+ *
+ * Reading past the end of the track continues from its beginning.
+ *
+ * \param first_frame Index of the first frame to read.
+ * \param frames Receives the stereo 16-bit frames.
+ * \param num_frames Number of frames to read.
+ */
+void PcmCache::Track::read(size_t first_frame, int16_t* frames, size_t num_frames) const {
+
+  Debug::check_assertion(is_complete() && this->num_frames > 0,
+      "Reading an incomplete track");
+
+  std::array<int16_t, 2 * block_frames> decoded;
+  size_t frame = first_frame % this->num_frames;
+  while (num_frames > 0) {
+    const size_t block_index = frame / block_frames;
+    const size_t offset = frame % block_frames;
+    const uint8_t* block = &blocks[block_index * block_size];
+
+    for (int channel = 0; channel < 2; ++channel) {
+      const uint8_t* header = &block[channel * 4];
+      AdpcmState state;
+      state.predictor = static_cast<int16_t>(header[0] | (header[1] << 8));
+      state.index = header[2];
+      const uint8_t* nibbles = &block[2 * 4 + channel * (block_frames / 2)];
+      for (size_t i = 0; i < block_frames; ++i) {
+        const uint8_t byte = nibbles[i / 2];
+        decoded[i * 2 + channel] = state.decode((i % 2 == 0) ? (byte & 0x0F) : (byte >> 4));
+      }
+    }
+
+    const size_t count = std::min({
+        num_frames,
+        block_frames - offset,
+        this->num_frames - frame
+    });
+    std::copy(&decoded[offset * 2], &decoded[(offset + count) * 2], frames);
+    frames += count * 2;
+    num_frames -= count;
+    frame = (frame + count) % this->num_frames;
+  }
+}
+
+/**
+ * \brief Adds rendered frames at the end of this track.
+ * \param frames Stereo 16-bit frames.
+ * \param num_frames Number of frames.
+ */
+void PcmCache::Track::append(const int16_t* frames, size_t num_frames) {
+
+  for (size_t i = 0; i < num_frames; ++i) {
+    pending.push_back(frames[i * 2]);
+    pending.push_back(frames[i * 2 + 1]);
+    if (pending.size() == 2 * block_frames) {
+      encode_block();
+    }
+  }
+  this->num_frames += num_frames;
+}
+
+/**
+ * \brief Encodes the last frames and makes the track readable.
+ */
+void PcmCache::Track::finish() {
+
+  if (!pending.empty()) {
+    // Repeat the last frame to fill the block.
+    const int16_t left = pending[pending.size() - 2];
+    const int16_t right = pending[pending.size() - 1];
+    while (pending.size() < 2 * block_frames) {
+      pending.push_back(left);
+      pending.push_back(right);
+    }
+    encode_block();
+  }
+  pending.shrink_to_fit();
+  blocks.shrink_to_fit();
+  memory_tracker.set_bytes(static_cast<int64_t>(blocks.capacity()));
+  complete.store(true, std::memory_order_release);
+}
+
+/**
+ * \brief Encodes the pending frames as a new block.
+ *
+ * Each channel of a block starts with its predictor and its step index,
+ * so that blocks can be decoded independently. The step index continues
+ * from the previous block to avoid a burst of error at each block start.
+ */
+void PcmCache::Track::encode_block() {
+
+  const size_t start = blocks.size();
+  blocks.resize(start + block_size, 0);
+  memory_tracker.set_bytes(static_cast<int64_t>(blocks.capacity()));
+  uint8_t* block = &blocks[start];
+
+  for (int channel = 0; channel < 2; ++channel) {
+    AdpcmState state;
+    state.predictor = pending[channel];
+    state.index = step_indexes[channel];  // Keep the step adapted to the music.
+    uint8_t* header = &block[channel * 4];
+    header[0] = static_cast<uint8_t>(state.predictor & 0xFF);
+    header[1] = static_cast<uint8_t>((state.predictor >> 8) & 0xFF);
+    header[2] = static_cast<uint8_t>(state.index);
+
+    uint8_t* nibbles = &block[2 * 4 + channel * (block_frames / 2)];
+    for (size_t i = 0; i < block_frames; ++i) {
+      const uint8_t nibble = state.encode(pending[i * 2 + channel]);
+      nibbles[i / 2] |= (i % 2 == 0) ? nibble : (nibble << 4);
+    }
+    step_indexes[channel] = state.index;
+  }
+  pending.clear();
+}
+
+/**
+ * \brief Enables the cache and starts its worker.
+ * \param max_bytes Budget of the rendered tracks.
+ */
+void PcmCache::initialize(size_t max_bytes) {
+
+  if (enabled) {
+    return;
+  }
+
+  PcmCache::max_bytes = max_bytes;
+  stopping = false;
+  enabled = true;
+  worker = std::thread(&PcmCache::run);
+}
+
+/**
+ * \brief Stops the worker and drops all tracks.
+ */
+void PcmCache::quit() {
+
+  if (!enabled) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobs_changed.notify_all();
+  worker.join();
+
+  tracks.clear();
+  last_uses.clear();
+  failed_files.clear();
+  num_uses = 0;
+  enabled = false;
+}
+
+/**
+ * \brief Returns whether musics are rendered in advance.
+ * \return \c true if the cache is enabled.
+ */
+bool PcmCache::is_enabled() {
+  return enabled;
+}
+
+/**
+ * \brief Returns the rendered track of a music.
+ *
+ * If the music is not in the cache yet, the worker starts rendering it.
+ * The track returned only becomes readable once complete.
+ *
+ * \param file_name Name of the music file.
+ * \param source Format of the file.
+ * \param data Content of the file.
+ * \param size Size of the content in bytes.
+ * \return The track, or nullptr if the music cannot be cached.
+ */
+PcmCache::TrackPtr PcmCache::get_track(
+    const std::string& file_name,
+    Source source,
+    const char* data,
+    size_t size
+) {
+  if (!enabled) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (failed_files.find(file_name) != failed_files.end()) {
+    return nullptr;
+  }
+
+  last_uses[file_name] = ++num_uses;
+  const auto it = tracks.find(file_name);
+  if (it != tracks.end()) {
+    return it->second;
+  }
+
+  Job job;
+  job.file_name = file_name;
+  job.source = source;
+  job.data = std::string(data, size);
+  job.track = std::make_shared<Track>(source == Source::SPC ? spc_sample_rate : it_sample_rate);
+  tracks.emplace(file_name, job.track);
+  TrackPtr track = job.track;
+  jobs.push_back(std::move(job));
+  jobs_changed.notify_one();
+  return track;
+}
+
+/**
+ * \brief Main function of the worker.
+ */
+void PcmCache::run() {
+
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobs_changed.wait(lock, []() { return stopping || !jobs.empty(); });
+      if (stopping) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    render(job);
+  }
+}
+
+/**
+ * \brief Renders a music into its track.
+ *
+ * If it fails, the track is removed from the cache and the music will not
+ * be tried again.
+ *
+ * \param job The music to render.
+ */
+void PcmCache::render(Job& job) {
+
+  bool success = false;
+  switch (job.source) {
+
+  case Source::SPC:
+    success = render_spc(job);
+    break;
+
+  case Source::IT:
+    success = render_it(job);
+    break;
+  }
+
+  success = success &&
+      job.track->get_num_frames() > 0 &&
+      job.track->get_size() <= max_bytes;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!success) {
+    if (!stopping) {
+      Logger::info("Music '" + job.file_name + "' is not cached");
+    }
+    tracks.erase(job.file_name);
+    last_uses.erase(job.file_name);
+    failed_files.insert(job.file_name);
+    return;
+  }
+
+  job.track->finish();
+  release_unused_tracks();
+}
+
+/**
+ * \brief Renders an SPC music.
+ *
+ * SPC files have no end and no loop points: the length of their ID666 tag
+ * is rendered, and the music restarts from the beginning after it.
+ *
+ * \param job The music to render.
+ * \return \c false if the rendering was interrupted.
+ */
+bool PcmCache::render_spc(Job& job) {
+
+  int seconds = get_spc_length(job.data);
+  if (seconds <= 0) {
+    seconds = default_spc_seconds;
+  }
+  if (seconds > max_track_seconds) {
+    return false;
+  }
+
+  SpcDecoder decoder;
+  decoder.load(reinterpret_cast<const int16_t*>(job.data.data()), job.data.size());
+
+  std::vector<int16_t> frames(render_frames * 2);
+  const size_t total_frames = static_cast<size_t>(seconds) * spc_sample_rate;
+  size_t done = 0;
+  while (done < total_frames) {
+    if (stopping) {
+      return false;
+    }
+    const size_t count = std::min(render_frames, total_frames - done);
+    decoder.decode(frames.data(), static_cast<int>(count * 2));
+    job.track->append(frames.data(), count);
+    done += count;
+  }
+  return true;
+}
+
+/**
+ * \brief Renders an IT music until the end of the module.
+ * \param job The music to render.
+ * \return \c false if the rendering was interrupted or if the module is
+ * too long.
+ */
+bool PcmCache::render_it(Job& job) {
+
+  ItDecoder decoder;
+  decoder.set_loops(false);
+  decoder.load(job.data.data(), job.data.size());
+  if (!decoder.is_loaded()) {
+    return false;
+  }
+
+  std::vector<int16_t> frames(render_frames * 2);
+  const size_t max_frames = static_cast<size_t>(max_track_seconds) * it_sample_rate;
+  while (true) {
+    if (stopping || job.track->get_num_frames() > max_frames) {
+      decoder.unload();
+      return false;
+    }
+    const int bytes = decoder.decode(frames.data(), static_cast<int>(frames.size() * sizeof(int16_t)));
+    if (bytes <= 0) {
+      break;
+    }
+    job.track->append(frames.data(), bytes / (2 * sizeof(int16_t)));
+  }
+  decoder.unload();
+  return true;
+}
+
+/**
+ * \brief Drops the least recently used tracks that are not playing
+ * until the complete tracks fit in the budget.
+ *
+ * The mutex must be locked.
+ */
+void PcmCache::release_unused_tracks() {
+
+  size_t total_bytes = 0;
+  for (const auto& kvp : tracks) {
+    if (kvp.second->is_complete()) {
+      total_bytes += kvp.second->get_size();
+    }
+  }
+
+  while (total_bytes > max_bytes) {
+    auto oldest = tracks.end();
+    for (auto it = tracks.begin(); it != tracks.end(); ++it) {
+      if (it->second->is_complete() &&
+          it->second.use_count() == 1 &&
+          (oldest == tracks.end() || last_uses[it->first] < last_uses[oldest->first])) {
+        oldest = it;
+      }
+    }
+    if (oldest == tracks.end()) {
+      // Everything left is playing.
+      return;
+    }
+    total_bytes -= oldest->second->get_size();
+    last_uses.erase(oldest->first);
+    tracks.erase(oldest);
+  }
+}
+
+}
@@ -15,20 +15,28 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include <algorithm>
+#include <cmath>
 #include <cstring>  // memcpy
 #include <sstream>
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/PerfCounter.h"
+#include "solarus/core/PerfTrace.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/String.h"
+#include "solarus/core/System.h"
+#include "solarus/audio/AudioThread.h"
 #include "solarus/audio/Music.h"
+#include "solarus/audio/OggDecoder.h"
 #include "solarus/audio/Sound.h"
 #ifdef SOLARUS_OPENAL_EXTENSIONS_RECONNECT
 #  include <alext.h>
 #endif
 #include <cstdio>
+#include <tuple>
+#include <utility>
 
 namespace Solarus {
 
@@ -37,10 +45,22 @@ ALCdevice* Sound::device = nullptr;
 ALCcontext* Sound::context = nullptr;
 bool Sound::sounds_preloaded = false;
 float Sound::volume = 1.0;
+int Sound::volume_setting = 100;
 bool Sound::pc_play = false;
 std::list<Sound*> Sound::current_sounds;
 std::map<std::string, Sound> Sound::all_sounds;
 uint32_t Sound::next_device_detection_date = 0;
+size_t Sound::stream_threshold = 1024 * 1024;
+size_t Sound::max_resident_bytes = 32 * 1024 * 1024;
+size_t Sound::resident_bytes = 0;
+uint64_t Sound::num_uses = 0;
+size_t Sound::num_voices = 32;
+std::vector<ALuint> Sound::free_sources;
+std::map<std::string, Sound::VoiceSettings> Sound::voice_settings;
+std::map<std::string, Sound::VoiceSettings> Sound::requested_voice_settings;
+constexpr int Sound::Stream::nb_buffers;
+constexpr int Sound::Stream::buffer_size;
+constexpr float Sound::max_grouped_gain;
 
 namespace {
 
@@ -59,7 +79,7 @@ size_t cb_read(void* ptr, size_t /* size */, size_t nb_bytes, void* datasource)
 
   Sound::SoundFromMemory* mem = static_cast<Sound::SoundFromMemory*>(datasource);
 
-  const size_t total_size = mem->data.size();
+  const size_t total_size = mem->data.get_size();
   if (mem->position >= total_size) {
     if (mem->loop) {
       mem->position = 0;
@@ -72,7 +92,7 @@ size_t cb_read(void* ptr, size_t /* size */, size_t nb_bytes, void* datasource)
     nb_bytes = total_size - mem->position;
   }
 
-  std::memcpy(ptr, mem->data.data() + mem->position, nb_bytes);
+  std::memcpy(ptr, mem->data.get_data() + mem->position, nb_bytes);
   mem->position += nb_bytes;
 
   return nb_bytes;
@@ -103,12 +123,12 @@ int cb_seek(void* datasource, ogg_int64_t offset, int whence) {
     break;
 
   case SEEK_END:
-    mem->position = mem->data.size() - offset;
+    mem->position = mem->data.get_size() - offset;
     break;
   }
 
-  if (mem->position >= mem->data.size()) {
-    mem->position = mem->data.size();
+  if (mem->position >= mem->data.get_size()) {
+    mem->position = mem->data.get_size();
   }
 
   return 0;
@@ -152,8 +172,18 @@ Sound::Sound():
  */
 Sound::Sound(const std::string& sound_id):
   id(sound_id),
-  buffer(AL_NONE) {
-
+  buffer(AL_NONE),
+  buffer_bytes(0),
+  streamed(false),
+  last_use(0),
+  settings(),
+  voices(),
+  streams() {
+
+  const auto it = voice_settings.find(sound_id);
+  if (it != voice_settings.end()) {
+    settings = it->second;
+  }
 }
 
 /**
@@ -161,34 +191,42 @@ Sound::Sound(const std::string& sound_id):
  */
 Sound::~Sound() {
 
-  if (device != nullptr && buffer != AL_NONE) {
+  if (device != nullptr) {
+
+    for (Stream& stream: streams) {
+      destroy_stream(stream);
+    }
 
     // stop the sources where this buffer is attached
-    for (ALuint source: sources) {
-      alSourceStop(source);
-      alSourcei(source, AL_BUFFER, 0);
-      alDeleteSources(1, &source);
+    for (const Voice& voice: voices) {
+      release_source(voice.source);
     }
-    alDeleteBuffers(1, &buffer);
-    current_sounds.remove(this);
   }
+  streams.clear();
+  voices.clear();
+  clear_buffer();
+  current_sounds.remove(this);
 }
 
 /**
  * \brief Initializes the audio (music and sound) system.
  *
  * This method should be called when the application starts.
- * If the argument -no-audio is provided, this function has no effect and
- * there will be no sound.
+ * If the argument -no-audio or -headless is provided, this function has
+ * no effect and there will be no sound.
  * If the argument -perf-sound-play is provided and is "yes", sound
  * playing will be accounted using a performance counter.
+ * If the argument -audio-thread is provided and is "no", the audio system
+ * is updated by the main thread instead of its own thread.
+ * The argument -sound-voices sets the number of OpenAL sources that sounds
+ * can use at the same time.
  *
  * \param args Command-line arguments.
  */
 void Sound::initialize(const Arguments& args) {
 
-  // Check the -no-audio option.
-  audio_enabled = !args.has_argument("-no-audio");
+  // Check the -no-audio and -headless options.
+  audio_enabled = !args.has_argument("-no-audio") && !args.has_argument("-headless");
   if (!audio_enabled) {
     return;
   }
@@ -196,6 +234,32 @@ void Sound::initialize(const Arguments& args) {
   // Check the -perf-sound-play option.
   pc_play = args.get_argument_value("-perf-sound-play") == "yes";
 
+  // Check the options of the sound buffers.
+  const std::string& stream_threshold_arg = args.get_argument_value("-sound-stream-threshold");
+  if (!stream_threshold_arg.empty()) {
+    std::istringstream iss(stream_threshold_arg);
+    int kibibytes = 0;
+    if (iss >> kibibytes && kibibytes >= 0) {
+      stream_threshold = static_cast<size_t>(kibibytes) * 1024;
+    }
+  }
+  const std::string& voices_arg = args.get_argument_value("-sound-voices");
+  if (!voices_arg.empty()) {
+    std::istringstream iss(voices_arg);
+    int voices = 0;
+    if (iss >> voices && voices > 0) {
+      num_voices = static_cast<size_t>(voices);
+    }
+  }
+  const std::string& cache_size_arg = args.get_argument_value("-sound-cache-size");
+  if (!cache_size_arg.empty()) {
+    std::istringstream iss(cache_size_arg);
+    int mebibytes = 0;
+    if (iss >> mebibytes && mebibytes >= 0) {
+      max_resident_bytes = static_cast<size_t>(mebibytes) * 1024 * 1024;
+    }
+  }
+
   // Initialize OpenAL.
   update_device_connection();
   if (device == nullptr) {
@@ -207,7 +271,12 @@ void Sound::initialize(const Arguments& args) {
   set_volume(100);
 
   // initialize the music system
-  Music::initialize();
+  Music::initialize(args);
+
+  // From now on, the audio system belongs to its thread.
+  if (args.get_argument_value("-audio-thread") != "no") {
+    AudioThread::start();
+  }
 }
 
 /**
@@ -221,11 +290,17 @@ void Sound::quit() {
     return;
   }
 
+  // Take the audio system back from its thread.
+  AudioThread::stop();
+
   // uninitialize the music subsystem
   Music::quit();
 
   // clear the sounds
   all_sounds.clear();
+  destroy_source_pool();
+  voice_settings.clear();
+  requested_voice_settings.clear();
 
   // uninitialize OpenAL
 
@@ -235,11 +310,14 @@ void Sound::quit() {
   alcCloseDevice(device);
   device = nullptr;
   volume = 1.0;
+  volume_setting = 100;
   audio_enabled = false;
 }
 
 /**
  * \brief Checks if the audio device is connected.
+ *
+ * Dates are in real time since this runs on the audio thread.
  */
 void Sound::update_device_connection() {
 
@@ -260,9 +338,9 @@ void Sound::update_device_connection() {
     if (!is_connected) {
       Logger::info("Lost connection to audio device");
     } else {
-      if (System::now() >= next_device_detection_date) {
+      if (System::get_real_time() >= next_device_detection_date) {
         // Check if this device is still the default one.
-        next_device_detection_date = System::now() + 1000;
+        next_device_detection_date = System::get_real_time() + 1000;
 
         const ALchar* current_device_name = alcGetString(device, SOLARUS_OPENAL_DEVICE_SPECIFIER);
         const ALchar* default_device_name = alcGetString(nullptr, SOLARUS_OPENAL_DEVICE_SPECIFIER);
@@ -285,15 +363,16 @@ void Sound::update_device_connection() {
       context = nullptr;
       alcCloseDevice(device);
       device = nullptr;
-      next_device_detection_date = System::now();
+      next_device_detection_date = System::get_real_time();
       all_sounds.clear();
+      free_sources.clear();  // Already destroyed with the context.
       sounds_preloaded = false;
       Music::notify_device_disconnected_all();
     }
   }
 
   if (device == nullptr) {
-    if (System::now() >= next_device_detection_date) {
+    if (System::get_real_time() >= next_device_detection_date) {
       // Try to connect or reconnect to an audio device.
       device = alcOpenDevice(nullptr);
       if (device == nullptr) {
@@ -313,12 +392,13 @@ void Sound::update_device_connection() {
         } else {
           const ALchar* current_device_name = alcGetString(device, SOLARUS_OPENAL_DEVICE_SPECIFIER);
           Logger::info(std::string("Connected to audio device '") + (current_device_name ? current_device_name : "") + "'");
+          create_source_pool();
           Music::notify_device_reconnected_all();
         }
       }
       if (device == nullptr) {
         // The attempt failed: try again later.
-        next_device_detection_date = System::now() + 1000;
+        next_device_detection_date = System::get_real_time() + 1000;
       }
     }
   }
@@ -332,20 +412,67 @@ bool Sound::is_initialized() {
   return audio_enabled;
 }
 
+/**
+ * \brief Returns a sound, creating it if necessary.
+ * \param sound_id Id of the sound.
+ * \return The sound.
+ */
+Sound& Sound::get_sound(const std::string& sound_id) {
+
+  auto it = all_sounds.find(sound_id);
+  if (it == all_sounds.end()) {
+    it = all_sounds.emplace(
+        std::piecewise_construct,
+        std::forward_as_tuple(sound_id),
+        std::forward_as_tuple(sound_id)
+    ).first;
+  }
+  return it->second;
+}
+
 /**
  * \brief Loads and decodes all sounds listed in the game database.
+ *
+ * Long sounds are not decoded since they are streamed,
+ * and loading stops when the budget of decoded sounds is full.
  */
 void Sound::load_all() {
 
+  if (!is_initialized()) {
+    return;
+  }
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::LOAD_SOUNDS;
+  const std::map<std::string, std::string>& sound_elements =
+      CurrentQuest::get_resources(ResourceType::SOUND);
+  for (const auto& kvp: sound_elements) {
+    command.ids.push_back(kvp.first);
+  }
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Loads and decodes some sounds, on the audio side.
+ *
+ * Does nothing if sounds were already loaded this way.
+ *
+ * \param sound_ids Ids of the sounds to load.
+ */
+void Sound::load_sounds(const std::vector<std::string>& sound_ids) {
+
   if (device != nullptr && !sounds_preloaded) {
 
-    const std::map<std::string, std::string>& sound_elements =
-        CurrentQuest::get_resources(ResourceType::SOUND);
-    for (const auto& kvp: sound_elements) {
-      const std::string& sound_id = kvp.first;
+    for (const std::string& sound_id: sound_ids) {
+      if (resident_bytes >= max_resident_bytes) {
+        // Other sounds will be decoded when they are played.
+        break;
+      }
 
-      all_sounds[sound_id] = Sound(sound_id);
-      all_sounds[sound_id].load();
+      Sound& sound = get_sound(sound_id);
+      if (sound.buffer == AL_NONE && !sound.streamed) {
+        sound.load();
+      }
     }
 
     sounds_preloaded = true;
@@ -359,6 +486,11 @@ void Sound::load_all() {
  */
 bool Sound::exists(const std::string& sound_id) {
 
+  if (CurrentQuest::resource_exists(ResourceType::SOUND, sound_id)) {
+    // Declared in the quest database: no need to ask the file system.
+    return true;
+  }
+
   std::ostringstream oss;
   oss << "sounds/" << sound_id << ".ogg";
   return QuestFiles::data_file_exists(oss.str());
@@ -366,6 +498,10 @@ bool Sound::exists(const std::string& sound_id) {
 
 /**
  * \brief Starts playing the specified sound.
+ *
+ * The sound starts at the end of the current tick. If it is played
+ * several times in the same tick, a single louder instance starts.
+ *
  * \param sound_id id of the sound to play
  */
 void Sound::play(const std::string& sound_id) {
@@ -373,11 +509,15 @@ void Sound::play(const std::string& sound_id) {
     PerfCounter::update("sound-play");
   }
 
-  if (all_sounds.find(sound_id) == all_sounds.end()) {
-    all_sounds[sound_id] = Sound(sound_id);
+  if (!is_initialized()) {
+    // Not even sent, so that it does not wait for an update that never comes.
+    return;
   }
 
-  all_sounds[sound_id].start();
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::PLAY_SOUND;
+  command.id = sound_id;
+  AudioThread::post(std::move(command));
 }
 
 /**
@@ -385,9 +525,10 @@ void Sound::play(const std::string& sound_id) {
  */
 void Sound::pause_all() {
 
-  for (Sound* sound: current_sounds) {
-    sound->set_paused(true);
-  }
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::PAUSE_SOUNDS;
+  command.flag = true;
+  AudioThread::post(std::move(command));
 }
 
 /**
@@ -395,8 +536,20 @@ void Sound::pause_all() {
  */
 void Sound::resume_all() {
 
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::PAUSE_SOUNDS;
+  command.flag = false;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Pauses or resumes all currently playing sounds, on the audio side.
+ * \param pause true to pause the sounds, false to resume them
+ */
+void Sound::set_all_paused(bool pause) {
+
   for (Sound* sound: current_sounds) {
-    sound->set_paused(false);
+    sound->set_paused(pause);
   }
 }
 
@@ -406,7 +559,7 @@ void Sound::resume_all() {
  */
 int Sound::get_volume() {
 
-  return (int) (volume * 100.0 + 0.5);
+  return volume_setting;
 }
 
 /**
@@ -415,22 +568,90 @@ int Sound::get_volume() {
  */
 void Sound::set_volume(int volume) {
 
-  volume = std::min(100, std::max(0, volume));
-  Sound::volume = volume / 100.0;
+  volume_setting = std::min(100, std::max(0, volume));
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::SET_SOUND_VOLUME;
+  command.value = volume_setting;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Returns how instances of a sound share the voices.
+ * \param sound_id Id of the sound.
+ * \return The settings of this sound.
+ */
+const Sound::VoiceSettings& Sound::get_voice_settings(const std::string& sound_id) {
+
+  static const VoiceSettings default_settings;
+  const auto it = requested_voice_settings.find(sound_id);
+  if (it == requested_voice_settings.end()) {
+    return default_settings;
+  }
+  return it->second;
+}
+
+/**
+ * \brief Sets how instances of a sound share the voices.
+ * \param sound_id Id of the sound.
+ * \param settings The new settings.
+ */
+void Sound::set_voice_settings(const std::string& sound_id, const VoiceSettings& settings) {
+
+  VoiceSettings& requested = requested_voice_settings[sound_id];
+  requested = settings;
+  requested.max_instances = std::max(0, requested.max_instances);
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::SET_SOUND_VOICES;
+  command.id = sound_id;
+  command.value = requested.max_instances;
+  command.value2 = requested.priority;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Sets how instances of a sound share the voices, on the audio side.
+ *
+ * Instances already playing are kept even if there are too many.
+ *
+ * \param sound_id Id of the sound.
+ * \param settings The new settings.
+ */
+void Sound::apply_voice_settings(const std::string& sound_id, const VoiceSettings& settings) {
+
+  voice_settings[sound_id] = settings;
+  const auto it = all_sounds.find(sound_id);
+  if (it != all_sounds.end()) {
+    it->second.settings = settings;
+  }
 }
 
 /**
  * \brief Updates the audio (music and sound) system.
  *
  * This function is called repeatedly by the game.
+ * If the audio thread is not running, this does its work.
+ * Events sent back by the audio system are then handled.
  */
 void Sound::update() {
 
+  PerfTrace::Scope trace_scope("audio-update");
+
   if (!is_initialized()) {
     return;
   }
 
-  update_device_connection();
+  AudioThread::update();
+
+  // also update the music
+  Music::update();
+}
+
+/**
+ * \brief Continues playing the current sounds, on the audio side.
+ */
+void Sound::update_sounds() {
 
   if (device != nullptr) {
 
@@ -446,9 +667,6 @@ void Sound::update() {
       current_sounds.remove(sound);
     }
   }
-
-  // also update the music
-  Music::update();
 }
 
 /**
@@ -457,22 +675,164 @@ void Sound::update() {
  */
 bool Sound::update_playing() {
 
-  // See if this sound is still playing.
-  if (sources.empty()) {
-    return false;
+  // Give back the sources that finished playing.
+  for (auto it = voices.begin(); it != voices.end();) {
+    ALint status;
+    alGetSourcei(it->source, AL_SOURCE_STATE, &status);
+
+    if (status != AL_PLAYING && status != AL_PAUSED) {
+      release_source(it->source);
+      it = voices.erase(it);
+    }
+    else {
+      ++it;
+    }
   }
 
-  ALuint source = *sources.begin();
-  ALint status;
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
+  for (auto it = streams.begin(); it != streams.end();) {
+    if (update_stream(*it)) {
+      ++it;
+    }
+    else {
+      destroy_stream(*it);
+      it = streams.erase(it);
+    }
+  }
+
+  return !voices.empty() || !streams.empty();
+}
 
-  if (status != AL_PLAYING) {
-    sources.pop_front();
-    alSourcei(source, AL_BUFFER, 0);
-    alDeleteSources(1, &source);
+/**
+ * \brief Returns the number of instances of this sound currently playing.
+ * \return The number of decoded and streamed instances.
+ */
+int Sound::get_num_instances() const {
+
+  return static_cast<int>(voices.size() + streams.size());
+}
+
+/**
+ * \brief Returns when the oldest playing instance of this sound started.
+ * \return The start of the oldest instance, in plays.
+ * The sound must be playing.
+ */
+uint64_t Sound::get_oldest_start() const {
+
+  if (voices.empty()) {
+    return streams.front().start;
   }
+  if (streams.empty()) {
+    return voices.front().start;
+  }
+  return std::min(voices.front().start, streams.front().start);
+}
 
-  return !sources.empty();
+/**
+ * \brief Stops the oldest playing instance of this sound
+ * and gives its source back to the pool.
+ */
+void Sound::stop_oldest_instance() {
+
+  if (get_num_instances() == 0) {
+    return;
+  }
+
+  if (streams.empty() ||
+      (!voices.empty() && voices.front().start < streams.front().start)) {
+    release_source(voices.front().source);
+    voices.pop_front();
+  }
+  else {
+    destroy_stream(streams.front());
+    streams.pop_front();
+  }
+}
+
+/**
+ * \brief Creates the sources of the pool.
+ *
+ * Fewer sources are created if the device cannot provide them all.
+ */
+void Sound::create_source_pool() {
+
+  free_sources.clear();
+  for (size_t i = 0; i < num_voices; ++i) {
+    ALuint source = AL_NONE;
+    alGenSources(1, &source);
+    if (alGetError() != AL_NO_ERROR) {
+      std::ostringstream oss;
+      oss << "Only " << free_sources.size() << " audio sources are available for sounds";
+      Logger::info(oss.str());
+      break;
+    }
+    free_sources.push_back(source);
+  }
+}
+
+/**
+ * \brief Deletes the sources of the pool.
+ *
+ * All sources must have been given back.
+ */
+void Sound::destroy_source_pool() {
+
+  if (device != nullptr && !free_sources.empty()) {
+    alDeleteSources(free_sources.size(), free_sources.data());
+  }
+  free_sources.clear();
+}
+
+/**
+ * \brief Takes a source from the pool to play a new instance.
+ *
+ * If no source is free, the oldest instance of the playing sound with the
+ * lowest priority is stopped, unless this priority is higher than the
+ * requested one.
+ *
+ * \param priority Priority of the new instance.
+ * \return The source, or AL_NONE if all voices are taken by more
+ * important sounds.
+ */
+ALuint Sound::acquire_source(int priority) {
+
+  if (free_sources.empty()) {
+    Sound* victim = nullptr;
+    for (Sound* sound: current_sounds) {
+      if (sound->get_num_instances() == 0 ||
+          sound->settings.priority > priority) {
+        continue;
+      }
+      if (victim == nullptr ||
+          sound->settings.priority < victim->settings.priority ||
+          (sound->settings.priority == victim->settings.priority &&
+           sound->get_oldest_start() < victim->get_oldest_start())) {
+        victim = sound;
+      }
+    }
+
+    if (victim == nullptr) {
+      return AL_NONE;
+    }
+    victim->stop_oldest_instance();
+  }
+
+  if (free_sources.empty()) {
+    return AL_NONE;
+  }
+  const ALuint source = free_sources.back();
+  free_sources.pop_back();
+  return source;
+}
+
+/**
+ * \brief Stops a source and gives it back to the pool.
+ * \param source The source to release.
+ */
+void Sound::release_source(ALuint source) {
+
+  alSourceStop(source);
+  alSourcei(source, AL_BUFFER, 0);
+  free_sources.push_back(source);
 }
 
 /**
@@ -484,40 +844,57 @@ void Sound::load() {
     Debug::error("Previous audio error not cleaned");
   }
 
-  std::string file_name = std::string("sounds/" + id);
-  if (id.find(".") == std::string::npos) {
-    file_name += ".ogg";
-  }
-
-  // Create an OpenAL buffer with the sound decoded by the library.
-  buffer = decode_file(file_name);
+  // Create an OpenAL buffer with the sound decoded by the library,
+  // unless the sound is long enough to be streamed.
+  decode_file(get_file_name(id));
 
-  // buffer is now AL_NONE if there was an error.
+  // buffer is now AL_NONE if there was an error or if the sound is streamed.
 }
 
 /**
  * \brief Plays the sound.
+ *
+ * A sound played several times at once makes a single instance
+ * whose volume increases with the number of plays, up to max_grouped_gain.
+ *
+ * \param num_plays Number of times the sound was played at once.
  * \return true if the sound was loaded successfully, false otherwise
  */
-bool Sound::start() {
+bool Sound::start(int num_plays) {
 
   if (device == nullptr) {
     return false;
   }
 
   bool success = false;
+  last_use = ++num_uses;
 
-  if (buffer == AL_NONE) { // first time: load and decode the file
+  if (buffer == AL_NONE && !streamed) { // first time: load and decode the file
     load();
   }
 
-  if (buffer != AL_NONE) {
+  if (buffer == AL_NONE && !streamed) {
+    return false;
+  }
 
-    // create a source
-    ALuint source;
-    alGenSources(1, &source);
+  // Respect the limit of simultaneous instances of this sound.
+  while (settings.max_instances > 0 && get_num_instances() >= settings.max_instances) {
+    stop_oldest_instance();
+  }
+
+  if (streamed) {
+    return start_stream();
+  }
+
+  // take a source from the pool
+  ALuint source = acquire_source(settings.priority);
+  if (source != AL_NONE) {
+
+    // Identical sounds add up like independent sources: by their energy.
+    const float gain = std::min(std::sqrt(static_cast<float>(std::max(num_plays, 1))), max_grouped_gain);
     alSourcei(source, AL_BUFFER, buffer);
-    alSourcef(source, AL_GAIN, volume);
+    alSourcef(source, AL_MAX_GAIN, max_grouped_gain);
+    alSourcef(source, AL_GAIN, volume * gain);
 
     // play the sound
     int error = alGetError();
@@ -526,10 +903,13 @@ bool Sound::start() {
       oss << "Cannot attach buffer " << buffer
           << " to the source to play sound '" << id << "': error " << error;
       Debug::error(oss.str());
-      alDeleteSources(1, &source);
+      release_source(source);
     }
     else {
-      sources.push_back(source);
+      Voice voice;
+      voice.source = source;
+      voice.start = last_use;
+      voices.push_back(voice);
       current_sounds.remove(this); // to avoid duplicates
       current_sounds.push_back(this);
       alSourcePlay(source);
@@ -558,36 +938,326 @@ void Sound::set_paused(bool pause) {
     return;
   }
 
-  for (ALuint source: sources) {
+  for (const Voice& voice: voices) {
     if (pause) {
-      alSourcePause(source);
+      alSourcePause(voice.source);
     }
     else {
-      alSourcePlay(source);
+      alSourcePlay(voice.source);
     }
   }
+
+  for (const Stream& stream: streams) {
+    if (pause) {
+      alSourcePause(stream.source);
+    }
+    else {
+      alSourcePlay(stream.source);
+    }
+  }
+}
+
+/**
+ * \brief Returns the name of the file of a sound.
+ * \param sound_id Id of the sound.
+ * \return The file name, relative to the data directory.
+ */
+std::string Sound::get_file_name(const std::string& sound_id) {
+
+  std::string file_name = std::string("sounds/" + sound_id);
+  if (sound_id.find(".") == std::string::npos) {
+    file_name += ".ogg";
+  }
+  return file_name;
+}
+
+/**
+ * \brief Puts a sound decoded in advance into the sound cache.
+ *
+ * Does nothing if the sound is already loaded or if there is no audio device.
+ *
+ * \param sound_id Id of the sound.
+ * \param decoded The decoded samples, as returned by decode_samples().
+ */
+void Sound::add_preloaded(const std::string& sound_id, DecodedSound&& decoded) {
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::ADD_PRELOADED_SOUND;
+  command.id = sound_id;
+  command.decoded = std::move(decoded);
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Puts a sound decoded in advance into the sound cache, on the audio side.
+ * \param sound_id Id of the sound.
+ * \param decoded The decoded samples, as returned by decode_samples().
+ */
+void Sound::store_preloaded(const std::string& sound_id, const DecodedSound& decoded) {
+
+  if (device == nullptr) {
+    return;
+  }
+
+  Sound& sound = get_sound(sound_id);
+  if (sound.buffer == AL_NONE && !sound.streamed) {
+    sound.set_decoded(get_file_name(sound_id), decoded);
+  }
+}
+
+/**
+ * \brief Makes the next plays of a sound read its file again.
+ *
+ * Call this when the sound file has changed.
+ * Instances of the sound currently playing are stopped.
+ *
+ * \param sound_id Id of the sound.
+ */
+void Sound::reload(const std::string& sound_id) {
+
+  AudioThread::Command command;
+  command.type = AudioThread::CommandType::RELOAD_SOUND;
+  command.id = sound_id;
+  AudioThread::post(std::move(command));
+}
+
+/**
+ * \brief Releases the decoded samples of a sound, on the audio side.
+ *
+ * Does nothing if the sound was never loaded.
+ *
+ * \param sound_id Id of the sound.
+ */
+void Sound::forget_decoded(const std::string& sound_id) {
+
+  const auto it = all_sounds.find(sound_id);
+  if (it == all_sounds.end()) {
+    return;
+  }
+
+  Sound& sound = it->second;
+  while (sound.get_num_instances() > 0) {
+    sound.stop_oldest_instance();
+  }
+  current_sounds.remove(&sound);
+  sound.clear_buffer();
+  sound.streamed = false;
 }
 
 /**
  * \brief Loads the specified sound file and decodes its content into an OpenAL buffer.
+ *
+ * If the sound is long, it is only marked as streamed.
+ *
  * \param file_name name of the file to open
- * \return the buffer created, or AL_NONE if the sound could not be loaded
  */
-ALuint Sound::decode_file(const std::string& file_name) {
+void Sound::decode_file(const std::string& file_name) {
 
-  ALuint buffer = AL_NONE;
+  DecodedSound decoded;
+  if (!decode_samples(file_name, decoded)) {
+    return;
+  }
+  set_decoded(file_name, decoded);
+}
+
+/**
+ * \brief Puts decoded samples into the buffer of this sound.
+ *
+ * Other sounds may be released to respect the budget of decoded sounds.
+ *
+ * \param file_name name of the sound file, for error messages
+ * \param decoded The decoded samples, as returned by decode_samples().
+ */
+void Sound::set_decoded(const std::string& file_name, const DecodedSound& decoded) {
 
-  if (!QuestFiles::data_file_exists(file_name)) {
+  if (decoded.streamed) {
+    streamed = true;
+    return;
+  }
+
+  buffer = create_buffer(file_name, decoded);
+  if (buffer != AL_NONE) {
+    buffer_bytes = decoded.samples.size();
+    resident_bytes += buffer_bytes;
+    MemoryUsage::add(MemoryUsage::Category::SOUNDS, static_cast<int64_t>(buffer_bytes));
+    release_unused_buffers(this);
+  }
+}
+
+/**
+ * \brief Releases the buffers of the least recently played sounds
+ * until the budget of decoded sounds is respected.
+ *
+ * Sounds that are playing are kept.
+ *
+ * \param sound_to_keep A sound to keep even if it is not playing.
+ */
+void Sound::release_unused_buffers(const Sound* sound_to_keep) {
+
+  while (resident_bytes > max_resident_bytes) {
+
+    Sound* oldest_sound = nullptr;
+    for (auto& kvp: all_sounds) {
+      Sound& sound = kvp.second;
+      if (&sound != sound_to_keep &&
+          sound.buffer != AL_NONE &&
+          sound.voices.empty() &&
+          (oldest_sound == nullptr || sound.last_use < oldest_sound->last_use)) {
+        oldest_sound = &sound;
+      }
+    }
+
+    if (oldest_sound == nullptr) {
+      // All other decoded sounds are playing.
+      return;
+    }
+    oldest_sound->clear_buffer();
+  }
+}
+
+/**
+ * \brief Releases the decoded samples of this sound.
+ *
+ * The sound must not be playing them.
+ */
+void Sound::clear_buffer() {
+
+  if (buffer == AL_NONE) {
+    return;
+  }
+
+  if (device != nullptr) {
+    alDeleteBuffers(1, &buffer);
+  }
+  buffer = AL_NONE;
+  resident_bytes -= buffer_bytes;
+  MemoryUsage::add(MemoryUsage::Category::SOUNDS, -static_cast<int64_t>(buffer_bytes));
+  buffer_bytes = 0;
+}
+
+/**
+ * \brief Starts playing a new streamed instance of this sound.
+ * \return \c true in case of success.
+ */
+bool Sound::start_stream() {
+
+  const std::string& file_name = get_file_name(id);
+  QuestFiles::DataFileView data;
+  if (!data.open(file_name)) {
     Debug::error(std::string("Cannot find sound file '") + file_name + "'");
-    return AL_NONE;
+    return false;
+  }
+
+  Stream stream;
+  stream.decoder = std::unique_ptr<OggDecoder>(new OggDecoder());
+  if (!stream.decoder->load(std::move(data), false)) {
+    Debug::error(std::string("Cannot load sound file '") + file_name + "'");
+    return false;
+  }
+
+  stream.source = acquire_source(settings.priority);
+  if (stream.source == AL_NONE) {
+    return false;
+  }
+  stream.start = last_use;
+  alSourcef(stream.source, AL_GAIN, volume);
+  alGenBuffers(Stream::nb_buffers, stream.buffers.data());
+  for (ALuint stream_buffer: stream.buffers) {
+    if (!stream.decoder->decode(stream_buffer, Stream::buffer_size)) {
+      stream.finished = true;
+      break;
+    }
+    alSourceQueueBuffers(stream.source, 1, &stream_buffer);
+  }
+  alSourcePlay(stream.source);
+
+  int error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot stream sound '" << id << "': error " << error;
+    Debug::error(oss.str());
+    destroy_stream(stream);
+    return false;
+  }
+
+  streams.push_back(std::move(stream));
+  current_sounds.remove(this); // to avoid duplicates
+  current_sounds.push_back(this);
+  return true;
+}
+
+/**
+ * \brief Refills the buffers of a streamed instance that were played.
+ * \param stream The streamed instance.
+ * \return \c true if it is still playing, \c false if it is finished.
+ */
+bool Sound::update_stream(Stream& stream) {
+
+  ALint nb_processed = 0;
+  alGetSourcei(stream.source, AL_BUFFERS_PROCESSED, &nb_processed);
+  for (int i = 0; i < nb_processed; ++i) {
+    ALuint stream_buffer;
+    alSourceUnqueueBuffers(stream.source, 1, &stream_buffer);
+    if (stream.finished) {
+      continue;
+    }
+    if (stream.decoder->decode(stream_buffer, Stream::buffer_size)) {
+      alSourceQueueBuffers(stream.source, 1, &stream_buffer);
+    }
+    else {
+      stream.finished = true;
+    }
+  }
+
+  ALint status;
+  alGetSourcei(stream.source, AL_SOURCE_STATE, &status);
+  if (status == AL_PLAYING || status == AL_PAUSED) {
+    return true;
   }
 
+  // The source ran out of data: restart it if buffers were refilled since.
+  ALint nb_queued = 0;
+  alGetSourcei(stream.source, AL_BUFFERS_QUEUED, &nb_queued);
+  if (nb_queued > 0) {
+    alSourcePlay(stream.source);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * \brief Stops a streamed instance and deletes its source and buffers.
+ * \param stream The streamed instance.
+ */
+void Sound::destroy_stream(Stream& stream) {
+
+  release_source(stream.source);
+  alDeleteBuffers(Stream::nb_buffers, stream.buffers.data());
+  stream.source = AL_NONE;
+  stream.decoder = nullptr;
+}
+
+/**
+ * \brief Loads the specified sound file and decodes its content into PCM samples.
+ *
+ * This function does not use OpenAL and can be called from any thread.
+ *
+ * \param file_name name of the file to open
+ * \param decoded The decoded stereo 16-bit samples and their rate.
+ * \return \c true in case of success.
+ */
+bool Sound::decode_samples(const std::string& file_name, DecodedSound& decoded) {
+
   // load the sound file
   SoundFromMemory mem;
   mem.loop = false;
   mem.position = 0;
-  mem.data = QuestFiles::data_file_read(file_name);
+  if (!mem.data.open(file_name)) {
+    Debug::error(std::string("Cannot find sound file '") + file_name + "'");
+    return false;
+  }
 
+  bool success = false;
   OggVorbis_File file;
   int error = ov_open_callbacks(&mem, &file, nullptr, 0, ogg_callbacks);
 
@@ -601,7 +1271,12 @@ ALuint Sound::decode_file(const std::string& file_name) {
 
     // read the encoded sound properties
     vorbis_info* info = ov_info(&file, -1);
-    ALsizei sample_rate = ALsizei(info->rate);
+    decoded.sample_rate = ALsizei(info->rate);
+
+    // long sounds are streamed when played: don't decode them now
+    const ogg_int64_t nb_samples = ov_pcm_total(&file, -1);
+    const ogg_int64_t decoded_size = nb_samples * 2 * sizeof(ALshort);
+    decoded.streamed = nb_samples >= 0 && decoded_size > ogg_int64_t(stream_threshold);
 
     ALenum format = AL_NONE;
     if (info->channels == 1) {
@@ -615,12 +1290,16 @@ ALuint Sound::decode_file(const std::string& file_name) {
       Debug::error(std::string("Invalid audio format for sound file '")
           + file_name + "'");
     }
+    else if (decoded.streamed) {
+      decoded.samples.clear();
+      success = true;
+    }
     else {
       // decode the sound with vorbisfile
-      std::vector<char> samples;
+      std::vector<char>& samples = decoded.samples;
+      samples.clear();
       int bitstream;
       long bytes_read;
-      long total_bytes_read = 0;
       const int buffer_size = 16384;
       char samples_buffer[buffer_size];
       do {
@@ -632,7 +1311,6 @@ ALuint Sound::decode_file(const std::string& file_name) {
           Debug::error(oss.str());
         }
         else {
-          total_bytes_read += bytes_read;
           if (format == AL_FORMAT_STEREO16) {
             samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
           }
@@ -644,39 +1322,51 @@ ALuint Sound::decode_file(const std::string& file_name) {
               samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
               samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
             }
-            total_bytes_read += bytes_read;
           }
         }
       }
       while (bytes_read > 0);
-
-      // copy the samples into an OpenAL buffer
-      alGenBuffers(1, &buffer);
-      if (alGetError() != AL_NO_ERROR) {
-          Debug::error("Failed to generate audio buffer");
-      }
-      alBufferData(buffer,
-          AL_FORMAT_STEREO16,
-          reinterpret_cast<ALshort*>(samples.data()),
-          ALsizei(total_bytes_read),
-          sample_rate);
-      ALenum error = alGetError();
-      if (error != AL_NO_ERROR) {
-        std::ostringstream oss;
-        oss << "Cannot copy the sound samples of '"
-            << file_name << "' into buffer " << buffer
-            << ": error " << error;
-        Debug::error(oss.str());
-        buffer = AL_NONE;
-      }
+      success = true;
     }
     ov_clear(&file);
   }
 
-  mem.data.clear();
+  mem.data.close();
 
-  return buffer;
+  return success;
 }
 
+/**
+ * \brief Copies decoded samples into a new OpenAL buffer.
+ * \param file_name name of the sound file, for error messages
+ * \param decoded The decoded stereo 16-bit samples.
+ * \return the buffer created, or AL_NONE in case of error
+ */
+ALuint Sound::create_buffer(const std::string& file_name, const DecodedSound& decoded) {
+
+  ALuint buffer = AL_NONE;
+
+  // copy the samples into an OpenAL buffer
+  alGenBuffers(1, &buffer);
+  if (alGetError() != AL_NO_ERROR) {
+      Debug::error("Failed to generate audio buffer");
+  }
+  alBufferData(buffer,
+      AL_FORMAT_STEREO16,
+      reinterpret_cast<const ALshort*>(decoded.samples.data()),
+      ALsizei(decoded.samples.size()),
+      decoded.sample_rate);
+  ALenum error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot copy the sound samples of '"
+        << file_name << "' into buffer " << buffer
+        << ": error " << error;
+    Debug::error(oss.str());
+    buffer = AL_NONE;
+  }
+
+  return buffer;
 }
 
+}
@@ -16,6 +16,7 @@
  */
 #include "solarus/audio/SpcDecoder.h"
 #include "solarus/core/Debug.h"
+#include "solarus/third_party/snes_spc/SPC_DSP.h"
 #include <string>
 
 namespace Solarus {
@@ -33,10 +34,10 @@ SpcDecoder::SpcDecoder():
  * \param sound_data The memory area to read.
  * \param sound_size Size of the memory area in bytes.
  */
-void SpcDecoder::load(int16_t* sound_data, size_t sound_size) {
+void SpcDecoder::load(const int16_t* sound_data, size_t sound_size) {
 
   // Load the SPC data into the SPC library.
-  spc_load_spc(snes_spc_manager.get(), (short int*) sound_data, sound_size);
+  spc_load_spc(snes_spc_manager.get(), sound_data, sound_size);
   spc_clear_echo(snes_spc_manager.get());
   spc_filter_clear(snes_spc_filter.get());
 }
@@ -58,5 +59,16 @@ void SpcDecoder::decode(int16_t* decoded_data, int nb_samples) {
   spc_filter_run(snes_spc_filter.get(), (short int*) decoded_data, nb_samples);
 }
 
+/**
+ * \brief Sets whether the DSP may use SIMD instructions.
+ *
+ * Disabling SIMD forces the scalar code, which gives the same result.
+ *
+ * \param enabled \c true to use SIMD instructions when available.
+ */
+void SpcDecoder::set_simd_enabled(bool enabled) {
+
+  SPC_DSP::set_simd_enabled(enabled);
 }
 
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/AssetWatcher.h"
+#include <physfs.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Data directories whose files are watched.
+ */
+const std::vector<std::string> watched_directories = {
+    "sprites",
+    "tilesets",
+    "images",
+    "sounds",
+    "shaders"
+};
+
+}
+
+/**
+ * \brief Creates a watcher that is not started yet.
+ */
+AssetWatcher::AssetWatcher():
+  stopping(false),
+  period(default_period) {
+
+}
+
+/**
+ * \brief Destructor. Stops the thread if it is running.
+ */
+AssetWatcher::~AssetWatcher() {
+
+  stop();
+}
+
+/**
+ * \brief Starts watching files.
+ *
+ * Files are compared to their state at the time of this call.
+ * Does nothing if the watcher is already started.
+ *
+ * \param period Milliseconds between two scans of the files.
+ */
+void AssetWatcher::start(uint32_t period) {
+
+  if (is_started()) {
+    return;
+  }
+
+  this->period = std::max(period, 1u);
+  stopping = false;
+  modification_dates.clear();
+  for (const std::string& dir_name : watched_directories) {
+    scan_directory(dir_name, modification_dates);
+  }
+
+  thread = std::thread([this]() {
+    run();
+  });
+}
+
+/**
+ * \brief Stops watching files.
+ *
+ * Changes not taken yet are forgotten.
+ */
+void AssetWatcher::stop() {
+
+  if (!is_started()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  stop_condition.notify_all();
+  thread.join();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  changed_files.clear();
+}
+
+/**
+ * \brief Returns whether the watcher is started.
+ * \return \c true if files are being watched.
+ */
+bool AssetWatcher::is_started() const {
+  return thread.joinable();
+}
+
+/**
+ * \brief Returns the files modified since the previous call.
+ *
+ * A file modified several times between two calls is only returned once.
+ *
+ * \return Names of the modified files, relative to the data directory.
+ */
+std::vector<std::string> AssetWatcher::take_changed_files() {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::string> result(changed_files.begin(), changed_files.end());
+  changed_files.clear();
+  return result;
+}
+
+/**
+ * \brief Scans the files periodically until stop() is called.
+ */
+void AssetWatcher::run() {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    stop_condition.wait_for(lock, std::chrono::milliseconds(period));
+    if (stopping) {
+      break;
+    }
+
+    // Don't block take_changed_files() while the files are scanned.
+    lock.unlock();
+    std::map<std::string, int64_t> dates;
+    for (const std::string& dir_name : watched_directories) {
+      scan_directory(dir_name, dates);
+    }
+    std::vector<std::string> modified;
+    for (const auto& kvp : dates) {
+      const auto it = modification_dates.find(kvp.first);
+      if (it != modification_dates.end() && it->second != kvp.second) {
+        modified.push_back(kvp.first);
+      }
+    }
+    // Remember files that disappeared: editors may save a file by deleting
+    // it first, and it is then reported once it exists again.
+    dates.insert(modification_dates.begin(), modification_dates.end());
+    modification_dates = std::move(dates);
+    lock.lock();
+
+    changed_files.insert(modified.begin(), modified.end());
+  }
+}
+
+/**
+ * \brief Gets the modification date of the files of a directory.
+ * \param dir_name A data directory.
+ * \param[out] dates Where to add the modification date of each file,
+ * recursively.
+ */
+void AssetWatcher::scan_directory(
+    const std::string& dir_name,
+    std::map<std::string, int64_t>& dates) const {
+
+  char** files = PHYSFS_enumerateFiles(dir_name.c_str());
+  if (files == nullptr) {
+    return;
+  }
+
+  for (char** file = files; *file != nullptr; ++file) {
+    const std::string& file_name = dir_name + "/" + *file;
+    if (PHYSFS_isDirectory(file_name.c_str())) {
+      scan_directory(file_name, dates);
+    }
+    else {
+      dates[file_name] = PHYSFS_getLastModTime(file_name.c_str());
+    }
+  }
+  PHYSFS_freeList(files);
+}
+
+}
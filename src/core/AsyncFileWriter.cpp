@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/AsyncFileWriter.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/QuestFiles.h"
+#include <algorithm>
+#include <cstdio>
+#ifdef _WIN32
+#  include <io.h>        // _commit()
+#  include <windows.h>   // MoveFileExA()
+#elif defined(SOLARUS_HAVE_UNISTD_H)
+#  include <unistd.h>    // fsync()
+#endif
+
+namespace Solarus {
+
+bool AsyncFileWriter::initialized = false;
+std::thread AsyncFileWriter::worker;
+std::mutex AsyncFileWriter::mutex;
+std::condition_variable AsyncFileWriter::jobs_changed;
+std::condition_variable AsyncFileWriter::jobs_done;
+std::deque<AsyncFileWriter::Job> AsyncFileWriter::jobs;
+bool AsyncFileWriter::writing = false;
+bool AsyncFileWriter::stopping = false;
+std::vector<AsyncFileWriter::Result> AsyncFileWriter::results;
+uint64_t AsyncFileWriter::next_id = 0;
+std::map<uint64_t, std::vector<AsyncFileWriter::Callback>> AsyncFileWriter::callbacks;
+
+/**
+ * \brief Starts the thread that writes files.
+ */
+void AsyncFileWriter::initialize() {
+
+  if (initialized) {
+    return;
+  }
+
+  stopping = false;
+  initialized = true;
+  worker = std::thread(&AsyncFileWriter::run);
+}
+
+/**
+ * \brief Writes the files still waiting and stops the thread.
+ *
+ * Callbacks not called yet are dropped.
+ */
+void AsyncFileWriter::quit() {
+
+  if (!initialized) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobs_changed.notify_all();
+  worker.join();
+
+  results.clear();
+  callbacks.clear();
+  initialized = false;
+}
+
+/**
+ * \brief Returns whether the writing thread is started.
+ * \return \c true if files can be written asynchronously.
+ */
+bool AsyncFileWriter::is_initialized() {
+  return initialized;
+}
+
+/**
+ * \brief Requests to write a file of the quest write directory.
+ *
+ * If the writer is not initialized, the file is written immediately.
+ *
+ * \param file_name Name of the file relative to the quest write directory.
+ * \param content Content to write.
+ * \param callback Function to call from update() when the file is written,
+ * or an empty function.
+ */
+void AsyncFileWriter::write(
+    const std::string& file_name,
+    const std::string& content,
+    const Callback& callback
+) {
+  const std::string& path = QuestFiles::get_full_quest_write_dir() + "/" + file_name;
+
+  if (!initialized) {
+    const bool success = save_file(path, content);
+    if (!success) {
+      Debug::error("Cannot write file '" + file_name + "'");
+    }
+    if (callback) {
+      callback(success);
+    }
+    return;
+  }
+
+  uint64_t id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = std::find_if(jobs.begin(), jobs.end(), [&](const Job& job) {
+      return job.file_name == file_name;
+    });
+    if (it != jobs.end()) {
+      // Not started yet: only write the new content.
+      it->content = content;
+      id = it->id;
+    }
+    else {
+      id = next_id++;
+      jobs.push_back({ id, file_name, path, content });
+    }
+  }
+  jobs_changed.notify_one();
+
+  if (callback) {
+    callbacks[id].push_back(callback);
+  }
+}
+
+/**
+ * \brief Waits until all files requested are written.
+ *
+ * Callbacks are still called by the next update().
+ * Call this function before reading or replacing a file that may be
+ * waiting to be written.
+ */
+void AsyncFileWriter::flush() {
+
+  if (!initialized) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  jobs_done.wait(lock, []() { return jobs.empty() && !writing; });
+}
+
+/**
+ * \brief Calls the callbacks of the files written since the last call.
+ *
+ * This function must be called by the main thread.
+ */
+void AsyncFileWriter::update() {
+
+  std::vector<Result> finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.swap(results);
+  }
+
+  for (const Result& result : finished) {
+    if (!result.success) {
+      Debug::error("Cannot write file '" + result.file_name + "'");
+    }
+    const auto it = callbacks.find(result.id);
+    if (it == callbacks.end()) {
+      continue;
+    }
+    const std::vector<Callback> job_callbacks = std::move(it->second);
+    callbacks.erase(it);
+    for (const Callback& callback : job_callbacks) {
+      callback(result.success);
+    }
+  }
+}
+
+/**
+ * \brief Drops all callbacks not called yet.
+ *
+ * Files requested are still written.
+ * Call this function when the objects used by callbacks are destroyed.
+ */
+void AsyncFileWriter::cancel_callbacks() {
+  callbacks.clear();
+}
+
+/**
+ * \brief Writes a file safely.
+ *
+ * The content is written to a temporary file, flushed to the disk and then
+ * renamed, so that the file is either fully replaced or left unchanged.
+ *
+ * \param path Full path of the file to write.
+ * \param content Content to write.
+ * \return \c true in case of success.
+ */
+bool AsyncFileWriter::save_file(const std::string& path, const std::string& content) {
+
+  const std::string& temporary_path = path + ".tmp";
+  std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool success = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+  success = std::fflush(file) == 0 && success;
+#ifdef _WIN32
+  success = success && _commit(_fileno(file)) == 0;
+#elif defined(SOLARUS_HAVE_UNISTD_H)
+  success = success && fsync(fileno(file)) == 0;
+#endif
+  success = std::fclose(file) == 0 && success;
+
+  if (success) {
+#ifdef _WIN32
+    success = MoveFileExA(temporary_path.c_str(), path.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    success = std::rename(temporary_path.c_str(), path.c_str()) == 0;
+#endif
+  }
+
+  if (!success) {
+    std::remove(temporary_path.c_str());
+  }
+  return success;
+}
+
+/**
+ * \brief Main function of the worker thread.
+ *
+ * Writes files until quit() is called and nothing remains to write.
+ */
+void AsyncFileWriter::run() {
+
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobs_changed.wait(lock, []() { return stopping || !jobs.empty(); });
+      if (jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      writing = true;
+    }
+
+    const bool success = save_file(job.path, job.content);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      writing = false;
+      results.push_back({ job.id, job.file_name, success });
+    }
+    jobs_done.notify_all();
+  }
+}
+
+}
+
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/BinaryData.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/Size.h"
+
+namespace Solarus {
+
+/**
+ * \brief Appends an unsigned integer.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_uint(uint32_t value) {
+
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<char>(value));
+}
+
+/**
+ * \brief Appends a signed integer.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_int(int value) {
+
+  const uint32_t bits = static_cast<uint32_t>(value);
+  write_uint((bits << 1) ^ (value < 0 ? 0xFFFFFFFF : 0));
+}
+
+/**
+ * \brief Appends a boolean.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_bool(bool value) {
+
+  buffer.push_back(value ? 1 : 0);
+}
+
+/**
+ * \brief Appends a 64-bit integer on exactly 8 bytes.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_uint64(uint64_t value) {
+
+  for (int i = 0; i < 8; ++i) {
+    buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+/**
+ * \brief Appends a string.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_string(const std::string& value) {
+
+  write_uint(static_cast<uint32_t>(value.size()));
+  buffer.append(value);
+}
+
+/**
+ * \brief Appends a point.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_point(const Point& value) {
+
+  write_int(value.x);
+  write_int(value.y);
+}
+
+/**
+ * \brief Appends a size.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_size(const Size& value) {
+
+  write_int(value.width);
+  write_int(value.height);
+}
+
+/**
+ * \brief Appends a rectangle.
+ * \param value The value to write.
+ */
+void BinaryWriter::write_rectangle(const Rectangle& value) {
+
+  write_point(value.get_xy());
+  write_size(value.get_size());
+}
+
+/**
+ * \brief Returns the bytes written so far.
+ * \return The buffer.
+ */
+const std::string& BinaryWriter::get_buffer() const {
+  return buffer;
+}
+
+/**
+ * \brief Creates a reader.
+ * \param buffer The bytes to read. They must live as long as the reader.
+ * \param position Index of the first byte to read.
+ */
+BinaryReader::BinaryReader(const std::string& buffer, size_t position):
+  buffer(buffer),
+  position(position),
+  failed(position > buffer.size()) {
+
+}
+
+/**
+ * \brief Reads an unsigned integer.
+ * \return The value read, or 0 in case of error.
+ */
+uint32_t BinaryReader::read_uint() {
+
+  uint32_t value = 0;
+  for (int shift = 0; !failed && shift < 35; shift += 7) {
+    if (position >= buffer.size()) {
+      break;
+    }
+    const uint8_t byte = static_cast<uint8_t>(buffer[position++]);
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  failed = true;
+  return 0;
+}
+
+/**
+ * \brief Reads a signed integer.
+ * \return The value read, or 0 in case of error.
+ */
+int BinaryReader::read_int() {
+
+  const uint32_t bits = read_uint();
+  return static_cast<int>((bits >> 1) ^ (0 - (bits & 1)));
+}
+
+/**
+ * \brief Reads a boolean.
+ * \return The value read, or \c false in case of error.
+ */
+bool BinaryReader::read_bool() {
+
+  if (failed || position >= buffer.size() || static_cast<uint8_t>(buffer[position]) > 1) {
+    failed = true;
+    return false;
+  }
+  return buffer[position++] != 0;
+}
+
+/**
+ * \brief Reads a 64-bit integer stored on exactly 8 bytes.
+ * \return The value read, or 0 in case of error.
+ */
+uint64_t BinaryReader::read_uint64() {
+
+  if (failed || buffer.size() - position < 8) {
+    failed = true;
+    return 0;
+  }
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(buffer[position++])) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * \brief Reads a string.
+ * \return The value read, or an empty string in case of error.
+ */
+std::string BinaryReader::read_string() {
+
+  const size_t size = read_uint();
+  if (failed || buffer.size() - position < size) {
+    failed = true;
+    return std::string();
+  }
+  std::string value = buffer.substr(position, size);
+  position += size;
+  return value;
+}
+
+/**
+ * \brief Reads a point.
+ * \return The value read.
+ */
+Point BinaryReader::read_point() {
+
+  const int x = read_int();
+  const int y = read_int();
+  return Point(x, y);
+}
+
+/**
+ * \brief Reads a size.
+ * \return The value read.
+ */
+Size BinaryReader::read_size() {
+
+  const int width = read_int();
+  const int height = read_int();
+  return Size(width, height);
+}
+
+/**
+ * \brief Reads a rectangle.
+ * \return The value read.
+ */
+Rectangle BinaryReader::read_rectangle() {
+
+  const Point& xy = read_point();
+  const Size& size = read_size();
+  return Rectangle(xy, size);
+}
+
+/**
+ * \brief Reads a number of elements that follow.
+ *
+ * Every element takes at least one byte, so a count greater than the number
+ * of remaining bytes is an error. This protects callers from allocating
+ * huge containers when the data is corrupted.
+ *
+ * \return The number of elements, or 0 in case of error.
+ */
+size_t BinaryReader::read_count() {
+
+  const size_t count = read_uint();
+  if (failed || count > buffer.size() - position) {
+    failed = true;
+    return 0;
+  }
+  return count;
+}
+
+/**
+ * \brief Returns the index of the next byte to read.
+ * \return The current position.
+ */
+size_t BinaryReader::get_position() const {
+  return position;
+}
+
+/**
+ * \brief Returns whether all bytes were read.
+ * \return \c true if the end of the buffer is reached.
+ */
+bool BinaryReader::is_at_end() const {
+  return position == buffer.size();
+}
+
+/**
+ * \brief Returns whether a read went wrong.
+ * \return \c true if the buffer was too short or malformed.
+ */
+bool BinaryReader::has_failed() const {
+  return failed;
+}
+
+/**
+ * \brief Computes the 64-bit FNV-1a hash of some bytes.
+ *
+ * Unlike std::hash, the result is the same on every platform and every run,
+ * so it can identify the content of files in caches.
+ *
+ * \param data The bytes to hash.
+ * \param size Number of bytes to hash.
+ * \return The hash.
+ */
+uint64_t get_fnv1a_hash(const char* data, size_t size) {
+
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CatchUpModeInfo.h"
+
+namespace Solarus {
+
+const std::string EnumInfoTraits<CatchUpMode>::pretty_name = "catch-up mode";
+
+const EnumInfo<CatchUpMode>::names_type EnumInfoTraits<CatchUpMode>::names = {
+    { CatchUpMode::FIXED, "fixed" },
+    { CatchUpMode::ADAPTIVE, "adaptive" },
+};
+
+}
@@ -16,13 +16,18 @@
  */
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
-#include "solarus/core/DialogResources.h"
+#include "solarus/core/JobSystem.h"
+#include "solarus/core/LanguageTexts.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestDatabase.h"
 #include "solarus/core/QuestProperties.h"
-#include "solarus/core/StringResources.h"
 #include <lua.hpp>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace Solarus {
 
@@ -32,6 +37,15 @@ namespace {
 
 bool initialized = false;
 
+std::shared_ptr<const LanguageTexts> current_texts;    /**< Texts of the current language,
+                                                        * accessed atomically. */
+std::mutex preloaded_languages_mutex;                  /**< Protects the preloads below. */
+std::map<std::string, std::shared_ptr<const LanguageTexts>>
+    preloaded_languages;                               /**< Languages parsed in advance. */
+std::map<std::string, std::shared_future<void>>
+    pending_preloads;                                  /**< Languages being parsed by
+                                                        * preload_language_async(). */
+
 }
 
 /**
@@ -83,8 +97,21 @@ void initialize() {
 void quit() {
 
   get_database().clear();
-  get_strings().clear();
-  get_dialogs().clear();
+
+  // Wait for languages still being parsed.
+  std::map<std::string, std::shared_future<void>> pending;
+  {
+    std::lock_guard<std::mutex> lock(preloaded_languages_mutex);
+    pending = pending_preloads;
+  }
+  for (const auto& kvp : pending) {
+    kvp.second.wait();
+  }
+
+  std::atomic_store(&current_texts, std::shared_ptr<const LanguageTexts>());
+  std::lock_guard<std::mutex> lock(preloaded_languages_mutex);
+  preloaded_languages.clear();
+  pending_preloads.clear();
 
   initialized = false;
 }
@@ -134,6 +161,21 @@ bool resource_exists(ResourceType resource_type, const std::string& id) {
   return get_database().resource_exists(resource_type, id);
 }
 
+/**
+ * \brief Returns whether there exists an element with the specified id.
+ *
+ * This version does no string work: use it with ids checked often.
+ *
+ * \param resource_type A type of resource.
+ * \param id The id to look for.
+ * \return \c true if there exists an element with the specified id in this
+ * resource type.
+ */
+bool resource_exists(ResourceType resource_type, const Symbol& id) {
+
+  return get_database().resource_exists(resource_type, id);
+}
+
 /**
  * \brief Returns the list of element ids and descriptions of the specified resource type.
  * \param resource_type A type of resource.
@@ -162,6 +204,9 @@ bool has_language(const std::string& language_code) {
  * The language-specific data will be loaded from the directory of this language.
  * This function must be called before the first language-specific file is loaded.
  *
+ * If the texts of this language were preloaded, they are used without
+ * reading any file: the switch only replaces a pointer.
+ *
  * \param language_code Code of the language to set.
  */
 void set_language(const std::string& language_code) {
@@ -171,37 +216,93 @@ void set_language(const std::string& language_code) {
 
   get_language() = language_code;
 
-  // Read the quest string list file.
-  get_strings().clear();
-  get_strings().import_from_quest_file("text/strings.dat", true);
+  // Use the texts parsed in advance if they are from this language,
+  // waiting for them if they are still being parsed.
+  std::shared_ptr<const LanguageTexts> texts;
+  std::shared_future<void> pending;
+  {
+    std::lock_guard<std::mutex> lock(preloaded_languages_mutex);
+    const auto& it = pending_preloads.find(language_code);
+    if (it != pending_preloads.end()) {
+      pending = it->second;
+    }
+  }
+  if (pending.valid()) {
+    pending.wait();
+  }
+  {
+    std::lock_guard<std::mutex> lock(preloaded_languages_mutex);
+    pending_preloads.erase(language_code);
+    const auto& it = preloaded_languages.find(language_code);
+    if (it != preloaded_languages.end()) {
+      texts = it->second;
+      preloaded_languages.erase(it);
+    }
+  }
+
+  if (texts == nullptr) {
+    texts = LanguageTexts::load(language_code);
+  }
+  std::atomic_store(&current_texts, texts);
+
+  Logger::info(std::string("Language: ") + language_code);
+}
 
-  // Read the quest dialog list file.
-  DialogResources resources;
-  std::map<std::string, Dialog>& dialogs = get_dialogs();
+/**
+ * \brief Parses the strings and dialogs of a language in advance.
+ *
+ * This can be called by any thread.
+ * The next call to set_language() with this language uses the result
+ * instead of reading the files again.
+ * Nothing is done if the files are missing: set_language() will then
+ * report the error.
+ *
+ * \param language_code Code of the language to parse.
+ */
+void preload_language(const std::string& language_code) {
 
-  bool success = resources.import_from_quest_file("text/dialogs.dat", true);
+  if (!has_language(language_code)) {
+    return;
+  }
 
-  // Create dialogs.
-  dialogs.clear();
-  if (success) {
-    for (const auto& kvp : resources.get_dialogs()) {
+  const std::string& prefix = "languages/" + language_code + "/";
+  if (!QuestFiles::data_file_exists(prefix + "text/strings.dat") ||
+      !QuestFiles::data_file_exists(prefix + "text/dialogs.dat")) {
+    return;
+  }
 
-      const std::string& id = kvp.first;
-      const DialogData& data = kvp.second;
+  std::shared_ptr<const LanguageTexts> texts = LanguageTexts::load(language_code);
 
-      Dialog dialog;
-      dialog.set_id(id);
-      dialog.set_text(data.get_text());
+  std::lock_guard<std::mutex> lock(preloaded_languages_mutex);
+  preloaded_languages[language_code] = texts;
+}
 
-      for (const auto& pkvp : data.get_properties()) {
-        dialog.set_property(pkvp.first, pkvp.second);
-      }
+/**
+ * \brief Starts parsing the strings and dialogs of a language in a
+ * separate thread.
+ *
+ * Returns immediately. If set_language() is called with this language
+ * before the parsing is finished, it waits for the result.
+ *
+ * \param language_code Code of the language to parse.
+ */
+void preload_language_async(const std::string& language_code) {
 
-      dialogs.emplace(id, dialog);
-    }
+  std::lock_guard<std::mutex> lock(preloaded_languages_mutex);
+  if (preloaded_languages.find(language_code) != preloaded_languages.end()) {
+    // Already done.
+    return;
+  }
+  const auto& it = pending_preloads.find(language_code);
+  if (it != pending_preloads.end() &&
+      it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    // In progress.
+    return;
   }
 
-  Logger::info(std::string("Language: ") + language_code);
+  pending_preloads[language_code] = JobSystem::async(JobSystem::Priority::BACKGROUND, [language_code]() {
+    preload_language(language_code);
+  }).share();
 }
 
 /**
@@ -238,15 +339,18 @@ std::string get_language_name(const std::string& language_code) {
 }
 
 /**
- * \brief Returns the string list of the current quest.
- * \return The current quest string list.
+ * \brief Returns the strings and dialogs of the current language.
+ * \return The current texts. They are empty if no language is set.
  */
-StringResources& get_strings() {
+std::shared_ptr<const LanguageTexts> get_texts() {
 
-  // The string resources object must be in a function to avoid static
-  // initialization order problems.
-  static StringResources strings;
-  return strings;
+  std::shared_ptr<const LanguageTexts> texts = std::atomic_load(&current_texts);
+  if (texts == nullptr) {
+    static const std::shared_ptr<const LanguageTexts> no_texts =
+        std::make_shared<LanguageTexts>();
+    return no_texts;
+  }
+  return texts;
 }
 
 /**
@@ -257,30 +361,24 @@ StringResources& get_strings() {
  */
 bool string_exists(const std::string& key) {
 
-  return get_strings().has_string(key);
+  return get_texts()->find_string(key) != nullptr;
 }
 
 /**
  * \brief Returns a string stored in the language-specific file
  * "text/strings.dat" for the current language.
+ *
+ * The string remains valid until the language changes.
+ *
  * \param key Id of the string to retrieve. It must exist.
  * \return The corresponding localized string.
  */
 const std::string& get_string(const std::string& key) {
 
-  return get_strings().get_string(key);
-}
-
-/**
- * \brief Returns the dialog list of the current quest.
- * \return The current quest dialog list.
- */
-std::map<std::string, Dialog>& get_dialogs() {
-
-  // The dialog objects must be in a function to avoid static initialization
-  // order problems.
-  static std::map<std::string, Dialog> dialogs;
-  return dialogs;
+  const std::string* string = get_texts()->find_string(key);
+  Debug::check_assertion(string != nullptr, std::string(
+    "No such string: '") + key + "'");
+  return *string;
 }
 
 /**
@@ -290,21 +388,24 @@ std::map<std::string, Dialog>& get_dialogs() {
  */
 bool dialog_exists(const std::string& dialog_id) {
 
-  const auto& dialogs = get_dialogs();
-  return dialogs.find(dialog_id) != dialogs.end();
+  return get_texts()->find_dialog(dialog_id) != nullptr;
 }
 
 /**
  * \brief Returns a dialog stored in the language-specific file
  * "text/dialogs.dat".
+ *
+ * The dialog remains valid until the language changes.
+ *
  * \param dialog_id id of the dialog to retrieve
  * \return the corresponding localized dialog
  */
 const Dialog& get_dialog(const std::string& dialog_id) {
 
-  Debug::check_assertion(dialog_exists(dialog_id), std::string(
+  const Dialog* dialog = get_texts()->find_dialog(dialog_id);
+  Debug::check_assertion(dialog != nullptr, std::string(
     "No such dialog: '") + dialog_id + "'");
-  return get_dialogs()[dialog_id];
+  return *dialog;
 }
 
 /**
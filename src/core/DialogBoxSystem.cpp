@@ -37,18 +37,12 @@ DialogBoxSystem::DialogBoxSystem(Game& game):
   game(game),
   callback_ref(),
   built_in(false),
+  line_surfaces(),
+  first_visible_line(0),
+  next_line(0),
   is_question(false),
   selected_first_answer(true) {
 
-  for (int i = 0; i < nb_visible_lines; i++) {
-    line_surfaces[i] = std::make_shared<TextSurface>(
-        0,
-        0,
-        TextSurface::HorizontalAlignment::LEFT,
-        TextSurface::VerticalAlignment::BOTTOM
-    );
-    line_surfaces[i]->set_font_size(16);
-  }
 }
 
 /**
@@ -139,11 +133,22 @@ void DialogBoxSystem::open(
         }
       }
 
-      remaining_lines.clear();
+      // Lay out all lines now, so that showing them later costs nothing.
+      line_surfaces.clear();
+      first_visible_line = 0;
+      next_line = 0;
       std::istringstream iss(text);
       std::string line;
       while (std::getline(iss, line)) {
-        remaining_lines.push_back(line);
+        std::shared_ptr<TextSurface> line_surface = std::make_shared<TextSurface>(
+            0,
+            0,
+            TextSurface::HorizontalAlignment::LEFT,
+            TextSurface::VerticalAlignment::BOTTOM
+        );
+        line_surface->set_font_size(16);
+        line_surface->set_text(line);
+        line_surfaces.push_back(line_surface);
       }
 
       // Determine the position.
@@ -181,6 +186,9 @@ void DialogBoxSystem::close(const ScopedLuaRef& status_ref) {
   ScopedLuaRef callback_ref = this->callback_ref;
   this->callback_ref.clear();
   this->dialog_id = "";
+  line_surfaces.clear();
+  first_visible_line = 0;
+  next_line = 0;
 
   // Restore commands.
   CommandsEffects& keys_effect = game.get_commands_effects();
@@ -200,7 +208,21 @@ void DialogBoxSystem::close(const ScopedLuaRef& status_ref) {
  * \return \c true if there are more lines.
  */
 bool DialogBoxSystem::has_more_lines() const {
-  return !remaining_lines.empty();
+  return next_line < line_surfaces.size();
+}
+
+/**
+ * \brief Returns a line currently displayed in the built-in dialog box.
+ * \param index Index of the line in the group of visible lines.
+ * \return The line, or nullptr if there is no such line.
+ */
+TextSurface* DialogBoxSystem::get_visible_line(int index) {
+
+  const size_t line_index = first_visible_line + index;
+  if (index < 0 || index >= nb_visible_lines || line_index >= next_line) {
+    return nullptr;
+  }
+  return line_surfaces[line_index].get();
 }
 
 /**
@@ -228,22 +250,16 @@ void DialogBoxSystem::show_more_lines() {
   CommandsEffects& keys_effect = game.get_commands_effects();
   keys_effect.set_action_key_effect(CommandsEffects::ACTION_KEY_NEXT);
 
-  // Prepare the 3 lines.
+  // Place the next 3 lines, already laid out.
   int text_x = text_position.x;
   int text_y = text_position.y;
-  for (int i = 0; i < nb_visible_lines; i++) {
+  first_visible_line = next_line;
+  for (int i = 0; i < nb_visible_lines && has_more_lines(); i++) {
     text_y += 16;
-    line_surfaces[i]->set_x(text_x);
-    line_surfaces[i]->set_y(text_y);
-    line_surfaces[i]->set_text_color(Color::white);
-
-    if (has_more_lines()) {
-      line_surfaces[i]->set_text(*remaining_lines.begin());
-      remaining_lines.pop_front();
-    }
-    else {
-      line_surfaces[i]->set_text("");
-    }
+    TextSurface& line_surface = *line_surfaces[next_line];
+    line_surface.set_position(text_x, text_y);
+    line_surface.set_text_color(Color::white);
+    ++next_line;
   }
 
   if (built_in && is_question && !has_more_lines()) {
@@ -253,7 +269,10 @@ void DialogBoxSystem::show_more_lines() {
     // if the user needs something more elaborate, he should make his own
     // dialog box in Lua.
     this->selected_first_answer = true;
-    line_surfaces[nb_visible_lines - 2]->set_text_color(Color::yellow);
+    TextSurface* first_answer = get_visible_line(nb_visible_lines - 2);
+    if (first_answer != nullptr) {
+      first_answer->set_text_color(Color::yellow);
+    }
   }
 }
 
@@ -287,9 +306,11 @@ bool DialogBoxSystem::notify_command_pressed(GameCommand command) {
       selected_first_answer = !selected_first_answer;
       int selected_line_index = selected_first_answer ? 1 : 2;
       for (int i = 0; i < nb_visible_lines; i++) {
-        line_surfaces[i]->set_text_color(Color::white);
+        TextSurface* line_surface = get_visible_line(i);
+        if (line_surface != nullptr) {
+          line_surface->set_text_color(i == selected_line_index ? Color::yellow : Color::white);
+        }
       }
-      line_surfaces[selected_line_index]->set_text_color(Color::yellow);
     }
   }
 
@@ -311,7 +332,7 @@ void DialogBoxSystem::draw(const SurfacePtr& dst_surface) {
   }
 
   // Draw the text.
-  for (int i = 0; i < nb_visible_lines; i++) {
+  for (size_t i = first_visible_line; i < next_line; i++) {
     line_surfaces[i]->draw(dst_surface);
   }
 }
@@ -25,6 +25,7 @@
 #include "solarus/core/Savegame.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Hero.h"
+#include "solarus/lua/LuaContext.h"
 #include <algorithm>
 #include <sstream>
 
@@ -36,7 +37,16 @@ namespace Solarus {
  */
 Equipment::Equipment(Savegame& savegame):
   savegame(savegame),
-  suspended(true) {
+  suspended(true),
+  max_money_value(savegame.get_value_handle(Savegame::KEY_MAX_MONEY)),
+  money_value(savegame.get_value_handle(Savegame::KEY_CURRENT_MONEY)),
+  max_life_value(savegame.get_value_handle(Savegame::KEY_MAX_LIFE)),
+  life_value(savegame.get_value_handle(Savegame::KEY_CURRENT_LIFE)),
+  max_magic_value(savegame.get_value_handle(Savegame::KEY_MAX_MAGIC)),
+  magic_value(savegame.get_value_handle(Savegame::KEY_CURRENT_MAGIC)),
+  updatable_items(),
+  updatable_items_valid(false),
+  updatable_items_version(0) {
 
 }
 
@@ -109,10 +119,35 @@ void Equipment::update() {
   }
 
   // Update item scripts.
+  update_updatable_items();
+  for (EquipmentItem* item: updatable_items) {
+    item->update();
+  }
+}
+
+/**
+ * \brief Recomputes the list of items to update if events have changed.
+ *
+ * Only items whose script or metatable defines on_update() are updated
+ * at each cycle.
+ */
+void Equipment::update_updatable_items() {
+
+  const LuaContext& lua_context = savegame.get_lua_context();
+  const uint32_t version = lua_context.get_lua_events_version();
+  if (updatable_items_valid && version == updatable_items_version) {
+    return;
+  }
+
+  updatable_items.clear();
   for (const auto& kvp: items) {
     EquipmentItem& item = *kvp.second;
-    item.update();
+    if (lua_context.userdata_has_field(item, LuaEvent::ON_UPDATE)) {
+      updatable_items.push_back(&item);
+    }
   }
+  updatable_items_valid = true;
+  updatable_items_version = version;
 }
 
 /**
@@ -135,7 +170,7 @@ void Equipment::set_suspended(bool suspended) {
  * \return the player's maximum number of money
  */
 int Equipment::get_max_money() const {
-  return savegame.get_integer(Savegame::KEY_MAX_MONEY);
+  return savegame.get_integer(max_money_value);
 }
 
 /**
@@ -146,7 +181,7 @@ void Equipment::set_max_money(int max_money) {
 
   Debug::check_assertion(max_money >= 0, "Invalid money amount to add");
 
-  savegame.set_integer(Savegame::KEY_MAX_MONEY, max_money);
+  savegame.set_integer(max_money_value, max_money);
 
   // If the max money is reduced, make sure the current money does not exceed
   // the new maximum.
@@ -160,7 +195,7 @@ void Equipment::set_max_money(int max_money) {
  * \return the player's current amount of money
  */
 int Equipment::get_money() const {
-  return savegame.get_integer(Savegame::KEY_CURRENT_MONEY);
+  return savegame.get_integer(money_value);
 }
 
 /**
@@ -174,7 +209,7 @@ int Equipment::get_money() const {
 void Equipment::set_money(int money) {
 
   money = std::max(0, std::min(get_max_money(), money));
-  savegame.set_integer(Savegame::KEY_CURRENT_MONEY, money);
+  savegame.set_integer(money_value, money);
 }
 
 /**
@@ -212,7 +247,7 @@ void Equipment::remove_money(int money_to_remove) {
  * \return the player's maximum level of life
  */
 int Equipment::get_max_life() const {
-  return savegame.get_integer(Savegame::KEY_MAX_LIFE);
+  return savegame.get_integer(max_life_value);
 }
 
 /**
@@ -227,7 +262,7 @@ void Equipment::set_max_life(int max_life) {
 
   Debug::check_assertion(max_life >= 0, "Invalid life amount");
 
-  savegame.set_integer(Savegame::KEY_MAX_LIFE, max_life);
+  savegame.set_integer(max_life_value, max_life);
 
   // If the max life is reduced, make sure the current life does not exceed
   // the new maximum.
@@ -241,7 +276,7 @@ void Equipment::set_max_life(int max_life) {
  * \return the player's current life
  */
 int Equipment::get_life() const {
-  return savegame.get_integer(Savegame::KEY_CURRENT_LIFE);
+  return savegame.get_integer(life_value);
 }
 
 /**
@@ -255,7 +290,7 @@ int Equipment::get_life() const {
 void Equipment::set_life(int life) {
 
   life = std::max(0, std::min(get_max_life(), life));
-  savegame.set_integer(Savegame::KEY_CURRENT_LIFE, life);
+  savegame.set_integer(life_value, life);
 }
 
 /**
@@ -298,7 +333,7 @@ void Equipment::restore_all_life() {
  * \return the maximum level of magic
  */
 int Equipment::get_max_magic() const {
-  return savegame.get_integer(Savegame::KEY_MAX_MAGIC);
+  return savegame.get_integer(max_magic_value);
 }
 
 /**
@@ -313,7 +348,7 @@ void Equipment::set_max_magic(int max_magic) {
 
   Debug::check_assertion(max_magic >= 0, "Invalid magic amount");
 
-  savegame.set_integer(Savegame::KEY_MAX_MAGIC, max_magic);
+  savegame.set_integer(max_magic_value, max_magic);
 
   restore_all_magic();
 }
@@ -323,7 +358,7 @@ void Equipment::set_max_magic(int max_magic) {
  * \return the player's current number of magic points
  */
 int Equipment::get_magic() const {
-  return savegame.get_integer(Savegame::KEY_CURRENT_MAGIC);
+  return savegame.get_integer(magic_value);
 }
 
 /**
@@ -338,7 +373,7 @@ int Equipment::get_magic() const {
 void Equipment::set_magic(int magic) {
 
   magic = std::max(0, std::min(get_max_magic(), magic));
-  savegame.set_integer(Savegame::KEY_CURRENT_MAGIC, magic);
+  savegame.set_integer(magic_value, magic);
 }
 
 /**
@@ -395,6 +430,8 @@ void Equipment::load_items() {
     items[item_id] = item;
   }
 
+  updatable_items_valid = false;
+
   // Load the item scripts.
   for (const auto& kvp: items) {
     EquipmentItem& item = *kvp.second;
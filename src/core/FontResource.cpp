@@ -20,11 +20,14 @@
 #include "solarus/core/QuestFiles.h"
 #include "solarus/graphics/Surface.h"
 #include <utility>
+#include <vector>
 
 namespace Solarus {
 
 bool FontResource::fonts_loaded = false;
 std::map<std::string, FontResource::FontFile> FontResource::fonts;
+std::mutex FontResource::preloaded_fonts_mutex;
+std::map<std::string, FontResource::PreloadedFont> FontResource::preloaded_fonts;
 
 /**
  * \brief Initializes the font system.
@@ -41,14 +44,91 @@ void FontResource::quit() {
 
   fonts.clear();
   fonts_loaded = false;
+  std::lock_guard<std::mutex> lock(preloaded_fonts_mutex);
+  preloaded_fonts.clear();
   TTF_Quit();
 }
 
+/**
+ * \brief Looks for the file of a font.
+ * \param[in] font_id Id of a font.
+ * \param[out] file_name Name of the font file, relative to the data directory.
+ * \param[out] bitmap_font Whether this is a bitmap font.
+ * \return \c false if there is no file for this font.
+ */
+bool FontResource::find_font_file(
+    const std::string& font_id,
+    std::string& file_name,
+    bool& bitmap_font
+) {
+  static const std::vector<std::string> bitmap_extensions = {
+      ".png", ".PNG"
+  };
+  static const std::vector<std::string> outline_extensions = {
+      ".ttf", ".TTF", ".otf", ".OTF", ".ttc", ".TTC", ".fon", ".FON"
+  };
+
+  const std::string file_name_start = std::string("fonts/") + font_id;
+  for (const std::string& extension : bitmap_extensions) {
+    if (QuestFiles::data_file_exists(file_name_start + extension)) {
+      file_name = file_name_start + extension;
+      bitmap_font = true;
+      return true;
+    }
+  }
+  for (const std::string& extension : outline_extensions) {
+    if (QuestFiles::data_file_exists(file_name_start + extension)) {
+      file_name = file_name_start + extension;
+      bitmap_font = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Finds and reads the font files declared in the quest resource list.
+ *
+ * This can be called by any thread before the fonts are loaded,
+ * to make load_fonts() faster.
+ * Bitmap fonts are only found: their image is still loaded by the main
+ * thread in load_fonts().
+ */
+void FontResource::preload_files() {
+
+  const std::map<std::string, std::string>& font_resource =
+      CurrentQuest::get_resources(ResourceType::FONT);
+
+  std::map<std::string, PreloadedFont> files;
+  for (const auto& kvp: font_resource) {
+
+    PreloadedFont file;
+    if (!find_font_file(kvp.first, file.file_name, file.bitmap_font)) {
+      // load_fonts() will report the error.
+      continue;
+    }
+    if (!file.bitmap_font) {
+      file.buffer = QuestFiles::data_file_read(file.file_name);
+    }
+    files.emplace(kvp.first, std::move(file));
+  }
+
+  std::lock_guard<std::mutex> lock(preloaded_fonts_mutex);
+  preloaded_fonts = std::move(files);
+}
+
 /**
  * \brief Loads the fonts declared in the quest resource list.
  */
 void FontResource::load_fonts() {
 
+  std::map<std::string, PreloadedFont> files;
+  {
+    std::lock_guard<std::mutex> lock(preloaded_fonts_mutex);
+    files = std::move(preloaded_fonts);
+    preloaded_fonts.clear();
+  }
+
   // Get the list of available fonts.
   const std::map<std::string, std::string>& font_resource =
       CurrentQuest::get_resources(ResourceType::FONT);
@@ -62,45 +142,21 @@ void FontResource::load_fonts() {
     // Load the font.
 
     bool bitmap_font = false;
-    const std::string file_name_start = std::string("fonts/") + font_id;
-    if (QuestFiles::data_file_exists(file_name_start + ".png")) {
-      font.file_name = file_name_start + ".png";
-      bitmap_font = true;
+    const auto& it = files.find(font_id);
+    if (it != files.end()) {
+      font.file_name = it->second.file_name;
+      font.buffer = std::move(it->second.buffer);
+      bitmap_font = it->second.bitmap_font;
     }
-    else if (QuestFiles::data_file_exists(file_name_start + ".PNG")) {
-      font.file_name = file_name_start + ".PNG";
-      bitmap_font = true;
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".ttf")) {
-      font.file_name = file_name_start + ".ttf";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".TTF")) {
-      font.file_name = file_name_start + ".TTF";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".otf")) {
-      font.file_name = file_name_start + ".otf";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".OTF")) {
-      font.file_name = file_name_start + ".OTF";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".ttc")) {
-      font.file_name = file_name_start + ".ttc";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".TTC")) {
-      font.file_name = file_name_start + ".TTC";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".fon")) {
-      font.file_name = file_name_start + ".fon";
-    }
-    else if (QuestFiles::data_file_exists(file_name_start + ".FON")) {
-      font.file_name = file_name_start + ".FON";
-    }
-    else {
+    else if (!find_font_file(font_id, font.file_name, bitmap_font)) {
       Debug::error(std::string("Cannot find font file 'fonts/")
           + font_id + "' (tried with extensions .png, .ttf, .otf, .ttc and .fon)"
       );
       continue;
     }
+    else if (!bitmap_font) {
+      font.buffer = QuestFiles::data_file_read(font.file_name);
+    }
 
     if (bitmap_font) {
       // It's a bitmap font.
@@ -109,7 +165,6 @@ void FontResource::load_fonts() {
 
     else {
       // It's an outline font.
-      font.buffer = QuestFiles::data_file_read(font.file_name);
       font.bitmap_font = nullptr;
     }
 
@@ -241,10 +296,48 @@ TTF_Font& FontResource::get_outline_font(const std::string& font_id, int size, H
   // Set font kerning.
   TTF_SetFontKerning(outline_font.get(), kerning);
 
-  OutlineFontReader reader = { std::move(rw), std::move(outline_font) };
+  OutlineFontReader reader = { std::move(rw), std::move(outline_font), {} };
   outline_fonts.emplace(OutlineFontProperties{size, hinting, kerning}, std::move(reader));
   return *outline_fonts.at(OutlineFontProperties{size, hinting, kerning}).outline_font;
 }
 
+/**
+ * \brief Returns the glyph atlas of an outline font.
+ *
+ * The atlas is created empty the first time, and glyphs are rendered into
+ * it when text surfaces need them.
+ *
+ * \param font_id Id of the outline font to get. It must exist.
+ * \param size Size to use.
+ * \param hinting The hinting setting to use.
+ * \param kerning Whether to use kerning for rendering.
+ * \param rendering_mode How to render glyphs.
+ * \param color Color of the glyphs.
+ * \return The glyph atlas.
+ */
+std::shared_ptr<GlyphAtlas> FontResource::get_glyph_atlas(
+    const std::string& font_id,
+    int size,
+    HintingSetting hinting,
+    bool kerning,
+    RenderingMode rendering_mode,
+    const Color& color
+) {
+  TTF_Font& outline_font = get_outline_font(font_id, size, hinting, kerning);
+  OutlineFontReader& reader = fonts.at(font_id).outline_fonts.at(
+      OutlineFontProperties{size, hinting, kerning}
+  );
+
+  uint8_t r, g, b, a;
+  color.get_components(r, g, b, a);
+  const uint32_t rgba = (static_cast<uint32_t>(r) << 24) | (g << 16) | (b << 8) | a;
+
+  std::shared_ptr<GlyphAtlas>& glyph_atlas =
+      reader.glyph_atlases[GlyphAtlasProperties{rendering_mode, rgba}];
+  if (glyph_atlas == nullptr) {
+    glyph_atlas = std::make_shared<GlyphAtlas>(outline_font, rendering_mode, color);
+  }
+  return glyph_atlas;
 }
 
+}
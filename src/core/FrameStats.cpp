@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/FrameStats.h"
+#include "solarus/core/HotCounters.h"
+#include "solarus/core/LauncherChannel.h"
+#include "solarus/core/PerfTrace.h"
+#include <algorithm>
+#include <array>
+
+namespace Solarus {
+namespace FrameStats {
+
+namespace {
+
+Frame current_frame;                         /**< The frame being measured. */
+std::array<Frame, history_size> history;     /**< Ring buffer of the last frames. */
+size_t next_frame = 0;                       /**< Index where to store the next frame. */
+size_t num_frames = 0;                       /**< Number of frames in the history. */
+bool overlay_enabled = false;                /**< Whether the debug overlay is shown. */
+
+}
+
+/**
+ * \brief Returns the frame being measured.
+ * \return The current frame.
+ */
+Frame& get_current_frame() {
+  return current_frame;
+}
+
+/**
+ * \brief Adds the current frame to the history and starts a new one.
+ */
+void finish_frame() {
+
+  // Take the counts of hot paths of this frame.
+  using HotCounters::Counter;
+  const HotCounters::Snapshot counts = HotCounters::take_snapshot();
+  current_frame.quadtree_queries = counts[static_cast<size_t>(Counter::QUADTREE_QUERIES)];
+  current_frame.obstacle_tests = counts[static_cast<size_t>(Counter::OBSTACLE_TESTS)];
+  current_frame.detector_checks = counts[static_cast<size_t>(Counter::DETECTOR_CHECKS)];
+  current_frame.lua_calls = counts[static_cast<size_t>(Counter::LUA_CALLS)];
+  if (PerfTrace::is_enabled()) {
+    for (size_t i = 0; i < HotCounters::num_counters; ++i) {
+      PerfTrace::record_counter(HotCounters::get_counter_name(static_cast<Counter>(i)), counts[i]);
+    }
+  }
+
+  LauncherChannel::publish_frame(current_frame);
+
+  history[next_frame] = current_frame;
+  next_frame = (next_frame + 1) % history_size;
+  num_frames = std::min(num_frames + 1, history_size);
+  current_frame = Frame();
+}
+
+/**
+ * \brief Returns the last frames finished.
+ * \param num_frames Maximum number of frames to return.
+ * \return The frames, from the oldest to the most recent one.
+ */
+std::vector<Frame> get_last_frames(size_t num_frames) {
+
+  num_frames = std::min(num_frames, FrameStats::num_frames);
+  std::vector<Frame> frames;
+  frames.reserve(num_frames);
+  size_t index = (next_frame + history_size - num_frames) % history_size;
+  for (size_t i = 0; i < num_frames; ++i) {
+    frames.push_back(history[index]);
+    index = (index + 1) % history_size;
+  }
+  return frames;
+}
+
+/**
+ * \brief Returns whether the frame statistics are drawn over the screen.
+ * \return \c true if the overlay is enabled.
+ */
+bool is_overlay_enabled() {
+  return overlay_enabled;
+}
+
+/**
+ * \brief Sets whether the frame statistics are drawn over the screen.
+ * \param enabled \c true to show the overlay.
+ */
+void set_overlay_enabled(bool enabled) {
+  overlay_enabled = enabled;
+}
+
+}
+}
+
@@ -22,6 +22,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/PerfTrace.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/Treasure.h"
 #include "solarus/entities/Destination.h"
@@ -33,6 +34,8 @@
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/FrameDamage.h"
+#include "solarus/graphics/ImageCache.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/TransitionFade.h"
 #include "solarus/graphics/Video.h"
@@ -57,10 +60,13 @@ Game::Game(MainLoop& main_loop, const std::shared_ptr<Savegame>& savegame):
   started(false),
   restarting(false),
   commands_effects(),
+  has_sword_ability(false),
+  changed_keys(),
   current_map(nullptr),
   next_map(nullptr),
   previous_map_surface(nullptr),
   current_transition_style(Transition::Style::IMMEDIATE),
+  current_transition_effect(),
   transition(nullptr),
   crystal_state(false) {
 
@@ -71,6 +77,7 @@ Game::Game(MainLoop& main_loop, const std::shared_ptr<Savegame>& savegame):
   commands = std::unique_ptr<GameCommands>(new GameCommands(*this));
   hero = std::make_shared<Hero>(get_equipment());
   hero->start_free();
+  has_sword_ability = get_equipment().has_ability(Ability::SWORD);
   update_commands_effects();
 
   // Maybe we are restarting after a game-over sequence.
@@ -356,6 +363,8 @@ void Game::notify_command_released(GameCommand command) {
  */
 void Game::update() {
 
+  PerfTrace::Scope trace_scope("game-update");
+
   // Update the transitions between maps.
   update_transitions();
 
@@ -372,18 +381,49 @@ void Game::update() {
 
   // Update the equipment and HUD.
   get_equipment().update();
+  update_changed_values();
   update_commands_effects();
 }
 
 /**
- * \brief Updates all tilesets currently loaded.
+ * \brief Notifies the savegame values changed during this cycle.
+ *
+ * Each value is notified once to game:on_value_changed(), with its final
+ * value of the cycle, so that HUD scripts don't need to poll values.
+ */
+void Game::update_changed_values() {
+
+  get_savegame().take_changed_keys(changed_keys);
+  if (changed_keys.empty()) {
+    return;
+  }
+
+  if (changed_keys.find(Savegame::KEY_ABILITY_SWORD) != changed_keys.end()) {
+    has_sword_ability = get_equipment().has_ability(Ability::SWORD);
+  }
+
+  get_lua_context().game_on_values_changed(*this, changed_keys);
+}
+
+/**
+ * \brief Updates the tilesets of the current map and of the next one.
+ *
+ * Other loaded tilesets are not visible. Their animations depend on
+ * the global clock, so they don't need to be updated in the meantime.
  */
 void Game::update_tilesets() {
 
-  // Need to update at least all tilesets used by the current map.
-  const std::map<std::string, std::shared_ptr<Tileset>>& tilesets = get_resource_provider().get_loaded_tilesets();
-  for (const auto& kvp : tilesets) {
-    kvp.second->update();
+  Tileset* current_tileset = nullptr;
+  if (current_map != nullptr && current_map->is_loaded()) {
+    current_tileset = &get_resource_provider().get_tileset(current_map->get_tileset_id());
+    current_tileset->update();
+  }
+
+  if (next_map != nullptr && next_map->is_loaded()) {
+    Tileset& next_tileset = get_resource_provider().get_tileset(next_map->get_tileset_id());
+    if (&next_tileset != current_tileset) {
+      next_tileset.update();
+    }
   }
 }
 
@@ -404,6 +444,10 @@ void Game::update_transitions() {
     previous_world = current_map->get_world();
   }
 
+  if (transition != nullptr || next_map != nullptr) {
+    FrameDamage::notify();
+  }
+
   if (transition != nullptr) {
     transition->update();
   }
@@ -416,11 +460,7 @@ void Game::update_transitions() {
       next_map = nullptr;
     }
     else { // normal case: stop the control and play an out transition before leaving the current map
-      transition = std::unique_ptr<Transition>(Transition::create(
-          current_transition_style,
-          Transition::Direction::CLOSING,
-          this
-      ));
+      transition = std::unique_ptr<Transition>(create_transition(Transition::Direction::CLOSING));
       transition->start();
     }
   }
@@ -497,21 +537,24 @@ void Game::update_transitions() {
       // before closing the map, draw it on a backup surface for transition effects
       // that want to display both maps at the same time
       if (needs_previous_surface && current_map->get_camera() != nullptr) {
-        previous_map_surface = Surface::create(
-            current_map->get_camera()->get_size()
-        );
         current_map->draw();
-        current_map->get_camera_surface()->draw(previous_map_surface);
+        if (next_map == current_map) {
+          // The camera will keep drawing this map: copy its surface.
+          previous_map_surface = Surface::create(
+              current_map->get_camera()->get_size()
+          );
+          current_map->get_camera_surface()->draw(previous_map_surface);
+        }
+        else {
+          // The camera goes away with the map: keep its surface as is.
+          previous_map_surface = current_map->get_camera_surface();
+        }
       }
 
       if (next_map == current_map) {
         // same map
         hero->place_on_destination(*current_map, previous_map_location);
-        transition = std::unique_ptr<Transition>(Transition::create(
-            current_transition_style,
-            Transition::Direction::OPENING,
-            this
-        ));
+        transition = std::unique_ptr<Transition>(create_transition(Transition::Direction::OPENING));
         if (needs_previous_surface) {
           transition->set_previous_surface(previous_map_surface.get());
         }
@@ -521,12 +564,16 @@ void Game::update_transitions() {
       else {
         // change the map
         current_map->leave();
+        current_map->get_entities().save_non_animated_cells();
 
         // set the next map
         current_map->unload();
 
         current_map = next_map;
         next_map = nullptr;
+
+        // Images of the previous map may now be evicted.
+        ImageCache::trim();
       }
     }
     else {
@@ -538,11 +585,7 @@ void Game::update_transitions() {
   // if a map has just been set as the current map, start it and play the in transition
   if (started && !current_map->is_started()) {
     Debug::check_assertion(current_map->is_loaded(), "This map is not loaded");
-    transition = std::unique_ptr<Transition>(Transition::create(
-        current_transition_style,
-        Transition::Direction::OPENING,
-        this
-    ));
+    transition = std::unique_ptr<Transition>(create_transition(Transition::Direction::OPENING));
 
     if (previous_map_surface != nullptr) {
       // some transition effects need to display both maps simultaneously
@@ -574,12 +617,12 @@ void Game::update_commands_effects() {
   }
 
   // make sure the sword key is coherent with having a sword
-  if (get_equipment().has_ability(Ability::SWORD)
+  if (has_sword_ability
       && commands_effects.get_sword_key_effect() != CommandsEffects::ATTACK_KEY_SWORD) {
 
     commands_effects.set_sword_key_effect(CommandsEffects::ATTACK_KEY_SWORD);
   }
-  else if (!get_equipment().has_ability(Ability::SWORD)
+  else if (!has_sword_ability
       && commands_effects.get_sword_key_effect() == CommandsEffects::ATTACK_KEY_SWORD) {
 
     commands_effects.set_sword_key_effect(CommandsEffects::ATTACK_KEY_NONE);
@@ -656,11 +699,14 @@ Map& Game::get_current_map() {
  * "_side0", "_side1", "_side2" or "_side3"
  * to place the hero on a side of the map.
  * \param transition_style Type of transition between the two maps.
+ * \param transition_effect Name of a transition effect to use instead of
+ * the style, or an empty string.
  */
 void Game::set_current_map(
     const std::string& map_id,
     const std::string& destination_name,
-    Transition::Style transition_style) {
+    Transition::Style transition_style,
+    const std::string& transition_effect) {
 
   if (current_map != nullptr) {
     // stop the hero's movement
@@ -685,6 +731,27 @@ void Game::set_current_map(
 
   next_map->set_destination(destination_name);
   this->current_transition_style = transition_style;
+  this->current_transition_effect = transition_effect;
+}
+
+/**
+ * \brief Creates the transition to play between the current map and the next one.
+ *
+ * The transition effect is used if any and still registered,
+ * the transition style otherwise.
+ *
+ * \param direction Direction of the transition.
+ * \return The transition created.
+ */
+Transition* Game::create_transition(Transition::Direction direction) {
+
+  if (!current_transition_effect.empty()) {
+    Transition* transition = Transition::create(current_transition_effect, direction, this);
+    if (transition != nullptr) {
+      return transition;
+    }
+  }
+  return Transition::create(current_transition_style, direction, this);
 }
 
 /**
@@ -26,6 +26,47 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Number of keyboard key codes that are not derived from a scancode.
+ */
+constexpr int num_character_keys = 128;
+
+/**
+ * \brief Size of the keyboard mapping: character keys then scancode keys.
+ */
+constexpr int num_keyboard_key_indices = num_character_keys + SDL_NUM_SCANCODES;
+
+/**
+ * \brief Greatest joypad element index that can be bound to a command.
+ */
+constexpr int max_joypad_index = 1024;
+
+/**
+ * \brief Returns the index of a keyboard key in the keyboard mapping.
+ * \param key A keyboard key.
+ * \return The index, or -1 if this key cannot be mapped.
+ */
+int get_keyboard_key_index(InputEvent::KeyboardKey key) {
+
+  const int code = static_cast<int>(key);
+  if ((code & SDLK_SCANCODE_MASK) != 0) {
+    const int scancode = code & ~SDLK_SCANCODE_MASK;
+    if (scancode < SDL_NUM_SCANCODES) {
+      return num_character_keys + scancode;
+    }
+    return -1;
+  }
+
+  if (code <= 0 || code >= num_character_keys) {
+    return -1;
+  }
+  return code;
+}
+
+}
+
 /**
  * \brief Lua name of each value of the Command enum.
  */
@@ -81,10 +122,19 @@ const int GameCommands::masks_to_directions8[] = {
  */
 GameCommands::GameCommands(Game& game):
   game(game),
+  keyboard_mapping(num_keyboard_key_indices, GameCommand::NONE),
+  keyboard_bindings(),
+  joypad_button_mapping(),
+  joypad_axis_mapping(),
+  joypad_hat_mapping(),
+  joypad_bindings(),
+  commands_pressed(),
   customizing(false),
   command_to_customize(GameCommand::NONE),
   customize_callback_ref() {
 
+  keyboard_bindings.fill(InputEvent::KeyboardKey::NONE);
+
   // Load the commands from the savegame.
   for (const auto& kvp : command_names) {
 
@@ -95,11 +145,15 @@ GameCommands::GameCommands(Game& game):
 
     // Keyboard.
     InputEvent::KeyboardKey keyboard_key = get_saved_keyboard_binding(command);
-    keyboard_mapping[keyboard_key] = command;
+    if (keyboard_key != InputEvent::KeyboardKey::NONE) {
+      map_keyboard_key(keyboard_key, command);
+    }
 
     // Joypad.
     const std::string& joypad_string = get_saved_joypad_binding(command);
-    joypad_mapping[joypad_string] = command;
+    if (!joypad_string.empty()) {
+      map_joypad_string(joypad_string, command);
+    }
   }
 }
 
@@ -128,7 +182,10 @@ const Savegame& GameCommands::get_savegame() const {
  * \return true if this game command is currently pressed.
  */
 bool GameCommands::is_command_pressed(GameCommand command) const {
-  return commands_pressed.find(command) != commands_pressed.end();
+  if (command == GameCommand::NONE) {
+    return false;
+  }
+  return commands_pressed.test(static_cast<size_t>(command));
 }
 
 /**
@@ -208,7 +265,7 @@ void GameCommands::keyboard_key_pressed(InputEvent::KeyboardKey keyboard_key_pre
     if (command_pressed != command_to_customize) {
       // Consider this keyboard key as the new mapping for the game command being customized.
       set_keyboard_binding(command_to_customize, keyboard_key_pressed);
-      commands_pressed.insert(command_to_customize);
+      commands_pressed.set(static_cast<size_t>(command_to_customize));
     }
     do_customization_callback();
   }
@@ -236,10 +293,7 @@ void GameCommands::keyboard_key_released(InputEvent::KeyboardKey keyboard_key_re
 void GameCommands::joypad_button_pressed(int button) {
 
   // Retrieve the game command (if any) corresponding to this joypad button.
-  std::ostringstream oss;
-  oss << "button " << button;
-  const std::string& joypad_string = oss.str();
-  GameCommand command_pressed = get_command_from_joypad(joypad_string);
+  GameCommand command_pressed = get_command_from_joypad(JoypadElement::BUTTON, button);
 
   if (!customizing) {
     // If the joypad button is mapped, notify the game.
@@ -252,8 +306,9 @@ void GameCommands::joypad_button_pressed(int button) {
 
     if (command_pressed != command_to_customize) {
       // Consider this button as the new mapping for the game command being customized.
-      set_joypad_binding(command_to_customize, joypad_string);
-      commands_pressed.insert(command_to_customize);
+      set_joypad_binding(command_to_customize,
+          get_joypad_string(JoypadElement::BUTTON, button));
+      commands_pressed.set(static_cast<size_t>(command_to_customize));
     }
     do_customization_callback();
   }
@@ -266,10 +321,7 @@ void GameCommands::joypad_button_pressed(int button) {
 void GameCommands::joypad_button_released(int button) {
 
   // Retrieve the game command (if any) corresponding to this joypad button.
-  std::ostringstream oss;
-  oss << "button " << button;
-  const std::string& joypad_string = oss.str();
-  GameCommand command_released = get_command_from_joypad(joypad_string);
+  GameCommand command_released = get_command_from_joypad(JoypadElement::BUTTON, button);
 
   // If the key is mapped, notify the game.
   if (command_released != GameCommand::NONE) {
@@ -287,16 +339,12 @@ void GameCommands::joypad_axis_moved(int axis, int state) {
   if (state == 0) {
     // Axis in centered position.
 
-    std::ostringstream oss;
-    oss << "axis " << axis << " +";
-    GameCommand command_released = get_command_from_joypad(oss.str());
+    GameCommand command_released = get_command_from_joypad(JoypadElement::AXIS, 2 * axis);
     if (command_released != GameCommand::NONE) {
       game_command_released(command_released);
     }
 
-    oss.str("");
-    oss << "axis " << axis << " -";
-    command_released = get_command_from_joypad(oss.str());
+    command_released = get_command_from_joypad(JoypadElement::AXIS, 2 * axis + 1);
     if (command_released != GameCommand::NONE) {
       game_command_released(command_released);
     }
@@ -304,16 +352,11 @@ void GameCommands::joypad_axis_moved(int axis, int state) {
   else {
     // Axis not centered.
 
-    std::ostringstream oss;
-    oss << "axis " << axis << ((state > 0) ? " +" : " -");
-    const std::string& joypad_string = oss.str();
-
-    oss.str("");
-    oss << "axis " << axis << ((state > 0) ? " -" : " +");
-    const std::string& inverse_joypad_string = oss.str();
+    const int index = 2 * axis + ((state > 0) ? 0 : 1);
+    const int inverse_index = 2 * axis + ((state > 0) ? 1 : 0);
 
-    GameCommand command_pressed = get_command_from_joypad(joypad_string);
-    GameCommand inverse_command_pressed = get_command_from_joypad(inverse_joypad_string);
+    GameCommand command_pressed = get_command_from_joypad(JoypadElement::AXIS, index);
+    GameCommand inverse_command_pressed = get_command_from_joypad(JoypadElement::AXIS, inverse_index);
 
     if (!customizing) {
 
@@ -330,8 +373,9 @@ void GameCommands::joypad_axis_moved(int axis, int state) {
 
       if (command_pressed != command_to_customize) {
         // Consider this axis movement as the new mapping for the game command being customized.
-        set_joypad_binding(command_to_customize, joypad_string);
-        commands_pressed.insert(command_to_customize);
+        set_joypad_binding(command_to_customize,
+            get_joypad_string(JoypadElement::AXIS, index));
+        commands_pressed.set(static_cast<size_t>(command_to_customize));
       }
       do_customization_callback();
     }
@@ -350,9 +394,7 @@ void GameCommands::joypad_hat_moved(int hat, int value) {
 
     for (int i = 0; i < 4; i++) {
 
-      std::ostringstream oss;
-      oss << "hat " << hat << ' ' << direction_names[i];
-      GameCommand command_released = get_command_from_joypad(oss.str());
+      GameCommand command_released = get_command_from_joypad(JoypadElement::HAT, 4 * hat + i);
 
       if (command_released != GameCommand::NONE) {
         game_command_released(command_released);
@@ -402,40 +444,26 @@ void GameCommands::joypad_hat_moved(int hat, int value) {
       direction_2 = 0;
     }
 
-    std::ostringstream oss;
-    oss << "hat " << hat << ' ' << direction_names[direction_1];
-    const std::string& joypad_string_1 = oss.str();
-    GameCommand command_1 = get_command_from_joypad(joypad_string_1);
-
-    oss.str("");
-    oss << "hat " << hat << ' ' << direction_names[(direction_1 + 2) % 4];
-    const std::string& inverse_joypad_string_1 = oss.str();
-    GameCommand inverse_command_1 = get_command_from_joypad(inverse_joypad_string_1);
+    const int index_1 = 4 * hat + direction_1;
+    GameCommand command_1 = get_command_from_joypad(
+        JoypadElement::HAT, index_1);
+    GameCommand inverse_command_1 = get_command_from_joypad(
+        JoypadElement::HAT, 4 * hat + (direction_1 + 2) % 4);
 
     GameCommand command_2 = GameCommand::NONE;
     GameCommand inverse_command_2 = GameCommand::NONE;
 
     if (direction_2 != -1) {
-      oss.str("");
-      oss << "hat " << hat << ' ' << direction_names[direction_2];
-      const std::string& joypad_string_2 = oss.str();
-      command_2 = get_command_from_joypad(joypad_string_2);
-
-      oss.str("");
-      oss << "hat " << hat << ' ' << direction_names[(direction_2 + 2) % 4];
-      const std::string& inverse_joypad_string_2 = oss.str();
-      inverse_command_2 = get_command_from_joypad(inverse_joypad_string_2);
+      command_2 = get_command_from_joypad(
+          JoypadElement::HAT, 4 * hat + direction_2);
+      inverse_command_2 = get_command_from_joypad(
+          JoypadElement::HAT, 4 * hat + (direction_2 + 2) % 4);
     }
     else {
-      std::ostringstream oss;
-      oss << "hat " << hat << ' ' << direction_names[(direction_1 + 1) % 4];
-      const std::string& joypad_string_2 = oss.str();
-      command_2 = get_command_from_joypad(joypad_string_2);
-
-      oss.str("");
-      oss << "hat " << hat << ' ' << direction_names[(direction_1 + 3) % 4];
-      const std::string& inverse_joypad_string_2 = oss.str();
-      inverse_command_2 = get_command_from_joypad(inverse_joypad_string_2);
+      command_2 = get_command_from_joypad(
+          JoypadElement::HAT, 4 * hat + (direction_1 + 1) % 4);
+      inverse_command_2 = get_command_from_joypad(
+          JoypadElement::HAT, 4 * hat + (direction_1 + 3) % 4);
     }
 
     if (!customizing) {
@@ -469,8 +497,9 @@ void GameCommands::joypad_hat_moved(int hat, int value) {
 
       if (command_1 != command_to_customize) {
         // Consider this hat movement as the new mapping for the game command being customized.
-        set_joypad_binding(command_to_customize, joypad_string_1);
-        commands_pressed.insert(command_to_customize);
+        set_joypad_binding(command_to_customize,
+            get_joypad_string(JoypadElement::HAT, index_1));
+        commands_pressed.set(static_cast<size_t>(command_to_customize));
       }
       do_customization_callback();
     }
@@ -486,7 +515,9 @@ void GameCommands::joypad_hat_moved(int hat, int value) {
  */
 void GameCommands::game_command_pressed(GameCommand command) {
 
-  commands_pressed.insert(command);
+  if (command != GameCommand::NONE) {
+    commands_pressed.set(static_cast<size_t>(command));
+  }
   game.notify_command_pressed(command);
 }
 
@@ -499,7 +530,9 @@ void GameCommands::game_command_pressed(GameCommand command) {
  */
 void GameCommands::game_command_released(GameCommand command) {
 
-  commands_pressed.erase(command);
+  if (command != GameCommand::NONE) {
+    commands_pressed.reset(static_cast<size_t>(command));
+  }
   game.notify_command_released(command);
 }
 
@@ -512,14 +545,10 @@ void GameCommands::game_command_released(GameCommand command) {
  */
 InputEvent::KeyboardKey GameCommands::get_keyboard_binding(GameCommand command) const {
 
-  for (const auto& kvp: keyboard_mapping) {
-
-    if (kvp.second == command) {
-      return kvp.first;
-    }
+  if (command == GameCommand::NONE) {
+    return InputEvent::KeyboardKey::NONE;
   }
-
-  return InputEvent::KeyboardKey::NONE;
+  return keyboard_bindings[static_cast<size_t>(command)];
 }
 
 /**
@@ -541,16 +570,16 @@ void GameCommands::set_keyboard_binding(GameCommand command, InputEvent::Keyboar
     // The command was already assigned.
     if (previous_command != GameCommand::NONE) {
       // This key is already mapped to a command.
-      keyboard_mapping[previous_key] = previous_command;
+      map_keyboard_key(previous_key, previous_command);
       set_saved_keyboard_binding(previous_command, previous_key);
     }
     else {
-      keyboard_mapping.erase(previous_key);
+      map_keyboard_key(previous_key, GameCommand::NONE);
     }
   }
 
   if (key != InputEvent::KeyboardKey::NONE) {
-      keyboard_mapping[key] = command;
+    map_keyboard_key(key, command);
   }
   set_saved_keyboard_binding(command, key);
 }
@@ -564,15 +593,11 @@ void GameCommands::set_keyboard_binding(GameCommand command, InputEvent::Keyboar
  */
 const std::string& GameCommands::get_joypad_binding(GameCommand command) const {
 
-  for (const auto& kvp: joypad_mapping) {
-
-    if (kvp.second == command) {
-      return kvp.first;
-    }
+  if (command == GameCommand::NONE) {
+    static const std::string empty_string;
+    return empty_string;
   }
-
-  static const std::string empty_string;
-  return empty_string;
+  return joypad_bindings[static_cast<size_t>(command)];
 }
 
 /**
@@ -587,23 +612,23 @@ const std::string& GameCommands::get_joypad_binding(GameCommand command) const {
  */
 void GameCommands::set_joypad_binding(GameCommand command, const std::string& joypad_string) {
 
-  const std::string& previous_joypad_string = get_joypad_binding(command);
+  const std::string previous_joypad_string = get_joypad_binding(command);
   GameCommand previous_command = get_command_from_joypad(joypad_string);
 
   if (!previous_joypad_string.empty()) {
     // The command was already assigned.
     if (previous_command != GameCommand::NONE) {
       // This joypad action is already mapped to a command.
-      joypad_mapping[previous_joypad_string] = previous_command;
+      map_joypad_string(previous_joypad_string, previous_command);
       set_saved_joypad_binding(previous_command, previous_joypad_string);
     }
     else {
-      joypad_mapping.erase(previous_joypad_string);
+      map_joypad_string(previous_joypad_string, GameCommand::NONE);
     }
   }
 
   if (!joypad_string.empty()) {
-    joypad_mapping[joypad_string] = command;
+    map_joypad_string(joypad_string, command);
   }
   set_saved_joypad_binding(command, joypad_string);
 }
@@ -698,12 +723,38 @@ void GameCommands::set_saved_keyboard_binding(
 GameCommand GameCommands::get_command_from_keyboard(
     InputEvent::KeyboardKey key) const {
 
-  const auto& it = keyboard_mapping.find(key);
-  if (it != keyboard_mapping.end()) {
-    return it->second;
+  const int index = get_keyboard_key_index(key);
+  if (index == -1) {
+    return GameCommand::NONE;
   }
+  return keyboard_mapping[index];
+}
 
-  return GameCommand::NONE;
+/**
+ * \brief Maps a keyboard key to a game command.
+ *
+ * The command that was previously mapped to this key, if any, loses its
+ * keyboard binding.
+ *
+ * \param key A keyboard key other than InputEvent::KeyboardKey::NONE.
+ * \param command The game command to map to this key,
+ * or GameCommand::NONE to unmap the key.
+ */
+void GameCommands::map_keyboard_key(InputEvent::KeyboardKey key, GameCommand command) {
+
+  for (InputEvent::KeyboardKey& binding : keyboard_bindings) {
+    if (binding == key) {
+      binding = InputEvent::KeyboardKey::NONE;
+    }
+  }
+  if (command != GameCommand::NONE) {
+    keyboard_bindings[static_cast<size_t>(command)] = key;
+  }
+
+  const int index = get_keyboard_key_index(key);
+  if (index != -1) {
+    keyboard_mapping[index] = command;
+  }
 }
 
 /**
@@ -741,14 +792,183 @@ void GameCommands::set_saved_joypad_binding(
 GameCommand GameCommands::get_command_from_joypad(
     const std::string& joypad_string) const {
 
-  const auto& it = joypad_mapping.find(joypad_string);
-  if (it != joypad_mapping.end()) {
-    return it->second;
+  if (joypad_string.empty()) {
+    return GameCommand::NONE;
+  }
+
+  for (size_t i = 0; i < num_commands; ++i) {
+    if (joypad_bindings[i] == joypad_string) {
+      return static_cast<GameCommand>(i);
+    }
   }
 
   return GameCommand::NONE;
 }
 
+/**
+ * \brief Returns the game command (if any) associated to a joypad element.
+ * \param element Kind of joypad element.
+ * \param index Index of the element in the corresponding mapping.
+ * \return The game command mapped to that joypad element or GameCommand::NONE.
+ */
+GameCommand GameCommands::get_command_from_joypad(
+    JoypadElement element, int index) const {
+
+  const std::vector<GameCommand>& mapping = get_joypad_mapping(element);
+  if (index < 0 || index >= static_cast<int>(mapping.size())) {
+    return GameCommand::NONE;
+  }
+  return mapping[index];
+}
+
+/**
+ * \brief Maps a joypad action to a game command.
+ *
+ * The command that was previously mapped to this joypad action, if any,
+ * loses its joypad binding.
+ *
+ * \param joypad_string A non-empty joypad action.
+ * \param command The game command to map to this joypad action,
+ * or GameCommand::NONE to unmap the joypad action.
+ */
+void GameCommands::map_joypad_string(
+    const std::string& joypad_string, GameCommand command) {
+
+  for (std::string& binding : joypad_bindings) {
+    if (binding == joypad_string) {
+      binding.clear();
+    }
+  }
+  if (command != GameCommand::NONE) {
+    joypad_bindings[static_cast<size_t>(command)] = joypad_string;
+  }
+
+  JoypadElement element = JoypadElement::BUTTON;
+  int index = 0;
+  if (!parse_joypad_string(joypad_string, element, index)) {
+    // Keep the binding even if no joypad event can trigger it.
+    return;
+  }
+
+  std::vector<GameCommand>& mapping = get_joypad_mapping(element);
+  if (index >= static_cast<int>(mapping.size())) {
+    mapping.resize(index + 1, GameCommand::NONE);
+  }
+  mapping[index] = command;
+}
+
+/**
+ * \brief Returns the mapping of a kind of joypad element.
+ * \param element Kind of joypad element.
+ * \return The game command of each element of this kind.
+ */
+std::vector<GameCommand>& GameCommands::get_joypad_mapping(JoypadElement element) {
+
+  switch (element) {
+
+  case JoypadElement::BUTTON:
+    return joypad_button_mapping;
+
+  case JoypadElement::AXIS:
+    return joypad_axis_mapping;
+
+  case JoypadElement::HAT:
+    return joypad_hat_mapping;
+  }
+
+  return joypad_button_mapping;
+}
+
+/**
+ * \brief Returns the mapping of a kind of joypad element.
+ * \param element Kind of joypad element.
+ * \return The game command of each element of this kind.
+ */
+const std::vector<GameCommand>& GameCommands::get_joypad_mapping(JoypadElement element) const {
+
+  return const_cast<GameCommands*>(this)->get_joypad_mapping(element);
+}
+
+/**
+ * \brief Determines the joypad element described by a joypad action string.
+ *
+ * Only strings in the canonical form produced by get_joypad_string()
+ * are recognized.
+ *
+ * \param[in] joypad_string A joypad action.
+ * \param[out] element Kind of joypad element.
+ * \param[out] index Index of the element in the corresponding mapping.
+ * \return false if the string does not describe a joypad element.
+ */
+bool GameCommands::parse_joypad_string(
+    const std::string& joypad_string, JoypadElement& element, int& index) {
+
+  std::istringstream iss(joypad_string);
+  std::string type;
+  int number = -1;
+  if (!(iss >> type >> number) || number < 0 || number >= max_joypad_index) {
+    return false;
+  }
+
+  if (type == "button") {
+    element = JoypadElement::BUTTON;
+    index = number;
+  }
+  else if (type == "axis") {
+    std::string sign;
+    iss >> sign;
+    element = JoypadElement::AXIS;
+    index = 2 * number + ((sign == "-") ? 1 : 0);
+  }
+  else if (type == "hat") {
+    std::string direction_name;
+    iss >> direction_name;
+    int direction = 0;
+    while (direction < 4 && direction_names[direction] != direction_name) {
+      ++direction;
+    }
+    element = JoypadElement::HAT;
+    index = 4 * number + direction;
+    if (direction == 4) {
+      return false;
+    }
+  }
+  else {
+    return false;
+  }
+
+  return get_joypad_string(element, index) == joypad_string;
+}
+
+/**
+ * \brief Returns the joypad action string of a joypad element.
+ *
+ * This is the form in which joypad bindings are saved.
+ *
+ * \param element Kind of joypad element.
+ * \param index Index of the element in the corresponding mapping.
+ * \return The joypad action.
+ */
+std::string GameCommands::get_joypad_string(JoypadElement element, int index) {
+
+  std::ostringstream oss;
+  switch (element) {
+
+  case JoypadElement::BUTTON:
+    oss << "button " << index;
+    break;
+
+  case JoypadElement::AXIS:
+    oss << "axis " << index / 2 << ((index % 2 == 0) ? " +" : " -");
+    break;
+
+  case JoypadElement::HAT:
+    oss << "hat " << index / 4 << ' ' << direction_names[index % 4];
+    break;
+  }
+  return oss.str();
+}
+
 // customization
 
 /**
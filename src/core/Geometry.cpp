@@ -56,6 +56,15 @@ double get_angle(double x1, double y1, double x2, double y2) {
     return PI_OVER_2;
   }
 
+  // Vectors along an axis are common on a tile grid: skip atan2 and return
+  // exactly what it gives in this case, including the sign of zero.
+  if (dy == 0.0) {
+    return dx > 0.0 ? -0.0 : -PI + TWO_PI;
+  }
+  if (dx == 0.0) {
+    return dy < 0.0 ? PI_OVER_2 : -PI_OVER_2 + TWO_PI;
+  }
+
   double angle = std::atan2(-dy, dx);
 
   // Normalize.
@@ -84,6 +93,20 @@ double get_angle(const Point& point1, const Point& point2) {
  */
 Point get_xy(double angle, int distance) {
 
+  // Along an axis, the tiny error of cos or sin is truncated away anyway.
+  if (angle == 0.0) {
+    return { distance, 0 };
+  }
+  if (angle == PI_OVER_2) {
+    return { 0, -distance };
+  }
+  if (angle == PI) {
+    return { -distance, 0 };
+  }
+  if (angle == THREE_PI_OVER_2) {
+    return { 0, distance };
+  }
+
   return {
       static_cast<int>(distance * std::cos(angle)),
       static_cast<int>(-distance * std::sin(angle))
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/AsyncFileWriter.h"
+#include "solarus/core/HitchDetector.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/ResourceProvider.h"
+#include "solarus/core/System.h"
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+namespace Solarus {
+
+namespace {
+
+const std::string log_file_name = "hitches.log";  /**< File of the last reports. */
+
+/**
+ * \brief Writes a duration in milliseconds.
+ * \param out The stream to write to.
+ * \param time The duration in microseconds.
+ */
+void write_time(std::ostream& out, uint64_t time) {
+  out << std::fixed << std::setprecision(1) << time / 1000.0 << " ms";
+}
+
+}
+
+bool HitchDetector::enabled = true;
+int HitchDetector::threshold = HitchDetector::default_threshold;
+int HitchDetector::log_size = HitchDetector::default_log_size;
+uint64_t HitchDetector::frame_start = 0;
+uint64_t HitchDetector::phase_times[static_cast<size_t>(Phase::NUM_PHASES)] = {};
+std::vector<uint64_t> HitchDetector::step_times;
+uint64_t HitchDetector::slowest_lua_call_time = 0;
+std::string HitchDetector::slowest_lua_call;
+bool HitchDetector::log_loaded = false;
+std::deque<std::string> HitchDetector::hitches;
+constexpr size_t HitchDetector::max_steps;
+
+/**
+ * \brief Returns the duration from which a frame is reported.
+ * \return The threshold in milliseconds, or 0 if the detector is disabled.
+ */
+int HitchDetector::get_threshold() {
+  return threshold;
+}
+
+/**
+ * \brief Sets the duration from which a frame is reported.
+ * \param threshold The threshold in milliseconds, or 0 to disable the detector.
+ */
+void HitchDetector::set_threshold(int threshold) {
+
+  HitchDetector::threshold = std::max(0, threshold);
+  enabled = HitchDetector::threshold > 0;
+  frame_start = 0;
+}
+
+/**
+ * \brief Returns the number of reports kept in the log file.
+ * \return The number of reports.
+ */
+int HitchDetector::get_log_size() {
+  return log_size;
+}
+
+/**
+ * \brief Sets the number of reports kept in the log file.
+ * \param log_size The number of reports, or 0 to keep none.
+ */
+void HitchDetector::set_log_size(int log_size) {
+  HitchDetector::log_size = std::max(0, log_size);
+}
+
+/**
+ * \brief Starts measuring an iteration of the main loop.
+ */
+void HitchDetector::start_frame() {
+
+  if (!enabled) {
+    return;
+  }
+  frame_start = System::get_real_time_us();
+  std::fill(std::begin(phase_times), std::end(phase_times), 0);
+  step_times.clear();
+  slowest_lua_call_time = 0;
+  slowest_lua_call.clear();
+}
+
+/**
+ * \brief Finishes measuring an iteration of the main loop and starts
+ * the next one.
+ *
+ * Reports the iteration if it took more than the threshold.
+ *
+ * \param resource_provider The resource provider, to report the resources
+ * being preloaded, or nullptr.
+ */
+void HitchDetector::finish_frame(ResourceProvider* resource_provider) {
+
+  if (!enabled) {
+    return;
+  }
+
+  if (frame_start != 0) {
+    const uint64_t frame_time = System::get_real_time_us() - frame_start;
+    if (frame_time >= static_cast<uint64_t>(threshold) * 1000) {
+      const std::string& report = get_report(frame_time, resource_provider);
+      Logger::warning(report);
+
+      if (log_size > 0) {
+        load_log();
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+        hitches.push_back(std::string(date) + " " + report);
+        while (hitches.size() > static_cast<size_t>(log_size)) {
+          hitches.pop_front();
+        }
+        save_log();
+      }
+    }
+  }
+  start_frame();
+}
+
+/**
+ * \brief Adds time to a phase of the current frame.
+ * \param phase The phase.
+ * \param time The time in microseconds.
+ */
+void HitchDetector::add_time(Phase phase, uint64_t time) {
+
+  phase_times[static_cast<size_t>(phase)] += time;
+  if (phase == Phase::STEP && step_times.size() < max_steps) {
+    step_times.push_back(time);
+  }
+}
+
+/**
+ * \brief Sets the slowest Lua call of the current frame.
+ * \param time Duration of the call in microseconds.
+ * \param event_name Name of the engine event that called Lua.
+ * \param location File and line of the Lua function called.
+ */
+void HitchDetector::set_slowest_lua_call(
+    uint64_t time, const char* event_name, const std::string& location) {
+
+  slowest_lua_call_time = time;
+  slowest_lua_call = std::string(event_name) + " (" + location + ")";
+}
+
+/**
+ * \brief Returns the last reports, including the ones of previous runs
+ * kept in the log file.
+ * \return The reports, from the oldest to the most recent one.
+ */
+std::vector<std::string> HitchDetector::get_last_hitches() {
+
+  load_log();
+  return std::vector<std::string>(hitches.begin(), hitches.end());
+}
+
+/**
+ * \brief Describes where the time of the current frame went.
+ * \param frame_time Duration of the frame in microseconds.
+ * \param resource_provider The resource provider, or nullptr.
+ * \return The report, on one line.
+ */
+std::string HitchDetector::get_report(uint64_t frame_time, ResourceProvider* resource_provider) {
+
+  const auto get_time = [](Phase phase) {
+    return phase_times[static_cast<size_t>(phase)];
+  };
+
+  std::ostringstream oss;
+  oss << "Hitch: frame of ";
+  write_time(oss, frame_time);
+  oss << ": input ";
+  write_time(oss, get_time(Phase::INPUT));
+  oss << ", " << step_times.size() << " steps ";
+  write_time(oss, get_time(Phase::STEP));
+  if (!step_times.empty()) {
+    oss << " (";
+    for (size_t i = 0; i < step_times.size(); ++i) {
+      oss << (i == 0 ? "" : ", ");
+      write_time(oss, step_times[i]);
+    }
+    oss << ")";
+  }
+  oss << ", draw ";
+  write_time(oss, get_time(Phase::DRAW));
+  oss << ", present ";
+  write_time(oss, get_time(Phase::PRESENT));
+
+  const uint64_t measured = get_time(Phase::INPUT) + get_time(Phase::STEP) +
+      get_time(Phase::DRAW) + get_time(Phase::PRESENT);
+  oss << ", other ";
+  write_time(oss, frame_time > measured ? frame_time - measured : 0);
+  oss << "; including Lua events ";
+  write_time(oss, get_time(Phase::LUA));
+  oss << ", map load ";
+  write_time(oss, get_time(Phase::MAP_LOAD));
+
+  if (!slowest_lua_call.empty()) {
+    oss << "; slowest Lua callback " << slowest_lua_call << " ";
+    write_time(oss, slowest_lua_call_time);
+  }
+
+  if (resource_provider != nullptr) {
+    const std::vector<std::string>& preloads = resource_provider->get_active_preloads();
+    if (!preloads.empty()) {
+      oss << "; preloading ";
+      for (size_t i = 0; i < preloads.size(); ++i) {
+        oss << (i == 0 ? "" : ", ") << preloads[i];
+      }
+    }
+  }
+  return oss.str();
+}
+
+/**
+ * \brief Reads the reports of previous runs from the log file, once.
+ */
+void HitchDetector::load_log() {
+
+  if (log_loaded || QuestFiles::get_quest_write_dir().empty()) {
+    return;
+  }
+  log_loaded = true;
+
+  if (!QuestFiles::data_file_exists(log_file_name)) {
+    return;
+  }
+  std::istringstream iss(QuestFiles::data_file_read(log_file_name));
+  std::deque<std::string> previous_hitches;
+  std::string line;
+  while (std::getline(iss, line)) {
+    if (!line.empty()) {
+      previous_hitches.push_back(line);
+    }
+  }
+  hitches.insert(hitches.begin(), previous_hitches.begin(), previous_hitches.end());
+  while (hitches.size() > static_cast<size_t>(log_size)) {
+    hitches.pop_front();
+  }
+}
+
+/**
+ * \brief Writes the last reports to the log file in background.
+ */
+void HitchDetector::save_log() {
+
+  if (QuestFiles::get_quest_write_dir().empty()) {
+    return;
+  }
+  std::string content;
+  for (const std::string& hitch : hitches) {
+    content += hitch + "\n";
+  }
+  AsyncFileWriter::write(log_file_name, content, nullptr);
+}
+
+}
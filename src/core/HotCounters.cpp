@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/HotCounters.h"
+
+namespace Solarus {
+namespace HotCounters {
+
+namespace {
+
+std::atomic<ThreadCounters*> all_threads(nullptr);  /**< Accumulators of all threads. */
+Snapshot last_totals = {};                          /**< Totals at the last snapshot. */
+
+const char* const counter_names[num_counters] = {
+  "quadtree-queries",
+  "obstacle-tests",
+  "detector-checks",
+  "lua-calls",
+};
+
+}
+
+/**
+ * \brief Creates the accumulators of the current thread.
+ *
+ * Accumulators are never freed: their totals still count after their
+ * thread finishes, and the engine only starts a few threads.
+ *
+ * \return The accumulators of the thread.
+ */
+ThreadCounters& register_thread() {
+
+  ThreadCounters* thread_counters = new ThreadCounters();
+  for (std::atomic<uint32_t>& count : thread_counters->counts) {
+    count.store(0, std::memory_order_relaxed);
+  }
+
+  // Push it to the list without locking.
+  ThreadCounters* head = all_threads.load(std::memory_order_relaxed);
+  do {
+    thread_counters->next = head;
+  } while (!all_threads.compare_exchange_weak(
+      head, thread_counters, std::memory_order_release, std::memory_order_relaxed));
+  return *thread_counters;
+}
+
+/**
+ * \brief Returns the counts since the previous snapshot.
+ *
+ * Must be called from the main thread.
+ *
+ * \return The count of each counter, summed over all threads.
+ */
+Snapshot take_snapshot() {
+
+  Snapshot totals = {};
+  for (const ThreadCounters* thread_counters = all_threads.load(std::memory_order_acquire);
+      thread_counters != nullptr;
+      thread_counters = thread_counters->next) {
+    for (size_t i = 0; i < num_counters; ++i) {
+      totals[i] += thread_counters->counts[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  Snapshot counts;
+  for (size_t i = 0; i < num_counters; ++i) {
+    counts[i] = totals[i] - last_totals[i];
+  }
+  last_totals = totals;
+  return counts;
+}
+
+/**
+ * \brief Returns the name of a counter, as shown in traces.
+ * \param counter A counter.
+ * \return Its name.
+ */
+const char* get_counter_name(Counter counter) {
+  return counter_names[static_cast<size_t>(counter)];
+}
+
+}
+}
+
@@ -19,6 +19,7 @@
 #include "solarus/core/InputEvent.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/Rectangle.h"
+#include "solarus/core/System.h"
 #include "solarus/graphics/Video.h"
 #include <SDL.h>
 #include <cstdlib>  // std::abs
@@ -343,6 +344,19 @@ std::unique_ptr<InputEvent> InputEvent::get_event() {
   return std::unique_ptr<InputEvent>(result);
 }
 
+/**
+ * \brief Creates an input event from a low-level event.
+ *
+ * Unlike get_event(), this does not update the state of the input manager:
+ * it is used to replay recorded events.
+ *
+ * \param internal_event The low-level event.
+ * \return The corresponding input event.
+ */
+std::unique_ptr<InputEvent> InputEvent::make_event(const SDL_Event& internal_event) {
+  return std::unique_ptr<InputEvent>(new InputEvent(internal_event));
+}
+
 // global information
 
 /**
@@ -674,6 +688,29 @@ bool InputEvent::is_window_event() const {
   return internal_event.type == SDL_QUIT; // other SDL window events are ignored
 }
 
+/**
+ * \brief Returns the low-level event encapsulated.
+ * \return The SDL event.
+ */
+const SDL_Event& InputEvent::get_internal_event() const {
+  return internal_event;
+}
+
+/**
+ * \brief Returns when this event happened.
+ *
+ * The date comes from the system event queue, so it does not depend on
+ * when the main loop got the event.
+ *
+ * \return The real time of the event in milliseconds,
+ * comparable to System::get_real_time().
+ */
+uint32_t InputEvent::get_timestamp() const {
+
+  const uint32_t age = SDL_GetTicks() - internal_event.common.timestamp;
+  return System::get_real_time() - age;
+}
+
 // keyboard
 
 /**
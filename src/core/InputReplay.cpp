@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/InputEvent.h"
+#include "solarus/core/InputReplay.h"
+#include "solarus/core/Logger.h"
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace Solarus {
+
+namespace {
+
+const std::string header = "solarus-replay 1";
+
+/**
+ * \brief Encodes the bytes of a low-level event as hexadecimal.
+ * \param event The event to encode.
+ * \return The hexadecimal string.
+ */
+std::string encode_event(const SDL_Event& event) {
+
+  std::ostringstream oss;
+  oss << std::hex << std::setfill('0');
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&event);
+  for (size_t i = 0; i < sizeof(SDL_Event); ++i) {
+    oss << std::setw(2) << static_cast<int>(bytes[i]);
+  }
+  return oss.str();
+}
+
+/**
+ * \brief Decodes a low-level event encoded by encode_event().
+ * \param hex The hexadecimal string.
+ * \param event The decoded event.
+ * \return \c false if the string is invalid.
+ */
+bool decode_event(const std::string& hex, SDL_Event& event) {
+
+  if (hex.size() != 2 * sizeof(SDL_Event)) {
+    return false;
+  }
+  unsigned char* bytes = reinterpret_cast<unsigned char*>(&event);
+  for (size_t i = 0; i < sizeof(SDL_Event); ++i) {
+    unsigned int byte = 0;
+    std::istringstream iss(hex.substr(2 * i, 2));
+    if (!(iss >> std::hex >> byte)) {
+      return false;
+    }
+    bytes[i] = static_cast<unsigned char>(byte);
+  }
+  return true;
+}
+
+}
+
+/**
+ * \brief Creates an input replay that neither records nor replays.
+ */
+InputReplay::InputReplay():
+  recording(false),
+  replaying(false),
+  hashing(false),
+  seed(0),
+  diverged(false) {
+
+}
+
+/**
+ * \brief Starts recording input events to a file.
+ * \param file_name The file to write.
+ * \param seed Seed of the random number generator to store.
+ * \param record_hashes Whether to also store a state hash after each tick.
+ * \return \c false if the file could not be opened.
+ */
+bool InputReplay::start_recording(
+    const std::string& file_name, uint32_t seed, bool record_hashes) {
+
+  stop();
+  output.open(file_name);
+  if (!output) {
+    Logger::error("Cannot open input record file '" + file_name + "'");
+    return false;
+  }
+
+  this->seed = seed;
+  recording = true;
+  hashing = record_hashes;
+  output << header << '\n' << "seed " << seed << '\n';
+  Logger::info("Recording input to '" + file_name + "'");
+  return true;
+}
+
+/**
+ * \brief Starts replaying input events from a file.
+ *
+ * The whole file is loaded now.
+ * State hashes are compared if the file has some.
+ *
+ * \param file_name The file to read.
+ * \return \c false if the file could not be read.
+ */
+bool InputReplay::start_replaying(const std::string& file_name) {
+
+  stop();
+  std::ifstream input(file_name);
+  std::string line;
+  if (!input || !std::getline(input, line) || line != header) {
+    Logger::error("Invalid input replay file '" + file_name + "'");
+    return false;
+  }
+
+  while (std::getline(input, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream iss(line);
+    std::string type;
+    iss >> type;
+    bool valid = false;
+    if (type == "seed") {
+      valid = static_cast<bool>(iss >> seed);
+    }
+    else if (type == "e") {
+      uint32_t tick = 0;
+      std::string hex;
+      SDL_Event event;
+      valid = iss >> tick >> hex && decode_event(hex, event);
+      if (valid) {
+        events.emplace_back(tick, event);
+      }
+    }
+    else if (type == "h") {
+      uint32_t tick = 0;
+      uint64_t hash = 0;
+      valid = static_cast<bool>(iss >> tick >> std::hex >> hash);
+      if (valid) {
+        hashes.emplace_back(tick, hash);
+      }
+    }
+    if (!valid) {
+      Logger::error("Invalid line in input replay file '" + file_name + "': '" + line + "'");
+      events.clear();
+      hashes.clear();
+      return false;
+    }
+  }
+
+  replaying = true;
+  hashing = !hashes.empty();
+  Logger::info("Replaying input from '" + file_name + "' (" +
+      std::to_string(events.size()) + " events)");
+  return true;
+}
+
+/**
+ * \brief Stops recording or replaying.
+ */
+void InputReplay::stop() {
+
+  if (output.is_open()) {
+    output.close();
+  }
+  recording = false;
+  replaying = false;
+  hashing = false;
+  events.clear();
+  hashes.clear();
+  diverged = false;
+}
+
+/**
+ * \brief Returns whether input events are being recorded.
+ * \return \c true if recording.
+ */
+bool InputReplay::is_recording() const {
+  return recording;
+}
+
+/**
+ * \brief Returns whether input events are being replayed.
+ * \return \c true if replaying.
+ */
+bool InputReplay::is_replaying() const {
+  return replaying;
+}
+
+/**
+ * \brief Returns whether state hashes are recorded or compared.
+ * \return \c true if hashes are used.
+ */
+bool InputReplay::is_hashing() const {
+  return hashing;
+}
+
+/**
+ * \brief Returns the seed of the random number generator of the recording.
+ * \return The seed.
+ */
+uint32_t InputReplay::get_seed() const {
+  return seed;
+}
+
+/**
+ * \brief Returns whether an input event affects the simulation.
+ *
+ * Window and quit events are not recorded: they are always handled live.
+ *
+ * \param event An input event.
+ * \return \c true if the event should be recorded and replayed.
+ */
+bool InputReplay::is_recordable(const InputEvent& event) {
+
+  return event.is_keyboard_event() ||
+      event.is_joypad_event() ||
+      event.is_mouse_event() ||
+      event.is_finger_event();
+}
+
+/**
+ * \brief Records an input event received during a tick.
+ * \param tick Simulated time of the tick in milliseconds.
+ * \param event The input event.
+ */
+void InputReplay::record_event(uint32_t tick, const InputEvent& event) {
+
+  if (!recording) {
+    return;
+  }
+  output << "e " << tick << ' ' << encode_event(event.get_internal_event()) << '\n';
+}
+
+/**
+ * \brief Gets the next replayed event of a tick.
+ *
+ * Call this repeatedly until it returns \c false.
+ *
+ * \param tick Simulated time of the current tick in milliseconds.
+ * \param event The event to replay.
+ * \return \c false if there are no more events for this tick.
+ */
+bool InputReplay::pop_event(uint32_t tick, SDL_Event& event) {
+
+  if (!replaying || events.empty() || events.front().first > tick) {
+    return false;
+  }
+  event = events.front().second;
+  events.pop_front();
+  return true;
+}
+
+/**
+ * \brief Records or compares the state hash of a tick.
+ *
+ * When replaying, the first mismatch is logged as a divergence.
+ *
+ * \param tick Simulated time of the tick in milliseconds.
+ * \param hash Hash of the game state after the tick.
+ */
+void InputReplay::check_hash(uint32_t tick, uint64_t hash) {
+
+  if (!hashing) {
+    return;
+  }
+
+  if (recording) {
+    output << "h " << tick << ' ' << std::hex << hash << std::dec << '\n';
+    return;
+  }
+
+  while (!hashes.empty() && hashes.front().first < tick) {
+    hashes.pop_front();
+  }
+  if (hashes.empty() || hashes.front().first != tick) {
+    return;
+  }
+  if (hashes.front().second != hash && !diverged) {
+    diverged = true;
+    Logger::warning("Replay diverged at tick " + std::to_string(tick));
+  }
+  hashes.pop_front();
+}
+
+/**
+ * \brief Returns whether a replayed state hash did not match.
+ * \return \c true if the replay diverged.
+ */
+bool InputReplay::has_diverged() const {
+  return diverged;
+}
+
+}
+
@@ -0,0 +1,608 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Arguments.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/JobSystem.h"
+#include "solarus/core/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace Solarus {
+
+constexpr int JobSystem::num_io_threads;
+
+/**
+ * \brief A function to run with its dependencies.
+ */
+struct JobSystem::Job {
+  Priority priority;                /**< How urgent the job is. */
+  bool main_thread;                 /**< Whether it runs on the main thread. */
+  Function function;                /**< What the job does. */
+  int num_pending_dependencies;     /**< Jobs to wait for before starting. */
+  std::vector<JobPtr> dependents;   /**< Jobs waiting for this one. */
+  bool done;                        /**< Whether the function has returned. */
+};
+
+namespace {
+
+using Job = JobSystem::Job;
+using JobPtr = JobSystem::JobPtr;
+using Priority = JobSystem::Priority;
+
+constexpr int num_worker_priorities = 2;  /**< FRAME and BACKGROUND. */
+
+/**
+ * \brief Queues of a worker thread, one per priority.
+ */
+struct Worker {
+  std::mutex mutex;                                      /**< Protects the queues. */
+  std::deque<JobPtr> queues[num_worker_priorities];      /**< Jobs to run, oldest first. */
+};
+
+/**
+ * \brief Lifecycle of the thread pool.
+ */
+enum class State {
+  NOT_STARTED,       /**< Threads are created by the first job. */
+  RUNNING,           /**< Threads are running. */
+  STOPPED            /**< Jobs run on the thread that schedules them. */
+};
+
+int wanted_num_workers = 0;                 /**< Number of workers requested, 0 means automatic. */
+std::atomic<State> state(State::NOT_STARTED);
+std::mutex lifecycle_mutex;                 /**< Protects starting and stopping. */
+std::vector<std::unique_ptr<Worker>> workers;
+std::vector<std::thread> worker_threads;    /**< Threads running FRAME and BACKGROUND jobs. */
+std::vector<std::thread> io_threads;        /**< Threads running IO jobs. */
+std::atomic<int> num_queued(0);             /**< Jobs in the queues of workers. */
+std::atomic<unsigned> next_worker(0);       /**< Worker receiving the next job
+                                             * added by a thread that is not a worker. */
+
+std::mutex sleep_mutex;                     /**< Protects the IO jobs and stopping. */
+std::condition_variable work_condition;     /**< Wakes up workers. */
+std::condition_variable io_condition;       /**< Wakes up IO threads. */
+std::deque<JobPtr> io_jobs;                 /**< IO jobs to run, oldest first. */
+bool stopping = false;                      /**< Whether threads should stop once idle. */
+
+std::mutex graph_mutex;                     /**< Protects dependencies, done flags
+                                             * and main thread jobs. */
+std::condition_variable done_condition;     /**< Notified when a job is done
+                                             * or queued for workers. */
+unsigned num_schedules = 0;                 /**< Jobs queued for workers so far,
+                                             * to wake up threads in wait(). */
+std::deque<JobPtr> main_thread_jobs;        /**< Jobs ready to run from update(). */
+
+thread_local int current_worker = -1;       /**< Index of the worker running on this thread. */
+
+void run_job(const JobPtr& job);
+
+/**
+ * \brief Queues a job whose dependencies are all done.
+ * \param job The job.
+ */
+void schedule(const JobPtr& job) {
+
+  if (job->main_thread) {
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    main_thread_jobs.push_back(job);
+    return;
+  }
+
+  if (state != State::RUNNING) {
+    // No threads anymore.
+    run_job(job);
+    return;
+  }
+
+  if (job->priority == Priority::IO) {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+      io_jobs.push_back(job);
+    }
+    io_condition.notify_one();
+    return;
+  }
+
+  // Workers add jobs to their own queue, other threads spread them.
+  const size_t index = current_worker >= 0 ?
+      static_cast<size_t>(current_worker) :
+      next_worker++ % workers.size();
+  Worker& worker = *workers[index];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queues[static_cast<int>(job->priority)].push_back(job);
+    ++num_queued;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+  }
+  work_condition.notify_one();
+
+  // Workers may all be in wait(): they can run it too.
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    ++num_schedules;
+  }
+  done_condition.notify_all();
+}
+
+/**
+ * \brief Marks a job as done and schedules the jobs that were waiting for it.
+ * \param job The job.
+ */
+void finish_job(const JobPtr& job) {
+
+  std::vector<JobPtr> ready_jobs;
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    job->done = true;
+    for (const JobPtr& dependent : job->dependents) {
+      if (--dependent->num_pending_dependencies == 0) {
+        ready_jobs.push_back(dependent);
+      }
+    }
+    job->dependents.clear();
+  }
+
+  // Queue the dependents before waking up threads in wait(),
+  // so that they find them.
+  for (const JobPtr& ready_job : ready_jobs) {
+    schedule(ready_job);
+  }
+  done_condition.notify_all();
+}
+
+/**
+ * \brief Runs the function of a job on the current thread.
+ * \param job The job.
+ */
+void run_job(const JobPtr& job) {
+
+  try {
+    job->function();
+  }
+  catch (const std::exception& ex) {
+    Logger::error(std::string("Uncaught exception in job: ") + ex.what());
+  }
+  job->function = nullptr;  // Release what it captured.
+  finish_job(job);
+}
+
+/**
+ * \brief Takes a job from the queues of workers.
+ *
+ * The queues of the given worker are tried first,
+ * then jobs are stolen from the other workers.
+ *
+ * \param index Index of the worker of the current thread, or -1.
+ * \param max_priority Least urgent priority accepted.
+ * \return The job, or nullptr if there is none.
+ */
+JobPtr take_job(int index, Priority max_priority) {
+
+  const int num_workers = static_cast<int>(workers.size());
+  for (int priority = 0; priority <= static_cast<int>(max_priority); ++priority) {
+
+    if (index >= 0) {
+      Worker& worker = *workers[index];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      std::deque<JobPtr>& queue = worker.queues[priority];
+      if (!queue.empty()) {
+        JobPtr job = std::move(queue.front());
+        queue.pop_front();
+        --num_queued;
+        return job;
+      }
+    }
+
+    // Steal the most recent job of another worker.
+    for (int i = 1; i <= num_workers; ++i) {
+      const int other = (std::max(index, 0) + i) % num_workers;
+      if (other == index) {
+        continue;
+      }
+      Worker& worker = *workers[other];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      std::deque<JobPtr>& queue = worker.queues[priority];
+      if (!queue.empty()) {
+        JobPtr job = std::move(queue.back());
+        queue.pop_back();
+        --num_queued;
+        return job;
+      }
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * \brief Main function of a worker thread.
+ * \param index Index of the worker.
+ */
+void run_worker(int index) {
+
+  current_worker = index;
+  while (true) {
+    JobPtr job = take_job(index, Priority::BACKGROUND);
+    if (job != nullptr) {
+      run_job(job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    work_condition.wait(lock, []() {
+      return stopping || num_queued > 0;
+    });
+    if (stopping && num_queued == 0) {
+      return;
+    }
+  }
+}
+
+/**
+ * \brief Main function of an IO thread.
+ */
+void run_io_thread() {
+
+  while (true) {
+    JobPtr job;
+    {
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      io_condition.wait(lock, []() {
+        return stopping || !io_jobs.empty();
+      });
+      if (io_jobs.empty()) {
+        return;
+      }
+      job = std::move(io_jobs.front());
+      io_jobs.pop_front();
+    }
+    run_job(job);
+  }
+}
+
+/**
+ * \brief Creates the threads if this was not done yet.
+ */
+void ensure_started() {
+
+  if (state != State::NOT_STARTED) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(lifecycle_mutex);
+  if (state != State::NOT_STARTED) {
+    return;
+  }
+
+  stopping = false;
+  const int num_workers = JobSystem::get_num_workers();
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(new Worker());
+  }
+  state = State::RUNNING;
+  for (int i = 0; i < num_workers; ++i) {
+    worker_threads.emplace_back(run_worker, i);
+  }
+  for (int i = 0; i < JobSystem::num_io_threads; ++i) {
+    io_threads.emplace_back(run_io_thread);
+  }
+}
+
+/**
+ * \brief Creates a job and schedules it once its dependencies are done.
+ * \param job The job.
+ * \param dependencies Jobs to wait for.
+ */
+void add_job(const JobPtr& job, const std::vector<JobPtr>& dependencies) {
+
+  ensure_started();
+
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    for (const JobPtr& dependency : dependencies) {
+      if (dependency != nullptr && !dependency->done) {
+        dependency->dependents.push_back(job);
+        ++job->num_pending_dependencies;
+      }
+    }
+    if (job->num_pending_dependencies > 0) {
+      return;
+    }
+  }
+  schedule(job);
+}
+
+/**
+ * \brief Creates a job.
+ * \param priority How urgent the job is.
+ * \param main_thread Whether it runs on the main thread.
+ * \param function What the job does.
+ * \return The job.
+ */
+JobPtr create_job(Priority priority, bool main_thread, const JobSystem::Function& function) {
+
+  JobPtr job = std::make_shared<Job>();
+  job->priority = priority;
+  job->main_thread = main_thread;
+  job->function = function;
+  job->num_pending_dependencies = 0;
+  job->done = false;
+  return job;
+}
+
+}
+
+/**
+ * \brief Sets up the job system with the command-line options.
+ *
+ * Threads are only created when the first job is added.
+ *
+ * \param args Command-line arguments.
+ */
+void JobSystem::initialize(const Arguments& args) {
+
+  const std::string& job_threads_arg = args.get_argument_value("-job-threads");
+  if (!job_threads_arg.empty()) {
+    std::istringstream iss(job_threads_arg);
+    int num_workers = 0;
+    if (iss >> num_workers && num_workers >= 0) {
+      wanted_num_workers = num_workers;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(lifecycle_mutex);
+  if (state == State::STOPPED) {
+    state = State::NOT_STARTED;
+  }
+}
+
+/**
+ * \brief Finishes the jobs already queued and stops the threads.
+ *
+ * Jobs added later run immediately on the thread that adds them.
+ * Main thread jobs still run from update().
+ */
+void JobSystem::quit() {
+
+  std::lock_guard<std::mutex> lock(lifecycle_mutex);
+  if (state != State::RUNNING) {
+    state = State::STOPPED;
+    return;
+  }
+
+  state = State::STOPPED;
+  {
+    std::lock_guard<std::mutex> sleep_lock(sleep_mutex);
+    stopping = true;
+  }
+  work_condition.notify_all();
+  io_condition.notify_all();
+
+  for (std::thread& thread : worker_threads) {
+    thread.join();
+  }
+  for (std::thread& thread : io_threads) {
+    thread.join();
+  }
+  worker_threads.clear();
+  io_threads.clear();
+
+  // Run what was queued while the threads were stopping.
+  while (true) {
+    JobPtr job = take_job(-1, Priority::BACKGROUND);
+    if (job == nullptr) {
+      break;
+    }
+    run_job(job);
+  }
+  while (!io_jobs.empty()) {
+    JobPtr job = std::move(io_jobs.front());
+    io_jobs.pop_front();
+    run_job(job);
+  }
+  workers.clear();
+}
+
+/**
+ * \brief Returns the number of worker threads running FRAME and
+ * BACKGROUND jobs.
+ * \return The number of workers, the main thread and IO threads excluded.
+ */
+int JobSystem::get_num_workers() {
+
+  if (wanted_num_workers > 0) {
+    return wanted_num_workers;
+  }
+
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, num_cores - 1);
+}
+
+/**
+ * \brief Adds a job.
+ *
+ * This function can be called from any thread.
+ *
+ * \param priority How urgent the job is.
+ * \param function What the job does. Exceptions are logged and ignored.
+ * \param dependencies Jobs that must be done before this one starts.
+ * \return The job created.
+ */
+JobSystem::JobPtr JobSystem::add(
+    Priority priority,
+    const Function& function,
+    const std::vector<JobPtr>& dependencies
+) {
+  JobPtr job = create_job(priority, false, function);
+  add_job(job, dependencies);
+  return job;
+}
+
+/**
+ * \brief Adds a job that will run on the main thread.
+ *
+ * The job runs from update() once its dependencies are done.
+ * This function can be called from any thread.
+ *
+ * \param function What the job does. Exceptions are logged and ignored.
+ * \param dependencies Jobs that must be done before this one starts.
+ * \return The job created.
+ */
+JobSystem::JobPtr JobSystem::add_main_thread(
+    const Function& function,
+    const std::vector<JobPtr>& dependencies
+) {
+  JobPtr job = create_job(Priority::FRAME, true, function);
+  add_job(job, dependencies);
+  return job;
+}
+
+/**
+ * \brief Returns whether a job is finished.
+ * \param job A job.
+ * \return \c true if its function has returned.
+ */
+bool JobSystem::is_done(const JobPtr& job) {
+
+  std::lock_guard<std::mutex> lock(graph_mutex);
+  return job->done;
+}
+
+/**
+ * \brief Waits until a job is finished.
+ *
+ * The calling thread runs other jobs meanwhile: only FRAME jobs
+ * if it is not a worker, any job otherwise.
+ * It sleeps when there is none, until a job is done or queued.
+ * Main thread jobs cannot be waited for.
+ *
+ * \param job The job to wait for.
+ */
+void JobSystem::wait(const JobPtr& job) {
+
+  Debug::check_assertion(!job->main_thread, "Cannot wait for a main thread job");
+
+  const Priority max_priority = current_worker >= 0 ?
+      Priority::BACKGROUND : Priority::FRAME;
+  while (true) {
+    unsigned num_schedules_before = 0;
+    {
+      std::lock_guard<std::mutex> lock(graph_mutex);
+      if (job->done) {
+        return;
+      }
+      num_schedules_before = num_schedules;
+    }
+
+    if (state == State::RUNNING) {
+      JobPtr other_job = take_job(current_worker, max_priority);
+      if (other_job != nullptr) {
+        run_job(other_job);
+        continue;
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(graph_mutex);
+    done_condition.wait(lock, [&job, num_schedules_before]() {
+      return job->done || num_schedules != num_schedules_before;
+    });
+  }
+}
+
+/**
+ * \brief Runs the main thread jobs whose dependencies are done.
+ *
+ * Must be called regularly from the main thread.
+ */
+void JobSystem::update() {
+
+  std::deque<JobPtr> jobs;
+  {
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    jobs.swap(main_thread_jobs);
+  }
+
+  for (const JobPtr& job : jobs) {
+    run_job(job);
+  }
+}
+
+/**
+ * \brief Runs a loop whose iterations are independent on several threads.
+ *
+ * Items are split in bands of consecutive items given to FRAME jobs.
+ * The calling thread processes a band too and returns when all of them
+ * are done.
+ *
+ * \param num_items Number of items to process.
+ * \param min_items_per_band Minimum number of items worth giving to a job.
+ * \param band_function Function that processes a band of items.
+ * It is called from several threads at the same time.
+ */
+void JobSystem::parallel_for(
+    int num_items,
+    int min_items_per_band,
+    const BandFunction& band_function
+) {
+  if (num_items <= 0) {
+    return;
+  }
+
+  ensure_started();
+  const int num_bands = std::min(
+      get_num_workers() + 1,
+      num_items / std::max(1, min_items_per_band)
+  );
+  if (num_bands <= 1) {
+    band_function(0, num_items);
+    return;
+  }
+
+  std::vector<JobPtr> jobs;
+  for (int band = 1; band < num_bands; ++band) {
+    const int first_item = band * num_items / num_bands;
+    const int end_item = (band + 1) * num_items / num_bands;
+    jobs.push_back(add(Priority::FRAME, [&band_function, first_item, end_item]() {
+      band_function(first_item, end_item - first_item);
+    }));
+  }
+
+  // Bands reference the function: wait for them even if ours throws.
+  std::exception_ptr error;
+  try {
+    band_function(0, num_items / num_bands);
+  }
+  catch (...) {
+    error = std::current_exception();
+  }
+  for (const JobPtr& job : jobs) {
+    wait(job);
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/DialogResources.h"
+#include "solarus/core/LanguageTexts.h"
+#include "solarus/core/StringResources.h"
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Reads the strings and dialogs of a language.
+ *
+ * This can be called by any thread.
+ * Files that are missing or invalid are reported and give no texts.
+ *
+ * \param language_code Code of the language.
+ * \return The texts of this language.
+ */
+std::shared_ptr<const LanguageTexts> LanguageTexts::load(const std::string& language_code) {
+
+  std::shared_ptr<LanguageTexts> texts = std::make_shared<LanguageTexts>();
+  texts->language_code = language_code;
+  const std::string& prefix = "languages/" + language_code + "/";
+
+  StringResources string_resources;
+  if (string_resources.import_from_quest_file(prefix + "text/strings.dat")) {
+    std::vector<FlatStringMap<std::string>::Entry> strings;
+    strings.reserve(string_resources.get_strings().size());
+    for (const auto& kvp : string_resources.get_strings()) {
+      strings.emplace_back(kvp.first, kvp.second);
+    }
+    texts->strings = FlatStringMap<std::string>(std::move(strings));
+  }
+
+  DialogResources dialog_resources;
+  if (dialog_resources.import_from_quest_file(prefix + "text/dialogs.dat")) {
+    std::vector<FlatStringMap<Dialog>::Entry> dialogs;
+    dialogs.reserve(dialog_resources.get_dialogs().size());
+    for (const auto& kvp : dialog_resources.get_dialogs()) {
+
+      const std::string& id = kvp.first;
+      const DialogData& data = kvp.second;
+
+      Dialog dialog;
+      dialog.set_id(id);
+      dialog.set_text(data.get_text());
+      for (const auto& pkvp : data.get_properties()) {
+        dialog.set_property(pkvp.first, pkvp.second);
+      }
+      dialogs.emplace_back(id, std::move(dialog));
+    }
+    texts->dialogs = FlatStringMap<Dialog>(std::move(dialogs));
+  }
+
+  return texts;
+}
+
+/**
+ * \brief Returns the code of the language of these texts.
+ * \return The language code.
+ */
+const std::string& LanguageTexts::get_language_code() const {
+  return language_code;
+}
+
+/**
+ * \brief Returns all strings of text/strings.dat.
+ * \return The strings by key.
+ */
+const FlatStringMap<std::string>& LanguageTexts::get_strings() const {
+  return strings;
+}
+
+/**
+ * \brief Returns a string of text/strings.dat.
+ * \param key Key of the string.
+ * \return The string, or nullptr if there is no such key.
+ */
+const std::string* LanguageTexts::find_string(const std::string& key) const {
+  return strings.find(key);
+}
+
+/**
+ * \brief Returns all dialogs of text/dialogs.dat.
+ * \return The dialogs by id.
+ */
+const FlatStringMap<Dialog>& LanguageTexts::get_dialogs() const {
+  return dialogs;
+}
+
+/**
+ * \brief Returns a dialog of text/dialogs.dat.
+ * \param dialog_id Id of the dialog.
+ * \return The dialog, or nullptr if there is no such dialog.
+ */
+const Dialog* LanguageTexts::find_dialog(const std::string& dialog_id) const {
+  return dialogs.find(dialog_id);
+}
+
+}
+
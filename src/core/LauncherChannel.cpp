@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/LauncherChannel.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/System.h"
+#include <cstring>
+#ifdef _WIN32
+#  include <windows.h>   // CreateFileMappingA(), MapViewOfFile()
+#elif defined(SOLARUS_HAVE_UNISTD_H)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace Solarus {
+
+constexpr uint32_t LauncherChannel::magic;
+constexpr uint32_t LauncherChannel::version;
+constexpr uint32_t LauncherChannel::telemetry_capacity;
+constexpr uint32_t LauncherChannel::command_buffer_size;
+
+LauncherChannel::Layout* LauncherChannel::layout = nullptr;
+void* LauncherChannel::mapping_handle = nullptr;
+
+namespace {
+
+/**
+ * \brief Copies bytes out of the command ring.
+ * \param layout The shared memory.
+ * \param offset Offset where to start reading, modulo the ring size.
+ * \param destination Where to copy the bytes.
+ * \param size Number of bytes to copy.
+ */
+void read_ring(const LauncherChannel::Layout& layout, uint32_t offset, char* destination, uint32_t size) {
+
+  for (uint32_t i = 0; i < size; ++i) {
+    destination[i] = layout.commands[(offset + i) % LauncherChannel::command_buffer_size];
+  }
+}
+
+/**
+ * \brief Copies bytes into the command ring.
+ * \param layout The shared memory.
+ * \param offset Offset where to start writing, modulo the ring size.
+ * \param source The bytes to copy.
+ * \param size Number of bytes to copy.
+ */
+void write_ring(LauncherChannel::Layout& layout, uint32_t offset, const char* source, uint32_t size) {
+
+  for (uint32_t i = 0; i < size; ++i) {
+    layout.commands[(offset + i) % LauncherChannel::command_buffer_size] = source[i];
+  }
+}
+
+}
+
+/**
+ * \brief Initializes a shared memory created by the launcher.
+ *
+ * The memory must be filled with zeros.
+ *
+ * \param layout The shared memory.
+ */
+void LauncherChannel::initialize_layout(Layout& layout) {
+
+  layout.magic = magic;
+  layout.version = version;
+  layout.size = sizeof(Layout);
+  layout.num_frames.store(0, std::memory_order_relaxed);
+  layout.command_write_offset.store(0, std::memory_order_relaxed);
+  layout.command_read_offset.store(0, std::memory_order_release);
+}
+
+/**
+ * \brief Returns whether a shared memory was initialized with the layout
+ * of this version.
+ * \param layout The shared memory.
+ * \return \c true if the layout can be used.
+ */
+bool LauncherChannel::is_layout_valid(const Layout& layout) {
+
+  return layout.magic == magic &&
+      layout.version == version &&
+      layout.size == sizeof(Layout);
+}
+
+/**
+ * \brief Adds the statistics of a frame to the telemetry ring.
+ *
+ * Only the engine calls this function.
+ *
+ * \param layout The shared memory.
+ * \param stats Statistics of the frame.
+ * \param date Real time when the frame ended, in milliseconds.
+ */
+void LauncherChannel::push_frame(Layout& layout, const FrameStats::Frame& stats, uint32_t date) {
+
+  const uint32_t frame_number = layout.num_frames.load(std::memory_order_relaxed);
+  TelemetryRecord& record = layout.frames[frame_number % telemetry_capacity];
+  record.frame_number = frame_number;
+  record.date = date;
+  record.stats = stats;
+  layout.num_frames.store(frame_number + 1, std::memory_order_release);
+}
+
+/**
+ * \brief Reads the frames added to the telemetry ring since a previous call.
+ *
+ * Only the launcher calls this function. If it does not read often enough,
+ * the oldest frames are lost.
+ *
+ * \param[in] layout The shared memory.
+ * \param[in] next_frame Number of the first frame to read,
+ * as returned by the previous call (0 the first time).
+ * \param[out] frames The frames read are appended to this vector.
+ * \return Number of the first frame to read next time.
+ */
+uint32_t LauncherChannel::pop_frames(
+    const Layout& layout, uint32_t next_frame, std::vector<TelemetryRecord>& frames) {
+
+  const uint32_t num_frames = layout.num_frames.load(std::memory_order_acquire);
+  if (num_frames - next_frame > telemetry_capacity) {
+    next_frame = num_frames - telemetry_capacity;
+  }
+
+  const size_t first_index = frames.size();
+  for (uint32_t frame_number = next_frame; frame_number != num_frames; ++frame_number) {
+    frames.push_back(layout.frames[frame_number % telemetry_capacity]);
+  }
+
+  // The engine may have overwritten the oldest ones while we were copying.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint32_t num_frames_after = layout.num_frames.load(std::memory_order_relaxed);
+  size_t num_overwritten = 0;
+  while (first_index + num_overwritten < frames.size() &&
+      num_frames_after - frames[first_index + num_overwritten].frame_number >= telemetry_capacity) {
+    ++num_overwritten;
+  }
+  frames.erase(frames.begin() + first_index, frames.begin() + first_index + num_overwritten);
+
+  return num_frames;
+}
+
+/**
+ * \brief Adds a Lua command to the command ring.
+ *
+ * Only the launcher calls this function.
+ *
+ * \param layout The shared memory.
+ * \param command The Lua code to run.
+ * \return \c false if there is not enough space in the ring.
+ */
+bool LauncherChannel::push_command(Layout& layout, const std::string& command) {
+
+  if (command.size() > command_buffer_size - sizeof(uint32_t)) {
+    return false;
+  }
+
+  const uint32_t size = static_cast<uint32_t>(command.size());
+  const uint32_t write_offset = layout.command_write_offset.load(std::memory_order_relaxed);
+  const uint32_t read_offset = layout.command_read_offset.load(std::memory_order_acquire);
+  const uint32_t free_space = command_buffer_size - (write_offset - read_offset);
+  if (sizeof(uint32_t) + size > free_space) {
+    return false;
+  }
+
+  char header[sizeof(uint32_t)];
+  std::memcpy(header, &size, sizeof(uint32_t));
+  write_ring(layout, write_offset, header, sizeof(uint32_t));
+  write_ring(layout, write_offset + sizeof(uint32_t), command.data(), size);
+  layout.command_write_offset.store(
+        write_offset + sizeof(uint32_t) + size, std::memory_order_release);
+  return true;
+}
+
+/**
+ * \brief Removes and returns the Lua commands of the command ring.
+ *
+ * Only the engine calls this function.
+ *
+ * \param layout The shared memory.
+ * \return The commands, in the order they were pushed.
+ */
+std::vector<std::string> LauncherChannel::pop_commands(Layout& layout) {
+
+  std::vector<std::string> commands;
+  const uint32_t write_offset = layout.command_write_offset.load(std::memory_order_acquire);
+  uint32_t read_offset = layout.command_read_offset.load(std::memory_order_relaxed);
+  while (write_offset - read_offset >= sizeof(uint32_t)) {
+
+    char header[sizeof(uint32_t)];
+    read_ring(layout, read_offset, header, sizeof(uint32_t));
+    uint32_t size = 0;
+    std::memcpy(&size, header, sizeof(uint32_t));
+    if (size > write_offset - read_offset - sizeof(uint32_t)) {
+      // Corrupted ring: drop everything.
+      Logger::error("Invalid command in the launcher channel");
+      read_offset = write_offset;
+      break;
+    }
+
+    std::string command(size, '\0');
+    read_ring(layout, read_offset + sizeof(uint32_t), &command[0], size);
+    commands.push_back(command);
+    read_offset += sizeof(uint32_t) + size;
+  }
+  layout.command_read_offset.store(read_offset, std::memory_order_release);
+  return commands;
+}
+
+/**
+ * \brief Maps the file of the channel created by the launcher.
+ * \param file_name The file to map.
+ * \return \c true in case of success.
+ */
+bool LauncherChannel::open(const std::string& file_name) {
+
+  close();
+
+  void* memory = nullptr;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    Logger::error("Cannot open launcher channel file '" + file_name + "'");
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  const bool size_valid = GetFileSizeEx(file, &file_size) &&
+      file_size.QuadPart >= static_cast<LONGLONG>(sizeof(Layout));
+  HANDLE mapping = size_valid ?
+      CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, sizeof(Layout), nullptr) :
+      nullptr;
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    Logger::error("Cannot map launcher channel file '" + file_name + "'");
+    return false;
+  }
+  memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Layout));
+  if (memory == nullptr) {
+    CloseHandle(mapping);
+    Logger::error("Cannot map launcher channel file '" + file_name + "'");
+    return false;
+  }
+  mapping_handle = mapping;
+#elif defined(SOLARUS_HAVE_UNISTD_H)
+  const int file = ::open(file_name.c_str(), O_RDWR);
+  if (file == -1) {
+    Logger::error("Cannot open launcher channel file '" + file_name + "'");
+    return false;
+  }
+  struct stat file_info;
+  const bool size_valid = fstat(file, &file_info) == 0 &&
+      file_info.st_size >= static_cast<off_t>(sizeof(Layout));
+  memory = size_valid ?
+      mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) :
+      MAP_FAILED;
+  ::close(file);
+  if (memory == MAP_FAILED) {
+    Logger::error("Cannot map launcher channel file '" + file_name + "'");
+    return false;
+  }
+#else
+  Logger::error("Launcher channel not supported on this system");
+  return false;
+#endif
+
+  layout = static_cast<Layout*>(memory);
+  if (!is_layout_valid(*layout)) {
+    Logger::error("Incompatible launcher channel file '" + file_name + "'");
+    close();
+    return false;
+  }
+
+  Logger::info("Launcher channel: yes");
+  return true;
+}
+
+/**
+ * \brief Unmaps the file of the channel if any.
+ */
+void LauncherChannel::close() {
+
+  if (layout == nullptr) {
+    return;
+  }
+
+#ifdef _WIN32
+  UnmapViewOfFile(layout);
+  CloseHandle(static_cast<HANDLE>(mapping_handle));
+  mapping_handle = nullptr;
+#elif defined(SOLARUS_HAVE_UNISTD_H)
+  munmap(layout, sizeof(Layout));
+#endif
+  layout = nullptr;
+}
+
+/**
+ * \brief Returns whether the engine is connected to a launcher channel.
+ * \return \c true if the channel is open.
+ */
+bool LauncherChannel::is_open() {
+  return layout != nullptr;
+}
+
+/**
+ * \brief Sends the statistics of a frame that has just ended to the launcher.
+ *
+ * Does nothing if the channel is not open.
+ *
+ * \param stats Statistics of the frame.
+ */
+void LauncherChannel::publish_frame(const FrameStats::Frame& stats) {
+
+  if (layout == nullptr) {
+    return;
+  }
+  push_frame(*layout, stats, System::get_real_time());
+}
+
+/**
+ * \brief Returns the Lua commands sent by the launcher since the last call.
+ * \return The commands, or an empty vector if the channel is not open.
+ */
+std::vector<std::string> LauncherChannel::take_commands() {
+
+  if (layout == nullptr) {
+    return std::vector<std::string>();
+  }
+  return pop_commands(*layout);
+}
+
+}
+
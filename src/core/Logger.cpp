@@ -14,10 +14,18 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/MpscQueue.h"
+#include "solarus/core/Arguments.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/System.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <SDL_log.h>
 
 namespace Solarus {
@@ -26,23 +34,376 @@ namespace Logger {
 
 namespace {
 
+  /**
+   * \brief A line waiting to be written by the background thread.
+   */
+  struct Entry {
+    std::string line;                 /**< The line, without newline. */
+    bool to_error_log = false;        /**< Whether to also write it to the error log. */
+  };
+
+  constexpr size_t queue_capacity = 4096;       /**< Lines that can wait. */
+  constexpr uint32_t repeat_window = 1000;      /**< Time in ms where a warning is a repetition. */
+  constexpr int max_repeats = 3;                /**< Repetitions logged in a window. */
+
+  std::atomic<int> min_level(static_cast<int>(Level::LEVEL_DEBUG));
+
+  /**
+   * \brief Keeps lines logged by several threads from being mixed.
+   */
+  std::mutex print_mutex;
+
+  // Background writing.
+  MpscQueue<Entry> queue(queue_capacity);
+  std::atomic<bool> initialized(false);
+  std::atomic<uint64_t> num_dropped(0);
+  std::thread writer;
+  std::mutex writer_mutex;                      /**< Protects what follows. */
+  std::condition_variable writer_wakeup;        /**< Wakes up the writer. */
+  std::condition_variable lines_written;        /**< Wakes up flush(). */
+  bool stopping = false;
+
+  // Repeated warnings.
+  std::mutex repeat_mutex;                      /**< Protects what follows. */
+  std::string last_warning;
+  uint32_t repeat_window_start = 0;
+  int num_repeats = 0;                          /**< Times last_warning was seen in the window. */
+
 #ifdef SOLARUS_FILE_LOGGING
   const std::string error_log_file_name = "error.txt";
+  const std::string error_log_old_file_name = "error.old.txt";
+  constexpr size_t error_log_max_size = 1024 * 1024;  /**< Size before rotation. */
   std::ofstream error_log_file;
+  size_t error_log_size = 0;
 
   /**
-   * \brief Returns the error log file.
+   * \brief Appends a line to the error log file.
    *
    * Opens it the first time this function is called.
+   * When the file exceeds error_log_max_size, it is renamed to
+   * error_log_old_file_name and a new one is started.
+   * Must be called with print_mutex locked.
+   *
+   * \param line The line to write.
    */
-  std::ofstream& get_error_log_file() {
+  void write_to_error_log(const std::string& line) {
 
+    if (error_log_file.is_open() &&
+        error_log_size + line.size() + 1 > error_log_max_size) {
+      error_log_file.close();
+      std::remove(error_log_old_file_name.c_str());
+      std::rename(error_log_file_name.c_str(), error_log_old_file_name.c_str());
+    }
     if (!error_log_file.is_open()) {
       error_log_file.open(error_log_file_name.c_str());
+      error_log_size = 0;
+    }
+    error_log_file << line << '\n';
+    error_log_size += line.size() + 1;
+  }
+#endif
+
+  /**
+   * \brief Writes a line on the console and possibly on the error log.
+   *
+   * Must be called with print_mutex locked.
+   * Streams are not flushed.
+   *
+   * \param entry The line to write.
+   */
+  void write_entry(const Entry& entry) {
+
+#ifdef ANDROID
+    SDL_Log("%s", entry.line.c_str());
+#else
+    std::cerr << entry.line << '\n';
+#endif
+#ifdef SOLARUS_FILE_LOGGING
+    if (entry.to_error_log) {
+      write_to_error_log(entry.line);
     }
-    return error_log_file;
+#endif
   }
+
+  /**
+   * \brief Flushes the console and the error log.
+   *
+   * Must be called with print_mutex locked.
+   */
+  void flush_streams() {
+
+    std::cerr.flush();
+#ifdef SOLARUS_FILE_LOGGING
+    if (error_log_file.is_open()) {
+      error_log_file.flush();
+    }
 #endif
+  }
+
+  /**
+   * \brief Writes the lines waiting in the queue.
+   *
+   * Must only be called by the consumer of the queue.
+   */
+  void write_queued_entries() {
+
+    static uint64_t num_dropped_reported = 0;
+
+    Entry entry;
+    std::lock_guard<std::mutex> lock(print_mutex);
+    bool written = false;
+    while (queue.pop(entry)) {
+      write_entry(entry);
+      written = true;
+    }
+
+    const uint64_t dropped = num_dropped.load();
+    if (dropped != num_dropped_reported) {
+      entry.line = "[Solarus] [" + std::to_string(System::now()) + "] Warning: " +
+          std::to_string(dropped - num_dropped_reported) + " log messages dropped";
+      entry.to_error_log = true;
+      write_entry(entry);
+      num_dropped_reported = dropped;
+      written = true;
+    }
+
+    if (written) {
+      flush_streams();
+    }
+  }
+
+  /**
+   * \brief Main function of the writer thread.
+   *
+   * Writes lines until quit() is called and nothing remains to write.
+   */
+  void run() {
+
+    while (true) {
+      write_queued_entries();
+
+      std::unique_lock<std::mutex> lock(writer_mutex);
+      lines_written.notify_all();
+      if (stopping) {
+        if (queue.get_num_popped() == queue.get_num_pushed()) {
+          return;
+        }
+        // A push is still in progress.
+        lock.unlock();
+        std::this_thread::yield();
+        continue;
+      }
+      // Producers notify without the lock: the timeout catches a missed wakeup.
+      writer_wakeup.wait_for(lock, std::chrono::milliseconds(50));
+    }
+  }
+
+  /**
+   * \brief Returns a clock in milliseconds that also works from other threads.
+   * \return The current time.
+   */
+  uint32_t get_clock_time() {
+
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  /**
+   * \brief Tells whether a warning should be logged or is a repetition to skip.
+   *
+   * The first max_repeats occurrences of a warning in a repeat_window are
+   * logged, further ones are only counted until the window ends or another
+   * warning comes.
+   *
+   * \param message The warning.
+   * \param[out] num_skipped Set to the number of repetitions skipped of the
+   * previous warning if it has just ended, 0 otherwise.
+   * \return \c true if the warning should be logged.
+   */
+  bool filter_repeated_warning(const std::string& message, int& num_skipped) {
+
+    const uint32_t now = get_clock_time();
+    num_skipped = 0;
+
+    std::lock_guard<std::mutex> lock(repeat_mutex);
+    if (message == last_warning && now - repeat_window_start < repeat_window) {
+      ++num_repeats;
+      return num_repeats <= max_repeats;
+    }
+
+    if (num_repeats > max_repeats) {
+      num_skipped = num_repeats - max_repeats;
+    }
+    if (message != last_warning) {
+      last_warning = message;
+    }
+    repeat_window_start = now;
+    num_repeats = 1;
+    return true;
+  }
+
+  /**
+   * \brief Logs a line on the console and possibly on the error log.
+   *
+   * If the logger is initialized, the line is queued for the writer thread.
+   * When the queue is full, errors wait for some room and other messages
+   * are dropped.
+   *
+   * \param message The message, without the "[Solarus] [t] " prefix.
+   * \param level Severity of the message.
+   * \param to_error_log Whether to also write it to the error log.
+   */
+  void log(const std::string& message, Level level, bool to_error_log) {
+
+    Entry entry;
+    entry.line = "[Solarus] [" + std::to_string(System::now()) + "] " + message;
+    entry.to_error_log = to_error_log;
+
+    if (!initialized) {
+      std::lock_guard<std::mutex> lock(print_mutex);
+      write_entry(entry);
+      flush_streams();
+      return;
+    }
+
+    if (!queue.push(std::move(entry))) {
+      if (level < Level::LEVEL_ERROR) {
+        ++num_dropped;
+        return;
+      }
+      do {
+        writer_wakeup.notify_one();
+        std::this_thread::yield();
+      } while (!queue.push(std::move(entry)));
+    }
+    writer_wakeup.notify_one();
+  }
+
+}
+
+/**
+ * \brief Starts the thread that writes log messages.
+ *
+ * Until this function is called, messages are written immediately.
+ *
+ * \param args Command-line arguments.
+ */
+SOLARUS_API void initialize(const Arguments& args) {
+
+  const std::string& level_arg = args.get_argument_value("-log-level");
+  if (level_arg == "debug") {
+    set_level(Level::LEVEL_DEBUG);
+  }
+  else if (level_arg == "info") {
+    set_level(Level::LEVEL_INFO);
+  }
+  else if (level_arg == "warning") {
+    set_level(Level::LEVEL_WARNING);
+  }
+  else if (level_arg == "error") {
+    set_level(Level::LEVEL_ERROR);
+  }
+  else if (level_arg == "fatal") {
+    set_level(Level::LEVEL_FATAL);
+  }
+  else if (level_arg == "none") {
+    set_level(Level::LEVEL_NONE);
+  }
+
+  if (initialized) {
+    return;
+  }
+
+  stopping = false;
+  writer = std::thread(&run);
+  initialized = true;
+}
+
+/**
+ * \brief Writes the messages still waiting and stops the thread.
+ *
+ * Messages logged after this call are written immediately again.
+ */
+SOLARUS_API void quit() {
+
+  if (!initialized) {
+    return;
+  }
+
+  initialized = false;
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    stopping = true;
+  }
+  writer_wakeup.notify_all();
+  writer.join();
+
+  // Lines pushed by other threads while stopping.
+  write_queued_entries();
+}
+
+/**
+ * \brief Returns whether messages are written by a background thread.
+ * \return \c true if the logger is initialized.
+ */
+SOLARUS_API bool is_initialized() {
+  return initialized;
+}
+
+/**
+ * \brief Waits until all messages logged so far are written.
+ */
+SOLARUS_API void flush() {
+
+  if (!initialized) {
+    return;
+  }
+
+  const size_t num_pushed = queue.get_num_pushed();
+  writer_wakeup.notify_one();
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  lines_written.wait(lock, [num_pushed]() {
+    return stopping || queue.get_num_popped() >= num_pushed;
+  });
+}
+
+/**
+ * \brief Returns the minimum severity of messages logged.
+ * \return The current log level.
+ */
+SOLARUS_API Level get_level() {
+  return static_cast<Level>(min_level.load());
+}
+
+/**
+ * \brief Sets the minimum severity of messages logged.
+ *
+ * This can be changed at any time, from any thread.
+ *
+ * \param level The new log level. Level::LEVEL_NONE disables logging.
+ */
+SOLARUS_API void set_level(Level level) {
+  min_level = static_cast<int>(level);
+}
+
+/**
+ * \brief Returns whether messages of a severity are logged.
+ *
+ * Use it to avoid building messages that would be discarded anyway.
+ *
+ * \param level A severity.
+ * \return \c true if messages of this severity are logged.
+ */
+SOLARUS_API bool is_enabled(Level level) {
+  return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the number of messages dropped because the queue was full.
+ * \return The number of messages dropped since the program started.
+ */
+SOLARUS_API uint64_t get_num_dropped_messages() {
+  return num_dropped;
 }
 
 /**
@@ -50,6 +411,8 @@ namespace {
  *
  * The message is prepended by "[Solarus] [t] " where t is the current
  * simulated time.
+ * Messages to the standard error go through the writer thread
+ * if the logger is initialized.
  *
  * \param message The message to log.
  * \param out The output stream.
@@ -58,7 +421,12 @@ SOLARUS_API void print(const std::string& message, std::ostream& out) {
 #ifdef ANDROID
   SDL_Log("%s",message.c_str());
 #else
+  if (&out == &std::cerr) {
+    log(message, Level::LEVEL_INFO, false);
+    return;
+  }
   uint32_t simulated_time = System::now();
+  std::lock_guard<std::mutex> lock(print_mutex);
   out << "[Solarus] [" << simulated_time << "] " << message << std::endl;
 #endif
 }
@@ -69,7 +437,10 @@ SOLARUS_API void print(const std::string& message, std::ostream& out) {
  */
 SOLARUS_API void debug(const std::string& message) {
 
-  print("Debug: " + message);
+  if (!is_enabled(Level::LEVEL_DEBUG)) {
+    return;
+  }
+  log("Debug: " + message, Level::LEVEL_DEBUG, false);
 }
 
 /**
@@ -78,20 +449,35 @@ SOLARUS_API void debug(const std::string& message) {
  */
 SOLARUS_API void info(const std::string& message) {
 
-  print("Info: " + message);
+  if (!is_enabled(Level::LEVEL_INFO)) {
+    return;
+  }
+  log("Info: " + message, Level::LEVEL_INFO, false);
 }
 
 /**
  * \brief Logs a warning message on stdout and error.txt (if configured).
+ *
+ * A warning repeated many times in a short time is only logged a few
+ * times, followed by the number of repetitions skipped.
+ *
  * \param message The message to log.
  */
 SOLARUS_API void warning(const std::string& message) {
 
-  std::string prefixed_message = "Warning: " + message;
-  print(prefixed_message);
-#ifdef SOLARUS_FILE_LOGGING
-  print(prefixed_message, get_error_log_file());
-#endif
+  if (!is_enabled(Level::LEVEL_WARNING)) {
+    return;
+  }
+
+  int num_skipped = 0;
+  const bool logged = filter_repeated_warning(message, num_skipped);
+  if (num_skipped > 0) {
+    log("Warning: previous warning repeated " + std::to_string(num_skipped) + " more times",
+        Level::LEVEL_WARNING, true);
+  }
+  if (logged) {
+    log("Warning: " + message, Level::LEVEL_WARNING, true);
+  }
 }
 
 /**
@@ -100,24 +486,26 @@ SOLARUS_API void warning(const std::string& message) {
  */
 SOLARUS_API void error(const std::string& message) {
 
-  std::string prefixed_message = "Error: " + message;
-  print(prefixed_message);
-#ifdef SOLARUS_FILE_LOGGING
-  print(prefixed_message, get_error_log_file());
-#endif
+  if (!is_enabled(Level::LEVEL_ERROR)) {
+    return;
+  }
+  log("Error: " + message, Level::LEVEL_ERROR, true);
 }
 
 /**
  * \brief Logs a fatal error message on stdout and error.txt (if configured).
+ *
+ * Waits until the message is written, since the program is about to stop.
+ *
  * \param message The message to log.
  */
 SOLARUS_API void fatal(const std::string& message) {
 
-  std::string prefixed_message = "Fatal: " + message;
-  print(prefixed_message);
-#ifdef SOLARUS_FILE_LOGGING
-  print(prefixed_message, get_error_log_file());
-#endif
+  if (!is_enabled(Level::LEVEL_FATAL)) {
+    return;
+  }
+  log("Fatal: " + message, Level::LEVEL_FATAL, true);
+  flush();
 }
 
 }  // namespace Logger
@@ -16,28 +16,51 @@
  */
 #include "solarus/audio/Music.h"
 #include "solarus/core/Arguments.h"
+#include "solarus/core/AsyncFileWriter.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/FontResource.h"
+#include "solarus/core/FrameStats.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/HitchDetector.h"
+#include "solarus/core/JobSystem.h"
+#include "solarus/core/LauncherChannel.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/MemoryUsage.h"
+#include "solarus/core/PerfTrace.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
+#include "solarus/core/Random.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/Settings.h"
+#include "solarus/core/StartupTasks.h"
 #include "solarus/core/String.h"
 #include "solarus/core/System.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Teletransporter.h"
 #include "solarus/entities/TilePattern.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/FrameDamage.h"
+#include "solarus/graphics/Renderer.h"
+#include "solarus/graphics/Shader.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/TextSurface.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/graphics/quest_icon.h"
 
 #include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaData.h"
 #include "solarus/lua/LuaTools.h"
+#include "solarus/lua/LuaWorkers.h"
+#include "solarus/movements/PlayerMovement.h"
 
 #include <lua.hpp>
+#include <algorithm>
 #include <clocale>
+#include <iomanip>
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -127,6 +150,7 @@ std::string get_quest_path(const Arguments& args) {
 MainLoop::MainLoop(const Arguments& args):
   lua_context(nullptr),
   resource_provider(),
+  asset_watcher(),
   root_surface(nullptr),
   game(nullptr),
   next_game(nullptr),
@@ -135,6 +159,16 @@ MainLoop::MainLoop(const Arguments& args):
   suspend_unfocused(true),
   suspended(false),
   turbo(false),
+  interpolation(false),
+  headless(false),
+  max_ticks(0),
+  catch_up_mode(CatchUpMode::FIXED),
+  max_catch_up_updates(10),
+  lag_drop_threshold(200),
+  average_step_cost(0),
+  draw_skipped(false),
+  input_replay(),
+  frame_stats_lines(),
   lua_commands(),
   lua_commands_mutex(),
   num_lua_commands_pushed(0),
@@ -154,8 +188,83 @@ MainLoop::MainLoop(const Arguments& args):
   }
   const std::string& turbo_arg = args.get_argument_value("-turbo");
   turbo = (turbo_arg == "yes");
+  const std::string& late_latch_arg = args.get_argument_value("-late-latch");
+  PlayerMovement::set_late_latch_enabled(late_latch_arg == "yes");
+  const std::string& lazy_redraw_arg = args.get_argument_value("-lazy-redraw");
+  FrameDamage::set_lazy_redraw_enabled(lazy_redraw_arg == "yes");
+  headless = args.has_argument("-headless");
+  const std::string& max_ticks_arg = args.get_argument_value("-max-ticks");
+  if (!max_ticks_arg.empty()) {
+    std::istringstream iss(max_ticks_arg);
+    iss >> max_ticks;
+  }
+  const std::string& random_seed_arg = args.get_argument_value("-random-seed");
+  if (!random_seed_arg.empty()) {
+    std::istringstream iss(random_seed_arg);
+    uint32_t seed = 0;
+    if (iss >> seed) {
+      Random::set_seed(seed);
+    }
+  }
+  const std::string& replay_input_arg = args.get_argument_value("-replay-input");
+  const std::string& record_input_arg = args.get_argument_value("-record-input");
+  const std::string& state_hash_arg = args.get_argument_value("-state-hash");
+  if (!replay_input_arg.empty()) {
+    if (input_replay.start_replaying(replay_input_arg)) {
+      Random::set_seed(input_replay.get_seed());
+    }
+  }
+  else if (!record_input_arg.empty()) {
+    input_replay.start_recording(record_input_arg, Random::get_seed(), state_hash_arg == "yes");
+  }
+  const std::string& frame_stats_arg = args.get_argument_value("-frame-stats");
+  FrameStats::set_overlay_enabled(frame_stats_arg == "yes");
+  const std::string& interpolation_arg = args.get_argument_value("-interpolation");
+  interpolation = (interpolation_arg == "yes");
   const std::string& suspend_unfocused_arg = args.get_argument_value("-suspend-unfocused");
   suspend_unfocused = suspend_unfocused_arg.empty() || suspend_unfocused_arg == "yes";
+  const std::string& launcher_channel_arg = args.get_argument_value("-launcher-channel");
+  if (!launcher_channel_arg.empty()) {
+    LauncherChannel::open(launcher_channel_arg);
+  }
+  const std::string& perf_trace_arg = args.get_argument_value("-perf-trace");
+  if (!perf_trace_arg.empty()) {
+    PerfTrace::start(perf_trace_arg);
+  }
+  const std::string& memory_log_period_arg = args.get_argument_value("-memory-log-period");
+  if (!memory_log_period_arg.empty()) {
+    std::istringstream iss(memory_log_period_arg);
+    int memory_log_period = 0;
+    if (iss >> memory_log_period && memory_log_period > 0) {
+      MemoryUsage::set_log_period(static_cast<uint32_t>(memory_log_period) * 1000);
+    }
+  }
+  const std::string& hitch_threshold_arg = args.get_argument_value("-hitch-threshold");
+  if (!hitch_threshold_arg.empty()) {
+    std::istringstream iss(hitch_threshold_arg);
+    int hitch_threshold = 0;
+    if (iss >> hitch_threshold && hitch_threshold >= 0) {
+      HitchDetector::set_threshold(hitch_threshold);
+    }
+  }
+  const std::string& hitch_log_size_arg = args.get_argument_value("-hitch-log-size");
+  if (!hitch_log_size_arg.empty()) {
+    std::istringstream iss(hitch_log_size_arg);
+    int hitch_log_size = 0;
+    if (iss >> hitch_log_size && hitch_log_size >= 0) {
+      HitchDetector::set_log_size(hitch_log_size);
+    }
+  }
+  const std::string& prefetch_distance_arg = args.get_argument_value("-map-prefetch-distance");
+  if (!prefetch_distance_arg.empty()) {
+    std::istringstream iss(prefetch_distance_arg);
+    int prefetch_distance = 0;
+    if (iss >> prefetch_distance && prefetch_distance >= 0) {
+      Teletransporter::set_prefetch_distance(prefetch_distance);
+    }
+  }
+  const std::string& data_cache_arg = args.get_argument_value("-data-cache");
+  LuaData::set_binary_cache_enabled(data_cache_arg.empty() || data_cache_arg == "yes");
 
   // Try to open the quest.
   const std::string& quest_path = get_quest_path(args);
@@ -165,31 +274,74 @@ MainLoop::MainLoop(const Arguments& args):
     return;
   }
 
-  // Initialize engine features (audio, video...).
-  System::initialize(args);
+  // Read the quest resource list from data if opening the quest did not.
+  if (!CurrentQuest::is_initialized()) {
+    CurrentQuest::initialize();
+  }
+
+  // Initialize engine features (audio, video...) and read the data needed
+  // at startup, in parallel when possible.
+  int num_startup_threads = StartupTasks::get_default_num_threads();
+  const std::string& startup_threads_arg = args.get_argument_value("-startup-threads");
+  if (!startup_threads_arg.empty()) {
+    std::istringstream iss(startup_threads_arg);
+    int num_threads = 0;
+    if (iss >> num_threads && num_threads >= 0) {
+      num_startup_threads = num_threads;
+    }
+  }
+  StartupTasks startup_tasks(num_startup_threads);
+  System::initialize(args, startup_tasks);
 
-  // Read the quest resource list from data.
-  CurrentQuest::initialize();
+  using Affinity = StartupTasks::Affinity;
+  startup_tasks.add("fonts", Affinity::ANY_THREAD, {}, []() {
+    FontResource::preload_files();
+  });
 
-  // Read the quest general properties.
-  load_quest_properties();
+  // The language is set before main.lua if there is only one.
+  std::vector<std::string> lua_dependencies = {
+      "audio", "input", "random", "video", "fonts", "quest properties"
+  };
+  const std::map<std::string, std::string>& languages =
+      CurrentQuest::get_resources(ResourceType::LANGUAGE);
+  if (languages.size() == 1) {
+    const std::string language_code = languages.begin()->first;
+    startup_tasks.add("language", Affinity::ANY_THREAD, {}, [language_code]() {
+      CurrentQuest::preload_language(language_code);
+    });
+    lua_dependencies.push_back("language");
+  }
 
-  // Create the quest surface.
-  root_surface = Surface::create(
-      Video::get_quest_size()
-  );
+  startup_tasks.add("quest properties", Affinity::MAIN_THREAD, { "video" }, [this]() {
+    // Read the quest general properties.
+    load_quest_properties();
+
+    // Create the quest surface.
+    root_surface = Surface::create(
+        Video::get_quest_size()
+    );
+  });
 
   // Run the Lua world.
   // Do this after the creation of the window, but before showing the window,
   // because Lua might change the video mode initially.
-  lua_context = std::unique_ptr<LuaContext>(new LuaContext(*this));
+  startup_tasks.add("lua", Affinity::MAIN_THREAD, lua_dependencies, [this, &args]() {
+    lua_context = std::unique_ptr<LuaContext>(new LuaContext(*this));
+
+    if(Video::get_renderer().needs_window_workaround()) {
+      Video::show_window();
+      lua_context->initialize(args);
+      Video::hide_window();
+    } else {
+      lua_context->initialize(args);
+    }
+  });
 
-  if(Video::get_renderer().needs_window_workaround()) {
-    Video::show_window();
-    lua_context->initialize(args);
-    Video::hide_window();
-  } else {
-    lua_context->initialize(args);
+  startup_tasks.run();
+  if (args.get_argument_value("-startup-report") == "yes") {
+    for (const std::string& line : startup_tasks.get_report()) {
+      Logger::info(line);
+    }
   }
 
   // Set up the Lua console.
@@ -210,9 +362,20 @@ MainLoop::MainLoop(const Arguments& args):
     Logger::info("Turbo mode: no");
   }
 
+  if (FrameDamage::is_lazy_redraw_enabled()) {
+    Logger::info("Lazy redraw: yes");
+  }
+
   // Start loading resources in background.
   resource_provider.start_preloading_resources();
 
+  // Watch asset files if requested.
+  const std::string& hot_reload_arg = args.get_argument_value("-hot-reload");
+  if (hot_reload_arg == "yes") {
+    Logger::info("Hot reload: yes");
+    asset_watcher.start(AssetWatcher::default_period);
+  }
+
   // Display the game icon as window icon (if any)
   setup_game_icon();
 
@@ -242,6 +405,7 @@ MainLoop::~MainLoop() {
     game.reset();  // While deleting the game, the Lua world must still exist.
   }
 
+  asset_watcher.stop();
   resource_provider.clear();
 
   // Clear the surface while Lua still exists,
@@ -255,6 +419,8 @@ MainLoop::~MainLoop() {
   QuestFiles::close_quest();
   System::quit();
   quit_lua_console();
+  LauncherChannel::close();
+  PerfTrace::stop();
 }
 
 /**
@@ -382,17 +548,39 @@ void MainLoop::run() {
     return;
   }
 
+  if (headless) {
+    run_headless();
+    return;
+  }
+
   // Main loop.
   Logger::info("Simulation started");
 
   uint32_t last_frame_date = System::get_real_time();
   uint32_t lag = 0;  // Lose time of the simulation to catch up.
   uint32_t time_dropped = 0;  // Time that won't be caught up.
+  uint64_t next_frame_date_us = System::get_real_time_us();  // For precise pacing.
+
+  // With interpolation, frames are drawn at the refresh rate of the display
+  // if it is faster than updates.
+  uint32_t frame_period = System::timestep;
+  if (interpolation && !turbo) {
+    int refresh_rate = Video::get_refresh_rate();
+    if (refresh_rate <= 0) {
+      refresh_rate = 60;
+    }
+    const uint32_t refresh_period = std::max(1, 1000 / refresh_rate);
+    if (refresh_period < frame_period) {
+      frame_period = refresh_period;
+    }
+  }
 
   // The main loop basically repeats
   // check_input(), update(), draw() and sleep().
   // Each call to update() makes the simulated time advance one fixed step.
 
+  uint32_t num_ticks = 0;
+  HitchDetector::start_frame();
   while (!is_exiting()) {
 
     // Measure the time of the last iteration.
@@ -403,11 +591,12 @@ void MainLoop::run() {
     // At this point, lag represents how much late the simulated time with
     // compared to the real time.
 
-    if (lag >= 200) {
+    if (lag >= lag_drop_threshold) {
       // Huge lag: don't try to catch up.
       // Maybe we have just made a one-time heavy operation like loading a
       // big file, or the process was just unsuspended.
       // Let's fake the real time instead.
+      FrameStats::get_current_frame().dropped_time += lag - System::timestep;
       time_dropped += lag - System::timestep;
       lag = System::timestep;
       last_frame_date = System::get_real_time() - time_dropped;
@@ -418,6 +607,7 @@ void MainLoop::run() {
 
     // 2. Update the world once, or several times (skipping some draws)
     // to catch up if the system is slow.
+    const uint64_t update_start_date = System::get_real_time_us();
     int num_updates = 0;
     if (turbo && !is_suspended()) {
       // Turbo mode: always update at least once.
@@ -426,18 +616,74 @@ void MainLoop::run() {
       ++num_updates;
     }
 
+    const int max_updates = get_max_catch_up_updates(frame_period);
     while (lag >= System::timestep &&
-           num_updates < 10 && // To draw sometimes anyway on very slow systems.
+           num_updates < max_updates && // To draw sometimes anyway on very slow systems.
            !is_exiting() && !is_suspended()
     ) {
+      if (num_updates > 0) {
+        // Sample input again just before each catch-up update
+        // rather than once per frame.
+        check_input();
+        if (is_exiting() || is_suspended()) {
+          break;
+        }
+      }
+      const uint64_t step_start_date = System::get_real_time_us();
       step();
       lag -= System::timestep;
       ++num_updates;
+      if (catch_up_mode == CatchUpMode::ADAPTIVE) {
+        // Moving average of the cost of recent updates.
+        const uint32_t step_cost = static_cast<uint32_t>(System::get_real_time_us() - step_start_date);
+        average_step_cost = (average_step_cost * 7 + step_cost) / 8;
+      }
+    }
+
+    bool overloaded = false;
+    if (catch_up_mode == CatchUpMode::ADAPTIVE &&
+        num_updates >= max_updates &&
+        lag >= System::timestep) {
+      // The system cannot catch up: more updates would make the next
+      // frame even later. Slow down the simulation instead.
+      const uint32_t lag_dropped = lag - lag % System::timestep;
+      FrameStats::get_current_frame().dropped_time += lag_dropped;
+      time_dropped += lag_dropped;
+      lag -= lag_dropped;
+      overloaded = true;
+    }
+
+    FrameStats::Frame& frame_stats = FrameStats::get_current_frame();
+    frame_stats.num_updates = num_updates;
+    frame_stats.update_time = static_cast<int>(System::get_real_time_us() - update_start_date);
+
+    num_ticks += num_updates;
+    if (max_ticks != 0 && num_ticks >= max_ticks) {
+      set_exiting();
     }
 
-    // 3. Redraw the screen.
-    if (num_updates > 0 && !is_suspended()) {
+    // 3. Redraw the screen unless nothing has changed since the last frame.
+    // With interpolation, also draw between updates: moving entities are
+    // drawn where they are at the real time.
+    const bool interpolating = interpolation && !turbo;
+    bool drawn = false;
+    // When overloaded, only draw every other frame to leave time to updates.
+    const bool skip_draw = overloaded && !draw_skipped;
+    draw_skipped = skip_draw;
+    if ((num_updates > 0 || interpolating) && !is_suspended() && !skip_draw &&
+        FrameDamage::is_damaged()) {
+      if (interpolating) {
+        System::set_interpolation_factor(static_cast<float>(lag) / System::timestep);
+      }
       draw();
+      System::set_interpolation_factor(1.0f);
+      drawn = true;
+    }
+
+    if (num_updates > 0 || drawn) {
+      frame_stats.lua_memory = lua_context->get_memory_usage();
+      frame_stats.audio_buffer_fill = Music::get_buffer_fill_level();
+      FrameStats::finish_frame();
     }
 
     // 4. Sleep if we have time, to save CPU and GPU cycles.
@@ -447,14 +693,97 @@ void MainLoop::run() {
     }
 
     last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
-    if (last_frame_duration < System::timestep && !turbo) {
-      System::sleep(System::timestep - last_frame_duration);
+    if (last_frame_duration < frame_period && !turbo) {
+      // Use some of the idle time to destroy removed entities
+      // and to collect Lua garbage.
+      if (num_updates > 0 && !is_exiting()) {
+        if (game != nullptr && game->has_current_map()) {
+          game->get_current_map().get_entities().destroy_removed_entities(
+                frame_period - last_frame_duration);
+          last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
+        }
+        if (last_frame_duration < frame_period) {
+          lua_context->step_garbage_collector(frame_period - last_frame_duration);
+          last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
+        }
+      }
+    }
+    if (Video::get_vsync_mode() == VsyncMode::LATENCY && !turbo) {
+      // Precise pacing: wait for the exact end of the frame period
+      // rather than a whole number of milliseconds.
+      next_frame_date_us += frame_period * 1000;
+      const uint64_t now_us = System::get_real_time_us();
+      if (next_frame_date_us < now_us) {
+        // Late: don't try to catch up.
+        next_frame_date_us = now_us;
+      }
+      else {
+        System::sleep_until_us(next_frame_date_us);
+      }
+    }
+    else if (last_frame_duration < frame_period && !turbo) {
+      System::sleep(frame_period - last_frame_duration);
     }
+
+    // 5. Report the iteration if it was too long.
+    HitchDetector::finish_frame(&resource_provider);
   }
 
   Logger::info("Simulation finished");
 }
 
+/**
+ * \brief Returns how many updates can be made before drawing the next frame.
+ *
+ * In fixed catch-up mode, this is the max_catch_up_updates quest property.
+ * In adaptive mode, this is also limited to what fits in most of a frame
+ * period according to the recent cost of updates, so that catching up
+ * does not make the next frame even later.
+ *
+ * \param frame_period Duration of a frame in milliseconds.
+ * \return The maximum number of updates, at least 1.
+ */
+int MainLoop::get_max_catch_up_updates(uint32_t frame_period) const {
+
+  if (catch_up_mode != CatchUpMode::ADAPTIVE || average_step_cost == 0) {
+    return max_catch_up_updates;
+  }
+
+  // Keep a quarter of the frame period for drawing.
+  const uint32_t budget = frame_period * 1000 * 3 / 4;
+  const int num_updates = static_cast<int>(budget / average_step_cost);
+  return std::max(1, std::min(num_updates, max_catch_up_updates));
+}
+
+/**
+ * \brief Runs the simulation as fast as possible, without drawing.
+ *
+ * There is no window, no audio and no input events: only Lua commands
+ * from the console are handled. The simulation stops after -max-ticks
+ * updates if set, or when Lua calls sol.main.exit(), for example when a
+ * test condition holds.
+ */
+void MainLoop::run_headless() {
+
+  Logger::info("Simulation started (headless)");
+
+  const uint32_t start_date = System::get_real_time();
+  uint32_t num_ticks = 0;
+  while (!is_exiting() && (max_ticks == 0 || num_ticks < max_ticks)) {
+    check_lua_commands();
+    step();
+    ++num_ticks;
+    FrameStats::get_current_frame().num_updates = 1;
+    FrameStats::finish_frame();
+    lua_context->step_garbage_collector(System::timestep);
+  }
+
+  std::ostringstream oss;
+  oss << "Simulation finished after " << num_ticks << " ticks in "
+      << System::get_real_time() - start_date << " ms";
+  Logger::info(oss.str());
+}
+
 /**
  * \brief Advances the simulation of one tick.
  *
@@ -462,16 +791,49 @@ void MainLoop::run() {
  * Otherwise, use run() to execute the standard main loop.
  */
 void MainLoop::step() {
+
+  PerfTrace::Scope trace_scope("main-loop-step");
+  HitchDetector::Scope hitch_scope(HitchDetector::Phase::STEP);
+
+  // Finish resources preloaded in background.
+  resource_provider.update();
+
+  // Reload assets modified on disk.
+  reload_changed_assets();
+
+  // Log the memory usage from time to time.
+  MemoryUsage::update();
+
+  // Deliver pixels read asynchronously.
+  Video::get_renderer().update_pixel_reads();
+
+  // Notify files written in background.
+  AsyncFileWriter::update();
+
+  // Run the continuations of background jobs.
+  JobSystem::update();
+
+  // Notify jobs finished by Lua workers.
+  LuaWorkers::update();
+
+  replay_input();
+
   if (game != nullptr) {
     game->update();
   }
   lua_context->update();
   System::update();
 
+  if (input_replay.is_hashing() && game != nullptr && game->has_current_map()) {
+    input_replay.check_hash(
+        System::now(), game->get_current_map().get_entities().get_positions_hash());
+  }
+
   // Go to another game?
   if (next_game != game.get()) {
 
     game = std::unique_ptr<Game>(next_game);
+    FrameDamage::notify();
 
     if (game != nullptr) {
       game->start();
@@ -489,6 +851,8 @@ void MainLoop::step() {
  */
 void MainLoop::check_input() {
 
+  HitchDetector::Scope hitch_scope(HitchDetector::Phase::INPUT);
+
   // Check SDL events.
   std::unique_ptr<InputEvent> event = InputEvent::get_event();
   while (event != nullptr) {
@@ -496,7 +860,20 @@ void MainLoop::check_input() {
     event = InputEvent::get_event();
   }
 
-  // Check Lua requests.
+  check_lua_commands();
+}
+
+/**
+ * \brief Runs the Lua commands received from the console if any.
+ */
+void MainLoop::check_lua_commands() {
+
+  if (LauncherChannel::is_open()) {
+    for (const std::string& command : LauncherChannel::take_commands()) {
+      push_lua_command(command);
+    }
+  }
+
   if (!lua_commands.empty()) {
     std::lock_guard<std::mutex> lock(lua_commands_mutex);
     for (const std::string& command : lua_commands) {
@@ -553,6 +930,26 @@ void MainLoop::setup_game_icon() {
  */
 void MainLoop::notify_input(const InputEvent& event) {
 
+  FrameDamage::notify();
+
+  FrameStats::Frame& frame_stats = FrameStats::get_current_frame();
+  const int latency = static_cast<int>(System::get_real_time() - event.get_timestamp());
+  frame_stats.input_latency = std::max(frame_stats.input_latency, latency);
+
+  if (event.is_keyboard_key_pressed(InputEvent::KeyboardKey::F12) && event.is_with_control()) {
+    // Ctrl+F12 toggles the frame statistics overlay.
+    FrameStats::set_overlay_enabled(!FrameStats::is_overlay_enabled());
+    return;
+  }
+
+  if (InputReplay::is_recordable(event)) {
+    if (input_replay.is_replaying()) {
+      // Live events are replaced by the recorded ones.
+      return;
+    }
+    input_replay.record_event(System::now(), event);
+  }
+
   if (event.is_window_closing()) {
     set_exiting();
   }
@@ -585,13 +982,174 @@ void MainLoop::notify_input(const InputEvent& event) {
 #endif
   }
 
-  // Send the event to Lua and to the current screen.
+  dispatch_input(event);
+}
+
+/**
+ * \brief Sends an input event to Lua, and then to the game if Lua did not
+ * handle it.
+ * \param event The input event.
+ */
+void MainLoop::dispatch_input(const InputEvent& event) {
+
   bool handled = lua_context->notify_input(event);
   if (!handled && game != nullptr) {
     game->notify_input(event);
   }
 }
 
+/**
+ * \brief Sends the recorded input events of the current tick if an input
+ * replay is running.
+ *
+ * Events received during a tick were recorded with the simulated time
+ * before its update, so they are replayed just before the same update.
+ */
+void MainLoop::replay_input() {
+
+  if (!input_replay.is_replaying()) {
+    return;
+  }
+
+  SDL_Event internal_event;
+  while (input_replay.pop_event(System::now(), internal_event)) {
+    FrameDamage::notify();
+    dispatch_input(*InputEvent::make_event(internal_event));
+  }
+}
+
+/**
+ * \brief Reloads the assets whose files were modified, if hot reload is
+ * enabled.
+ *
+ * Sprites, tilesets, images and sounds already loaded are reloaded in place,
+ * so that the objects using them switch to the new version.
+ * The video shader and the post-processing shaders are created again if
+ * their files changed.
+ */
+void MainLoop::reload_changed_assets() {
+
+  if (!asset_watcher.is_started()) {
+    return;
+  }
+
+  const std::vector<std::string>& file_names = asset_watcher.take_changed_files();
+  if (file_names.empty()) {
+    return;
+  }
+
+  const auto& remove_suffix = [](const std::string& name, const std::string& suffix, std::string& id) {
+    if (name.size() <= suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+      return false;
+    }
+    id = name.substr(0, name.size() - suffix.size());
+    return true;
+  };
+
+  // Images first, so that reloaded sprites and tilesets use the new ones.
+  std::set<std::string> tileset_ids;
+  std::set<std::string> sprite_ids;
+  std::set<std::string> sound_ids;
+  std::set<std::string> shader_file_names;
+  for (const std::string& file_name : file_names) {
+    Logger::info("Asset changed: '" + file_name + "'");
+    const size_t slash = file_name.find('/');
+    const std::string& dir_name = file_name.substr(0, slash);
+    const std::string& name = file_name.substr(slash + 1);
+    std::string id;
+    if (dir_name == "tilesets") {
+      if (remove_suffix(name, ".tiles.png", id) ||
+          remove_suffix(name, ".entities.png", id) ||
+          remove_suffix(name, ".dat", id)) {
+        tileset_ids.insert(id);
+      }
+    }
+    else if (dir_name == "sprites" && remove_suffix(name, ".dat", id)) {
+      sprite_ids.insert(id);
+    }
+    else if (dir_name == "sprites" || dir_name == "images") {
+      Surface::reload_image(file_name);
+    }
+    else if (dir_name == "sounds" && remove_suffix(name, ".ogg", id)) {
+      sound_ids.insert(id);
+    }
+    else if (dir_name == "shaders") {
+      shader_file_names.insert(name);
+    }
+  }
+
+  for (const std::string& sprite_id : sprite_ids) {
+    if (CurrentQuest::resource_exists(ResourceType::SPRITE, sprite_id)) {
+      resource_provider.invalidate_resource_element(ResourceType::SPRITE, sprite_id);
+    }
+  }
+
+  for (const std::string& sound_id : sound_ids) {
+    if (CurrentQuest::resource_exists(ResourceType::SOUND, sound_id)) {
+      resource_provider.invalidate_resource_element(ResourceType::SOUND, sound_id);
+    }
+  }
+
+  for (const std::string& tileset_id : tileset_ids) {
+    if (!CurrentQuest::resource_exists(ResourceType::TILESET, tileset_id)) {
+      continue;
+    }
+    resource_provider.invalidate_resource_element(ResourceType::TILESET, tileset_id);
+    if (game != nullptr && game->has_current_map()) {
+      Map& map = game->get_current_map();
+      if (map.get_tileset_id() == tileset_id) {
+        // Give the new tile patterns to the tiles.
+        map.set_tileset(tileset_id);
+      }
+    }
+  }
+
+  if (shader_file_names.empty()) {
+    return;
+  }
+
+  // Shaders created by scripts are not tracked: only replace the ones
+  // of the video, with their default uniform values.
+  const auto& reload_shader = [&shader_file_names](const ShaderPtr& shader) {
+    if (shader == nullptr || shader->get_id().empty()) {
+      return shader;
+    }
+    const ShaderData& data = shader->get_data();
+    if (shader_file_names.find(shader->get_id() + ".dat") == shader_file_names.end() &&
+        shader_file_names.find(data.get_vertex_file()) == shader_file_names.end() &&
+        shader_file_names.find(data.get_fragment_file()) == shader_file_names.end()) {
+      return shader;
+    }
+    ShaderPtr new_shader = Video::get_renderer().create_shader(shader->get_id());
+    if (new_shader == nullptr || !new_shader->is_valid()) {
+      Debug::error("Cannot reload shader '" + shader->get_id() + "': " +
+          (new_shader == nullptr ? std::string() : new_shader->get_error()));
+      return shader;
+    }
+    return new_shader;
+  };
+
+  const ShaderPtr& shader = Video::get_shader();
+  const ShaderPtr& new_shader = reload_shader(shader);
+  if (new_shader != shader) {
+    Video::set_shader(new_shader);
+  }
+
+  std::vector<ShaderPtr> post_effects = Video::get_post_effects();
+  bool post_effects_changed = false;
+  for (ShaderPtr& post_effect : post_effects) {
+    const ShaderPtr& new_post_effect = reload_shader(post_effect);
+    if (new_post_effect != post_effect) {
+      post_effect = new_post_effect;
+      post_effects_changed = true;
+    }
+  }
+  if (post_effects_changed) {
+    Video::set_post_effects(post_effects);
+  }
+}
+
 /**
  * \brief Redraws the current screen.
  *
@@ -599,15 +1157,134 @@ void MainLoop::notify_input(const InputEvent& event) {
  */
 void MainLoop::draw() {
 
+  PerfTrace::Scope trace_scope("main-loop-draw");
+
+  const uint64_t start_date = System::get_real_time_us();
+  FrameDamage::start_drawing();
   root_surface->clear();
 
   if (game != nullptr) {
     game->draw(root_surface);
   }
   lua_context->main_on_draw(root_surface);
+  if (FrameStats::is_overlay_enabled()) {
+    draw_frame_stats();
+  }
   Video::render(root_surface);
   lua_context->video_on_draw(Video::get_screen_surface());
+
+  const uint64_t present_date = System::get_real_time_us();
   Video::finish();
+  FrameDamage::finish_drawing();
+
+  FrameStats::Frame& frame_stats = FrameStats::get_current_frame();
+  frame_stats.draw_time = static_cast<int>(present_date - start_date);
+  frame_stats.present_time = static_cast<int>(System::get_real_time_us() - present_date);
+  if (HitchDetector::is_enabled()) {
+    HitchDetector::add_time(HitchDetector::Phase::DRAW, frame_stats.draw_time);
+    HitchDetector::add_time(HitchDetector::Phase::PRESENT, frame_stats.present_time);
+  }
+  const Renderer::FrameStats& renderer_stats = Video::get_renderer().get_last_frame_stats();
+  frame_stats.draw_calls = renderer_stats.draw_calls;
+  frame_stats.texture_uploads = renderer_stats.texture_uploads;
+}
+
+/**
+ * \brief Draws the statistics of the last frames over the quest surface.
+ *
+ * Values are averaged over the last half second to be readable.
+ * Nothing is drawn if the quest has no font.
+ */
+void MainLoop::draw_frame_stats() {
+
+  const std::vector<FrameStats::Frame> frames = FrameStats::get_last_frames(30);
+  if (frames.empty() || FontResource::get_default_font_id().empty()) {
+    return;
+  }
+
+  FrameStats::Frame sum;
+  for (const FrameStats::Frame& frame : frames) {
+    sum.num_updates += frame.num_updates;
+    sum.update_time += frame.update_time;
+    sum.draw_time += frame.draw_time;
+    sum.present_time += frame.present_time;
+    sum.dropped_time += frame.dropped_time;
+    sum.draw_calls += frame.draw_calls;
+    sum.texture_uploads += frame.texture_uploads;
+    sum.entities_updated += frame.entities_updated;
+    sum.entities_drawn += frame.entities_drawn;
+    sum.quadtree_queries += frame.quadtree_queries;
+    sum.obstacle_tests += frame.obstacle_tests;
+    sum.detector_checks += frame.detector_checks;
+    sum.lua_calls += frame.lua_calls;
+    sum.input_latency = std::max(sum.input_latency, frame.input_latency);
+  }
+  const FrameStats::Frame& last = frames.back();
+  const double num_frames = static_cast<double>(frames.size());
+
+  std::vector<std::string> lines(5);
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2)
+      << "upd " << sum.num_updates / num_frames
+      << " sim " << sum.update_time / num_frames / 1000.0 << "ms"
+      << " draw " << sum.draw_time / num_frames / 1000.0 << "ms"
+      << " present " << sum.present_time / num_frames / 1000.0 << "ms";
+  lines[0] = oss.str();
+  oss.str("");
+  oss << std::fixed << std::setprecision(1)
+      << "dropped " << sum.dropped_time << "ms"
+      << " calls " << sum.draw_calls / num_frames
+      << " uploads " << sum.texture_uploads;
+  lines[1] = oss.str();
+  oss.str("");
+  oss << std::fixed << std::setprecision(1)
+      << "entities upd " << sum.entities_updated / num_frames
+      << " drawn " << sum.entities_drawn / num_frames;
+  lines[2] = oss.str();
+  oss.str("");
+  oss << "lua " << last.lua_memory << "KiB audio ";
+  if (last.audio_buffer_fill >= 0) {
+    oss << last.audio_buffer_fill << "%";
+  }
+  else {
+    oss << "-";
+  }
+  oss << " input " << sum.input_latency << "ms";
+  lines[3] = oss.str();
+  oss.str("");
+  oss << std::fixed << std::setprecision(0)
+      << "quadtree " << sum.quadtree_queries / num_frames
+      << " obstacles " << sum.obstacle_tests / num_frames
+      << " detectors " << sum.detector_checks / num_frames
+      << " lua calls " << sum.lua_calls / num_frames;
+  lines[4] = oss.str();
+
+  if (frame_stats_lines.size() != lines.size()) {
+    frame_stats_lines.clear();
+    for (size_t i = 0; i < lines.size(); ++i) {
+      std::shared_ptr<TextSurface> line_surface = std::make_shared<TextSurface>(
+          2,
+          2 + static_cast<int>(i) * 10,
+          TextSurface::HorizontalAlignment::LEFT,
+          TextSurface::VerticalAlignment::TOP
+      );
+      line_surface->set_font_size(8);
+      frame_stats_lines.push_back(line_surface);
+    }
+  }
+
+  int width = 0;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    frame_stats_lines[i]->set_text(lines[i]);
+    width = std::max(width, frame_stats_lines[i]->get_width());
+  }
+  root_surface->fill_with_color(
+      Color(0, 0, 0, 160),
+      Rectangle(0, 0, width + 4, static_cast<int>(lines.size()) * 10 + 4)
+  );
+  for (const std::shared_ptr<TextSurface>& line_surface : frame_stats_lines) {
+    line_surface->draw(root_surface);
+  }
 }
 
 /**
@@ -642,6 +1319,12 @@ void MainLoop::load_quest_properties() {
       properties.get_min_quest_size(),
       properties.get_max_quest_size()
   );
+
+  catch_up_mode = properties.get_catch_up_mode();
+  max_catch_up_updates = properties.get_max_catch_up_updates();
+  lag_drop_threshold = static_cast<uint32_t>(properties.get_lag_drop_threshold());
+
+  Music::set_quest_quality(properties.get_music_quality());
 }
 
 /**
@@ -17,10 +17,13 @@
 #include "solarus/audio/Music.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
+#include "solarus/core/HitchDetector.h"
+#include "solarus/core/HotCounters.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Savegame.h"
+#include "solarus/core/System.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/GroundInfo.h"
@@ -32,6 +35,11 @@
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <set>
+#include <vector>
 
 namespace Solarus {
 
@@ -54,7 +62,13 @@ Map::Map(const std::string& id):
   loaded(false),
   started(false),
   destination_name(""),
+  arena(nullptr),
   entities(nullptr),
+  path_finding_scheduler(*this),
+  flow_fields(),
+  chunk_size(),
+  chunk_margin(0),
+  active_chunks(),
   suspended(false) {
 
 }
@@ -264,7 +278,11 @@ void Map::unload() {
     tileset = nullptr;
     background_surface = nullptr;
     foreground_surface = nullptr;
+    path_finding_scheduler.clear();
+    flow_fields.clear();
+    active_chunks.clear();
     entities = nullptr;
+    arena = nullptr;  // Frees most of the map data at once.
 
     loaded = false;
   }
@@ -279,23 +297,30 @@ void Map::unload() {
  */
 void Map::load(Game& game) {
 
+  HitchDetector::Scope hitch_scope(HitchDetector::Phase::MAP_LOAD);
+
   background_surface = Surface::create(
       Video::get_quest_size()
   );
 
-  // Read the map data file.
-  MapData data;
-  const std::string& file_name = std::string("maps/") + get_id() + ".dat";
-  bool success = data.import_from_quest_file(file_name);
-
-  if (!success) {
-    Debug::die("Failed to load map data file '" + file_name + "'");
+  // Read the map data file, unless it was preloaded.
+  ResourceProvider& resource_provider = game.get_resource_provider();
+  std::shared_ptr<MapData> preloaded_data = resource_provider.take_map_data(get_id());
+  if (preloaded_data == nullptr) {
+    preloaded_data = std::make_shared<MapData>();
+    const std::string& file_name = std::string("maps/") + get_id() + ".dat";
+    bool success = preloaded_data->import_from_quest_file(file_name);
+
+    if (!success) {
+      Debug::die("Failed to load map data file '" + file_name + "'");
+    }
   }
+  resource_provider.keep_recent_map_data(get_id(), preloaded_data);
+  const MapData& data = *preloaded_data;
 
   // Initialize the map from the data just read.
   this->savegame = std::static_pointer_cast<Savegame>(
         game.get_savegame().shared_from_this());  // TODO make Game::get_savegame() return a shared_ptr.
-  ResourceProvider& resource_provider = game.get_resource_provider();
   location.set_xy(data.get_location());
   location.set_size(data.get_size());
   width8 = data.get_size().width / 8;
@@ -307,12 +332,16 @@ void Map::load(Game& game) {
   set_floor(data.get_floor());
   tileset_id = data.get_tileset_id();
   tileset = &resource_provider.get_tileset(tileset_id);
+  arena = std::unique_ptr<MonotonicArena>(new MonotonicArena());
   entities = std::unique_ptr<Entities>(new Entities(game, *this));
   entities->create_entities(data);
 
   build_background_surface();
   build_foreground_surface();
 
+  // Maps reachable from here will probably be needed soon.
+  resource_provider.preload_map_neighbors(data);
+
   loaded = true;
 }
 
@@ -507,9 +536,203 @@ void Map::update() {
 
   // Update the elements.
   entities->update();
+  if (!suspended) {
+    path_finding_scheduler.update();
+    remove_unused_flow_fields();
+  }
+  update_chunks();
   get_lua_context().map_on_update(*this);
 }
 
+/**
+ * \brief Returns a flow field toward an entity, up to date.
+ *
+ * Entities that consider the same grounds as obstacles share the same field.
+ *
+ * \param target The entity to reach.
+ * \param source An entity that wants to reach the target.
+ * \return The flow field. It remains valid until the next cycle.
+ */
+FlowField& Map::get_flow_field(const EntityPtr& target, Entity& source) {
+
+  const uint32_t ground_obstacles = source.get_ground_obstacles();
+  FlowField* flow_field = nullptr;
+  for (const std::unique_ptr<FlowField>& existing_flow_field : flow_fields) {
+    if (existing_flow_field->get_target() == target &&
+        existing_flow_field->get_ground_obstacles() == ground_obstacles) {
+      flow_field = existing_flow_field.get();
+      break;
+    }
+  }
+
+  if (flow_field == nullptr) {
+    flow_fields.emplace_back(new FlowField(target, ground_obstacles));
+    flow_field = flow_fields.back().get();
+  }
+
+  flow_field->update(*this, source);
+  return *flow_field;
+}
+
+/**
+ * \brief Destroys the flow fields that were not used recently.
+ */
+void Map::remove_unused_flow_fields() {
+
+  const uint32_t now = System::now();
+  flow_fields.erase(std::remove_if(flow_fields.begin(), flow_fields.end(),
+      [now](const std::unique_ptr<FlowField>& flow_field) {
+    return flow_field->get_target()->is_being_removed() ||
+        now >= flow_field->get_last_use_date() + 5000;
+  }), flow_fields.end());
+}
+
+/**
+ * \brief Returns whether this map is split into chunks.
+ * \return \c true if chunk events are enabled.
+ */
+bool Map::is_chunked() const {
+  return !chunk_size.is_flat();
+}
+
+/**
+ * \brief Returns the size of the chunks of this map.
+ * \return The chunk size, or an empty size if the map is not chunked.
+ */
+const Size& Map::get_chunk_size() const {
+  return chunk_size;
+}
+
+/**
+ * \brief Returns the number of chunks kept active around the camera.
+ * \return The margin in chunks.
+ */
+int Map::get_chunk_margin() const {
+  return chunk_margin;
+}
+
+/**
+ * \brief Splits this map into chunks or stops doing so.
+ *
+ * Chunks overlapping the camera, plus a margin of chunks around it,
+ * are active. The map script is notified when a chunk becomes active or
+ * inactive, so that it can create or remove the content of that chunk.
+ * Active chunks of the previous size are deactivated first.
+ *
+ * \param chunk_size The chunk size, or an empty size to disable chunks.
+ * \param chunk_margin Number of chunks to keep active around the camera.
+ */
+void Map::set_chunk_size(const Size& chunk_size, int chunk_margin) {
+
+  Debug::check_assertion(chunk_size.is_flat() ||
+      (chunk_size.width > 0 && chunk_size.height > 0), "Invalid chunk size");
+  Debug::check_assertion(chunk_margin >= 0, "Invalid chunk margin");
+
+  if (chunk_size == this->chunk_size && chunk_margin == this->chunk_margin) {
+    return;
+  }
+
+  deactivate_chunks();
+  this->chunk_size = chunk_size;
+  this->chunk_margin = chunk_margin;
+  update_chunks();
+}
+
+/**
+ * \brief Returns whether a chunk of this map is currently active.
+ * \param column Column of the chunk.
+ * \param row Row of the chunk.
+ * \return \c true if this chunk is active.
+ */
+bool Map::is_chunk_active(int column, int row) const {
+
+  if (!is_chunked()) {
+    return false;
+  }
+
+  const int num_columns = (get_width() + chunk_size.width - 1) / chunk_size.width;
+  if (column < 0 || column >= num_columns || row < 0) {
+    return false;
+  }
+  return active_chunks.find(row * num_columns + column) != active_chunks.end();
+}
+
+/**
+ * \brief Activates chunks that entered the camera area and
+ * deactivates the ones that left it.
+ *
+ * Deactivations are notified before activations so that scripts can
+ * release the content of old chunks before creating the new one.
+ */
+void Map::update_chunks() {
+
+  if (!is_chunked() || !is_started()) {
+    return;
+  }
+
+  const int num_columns = (get_width() + chunk_size.width - 1) / chunk_size.width;
+  const int num_rows = (get_height() + chunk_size.height - 1) / chunk_size.height;
+  const Rectangle& view = get_camera()->get_bounding_box();
+  const int min_x = std::max(0, view.get_x());
+  const int min_y = std::max(0, view.get_y());
+  const int max_x = std::min(get_width(), view.get_x() + view.get_width()) - 1;
+  const int max_y = std::min(get_height(), view.get_y() + view.get_height()) - 1;
+
+  std::set<int> visible_chunks;
+  if (max_x >= min_x && max_y >= min_y) {
+    const int first_column = std::max(0, min_x / chunk_size.width - chunk_margin);
+    const int last_column = std::min(num_columns - 1, max_x / chunk_size.width + chunk_margin);
+    const int first_row = std::max(0, min_y / chunk_size.height - chunk_margin);
+    const int last_row = std::min(num_rows - 1, max_y / chunk_size.height + chunk_margin);
+    for (int row = first_row; row <= last_row; ++row) {
+      for (int column = first_column; column <= last_column; ++column) {
+        visible_chunks.insert(row * num_columns + column);
+      }
+    }
+  }
+
+  if (visible_chunks == active_chunks) {
+    return;
+  }
+
+  std::vector<int> deactivated;
+  std::set_difference(active_chunks.begin(), active_chunks.end(),
+      visible_chunks.begin(), visible_chunks.end(), std::back_inserter(deactivated));
+  std::vector<int> activated;
+  std::set_difference(visible_chunks.begin(), visible_chunks.end(),
+      active_chunks.begin(), active_chunks.end(), std::back_inserter(activated));
+  active_chunks = std::move(visible_chunks);
+
+  LuaContext& lua_context = get_lua_context();
+  for (int index : deactivated) {
+    lua_context.map_on_chunk_deactivated(*this, index % num_columns, index / num_columns);
+  }
+  for (int index : activated) {
+    if (active_chunks.find(index) == active_chunks.end()) {
+      // Chunks changed again during a previous event.
+      continue;
+    }
+    lua_context.map_on_chunk_activated(*this, index % num_columns, index / num_columns);
+  }
+}
+
+/**
+ * \brief Deactivates all chunks of this map.
+ */
+void Map::deactivate_chunks() {
+
+  if (active_chunks.empty()) {
+    return;
+  }
+
+  const int num_columns = (get_width() + chunk_size.width - 1) / chunk_size.width;
+  const std::set<int> deactivated = std::move(active_chunks);
+  active_chunks.clear();
+  for (int index : deactivated) {
+    get_lua_context().map_on_chunk_deactivated(*this, index % num_columns, index / num_columns);
+  }
+}
+
 /**
  * \brief Returns whether the map is currently suspended.
  * \return true if the map is suspended.
@@ -549,6 +772,12 @@ void Map::draw() {
     return;
   }
 
+  // When drawing between two updates, temporarily move the camera between
+  // its previous and current positions, like other entities.
+  Camera& camera = *get_camera();
+  const Point camera_xy = camera.get_top_left_xy();
+  camera.set_top_left_xy(camera_xy + camera.get_interpolation_offset());
+
   // background
   draw_background(camera_surface);
 
@@ -560,6 +789,8 @@ void Map::draw() {
 
   // Lua
   get_lua_context().map_on_draw(*this, camera_surface);
+
+  camera.set_top_left_xy(camera_xy);
 }
 
 /**
@@ -731,6 +962,8 @@ void Map::draw_visual(Drawable& drawable, int x, int y,
  */
 void Map::start() {
 
+  HitchDetector::Scope hitch_scope(HitchDetector::Phase::MAP_LOAD);
+
   this->started = true;
 
   Music::play(music_id, true);
@@ -747,6 +980,7 @@ void Map::start() {
  */
 void Map::leave() {
   started = false;
+  active_chunks.clear();
   get_lua_context().map_on_finished(*this);
   this->entities->notify_map_finished();
 }
@@ -902,8 +1136,10 @@ bool Map::test_collision_with_entities(
     return false;
   }
 
+  // The order does not matter here since we only want to know if there is
+  // an obstacle, but is_obstacle_for() may call Lua so we cannot use a visitor.
   EntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle_z_sorted(collision_box, entities_nearby);
+  get_entities().get_entities_in_rectangle(collision_box, entities_nearby);
   for (const EntityPtr& entity_nearby: entities_nearby) {
 
     if (entity_nearby->overlaps(collision_box) &&
@@ -933,11 +1169,52 @@ bool Map::test_collision_with_obstacles(
     const Rectangle& collision_box,
     Entity& entity_to_check) {
 
+  SOLARUS_HOT_COUNT(OBSTACLE_TESTS);
+
   // This function is called very often.
   // For performance reasons, we only check the border of the of the collision box.
 
   // Collisions with the terrain
   // (i.e., tiles and dynamic entities that may change it).
+  if (test_collision_with_ground(layer, collision_box, entity_to_check)) {
+    return true;
+  }
+
+  // No collision with the terrain: check collisions with dynamic entities.
+  return test_collision_with_entities(layer, collision_box, entity_to_check);
+}
+
+/**
+ * \brief Tests whether the border of a rectangle collides with the terrain.
+ *
+ * The terrain is made of tiles and of dynamic entities that modify the ground.
+ * When the size of the rectangle is a multiple of 8, the walkability grid
+ * of the map is used to avoid testing each point.
+ *
+ * \param layer Layer of the rectangle in the map.
+ * \param collision_box The rectangle to check (its dimensions should be
+ * multiples of 8).
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \return \c true if the border of the rectangle overlaps an obstacle ground.
+ */
+bool Map::test_collision_with_ground(
+    int layer,
+    const Rectangle& collision_box,
+    const Entity& entity_to_check) {
+
+  if (entities != nullptr &&
+      ((collision_box.get_width() | collision_box.get_height()) & 7) == 0) {
+    const WalkabilityGrid::Result result = entities->get_walkability_grid().test_collision(
+        layer,
+        collision_box,
+        entity_to_check.get_ground_obstacles()
+    );
+    if (result != WalkabilityGrid::Result::UNKNOWN) {
+      return result == WalkabilityGrid::Result::OBSTACLE;
+    }
+  }
+
   const int x1 = collision_box.get_x();
   const int x2 = x1 + collision_box.get_width() - 1;
   const int y1 = collision_box.get_y();
@@ -988,8 +1265,7 @@ bool Map::test_collision_with_obstacles(
     }
   }
 
-  // No collision with the terrain: check collisions with dynamic entities.
-  return test_collision_with_entities(layer, collision_box, entity_to_check);
+  return false;
 }
 
 /**
@@ -1008,6 +1284,8 @@ bool Map::test_collision_with_obstacles(
     Entity& entity_to_check
 ) {
 
+  SOLARUS_HOT_COUNT(OBSTACLE_TESTS);
+
   bool is_diagonal_wall = false;
 
   // Test the terrain.
@@ -1038,6 +1316,132 @@ bool Map::test_collision_with_obstacles(
   return test_collision_with_obstacles(layer, point.x, point.y, entity_to_check);
 }
 
+/**
+ * \brief Returns how many steps a rectangle can make along a vector
+ * without colliding with the map obstacles.
+ *
+ * This gives the same result as calling test_collision_with_obstacles()
+ * on each translated rectangle in turn, as long as the initial rectangle
+ * does not already contain obstacle ground, but it is much faster:
+ * obstacle entities are looked up only once for the whole sweep, and
+ * for horizontal and vertical steps only the front edge of each
+ * rectangle is tested against the ground.
+ *
+ * \param layer Layer of the rectangle in the map.
+ * \param collision_box The rectangle before moving (its dimensions should
+ * be multiples of 8).
+ * \param step Translation of each step. Coordinates must be -1, 0 or 1.
+ * \param max_steps Maximum number of steps to check.
+ * \param entity_to_check The entity to check (used to decide what is
+ * considered as obstacle).
+ * \return The number of steps that can be made, between 0 and max_steps.
+ */
+int Map::get_free_distance(
+    int layer,
+    const Rectangle& collision_box,
+    const Point& step,
+    int max_steps,
+    Entity& entity_to_check) {
+
+  Debug::check_assertion(std::abs(step.x) <= 1 && std::abs(step.y) <= 1,
+      "Steps must be of one pixel");
+
+  if (max_steps <= 0 || step == Point()) {
+    return 0;
+  }
+
+  SOLARUS_HOT_COUNT(OBSTACLE_TESTS);
+
+  // Map border and ground.
+  int num_steps = max_steps;
+  const bool diagonal = step.x != 0 && step.y != 0;
+  bool found_diagonal_wall = false;
+  Rectangle box = collision_box;
+  for (int i = 1; i <= num_steps; ++i) {
+
+    box.add_xy(step);
+    if (test_collision_with_border(box)) {
+      num_steps = i - 1;
+      break;
+    }
+
+    if (i == 1 || diagonal || found_diagonal_wall) {
+      // Test the whole border.
+      if (test_collision_with_ground(layer, box, entity_to_check)) {
+        num_steps = i - 1;
+        break;
+      }
+      continue;
+    }
+
+    // Only the front edge can reach new ground.
+    const int x1 = box.get_x();
+    const int x2 = x1 + box.get_width() - 1;
+    const int y1 = box.get_y();
+    const int y2 = y1 + box.get_height() - 1;
+    bool collision = false;
+    if (step.x != 0) {
+      const int x = step.x > 0 ? x2 : x1;
+      for (int y = y1; y <= y2 && !collision; y += 8) {
+        collision = test_collision_with_ground(layer, x, y, entity_to_check, found_diagonal_wall)
+            || test_collision_with_ground(layer, x, y + 7, entity_to_check, found_diagonal_wall);
+      }
+    }
+    else {
+      const int y = step.y > 0 ? y2 : y1;
+      for (int x = x1; x <= x2 && !collision; x += 8) {
+        collision = test_collision_with_ground(layer, x, y, entity_to_check, found_diagonal_wall)
+            || test_collision_with_ground(layer, x + 7, y, entity_to_check, found_diagonal_wall);
+      }
+    }
+
+    if (!collision && found_diagonal_wall) {
+      // Diagonal walls need all points of the border.
+      collision = test_collision_with_ground(layer, box, entity_to_check);
+    }
+
+    if (collision) {
+      num_steps = i - 1;
+      break;
+    }
+  }
+
+  if (num_steps == 0 || !is_loaded()) {
+    return num_steps;
+  }
+
+  // Obstacle entities: get the ones near the whole sweep at once.
+  Rectangle last_box = collision_box;
+  last_box.add_xy(step * num_steps);
+  EntityVector entities_nearby;
+  get_entities().get_entities_in_rectangle(collision_box | last_box, entities_nearby);
+  for (const EntityPtr& entity_nearby: entities_nearby) {
+
+    if (entity_nearby.get() == &entity_to_check ||
+        (entity_nearby->get_layer() != layer && !entity_nearby->has_layer_independent_collisions()) ||
+        !entity_nearby->is_enabled() ||
+        entity_nearby->is_being_removed()) {
+      continue;
+    }
+
+    box = collision_box;
+    for (int i = 1; i <= num_steps; ++i) {
+      box.add_xy(step);
+      if (entity_nearby->overlaps(box) &&
+          entity_nearby->is_obstacle_for(entity_to_check, box)) {
+        num_steps = i - 1;
+        break;
+      }
+    }
+
+    if (num_steps == 0) {
+      break;
+    }
+  }
+
+  return num_steps;
+}
+
 /**
  * \brief Returns whether there is empty ground in the specified rectangle.
  *
@@ -1125,35 +1529,42 @@ Ground Map::get_ground(
     return Ground::EMPTY;
   }
 
-  // See if a dynamic entity changes the ground.
   const Rectangle box(xy, Size(1, 1));
-  ConstEntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle_z_sorted(box, entities_nearby);
-
-  const auto& rend = entities_nearby.rend();
-  for (auto it = entities_nearby.rbegin(); it != rend; ++it) {
-    const Entity& entity_nearby = *(*it);
+  if (!entities->get_walkability_grid().may_overlap_ground_modifiers(layer, box)) {
+    // No dynamic entity changes the ground here: only tiles matter.
+    return entities->get_tile_ground(layer, xy.x, xy.y);
+  }
 
-    const Ground ground = entity_nearby.get_modified_ground();
+  // See if a dynamic entity changes the ground.
+  // The highest one on the layer wins: no need to sort them all.
+  const Entity* highest_entity = nullptr;
+  get_entities().visit_entities_in_rectangle(box, [&](const EntityPtr& entity) {
+    const Entity& entity_nearby = *entity;
 
     if (&entity_nearby == entity_to_check) {
       // Skip the entity itself.
-      continue;
+      return true;
     }
     // TODO also skip entities above?
 
-    if (ground == Ground::EMPTY) {
+    if (entity_nearby.get_modified_ground() == Ground::EMPTY) {
       // The entity has no influence on the ground.
-      continue;
+      return true;
     }
 
     if (entity_nearby.overlaps(xy) &&
         entity_nearby.get_layer() == layer &&
         entity_nearby.is_enabled() &&
-        !entity_nearby.is_being_removed()
+        !entity_nearby.is_being_removed() &&
+        (highest_entity == nullptr || entity_nearby.get_z() > highest_entity->get_z())
     ) {
-      return get_ground_from_entity(entity_nearby, xy);
+      highest_entity = &entity_nearby;
     }
+    return true;
+  });
+
+  if (highest_entity != nullptr) {
+    return get_ground_from_entity(*highest_entity, xy);
   }
 
   // Otherwise, return the ground defined by static tiles (this is very fast).
@@ -1303,7 +1714,9 @@ Ground Map::get_ground_from_entity(const Entity& entity, const Point& xy) const
  * This function is called by an entity sensitive to the entity detectors
  * when this entity has just moved on the map, or when a detector
  * wants to check this entity.
- * We check whether or not the entity overlaps an entity detector.
+ * We check whether or not the entity overlaps an entity detector,
+ * and then the pixel-precise collisions of its sprites.
+ * Both use the result of a single spatial query.
  * If the map is suspended, this function does nothing.
  *
  * \param entity The entity that has just moved (this entity should have
@@ -1323,15 +1736,29 @@ void Map::check_collision_with_detectors(Entity& entity) {
   // Check this entity with each detector.
 
   // Extend the box because some collision tests work without overlapping.
-  Rectangle box = entity.get_extended_bounding_box(8);
+  // Also include the sprites for pixel-precise collisions.
+  const Rectangle box = entity.get_extended_bounding_box(8);
+  const Rectangle query_box = box | entity.get_max_bounding_box();
+  const bool sprites_outside_box = query_box != box;
   std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle_z_sorted(box, entities_nearby);
+  entities->get_entities_in_rectangle_z_sorted(query_box, entities_nearby);
   for (const EntityPtr& entity_nearby: entities_nearby) {
 
     if (entity.is_being_removed()) {
       return;
     }
 
+    if (sprites_outside_box &&
+        !entity_nearby->get_max_bounding_box().overlaps(box)) {
+      // Only near the sprites.
+      continue;
+    }
+
+    if (!entity_nearby->can_detect(entity)) {
+      // Rejected by the collision filter of the detector.
+      continue;
+    }
+
     if (!entity_nearby->is_detector()) {
       // Most entities are detectors anyway.
       continue;
@@ -1343,6 +1770,77 @@ void Map::check_collision_with_detectors(Entity& entity) {
       entity_nearby->check_collision(entity);
     }
   }
+
+  // Streams baked in the stream field are not detectors.
+  if (!entity.is_being_removed()) {
+    entities->check_stream_field(entity);
+  }
+
+  // Detect pixel-precise collisions with the same candidates.
+  check_sprite_collisions_with_detectors(entity, entities_nearby);
+}
+
+/**
+ * \brief Checks the pixel-precise collisions between the sprites of an entity
+ * and the detectors of the map.
+ *
+ * Only sprites that have pixel-precise collisions enabled are checked.
+ * Detectors are searched once for all sprites.
+ * If the map is suspended, this function does nothing.
+ *
+ * \param entity A map entity.
+ */
+void Map::check_sprite_collisions_with_detectors(Entity& entity) {
+
+  if (suspended) {
+    return;
+  }
+
+  if (!entity.is_enabled()) {
+    return;
+  }
+
+  std::vector<EntityPtr> entities_nearby;
+  entities->get_entities_in_rectangle_z_sorted(entity.get_max_bounding_box(), entities_nearby);
+  check_sprite_collisions_with_detectors(entity, entities_nearby);
+}
+
+/**
+ * \brief Checks the pixel-precise collisions between the sprites of an entity
+ * and some detectors.
+ * \param entity A map entity.
+ * \param entities_nearby Entities found near the sprites, in Z order.
+ */
+void Map::check_sprite_collisions_with_detectors(
+    Entity& entity,
+    const std::vector<EntityPtr>& entities_nearby
+) {
+  // Make a copy of the sprites list in case it changes during callbacks.
+  const std::vector<SpritePtr> sprites = entity.get_sprites();
+  for (const SpritePtr& sprite : sprites) {
+
+    if (!sprite->are_pixel_collisions_enabled()) {
+      continue;
+    }
+
+    for (const EntityPtr& entity_nearby: entities_nearby) {
+
+      if (suspended || !entity.is_enabled() || entity.is_being_removed()) {
+        return;
+      }
+
+      if (!entity_nearby->can_detect(entity) ||
+          !entity_nearby->is_detector()) {
+        continue;
+      }
+
+      if (!entity_nearby->is_being_removed()
+          && !entity_nearby->is_suspended()
+          && entity_nearby->is_enabled()) {
+        entity_nearby->check_collision(entity, *sprite);
+      }
+    }
+  }
 }
 
 /**
@@ -1366,7 +1864,10 @@ void Map::check_collision_from_detector(Entity& detector) {
   }
 
   // First check the hero.
-  detector.check_collision(get_entities().get_hero());
+  Hero& hero = get_entities().get_hero();
+  if (detector.can_detect(hero)) {
+    detector.check_collision(hero);
+  }
 
   // Check each entity with this detector.
   Rectangle box = detector.get_extended_bounding_box(8);
@@ -1378,11 +1879,12 @@ void Map::check_collision_from_detector(Entity& detector) {
       return;
     }
 
-    if (entity_nearby->is_enabled() &&
+    if (detector.can_detect(*entity_nearby) &&
+        entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
         !entity_nearby->is_being_removed() &&
         entity_nearby.get() != &detector &&
-        entity_nearby.get() != &get_entities().get_hero()
+        entity_nearby.get() != &hero
     ) {
       detector.check_collision(*entity_nearby);
     }
@@ -1412,7 +1914,10 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
   }
 
   // First check the hero.
-  detector.check_collision(detector_sprite, get_entities().get_hero());
+  Hero& hero = get_entities().get_hero();
+  if (detector.can_detect(hero)) {
+    detector.check_collision(detector_sprite, hero);
+  }
 
   // Check each entity with this detector.
   Rectangle box = detector.get_max_bounding_box();
@@ -1424,11 +1929,12 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
       return;
     }
 
-    if (entity_nearby->is_enabled() &&
+    if (detector.can_detect(*entity_nearby) &&
+        entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
         !entity_nearby->is_being_removed() &&
         entity_nearby.get() != &detector &&
-        entity_nearby.get() != &get_entities().get_hero()
+        entity_nearby.get() != &hero
     ) {
       detector.check_collision(detector_sprite, *entity_nearby);
     }
@@ -1467,7 +1973,8 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
       return;
     }
 
-    if (!entity_nearby->is_detector()) {
+    if (!entity_nearby->can_detect(entity) ||
+        !entity_nearby->is_detector()) {
       continue;
     }
 
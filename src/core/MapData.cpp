@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/MapData.h"
 #include "solarus/entities/EntityTypeInfo.h"
@@ -886,6 +887,18 @@ int l_properties(lua_State* l) {
 
 }  // Anonymous namespace
 
+/**
+ * \brief Counts the estimated size of the map data in the memory usage.
+ */
+void MapData::update_memory_usage() {
+
+  memory_tracker.set_bytes(static_cast<int64_t>(
+      sizeof(MapData) +
+      get_num_entities() * sizeof(EntityData) +
+      named_entities.size() * sizeof(std::pair<const std::string, EntityIndex>)
+  ));
+}
+
 /**
  * \copydoc LuaData::import_from_lua
  */
@@ -900,6 +913,7 @@ bool MapData::import_from_lua(lua_State* l) {
     return false;
   }
 
+  update_memory_usage();
   return true;
 }
 
@@ -939,5 +953,70 @@ bool MapData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool MapData::import_from_binary(BinaryReader& reader) {
+
+  MapData map;
+  map.set_location(reader.read_point());
+  map.set_size(reader.read_size());
+  const int min_layer = reader.read_int();
+  const int max_layer = reader.read_int();
+  if (reader.has_failed() || min_layer > 0 || max_layer < 0) {
+    return false;
+  }
+  map.set_min_layer(min_layer);
+  map.set_max_layer(max_layer);
+  map.set_world(reader.read_string());
+  map.set_floor(reader.read_int());
+  map.set_tileset_id(reader.read_string());
+  map.set_music_id(reader.read_string());
+
+  // Entities are stored in their order, so they keep their index.
+  const size_t num_entities = reader.read_count();
+  EntityData entity;
+  for (size_t i = 0; i < num_entities; ++i) {
+    if (!entity.import_from_binary(reader) ||
+        !map.add_entity(entity).is_valid()) {
+      return false;
+    }
+  }
+
+  if (reader.has_failed() || !reader.is_at_end()) {
+    return false;
+  }
+  *this = std::move(map);
+  update_memory_usage();
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool MapData::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_point(get_location());
+  writer.write_size(get_size());
+  writer.write_int(get_min_layer());
+  writer.write_int(get_max_layer());
+  writer.write_string(get_world());
+  writer.write_int(get_floor());
+  writer.write_string(get_tileset_id());
+  writer.write_string(get_music_id());
+
+  writer.write_uint(static_cast<uint32_t>(get_num_entities()));
+  for (const auto& kvp : entities) {
+    const EntityDataList& layer_entities = kvp.second;
+    for (const EntityData& entity_data : layer_entities.entities) {
+      if (!entity_data.export_to_binary(writer)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
 }  // namespace Solarus
 
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Logger.h"
+#include "solarus/core/MemoryUsage.h"
+#include "solarus/core/System.h"
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+namespace Solarus {
+namespace MemoryUsage {
+
+namespace {
+
+constexpr size_t num_categories = static_cast<size_t>(Category::NUM_CATEGORIES);
+
+std::array<std::atomic<int64_t>, num_categories> bytes;        /**< Bytes of each category. */
+std::array<std::atomic<int64_t>, num_categories> peak_bytes;   /**< Peak of each category. */
+std::array<std::atomic<int64_t>, num_categories> num_objects;  /**< Trackers of each category. */
+
+uint32_t log_period = 0;                  /**< Milliseconds between two log lines, 0 for none. */
+uint32_t next_log_date = 0;               /**< When to log the next line. */
+
+/**
+ * \brief Names of the categories, as shown in the log and to Lua.
+ */
+const std::array<std::string, num_categories> category_names = {{
+    "textures",
+    "sounds",
+    "musics",
+    "lua",
+    "map_data",
+    "tileset_data",
+    "entities"
+}};
+
+/**
+ * \brief Returns the index of a category in the arrays.
+ * \param category A category.
+ * \return Its index.
+ */
+size_t get_index(Category category) {
+  return static_cast<size_t>(category);
+}
+
+/**
+ * \brief Raises the peak of a category if needed.
+ * \param index Index of the category.
+ * \param value Bytes now taken by the category.
+ */
+void update_peak(size_t index, int64_t value) {
+
+  int64_t peak = peak_bytes[index].load(std::memory_order_relaxed);
+  while (value > peak &&
+         !peak_bytes[index].compare_exchange_weak(peak, value, std::memory_order_relaxed)) {
+  }
+}
+
+/**
+ * \brief Formats a number of bytes in mebibytes.
+ * \param value A number of bytes.
+ * \return The text to show.
+ */
+std::string to_mebibytes(int64_t value) {
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1) << (value / (1024.0 * 1024.0)) << " MiB";
+  return oss.str();
+}
+
+}
+
+/**
+ * \brief Starts counting the memory of an object.
+ * \param category Category of the object.
+ * \param bytes Initial size of the object.
+ */
+Tracker::Tracker(Category category, int64_t bytes):
+  category(category),
+  bytes(0) {
+
+  num_objects[get_index(category)].fetch_add(1, std::memory_order_relaxed);
+  set_bytes(bytes);
+}
+
+/**
+ * \brief Counts the memory of a copy of an object.
+ * \param other Tracker of the object copied.
+ */
+Tracker::Tracker(const Tracker& other):
+  Tracker(other.category, other.bytes) {
+
+}
+
+/**
+ * \brief Counts the memory of an object that becomes a copy of another one.
+ * \param other Tracker of the object copied.
+ * \return This tracker.
+ */
+Tracker& Tracker::operator=(const Tracker& other) {
+
+  if (&other != this) {
+    set_bytes(0);
+    num_objects[get_index(category)].fetch_sub(1, std::memory_order_relaxed);
+    category = other.category;
+    num_objects[get_index(category)].fetch_add(1, std::memory_order_relaxed);
+    set_bytes(other.bytes);
+  }
+  return *this;
+}
+
+/**
+ * \brief Stops counting the memory of the object.
+ */
+Tracker::~Tracker() {
+
+  set_bytes(0);
+  num_objects[get_index(category)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * \brief Returns the bytes counted for the object.
+ * \return The size of the object.
+ */
+int64_t Tracker::get_bytes() const {
+  return bytes;
+}
+
+/**
+ * \brief Changes the bytes counted for the object.
+ * \param bytes The new size of the object.
+ */
+void Tracker::set_bytes(int64_t bytes) {
+
+  if (bytes != this->bytes) {
+    add(category, bytes - this->bytes);
+    this->bytes = bytes;
+  }
+}
+
+/**
+ * \brief Counts memory allocated or released by a category.
+ * \param category A category.
+ * \param bytes Bytes allocated, or negative bytes released.
+ */
+void add(Category category, int64_t bytes) {
+
+  const size_t index = get_index(category);
+  const int64_t value = MemoryUsage::bytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  update_peak(index, value);
+}
+
+/**
+ * \brief Sets the memory taken by a category.
+ *
+ * This is for subsystems that already measure their memory themselves.
+ *
+ * \param category A category.
+ * \param bytes Bytes now taken.
+ */
+void set(Category category, int64_t bytes) {
+
+  const size_t index = get_index(category);
+  MemoryUsage::bytes[index].store(bytes, std::memory_order_relaxed);
+  update_peak(index, bytes);
+}
+
+/**
+ * \brief Returns the memory taken by a category.
+ * \param category A category.
+ * \return Its current and peak usage.
+ */
+Usage get(Category category) {
+
+  const size_t index = get_index(category);
+  Usage usage;
+  usage.bytes = bytes[index].load(std::memory_order_relaxed);
+  usage.peak_bytes = peak_bytes[index].load(std::memory_order_relaxed);
+  usage.num_objects = num_objects[index].load(std::memory_order_relaxed);
+  return usage;
+}
+
+/**
+ * \brief Returns the memory taken by all categories.
+ * \return The sum of the bytes of the categories.
+ */
+int64_t get_total_bytes() {
+
+  int64_t total = 0;
+  for (const std::atomic<int64_t>& value : bytes) {
+    total += value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+/**
+ * \brief Returns the name of a category.
+ * \param category A category.
+ * \return Its name in lowercase.
+ */
+const std::string& get_category_name(Category category) {
+  return category_names[get_index(category)];
+}
+
+/**
+ * \brief Sets how often update() logs the memory of each category.
+ * \param log_period Milliseconds between two log lines, or 0 to stop logging.
+ */
+void set_log_period(uint32_t log_period) {
+
+  MemoryUsage::log_period = log_period;
+  next_log_date = System::get_real_time() + log_period;
+}
+
+/**
+ * \brief Logs the memory of each category if the log period has elapsed.
+ *
+ * Called by the main loop at each step.
+ */
+void update() {
+
+  if (log_period == 0) {
+    return;
+  }
+
+  const uint32_t now = System::get_real_time();
+  if (now < next_log_date) {
+    return;
+  }
+  next_log_date = now + log_period;
+
+  std::ostringstream oss;
+  oss << "Memory: " << to_mebibytes(get_total_bytes());
+  for (size_t i = 0; i < num_categories; ++i) {
+    const Usage& usage = get(static_cast<Category>(i));
+    oss << ", " << category_names[i] << " " << to_mebibytes(usage.bytes)
+        << " (peak " << to_mebibytes(usage.peak_bytes) << ")";
+  }
+  Logger::info(oss.str());
+}
+
+}
+}
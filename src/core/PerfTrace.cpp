@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Logger.h"
+#include "solarus/core/PerfTrace.h"
+#include <cstring>
+#include <fstream>
+
+namespace Solarus {
+
+constexpr size_t PerfTrace::capacity;
+constexpr size_t PerfTrace::max_name_length;
+
+bool PerfTrace::enabled = false;
+std::string PerfTrace::file_name;
+std::chrono::steady_clock::time_point PerfTrace::start_time;
+std::vector<PerfTrace::Event> PerfTrace::events;
+size_t PerfTrace::next_event = 0;
+bool PerfTrace::wrapped = false;
+
+namespace {
+
+/**
+ * \brief Writes a string as a JSON string literal.
+ * \param out The stream to write to.
+ * \param value The string to write.
+ */
+void write_json_string(std::ostream& out, const char* value) {
+
+  out << '"';
+  for (const char* c = value; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      out << '\\' << *c;
+    }
+    else if (static_cast<unsigned char>(*c) < 0x20) {
+      out << ' ';
+    }
+    else {
+      out << *c;
+    }
+  }
+  out << '"';
+}
+
+}
+
+/**
+ * \brief Starts recording scopes.
+ *
+ * Scopes recorded before are discarded.
+ *
+ * \param file_name File where the trace will be written by stop().
+ */
+void PerfTrace::start(const std::string& file_name) {
+
+  PerfTrace::file_name = file_name;
+  start_time = std::chrono::steady_clock::now();
+  events.assign(capacity, Event());
+  next_event = 0;
+  wrapped = false;
+  enabled = true;
+  Logger::info("Performance trace started");
+}
+
+/**
+ * \brief Stops recording scopes and writes the trace file.
+ *
+ * Does nothing if the trace was not started.
+ */
+void PerfTrace::stop() {
+
+  if (!enabled) {
+    return;
+  }
+  enabled = false;
+
+  std::ofstream out(file_name);
+  if (!out) {
+    Logger::error("Cannot write performance trace file '" + file_name + "'");
+  }
+  else {
+    // Oldest scopes first.
+    const size_t first = wrapped ? next_event : 0;
+    const size_t num_events = wrapped ? capacity : next_event;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < num_events; ++i) {
+      const Event& event = events[(first + i) % capacity];
+      if (i > 0) {
+        out << ",\n";
+      }
+      out << "{\"name\":";
+      write_json_string(out, event.name);
+      if (event.counter) {
+        out << ",\"cat\":\"solarus\",\"ph\":\"C\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << event.start
+            << ",\"args\":{\"value\":" << event.duration << "}}";
+      }
+      else {
+        out << ",\"cat\":\"solarus\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << event.start
+            << ",\"dur\":" << event.duration << "}";
+      }
+    }
+    out << "\n]}\n";
+    Logger::info("Performance trace written to '" + file_name + "'");
+  }
+
+  std::vector<Event>().swap(events);
+  next_event = 0;
+  wrapped = false;
+}
+
+/**
+ * \brief Stores a measured scope in the ring buffer.
+ * \param name Name of the scope.
+ * \param start Start date in microseconds.
+ * \param end End date in microseconds.
+ */
+void PerfTrace::record(const char* name, int64_t start, int64_t end) {
+
+  Event& event = add_event(name);
+  event.start = start;
+  event.duration = end - start;
+}
+
+/**
+ * \brief Stores the current value of a counter in the ring buffer.
+ *
+ * Does nothing if tracing is disabled.
+ *
+ * \param name Name of the counter.
+ * \param value Its value.
+ */
+void PerfTrace::record_counter(const char* name, int64_t value) {
+
+  if (!enabled) {
+    return;
+  }
+  Event& event = add_event(name);
+  event.start = get_time();
+  event.duration = value;
+  event.counter = true;
+}
+
+/**
+ * \brief Takes the next event of the ring buffer.
+ * \param name Name of the event.
+ * \return The event, to be filled by the caller.
+ */
+PerfTrace::Event& PerfTrace::add_event(const char* name) {
+
+  Event& event = events[next_event];
+  std::strncpy(event.name, name, max_name_length);
+  event.name[max_name_length] = '\0';
+  event.counter = false;
+
+  ++next_event;
+  if (next_event == capacity) {
+    next_event = 0;
+    wrapped = true;
+  }
+  return event;
+}
+
+}  // namespace Solarus
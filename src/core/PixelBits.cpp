@@ -19,18 +19,87 @@
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/System.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/SurfaceImpl.h"
 #include <SDL.h>
 #include <algorithm>
+#include <cmath>
 #include <iostream> // print functions
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SOLARUS_PIXEL_BITS_SSE2
+#  include <emmintrin.h>
+#endif
+
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Restricts a range of x values to the ones where a linear function
+ * is strictly between two bounds.
+ * \param offset Value of the function at x = 0.
+ * \param slope Slope of the function.
+ * \param min Lower bound.
+ * \param max Upper bound.
+ * \param[in,out] first First x value of the range.
+ * \param[in,out] last Last x value of the range.
+ * \return \c false if the resulting range is empty.
+ */
+bool clip_range(double offset, double slope, double min, double max,
+                double& first, double& last) {
+
+  if (std::fabs(slope) < 1e-9) {
+    return offset > min && offset < max;
+  }
+
+  double a = (min - offset) / slope;
+  double b = (max - offset) / slope;
+  if (a > b) {
+    std::swap(a, b);
+  }
+  first = std::max(first, a);
+  last = std::min(last, b);
+  return first <= last;
+}
+
+/**
+ * \brief Returns 32 bits of a row starting at any pixel.
+ * \param row A row of bits.
+ * \param x Index of the first bit, must be inside the row.
+ * \return The bits, 0 after the end of the row.
+ */
+uint32_t get_bits(const std::vector<uint32_t>& row, int x) {
+
+  const size_t index = x >> 5;
+  const int shift = x & 31;
+  uint32_t result = row[index] << shift;
+  if (shift != 0 && index + 1 < row.size()) {
+    result |= row[index + 1] >> (32 - shift);
+  }
+  return result;
+}
+
+}
+
 /**
  * \brief Creates a pixel bits object.
  * \param surface The surface where the image is.
  * \param image_position Position of the image on this surface.
  */
 PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
+  PixelBits(surface.get_impl(), image_position) {
+}
+
+/**
+ * \brief Creates a pixel bits object.
+ *
+ * Pixels are read from the SDL surface kept on the CPU side, so there is
+ * no read-back from the GPU unless the surface was drawn on.
+ *
+ * \param surface The surface where the image is.
+ * \param image_position Position of the image on this surface.
+ */
+PixelBits::PixelBits(const SurfaceImpl& surface, const Rectangle& image_position):
   width(0),
   height(0),
   nb_integers_per_row(0),
@@ -41,7 +110,7 @@ PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
 
   // Clip the rectangle passed as parameter.
   const Rectangle clipped_image_position(
-      image_position.get_intersection(Rectangle(surface.get_size()))
+      image_position.get_intersection(Rectangle(Size(surface.get_width(), surface.get_height())))
   );
 
   if (clipped_image_position.is_flat()) {
@@ -56,11 +125,18 @@ PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
     nb_integers_per_row++;
   }
 
-  int pixel_index = clipped_image_position.get_y() * surface.get_width() + clipped_image_position.get_x();
+  const SDL_Surface* sdl_surface = surface.get_surface();
+  Debug::check_assertion(sdl_surface->format->BytesPerPixel == 4 && sdl_surface->format->Amask != 0,
+      "Surface is not in RGBA format");
+  const uint32_t alpha_mask = sdl_surface->format->Amask;
+  const uint8_t* first_row = static_cast<const uint8_t*>(sdl_surface->pixels) +
+      clipped_image_position.get_y() * sdl_surface->pitch +
+      clipped_image_position.get_x() * 4;
 
   bits.resize(height);
   for (int i = 0; i < height; ++i) {
     bits[i].resize(nb_integers_per_row);
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(first_row + i * sdl_surface->pitch);
 
     // Fill the bits for this row, using nb_integers_per_row sequences of 32 bits.
     int k = -1;
@@ -74,14 +150,108 @@ PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
       }
 
       // If the pixel is opaque.
-      if (!surface.is_pixel_transparent(pixel_index)) {
+      if ((pixels[j] & alpha_mask) != 0) {
         bits[i][k] |= mask;
       }
 
       mask >>= 1;
-      ++pixel_index;
     }
-    pixel_index += surface.get_width() - width;
+  }
+
+  compute_extents();
+}
+
+/**
+ * \brief Creates a pixel bits object from opacity values.
+ * \param size Size of the image.
+ * \param opaque_pixels Whether each pixel is opaque, row by row.
+ * Must contain size.width * size.height values.
+ */
+PixelBits::PixelBits(const Size& size, const std::vector<bool>& opaque_pixels):
+  width(0),
+  height(0),
+  nb_integers_per_row(0),
+  bits() {
+
+  Debug::check_assertion(opaque_pixels.size() == static_cast<size_t>(size.width * size.height),
+      "Wrong number of pixels");
+
+  if (size.is_flat()) {
+    return;
+  }
+
+  width = size.width;
+  height = size.height;
+  nb_integers_per_row = (width + 31) >> 5;
+
+  bits.resize(height);
+  for (int i = 0; i < height; ++i) {
+    bits[i].resize(nb_integers_per_row, 0x00000000);
+    for (int j = 0; j < width; ++j) {
+      if (opaque_pixels[i * width + j]) {
+        bits[i][j >> 5] |= 0x80000000 >> (j & 31);
+      }
+    }
+  }
+
+  compute_extents();
+}
+
+/**
+ * \brief Computes the range of opaque pixels of each row,
+ * the bounding box of all opaque pixels and the mask of 8x8 blocks.
+ */
+void PixelBits::compute_extents() {
+
+  const int nb_blocks_x = (width + 7) >> 3;
+  const int nb_blocks_y = (height + 7) >> 3;
+  block_bits.assign(nb_blocks_y, std::vector<uint32_t>((nb_blocks_x + 31) >> 5, 0x00000000));
+
+  row_extents.assign(height, RowExtent());
+  int min_x = width;
+  int max_x = -1;
+  int min_y = height;
+  int max_y = -1;
+  for (int i = 0; i < height; ++i) {
+    RowExtent& extent = row_extents[i];
+    std::vector<uint32_t>& block_row = block_bits[i >> 3];
+    for (int k = 0; k < nb_integers_per_row; ++k) {
+      const uint32_t mask = bits[i][k];
+      if (mask == 0x00000000) {
+        continue;
+      }
+
+      // Each byte of the mask is a row of a block.
+      for (int b = 0; b < 4; ++b) {
+        if (((mask << (b * 8)) & 0xFF000000) != 0) {
+          const int block_x = k * 4 + b;
+          block_row[block_x >> 5] |= 0x80000000 >> (block_x & 31);
+        }
+      }
+
+      int first_bit = 0;
+      while (((mask << first_bit) & 0x80000000) == 0) {
+        ++first_bit;
+      }
+      int last_bit = 31;
+      while (((mask >> (31 - last_bit)) & 1) == 0) {
+        --last_bit;
+      }
+      if (extent.last == -1) {
+        extent.first = k * 32 + first_bit;
+      }
+      extent.last = k * 32 + last_bit;
+    }
+    if (extent.last != -1) {
+      min_x = std::min(min_x, extent.first);
+      max_x = std::max(max_x, extent.last);
+      min_y = std::min(min_y, i);
+      max_y = i;
+    }
+  }
+
+  if (max_y != -1) {
+    opaque_box = Rectangle(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
   }
 }
 
@@ -99,131 +269,67 @@ bool PixelBits::test_aligned_collision(const PixelBits& other,
 ) const {
   const bool debug_pixel_collisions = false;
 
-  if (bits.empty()) {
-    // No image.
+  if (opaque_box.is_flat() || other.opaque_box.is_flat()) {
+    // No opaque pixel.
     return false;
   }
 
-  // Compute both bounding boxes.
-  const Rectangle bounding_box1(location1.x, location1.y, width, height);
-  const Rectangle bounding_box2(location2.x, location2.y, other.width, other.height);
+  // Compute both bounding boxes of opaque pixels.
+  const Rectangle bounding_box1(location1 + opaque_box.get_xy(), opaque_box.get_size());
+  const Rectangle bounding_box2(location2 + other.opaque_box.get_xy(), other.opaque_box.get_size());
 
   // Check collision between the two bounding boxes.
   if (!bounding_box1.overlaps(bounding_box2)) {
     return false;
   }
 
+  const Rectangle intersection = bounding_box1.get_intersection(bounding_box2);
+
   if (debug_pixel_collisions) {
     std::cout << System::now() << "\n bounding box collision\n";
     std::cout << "rect1 = " << bounding_box1 << "\n";
     std::cout << "rect2 = " << bounding_box2 << "\n";
+    std::cout << "intersection: " << intersection << "\n";
     print();
     other.print();
   }
 
-  // Compute the intersection between both rectangles.
-  const int intersection_x = std::max(bounding_box1.get_x(), bounding_box2.get_x());
-  const int intersection_y = std::max(bounding_box1.get_y(), bounding_box2.get_y());
-  const Rectangle intersection(
-      intersection_x,
-      intersection_y,
-      std::min(bounding_box1.get_x() + bounding_box1.get_width(),
-          bounding_box2.get_x() + bounding_box2.get_width()) - intersection_x,
-      std::min(bounding_box1.get_y() + bounding_box1.get_height(),
-          bounding_box2.get_y() + bounding_box2.get_height()) - intersection_y);
-
-  if (debug_pixel_collisions) {
-    std::cout << "intersection: " << intersection << "\n";
-  }
-
-  // compute the relative position of the intersection rectangle for each bounding_box
-  Point offset1 = intersection.get_xy() - bounding_box1.get_xy();
-  Point offset2 = intersection.get_xy() - bounding_box2.get_xy();
-
-  if (debug_pixel_collisions) {
-    std::cout << "offset1.x = " << offset1.x << ", offset1.y = " << offset1.y;
-    std::cout << ", offset2.x = " << offset2.x << ", offset2.y = " << offset2.y << std::endl;
-  }
-
-  // For each row of the intersection, we will call row 'a' the row coming from the right bounding box
-  // and row 'b' the one coming from the left bounding box.
-
-  std::vector<std::vector<uint32_t>>::const_iterator rows_a;           // for each row: array of masks of the right bounding box
-  std::vector<std::vector<uint32_t>>::const_iterator rows_b;           // for each row: array of masks of the left bounding box
-
-  int nb_masks_per_row_a;    // number of masks on row a that are in the intersection (row b may have one more mask)
-  int nb_masks_per_row_b;    // number of masks on row b that are in the intersection
-  int nb_unused_masks_row_b; // number of unused masks on row b (i.e. before the intersection)
-  int nb_unused_bits_row_b;  // number of unused bits on the first used mask of row b
-  int nb_used_bits_row_b;    // number of bits used on the first used mask of row b
-
-  // make sure row a starts after row b
-  if (bounding_box1.get_x() > bounding_box2.get_x()) {
-    rows_a = this->bits.begin() + offset1.y;
-    rows_b = other.bits.begin() + offset2.y;
-    nb_unused_masks_row_b = offset2.x >> 5;
-    nb_unused_bits_row_b = offset2.x & 31;
-  }
-  else {
-    rows_a = other.bits.begin() + offset2.y;
-    rows_b = this->bits.begin() + offset1.y;
-    nb_unused_masks_row_b = offset1.x >> 5;
-    nb_unused_bits_row_b = offset1.x & 31;
-  }
-  nb_used_bits_row_b = 32 - nb_unused_bits_row_b;
-
-  // compute the number of masks in the intersection on row a
-  nb_masks_per_row_a = intersection.get_width() >> 5;
-  if ((intersection.get_width() & 31) != 0) {
-    nb_masks_per_row_a++;
+  // Check the 8x8 blocks before individual pixels.
+  if (!test_blocks(other, location1, location2, intersection)) {
+    return false;
   }
 
-  // compute the number of masks in the intersection on row b
-  nb_masks_per_row_b = (intersection.get_width() + nb_unused_bits_row_b) >> 5;
-  if (((intersection.get_width() + nb_unused_bits_row_b) & 31) != 0) {
-    nb_masks_per_row_b++;
-  }
+  // Compute the relative position of the intersection rectangle in each image.
+  const Point offset1 = intersection.get_xy() - location1;
+  const Point offset2 = intersection.get_xy() - location2;
+  const int intersection_width = intersection.get_width();
 
-  // check the collisions each row of the intersection rectangle
+  // Check the collisions each row of the intersection rectangle, 32 pixels at a time.
   for (int i = 0; i < intersection.get_height(); ++i) {
 
-    // current row
-    const std::vector<uint32_t>& bits_a = *rows_a;
-    const std::vector<uint32_t>& bits_b = *rows_b;
-
-    ++rows_a;
-    ++rows_b;
-
-    if (debug_pixel_collisions) {
-      std::cout << "*** checking row " << i << " of the intersection rectangle\n";
+    const int y1 = offset1.y + i;
+    const int y2 = offset2.y + i;
+    if (row_extents[y1].last == -1 || other.row_extents[y2].last == -1) {
+      continue;
     }
 
-    // Check each mask.
-    for (int j = 0; j < nb_masks_per_row_a; ++j) {
-
-      // We compare the left of a with the right part of b,
-      // and the right part of a with the right part of the next b if any.
-
-      uint32_t mask_a = bits_a[j];
-      uint32_t mask_b = bits_b[j + nb_unused_masks_row_b];
-      uint32_t mask_a_left = mask_a >> nb_unused_bits_row_b;
-      uint32_t next_mask_b_left = 0x00000000;
-      if (j + 1 < nb_masks_per_row_a ||            // Not the last a-mask.
-          nb_masks_per_row_b > nb_masks_per_row_a  // Last a-mask but there exists one more b-mask.
-          ) {
-        // We are still inside the intersection: next_mask_b_left exists.
-        next_mask_b_left = bits_b[j + nb_unused_masks_row_b + 1] >> nb_used_bits_row_b;
+    const std::vector<uint32_t>& row1 = bits[y1];
+    const std::vector<uint32_t>& row2 = other.bits[y2];
+
+    for (int j = 0; j < intersection_width; j += 32) {
+      uint32_t mask = get_bits(row1, offset1.x + j) & get_bits(row2, offset2.x + j);
+      if (intersection_width - j < 32) {
+        // Ignore pixels after the intersection.
+        mask &= ~(0xFFFFFFFF >> (intersection_width - j));
       }
 
       if (debug_pixel_collisions) {
-        std::cout << "mask_a = ";
-        print_mask(mask_a);
-        std::cout << ", mask b = ";
-        print_mask(mask_b);
+        std::cout << "row " << i << ", mask = ";
+        print_mask(mask);
         std::cout << "\n";
       }
 
-      if (((mask_a_left & mask_b) | (mask_a & next_mask_b_left)) != 0x00000000) {
+      if (mask != 0x00000000) {
         return true;
       }
     }
@@ -232,6 +338,53 @@ bool PixelBits::test_aligned_collision(const PixelBits& other,
   return false;
 }
 
+/**
+ * \brief Returns whether opaque blocks of 8x8 pixels of both images overlap.
+ *
+ * This is a conservative test: if it returns \c false, there is no
+ * pixel collision.
+ *
+ * \param other The other image.
+ * \param location1 Position of the upper-left corner of this image on the map.
+ * \param location2 Position of the upper-left corner of the other image.
+ * \param intersection Intersection of the opaque bounding boxes on the map.
+ * \return \c true if some opaque blocks overlap.
+ */
+bool PixelBits::test_blocks(const PixelBits& other,
+    const Point& location1,
+    const Point& location2,
+    const Rectangle& intersection) const {
+
+  const int first_block_x = (intersection.get_x() - location1.x) >> 3;
+  const int last_block_x = (intersection.get_right() - 1 - location1.x) >> 3;
+  const int first_block_y = (intersection.get_y() - location1.y) >> 3;
+  const int last_block_y = (intersection.get_bottom() - 1 - location1.y) >> 3;
+
+  for (int block_y = first_block_y; block_y <= last_block_y; ++block_y) {
+    for (int block_x = first_block_x; block_x <= last_block_x; ++block_x) {
+      if (!block_at(block_x, block_y)) {
+        continue;
+      }
+
+      // Blocks of the other image under the part of this block in the intersection.
+      const Rectangle block(location1.x + block_x * 8, location1.y + block_y * 8, 8, 8);
+      const Rectangle part = block.get_intersection(intersection);
+      const int other_first_x = (part.get_x() - location2.x) >> 3;
+      const int other_last_x = (part.get_right() - 1 - location2.x) >> 3;
+      const int other_first_y = (part.get_y() - location2.y) >> 3;
+      const int other_last_y = (part.get_bottom() - 1 - location2.y) >> 3;
+      for (int other_y = other_first_y; other_y <= other_last_y; ++other_y) {
+        for (int other_x = other_first_x; other_x <= other_last_x; ++other_x) {
+          if (other.block_at(other_x, other_y)) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
 /**
  * @brief test collision of this pixmap with another one
  * @param other other PixelBits
@@ -252,15 +405,82 @@ bool PixelBits::test_collision(const PixelBits &other,
 }
 
 /**
- * @brief slower collision test taking rotation and scale into account
+ * @brief collision test taking rotation and scale into account
  * @param other other pixelbits
  * @param transform1 transform applied to this pixelbits
  * @param transform2 transform applied to the other pixel bits
- * @return
+ * @return true if pixel bits intersects
+ *
+ * Each row of opaque pixels of this image is first clipped to the part that
+ * can land on opaque pixels of the other image. The remaining pixels are
+ * checked 64 at a time: the other image is sampled under them into a word
+ * that is compared with the row.
+ * The result is the same as test_oriented_collision_per_pixel().
  */
 bool PixelBits::test_oriented_collision(const PixelBits &other,
                              const Transform& transform1,
                              const Transform& transform2) const {
+  if(bits.empty() || other.opaque_box.is_flat() || opaque_box.is_flat()) {
+    return false;
+  }
+  if(!transform1.obb_intersect(Size(width,height),transform2,Size(other.width,other.height))) {
+    return false;
+  }
+  glm::vec2 origin,vx,vy;
+  transform1.compute_collision_data(transform2,origin,vx,vy);
+
+  // Coordinates are truncated toward zero: pixel n is hit by ]n - 1, n + 1[.
+  // Add a margin for rounding errors, exact checks are done when sampling.
+  const Rectangle& box = other.opaque_box;
+  const double min_x = box.get_x() - 2.0;
+  const double max_x = box.get_x() + box.get_width() + 1.0;
+  const double min_y = box.get_y() - 2.0;
+  const double max_y = box.get_y() + box.get_height() + 1.0;
+
+  for(int y = opaque_box.get_y(); y < opaque_box.get_y() + opaque_box.get_height(); y++) {
+    const RowExtent& extent = row_extents[y];
+    if(extent.last < extent.first) {
+      continue;
+    }
+    double first = extent.first;
+    double last = extent.last;
+    if(!clip_range(origin.x + vy.x * y, vx.x, min_x, max_x, first, last) ||
+       !clip_range(origin.y + vy.y * y, vx.y, min_y, max_y, first, last)) {
+      continue;
+    }
+    const int first_x = static_cast<int>(std::ceil(first));
+    const int last_x = static_cast<int>(std::floor(last));
+
+    for(int word_index = first_x >> 6; word_index <= last_x >> 6; word_index++) {
+      const int word_x = word_index << 6;
+      uint64_t mask = get_word(y, word_index);
+      if(first_x > word_x) {
+        mask &= ~uint64_t(0) >> (first_x - word_x);
+      }
+      if(last_x < word_x + 63) {
+        mask &= ~uint64_t(0) << (63 - (last_x - word_x));
+      }
+      if(mask != 0 && sample_word(other, y, word_x, mask, origin, vx, vy) != 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief reference collision test taking rotation and scale into account
+ * @param other other pixelbits
+ * @param transform1 transform applied to this pixelbits
+ * @param transform2 transform applied to the other pixel bits
+ * @return true if pixel bits intersects
+ *
+ * Projects every pixel of this image on the other one.
+ * Much slower than test_oriented_collision(), kept to check and measure it.
+ */
+bool PixelBits::test_oriented_collision_per_pixel(const PixelBits &other,
+                             const Transform& transform1,
+                             const Transform& transform2) const {
   if(!transform1.obb_intersect(Size(width,height),transform2,Size(other.width,other.height))) {
     return false;
   }
@@ -282,6 +502,87 @@ bool PixelBits::test_oriented_collision(const PixelBits &other,
   return false;
 }
 
+/**
+ * @brief returns 64 bits of a row, the first pixel being the highest bit
+ * @param y the row
+ * @param word_index index of the 64-bit word in the row
+ * @return the bits, 0 after the end of the row
+ */
+uint64_t PixelBits::get_word(int y, int word_index) const {
+  const std::vector<uint32_t>& row = bits[y];
+  const size_t index = static_cast<size_t>(word_index) * 2;
+  const uint64_t high = index < row.size() ? row[index] : 0;
+  const uint64_t low = index + 1 < row.size() ? row[index + 1] : 0;
+  return (high << 32) | low;
+}
+
+/**
+ * @brief samples the other image under 64 pixels of a row of this one
+ * @param other the other image
+ * @param y row of this image
+ * @param first_x x coordinate of the pixel of the highest bit
+ * @param mask pixels to sample
+ * @param origin origin of the other image in this one
+ * @param vx x basis of the other image in this one
+ * @param vy y basis of the other image in this one
+ * @return the bits of mask whose pixels land on an opaque pixel of other
+ *
+ * Sample coordinates are computed like in
+ * test_oriented_collision_per_pixel(), four at a time with SSE2.
+ */
+uint64_t PixelBits::sample_word(const PixelBits& other, int y, int first_x, uint64_t mask,
+    const glm::vec2& origin, const glm::vec2& vx, const glm::vec2& vy) const {
+
+  const glm::vec2 row_offset = vy * static_cast<float>(y);
+  uint64_t sampled = 0;
+
+#ifdef SOLARUS_PIXEL_BITS_SSE2
+  const __m128 origin_x = _mm_set1_ps(origin.x);
+  const __m128 origin_y = _mm_set1_ps(origin.y);
+  const __m128 vx_x = _mm_set1_ps(vx.x);
+  const __m128 vx_y = _mm_set1_ps(vx.y);
+  const __m128 offset_x = _mm_set1_ps(row_offset.x);
+  const __m128 offset_y = _mm_set1_ps(row_offset.y);
+  alignas(16) int32_t xs[4];
+  alignas(16) int32_t ys[4];
+#endif
+
+  for(int i = 0; i < 64; i += 4) {
+    const unsigned nibble = (mask >> (60 - i)) & 0xF;
+    if(nibble == 0) {
+      continue;
+    }
+    const int x = first_x + i;
+
+#ifdef SOLARUS_PIXEL_BITS_SSE2
+    const __m128 fx = _mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3));
+    const __m128 px = _mm_add_ps(_mm_add_ps(origin_x, _mm_mul_ps(vx_x, fx)), offset_x);
+    const __m128 py = _mm_add_ps(_mm_add_ps(origin_y, _mm_mul_ps(vx_y, fx)), offset_y);
+    _mm_store_si128(reinterpret_cast<__m128i*>(xs), _mm_cvttps_epi32(px));
+    _mm_store_si128(reinterpret_cast<__m128i*>(ys), _mm_cvttps_epi32(py));
+#endif
+
+    for(int j = 0; j < 4; j++) {
+      if((nibble & (8 >> j)) == 0) {
+        continue;
+      }
+#ifdef SOLARUS_PIXEL_BITS_SSE2
+      const int ox = xs[j];
+      const int oy = ys[j];
+#else
+      const glm::vec2 p = origin + vx * static_cast<float>(x + j) + row_offset;
+      const int ox = p.x;
+      const int oy = p.y;
+#endif
+      if(ox >= 0 && oy >= 0 && ox < other.width && oy < other.height &&
+         ((other.bits[oy][ox >> 5] << (ox & 31)) & 0x80000000) != 0) {
+        sampled |= uint64_t(1) << (63 - i - j);
+      }
+    }
+  }
+  return sampled & mask;
+}
+
 /**
  * @brief access the pixel at given coords
  * @param x x coord in the pixel map
@@ -298,6 +599,16 @@ bool PixelBits::at(int x, int y) const {
   return (row[index] << offset) & 0x80000000;
 }
 
+/**
+ * \brief Returns whether a block of 8x8 pixels has an opaque pixel.
+ * \param block_x X coordinate of the block.
+ * \param block_y Y coordinate of the block.
+ * \return \c true if the block has an opaque pixel.
+ */
+bool PixelBits::block_at(int block_x, int block_y) const {
+  return ((block_bits[block_y][block_x >> 5] << (block_x & 31)) & 0x80000000) != 0;
+}
+
 /**
  * \brief Prints an ASCII representation of the pixels (for debugging purposes only).
  */
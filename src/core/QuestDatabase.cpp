@@ -18,8 +18,10 @@
 #include "solarus/core/QuestDatabase.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/lua/LuaTools.h"
+#include <algorithm>
 #include <ostream>
 #include <sstream>
+#include <vector>
 
 namespace Solarus {
 
@@ -100,9 +102,6 @@ int l_file(lua_State* l) {
  */
 QuestDatabase::QuestDatabase() {
 
-  for (size_t i = 0 ; i < EnumInfoTraits<ResourceType>::names.size(); ++i) {
-    resource_maps.emplace(static_cast<ResourceType>(i), ResourceMap());
-  }
 }
 
 /**
@@ -110,8 +109,9 @@ QuestDatabase::QuestDatabase() {
  */
 void QuestDatabase::clear() {
 
-  for (size_t i = 0; i < EnumInfoTraits<ResourceType>::names.size(); ++i) {
-    resource_maps[static_cast<ResourceType>(i)].clear();
+  for (size_t i = 0; i < num_resource_types; ++i) {
+    resource_maps[i].clear();
+    resource_ids[i].clear();
   }
 
   files.clear();
@@ -126,8 +126,28 @@ void QuestDatabase::clear() {
  */
 bool QuestDatabase::resource_exists(ResourceType resource_type, const std::string& id) const {
 
-  const ResourceMap& resource = get_resource_elements(resource_type);
-  return resource.find(id) != resource.end();
+  // Ids of elements are interned: a string never interned is not an id.
+  const Symbol& symbol = Symbol::find(id);
+  if (symbol.is_empty() && !id.empty()) {
+    return false;
+  }
+  return resource_exists(resource_type, symbol);
+}
+
+/**
+ * \brief Returns whether there exists a resource element with the specified id.
+ *
+ * This only hashes the symbol: keep the symbol of ids checked often.
+ *
+ * \param resource_type A type of resource.
+ * \param id The id to look for.
+ * \return \c true if there exists an element with the specified id in this
+ * resource type.
+ */
+bool QuestDatabase::resource_exists(ResourceType resource_type, const Symbol& id) const {
+
+  const std::unordered_set<Symbol>& ids = resource_ids[static_cast<size_t>(resource_type)];
+  return ids.find(id) != ids.end();
 }
 
 /**
@@ -138,18 +158,21 @@ bool QuestDatabase::resource_exists(ResourceType resource_type, const std::strin
 const QuestDatabase::ResourceMap& QuestDatabase::get_resource_elements(
     ResourceType resource_type) const {
 
-  return resource_maps.find(resource_type)->second;
+  return resource_maps[static_cast<size_t>(resource_type)];
 }
 
 /**
- * \brief Returns the list of element IDs of the specified resource type.
+ * \brief Returns the modifiable list of elements of the specified resource type.
+ *
+ * Ids must not be added or removed through this list without updating the
+ * index of ids.
+ *
  * \param resource_type A type of resource.
- * \return The ids of all declared element of this type
+ * \return The ids and descriptions of all declared elements of this type.
  */
-QuestDatabase::ResourceMap& QuestDatabase::get_resource_elements(
-    ResourceType resource_type) {
+QuestDatabase::ResourceMap& QuestDatabase::get_resource_map(ResourceType resource_type) {
 
-  return resource_maps.find(resource_type)->second;
+  return resource_maps[static_cast<size_t>(resource_type)];
 }
 
 /**
@@ -165,8 +188,11 @@ bool QuestDatabase::add(
     const std::string& id,
     const std::string& description
 ) {
-  ResourceMap& resource = get_resource_elements(resource_type);
+  ResourceMap& resource = get_resource_map(resource_type);
   auto result = resource.emplace(id, description);
+  if (result.second) {
+    resource_ids[static_cast<size_t>(resource_type)].insert(Symbol(id));
+  }
   return result.second;
 }
 
@@ -181,8 +207,12 @@ bool QuestDatabase::remove(
     ResourceType resource_type,
     const std::string& id
 ) {
-  ResourceMap& resource = get_resource_elements(resource_type);
-  return resource.erase(id) > 0;
+  ResourceMap& resource = get_resource_map(resource_type);
+  if (resource.erase(id) == 0) {
+    return false;
+  }
+  resource_ids[static_cast<size_t>(resource_type)].erase(Symbol::find(id));
+  return true;
 }
 
 /**
@@ -248,7 +278,7 @@ bool QuestDatabase::set_description(
     return false;
   }
 
-  ResourceMap& resource = get_resource_elements(resource_type);
+  ResourceMap& resource = get_resource_map(resource_type);
   resource[id] = description;
   return true;
 }
@@ -307,7 +337,7 @@ void QuestDatabase::clear_file_info(const std::string& path) {
  * \return The file information of all files.
  */
 std::map<std::string, QuestDatabase::FileInfo> QuestDatabase::get_all_file_info() const {
-  return files;
+  return std::map<std::string, FileInfo>(files.begin(), files.end());
 }
 
 /**
@@ -369,10 +399,20 @@ bool QuestDatabase::export_to_lua(std::ostream& out) const {
     out << "\n";
   }
 
-  // Save file information.
+  // Save file information, sorted by path.
+  std::vector<const std::pair<const std::string, FileInfo>*> sorted_files;
+  sorted_files.reserve(files.size());
   for (const auto& kvp : files) {
-    const std::string& path = kvp.first;
-    const FileInfo& info = kvp.second;
+    sorted_files.push_back(&kvp);
+  }
+  std::sort(sorted_files.begin(), sorted_files.end(), [](
+      const std::pair<const std::string, FileInfo>* first,
+      const std::pair<const std::string, FileInfo>* second) {
+    return first->first < second->first;
+  });
+  for (const auto* file : sorted_files) {
+    const std::string& path = file->first;
+    const FileInfo& info = file->second;
     if (info.is_empty()) {
       continue;
     }
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/QuestFileIndex.h"
+#include <physfs.h>
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+namespace Solarus {
+
+namespace {
+
+constexpr uint32_t local_header_signature = 0x04034b50;
+constexpr uint32_t central_header_signature = 0x02014b50;
+constexpr uint32_t end_of_central_directory_signature = 0x06054b50;
+constexpr size_t local_header_size = 30;
+constexpr size_t central_header_size = 46;
+constexpr size_t end_of_central_directory_size = 22;
+
+/**
+ * \brief Reads a little-endian 16-bit integer.
+ * \param data The bytes to read.
+ * \return The integer.
+ */
+uint16_t read_uint16(const char* data) {
+
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+/**
+ * \brief Reads a little-endian 32-bit integer.
+ * \param data The bytes to read.
+ * \return The integer.
+ */
+uint32_t read_uint32(const char* data) {
+
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return static_cast<uint32_t>(bytes[0]) |
+      (static_cast<uint32_t>(bytes[1]) << 8) |
+      (static_cast<uint32_t>(bytes[2]) << 16) |
+      (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+/**
+ * \brief Reads a part of a file.
+ * \param file The file.
+ * \param offset Where to start reading.
+ * \param size Number of bytes to read.
+ * \param[out] buffer The bytes read.
+ * \return \c true in case of success.
+ */
+bool read_bytes(std::ifstream& file, uint64_t offset, uint64_t size, std::string& buffer) {
+
+  buffer.resize(static_cast<size_t>(size));
+  file.seekg(static_cast<std::streamoff>(offset));
+  if (size > 0) {
+    file.read(&buffer[0], static_cast<std::streamsize>(size));
+  }
+  return static_cast<bool>(file);
+}
+
+}  // Anonymous namespace
+
+/**
+ * \brief Indexes the files of the current PhysFS search path.
+ *
+ * The previous content of the index is cleared.
+ * When a file exists in several elements of the search path, the first one
+ * wins, like with PhysFS.
+ */
+void QuestFileIndex::build() {
+
+  clear();
+
+  std::vector<ArchiveEntries> archives;
+  add_directory("", archives);
+  built = true;
+}
+
+/**
+ * \brief Empties the index.
+ */
+void QuestFileIndex::clear() {
+
+  built = false;
+  sources.clear();
+  entries.clear();
+}
+
+/**
+ * \brief Returns whether the index was built.
+ * \return \c true if build() was called since the last clear().
+ */
+bool QuestFileIndex::is_built() const {
+  return built;
+}
+
+/**
+ * \brief Returns the number of files and directories indexed.
+ * \return The number of entries.
+ */
+size_t QuestFileIndex::get_num_entries() const {
+  return entries.size();
+}
+
+/**
+ * \brief Converts a file name to the form used by the index.
+ *
+ * Like PhysFS, leading, trailing and repeated slashes are ignored.
+ *
+ * \param file_name A file name.
+ * \param[out] normalized The file name to look for in the index.
+ * \return \c false if the file name is empty or is not a valid PhysFS name,
+ * for example because it contains "." or "..".
+ */
+bool QuestFileIndex::normalize_file_name(
+    const std::string& file_name,
+    std::string& normalized
+) {
+  normalized.clear();
+  normalized.reserve(file_name.size());
+
+  size_t start = 0;
+  while (start < file_name.size()) {
+    size_t end = file_name.find('/', start);
+    if (end == std::string::npos) {
+      end = file_name.size();
+    }
+    if (end > start) {
+      const std::string& component = file_name.substr(start, end - start);
+      if (component == "." ||
+          component == ".." ||
+          component.find_first_of(":\\") != std::string::npos) {
+        return false;
+      }
+      if (!normalized.empty()) {
+        normalized += '/';
+      }
+      normalized += component;
+    }
+    start = end + 1;
+  }
+
+  return !normalized.empty();
+}
+
+/**
+ * \brief Returns the entry of a file or directory.
+ * \param file_name A name returned by normalize_file_name().
+ * \return The entry, or nullptr if there is no such file or directory.
+ */
+const QuestFileIndex::Entry* QuestFileIndex::find(const std::string& file_name) const {
+
+  const auto& it = entries.find(file_name);
+  if (it == entries.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+/**
+ * \brief Returns the real path of the directory or archive of an entry.
+ * \param entry An entry of this index.
+ * \return The path of the search path element containing the entry.
+ */
+const std::string& QuestFileIndex::get_source_path(const Entry& entry) const {
+  return sources[entry.source].path;
+}
+
+/**
+ * \brief Returns whether an entry belongs to a zip archive.
+ * \param entry An entry of this index.
+ * \return \c true if the entry is in an archive.
+ */
+bool QuestFileIndex::is_in_archive(const Entry& entry) const {
+  return sources[entry.source].archive;
+}
+
+/**
+ * \brief Reads a file without going through PhysFS.
+ *
+ * This is possible for files of a data directory and for files stored
+ * uncompressed in an archive.
+ * Each call uses its own file handle, so several threads can read files
+ * at the same time.
+ *
+ * \param file_name A name returned by normalize_file_name().
+ * \param entry The entry of this file.
+ * \param[out] buffer The content of the file.
+ * \return \c false if the file cannot be read this way: PhysFS should then
+ * be used instead.
+ */
+bool QuestFileIndex::read(
+    const std::string& file_name,
+    const Entry& entry,
+    std::string& buffer
+) const {
+
+  if (entry.directory) {
+    return false;
+  }
+
+  const Source& source = sources[entry.source];
+  if (!source.archive) {
+    std::ifstream file(source.path + "/" + file_name, std::ios::binary);
+    if (!file) {
+      return false;
+    }
+    file.seekg(0, std::ios::end);
+    const std::streamoff size = file.tellg();
+    if (size < 0) {
+      return false;
+    }
+    return read_bytes(file, 0, static_cast<uint64_t>(size), buffer);
+  }
+
+  if (!entry.stored) {
+    return false;
+  }
+
+  std::ifstream file(source.path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  // The local header may have a different extra field than the central one.
+  std::string header;
+  if (!read_bytes(file, entry.offset, local_header_size, header) ||
+      read_uint32(&header[0]) != local_header_signature) {
+    return false;
+  }
+  const uint64_t data_offset = entry.offset + local_header_size +
+      read_uint16(&header[26]) + read_uint16(&header[28]);
+  return read_bytes(file, data_offset, entry.size, buffer);
+}
+
+/**
+ * \brief Recursively indexes a directory of the search path.
+ * \param dir_name Name of the directory, or an empty string for the root.
+ * \param archives Central directory of the archives found so far,
+ * by source index.
+ */
+void QuestFileIndex::add_directory(
+    const std::string& dir_name,
+    std::vector<ArchiveEntries>& archives
+) {
+  char** files = PHYSFS_enumerateFiles(dir_name.empty() ? "/" : dir_name.c_str());
+  if (files == nullptr) {
+    return;
+  }
+
+  std::vector<std::string> subdirectories;
+  for (char** file = files; *file != nullptr; ++file) {
+    const std::string& file_name = dir_name.empty() ?
+        std::string(*file) : dir_name + "/" + *file;
+    const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+    if (real_dir == nullptr) {
+      continue;
+    }
+
+    Entry entry;
+    entry.source = get_source(real_dir, archives);
+    entry.directory = PHYSFS_isDirectory(file_name.c_str()) != 0;
+    if (entry.directory) {
+      subdirectories.push_back(file_name);
+    }
+    else if (sources[entry.source].archive) {
+      const ArchiveEntries& archive_entries = archives[entry.source];
+      const auto& it = archive_entries.find(file_name);
+      if (it != archive_entries.end()) {
+        entry.stored = it->second.stored;
+        entry.size = it->second.size;
+        entry.offset = it->second.offset;
+      }
+    }
+    entries.emplace(file_name, entry);
+  }
+  PHYSFS_freeList(files);
+
+  for (const std::string& subdirectory : subdirectories) {
+    add_directory(subdirectory, archives);
+  }
+}
+
+/**
+ * \brief Returns the index of a search path element, adding it if needed.
+ * \param path Real path of the element as returned by PhysFS.
+ * \param archives Central directory of the archives found so far,
+ * by source index.
+ * \return Index of the element in sources.
+ */
+size_t QuestFileIndex::get_source(
+    const std::string& path,
+    std::vector<ArchiveEntries>& archives
+) {
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (sources[i].path == path) {
+      return i;
+    }
+  }
+
+  ArchiveEntries archive_entries;
+  const bool archive = read_archive_entries(path, archive_entries);
+  sources.push_back({ path, archive });
+  archives.push_back(std::move(archive_entries));
+  return sources.size() - 1;
+}
+
+/**
+ * \brief Reads the central directory of a zip archive.
+ *
+ * Zip64 archives are not supported: their files are still indexed but
+ * they will be read through PhysFS.
+ *
+ * \param path Path of a file that may be a zip archive.
+ * \param[out] archive_entries The files of the archive.
+ * \return \c false if this is not a readable zip archive, for example
+ * because it is a directory.
+ */
+bool QuestFileIndex::read_archive_entries(
+    const std::string& path,
+    ArchiveEntries& archive_entries
+) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  file.seekg(0, std::ios::end);
+  const std::streamoff file_size = file.tellg();
+  if (file_size < static_cast<std::streamoff>(end_of_central_directory_size)) {
+    return false;
+  }
+
+  // The end of central directory record is followed by a comment
+  // of at most 65535 bytes.
+  const uint64_t tail_size = std::min<uint64_t>(
+      static_cast<uint64_t>(file_size), end_of_central_directory_size + 0xFFFF);
+  const uint64_t tail_offset = static_cast<uint64_t>(file_size) - tail_size;
+  std::string tail;
+  if (!read_bytes(file, tail_offset, tail_size, tail)) {
+    return false;
+  }
+
+  size_t end_position = tail.size() - end_of_central_directory_size + 1;
+  do {
+    if (end_position == 0) {
+      return false;
+    }
+    --end_position;
+  } while (read_uint32(&tail[end_position]) != end_of_central_directory_signature);
+
+  const char* end_record = &tail[end_position];
+  const uint16_t num_entries = read_uint16(end_record + 10);
+  const uint32_t directory_size = read_uint32(end_record + 12);
+  const uint32_t directory_offset = read_uint32(end_record + 16);
+  if (num_entries == 0xFFFF ||
+      directory_size == 0xFFFFFFFF ||
+      directory_offset == 0xFFFFFFFF) {
+    return false;
+  }
+
+  // Data may be prepended to the archive, like in self-extracting ones.
+  const uint64_t end_offset = tail_offset + end_position;
+  if (end_offset < static_cast<uint64_t>(directory_offset) + directory_size) {
+    return false;
+  }
+  const uint64_t shift = end_offset - directory_offset - directory_size;
+
+  std::string directory;
+  if (!read_bytes(file, directory_offset + shift, directory_size, directory)) {
+    return false;
+  }
+
+  size_t position = 0;
+  for (uint16_t i = 0; i < num_entries; ++i) {
+    if (position + central_header_size > directory.size()) {
+      return false;
+    }
+    const char* header = &directory[position];
+    if (read_uint32(header) != central_header_signature) {
+      return false;
+    }
+    const uint16_t version_made_by = read_uint16(header + 4);
+    const uint16_t flags = read_uint16(header + 8);
+    const uint16_t method = read_uint16(header + 10);
+    const uint32_t compressed_size = read_uint32(header + 20);
+    const uint32_t size = read_uint32(header + 24);
+    const uint16_t name_length = read_uint16(header + 28);
+    const uint16_t extra_length = read_uint16(header + 30);
+    const uint16_t comment_length = read_uint16(header + 32);
+    const uint32_t attributes = read_uint32(header + 38);
+    const uint32_t local_offset = read_uint32(header + 42);
+    if (position + central_header_size + name_length > directory.size()) {
+      return false;
+    }
+
+    std::string name = directory.substr(position + central_header_size, name_length);
+    position += central_header_size + name_length + extra_length + comment_length;
+    if (name.empty() || name.back() == '/') {
+      // Directory.
+      continue;
+    }
+
+    // Encrypted files, symbolic links and zip64 entries are left to PhysFS.
+    const bool encrypted = (flags & 0x0001) != 0;
+    const bool unix_symlink = (version_made_by >> 8) == 3 &&
+        ((attributes >> 16) & 0170000) == 0120000;
+    const bool zip64 = size == 0xFFFFFFFF || local_offset == 0xFFFFFFFF;
+    ArchiveEntry archive_entry;
+    archive_entry.stored = method == 0 &&
+        compressed_size == size &&
+        !encrypted &&
+        !unix_symlink &&
+        !zip64;
+    archive_entry.size = size;
+    archive_entry.offset = local_offset + shift;
+    archive_entries.emplace(std::move(name), archive_entry);
+  }
+
+  return true;
+}
+
+}
+
@@ -17,6 +17,7 @@
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/QuestFileIndex.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
 #include "solarus/lua/LuaContext.h"
@@ -27,6 +28,11 @@
 #ifdef SOLARUS_HAVE_UNISTD_H
 #  include <unistd.h>  // close()
 #endif
+#ifdef SOLARUS_HAVE_SYS_MMAN_H
+#  include <fcntl.h>      // open()
+#  include <sys/mman.h>   // mmap(), munmap()
+#  include <sys/stat.h>   // fstat()
+#endif
 
 #ifdef ANDROID
 #include <SDL_filesystem.h>
@@ -60,11 +66,22 @@ std::string solarus_write_dir_;
  */
 std::string quest_write_dir_;
 
+/**
+ * \brief Absolute path of the quest write directory,
+ * or an empty string if there is no quest write directory.
+ */
+std::string full_quest_write_dir_;
+
 /**
  * \brief Name of all temporary files created.
  */
 std::vector<std::string> temporary_files_;
 
+/**
+ * \brief Read-only files of the quest: data directory and archive.
+ */
+QuestFileIndex index_;
+
 /**
  * \brief Sets the directory where the engine can write files.
  *
@@ -106,6 +123,106 @@ void set_solarus_write_dir(const std::string& solarus_write_dir) {
   }
 }
 
+/**
+ * \brief Returns whether a file name can be looked up in the index.
+ * \param file_name A file name.
+ * \param[out] normalized The name to look for in the index.
+ * \return \c false if PhysFS should be used instead.
+ */
+bool can_use_index(const std::string& file_name, std::string& normalized) {
+
+  return index_.is_built() &&
+      QuestFileIndex::normalize_file_name(file_name, normalized);
+}
+
+/**
+ * \brief Returns whether a file or directory exists in the quest write
+ * directory.
+ *
+ * The write directory is not indexed because it changes at runtime,
+ * including through the Lua io functions.
+ *
+ * \param file_name A name returned by can_use_index().
+ * \param[out] is_dir Whether this is a directory.
+ * \return \c true if the file exists in the quest write directory.
+ */
+bool write_dir_find(const std::string& file_name, bool& is_dir) {
+
+  is_dir = false;
+  if (full_quest_write_dir_.empty()) {
+    return false;
+  }
+
+#ifdef SOLARUS_HAVE_SYS_MMAN_H
+  struct stat status;
+  if (stat((full_quest_write_dir_ + "/" + file_name).c_str(), &status) != 0) {
+    return false;
+  }
+  is_dir = S_ISDIR(status.st_mode);
+  return true;
+#else
+  const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+  if (real_dir == nullptr || full_quest_write_dir_ != real_dir) {
+    return false;
+  }
+  is_dir = PHYSFS_isDirectory(file_name.c_str());
+  return true;
+#endif
+}
+
+/**
+ * \brief Returns the directory or archive where a data file is located.
+ * \param file_name A file name.
+ * \return The real path of the search path element containing the file,
+ * or an empty string if the file does not exist.
+ */
+std::string get_real_dir(const std::string& file_name) {
+
+  std::string name;
+  if (!can_use_index(file_name, name)) {
+    const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+    return real_dir == nullptr ? "" : real_dir;
+  }
+
+  bool is_dir = false;
+  if (write_dir_find(name, is_dir)) {
+    return full_quest_write_dir_;
+  }
+
+  const QuestFileIndex::Entry* entry = index_.find(name);
+  if (entry == nullptr) {
+    return "";
+  }
+  return index_.get_source_path(*entry);
+}
+
+/**
+ * \brief Reads a data file without going through PhysFS if possible.
+ *
+ * This works for files of the data directory and for files stored
+ * uncompressed in the data archive, and allows to read them from several
+ * threads at the same time.
+ *
+ * \param file_name Name of a data file.
+ * \param[out] buffer The content of the file.
+ * \return \c false if PhysFS should be used instead.
+ */
+bool read_from_index(const std::string& file_name, std::string& buffer) {
+
+  std::string name;
+  bool is_dir = false;
+  if (!can_use_index(file_name, name) ||
+      write_dir_find(name, is_dir)) {
+    return false;
+  }
+
+  const QuestFileIndex::Entry* entry = index_.find(name);
+  if (entry == nullptr || entry->directory) {
+    return false;
+  }
+  return index_.read(name, *entry, buffer);
+}
+
 } // Anonymous namespace
 
 /**
@@ -153,6 +270,8 @@ SOLARUS_API bool open_quest(const std::string& program_name, const std::string&
   PHYSFS_addToSearchPath((base_dir + "/" + archive_quest_path_1).c_str(), 1);
   PHYSFS_addToSearchPath((base_dir + "/" + archive_quest_path_2).c_str(), 1);
 
+  // Index the read-only files before the write directory is in the search path.
+  index_.build();
 
   // Set the engine root write directory.
   set_solarus_write_dir(SOLARUS_WRITE_DIR);
@@ -180,10 +299,12 @@ SOLARUS_API void close_quest() {
   CurrentQuest::quit();
 
   remove_temporary_files();
+  index_.clear();
 
   quest_path_ = "";
   solarus_write_dir_ = "";
   quest_write_dir_ = "";
+  full_quest_write_dir_ = "";
 
   PHYSFS_deinit();
 }
@@ -235,14 +356,13 @@ SOLARUS_API bool quest_exists() {
 SOLARUS_API DataFileLocation data_file_get_location(
     const std::string& file_name) {
 
-  const char* path_ptr = PHYSFS_getRealDir(file_name.c_str());
-  std::string path = path_ptr == nullptr ? "" : path_ptr;
+  const std::string& path = get_real_dir(file_name);
   if (path.empty()) {
     // File does not exist.
     return DataFileLocation::LOCATION_NONE;
   }
 
-  if (!get_quest_write_dir().empty() && path == PHYSFS_getWriteDir()) {
+  if (!full_quest_write_dir_.empty() && path == full_quest_write_dir_) {
     return DataFileLocation::LOCATION_WRITE_DIRECTORY;
   }
 
@@ -267,7 +387,13 @@ SOLARUS_API bool data_file_exists(
     bool language_specific
 ) {
   const std::string& actual_file_name = get_actual_file_name(file_name, language_specific);
-  return PHYSFS_exists(actual_file_name.c_str());
+  std::string name;
+  if (!can_use_index(actual_file_name, name)) {
+    return PHYSFS_exists(actual_file_name.c_str());
+  }
+
+  bool is_dir = false;
+  return index_.find(name) != nullptr || write_dir_find(name, is_dir);
 }
 
 /**
@@ -279,15 +405,37 @@ SOLARUS_API bool data_file_exists(
 SOLARUS_API std::string get_actual_file_name(
     const std::string& file_name,
     bool language_specific
+) {
+  if (!language_specific) {
+    return file_name;
+  }
+  return get_actual_file_name(file_name, true, CurrentQuest::get_language());
+}
+
+/**
+ * \brief Returns a file name after resolving whether it is a language-specific
+ * one, for a given language.
+ *
+ * Unlike the other version, this one does not read the current language,
+ * so it can be called from any thread.
+ *
+ * \param file_name The file name possibly relative to the language.
+ * \param language_specific \c true if the file name is relative to the language.
+ * \param language The language.
+ * \return \c The actual file name.
+ */
+SOLARUS_API std::string get_actual_file_name(
+    const std::string& file_name,
+    bool language_specific,
+    const std::string& language
 ) {
   std::string full_file_name;
   if (language_specific) {
-    Debug::check_assertion(!CurrentQuest::get_language().empty(),
+    Debug::check_assertion(!language.empty(),
         std::string("Cannot open language-specific file '") + file_name
         + "': no language was set"
     );
-    full_file_name = std::string("languages/") +
-        CurrentQuest::get_language() + "/" + file_name;
+    full_file_name = std::string("languages/") + language + "/" + file_name;
   }
   else {
     full_file_name = file_name;
@@ -304,6 +452,11 @@ SOLARUS_API std::string get_actual_file_name(
 SOLARUS_API std::string data_file_read(
     const std::string& file_name
 ) {
+  std::string buffer;
+  if (read_from_index(file_name, buffer)) {
+    return buffer;
+  }
+
   // Open the file.
   Debug::check_assertion(PHYSFS_exists(file_name.c_str()),
       std::string("Data file '") + file_name + "' does not exist"
@@ -318,12 +471,14 @@ SOLARUS_API std::string data_file_read(
 
   // Load it into memory.
   size_t size =  static_cast<size_t>(PHYSFS_fileLength(file));
-  std::vector<char> buffer(size);
+  buffer.resize(size);
 
-  PHYSFS_read(file, buffer.data(), 1, (PHYSFS_uint32) size);
+  if (size > 0) {
+    PHYSFS_read(file, &buffer[0], 1, (PHYSFS_uint32) size);
+  }
   PHYSFS_close(file);
 
-  return std::string(buffer.data(), size);
+  return buffer;
 }
 
 /**
@@ -339,6 +494,233 @@ SOLARUS_API std::string data_file_read(
   return data_file_read(get_actual_file_name(file_name, language_specific));
 }
 
+/**
+ * \brief Creates a view with no content.
+ */
+DataFileView::DataFileView():
+  data(nullptr),
+  size(0),
+  mapping(nullptr),
+  buffer() {
+
+}
+
+/**
+ * \brief Creates a view on content already in memory.
+ * \param buffer The content. The view takes ownership of it.
+ */
+DataFileView::DataFileView(std::string&& buffer):
+  data(nullptr),
+  size(0),
+  mapping(nullptr),
+  buffer(std::move(buffer)) {
+
+  data = this->buffer.data();
+  size = this->buffer.size();
+}
+
+/**
+ * \brief Moves a view.
+ * \param other The view to move. It no longer has any content.
+ */
+DataFileView::DataFileView(DataFileView&& other):
+  DataFileView() {
+
+  *this = std::move(other);
+}
+
+/**
+ * \brief Moves a view.
+ * \param other The view to move. It no longer has any content.
+ * \return This view.
+ */
+DataFileView& DataFileView::operator=(DataFileView&& other) {
+
+  if (&other == this) {
+    return *this;
+  }
+
+  close();
+  const bool other_mapped = other.is_mapped();
+  mapping = other.mapping;
+  size = other.size;
+  buffer = std::move(other.buffer);
+  data = other_mapped ? other.data : buffer.data();
+  other.data = nullptr;
+  other.size = 0;
+  other.mapping = nullptr;
+  other.buffer.clear();
+  return *this;
+}
+
+/**
+ * \brief Destroys the view and releases its content.
+ */
+DataFileView::~DataFileView() {
+  close();
+}
+
+/**
+ * \brief Gives access to the content of a data file.
+ *
+ * The previous content of this view is released.
+ *
+ * \param file_name Name of the file to open.
+ * \param language_specific \c true if the file is specific to the current language.
+ * \return \c true in case of success, \c false if the file does not exist
+ * or cannot be read.
+ */
+bool DataFileView::open(const std::string& file_name, bool language_specific) {
+
+  close();
+
+  const std::string& actual_file_name = get_actual_file_name(file_name, language_specific);
+  if (!data_file_exists(actual_file_name) ||
+      data_file_is_dir(actual_file_name)) {
+    return false;
+  }
+
+  if (map(actual_file_name)) {
+    return true;
+  }
+
+  // The file is in an archive or cannot be mapped: read it.
+  if (read_from_index(actual_file_name, buffer)) {
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+  }
+
+  PHYSFS_file* file = PHYSFS_openRead(actual_file_name.c_str());
+  if (file == nullptr) {
+    return false;
+  }
+  const size_t file_size = static_cast<size_t>(PHYSFS_fileLength(file));
+  buffer.resize(file_size);
+  const PHYSFS_sint64 bytes_read = PHYSFS_read(file, &buffer[0], 1, (PHYSFS_uint32) file_size);
+  PHYSFS_close(file);
+  if (bytes_read != static_cast<PHYSFS_sint64>(file_size)) {
+    buffer.clear();
+    return false;
+  }
+
+  data = buffer.data();
+  size = buffer.size();
+  return true;
+}
+
+/**
+ * \brief Releases the content of this view.
+ *
+ * The memory of the buffer is kept to be reused by the next call to open().
+ */
+void DataFileView::close() {
+
+  unmap();
+  buffer.clear();
+  data = nullptr;
+  size = 0;
+}
+
+/**
+ * \brief Makes the view own its content.
+ *
+ * If the file is mapped, its content is copied into the buffer of the view
+ * and the mapping is released. The content then stays valid even if the
+ * file changes on disk, which would otherwise crash the process when
+ * reading the mapping.
+ */
+void DataFileView::copy_to_buffer() {
+
+  if (!is_mapped()) {
+    return;
+  }
+
+  buffer.assign(data, size);
+  unmap();
+  data = buffer.data();
+}
+
+/**
+ * \brief Returns the content of the file.
+ * \return The content, or nullptr if the view is closed.
+ */
+const char* DataFileView::get_data() const {
+  return data;
+}
+
+/**
+ * \brief Returns the size of the content.
+ * \return The size in bytes.
+ */
+size_t DataFileView::get_size() const {
+  return size;
+}
+
+/**
+ * \brief Returns whether the content is a memory mapping of the file.
+ * \return \c true if the file is mapped, \c false if it was read.
+ */
+bool DataFileView::is_mapped() const {
+  return mapping != nullptr;
+}
+
+/**
+ * \brief Attempts to map a file of a directory of the search path.
+ * \param file_name Name of a data file that exists.
+ * \return \c true in case of success, \c false if the file is not a regular
+ * file of a directory or if memory mappings are not available.
+ */
+bool DataFileView::map(const std::string& file_name) {
+
+#ifdef SOLARUS_HAVE_SYS_MMAN_H
+  const std::string& real_dir = get_real_dir(file_name);
+  if (real_dir.empty()) {
+    return false;
+  }
+
+  // Archives fail here because their real path is not a directory.
+  const std::string& real_path = real_dir + "/" + file_name;
+  const int fd = ::open(real_path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat status;
+  void* address = MAP_FAILED;
+  if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+    address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+
+  mapping = address;
+  data = static_cast<const char*>(address);
+  size = static_cast<size_t>(status.st_size);
+  return true;
+#else
+  (void) file_name;
+  return false;
+#endif
+}
+
+/**
+ * \brief Releases the memory mapping if any.
+ */
+void DataFileView::unmap() {
+
+  if (mapping == nullptr) {
+    return;
+  }
+
+#ifdef SOLARUS_HAVE_SYS_MMAN_H
+  munmap(mapping, size);
+#endif
+  mapping = nullptr;
+}
+
 /**
  * \brief Saves a buffer into a data file.
  * \param file_name Name of the file to write, relative to Solarus write directory.
@@ -365,6 +747,58 @@ SOLARUS_API void data_file_save(
   PHYSFS_close(file);
 }
 
+/**
+ * \brief Saves a buffer into a data file if possible.
+ *
+ * Unlike data_file_save(), failing to write the file is not fatal.
+ * This is useful for files that can be regenerated, like caches.
+ *
+ * \param file_name Name of the file to write, relative to Solarus write directory.
+ * \param buffer The buffer to save.
+ * \return \c true in case of success.
+ */
+SOLARUS_API bool data_file_try_save(
+    const std::string& file_name,
+    const std::string& buffer
+) {
+  PHYSFS_file* file = PHYSFS_openWrite(file_name.c_str());
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool success = PHYSFS_write(file, buffer.data(), (PHYSFS_uint32) buffer.size(), 1) == 1;
+  if (!PHYSFS_close(file)) {
+    success = false;
+  }
+  return success;
+}
+
+/**
+ * \brief Appends a buffer to the end of a data file.
+ *
+ * The file is created if it does not exist.
+ * Failing to write the file is not fatal.
+ *
+ * \param file_name Name of the file to write, relative to Solarus write directory.
+ * \param buffer The buffer to append.
+ * \return \c true in case of success.
+ */
+SOLARUS_API bool data_file_append(
+    const std::string& file_name,
+    const std::string& buffer
+) {
+  PHYSFS_file* file = PHYSFS_openAppend(file_name.c_str());
+  if (file == nullptr) {
+    return false;
+  }
+
+  bool success = PHYSFS_write(file, buffer.data(), (PHYSFS_uint32) buffer.size(), 1) == 1;
+  if (!PHYSFS_close(file)) {
+    success = false;
+  }
+  return success;
+}
+
 /**
  * \brief Removes a file from the write directory.
  * \param file_name Name of the file to delete, relative to the Solarus
@@ -404,8 +838,19 @@ SOLARUS_API bool data_file_mkdir(const std::string& dir_name) {
  */
 SOLARUS_API bool data_file_is_dir(const std::string& file_name) {
 
-  return PHYSFS_exists(file_name.c_str()) &&
-      PHYSFS_isDirectory(file_name.c_str());
+  std::string name;
+  if (!can_use_index(file_name, name)) {
+    return PHYSFS_exists(file_name.c_str()) &&
+        PHYSFS_isDirectory(file_name.c_str());
+  }
+
+  bool is_dir = false;
+  if (write_dir_find(name, is_dir)) {
+    return is_dir;
+  }
+
+  const QuestFileIndex::Entry* entry = index_.find(name);
+  return entry != nullptr && entry->directory;
 }
 
 /**
@@ -475,6 +920,7 @@ SOLARUS_API void set_quest_write_dir(const std::string& quest_write_dir) {
   }
 
   quest_write_dir_ = quest_write_dir;
+  full_quest_write_dir_ = "";
 
   // Reset the write directory to the Solarus directory
   // so that we can create the new quest subdirectory.
@@ -495,6 +941,7 @@ SOLARUS_API void set_quest_write_dir(const std::string& quest_write_dir) {
 
     // Also allow the quest to read savegames, settings and data files there.
     PHYSFS_addToSearchPath(PHYSFS_getWriteDir(), 0);
+    full_quest_write_dir_ = PHYSFS_getWriteDir();
   }
 }
 
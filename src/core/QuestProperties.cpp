@@ -15,9 +15,12 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/QuestProperties.h"
+#include "solarus/audio/MusicQualityInfo.h"
+#include "solarus/core/CatchUpModeInfo.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Size.h"
+#include "solarus/core/System.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
@@ -118,6 +121,32 @@ int l_quest(lua_State* l) {
     properties.set_min_quest_size(min_quest_size);
     properties.set_max_quest_size(max_quest_size);
 
+    const CatchUpMode catch_up_mode =
+        LuaTools::opt_enum_field<CatchUpMode>(l, 1, "catch_up_mode", CatchUpMode::FIXED);
+    const int max_catch_up_updates =
+        LuaTools::opt_int_field(l, 1, "max_catch_up_updates", 10);
+    const int lag_drop_threshold =
+        LuaTools::opt_int_field(l, 1, "lag_drop_threshold", 200);
+
+    if (max_catch_up_updates < 1) {
+      LuaTools::arg_error(l, 1, std::string(
+          "Bad field 'max_catch_up_updates' (should be positive)"));
+    }
+
+    if (lag_drop_threshold < static_cast<int>(System::timestep)) {
+      LuaTools::arg_error(l, 1, std::string(
+          "Bad field 'lag_drop_threshold' (should be at least ")
+      + std::to_string(System::timestep) + ")");
+    }
+
+    properties.set_catch_up_mode(catch_up_mode);
+    properties.set_max_catch_up_updates(max_catch_up_updates);
+    properties.set_lag_drop_threshold(lag_drop_threshold);
+
+    const MusicQuality music_quality =
+        LuaTools::opt_enum_field<MusicQuality>(l, 1, "music_quality", MusicQuality::HIGH);
+    properties.set_music_quality(music_quality);
+
     return 0;
   });
 }
@@ -127,7 +156,11 @@ int l_quest(lua_State* l) {
 /**
  * \brief Creates quest properties.
  */
-QuestProperties::QuestProperties() {
+QuestProperties::QuestProperties():
+  catch_up_mode(CatchUpMode::FIXED),
+  max_catch_up_updates(10),
+  lag_drop_threshold(200),
+  music_quality(MusicQuality::HIGH) {
 }
 
 /**
@@ -164,8 +197,22 @@ bool QuestProperties::export_to_lua(std::ostream& out) const {
       << "  website = \"" << escape_string(website) << "\",\n"
       << "  normal_quest_size = \"" << normal_quest_size.width << 'x' << normal_quest_size.height << "\",\n"
       << "  min_quest_size = \"" << min_quest_size.width << 'x' << min_quest_size.height << "\",\n"
-      << "  max_quest_size = \"" << max_quest_size.width << 'x' << max_quest_size.height << "\",\n"
-      << "}\n\n";
+      << "  max_quest_size = \"" << max_quest_size.width << 'x' << max_quest_size.height << "\",\n";
+
+  // Only write catch-up settings that differ from the defaults.
+  if (catch_up_mode != CatchUpMode::FIXED) {
+    out << "  catch_up_mode = \"" << enum_to_name(catch_up_mode) << "\",\n";
+  }
+  if (max_catch_up_updates != 10) {
+    out << "  max_catch_up_updates = " << max_catch_up_updates << ",\n";
+  }
+  if (lag_drop_threshold != 200) {
+    out << "  lag_drop_threshold = " << lag_drop_threshold << ",\n";
+  }
+  if (music_quality != MusicQuality::HIGH) {
+    out << "  music_quality = \"" << enum_to_name(music_quality) << "\",\n";
+  }
+  out << "}\n\n";
 
   return true;
 }
@@ -389,4 +436,67 @@ void QuestProperties::set_max_quest_size(const Size& max_quest_size) {
   this->max_quest_size = max_quest_size;
 }
 
+/**
+ * \brief Returns how the main loop catches up when updates are late.
+ * \return The "catch_up_mode" value.
+ */
+CatchUpMode QuestProperties::get_catch_up_mode() const {
+  return catch_up_mode;
+}
+
+/**
+ * \brief Sets how the main loop catches up when updates are late.
+ * \param catch_up_mode The "catch_up_mode" value.
+ */
+void QuestProperties::set_catch_up_mode(CatchUpMode catch_up_mode) {
+  this->catch_up_mode = catch_up_mode;
+}
+
+/**
+ * \brief Returns the maximum number of updates before drawing a frame.
+ * \return The "max_catch_up_updates" value.
+ */
+int QuestProperties::get_max_catch_up_updates() const {
+  return max_catch_up_updates;
+}
+
+/**
+ * \brief Sets the maximum number of updates before drawing a frame.
+ * \param max_catch_up_updates The "max_catch_up_updates" value.
+ */
+void QuestProperties::set_max_catch_up_updates(int max_catch_up_updates) {
+  this->max_catch_up_updates = max_catch_up_updates;
+}
+
+/**
+ * \brief Returns the lag beyond which the simulation gives up catching up.
+ * \return The "lag_drop_threshold" value in milliseconds.
+ */
+int QuestProperties::get_lag_drop_threshold() const {
+  return lag_drop_threshold;
+}
+
+/**
+ * \brief Sets the lag beyond which the simulation gives up catching up.
+ * \param lag_drop_threshold The "lag_drop_threshold" value in milliseconds.
+ */
+void QuestProperties::set_lag_drop_threshold(int lag_drop_threshold) {
+  this->lag_drop_threshold = lag_drop_threshold;
+}
+/**
+ * \brief Returns the rendering tier of .it musics.
+ * \return The "music_quality" value.
+ */
+MusicQuality QuestProperties::get_music_quality() const {
+  return music_quality;
+}
+
+/**
+ * \brief Sets the rendering tier of .it musics.
+ * \param music_quality The "music_quality" value.
+ */
+void QuestProperties::set_music_quality(MusicQuality music_quality) {
+  this->music_quality = music_quality;
+}
+
 }
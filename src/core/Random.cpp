@@ -16,11 +16,50 @@
  */
 #include "solarus/core/Random.h"
 #include <ctime>
-#include <random>
 
 namespace Solarus {
 namespace Random {
 
+namespace {
+
+/**
+ * \brief Seed of the engine.
+ *
+ * The engine is not seeded with std::random_device
+ * because not every main platform support non-deterministic
+ * random numbers generation yet.
+ */
+uint32_t seed = static_cast<uint32_t>(std::time(nullptr));
+
+/**
+ * \brief Returns the seed of the stream of a subsystem.
+ * \param subsystem A subsystem.
+ * \return The seed of its stream.
+ */
+uint64_t get_stream_seed(Subsystem subsystem) {
+  return (static_cast<uint64_t>(subsystem) << 32) | seed;
+}
+
+/**
+ * \brief Returns the stream of each subsystem.
+ * \return The streams.
+ */
+RandomStream* get_streams() {
+
+  static RandomStream streams[] = {
+      RandomStream(get_stream_seed(Subsystem::GENERAL)),
+      RandomStream(get_stream_seed(Subsystem::MOVEMENTS)),
+      RandomStream(get_stream_seed(Subsystem::ENEMIES)),
+      RandomStream(get_stream_seed(Subsystem::EFFECTS)),
+      RandomStream(get_stream_seed(Subsystem::SCRIPTS)),
+  };
+  static_assert(sizeof(streams) / sizeof(streams[0]) ==
+      static_cast<size_t>(Subsystem::NUM_SUBSYSTEMS), "Missing random streams");
+  return streams;
+}
+
+}
+
 /**
  * \brief Initializes the random number generator.
  */
@@ -35,40 +74,63 @@ void quit() {
   // nothing to do
 }
 
+/**
+ * \brief Returns the seed of the random number generator.
+ * \return The seed.
+ */
+uint32_t get_seed() {
+  return seed;
+}
+
+/**
+ * \brief Restarts the random streams of all subsystems with a seed.
+ *
+ * The same seed produces the same sequences of numbers,
+ * which makes input replays deterministic.
+ *
+ * \param seed The new seed.
+ */
+void set_seed(uint32_t seed) {
+
+  Random::seed = seed;
+  for (int i = 0; i < static_cast<int>(Subsystem::NUM_SUBSYSTEMS); ++i) {
+    get_streams()[i].set_seed(get_stream_seed(static_cast<Subsystem>(i)));
+  }
+}
+
+/**
+ * \brief Returns the random stream of a subsystem.
+ * \param subsystem A subsystem.
+ * \return Its random stream.
+ */
+RandomStream& get_stream(Subsystem subsystem) {
+  return get_streams()[static_cast<int>(subsystem)];
+}
+
 /**
  * \brief Returns a random integer number in [0, x[ with a uniform distribution.
  *
  * This is equivalent to: Random::get_number(0, x).
+ * The number is taken from the general stream.
  *
  * \param x The superior bound.
  * \return a Random integer number in [0, x[.
  */
 int get_number(unsigned int x) {
-  return get_number(0, x);
+  return get_stream(Subsystem::GENERAL).get_number(x);
 }
 
 /**
  * \brief Returns a random integer number in [x, y[ with a uniform distribution.
+ *
+ * The number is taken from the general stream.
+ *
  * \param x The inferior bound.
  * \param y The superior bound.
  * \return A random integer number in [x, y[.
  */
 int get_number(int x, int y) {
-
-  // Initialize the engine and the distribution
-  //
-  // The engine is not initialized with std::random_device
-  // because not every main platform support non-deterministic
-  // random numbers generation yet.
-  //
-  static std::mt19937 engine(std::time(nullptr));
-  static std::uniform_int_distribution<int> dist{};
-
-  // Type of the parameters of the distribution
-  using param_type = std::uniform_int_distribution<int>::param_type;
-
-  // Get a random number in [x, y[
-  return dist(engine, param_type{x, y - 1});
+  return get_stream(Subsystem::GENERAL).get_number(x, y);
 }
 
 }
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/RandomStream.h"
+#include "solarus/lua/LuaContext.h"
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the next number of a splitmix64 sequence.
+ *
+ * Used to expand a seed into the state of the generator, so that
+ * close seeds still give unrelated sequences.
+ *
+ * \param x The state of the splitmix64 sequence, updated.
+ * \return The next number.
+ */
+uint64_t splitmix64(uint64_t& x) {
+
+  x += 0x9E3779B97F4A7C15ull;
+  uint64_t z = x;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+}
+
+/**
+ * \brief Creates a random stream.
+ * \param seed The seed.
+ */
+RandomStream::RandomStream(uint64_t seed):
+  ExportableToLua(),
+  seed(0),
+  state() {
+
+  set_seed(seed);
+}
+
+/**
+ * \brief Returns the seed of this stream.
+ * \return The seed.
+ */
+uint64_t RandomStream::get_seed() const {
+  return seed;
+}
+
+/**
+ * \brief Restarts this stream with a seed.
+ * \param seed The new seed.
+ */
+void RandomStream::set_seed(uint64_t seed) {
+
+  this->seed = seed;
+  uint64_t x = seed;
+  const uint64_t first = splitmix64(x);
+  const uint64_t second = splitmix64(x);
+  state[0] = static_cast<uint32_t>(first);
+  state[1] = static_cast<uint32_t>(first >> 32);
+  state[2] = static_cast<uint32_t>(second);
+  state[3] = static_cast<uint32_t>(second >> 32);
+}
+
+/**
+ * \brief Returns a random real number in [0, 1[ with a uniform distribution.
+ * \return A random real number in [0, 1[.
+ */
+double RandomStream::get_real() {
+
+  // 53 random bits, the precision of a double.
+  const uint64_t high = next() >> 5;
+  const uint64_t low = next() >> 6;
+  return static_cast<double>((high << 26) | low) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * \brief Fills an array with random integer numbers in [x, y[.
+ * \param numbers The array to fill.
+ * \param count Number of elements to fill.
+ * \param x The inferior bound.
+ * \param y The superior bound. Must be greater than x.
+ */
+void RandomStream::get_numbers(int* numbers, size_t count, int x, int y) {
+
+  for (size_t i = 0; i < count; ++i) {
+    numbers[i] = get_number(x, y);
+  }
+}
+
+/**
+ * \brief Fills an array with random real numbers in [0, 1[.
+ * \param reals The array to fill.
+ * \param count Number of elements to fill.
+ */
+void RandomStream::get_reals(double* reals, size_t count) {
+
+  for (size_t i = 0; i < count; ++i) {
+    reals[i] = get_real();
+  }
+}
+
+/**
+ * \brief Returns the name identifying this type in Lua.
+ * \return The name identifying this type in Lua.
+ */
+const std::string& RandomStream::get_lua_type_name() const {
+  return LuaContext::random_module_name;
+}
+
+}
@@ -14,47 +14,505 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/audio/Music.h"
+#include "solarus/audio/Sound.h"
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/JobSystem.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/PerfTrace.h"
 #include "solarus/core/ResourceProvider.h"
 #include "solarus/core/QuestDatabase.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/NonAnimatedRegions.h"
+#include "solarus/graphics/Renderer.h"
+#include "solarus/graphics/ShaderData.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <set>
 
 namespace Solarus {
 
+constexpr uint32_t ResourceProvider::update_time_budget;
+
+/**
+ * \brief Result of a preload job, to be finished on the main thread.
+ */
+struct ResourceProvider::PreloadResult {
+  ResourceType resource_type;         /**< Type of resource. */
+  std::string element_id;             /**< Id of the resource element. */
+  PreloadPriority priority;           /**< Priority of the job. */
+  std::shared_ptr<MapData> map_data;  /**< Parsed map, for maps. */
+  std::shared_ptr<SpriteData> sprite_data;  /**< Parsed sprite, for sprites. */
+  std::vector<std::pair<std::string, SDL_Surface_UniquePtr>>
+      images;                         /**< Decoded images of a sprite, with their
+                                       * actual file names. */
+  Sound::DecodedSound sound;          /**< Decoded samples, for sounds. */
+  std::string music_file_name;        /**< File name, for musics. */
+  std::string music_data;             /**< Content of the file, for musics. */
+  std::string vertex_source;          /**< Vertex shader code, for shaders. */
+  std::string fragment_source;        /**< Fragment shader code, for shaders. */
+  double scaling_factor;              /**< Scaling factor, for shaders. */
+};
+
+/**
+ * \brief Compares two preload jobs by urgency.
+ * \param other Another job.
+ * \return \c true if this job should run after the other one.
+ */
+bool ResourceProvider::PreloadJob::operator<(const PreloadJob& other) const {
+
+  if (priority != other.priority) {
+    return priority < other.priority;
+  }
+  return order > other.order;
+}
+
 /**
  * \brief Creates a resource provider.
  */
-ResourceProvider::ResourceProvider() {
+ResourceProvider::ResourceProvider():
+  next_job_order(0),
+  num_scheduled_jobs(0),
+  stopping(false),
+  map_cache_size(NonAnimatedRegions::get_max_saved_maps()) {
 }
 
 /**
- * \brief Preloads resources in background in a separate thread.
+ * \brief Destroys the resource provider and stops preloading.
+ */
+ResourceProvider::~ResourceProvider() {
+
+  stop_preloading();
+}
+
+/**
+ * \brief Preloads resources in background with IO jobs.
+ *
+ * All tilesets are queued with a low priority.
+ * Other resources are preloaded when requested with preload(),
+ * for example when a map requests its neighbors.
  */
 void ResourceProvider::start_preloading_resources() {
 
   // Put all tilesets in the cache, without loading them yet.
   const QuestDatabase& database = CurrentQuest::get_database();
   const QuestDatabase::ResourceMap& tileset_ids = database.get_resource_elements(ResourceType::TILESET);
-  std::vector<std::shared_ptr<Tileset>> tilesets_to_preload;
   for (const auto& pair : tileset_ids) {
-    const std::string& tileset_id = pair.first;
-    std::shared_ptr<Tileset> tileset = std::make_shared<Tileset>(tileset_id);
-    tileset_cache.emplace(tileset_id, tileset);
-    tilesets_to_preload.emplace_back(tileset);
+    preload(ResourceType::TILESET, pair.first, PreloadPriority::LOW);
+  }
+}
+
+/**
+ * \brief Requests a resource to be preloaded in background.
+ *
+ * Does nothing if the resource was already requested with the same or a
+ * higher priority. Only maps, tilesets, sprites, sounds, musics and shaders
+ * can be preloaded. This function must be called from the main thread.
+ *
+ * \param resource_type Type of resource.
+ * \param element_id Id of the resource element.
+ * \param priority How soon the resource will be needed.
+ */
+void ResourceProvider::preload(
+    ResourceType resource_type,
+    const std::string& element_id,
+    PreloadPriority priority) {
+
+  // Resolve file names here: workers must not read the current language.
+  PreloadJob job = { resource_type, element_id, priority, 0, nullptr,
+      std::string(), CurrentQuest::get_language() };
+
+  switch (resource_type) {
+
+  case ResourceType::TILESET:
+  {
+    // Tilesets are cached here, create the object on the main thread.
+    std::shared_ptr<Tileset>& tileset = tileset_cache[element_id];
+    if (tileset == nullptr) {
+      tileset = std::make_shared<Tileset>(element_id);
+    }
+    if (tileset->is_loaded()) {
+      return;
+    }
+    job.tileset = tileset;
+  }
+    break;
+
+  case ResourceType::MAP:
+    if (map_data_cache.find(element_id) != map_data_cache.end()) {
+      return;
+    }
+    job.file_name = std::string("maps/") + element_id + ".dat";
+    break;
+
+  case ResourceType::SPRITE:
+    job.file_name = std::string("sprites/") + element_id + ".dat";
+    break;
+
+  case ResourceType::SOUND:
+    if (!Sound::is_initialized()) {
+      return;
+    }
+    job.file_name = Sound::get_file_name(element_id);
+    break;
+
+  case ResourceType::MUSIC:
+    if (!Music::is_initialized() ||
+        element_id == Music::none ||
+        element_id == Music::unchanged) {
+      return;
+    }
+    break;
+
+  case ResourceType::SHADER:
+    if (!Video::is_initialized()) {
+      return;
+    }
+    job.file_name = std::string("shaders/") + element_id + ".dat";
+    break;
+
+  default:
+    // No preloading for other types.
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(preload_mutex);
+    const ElementKey key(resource_type, element_id);
+    auto it = preload_states.find(key);
+    if (it != preload_states.end()) {
+      if (it->second.started || it->second.priority >= priority) {
+        // Already done, in progress or queued soon enough.
+        return;
+      }
+      // Queue it again with the higher priority, the old job will be skipped.
+      it->second.priority = priority;
+    }
+    else {
+      preload_states.emplace(key, PreloadState{ priority, false });
+    }
+    job.order = next_job_order++;
+    preload_jobs.push(job);
+    ++num_scheduled_jobs;
   }
+  JobSystem::add(JobSystem::Priority::IO, [this]() {
+    run_next_job();
+  });
+}
+
+/**
+ * \brief Requests the maps reachable from a map to be preloaded first.
+ *
+ * Maps that are destinations of teletransporters are preloaded with a normal
+ * priority, as well as, once they are parsed, their tileset, music and
+ * sprites.
+ *
+ * \param map_data The map whose neighbors will be preloaded.
+ */
+void ResourceProvider::preload_map_neighbors(const MapData& map_data) {
 
-  // Start loading them in a separate thread.
-  preloader_thread = std::thread([this, tilesets_to_preload]() {
+  for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+    for (int i = 0; i < map_data.get_num_entities(layer); ++i) {
+      const EntityData& entity = map_data.get_entity({ layer, i });
+      if (entity.get_type() == EntityType::TELETRANSPORTER &&
+          entity.is_string("destination_map")) {
+        const std::string& destination_map = entity.get_string("destination_map");
+        if (!destination_map.empty()) {
+          preload(ResourceType::MAP, destination_map, PreloadPriority::NORMAL);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * \brief Finishes resources preloaded in background.
+ *
+ * Must be called regularly from the main thread.
+ * Uploads images and sounds that jobs have decoded and creates the
+ * corresponding objects, within a time budget.
+ */
+void ResourceProvider::update() {
 
-    for (const std::shared_ptr<Tileset>& tileset : tilesets_to_preload) {
-      if (tileset_cache.empty()) {
-        // clear() was probably called in the meantime.
-        // No reason to continue.
+  PerfTrace::Scope trace_scope("resource-provider-update");
+
+  const uint32_t start_time = System::get_real_time();
+  while (true) {
+    std::unique_ptr<PreloadResult> result;
+    {
+      std::lock_guard<std::mutex> lock(preload_mutex);
+      if (preload_results.empty()) {
         return;
       }
-      tileset->load();
-      std::this_thread::yield();
+      result = std::move(preload_results.front());
+      preload_results.pop_front();
+    }
+
+    finish_job(*result);
+
+    if (System::get_real_time() - start_time >= update_time_budget) {
+      return;
     }
+  }
+}
+
+/**
+ * \brief Returns the resources being preloaded in background.
+ *
+ * These are the resources read by jobs and the ones waiting for update()
+ * to finish them.
+ *
+ * \return A description of each resource, like "sprite hero/tunic1".
+ */
+std::vector<std::string> ResourceProvider::get_active_preloads() {
+
+  std::lock_guard<std::mutex> lock(preload_mutex);
+  std::vector<std::string> preloads;
+  for (const ElementKey& key : running_preloads) {
+    preloads.push_back(enum_to_name(key.first) + " " + key.second);
+  }
+  for (const std::unique_ptr<PreloadResult>& result : preload_results) {
+    preloads.push_back(enum_to_name(result->resource_type) + " " + result->element_id + " (to finish)");
+  }
+  return preloads;
+}
+
+/**
+ * \brief Waits for the preload jobs in progress and forgets pending ones.
+ */
+void ResourceProvider::stop_preloading() {
+
+  std::unique_lock<std::mutex> lock(preload_mutex);
+  stopping = true;
+  preload_condition.wait(lock, [this]() {
+    return num_scheduled_jobs == 0;
   });
+  stopping = false;
+
+  preload_jobs = std::priority_queue<PreloadJob>();
+  preload_results.clear();
+  preload_states.clear();
+}
+
+/**
+ * \brief Runs the most urgent preload job.
+ *
+ * Called from the job system, once per job queued.
+ */
+void ResourceProvider::run_next_job() {
+
+  PreloadJob job;
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> lock(preload_mutex);
+    while (!stopping && !preload_jobs.empty() && !found) {
+      job = preload_jobs.top();
+      preload_jobs.pop();
+
+      auto it = preload_states.find(ElementKey(job.resource_type, job.element_id));
+      if (it == preload_states.end() ||
+          it->second.started ||
+          it->second.priority != job.priority) {
+        // Outdated duplicate of a job requested again with a higher priority.
+        continue;
+      }
+      it->second.started = true;
+      found = true;
+      running_preloads.emplace_back(job.resource_type, job.element_id);
+    }
+  }
+
+  std::unique_ptr<PreloadResult> result;
+  if (found) {
+    result = run_job(job);
+  }
+
+  std::lock_guard<std::mutex> lock(preload_mutex);
+  if (found) {
+    running_preloads.erase(std::find(running_preloads.begin(), running_preloads.end(),
+        ElementKey(job.resource_type, job.element_id)));
+  }
+  if (result != nullptr && !stopping) {
+    preload_results.emplace_back(std::move(result));
+  }
+  --num_scheduled_jobs;
+  preload_condition.notify_all();
+}
+
+/**
+ * \brief Does the part of a preload job that does not need the main thread.
+ *
+ * Only reads files, decodes data and parses data files.
+ *
+ * \param job The job to run.
+ * \return What is left to do on the main thread, if anything.
+ */
+std::unique_ptr<ResourceProvider::PreloadResult> ResourceProvider::run_job(
+    const PreloadJob& job) {
+
+  std::unique_ptr<PreloadResult> result(new PreloadResult());
+  result->resource_type = job.resource_type;
+  result->element_id = job.element_id;
+  result->priority = job.priority;
+
+  switch (job.resource_type) {
+
+  case ResourceType::TILESET:
+    // Tilesets only decode their images here and upload them when used.
+    job.tileset->load();
+    return nullptr;
+
+  case ResourceType::MAP:
+  {
+    std::shared_ptr<MapData> map_data = std::make_shared<MapData>();
+    const std::string& file_name = job.file_name;
+    if (!QuestFiles::data_file_exists(file_name) ||
+        !map_data->import_from_quest_file(file_name)) {
+      return nullptr;
+    }
+    result->map_data = map_data;
+  }
+    break;
+
+  case ResourceType::SPRITE:
+  {
+    std::shared_ptr<SpriteData> sprite_data = std::make_shared<SpriteData>();
+    const std::string& file_name = job.file_name;
+    if (!QuestFiles::data_file_exists(file_name) ||
+        !sprite_data->import_from_quest_file(file_name)) {
+      return nullptr;
+    }
+    std::set<std::string> image_file_names;
+    for (const auto& kvp : sprite_data->get_animations()) {
+      const std::string& src_image = kvp.second.get_src_image();
+      if (src_image == "tileset") {
+        continue;
+      }
+      const std::string& image_file_name =
+          Surface::get_image_file_name(src_image, Surface::DIR_SPRITES, job.language);
+      if (image_file_names.insert(image_file_name).second &&
+          QuestFiles::data_file_exists(image_file_name)) {
+        result->images.emplace_back(
+              image_file_name,
+              Surface::create_sdl_surface_from_file(image_file_name)
+        );
+      }
+    }
+    result->sprite_data = sprite_data;
+  }
+    break;
+
+  case ResourceType::SOUND:
+  {
+    const std::string& file_name = job.file_name;
+    if (!QuestFiles::data_file_exists(file_name) ||
+        !Sound::decode_samples(file_name, result->sound)) {
+      return nullptr;
+    }
+  }
+    break;
+
+  case ResourceType::MUSIC:
+  {
+    Music::Format format;
+    Music::find_music_file(job.element_id, result->music_file_name, format);
+    if (result->music_file_name.empty()) {
+      return nullptr;
+    }
+    result->music_data = QuestFiles::data_file_read(result->music_file_name);
+  }
+    break;
+
+  case ResourceType::SHADER:
+  {
+    ShaderData shader_data;
+    const std::string& file_name = job.file_name;
+    if (!QuestFiles::data_file_exists(file_name) ||
+        !shader_data.import_from_quest_file(file_name)) {
+      return nullptr;
+    }
+    const std::string& vertex_file_name = "shaders/" + shader_data.get_vertex_file();
+    if (!shader_data.get_vertex_file().empty() &&
+        QuestFiles::data_file_exists(vertex_file_name)) {
+      result->vertex_source = QuestFiles::data_file_read(vertex_file_name);
+    }
+    const std::string& fragment_file_name = "shaders/" + shader_data.get_fragment_file();
+    if (!shader_data.get_fragment_file().empty() &&
+        QuestFiles::data_file_exists(fragment_file_name)) {
+      result->fragment_source = QuestFiles::data_file_read(fragment_file_name);
+    }
+    result->scaling_factor = shader_data.get_scaling_factor();
+  }
+    break;
+
+  default:
+    return nullptr;
+  }
+
+  return result;
+}
+
+/**
+ * \brief Does the part of a preload job that needs the main thread.
+ * \param result What the job produced.
+ */
+void ResourceProvider::finish_job(PreloadResult& result) {
+
+  switch (result.resource_type) {
+
+  case ResourceType::MAP:
+  {
+    const MapData& map_data = *result.map_data;
+    map_data_cache[result.element_id] = result.map_data;
+
+    // Now that we know what the map contains, preload it too.
+    preload(ResourceType::TILESET, map_data.get_tileset_id(), result.priority);
+    preload(ResourceType::MUSIC, map_data.get_music_id(), result.priority);
+    for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+      for (int i = 0; i < map_data.get_num_entities(layer); ++i) {
+        const EntityData& entity = map_data.get_entity({ layer, i });
+        if (entity.is_string("sprite")) {
+          const std::string& sprite_id = entity.get_string("sprite");
+          if (!sprite_id.empty()) {
+            preload(ResourceType::SPRITE, sprite_id, result.priority);
+          }
+        }
+      }
+    }
+  }
+    break;
+
+  case ResourceType::SPRITE:
+    for (auto& image : result.images) {
+      Surface::add_preloaded_image(image.first, std::move(image.second));
+    }
+    Sprite::add_preloaded_animation_set(result.element_id, *result.sprite_data);
+    break;
+
+  case ResourceType::SOUND:
+    Sound::add_preloaded(result.element_id, std::move(result.sound));
+    break;
+
+  case ResourceType::MUSIC:
+    Music::add_preloaded_file(result.music_file_name, std::move(result.music_data));
+    break;
+
+  case ResourceType::SHADER:
+    // Compile and link the program once: the renderer saves it in its
+    // program cache if it has one, and the driver may keep it too.
+    // The shader itself is created again when the quest needs it.
+    Video::get_renderer().create_shader(
+        result.vertex_source, result.fragment_source, result.scaling_factor
+    );
+    break;
+
+  default:
+    break;
+  }
 }
 
 /**
@@ -62,8 +520,11 @@ void ResourceProvider::start_preloading_resources() {
  */
 void ResourceProvider::clear() {
 
+  stop_preloading();
   tileset_cache.clear();
-  preloader_thread.join();
+  map_data_cache.clear();
+  recent_map_data.clear();
+  NonAnimatedRegions::clear_saved_cells();
 }
 
 /**
@@ -75,12 +536,12 @@ Tileset& ResourceProvider::get_tileset(const std::string& tileset_id) {
 
   std::shared_ptr<Tileset> tileset;
   auto it = tileset_cache.find(tileset_id);
-  if (it->second != nullptr) {
+  if (it != tileset_cache.end() && it->second != nullptr) {
     tileset = it->second;
   }
   else {
     tileset = std::make_shared<Tileset>(tileset_id);
-    tileset_cache.emplace(tileset_id, tileset);
+    tileset_cache[tileset_id] = tileset;
   }
 
   tileset->load();
@@ -96,10 +557,108 @@ const std::map<std::string, std::shared_ptr<Tileset>>& ResourceProvider::get_loa
   return tileset_cache;
 }
 
+/**
+ * \brief Returns the data of a map if it was preloaded.
+ *
+ * The data is removed from the cache, so that it can be preloaded again
+ * later.
+ *
+ * \param map_id A map id.
+ * \return The parsed map data, or nullptr if it is not preloaded yet.
+ */
+std::shared_ptr<MapData> ResourceProvider::take_map_data(const std::string& map_id) {
+
+  std::shared_ptr<MapData> map_data;
+  auto it = map_data_cache.find(map_id);
+  if (it != map_data_cache.end()) {
+    map_data = it->second;
+    map_data_cache.erase(it);
+  }
+
+  if (map_data != nullptr) {
+    // Allow preloading it again next time.
+    std::lock_guard<std::mutex> lock(preload_mutex);
+    preload_states.erase(ElementKey(ResourceType::MAP, map_id));
+    return map_data;
+  }
+
+  // Maybe the map was used recently.
+  for (const auto& recent : recent_map_data) {
+    if (recent.first == map_id) {
+      return recent.second;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * \brief Keeps the data of a map that was just loaded,
+ * so that it is not parsed again if the map is entered again soon.
+ *
+ * Only the data of the last get_map_cache_size() maps is kept.
+ * The data must not be modified after this call.
+ *
+ * \param map_id A map id.
+ * \param map_data The parsed map data.
+ */
+void ResourceProvider::keep_recent_map_data(
+    const std::string& map_id,
+    const std::shared_ptr<MapData>& map_data) {
+
+  for (auto it = recent_map_data.begin(); it != recent_map_data.end(); ++it) {
+    if (it->first == map_id) {
+      recent_map_data.erase(it);
+      break;
+    }
+  }
+  if (map_cache_size <= 0) {
+    return;
+  }
+  recent_map_data.emplace_front(map_id, map_data);
+  // The current map plus the ones recently left.
+  while (recent_map_data.size() > static_cast<size_t>(map_cache_size) + 1) {
+    recent_map_data.pop_back();
+  }
+}
+
+/**
+ * \brief Returns the number of recently left maps whose data and tile
+ * drawings are kept.
+ * \return The number of maps kept.
+ */
+int ResourceProvider::get_map_cache_size() const {
+  return map_cache_size;
+}
+
+/**
+ * \brief Sets the number of recently left maps whose data and tile
+ * drawings are kept to enter them again faster.
+ *
+ * The state of their entities is not kept: maps entered again are
+ * started from their data as usual.
+ *
+ * \param map_cache_size The number of maps to keep. 0 keeps none.
+ */
+void ResourceProvider::set_map_cache_size(int map_cache_size) {
+
+  this->map_cache_size = map_cache_size;
+  while (recent_map_data.size() > static_cast<size_t>(std::max(0, map_cache_size)) + 1) {
+    recent_map_data.pop_back();
+  }
+  if (map_cache_size <= 0) {
+    recent_map_data.clear();
+  }
+  NonAnimatedRegions::set_max_saved_maps(map_cache_size);
+}
+
 /**
  * \brief Notifies the resource provider that cached data (if any) is no longer valid.
  *
  * This function must be called when a resource element has changed on disk.
+ * Tilesets, sprites and sounds already loaded are reloaded in place,
+ * so that the objects using them switch to the new version.
+ * Maps using a reloaded tileset still have to refresh their tiles
+ * with Map::set_tileset().
  *
  * \param resource_type Type of resource that has changed.
  * \param element_id Resource element that has changed.
@@ -112,13 +671,45 @@ void ResourceProvider::invalidate_resource_element(
 
   case ResourceType::TILESET:
   {
-    tileset_cache.erase(element_id);
+    // Maps and dynamic tiles point to the tileset: keep the same object.
+    auto it = tileset_cache.find(element_id);
+    if (it != tileset_cache.end() && it->second != nullptr && it->second->is_loaded()) {
+      it->second->reload();
+    }
+    // Tiles of maps left recently were drawn with the old version.
+    NonAnimatedRegions::clear_saved_cells();
+  }
+    break;
+
+  case ResourceType::SPRITE:
+    Sprite::reload_animation_set(element_id);
+    break;
+
+  case ResourceType::SOUND:
+    Sound::reload(element_id);
+    break;
+
+  case ResourceType::MAP:
+  {
+    map_data_cache.erase(element_id);
+    for (auto it = recent_map_data.begin(); it != recent_map_data.end(); ++it) {
+      if (it->first == element_id) {
+        recent_map_data.erase(it);
+        break;
+      }
+    }
   }
     break;
 
   default:
     break;
   }
+
+  std::lock_guard<std::mutex> lock(preload_mutex);
+  auto it = preload_states.find(ElementKey(resource_type, element_id));
+  if (it != preload_states.end() && it->second.started) {
+    preload_states.erase(it);
+  }
 }
 
 }
@@ -14,6 +14,8 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/AsyncFileWriter.h"
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/InputEvent.h"
 #include "solarus/core/MainLoop.h"
@@ -25,9 +27,70 @@
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
 #include <sstream>
+#include <vector>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Identifies binary savegame files.
+ */
+const std::string binary_magic = "SOLG";
+
+/**
+ * \brief Version of the binary savegame encoding.
+ */
+constexpr uint32_t binary_version = 1;
+
+/**
+ * \brief Type of a value in a binary savegame file.
+ */
+enum BinaryValueType {
+  BINARY_STRING = 0,
+  BINARY_INTEGER = 1,
+  BINARY_BOOLEAN = 2,
+  BINARY_UNSET = 3     /**< Removed value (only in the journal). */
+};
+
+/**
+ * \brief Writes a block of a binary savegame file.
+ *
+ * A block is followed by its hash so that a block partially written
+ * when the program was interrupted is detected.
+ *
+ * \param writer The writer.
+ * \param block The block to write.
+ */
+void write_binary_block(BinaryWriter& writer, const std::string& block) {
+
+  writer.write_string(block);
+  writer.write_uint64(get_fnv1a_hash(block.data(), block.size()));
+}
+
+/**
+ * \brief Reads a block of a binary savegame file.
+ * \param[in] reader The reader.
+ * \param[out] block The block read.
+ * \return \c false if the block is truncated or corrupted.
+ */
+bool read_binary_block(BinaryReader& reader, std::string& block) {
+
+  block = reader.read_string();
+  const uint64_t hash = reader.read_uint64();
+  return !reader.has_failed() &&
+      hash == get_fnv1a_hash(block.data(), block.size());
+}
+
+}  // Anonymous namespace
+
+const std::string EnumInfoTraits<Savegame::Format>::pretty_name = "savegame format";
+
+const EnumInfo<Savegame::Format>::names_type EnumInfoTraits<Savegame::Format>::names = {
+    { Savegame::Format::TEXT, "text" },
+    { Savegame::Format::BINARY, "binary" }
+};
+
 const int Savegame::SAVEGAME_VERSION = 2;
 
 const std::string Savegame::KEY_SAVEGAME_VERSION = "_version";         /**< Format of this savegame file. */
@@ -85,12 +148,21 @@ const std::string Savegame::KEY_ABILITY_GET_BACK_FROM_DEATH =
  */
 Savegame::Savegame(MainLoop& main_loop, const std::string& file_name):
   ExportableToLua(),
+  values(),
+  value_keys(),
+  value_slots(),
   empty(true),
   file_name(file_name),
   main_loop(main_loop),
   equipment(*this),
   game(nullptr),
-  default_transition_style(Transition::Style::FADE) {
+  default_transition_style(Transition::Style::FADE),
+  format(Format::TEXT),
+  dirty_keys(),
+  changed_keys(),
+  key_indexes(),
+  snapshot_size(0),
+  journal_size(0) {
 
   // Don't call initialize() manually because the shared_ptr does not exist
   // at this point, but is needed by initialize() when calling item scripts.
@@ -110,6 +182,9 @@ void Savegame::initialize() {
   Debug::check_assertion(!quest_write_dir.empty(),
       "The quest write directory for savegames was not set in quest.dat");
 
+  // Read the last version saved.
+  AsyncFileWriter::flush();
+
   if (!QuestFiles::data_file_exists(file_name)) {
     // This save does not exist yet.
     empty = true;
@@ -225,9 +300,21 @@ void Savegame::post_process_existing_savegame() {
  */
 void Savegame::import_from_file() {
 
+  const std::string& buffer = QuestFiles::data_file_read(file_name);
+  if (buffer.compare(0, binary_magic.size(), binary_magic) == 0) {
+    if (!import_from_binary(buffer)) {
+      Debug::die(std::string("Failed to load savegame file '")
+          + file_name + "': invalid binary data");
+    }
+    format = Format::BINARY;
+    dirty_keys.clear();
+    post_process_existing_savegame();
+    return;
+  }
+
   // Try to parse as Lua first.
+  format = Format::TEXT;
   lua_State* l = luaL_newstate();
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
   const int load_result = luaL_loadbuffer(l, buffer.data(), buffer.size(), file_name.c_str());
 
   // Call the Lua savegame file.
@@ -266,9 +353,121 @@ void Savegame::import_from_file() {
 
   lua_close(l);
 
+  dirty_keys.clear();
   post_process_existing_savegame();
 }
 
+/**
+ * \brief Loads the values from a binary savegame file.
+ *
+ * The snapshot is read first, then the changes of the journal.
+ * Reading stops at the first journal block that is truncated or corrupted:
+ * the next save then rewrites the whole file.
+ *
+ * \param buffer Content of the file.
+ * \return \c false if the snapshot is invalid.
+ */
+bool Savegame::import_from_binary(const std::string& buffer) {
+
+  BinaryReader reader(buffer, binary_magic.size());
+  const uint32_t version = reader.read_uint();
+  std::string block;
+  if (reader.has_failed() ||
+      version != binary_version ||
+      !read_binary_block(reader, block)) {
+    return false;
+  }
+
+  // Snapshot: all values, in the order of the string table.
+  std::vector<std::string> keys;
+  BinaryReader snapshot_reader(block);
+  const size_t num_values = snapshot_reader.read_count();
+  for (size_t i = 0; i < num_values; ++i) {
+    const std::string& key = snapshot_reader.read_string();
+    if (!import_binary_value(snapshot_reader, key)) {
+      return false;
+    }
+    keys.push_back(key);
+  }
+  if (snapshot_reader.has_failed()) {
+    return false;
+  }
+  snapshot_size = reader.get_position();
+  journal_size = 0;
+
+  // Journal: changes appended by each save, referring to keys by index.
+  bool journal_valid = true;
+  while (journal_valid && !reader.is_at_end()) {
+    if (!read_binary_block(reader, block)) {
+      journal_valid = false;
+      break;
+    }
+    BinaryReader journal_reader(block);
+    const size_t num_changes = journal_reader.read_count();
+    for (size_t i = 0; i < num_changes && journal_valid; ++i) {
+      const uint32_t index = journal_reader.read_uint();
+      if (index == keys.size()) {
+        keys.push_back(journal_reader.read_string());
+      }
+      journal_valid = index < keys.size() &&
+          import_binary_value(journal_reader, keys[index]);
+    }
+    journal_valid = journal_valid && !journal_reader.has_failed();
+    journal_size = reader.get_position() - snapshot_size;
+  }
+
+  key_indexes.clear();
+  for (size_t i = 0; i < keys.size(); ++i) {
+    key_indexes[keys[i]] = static_cast<uint32_t>(i);
+  }
+  if (!journal_valid) {
+    // Don't append after garbage.
+    snapshot_size = 0;
+  }
+  return true;
+}
+
+/**
+ * \brief Reads a value of a binary savegame file.
+ * \param reader The reader.
+ * \param key Key of the value.
+ * \return \c false if the value is invalid.
+ */
+bool Savegame::import_binary_value(BinaryReader& reader, const std::string& key) {
+
+  if (!LuaTools::is_valid_lua_identifier(key)) {
+    return false;
+  }
+
+  SavedValue& value = get_value(get_value_handle(key));
+  switch (reader.read_uint()) {
+
+  case BINARY_STRING:
+    value.type = SavedValue::VALUE_STRING;
+    value.string_data = reader.read_string();
+    break;
+
+  case BINARY_INTEGER:
+    value.type = SavedValue::VALUE_INTEGER;
+    value.int_data = reader.read_int();
+    break;
+
+  case BINARY_BOOLEAN:
+    value.type = SavedValue::VALUE_BOOLEAN;
+    value.int_data = reader.read_bool();
+    break;
+
+  case BINARY_UNSET:
+    value.type = SavedValue::VALUE_UNSET;
+    value.string_data.clear();
+    break;
+
+  default:
+    return false;
+  }
+  return !reader.has_failed();
+}
+
 /**
  * \brief __newindex function of the environment of the savegame file.
  *
@@ -311,14 +510,88 @@ int Savegame::l_newindex(lua_State* l) {
 
 /**
  * \brief Saves the data into a file.
+ *
+ * With the binary format, only the values changed since the last save
+ * are appended to the file, unless the file needs to be compacted.
  */
 void Savegame::save() {
 
+  // Don't let a previous asynchronous save overwrite this one.
+  AsyncFileWriter::flush();
+
+  if (format == Format::BINARY && append_journal()) {
+    empty = false;
+    return;
+  }
+
+  const std::string& buffer = export_to_buffer();
+  QuestFiles::data_file_save(file_name, buffer);
+  empty = false;
+}
+
+/**
+ * \brief Saves the data into a file in background.
+ *
+ * Values are copied immediately: later changes are not saved.
+ * If a previous asynchronous save of the same file is not started yet,
+ * only this one is written.
+ * The whole file is always written.
+ *
+ * \param callback Function called by the main loop when the file is written,
+ * with a boolean telling whether it succeeded. Can be an empty function.
+ */
+void Savegame::save_async(const std::function<void(bool)>& callback) {
+
+  const std::weak_ptr<Savegame> weak_savegame =
+      std::static_pointer_cast<Savegame>(shared_from_this());
+  AsyncFileWriter::write(file_name, export_to_buffer(),
+      [weak_savegame, callback](bool success) {
+    const std::shared_ptr<Savegame>& savegame = weak_savegame.lock();
+    if (!success && savegame != nullptr) {
+      // The file does not match the string table: rewrite it next time.
+      savegame->snapshot_size = 0;
+    }
+    if (callback) {
+      callback(success);
+    }
+  });
+  empty = false;
+}
+
+/**
+ * \brief Returns the whole content of the savegame file in its format.
+ *
+ * The changes are then considered as saved.
+ *
+ * \return The content of the file.
+ */
+std::string Savegame::export_to_buffer() {
+
+  dirty_keys.clear();
+  if (format == Format::BINARY) {
+    return export_to_binary();
+  }
+
+  key_indexes.clear();
+  snapshot_size = 0;
+  journal_size = 0;
+  return export_to_text();
+}
+
+/**
+ * \brief Returns the saved values as Lua text.
+ * \return The text.
+ */
+std::string Savegame::export_to_text() const {
+
   std::ostringstream oss;
-  for (const auto& kvp: saved_values) {
+  for (const auto& kvp: value_slots) {
     const std::string& key = kvp.first;
+    const SavedValue& value = values[kvp.second];
+    if (value.type == SavedValue::VALUE_UNSET) {
+      continue;
+    }
     oss << key << " = ";
-    const SavedValue& value = kvp.second;
     if (value.type == SavedValue::VALUE_BOOLEAN) {
       oss << (value.int_data ? "true" : "false");
     }
@@ -330,10 +603,125 @@ void Savegame::save() {
     }
     oss << "\n";
   }
+  return oss.str();
+}
 
-  const std::string& text = oss.str();
-  QuestFiles::data_file_save(file_name, text);
-  empty = false;
+/**
+ * \brief Returns the saved values as a binary snapshot with no journal.
+ *
+ * The order of values in the snapshot becomes the string table used
+ * by the journal.
+ *
+ * \return The binary content.
+ */
+std::string Savegame::export_to_binary() {
+
+  uint32_t num_values = 0;
+  for (const SavedValue& value: values) {
+    if (value.type != SavedValue::VALUE_UNSET) {
+      ++num_values;
+    }
+  }
+
+  BinaryWriter snapshot;
+  snapshot.write_uint(num_values);
+  key_indexes.clear();
+  uint32_t index = 0;
+  for (const auto& kvp: value_slots) {
+    const std::string& key = kvp.first;
+    const SavedValue& value = values[kvp.second];
+    if (value.type == SavedValue::VALUE_UNSET) {
+      continue;
+    }
+    key_indexes[key] = index++;
+    snapshot.write_string(key);
+    if (value.type == SavedValue::VALUE_BOOLEAN) {
+      snapshot.write_uint(BINARY_BOOLEAN);
+      snapshot.write_bool(value.int_data != 0);
+    }
+    else if (value.type == SavedValue::VALUE_INTEGER) {
+      snapshot.write_uint(BINARY_INTEGER);
+      snapshot.write_int(value.int_data);
+    }
+    else {
+      snapshot.write_uint(BINARY_STRING);
+      snapshot.write_string(value.string_data);
+    }
+  }
+
+  BinaryWriter writer;
+  writer.write_uint(binary_version);
+  write_binary_block(writer, snapshot.get_buffer());
+
+  snapshot_size = binary_magic.size() + writer.get_buffer().size();
+  journal_size = 0;
+  return binary_magic + writer.get_buffer();
+}
+
+/**
+ * \brief Appends the values changed since the last save to the binary file.
+ *
+ * Keys that are not in the string table yet are added to it.
+ *
+ * \return \c false if the whole file should be written instead:
+ * when the file is not known to match the string table, or when the journal
+ * became larger than the snapshot and the file needs to be compacted.
+ */
+bool Savegame::append_journal() {
+
+  if (snapshot_size == 0 ||
+      journal_size > snapshot_size ||
+      !QuestFiles::data_file_exists(file_name)) {
+    return false;
+  }
+
+  if (dirty_keys.empty()) {
+    return true;
+  }
+
+  BinaryWriter changes;
+  changes.write_uint(static_cast<uint32_t>(dirty_keys.size()));
+  for (const std::string& key : dirty_keys) {
+    const auto& index_it = key_indexes.find(key);
+    if (index_it != key_indexes.end()) {
+      changes.write_uint(index_it->second);
+    }
+    else {
+      const uint32_t index = static_cast<uint32_t>(key_indexes.size());
+      changes.write_uint(index);
+      changes.write_string(key);
+      key_indexes[key] = index;
+    }
+
+    const SavedValue* value_ptr = find_value(key);
+    if (value_ptr == nullptr) {
+      changes.write_uint(BINARY_UNSET);
+      continue;
+    }
+    const SavedValue& value = *value_ptr;
+    if (value.type == SavedValue::VALUE_BOOLEAN) {
+      changes.write_uint(BINARY_BOOLEAN);
+      changes.write_bool(value.int_data != 0);
+    }
+    else if (value.type == SavedValue::VALUE_INTEGER) {
+      changes.write_uint(BINARY_INTEGER);
+      changes.write_int(value.int_data);
+    }
+    else {
+      changes.write_uint(BINARY_STRING);
+      changes.write_string(value.string_data);
+    }
+  }
+
+  BinaryWriter writer;
+  write_binary_block(writer, changes.get_buffer());
+  if (!QuestFiles::data_file_append(file_name, writer.get_buffer())) {
+    return false;
+  }
+
+  journal_size += writer.get_buffer().size();
+  dirty_keys.clear();
+  return true;
 }
 
 /**
@@ -344,6 +732,32 @@ const std::string& Savegame::get_file_name() const {
   return file_name;
 }
 
+/**
+ * \brief Returns the encoding of the savegame file.
+ * \return The format.
+ */
+Savegame::Format Savegame::get_format() const {
+  return format;
+}
+
+/**
+ * \brief Sets the encoding of the savegame file.
+ *
+ * The whole file is written in the new format at the next save.
+ * Existing files are read in both formats, so text savegames are
+ * converted by loading them and saving them in the binary format.
+ *
+ * \param format The format.
+ */
+void Savegame::set_format(Format format) {
+
+  if (format == this->format) {
+    return;
+  }
+  this->format = format;
+  snapshot_size = 0;
+}
+
 /**
  * \brief Returns the Solarus main loop.
  * \return The main loop.
@@ -414,6 +828,95 @@ void Savegame::notify_game_finished() {
   equipment.notify_game_finished();
 }
 
+/**
+ * \brief Returns the value of a key if it is set.
+ * \param key Name of the value to get.
+ * \return The value, or nullptr if it is not set.
+ */
+const Savegame::SavedValue* Savegame::find_value(const std::string& key) const {
+
+  const auto& it = value_slots.find(key);
+  if (it == value_slots.end()) {
+    return nullptr;
+  }
+  const SavedValue& value = values[it->second];
+  if (value.type == SavedValue::VALUE_UNSET) {
+    return nullptr;
+  }
+  return &value;
+}
+
+/**
+ * \brief Returns the value referred to by a handle.
+ * \param handle A handle obtained from this savegame.
+ * \return The value, possibly unset.
+ */
+const Savegame::SavedValue& Savegame::get_value(SavegameValueHandle handle) const {
+
+  SOLARUS_ASSERT(is_value_handle(handle), "Invalid savegame value handle");
+  return values[handle.get_slot()];
+}
+
+/**
+ * \brief Returns the value referred to by a handle.
+ * \param handle A handle obtained from this savegame.
+ * \return The value, possibly unset.
+ */
+Savegame::SavedValue& Savegame::get_value(SavegameValueHandle handle) {
+
+  SOLARUS_ASSERT(is_value_handle(handle), "Invalid savegame value handle");
+  return values[handle.get_slot()];
+}
+
+/**
+ * \brief Returns a handle to access a value without looking up its key.
+ *
+ * The value does not have to be set: the handle remains valid if the value
+ * is set or unset later.
+ *
+ * \param key Name of a value.
+ * \return The handle of this value.
+ */
+SavegameValueHandle Savegame::get_value_handle(const std::string& key) {
+
+  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
+      std::string("Savegame variable '") + key + "' is not a valid key");
+
+  const auto& it = value_slots.find(key);
+  if (it != value_slots.end()) {
+    return SavegameValueHandle(it->second);
+  }
+
+  const uint32_t slot = static_cast<uint32_t>(values.size());
+  SavedValue value;
+  value.type = SavedValue::VALUE_UNSET;
+  value.int_data = 0;
+  values.push_back(value);
+  value_keys.push_back(key);
+  value_slots.emplace(key, slot);
+  return SavegameValueHandle(slot);
+}
+
+/**
+ * \brief Returns whether a handle refers to a value of this savegame.
+ * \param handle The handle to check.
+ * \return \c true if it was obtained from this savegame.
+ */
+bool Savegame::is_value_handle(SavegameValueHandle handle) const {
+  return handle.get_slot() < values.size();
+}
+
+/**
+ * \brief Returns the key of the value referred to by a handle.
+ * \param handle A handle obtained from this savegame.
+ * \return Name of the value.
+ */
+const std::string& Savegame::get_value_key(SavegameValueHandle handle) const {
+
+  SOLARUS_ASSERT(is_value_handle(handle), "Invalid savegame value handle");
+  return value_keys[handle.get_slot()];
+}
+
 /**
  * \brief Returns whether a saved value is a string.
  * \param key Name of the value to get.
@@ -424,13 +927,18 @@ bool Savegame::is_string(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  bool result = false;
-  const auto& it = saved_values.find(key);
-  if (it != saved_values.end()) {
-    const SavedValue& value = it->second;
-    result = (value.type == SavedValue::VALUE_STRING);
-  }
-  return result;
+  const SavedValue* value = find_value(key);
+  return value != nullptr && value->type == SavedValue::VALUE_STRING;
+}
+
+/**
+ * \brief Returns whether a saved value is a string.
+ * \param handle Handle of the value to get.
+ * \return true if this value exists and is a string.
+ */
+bool Savegame::is_string(SavegameValueHandle handle) const {
+
+  return get_value(handle).type == SavedValue::VALUE_STRING;
 }
 
 /**
@@ -459,14 +967,27 @@ std::string Savegame::get_string(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  const auto& it = saved_values.find(key);
-  if (it == saved_values.end()) {
+  const auto& it = value_slots.find(key);
+  if (it == value_slots.end()) {
+    return "";
+  }
+  return get_string(SavegameValueHandle(it->second));
+}
+
+/**
+ * \brief Returns a string value saved.
+ * \param handle Handle of the value to get.
+ * \return The string value or an empty string.
+ */
+std::string Savegame::get_string(SavegameValueHandle handle) const {
+
+  const SavedValue& value = get_value(handle);
+  if (value.type == SavedValue::VALUE_UNSET) {
     return "";
   }
 
-  const SavedValue& value = it->second;
   if (value.type != SavedValue::VALUE_STRING) {
-    Debug::error(std::string("Value '") + key + "' is not a string");
+    Debug::error(std::string("Value '") + get_value_key(handle) + "' is not a string");
     return "";
   }
 
@@ -480,11 +1001,25 @@ std::string Savegame::get_string(const std::string& key) const {
  */
 void Savegame::set_string(const std::string& key, const std::string& value) {
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+  set_string(get_value_handle(key), value);
+}
 
-  saved_values[key].type = SavedValue::VALUE_STRING;
-  saved_values[key].string_data = value;
+/**
+ * \brief Sets a string value saved.
+ * \param handle Handle of the value to set.
+ * \param value The string value to associate with this key.
+ */
+void Savegame::set_string(SavegameValueHandle handle, const std::string& value) {
+
+  SavedValue& saved_value = get_value(handle);
+  const std::string& key = get_value_key(handle);
+  if (saved_value.type != SavedValue::VALUE_STRING ||
+      saved_value.string_data != value) {
+    notify_value_changed(key);
+  }
+  saved_value.type = SavedValue::VALUE_STRING;
+  saved_value.string_data = value;
+  dirty_keys.insert(key);
 }
 
 /**
@@ -497,13 +1032,18 @@ bool Savegame::is_integer(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  bool result = false;
-  const auto& it = saved_values.find(key);
-  if (it != saved_values.end()) {
-    const SavedValue& value = it->second;
-    result = (value.type == SavedValue::VALUE_INTEGER);
-  }
-  return result;
+  const SavedValue* value = find_value(key);
+  return value != nullptr && value->type == SavedValue::VALUE_INTEGER;
+}
+
+/**
+ * \brief Returns whether a saved value is an integer.
+ * \param handle Handle of the value to get.
+ * \return true if this value exists and is an integer.
+ */
+bool Savegame::is_integer(SavegameValueHandle handle) const {
+
+  return get_value(handle).type == SavedValue::VALUE_INTEGER;
 }
 
 /**
@@ -516,14 +1056,27 @@ int Savegame::get_integer(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  const auto& it = saved_values.find(key);
-  if (it == saved_values.end()) {
+  const auto& it = value_slots.find(key);
+  if (it == value_slots.end()) {
+    return 0;
+  }
+  return get_integer(SavegameValueHandle(it->second));
+}
+
+/**
+ * \brief Returns a integer value saved.
+ * \param handle Handle of the value to get.
+ * \return The integer value or 0.
+ */
+int Savegame::get_integer(SavegameValueHandle handle) const {
+
+  const SavedValue& value = get_value(handle);
+  if (value.type == SavedValue::VALUE_UNSET) {
     return 0;
   }
 
-  const SavedValue& value = it->second;
   if (value.type != SavedValue::VALUE_INTEGER) {
-    Debug::error(std::string("Value '") + key + "' is not an integer");
+    Debug::error(std::string("Value '") + get_value_key(handle) + "' is not an integer");
   }
 
   return value.int_data;
@@ -536,11 +1089,26 @@ int Savegame::get_integer(const std::string& key) const {
  */
 void Savegame::set_integer(const std::string& key, int value) {
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+  set_integer(get_value_handle(key), value);
+}
 
-  saved_values[key].type = SavedValue::VALUE_INTEGER;
-  saved_values[key].int_data = value;
+/**
+ * \brief Sets an integer value saved.
+ * \param handle Handle of the value to set.
+ * \param value The integer value to associate with this key.
+ */
+void Savegame::set_integer(SavegameValueHandle handle, int value) {
+
+  SavedValue& saved_value = get_value(handle);
+  const std::string& key = get_value_key(handle);
+  if (saved_value.type != SavedValue::VALUE_INTEGER ||
+      saved_value.int_data != value) {
+    notify_value_changed(key);
+  }
+  saved_value.type = SavedValue::VALUE_INTEGER;
+  saved_value.int_data = value;
+  saved_value.string_data.clear();
+  dirty_keys.insert(key);
 }
 
 /**
@@ -553,13 +1121,18 @@ bool Savegame::is_boolean(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  bool result = false;
-  const auto& it = saved_values.find(key);
-  if (it != saved_values.end()) {
-    const SavedValue& value = it->second;
-    result = (value.type == SavedValue::VALUE_BOOLEAN);
-  }
-  return result;
+  const SavedValue* value = find_value(key);
+  return value != nullptr && value->type == SavedValue::VALUE_BOOLEAN;
+}
+
+/**
+ * \brief Returns whether a saved value is a boolean.
+ * \param handle Handle of the value to get.
+ * \return true if this value exists and is a boolean.
+ */
+bool Savegame::is_boolean(SavegameValueHandle handle) const {
+
+  return get_value(handle).type == SavedValue::VALUE_BOOLEAN;
 }
 
 /**
@@ -572,14 +1145,27 @@ bool Savegame::get_boolean(const std::string& key) const {
   SOLARUS_ASSERT(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  const auto& it = saved_values.find(key);
-  if (it == saved_values.end()) {
+  const auto& it = value_slots.find(key);
+  if (it == value_slots.end()) {
+    return false;
+  }
+  return get_boolean(SavegameValueHandle(it->second));
+}
+
+/**
+ * \brief Returns a boolean value saved.
+ * \param handle Handle of the value to get.
+ * \return The boolean value or false.
+ */
+bool Savegame::get_boolean(SavegameValueHandle handle) const {
+
+  const SavedValue& value = get_value(handle);
+  if (value.type == SavedValue::VALUE_UNSET) {
     return false;
   }
 
-  const SavedValue& value = it->second;
   if (value.type != SavedValue::VALUE_BOOLEAN) {
-    Debug::error(std::string("Value '") + key + "' is not a boolean");
+    Debug::error(std::string("Value '") + get_value_key(handle) + "' is not a boolean");
     return false;
   }
   return value.int_data != 0;
@@ -592,11 +1178,26 @@ bool Savegame::get_boolean(const std::string& key) const {
  */
 void Savegame::set_boolean(const std::string& key, bool value) {
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+  set_boolean(get_value_handle(key), value);
+}
 
-  saved_values[key].type = SavedValue::VALUE_BOOLEAN;
-  saved_values[key].int_data = value;
+/**
+ * \brief Sets a boolean value saved.
+ * \param handle Handle of the value to set.
+ * \param value The boolean value to associate with this key.
+ */
+void Savegame::set_boolean(SavegameValueHandle handle, bool value) {
+
+  SavedValue& saved_value = get_value(handle);
+  const std::string& key = get_value_key(handle);
+  if (saved_value.type != SavedValue::VALUE_BOOLEAN ||
+      (saved_value.int_data != 0) != value) {
+    notify_value_changed(key);
+  }
+  saved_value.type = SavedValue::VALUE_BOOLEAN;
+  saved_value.int_data = value;
+  saved_value.string_data.clear();
+  dirty_keys.insert(key);
 }
 
 /**
@@ -606,7 +1207,17 @@ void Savegame::set_boolean(const std::string& key, bool value) {
  */
 bool Savegame::is_set(const std::string& key) const {
 
-  return saved_values.find(key) != saved_values.end();
+  return find_value(key) != nullptr;
+}
+
+/**
+ * \brief Returns whether a value is defined in the savegame.
+ * \param handle Handle of the value to check.
+ * \return \c true if such a value is defined.
+ */
+bool Savegame::is_set(SavegameValueHandle handle) const {
+
+  return get_value(handle).type != SavedValue::VALUE_UNSET;
 }
 
 /**
@@ -615,10 +1226,55 @@ bool Savegame::is_set(const std::string& key) const {
  */
 void Savegame::unset(const std::string& key) {
 
-  Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
-      std::string("Savegame variable '") + key + "' is not a valid key");
+  unset(get_value_handle(key));
+}
+
+/**
+ * \brief Unsets a value saved.
+ *
+ * The handle remains valid.
+ *
+ * \param handle Handle of the value to unset.
+ */
+void Savegame::unset(SavegameValueHandle handle) {
+
+  SavedValue& saved_value = get_value(handle);
+  const std::string& key = get_value_key(handle);
+  if (saved_value.type != SavedValue::VALUE_UNSET) {
+    notify_value_changed(key);
+  }
+  saved_value.type = SavedValue::VALUE_UNSET;
+  saved_value.string_data.clear();
+  dirty_keys.insert(key);
+}
+
+/**
+ * \brief Records that a value has just changed.
+ *
+ * Changes are only recorded while a game is running: they are delivered
+ * to game:on_value_changed() once per cycle.
+ *
+ * \param key Name of the value changed.
+ */
+void Savegame::notify_value_changed(const std::string& key) {
+
+  if (game != nullptr) {
+    changed_keys.insert(key);
+  }
+}
+
+/**
+ * \brief Returns the keys whose value changed since the previous call.
+ *
+ * Each key is returned once even if its value changed several times.
+ *
+ * \param keys Set that receives the changed keys. Its previous content
+ * is lost.
+ */
+void Savegame::take_changed_keys(std::set<std::string>& keys) {
 
-  saved_values.erase(key);
+  keys.clear();
+  keys.swap(changed_keys);
 }
 
 /**
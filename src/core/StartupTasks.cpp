@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/StartupTasks.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the duration between two dates in milliseconds.
+ */
+template<typename TimePoint>
+double get_milliseconds(const TimePoint& start, const TimePoint& end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}
+
+/**
+ * \brief Creates an empty task graph.
+ * \param num_threads Maximum number of worker threads,
+ * or 0 to run all tasks on the main thread in the order they are added.
+ */
+StartupTasks::StartupTasks(int num_threads):
+  num_threads(std::max(0, num_threads)),
+  num_workers_started(0),
+  tasks(),
+  start_time(),
+  end_time(),
+  mutex(),
+  tasks_changed(),
+  num_tasks_done(0),
+  error() {
+
+}
+
+/**
+ * \brief Returns the number of worker threads to use by default.
+ * \return One less than the number of cores, at least 1.
+ */
+int StartupTasks::get_default_num_threads() {
+
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, num_cores - 1);
+}
+
+/**
+ * \brief Adds a task.
+ * \param name Name of the task, unique in this graph.
+ * \param affinity Threads allowed to run the task.
+ * \param dependencies Names of tasks already added that must be finished
+ * before this one starts.
+ * \param function What the task does.
+ */
+void StartupTasks::add(
+    const std::string& name,
+    Affinity affinity,
+    const std::vector<std::string>& dependencies,
+    const Function& function
+) {
+  Task task;
+  task.name = name;
+  task.affinity = affinity;
+  for (const std::string& dependency : dependencies) {
+    const auto& it = std::find_if(tasks.begin(), tasks.end(), [&](const Task& other) {
+      return other.name == dependency;
+    });
+    Debug::check_assertion(it != tasks.end(),
+        "No such startup task: '" + dependency + "'");
+    task.dependencies.push_back(static_cast<size_t>(it - tasks.begin()));
+  }
+  task.function = function;
+  task.started = false;
+  task.done = false;
+  task.thread = 0;
+  tasks.push_back(std::move(task));
+}
+
+/**
+ * \brief Runs all tasks and returns when they are finished.
+ *
+ * Rethrows the first exception thrown by a task.
+ */
+void StartupTasks::run() {
+
+  start_time = Clock::now();
+  num_tasks_done = 0;
+  error = nullptr;
+
+  const int num_worker_tasks = static_cast<int>(std::count_if(tasks.begin(), tasks.end(),
+      [](const Task& task) { return task.affinity == Affinity::ANY_THREAD; }
+  ));
+  num_workers_started = std::min(num_threads, num_worker_tasks);
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i <= num_workers_started; ++i) {
+    workers.emplace_back([this, i]() { run_worker(i); });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (error == nullptr && num_tasks_done < tasks.size()) {
+      const int index = find_ready_task(true);
+      if (index == -1) {
+        tasks_changed.wait(lock);
+        continue;
+      }
+      run_task(static_cast<size_t>(index), 0, lock);
+    }
+  }
+  tasks_changed.notify_all();
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  end_time = Clock::now();
+
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * \brief Returns a task that can start now.
+ *
+ * The main thread prefers tasks that only it can run, and takes other
+ * tasks only when there is no worker thread or no main thread task left.
+ *
+ * \param main_thread \c true to look for a task for the main thread.
+ * \return Index of the task, or -1 if no task can start.
+ */
+int StartupTasks::find_ready_task(bool main_thread) const {
+
+  bool main_thread_tasks_left = false;
+  int ready_task = -1;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    const Task& task = tasks[i];
+    if (task.started) {
+      continue;
+    }
+    if (task.affinity == Affinity::MAIN_THREAD) {
+      main_thread_tasks_left = true;
+    }
+
+    const bool ready = std::all_of(task.dependencies.begin(), task.dependencies.end(),
+        [this](size_t dependency) { return tasks[dependency].done; }
+    );
+    if (!ready) {
+      continue;
+    }
+
+    if (main_thread && num_workers_started == 0) {
+      // Without workers, tasks run in the order they were added.
+      return static_cast<int>(i);
+    }
+
+    if (task.affinity == Affinity::MAIN_THREAD) {
+      if (main_thread) {
+        return static_cast<int>(i);
+      }
+    }
+    else if (ready_task == -1) {
+      ready_task = static_cast<int>(i);
+    }
+  }
+
+  if (main_thread && main_thread_tasks_left) {
+    // Stay available for the next main thread task.
+    return -1;
+  }
+  return ready_task;
+}
+
+/**
+ * \brief Runs a task.
+ * \param index Index of the task.
+ * \param thread The thread running it: 0 for the main thread.
+ * \param lock Lock on the mutex, released while the task runs.
+ */
+void StartupTasks::run_task(size_t index, int thread, std::unique_lock<std::mutex>& lock) {
+
+  Task& task = tasks[index];
+  task.started = true;
+  task.thread = thread;
+  task.start_time = Clock::now();
+  lock.unlock();
+
+  std::exception_ptr task_error;
+  try {
+    task.function();
+  }
+  catch (...) {
+    task_error = std::current_exception();
+  }
+
+  lock.lock();
+  task.end_time = Clock::now();
+  task.done = true;
+  ++num_tasks_done;
+  if (task_error != nullptr && error == nullptr) {
+    error = task_error;
+  }
+  tasks_changed.notify_all();
+}
+
+/**
+ * \brief Runs tasks on a worker thread until all of them are finished.
+ * \param thread Number of this worker thread, starting at 1.
+ */
+void StartupTasks::run_worker(int thread) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (error == nullptr && num_tasks_done < tasks.size()) {
+    const int index = find_ready_task(false);
+    if (index == -1) {
+      tasks_changed.wait(lock);
+      continue;
+    }
+    run_task(static_cast<size_t>(index), thread, lock);
+  }
+}
+
+/**
+ * \brief Returns the duration of each task of the last run().
+ * \return Lines of text with the thread, start date and duration of
+ * each task in milliseconds, and a summary line.
+ */
+std::vector<std::string> StartupTasks::get_report() const {
+
+  std::vector<std::string> lines;
+  size_t name_width = 0;
+  double total_work = 0.0;
+  for (const Task& task : tasks) {
+    name_width = std::max(name_width, task.name.size());
+  }
+
+  for (const Task& task : tasks) {
+    if (!task.done) {
+      continue;
+    }
+    const double duration = get_milliseconds(task.start_time, task.end_time);
+    total_work += duration;
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1)
+        << "  " << std::left << std::setw(static_cast<int>(name_width)) << task.name << std::right
+        << "  " << (task.thread == 0 ? "main    " : "worker " + std::to_string(task.thread))
+        << "  start " << std::setw(7) << get_milliseconds(start_time, task.start_time) << " ms"
+        << "  duration " << std::setw(7) << duration << " ms";
+    lines.push_back(oss.str());
+  }
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1)
+      << "Startup: " << get_milliseconds(start_time, end_time) << " ms"
+      << " (" << total_work << " ms of work, "
+      << num_workers_started << " worker threads)";
+  lines.insert(lines.begin(), oss.str());
+  return lines;
+}
+
+}
+
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Symbol.h"
+#include <mutex>
+#include <unordered_set>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief The interned strings.
+ *
+ * Elements of an unordered set keep their address when the set grows,
+ * so symbols can point to them.
+ */
+struct SymbolTable {
+  std::unordered_set<std::string> strings;
+  std::mutex mutex;             /**< Symbols may be created by loading threads. */
+};
+
+/**
+ * \brief Returns the table of interned strings.
+ * \return The table.
+ */
+SymbolTable& get_table() {
+  static SymbolTable table;
+  return table;
+}
+
+}
+
+/**
+ * \brief Creates the symbol of the empty string.
+ */
+Symbol::Symbol():
+  name(get_empty_string()) {
+
+}
+
+/**
+ * \brief Creates the symbol of a string, interning the string if needed.
+ * \param name The string.
+ */
+Symbol::Symbol(const std::string& name):
+  name(intern(name)) {
+
+}
+
+/**
+ * \brief Creates a symbol from an interned string.
+ * \param name The unique copy of the string.
+ */
+Symbol::Symbol(const std::string* name):
+  name(name) {
+
+}
+
+/**
+ * \brief Returns the symbol of a string without interning it.
+ * \param name The string.
+ * \return The symbol of this string if it is interned,
+ * the symbol of the empty string otherwise.
+ */
+Symbol Symbol::find(const std::string& name) {
+
+  const std::string* interned = nullptr;
+  {
+    SymbolTable& table = get_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    const auto& it = table.strings.find(name);
+    if (it != table.strings.end()) {
+      interned = &*it;
+    }
+  }
+
+  if (interned == nullptr) {
+    return Symbol();
+  }
+  return Symbol(interned);
+}
+
+/**
+ * \brief Returns the unique copy of a string, creating it if needed.
+ * \param name The string.
+ * \return The interned string.
+ */
+const std::string* Symbol::intern(const std::string& name) {
+
+  SymbolTable& table = get_table();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  return &*table.strings.insert(name).first;
+}
+
+/**
+ * \brief Returns the unique copy of the empty string.
+ * \return The interned empty string.
+ */
+const std::string* Symbol::get_empty_string() {
+
+  static const std::string* empty_string = intern(std::string());
+  return empty_string;
+}
+
+}
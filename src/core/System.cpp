@@ -15,14 +15,21 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/core/Arguments.h"
+#include "solarus/core/AsyncFileWriter.h"
 #include "solarus/core/FontResource.h"
 #include "solarus/core/InputEvent.h"
+#include "solarus/core/JobSystem.h"
+#include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Random.h"
+#include "solarus/core/StartupTasks.h"
 #include "solarus/core/System.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/Video.h"
+#include "solarus/lua/LuaWorkers.h"
+#include <algorithm>
 #if _POSIX_C_SOURCE >= 200112L
 #  include <stdlib.h>
 #  include <string.h>
@@ -36,6 +43,7 @@ namespace Solarus {
 
 uint32_t System::initial_time = 0;
 uint32_t System::ticks = 0;
+float System::interpolation_factor = 1.0f;
 
 /**
  * \brief Initializes the basic low-level system.
@@ -47,6 +55,61 @@ uint32_t System::ticks = 0;
  */
 void System::initialize(const Arguments& args) {
 
+  StartupTasks tasks(0);
+  initialize(args, tasks);
+  tasks.run();
+}
+
+/**
+ * \brief Adds the initialization of the basic low-level system to a
+ * startup task graph.
+ *
+ * The audio device is opened while the main thread creates the window.
+ *
+ * \param args Command-line arguments. They must exist until the tasks are run.
+ * \param tasks The startup task graph.
+ */
+void System::initialize(const Arguments& args, StartupTasks& tasks) {
+
+  using Affinity = StartupTasks::Affinity;
+
+  Logger::initialize(args);
+  JobSystem::initialize(args);
+
+  tasks.add("sdl", Affinity::MAIN_THREAD, {}, [&args]() {
+    initialize_sdl(args);
+  });
+
+  // audio
+  tasks.add("audio", Affinity::ANY_THREAD, { "sdl" }, [&args]() {
+    Sound::initialize(args);
+  });
+
+  // input
+  tasks.add("input", Affinity::MAIN_THREAD, { "sdl" }, [&args]() {
+    InputEvent::initialize(args);
+  });
+
+  // random number generator, files written in background
+  tasks.add("random", Affinity::MAIN_THREAD, {}, []() {
+    Random::initialize();
+    AsyncFileWriter::initialize();
+  });
+
+  // video
+  tasks.add("video", Affinity::MAIN_THREAD, { "sdl" }, [&args]() {
+    Video::initialize(args);
+    FontResource::initialize();
+    Sprite::initialize();
+  });
+}
+
+/**
+ * \brief Initializes SDL.
+ * \param args Command-line arguments.
+ */
+void System::initialize_sdl(const Arguments& args) {
+
 #if _POSIX_C_SOURCE >= 200112L
   // Back up state of environment variables about to be modified.
   char* sdl_video_x11_wmclass = getenv("SDL_VIDEO_X11_WMCLASS");
@@ -65,6 +128,10 @@ void System::initialize(const Arguments& args) {
 #endif
 
   // initialize SDL
+  if (args.has_argument("-headless")) {
+    // No display is needed.
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+  }
   SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK);
   initial_time = get_real_time();
   ticks = 0;
@@ -87,20 +154,6 @@ void System::initialize(const Arguments& args) {
     unsetenv("SDL_VIDEO_X11_WMCLASS");
   }
 #endif
-
-  // audio
-  Sound::initialize(args);
-
-  // input
-  InputEvent::initialize(args);
-
-  // random number generator
-  Random::initialize();
-
-  // video
-  Video::initialize(args);
-  FontResource::initialize();
-  Sprite::initialize();
 }
 
 /**
@@ -110,14 +163,18 @@ void System::initialize(const Arguments& args) {
  */
 void System::quit() {
 
+  LuaWorkers::quit();
+  AsyncFileWriter::quit();
   Random::quit();
   InputEvent::quit();
   Sound::quit();
   Sprite::quit();
   FontResource::quit();
   Video::quit();
+  JobSystem::quit();
 
   SDL_Quit();
+  Logger::quit();
 }
 
 /**
@@ -160,6 +217,32 @@ uint32_t System::now() {
   return ticks;
 }
 
+/**
+ * \brief Returns where the frame being drawn is between the previous update
+ * and the last one.
+ *
+ * Drawing at the real time rather than at the simulated time shows moving
+ * objects between their previous and current positions.
+ *
+ * \return 0 to draw the state before the last update, 1 to draw the state
+ * after it.
+ */
+float System::get_interpolation_factor() {
+  return interpolation_factor;
+}
+
+/**
+ * \brief Sets where the frame being drawn is between the previous update
+ * and the last one.
+ *
+ * This is called by the main loop before and after drawing.
+ *
+ * \param interpolation_factor A value between 0 and 1.
+ */
+void System::set_interpolation_factor(float interpolation_factor) {
+  System::interpolation_factor = std::max(0.0f, std::min(interpolation_factor, 1.0f));
+}
+
 /**
  * \brief Returns the number of real milliseconds elapsed since the
  * initialization of the Solarus library.
@@ -183,5 +266,39 @@ void System::sleep(uint32_t duration) {
   SDL_Delay(duration);
 }
 
+/**
+ * \brief Returns the real time in microseconds with a high-resolution timer.
+ *
+ * The origin is arbitrary: only use differences between two dates.
+ *
+ * \return The current real time in microseconds.
+ */
+uint64_t System::get_real_time_us() {
+
+  static const uint64_t frequency = SDL_GetPerformanceFrequency();
+  const uint64_t counter = SDL_GetPerformanceCounter();
+  return (counter / frequency) * 1000000 + (counter % frequency) * 1000000 / frequency;
+}
+
+/**
+ * \brief Makes the program sleep until a precise date.
+ *
+ * Sleeps with the OS scheduler while the date is more than two
+ * milliseconds away, and then busy-waits for the rest,
+ * trading some CPU time for precision.
+ *
+ * \param date Date to wait for, as returned by get_real_time_us().
+ */
+void System::sleep_until_us(uint64_t date) {
+
+  uint64_t now = get_real_time_us();
+  if (now + 2000 < date) {
+    SDL_Delay(static_cast<uint32_t>((date - now - 1000) / 1000));
+  }
+  while (get_real_time_us() < date) {
+    // Busy wait.
+  }
+}
+
 }
 
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Map.h"
+#include "solarus/entities/AnimatedRegions.h"
+#include "solarus/entities/Camera.h"
+#include "solarus/entities/Tile.h"
+#include "solarus/entities/TilePattern.h"
+#include "solarus/entities/Tileset.h"
+#include "solarus/graphics/Renderer.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+
+namespace Solarus {
+
+/**
+ * \brief Constructor.
+ * \param map The map.
+ */
+AnimatedRegions::AnimatedRegions(Map& map):
+  map(map) {
+
+}
+
+/**
+ * \brief Adds a tile to draw at each frame.
+ *
+ * build() must be called again after tiles are added.
+ *
+ * \param tile The tile to add, on top of the previous ones.
+ */
+void AnimatedRegions::add_tile(const TilePtr& tile) {
+
+  tiles.push_back(tile);
+}
+
+/**
+ * \brief Uploads the tiles to tile meshes when possible.
+ *
+ * Tiles that cannot be part of a mesh, for example because their pattern
+ * does not support it or because a mesh has no free slot left, are drawn
+ * one by one.
+ */
+void AnimatedRegions::build() {
+
+  meshes.clear();
+  runs.clear();
+
+  std::vector<std::vector<TileMesh::Quad>> quads;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+
+    Size size;
+    const size_t num_tiles = find_repeated_rectangle(i, size);
+    if (num_tiles > 1 && add_to_mesh(i, num_tiles, size, quads)) {
+      i += num_tiles - 1;
+      continue;
+    }
+
+    if (add_to_mesh(i, 1, tiles[i]->get_size(), quads)) {
+      continue;
+    }
+
+    if (!runs.empty() && runs.back().mesh_index == -1) {
+      ++runs.back().num_tiles;
+    }
+    else {
+      runs.push_back(Run{ -1, i, 1 });
+    }
+  }
+
+  Renderer& renderer = Video::get_renderer();
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    meshes[i].mesh = renderer.create_tile_mesh(meshes[i].image, quads[i]);
+  }
+}
+
+/**
+ * \brief Finds consecutive tiles that repeat the same scrolling pattern
+ * over a rectangle.
+ *
+ * Rectangles of tiles are created row by row, so their tiles are
+ * consecutive. Such a rectangle can be drawn as one quad whose image wraps
+ * rather than one quad per tile.
+ *
+ * \param[in] first_tile Index of the top-left tile in tiles.
+ * \param[out] size Size of the rectangle found.
+ * \return Number of tiles of the rectangle, or 0 if the tile
+ * does not have a scrolling pattern.
+ */
+size_t AnimatedRegions::find_repeated_rectangle(size_t first_tile, Size& size) const {
+
+  const Tile& first = *tiles[first_tile];
+  if (!first.has_tile_pattern()) {
+    return 0;
+  }
+
+  const TilePattern& pattern = first.get_tile_pattern();
+  TileMesh::Quad quad;
+  Point frame_offset;
+  if (!pattern.get_mesh_quad(quad) ||
+      (!quad.parallax && !quad.self_scrolling) ||
+      pattern.get_frame_offset(frame_offset) ||
+      first.get_size() != quad.region.get_size()) {
+    return 0;
+  }
+
+  // Whether a tile continues the rectangle at the given column and row.
+  const Point& origin = first.get_top_left_xy();
+  const Size& pattern_size = first.get_size();
+  const auto continues = [&](size_t index, int column, int row) {
+    if (index >= tiles.size()) {
+      return false;
+    }
+    const Tile& tile = *tiles[index];
+    return tile.has_tile_pattern() &&
+        &tile.get_tile_pattern() == &pattern &&
+        tile.get_size() == pattern_size &&
+        tile.get_top_left_xy() == origin + Point(column * pattern_size.width, row * pattern_size.height);
+  };
+
+  int num_columns = 1;
+  while (continues(first_tile + num_columns, num_columns, 0)) {
+    ++num_columns;
+  }
+  int num_rows = 1;
+  bool complete_row = true;
+  while (complete_row) {
+    for (int column = 0; column < num_columns && complete_row; ++column) {
+      complete_row = continues(first_tile + num_rows * num_columns + column, column, num_rows);
+    }
+    if (complete_row) {
+      ++num_rows;
+    }
+  }
+
+  size = Size(num_columns * pattern_size.width, num_rows * pattern_size.height);
+  return num_columns * num_rows;
+}
+
+/**
+ * \brief Adds tiles to the mesh of their image as one quad.
+ * \param first_tile Index of the first tile to add in tiles.
+ * \param num_tiles Number of tiles covered by the quad: 1 for a single tile,
+ * more for a rectangle found by find_repeated_rectangle().
+ * \param size Size of the quad.
+ * \param quads Tiles of each mesh, to upload when all tiles are added.
+ * \return \c false if the tiles have to be drawn another way.
+ */
+bool AnimatedRegions::add_to_mesh(
+    size_t first_tile,
+    size_t num_tiles,
+    const Size& size,
+    std::vector<std::vector<TileMesh::Quad>>& quads) {
+
+  Tile& tile = *tiles[first_tile];
+  if (!tile.has_tile_pattern()) {
+    return false;
+  }
+
+  const TilePattern& pattern = tile.get_tile_pattern();
+  TileMesh::Quad quad;
+  if (!pattern.get_mesh_quad(quad) ||
+      quad.region.get_width() > TileMesh::max_tile_size ||
+      quad.region.get_height() > TileMesh::max_tile_size) {
+    return false;
+  }
+  quad.position = tile.get_top_left_xy();
+  quad.size = size;
+  quad.slot = 0;
+  const bool repeated = num_tiles > 1;
+
+  const SurfacePtr& image = tile.get_tileset().get_tiles_image();
+  int mesh_index = -1;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    if (meshes[i].image == image && quads[i].size() < TileMesh::max_quads) {
+      mesh_index = i;
+    }
+  }
+  if (mesh_index == -1) {
+    mesh_index = meshes.size();
+    meshes.emplace_back();
+    meshes.back().image = image;
+    quads.emplace_back();
+  }
+  Mesh& mesh = meshes[mesh_index];
+  if (repeated && mesh.num_repeats >= TileMesh::max_repeats) {
+    return false;
+  }
+
+  Point offset;
+  if (pattern.get_frame_offset(offset)) {
+    // Patterns whose image changes get a slot.
+    std::vector<const TilePattern*>& patterns = mesh.animated_patterns;
+    size_t slot = 0;
+    while (slot < patterns.size() && patterns[slot] != &pattern) {
+      ++slot;
+    }
+    if (slot == patterns.size()) {
+      if (patterns.size() + 1 >= static_cast<size_t>(TileMesh::max_slots)) {
+        return false;
+      }
+      patterns.push_back(&pattern);
+    }
+    quad.slot = slot + 1;
+  }
+
+  if (!runs.empty() &&
+      runs.back().mesh_index == mesh_index &&
+      runs.back().first_tile + runs.back().num_tiles == quads[mesh_index].size()) {
+    ++runs.back().num_tiles;
+  }
+  else {
+    runs.push_back(Run{ mesh_index, quads[mesh_index].size(), 1 });
+  }
+  quads[mesh_index].push_back(quad);
+  mesh.quad_tiles.emplace_back();
+  for (size_t i = first_tile; i < first_tile + num_tiles; ++i) {
+    mesh.quad_tiles.back().push_back(tiles[i].get());
+  }
+  if (repeated) {
+    ++mesh.num_repeats;
+  }
+  return true;
+}
+
+/**
+ * \brief Notifies this object that the tileset of the map has changed.
+ *
+ * The patterns of tiles may have changed so the meshes are built again.
+ */
+void AnimatedRegions::notify_tileset_changed() {
+
+  for (const TilePtr& tile : tiles) {
+    tile->notify_tileset_changed();
+  }
+  build();
+}
+
+/**
+ * \brief Draws all tiles on the map.
+ */
+void AnimatedRegions::draw_on_map() {
+
+  const CameraPtr& camera = map.get_camera();
+  if (camera == nullptr) {
+    return;
+  }
+
+  for (Mesh& mesh : meshes) {
+    if (mesh.mesh == nullptr) {
+      continue;
+    }
+    for (size_t i = 0; i < mesh.animated_patterns.size(); ++i) {
+      Point offset;
+      mesh.animated_patterns[i]->get_frame_offset(offset);
+      mesh.mesh->set_slot_offset(i + 1, offset);
+    }
+  }
+
+  Surface& dst_surface = *camera->get_surface();
+  const Point& viewport = camera->get_top_left_xy();
+  for (const Run& run : runs) {
+    if (run.mesh_index != -1 && meshes[run.mesh_index].mesh != nullptr) {
+      // The renderer clips tiles outside the camera.
+      meshes[run.mesh_index].mesh->draw(dst_surface, viewport, run.first_tile, run.num_tiles);
+    }
+    else {
+      draw_tiles(run);
+    }
+  }
+}
+
+/**
+ * \brief Draws the tiles of a run one by one.
+ * \param run The tiles to draw.
+ */
+void AnimatedRegions::draw_tiles(const Run& run) {
+
+  Camera& camera = *map.get_camera();
+  const auto draw_tile = [&camera](Tile& tile) {
+    if (tile.overlaps(camera) || !tile.is_drawn_at_its_position()) {
+      tile.draw(camera);
+    }
+  };
+
+  for (size_t i = run.first_tile; i < run.first_tile + run.num_tiles; ++i) {
+    if (run.mesh_index == -1) {
+      draw_tile(*tiles[i]);
+      continue;
+    }
+    for (Tile* tile : meshes[run.mesh_index].quad_tiles[i]) {
+      draw_tile(*tile);
+    }
+  }
+}
+
+}
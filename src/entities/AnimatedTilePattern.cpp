@@ -19,6 +19,7 @@
 #include "solarus/entities/AnimatedTilePattern.h"
 #include "solarus/entities/ParallaxScrollingTilePattern.h"
 #include "solarus/entities/Tileset.h"
+#include "solarus/graphics/FrameDamage.h"
 #include "solarus/graphics/Surface.h"
 
 namespace Solarus {
@@ -43,26 +44,33 @@ AnimatedTilePattern::AnimatedTilePattern(
   frame_delay(frame_delay),
   mirror_loop(mirror_loop),
   parallax(parallax),
-  frame_index(0),
-  next_frame_date(System::now() + frame_delay) {
+  frame_index(0) {
 
   Debug::check_assertion(!this->frames.empty(), "Missing frames for animated pattern");
+  update();
 }
 
 /**
  * \copydoc TilePattern::update
+ *
+ * The current frame only depends on the global clock, so tilesets that
+ * are not updated for a while show the right frame as soon as they are
+ * updated again.
  */
 void AnimatedTilePattern::update() {
 
-  uint32_t now = System::now();
-  while (now >= next_frame_date) {
-    if (!mirror_loop) {
-      frame_index = (frame_index + 1) % frames.size();
-    }
-    else {
-      frame_index = (frame_index + 1) % (2 * frames.size() - 2);
-    }
-    next_frame_date += frame_delay;
+  if (frame_delay == 0) {
+    return;
+  }
+
+  int num_steps = frames.size();
+  if (mirror_loop && num_steps > 1) {
+    num_steps = 2 * num_steps - 2;
+  }
+  const int new_frame_index = (System::now() / frame_delay) % num_steps;
+  if (new_frame_index != frame_index) {
+    frame_index = new_frame_index;
+    FrameDamage::notify();
   }
 }
 
@@ -76,14 +84,7 @@ void AnimatedTilePattern::draw(
     const Point& viewport
 ) const {
   const SurfacePtr& tileset_image = tileset.get_tiles_image();
-
-  int final_frame_index = frame_index;
-  int num_frames = frames.size();
-  if (mirror_loop && frame_index >= num_frames) {
-    final_frame_index = (2 * frames.size() - 2) - frame_index;
-  }
-  Debug::check_assertion(final_frame_index >= 0 && final_frame_index < num_frames, "Wrong frame index");
-  const Rectangle& src = frames[final_frame_index];
+  const Rectangle& src = get_current_frame();
   Point dst = dst_position;
 
   if (parallax) {
@@ -110,5 +111,38 @@ bool AnimatedTilePattern::is_drawn_at_its_position() const {
   return !parallax;
 }
 
+/**
+ * \copydoc TilePattern::get_mesh_quad
+ */
+bool AnimatedTilePattern::get_mesh_quad(TileMesh::Quad& quad) const {
+  quad.region = frames[0];
+  quad.parallax = parallax;
+  quad.self_scrolling = false;
+  return true;
+}
+
+/**
+ * \copydoc TilePattern::get_frame_offset
+ */
+bool AnimatedTilePattern::get_frame_offset(Point& offset) const {
+  offset = get_current_frame().get_xy() - frames[0].get_xy();
+  return true;
+}
+
+/**
+ * \brief Returns the rectangle of the frame currently displayed.
+ * \return The current frame in the tileset image.
+ */
+const Rectangle& AnimatedTilePattern::get_current_frame() const {
+
+  int final_frame_index = frame_index;
+  int num_frames = frames.size();
+  if (mirror_loop && frame_index >= num_frames) {
+    final_frame_index = (2 * frames.size() - 2) - frame_index;
+  }
+  Debug::check_assertion(final_frame_index >= 0 && final_frame_index < num_frames, "Wrong frame index");
+  return frames[final_frame_index];
+}
+
 }
 
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/System.h"
@@ -259,7 +260,7 @@ void Bomb::update() {
  */
 void Bomb::explode() {
 
-  get_entities().add_entity(std::make_shared<Explosion>(
+  get_entities().add_entity(make_pooled<Explosion>(
       "", get_layer(), get_center_point(), true
   ));
   Sound::play("explosion");
@@ -440,99 +440,7 @@ Rectangle Camera::apply_map_bounds(const Rectangle& area) const {
  */
 Rectangle Camera::apply_separators(const Rectangle& area) const {
 
-  int x = area.get_x();  // Top-left corner.
-  int y = area.get_y();
-  const int width = area.get_width();
-  const int height = area.get_height();
-
-  // TODO simplify: treat horizontal separators first and then all vertical ones.
-  int adjusted_x = x;  // Updated coordinates after applying separators.
-  int adjusted_y = y;
-  std::vector<std::shared_ptr<const Separator>> applied_separators;
-  const std::set<std::shared_ptr<const Separator>>& separators =
-      get_entities().get_entities_by_type<Separator>();
-  for (const std::shared_ptr<const Separator>& separator: separators) {
-
-    if (separator->is_vertical()) {
-      // Vertical separator.
-      int separation_x = separator->get_x() + 8;
-
-      if (x < separation_x && separation_x < x + width
-          && separator->get_y() < y + height
-          && y < separator->get_y() + separator->get_height()) {
-        int left = separation_x - x;
-        int right = x + width - separation_x;
-        if (left > right) {
-          adjusted_x = separation_x - width;
-        }
-        else {
-          adjusted_x = separation_x;
-        }
-        applied_separators.push_back(separator);
-      }
-    }
-    else {
-      Debug::check_assertion(separator->is_horizontal(), "Invalid separator shape");
-
-      // Horizontal separator.
-      int separation_y = separator->get_y() + 8;
-      if (y < separation_y && separation_y < y + height
-          && separator->get_x() < x + width
-          && x < separator->get_x() + separator->get_width()) {
-        int top = separation_y - y;
-        int bottom = y + height - separation_y;
-        if (top > bottom) {
-          adjusted_y = separation_y - height;
-        }
-        else {
-          adjusted_y = separation_y;
-        }
-        applied_separators.push_back(separator);
-      }
-    }
-  }  // End for each separator.
-
-  bool must_adjust_x = true;
-  bool must_adjust_y = true;
-  if (adjusted_x != x && adjusted_y != y) {
-    // Both directions were modified. Maybe it is a T configuration where
-    // a separator deactivates another one.
-
-    must_adjust_x = false;
-    must_adjust_y = false;
-    for (const std::shared_ptr<const Separator>& separator: applied_separators) {
-
-      if (separator->is_vertical()) {
-        // Vertical separator.
-        int separation_x = separator->get_x() + 8;
-
-        if (x < separation_x && separation_x < x + width
-            && separator->get_y() < adjusted_y + height
-            && adjusted_y < separator->get_y() + separator->get_height()) {
-          must_adjust_x = true;
-        }
-      }
-      else {
-        // Horizontal separator.
-        int separation_y = separator->get_y() + 8;
-
-        if (y < separation_y && separation_y < y + height
-            && separator->get_x() < adjusted_x + width
-            && adjusted_x < separator->get_x() + separator->get_width()) {
-          must_adjust_y = true;
-        }
-      }
-    }  // End for each separator applied.
-  }  // End if both directions.
-
-  if (must_adjust_x) {
-    x = adjusted_x;
-  }
-  if (must_adjust_y) {
-    y = adjusted_y;
-  }
-
-  return Rectangle(x, y, width, height);
+  return get_entities().get_separator_regions().apply_separators(area);
 }
 
 /**
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Map.h"
@@ -299,7 +300,7 @@ void CarriedObject::break_item() {
     }
   }
   else {
-    get_entities().add_entity(std::make_shared<Explosion>(
+    get_entities().add_entity(make_pooled<Explosion>(
         "", get_layer(), get_xy(), true
     ));
     Sound::play("explosion");
@@ -151,7 +151,8 @@ void Crystal::activate(Entity& entity_activating) {
  */
 void Crystal::twinkle() {
 
-  const Point star_xy = { Random::get_number(3, 13), Random::get_number(3, 13) };
+  RandomStream& random_stream = Random::get_stream(Random::Subsystem::EFFECTS);
+  const Point star_xy = { random_stream.get_number(3, 13), random_stream.get_number(3, 13) };
   star_sprite->restart_animation();
   star_sprite->set_xy(star_xy - get_origin());
 }
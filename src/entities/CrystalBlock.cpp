@@ -190,6 +190,7 @@ void CrystalBlock::update() {
   if (orange_raised != this->orange_raised) {
 
     this->orange_raised = orange_raised;
+    get_entities().get_walkability_grid().notify_ground_modifier_changed(*this);
 
     if (sprite != nullptr) {
 
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/entities/CustomEntity.h"
+#include "solarus/core/Geometry.h"
 #include "solarus/entities/Block.h"
 #include "solarus/entities/Bomb.h"
 #include "solarus/entities/Chest.h"
@@ -38,6 +39,8 @@
 #include "solarus/graphics/Sprite.h"
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace Solarus {
 
@@ -659,6 +662,7 @@ bool CustomEntity::can_traverse_ground(Ground ground) const {
 void CustomEntity::set_can_traverse_ground(Ground ground, bool traversable) {
 
   can_traverse_grounds[ground] = traversable;
+  notify_ground_obstacles_changed();
 }
 
 /**
@@ -673,6 +677,7 @@ void CustomEntity::set_can_traverse_ground(Ground ground, bool traversable) {
 void CustomEntity::reset_can_traverse_ground(Ground ground) {
 
   can_traverse_grounds.erase(ground);
+  notify_ground_obstacles_changed();
 }
 
 /**
@@ -808,6 +813,29 @@ void CustomEntity::add_collision_test(
   check_collision_with_detectors();
 }
 
+/**
+ * \brief Registers a function to be called when a collision test computed
+ * without calling Lua detects a collision.
+ * \param collision_test Parameters of the collision test.
+ * \param callback_ref Lua ref to a function to call when this collision is
+ * detected.
+ */
+void CustomEntity::add_collision_test(
+    const NativeCollisionTest& collision_test,
+    const ScopedLuaRef& callback_ref
+) {
+  Debug::check_assertion(!callback_ref.is_empty(), "Missing collision callback");
+
+  add_collision_mode(COLLISION_CUSTOM);
+
+  collision_tests.emplace_back(
+      collision_test,
+      callback_ref
+  );
+
+  check_collision_with_detectors();
+}
+
 /**
  * \brief Unregisters all collision test functions.
  */
@@ -830,9 +858,12 @@ bool CustomEntity::test_collision_custom(Entity& entity) {
 
   bool collision = false;
 
-  const std::vector<CollisionInfo> collision_tests = this->collision_tests;
-  for (const CollisionInfo& info: collision_tests) {
+  // Lua collision tests may change the list: only the tests existing now
+  // are performed, and only Lua tests need a copy of their info.
+  const size_t num_tests = collision_tests.size();
+  for (size_t i = 0; i < num_tests && i < collision_tests.size(); ++i) {
 
+    const CollisionInfo& info = collision_tests[i];
     switch (info.get_built_in_test()) {
 
       case COLLISION_OVERLAPPING:
@@ -878,11 +909,20 @@ bool CustomEntity::test_collision_custom(Entity& entity) {
         break;
 
       case COLLISION_CUSTOM:
-        if (get_lua_context()->do_custom_entity_collision_test_function(
-              info.get_custom_test_ref(), *this, entity)
-        ) {
-          collision = true;
-          successful_collision_tests.push_back(info);
+        if (info.get_custom_test_ref().is_empty()) {
+          if (info.get_native_test().test(*this, entity)) {
+            collision = true;
+            successful_collision_tests.push_back(info);
+          }
+        }
+        else {
+          const CollisionInfo lua_info = info;
+          if (get_lua_context()->do_custom_entity_collision_test_function(
+                lua_info.get_custom_test_ref(), *this, entity)
+          ) {
+            collision = true;
+            successful_collision_tests.push_back(lua_info);
+          }
         }
         break;
 
@@ -1193,6 +1233,9 @@ void CustomEntity::update_ground_observer() {
   );
   if (ground_observer != this->ground_observer) {
     this->ground_observer = ground_observer;
+    if (is_on_map()) {
+      get_entities().get_ground_observers().notify_entity_changed(*this);
+    }
   }
 }
 
@@ -1269,12 +1312,77 @@ void CustomEntity::set_follow_streams(bool follow_streams) {
   this->follow_streams = follow_streams;
 }
 
+/**
+ * \brief Tests a collision without calling Lua.
+ * \param entity The custom entity doing the test.
+ * \param other The other entity.
+ * \return \c true if the other entity passes the filters and is in the shape.
+ */
+bool CustomEntity::NativeCollisionTest::test(
+    const CustomEntity& entity,
+    const Entity& other
+) const {
+
+  if (!layers.empty() &&
+      std::find(layers.begin(), layers.end(), other.get_layer()) == layers.end()) {
+    return false;
+  }
+
+  if (filter_type && other.get_type() != type) {
+    return false;
+  }
+
+  if (same_model &&
+      (other.get_type() != EntityType::CUSTOM ||
+       static_cast<const CustomEntity&>(other).get_model() != entity.get_model())) {
+    return false;
+  }
+
+  switch (shape) {
+
+    case CollisionShape::CIRCLE:
+    {
+      const int reach = radius + other_radius;
+      return Geometry::get_distance2(entity.get_center_point(), other.get_center_point()) <=
+          reach * reach;
+    }
+
+    case CollisionShape::DISTANCE:
+      return Geometry::get_distance2(entity.get_xy(), other.get_xy()) <= radius * radius;
+
+    case CollisionShape::CONE:
+    {
+      const Point& center = entity.get_center_point();
+      const Point& other_center = other.get_center_point();
+      if (Geometry::get_distance2(center, other_center) > radius * radius) {
+        return false;
+      }
+      if (center == other_center) {
+        return true;
+      }
+      const double direction = angle >= 0.0 ?
+          angle : entity.get_sprites_direction() * Geometry::PI_OVER_2;
+      double difference = std::fmod(
+          std::fabs(Geometry::get_angle(center, other_center) - direction),
+          Geometry::TWO_PI
+      );
+      if (difference > Geometry::PI) {
+        difference = Geometry::TWO_PI - difference;
+      }
+      return difference <= aperture / 2.0;
+    }
+  }
+
+  return false;
+}
+
 /**
  * \brief Empty constructor.
  */
 CustomEntity::CollisionInfo::CollisionInfo():
     built_in_test(COLLISION_NONE),
     custom_test_ref(),
+    native_test(),
     callback_ref() {
 
 }
@@ -1291,6 +1399,7 @@ CustomEntity::CollisionInfo::CollisionInfo(
 ):
     built_in_test(built_in_test),
     custom_test_ref(),
+    native_test(),
     callback_ref(callback_ref) {
 
   Debug::check_assertion(!callback_ref.is_empty(), "Missing callback ref");
@@ -1308,6 +1417,26 @@ CustomEntity::CollisionInfo::CollisionInfo(
 ):
     built_in_test(COLLISION_CUSTOM),
     custom_test_ref(custom_test_ref),
+    native_test(),
+    callback_ref(callback_ref) {
+
+  Debug::check_assertion(!callback_ref.is_empty(), "Missing callback ref");
+}
+
+/**
+ * \brief Creates a collision test info.
+ * \param native_test Parameters of a collision test computed without
+ * calling Lua.
+ * \param callback_ref Lua ref to a function to call when this collision is
+ * detected.
+ */
+CustomEntity::CollisionInfo::CollisionInfo(
+    const NativeCollisionTest& native_test,
+    const ScopedLuaRef& callback_ref
+):
+    built_in_test(COLLISION_CUSTOM),
+    custom_test_ref(),
+    native_test(native_test),
     callback_ref(callback_ref) {
 
   Debug::check_assertion(!callback_ref.is_empty(), "Missing callback ref");
@@ -1331,6 +1460,15 @@ const ScopedLuaRef& CustomEntity::CollisionInfo::get_custom_test_ref() const {
   return custom_test_ref;
 }
 
+/**
+ * \brief Returns the collision test computed without calling Lua.
+ * \return The parameters of the test. Only meaningful if there is no
+ * customized collision test function.
+ */
+const CustomEntity::NativeCollisionTest& CustomEntity::CollisionInfo::get_native_test() const {
+  return native_test;
+}
+
 /**
  * \brief Returns the function to call when the collision is detected.
  * \return A Lua ref to the callback.
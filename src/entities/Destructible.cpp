@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Equipment.h"
@@ -467,7 +468,7 @@ bool Destructible::is_waiting_for_regeneration() const {
  */
 void Destructible::explode() {
 
-  get_entities().add_entity(std::make_shared<Explosion>(
+  get_entities().add_entity(make_pooled<Explosion>(
       "", get_layer(), get_xy(), true
   ));
   Sound::play("explosion");
@@ -524,6 +525,7 @@ void Destructible::update() {
     }
     is_regenerating = true;
     regeneration_date = 0;
+    get_entities().get_walkability_grid().notify_ground_modifier_changed(*this);
     get_lua_context()->destructible_on_regenerating(*this);
   }
   else if (is_regenerating &&
@@ -74,6 +74,9 @@ Door::Door(Game& game,
     const std::string& savegame_variable):
   Entity(name, 0, layer, xy, Size(16, 16)),
   savegame_variable(savegame_variable),
+  savegame_value(savegame_variable.empty() ?
+      SavegameValueHandle() :
+      game.get_savegame().get_value_handle(savegame_variable)),
   opening_method(OpeningMethod::NONE),
   opening_condition(),
   opening_condition_consumed(false),
@@ -90,7 +93,7 @@ Door::Door(Game& game,
   set_direction(direction);
 
   if (is_saved()) {
-    set_open(game.get_savegame().get_boolean(savegame_variable));
+    set_open(game.get_savegame().get_boolean(savegame_value));
   }
   else {
     set_open(false);
@@ -187,7 +190,7 @@ void Door::set_open(bool door_open) {
     update_dynamic_tiles();
 
     if (is_saved()) {
-      get_savegame().set_boolean(savegame_variable, door_open);
+      get_savegame().set_boolean(savegame_value, door_open);
     }
 
     if (door_open) {
@@ -514,7 +517,7 @@ void Door::update() {
   if (is_closed()
       && get_opening_method() == OpeningMethod::BY_EXPLOSION
       && get_equipment().has_ability(Ability::DETECT_WEAK_WALLS)
-      && Geometry::get_distance(get_center_point(), get_hero().get_center_point()) < 40
+      && Geometry::get_distance2(get_center_point(), get_hero().get_center_point()) < 40 * 40
       && !is_suspended()
       && System::now() >= next_hint_sound_date) {
     Sound::play("cane");
@@ -530,7 +533,7 @@ void Door::update() {
   }
 
   if (is_saved() && !is_changing()) {
-    bool open_in_savegame = get_savegame().get_boolean(savegame_variable);
+    bool open_in_savegame = get_savegame().get_boolean(savegame_value);
     if (open_in_savegame && is_closed()) {
       set_opening();
     }
@@ -550,6 +553,13 @@ void Door::built_in_draw(Camera& camera) {
   }
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool Door::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 /**
  * \copydoc Entity::notify_action_command_pressed
  */
@@ -565,7 +575,7 @@ bool Door::notify_action_command_pressed() {
       Sound::play("door_open");
 
       if (is_saved()) {
-        get_savegame().set_boolean(savegame_variable, true);
+        get_savegame().set_boolean(savegame_value, true);
       }
 
       if (is_opening_condition_consumed()) {
@@ -663,7 +673,7 @@ void Door::open() {
   set_opening();
 
   if (is_saved()) {
-    get_savegame().set_boolean(savegame_variable, true);
+    get_savegame().set_boolean(savegame_value, true);
   }
 }
 
@@ -697,7 +707,7 @@ void Door::close() {
   set_closing();
 
   if (is_saved()) {
-    get_savegame().set_boolean(savegame_variable, false);
+    get_savegame().set_boolean(savegame_value, false);
   }
 }
 
@@ -142,6 +142,13 @@ void DynamicTile::built_in_draw(Camera& camera) {
   Entity::built_in_draw(camera);
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool DynamicTile::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 /**
  * \copydoc Entity::notify_tileset_changed
  */
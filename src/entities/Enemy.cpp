@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
@@ -326,6 +327,18 @@ bool Enemy::is_stream_obstacle(Stream& stream) {
   return false;
 }
 
+/**
+ * \brief Returns whether the grounds that are obstacles for this enemy
+ * can be cached.
+ *
+ * They depend on the ground under the enemy and on whether it is being hurt.
+ *
+ * \return \c false.
+ */
+bool Enemy::are_ground_obstacles_cacheable() const {
+  return false;
+}
+
 /**
  * \brief Returns whether a deep water tile is currently considered as an obstacle by this entity.
  * \return true if the deep water tiles are currently an obstacle for this entity
@@ -648,16 +661,31 @@ void Enemy::set_minimum_shield_needed(int minimum_shield_needed) {
  * a pixel-precise collision test
  * \return the corresponding reaction
  */
-EnemyReaction::Reaction Enemy::get_attack_consequence(
+const EnemyReaction::Reaction& Enemy::get_attack_consequence(
     EnemyAttack attack,
     const Sprite* this_sprite) const {
 
-  const auto& it = attack_reactions.find(attack);
-  if (it == attack_reactions.end()) {
-    // Attack consequence was not initialized. Return a default value.
-    return EnemyReaction::Reaction();
-  }
-  return it->second.get_reaction(this_sprite);
+  return get_attack_reaction(attack).get_reaction(this_sprite);
+}
+
+/**
+ * \brief Returns how the enemy reacts to an attack on each of its sprites.
+ * \param attack an attack
+ * \return the reactions to this attack
+ */
+const EnemyReaction& Enemy::get_attack_reaction(EnemyAttack attack) const {
+
+  return attack_reactions[static_cast<size_t>(attack)];
+}
+
+/**
+ * \brief Returns how the enemy reacts to an attack on each of its sprites.
+ * \param attack an attack
+ * \return the reactions to this attack
+ */
+EnemyReaction& Enemy::get_attack_reaction(EnemyAttack attack) {
+
+  return attack_reactions[static_cast<size_t>(attack)];
 }
 
 /**
@@ -676,7 +704,7 @@ void Enemy::set_attack_consequence(
     int life_lost,
     const ScopedLuaRef& callback) {
 
-  attack_reactions[attack].set_general_reaction(reaction, life_lost, callback);
+  get_attack_reaction(attack).set_general_reaction(reaction, life_lost, callback);
 }
 
 /**
@@ -693,7 +721,7 @@ void Enemy::set_attack_consequence_sprite(
     int life_lost,
     const ScopedLuaRef& callback) {
 
-  attack_reactions[attack].set_sprite_reaction(&sprite, reaction, life_lost, callback);
+  get_attack_reaction(attack).set_sprite_reaction(&sprite, reaction, life_lost, callback);
 }
 
 /**
@@ -723,9 +751,8 @@ void Enemy::set_no_attack_consequences_sprite(const Sprite& sprite) {
  */
 void Enemy::set_default_attack_consequences() {
 
-  for (const auto& kvp : attack_names) {
-    EnemyAttack attack = kvp.first;
-    attack_reactions[attack].set_default_reaction();
+  for (EnemyReaction& attack_reaction : attack_reactions) {
+    attack_reaction.set_default_reaction();
   }
   set_attack_consequence(EnemyAttack::SWORD, EnemyReaction::ReactionType::HURT, 1); // multiplied by the sword strength
   set_attack_consequence(EnemyAttack::THROWN_ITEM, EnemyReaction::ReactionType::HURT, 1); // multiplied depending on the item
@@ -852,10 +879,11 @@ void Enemy::update() {
     if (now >= next_explosion_date) {
 
       // create an explosion
+      RandomStream& random_stream = Random::get_stream(Random::Subsystem::ENEMIES);
       Point xy;
-      xy.x = get_top_left_x() + Random::get_number(get_width());
-      xy.y = get_top_left_y() + Random::get_number(get_height());
-      get_entities().add_entity(std::make_shared<Explosion>(
+      xy.x = get_top_left_x() + random_stream.get_number(get_width());
+      xy.y = get_top_left_y() + random_stream.get_number(get_height());
+      get_entities().add_entity(make_pooled<Explosion>(
           "", get_map().get_max_layer(), xy, false
       ));
       Sound::play("explosion");
@@ -1175,11 +1203,12 @@ bool Enemy::is_invulnerable() const {
  */
 void Enemy::try_hurt(EnemyAttack attack, Entity& source, Sprite* this_sprite) {
 
-  EnemyReaction::Reaction reaction = get_attack_consequence(attack, this_sprite);
-  if (invulnerable || reaction.type == EnemyReaction::ReactionType::IGNORED) {
+  const EnemyReaction::Reaction& consequence = get_attack_consequence(attack, this_sprite);
+  if (invulnerable || consequence.type == EnemyReaction::ReactionType::IGNORED) {
     // ignore the attack
     return;
   }
+  EnemyReaction::Reaction reaction = consequence;
 
   if (reaction.type != EnemyReaction::ReactionType::LUA_CALLBACK) {
       // Make the enemy invulnerable for a while except if the reaction
@@ -17,6 +17,8 @@
 #include "solarus/core/Debug.h"
 #include "solarus/entities/EnemyReaction.h"
 #include "solarus/graphics/Sprite.h"
+#include <algorithm>
+#include <functional>
 #include <sstream>
 
 namespace Solarus {
@@ -31,6 +33,20 @@ const EnumInfo<EnemyReaction::ReactionType>::names_type EnumInfoTraits<EnemyReac
   { EnemyReaction::ReactionType::CUSTOM, "custom" }
 };
 
+namespace {
+
+/**
+ * \brief Orders sprite-specific reactions by sprite.
+ */
+struct SpriteLess {
+  template<typename Reaction>
+  bool operator()(const std::pair<const Sprite*, Reaction>& sprite_reaction, const Sprite* sprite) const {
+    return std::less<const Sprite*>()(sprite_reaction.first, sprite);
+  }
+};
+
+}
+
 /**
  * \brief Constructor.
  */
@@ -86,22 +102,41 @@ void EnemyReaction::set_sprite_reaction(const Sprite* sprite, ReactionType react
     set_general_reaction(reaction, life_lost);
   }
   else {
-    sprite_reactions[sprite].type = reaction;
+    Reaction& sprite_reaction = get_sprite_reaction(sprite);
+    sprite_reaction.type = reaction;
     if (reaction == ReactionType::HURT) {
       if (life_lost < 0) {
         std::ostringstream oss;
         oss << "Invalid amount of life: " << life_lost;
         Debug::die(oss.str());
       }
-      sprite_reactions[sprite].life_lost = life_lost;
+      sprite_reaction.life_lost = life_lost;
     }
     else if (reaction == ReactionType::LUA_CALLBACK) {
       Debug::check_assertion(!callback.is_empty(), "Missing enemy reaction callback");
-      sprite_reactions[sprite].callback = callback;
+      sprite_reaction.callback = callback;
     }
   }
 }
 
+/**
+ * \brief Returns the specific reaction of a sprite, creating it if necessary.
+ *
+ * A new sprite-specific reaction starts as IGNORED.
+ *
+ * \param sprite A sprite of the enemy.
+ * \return The reaction of this sprite.
+ */
+EnemyReaction::Reaction& EnemyReaction::get_sprite_reaction(const Sprite* sprite) {
+
+  auto it = std::lower_bound(
+      sprite_reactions.begin(), sprite_reactions.end(), sprite, SpriteLess());
+  if (it == sprite_reactions.end() || it->first != sprite) {
+    it = sprite_reactions.emplace(it, sprite, Reaction());
+  }
+  return it->second;
+}
+
 /**
  * \brief Returns the reaction to an attack on a sprite.
  * \param sprite the sprite that receives the attack
@@ -111,8 +146,9 @@ const EnemyReaction::Reaction& EnemyReaction::get_reaction(
     const Sprite* sprite) const {
 
   if (sprite != nullptr) {
-    auto it = sprite_reactions.find(sprite);
-    if (it != sprite_reactions.end()) {
+    const auto it = std::lower_bound(
+        sprite_reactions.begin(), sprite_reactions.end(), sprite, SpriteLess());
+    if (it != sprite_reactions.end() && it->first == sprite) {
       return it->second;
     }
   }
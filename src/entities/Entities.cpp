@@ -15,31 +15,58 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Music.h"
-#include "solarus/containers/Quadtree.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/FrameStats.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/PerfTrace.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/ResourceProvider.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/AnimatedRegions.h"
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/CrystalBlock.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/Separator.h"
 #include "solarus/entities/SeparatorPtr.h"
 #include "solarus/entities/Stairs.h"
+#include "solarus/entities/Stream.h"
 #include "solarus/entities/Tile.h"
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/FrameDamage.h"
+#include "solarus/graphics/PixelFilterExecutor.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/graphics/SpriteData.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <set>
 #include <sstream>
 #include <lua.hpp>
 
 namespace Solarus {
 
+const std::string EnumInfoTraits<Entities::RoomActivation>::pretty_name = "room activation";
+
+const EnumInfo<Entities::RoomActivation>::names_type EnumInfoTraits<Entities::RoomActivation>::names = {
+  { Entities::RoomActivation::NONE, "none" },
+  { Entities::RoomActivation::ROOM, "room" },
+  { Entities::RoomActivation::ADJACENT_ROOMS, "adjacent_rooms" },
+};
+
+const EntityVector Entities::no_entities;
+constexpr size_t Entities::max_draw_lookahead;
+
 namespace {
 
 /**
@@ -102,16 +129,41 @@ Entities::Entities(Game& game, Map& map):
   tiles_grid_size(0),
   tiles_ground(),
   non_animated_regions(),
-  tiles_in_animated_regions(),
+  animated_regions(),
+  walkability_grid(*this, map.get_width8(), map.get_height8()),
+  ground_observers(),
+  stream_field(map.get_width8(), map.get_height8()),
+  separator_regions(),
+  separator_regions_dirty(true),
   hero(game.get_hero()),
   camera(nullptr),
   named_entities(),
+  sorted_named_entities(),
   all_entities(),
+  hot_states(),
+  lua_events_version(0),
+  entities_by_type(EnumInfoTraits<EntityType>::names.size()),
   quadtree(new EntityTree()),
   z_orders(),
   entities_drawn_not_at_their_position(),
   entities_to_draw(),
+  draw_region(),
+  drawing_entities(false),
+  draw_items(),
+  skipped_draw_items(),
+  occlusion_culling_enabled(false),
+  occluded_squares_outdated(true),
+  occluded_squares(),
   entities_to_remove(),
+  entities_to_destroy(),
+  collision_batching_enabled(false),
+  collision_batching_active(false),
+  entities_to_check(),
+  stream_field_enabled(false),
+  parallel_update_enabled(false),
+  sprites_to_advance(),
+  room_activation(RoomActivation::NONE),
+  active_rooms(),
   default_destination(nullptr) {
 
   // Initialize the size.
@@ -127,6 +179,9 @@ Entities::Entities(Game& game, Map& map):
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>(
         new NonAnimatedRegions(map, layer)
     );
+    animated_regions[layer] = std::unique_ptr<AnimatedRegions>(
+        new AnimatedRegions(map)
+    );
   }
 
   // Initialize the quadtree.
@@ -146,6 +201,9 @@ Entities::Entities(Game& game, Map& map):
  * \brief Destructor.
  */
 Entities::~Entities() {
+
+  // Destroy removed entities while the rest of the map still exists.
+  entities_to_destroy.clear();
 }
 
 /**
@@ -153,10 +211,18 @@ Entities::~Entities() {
  */
 void Entities::create_entities(const MapData& data) {
 
-  // Create entities from the map data file.
+  // Tiles are not visible from Lua: add them first, in parallel.
+  const ByLayer<std::vector<bool>>& tiles_added = add_tiles(data);
+  preload_sprites(data);
+
+  // Create other entities from the map data file.
   LuaContext& lua_context = map.get_lua_context();
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    const std::vector<bool>& layer_tiles_added = tiles_added.at(layer);
     for (int i = 0; i < data.get_num_entities(layer); ++i) {
+      if (layer_tiles_added[i]) {
+        continue;
+      }
       const EntityData& entity_data = data.get_entity({ layer, i });
       EntityType type = entity_data.get_type();
       if (!EntityTypeInfo::can_be_stored_in_map_file(type)) {
@@ -169,6 +235,197 @@ void Entities::create_entities(const MapData& data) {
   }
 }
 
+/**
+ * \brief Adds the tiles of the map data, one layer per thread.
+ *
+ * Each layer has its own ground grid and non-animated regions,
+ * so layers can be filled in parallel.
+ * Tiles with invalid data are not added here: they are left to the usual
+ * creation functions, which report the error.
+ *
+ * \param data The map data.
+ * \return For each layer, whether each entity of the data was added.
+ */
+Entities::ByLayer<std::vector<bool>> Entities::add_tiles(const MapData& data) {
+
+  // Loading tilesets is not thread-safe: get the ones of the tiles first.
+  ResourceProvider& resource_provider = game.get_resource_provider();
+  std::map<std::string, const Tileset*> tilesets;
+  ByLayer<std::vector<bool>> tiles_added;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    tiles_added[layer].assign(data.get_num_entities(layer), false);
+    for (int i = 0; i < data.get_num_entities(layer); ++i) {
+      const EntityData& entity_data = data.get_entity({ layer, i });
+      if (entity_data.get_type() != EntityType::TILE) {
+        continue;
+      }
+      const std::string& tileset_id = entity_data.get_string("tileset");
+      if (!tileset_id.empty() && tilesets.find(tileset_id) == tilesets.end()) {
+        tilesets[tileset_id] = &resource_provider.get_tileset(tileset_id);
+      }
+    }
+  }
+
+  const int min_layer = map.get_min_layer();
+  const int num_layers = map.get_max_layer() - min_layer + 1;
+  PixelFilterExecutor::run(num_layers, 1, [&](int first_layer_index, int num_layers_in_band) {
+    for (int layer = min_layer + first_layer_index;
+        layer < min_layer + first_layer_index + num_layers_in_band;
+        ++layer) {
+      std::vector<bool>& layer_tiles_added = tiles_added.at(layer);
+
+      // Consecutive tiles of the same pattern that continue each other
+      // are merged in one rectangle before being added.
+      TileInfo pending_tile_info;
+      Size pending_size;
+      bool has_pending_tile = false;
+      for (int i = 0; i < data.get_num_entities(layer); ++i) {
+        const EntityData& entity_data = data.get_entity({ layer, i });
+        if (entity_data.get_type() != EntityType::TILE) {
+          continue;
+        }
+
+        const Size size = {
+            entity_data.get_integer("width"),
+            entity_data.get_integer("height")
+        };
+        if (size.width < 0 || size.width % 8 != 0 ||
+            size.height < 0 || size.height % 8 != 0) {
+          continue;
+        }
+
+        const std::string& tileset_id = entity_data.get_string("tileset");
+        const Tileset& tileset = tileset_id.empty() ?
+            map.get_tileset() : *tilesets.at(tileset_id);
+        const std::string& pattern_id = entity_data.get_string("pattern");
+        std::shared_ptr<TilePattern> pattern = tileset.get_tile_pattern(pattern_id);
+        if (pattern == nullptr) {
+          continue;
+        }
+
+        layer_tiles_added[i] = true;
+        const Tileset* tile_tileset = tileset_id.empty() ? nullptr : &tileset;
+        if (has_pending_tile &&
+            extend_tile_rectangle(pending_tile_info, pending_size,
+                                  entity_data.get_xy(), size, pattern_id, tile_tileset)) {
+          continue;
+        }
+
+        if (has_pending_tile) {
+          add_tile_infos_to_layer(pending_tile_info, pending_size);
+        }
+        pending_tile_info.layer = layer;
+        pending_tile_info.box = { entity_data.get_xy(), pattern->get_size() };
+        pending_tile_info.pattern_id = pattern_id;
+        pending_tile_info.pattern = pattern;
+        pending_tile_info.tileset = tile_tileset;
+        pending_size = size;
+        has_pending_tile = true;
+      }
+      if (has_pending_tile) {
+        add_tile_infos_to_layer(pending_tile_info, pending_size);
+      }
+    }
+  });
+
+  walkability_grid.notify_tiles_ground_changed();
+  return tiles_added;
+}
+
+/**
+ * \brief Tries to extend a rectangle of tiles with the next tile of the map.
+ *
+ * The next tile must have the same pattern and continue the rectangle
+ * horizontally or vertically, so that the pattern repeats the same way.
+ *
+ * \param tile_info The top-left tile of the rectangle.
+ * \param[in,out] size Size of the rectangle, extended in case of success.
+ * \param xy Position of the next tile.
+ * \param next_size Size of the next tile.
+ * \param pattern_id Pattern of the next tile.
+ * \param tileset Tileset of the next tile, nullptr for the one of the map.
+ * \return \c true if the next tile was merged into the rectangle.
+ */
+bool Entities::extend_tile_rectangle(
+    const TileInfo& tile_info,
+    Size& size,
+    const Point& xy,
+    const Size& next_size,
+    const std::string& pattern_id,
+    const Tileset* tileset) {
+
+  if (pattern_id != tile_info.pattern_id || tileset != tile_info.tileset) {
+    return false;
+  }
+
+  const Rectangle& box = tile_info.box;
+  const Size& pattern_size = tile_info.pattern->get_size();
+  if (xy.y == box.get_y() &&
+      next_size.height == size.height &&
+      xy.x == box.get_x() + size.width &&
+      size.width % pattern_size.width == 0) {
+    size.width += next_size.width;
+    return true;
+  }
+
+  if (xy.x == box.get_x() &&
+      next_size.width == size.width &&
+      xy.y == box.get_y() + size.height &&
+      size.height % pattern_size.height == 0) {
+    size.height += next_size.height;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * \brief Parses in parallel the sprites of the map data not loaded yet.
+ *
+ * Only sprite data files are parsed in parallel. Animation sets are then
+ * created from this thread. Their images are loaded later, when each
+ * animation is first used.
+ *
+ * \param data The map data.
+ */
+void Entities::preload_sprites(const MapData& data) {
+
+  std::vector<std::string> sprite_ids;
+  std::set<std::string> known_sprite_ids;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    for (int i = 0; i < data.get_num_entities(layer); ++i) {
+      const EntityData& entity_data = data.get_entity({ layer, i });
+      if (!entity_data.is_string("sprite")) {
+        continue;
+      }
+      const std::string& sprite_id = entity_data.get_string("sprite");
+      if (!sprite_id.empty() &&
+          known_sprite_ids.insert(sprite_id).second &&
+          !Sprite::is_animation_set_loaded(sprite_id)) {
+        sprite_ids.push_back(sprite_id);
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<SpriteData>> sprites_data(sprite_ids.size());
+  PixelFilterExecutor::run(static_cast<int>(sprite_ids.size()), 1, [&](int first_sprite, int num_sprites) {
+    for (int i = first_sprite; i < first_sprite + num_sprites; ++i) {
+      const std::string& file_name = std::string("sprites/") + sprite_ids[i] + ".dat";
+      std::unique_ptr<SpriteData> sprite_data(new SpriteData());
+      if (QuestFiles::data_file_exists(file_name) &&
+          sprite_data->import_from_quest_file(file_name)) {
+        sprites_data[i] = std::move(sprite_data);
+      }
+    }
+  });
+
+  for (size_t i = 0; i < sprite_ids.size(); ++i) {
+    if (sprites_data[i] != nullptr) {
+      Sprite::add_preloaded_animation_set(sprite_ids[i], *sprites_data[i]);
+    }
+  }
+}
+
 /**
  * \brief Notifies an entity that it is being removed.
  * \param entity The entity being removed.
@@ -178,6 +435,11 @@ void Entities::notify_entity_removed(Entity& entity) {
   if (!entity.is_being_removed()) {
     entity.notify_being_removed();
   }
+  walkability_grid.notify_entity_removed(entity);
+  ground_observers.notify_entity_removed(entity);
+  if (entity.get_type() == EntityType::STREAM) {
+    stream_field.remove_stream(static_cast<Stream&>(entity));
+  }
 }
 
 /**
@@ -188,15 +450,83 @@ Hero& Entities::get_hero() {
   return *hero;
 }
 
+/**
+ * \brief Returns the cache of obstacles of the terrain.
+ * \return The walkability grid.
+ */
+WalkabilityGrid& Entities::get_walkability_grid() {
+  return walkability_grid;
+}
+
+/**
+ * \brief Returns the spatial index of ground observers and modifiers.
+ * \return The ground observers.
+ */
+GroundObservers& Entities::get_ground_observers() {
+  return ground_observers;
+}
+
+/**
+ * \brief Returns the separators indexed by position and the regions
+ * they make.
+ *
+ * They are rebuilt if separators were added, removed or moved.
+ *
+ * \return The separator regions.
+ */
+const SeparatorRegions& Entities::get_separator_regions() const {
+
+  if (separator_regions_dirty) {
+    std::vector<const Separator*> separators;
+    for (const std::shared_ptr<const Separator>& separator : get_entities_by_type<Separator>()) {
+      separators.push_back(separator.get());
+    }
+    separator_regions.build(map.get_size(), separators);
+    separator_regions_dirty = false;
+  }
+  return separator_regions;
+}
+
 /**
  * \brief Returns all entities expect tiles.
  * \return The entities except tiles.
  */
 EntityVector Entities::get_entities() {
+  return all_entities;
+}
 
-  EntityVector result;
-  result.insert(result.begin(), all_entities.begin(), all_entities.end());
-  return result;
+/**
+ * \brief Returns a hash of the type, position and layer of all entities
+ * except tiles.
+ *
+ * Two simulations that stay identical have the same hash at each tick:
+ * this detects when an input replay diverges from its recording.
+ *
+ * \return A FNV-1a hash of the entity positions.
+ */
+uint64_t Entities::get_positions_hash() const {
+
+  uint64_t hash = 14695981039346656037ULL;
+  const auto add = [&hash](int value) {
+    for (int i = 0; i < 4; ++i) {
+      hash ^= static_cast<uint64_t>((static_cast<uint32_t>(value) >> (8 * i)) & 0xFF);
+      hash *= 1099511628211ULL;
+    }
+  };
+  const auto add_entity = [&add](const Entity& entity) {
+    add(static_cast<int>(entity.get_type()));
+    add(entity.get_x());
+    add(entity.get_y());
+    add(entity.get_layer());
+  };
+
+  add_entity(*hero);
+  for (const EntityPtr& entity : all_entities) {
+    if (!entity->is_being_removed()) {
+      add_entity(*entity);
+    }
+  }
+  return hash;
 }
 
 /**
@@ -213,6 +543,7 @@ const std::shared_ptr<Destination>& Entities::get_default_destination() {
  *
  * Coordinates outside the range of the map are not an error:
  * in this case, this function does nothing.
+ * The walkability grid is not notified: the caller has to do it.
  *
  * \param layer Layer of the square.
  * \param x8 X coordinate of the square (divided by 8).
@@ -223,7 +554,7 @@ void Entities::set_tile_ground(int layer, int x8, int y8, Ground ground) {
 
   if (x8 >= 0 && x8 < map_width8 && y8 >= 0 && y8 < map_height8) {
     int index = y8 * map_width8 + x8;
-    tiles_ground[layer][index] = ground;
+    tiles_ground.at(layer)[index] = ground;
   }
 }
 
@@ -270,6 +601,31 @@ EntityPtr Entities::find_entity(const std::string& name) {
   return entity;
 }
 
+/**
+ * \brief Calls a function on each named entity having the specified
+ * name prefix, in alphabetical order.
+ *
+ * Entities are found by a range scan of sorted_named_entities,
+ * so only matching names are visited.
+ *
+ * \param prefix Prefix of the name.
+ * \param function Function to call on each entity found.
+ * It returns \c false to stop the iteration.
+ */
+template<typename Function>
+void Entities::for_each_entity_with_prefix(
+    const std::string& prefix, Function function) const {
+
+  for (auto it = sorted_named_entities.lower_bound(prefix);
+      it != sorted_named_entities.end() &&
+      it->first.compare(0, prefix.size(), prefix) == 0;
+      ++it) {
+    if (!function(it->second)) {
+      return;
+    }
+  }
+}
+
 /**
  * \brief Returns the entities of the map having the specified name prefix.
  *
@@ -294,13 +650,12 @@ EntityVector Entities::get_entities_with_prefix(const std::string& prefix) {
   }
 
   // Normal case: add entities whose name starts with the prefix.
-  for (const auto& kvp: named_entities) {
-    const EntityPtr& entity = kvp.second;
-    if (entity->has_prefix(prefix) &&
-        !entity->is_being_removed()) {
+  for_each_entity_with_prefix(prefix, [&](const EntityPtr& entity) {
+    if (!entity->is_being_removed()) {
       entities.push_back(entity);
     }
-  }
+    return true;
+  });
 
   return entities;
 }
@@ -333,24 +688,25 @@ EntityVector Entities::get_entities_with_prefix(
 
   if (prefix.empty()) {
     // No prefix: return all entities of the type, no matter their name.
-    for (const EntityPtr& entity: get_entities_by_type(type)) {
-      if (!entity->is_being_removed()) {
-        entities.push_back(entity);
+    for (const auto& kvp: entities_by_type[static_cast<size_t>(type)]) {
+      for (const EntityPtr& entity: kvp.second) {
+        if (!entity->is_being_removed()) {
+          entities.push_back(entity);
+        }
       }
     }
     return entities;
   }
 
   // Normal case: add entities whose name starts with the prefix.
-  for (const auto& kvp: named_entities) {
-    const EntityPtr& entity = kvp.second;
+  for_each_entity_with_prefix(prefix, [&](const EntityPtr& entity) {
     if (entity->get_type() == type &&
-        entity->has_prefix(prefix) &&
         !entity->is_being_removed()
     ) {
       entities.push_back(entity);
     }
-  }
+    return true;
+  });
 
   return entities;
 }
@@ -379,13 +735,55 @@ EntityVector Entities::get_entities_with_prefix_z_sorted(
  */
 bool Entities::has_entity_with_prefix(const std::string& prefix) const {
 
-  for (const EntityPtr& entity: all_entities) {
-    if (entity->has_prefix(prefix) && !entity->is_being_removed()) {
-      return true;
+  if (prefix.empty()) {
+    for (const EntityPtr& entity: all_entities) {
+      if (!entity->is_being_removed()) {
+        return true;
+      }
     }
+    return false;
   }
 
-  return false;
+  // Stop at the first match.
+  bool found = false;
+  for_each_entity_with_prefix(prefix, [&](const EntityPtr& entity) {
+    found = !entity->is_being_removed();
+    return !found;
+  });
+
+  return found;
+}
+
+/**
+ * \brief Returns the number of entities of the map having the specified
+ * name prefix.
+ *
+ * This is the size of get_entities_with_prefix(prefix), without building
+ * the list.
+ *
+ * \param prefix Prefix of the name.
+ * \return The number of entities having this prefix in their name.
+ */
+int Entities::get_num_entities_with_prefix(const std::string& prefix) const {
+
+  int count = 0;
+  if (prefix.empty()) {
+    for (const EntityPtr& entity: all_entities) {
+      if (!entity->is_being_removed()) {
+        ++count;
+      }
+    }
+    return count + 1;  // The hero.
+  }
+
+  for_each_entity_with_prefix(prefix, [&](const EntityPtr& entity) {
+    if (!entity->is_being_removed()) {
+      ++count;
+    }
+    return true;
+  });
+
+  return count;
 }
 
 /**
@@ -398,12 +796,13 @@ void Entities::get_entities_in_rectangle_z_sorted(
     const Rectangle& rectangle, ConstEntityVector& result
 ) const {
 
-  EntityVector non_const_result = quadtree->get_elements(rectangle);
-
-  result.reserve(non_const_result.size());
-  for (const ConstEntityPtr& entity : non_const_result) {
-      result.push_back(entity);
-  }
+  const size_t initial_size = result.size();
+  add_pending_entities_to_quadtree();
+  quadtree->visit_elements(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity);
+    return true;
+  });
+  std::sort(result.begin() + initial_size, result.end(), EntityZOrderComparator());
 }
 
 /**
@@ -413,7 +812,28 @@ void Entities::get_entities_in_rectangle_z_sorted(
     const Rectangle& rectangle, EntityVector& result
 ) {
 
-  result = quadtree->get_elements(rectangle);
+  result.clear();
+  add_pending_entities_to_quadtree();
+  quadtree->get_elements(rectangle, result);
+  std::sort(result.begin(), result.end(), EntityZOrderComparator());
+}
+
+/**
+ * \brief Returns all entities whose bounding box overlaps the given rectangle,
+ * in no particular order.
+ *
+ * This is faster than get_entities_in_rectangle_z_sorted() when the order
+ * does not matter.
+ *
+ * \param[in] rectangle A rectangle.
+ * \param[out] result The entities in that rectangle.
+ */
+void Entities::get_entities_in_rectangle(
+    const Rectangle& rectangle, EntityVector& result
+) {
+  result.clear();
+  add_pending_entities_to_quadtree();
+  quadtree->get_elements(rectangle, result);
 }
 
 /**
@@ -426,7 +846,13 @@ void Entities::get_entities_in_rectangle_z_sorted(
  */
 Rectangle Entities::get_region_box(const Point& point) const {
 
-  // Start with a rectangle of the whole map.
+  const SeparatorRegions& separator_regions = get_separator_regions();
+  const int index = separator_regions.get_region_index_at(point);
+  if (index != -1) {
+    return separator_regions.get_region(index);
+  }
+
+  // The point is outside the map: start with a rectangle of the whole map.
   int top = 0;
   int bottom = map.get_height();
   int left = 0;
@@ -434,9 +860,7 @@ Rectangle Entities::get_region_box(const Point& point) const {
 
   // Find the closest separator in each direction.
 
-  const std::set<ConstSeparatorPtr>& separators =
-      get_entities_by_type<Separator>();
-  for (const ConstSeparatorPtr& separator: separators) {
+  for (const ConstSeparatorPtr& separator: get_entities_by_type<Separator>()) {
 
     const Point& separator_center = separator->get_center_point();
 
@@ -513,14 +937,13 @@ void Entities::get_entities_in_region_z_sorted(
 /**
  * \brief Returns all entities of a type.
  * \param type An entity type.
- * \return All entities of the type.
+ * \return All entities of the type, in arbitrary order.
  */
-EntitySet Entities::get_entities_by_type(EntityType type) {
+EntityVector Entities::get_entities_by_type(EntityType type) const {
 
-  EntitySet result;
-  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-    const EntitySet& layer_entities = get_entities_by_type(type, layer);
-    result.insert(layer_entities.begin(), layer_entities.end());
+  EntityVector result;
+  for (const auto& kvp : entities_by_type[static_cast<size_t>(type)]) {
+    result.insert(result.end(), kvp.second.begin(), kvp.second.end());
   }
   return result;
 }
@@ -531,41 +954,33 @@ EntitySet Entities::get_entities_by_type(EntityType type) {
  * \param type An entity type.
  * \return All entities of the type.
  */
-EntityVector Entities::get_entities_by_type_z_sorted(EntityType type) {
+EntityVector Entities::get_entities_by_type_z_sorted(EntityType type) const {
 
-  EntitySet entity_set = get_entities_by_type(type);
-  EntityVector entities;
-  entities.insert(entities.begin(), entity_set.begin(), entity_set.end());
+  EntityVector entities = get_entities_by_type(type);
   std::sort(entities.begin(), entities.end(), EntityZOrderComparator());
   return entities;
 }
 
 /**
  * \brief Returns all entities of a type on the given layer.
+ *
+ * The list is not copied: it is invalidated when an entity of this type
+ * is added or changes its layer.
+ *
  * \param type Type of entities to get.
  * \param layer The layer to get entities from.
- * \return All entities of the type on this layer.
+ * \return All entities of the type on this layer, in arbitrary order.
  */
-EntitySet Entities::get_entities_by_type(EntityType type, int layer) {
-
-  Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
-
-  EntitySet result;
+const EntityVector& Entities::get_entities_by_type(EntityType type, int layer) const {
 
-  const auto& it = entities_by_type.find(type);
-  if (it == entities_by_type.end()) {
-    return result;
-  }
+  SOLARUS_CHECK(map.is_valid_layer(layer), "Invalid layer");
 
-  const ByLayer<EntitySet>& sets = it->second;
-  const auto& layer_it = sets.find(layer);
-  if (layer_it == sets.end()) {
-    return result;
-  }
-  for (const EntityPtr& entity : layer_it->second) {
-    result.insert(entity);
+  const ByLayer<EntityVector>& layers = entities_by_type[static_cast<size_t>(type)];
+  const auto& it = layers.find(layer);
+  if (it == layers.end()) {
+    return no_entities;
   }
-  return result;
+  return it->second;
 }
 
 /**
@@ -577,6 +992,7 @@ void Entities::bring_to_front(Entity& entity) {
   const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
   z_orders.at(layer).bring_to_front(shared_entity);
+  notify_entity_draw_order_changed(entity);
 }
 
 /**
@@ -588,6 +1004,7 @@ void Entities::bring_to_back(Entity& entity) {
   const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
   z_orders.at(layer).bring_to_back(shared_entity);
+  notify_entity_draw_order_changed(entity);
 }
 
 /**
@@ -601,18 +1018,34 @@ void Entities::bring_to_back(Entity& entity) {
 void Entities::notify_map_starting(Map& map, const std::shared_ptr<Destination>& destination) {
 
   // Setup non-animated tiles pre-drawing.
+  // Layers are independent: find their animated regions in parallel.
+  const int min_layer = map.get_min_layer();
+  const int num_layers = map.get_max_layer() - min_layer + 1;
+  ByLayer<std::vector<TileInfo>> tiles_in_animated_regions_info;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    tiles_in_animated_regions_info[layer] = std::vector<TileInfo>();
+  }
+  PixelFilterExecutor::run(num_layers, 1, [&](int first_layer_index, int num_layers_in_band) {
+    for (int layer = min_layer + first_layer_index;
+        layer < min_layer + first_layer_index + num_layers_in_band;
+        ++layer) {
+      non_animated_regions.at(layer)->build(tiles_in_animated_regions_info.at(layer));
+    }
+  });
+
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-    std::vector<TileInfo> tiles_in_animated_regions_info;
-    non_animated_regions.at(layer)->build(tiles_in_animated_regions_info);
-    for (const TileInfo& tile_info : tiles_in_animated_regions_info) {
+    // Reuse the drawings of the last visit if any.
+    non_animated_regions.at(layer)->restore_cells();
+    for (const TileInfo& tile_info : tiles_in_animated_regions_info.at(layer)) {
       // This tile is non-optimizable, create it for real.
       TilePtr tile = std::make_shared<Tile>(tile_info);
-      tiles_in_animated_regions.at(layer).push_back(tile);
+      animated_regions.at(layer)->add_tile(tile);
       add_entity(tile);
     }
+    animated_regions.at(layer)->build();
   }
 
-  // Now, tiles_in_animated_regions contains the tiles that won't be optimized.
+  // Now, animated_regions contains the tiles that won't be optimized.
   // Notify entities.
   for (const EntityPtr& entity: all_entities) {
     entity->notify_map_starting(map, destination);
@@ -622,6 +1055,21 @@ void Entities::notify_map_starting(Map& map, const std::shared_ptr<Destination>&
   hero->notify_tileset_changed();
 }
 
+/**
+ * \brief Saves the drawings of the non-animated tiles of the map,
+ * to reuse them if the map is entered again soon.
+ *
+ * Called when the map is left for another one.
+ */
+void Entities::save_non_animated_cells() {
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    if (non_animated_regions.at(layer) != nullptr) {
+      non_animated_regions.at(layer)->save_cells();
+    }
+  }
+}
+
 /**
  * \brief Notifies all entities of the map that the map has just started.
  *
@@ -680,10 +1128,9 @@ void Entities::notify_tileset_changed() {
 
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
     non_animated_regions[layer]->notify_tileset_changed();
-    for (const TilePtr& tile : tiles_in_animated_regions[layer]) {
-      tile->notify_tileset_changed();
-    }
+    animated_regions[layer]->notify_tileset_changed();
   }
+  occluded_squares_outdated = true;
 
   for (const EntityPtr& entity: all_entities) {
     entity->notify_tileset_changed();
@@ -713,9 +1160,10 @@ void Entities::initialize_layers() {
   Debug::check_assertion(z_orders.empty(), "Layers already initialized");
 
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-    tiles_ground[layer] = std::vector<Ground>();
+    tiles_ground[layer] = GroundVector(ArenaAllocator<Ground>(map.get_arena()));
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>();
-    tiles_in_animated_regions[layer] = std::vector<TilePtr>();
+    animated_regions[layer] = std::unique_ptr<AnimatedRegions>();
+    occluded_squares[layer] = std::vector<bool>();
     z_orders[layer] = ZOrderInfo();
   }
 }
@@ -726,11 +1174,98 @@ void Entities::initialize_layers() {
  * If possible, the actual tile will never be created for performance reasons:
  * instead, only its picture and its obstacle info are stored.
  *
+ * \param tile_info The tile info to add.
+ */
+void Entities::add_tile_info(const TileInfo& tile_info) {
+
+  add_tile_info_to_layer(tile_info);
+  walkability_grid.notify_tiles_ground_changed();
+}
+
+/**
+ * \brief Adds the creation info of tiles repeating a pattern over a rectangle.
+ *
  * This function is called for each tile when loading the map.
  *
+ * \param tile_info The tile info of the top-left pattern.
+ * \param size Size of the rectangle to fill with the pattern.
+ */
+void Entities::add_tile_infos(const TileInfo& tile_info, const Size& size) {
+
+  add_tile_infos_to_layer(tile_info, size);
+  walkability_grid.notify_tiles_ground_changed();
+}
+
+/**
+ * \brief Adds the creation info of tiles repeating a pattern over a rectangle,
+ * without notifying the walkability grid.
+ *
+ * Only the structures of the tile layer are modified, so layers can be
+ * filled from different threads.
+ *
+ * \param tile_info The tile info of the top-left pattern.
+ * \param size Size of the rectangle to fill with the pattern.
+ */
+void Entities::add_tile_infos_to_layer(const TileInfo& tile_info, const Size& size) {
+
+  const int x = tile_info.box.get_x();
+  const int y = tile_info.box.get_y();
+  const TilePattern& pattern = *tile_info.pattern;
+  const Size& pattern_size = pattern.get_size();
+  if (size.width <= 0 || size.height <= 0) {
+    return;
+  }
+
+  if (!pattern.is_animated()) {
+    // Give the whole rectangle to the non-animated regions as one
+    // repeated tile: they only split it where animated tiles overlap it.
+    TileInfo repeated_tile_info = tile_info;
+    repeated_tile_info.box.set_size(
+        (size.width + pattern_size.width - 1) / pattern_size.width * pattern_size.width,
+        (size.height + pattern_size.height - 1) / pattern_size.height * pattern_size.height
+    );
+    Debug::check_assertion(map.is_valid_layer(tile_info.layer), "Invalid layer");
+    non_animated_regions.at(tile_info.layer)->add_tile(repeated_tile_info);
+
+    const Ground ground = pattern.get_ground();
+    if (!GroundInfo::is_ground_diagonal(ground)) {
+      set_pattern_ground(tile_info.layer, repeated_tile_info.box, ground);
+      return;
+    }
+    for (int current_y = y; current_y < y + size.height; current_y += pattern_size.height) {
+      for (int current_x = x; current_x < x + size.width; current_x += pattern_size.width) {
+        set_pattern_ground(
+            tile_info.layer,
+            Rectangle(current_x, current_y, pattern_size.width, pattern_size.height),
+            ground
+        );
+      }
+    }
+    return;
+  }
+
+  // Animated tiles become real entities: divide the rectangle in tiles
+  // of the size of the pattern.
+  TileInfo current_tile_info = tile_info;
+  for (int current_y = y; current_y < y + size.height; current_y += pattern_size.height) {
+    for (int current_x = x; current_x < x + size.width; current_x += pattern_size.width) {
+      current_tile_info.box.set_xy(current_x, current_y);
+      // The tile will actually be created only if it cannot be optimized away.
+      add_tile_info_to_layer(current_tile_info);
+    }
+  }
+}
+
+/**
+ * \brief Adds tile creation info to the map without notifying the
+ * walkability grid.
+ *
+ * Only the structures of the tile layer are modified, so layers can be
+ * filled from different threads.
+ *
  * \param tile_info The tile info to add.
  */
-void Entities::add_tile_info(const TileInfo& tile_info) {
+void Entities::add_tile_info_to_layer(const TileInfo& tile_info) {
 
   const Rectangle& box = tile_info.box;
   const int layer = tile_info.layer;
@@ -749,10 +1284,25 @@ void Entities::add_tile_info(const TileInfo& tile_info) {
       "Static tile size must match tile pattern size");
 
   // Update the animated regions manager.
-  non_animated_regions[tile_info.layer]->add_tile(tile_info);
+  non_animated_regions.at(tile_info.layer)->add_tile(tile_info);
 
   // Update the ground list.
-  const Ground ground = pattern.get_ground();
+  set_pattern_ground(layer, box, pattern.get_ground());
+}
+
+/**
+ * \brief Sets the tile ground of the 8x8 squares covered by a tile pattern.
+ *
+ * Grounds that are the same for all points of the pattern can be set
+ * over a rectangle of several patterns at once.
+ * Diagonal grounds must be set pattern by pattern.
+ * The walkability grid is not notified: the caller has to do it.
+ *
+ * \param layer Layer of the tile.
+ * \param box Rectangle covered by the tile.
+ * \param ground Ground of the tile pattern.
+ */
+void Entities::set_pattern_ground(int layer, const Rectangle& box, Ground ground) {
 
   const int tile_x8 = box.get_x() / 8;
   const int tile_y8 = box.get_y() / 8;
@@ -906,6 +1456,7 @@ void Entities::add_entity(const EntityPtr& entity) {
   if (entity == nullptr) {
     return;
   }
+  FrameDamage::notify();
 
   Debug::check_assertion(map.is_valid_layer(entity->get_layer()),
       "No such layer on this map");
@@ -914,8 +1465,10 @@ void Entities::add_entity(const EntityPtr& entity) {
   if (type != EntityType::TILE) {  // Tiles are optimized specifically.
     const int layer = entity->get_layer();
 
-    // Update the quadtree.
-    quadtree->add(entity, entity->get_max_bounding_box());
+    // Update the quadtree before its next use.
+    // Entities created together, like the treasures of destructibles
+    // cut in the same tick, are inserted at once.
+    entities_to_add_to_quadtree.push_back(entity);
 
     // Update the specific entities lists.
     switch (entity->get_type()) {
@@ -947,17 +1500,31 @@ void Entities::add_entity(const EntityPtr& entity) {
     // Track the insertion order.
     z_orders[layer].add(entity);
 
+    // Draw it from now on if it is in the region of entities to draw.
+    entity->set_in_draw_list(false);
+    add_entity_to_draw(entity);
+
     // Update the list of entities by type.
-    auto it = entities_by_type.find(type);
-    if (it == entities_by_type.end()) {
-      it = entities_by_type.emplace(type, ByLayer<EntitySet>()).first;
-    }
-    ByLayer<EntitySet>& sets = it->second;
-    sets[layer].insert(entity);
+    add_to_type_list(entity, layer);
 
     // Update the list of all entities.
     if (type != EntityType::HERO) {
       all_entities.push_back(entity);
+
+      HotState hot_state;
+      hot_state.entity = entity.get();
+      hot_state.bounding_box = entity->get_max_bounding_box();
+      hot_state.layer = layer;
+      update_hot_flags(hot_state);
+      entity->set_hot_state_index(hot_states.size());
+      hot_states.push_back(hot_state);
+    }
+
+    // Update the terrain cache.
+    walkability_grid.notify_ground_modifier_changed(*entity);
+    ground_observers.notify_entity_added(*entity);
+    if (type == EntityType::STREAM && stream_field_enabled) {
+      notify_stream_changed(static_cast<Stream&>(*entity));
     }
   }
 
@@ -995,6 +1562,7 @@ void Entities::add_entity(const EntityPtr& entity) {
       entity->set_name(name);
     }
     named_entities[name] = entity;
+    sorted_named_entities[name] = entity;
   }
 
   // Notify the entity.
@@ -1016,12 +1584,15 @@ void Entities::remove_entity(Entity& entity) {
 
     // Tell the entity.
     entity.notify_being_removed();
+    walkability_grid.notify_entity_removed(entity);
+    ground_observers.notify_entity_changed(entity);
 
     // Remove the entity from the by name list
     // to allow users to create a new one with
     // the same name right now.
     if (!entity.get_name().empty()) {
       named_entities.erase(entity.get_name());
+      sorted_named_entities.erase(entity.get_name());
     }
   }
 }
@@ -1051,24 +1622,37 @@ void Entities::remove_entities_with_prefix(const std::string& prefix) {
 }
 
 /**
- * \brief Removes and destroys the entities placed in the entities_to_remove list.
+ * \brief Removes the entities placed in the entities_to_remove list.
+ *
+ * Lists of all entities are compacted in a single pass for the whole batch.
+ * The entities are then destroyed later by destroy_removed_entities(),
+ * a few at each cycle or during idle time.
  */
 void Entities::remove_marked_entities() {
 
-  // Remove the marked entities.
+  if (entities_to_remove.empty()) {
+    return;
+  }
+  FrameDamage::notify();
+
+  // Remove the marked entities from the structures indexed by entity.
   for (const EntityPtr& entity: entities_to_remove) {
 
     const EntityType type = entity->get_type();
     const int layer = entity->get_layer();
 
     // Remove it from the quadtree.
+    add_pending_entities_to_quadtree();
     quadtree->remove(entity);
 
-    // Remove it from the whole list.
-    all_entities.remove(entity);
+    // The name may already have been given to a new entity.
     const std::string& name = entity->get_name();
     if (!name.empty()) {
-      named_entities.erase(name);
+      const auto& it = named_entities.find(name);
+      if (it != named_entities.end() && it->second == entity) {
+        named_entities.erase(it);
+        sorted_named_entities.erase(name);
+      }
     }
 
     // Update the specific entities lists.
@@ -1086,35 +1670,245 @@ void Entities::remove_marked_entities() {
     z_orders.at(layer).remove(entity);
 
     // Update the list of entities by type.
-    const auto& it = entities_by_type.find(type);
-    if (it != entities_by_type.end()) {
-      ByLayer<EntitySet>& sets = it->second;
-      sets[layer].erase(entity);
-    }
+    remove_from_type_list(entity, layer);
 
-    // Destroy it.
     notify_entity_removed(*entity);
   }
+
+  // Compact the lists of entities in one pass each.
+  remove_hot_states();
+  remove_drawn_not_at_their_position();
+  for (auto& kvp : entities_to_draw) {
+    EntityVector& entities = kvp.second.entities;
+    entities.erase(std::remove_if(entities.begin(), entities.end(),
+        [](const EntityPtr& entity) {
+          return entity->is_being_removed();
+        }), entities.end());
+  }
+
+  // Destroy them later.
+  entities_to_destroy.insert(
+      entities_to_destroy.end(),
+      std::make_move_iterator(entities_to_remove.begin()),
+      std::make_move_iterator(entities_to_remove.end())
+  );
   entities_to_remove.clear();
 }
 
 /**
- * \brief Suspends or resumes the movement and animations of the entities.
+ * \brief Removes entities being removed from the lists of entities drawn
+ * not at their position.
+ */
+void Entities::remove_drawn_not_at_their_position() {
+
+  for (auto& kvp : entities_drawn_not_at_their_position) {
+    EntityVector& entities = kvp.second;
+    entities.erase(std::remove_if(entities.begin(), entities.end(),
+        [](const EntityPtr& entity) {
+          return entity->is_being_removed();
+        }), entities.end());
+  }
+}
+
+/**
+ * \brief Destroys entities that were removed from the map.
  *
- * This function is called by the map when the game
- * is being suspended or resumed.
+ * Releasing the last reference to an entity runs its destructor and frees
+ * its sprites and movements, which can take a while when many entities
+ * are removed at once.
+ * This function spreads this work: it is called at each cycle with no idle
+ * time, and by the main loop when there is idle time left before the next
+ * frame.
  *
- * \param suspended true to suspend the movement and the animations,
- * false to resume them
+ * \param idle_time Time available in milliseconds. 0 means to only destroy
+ * a few entities.
  */
-void Entities::set_suspended(bool suspended) {
-
-  // the hero first
-  hero->set_suspended(suspended);
+void Entities::destroy_removed_entities(uint32_t idle_time) {
 
-  // other entities
-  for (const EntityPtr& entity: all_entities) {
-    entity->set_suspended(suspended);
+  if (entities_to_destroy.empty()) {
+    return;
+  }
+
+  PerfTrace::Scope trace_scope("entities-destroy");
+
+  if (idle_time == 0) {
+    // Destroy a few of them, and more if they keep accumulating.
+    const size_t count = std::min(
+        entities_to_destroy.size(),
+        std::max(min_destroyed_per_cycle, entities_to_destroy.size() / 8)
+    );
+    entities_to_destroy.erase(entities_to_destroy.end() - count, entities_to_destroy.end());
+    return;
+  }
+
+  // Use half of the idle time at most.
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point deadline = Clock::now() +
+      std::chrono::microseconds(idle_time * 1000 / 2);
+  do {
+    entities_to_destroy.pop_back();
+  } while (!entities_to_destroy.empty() && Clock::now() < deadline);
+}
+
+/**
+ * \brief Removes entities being removed from all_entities and their hot
+ * states, keeping the others in order.
+ *
+ * The entities must still be referenced elsewhere (in entities_to_remove).
+ */
+void Entities::remove_hot_states() {
+
+  size_t count = 0;
+  for (size_t i = 0; i < hot_states.size(); ++i) {
+    HotState& hot_state = hot_states[i];
+    if ((hot_state.flags & HotState::BEING_REMOVED) != 0) {
+      hot_state.entity->set_hot_state_index(-1);
+      continue;
+    }
+    if (count != i) {
+      hot_states[count] = hot_state;
+      all_entities[count] = std::move(all_entities[i]);
+      hot_state.entity->set_hot_state_index(count);
+    }
+    ++count;
+  }
+  hot_states.resize(count);
+  all_entities.resize(count);
+}
+
+/**
+ * \brief Adds an entity to the list of entities of its type and layer.
+ * \param entity The entity to add.
+ * \param layer Its layer.
+ */
+void Entities::add_to_type_list(const EntityPtr& entity, int layer) {
+
+  EntityVector& entities = entities_by_type[static_cast<size_t>(entity->get_type())][layer];
+  entity->set_by_type_index(entities.size());
+  entities.push_back(entity);
+  if (entity->get_type() == EntityType::SEPARATOR) {
+    separator_regions_dirty = true;
+  }
+}
+
+/**
+ * \brief Removes an entity from the list of entities of its type and layer.
+ *
+ * The last entity of the list takes its place.
+ *
+ * \param entity The entity to remove.
+ * \param layer Its layer.
+ */
+void Entities::remove_from_type_list(const EntityPtr& entity, int layer) {
+
+  EntityVector& entities = entities_by_type[static_cast<size_t>(entity->get_type())][layer];
+  const int index = entity->get_by_type_index();
+  SOLARUS_CHECK(index >= 0 && index < static_cast<int>(entities.size()) &&
+      entities[index] == entity, "Entity missing from the list of its type");
+
+  entity->set_by_type_index(-1);
+  if (index != static_cast<int>(entities.size()) - 1) {
+    entities[index] = std::move(entities.back());
+    entities[index]->set_by_type_index(index);
+  }
+  entities.pop_back();
+  if (entity->get_type() == EntityType::SEPARATOR) {
+    separator_regions_dirty = true;
+  }
+}
+
+/**
+ * \brief Recomputes the flags of a hot state from its entity.
+ * \param hot_state The hot state to update.
+ */
+void Entities::update_hot_flags(HotState& hot_state) {
+
+  Entity& entity = *hot_state.entity;
+  uint16_t flags = 0;
+  if (entity.is_enabled()) {
+    flags |= HotState::ENABLED;
+  }
+  if (entity.is_visible()) {
+    flags |= HotState::VISIBLE;
+  }
+  if (entity.is_suspended()) {
+    flags |= HotState::SUSPENDED;
+  }
+  if (entity.get_movement() != nullptr) {
+    flags |= HotState::HAS_MOVEMENT;
+  }
+  if (entity.has_sprite()) {
+    flags |= HotState::HAS_SPRITES;
+  }
+  if (entity.is_detector()) {
+    flags |= HotState::DETECTOR;
+  }
+  if (entity.is_being_removed()) {
+    flags |= HotState::BEING_REMOVED;
+  }
+  if (entity.is_update_needed()) {
+    flags |= HotState::UPDATE_NEEDED;
+  }
+  if (entity.get_type() == EntityType::CAMERA) {
+    flags |= HotState::UPDATED_SEPARATELY;
+  }
+  switch (entity.get_update_policy()) {
+
+  case Entity::UpdatePolicy::ALWAYS:
+    break;
+
+  case Entity::UpdatePolicy::NEAR_CAMERA:
+    flags |= HotState::NEAR_CAMERA_ONLY;
+    break;
+
+  case Entity::UpdatePolicy::ON_DEMAND:
+    flags |= HotState::ON_DEMAND;
+    if ((flags & HotState::UPDATE_NEEDED) != 0 && entity.is_awake()) {
+      flags |= HotState::AWAKE;
+    }
+    break;
+  }
+  hot_state.flags = flags;
+}
+
+/**
+ * \brief This function should be called whenever a property of an entity
+ * stored in its hot state changes: enabled, visible, suspended, movement,
+ * sprites, collision modes or anything that makes its update necessary.
+ *
+ * Bounding box and layer changes are handled by
+ * notify_entity_bounding_box_changed() and set_entity_layer().
+ *
+ * \param entity The entity modified.
+ */
+void Entities::notify_entity_hot_state_changed(Entity& entity) {
+
+  FrameDamage::notify();
+  const int index = entity.get_hot_state_index();
+  if (index < 0) {
+    // Not managed here (hero or tile).
+    return;
+  }
+  update_hot_flags(hot_states[index]);
+}
+
+/**
+ * \brief Suspends or resumes the movement and animations of the entities.
+ *
+ * This function is called by the map when the game
+ * is being suspended or resumed.
+ *
+ * \param suspended true to suspend the movement and the animations,
+ * false to resume them
+ */
+void Entities::set_suspended(bool suspended) {
+
+  // the hero first
+  hero->set_suspended(suspended);
+
+  // other entities
+  for (const EntityPtr& entity: all_entities) {
+    entity->set_suspended(suspended);
   }
 
   // note that we don't suspend the tiles
@@ -1125,31 +1919,127 @@ void Entities::set_suspended(bool suspended) {
  */
 void Entities::update() {
 
+  PerfTrace::Scope trace_scope("entities-update");
+
   Debug::check_assertion(map.is_started(), "The map is not started");
 
   // First update the hero.
+  // Positions before updates are saved to draw interpolated frames.
+  hero->save_previous_xy();
   hero->update();
 
-  // Update the dynamic entities.
-  for (const EntityPtr& entity: all_entities) {
+  // Entities with an update policy other than "always" sleep
+  // when they are more than one screen away from the camera.
+  const Rectangle near_camera(
+      Point(
+          camera->get_x() - camera->get_size().width,
+          camera->get_y() - camera->get_size().height
+      ),
+      camera->get_size() * 3
+  );
+
+  // In room mode, entities outside the active rooms are frozen.
+  update_active_rooms();
+
+  // on_update() defined on a metatable wakes up sleeping entities.
+  const uint32_t events_version = map.get_lua_context().get_lua_events_version();
+  if (events_version != lua_events_version) {
+    lua_events_version = events_version;
+    for (HotState& hot_state : hot_states) {
+      if ((hot_state.flags & (HotState::ON_DEMAND | HotState::AWAKE)) == HotState::ON_DEMAND) {
+        update_hot_flags(hot_state);
+      }
+    }
+  }
 
-    if (
-        !entity->is_being_removed() &&
-        entity->get_type() != EntityType::CAMERA  // The camera is updated after.
-    ) {
-      entity->update();
+  // Only dereference the entities that have something to update.
+  // The camera is updated after.
+  const auto is_update_wanted = [&](const HotState& hot_state) {
+
+    const uint16_t flags = hot_state.flags;
+    if ((flags & HotState::UPDATE_NEEDED) == 0 ||
+        (flags & (HotState::BEING_REMOVED | HotState::UPDATED_SEPARATELY)) != 0) {
+      return false;
     }
+
+    if ((flags & HotState::NEAR_CAMERA_ONLY) != 0 ||
+        (flags & (HotState::ON_DEMAND | HotState::AWAKE)) == HotState::ON_DEMAND) {
+      if (!hot_state.bounding_box.overlaps(near_camera)) {
+        return false;
+      }
+    }
+    return is_in_active_room(hot_state.bounding_box);
+  };
+
+  // First update the running movements, grouped by type.
+  collision_batching_active = collision_batching_enabled;
+  for (const HotState& hot_state : hot_states) {
+    if ((hot_state.flags & HotState::HAS_MOVEMENT) != 0 &&
+        is_update_wanted(hot_state) &&
+        MovementSystem::is_early_update_allowed(hot_state.entity->get_type())) {
+      movement_system.add(*hot_state.entity);
+    }
+  }
+  movement_system.update();
+
+  // In parallel mode, advance the due frames of sprites nobody observes
+  // on several threads. Their update() below then only finishes the job.
+  if (parallel_update_enabled) {
+    advance_sprite_frames(is_update_wanted);
   }
 
+  // Then update the dynamic entities.
+  // Entities created meanwhile are added at the end and updated too.
+  int num_updated = 1;  // The hero.
+  for (size_t i = 0; i < hot_states.size(); ++i) {
+
+    if (!is_update_wanted(hot_states[i])) {
+      continue;
+    }
+
+    Entity& entity = *hot_states[i].entity;
+    if (!entity.is_movement_updated_early()) {
+      entity.save_previous_xy();
+    }
+    entity.update();
+    ++num_updated;
+
+    // Old movements, sprites and states may have just been destroyed.
+    update_hot_flags(hot_states[i]);
+  }
+  movement_system.finish();
+  check_deferred_collisions_with_detectors();
+
   // Update the camera after everyone else.
+  camera->save_previous_xy();
   camera->update();
-  entities_to_draw.clear();  // Invalidate entities to draw.
-  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-    non_animated_regions[layer]->update();
-  }
+  FrameStats::get_current_frame().entities_updated += num_updated + 1;
 
   // Remove the entities that have to be removed now.
   remove_marked_entities();
+  destroy_removed_entities(0);
+
+  // Merge the quadtree cells emptied by the moves of this tick.
+  add_pending_entities_to_quadtree();
+  quadtree->rebalance();
+}
+
+/**
+ * \brief Inserts in the quadtree the entities added since its last use.
+ */
+void Entities::add_pending_entities_to_quadtree() const {
+
+  if (entities_to_add_to_quadtree.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<EntityPtr, Rectangle>> elements;
+  elements.reserve(entities_to_add_to_quadtree.size());
+  for (const EntityPtr& entity : entities_to_add_to_quadtree) {
+    elements.emplace_back(entity, entity->get_max_bounding_box());
+  }
+  entities_to_add_to_quadtree.clear();
+  quadtree->add_elements(elements);
 }
 
 /**
@@ -1157,6 +2047,8 @@ void Entities::update() {
  */
 void Entities::draw() {
 
+  PerfTrace::Scope trace_scope("entities-draw");
+
   const CameraPtr& camera = get_camera();
   if (camera == nullptr) {
     return;
@@ -1164,83 +2056,360 @@ void Entities::draw() {
 
   const SurfacePtr& camera_surface = camera->get_surface();
 
-  // Lazily build the list of entities to draw.
-  if (entities_to_draw.empty()) {
-
-    // Add entities in the camera,
-    // or nearby because of possible
-    // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
-    // TODO it would probably be better to detect entities with
-    // such events and make their is_drawn_at_its_position()
-    // method return false.
-    EntityVector entities_in_camera;
-    Rectangle around_camera(
-        Point(
-            camera->get_x() - camera->get_size().width,
-            camera->get_y() - camera->get_size().height
-        ),
-        camera->get_size() * 3
-    );
-    get_entities_in_rectangle_z_sorted(around_camera, entities_in_camera);
-
-    for (const EntityPtr& entity : entities_in_camera) {
-      int layer = entity->get_layer();
-      Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
-      entities_to_draw[layer].push_back(entity);
-    }
-
-    // Add entities displayed even when out of the camera.
-    for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-      for (const EntityPtr& entity : entities_drawn_not_at_their_position[layer]) {
-        entities_to_draw[layer].push_back(entity);
-      }
-
-      // Sort them and remove duplicates.
-      // Duplicate drawings are a problem for entities with semi-transparency.
-      // Using an std::set would be slower because duplicates are rare:
-      // there are not often a lot of dynamic entities displayed out of the camera.
-      std::sort(entities_to_draw[layer].begin(), entities_to_draw[layer].end(), DrawingOrderComparator());
-      entities_to_draw[layer].erase(
-            std::unique(entities_to_draw[layer].begin(), entities_to_draw[layer].end()),
-            entities_to_draw[layer].end()
-      );
-    }
+  // The lists of entities to draw cover the camera and one and a half
+  // screens around it, because of possible
+  // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
+  // They are maintained incrementally and only rebuilt when the camera
+  // moves more than half a screen away from where they were built.
+  const Size& camera_size = camera->get_size();
+  const Rectangle inner_region(
+      draw_region.get_x() + camera_size.width,
+      draw_region.get_y() + camera_size.height,
+      draw_region.get_width() - 2 * camera_size.width,
+      draw_region.get_height() - 2 * camera_size.height
+  );
+  if (draw_region.is_flat() ||
+      draw_region.get_size() != camera_size * 4 ||
+      !inner_region.contains(Rectangle(camera->get_top_left_xy(), camera_size))) {
+    rebuild_entities_to_draw();
+  }
+  else {
+    sort_entities_to_draw();
+  }
 
+  if (occlusion_culling_enabled && occluded_squares_outdated) {
+    update_occluded_squares();
   }
 
+  drawing_entities = true;
+  int num_drawn = 0;
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
 
     // Draw the animated tiles and the tiles that overlap them:
     // in other words, draw all regions containing animated tiles
     // (and maybe more, but we don't care because non-animated tiles
     // will be drawn later).
-    for (unsigned int i = 0; i < tiles_in_animated_regions[layer].size(); ++i) {
-      Tile& tile = *tiles_in_animated_regions[layer][i];
-      if (tile.overlaps(*camera) || !tile.is_drawn_at_its_position()) {
-        tile.draw(*camera);
-      }
-    }
+    animated_regions[layer]->draw_on_map();
 
     // Draw the non-animated tiles (with transparent rectangles on the regions of animated tiles
     // since they are already drawn).
     non_animated_regions[layer]->draw_on_map();
 
     // Draw dynamic entities, ordered by their data structure.
-    for (const EntityPtr& entity: entities_to_draw[layer]) {
-      if (!entity->is_being_removed() &&
-          entity->is_enabled() &&
-          entity->is_visible()) {
-        entity->draw(*camera);
-      }
-    }
+    num_drawn += draw_entities(layer, *camera);
   }
+  drawing_entities = false;
+  FrameStats::get_current_frame().entities_drawn += num_drawn;
 
   if (EntityTree::debug_quadtrees) {
     // Draw the quadtree structure for debugging.
+    add_pending_entities_to_quadtree();
     quadtree->draw(camera_surface, -camera->get_top_left_xy());
   }
 }
 
+/**
+ * \brief Draws the dynamic entities of a layer.
+ *
+ * Entities that only draw sprites are drawn before others when the result
+ * is the same, to group entities that have the same shader and blend mode.
+ * Other entities may run Lua code when they are drawn:
+ * they are drawn in their exact order.
+ * Entities that only draw sprites are not drawn at all if opaque tiles of
+ * higher layers hide them.
+ *
+ * \param layer The layer to draw.
+ * \param camera The camera where to draw.
+ * \return The number of entities drawn.
+ */
+int Entities::draw_entities(int layer, Camera& camera) {
+
+  int num_drawn = 0;
+  draw_items.clear();
+  for (const EntityPtr& entity: entities_to_draw[layer].entities) {
+    if (entity->is_being_removed() ||
+        !entity->is_enabled() ||
+        !entity->is_visible()) {
+      continue;
+    }
+
+    DrawItem item;
+    item.entity = entity.get();
+    item.drawn = false;
+    if (entity->get_sprites_draw_state(item.box, item.shader, item.blend_mode)) {
+      if (is_occluded(layer, item.box)) {
+        continue;
+      }
+      draw_items.push_back(item);
+      continue;
+    }
+
+    // The Lua code of this entity may change the next ones:
+    // draw the previous ones first and look at the next ones afterwards.
+    num_drawn += draw_grouped_items(camera);
+    entity->draw(camera);
+    ++num_drawn;
+  }
+  num_drawn += draw_grouped_items(camera);
+  return num_drawn;
+}
+
+/**
+ * \brief Draws the entities of draw_items, grouping those that have the
+ * same shader and blend mode.
+ *
+ * After an entity is drawn, the next entities with the same shader and
+ * blend mode are drawn right away if they do not overlap the entities
+ * they are now drawn before.
+ *
+ * \param camera The camera where to draw.
+ * \return The number of entities drawn.
+ */
+int Entities::draw_grouped_items(Camera& camera) {
+
+  const size_t num_items = draw_items.size();
+  for (size_t i = 0; i < num_items; ++i) {
+    DrawItem& item = draw_items[i];
+    if (item.drawn) {
+      continue;
+    }
+    item.entity->draw(camera);
+    item.drawn = true;
+
+    skipped_draw_items.clear();
+    const size_t end = std::min(num_items, i + 1 + max_draw_lookahead);
+    for (size_t j = i + 1; j < end; ++j) {
+      DrawItem& next = draw_items[j];
+      if (next.drawn) {
+        continue;
+      }
+      bool grouped = next.shader == item.shader && next.blend_mode == item.blend_mode;
+      if (grouped) {
+        for (size_t skipped : skipped_draw_items) {
+          if (draw_items[skipped].box.overlaps(next.box)) {
+            grouped = false;
+            break;
+          }
+        }
+      }
+      if (grouped) {
+        next.entity->draw(camera);
+        next.drawn = true;
+      }
+      else {
+        skipped_draw_items.push_back(j);
+      }
+    }
+  }
+  draw_items.clear();
+  return static_cast<int>(num_items);
+}
+
+/**
+ * \brief Computes for each layer the 8x8 squares hidden by opaque
+ * non-animated tiles of higher layers.
+ */
+void Entities::update_occluded_squares() {
+
+  occluded_squares_outdated = false;
+  std::vector<bool> covered;
+  for (int layer = map.get_max_layer(); layer >= map.get_min_layer(); --layer) {
+    occluded_squares[layer] = covered;
+    non_animated_regions[layer]->set_occluded_squares(covered);
+
+    const std::vector<bool>& opaque_squares = non_animated_regions[layer]->get_opaque_squares();
+    if (std::find(opaque_squares.begin(), opaque_squares.end(), true) == opaque_squares.end()) {
+      continue;
+    }
+    if (covered.empty()) {
+      covered = opaque_squares;
+      continue;
+    }
+    for (size_t i = 0; i < covered.size(); ++i) {
+      if (opaque_squares[i]) {
+        covered[i] = true;
+      }
+    }
+  }
+}
+
+/**
+ * \brief Returns whether a rectangle of a layer is hidden by opaque tiles
+ * of higher layers.
+ *
+ * Rectangles not entirely in the map are never hidden.
+ *
+ * \param layer The layer of the rectangle.
+ * \param box A rectangle in map coordinates.
+ * \return \c true if all 8x8 squares overlapping the rectangle are hidden.
+ */
+bool Entities::is_occluded(int layer, const Rectangle& box) const {
+
+  const std::vector<bool>& squares = occluded_squares.at(layer);
+  if (squares.empty() ||
+      box.is_flat() ||
+      !Rectangle(map.get_size()).contains(box)) {
+    return false;
+  }
+
+  const int map_width8 = map.get_width8();
+  const int x8_end = (box.get_x() + box.get_width() - 1) / 8;
+  const int y8_end = (box.get_y() + box.get_height() - 1) / 8;
+  for (int y8 = box.get_y() / 8; y8 <= y8_end; ++y8) {
+    for (int x8 = box.get_x() / 8; x8 <= x8_end; ++x8) {
+      if (!squares[y8 * map_width8 + x8]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Returns whether an entity belongs to the region of entities to draw.
+ * \param entity An entity.
+ * \param bounding_box Its maximum bounding box.
+ * \return \c true if the entity should be in the list of entities to draw.
+ */
+bool Entities::is_in_draw_region(const Entity& entity, const Rectangle& bounding_box) const {
+
+  return !draw_region.is_flat() &&
+      !entity.is_being_removed() &&
+      (bounding_box.overlaps(draw_region) || !entity.is_drawn_at_its_position());
+}
+
+/**
+ * \brief Adds an entity to the list of entities to draw of its layer
+ * if it belongs to the draw region.
+ * \param entity The entity to add.
+ */
+void Entities::add_entity_to_draw(const EntityPtr& entity) {
+
+  if (entity->is_in_draw_list() ||
+      !is_in_draw_region(*entity, entity->get_max_bounding_box())) {
+    return;
+  }
+
+  if (drawing_entities) {
+    // The lists are being iterated: rebuild them at the next frame.
+    draw_region = Rectangle();
+    return;
+  }
+
+  EntitiesToDraw& layer_entities = entities_to_draw[entity->get_layer()];
+  layer_entities.entities.push_back(entity);
+  layer_entities.sorted = false;
+  entity->set_in_draw_list(true);
+}
+
+/**
+ * \brief Removes an entity from the list of entities to draw of a layer.
+ *
+ * The order of other entities is preserved.
+ *
+ * \param entity The entity to remove.
+ * \param layer The layer where it is drawn.
+ */
+void Entities::remove_entity_to_draw(Entity& entity, int layer) {
+
+  if (drawing_entities) {
+    // The lists are being iterated: rebuild them at the next frame.
+    draw_region = Rectangle();
+    return;
+  }
+
+  EntityVector& layer_entities = entities_to_draw[layer].entities;
+  const auto& it = std::find_if(layer_entities.begin(), layer_entities.end(),
+      [&entity](const EntityPtr& element) {
+        return element.get() == &entity;
+  });
+  if (it != layer_entities.end()) {
+    layer_entities.erase(it);
+  }
+  entity.set_in_draw_list(false);
+}
+
+/**
+ * \brief Builds the lists of entities to draw around the camera.
+ */
+void Entities::rebuild_entities_to_draw() {
+
+  for (auto& kvp : entities_to_draw) {
+    for (const EntityPtr& entity : kvp.second.entities) {
+      entity->set_in_draw_list(false);
+    }
+    kvp.second.entities.clear();
+  }
+
+  const Size& camera_size = camera->get_size();
+  draw_region = Rectangle(
+      camera->get_x() - camera_size.width * 3 / 2,
+      camera->get_y() - camera_size.height * 3 / 2,
+      camera_size.width * 4,
+      camera_size.height * 4
+  );
+
+  EntityVector entities_in_region;
+  get_entities_in_rectangle(draw_region, entities_in_region);
+  for (const EntityPtr& entity : entities_in_region) {
+    add_entity_to_draw(entity);
+  }
+
+  // Add entities displayed even when out of the camera.
+  for (const auto& kvp : entities_drawn_not_at_their_position) {
+    for (const EntityPtr& entity : kvp.second) {
+      add_entity_to_draw(entity);
+    }
+  }
+
+  sort_entities_to_draw();
+}
+
+/**
+ * \brief Sorts the lists of entities to draw whose order may have changed.
+ *
+ * Between two frames, only a few entities are added or moved,
+ * so an insertion sort is used: it is linear on almost sorted lists.
+ */
+void Entities::sort_entities_to_draw() {
+
+  const DrawingOrderComparator comparator;
+  for (auto& kvp : entities_to_draw) {
+    EntitiesToDraw& layer_entities = kvp.second;
+    if (layer_entities.sorted) {
+      continue;
+    }
+
+    EntityVector& entities = layer_entities.entities;
+    for (size_t i = 1; i < entities.size(); ++i) {
+      if (!comparator(entities[i], entities[i - 1])) {
+        continue;
+      }
+      EntityPtr entity = std::move(entities[i]);
+      size_t j = i;
+      do {
+        entities[j] = std::move(entities[j - 1]);
+        --j;
+      } while (j > 0 && comparator(entity, entities[j - 1]));
+      entities[j] = std::move(entity);
+    }
+    layer_entities.sorted = true;
+  }
+}
+
+/**
+ * \brief This function should be called when the drawing order of an
+ * entity may have changed: Z order or drawing in Y order.
+ * \param entity The entity modified.
+ */
+void Entities::notify_entity_draw_order_changed(Entity& entity) {
+
+  FrameDamage::notify();
+  if (entity.is_in_draw_list()) {
+    entities_to_draw[entity.get_layer()].sorted = false;
+  }
+}
+
 /**
  * \brief Changes the layer of an entity.
  * \param entity An entity.
@@ -1252,6 +2421,7 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
 
   if (layer != old_layer) {
 
+    FrameDamage::notify();
     const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
 
     if (!map.is_valid_layer(layer)) {
@@ -1270,16 +2440,28 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
     z_orders.at(layer).add(shared_entity);
 
     // Update the list of entities by type and layer.
-    const EntityType type = entity.get_type();
-    const auto& it = entities_by_type.find(type);
-    if (it != entities_by_type.end()) {
-      ByLayer<EntitySet>& sets = it->second;
-      sets[old_layer].erase(shared_entity);
-      sets[layer].insert(shared_entity);
+    remove_from_type_list(shared_entity, old_layer);
+    add_to_type_list(shared_entity, layer);
+    const bool in_draw_list = entity.is_in_draw_list();
+    if (in_draw_list) {
+      remove_entity_to_draw(entity, old_layer);
     }
 
     // Update the entity after the lists because this function might be called again.
     entity.set_layer(layer);
+    if (in_draw_list) {
+      add_entity_to_draw(shared_entity);
+    }
+    walkability_grid.notify_ground_modifier_changed(entity);
+    ground_observers.notify_entity_changed(entity);
+    if (entity.get_type() == EntityType::STREAM && stream_field_enabled) {
+      notify_stream_changed(static_cast<Stream&>(entity));
+    }
+
+    const int index = entity.get_hot_state_index();
+    if (index >= 0) {
+      hot_states[index].layer = entity.get_layer();
+    }
   }
 }
 
@@ -1290,12 +2472,501 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
  */
 void Entities::notify_entity_bounding_box_changed(Entity& entity) {
 
+  FrameDamage::notify();
+
   // Update the quadtree.
 
   // Note that if the entity is not in the quadtree
   // (i.e. not managed by MapEntities) this does nothing.
   EntityPtr shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
-  quadtree->move(shared_entity, shared_entity->get_max_bounding_box());
+  const Rectangle max_bounding_box = shared_entity->get_max_bounding_box();
+  add_pending_entities_to_quadtree();
+  if (!quadtree->move(shared_entity, max_bounding_box)) {
+    // Not on this map.
+    return;
+  }
+  walkability_grid.notify_ground_modifier_changed(entity);
+  ground_observers.notify_entity_changed(entity);
+  if (entity.get_type() == EntityType::SEPARATOR) {
+    separator_regions_dirty = true;
+  }
+  else if (entity.get_type() == EntityType::STREAM && stream_field_enabled) {
+    notify_stream_changed(static_cast<Stream&>(entity));
+  }
+
+  // Update the entities to draw.
+  if (!entity.is_in_draw_list()) {
+    add_entity_to_draw(shared_entity);
+  }
+  else if (!is_in_draw_region(entity, max_bounding_box)) {
+    remove_entity_to_draw(entity, entity.get_layer());
+  }
+  else if (entity.is_drawn_in_y_order()) {
+    entities_to_draw[entity.get_layer()].sorted = false;
+  }
+
+  // Sprites may have been added or removed.
+  const int index = entity.get_hot_state_index();
+  if (index >= 0) {
+    HotState& hot_state = hot_states[index];
+    hot_state.bounding_box = max_bounding_box;
+    update_hot_flags(hot_state);
+  }
+}
+
+/**
+ * \brief Returns whether collision checks with detectors are batched.
+ * \return \c true if entities moved during an update are checked against
+ * detectors in a single broad phase at the end of the update.
+ */
+bool Entities::is_collision_batching_enabled() const {
+  return collision_batching_enabled;
+}
+
+/**
+ * \brief Sets whether collision checks with detectors are batched.
+ *
+ * When enabled, entities that move while dynamic entities are being updated
+ * don't look for detectors immediately. Instead, all of them are checked
+ * once at the end of the update, against detectors found by a single
+ * sort-and-sweep pass.
+ * Only the last position of each entity during the cycle is then checked.
+ *
+ * \param collision_batching_enabled \c true to batch collision checks.
+ */
+void Entities::set_collision_batching_enabled(bool collision_batching_enabled) {
+  this->collision_batching_enabled = collision_batching_enabled;
+}
+
+/**
+ * \brief Returns whether non-blocking streams are baked in a stream field.
+ * \return \c true if the stream field is enabled.
+ */
+bool Entities::is_stream_field_enabled() const {
+  return stream_field_enabled;
+}
+
+/**
+ * \brief Sets whether non-blocking streams are baked in a stream field.
+ *
+ * When enabled, non-blocking streams aligned on the 8x8 grid are no longer
+ * detectors. Instead, entities look for a stream at their ground point in
+ * the field when they check their collisions with detectors, and an entity
+ * moved by a stream of the field keeps its stream action when it goes on
+ * another stream of the field with the same properties.
+ *
+ * \param stream_field_enabled \c true to bake streams.
+ */
+void Entities::set_stream_field_enabled(bool stream_field_enabled) {
+
+  if (stream_field_enabled == this->stream_field_enabled) {
+    return;
+  }
+
+  this->stream_field_enabled = stream_field_enabled;
+  stream_field.clear();
+  for (const std::shared_ptr<Stream>& stream : get_entities_by_type<Stream>()) {
+    notify_stream_changed(*stream);
+  }
+}
+
+/**
+ * \brief Returns the streams baked at 8x8 granularity.
+ * \return The stream field, empty if disabled.
+ */
+const StreamField& Entities::get_stream_field() const {
+  return stream_field;
+}
+
+/**
+ * \brief Adds, moves or removes a stream in the stream field.
+ *
+ * This function should be called when the position, the size, the layer
+ * or the blocking property of a stream changes.
+ *
+ * \param stream A stream of the map.
+ */
+void Entities::notify_stream_changed(Stream& stream) {
+
+  stream_field.remove_stream(stream);
+  const bool in_field = stream_field_enabled &&
+      !stream.is_being_removed() &&
+      stream.get_allow_movement() &&
+      stream_field.add_stream(stream);
+  stream.set_in_field(in_field);
+}
+
+/**
+ * \brief Notifies an entity of the stream of the field at its ground point.
+ *
+ * This replaces collision checks with streams baked in the field.
+ *
+ * \param entity The entity to check.
+ */
+void Entities::check_stream_field(Entity& entity) {
+
+  if (stream_field.is_empty() ||
+      entity.get_type() == EntityType::STREAM) {
+    return;
+  }
+
+  Stream* stream = stream_field.get_stream(entity.get_layer(), entity.get_ground_point());
+  if (stream != nullptr &&
+      stream->is_enabled() &&
+      !stream->is_suspended() &&
+      !stream->is_being_removed()) {
+    stream->notify_collision(entity, CollisionMode::COLLISION_OVERLAPPING);
+  }
+}
+
+/**
+ * \brief Returns whether entities are partly updated on several threads.
+ * \return \c true if the parallel update phase is enabled.
+ */
+bool Entities::is_parallel_update_enabled() const {
+  return parallel_update_enabled;
+}
+
+/**
+ * \brief Sets whether entities are partly updated on several threads.
+ *
+ * When enabled, the sprite frames that are due are advanced by the
+ * threads of the PixelFilterExecutor pool before entities are updated,
+ * for sprites whose frame changes are not observed from Lua.
+ * Everything else, including movements, collisions, timers and events,
+ * is still updated by the main thread.
+ *
+ * \param parallel_update_enabled \c true to enable the parallel phase.
+ */
+void Entities::set_parallel_update_enabled(bool parallel_update_enabled) {
+
+  this->parallel_update_enabled = parallel_update_enabled;
+  if (!parallel_update_enabled) {
+    sprites_to_advance = std::vector<Sprite*>();
+  }
+}
+
+/**
+ * \brief Returns whether drawings hidden by opaque tiles are skipped.
+ * \return \c true if occlusion culling is enabled.
+ */
+bool Entities::is_occlusion_culling_enabled() const {
+  return occlusion_culling_enabled;
+}
+
+/**
+ * \brief Sets whether drawings hidden by opaque tiles are skipped.
+ *
+ * When enabled, the 8x8 squares fully covered by opaque non-animated tiles
+ * are computed from the pixels of the tilesets.
+ * Then cells of non-animated tiles and entities that only draw sprites are
+ * not drawn if opaque non-animated tiles of higher layers hide them.
+ * Tiles drawn with a blend mode other than alpha blending or with partial
+ * opacity never hide anything, and entities with their own drawing code
+ * are always drawn.
+ *
+ * \param occlusion_culling_enabled \c true to skip hidden drawings.
+ */
+void Entities::set_occlusion_culling_enabled(bool occlusion_culling_enabled) {
+
+  if (occlusion_culling_enabled == this->occlusion_culling_enabled) {
+    return;
+  }
+
+  this->occlusion_culling_enabled = occlusion_culling_enabled;
+  occluded_squares_outdated = true;
+  if (!occlusion_culling_enabled) {
+    for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+      occluded_squares[layer].clear();
+      non_animated_regions[layer]->set_occluded_squares(occluded_squares[layer]);
+    }
+  }
+}
+
+/**
+ * \brief Advances the due frames of sprites of entities on several threads.
+ *
+ * Sprites are selected by the main thread, then split into chunks
+ * for the worker threads. Each sprite is advanced at most once,
+ * even if several entities share it.
+ *
+ * \param is_update_wanted Tells whether an entity is updated this cycle.
+ */
+void Entities::advance_sprite_frames(
+    const std::function<bool(const HotState&)>& is_update_wanted) {
+
+  const uint32_t now = System::now();
+  sprites_to_advance.clear();
+  for (const HotState& hot_state : hot_states) {
+    if (!is_update_wanted(hot_state)) {
+      continue;
+    }
+    for (const Entity::NamedSprite& named_sprite : hot_state.entity->get_named_sprites()) {
+      Sprite& sprite = *named_sprite.sprite;
+      if (!named_sprite.removed &&
+          sprite.is_frame_advance_native(now) &&
+          !hot_state.entity->is_sprite_update_deferrable(sprite, now)) {
+        sprites_to_advance.push_back(&sprite);
+      }
+    }
+  }
+
+  if (sprites_to_advance.empty()) {
+    return;
+  }
+  std::sort(sprites_to_advance.begin(), sprites_to_advance.end());
+  sprites_to_advance.erase(
+      std::unique(sprites_to_advance.begin(), sprites_to_advance.end()),
+      sprites_to_advance.end()
+  );
+
+  PixelFilterExecutor::run(
+      static_cast<int>(sprites_to_advance.size()),
+      min_sprites_per_job_band,
+      [&](int first_sprite, int num_sprites) {
+    for (int i = first_sprite; i < first_sprite + num_sprites; ++i) {
+      sprites_to_advance[i]->advance_frames(now);
+    }
+  });
+}
+
+/**
+ * \brief Returns which entities are updated when the map has rooms.
+ * \return The room activation mode.
+ */
+Entities::RoomActivation Entities::get_room_activation() const {
+  return room_activation;
+}
+
+/**
+ * \brief Sets which entities are updated when the map has rooms.
+ *
+ * Rooms are the regions delimited by separators.
+ * With RoomActivation::ROOM, only entities overlapping the rooms
+ * that the camera overlaps are updated: others are frozen, they don't
+ * move and don't check collisions.
+ * RoomActivation::ADJACENT_ROOMS also keeps rooms next to these ones
+ * active.
+ * The hero and the camera are always updated.
+ *
+ * \param room_activation The room activation mode.
+ */
+void Entities::set_room_activation(RoomActivation room_activation) {
+
+  this->room_activation = room_activation;
+  update_active_rooms();
+}
+
+/**
+ * \brief Returns whether an entity is in a room whose entities are updated.
+ * \param bounding_box Bounding box of the entity.
+ * \return \c true if the entity overlaps an active room, or if the room
+ * activation mode is RoomActivation::NONE.
+ */
+bool Entities::is_in_active_room(const Rectangle& bounding_box) const {
+
+  if (room_activation == RoomActivation::NONE) {
+    return true;
+  }
+
+  for (const Rectangle& room : active_rooms) {
+    if (bounding_box.overlaps(room)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Determines the rooms whose entities are updated during this cycle.
+ */
+void Entities::update_active_rooms() {
+
+  active_rooms.clear();
+  if (room_activation == RoomActivation::NONE || camera == nullptr) {
+    return;
+  }
+
+  const SeparatorRegions& separator_regions = get_separator_regions();
+  std::vector<int> room_indices;
+  separator_regions.get_region_indices_in(camera->get_bounding_box(), room_indices);
+
+  if (room_activation == RoomActivation::ADJACENT_ROOMS) {
+    std::vector<int> adjacent_indices;
+    std::vector<int> neighbors;
+    for (int index : room_indices) {
+      Rectangle around = separator_regions.get_region(index);
+      around.add_xy(-1, -1);
+      around.add_width(2);
+      around.add_height(2);
+      separator_regions.get_region_indices_in(around, neighbors);
+      adjacent_indices.insert(adjacent_indices.end(), neighbors.begin(), neighbors.end());
+    }
+    std::sort(adjacent_indices.begin(), adjacent_indices.end());
+    adjacent_indices.erase(
+        std::unique(adjacent_indices.begin(), adjacent_indices.end()),
+        adjacent_indices.end()
+    );
+    room_indices = std::move(adjacent_indices);
+  }
+
+  for (int index : room_indices) {
+    active_rooms.push_back(separator_regions.get_region(index));
+  }
+}
+
+/**
+ * \brief Defers the collision check of an entity with detectors if possible.
+ *
+ * This function is called by entities when they need to check their
+ * collisions with detectors.
+ *
+ * \param entity An entity that needs to check its collisions with detectors.
+ * \return \c true if the check is deferred to the broad phase,
+ * \c false if the caller should do the check now.
+ */
+bool Entities::defer_collision_check_with_detectors(Entity& entity) {
+
+  if (!collision_batching_active) {
+    return false;
+  }
+
+  entities_to_check.push_back(
+      std::static_pointer_cast<Entity>(entity.shared_from_this())
+  );
+  return true;
+}
+
+/**
+ * \brief Checks the collisions deferred during the update of entities.
+ *
+ * Candidate pairs are found with a sort-and-sweep pass over the extended
+ * bounding boxes of entities to check and the boxes of detectors.
+ * Entities are then checked in Z order, and for each of them detectors are
+ * notified in Z order like Map::check_collision_with_detectors() does,
+ * so that Lua callbacks are called in a deterministic order.
+ */
+void Entities::check_deferred_collisions_with_detectors() {
+
+  collision_batching_active = false;
+  if (entities_to_check.empty()) {
+    return;
+  }
+
+  EntityVector entities;
+  entities.swap(entities_to_check);
+
+  // Sort entities to check and remove duplicates.
+  const EntityZOrderComparator z_order;
+  std::sort(entities.begin(), entities.end(), [&z_order](const EntityPtr& first, const EntityPtr& second) {
+    if (z_order(first, second)) {
+      return true;
+    }
+    if (z_order(second, first)) {
+      return false;
+    }
+    return first.get() < second.get();
+  });
+  entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+
+  if (map.is_suspended()) {
+    return;
+  }
+
+  // Gather the boxes to sweep and the detectors in a single query.
+  struct SweepBox {
+    Rectangle box;
+    size_t index;
+    bool is_entity;
+  };
+  std::vector<SweepBox> boxes;
+  boxes.reserve(entities.size());
+  Rectangle region;
+  for (size_t i = 0; i < entities.size(); ++i) {
+    const Entity& entity = *entities[i];
+    if (entity.is_being_removed() || !entity.is_enabled()) {
+      continue;
+    }
+    // Extend the box because some collision tests work without overlapping.
+    const Rectangle& box = entity.get_extended_bounding_box(8);
+    region = boxes.empty() ? box : (region | box);
+    boxes.push_back({ box, i, true });
+  }
+
+  // Find detectors from the hot states, without dereferencing other entities.
+  EntityVector detectors;
+  if (!boxes.empty()) {
+    for (const HotState& hot_state : hot_states) {
+      if ((hot_state.flags & HotState::DETECTOR) != 0 &&
+          (hot_state.flags & HotState::BEING_REMOVED) == 0 &&
+          hot_state.bounding_box.overlaps(region)) {
+        detectors.push_back(std::static_pointer_cast<Entity>(hot_state.entity->shared_from_this()));
+      }
+    }
+  }
+  std::sort(detectors.begin(), detectors.end(), z_order);
+  for (size_t i = 0; i < detectors.size(); ++i) {
+    boxes.push_back({ detectors[i]->get_max_bounding_box(), i, false });
+  }
+
+  // Sweep along the X axis.
+  std::sort(boxes.begin(), boxes.end(), [](const SweepBox& first, const SweepBox& second) {
+    return first.box.get_x() < second.box.get_x();
+  });
+  std::vector<std::pair<size_t, size_t>> pairs;
+  std::vector<const SweepBox*> active_entities;
+  std::vector<const SweepBox*> active_detectors;
+  for (const SweepBox& sweep_box : boxes) {
+    std::vector<const SweepBox*>& others = sweep_box.is_entity ? active_detectors : active_entities;
+    const int left = sweep_box.box.get_x();
+    for (size_t i = 0; i < others.size(); ) {
+      const SweepBox& other = *others[i];
+      if (other.box.get_x() + other.box.get_width() <= left) {
+        // This one is over for the rest of the sweep.
+        others[i] = others.back();
+        others.pop_back();
+        continue;
+      }
+      if (other.box.overlaps(sweep_box.box)) {
+        if (sweep_box.is_entity) {
+          pairs.emplace_back(sweep_box.index, other.index);
+        }
+        else {
+          pairs.emplace_back(other.index, sweep_box.index);
+        }
+      }
+      ++i;
+    }
+    (sweep_box.is_entity ? active_entities : active_detectors).push_back(&sweep_box);
+  }
+
+  // Detectors are indexed in Z order: sorting indexes is enough.
+  std::sort(pairs.begin(), pairs.end());
+
+  // Notify detectors.
+  size_t pair_index = 0;
+  for (size_t i = 0; i < entities.size(); ++i) {
+    Entity& entity = *entities[i];
+    for (; pair_index < pairs.size() && pairs[pair_index].first == i; ++pair_index) {
+      if (entity.is_being_removed()) {
+        continue;
+      }
+      Entity& detector = *detectors[pairs[pair_index].second];
+      if (detector.can_detect(entity) &&
+          detector.is_enabled() &&
+          !detector.is_suspended() &&
+          !detector.is_being_removed()) {
+        detector.check_collision(entity);
+      }
+    }
+
+    if (!entity.is_being_removed() && entity.is_enabled()) {
+      check_stream_field(entity);
+    }
+    if (!entity.is_being_removed() && entity.is_enabled()) {
+      entity.check_sprite_collisions_with_detectors();
+    }
+  }
 }
 
 /**
@@ -1306,25 +2977,26 @@ void Entities::notify_entity_bounding_box_changed(Entity& entity) {
  */
 bool Entities::overlaps_raised_blocks(int layer, const Rectangle& rectangle) {
 
-  EntityVector entities_nearby;
-  get_entities_in_rectangle_z_sorted(rectangle, entities_nearby);
-  for (const EntityPtr& entity : entities_nearby) {
+  if (!walkability_grid.may_overlap_raised_blocks(layer, rectangle)) {
+    return false;
+  }
+
+  const bool found = !visit_entities_in_rectangle(rectangle, [layer](const EntityPtr& entity) {
 
     if (entity->get_type() != EntityType::CRYSTAL_BLOCK) {
-      continue;
+      return true;
     }
 
     if (entity->get_layer() != layer) {
-      continue;
-    }
-
-    const CrystalBlock& crystal_block = static_cast<CrystalBlock&>(*entity);
-    if (crystal_block.is_raised()) {
       return true;
     }
-  }
 
-  return false;
+    const CrystalBlock& crystal_block = static_cast<const CrystalBlock&>(*entity);
+    // Stop as soon as a raised block is found.
+    return !crystal_block.is_raised();
+  });
+
+  return found;
 }
 
 /**
@@ -19,6 +19,7 @@
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Geometry.h"
+#include "solarus/core/HotCounters.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/System.h"
@@ -28,6 +29,7 @@
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/entities/EntityState.h"
+#include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/entities/Npc.h"
 #include "solarus/entities/Separator.h"
@@ -35,18 +37,29 @@
 #include "solarus/entities/StreamAction.h"
 #include "solarus/entities/Switch.h"
 #include "solarus/entities/Tileset.h"
+#include "solarus/entities/WalkabilityGrid.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/SpriteAnimationSet.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iterator>
 #include <list>
 #include <utility>
 
 namespace Solarus {
 
+const std::string EnumInfoTraits<Entity::UpdatePolicy>::pretty_name = "update policy";
+
+const EnumInfo<Entity::UpdatePolicy>::names_type EnumInfoTraits<Entity::UpdatePolicy>::names = {
+  { Entity::UpdatePolicy::ALWAYS, "always" },
+  { Entity::UpdatePolicy::NEAR_CAMERA, "near_camera" },
+  { Entity::UpdatePolicy::ON_DEMAND, "on_demand" },
+};
+
 /**
  * \brief Creates an entity, specifying its position, its name and its direction.
  * \param name Name identifying the entity on the map or an empty string.
@@ -66,6 +79,9 @@ Entity::Entity(
   map(nullptr),
   layer(layer),
   z(0),
+  hot_state_index(-1),
+  by_type_index(-1),
+  in_draw_list(false),
   bounding_box(xy, size),
   ground_below(Ground::EMPTY),
   origin(0, 0),
@@ -80,9 +96,12 @@ Entity::Entity(
   draw_override(),
   movement(nullptr),
   movement_notifications_enabled(true),
+  movement_updated_early(nullptr),
   facing_entity(nullptr),
   collision_modes(CollisionMode::COLLISION_NONE),
   layer_independent_collisions(false),
+  collision_category(0),
+  collision_mask(0),
   weight(-1),
   stream_action(nullptr),
   initialized(false),
@@ -91,7 +110,14 @@ Entity::Entity(
   suspended(false),
   when_suspended(0),
   optimization_distance(default_optimization_distance),
-  optimization_distance2(default_optimization_distance * default_optimization_distance) {
+  optimization_distance2(default_optimization_distance * default_optimization_distance),
+  update_policy(UpdatePolicy::ALWAYS),
+  previous_xy(xy),
+  previous_xy_date(0),
+  interpolated(true),
+  ground_obstacles(0),
+  ground_obstacles_known(false),
+  memory_tracker(MemoryUsage::Category::ENTITIES, sizeof(Entity)) {
 
   Debug::check_assertion(size.width >= 0 && size.height >= 0,
       "Invalid entity size: width and height must be positive");
@@ -177,24 +203,14 @@ Ground Entity::get_modified_ground() const {
  */
 void Entity::update_ground_observers() {
 
-  // Update overlapping entities that are sensible to their ground.
-  const Rectangle& box = get_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
-  get_entities().get_entities_in_rectangle_z_sorted(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
-
-    if (!entity_nearby->is_ground_observer()) {
-      // The entity does not care about the ground below it.
-      continue;
-    }
+  get_entities().get_walkability_grid().notify_ground_modifier_changed(*this);
 
-    // Update the ground of observers that overlap or were just overlapping this one.
-    if (entity_nearby->get_layer() == get_layer() &&
-        (overlaps(entity_nearby->get_ground_point()) || overlaps(*entity_nearby))
-        // FIXME this is not precise and does not work for entities that disappear.
-    ) {
-      entity_nearby->update_ground_below();
-    }
+  // Update entities sensible to their ground whose ground point
+  // entered or left the area covered by this entity.
+  std::vector<EntityPtr> observers;
+  get_entities().get_ground_observers().notify_modifier_changed(*this, observers);
+  for (const EntityPtr& observer: observers) {
+    observer->update_ground_below();
   }
 }
 
@@ -295,6 +311,12 @@ bool Entity::is_on_map() const {
  */
 void Entity::set_map(Map& map) {
 
+  if (this->map == nullptr) {
+    // First map: use the collision filter of the type.
+    collision_category = EntityTypeInfo::get_collision_category(get_type());
+    collision_mask = EntityTypeInfo::get_default_collision_mask(get_type());
+  }
+
   this->main_loop = &map.get_game().get_main_loop();
   this->map = &map;
   set_lua_context(&main_loop->get_lua_context());
@@ -570,6 +592,7 @@ void Entity::notify_being_removed() {
 
   get_lua_context()->entity_on_removed(*this);
   this->being_removed = true;
+  notify_hot_state_changed();
 
   // If this entity defines a ground, tell people that it is disappearing.
   if (is_on_map() &&
@@ -823,6 +846,46 @@ void Entity::set_top_left_xy(const Point& xy) {
   return get_movement()->get_displayed_xy();
 }
 
+/**
+ * \brief Remembers the current position before an update.
+ *
+ * This is called by Entities for interpolated drawing.
+ */
+void Entity::save_previous_xy() {
+  previous_xy = get_xy();
+  previous_xy_date = System::now();
+}
+
+/**
+ * \brief Returns how far from its current position this entity should be
+ * drawn in the frame being drawn.
+ *
+ * When the main loop draws between two updates, an entity that has just
+ * moved is drawn between its previous and current positions.
+ *
+ * \return The offset to add to the drawing position.
+ */
+Point Entity::get_interpolation_offset() const {
+
+  const float factor = System::get_interpolation_factor();
+  if (!interpolated ||
+      factor >= 1.0f ||
+      previous_xy_date + System::timestep != System::now()) {
+    // Not moved during the last update.
+    return Point();
+  }
+
+  const Point& delta = previous_xy - get_xy();
+  if (std::abs(delta.x) > max_interpolated_distance ||
+      std::abs(delta.y) > max_interpolated_distance) {
+    return Point();
+  }
+  return Point(
+      static_cast<int>(std::lround(delta.x * (1.0f - factor))),
+      static_cast<int>(std::lround(delta.y * (1.0f - factor)))
+  );
+}
+
 /**
  * \brief Returns the width of the entity.
  * \return the width of the entity
@@ -955,6 +1018,17 @@ void Entity::notify_bounding_box_changed() {
   }
 }
 
+/**
+ * \brief Notifies the map entities that a property stored in the hot state
+ * of this entity has just changed.
+ */
+void Entity::notify_hot_state_changed() {
+
+  if (is_on_map()) {
+    get_entities().notify_entity_hot_state_changed(*this);
+  }
+}
+
 /**
  * \brief Returns whether the entity's bounding box is aligned with the 8*8 grid of the map.
  * \return true if the entity's bounding box is aligned
@@ -1112,6 +1186,7 @@ const Entity* Entity::get_facing_entity() const {
 void Entity::set_facing_entity(Entity* facing_entity) {
 
   this->facing_entity = facing_entity;
+  notify_hot_state_changed();
   notify_facing_entity_changed(facing_entity);
 }
 
@@ -1404,7 +1479,7 @@ std::vector<SpritePtr> Entity::get_sprites() const {
  * \brief Returns all sprites of this entity and their names.
  * \return The sprites and their names.
  */
-std::vector<Entity::NamedSprite> Entity::get_named_sprites() const {
+const std::vector<Entity::NamedSprite>& Entity::get_named_sprites() const {
   return sprites;
 }
 
@@ -1424,6 +1499,7 @@ SpritePtr Entity::create_sprite(
     order = sprites.size();
   }
   SpritePtr sprite = std::make_shared<Sprite>(animation_set_id);
+  sprite->set_owner(this);
 
   NamedSprite named_sprite;
   named_sprite.name = sprite_name;
@@ -1498,7 +1574,12 @@ void Entity::clear_old_sprites() {
   ) {
     const NamedSprite& named_sprite = *it;
     if (named_sprite.removed) {
+      // The sprite may still be here under another entry or kept by Lua.
+      const SpritePtr sprite = named_sprite.sprite;
       it = sprites.erase(it);
+      if (sprite->get_owner() == this && get_sprite_order(*sprite) == -1) {
+        sprite->set_owner(nullptr);
+      }
     }
     else {
       ++it;
@@ -1609,6 +1690,7 @@ bool Entity::is_visible() const {
  */
 void Entity::set_visible(bool visible) {
   this->visible = visible;
+  notify_hot_state_changed();
 }
 
 /**
@@ -1650,7 +1732,14 @@ bool Entity::is_drawn_in_y_order() const {
  * as the hero.
  */
 void Entity::set_drawn_in_y_order(bool drawn_in_y_order) {
+
+  if (drawn_in_y_order == this->drawn_in_y_order) {
+    return;
+  }
   this->drawn_in_y_order = drawn_in_y_order;
+  if (is_on_map()) {
+    get_entities().notify_entity_draw_order_changed(*this);
+  }
 }
 
 /**
@@ -1690,6 +1779,7 @@ void Entity::set_movement(const std::shared_ptr<Movement>& movement) {
         movement->set_suspended(is_enabled() && !movement->get_ignore_suspend());
       }
     }
+    notify_hot_state_changed();
     notify_movement_started();
   }
 }
@@ -1708,9 +1798,40 @@ void Entity::clear_movement() {
     movement->set_lua_notifications_enabled(false);  // Stop future Lua callbacks.
     old_movements.push_back(movement);               // Destroy it later.
     movement = nullptr;
+    notify_hot_state_changed();
   }
 }
 
+/**
+ * \brief Updates the movement of this entity before update().
+ *
+ * This is called by the MovementSystem of the map. The next call to
+ * update() does not update this movement again.
+ * The position before the move is saved to draw interpolated frames.
+ */
+void Entity::update_movement_early() {
+
+  save_previous_xy();
+  movement_updated_early = movement.get();
+  movement->update();
+}
+
+/**
+ * \brief Returns whether the movement was already updated at this cycle
+ * by update_movement_early().
+ * \return \c true if update() will not update the movement.
+ */
+bool Entity::is_movement_updated_early() const {
+  return movement_updated_early != nullptr;
+}
+
+/**
+ * \brief Forgets that the movement was updated early at this cycle.
+ */
+void Entity::clear_movement_updated_early() {
+  movement_updated_early = nullptr;
+}
+
 /**
  * \brief Destroys the old movements of this entity.
  */
@@ -1779,6 +1900,7 @@ void Entity::start_stream_action(
 ) {
   stop_stream_action();
   this->stream_action = std::move(stream_action);
+  notify_hot_state_changed();
 }
 
 /**
@@ -1792,6 +1914,7 @@ void Entity::stop_stream_action() {
 
   old_stream_actions.emplace_back(std::move(stream_action));
   stream_action = nullptr;
+  notify_hot_state_changed();
   check_collision_with_detectors();
 }
 
@@ -1887,6 +2010,7 @@ void Entity::set_collision_modes(int collision_modes) {
     enable_pixel_collisions();
   }
   this->collision_modes = collision_modes;
+  notify_hot_state_changed();
 }
 
 /**
@@ -2007,6 +2131,8 @@ void Entity::check_collision(Entity& other) {
     return;
   }
 
+  SOLARUS_HOT_COUNT(DETECTOR_CHECKS);
+
   // Detect the collision depending on the collision modes.
 
   if (has_collision_mode(CollisionMode::COLLISION_OVERLAPPING) && test_collision_rectangle(other)) {
@@ -2416,20 +2542,129 @@ void Entity::check_collision_with_detectors() {
     return;
   }
 
-  // Detect simple collisions.
+  if (get_entities().defer_collision_check_with_detectors(*this)) {
+    // Will be checked in a broad phase at the end of the entities update.
+    return;
+  }
+
+  // Detect simple collisions and pixel-precise collisions.
   get_map().check_collision_with_detectors(*this);
+}
+
+/**
+ * \brief Checks pixel-precise collisions between the sprites of this entity
+ * and the detectors of the map.
+ *
+ * Only sprites that have pixel-precise collisions enabled are checked.
+ */
+void Entity::check_sprite_collisions_with_detectors() {
 
-  // Detect pixel-precise collisions.
-  std::vector<NamedSprite> sprites = this->sprites;
   for (const NamedSprite& named_sprite: sprites) {
-    if (named_sprite.removed) {
-      continue;
+    if (!named_sprite.removed &&
+        named_sprite.sprite->are_pixel_collisions_enabled()) {
+      get_map().check_sprite_collisions_with_detectors(*this);
+      return;
     }
-    Sprite& sprite = *named_sprite.sprite;
-    if (sprite.are_pixel_collisions_enabled()) {
-      get_map().check_collision_with_detectors(*this, sprite);
+  }
+}
+
+/**
+ * \brief Checks collisions at positions that this entity went through
+ * without notifying them.
+ *
+ * This is called when a movement coalesces its moves.
+ * Entities near the whole path are found once. The entity is then placed
+ * at each position of the path in turn, and collisions are checked in both
+ * directions with those of them whose box is close enough.
+ * The entity finally goes back to its current position, unless a collision
+ * callback moved it or changed its movement: in that case it stays where
+ * it was when this happened.
+ *
+ * \param path Positions in the order they were taken,
+ * not including the current one.
+ */
+void Entity::check_collisions_along_path(const std::vector<Point>& path) {
+
+  if (path.empty() ||
+      !is_on_map() ||
+      !is_enabled() ||
+      is_being_removed() ||
+      get_map().is_suspended()) {
+    return;
+  }
+
+  // Find entities near the path once.
+  const Point xy = get_xy();
+  const Rectangle& box = get_extended_bounding_box(8);
+  Rectangle swept_box = box;
+  for (const Point& path_xy : path) {
+    Rectangle path_box = box;
+    path_box.add_xy(path_xy - xy);
+    swept_box |= path_box;
+  }
+
+  const bool detector = is_detector();
+  std::vector<EntityPtr> entities_nearby;
+  get_entities().get_entities_in_rectangle_z_sorted(swept_box, entities_nearby);
+  entities_nearby.erase(std::remove_if(entities_nearby.begin(), entities_nearby.end(),
+      [this, detector](const EntityPtr& other) {
+    return other.get() == this || (!detector && !other->is_detector());
+  }), entities_nearby.end());
+
+  if (entities_nearby.empty()) {
+    // Nothing was crossed.
+    return;
+  }
+
+  // Tells whether a collision callback changed this entity.
+  const std::shared_ptr<Movement> movement = get_movement();
+  const auto& is_interrupted = [&](const Point& path_xy) {
+    if (is_being_removed() || !is_enabled() || get_xy() != path_xy) {
+      return true;
+    }
+    if (get_movement() != movement) {
+      // The movement was stopped or replaced: stay where it happened.
+      notify_position_changed();
+      return true;
+    }
+    return false;
+  };
+
+  for (const Point& path_xy : path) {
+
+    set_xy(path_xy);
+    const Rectangle& path_box = get_extended_bounding_box(8);
+    for (const EntityPtr& other : entities_nearby) {
+
+      if (!other->is_enabled() ||
+          other->is_suspended() ||
+          other->is_being_removed() ||
+          !path_box.overlaps(other->get_max_bounding_box())) {
+        continue;
+      }
+
+      if (other->is_detector() && other->can_detect(*this)) {
+        other->check_collision(*this);
+        std::vector<NamedSprite> sprites = this->sprites;
+        for (const NamedSprite& named_sprite: sprites) {
+          if (!named_sprite.removed &&
+              named_sprite.sprite->are_pixel_collisions_enabled()) {
+            other->check_collision(*this, *named_sprite.sprite);
+          }
+        }
+      }
+
+      if (detector && can_detect(*other)) {
+        check_collision(*other);
+      }
+
+      if (is_interrupted(path_xy)) {
+        return;
+      }
     }
   }
+
+  set_xy(xy);
 }
 
 /**
@@ -2582,6 +2817,7 @@ void Entity::set_enabled(bool enabled) {
     }
     notify_enabled(false);
   }
+  notify_hot_state_changed();
 }
 
 /**
@@ -2712,6 +2948,51 @@ bool Entity::is_ground_obstacle(Ground ground) const {
   return false;
 }
 
+/**
+ * \brief Returns the set of uniform grounds that are obstacles for this entity.
+ *
+ * The result is cached until notify_ground_obstacles_changed() is called,
+ * unless are_ground_obstacles_cacheable() returns \c false.
+ *
+ * \return A bit set of grounds, as computed by
+ * WalkabilityGrid::compute_ground_obstacles().
+ */
+uint32_t Entity::get_ground_obstacles() const {
+
+  if (!ground_obstacles_known) {
+    ground_obstacles = WalkabilityGrid::compute_ground_obstacles(*this);
+    ground_obstacles_known = are_ground_obstacles_cacheable();
+  }
+  return ground_obstacles;
+}
+
+/**
+ * \brief Notifies this entity that the result of is_ground_obstacle() may
+ * have changed.
+ *
+ * Call this function whenever something that the is_xxx_obstacle()
+ * functions depend on changes.
+ */
+void Entity::notify_ground_obstacles_changed() {
+
+  ground_obstacles_known = false;
+}
+
+/**
+ * \brief Returns whether the grounds that are obstacles for this entity
+ * can be cached.
+ *
+ * By default, they only change when the state changes or when
+ * notify_ground_obstacles_changed() is called.
+ * Redefine this function to return \c false if they depend on other
+ * things, like the position of the entity.
+ *
+ * \return \c true if get_ground_obstacles() can cache its result.
+ */
+bool Entity::are_ground_obstacles_cacheable() const {
+  return true;
+}
+
 /**
  * \brief Returns whether traversable ground is currently considered as an
  * obstacle by this entity.
@@ -3233,9 +3514,16 @@ bool Entity::is_in_same_region(const Point& xy) const {
   const Point& this_xy = get_center_point();
   const Point& other_xy = xy;
 
-  const std::set<ConstSeparatorPtr>& separators =
-      get_entities().get_entities_by_type<Separator>();
-  for (const ConstSeparatorPtr& separator: separators) {
+  const SeparatorRegions& separator_regions = get_entities().get_separator_regions();
+  const int this_region = separator_regions.get_region_index_at(this_xy);
+  const int other_region = separator_regions.get_region_index_at(other_xy);
+  if (this_region != -1 && other_region != -1) {
+    return this_region == other_region;
+  }
+
+  // A point is outside the map: look at separators one by one.
+  for (const ConstSeparatorPtr& separator:
+      get_entities().get_entities_by_type<Separator>()) {
 
     if (separator->is_vertical()) {
       // Vertical separation.
@@ -3614,6 +3902,7 @@ bool Entity::is_suspended() const {
 void Entity::set_suspended(bool suspended) {
 
   this->suspended = suspended;
+  notify_hot_state_changed();
 
   // Remember the date if the entity is being suspended.
   if (suspended) {
@@ -3713,10 +4002,11 @@ void Entity::update() {
 
   update_sprites();
 
-  // Update the movement.
-  if (movement != nullptr) {
+  // Update the movement unless the movement system just did.
+  if (movement != nullptr && movement.get() != movement_updated_early) {
     movement->update();
   }
+  movement_updated_early = nullptr;
   clear_old_movements();
   update_stream_action();
 
@@ -3724,24 +4014,141 @@ void Entity::update() {
   update_state();
 }
 
+/**
+ * \brief Returns whether calling update() on this entity would do something.
+ *
+ * This is \c false for entities whose type does not redefine update()
+ * and that have nothing to update: no sprite, no movement, no stream,
+ * no state and no old objects to destroy.
+ *
+ * \return \c false if update() can be skipped.
+ */
+bool Entity::is_update_needed() const {
+
+  switch (get_type()) {
+
+  // Types that don't redefine update().
+  case EntityType::BLOCK:
+  case EntityType::DESTINATION:
+  case EntityType::DYNAMIC_TILE:
+  case EntityType::JUMPER:
+  case EntityType::NPC:
+  case EntityType::SEPARATOR:
+  case EntityType::STAIRS:
+  case EntityType::STREAM:
+  case EntityType::WALL:
+    break;
+
+  default:
+    return true;
+  }
+
+  return facing_entity != nullptr ||
+      !sprites.empty() ||
+      movement != nullptr ||
+      !old_movements.empty() ||
+      stream_action != nullptr ||
+      !old_stream_actions.empty() ||
+      state != nullptr ||
+      !old_states.empty();
+}
+
+/**
+ * \brief Sets when the engine calls update() on this entity.
+ *
+ * With UpdatePolicy::NEAR_CAMERA, the entity is only updated when it is
+ * at most one screen away from the visible area.
+ * With UpdatePolicy::ON_DEMAND, it is also updated far from the visible
+ * area as long as it is awake (see is_awake()).
+ *
+ * \param update_policy The update policy.
+ */
+void Entity::set_update_policy(UpdatePolicy update_policy) {
+
+  this->update_policy = update_policy;
+  notify_hot_state_changed();
+}
+
+/**
+ * \brief Returns whether this entity has something running that needs
+ * updates.
+ *
+ * An entity is awake if it has a movement, a stream action, a state,
+ * a sprite animation in progress or an on_update() event.
+ * Timers don't need to wake the entity up: they are updated by Lua.
+ * Sleeping entities wake up when one of these things starts: sprites
+ * and Lua events call notify_hot_state_changed() for that.
+ *
+ * \return \c true if the entity is awake.
+ */
+bool Entity::is_awake() const {
+
+  if (movement != nullptr ||
+      stream_action != nullptr ||
+      state != nullptr ||
+      !old_movements.empty() ||
+      !old_stream_actions.empty() ||
+      !old_states.empty()) {
+    return true;
+  }
+
+  for (const NamedSprite& named_sprite : sprites) {
+    const Sprite& sprite = *named_sprite.sprite;
+    if (!named_sprite.removed &&
+        sprite.get_nb_frames() > 1 &&
+        sprite.get_frame_delay() > 0 &&
+        !sprite.is_animation_finished() &&
+        !sprite.is_paused()) {
+      return true;
+    }
+  }
+
+  const LuaContext* lua_context = get_lua_context();
+  return lua_context != nullptr &&
+      lua_context->userdata_has_field(*this, LuaEvent::ON_UPDATE);
+}
+
 /**
  * \brief Updates all sprites of this entity.
  */
 void Entity::update_sprites() {
 
+  // Only touch sprites whose frame, blinking or effects can change now.
+  const uint32_t now = System::now();
   if (sprites.size() == 1) {
     // Special case just to avoid a copy of the vector.
-    if (!sprites[0].removed) {
-      update_sprite(*sprites[0].sprite);
+    Sprite& sprite = *sprites[0].sprite;
+    if (!sprites[0].removed && sprite.is_update_needed(now)) {
+      if (is_sprite_update_deferrable(sprite, now)) {
+        sprite.set_update_deferred();
+      }
+      else {
+        update_sprite(sprite);
+      }
     }
   } else {
-    // Iterate on a copy because the list might change during the iteration.
-    std::vector<NamedSprite> sprites = this->sprites;
-    for (const NamedSprite& named_sprite: sprites) {
-      if (named_sprite.removed) {
-        continue;
+    bool update_needed = false;
+    for (const NamedSprite& named_sprite: this->sprites) {
+      if (!named_sprite.removed && named_sprite.sprite->is_update_needed(now)) {
+        update_needed = true;
+        break;
+      }
+    }
+
+    if (update_needed) {
+      // Iterate on a copy because the list might change during the iteration.
+      std::vector<NamedSprite> sprites = this->sprites;
+      for (const NamedSprite& named_sprite: sprites) {
+        if (named_sprite.removed ||
+            !named_sprite.sprite->is_update_needed(now)) {
+          continue;
+        }
+        if (is_sprite_update_deferrable(*named_sprite.sprite, now)) {
+          named_sprite.sprite->set_update_deferred();
+          continue;
+        }
+        update_sprite(*named_sprite.sprite);
       }
-      update_sprite(*named_sprite.sprite);
     }
   }
   clear_old_sprites();
@@ -3775,6 +4182,60 @@ void Entity::update_sprite(Sprite& sprite) {
   }
 }
 
+/**
+ * \brief Returns how the sprites of this type of entity advance their
+ * animation while off-screen, unless a sprite sets its own policy.
+ *
+ * Returns AnimationLod::LAZY by default: nobody sees the frames of
+ * off-screen sprites whose frame changes are not observed.
+ * Redefine this function for types that need all their frames.
+ *
+ * \return The default animation level of detail of this type of entity.
+ */
+AnimationLod Entity::get_default_animation_lod() const {
+  return AnimationLod::LAZY;
+}
+
+/**
+ * \brief Returns how a sprite of this entity advances its animation
+ * while off-screen.
+ * \param sprite A sprite of this entity.
+ * \return Its animation level of detail, never AnimationLod::DEFAULT.
+ */
+AnimationLod Entity::get_animation_lod(const Sprite& sprite) const {
+
+  const AnimationLod animation_lod = sprite.get_animation_lod();
+  if (animation_lod == AnimationLod::DEFAULT) {
+    return get_default_animation_lod();
+  }
+  return animation_lod;
+}
+
+/**
+ * \brief Returns whether the update of a sprite of this entity can wait
+ * until the entity is visible again.
+ * \param sprite A sprite of this entity.
+ * \param now The current date in milliseconds.
+ * \return \c true if the sprite is lazy, off-screen, and only has frames
+ * to change that nobody needs now.
+ */
+bool Entity::is_sprite_update_deferrable(Sprite& sprite, uint32_t now) const {
+
+  if (get_animation_lod(sprite) != AnimationLod::LAZY ||
+      !is_on_map() ||
+      !is_drawn_at_its_position()) {
+    return false;
+  }
+
+  const CameraPtr& camera = get_map().get_camera();
+  if (camera == nullptr ||
+      get_max_bounding_box().overlaps(camera->get_bounding_box())) {
+    return false;
+  }
+
+  return sprite.is_update_deferrable(now);
+}
+
 /**
  * \brief Returns whether this entity is drawn at its position on the map.
  *
@@ -3825,6 +4286,81 @@ void Entity::built_in_draw(Camera& camera) {
   draw_sprites(camera);
 }
 
+/**
+ * \brief Returns whether the built-in draw of this entity only draws its
+ * sprites.
+ *
+ * Types of entities that reimplement built_in_draw() should return \c false.
+ *
+ * \return \c true if built_in_draw() is draw_sprites().
+ */
+bool Entity::is_drawn_with_sprites_only() const {
+  return true;
+}
+
+/**
+ * \brief Returns where and how this entity is drawn, if it only draws
+ * untransformed sprites that share the same shader and blend mode.
+ *
+ * This is not known for entities drawn by Lua (draw events or draw
+ * override), by a reimplemented built_in_draw() or with tiled, rotated,
+ * scaled or transitioning sprites.
+ *
+ * \param[out] box Rectangle of the map containing the sprites drawn.
+ * \param[out] shader The shader of the sprites or nullptr.
+ * \param[out] blend_mode The blend mode of the sprites.
+ * \return \c true if the drawing of the entity is known.
+ */
+bool Entity::get_sprites_draw_state(
+    Rectangle& box, const Shader*& shader, BlendMode& blend_mode) const {
+
+  if (!is_drawn_with_sprites_only() ||
+      !draw_override.is_empty() ||
+      is_tiled() ||
+      !is_drawn_at_its_position() ||
+      get_state() != nullptr) {
+    return false;
+  }
+
+  const LuaContext& lua_context = *get_lua_context();
+  if (lua_context.userdata_has_field(*this, LuaEvent::ON_PRE_DRAW) ||
+      lua_context.userdata_has_field(*this, LuaEvent::ON_POST_DRAW)) {
+    return false;
+  }
+
+  const Point& xy = get_displayed_xy() + get_interpolation_offset();
+  bool first = true;
+  for (const NamedSprite& named_sprite: sprites) {
+    if (named_sprite.removed) {
+      continue;
+    }
+    Sprite& sprite = *named_sprite.sprite;
+    if (sprite.get_rotation() != 0.0 ||
+        sprite.get_scale().x != 1.0f ||
+        sprite.get_scale().y != 1.0f ||
+        sprite.get_transition() != nullptr) {
+      return false;
+    }
+
+    Rectangle sprite_box = sprite.get_max_bounding_box();
+    sprite_box.add_xy(sprite.get_xy() + xy);
+    if (first) {
+      box = sprite_box;
+      shader = sprite.get_shader().get();
+      blend_mode = sprite.get_blend_mode();
+      first = false;
+    }
+    else {
+      if (sprite.get_shader().get() != shader ||
+          sprite.get_blend_mode() != blend_mode) {
+        return false;
+      }
+      box |= sprite_box;
+    }
+  }
+  return !first;
+}
+
 /**
  * \brief Draws the sprites of this entity.
  *
@@ -3837,7 +4373,7 @@ void Entity::built_in_draw(Camera& camera) {
  */
 void Entity::draw_sprites(Camera& /* camera */, const Rectangle& clipping_area) {
 
-  const Point& xy = get_displayed_xy();
+  const Point& xy = get_displayed_xy() + get_interpolation_offset();
   const Size& size = get_size();
 
   // Draw the sprites.
@@ -3930,6 +4466,8 @@ void Entity::set_state(const std::shared_ptr<State>& new_state) {
   this->old_states.emplace_back(this->state);
 
   this->state = new_state;
+  notify_hot_state_changed();
+  notify_ground_obstacles_changed();
   this->state->start(old_state.get());  // May also change the state again.
 
   if (this->state == new_state) {
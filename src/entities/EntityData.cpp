@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/entities/EntityData.h"
 #include "solarus/entities/EntityTypeInfo.h"
@@ -394,7 +395,8 @@ EntityData::EntityData(EntityType type) :
     xy(),
     enabled_at_start(true),
     user_properties(),
-    specific_properties() {
+    type_description(nullptr),
+    specific_values() {
 
   initialize_specific_properties();
 }
@@ -649,21 +651,95 @@ bool EntityData::has_user_property(const std::string& key) const {
  */
 void EntityData::initialize_specific_properties() {
 
-  specific_properties.clear();
-  const EntityTypeDescription& type_description = entity_type_descriptions.at(type);
-  for (const EntityFieldDescription& field_description : type_description) {
-    specific_properties.emplace(field_description.key, field_description.default_value);
+  type_description = &entity_type_descriptions.at(type);
+  specific_values.clear();
+  specific_values.reserve(type_description->size());
+  for (const EntityFieldDescription& field_description : *type_description) {
+    specific_values.push_back(field_description.default_value);
   }
 }
 
 /**
  * \brief Returns all specific properties of this entity.
+ *
+ * The map is built on demand: prefer the accessors of individual properties.
+ *
  * \return The entity properties that are specific to its type.
  */
-const std::map<std::string, FieldValue>& EntityData::get_specific_properties() const {
+std::map<std::string, FieldValue> EntityData::get_specific_properties() const {
+
+  std::map<std::string, FieldValue> specific_properties;
+  for (size_t i = 0; i < specific_values.size(); ++i) {
+    specific_properties.emplace((*type_description)[i].key, specific_values[i]);
+  }
   return specific_properties;
 }
 
+/**
+ * \brief Returns the position of a specific property in the type description.
+ *
+ * Entity types have a few fields: a linear search is faster than hashing.
+ *
+ * \param key Key of a specific property.
+ * \return The index of this property in specific_values, or -1.
+ */
+int EntityData::find_specific_property(const std::string& key) const {
+
+  for (size_t i = 0; i < type_description->size(); ++i) {
+    if ((*type_description)[i].key == key) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+/**
+ * \brief Returns a specific property that must exist with the given type.
+ *
+ * Stops with an error if the property does not exist or has another type.
+ *
+ * \param key Key of the specific property to get.
+ * \param value_type The expected type.
+ * \return The value.
+ */
+const FieldValue& EntityData::get_field(const std::string& key, EntityFieldType value_type) const {
+
+  const int index = find_specific_property(key);
+  if (index == -1) {
+    Debug::die("No such entity field in " + get_type_name() + ": '" + key + "'");
+  }
+
+  const FieldValue& value = specific_values[index];
+  if (value.value_type != value_type) {
+    switch (value_type) {
+
+    case EntityFieldType::STRING:
+      Debug::die("Field '" + key + "' is not a string");
+
+    case EntityFieldType::INTEGER:
+      Debug::die("Field '" + key + "' is not an integer");
+
+    case EntityFieldType::BOOLEAN:
+      Debug::die("Field '" + key + "' is not a boolean");
+
+    case EntityFieldType::NIL:
+      break;
+    }
+    Debug::die("Nil entity field");
+  }
+  return value;
+}
+
+/**
+ * \copydoc get_field
+ */
+FieldValue& EntityData::get_field(const std::string& key, EntityFieldType value_type) {
+
+  return const_cast<FieldValue&>(
+      static_cast<const EntityData&>(*this).get_field(key, value_type)
+  );
+}
+
 /**
  * \brief Returns a specific property of this entity if it exists.
  * \param key Key of the specific property to get.
@@ -671,12 +747,12 @@ const std::map<std::string, FieldValue>& EntityData::get_specific_properties() c
  */
 FieldValue EntityData::get_specific_property(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  if (it == specific_properties.end()) {
+  const int index = find_specific_property(key);
+  if (index == -1) {
     return FieldValue();
   }
 
-  return it->second;
+  return specific_values[index];
 }
 
 /**
@@ -686,11 +762,11 @@ FieldValue EntityData::get_specific_property(const std::string& key) const {
  */
 bool EntityData::is_string(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  if (it == specific_properties.end()) {
+  const int index = find_specific_property(key);
+  if (index == -1) {
     return false;
   }
-  return it->second.value_type == EntityFieldType::STRING;
+  return specific_values[index].value_type == EntityFieldType::STRING;
 }
 
 /**
@@ -701,14 +777,7 @@ bool EntityData::is_string(const std::string& key) const {
  */
 const std::string& EntityData::get_string(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
-
-  Debug::check_assertion(it->second.value_type == EntityFieldType::STRING,
-      "Field '" + key + "' is not a string");
-
-  return it->second.string_value;
+  return get_field(key, EntityFieldType::STRING).string_value;
 }
 
 /**
@@ -719,14 +788,7 @@ const std::string& EntityData::get_string(const std::string& key) const {
  */
 void EntityData::set_string(const std::string& key, const std::string& value) {
 
-  const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
-
-  Debug::check_assertion(it->second.value_type == EntityFieldType::STRING,
-      "Field '" + key + "' is not a string");
-
-  it->second.string_value = value;
+  get_field(key, EntityFieldType::STRING).string_value = value;
 }
 
 /**
@@ -736,11 +798,11 @@ void EntityData::set_string(const std::string& key, const std::string& value) {
  */
 bool EntityData::is_integer(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  if (it == specific_properties.end()) {
+  const int index = find_specific_property(key);
+  if (index == -1) {
     return false;
   }
-  return it->second.value_type == EntityFieldType::INTEGER;
+  return specific_values[index].value_type == EntityFieldType::INTEGER;
 }
 
 /**
@@ -751,14 +813,7 @@ bool EntityData::is_integer(const std::string& key) const {
  */
 int EntityData::get_integer(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
-
-  Debug::check_assertion(it->second.value_type == EntityFieldType::INTEGER,
-      "Field '" + key + "' is not a string");
-
-  return it->second.int_value;
+  return get_field(key, EntityFieldType::INTEGER).int_value;
 }
 
 /**
@@ -769,14 +824,7 @@ int EntityData::get_integer(const std::string& key) const {
  */
 void EntityData::set_integer(const std::string& key, int value) {
 
-  const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
-
-  Debug::check_assertion(it->second.value_type == EntityFieldType::INTEGER,
-      "Field '" + key + "' is not an integer");
-
-  it->second.int_value = value;
+  get_field(key, EntityFieldType::INTEGER).int_value = value;
 }
 
 /**
@@ -786,11 +834,11 @@ void EntityData::set_integer(const std::string& key, int value) {
  */
 bool EntityData::is_boolean(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  if (it == specific_properties.end()) {
+  const int index = find_specific_property(key);
+  if (index == -1) {
     return false;
   }
-  return it->second.value_type == EntityFieldType::BOOLEAN;
+  return specific_values[index].value_type == EntityFieldType::BOOLEAN;
 }
 
 /**
@@ -801,14 +849,7 @@ bool EntityData::is_boolean(const std::string& key) const {
  */
 bool EntityData::get_boolean(const std::string& key) const {
 
-  const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
-
-  Debug::check_assertion(it->second.value_type == EntityFieldType::BOOLEAN,
-      "Field '" + key + "' is not a boolean");
-
-  return it->second.int_value != 0;
+  return get_field(key, EntityFieldType::BOOLEAN).int_value != 0;
 }
 
 /**
@@ -819,14 +860,7 @@ bool EntityData::get_boolean(const std::string& key) const {
  */
 void EntityData::set_boolean(const std::string& key, bool value) {
 
-  const auto& it = specific_properties.find(key);
-  Debug::check_assertion(it != specific_properties.end(),
-      "No such entity field in " + get_type_name() + ": '" + key + "'");
-
-  Debug::check_assertion(it->second.value_type == EntityFieldType::BOOLEAN,
-      "Field '" + key + "' is not an boolean");
-
-  it->second.int_value = value ? 1 : 0;
+  get_field(key, EntityFieldType::BOOLEAN).int_value = value ? 1 : 0;
 }
 
 /**
@@ -846,14 +880,11 @@ bool EntityData::has_specific_property(const std::string& key) const {
  */
 bool EntityData::is_specific_property_optional(const std::string& key) const {
 
-  const EntityTypeDescription& type_description = entity_type_descriptions.at(type);
-  for (const EntityFieldDescription& field_description : type_description) {
-    if (field_description.key == key) {
-      return field_description.optional == OptionalFlag::OPTIONAL;
-    }
+  const int index = find_specific_property(key);
+  if (index == -1) {
+    return false;
   }
-
-  return false;
+  return (*type_description)[index].optional == OptionalFlag::OPTIONAL;
 }
 
 /**
@@ -867,8 +898,7 @@ bool EntityData::is_specific_property_optional(const std::string& key) const {
  */
 bool EntityData::is_specific_property_unset(const std::string& key) const {
 
-  const EntityTypeDescription& type_description = entity_type_descriptions.at(type);
-  for (const EntityFieldDescription& field_description : type_description) {
+  for (const EntityFieldDescription& field_description : *type_description) {
     if (field_description.key != key) {
       continue;
     }
@@ -1105,9 +1135,7 @@ void EntityData::export_user_properties(std::ostream& out) const {
 void EntityData::export_specific_properties(std::ostream& out) const {
 
   // Properties specific to the type of entity.
-  const EntityTypeDescription& type_description = entity_type_descriptions.at(get_type());
-
-  for (const EntityFieldDescription& field_description : type_description) {
+  for (const EntityFieldDescription& field_description : *type_description) {
 
     const std::string& key = field_description.key;
     const bool optional = field_description.optional == OptionalFlag::OPTIONAL;
@@ -1157,5 +1185,100 @@ void EntityData::export_specific_properties(std::ostream& out) const {
   }
 }
 
+/**
+ * \copydoc LuaData::import_from_binary
+ *
+ * Specific properties are read in the order of the description of the
+ * entity type.
+ */
+bool EntityData::import_from_binary(BinaryReader& reader) {
+
+  const EntityType type = static_cast<EntityType>(reader.read_uint());
+  const auto& it = entity_type_descriptions.find(type);
+  if (reader.has_failed() || it == entity_type_descriptions.end()) {
+    return false;
+  }
+
+  EntityData entity(type);
+  entity.name = reader.read_string();
+  entity.layer = reader.read_int();
+  entity.xy = reader.read_point();
+  entity.enabled_at_start = reader.read_bool();
+
+  const size_t num_user_properties = reader.read_count();
+  entity.user_properties.reserve(num_user_properties);
+  for (size_t i = 0; i < num_user_properties; ++i) {
+    const std::string& key = reader.read_string();
+    const std::string& value = reader.read_string();
+    entity.user_properties.emplace_back(key, value);
+  }
+
+  for (FieldValue& value : entity.specific_values) {
+    switch (value.value_type) {
+
+      case EntityFieldType::STRING:
+        value.string_value = reader.read_string();
+        break;
+
+      case EntityFieldType::INTEGER:
+        value.int_value = reader.read_int();
+        break;
+
+      case EntityFieldType::BOOLEAN:
+        value.int_value = reader.read_bool() ? 1 : 0;
+        break;
+
+      case EntityFieldType::NIL:
+        return false;
+    }
+  }
+
+  if (reader.has_failed()) {
+    return false;
+  }
+  *this = std::move(entity);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool EntityData::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_uint(static_cast<uint32_t>(type));
+  writer.write_string(name);
+  writer.write_int(layer);
+  writer.write_point(xy);
+  writer.write_bool(enabled_at_start);
+
+  writer.write_uint(static_cast<uint32_t>(user_properties.size()));
+  for (const UserProperty& user_property : user_properties) {
+    writer.write_string(user_property.first);
+    writer.write_string(user_property.second);
+  }
+
+  for (const FieldValue& value : specific_values) {
+    switch (value.value_type) {
+
+      case EntityFieldType::STRING:
+        writer.write_string(value.string_value);
+        break;
+
+      case EntityFieldType::INTEGER:
+        writer.write_int(value.int_value);
+        break;
+
+      case EntityFieldType::BOOLEAN:
+        writer.write_bool(value.int_value != 0);
+        break;
+
+      case EntityFieldType::NIL:
+        return false;
+    }
+  }
+
+  return true;
+}
+
 }  // namespace Solarus
 
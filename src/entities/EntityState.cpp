@@ -236,7 +236,7 @@ void Entity::State::start(const State* /* previous_state */) {
  */
 void Entity::State::stop(const State* next_state) {
 
-  Debug::check_assertion(!is_stopping(),
+  SOLARUS_CHECK(!is_stopping(),
       std::string("This state is already stopping: ") + get_name());
 
   // Notify Lua.
@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/entities/EntityTypeInfo.h"
+#include <initializer_list>
 
 namespace Solarus {
 
@@ -159,5 +160,112 @@ bool EntityTypeInfo::can_be_created_from_lua_api(EntityType type) {
   return false;
 }
 
+/**
+ * \brief Returns the default collision category of entities of a type.
+ *
+ * Each type has its own bit.
+ *
+ * \param type A type of entity.
+ * \return The collision category.
+ */
+uint32_t EntityTypeInfo::get_collision_category(EntityType type) {
+
+  static_assert(static_cast<int>(EntityType::HOOKSHOT) < 32, "Too many entity types for collision categories");
+  return UINT32_C(1) << static_cast<int>(type);
+}
+
+/**
+ * \brief Returns the default collision mask of entities of a type.
+ *
+ * The mask tells the categories of entities that a detector of this type
+ * can react to.
+ * For detectors that only forward collisions to the other entity,
+ * these are the types that handle collisions with this type.
+ * Detectors that set the facing entity of others, detectors whose
+ * collisions go to scripts and entities that are not detectors
+ * accept all categories.
+ *
+ * \param type A type of entity.
+ * \return The collision mask.
+ */
+uint32_t EntityTypeInfo::get_default_collision_mask(EntityType type) {
+
+  const auto& mask = [](std::initializer_list<EntityType> types) {
+    uint32_t result = 0;
+    for (EntityType type : types) {
+      result |= get_collision_category(type);
+    }
+    return result;
+  };
+
+  switch (type) {
+
+  case EntityType::CRYSTAL_BLOCK:
+  case EntityType::SEPARATOR:
+  case EntityType::TELETRANSPORTER:
+    return mask({ EntityType::HERO });
+
+  case EntityType::ENEMY:
+    return mask({
+        EntityType::ARROW,
+        EntityType::BOOMERANG,
+        EntityType::CARRIED_OBJECT,
+        EntityType::ENEMY,
+        EntityType::EXPLOSION,
+        EntityType::HERO,
+        EntityType::HOOKSHOT
+    });
+
+  case EntityType::EXPLOSION:
+    return mask({
+        EntityType::BOMB,
+        EntityType::DOOR,
+        EntityType::ENEMY,
+        EntityType::HERO,
+        EntityType::SENSOR
+    });
+
+  case EntityType::FIRE:
+    return mask({ EntityType::ENEMY });
+
+  case EntityType::PICKABLE:
+    return mask({ EntityType::BOOMERANG, EntityType::HERO, EntityType::HOOKSHOT });
+
+  case EntityType::SENSOR:
+    return mask({ EntityType::EXPLOSION, EntityType::HERO });
+
+  case EntityType::STAIRS:
+    return mask({ EntityType::CARRIED_OBJECT, EntityType::HERO });
+
+  case EntityType::STREAM:
+    return mask({ EntityType::BOMB, EntityType::HERO, EntityType::PICKABLE });
+
+  case EntityType::ARROW:
+  case EntityType::BLOCK:
+  case EntityType::BOMB:
+  case EntityType::BOOMERANG:
+  case EntityType::CAMERA:
+  case EntityType::CARRIED_OBJECT:
+  case EntityType::CHEST:
+  case EntityType::CRYSTAL:
+  case EntityType::CUSTOM:
+  case EntityType::DESTINATION:
+  case EntityType::DESTRUCTIBLE:
+  case EntityType::DOOR:
+  case EntityType::DYNAMIC_TILE:
+  case EntityType::HERO:
+  case EntityType::HOOKSHOT:
+  case EntityType::JUMPER:
+  case EntityType::NPC:
+  case EntityType::SHOP_TREASURE:
+  case EntityType::SWITCH:
+  case EntityType::TILE:
+  case EntityType::WALL:
+    return UINT32_MAX;
+  }
+
+  return UINT32_MAX;
+}
+
 }  // namespace Solarus
 
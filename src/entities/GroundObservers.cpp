@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Point.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/GroundInfo.h"
+#include "solarus/entities/GroundObservers.h"
+#include <algorithm>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the ground that an entity currently imposes to the map.
+ * \param entity An entity.
+ * \return Its modified ground, or Ground::EMPTY if it is disabled or
+ * being removed.
+ */
+Ground get_effective_ground(const Entity& entity) {
+
+  if (!entity.is_enabled() || entity.is_being_removed()) {
+    return Ground::EMPTY;
+  }
+  return entity.get_modified_ground();
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates an empty index.
+ */
+GroundObservers::GroundObservers():
+  buckets(),
+  observer_buckets(),
+  modifiers() {
+
+}
+
+/**
+ * \brief Returns what a ground modifier currently covers.
+ * \param modifier An entity.
+ * \return Its layer, bounding box and effective ground.
+ */
+GroundObservers::ModifierState GroundObservers::get_modifier_state(const Entity& modifier) {
+
+  return {
+      modifier.get_layer(),
+      modifier.get_bounding_box(),
+      get_effective_ground(modifier)
+  };
+}
+
+/**
+ * \brief Returns the bucket containing a point.
+ * \param layer Layer of the point.
+ * \param xy Coordinates of the point.
+ * \return A key identifying the bucket.
+ */
+uint64_t GroundObservers::get_bucket_key(int layer, const Point& xy) {
+
+  const uint64_t bucket_x = static_cast<uint32_t>(xy.x >> bucket_shift) & 0xFFFFFF;
+  const uint64_t bucket_y = static_cast<uint32_t>(xy.y >> bucket_shift) & 0xFFFFFF;
+  return (static_cast<uint64_t>(static_cast<uint16_t>(layer)) << 48) |
+      (bucket_x << 24) |
+      bucket_y;
+}
+
+/**
+ * \brief Starts tracking an entity added to the map.
+ *
+ * If it modifies the ground, what it covers is remembered so that
+ * observers can be updated when it moves or disappears later.
+ *
+ * \param entity The entity.
+ */
+void GroundObservers::notify_entity_added(Entity& entity) {
+
+  notify_entity_changed(entity);
+
+  const ModifierState state = get_modifier_state(entity);
+  if (state.ground != Ground::EMPTY) {
+    modifiers[&entity] = state;
+  }
+}
+
+/**
+ * \brief Updates the bucket of an entity that may be a ground observer.
+ *
+ * This function should be called whenever an entity is added, moves,
+ * changes its layer or starts or stops observing its ground.
+ *
+ * \param entity The entity.
+ */
+void GroundObservers::notify_entity_changed(Entity& entity) {
+
+  const auto& it = observer_buckets.find(&entity);
+  const bool observer = entity.is_ground_observer() && !entity.is_being_removed();
+  const uint64_t key = get_bucket_key(entity.get_layer(), entity.get_ground_point());
+
+  if (it != observer_buckets.end()) {
+    if (observer && it->second == key) {
+      // Still in the same bucket.
+      return;
+    }
+    std::vector<Entity*>& bucket = buckets[it->second];
+    const auto& bucket_it = std::find(bucket.begin(), bucket.end(), &entity);
+    if (bucket_it != bucket.end()) {
+      *bucket_it = bucket.back();
+      bucket.pop_back();
+    }
+    if (bucket.empty()) {
+      buckets.erase(it->second);
+    }
+    if (!observer) {
+      observer_buckets.erase(it);
+      return;
+    }
+    it->second = key;
+  }
+  else if (!observer) {
+    return;
+  }
+  else {
+    observer_buckets.emplace(&entity, key);
+  }
+  buckets[key].push_back(&entity);
+}
+
+/**
+ * \brief Forgets an entity that is being removed from the map.
+ * \param entity The entity.
+ */
+void GroundObservers::notify_entity_removed(const Entity& entity) {
+
+  const auto& it = observer_buckets.find(&entity);
+  if (it != observer_buckets.end()) {
+    std::vector<Entity*>& bucket = buckets[it->second];
+    const auto& bucket_it = std::find(bucket.begin(), bucket.end(), &entity);
+    if (bucket_it != bucket.end()) {
+      *bucket_it = bucket.back();
+      bucket.pop_back();
+    }
+    if (bucket.empty()) {
+      buckets.erase(it->second);
+    }
+    observer_buckets.erase(it);
+  }
+  modifiers.erase(&entity);
+}
+
+/**
+ * \brief Remembers the new state of a ground modifier and returns the ground
+ * observers whose ground may have changed because of it.
+ *
+ * An observer is returned if its ground point is in the rectangle covered
+ * before or after the change. When the modifier only moved on its layer
+ * and its ground is not diagonal, only observers that entered or left
+ * the rectangle are returned.
+ *
+ * \param modifier An entity that modifies the ground or just stopped
+ * modifying it.
+ * \param[out] observers The observers whose ground should be updated.
+ */
+void GroundObservers::notify_modifier_changed(
+    const Entity& modifier,
+    std::vector<EntityPtr>& observers) {
+
+  const ModifierState new_state = get_modifier_state(modifier);
+
+  const auto& it = modifiers.find(&modifier);
+  if (it == modifiers.end() && new_state.ground == Ground::EMPTY) {
+    // Nothing covered before or after.
+    return;
+  }
+
+  ModifierState old_state = { new_state.layer, Rectangle(), Ground::EMPTY };
+  if (it != modifiers.end()) {
+    old_state = it->second;
+    if (new_state.ground == Ground::EMPTY) {
+      modifiers.erase(it);
+    }
+    else {
+      it->second = new_state;
+    }
+  }
+  else {
+    modifiers.emplace(&modifier, new_state);
+  }
+
+  const bool old_covers = old_state.ground != Ground::EMPTY;
+  const bool new_covers = new_state.ground != Ground::EMPTY;
+  const bool only_edges = old_covers && new_covers &&
+      old_state.layer == new_state.layer &&
+      old_state.ground == new_state.ground &&
+      !GroundInfo::is_ground_diagonal(new_state.ground);
+
+  std::vector<Entity*> candidates;
+  if (old_covers && new_covers &&
+      old_state.layer == new_state.layer &&
+      old_state.box.overlaps(new_state.box)) {
+    // Usual case of a small move: visit the union of both rectangles once.
+    const Rectangle& old_box = old_state.box;
+    const Rectangle& new_box = new_state.box;
+    const int x = std::min(old_box.get_x(), new_box.get_x());
+    const int y = std::min(old_box.get_y(), new_box.get_y());
+    const Rectangle box(
+        x,
+        y,
+        std::max(old_box.get_x() + old_box.get_width(), new_box.get_x() + new_box.get_width()) - x,
+        std::max(old_box.get_y() + old_box.get_height(), new_box.get_y() + new_box.get_height()) - y
+    );
+    get_observers_in_rectangle(new_state.layer, box, candidates);
+  }
+  else {
+    if (old_covers) {
+      get_observers_in_rectangle(old_state.layer, old_state.box, candidates);
+    }
+    if (new_covers) {
+      get_observers_in_rectangle(new_state.layer, new_state.box, candidates);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  }
+
+  for (Entity* candidate : candidates) {
+    if (candidate == &modifier) {
+      continue;
+    }
+    const Point& ground_point = candidate->get_ground_point();
+    const int layer = candidate->get_layer();
+    const bool in_old = old_covers && layer == old_state.layer &&
+        old_state.box.contains(ground_point);
+    const bool in_new = new_covers && layer == new_state.layer &&
+        new_state.box.contains(ground_point);
+    if (only_edges ? in_old != in_new : in_old || in_new) {
+      observers.push_back(std::static_pointer_cast<Entity>(candidate->shared_from_this()));
+    }
+  }
+}
+
+/**
+ * \brief Returns the ground observers whose bucket overlaps a rectangle.
+ *
+ * Callers still have to check their exact ground point.
+ *
+ * \param layer The layer.
+ * \param box The rectangle.
+ * \param[out] observers The observers found.
+ */
+void GroundObservers::get_observers_in_rectangle(
+    int layer,
+    const Rectangle& box,
+    std::vector<Entity*>& observers) const {
+
+  if (buckets.empty() || box.is_flat()) {
+    return;
+  }
+
+  const int bucket_x1 = box.get_x() >> bucket_shift;
+  const int bucket_y1 = box.get_y() >> bucket_shift;
+  const int bucket_x2 = (box.get_x() + box.get_width() - 1) >> bucket_shift;
+  const int bucket_y2 = (box.get_y() + box.get_height() - 1) >> bucket_shift;
+  for (int bucket_y = bucket_y1; bucket_y <= bucket_y2; ++bucket_y) {
+    for (int bucket_x = bucket_x1; bucket_x <= bucket_x2; ++bucket_x) {
+      const Point xy(bucket_x * (1 << bucket_shift), bucket_y * (1 << bucket_shift));
+      const auto& it = buckets.find(get_bucket_key(layer, xy));
+      if (it != buckets.end()) {
+        observers.insert(observers.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+}
+
+}
+
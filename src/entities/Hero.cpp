@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Equipment.h"
@@ -136,6 +137,16 @@ EntityType Hero::get_type() const {
   return ThisType;
 }
 
+/**
+ * \copydoc Entity::get_default_animation_lod
+ *
+ * The sprites of the hero synchronize each other and drive its states:
+ * they always advance on time.
+ */
+AnimationLod Hero::get_default_animation_lod() const {
+  return AnimationLod::FULL;
+}
+
 /**
  * \brief Returns the item currently carried by the hero, if any.
  *
@@ -283,7 +294,7 @@ void Hero::update_ground_effects() {
         if (get_distance(last_solid_ground_coords) >= 8) {
           // too far from the solid ground: make the hero fall
           set_walking_speed(normal_walking_speed);
-          set_state(std::make_shared<FallingState>(*this));
+          set_state(make_pooled<FallingState>(*this));
         }
         else {
           // not too far yet
@@ -402,7 +413,7 @@ void Hero::apply_additional_ground_movement() {
     if (get_ground_below() == Ground::HOLE) {
       // the hero cannot be moved towards the direction previously calculated
       set_walking_speed(normal_walking_speed);
-      set_state(std::make_shared<FallingState>(*this));
+      set_state(make_pooled<FallingState>(*this));
     }
   }
 }
@@ -429,6 +440,13 @@ void Hero::built_in_draw(Camera& /* camera */) {
   get_state()->draw_on_map();
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool Hero::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 /**
  * \brief This function is called when a low-level input event occurs.
  * \param event The event to handle.
@@ -773,9 +791,8 @@ void Hero::place_on_destination(Map& map, const Rectangle& previous_map_location
       last_solid_ground_layer = get_layer();
 
       // Remove boomerangs in case the map remains the same.
-      const std::set<std::shared_ptr<Boomerang>>& boomerangs =
-          map.get_entities().get_entities_by_type<Boomerang>();
-      for (const std::shared_ptr<Boomerang>& boomerang : boomerangs) {
+      for (const std::shared_ptr<Boomerang>& boomerang :
+          map.get_entities().get_entities_by_type<Boomerang>()) {
         boomerang->remove_from_map();
       }
 
@@ -786,7 +803,7 @@ void Hero::place_on_destination(Map& map, const Rectangle& previous_map_location
       const std::shared_ptr<const Stairs> stairs = get_stairs_overlapping();
       if (stairs != nullptr) {
         // The hero arrived on the map by stairs.
-        set_state(std::make_shared<StairsState>(*this, stairs, Stairs::REVERSE_WAY));
+        set_state(make_pooled<StairsState>(*this, stairs, Stairs::REVERSE_WAY));
       }
       else {
         // The hero arrived on the map by a usual destination point.
@@ -918,9 +935,8 @@ bool Hero::is_on_raised_blocks() const {
  */
 std::shared_ptr<const Stairs> Hero::get_stairs_overlapping() const {
 
-  std::set<std::shared_ptr<const Stairs>> all_stairs =
-      get_entities().get_entities_by_type<Stairs>(get_layer());
-  for (const std::shared_ptr<const Stairs>& stairs: all_stairs) {
+  for (const std::shared_ptr<const Stairs>& stairs:
+      get_entities().get_entities_by_type<Stairs>(get_layer())) {
 
     if (overlaps(*stairs)) {
       return stairs;
@@ -1903,7 +1919,7 @@ void Hero::notify_collision_with_stairs(
     if (is_moving_towards(correct_direction / 2)) {
       std::shared_ptr<const Stairs> shared_stairs =
           std::static_pointer_cast<const Stairs>(stairs.shared_from_this());
-      set_state(std::make_shared<StairsState>(*this, shared_stairs, stairs_way));
+      set_state(make_pooled<StairsState>(*this, shared_stairs, stairs_way));
     }
   }
 }
@@ -2251,7 +2267,7 @@ void Hero::hurt(
     // Add the offset of the sprite if any.
     source_xy += source_sprite->get_xy();
   }
-  set_state(std::make_shared<HurtState>(*this, &source_xy, damage));
+  set_state(make_pooled<HurtState>(*this, &source_xy, damage));
 }
 
 /**
@@ -2262,7 +2278,7 @@ void Hero::hurt(
  */
 void Hero::hurt(const Point& source_xy, int damage) {
 
-  set_state(std::make_shared<HurtState>(*this, &source_xy, damage));
+  set_state(make_pooled<HurtState>(*this, &source_xy, damage));
 }
 
 /**
@@ -2272,7 +2288,7 @@ void Hero::hurt(const Point& source_xy, int damage) {
  */
 void Hero::hurt(int damage) {
 
-  set_state(std::make_shared<HurtState>(*this, nullptr, damage));
+  set_state(make_pooled<HurtState>(*this, nullptr, damage));
 }
 
 /**
@@ -2327,12 +2343,12 @@ void Hero::start_deep_water() {
   if (!get_state()->is_touching_ground()) {
     // Entering water from above the ground
     // (e.g. after a jump).
-    set_state(std::make_shared<PlungingState>(*this));
+    set_state(make_pooled<PlungingState>(*this));
   }
   else {
     // Entering water normally (e.g. by walking).
     if (can_swim) {
-      set_state(std::make_shared<SwimmingState>(*this));
+      set_state(make_pooled<SwimmingState>(*this));
     }
     else if (can_jump_over_water) {
       int direction8 = get_wanted_movement_direction8();
@@ -2342,7 +2358,7 @@ void Hero::start_deep_water() {
       start_jumping(direction8, 32, false, true);
     }
     else {
-      set_state(std::make_shared<PlungingState>(*this));
+      set_state(make_pooled<PlungingState>(*this));
     }
   }
 }
@@ -2355,7 +2371,7 @@ void Hero::start_hole() {
   if (!can_control_movement()) {
     // the player has no control (e.g. he is running or being hurt):
     // fall immediately
-    set_state(std::make_shared<FallingState>(*this));
+    set_state(make_pooled<FallingState>(*this));
   }
   else {
     // otherwise, push the hero towards the hole
@@ -2368,7 +2384,7 @@ void Hero::start_hole() {
     if (last_solid_ground_coords.x == -1 ||
         (last_solid_ground_coords == get_xy())) {
       // Fall immediately because the hero was not moving but directly placed on the hole.
-      set_state(std::make_shared<FallingState>(*this));
+      set_state(make_pooled<FallingState>(*this));
     }
     else {
       ground_dxy = { 0, 0 };
@@ -2415,7 +2431,7 @@ void Hero::start_ice() {
 void Hero::start_lava() {
 
   // plunge into the lava
-  set_state(std::make_shared<PlungingState>(*this));
+  set_state(make_pooled<PlungingState>(*this));
 }
 
 /**
@@ -2491,7 +2507,7 @@ bool Hero::is_grabbing_or_pulling() const {
  */
 void Hero::start_free() {
 
-  set_state(std::make_shared<FreeState>(*this));
+  set_state(make_pooled<FreeState>(*this));
 }
 
 /**
@@ -2514,10 +2530,10 @@ void Hero::start_free_carrying_loading_or_running() {
   }
 
   if (get_state()->is_carrying_item()) {
-    set_state(std::make_shared<CarryingState>(*this, get_state()->get_carried_object()));
+    set_state(make_pooled<CarryingState>(*this, get_state()->get_carried_object()));
   }
   else {
-    set_state(std::make_shared<FreeState>(*this));
+    set_state(make_pooled<FreeState>(*this));
   }
 }
 
@@ -2531,7 +2547,7 @@ void Hero::start_treasure(
     const Treasure& treasure,
     const ScopedLuaRef& callback_ref
 ) {
-  set_state(std::make_shared<TreasureState>(*this, treasure, callback_ref));
+  set_state(make_pooled<TreasureState>(*this, treasure, callback_ref));
 }
 
 /**
@@ -2547,7 +2563,7 @@ void Hero::start_treasure(
  * \param ignore_obstacles true to make the movement ignore obstacles
  */
 void Hero::start_forced_walking(const std::string& path, bool loop, bool ignore_obstacles) {
-  set_state(std::make_shared<ForcedWalkingState>(*this, path, loop, ignore_obstacles));
+  set_state(make_pooled<ForcedWalkingState>(*this, path, loop, ignore_obstacles));
 }
 
 /**
@@ -2566,7 +2582,7 @@ void Hero::start_jumping(
     bool ignore_obstacles,
     bool with_sound) {
 
-  set_state(std::make_shared<JumpingState>(
+  set_state(make_pooled<JumpingState>(
       *this,
       direction8,
       distance,
@@ -2580,7 +2596,7 @@ void Hero::start_jumping(
  * victory sequence finishes (possibly an empty ref).
  */
 void Hero::start_victory(const ScopedLuaRef& callback_ref) {
-  set_state(std::make_shared<VictoryState>(*this, callback_ref));
+  set_state(make_pooled<VictoryState>(*this, callback_ref));
 }
 
 /**
@@ -2591,7 +2607,7 @@ void Hero::start_victory(const ScopedLuaRef& callback_ref) {
  * You can call start_free() to unfreeze him.
  */
 void Hero::start_frozen() {
-  set_state(std::make_shared<FrozenState>(*this));
+  set_state(make_pooled<FrozenState>(*this));
 }
 
 /**
@@ -2599,7 +2615,7 @@ void Hero::start_frozen() {
  * \param item_to_lift The item to lift.
  */
 void Hero::start_lifting(const std::shared_ptr<CarriedObject>& item_to_lift) {
-  set_state(std::make_shared<LiftingState>(*this, item_to_lift));
+  set_state(make_pooled<LiftingState>(*this, item_to_lift));
 }
 
 /**
@@ -2617,7 +2633,7 @@ void Hero::start_running() {
     command = get_commands().is_command_pressed(GameCommand::ITEM_1) ?
         GameCommand::ITEM_1 : GameCommand::ITEM_2;
   }
-  set_state(std::make_shared<RunningState>(*this, command));
+  set_state(make_pooled<RunningState>(*this, command));
 }
 
 /**
@@ -2626,7 +2642,7 @@ void Hero::start_running() {
 void Hero::start_pushing() {
 
   get_equipment().notify_ability_used(Ability::PUSH);
-  set_state(std::make_shared<PushingState>(*this));
+  set_state(make_pooled<PushingState>(*this));
 }
 
 /**
@@ -2635,7 +2651,7 @@ void Hero::start_pushing() {
 void Hero::start_grabbing() {
 
   get_equipment().notify_ability_used(Ability::GRAB);
-  set_state(std::make_shared<GrabbingState>(*this));
+  set_state(make_pooled<GrabbingState>(*this));
 }
 
 /**
@@ -2644,7 +2660,7 @@ void Hero::start_grabbing() {
 void Hero::start_pulling() {
 
   get_equipment().notify_ability_used(Ability::PULL);
-  set_state(std::make_shared<PullingState>(*this));
+  set_state(make_pooled<PullingState>(*this));
 }
 
 /**
@@ -2764,7 +2780,7 @@ bool Hero::can_start_sword() const {
  * \brief Starts using the sword.
  */
 void Hero::start_sword() {
-  set_state(std::make_shared<SwordSwingingState>(*this));
+  set_state(make_pooled<SwordSwingingState>(*this));
 }
 
 /**
@@ -2772,7 +2788,7 @@ void Hero::start_sword() {
  * \param spin_attack_delay Delay before allowing the spin attack (-1 means never).
  */
 void Hero::start_sword_loading(int spin_attack_delay) {
-  set_state(std::make_shared<SwordLoadingState>(*this, spin_attack_delay));
+  set_state(make_pooled<SwordLoadingState>(*this, spin_attack_delay));
 }
 
 /**
@@ -2814,7 +2830,7 @@ void Hero::start_item(EquipmentItem& item) {
   Debug::check_assertion(can_start_item(item),
       std::string("The hero cannot start using item '")
       + item.get_name() + "' now");
-  set_state(std::make_shared<UsingItemState>(*this, item));
+  set_state(make_pooled<UsingItemState>(*this, item));
 }
 
 /**
@@ -2829,7 +2845,7 @@ void Hero::start_boomerang(int max_distance, int speed,
     const std::string& tunic_preparing_animation,
     const std::string& sprite_name) {
 
-  set_state(std::make_shared<BoomerangState>(*this, max_distance, speed,
+  set_state(make_pooled<BoomerangState>(*this, max_distance, speed,
       tunic_preparing_animation, sprite_name));
 }
 
@@ -2837,14 +2853,14 @@ void Hero::start_boomerang(int max_distance, int speed,
  * \brief Starts shooting an arrow with a bow.
  */
 void Hero::start_bow() {
-  set_state(std::make_shared<BowState>(*this));
+  set_state(make_pooled<BowState>(*this));
 }
 
 /**
  * \brief Starts shooting the hookshot.
  */
 void Hero::start_hookshot() {
-  set_state(std::make_shared<HookshotState>(*this));
+  set_state(make_pooled<HookshotState>(*this));
 }
 
 /**
@@ -2857,7 +2873,7 @@ void Hero::start_hookshot() {
 void Hero::start_back_to_solid_ground(bool use_specified_position,
     uint32_t end_delay, bool with_sound) {
 
-  set_state(std::make_shared<BackToSolidGroundState>(
+  set_state(make_pooled<BackToSolidGroundState>(
               *this, use_specified_position, end_delay, with_sound));
 }
 
@@ -2884,24 +2900,24 @@ void Hero::start_state_from_ground() {
   case Ground::DEEP_WATER:
     if (get_state()->is_touching_ground()
         && get_equipment().has_ability(Ability::SWIM)) {
-      set_state(std::make_shared<SwimmingState>(*this));
+      set_state(make_pooled<SwimmingState>(*this));
     }
     else {
-      set_state(std::make_shared<PlungingState>(*this));
+      set_state(make_pooled<PlungingState>(*this));
     }
     break;
 
   case Ground::HOLE:
-    set_state(std::make_shared<FallingState>(*this));
+    set_state(make_pooled<FallingState>(*this));
     break;
 
   case Ground::LAVA:
-    set_state(std::make_shared<PlungingState>(*this));
+    set_state(make_pooled<PlungingState>(*this));
     break;
 
   case Ground::PRICKLE:
     // There is no specific state for prickles (yet?).
-    set_state(std::make_shared<FreeState>(*this));
+    set_state(make_pooled<FreeState>(*this));
     start_prickle(0);
     break;
 
@@ -242,6 +242,13 @@ void Hookshot::built_in_draw(Camera& camera) {
   }
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool Hookshot::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 /**
  * \brief Returns whether the hookshot is currently flying.
  * \return true if the hookshot was shot, is not going back and has not reached any target yet
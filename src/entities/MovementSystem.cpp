@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/MovementSystem.h"
+#include "solarus/movements/Movement.h"
+
+namespace Solarus {
+
+/**
+ * \brief Returns whether entities of a type may have their movement
+ * updated before their own update.
+ *
+ * This is the case when update() does nothing before Entity::update(),
+ * so that updating the movement first keeps the behavior of the entity.
+ *
+ * \param type A type of entity.
+ * \return \c true if the movement of these entities can be updated first.
+ */
+bool MovementSystem::is_early_update_allowed(EntityType type) {
+
+  switch (type) {
+
+  // update() does something before Entity::update().
+  case EntityType::TILE:
+  case EntityType::CHEST:
+  case EntityType::CRYSTAL:
+  case EntityType::CRYSTAL_BLOCK:
+  // Updated separately.
+  case EntityType::CAMERA:
+  case EntityType::HERO:
+    return false;
+
+  default:
+    return true;
+  }
+}
+
+/**
+ * \brief Adds the movement of an entity to update at this cycle.
+ *
+ * Does nothing if the entity has no running movement.
+ *
+ * \param entity The entity.
+ */
+void MovementSystem::add(Entity& entity) {
+
+  Movement* movement = entity.get_movement().get();
+  if (movement == nullptr ||
+      movement->is_suspended() ||
+      movement->is_finished()) {
+    return;
+  }
+
+  const std::type_info& type = typeid(*movement);
+  if (last_group >= groups.size() || *groups[last_group].type != type) {
+    // Consecutive entities often have the same type of movement.
+    last_group = 0;
+    while (last_group < groups.size() && *groups[last_group].type != type) {
+      ++last_group;
+    }
+    if (last_group == groups.size()) {
+      groups.push_back({ &type, {} });
+    }
+  }
+  groups[last_group].entries.push_back({ &entity, movement });
+}
+
+/**
+ * \brief Updates the movements added since the last call to finish().
+ *
+ * Movements changed or removed meanwhile by scripts are skipped:
+ * their entity will update them normally.
+ *
+ * \return The number of movements updated.
+ */
+int MovementSystem::update() {
+
+  int num_updated = 0;
+  for (const Group& group : groups) {
+    for (const Entry& entry : group.entries) {
+      Entity& entity = *entry.entity;
+      if (entity.is_being_removed() ||
+          entity.get_movement().get() != entry.movement) {
+        continue;
+      }
+      entity.update_movement_early();
+      ++num_updated;
+    }
+  }
+  return num_updated;
+}
+
+/**
+ * \brief Ends the cycle.
+ *
+ * Entities that were not updated after their movement forget it,
+ * so that their next update does not skip their movement.
+ * This should be called before entities removed at this cycle are destroyed.
+ */
+void MovementSystem::finish() {
+
+  for (Group& group : groups) {
+    for (const Entry& entry : group.entries) {
+      entry.entity->clear_movement_updated_early();
+    }
+    group.entries.clear();
+  }
+}
+
+}
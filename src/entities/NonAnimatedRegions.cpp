@@ -14,16 +14,26 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/System.h"
 #include "solarus/entities/Camera.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Surface.h"
+#include <algorithm>
 
 namespace Solarus {
 
+constexpr int NonAnimatedRegions::max_cell_rebuilds_per_frame;
+constexpr size_t NonAnimatedRegions::cell_cache_budget;
+constexpr uint64_t NonAnimatedRegions::prefetch_time_budget;
+constexpr size_t NonAnimatedRegions::saved_cells_budget;
+std::list<NonAnimatedRegions::SavedCells> NonAnimatedRegions::saved_cells;
+int NonAnimatedRegions::max_saved_maps = 2;
+
 /**
  * \brief Constructor.
  * \param map The map. Its size must be known.
@@ -32,18 +42,34 @@ namespace Solarus {
 NonAnimatedRegions::NonAnimatedRegions(Map& map, int layer):
   map(map),
   layer(layer),
-  non_animated_tiles(map.get_size(), Size(512, 256)) {
+  tiles_hash(0),
+  non_animated_tiles(map.get_size(), Size(512, 256), ArenaAllocator<TileInfo>(map.get_arena())),
+  num_frames(0),
+  previous_camera_xy(),
+  previous_camera_xy_known(false),
+  opaque_squares_outdated(false) {
 
 }
 
 /**
  * \brief Adds a tile to the list of tiles.
+ *
+ * Non-animated tiles may cover a rectangle of several times their pattern:
+ * they are split only where they overlap animated tiles.
+ *
+ * \param tile The tile to add.
  */
 void NonAnimatedRegions::add_tile(const TileInfo& tile) {
 
   Debug::check_assertion(are_squares_animated.empty(),
       "Tile regions are already built");
   Debug::check_assertion(tile.layer == layer, "Wrong layer for add tile");
+  const Size& pattern_size = tile.pattern->get_size();
+  Debug::check_assertion(
+      tile.box.get_width() % pattern_size.width == 0 &&
+      tile.box.get_height() % pattern_size.height == 0 &&
+      (!tile.pattern->is_animated() || tile.box.get_size() == pattern_size),
+      "Tile size must be a multiple of its pattern size");
 
   tiles.push_back(tile);
 }
@@ -99,7 +125,7 @@ void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
     if (!tile.pattern->is_animated()) {
       non_animated_tiles.add(tile, tile.box);
       if (overlaps_animated_tile(tile)) {
-        rejected_tiles.push_back(tile);
+        reject_overlapping_parts(tile, rejected_tiles);
       }
     }
     else {
@@ -107,18 +133,327 @@ void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
     }
   }
 
+  // Remember the cells to redraw when the tileset of the map changes.
+  are_cells_using_map_tileset.assign(non_animated_tiles.get_num_cells(), false);
+  for (size_t i = 0; i < non_animated_tiles.get_num_cells(); ++i) {
+    for (const TileInfo& tile : non_animated_tiles.get_elements(i)) {
+      if (tile.tileset == nullptr) {
+        are_cells_using_map_tileset[i] = true;
+        break;
+      }
+    }
+  }
+
+  // Identify the tiles, to know later if saved cells can be restored.
+  std::string tiles_key = map.get_tileset_id();
+  for (const TileInfo& tile : tiles) {
+    tiles_key += '\n';
+    tiles_key += std::to_string(tile.box.get_x()) + ',' +
+        std::to_string(tile.box.get_y()) + ',' +
+        std::to_string(tile.box.get_width()) + ',' +
+        std::to_string(tile.box.get_height()) + ',' +
+        tile.pattern_id;
+    if (tile.tileset != nullptr) {
+      tiles_key += ',' + tile.tileset->get_id();
+    }
+  }
+  tiles_hash = get_fnv1a_hash(tiles_key.data(), tiles_key.size());
+  built_tileset_id = map.get_tileset_id();
+
   // No need to keep all tiles at this point.
   // Just keep the non-animated ones to draw them lazily.
   tiles.clear();
 }
 
 /**
- * \brief Clears previous drawings because the tileset has changed.
+ * \brief Takes the cells saved when this layer of the map was last left,
+ * if its tiles are still the same.
+ *
+ * Must be called from the main thread after build().
  */
-void NonAnimatedRegions::notify_tileset_changed() {
+void NonAnimatedRegions::restore_cells() {
+
+  for (auto it = saved_cells.begin(); it != saved_cells.end(); ++it) {
+    if (it->map_id != map.get_id() || it->layer != layer) {
+      continue;
+    }
+    if (it->tiles_hash == tiles_hash) {
+      optimized_tiles_surfaces = std::move(it->cells);
+      for (auto& kvp : optimized_tiles_surfaces) {
+        kvp.second.last_visible_frame = 0;
+      }
+    }
+    saved_cells.erase(it);
+    return;
+  }
+}
+
+/**
+ * \brief Saves the drawn cells so that they can be restored if the map
+ * is entered again soon.
+ *
+ * Called when the map is left.
+ * Cells are not saved if the tileset of the map was changed, and the oldest
+ * saved cells are forgotten beyond max_saved_maps maps or
+ * saved_cells_budget bytes.
+ */
+void NonAnimatedRegions::save_cells() {
+
+  if (max_saved_maps <= 0 ||
+      optimized_tiles_surfaces.empty() ||
+      map.get_tileset_id() != built_tileset_id) {
+    return;
+  }
+
+  for (int cell_index : outdated_cells) {
+    optimized_tiles_surfaces.erase(cell_index);
+  }
+  outdated_cells.clear();
+
+  for (auto it = saved_cells.begin(); it != saved_cells.end(); ++it) {
+    if (it->map_id == map.get_id() && it->layer == layer) {
+      saved_cells.erase(it);
+      break;
+    }
+  }
 
+  SavedCells saved;
+  saved.map_id = map.get_id();
+  saved.layer = layer;
+  saved.tiles_hash = tiles_hash;
+  saved.bytes = optimized_tiles_surfaces.size() * get_cell_bytes();
+  saved.cells = std::move(optimized_tiles_surfaces);
   optimized_tiles_surfaces.clear();
-  // Everything will be redrawn when necessary.
+  saved_cells.push_front(std::move(saved));
+
+  set_max_saved_maps(max_saved_maps);
+}
+
+/**
+ * \brief Returns the number of recently left maps whose cells are saved.
+ * \return The number of maps.
+ */
+int NonAnimatedRegions::get_max_saved_maps() {
+  return max_saved_maps;
+}
+
+/**
+ * \brief Sets the number of recently left maps whose cells are saved.
+ *
+ * Cells of older maps are forgotten.
+ *
+ * \param max_saved_maps The number of maps. 0 saves no cells.
+ */
+void NonAnimatedRegions::set_max_saved_maps(int max_saved_maps) {
+
+  NonAnimatedRegions::max_saved_maps = max_saved_maps;
+
+  std::vector<std::string> map_ids;
+  size_t bytes = 0;
+  for (auto it = saved_cells.begin(); it != saved_cells.end();) {
+    if (std::find(map_ids.begin(), map_ids.end(), it->map_id) == map_ids.end()) {
+      map_ids.push_back(it->map_id);
+    }
+    bytes += it->bytes;
+    if (static_cast<int>(map_ids.size()) > max_saved_maps || bytes > saved_cells_budget) {
+      it = saved_cells.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * \brief Forgets all saved cells.
+ *
+ * Called when tilesets change or when the video system stops.
+ */
+void NonAnimatedRegions::clear_saved_cells() {
+  saved_cells.clear();
+}
+
+/**
+ * \brief Marks the drawn cells that use the tileset of the map as outdated.
+ *
+ * They will be redrawn progressively when they are visible.
+ * Other cells are kept as is.
+ */
+void NonAnimatedRegions::notify_tileset_changed() {
+
+  for (const auto& kvp : optimized_tiles_surfaces) {
+    const int cell_index = kvp.first;
+    if (are_cells_using_map_tileset[cell_index]) {
+      outdated_cells.insert(cell_index);
+    }
+  }
+  opaque_squares_outdated = true;
+}
+
+/**
+ * \brief Returns the 8x8 squares of this layer fully covered by opaque
+ * non-animated tiles.
+ *
+ * Squares are computed the first time and after the tileset changes.
+ * Squares of outdated cells are never opaque, because these cells may
+ * still show the previous tileset.
+ *
+ * Must be called from the main thread after build().
+ *
+ * \return Whether each 8x8 square of the map is opaque, in row-major order.
+ */
+const std::vector<bool>& NonAnimatedRegions::get_opaque_squares() {
+
+  if (are_squares_opaque.empty() || opaque_squares_outdated) {
+    build_opaque_squares();
+  }
+  return are_squares_opaque;
+}
+
+/**
+ * \brief Computes the 8x8 squares fully covered by opaque non-animated tiles.
+ */
+void NonAnimatedRegions::build_opaque_squares() {
+
+  const int map_width8 = map.get_width8();
+  const int map_height8 = map.get_height8();
+  are_squares_opaque.assign(map_width8 * map_height8, false);
+  opaque_squares_outdated = false;
+
+  for (size_t i = 0; i < non_animated_tiles.get_num_cells(); ++i) {
+    const int cell_index = static_cast<int>(i);
+    if (outdated_cells.find(cell_index) != outdated_cells.end()) {
+      continue;
+    }
+
+    const Rectangle cell_box = get_cell_box(cell_index);
+    for (const TileInfo& tile : non_animated_tiles.get_elements(i)) {
+      if (tile.box.get_x() % 8 != 0 ||
+          tile.box.get_y() % 8 != 0 ||
+          !tile.pattern->is_drawn_at_its_position()) {
+        continue;
+      }
+
+      const Tileset* tileset = tile.tileset != nullptr ? tile.tileset : &map.get_tileset();
+      Debug::check_assertion(tileset != nullptr, "Missing tileset");
+      const std::vector<bool>* pattern_squares = tile.pattern->get_opaque_squares(*tileset);
+      if (pattern_squares == nullptr) {
+        continue;
+      }
+
+      // Only look at the part of the tile in this cell:
+      // other parts may be in outdated cells.
+      const int pattern_width8 = tile.pattern->get_width() / 8;
+      const int pattern_height8 = tile.pattern->get_height() / 8;
+      const Rectangle box = tile.box & cell_box;
+      for (int y = box.get_y(); y < box.get_y() + box.get_height(); y += 8) {
+        const int y8 = y / 8;
+        if (y8 < 0 || y8 >= map_height8) {
+          continue;
+        }
+        const int pattern_y8 = ((y - tile.box.get_y()) / 8) % pattern_height8;
+        for (int x = box.get_x(); x < box.get_x() + box.get_width(); x += 8) {
+          const int x8 = x / 8;
+          if (x8 < 0 || x8 >= map_width8) {
+            continue;
+          }
+          const int pattern_x8 = ((x - tile.box.get_x()) / 8) % pattern_width8;
+          if ((*pattern_squares)[pattern_y8 * pattern_width8 + pattern_x8]) {
+            are_squares_opaque[y8 * map_width8 + x8] = true;
+          }
+        }
+      }
+    }
+  }
+
+  // Animated squares are erased from the cells.
+  for (size_t i = 0; i < are_squares_opaque.size(); ++i) {
+    if (are_squares_animated[i]) {
+      are_squares_opaque[i] = false;
+    }
+  }
+}
+
+/**
+ * \brief Sets the 8x8 squares hidden by opaque tiles of higher layers.
+ *
+ * Cells whose squares are all hidden are not drawn.
+ *
+ * \param occluded_squares Whether each 8x8 square of the map is hidden,
+ * in row-major order, or an empty vector to draw all cells.
+ */
+void NonAnimatedRegions::set_occluded_squares(const std::vector<bool>& occluded_squares) {
+
+  are_cells_occluded.clear();
+  if (occluded_squares.empty()) {
+    return;
+  }
+
+  const int map_width8 = map.get_width8();
+  const Rectangle map_box(map.get_size());
+  are_cells_occluded.assign(non_animated_tiles.get_num_cells(), false);
+  for (size_t i = 0; i < non_animated_tiles.get_num_cells(); ++i) {
+    const Rectangle box = get_cell_box(static_cast<int>(i)) & map_box;
+    bool occluded = true;
+    for (int y = box.get_y(); y < box.get_y() + box.get_height() && occluded; y += 8) {
+      for (int x = box.get_x(); x < box.get_x() + box.get_width(); x += 8) {
+        if (!occluded_squares[(y / 8) * map_width8 + (x / 8)]) {
+          occluded = false;
+          break;
+        }
+      }
+    }
+    are_cells_occluded[i] = occluded;
+  }
+}
+
+/**
+ * \brief Returns the rectangle of the map covered by a cell.
+ * \param cell_index Index of a cell.
+ * \return The rectangle of the cell, possibly exceeding the map border.
+ */
+Rectangle NonAnimatedRegions::get_cell_box(int cell_index) const {
+
+  const int row = cell_index / non_animated_tiles.get_num_columns();
+  const int column = cell_index % non_animated_tiles.get_num_columns();
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  return Rectangle(
+      Point(column * cell_size.width, row * cell_size.height),
+      cell_size
+  );
+}
+
+/**
+ * \brief Rejects the parts of a repeated tile that overlap animated tiles.
+ *
+ * Rejected parts have the size of the pattern, so that a big rectangle of
+ * tiles does not have to be redrawn at each frame because of one small
+ * animated tile.
+ *
+ * \param tile A non-animated tile overlapping animated tiles.
+ * \param[out] rejected_tiles The list where to add the rejected parts.
+ */
+void NonAnimatedRegions::reject_overlapping_parts(
+    const TileInfo& tile, std::vector<TileInfo>& rejected_tiles) const {
+
+  const Size& pattern_size = tile.pattern->get_size();
+  if (tile.box.get_size() == pattern_size) {
+    rejected_tiles.push_back(tile);
+    return;
+  }
+
+  const int x = tile.box.get_x();
+  const int y = tile.box.get_y();
+  TileInfo part = tile;
+  part.box.set_size(pattern_size);
+  for (int current_y = y; current_y < y + tile.box.get_height(); current_y += pattern_size.height) {
+    for (int current_x = x; current_x < x + tile.box.get_width(); current_x += pattern_size.width) {
+      part.box.set_xy(current_x, current_y);
+      if (overlaps_animated_tile(part)) {
+        rejected_tiles.push_back(part);
+      }
+    }
+  }
 }
 
 /**
@@ -154,43 +489,6 @@ bool NonAnimatedRegions::overlaps_animated_tile(const TileInfo& tile) const {
   return false;
 }
 
-/**
- * \brief Called at each frame of the main loop.
- */
-void NonAnimatedRegions::update() {
-
-  // Limit the size of the cache to avoid growing the memory usage.
-  if (optimized_tiles_surfaces.size() < 25) {
-    return;
-  }
-
-  std::vector<int> indexes_to_clear;
-  const CameraPtr& camera = map.get_camera();
-  if (camera == nullptr) {
-    return;
-  }
-
-  const Size& cell_size = non_animated_tiles.get_cell_size();
-  const Rectangle& camera_position = camera->get_bounding_box();
-  const int row1 = camera_position.get_y() / cell_size.height;
-  const int row2 = (camera_position.get_y() + camera_position.get_height()) / cell_size.height;
-  const int column1 = camera_position.get_x() / cell_size.width;
-  const int column2 = (camera_position.get_x() + camera_position.get_width()) / cell_size.width;
-
-  for (const auto& kvp : optimized_tiles_surfaces) {
-    const int cell_index = kvp.first;
-    const int row = cell_index / non_animated_tiles.get_num_columns();
-    const int column = cell_index % non_animated_tiles.get_num_columns();
-    if (column < column1 || column > column2 || row < row1 || row > row2) {
-      indexes_to_clear.push_back(cell_index);
-    }
-  }
-
-  for (int cell_index : indexes_to_clear) {
-    optimized_tiles_surfaces.erase(cell_index);
-  }
-}
-
 /**
  * \brief Draws a layer of non-animated regions of tiles on the current map.
  */
@@ -200,12 +498,14 @@ void NonAnimatedRegions::draw_on_map() {
   if (camera == nullptr) {
     return;
   }
+  ++num_frames;
 
   // Check all grid cells that overlap the camera.
   const int num_rows = non_animated_tiles.get_num_rows();
   const int num_columns = non_animated_tiles.get_num_columns();
   const Size& cell_size = non_animated_tiles.get_cell_size();
   const Rectangle& camera_position = camera->get_bounding_box();
+  const Rectangle map_box(map.get_size());
 
   const int row1 = camera_position.get_y() / cell_size.height;
   const int row2 = (camera_position.get_y() + camera_position.get_height()) / cell_size.height;
@@ -217,6 +517,7 @@ void NonAnimatedRegions::draw_on_map() {
     return;
   }
 
+  int num_rebuilds = 0;
   for (int i = row1; i <= row2; ++i) {
     if (i < 0 || i >= num_rows) {
       continue;
@@ -227,12 +528,25 @@ void NonAnimatedRegions::draw_on_map() {
         continue;
       }
 
-      // Make sure this cell is built.
       int cell_index = i * num_columns + j;
+      if (!are_cells_occluded.empty() &&
+          are_cells_occluded[cell_index] &&
+          map_box.contains(get_cell_box(cell_index) & camera_position)) {
+        // Hidden by opaque tiles of higher layers.
+        continue;
+      }
+
+      // Make sure this cell is built.
       if (optimized_tiles_surfaces.find(cell_index) == optimized_tiles_surfaces.end()) {
         // Lazily build the cell.
         build_cell(cell_index);
       }
+      else if (num_rebuilds < max_cell_rebuilds_per_frame &&
+          outdated_cells.find(cell_index) != outdated_cells.end()) {
+        // Redraw an outdated cell, the other ones will wait for next frames.
+        build_cell(cell_index);
+        ++num_rebuilds;
+      }
 
       const Point cell_xy = {
           j * cell_size.width,
@@ -240,15 +554,122 @@ void NonAnimatedRegions::draw_on_map() {
       };
 
       const Point dst_position = cell_xy - camera_position.get_xy();
-      optimized_tiles_surfaces.at(cell_index)->draw(
-          map.get_camera_surface(), dst_position
-      );
+      CachedCell& cell = optimized_tiles_surfaces.at(cell_index);
+      cell.last_visible_frame = num_frames;
+      cell.surface->draw(map.get_camera_surface(), dst_position);
     }
   }
+
+  // Get ready for the next cells to become visible.
+  prefetch_cells(camera_position);
+
+  // Limit the size of the cache to avoid growing the memory usage.
+  remove_old_cells();
+}
+
+/**
+ * \brief Draws in advance the cells that the camera is moving to.
+ *
+ * The cells drawn are those up to one cell away from the camera
+ * in its direction of motion, until prefetch_time_budget is elapsed.
+ *
+ * \param camera_position Current position of the camera.
+ */
+void NonAnimatedRegions::prefetch_cells(const Rectangle& camera_position) {
+
+  const Point& camera_xy = camera_position.get_xy();
+  const Point motion = previous_camera_xy_known ?
+      camera_xy - previous_camera_xy : Point();
+  previous_camera_xy = camera_xy;
+  previous_camera_xy_known = true;
+
+  if (motion.x == 0 && motion.y == 0) {
+    return;
+  }
+
+  // Extend the camera rectangle on the sides it is moving to.
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  Rectangle ahead = camera_position;
+  if (motion.x < 0) {
+    ahead.set_x(ahead.get_x() - cell_size.width);
+  }
+  if (motion.x != 0) {
+    ahead.set_width(ahead.get_width() + cell_size.width);
+  }
+  if (motion.y < 0) {
+    ahead.set_y(ahead.get_y() - cell_size.height);
+  }
+  if (motion.y != 0) {
+    ahead.set_height(ahead.get_height() + cell_size.height);
+  }
+
+  const int num_rows = non_animated_tiles.get_num_rows();
+  const int num_columns = non_animated_tiles.get_num_columns();
+  const int row1 = std::max(0, ahead.get_y() / cell_size.height);
+  const int row2 = std::min(num_rows - 1, (ahead.get_y() + ahead.get_height()) / cell_size.height);
+  const int column1 = std::max(0, ahead.get_x() / cell_size.width);
+  const int column2 = std::min(num_columns - 1, (ahead.get_x() + ahead.get_width()) / cell_size.width);
+
+  const uint64_t start_date = System::get_real_time_us();
+  for (int i = row1; i <= row2; ++i) {
+    for (int j = column1; j <= column2; ++j) {
+      const int cell_index = i * num_columns + j;
+      if (optimized_tiles_surfaces.find(cell_index) != optimized_tiles_surfaces.end()) {
+        continue;
+      }
+      if (System::get_real_time_us() - start_date >= prefetch_time_budget) {
+        // The remaining cells will be drawn at next frames.
+        return;
+      }
+      build_cell(cell_index);
+      optimized_tiles_surfaces.at(cell_index).last_visible_frame = num_frames;
+    }
+  }
+}
+
+/**
+ * \brief Forgets the least recently visible cells until the cache
+ * fits in its budget.
+ *
+ * Cells visible at this frame are always kept.
+ */
+void NonAnimatedRegions::remove_old_cells() {
+
+  const size_t cell_bytes = get_cell_bytes();
+  while (optimized_tiles_surfaces.size() * cell_bytes > cell_cache_budget) {
+
+    auto oldest = optimized_tiles_surfaces.end();
+    for (auto it = optimized_tiles_surfaces.begin(); it != optimized_tiles_surfaces.end(); ++it) {
+      if (it->second.last_visible_frame < num_frames &&
+          (oldest == optimized_tiles_surfaces.end() ||
+           it->second.last_visible_frame < oldest->second.last_visible_frame)) {
+        oldest = it;
+      }
+    }
+    if (oldest == optimized_tiles_surfaces.end()) {
+      // All cells are visible.
+      return;
+    }
+    outdated_cells.erase(oldest->first);
+    optimized_tiles_surfaces.erase(oldest);
+  }
+}
+
+/**
+ * \brief Returns the video memory taken by the surface of a cell.
+ * \return The size of a cell surface in bytes.
+ */
+size_t NonAnimatedRegions::get_cell_bytes() const {
+
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  return static_cast<size_t>(cell_size.width) * cell_size.height * 4;
 }
 
 /**
  * \brief Draws all non-animated tiles of a cell on its surface.
+ *
+ * If the cell was already drawn, its surface is cleared and reused.
+ *
  * \param cell_index Index of the cell to draw.
  */
 void NonAnimatedRegions::build_cell(int cell_index) {
@@ -257,10 +678,6 @@ void NonAnimatedRegions::build_cell(int cell_index) {
       cell_index >= 0 && (size_t) cell_index < non_animated_tiles.get_num_cells(),
       "Wrong cell index"
   );
-  Debug::check_assertion(optimized_tiles_surfaces.find(cell_index) == optimized_tiles_surfaces.end(),
-      "This cell is already built"
-  );
-
   const int row = cell_index / non_animated_tiles.get_num_columns();
   const int column = cell_index % non_animated_tiles.get_num_columns();
 
@@ -271,10 +688,16 @@ void NonAnimatedRegions::build_cell(int cell_index) {
       row * cell_size.height
   };
 
-  SurfacePtr cell_surface = Surface::create(cell_size,true);
-  optimized_tiles_surfaces[cell_index] = cell_surface;
+  SurfacePtr& cell_surface = optimized_tiles_surfaces[cell_index].surface;
+  if (cell_surface == nullptr) {
+    cell_surface = Surface::create(cell_size, true);
+  }
+  else {
+    cell_surface->clear();
+  }
+  outdated_cells.erase(cell_index);
 
-  const std::vector<TileInfo>& tiles_in_cell =
+  const auto& tiles_in_cell =
       non_animated_tiles.get_elements(cell_index);
   for (const TileInfo& tile: tiles_in_cell) {
 
@@ -84,5 +84,14 @@ bool ParallaxScrollingTilePattern::is_drawn_at_its_position() const {
   return false;
 }
 
+/**
+ * \copydoc TilePattern::get_mesh_quad
+ */
+bool ParallaxScrollingTilePattern::get_mesh_quad(TileMesh::Quad& quad) const {
+  SimpleTilePattern::get_mesh_quad(quad);
+  quad.parallax = true;
+  return true;
+}
+
 }
 
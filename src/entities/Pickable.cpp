@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/EquipmentItem.h"
 #include "solarus/core/Game.h"
@@ -115,7 +116,7 @@ std::shared_ptr<Pickable> Pickable::create(
     return nullptr;
   }
 
-  std::shared_ptr<Pickable> pickable = std::make_shared<Pickable>(
+  std::shared_ptr<Pickable> pickable = make_pooled<Pickable>(
       name, layer, xy, treasure
   );
 
@@ -612,4 +613,11 @@ void Pickable::built_in_draw(Camera& camera) {
   Entity::built_in_draw(camera);
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool Pickable::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 }
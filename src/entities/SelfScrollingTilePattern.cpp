@@ -115,5 +115,14 @@ bool SelfScrollingTilePattern::is_animated() const {
   return true;
 }
 
+/**
+ * \copydoc TilePattern::get_mesh_quad
+ */
+bool SelfScrollingTilePattern::get_mesh_quad(TileMesh::Quad& quad) const {
+  SimpleTilePattern::get_mesh_quad(quad);
+  quad.self_scrolling = true;
+  return true;
+}
+
 }
 
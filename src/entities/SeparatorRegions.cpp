@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Point.h"
+#include "solarus/entities/Separator.h"
+#include "solarus/entities/SeparatorRegions.h"
+#include <algorithm>
+#include <limits>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the index of a grid line.
+ * \param lines Sorted coordinates of the grid lines.
+ * \param position Coordinate of the grid line to find.
+ * \return Its index.
+ */
+int get_grid_line_index(const std::vector<int>& lines, int position) {
+  return std::lower_bound(lines.begin(), lines.end(), position) - lines.begin();
+}
+
+/**
+ * \brief Returns the representative of a set of cells being merged.
+ * \param parents Parent of each cell.
+ * \param cell A cell.
+ * \return The cell representing its set.
+ */
+int find_root(std::vector<int>& parents, int cell) {
+
+  while (parents[cell] != cell) {
+    parents[cell] = parents[parents[cell]];
+    cell = parents[cell];
+  }
+  return cell;
+}
+
+}
+
+/**
+ * \brief Compares two separation lines by position.
+ * \param other Another line.
+ * \return \c true if this line comes first.
+ */
+bool SeparatorRegions::Line::operator<(const Line& other) const {
+
+  if (position != other.position) {
+    return position < other.position;
+  }
+  return start < other.start;
+}
+
+/**
+ * \brief Creates empty separator regions.
+ */
+SeparatorRegions::SeparatorRegions() {
+
+}
+
+/**
+ * \brief Indexes the separators of a map and computes its regions.
+ * \param map_size Size of the map.
+ * \param separators All separators of the map.
+ */
+void SeparatorRegions::build(
+    const Size& map_size,
+    const std::vector<const Separator*>& separators
+) {
+  vertical_lines.clear();
+  horizontal_lines.clear();
+  for (const Separator* separator : separators) {
+    if (separator->is_vertical()) {
+      vertical_lines.push_back({
+          separator->get_x() + 8,
+          separator->get_y(),
+          separator->get_y() + separator->get_height()
+      });
+    }
+    else {
+      horizontal_lines.push_back({
+          separator->get_y() + 8,
+          separator->get_x(),
+          separator->get_x() + separator->get_width()
+      });
+    }
+  }
+  std::sort(vertical_lines.begin(), vertical_lines.end());
+  std::sort(horizontal_lines.begin(), horizontal_lines.end());
+
+  build_regions(map_size);
+}
+
+/**
+ * \brief Returns the first line strictly after a position.
+ * \param lines Sorted separation lines.
+ * \param position A position on the axis of the lines.
+ * \return The first line whose position is greater.
+ */
+std::vector<SeparatorRegions::Line>::const_iterator SeparatorRegions::first_line_after(
+    const std::vector<Line>& lines,
+    int position
+) {
+  return std::upper_bound(lines.begin(), lines.end(), Line{ position, std::numeric_limits<int>::max(), 0 });
+}
+
+/**
+ * \brief Cuts the map into a grid along separators and merges the cells
+ * that are not separated.
+ * \param map_size Size of the map.
+ */
+void SeparatorRegions::build_regions(const Size& map_size) {
+
+  // Grid lines: map limits, separation lines and ends of separators.
+  grid_xs = { 0, map_size.width };
+  grid_ys = { 0, map_size.height };
+  for (const Line& line : vertical_lines) {
+    grid_xs.push_back(line.position);
+    grid_ys.push_back(line.start);
+    grid_ys.push_back(line.end);
+  }
+  for (const Line& line : horizontal_lines) {
+    grid_ys.push_back(line.position);
+    grid_xs.push_back(line.start);
+    grid_xs.push_back(line.end);
+  }
+  for (std::vector<int>* lines : { &grid_xs, &grid_ys }) {
+    const int max = lines == &grid_xs ? map_size.width : map_size.height;
+    for (int& position : *lines) {
+      position = std::min(std::max(position, 0), max);
+    }
+    std::sort(lines->begin(), lines->end());
+    lines->erase(std::unique(lines->begin(), lines->end()), lines->end());
+  }
+
+  const int num_columns = static_cast<int>(grid_xs.size()) - 1;
+  const int num_rows = static_cast<int>(grid_ys.size()) - 1;
+  cell_regions.clear();
+  regions.clear();
+  if (num_columns <= 0 || num_rows <= 0) {
+    return;
+  }
+
+  // Mark the cell borders covered by a separator.
+  std::vector<bool> right_blocked(num_columns * num_rows, false);
+  std::vector<bool> bottom_blocked(num_columns * num_rows, false);
+  for (const Line& line : vertical_lines) {
+    const int i = get_grid_line_index(grid_xs, line.position) - 1;
+    if (i < 0 || i >= num_columns - 1) {
+      continue;  // On a map limit.
+    }
+    const int end = get_grid_line_index(grid_ys, line.end);
+    for (int j = get_grid_line_index(grid_ys, line.start); j < end && j < num_rows; ++j) {
+      right_blocked[get_cell_index(i, j)] = true;
+    }
+  }
+  for (const Line& line : horizontal_lines) {
+    const int j = get_grid_line_index(grid_ys, line.position) - 1;
+    if (j < 0 || j >= num_rows - 1) {
+      continue;
+    }
+    const int end = get_grid_line_index(grid_xs, line.end);
+    for (int i = get_grid_line_index(grid_xs, line.start); i < end && i < num_columns; ++i) {
+      bottom_blocked[get_cell_index(i, j)] = true;
+    }
+  }
+
+  // Merge neighbor cells not separated.
+  std::vector<int> parents(num_columns * num_rows);
+  for (size_t cell = 0; cell < parents.size(); ++cell) {
+    parents[cell] = cell;
+  }
+  for (int j = 0; j < num_rows; ++j) {
+    for (int i = 0; i < num_columns; ++i) {
+      const int cell = get_cell_index(i, j);
+      if (i < num_columns - 1 && !right_blocked[cell]) {
+        parents[find_root(parents, get_cell_index(i + 1, j))] = find_root(parents, cell);
+      }
+      if (j < num_rows - 1 && !bottom_blocked[cell]) {
+        parents[find_root(parents, get_cell_index(i, j + 1))] = find_root(parents, cell);
+      }
+    }
+  }
+
+  // Number the regions in reading order of their first cell.
+  std::vector<int> root_regions(parents.size(), -1);
+  cell_regions.resize(parents.size());
+  for (int j = 0; j < num_rows; ++j) {
+    for (int i = 0; i < num_columns; ++i) {
+      const int cell = get_cell_index(i, j);
+      const int root = find_root(parents, cell);
+      const Rectangle cell_box(
+          grid_xs[i], grid_ys[j],
+          grid_xs[i + 1] - grid_xs[i], grid_ys[j + 1] - grid_ys[j]
+      );
+      if (root_regions[root] == -1) {
+        root_regions[root] = regions.size();
+        regions.push_back(cell_box);
+      }
+      else {
+        regions[root_regions[root]] |= cell_box;
+      }
+      cell_regions[cell] = root_regions[root];
+    }
+  }
+}
+
+/**
+ * \brief Returns the index of a cell of the grid.
+ * \param i Column of the cell.
+ * \param j Row of the cell.
+ * \return The cell index.
+ */
+int SeparatorRegions::get_cell_index(int i, int j) const {
+  return j * (static_cast<int>(grid_xs.size()) - 1) + i;
+}
+
+/**
+ * \brief Ensures that a rectangle does not cross separators.
+ * \param area The rectangle to check.
+ * \return A rectangle corresponding to the first one but stopping on separators.
+ */
+Rectangle SeparatorRegions::apply_separators(const Rectangle& area) const {
+
+  int x = area.get_x();  // Top-left corner.
+  int y = area.get_y();
+  const int width = area.get_width();
+  const int height = area.get_height();
+
+  // Only separation lines strictly inside the area can apply.
+  int adjusted_x = x;  // Updated coordinates after applying separators.
+  int adjusted_y = y;
+  std::vector<const Line*> applied_vertical_lines;
+  std::vector<const Line*> applied_horizontal_lines;
+  for (auto it = first_line_after(vertical_lines, x);
+      it != vertical_lines.end() && it->position < x + width;
+      ++it) {
+    const Line& line = *it;
+    if (line.start < y + height && y < line.end) {
+      int left = line.position - x;
+      int right = x + width - line.position;
+      if (left > right) {
+        adjusted_x = line.position - width;
+      }
+      else {
+        adjusted_x = line.position;
+      }
+      applied_vertical_lines.push_back(&line);
+    }
+  }
+  for (auto it = first_line_after(horizontal_lines, y);
+      it != horizontal_lines.end() && it->position < y + height;
+      ++it) {
+    const Line& line = *it;
+    if (line.start < x + width && x < line.end) {
+      int top = line.position - y;
+      int bottom = y + height - line.position;
+      if (top > bottom) {
+        adjusted_y = line.position - height;
+      }
+      else {
+        adjusted_y = line.position;
+      }
+      applied_horizontal_lines.push_back(&line);
+    }
+  }
+
+  bool must_adjust_x = true;
+  bool must_adjust_y = true;
+  if (adjusted_x != x && adjusted_y != y) {
+    // Both directions were modified. Maybe it is a T configuration where
+    // a separator deactivates another one.
+    must_adjust_x = false;
+    must_adjust_y = false;
+    for (const Line* line : applied_vertical_lines) {
+      if (line->start < adjusted_y + height && adjusted_y < line->end) {
+        must_adjust_x = true;
+      }
+    }
+    for (const Line* line : applied_horizontal_lines) {
+      if (line->start < adjusted_x + width && adjusted_x < line->end) {
+        must_adjust_y = true;
+      }
+    }
+  }
+
+  if (must_adjust_x) {
+    x = adjusted_x;
+  }
+  if (must_adjust_y) {
+    y = adjusted_y;
+  }
+
+  return Rectangle(x, y, width, height);
+}
+
+/**
+ * \brief Returns the number of regions of the map.
+ * \return The number of regions.
+ */
+int SeparatorRegions::get_num_regions() const {
+  return static_cast<int>(regions.size());
+}
+
+/**
+ * \brief Returns the region containing a point.
+ * \param xy A point in map coordinates.
+ * \return Index of its region, or -1 if the point is outside the map.
+ */
+int SeparatorRegions::get_region_index_at(const Point& xy) const {
+
+  if (cell_regions.empty() ||
+      xy.x < grid_xs.front() || xy.x >= grid_xs.back() ||
+      xy.y < grid_ys.front() || xy.y >= grid_ys.back()) {
+    return -1;
+  }
+
+  const int i = std::upper_bound(grid_xs.begin(), grid_xs.end(), xy.x) - grid_xs.begin() - 1;
+  const int j = std::upper_bound(grid_ys.begin(), grid_ys.end(), xy.y) - grid_ys.begin() - 1;
+  return cell_regions[get_cell_index(i, j)];
+}
+
+/**
+ * \brief Returns the regions overlapping a rectangle.
+ * \param[in] area A rectangle in map coordinates.
+ * \param[out] result Index of each region overlapping it, sorted
+ * and without duplicates.
+ */
+void SeparatorRegions::get_region_indices_in(
+    const Rectangle& area, std::vector<int>& result) const {
+
+  result.clear();
+  if (cell_regions.empty() || area.is_flat()) {
+    return;
+  }
+
+  const int min_i = std::max(0, static_cast<int>(
+      std::upper_bound(grid_xs.begin(), grid_xs.end(), area.get_x()) - grid_xs.begin()) - 1);
+  const int max_i = std::min(static_cast<int>(grid_xs.size()) - 2, static_cast<int>(
+      std::lower_bound(grid_xs.begin(), grid_xs.end(), area.get_x() + area.get_width()) - grid_xs.begin()) - 1);
+  const int min_j = std::max(0, static_cast<int>(
+      std::upper_bound(grid_ys.begin(), grid_ys.end(), area.get_y()) - grid_ys.begin()) - 1);
+  const int max_j = std::min(static_cast<int>(grid_ys.size()) - 2, static_cast<int>(
+      std::lower_bound(grid_ys.begin(), grid_ys.end(), area.get_y() + area.get_height()) - grid_ys.begin()) - 1);
+
+  for (int j = min_j; j <= max_j; ++j) {
+    for (int i = min_i; i <= max_i; ++i) {
+      result.push_back(cell_regions[get_cell_index(i, j)]);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+/**
+ * \brief Returns the bounding box of a region.
+ *
+ * Regions are rectangular when separators close them entirely.
+ *
+ * \param index Index of a region.
+ * \return The bounding box of this region.
+ */
+Rectangle SeparatorRegions::get_region(int index) const {
+  return regions[index];
+}
+
+}
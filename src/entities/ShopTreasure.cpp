@@ -233,5 +233,12 @@ void ShopTreasure::built_in_draw(Camera& camera) {
   Entity::built_in_draw(camera);
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool ShopTreasure::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 }
 
@@ -18,6 +18,7 @@
 #include "solarus/entities/SimpleTilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Surface.h"
+#include <cstdint>
 
 namespace Solarus {
 
@@ -64,5 +65,67 @@ bool SimpleTilePattern::is_animated() const {
   return false;
 }
 
+/**
+ * \copydoc TilePattern::get_mesh_quad
+ */
+bool SimpleTilePattern::get_mesh_quad(TileMesh::Quad& quad) const {
+  quad.region = position_in_tileset;
+  quad.parallax = false;
+  quad.self_scrolling = false;
+  return true;
+}
+
+/**
+ * \copydoc TilePattern::get_opaque_squares
+ *
+ * Squares are computed from the pixels of the tileset image the first time
+ * and computed again only if the tileset image changes.
+ * No square is opaque if the tileset image is not drawn with alpha blending
+ * and full opacity.
+ */
+const std::vector<bool>* SimpleTilePattern::get_opaque_squares(const Tileset& tileset) const {
+
+  const SurfacePtr& tiles_image = tileset.get_tiles_image();
+  if (is_animated() ||
+      tiles_image == nullptr ||
+      !Rectangle(tiles_image->get_size()).contains(position_in_tileset)) {
+    return nullptr;
+  }
+
+  if (opaque_squares_image.lock() == tiles_image) {
+    return &opaque_squares;
+  }
+
+  const int width8 = get_width() / 8;
+  const int height8 = get_height() / 8;
+  opaque_squares.assign(width8 * height8, false);
+  opaque_squares_image = tiles_image;
+  if (tiles_image->get_opacity() != 255 ||
+      (tiles_image->get_blend_mode() != BlendMode::BLEND &&
+       tiles_image->get_blend_mode() != BlendMode::NONE)) {
+    return &opaque_squares;
+  }
+
+  const int pitch = get_width() * 4;
+  std::vector<uint8_t> pixels(pitch * get_height());
+  tiles_image->get_impl().get_pixels(pixels.data(), pitch, position_in_tileset);
+  for (int i = 0; i < height8; ++i) {
+    for (int j = 0; j < width8; ++j) {
+      bool opaque = true;
+      for (int y = i * 8; y < i * 8 + 8 && opaque; ++y) {
+        const uint8_t* alpha = &pixels[y * pitch + j * 8 * 4 + 3];
+        for (int x = 0; x < 8; ++x) {
+          if (alpha[x * 4] != 255) {
+            opaque = false;
+            break;
+          }
+        }
+      }
+      opaque_squares[i * width8 + j] = opaque;
+    }
+  }
+  return &opaque_squares;
+}
+
 }
 
@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Map.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/entities/Entities.h"
 #include "solarus/entities/Stream.h"
 #include "solarus/entities/StreamAction.h"
 #include "solarus/graphics/Sprite.h"
@@ -42,7 +43,8 @@ Stream::Stream(
   speed(64),
   allow_movement(true),
   allow_attack(true),
-  allow_item(true) {
+  allow_item(true),
+  in_field(false) {
 
   set_collision_modes(CollisionMode::COLLISION_OVERLAPPING);
   set_origin(8, 13);
@@ -91,7 +93,12 @@ bool Stream::get_allow_movement() const {
  * this is a blocking stream.
  */
 void Stream::set_allow_movement(bool allow_movement) {
+
   this->allow_movement = allow_movement;
+  if (is_on_map()) {
+    // Only non-blocking streams can be in the stream field.
+    get_entities().notify_stream_changed(*this);
+  }
 }
 
 /**
@@ -126,6 +133,36 @@ void Stream::set_allow_item(bool allow_item) {
   this->allow_item = allow_item;
 }
 
+/**
+ * \brief Returns whether this stream is baked in the stream field of the map.
+ *
+ * Entities then find it by sampling the field at their ground point
+ * instead of by collision checks.
+ *
+ * \return \c true if this stream is in the stream field.
+ */
+bool Stream::is_in_field() const {
+  return in_field;
+}
+
+/**
+ * \brief Sets whether this stream is baked in the stream field of the map.
+ *
+ * This is called by the map entities when the stream is added to or
+ * removed from the field. A stream in the field is not a detector.
+ *
+ * \param in_field \c true if the stream is now in the stream field.
+ */
+void Stream::set_in_field(bool in_field) {
+
+  if (in_field == this->in_field) {
+    return;
+  }
+  this->in_field = in_field;
+  set_collision_modes(in_field ?
+      CollisionMode::COLLISION_NONE : CollisionMode::COLLISION_OVERLAPPING);
+}
+
 /**
  * \copydoc Entity::notify_direction_changed
  */
@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Map.h"
 #include "solarus/core/System.h"
+#include "solarus/entities/Entities.h"
 #include "solarus/entities/StreamAction.h"
 #include "solarus/entities/Stream.h"
 #include "solarus/graphics/Sprite.h"
@@ -186,7 +187,8 @@ void StreamAction::update() {
   const Point& ground_point = entity_moved->get_ground_point();
   if (
       stream->get_allow_movement() &&
-      !stream->overlaps(ground_point)  // We are no longer on the stream.
+      !stream->overlaps(ground_point) &&  // We are no longer on the stream.
+      !follow_stream_field(ground_point)  // And not on a similar one of the field.
   ) {
     // Blocking streams are more special.
     // The hero cannot escape them so we don't need this.
@@ -272,6 +274,39 @@ void StreamAction::update() {
   }
 }
 
+/**
+ * \brief Continues this action with the next stream of the stream field.
+ *
+ * When the entity leaves a stream of the field for another one of the field
+ * with the same properties, the action is kept and only its stream changes,
+ * so that crossing a large area of streams does not restart the action
+ * on each of them.
+ *
+ * \param ground_point Ground point of the entity moved.
+ * \return \c true if the entity is now moved by another stream.
+ */
+bool StreamAction::follow_stream_field(const Point& ground_point) {
+
+  if (!stream->is_in_field()) {
+    return false;
+  }
+
+  Stream* next_stream = entity_moved->get_entities().get_stream_field().get_stream(
+      stream->get_layer(), ground_point
+  );
+  if (next_stream == nullptr ||
+      next_stream == stream.get() ||
+      !next_stream->is_enabled() ||
+      next_stream->is_being_removed() ||
+      next_stream->get_allow_attack() != stream->get_allow_attack() ||
+      next_stream->get_allow_item() != stream->get_allow_item()) {
+    return false;
+  }
+
+  stream = std::static_pointer_cast<Stream>(next_stream->shared_from_this());
+  return true;
+}
+
 /**
  * \brief Returns whether the entity moved has finished to follow the stream.
  * \return \c true if the target point is reached.
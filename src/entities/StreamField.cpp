@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/Stream.h"
+#include "solarus/entities/StreamField.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty stream field.
+ * \param map_width8 Number of 8x8 squares in a row of the map.
+ * \param map_height8 Number of 8x8 squares in a column of the map.
+ */
+StreamField::StreamField(int map_width8, int map_height8):
+  map_width8(map_width8),
+  map_height8(map_height8),
+  squares(),
+  footprints() {
+
+}
+
+/**
+ * \brief Adds a stream to the field.
+ *
+ * Squares already covered by another stream are left unchanged.
+ *
+ * \param stream The stream to add. It must not be in the field already.
+ * \return \c false if the stream is not aligned on the grid or is outside
+ * the map: it was not added then.
+ */
+bool StreamField::add_stream(Stream& stream) {
+
+  const Rectangle& box = stream.get_bounding_box();
+  if (box.get_x() % 8 != 0 ||
+      box.get_y() % 8 != 0 ||
+      box.get_width() % 8 != 0 ||
+      box.get_height() % 8 != 0 ||
+      box.get_width() <= 0 ||
+      box.get_height() <= 0) {
+    return false;
+  }
+
+  const Footprint footprint = {
+      &stream,
+      stream.get_layer(),
+      box.get_x() / 8,
+      box.get_y() / 8,
+      box.get_width() / 8,
+      box.get_height() / 8
+  };
+  if (footprint.x8 < 0 ||
+      footprint.y8 < 0 ||
+      footprint.x8 + footprint.width8 > map_width8 ||
+      footprint.y8 + footprint.height8 > map_height8) {
+    return false;
+  }
+
+  footprints[&stream] = footprint;
+  fill(footprint);
+  return true;
+}
+
+/**
+ * \brief Removes a stream from the field if it is there.
+ *
+ * Squares it covered are given to other streams of the field that also
+ * cover them, if any.
+ *
+ * \param stream The stream to remove.
+ */
+void StreamField::remove_stream(const Stream& stream) {
+
+  const auto it = footprints.find(&stream);
+  if (it == footprints.end()) {
+    return;
+  }
+  const Footprint footprint = it->second;
+  footprints.erase(it);
+
+  std::vector<Stream*>& layer_squares = squares[footprint.layer];
+  for (int y8 = footprint.y8; y8 < footprint.y8 + footprint.height8; ++y8) {
+    for (int x8 = footprint.x8; x8 < footprint.x8 + footprint.width8; ++x8) {
+      Stream*& square = layer_squares[y8 * map_width8 + x8];
+      if (square == &stream) {
+        square = nullptr;
+      }
+    }
+  }
+
+  // Streams rarely change: a linear search is enough here.
+  for (const auto& kvp : footprints) {
+    const Footprint& other = kvp.second;
+    if (other.layer == footprint.layer &&
+        other.x8 < footprint.x8 + footprint.width8 &&
+        footprint.x8 < other.x8 + other.width8 &&
+        other.y8 < footprint.y8 + footprint.height8 &&
+        footprint.y8 < other.y8 + other.height8) {
+      fill(other);
+    }
+  }
+}
+
+/**
+ * \brief Removes all streams from the field.
+ */
+void StreamField::clear() {
+
+  squares.clear();
+  footprints.clear();
+}
+
+/**
+ * \brief Returns whether the field has no stream.
+ * \return \c true if no stream was added.
+ */
+bool StreamField::is_empty() const {
+  return footprints.empty();
+}
+
+/**
+ * \brief Returns the stream of the field at a point.
+ * \param layer A layer.
+ * \param xy A point of the map.
+ * \return The stream covering this point in the field, or nullptr.
+ */
+Stream* StreamField::get_stream(int layer, const Point& xy) const {
+
+  if (xy.x < 0 ||
+      xy.y < 0 ||
+      xy.x >= map_width8 * 8 ||
+      xy.y >= map_height8 * 8) {
+    return nullptr;
+  }
+
+  const auto it = squares.find(layer);
+  if (it == squares.end()) {
+    return nullptr;
+  }
+  return it->second[(xy.y / 8) * map_width8 + (xy.x / 8)];
+}
+
+/**
+ * \brief Gives to a stream the squares of its footprint that have no stream.
+ * \param footprint The squares of a stream of the field.
+ */
+void StreamField::fill(const Footprint& footprint) {
+
+  std::vector<Stream*>& layer_squares = squares[footprint.layer];
+  if (layer_squares.empty()) {
+    layer_squares.resize(map_width8 * map_height8, nullptr);
+  }
+  for (int y8 = footprint.y8; y8 < footprint.y8 + footprint.height8; ++y8) {
+    for (int x8 = footprint.x8; x8 < footprint.x8 + footprint.width8; ++x8) {
+      Stream*& square = layer_squares[y8 * map_width8 + x8];
+      if (square == nullptr) {
+        square = footprint.stream;
+      }
+    }
+  }
+}
+
+}
+
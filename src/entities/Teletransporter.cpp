@@ -17,15 +17,19 @@
 #include "solarus/audio/Sound.h"
 #include "solarus/entities/Hero.h"
 #include "solarus/entities/Teletransporter.h"
+#include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/lua/LuaContext.h"
 
 namespace Solarus {
 
+int Teletransporter::prefetch_distance = 64;
+
 /**
  * \brief Constructor.
  * \param name Name of the teletransporter.
@@ -60,7 +64,8 @@ Teletransporter::Teletransporter(
   destination_name(destination_name),
   destination_side(-1),
   transition_direction(0),
-  transporting_hero(false) {
+  transporting_hero(false),
+  destination_prefetched(false) {
 
   set_collision_modes(CollisionMode::COLLISION_CUSTOM);
 
@@ -169,6 +174,7 @@ const std::string& Teletransporter::get_destination_map_id() const {
  */
 void Teletransporter::set_destination_map_id(const std::string& map_id) {
   this->destination_map_id = map_id;
+  this->destination_prefetched = false;
 }
 
 /**
@@ -193,6 +199,74 @@ void Teletransporter::set_destination_name(const std::string& destination_name)
   this->destination_name = destination_name;
 }
 
+/**
+ * \brief Returns the distance below which teletransporters preload their
+ * destination map.
+ * \return The distance in pixels between the hero and teletransporters.
+ * 0 means that destination maps are not preloaded this way.
+ */
+int Teletransporter::get_prefetch_distance() {
+  return prefetch_distance;
+}
+
+/**
+ * \brief Sets the distance below which teletransporters preload their
+ * destination map.
+ * \param prefetch_distance The distance in pixels between the hero and
+ * teletransporters. 0 means that destination maps are not preloaded this way.
+ */
+void Teletransporter::set_prefetch_distance(int prefetch_distance) {
+
+  Debug::check_assertion(prefetch_distance >= 0, "Invalid prefetch distance");
+  Teletransporter::prefetch_distance = prefetch_distance;
+}
+
+/**
+ * \copydoc Entity::update
+ */
+void Teletransporter::update() {
+
+  Entity::update();
+
+  if (!destination_prefetched &&
+      prefetch_distance > 0 &&
+      is_enabled() &&
+      !is_suspended()) {
+    const Rectangle& bounding_box = get_bounding_box();
+    const Rectangle nearby(
+        bounding_box.get_x() - prefetch_distance,
+        bounding_box.get_y() - prefetch_distance,
+        bounding_box.get_width() + 2 * prefetch_distance,
+        bounding_box.get_height() + 2 * prefetch_distance
+    );
+    if (get_hero().overlaps(nearby)) {
+      prefetch_destination_map();
+    }
+  }
+}
+
+/**
+ * \brief Requests the destination map to be preloaded as soon as possible.
+ *
+ * Does nothing if the destination is the current map.
+ */
+void Teletransporter::prefetch_destination_map() {
+
+  destination_prefetched = true;
+
+  if (destination_map_id.empty() ||
+      destination_map_id == get_map().get_id() ||
+      !CurrentQuest::resource_exists(ResourceType::MAP, destination_map_id)) {
+    return;
+  }
+
+  get_game().get_resource_provider().preload(
+        ResourceType::MAP,
+        destination_map_id,
+        ResourceProvider::PreloadPriority::HIGH
+  );
+}
+
 /**
  * \brief Returns whether this teletransporter is on the side of the map.
  *
@@ -74,6 +74,13 @@ void Tile::built_in_draw(Camera& camera) {
   draw_on_surface(camera.get_surface(), camera.get_top_left_xy());
 }
 
+/**
+ * \copydoc Entity::is_drawn_with_sprites_only
+ */
+bool Tile::is_drawn_with_sprites_only() const {
+  return false;
+}
+
 /**
  * \brief Draws the tile on the specified surface.
  * \param dst_surface the destination surface
@@ -93,15 +100,22 @@ void Tile::draw_on_surface(const SurfacePtr& dst_surface, const Point& viewport)
       get_height()
   );
 
-  const Tileset* tileset = this->tileset != nullptr ? this->tileset : &get_map().get_tileset();
   tile_pattern->fill_surface(
       dst_surface,
       dst_position,
-      *tileset,
+      get_tileset(),
       viewport
   );
 }
 
+/**
+ * \brief Returns whether the pattern of this tile exists in its tileset.
+ * \return \c true if get_tile_pattern() can be called.
+ */
+bool Tile::has_tile_pattern() const {
+  return tile_pattern != nullptr;
+}
+
 /**
  * \brief Returns the pattern of this tile.
  * \return The tile pattern.
@@ -118,6 +132,14 @@ const std::string& Tile::get_tile_pattern_id() const {
   return tile_pattern_id;
 }
 
+/**
+ * \brief Returns the tileset of the pattern of this tile.
+ * \return The tileset of this tile, or the one of the map.
+ */
+const Tileset& Tile::get_tileset() const {
+  return tileset != nullptr ? *tileset : get_map().get_tileset();
+}
+
 /**
  * \brief Returns whether the pattern is animated.
  *
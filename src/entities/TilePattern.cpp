@@ -126,6 +126,45 @@ bool TilePattern::is_drawn_at_its_position() const {
   return true;
 }
 
+/**
+ * \brief Describes how tiles having this tile pattern are drawn in a tile mesh.
+ *
+ * Sets the region, parallax and self scrolling properties of \c quad.
+ * Returns false by default: such tiles have to be drawn one by one.
+ *
+ * \param quad The tile to describe.
+ * \return \c true if tiles having this pattern can be drawn in a tile mesh.
+ */
+bool TilePattern::get_mesh_quad(TileMesh::Quad& /* quad */) const {
+  return false;
+}
+
+/**
+ * \brief Returns how far the current image is from the region given by
+ * get_mesh_quad().
+ *
+ * Returns false by default: the region never changes.
+ *
+ * \param offset Set to the offset of the current frame.
+ * \return \c true if the region of this tile pattern changes over time.
+ */
+bool TilePattern::get_frame_offset(Point& /* offset */) const {
+  return false;
+}
+
+/**
+ * \brief Returns which 8x8 squares of this tile pattern are fully opaque.
+ *
+ * Returns nullptr by default: no square is known to be opaque.
+ *
+ * \param tileset The tileset of this tile.
+ * \return For each 8x8 square of the pattern in row-major order, whether
+ * all its pixels are opaque, or nullptr if unknown.
+ */
+const std::vector<bool>* TilePattern::get_opaque_squares(const Tileset& /* tileset */) const {
+  return nullptr;
+}
+
 /**
  * \brief Fills a rectangle by repeating this tile pattern.
  * \param dst_surface The destination surface.
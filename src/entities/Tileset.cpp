@@ -194,12 +194,34 @@ void Tileset::unload() {
   }
 
   tile_patterns.clear();
+  animated_tile_patterns.clear();
   tiles_image = nullptr;
   entities_image = nullptr;
 
   loaded = false;
 }
 
+/**
+ * \brief Loads the tileset again from its files.
+ *
+ * Tile patterns already given to tiles stay alive until the tiles
+ * get the new ones from get_tile_pattern().
+ */
+void Tileset::reload() {
+
+  {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    tile_patterns.clear();
+    animated_tile_patterns.clear();
+    tiles_image_soft = nullptr;
+    tiles_image = nullptr;
+    entities_image_soft = nullptr;
+    entities_image = nullptr;
+    loaded = false;
+  }
+  load();
+}
+
 /**
  * \brief Returns the background color of this tileset.
  * \return The background color.
@@ -219,7 +241,7 @@ const SurfacePtr& Tileset::get_tiles_image() const {
       tiles_image = Surface::create(16, 16);
     }
     else {
-      tiles_image = Surface::create(std::move(tiles_image_soft));
+      tiles_image = Surface::create_packed(std::move(tiles_image_soft));
     }
     tiles_image_soft = nullptr;
   }
@@ -239,7 +261,7 @@ const SurfacePtr& Tileset::get_entities_image() const {
       entities_image = Surface::create(16, 16);
     }
     else {
-      entities_image = Surface::create(std::move(entities_image_soft));
+      entities_image = Surface::create_packed(std::move(entities_image_soft));
     }
     entities_image_soft = nullptr;
   }
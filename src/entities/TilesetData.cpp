@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/TilesetData.h"
@@ -668,8 +669,36 @@ int l_border_set(lua_State* l) {
   });
 }
 
+/**
+ * \brief Reads an enumerated value from binary data.
+ * \param reader The binary data to read.
+ * \param[out] value The value read.
+ * \return \c true in case of success, \c false if the value is not a valid
+ * one of the enumeration.
+ */
+template<typename E>
+bool read_enum(BinaryReader& reader, E& value) {
+
+  value = static_cast<E>(reader.read_uint());
+  return !reader.has_failed() &&
+      EnumInfoTraits<E>::names.find(value) != EnumInfoTraits<E>::names.end();
+}
+
 }  // Anonymous namespace.
 
+/**
+ * \brief Counts the estimated size of the tileset data in the memory usage.
+ */
+void TilesetData::update_memory_usage() {
+
+  int64_t bytes = sizeof(TilesetData);
+  for (const auto& kvp : patterns) {
+    bytes += sizeof(kvp) + kvp.second.get_frames().size() * sizeof(Rectangle);
+  }
+  bytes += border_sets.size() * sizeof(std::pair<const std::string, BorderSet>);
+  memory_tracker.set_bytes(bytes);
+}
+
 /**
  * \copydoc LuaData::import_from_lua
  */
@@ -687,6 +716,7 @@ bool TilesetData::import_from_lua(lua_State* l) {
     return false;
   }
 
+  update_memory_usage();
   return true;
 }
 
@@ -791,4 +821,123 @@ bool TilesetData::export_to_lua(std::ostream& out) const {
   return true;
 }
 
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool TilesetData::import_from_binary(BinaryReader& reader) {
+
+  TilesetData tileset;
+  const int r = reader.read_uint();
+  const int g = reader.read_uint();
+  const int b = reader.read_uint();
+  const int a = reader.read_uint();
+  tileset.set_background_color(Color(r, g, b, a));
+
+  const size_t num_patterns = reader.read_count();
+  for (size_t i = 0; i < num_patterns; ++i) {
+    const std::string& pattern_id = reader.read_string();
+    TilePatternData pattern;
+    Ground ground;
+    PatternScrolling scrolling;
+    PatternRepeatMode repeat_mode;
+    if (!read_enum(reader, ground) ||
+        !read_enum(reader, scrolling) ||
+        !read_enum(reader, repeat_mode)) {
+      return false;
+    }
+    pattern.set_ground(ground);
+    pattern.set_scrolling(scrolling);
+    pattern.set_repeat_mode(repeat_mode);
+    pattern.set_default_layer(reader.read_int());
+
+    const size_t num_frames = reader.read_count();
+    std::vector<Rectangle> frames;
+    frames.reserve(num_frames);
+    for (size_t j = 0; j < num_frames; ++j) {
+      frames.push_back(reader.read_rectangle());
+    }
+    const int frame_delay = reader.read_int();
+    if (reader.has_failed() || frames.empty() || frame_delay <= 0) {
+      return false;
+    }
+    pattern.set_frames(frames);
+    pattern.set_frame_delay(frame_delay);
+    pattern.set_mirror_loop(reader.read_bool());
+
+    if (!tileset.add_pattern(pattern_id, pattern)) {
+      return false;
+    }
+  }
+
+  const size_t num_border_sets = reader.read_count();
+  for (size_t i = 0; i < num_border_sets; ++i) {
+    const std::string& border_set_id = reader.read_string();
+    BorderSet border_set;
+    border_set.set_inner(reader.read_bool());
+    const size_t num_border_patterns = reader.read_count();
+    for (size_t j = 0; j < num_border_patterns; ++j) {
+      const int border_kind = reader.read_int();
+      if (border_kind < static_cast<int>(BorderKind::RIGHT) ||
+          border_kind > static_cast<int>(BorderKind::BOTTOM_RIGHT_CONCAVE)) {
+        return false;
+      }
+      border_set.set_pattern(static_cast<BorderKind>(border_kind), reader.read_string());
+    }
+
+    if (reader.has_failed() || !tileset.add_border_set(border_set_id, border_set)) {
+      return false;
+    }
+  }
+
+  if (reader.has_failed() || !reader.is_at_end()) {
+    return false;
+  }
+  *this = std::move(tileset);
+  update_memory_usage();
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool TilesetData::export_to_binary(BinaryWriter& writer) const {
+
+  uint8_t r, g, b, a;
+  background_color.get_components(r, g, b, a);
+  writer.write_uint(r);
+  writer.write_uint(g);
+  writer.write_uint(b);
+  writer.write_uint(a);
+
+  writer.write_uint(static_cast<uint32_t>(patterns.size()));
+  for (const auto& kvp : patterns) {
+    const TilePatternData& pattern = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_uint(static_cast<uint32_t>(pattern.get_ground()));
+    writer.write_uint(static_cast<uint32_t>(pattern.get_scrolling()));
+    writer.write_uint(static_cast<uint32_t>(pattern.get_repeat_mode()));
+    writer.write_int(pattern.get_default_layer());
+    writer.write_uint(static_cast<uint32_t>(pattern.get_num_frames()));
+    for (const Rectangle& frame : pattern.get_frames()) {
+      writer.write_rectangle(frame);
+    }
+    writer.write_int(pattern.get_frame_delay());
+    writer.write_bool(pattern.is_mirror_loop());
+  }
+
+  writer.write_uint(static_cast<uint32_t>(border_sets.size()));
+  for (const auto& kvp : border_sets) {
+    const BorderSet& border_set = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_bool(border_set.is_inner());
+    writer.write_uint(static_cast<uint32_t>(border_set.get_patterns().size()));
+    for (const auto& pattern_kvp : border_set.get_patterns()) {
+      writer.write_int(static_cast<int>(pattern_kvp.first));
+      writer.write_string(pattern_kvp.second);
+    }
+  }
+
+  return true;
+}
+
 }
@@ -14,8 +14,10 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/System.h"
 #include "solarus/entities/TraversableInfo.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
 
 namespace Solarus {
 
@@ -25,7 +27,10 @@ namespace Solarus {
 TraversableInfo::TraversableInfo():
     lua_context(nullptr),
     traversable_test_ref(),
-    traversable(false) {
+    traversable(false),
+    pure(false),
+    cache_date(0),
+    cached_results() {
 
 }
 
@@ -40,7 +45,10 @@ TraversableInfo::TraversableInfo(
 ):
     lua_context(&lua_context),
     traversable_test_ref(),
-    traversable(traversable) {
+    traversable(traversable),
+    pure(false),
+    cache_date(0),
+    cached_results() {
 
 }
 
@@ -48,14 +56,20 @@ TraversableInfo::TraversableInfo(
  * \brief Creates a traversable property as a Lua boolean function.
  * \param lua_context The Lua context.
  * \param traversable_test_ref Lua ref to a function.
+ * \param pure \c true if the function always returns the same result
+ * for a given entity during a tick.
  */
 TraversableInfo::TraversableInfo(
     LuaContext& lua_context,
-    const ScopedLuaRef& traversable_test_ref
+    const ScopedLuaRef& traversable_test_ref,
+    bool pure
 ):
     lua_context(&lua_context),
     traversable_test_ref(traversable_test_ref),
-    traversable(false) {
+    traversable(false),
+    pure(pure),
+    cache_date(0),
+    cached_results() {
 
 }
 
@@ -90,9 +104,32 @@ bool TraversableInfo::is_traversable(
   }
 
   // A Lua boolean function was set.
-  return lua_context->do_traversable_test_function(
+  if (!pure) {
+    return lua_context->do_traversable_test_function(
+        traversable_test_ref, userdata, other_entity
+    );
+  }
+
+  // Reuse the result already computed during this tick if any.
+  const uint32_t now = System::now();
+  if (now != cache_date) {
+    cached_results.clear();
+    cache_date = now;
+  }
+  const Entity* other = &other_entity;
+  const auto it = std::find_if(cached_results.begin(), cached_results.end(),
+      [other](const std::pair<const Entity*, bool>& result) {
+    return result.first == other;
+  });
+  if (it != cached_results.end()) {
+    return it->second;
+  }
+
+  const bool result = lua_context->do_traversable_test_function(
       traversable_test_ref, userdata, other_entity
   );
+  cached_results.emplace_back(other, result);
+  return result;
 }
 
 }
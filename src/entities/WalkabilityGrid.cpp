@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/CrystalBlock.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/Ground.h"
+#include "solarus/entities/WalkabilityGrid.h"
+#include <algorithm>
+#include <utility>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Grounds that are uniform on a whole 8x8 square.
+ */
+const Ground uniform_grounds[] = {
+    Ground::EMPTY,
+    Ground::TRAVERSABLE,
+    Ground::GRASS,
+    Ground::ICE,
+    Ground::WALL,
+    Ground::LOW_WALL,
+    Ground::SHALLOW_WATER,
+    Ground::DEEP_WATER,
+    Ground::HOLE,
+    Ground::LAVA,
+    Ground::PRICKLE,
+    Ground::LADDER
+};
+
+/**
+ * \brief Returns the bit representing a ground in a set of grounds.
+ * \param ground A ground.
+ * \return The corresponding bit.
+ */
+uint32_t get_ground_bit(Ground ground) {
+  return 1u << static_cast<int>(ground);
+}
+
+/**
+ * \brief Returns whether a ground is uniform on a whole 8x8 square.
+ * \param ground A ground.
+ * \return \c true if it is not a diagonal ground.
+ */
+bool is_uniform_ground(Ground ground) {
+  return std::find(std::begin(uniform_grounds), std::end(uniform_grounds), ground) !=
+      std::end(uniform_grounds);
+}
+
+/**
+ * \brief Returns the bits of a word of a row that are in a range of squares.
+ * \param word Index of the word in the row.
+ * \param x8_1 First square of the range.
+ * \param x8_2 Last square of the range.
+ * \return The mask of squares of this word in the range.
+ */
+uint64_t get_range_mask(int word, int x8_1, int x8_2) {
+
+  const int first = std::max(x8_1 - word * 64, 0);
+  const int last = std::min(x8_2 - word * 64, 63);
+  uint64_t mask = ~UINT64_C(0) << first;
+  if (last < 63) {
+    mask &= (UINT64_C(1) << (last + 1)) - 1;
+  }
+  return mask;
+}
+
+/**
+ * \brief Tests a range of squares of a row.
+ * \param obstacles The row of obstacle squares.
+ * \param diagonals The row of diagonal squares.
+ * \param modified The row of squares with ground modifiers, or nullptr.
+ * \param x8_1 First square of the range.
+ * \param x8_2 Last square of the range.
+ * \return The result for these squares.
+ */
+WalkabilityGrid::Result test_row(
+    const uint64_t* obstacles,
+    const uint64_t* diagonals,
+    const uint64_t* modified,
+    int x8_1,
+    int x8_2) {
+
+  WalkabilityGrid::Result result = WalkabilityGrid::Result::FREE;
+  for (int word = x8_1 >> 6; word <= (x8_2 >> 6); ++word) {
+    const uint64_t mask = get_range_mask(word, x8_1, x8_2);
+    const uint64_t modified_word = modified == nullptr ? 0 : modified[word];
+    if ((obstacles[word] & ~modified_word & mask) != 0) {
+      return WalkabilityGrid::Result::OBSTACLE;
+    }
+    if (((diagonals[word] | modified_word) & mask) != 0) {
+      result = WalkabilityGrid::Result::UNKNOWN;
+    }
+  }
+  return result;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Compares two footprints.
+ * \param other Another footprint.
+ * \return \c true if they cover the same squares.
+ */
+bool WalkabilityGrid::Footprint::operator==(const Footprint& other) const {
+
+  return layer == other.layer &&
+      x8 == other.x8 &&
+      y8 == other.y8 &&
+      width8 == other.width8 &&
+      height8 == other.height8;
+}
+
+/**
+ * \brief Creates an empty grid.
+ * \param entities The entities of the map, that give the ground of tiles.
+ * \param map_width8 Number of 8x8 squares in a row of the map.
+ * \param map_height8 Number of 8x8 squares in a column of the map.
+ */
+WalkabilityGrid::WalkabilityGrid(
+    Entities& entities,
+    int map_width8,
+    int map_height8):
+  entities(entities),
+  map_width8(map_width8),
+  map_height8(map_height8),
+  words_per_row((map_width8 + 63) / 64),
+  layer_grounds(),
+  obstacle_bits(),
+  ground_modifiers(),
+  raised_blocks(),
+  version(0) {
+
+}
+
+/**
+ * \brief Computes the set of uniform grounds that are obstacles for an entity.
+ *
+ * Diagonal grounds are never part of the set: squares with a diagonal
+ * ground always need a full collision test.
+ *
+ * This calls is_ground_obstacle() for each uniform ground:
+ * use Entity::get_ground_obstacles() instead, which caches the result.
+ *
+ * \param entity An entity.
+ * \return A bit set of grounds, to be passed to test_collision().
+ */
+uint32_t WalkabilityGrid::compute_ground_obstacles(const Entity& entity) {
+
+  uint32_t ground_obstacles = 0;
+  for (Ground ground : uniform_grounds) {
+    if (entity.is_ground_obstacle(ground)) {
+      ground_obstacles |= get_ground_bit(ground);
+    }
+  }
+  return ground_obstacles;
+}
+
+/**
+ * \brief Tests whether the border of a rectangle collides with the terrain.
+ *
+ * Like Map::test_collision_with_ground(), only the border of the rectangle
+ * is tested. Dynamic entities that are obstacles but don't modify the
+ * ground are not taken into account.
+ *
+ * \param layer The layer.
+ * \param collision_box The rectangle to test. Its size must be a multiple
+ * of 8. Its coordinates don't need to be aligned on the grid.
+ * \param ground_obstacles Grounds that are obstacles,
+ * as returned by Entity::get_ground_obstacles().
+ * \return Result::UNKNOWN if the rectangle overlaps ground modifiers or
+ * diagonal grounds and none of the other squares is an obstacle.
+ */
+WalkabilityGrid::Result WalkabilityGrid::test_collision(
+    int layer,
+    const Rectangle& collision_box,
+    uint32_t ground_obstacles) {
+
+  const int x1 = collision_box.get_x();
+  const int y1 = collision_box.get_y();
+  const int x2 = x1 + collision_box.get_width() - 1;
+  const int y2 = y1 + collision_box.get_height() - 1;
+
+  if (x1 < 0 || y1 < 0 || x2 >= map_width8 * 8 || y2 >= map_height8 * 8) {
+    // Outside the map: this is an obstacle.
+    return Result::OBSTACLE;
+  }
+
+  // Since the size is a multiple of 8, the squares overlapped by the border
+  // are exactly the ones tested point by point by Map.
+  const int x8_1 = x1 >> 3;
+  const int y8_1 = y1 >> 3;
+  const int x8_2 = x2 >> 3;
+  const int y8_2 = y2 >> 3;
+
+  const Bits& obstacles = get_obstacle_bits(layer, ground_obstacles);
+  const Bits& diagonals = get_layer_grounds(layer).diagonal_bits;
+  const auto& modified_it = ground_modifiers.bits.find(layer);
+  const uint64_t* modified = modified_it == ground_modifiers.bits.end() ?
+      nullptr : modified_it->second.data();
+
+  Result result = Result::FREE;
+  for (int y8 = y8_1; y8 <= y8_2; ++y8) {
+    const int offset = y8 * words_per_row;
+    const uint64_t* modified_row = modified == nullptr ? nullptr : modified + offset;
+    const bool horizontal_border = y8 == y8_1 || y8 == y8_2;
+    const int step = horizontal_border ? x8_2 - x8_1 + 1 : std::max(1, x8_2 - x8_1);
+    for (int x8 = x8_1; x8 <= x8_2; x8 += step) {
+      // Whole row on horizontal borders, one square on each side otherwise.
+      const int last_x8 = horizontal_border ? x8_2 : x8;
+      switch (test_row(&obstacles[offset], &diagonals[offset], modified_row, x8, last_x8)) {
+
+        case Result::OBSTACLE:
+          return Result::OBSTACLE;
+
+        case Result::UNKNOWN:
+          result = Result::UNKNOWN;
+          break;
+
+        case Result::FREE:
+          break;
+      }
+    }
+  }
+
+  return result;
+}
+
+/**
+ * \brief Returns the ground bitmaps of the static tiles of a layer.
+ *
+ * They are built the first time they are needed.
+ *
+ * \param layer The layer.
+ * \return The squares of each kind of ground.
+ */
+const WalkabilityGrid::LayerGrounds& WalkabilityGrid::get_layer_grounds(int layer) {
+
+  for (const LayerGrounds& existing_grounds : layer_grounds) {
+    if (existing_grounds.layer == layer) {
+      return existing_grounds;
+    }
+  }
+
+  const size_t num_bits = words_per_row * map_height8;
+  layer_grounds.push_back({ layer, std::vector<Bits>(), Bits(num_bits, 0) });
+  LayerGrounds& grounds = layer_grounds.back();
+  grounds.ground_bits.resize(static_cast<int>(Ground::LAVA) + 1);
+  for (int y8 = 0; y8 < map_height8; ++y8) {
+    for (int x8 = 0; x8 < map_width8; ++x8) {
+      const Ground ground = entities.get_tile_ground(layer, x8 * 8, y8 * 8);
+      Bits* bits = &grounds.diagonal_bits;
+      if (is_uniform_ground(ground)) {
+        bits = &grounds.ground_bits[static_cast<int>(ground)];
+        if (bits->empty()) {
+          bits->assign(num_bits, 0);
+        }
+      }
+      (*bits)[y8 * words_per_row + (x8 >> 6)] |= UINT64_C(1) << (x8 & 63);
+    }
+  }
+  return grounds;
+}
+
+/**
+ * \brief Returns the static obstacle bitmap of a layer for a set of obstacle
+ * grounds.
+ *
+ * It is built the first time it is needed by merging the bitmaps of
+ * these grounds.
+ *
+ * \param layer The layer.
+ * \param ground_obstacles Grounds that are obstacles.
+ * \return The obstacle squares of the layer.
+ */
+const WalkabilityGrid::Bits& WalkabilityGrid::get_obstacle_bits(
+    int layer,
+    uint32_t ground_obstacles) {
+
+  for (const ObstacleBits& existing_bits : obstacle_bits) {
+    if (existing_bits.layer == layer &&
+        existing_bits.ground_obstacles == ground_obstacles) {
+      return existing_bits.bits;
+    }
+  }
+
+  const LayerGrounds& grounds = get_layer_grounds(layer);
+  Bits bits(words_per_row * map_height8, 0);
+  for (Ground ground : uniform_grounds) {
+    const Bits& ground_bits = grounds.ground_bits[static_cast<int>(ground)];
+    if ((ground_obstacles & get_ground_bit(ground)) == 0 || ground_bits.empty()) {
+      continue;
+    }
+    for (size_t i = 0; i < bits.size(); ++i) {
+      bits[i] |= ground_bits[i];
+    }
+  }
+  obstacle_bits.push_back({ layer, ground_obstacles, std::move(bits) });
+  return obstacle_bits.back().bits;
+}
+
+/**
+ * \brief Returns whether a rectangle may overlap raised crystal blocks.
+ *
+ * Only squares are tested: when this returns \c true,
+ * callers have to check the blocks themselves.
+ *
+ * \param layer The layer.
+ * \param rectangle The rectangle to test.
+ * \return \c false if no raised crystal block overlaps the squares of the
+ * rectangle.
+ */
+bool WalkabilityGrid::may_overlap_raised_blocks(
+    int layer,
+    const Rectangle& rectangle) const {
+  return may_overlap(raised_blocks, layer, rectangle);
+}
+
+/**
+ * \brief Returns whether a rectangle may overlap dynamic entities that
+ * modify the ground.
+ *
+ * Only squares are tested: when this returns \c true,
+ * callers have to check the entities themselves.
+ * Otherwise, the ground is the one of static tiles.
+ *
+ * \param layer The layer.
+ * \param rectangle The rectangle to test.
+ * \return \c false if no ground modifier overlaps the squares of the
+ * rectangle.
+ */
+bool WalkabilityGrid::may_overlap_ground_modifiers(
+    int layer,
+    const Rectangle& rectangle) const {
+  return may_overlap(ground_modifiers, layer, rectangle);
+}
+
+/**
+ * \brief Returns whether a rectangle overlaps squares with counted entities.
+ * \param squares The counts to test.
+ * \param layer The layer.
+ * \param rectangle The rectangle to test.
+ * \return \c false if no entity is counted on the squares of the rectangle.
+ */
+bool WalkabilityGrid::may_overlap(
+    const SquareCounts& squares,
+    int layer,
+    const Rectangle& rectangle) const {
+
+  const auto& it = squares.bits.find(layer);
+  if (it == squares.bits.end()) {
+    return false;
+  }
+
+  const int x1 = rectangle.get_x();
+  const int y1 = rectangle.get_y();
+  const int x2 = x1 + rectangle.get_width() - 1;
+  const int y2 = y1 + rectangle.get_height() - 1;
+  if (x1 < 0 || y1 < 0 || x2 >= map_width8 * 8 || y2 >= map_height8 * 8) {
+    // Entities outside the map are not counted.
+    return true;
+  }
+
+  const Bits& bits = it->second;
+  const int x8_1 = x1 >> 3;
+  const int x8_2 = x2 >> 3;
+  for (int y8 = y1 >> 3; y8 <= (y2 >> 3); ++y8) {
+    const int offset = y8 * words_per_row;
+    for (int word = x8_1 >> 6; word <= (x8_2 >> 6); ++word) {
+      if ((bits[offset + word] & get_range_mask(word, x8_1, x8_2)) != 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Updates the squares where an entity modifies the ground.
+ *
+ * This function should be called whenever an entity that modifies the ground,
+ * or that starts or stops modifying it, moves or changes.
+ * Crystal blocks should also call it when they are raised or lowered.
+ *
+ * \param entity The entity.
+ */
+void WalkabilityGrid::notify_ground_modifier_changed(const Entity& entity) {
+
+  if (entity.get_type() == EntityType::CRYSTAL_BLOCK) {
+    update_raised_block(entity);
+  }
+
+  const bool modifier = entity.is_ground_modifier() && !entity.is_being_removed();
+  if (!modifier) {
+    if (remove_footprint(ground_modifiers, entity)) {
+      ++version;
+    }
+    return;
+  }
+
+  if (set_footprint(ground_modifiers, entity, get_footprint(entity, entity.get_bounding_box()))) {
+    ++version;
+  }
+}
+
+/**
+ * \brief Stops tracking an entity that no longer modifies the ground.
+ * \param entity The entity.
+ */
+void WalkabilityGrid::notify_entity_removed(const Entity& entity) {
+
+  remove_footprint(raised_blocks, entity);
+  if (remove_footprint(ground_modifiers, entity)) {
+    ++version;
+  }
+}
+
+/**
+ * \brief Forgets the bitmaps built so far because the ground of tiles changed.
+ */
+void WalkabilityGrid::notify_tiles_ground_changed() {
+
+  obstacle_bits.clear();
+  layer_grounds.clear();
+  ++version;
+}
+
+/**
+ * \brief Returns a number that changes whenever the terrain changes.
+ * \return The version of the grid.
+ */
+uint32_t WalkabilityGrid::get_version() const {
+  return version;
+}
+
+/**
+ * \brief Returns the squares of the map overlapped by a box of an entity.
+ * \param entity The entity.
+ * \param box The box of the entity to consider.
+ * \return The corresponding squares, clipped to the map.
+ */
+WalkabilityGrid::Footprint WalkabilityGrid::get_footprint(
+    const Entity& entity,
+    const Rectangle& box) const {
+
+  const int x8_1 = std::max(0, box.get_x() >> 3);
+  const int y8_1 = std::max(0, box.get_y() >> 3);
+  const int x8_2 = std::min(map_width8 - 1, (box.get_x() + box.get_width() - 1) >> 3);
+  const int y8_2 = std::min(map_height8 - 1, (box.get_y() + box.get_height() - 1) >> 3);
+  return {
+      entity.get_layer(),
+      x8_1,
+      y8_1,
+      std::max(0, x8_2 - x8_1 + 1),
+      std::max(0, y8_2 - y8_1 + 1)
+  };
+}
+
+/**
+ * \brief Counts an entity on some squares instead of its previous ones.
+ * \param squares The counts to update.
+ * \param entity The entity.
+ * \param footprint The new squares of the entity.
+ * \return \c true if the squares of the entity changed.
+ */
+bool WalkabilityGrid::set_footprint(
+    SquareCounts& squares,
+    const Entity& entity,
+    const Footprint& footprint) {
+
+  const auto& it = squares.footprints.find(&entity);
+  if (it != squares.footprints.end()) {
+    if (it->second == footprint) {
+      return false;
+    }
+    add_footprint(squares, it->second, -1);
+    it->second = footprint;
+  }
+  else {
+    squares.footprints.emplace(&entity, footprint);
+  }
+  add_footprint(squares, footprint, 1);
+  return true;
+}
+
+/**
+ * \brief Stops counting an entity.
+ * \param squares The counts to update.
+ * \param entity The entity.
+ * \return \c true if the entity was counted.
+ */
+bool WalkabilityGrid::remove_footprint(SquareCounts& squares, const Entity& entity) {
+
+  const auto& it = squares.footprints.find(&entity);
+  if (it == squares.footprints.end()) {
+    return false;
+  }
+
+  add_footprint(squares, it->second, -1);
+  squares.footprints.erase(it);
+  return true;
+}
+
+/**
+ * \brief Adds or removes an entity on some squares.
+ * \param squares The counts to update.
+ * \param footprint The squares.
+ * \param delta 1 to add an entity, -1 to remove it.
+ */
+void WalkabilityGrid::add_footprint(
+    SquareCounts& squares,
+    const Footprint& footprint,
+    int delta) {
+
+  std::vector<uint16_t>& counts = squares.counts[footprint.layer];
+  Bits& bits = squares.bits[footprint.layer];
+  if (counts.empty()) {
+    counts.assign(map_width8 * map_height8, 0);
+    bits.assign(words_per_row * map_height8, 0);
+  }
+
+  for (int y8 = footprint.y8; y8 < footprint.y8 + footprint.height8; ++y8) {
+    for (int x8 = footprint.x8; x8 < footprint.x8 + footprint.width8; ++x8) {
+      uint16_t& count = counts[y8 * map_width8 + x8];
+      count += delta;
+      uint64_t& word = bits[y8 * words_per_row + (x8 >> 6)];
+      const uint64_t bit = UINT64_C(1) << (x8 & 63);
+      if (count != 0) {
+        word |= bit;
+      }
+      else {
+        word &= ~bit;
+      }
+    }
+  }
+}
+
+/**
+ * \brief Updates the squares of a crystal block.
+ *
+ * Lowered blocks are not counted.
+ * Their maximum bounding box is used like in the quadtree of entities.
+ *
+ * \param entity A crystal block.
+ */
+void WalkabilityGrid::update_raised_block(const Entity& entity) {
+
+  const CrystalBlock& block = static_cast<const CrystalBlock&>(entity);
+  if (!block.is_raised() || block.is_being_removed()) {
+    remove_footprint(raised_blocks, block);
+    return;
+  }
+
+  set_footprint(raised_blocks, block, get_footprint(block, block.get_max_bounding_box()));
+}
+
+}
+
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/DrawList.h"
+#include "solarus/graphics/Renderer.h"
+#include "solarus/graphics/Shader.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/lua/LuaContext.h"
+
+namespace Solarus {
+
+/**
+ * \brief Returns whether two surfaces are drawn the same way.
+ * \param other Another draw state.
+ * \return \c true if both states are equal.
+ */
+bool DrawList::DrawState::operator==(const DrawState& other) const {
+
+  return xy == other.xy &&
+      origin == other.origin &&
+      blend_mode == other.blend_mode &&
+      opacity == other.opacity &&
+      rotation == other.rotation &&
+      scale.x == other.scale.x &&
+      scale.y == other.scale.y &&
+      color == other.color &&
+      shader == other.shader;
+}
+
+/**
+ * \brief Creates an empty draw list.
+ */
+DrawList::DrawList():
+  ExportableToLua() {
+
+}
+
+/**
+ * \brief Adds a surface at the end of the list.
+ * \param surface The surface to add.
+ * \param position Where to draw it, relative to the position of the list.
+ */
+void DrawList::add_surface(const SurfacePtr& surface, const Point& position) {
+
+  entries.push_back({ surface, position, DrawState() });
+  recording = nullptr;
+}
+
+/**
+ * \brief Removes all surfaces from the list.
+ */
+void DrawList::clear() {
+
+  entries.clear();
+  recording = nullptr;
+}
+
+/**
+ * \brief Returns the number of surfaces in the list.
+ * \return The number of surfaces.
+ */
+int DrawList::get_num_surfaces() const {
+  return static_cast<int>(entries.size());
+}
+
+/**
+ * \brief Draws the surfaces of the list.
+ *
+ * The recording of the surfaces is replayed if it is up to date,
+ * and made again first otherwise.
+ *
+ * \param dst_surface The destination surface.
+ * \param dst_position Position of the list on this surface.
+ */
+void DrawList::draw(const SurfacePtr& dst_surface, const Point& dst_position) {
+
+  if (!is_recording_up_to_date(*dst_surface)) {
+    record(dst_surface);
+  }
+
+  if (recording != nullptr) {
+    if (recording->draw(*dst_surface, dst_position)) {
+      return;
+    }
+    // Outdated in a way the list cannot see, like an image leaving an atlas.
+    recording = nullptr;
+  }
+  draw_surfaces(dst_surface, dst_position);
+}
+
+/**
+ * \brief Returns the properties that change how a surface is drawn.
+ * \param[in] surface A surface.
+ * \param[out] state The properties of the surface.
+ * \return \c false if the surface cannot be recorded.
+ */
+bool DrawList::get_draw_state(Surface& surface, DrawState& state) {
+
+  if (surface.get_transition() != nullptr) {
+    return false;
+  }
+
+  state.xy = surface.get_xy();
+  state.origin = surface.get_full_origin();
+  state.blend_mode = surface.get_blend_mode();
+  state.opacity = surface.get_opacity();
+  state.rotation = surface.get_rotation();
+  state.scale = surface.get_scale();
+  state.color = surface.get_color_modulation();
+  state.shader = surface.get_shader().get();
+  return true;
+}
+
+/**
+ * \brief Returns whether the recording can be replayed on a surface.
+ * \param dst_surface The destination surface.
+ * \return \c true if no surface of the list changed since the recording.
+ */
+bool DrawList::is_recording_up_to_date(const Surface& dst_surface) const {
+
+  if (recording == nullptr ||
+      recording_dst.lock().get() != &dst_surface) {
+    return false;
+  }
+
+  DrawState state;
+  for (const Entry& entry : entries) {
+    if (!get_draw_state(*entry.surface, state) ||
+        !(state == entry.state)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Records the surfaces of the list drawn at the origin of a surface.
+ *
+ * Nothing is recorded if a surface has a transition or if the renderer
+ * does not support recordings.
+ *
+ * \param dst_surface The destination surface.
+ */
+void DrawList::record(const SurfacePtr& dst_surface) {
+
+  recording = nullptr;
+  recording_dst.reset();
+
+  for (Entry& entry : entries) {
+    if (!get_draw_state(*entry.surface, entry.state)) {
+      return;
+    }
+  }
+
+  Renderer& renderer = Video::get_renderer();
+  recording = renderer.begin_recording(dst_surface->get_impl());
+  if (recording == nullptr) {
+    return;
+  }
+  for (const Entry& entry : entries) {
+    entry.surface->draw(dst_surface, entry.position);
+  }
+  renderer.end_recording();
+  recording_dst = dst_surface;
+}
+
+/**
+ * \brief Draws the surfaces of the list one by one.
+ * \param dst_surface The destination surface.
+ * \param dst_position Position of the list on this surface.
+ */
+void DrawList::draw_surfaces(const SurfacePtr& dst_surface, const Point& dst_position) const {
+
+  for (const Entry& entry : entries) {
+    entry.surface->draw(dst_surface, dst_position + entry.position);
+  }
+}
+
+/**
+ * \brief Returns the name identifying this type in Lua.
+ * \return The name identifying this type in Lua.
+ */
+const std::string& DrawList::get_lua_type_name() const {
+  return LuaContext::draw_list_module_name;
+}
+
+}
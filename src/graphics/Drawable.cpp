@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/graphics/Drawable.h"
+#include "solarus/graphics/FrameDamage.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/Movement.h"
@@ -158,6 +159,7 @@ Transition* Drawable::get_transition() {
 void Drawable::update() {
 
   if (transition != nullptr) {
+    FrameDamage::notify();
     transition->update();
     if (transition->is_finished()) {
       transition->finish(*this);
@@ -171,6 +173,7 @@ void Drawable::update() {
   }
 
   if (movement != nullptr) {
+    FrameDamage::notify();
     movement->update();
     if (movement != nullptr && movement->is_finished()) {
       stop_movement();
@@ -437,6 +440,23 @@ Point Drawable::get_full_origin() const {
   return transformation_origin + get_origin();
 }
 
+/**
+ * \brief Returns the position of this object in the drawables updated by Lua.
+ * \return The index in the list of Lua drawables, or -1 if this object was
+ * not created by Lua.
+ */
+int Drawable::get_lua_index() const {
+  return lua_index;
+}
+
+/**
+ * \brief Sets the position of this object in the drawables updated by Lua.
+ * \param lua_index The index in the list of Lua drawables, or -1.
+ */
+void Drawable::set_lua_index(int lua_index) {
+  this->lua_index = lua_index;
+}
+
 /**
  * @brief get the final proxy that will finish drawing this object
  * @return
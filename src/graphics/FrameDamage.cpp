@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/FrameDamage.h"
+
+namespace Solarus {
+namespace FrameDamage {
+
+namespace {
+
+bool lazy_redraw_enabled = false;  /**< Whether frames without damage are skipped. */
+bool damaged = true;               /**< Whether something changed since the last frame drawn. */
+bool drawing = false;              /**< Whether a frame is being drawn. */
+
+}
+
+/**
+ * \brief Returns whether frames without damage are skipped.
+ * \return \c true if lazy redraw is enabled.
+ */
+bool is_lazy_redraw_enabled() {
+  return lazy_redraw_enabled;
+}
+
+/**
+ * \brief Sets whether frames without damage are skipped.
+ * \param enabled \c true to enable lazy redraw.
+ */
+void set_lazy_redraw_enabled(bool enabled) {
+  lazy_redraw_enabled = enabled;
+  damaged = true;
+}
+
+/**
+ * \brief Notifies that something visible has changed.
+ *
+ * When called during drawing, the next frame is damaged.
+ */
+void notify() {
+  damaged = true;
+}
+
+/**
+ * \brief Notifies that Lua code is about to run.
+ *
+ * Lua code can change anything visible, so this damages the frame
+ * unless a frame is being drawn.
+ */
+void notify_lua_call() {
+  if (!drawing) {
+    damaged = true;
+  }
+}
+
+/**
+ * \brief Returns whether the next frame can differ from the last one drawn.
+ * \return \c true if the frame needs to be drawn.
+ */
+bool is_damaged() {
+  return damaged || !lazy_redraw_enabled;
+}
+
+/**
+ * \brief Called at the beginning of drawing a frame.
+ *
+ * Clears the damage.
+ */
+void start_drawing() {
+  damaged = false;
+  drawing = true;
+}
+
+/**
+ * \brief Called at the end of drawing a frame.
+ */
+void finish_drawing() {
+  drawing = false;
+}
+
+}
+}
+
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/System.h"
+#include "solarus/graphics/FrameRecorder.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/Surface.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <SDL_image.h>
+#ifndef _WIN32
+#  include <csignal>
+#endif
+
+namespace Solarus {
+
+constexpr int FrameRecorder::default_frame_rate;
+constexpr size_t FrameRecorder::max_queued_frames;
+
+std::thread FrameRecorder::worker;
+std::mutex FrameRecorder::mutex;
+std::condition_variable FrameRecorder::frames_changed;
+std::deque<FrameRecorder::Frame> FrameRecorder::frames;
+bool FrameRecorder::stopping = false;
+uint64_t FrameRecorder::num_dropped_frames = 0;
+bool FrameRecorder::recording = false;
+uint64_t FrameRecorder::session = 0;
+FrameRecorder::Output FrameRecorder::output = FrameRecorder::Output::Y4M_FILE;
+std::string FrameRecorder::target;
+int FrameRecorder::frame_rate = FrameRecorder::default_frame_rate;
+std::FILE* FrameRecorder::file = nullptr;
+uint64_t FrameRecorder::first_date = 0;
+uint64_t FrameRecorder::num_written_frames = 0;
+FrameRecorder::Frame FrameRecorder::last_frame;
+bool FrameRecorder::failed = false;
+
+namespace {
+
+const std::string png_extension = ".png";
+
+}
+
+/**
+ * \brief Starts recording the frames drawn.
+ *
+ * A recording in progress is stopped first.
+ *
+ * \param recording_target File name, command or PNG file name pattern,
+ * as described in the class documentation.
+ * \param recording_frame_rate Frames per second of the output.
+ * \return \c false if the output could not be opened.
+ */
+bool FrameRecorder::start(const std::string& recording_target, int recording_frame_rate) {
+
+  stop();
+
+  Debug::check_assertion(recording_frame_rate > 0, "Invalid recording frame rate");
+
+  output = Output::Y4M_FILE;
+  target = recording_target;
+  if (!target.empty() && target[0] == '|') {
+    output = Output::Y4M_PIPE;
+    target = target.substr(1);
+  }
+  else if (target.size() > png_extension.size() &&
+      target.compare(target.size() - png_extension.size(), png_extension.size(), png_extension) == 0) {
+    output = Output::PNG_SEQUENCE;
+    target = target.substr(0, target.size() - png_extension.size());
+  }
+
+  file = nullptr;
+  switch (output) {
+
+  case Output::Y4M_FILE:
+    file = std::fopen(target.c_str(), "wb");
+    break;
+
+  case Output::Y4M_PIPE:
+#ifdef _WIN32
+    file = _popen(target.c_str(), "wb");
+#else
+    // Don't let the command kill the engine if it exits first.
+    std::signal(SIGPIPE, SIG_IGN);
+    file = popen(target.c_str(), "w");
+#endif
+    break;
+
+  case Output::PNG_SEQUENCE:
+    break;
+  }
+
+  if (output != Output::PNG_SEQUENCE && file == nullptr) {
+    Logger::error("Cannot record frames to '" + recording_target + "'");
+    return false;
+  }
+
+  frame_rate = recording_frame_rate;
+  first_date = 0;
+  num_written_frames = 0;
+  last_frame = Frame();
+  failed = false;
+  num_dropped_frames = 0;
+  stopping = false;
+  recording = true;
+  ++session;
+  worker = std::thread(&FrameRecorder::run);
+
+  Logger::info("Recording frames to '" + recording_target + "'");
+  return true;
+}
+
+/**
+ * \brief Stops the recording in progress if any.
+ *
+ * Frames already read back are encoded before returning,
+ * frames still being read back are dropped.
+ */
+void FrameRecorder::stop() {
+
+  if (!recording) {
+    return;
+  }
+
+  recording = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  frames_changed.notify_all();
+  worker.join();
+
+  if (file != nullptr) {
+    if (output == Output::Y4M_PIPE) {
+#ifdef _WIN32
+      _pclose(file);
+#else
+      pclose(file);
+#endif
+    }
+    else {
+      std::fclose(file);
+    }
+    file = nullptr;
+  }
+  last_frame = Frame();
+
+  Logger::info("Recording finished: " + std::to_string(num_written_frames) +
+               " frames written, " + std::to_string(num_dropped_frames) + " dropped");
+}
+
+/**
+ * \brief Returns whether a recording is in progress.
+ * \return \c true if frames are being recorded.
+ */
+bool FrameRecorder::is_recording() {
+  return recording;
+}
+
+/**
+ * \brief Records the frame just drawn on the quest surface.
+ *
+ * Does nothing if there is no recording in progress.
+ * The pixels are read back asynchronously and delivered a few frames later.
+ *
+ * \param quest_surface The quest surface, fully drawn.
+ */
+void FrameRecorder::capture(const Surface& quest_surface) {
+
+  if (!recording) {
+    return;
+  }
+
+  const uint64_t capture_session = session;
+  const uint64_t date = System::get_real_time_us();
+  const int width = quest_surface.get_width();
+  const int height = quest_surface.get_height();
+  quest_surface.get_pixels_async([capture_session, date, width, height](const std::string& pixels) {
+    push_frame(capture_session, Frame{ date, width, height, pixels });
+  });
+}
+
+/**
+ * \brief Gives a frame read back to the encoder.
+ * \param capture_session The recording the frame was captured for.
+ * \param frame The frame.
+ */
+void FrameRecorder::push_frame(uint64_t capture_session, Frame&& frame) {
+
+  if (!recording || capture_session != session) {
+    // Captured before the recording was stopped.
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frames.size() >= max_queued_frames) {
+      ++num_dropped_frames;
+      return;
+    }
+    frames.push_back(std::move(frame));
+  }
+  frames_changed.notify_one();
+}
+
+/**
+ * \brief Encodes frames until the recording is stopped.
+ */
+void FrameRecorder::run() {
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    frames_changed.wait(lock, [] { return stopping || !frames.empty(); });
+    if (frames.empty()) {
+      break;
+    }
+
+    const Frame frame = std::move(frames.front());
+    frames.pop_front();
+    lock.unlock();
+    encode(frame);
+    lock.lock();
+  }
+}
+
+/**
+ * \brief Writes a frame at its date in the output.
+ *
+ * The previous frame is repeated to fill the time since it was drawn.
+ * A frame drawn before its turn in the output is skipped.
+ *
+ * \param frame The frame to write.
+ */
+void FrameRecorder::encode(const Frame& frame) {
+
+  if (failed) {
+    return;
+  }
+
+  if (num_written_frames == 0) {
+    first_date = frame.date;
+    if (output != Output::PNG_SEQUENCE) {
+      std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+                   frame.width, frame.height, frame_rate);
+    }
+  }
+  else if (frame.width != last_frame.width || frame.height != last_frame.height) {
+    // The output cannot change its size.
+    return;
+  }
+
+  // Round to the nearest period: frames drawn exactly at the frame rate
+  // still arrive with some jitter.
+  const uint64_t index = ((frame.date - first_date) * frame_rate + 500000) / 1000000;
+  if (num_written_frames > 0 && index < num_written_frames) {
+    return;
+  }
+
+  auto write = [](const Frame& written_frame) {
+    const bool success = output == Output::PNG_SEQUENCE ?
+          write_png(written_frame) : write_y4m(written_frame);
+    if (!success) {
+      Logger::error("Failed to write recorded frame " + std::to_string(num_written_frames) +
+                    ": recording stopped");
+      failed = true;
+    }
+    ++num_written_frames;
+    return success;
+  };
+
+  while (num_written_frames > 0 && num_written_frames < index) {
+    if (!write(last_frame)) {
+      return;
+    }
+  }
+  if (write(frame)) {
+    last_frame = frame;
+  }
+}
+
+/**
+ * \brief Writes a frame to the Y4M output.
+ *
+ * Colors are converted to full range YCbCr with chroma subsampled
+ * by blocks of 2x2 pixels. Pixels are considered premultiplied,
+ * as the quest surface is drawn on a black screen.
+ *
+ * \param frame The frame.
+ * \return \c false if writing failed.
+ */
+bool FrameRecorder::write_y4m(const Frame& frame) {
+
+  const int width = frame.width;
+  const int height = frame.height;
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  std::vector<uint8_t> planes(width * height + 2 * chroma_width * chroma_height);
+  uint8_t* y_plane = planes.data();
+  uint8_t* cb_plane = y_plane + width * height;
+  uint8_t* cr_plane = cb_plane + chroma_width * chroma_height;
+
+  const uint8_t* pixels = reinterpret_cast<const uint8_t*>(frame.pixels.data());
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* pixel = pixels + y * width * 4;
+    for (int x = 0; x < width; ++x, pixel += 4) {
+      y_plane[y * width + x] = static_cast<uint8_t>(
+          (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+    }
+  }
+
+  for (int cy = 0; cy < chroma_height; ++cy) {
+    for (int cx = 0; cx < chroma_width; ++cx) {
+      // Average the block, clamped at the right and bottom edges.
+      int r = 0, g = 0, b = 0, count = 0;
+      for (int y = cy * 2; y < std::min(cy * 2 + 2, height); ++y) {
+        for (int x = cx * 2; x < std::min(cx * 2 + 2, width); ++x) {
+          const uint8_t* pixel = pixels + (y * width + x) * 4;
+          r += pixel[0];
+          g += pixel[1];
+          b += pixel[2];
+          ++count;
+        }
+      }
+      r /= count;
+      g /= count;
+      b /= count;
+      cb_plane[cy * chroma_width + cx] = static_cast<uint8_t>(
+          128 + ((-43 * r - 85 * g + 128 * b + 128) >> 8));
+      cr_plane[cy * chroma_width + cx] = static_cast<uint8_t>(
+          128 + ((128 * r - 107 * g - 21 * b + 128) >> 8));
+    }
+  }
+
+  return std::fputs("FRAME\n", file) >= 0 &&
+      std::fwrite(planes.data(), 1, planes.size(), file) == planes.size();
+}
+
+/**
+ * \brief Writes a frame as the next PNG image of the sequence.
+ * \param frame The frame.
+ * \return \c false if writing failed.
+ */
+bool FrameRecorder::write_png(const Frame& frame) {
+
+  // Opaque like on the screen.
+  std::string pixels = frame.pixels;
+  for (size_t i = 3; i < pixels.size(); i += 4) {
+    pixels[i] = static_cast<char>(255);
+  }
+
+  SDL_Surface_UniquePtr surface(SDL_CreateRGBSurfaceWithFormatFrom(
+        &pixels[0],
+        frame.width,
+        frame.height,
+        32,
+        frame.width * 4,
+        SDL_PIXELFORMAT_ABGR8888));
+  if (surface == nullptr) {
+    return false;
+  }
+
+  char suffix[16];
+  std::snprintf(suffix, sizeof(suffix), "_%06llu",
+                static_cast<unsigned long long>(num_written_frames));
+  const std::string file_name = target + suffix + png_extension;
+  return IMG_SavePNG(surface.get(), file_name.c_str()) == 0;
+}
+
+}
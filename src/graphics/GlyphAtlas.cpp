@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Size.h"
+#include "solarus/graphics/GlyphAtlas.h"
+#include "solarus/graphics/SDLPtrs.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+
+namespace Solarus {
+
+constexpr int GlyphAtlas::width;
+constexpr int GlyphAtlas::initial_height;
+constexpr int GlyphAtlas::max_height;
+
+/**
+ * \brief Creates an empty glyph atlas.
+ * \param font The font to render. It must live as long as the atlas.
+ * \param rendering_mode How to render glyphs.
+ * \param color Color of the glyphs.
+ */
+GlyphAtlas::GlyphAtlas(
+    TTF_Font& font,
+    TextSurface::RenderingMode rendering_mode,
+    const Color& color):
+  font(font),
+  rendering_mode(rendering_mode),
+  color(color),
+  surface(nullptr),
+  glyphs(),
+  row_position(),
+  row_height(0) {
+
+}
+
+/**
+ * \brief Returns the font of this atlas.
+ * \return The font.
+ */
+TTF_Font& GlyphAtlas::get_font() const {
+  return font;
+}
+
+/**
+ * \brief Returns the surface containing the glyphs.
+ *
+ * The surface is replaced by a taller one when it is full,
+ * so it should not be kept across calls to get_glyph().
+ *
+ * \return The atlas surface, or nullptr if no glyph was rendered yet.
+ */
+const SurfacePtr& GlyphAtlas::get_surface() const {
+  return surface;
+}
+
+/**
+ * \brief Returns a glyph, rendering it into the atlas the first time.
+ * \param code_point Unicode code point of the glyph.
+ * \return The glyph, or nullptr if it could not be rendered or if the atlas
+ * is full.
+ */
+const GlyphAtlas::Glyph* GlyphAtlas::get_glyph(uint16_t code_point) {
+
+  const auto it = glyphs.find(code_point);
+  if (it != glyphs.end()) {
+    return &it->second;
+  }
+
+  Glyph glyph;
+  if (!add_glyph(code_point, glyph)) {
+    return nullptr;
+  }
+  return &glyphs.emplace(code_point, glyph).first->second;
+}
+
+/**
+ * \brief Returns the kerning between two glyphs.
+ * \param previous_code_point Code point of the glyph on the left.
+ * \param code_point Code point of the glyph on the right.
+ * \return Horizontal adjustment to add between them,
+ * 0 if kerning is disabled.
+ */
+int GlyphAtlas::get_kerning(uint16_t previous_code_point, uint16_t code_point) const {
+
+#if SDL_VERSIONNUM(SDL_TTF_MAJOR_VERSION, SDL_TTF_MINOR_VERSION, SDL_TTF_PATCHLEVEL) >= SDL_VERSIONNUM(2, 0, 14)
+  if (TTF_GetFontKerning(&font) == 0) {
+    return 0;
+  }
+  return TTF_GetFontKerningSizeGlyphs(&font, previous_code_point, code_point);
+#else
+  (void) previous_code_point;
+  (void) code_point;
+  return 0;
+#endif
+}
+
+/**
+ * \brief Renders a glyph and copies it into the atlas.
+ * \param[in] code_point Unicode code point of the glyph.
+ * \param[out] glyph The glyph added.
+ * \return \c false if the glyph could not be rendered or does not fit.
+ */
+bool GlyphAtlas::add_glyph(uint16_t code_point, Glyph& glyph) {
+
+  int min_x = 0, max_x = 0, min_y = 0, max_y = 0, advance = 0;
+  if (TTF_GlyphMetrics(&font, code_point, &min_x, &max_x, &min_y, &max_y, &advance) != 0) {
+    return false;
+  }
+  glyph.min_x = min_x;
+  glyph.max_x = max_x;
+  glyph.advance = advance;
+  glyph.region = Rectangle();
+
+  if (min_x == max_x || min_y == max_y) {
+    // Nothing to draw, and some fonts fail to render whitespaces.
+    return true;
+  }
+
+  // Render the glyph as a one-character line, so that it has the same
+  // height and baseline as when SDL_ttf renders a whole line.
+  char utf8[4] = { 0, 0, 0, 0 };
+  if (code_point < 0x80) {
+    utf8[0] = static_cast<char>(code_point);
+  }
+  else if (code_point < 0x800) {
+    utf8[0] = static_cast<char>(0xC0 | (code_point >> 6));
+    utf8[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+  else {
+    utf8[0] = static_cast<char>(0xE0 | (code_point >> 12));
+    utf8[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    utf8[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+
+  SDL_Color internal_color;
+  color.get_components(
+      internal_color.r, internal_color.g, internal_color.b, internal_color.a);
+  SDL_Surface_UniquePtr rendered;
+  switch (rendering_mode) {
+
+  case TextSurface::RenderingMode::SOLID:
+    rendered = SDL_Surface_UniquePtr(
+        TTF_RenderUTF8_Solid(&font, utf8, internal_color));
+    break;
+
+  case TextSurface::RenderingMode::ANTIALIASING:
+    rendered = SDL_Surface_UniquePtr(
+        TTF_RenderUTF8_Blended(&font, utf8, internal_color));
+    break;
+  }
+  if (rendered == nullptr) {
+    return false;
+  }
+
+  Point position;
+  if (!reserve(Size(rendered->w, rendered->h), position)) {
+    return false;
+  }
+
+  SDL_PixelFormat* format = Video::get_pixel_format();
+  SDL_Surface_UniquePtr full = SDL_Surface_UniquePtr(SDL_CreateRGBSurface(
+       0,
+       rendered->w,
+       rendered->h,
+       32,
+       format->Rmask,
+       format->Gmask,
+       format->Bmask,
+       format->Amask));
+  SDL_BlitSurface(rendered.get(), nullptr, full.get(), nullptr);
+  SurfacePtr glyph_surface = Surface::create(std::move(full), true);
+  glyph_surface->set_blend_mode(BlendMode::NONE);
+  glyph_surface->draw(surface, position);
+
+  glyph.region = Rectangle(position, glyph_surface->get_size());
+  return true;
+}
+
+/**
+ * \brief Finds room for a glyph in the atlas.
+ *
+ * Glyphs are placed from left to right in rows.
+ * The atlas surface is created or made taller if needed.
+ *
+ * \param[in] size Size of the glyph.
+ * \param[out] position Where to put the glyph.
+ * \return \c false if the atlas is full.
+ */
+bool GlyphAtlas::reserve(const Size& size, Point& position) {
+
+  // Leave one pixel between glyphs so that filtering does not mix them.
+  constexpr int padding = 1;
+  if (size.width + padding > width) {
+    return false;
+  }
+
+  if (row_position.x + size.width + padding > width) {
+    // Start a new row.
+    row_position = Point(0, row_position.y + row_height);
+    row_height = 0;
+  }
+
+  const int bottom = row_position.y + size.height + padding;
+  const int height = surface != nullptr ? surface->get_height() : 0;
+  if (bottom > height) {
+    int new_height = std::max(height, initial_height);
+    while (new_height < bottom) {
+      new_height *= 2;
+    }
+    if (new_height > max_height) {
+      return false;
+    }
+
+    SurfacePtr new_surface = Surface::create(width, new_height);
+    if (surface != nullptr) {
+      surface->set_blend_mode(BlendMode::NONE);
+      surface->draw(new_surface);
+    }
+    surface = new_surface;
+  }
+
+  position = row_position;
+  row_position.x += size.width + padding;
+  row_height = std::max(row_height, size.height + padding);
+  return true;
+}
+
+}
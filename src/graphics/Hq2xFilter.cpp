@@ -35,18 +35,36 @@ int Hq2xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Hq2xFilter::filter(
+void Hq2xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
-    uint32_t* dst) const {
+    uint32_t* dst,
+    int first_row,
+    int num_rows) const {
+
+  const uint32_t src_row_bytes = src_width * sizeof(uint32_t);
+  hq2x_32_rb_rows(
+      const_cast<uint32_t*>(src),
+      src_row_bytes,
+      dst,
+      src_row_bytes * 2,
+      src_width,
+      src_height,
+      first_row,
+      num_rows
+  );
+}
+
+/**
+ * \copydoc SoftwarePixelFilter::prepare_filter
+ */
+void Hq2xFilter::prepare_filter() const {
 
   // Make sure hqx is initialized.
   Hq4xFilter::initialize_hqx();
-
-  hq2x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
 }
 
 }
@@ -21,6 +21,31 @@ namespace Solarus {
 
 namespace {
   bool hqx_initialized = false;   /**< Whether the common hqx initialization was done. */
+
+/**
+ * \brief Converts a SIMD instruction set to its hqx value.
+ * \param simd A SIMD instruction set.
+ * \return The corresponding HQX_SIMD_* value.
+ */
+int get_hqx_simd(SoftwarePixelFilter::Simd simd) {
+
+  switch (simd) {
+
+  case SoftwarePixelFilter::Simd::SSE2:
+    return HQX_SIMD_SSE2;
+
+  case SoftwarePixelFilter::Simd::AVX2:
+    return HQX_SIMD_AVX2;
+
+  case SoftwarePixelFilter::Simd::NEON:
+    return HQX_SIMD_NEON;
+
+  case SoftwarePixelFilter::Simd::NONE:
+    break;
+  }
+  return HQX_SIMD_NONE;
+}
+
 }
 
 /**
@@ -38,24 +63,43 @@ int Hq4xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Hq4xFilter::filter(
+void Hq4xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
-    uint32_t* dst) const {
+    uint32_t* dst,
+    int first_row,
+    int num_rows) const {
+
+  const uint32_t src_row_bytes = src_width * sizeof(uint32_t);
+  hq4x_32_rb_rows(
+      const_cast<uint32_t*>(src),
+      src_row_bytes,
+      dst,
+      src_row_bytes * 4,
+      src_width,
+      src_height,
+      first_row,
+      num_rows
+  );
+}
+
+/**
+ * \copydoc SoftwarePixelFilter::prepare_filter
+ */
+void Hq4xFilter::prepare_filter() const {
 
   // Make sure hqx is initialized.
   initialize_hqx();
-
-  hq4x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
 }
 
 /**
  * \brief Performs the initialization common to the 3 variants of hqx.
  *
- * Does nothing if the initialization was already done.
+ * The lookup table is only computed the first time.
+ * The SIMD instruction set is updated each time.
  */
 void Hq4xFilter::initialize_hqx() {
 
@@ -63,6 +107,7 @@ void Hq4xFilter::initialize_hqx() {
     hqx_initialized = true;
     hqxInit();
   }
+  hqxSetSimd(get_hqx_simd(get_simd()));
 }
 
 }
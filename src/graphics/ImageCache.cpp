@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/ImageCache.h"
+#include "solarus/core/Logger.h"
+#include <map>
+#include <mutex>
+
+namespace Solarus {
+namespace ImageCache {
+
+namespace {
+
+/**
+ * \brief An image of the cache.
+ */
+struct Entry {
+  SurfaceImplPtr texture;      /**< The texture of the image. */
+  uint64_t last_use = 0;       /**< Date of the last get(), in number of calls. */
+};
+
+std::mutex mutex;                         /**< Lock for the cache. */
+std::map<std::string, Entry> entries;     /**< Images by file name. */
+uint64_t num_uses = 0;                    /**< Calls to get() and add() so far. */
+Stats stats;                              /**< Counters of the cache. */
+
+/**
+ * \brief Returns the video memory taken by a texture.
+ * \param texture A texture.
+ * \return Its size in bytes.
+ */
+int64_t get_vram_bytes(const SurfaceImpl& texture) {
+  return static_cast<int64_t>(texture.get_width()) * texture.get_height() * 4;
+}
+
+/**
+ * \brief Returns the main memory taken by the software copy of a texture.
+ * \param texture A texture.
+ * \return Its size in bytes, or 0 if there is no copy.
+ */
+int64_t get_ram_bytes(const SurfaceImpl& texture) {
+  return texture.has_software_copy() ? get_vram_bytes(texture) : 0;
+}
+
+/**
+ * \brief Returns whether an image is only kept by the cache.
+ * \param entry An image of the cache.
+ * \return \c true if it can be evicted.
+ */
+bool is_unreferenced(const Entry& entry) {
+  return entry.texture.use_count() == 1;
+}
+
+/**
+ * \brief Evicts the least recently used unreferenced images until the
+ * memory taken is within the budgets.
+ *
+ * The mutex must be locked.
+ */
+void trim_locked() {
+
+  if (stats.vram_budget <= 0 && stats.ram_budget <= 0) {
+    return;
+  }
+
+  // Software copies may have been freed or decoded again since the images
+  // were added: measure again.
+  int64_t vram_bytes = 0;
+  int64_t ram_bytes = 0;
+  for (const auto& kvp : entries) {
+    vram_bytes += get_vram_bytes(*kvp.second.texture);
+    ram_bytes += get_ram_bytes(*kvp.second.texture);
+  }
+
+  while ((stats.vram_budget > 0 && vram_bytes > stats.vram_budget) ||
+         (stats.ram_budget > 0 && ram_bytes > stats.ram_budget)) {
+
+    auto oldest = entries.end();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (is_unreferenced(it->second) &&
+          (oldest == entries.end() || it->second.last_use < oldest->second.last_use)) {
+        oldest = it;
+      }
+    }
+    if (oldest == entries.end()) {
+      // Everything left is in use.
+      break;
+    }
+
+    vram_bytes -= get_vram_bytes(*oldest->second.texture);
+    ram_bytes -= get_ram_bytes(*oldest->second.texture);
+    entries.erase(oldest);
+    ++stats.evictions;
+  }
+}
+
+}
+
+/**
+ * \brief Returns the texture of an image file if it is in the cache.
+ * \param file_name Name of the image file, relative to the data directory.
+ * \return The texture, or nullptr if it has to be loaded.
+ */
+SurfaceImplPtr get(const std::string& file_name) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto it = entries.find(file_name);
+  if (it == entries.end()) {
+    ++stats.misses;
+    return nullptr;
+  }
+  ++stats.hits;
+  it->second.last_use = ++num_uses;
+  return it->second.texture;
+}
+
+/**
+ * \brief Adds the texture of an image file to the cache.
+ *
+ * Then evicts unreferenced images if the budgets are exceeded.
+ * Does nothing if the image is already in the cache.
+ *
+ * \param file_name Name of the image file, relative to the data directory.
+ * \param texture The texture loaded from this file.
+ */
+void add(const std::string& file_name, const SurfaceImplPtr& texture) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Entry& entry = entries[file_name];
+  if (entry.texture != nullptr) {
+    return;
+  }
+  entry.texture = texture;
+  entry.last_use = ++num_uses;
+  trim_locked();
+}
+
+/**
+ * \brief Returns whether an image file is in the cache.
+ *
+ * Unlike get(), this does not count as a use of the image.
+ *
+ * \param file_name Name of the image file, relative to the data directory.
+ * \return \c true if the image is in the cache.
+ */
+bool has(const std::string& file_name) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.find(file_name) != entries.end();
+}
+
+/**
+ * \brief Removes an image from the cache.
+ *
+ * Its texture stays alive while surfaces use it, but the next surfaces
+ * created from this file will load it again.
+ *
+ * \param file_name Name of the image file, relative to the data directory.
+ */
+void remove(const std::string& file_name) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(file_name);
+}
+
+/**
+ * \brief Evicts unreferenced images until the budgets are respected.
+ *
+ * Called when the map changes, since the images of the previous map may
+ * not be referenced anymore.
+ */
+void trim() {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  trim_locked();
+}
+
+/**
+ * \brief Removes all images from the cache.
+ *
+ * Textures still referenced stay alive but are not shared anymore.
+ */
+void clear() {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+}
+
+/**
+ * \brief Sets the maximum memory that images may take.
+ * \param vram_budget Maximum video memory in bytes, or 0 for no limit.
+ * \param ram_budget Maximum main memory in bytes, or 0 for no limit.
+ */
+void set_budgets(int64_t vram_budget, int64_t ram_budget) {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  stats.vram_budget = vram_budget;
+  stats.ram_budget = ram_budget;
+  if (vram_budget > 0 || ram_budget > 0) {
+    Logger::info("Image cache budget: " +
+        std::to_string(vram_budget / (1024 * 1024)) + " MiB video, " +
+        std::to_string(ram_budget / (1024 * 1024)) + " MiB main memory");
+  }
+  trim_locked();
+}
+
+/**
+ * \brief Returns the statistics of the cache.
+ * \return The counters and the memory currently taken.
+ */
+Stats get_stats() {
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats result = stats;
+  for (const auto& kvp : entries) {
+    ++result.num_images;
+    if (is_unreferenced(kvp.second)) {
+      ++result.num_unreferenced;
+    }
+    result.vram_bytes += get_vram_bytes(*kvp.second.texture);
+    result.ram_bytes += get_ram_bytes(*kvp.second.texture);
+  }
+  return result;
+}
+
+}
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/KtxImage.h"
+#include "solarus/core/Debug.h"
+#include <cstring>
+
+namespace Solarus {
+
+namespace {
+
+const uint8_t ktx2_identifier[] = {
+  0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+constexpr size_t header_size = 80;       /**< Identifier, header and index. */
+constexpr size_t level_index_size = 24;  /**< Size of an entry of the level index. */
+
+/**
+ * \brief Reads a little-endian 32-bit integer.
+ * \param bytes The bytes to read.
+ * \return The value.
+ */
+uint32_t read_uint32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) |
+      (static_cast<uint32_t>(bytes[1]) << 8) |
+      (static_cast<uint32_t>(bytes[2]) << 16) |
+      (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+/**
+ * \brief Reads a little-endian 64-bit integer.
+ * \param bytes The bytes to read.
+ * \return The value.
+ */
+uint64_t read_uint64(const uint8_t* bytes) {
+  return static_cast<uint64_t>(read_uint32(bytes)) |
+      (static_cast<uint64_t>(read_uint32(bytes + 4)) << 32);
+}
+
+}
+
+/**
+ * \brief Creates an empty image.
+ */
+KtxImage::KtxImage():
+  format(FORMAT_UNDEFINED),
+  width(0),
+  height(0) {
+
+}
+
+/**
+ * \brief Reads a KTX2 file from memory.
+ *
+ * Emits a warning and returns \c false if the file is invalid or uses a
+ * feature that is not supported.
+ *
+ * \param file_data Content of the file.
+ * \param size Size of the file in bytes.
+ * \return \c true in case of success.
+ */
+bool KtxImage::load(const void* file_data, size_t size) {
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(file_data);
+  if (size < header_size + level_index_size ||
+      std::memcmp(bytes, ktx2_identifier, sizeof(ktx2_identifier)) != 0) {
+    Debug::warning("Not a KTX2 file");
+    return false;
+  }
+
+  const Format file_format = static_cast<Format>(read_uint32(bytes + 12));
+  const uint32_t pixel_width = read_uint32(bytes + 20);
+  const uint32_t pixel_height = read_uint32(bytes + 24);
+  const uint32_t pixel_depth = read_uint32(bytes + 28);
+  const uint32_t layer_count = read_uint32(bytes + 32);
+  const uint32_t face_count = read_uint32(bytes + 36);
+  const uint32_t supercompression_scheme = read_uint32(bytes + 44);
+
+  const size_t block_size = get_block_size(file_format);
+  if (block_size == 0) {
+    Debug::warning("Unsupported KTX2 format: " + std::to_string(file_format));
+    return false;
+  }
+  if (supercompression_scheme != 0) {
+    Debug::warning("Supercompressed KTX2 files are not supported");
+    return false;
+  }
+  if (pixel_width == 0 || pixel_height == 0 || pixel_width > 16384 || pixel_height > 16384 ||
+      pixel_depth > 1 || layer_count > 1 || face_count != 1) {
+    Debug::warning("Only 2D KTX2 images are supported");
+    return false;
+  }
+
+  // The first entry of the level index is the full size image.
+  const uint64_t level_offset = read_uint64(bytes + header_size);
+  const uint64_t level_length = read_uint64(bytes + header_size + 8);
+  const uint64_t expected_length =
+      static_cast<uint64_t>((pixel_width + 3) / 4) * ((pixel_height + 3) / 4) * block_size;
+  if (level_length < expected_length ||
+      level_offset > size ||
+      expected_length > size - level_offset) {
+    Debug::warning("Truncated KTX2 file");
+    return false;
+  }
+
+  format = file_format;
+  width = static_cast<int>(pixel_width);
+  height = static_cast<int>(pixel_height);
+  data.assign(bytes + level_offset, bytes + level_offset + expected_length);
+  return true;
+}
+
+/**
+ * \brief Returns the compression format of the image.
+ * \return The format, or FORMAT_UNDEFINED if nothing is loaded.
+ */
+KtxImage::Format KtxImage::get_format() const {
+  return format;
+}
+
+/**
+ * \brief Returns the width of the image.
+ * \return The width in pixels.
+ */
+int KtxImage::get_width() const {
+  return width;
+}
+
+/**
+ * \brief Returns the height of the image.
+ * \return The height in pixels.
+ */
+int KtxImage::get_height() const {
+  return height;
+}
+
+/**
+ * \brief Returns the compressed pixels.
+ * \return The 4x4 blocks of the image, row by row.
+ */
+const std::vector<uint8_t>& KtxImage::get_data() const {
+  return data;
+}
+
+/**
+ * \brief Returns the name of the precompressed version of an image file.
+ * \param image_file_name Name of an image file, relative to the data
+ * directory.
+ * \return The same name with the .ktx2 extension.
+ */
+std::string KtxImage::get_file_name(const std::string& image_file_name) {
+
+  const size_t dot_index = image_file_name.rfind('.');
+  const size_t slash_index = image_file_name.rfind('/');
+  if (dot_index == std::string::npos ||
+      (slash_index != std::string::npos && dot_index < slash_index)) {
+    return image_file_name + ".ktx2";
+  }
+  return image_file_name.substr(0, dot_index) + ".ktx2";
+}
+
+/**
+ * \brief Returns the size of a 4x4 block of pixels in a format.
+ * \param format A format.
+ * \return The size in bytes, or 0 if the format is not supported.
+ */
+size_t KtxImage::get_block_size(Format format) {
+
+  switch (format) {
+
+  case FORMAT_BC1_RGBA:
+    return 8;
+
+  case FORMAT_BC3:
+  case FORMAT_BC7:
+  case FORMAT_ETC2_RGBA:
+  case FORMAT_ASTC_4x4:
+    return 16;
+
+  case FORMAT_UNDEFINED:
+    break;
+  }
+  return 0;
+}
+
+/**
+ * \brief Returns a human-readable name of a format.
+ * \param format A format.
+ * \return The name of the format.
+ */
+std::string KtxImage::get_format_name(Format format) {
+
+  switch (format) {
+
+  case FORMAT_BC1_RGBA:
+    return "BC1";
+
+  case FORMAT_BC3:
+    return "BC3";
+
+  case FORMAT_BC7:
+    return "BC7";
+
+  case FORMAT_ETC2_RGBA:
+    return "ETC2";
+
+  case FORMAT_ASTC_4x4:
+    return "ASTC 4x4";
+
+  case FORMAT_UNDEFINED:
+    break;
+  }
+  return "unknown";
+}
+
+}
+
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/PixelBitsCache.h"
+#include <algorithm>
+
+namespace Solarus {
+
+std::map<PixelBitsCache::Key, PixelBitsCache::Entry> PixelBitsCache::entries;
+size_t PixelBitsCache::max_entries = 256;
+
+/**
+ * \brief Returns the collision mask of a region of an image.
+ *
+ * The mask is computed if no one uses it yet.
+ *
+ * \param image The image.
+ * \param frame Region of the image.
+ * \return The mask of this region.
+ */
+std::shared_ptr<const PixelBits> PixelBitsCache::get(
+    const SurfaceImplPtr& image,
+    const Rectangle& frame) {
+
+  Debug::check_assertion(image != nullptr, "Missing image for pixel collisions");
+
+  const Key key(image.get(), frame.get_x(), frame.get_y(), frame.get_width(), frame.get_height());
+  Entry& entry = entries[key];
+  std::shared_ptr<const PixelBits> bits = entry.bits.lock();
+  if (bits != nullptr && entry.image.lock() == image) {
+    return bits;
+  }
+
+  bits = std::make_shared<const PixelBits>(*image, frame);
+  entry.image = image;
+  entry.bits = bits;
+
+  if (entries.size() > max_entries) {
+    remove_expired();
+  }
+  return bits;
+}
+
+/**
+ * \brief Removes the entries of masks or images that no longer exist.
+ */
+void PixelBitsCache::remove_expired() {
+
+  for (auto it = entries.begin(); it != entries.end(); ) {
+    if (it->second.bits.expired() || it->second.image.expired()) {
+      it = entries.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  // Don't scan again before the cache has grown enough.
+  max_entries = std::max(static_cast<size_t>(256), entries.size() * 2);
+}
+
+}
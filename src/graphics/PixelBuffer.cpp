@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/PixelBuffer.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a fully transparent pixel buffer.
+ * \param width Width in pixels.
+ * \param height Height in pixels.
+ */
+PixelBuffer::PixelBuffer(int width, int height):
+  ExportableToLua(),
+  width(width),
+  height(height),
+  pixels(static_cast<size_t>(width) * height * 4, 0),
+  dirty_region(0, 0, 0, 0) {
+
+  Debug::check_assertion(width > 0 && height > 0, "Empty pixel buffer");
+}
+
+/**
+ * \brief Returns the width of this buffer.
+ * \return The width in pixels.
+ */
+int PixelBuffer::get_width() const {
+  return width;
+}
+
+/**
+ * \brief Returns the height of this buffer.
+ * \return The height in pixels.
+ */
+int PixelBuffer::get_height() const {
+  return height;
+}
+
+/**
+ * \brief Returns the size of this buffer.
+ * \return The size in pixels.
+ */
+Size PixelBuffer::get_size() const {
+  return { width, height };
+}
+
+/**
+ * \brief Returns the pixels of this buffer.
+ *
+ * Call add_dirty_region() after modifying them.
+ *
+ * \return The first pixel. The address stays valid as long as the
+ * buffer exists.
+ */
+uint8_t* PixelBuffer::get_data() {
+  return pixels.data();
+}
+
+/**
+ * \brief Returns the pixels of this buffer.
+ * \return The first pixel.
+ */
+const uint8_t* PixelBuffer::get_data() const {
+  return pixels.data();
+}
+
+/**
+ * \brief Returns the number of bytes between two rows of pixels.
+ * \return The pitch in bytes.
+ */
+int PixelBuffer::get_pitch() const {
+  return width * 4;
+}
+
+/**
+ * \brief Returns whether a point is inside this buffer.
+ * \param x X coordinate of the point.
+ * \param y Y coordinate of the point.
+ * \return \c true if there is a pixel at these coordinates.
+ */
+bool PixelBuffer::contains(int x, int y) const {
+  return x >= 0 && x < width && y >= 0 && y < height;
+}
+
+/**
+ * \brief Returns the color of a pixel.
+ * \param x X coordinate of a pixel inside the buffer.
+ * \param y Y coordinate of a pixel inside the buffer.
+ * \return The color of this pixel.
+ */
+Color PixelBuffer::get_pixel(int x, int y) const {
+
+  SOLARUS_ASSERT(contains(x, y), "Pixel outside the buffer");
+  const uint8_t* pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+  return Color(pixel[0], pixel[1], pixel[2], pixel[3]);
+}
+
+/**
+ * \brief Sets the color of a pixel.
+ * \param x X coordinate of a pixel inside the buffer.
+ * \param y Y coordinate of a pixel inside the buffer.
+ * \param color The new color of this pixel.
+ */
+void PixelBuffer::set_pixel(int x, int y, const Color& color) {
+
+  SOLARUS_ASSERT(contains(x, y), "Pixel outside the buffer");
+  uint8_t* pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+  color.get_components(pixel[0], pixel[1], pixel[2], pixel[3]);
+  add_dirty_region(Rectangle(x, y, 1, 1));
+}
+
+/**
+ * \brief Fills the whole buffer with a color.
+ * \param color The color to set.
+ */
+void PixelBuffer::fill(const Color& color) {
+  fill(color, Rectangle(0, 0, width, height));
+}
+
+/**
+ * \brief Fills a rectangle of this buffer with a color.
+ *
+ * Pixels are replaced, not blended.
+ *
+ * \param color The color to set.
+ * \param where The rectangle to fill. It is clipped to the buffer.
+ */
+void PixelBuffer::fill(const Color& color, const Rectangle& where) {
+
+  const Rectangle region = clip(where);
+  if (region.is_flat()) {
+    return;
+  }
+
+  uint8_t pixel[4];
+  color.get_components(pixel[0], pixel[1], pixel[2], pixel[3]);
+  uint8_t* row = &pixels[(static_cast<size_t>(region.get_y()) * width + region.get_x()) * 4];
+  uint8_t* first_row = row;
+  const size_t row_size = static_cast<size_t>(region.get_width()) * 4;
+  for (int x = 0; x < region.get_width(); ++x) {
+    std::copy(pixel, pixel + 4, row + x * 4);
+  }
+  for (int y = 1; y < region.get_height(); ++y) {
+    row += get_pitch();
+    std::copy(first_row, first_row + row_size, row);
+  }
+  add_dirty_region(region);
+}
+
+/**
+ * \brief Copies pixels of another buffer into this one.
+ *
+ * Pixels are replaced, not blended. The source may be this buffer.
+ *
+ * \param src The buffer to copy pixels from.
+ * \param src_region The rectangle to copy in the source buffer.
+ * \param dst_position Where to copy it in this buffer.
+ */
+void PixelBuffer::blit(
+    const PixelBuffer& src,
+    const Rectangle& src_region,
+    const Point& dst_position) {
+
+  // Clip to the source, then to the destination.
+  Rectangle region = src.clip(src_region);
+  const Point offset = dst_position - src_region.get_xy();
+  Rectangle dst_region = clip(Rectangle(region.get_xy() + offset, region.get_size()));
+  if (dst_region.is_flat()) {
+    return;
+  }
+  region = Rectangle(dst_region.get_xy() - offset, dst_region.get_size());
+
+  const size_t row_size = static_cast<size_t>(region.get_width()) * 4;
+  const uint8_t* src_row = &src.pixels[(static_cast<size_t>(region.get_y()) * src.width + region.get_x()) * 4];
+  uint8_t* dst_row = &pixels[(static_cast<size_t>(dst_region.get_y()) * width + dst_region.get_x()) * 4];
+  if (&src == this && dst_region.get_y() > region.get_y()) {
+    // Overlapping copy downwards: start from the last row.
+    const int last = region.get_height() - 1;
+    src_row += last * src.get_pitch();
+    dst_row += last * get_pitch();
+    for (int y = 0; y < region.get_height(); ++y) {
+      std::memmove(dst_row, src_row, row_size);
+      src_row -= src.get_pitch();
+      dst_row -= get_pitch();
+    }
+  }
+  else {
+    for (int y = 0; y < region.get_height(); ++y) {
+      std::memmove(dst_row, src_row, row_size);
+      src_row += src.get_pitch();
+      dst_row += get_pitch();
+    }
+  }
+  add_dirty_region(dst_region);
+}
+
+/**
+ * \brief Copies pixels of a surface into this buffer.
+ *
+ * The whole buffer is replaced. The dirty region is not changed.
+ *
+ * \param surface The surface to read.
+ * \param src_position Position in the surface of the pixel to copy
+ * to the upper-left corner of this buffer.
+ */
+void PixelBuffer::read_from_surface(const Surface& surface, const Point& src_position) {
+
+  const Rectangle src_region = Rectangle(src_position, get_size()).get_intersection(
+      Rectangle(0, 0, surface.get_width(), surface.get_height()));
+  if (src_region.is_flat()) {
+    return;
+  }
+  const Point dst_position = src_region.get_xy() - src_position;
+  surface.get_impl().get_pixels(
+      &pixels[(static_cast<size_t>(dst_position.y) * width + dst_position.x) * 4],
+      get_pitch(),
+      src_region
+  );
+}
+
+/**
+ * \brief Copies pixels of this buffer to a surface.
+ *
+ * Only the pixels copied are uploaded to video memory.
+ * Pixels are replaced, not blended.
+ *
+ * \param surface The surface to modify.
+ * \param src_region The rectangle to copy in this buffer.
+ * \param dst_position Where to copy it in the surface.
+ */
+void PixelBuffer::upload_to_surface(
+    Surface& surface,
+    const Rectangle& src_region,
+    const Point& dst_position) const {
+
+  Rectangle region = clip(src_region);
+  const Point offset = dst_position - src_region.get_xy();
+  const Rectangle dst_region = Rectangle(region.get_xy() + offset, region.get_size()).get_intersection(
+      Rectangle(0, 0, surface.get_width(), surface.get_height()));
+  if (dst_region.is_flat()) {
+    return;
+  }
+  region = Rectangle(dst_region.get_xy() - offset, dst_region.get_size());
+
+  surface.get_impl().set_pixels(
+      &pixels[(static_cast<size_t>(region.get_y()) * width + region.get_x()) * 4],
+      get_pitch(),
+      dst_region
+  );
+}
+
+/**
+ * \brief Returns the region modified since the last clear_dirty_region().
+ * \return The modified region, or a flat rectangle.
+ */
+const Rectangle& PixelBuffer::get_dirty_region() const {
+  return dirty_region;
+}
+
+/**
+ * \brief Adds a rectangle to the modified region.
+ * \param region The rectangle modified. It is clipped to the buffer.
+ */
+void PixelBuffer::add_dirty_region(const Rectangle& region) {
+
+  const Rectangle clipped = clip(region);
+  if (clipped.is_flat()) {
+    return;
+  }
+  dirty_region |= clipped;
+}
+
+/**
+ * \brief Forgets the modified region, typically after uploading it.
+ */
+void PixelBuffer::clear_dirty_region() {
+  dirty_region = Rectangle(0, 0, 0, 0);
+}
+
+/**
+ * \brief Returns the part of a rectangle that is inside this buffer.
+ * \param region A rectangle.
+ * \return Its intersection with the buffer, possibly flat.
+ */
+Rectangle PixelBuffer::clip(const Rectangle& region) const {
+  return region.get_intersection(Rectangle(0, 0, width, height));
+}
+
+/**
+ * \brief Returns the name identifying this type in Lua.
+ * \return The name identifying this type in Lua.
+ */
+const std::string& PixelBuffer::get_lua_type_name() const {
+  return LuaContext::pixel_buffer_module_name;
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/JobSystem.h"
+#include "solarus/graphics/PixelFilterExecutor.h"
+#include <algorithm>
+#include <thread>
+
+namespace Solarus {
+
+constexpr int PixelFilterExecutor::min_rows_per_band;
+
+namespace {
+
+int wanted_num_threads = 0;              /**< Number of threads requested, 0 means automatic. */
+
+}
+
+/**
+ * \brief Filters an image, possibly on several threads.
+ *
+ * Returns when all rows are filtered.
+ *
+ * \param num_rows Number of rows of the source image.
+ * \param band_function Function that filters a band of rows.
+ * It is called from several threads at the same time.
+ */
+void PixelFilterExecutor::run(int num_rows, const BandFunction& band_function) {
+
+  run(num_rows, min_rows_per_band, band_function);
+}
+
+/**
+ * \brief Runs a loop, possibly on several threads.
+ *
+ * Returns when all rows are processed.
+ *
+ * \param num_rows Number of rows, or items, to process.
+ * \param min_rows_per_job_band Minimum number of rows worth giving
+ * to a thread.
+ * \param band_function Function that processes a band of rows.
+ * It is called from several threads at the same time.
+ */
+void PixelFilterExecutor::run(
+    int num_rows,
+    int min_rows_per_job_band,
+    const BandFunction& band_function) {
+
+  if (num_rows <= 0) {
+    return;
+  }
+
+  const int num_bands = std::min(get_num_threads(), num_rows / std::max(1, min_rows_per_job_band));
+  if (num_bands <= 1) {
+    band_function(0, num_rows);
+    return;
+  }
+
+  // Bands big enough so that there are no more than num_bands of them.
+  JobSystem::parallel_for(num_rows, (num_rows + num_bands - 1) / num_bands, band_function);
+}
+
+/**
+ * \brief Returns the number of threads used to filter an image.
+ * \return The number of threads, the main thread included.
+ */
+int PixelFilterExecutor::get_num_threads() {
+
+  if (wanted_num_threads > 0) {
+    return wanted_num_threads;
+  }
+
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, std::min(4, num_cores));
+}
+
+/**
+ * \brief Sets the number of threads used to filter an image.
+ * \param num_threads The number of threads, the main thread included,
+ * or 0 to use the number of cores, up to 4.
+ */
+void PixelFilterExecutor::set_num_threads(int num_threads) {
+
+  wanted_num_threads = std::max(0, num_threads);
+}
+
+}
@@ -11,4 +11,30 @@ Renderer::Renderer() {
 Renderer::~Renderer() {
 
 }
+
+/**
+ * @copydoc Renderer::read_pixels_async
+ */
+void Renderer::read_pixels_async(const SurfaceImplPtr& surf, const PixelsCallback& callback) {
+  pending_pixel_reads.emplace_back(surf, callback);
+}
+
+/**
+ * @copydoc Renderer::update_pixel_reads
+ */
+void Renderer::update_pixel_reads() {
+  //Callbacks may request other reads: they will be done next time
+  std::vector<std::pair<SurfaceImplPtr, PixelsCallback>> reads;
+  reads.swap(pending_pixel_reads);
+  for(const auto& read : reads) {
+    read.second(read.first->get_pixels());
+  }
+}
+
+/**
+ * @copydoc Renderer::cancel_pixel_reads
+ */
+void Renderer::cancel_pixel_reads() {
+  pending_pixel_reads.clear();
+}
 }
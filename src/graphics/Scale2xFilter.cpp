@@ -14,10 +14,274 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/graphics/DefaultShaders.h"
 #include "solarus/graphics/Scale2xFilter.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define SOLARUS_SCALE2X_X86
+#  include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define SOLARUS_SCALE2X_NEON
+#  include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__)
+#  define SOLARUS_SCALE2X_TARGET(x) __attribute__((target(x)))
+#else
+#  define SOLARUS_SCALE2X_TARGET(x)
+#endif
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Filters some pixels of a row.
+ *
+ * Neighbours outside the image are replaced by the pixel itself.
+ *
+ * \param above The row above, or the row itself for the first row.
+ * \param row The row to filter.
+ * \param below The row below, or the row itself for the last row.
+ * \param width Width of the rows.
+ * \param col Column of the first pixel to filter.
+ * \param end Column after the last pixel to filter.
+ * \param dst_top The first destination row.
+ * \param dst_bottom The second destination row.
+ */
+void filter_pixels_scalar(
+    const uint32_t* above,
+    const uint32_t* row,
+    const uint32_t* below,
+    int width,
+    int col,
+    int end,
+    uint32_t* dst_top,
+    uint32_t* dst_bottom) {
+
+  for (; col < end; ++col) {
+    const uint32_t b = above[col];
+    const uint32_t e = row[col];
+    const uint32_t h = below[col];
+    const uint32_t d = (col == 0) ? e : row[col - 1];
+    const uint32_t f = (col == width - 1) ? e : row[col + 1];
+
+    if (b != h && d != f) {
+      dst_top[2 * col] = (d == b) ? d : e;
+      dst_top[2 * col + 1] = (b == f) ? f : e;
+      dst_bottom[2 * col] = (d == h) ? d : e;
+      dst_bottom[2 * col + 1] = (h == f) ? f : e;
+    }
+    else {
+      dst_top[2 * col] = dst_top[2 * col + 1] = e;
+      dst_bottom[2 * col] = dst_bottom[2 * col + 1] = e;
+    }
+  }
+}
+
+/**
+ * \brief Filters a row with scalar code only.
+ *
+ * Parameters are the same as for filter_pixels_scalar().
+ */
+void filter_row_scalar(
+    const uint32_t* above,
+    const uint32_t* row,
+    const uint32_t* below,
+    int width,
+    uint32_t* dst_top,
+    uint32_t* dst_bottom) {
+
+  filter_pixels_scalar(above, row, below, width, 0, width, dst_top, dst_bottom);
+}
+
+#ifdef SOLARUS_SCALE2X_X86
+
+/**
+ * \brief Filters a row 4 pixels at a time with SSE2.
+ *
+ * The first and last pixels have missing neighbours: they use scalar code.
+ */
+SOLARUS_SCALE2X_TARGET("sse2")
+void filter_row_sse2(
+    const uint32_t* above,
+    const uint32_t* row,
+    const uint32_t* below,
+    int width,
+    uint32_t* dst_top,
+    uint32_t* dst_bottom) {
+
+  filter_pixels_scalar(above, row, below, width, 0, std::min(1, width), dst_top, dst_bottom);
+
+  int col = 1;
+  for (; col + 4 < width; col += 4) {
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + col));
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + col - 1));
+    const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + col));
+    const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + col + 1));
+    const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + col));
+
+    // b != h && d != f
+    const __m128i cond = _mm_andnot_si128(
+        _mm_cmpeq_epi32(d, f),
+        _mm_andnot_si128(_mm_cmpeq_epi32(b, h), _mm_set1_epi32(-1))
+    );
+    const __m128i mask1 = _mm_and_si128(cond, _mm_cmpeq_epi32(d, b));
+    const __m128i mask2 = _mm_and_si128(cond, _mm_cmpeq_epi32(b, f));
+    const __m128i mask3 = _mm_and_si128(cond, _mm_cmpeq_epi32(d, h));
+    const __m128i mask4 = _mm_and_si128(cond, _mm_cmpeq_epi32(h, f));
+    const __m128i e1 = _mm_or_si128(_mm_and_si128(mask1, d), _mm_andnot_si128(mask1, e));
+    const __m128i e2 = _mm_or_si128(_mm_and_si128(mask2, f), _mm_andnot_si128(mask2, e));
+    const __m128i e3 = _mm_or_si128(_mm_and_si128(mask3, d), _mm_andnot_si128(mask3, e));
+    const __m128i e4 = _mm_or_si128(_mm_and_si128(mask4, f), _mm_andnot_si128(mask4, e));
+
+    __m128i* top = reinterpret_cast<__m128i*>(dst_top + 2 * col);
+    __m128i* bottom = reinterpret_cast<__m128i*>(dst_bottom + 2 * col);
+    _mm_storeu_si128(top, _mm_unpacklo_epi32(e1, e2));
+    _mm_storeu_si128(top + 1, _mm_unpackhi_epi32(e1, e2));
+    _mm_storeu_si128(bottom, _mm_unpacklo_epi32(e3, e4));
+    _mm_storeu_si128(bottom + 1, _mm_unpackhi_epi32(e3, e4));
+  }
+
+  filter_pixels_scalar(above, row, below, width, col, width, dst_top, dst_bottom);
+}
+
+/**
+ * \brief Filters a row 8 pixels at a time with AVX2.
+ *
+ * The first and last pixels have missing neighbours: they use scalar code.
+ */
+SOLARUS_SCALE2X_TARGET("avx2")
+void filter_row_avx2(
+    const uint32_t* above,
+    const uint32_t* row,
+    const uint32_t* below,
+    int width,
+    uint32_t* dst_top,
+    uint32_t* dst_bottom) {
+
+  filter_pixels_scalar(above, row, below, width, 0, std::min(1, width), dst_top, dst_bottom);
+
+  int col = 1;
+  for (; col + 8 < width; col += 8) {
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(above + col));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + col - 1));
+    const __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + col));
+    const __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + col + 1));
+    const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(below + col));
+
+    // b != h && d != f
+    const __m256i cond = _mm256_andnot_si256(
+        _mm256_cmpeq_epi32(d, f),
+        _mm256_andnot_si256(_mm256_cmpeq_epi32(b, h), _mm256_set1_epi32(-1))
+    );
+    const __m256i mask1 = _mm256_and_si256(cond, _mm256_cmpeq_epi32(d, b));
+    const __m256i mask2 = _mm256_and_si256(cond, _mm256_cmpeq_epi32(b, f));
+    const __m256i mask3 = _mm256_and_si256(cond, _mm256_cmpeq_epi32(d, h));
+    const __m256i mask4 = _mm256_and_si256(cond, _mm256_cmpeq_epi32(h, f));
+    const __m256i e1 = _mm256_blendv_epi8(e, d, mask1);
+    const __m256i e2 = _mm256_blendv_epi8(e, f, mask2);
+    const __m256i e3 = _mm256_blendv_epi8(e, d, mask3);
+    const __m256i e4 = _mm256_blendv_epi8(e, f, mask4);
+
+    // Unpacking works within each 128-bit lane: put the lanes back in order.
+    const __m256i top_low = _mm256_unpacklo_epi32(e1, e2);
+    const __m256i top_high = _mm256_unpackhi_epi32(e1, e2);
+    const __m256i bottom_low = _mm256_unpacklo_epi32(e3, e4);
+    const __m256i bottom_high = _mm256_unpackhi_epi32(e3, e4);
+    __m256i* top = reinterpret_cast<__m256i*>(dst_top + 2 * col);
+    __m256i* bottom = reinterpret_cast<__m256i*>(dst_bottom + 2 * col);
+    _mm256_storeu_si256(top, _mm256_permute2x128_si256(top_low, top_high, 0x20));
+    _mm256_storeu_si256(top + 1, _mm256_permute2x128_si256(top_low, top_high, 0x31));
+    _mm256_storeu_si256(bottom, _mm256_permute2x128_si256(bottom_low, bottom_high, 0x20));
+    _mm256_storeu_si256(bottom + 1, _mm256_permute2x128_si256(bottom_low, bottom_high, 0x31));
+  }
+
+  filter_pixels_scalar(above, row, below, width, col, width, dst_top, dst_bottom);
+}
+
+#endif
+
+#ifdef SOLARUS_SCALE2X_NEON
+
+/**
+ * \brief Filters a row 4 pixels at a time with NEON.
+ *
+ * The first and last pixels have missing neighbours: they use scalar code.
+ */
+void filter_row_neon(
+    const uint32_t* above,
+    const uint32_t* row,
+    const uint32_t* below,
+    int width,
+    uint32_t* dst_top,
+    uint32_t* dst_bottom) {
+
+  filter_pixels_scalar(above, row, below, width, 0, std::min(1, width), dst_top, dst_bottom);
+
+  int col = 1;
+  for (; col + 4 < width; col += 4) {
+    const uint32x4_t b = vld1q_u32(above + col);
+    const uint32x4_t d = vld1q_u32(row + col - 1);
+    const uint32x4_t e = vld1q_u32(row + col);
+    const uint32x4_t f = vld1q_u32(row + col + 1);
+    const uint32x4_t h = vld1q_u32(below + col);
+
+    // b != h && d != f
+    const uint32x4_t cond = vbicq_u32(vmvnq_u32(vceqq_u32(b, h)), vceqq_u32(d, f));
+    uint32x4x2_t top;
+    uint32x4x2_t bottom;
+    top.val[0] = vbslq_u32(vandq_u32(cond, vceqq_u32(d, b)), d, e);
+    top.val[1] = vbslq_u32(vandq_u32(cond, vceqq_u32(b, f)), f, e);
+    bottom.val[0] = vbslq_u32(vandq_u32(cond, vceqq_u32(d, h)), d, e);
+    bottom.val[1] = vbslq_u32(vandq_u32(cond, vceqq_u32(h, f)), f, e);
+    vst2q_u32(dst_top + 2 * col, top);
+    vst2q_u32(dst_bottom + 2 * col, bottom);
+  }
+
+  filter_pixels_scalar(above, row, below, width, col, width, dst_top, dst_bottom);
+}
+
+#endif
+
+using RowFilter = void (*)(
+    const uint32_t* above,
+    const uint32_t* row,
+    const uint32_t* below,
+    int width,
+    uint32_t* dst_top,
+    uint32_t* dst_bottom
+);
+
+/**
+ * \brief Returns the row filter to use with the current SIMD settings.
+ * \return The row filter.
+ */
+RowFilter get_row_filter() {
+
+  switch (SoftwarePixelFilter::get_simd()) {
+
+#ifdef SOLARUS_SCALE2X_X86
+  case SoftwarePixelFilter::Simd::AVX2:
+    return filter_row_avx2;
+
+  case SoftwarePixelFilter::Simd::SSE2:
+    return filter_row_sse2;
+#endif
+
+#ifdef SOLARUS_SCALE2X_NEON
+  case SoftwarePixelFilter::Simd::NEON:
+    return filter_row_neon;
+#endif
+
+  default:
+    return filter_row_scalar;
+  }
+}
+
+}
+
 /**
  * \brief Constructor.
  */
@@ -33,65 +297,33 @@ int Scale2xFilter::get_scaling_factor() const {
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::get_fragment_shader_source
  */
-void Scale2xFilter::filter(
+std::string Scale2xFilter::get_fragment_shader_source() const {
+  return DefaultShaders::get_scale2x_fragment_source();
+}
+
+/**
+ * \copydoc SoftwarePixelFilter::filter_rows
+ */
+void Scale2xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
-    uint32_t* dst) const {
+    uint32_t* dst,
+    int first_row,
+    int num_rows) const {
 
+  const RowFilter filter_row = get_row_filter();
   const int dst_width = src_width * 2;
 
-  int e1 = 0;
-  int e2, e3, e4;
-  int b, d, e = 0, f,  h;
-  for (int row = 0; row < src_height; row++) {
-    for (int col = 0; col < src_width; col++) {
-
-      // compute a to i
-
-      b = e - src_width;
-      d = e - 1;
-      f = e + 1;
-      h = e + src_width;
-
-      if (row == 0) {
-        b = e;
-      }
-      if (row == src_height - 1) {
-        h = e;
-      }
-      if (col == 0) {
-        d = e;
-      }
-      if (col == src_width - 1) {
-        f = e;
-      }
-
-      // compute e1 to e4
-      e2 = e1 + 1;
-      e3 = e1 + dst_width;
-      e4 = e3 + 1;
-
-      // compute the color
-
-      if (src[b] != src[h] && src[d] != src[f]) {
-        dst[e1] = src[(src[d] == src[b]) ? d : e];
-        dst[e2] = src[(src[b] == src[f]) ? f : e];
-        dst[e3] = src[(src[d] == src[h]) ? d : e];
-        dst[e4] = src[(src[h] == src[f]) ? f : e];
-      }
-      else {
-        dst[e1] = dst[e2] = dst[e3] = dst[e4] = src[e];
-      }
-      e1 += 2;
-      e++;
-    }
-    e1 += dst_width;
+  for (int row = first_row; row < first_row + num_rows; row++) {
+    const uint32_t* current = src + row * src_width;
+    const uint32_t* above = (row == 0) ? current : current - src_width;
+    const uint32_t* below = (row == src_height - 1) ? current : current + src_width;
+    uint32_t* dst_top = dst + 2 * row * dst_width;
+    filter_row(above, current, below, src_width, dst_top, dst_top + dst_width);
   }
-
 }
 
 }
-
@@ -272,6 +272,122 @@ void Shader::set_scaling_factor(double scaling_factor) {
   data.set_scaling_factor(scaling_factor);
 }
 
+/**
+ * \brief Returns a handle to set a uniform without looking up its name.
+ *
+ * The uniform is looked up in the program once, when its handle is created.
+ * Handles stay valid as long as the shader exists, even if the program has
+ * no such uniform: setting it then does nothing.
+ *
+ * \param uniform_name Name of the uniform.
+ * \return The handle of this uniform.
+ */
+int Shader::get_uniform_handle(const std::string& uniform_name) {
+
+  const auto it = uniform_handles.find(uniform_name);
+  if (it != uniform_handles.end()) {
+    return it->second;
+  }
+
+  const int handle = static_cast<int>(uniform_names.size());
+  uniform_handles.emplace(uniform_name, handle);
+  uniform_names.push_back(uniform_name);
+  resolve_uniform(handle, uniform_name);
+  return handle;
+}
+
+/**
+ * \brief Returns whether an integer is a uniform handle of this shader.
+ * \param handle The integer to test.
+ * \return \c true if it was returned by get_uniform_handle().
+ */
+bool Shader::is_uniform_handle(int handle) const {
+  return handle >= 0 && handle < static_cast<int>(uniform_names.size());
+}
+
+/**
+ * \brief Returns the name of the uniform of a handle.
+ * \param handle A uniform handle of this shader.
+ * \return The uniform name.
+ */
+const std::string& Shader::get_uniform_name(int handle) const {
+
+  Debug::check_assertion(is_uniform_handle(handle), "Invalid uniform handle");
+  return uniform_names[handle];
+}
+
+/**
+ * \brief Sets a uniform of type bool.
+ * \param uniform_name Name of the uniform.
+ * \param value The value.
+ */
+void Shader::set_uniform_1b(const std::string& uniform_name, bool value) {
+  set_uniform_1b(get_uniform_handle(uniform_name), value);
+}
+
+/**
+ * \brief Sets a uniform of type int.
+ * \param uniform_name Name of the uniform.
+ * \param value The value.
+ */
+void Shader::set_uniform_1i(const std::string& uniform_name, int value) {
+  set_uniform_1i(get_uniform_handle(uniform_name), value);
+}
+
+/**
+ * \brief Sets a uniform of type float.
+ * \param uniform_name Name of the uniform.
+ * \param value The value.
+ */
+void Shader::set_uniform_1f(const std::string& uniform_name, float value) {
+  set_uniform_1f(get_uniform_handle(uniform_name), value);
+}
+
+/**
+ * \brief Sets a uniform of type vec2.
+ * \param uniform_name Name of the uniform.
+ * \param value_1 The first component.
+ * \param value_2 The second component.
+ */
+void Shader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+  set_uniform_2f(get_uniform_handle(uniform_name), value_1, value_2);
+}
+
+/**
+ * \brief Sets a uniform of type vec3.
+ * \param uniform_name Name of the uniform.
+ * \param value_1 The first component.
+ * \param value_2 The second component.
+ * \param value_3 The third component.
+ */
+void Shader::set_uniform_3f(
+    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+  set_uniform_3f(get_uniform_handle(uniform_name), value_1, value_2, value_3);
+}
+
+/**
+ * \brief Sets a uniform of type vec4.
+ * \param uniform_name Name of the uniform.
+ * \param value_1 The first component.
+ * \param value_2 The second component.
+ * \param value_3 The third component.
+ * \param value_4 The fourth component.
+ */
+void Shader::set_uniform_4f(
+    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+  set_uniform_4f(get_uniform_handle(uniform_name), value_1, value_2, value_3, value_4);
+}
+
+/**
+ * \brief Sets a uniform of type sampler2D.
+ * \param uniform_name Name of the uniform.
+ * \param value The surface to sample.
+ * \return \c false if the surface cannot be used.
+ */
+bool Shader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
+  return set_uniform_texture(get_uniform_handle(uniform_name), value);
+}
+
 /**
  * \brief Returns the name identifying this type in Lua.
  * \return The name identifying this type in Lua.
@@ -14,10 +14,42 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/graphics/PixelFilterExecutor.h"
 #include "solarus/graphics/SoftwarePixelFilter.h"
+#include <SDL_cpuinfo.h>
+#include <SDL_version.h>
 
 namespace Solarus {
 
+namespace {
+
+bool simd_enabled = true;    /**< Whether filters may use SIMD instructions. */
+
+/**
+ * \brief Detects the best SIMD instruction set that filters can use.
+ * \return The SIMD instruction set supported by both the build and the CPU.
+ */
+SoftwarePixelFilter::Simd detect_simd() {
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  if SDL_VERSION_ATLEAST(2, 0, 2)
+  if (SDL_HasAVX2()) {
+    return SoftwarePixelFilter::Simd::AVX2;
+  }
+#  endif
+  if (SDL_HasSSE2()) {
+    return SoftwarePixelFilter::Simd::SSE2;
+  }
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && SDL_VERSION_ATLEAST(2, 0, 6)
+  if (SDL_HasNEON()) {
+    return SoftwarePixelFilter::Simd::NEON;
+  }
+#endif
+  return SoftwarePixelFilter::Simd::NONE;
+}
+
+}
+
 /**
  * \brief Constructor.
  */
@@ -30,5 +62,75 @@ SoftwarePixelFilter::SoftwarePixelFilter() {
 SoftwarePixelFilter::~SoftwarePixelFilter() {
 }
 
+/**
+ * \brief Applies the algorithm on a rectangle of pixels.
+ *
+ * Rows are filtered in parallel by several threads.
+ *
+ * \param src The rectangle of pixels in RGBA format.
+ * Must be a buffer of size src_width * src_height.
+ * \param src_width Width of the rectangle.
+ * \param src_height Height of the rectangle.
+ * \param dst The destination rectangle to write.
+ * Must be a buffer of size
+ * src_width * src_height * get_scaling_factor() * get_scaling_factor().
+ */
+void SoftwarePixelFilter::filter(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst) const {
+
+  prepare_filter();
+  PixelFilterExecutor::run(src_height, [&](int first_row, int num_rows) {
+    filter_rows(src, src_width, src_height, dst, first_row, num_rows);
+  });
+}
+
+/**
+ * \brief Returns the source of a fragment shader that gives the same result
+ * as this filter on the GPU.
+ *
+ * The shader reads the image in \c sol_texture, whose size is
+ * \c sol_input_size, and writes an image get_scaling_factor() times larger.
+ * Returns an empty string by default: the filter only works on the CPU.
+ *
+ * \return The fragment shader source, or an empty string.
+ */
+std::string SoftwarePixelFilter::get_fragment_shader_source() const {
+  return "";
+}
+
+/**
+ * \brief Called on the main thread before filtering an image.
+ *
+ * Does nothing by default.
+ * Redefine it to initialize data shared by the threads that filter rows.
+ */
+void SoftwarePixelFilter::prepare_filter() const {
 }
 
+/**
+ * \brief Returns the SIMD instruction set that filters should use.
+ * \return The best SIMD instruction set available,
+ * or Simd::NONE if SIMD is disabled.
+ */
+SoftwarePixelFilter::Simd SoftwarePixelFilter::get_simd() {
+
+  static const Simd detected_simd = detect_simd();
+  return simd_enabled ? detected_simd : Simd::NONE;
+}
+
+/**
+ * \brief Sets whether filters may use SIMD instructions.
+ *
+ * Disabling SIMD forces the scalar code, which gives the same result.
+ *
+ * \param enabled \c true to use SIMD instructions when available.
+ */
+void SoftwarePixelFilter::set_simd_enabled(bool enabled) {
+
+  simd_enabled = enabled;
+}
+
+}
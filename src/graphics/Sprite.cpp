@@ -20,17 +20,22 @@
 #include "solarus/core/PixelBits.h"
 #include "solarus/core/Size.h"
 #include "solarus/core/System.h"
+#include "solarus/entities/Entity.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/DefaultShaders.h"
+#include "solarus/graphics/FrameDamage.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/SpriteAnimation.h"
 #include "solarus/graphics/SpriteAnimationDirection.h"
 #include "solarus/graphics/SpriteAnimationSet.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Shader.h"
+#include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
 #include <lua.hpp>
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <sstream>
@@ -38,6 +43,68 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief A palette and the shader that draws indexed images with it.
+ */
+struct PaletteShader {
+  std::weak_ptr<Surface> palette;
+  std::weak_ptr<Shader> shader;
+};
+
+/**
+ * \brief Shaders of the palettes in use, by address of the palette.
+ */
+std::map<const Surface*, PaletteShader> palette_shaders;
+
+/**
+ * \brief Returns a shader that draws indexed images with a palette.
+ *
+ * Sprites with the same palette share the same shader.
+ *
+ * \param palette The palette.
+ * \return The shader.
+ */
+ShaderPtr get_palette_shader(const SurfacePtr& palette) {
+
+  PaletteShader& entry = palette_shaders[palette.get()];
+  ShaderPtr shader = entry.shader.lock();
+  if (shader != nullptr && entry.palette.lock() == palette) {
+    return shader;
+  }
+
+  // Forget palettes that no longer exist.
+  for (auto it = palette_shaders.begin(); it != palette_shaders.end();) {
+    if (it->second.palette.expired() || it->second.shader.expired()) {
+      it = palette_shaders.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  shader = Video::get_renderer().create_shader(
+        "", DefaultShaders::get_palette_fragment_source(), 0.0);
+  Debug::check_assertion(shader != nullptr && shader->is_valid(),
+      "Failed to create the palette shader: " +
+      (shader != nullptr ? shader->get_error() : std::string()));
+  shader->set_uniform_texture("sol_palette", palette);
+  shader->set_uniform_1f("sol_palette_size", static_cast<float>(palette->get_width()));
+  palette_shaders[palette.get()] = { palette, shader };
+  return shader;
+}
+
+}
+
+const std::string EnumInfoTraits<AnimationLod>::pretty_name = "animation lod";
+
+const EnumInfo<AnimationLod>::names_type EnumInfoTraits<AnimationLod>::names = {
+  { AnimationLod::DEFAULT, "default" },
+  { AnimationLod::FULL, "full" },
+  { AnimationLod::LAZY, "lazy" },
+};
+
 std::map<std::string, SpriteAnimationSet*> Sprite::all_animation_sets;
 
 /**
@@ -56,6 +123,78 @@ void Sprite::quit() {
     delete kvp.second;
   }
   all_animation_sets.clear();
+  palette_shaders.clear();
+}
+
+/**
+ * \brief Creates an animation set from data parsed in advance.
+ *
+ * Does nothing if this animation set is already loaded.
+ *
+ * \param id Id of the animation set.
+ * \param data The content of its sprite data file.
+ */
+void Sprite::add_preloaded_animation_set(const std::string& id, const SpriteData& data) {
+
+  if (all_animation_sets.find(id) == all_animation_sets.end()) {
+    all_animation_sets[id] = new SpriteAnimationSet(id, data);
+  }
+}
+
+/**
+ * \brief Returns whether an animation set is already loaded.
+ * \param id Id of the animation set.
+ * \return \c true if get_animation_set() will not need to load it.
+ */
+bool Sprite::is_animation_set_loaded(const std::string& id) {
+
+  return all_animation_sets.find(id) != all_animation_sets.end();
+}
+
+/**
+ * \brief Loads an animation set again from its file.
+ *
+ * Sprites using it switch to the new animations at their next update.
+ * Does nothing if this animation set is not loaded.
+ *
+ * \param id Id of the animation set.
+ */
+void Sprite::reload_animation_set(const std::string& id) {
+
+  const auto it = all_animation_sets.find(id);
+  if (it != all_animation_sets.end()) {
+    it->second->reload();
+  }
+}
+
+/**
+ * \brief Loads animations of an animation set before they are used.
+ *
+ * Animations are normally created the first time a sprite sets them.
+ * This can be used to load their images and pixel masks in advance,
+ * for example when a map starts.
+ *
+ * \param id Id of the animation set.
+ * \param animation_names Animations to create.
+ * An empty list means all animations of the set.
+ */
+void Sprite::preload_animations(
+    const std::string& id,
+    const std::vector<std::string>& animation_names) {
+
+  SpriteAnimationSet& animation_set = get_animation_set(id);
+  if (animation_names.empty()) {
+    animation_set.preload_animations();
+    return;
+  }
+
+  for (const std::string& animation_name : animation_names) {
+    if (!animation_set.has_animation(animation_name)) {
+      Debug::error("No animation '" + animation_name + "' in sprite '" + id + "'");
+      continue;
+    }
+    animation_set.preload_animation(animation_name);
+  }
 }
 
 /**
@@ -79,7 +218,7 @@ SpriteAnimationSet& Sprite::get_animation_set(const std::string& id) {
     all_animation_sets[id] = animation_set;
   }
 
-  Debug::check_assertion(animation_set != nullptr, "No animation set");
+  SOLARUS_ASSERT(animation_set != nullptr, "No animation set");
 
   return *animation_set;
 }
@@ -92,12 +231,17 @@ Sprite::Sprite(const std::string& id):
   Drawable(),
   animation_set_id(id),
   animation_set(get_animation_set(id)),
+  animation_set_revision(animation_set.get_revision()),
+  owner(nullptr),
   current_animation(nullptr),
   current_direction(0),
   current_frame(-1),
   frame_changed(false),
+  frames_advanced_early(false),
   frame_delay(0),
   next_frame_date(0),
+  animation_lod(AnimationLod::DEFAULT),
+  update_deferred(false),
   ignore_suspend(false),
   paused(false),
   finished(false),
@@ -105,6 +249,8 @@ Sprite::Sprite(const std::string& id):
   blink_delay(0),
   blink_is_sprite_visible(true),
   blink_next_change_date(0),
+  palette(nullptr),
+  next_update_date(0),
   finished_callback_ref() {
 
   set_current_animation(animation_set.get_default_animation());
@@ -141,6 +287,27 @@ void Sprite::set_tileset(const Tileset& tileset) {
   animation_set.set_tileset(tileset);
 }
 
+/**
+ * \brief Returns the entity that displays this sprite.
+ * \return The owner entity, or nullptr if the sprite is not attached to
+ * an entity.
+ */
+Entity* Sprite::get_owner() const {
+  return owner;
+}
+
+/**
+ * \brief Sets the entity that displays this sprite.
+ *
+ * The owner is notified when an animation starts, so that it can wake up
+ * if it is sleeping.
+ *
+ * \param owner The owner entity, or nullptr.
+ */
+void Sprite::set_owner(Entity* owner) {
+  this->owner = owner;
+}
+
 /**
  * \brief Enables the pixel-perfect collision detection for the animation set of this sprite.
  *
@@ -231,6 +398,7 @@ uint32_t Sprite::get_frame_delay() const {
  */
 void Sprite::set_frame_delay(uint32_t frame_delay) {
   this->frame_delay = frame_delay;
+  reschedule();
 }
 
 /**
@@ -261,6 +429,17 @@ int Sprite::get_next_frame() const {
  * \return the name of the current animation of the sprite
  */
 const std::string& Sprite::get_current_animation() const {
+  return current_animation_name.get_name();
+}
+
+/**
+ * \brief Returns the interned name of the current animation of the sprite.
+ *
+ * Comparing interned names is faster than comparing strings.
+ *
+ * \return the name of the current animation of the sprite
+ */
+const Symbol& Sprite::get_current_animation_symbol() const {
   return current_animation_name;
 }
 
@@ -274,9 +453,26 @@ const std::string& Sprite::get_current_animation() const {
  */
 void Sprite::set_current_animation(const std::string& animation_name) {
 
+  // Compare the strings first to avoid interning the name when it is unchanged.
+  if (animation_name != this->current_animation_name.get_name() || !is_animation_started()) {
+    set_current_animation(Symbol(animation_name));
+  }
+}
+
+/**
+ * \brief Sets the current animation of the sprite.
+ *
+ * If the sprite is already playing another animation, this animation is interrupted.
+ * If the sprite is already playing the same animation, nothing is done.
+ *
+ * \param animation_name interned name of the new animation of the sprite
+ */
+void Sprite::set_current_animation(const Symbol& animation_name) {
+
   if (animation_name != this->current_animation_name || !is_animation_started()) {
 
     this->current_animation_name = animation_name;
+    FrameDamage::notify();
     if (animation_set.has_animation(animation_name)) {
       this->current_animation = &animation_set.get_animation(animation_name);
       set_frame_delay(current_animation->get_frame_delay());
@@ -296,11 +492,11 @@ void Sprite::set_current_animation(const std::string& animation_name) {
 
     LuaContext* lua_context = get_lua_context();
     if (lua_context != nullptr) {
-      lua_context->sprite_on_animation_changed(*this, current_animation_name);
+      lua_context->sprite_on_animation_changed(*this, current_animation_name.get_name());
       if (current_direction != old_direction) {
-        lua_context->sprite_on_direction_changed(*this, current_animation_name, current_direction);
+        lua_context->sprite_on_direction_changed(*this, current_animation_name.get_name(), current_direction);
       }
-      lua_context->sprite_on_frame_changed(*this, current_animation_name, 0);
+      lua_context->sprite_on_frame_changed(*this, current_animation_name.get_name(), 0);
     }
   }
 }
@@ -314,6 +510,15 @@ bool Sprite::has_animation(const std::string& animation_name) const {
   return animation_set.has_animation(animation_name);
 }
 
+/**
+ * \brief Returns whether this sprite has an animation with the specified name.
+ * \param animation_name an interned animation name
+ * \return true if this animation exists
+ */
+bool Sprite::has_animation(const Symbol& animation_name) const {
+  return animation_set.has_animation(animation_name);
+}
+
 /**
  * \brief Returns the number of directions in the current animation of this
  * sprite.
@@ -351,19 +556,20 @@ void Sprite::set_current_direction(int current_direction) {
       std::ostringstream oss;
       oss << "Illegal direction " << current_direction
           << " for sprite '" << get_animation_set_id()
-          << "' in animation '" << current_animation_name << "'";
+          << "' in animation '" << current_animation_name.get_name() << "'";
       Debug::error(oss.str());
       return;
     }
 
     this->current_direction = current_direction;
+    FrameDamage::notify();
 
     set_current_frame(0, false);
 
     LuaContext* lua_context = get_lua_context();
     if (lua_context != nullptr) {
-      lua_context->sprite_on_direction_changed(*this, current_animation_name, current_direction);
-      lua_context->sprite_on_frame_changed(*this, current_animation_name, 0);
+      lua_context->sprite_on_direction_changed(*this, current_animation_name.get_name(), current_direction);
+      lua_context->sprite_on_frame_changed(*this, current_animation_name.get_name(), 0);
     }
   }
 }
@@ -405,6 +611,8 @@ void Sprite::set_current_frame(int current_frame, bool notify_script) {
 
   finished = false;
   next_frame_date = System::now() + get_frame_delay();
+  reschedule();
+  notify_animation_started();
 
   if (current_frame != this->current_frame) {
     this->current_frame = current_frame;
@@ -414,7 +622,7 @@ void Sprite::set_current_frame(int current_frame, bool notify_script) {
       LuaContext* lua_context = get_lua_context();
       if (lua_context != nullptr) {
         lua_context->sprite_on_frame_changed(
-            *this, current_animation_name, current_frame);
+            *this, current_animation_name.get_name(), current_frame);
       }
     }
   }
@@ -448,6 +656,9 @@ bool Sprite::has_frame_changed() const {
 void Sprite::set_frame_changed(bool frame_changed) {
 
   this->frame_changed = frame_changed;
+  if (frame_changed) {
+    FrameDamage::notify();
+  }
 }
 
 /**
@@ -457,6 +668,7 @@ void Sprite::set_frame_changed(bool frame_changed) {
  */
 void Sprite::set_synchronized_to(const SpritePtr& other) {
   this->synchronize_to = other;
+  reschedule();
 }
 
 /**
@@ -470,6 +682,26 @@ bool Sprite::is_animation_started() const {
   return !is_animation_finished();
 }
 
+/**
+ * \brief Returns how the animation advances while the sprite is off-screen.
+ * \return The animation level of detail.
+ */
+AnimationLod Sprite::get_animation_lod() const {
+  return animation_lod;
+}
+
+/**
+ * \brief Sets how the animation advances while the sprite is off-screen.
+ *
+ * This only matters for sprites of map entities:
+ * AnimationLod::DEFAULT uses the policy of the entity type.
+ *
+ * \param animation_lod The animation level of detail.
+ */
+void Sprite::set_animation_lod(AnimationLod animation_lod) {
+  this->animation_lod = animation_lod;
+}
+
 /**
  * \brief Starts the animation.
  */
@@ -490,6 +722,7 @@ void Sprite::restart_animation() {
  */
 void Sprite::stop_animation() {
   finished = true;
+  reschedule();
 }
 
 /**
@@ -505,6 +738,7 @@ void Sprite::set_suspended(bool suspended) {
       !ignore_suspend) {
 
     Drawable::set_suspended(suspended);
+    reschedule();
 
     // compte next_frame_date if the animation is being resumed
     if (!suspended) {
@@ -514,6 +748,7 @@ void Sprite::set_suspended(bool suspended) {
     }
     else {
       blink_is_sprite_visible = true;
+      FrameDamage::notify();
     }
   }
 }
@@ -559,15 +794,18 @@ void Sprite::set_paused(bool paused) {
 
   if (paused != this->paused) {
     this->paused = paused;
+    reschedule();
 
     // compte next_frame_date if the animation is being resumed
     if (!paused) {
       uint32_t now = System::now();
       next_frame_date = now + get_frame_delay();
       blink_next_change_date = now;
+      notify_animation_started();
     }
     else {
       blink_is_sprite_visible = true;
+      FrameDamage::notify();
     }
   }
 }
@@ -621,6 +859,8 @@ bool Sprite::is_blinking() const {
  */
 void Sprite::set_blinking(uint32_t blink_delay) {
   this->blink_delay = blink_delay;
+  FrameDamage::notify();
+  reschedule();
 
   if (blink_delay > 0) {
     blink_is_sprite_visible = false;
@@ -628,6 +868,37 @@ void Sprite::set_blinking(uint32_t blink_delay) {
   }
 }
 
+/**
+ * \brief Returns the palette used to draw this sprite.
+ * \return The palette, or nullptr if the sprite sheet is drawn as is.
+ */
+const SurfacePtr& Sprite::get_palette() const {
+  return palette;
+}
+
+/**
+ * \brief Draws the sprite sheet as an indexed image with the given colors.
+ *
+ * The red channel of each pixel of the sprite sheet is then an index in
+ * the palette: color \c i is the pixel <tt>(i, 0)</tt> of the palette.
+ * This allows color variants of a sprite to share one sprite sheet.
+ * The palette is applied by a built-in shader that replaces the shader
+ * of the sprite.
+ *
+ * \param palette The palette, or nullptr to draw the sprite sheet as is
+ * and remove the shader.
+ */
+void Sprite::set_palette(const SurfacePtr& palette) {
+
+  if (palette == this->palette) {
+    return;
+  }
+
+  this->palette = palette;
+  set_shader(palette != nullptr ? get_palette_shader(palette) : nullptr);
+  FrameDamage::notify();
+}
+
 /**
  * \brief Tests whether this sprite's pixels are overlapping another sprite.
  * \param other Another sprite.
@@ -690,21 +961,44 @@ void Sprite::update() {
 
   Drawable::update();
 
+  if (animation_set_revision != animation_set.get_revision()) {
+    notify_animation_set_reloaded();
+  }
+
+  const bool advanced_early = frames_advanced_early;
+  frames_advanced_early = false;
+
   if (is_suspended() || paused) {
     return;
   }
 
-  LuaContext* lua_context = get_lua_context();
-
   frame_changed = false;
+  if (advanced_early) {
+    set_frame_changed(true);
+  }
   uint32_t now = System::now();
+  const bool was_deferred = update_deferred;
+  update_deferred = false;
+  if (now < next_update_date) {
+    // No frame or blink change is due yet.
+    return;
+  }
+
+  LuaContext* lua_context = get_lua_context();
 
   // Update the current frame.
   if (synchronize_to == nullptr
-      || current_animation_name != synchronize_to->get_current_animation()
+      || current_animation_name != synchronize_to->get_current_animation_symbol()
       || synchronize_to->get_current_direction() > get_nb_directions()
       || synchronize_to->get_current_frame() > get_nb_frames()) {
 
+    // After deferred updates, whole loops of the animation may be late:
+    // skip them if nobody sees the intermediate frames.
+    if (was_deferred &&
+        (lua_context == nullptr || !lua_context->is_sprite_frame_change_observed(*this))) {
+      skip_animation_loops(now);
+    }
+
     // Update frames normally (with time).
     while (!finished &&
         !is_suspended() &&
@@ -732,7 +1026,7 @@ void Sprite::update() {
       set_frame_changed(true);
 
       if (lua_context != nullptr) {
-        lua_context->sprite_on_frame_changed(*this, current_animation_name, current_frame);
+        lua_context->sprite_on_frame_changed(*this, current_animation_name.get_name(), current_frame);
       }
     }
   }
@@ -750,7 +1044,7 @@ void Sprite::update() {
         set_frame_changed(true);
 
         if (lua_context != nullptr) {
-          lua_context->sprite_on_frame_changed(*this, current_animation_name, current_frame);
+          lua_context->sprite_on_frame_changed(*this, current_animation_name.get_name(), current_frame);
         }
       }
     }
@@ -763,8 +1057,209 @@ void Sprite::update() {
     while (now >= blink_next_change_date) {
       blink_is_sprite_visible = !blink_is_sprite_visible;
       blink_next_change_date += blink_delay;
+      FrameDamage::notify();
     }
   }
+
+  next_update_date = get_next_change_date();
+}
+
+/**
+ * \brief Returns whether update() has something to do.
+ *
+ * Owners of sprites can skip calling update() when this returns \c false:
+ * the sprite is then unchanged until the date returned by
+ * get_next_change_date().
+ *
+ * \param now The current date in milliseconds.
+ * \return \c true if the frame, the blinking, the movement, the transition
+ * or the frame changed flag of this sprite may change during update().
+ */
+bool Sprite::is_update_needed(uint32_t now) {
+
+  return now >= next_update_date ||
+      frame_changed ||
+      animation_set_revision != animation_set.get_revision() ||
+      get_movement() != nullptr ||
+      get_transition() != nullptr;
+}
+
+/**
+ * \brief Returns the next date when the frame or the blinking changes.
+ *
+ * Sprites synchronized to another one follow it at each update.
+ *
+ * \return The date in milliseconds, 0 if the sprite has to be updated
+ * every time, or the maximum date if nothing will change.
+ */
+uint32_t Sprite::get_next_change_date() const {
+
+  if (synchronize_to != nullptr) {
+    return 0;
+  }
+
+  uint32_t date = std::numeric_limits<uint32_t>::max();
+  if (is_suspended() || paused) {
+    return date;
+  }
+
+  if (!finished && get_frame_delay() > 0) {
+    date = next_frame_date;
+  }
+  if (is_blinking()) {
+    date = std::min(date, blink_next_change_date);
+  }
+  return date;
+}
+
+/**
+ * \brief Returns whether advance_frames() can be called on this sprite now.
+ *
+ * This is the case when frames are due and their changes don't need to
+ * notify anyone: the sprite is not synchronized to another one and
+ * nothing observes its frame changes from Lua.
+ * This function must be called from the main thread.
+ *
+ * \param now The current date in milliseconds.
+ * \return \c true if advance_frames() is useful and allowed.
+ */
+bool Sprite::is_frame_advance_native(uint32_t now) const {
+
+  if (synchronize_to != nullptr ||
+      current_animation == nullptr ||
+      finished ||
+      is_suspended() ||
+      paused ||
+      get_frame_delay() == 0 ||
+      now < next_frame_date) {
+    return false;
+  }
+
+  LuaContext* lua_context = get_lua_context();
+  return lua_context == nullptr ||
+      !lua_context->is_sprite_frame_change_observed(*this);
+}
+
+/**
+ * \brief Advances the frames that are due without notifying anyone.
+ *
+ * Stops before the end of a non-looping animation: finishing it is left
+ * to update(), as well as the frame changed flag.
+ * This function only touches the frame state of this sprite, so it can run
+ * on a worker thread for sprites that is_frame_advance_native() accepted,
+ * as long as no other thread uses the same sprite meanwhile.
+ *
+ * \param now The current date in milliseconds.
+ */
+void Sprite::advance_frames(uint32_t now) {
+
+  skip_animation_loops(now);
+  while (now >= next_frame_date) {
+    int next_frame = get_next_frame();
+    if (next_frame == -1) {
+      return;
+    }
+    current_frame = next_frame;
+    uint32_t old_next_frame_date = next_frame_date;
+    next_frame_date += get_frame_delay();
+    if (next_frame_date < old_next_frame_date) {
+      next_frame_date = std::numeric_limits<uint32_t>::max();
+    }
+    frames_advanced_early = true;
+  }
+}
+
+/**
+ * \brief Returns whether the owner of this sprite can skip update() now.
+ *
+ * This is the case when the only thing to do is changing the frame of a
+ * looping animation, and nothing needs the current frame: the frame
+ * changes are not observed from Lua and pixel-precise collisions are
+ * disabled. The frames can then catch up later with the timeline.
+ * This function must be called from the main thread.
+ *
+ * \param now The current date in milliseconds.
+ * \return \c true if update() can be deferred.
+ */
+bool Sprite::is_update_deferrable(uint32_t now) {
+
+  return !frame_changed &&
+      !frames_advanced_early &&
+      !is_blinking() &&
+      !are_pixel_collisions_enabled() &&
+      is_animation_looping() &&
+      animation_set_revision == animation_set.get_revision() &&
+      get_movement() == nullptr &&
+      get_transition() == nullptr &&
+      is_frame_advance_native(now);
+}
+
+/**
+ * \brief Returns whether the owner of this sprite skipped update()
+ * since the last call to update().
+ * \return \c true if the current frame may be late.
+ */
+bool Sprite::is_update_deferred() const {
+  return update_deferred;
+}
+
+/**
+ * \brief Notifies this sprite that its owner skipped update().
+ *
+ * The next update() catches up with the timeline.
+ */
+void Sprite::set_update_deferred() {
+  update_deferred = true;
+}
+
+/**
+ * \brief Skips the whole loops of a looping animation that are due.
+ *
+ * The current frame is unchanged, only the date of the next frame moves
+ * forward, so that catching up after a long time stays cheap.
+ *
+ * \param now The current date in milliseconds.
+ */
+void Sprite::skip_animation_loops(uint32_t now) {
+
+  if (current_animation == nullptr ||
+      !current_animation->is_looping() ||
+      get_frame_delay() == 0 ||
+      now < next_frame_date) {
+    return;
+  }
+
+  const int loop_on_frame = current_animation->get_loop_on_frame();
+  if (current_frame < loop_on_frame) {
+    return;
+  }
+
+  const uint32_t loop_duration = (get_nb_frames() - loop_on_frame) * get_frame_delay();
+  if (loop_duration == 0) {
+    return;
+  }
+  const uint32_t delay = now - next_frame_date;
+  next_frame_date += delay - delay % loop_duration;
+}
+
+/**
+ * \brief Lets the owner entity wake up if it only updates on demand.
+ */
+void Sprite::notify_animation_started() {
+
+  if (owner != nullptr &&
+      owner->get_update_policy() == Entity::UpdatePolicy::ON_DEMAND) {
+    owner->notify_hot_state_changed();
+  }
+}
+
+/**
+ * \brief Makes the next update() check the frame and blinking again.
+ *
+ * Called whenever the animation state changes outside of update().
+ */
+void Sprite::reschedule() {
+  next_update_date = 0;
 }
 
 /**
@@ -849,42 +1344,21 @@ void Sprite::raw_draw_region(Surface& dst_surface, const DrawInfos& infos) const
   if (!is_animation_finished()
       && (blink_delay == 0 || blink_is_sprite_visible)) {
 
-    //draw_intermediate();
-
     // If the region is bigger than the current frame, clip it.
     // Otherwise, more than the current frame could be visible.
-    Rectangle src_position = clamp_region(infos.region);
-
-
-    struct CropProxy : DrawProxy {
-      CropProxy(const Rectangle& r, const Point& p) : crop_region(r), origin(p) {}
-      void draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const override {
-        //Compute area to keep in sprite sheet
-        Rectangle crop_win = Rectangle(crop_region.get_xy()+infos.region.get_xy(),crop_region.get_bottom_right()+infos.region.get_xy());
-
-        //Adapt destination
-        Point dest = infos.dst_position+crop_region.get_xy();
-
-        //Use given Proxy to draw result
-        //infos.proxy.draw(dst_surface,src_surface,infos);
-        infos.proxy.draw(dst_surface,src_surface,DrawInfos(infos,crop_win&infos.region,dest));
-      }
-      const Rectangle& crop_region;
-      const Point origin;
-    };
-
-    //Instantiate crop proxy with current draw parameters
-    CropProxy cropProxy{
-      src_position,
-      get_origin()
-    };
+    const Rectangle src_position = clamp_region(infos.region);
+    if (src_position.get_width() <= 0 || src_position.get_height() <= 0) {
+      return;
+    }
 
-    current_animation->draw(
+    // Draw the visible part of the frame directly from the sprite sheet.
+    current_animation->draw_region(
           dst_surface,
           infos.dst_position,
           current_direction,
           current_frame,
-          DrawInfos(infos,DrawProxyChain<2>(DrawProxyChain<2>::Proxies{{cropProxy,infos.proxy}})));
+          src_position,
+          infos);
   }
 }
 
@@ -986,10 +1460,37 @@ void Sprite::notify_finished() {
     }
 
     // Sprite event.
-    lua_context->sprite_on_animation_finished(*this, current_animation_name);
+    lua_context->sprite_on_animation_finished(*this, current_animation_name.get_name());
   }
 
 }
 
+/**
+ * \brief Switches to the new animations after the animation set was reloaded.
+ *
+ * The current animation, direction and frame are kept when they still exist.
+ */
+void Sprite::notify_animation_set_reloaded() {
+
+  animation_set_revision = animation_set.get_revision();
+  intermediate_surface = nullptr;
+  FrameDamage::notify();
+
+  if (!animation_set.has_animation(current_animation_name)) {
+    current_animation = nullptr;
+    set_current_animation(animation_set.get_default_animation());
+    return;
+  }
+
+  current_animation = &animation_set.get_animation(current_animation_name);
+  set_frame_delay(current_animation->get_frame_delay());
+  if (current_direction >= get_nb_directions()) {
+    current_direction = 0;
+  }
+  if (current_frame >= get_nb_frames()) {
+    set_current_frame(0, false);
+  }
+}
+
 }
 
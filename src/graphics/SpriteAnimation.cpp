@@ -102,6 +102,14 @@ bool SpriteAnimation::is_looping() const {
   return loop_on_frame != -1;
 }
 
+/**
+ * \brief Returns the frame where this animation loops.
+ * \return The frame to loop on, or -1 if the animation does not loop.
+ */
+int SpriteAnimation::get_loop_on_frame() const {
+  return loop_on_frame;
+}
+
 /**
  * \brief Returns the next frame of the current frame.
  * \param current_direction the current direction
@@ -149,16 +157,50 @@ void SpriteAnimation::draw(Surface& dst_surface,
     return;
   }
 
-  if (current_direction < 0
-      || current_direction >= get_nb_directions()) {
+  check_direction(current_direction);
+  directions[current_direction].draw(dst_surface, dst_position,
+      current_frame, *src_image, infos);
+}
+
+/**
+ * \brief Draws a subrectangle of a specific frame of this animation on a
+ * surface.
+ * \param dst_surface the surface on which the sprite will be drawn
+ * \param dst_position coordinates on the destination surface
+ * (the origin point will be drawn at this position)
+ * \param current_direction the direction to show
+ * \param current_frame the frame to show in this direction
+ * \param region The subrectangle to draw, relative to the upper-left corner
+ * of the frame. It must be inside the frame.
+ * \param infos draw infos bundle
+ */
+void SpriteAnimation::draw_region(Surface& dst_surface,
+    const Point& dst_position, int current_direction, int current_frame,
+    const Rectangle& region, const DrawInfos& infos) const {
+
+  if (src_image == nullptr) {
+    return;
+  }
+
+  check_direction(current_direction);
+  directions[current_direction].draw_region(dst_surface, dst_position,
+      current_frame, region, *src_image, infos);
+}
+
+/**
+ * \brief Stops the program if a direction does not exist in this animation.
+ * \param direction The direction to check.
+ */
+void SpriteAnimation::check_direction(int direction) const {
+
+  if (direction < 0
+      || direction >= get_nb_directions()) {
     std::ostringstream oss;
     oss << "Invalid sprite direction "
-        << current_direction << ": this sprite has " << get_nb_directions()
+        << direction << ": this sprite has " << get_nb_directions()
         << " direction(s)";
     Debug::die(oss.str());
   }
-  directions[current_direction].draw(dst_surface, dst_position,
-      current_frame, *src_image, infos);
 }
 
 /**
@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/core/PixelBits.h"
+#include "solarus/graphics/PixelBitsCache.h"
 #include "solarus/graphics/SpriteAnimationDirection.h"
 #include "solarus/graphics/Surface.h"
 #include <memory>
@@ -93,21 +94,52 @@ void SpriteAnimationDirection::draw(Surface& dst_surface,
 }
 
 /**
- * \brief Calculates the bit fields representing the non-transparent pixels
- * of the images in this direction.
+ * \brief Draws a subrectangle of a frame on a surface.
+ *
+ * The subrectangle is taken directly from the source image, so it is drawn
+ * like a full frame.
+ *
+ * \param dst_surface The surface on which the frame will be drawn.
+ * \param dst_position Coordinates on the destination surface
+ * (the origin point will be drawn at this position).
+ * \param current_frame The frame to show.
+ * \param region The subrectangle to draw, relative to the upper-left corner
+ * of the frame. It must be inside the frame.
+ * \param src_image The image from which the frame is extracted.
+ * \param infos Draw infos bundle.
+ */
+void SpriteAnimationDirection::draw_region(Surface& dst_surface,
+    const Point& dst_position, int current_frame, const Rectangle& region,
+    Surface& src_image, const DrawInfos &infos) const {
+
+  Rectangle src_rect(region);
+  src_rect.add_xy(get_frame(current_frame).get_xy());
+
+  // Position of the upper left corner of the region.
+  Point position = dst_position;
+  position -= origin;
+  position += region.get_xy();
+
+  infos.proxy.draw(dst_surface,src_image,DrawInfos(infos,src_rect,position));
+}
+
+/**
+ * \brief Enables the computation of the bit fields representing the
+ * non-transparent pixels of the images in this direction.
  *
  * This method has to be called if you want a sprite having this animations
  * to be able to detect pixel-perfect collisions.
+ * The bit fields of a frame are computed the first time they are needed,
+ * and shared with other directions that use the same image region.
  * If the pixel-perfect collisions are already enabled, this function does nothing.
  *
  * \param src_image the surface containing the animations
  */
-void SpriteAnimationDirection::enable_pixel_collisions(Surface& src_image) {
+void SpriteAnimationDirection::enable_pixel_collisions(const Surface& src_image) {
 
   if (!are_pixel_collisions_enabled()) {
-    for (int i = 0; i < get_nb_frames(); i++) {
-      pixel_bits.emplace_back(src_image, frames[i]);
-    }
+    pixel_bits_image = src_image.get_shared_impl();
+    pixel_bits.assign(get_nb_frames(), nullptr);
   }
 }
 
@@ -115,15 +147,25 @@ void SpriteAnimationDirection::enable_pixel_collisions(Surface& src_image) {
  * \brief Disables the pixel-perfect collision ability of this sprite animation direction.
  */
 void SpriteAnimationDirection::disable_pixel_collisions() {
+  pixel_bits_image = nullptr;
   pixel_bits.clear();
 }
 
+/**
+ * \brief Returns the bit fields of a frame from the shared cache.
+ * \param frame A frame of the animation.
+ * \return The bit fields of this frame.
+ */
+std::shared_ptr<const PixelBits> SpriteAnimationDirection::get_frame_pixel_bits(int frame) const {
+  return PixelBitsCache::get(pixel_bits_image, frames[frame]);
+}
+
 /**
  * \brief Returns whether the pixel-perfect collisions are enabled for this direction.
  * \return true if the pixel-perfect collisions are enabled
  */
 bool SpriteAnimationDirection::are_pixel_collisions_enabled() const {
-  return !pixel_bits.empty();
+  return pixel_bits_image != nullptr;
 }
 
 }
@@ -34,29 +34,88 @@ namespace Solarus {
  * (name of a sprite definition file, without the ".dat" extension).
  */
 SpriteAnimationSet::SpriteAnimationSet(const std::string& id):
-  id(id) {
+  id(id),
+  revision(0),
+  tileset(nullptr),
+  pixel_collisions_enabled(false) {
 
   load();
 }
 
+/**
+ * \brief Creates the animations of a sprite from already parsed data.
+ * \param id Id of the sprite animation set.
+ * \param data The content of its sprite definition file.
+ */
+SpriteAnimationSet::SpriteAnimationSet(const std::string& id, const SpriteData& data):
+  id(id),
+  revision(0),
+  tileset(nullptr),
+  pixel_collisions_enabled(false) {
+
+  load(data);
+}
+
 /**
  * \brief Attempts to load this animation set from its file.
  */
 void SpriteAnimationSet::load() {
 
-  Debug::check_assertion(animations.empty(),
-      "Animation set already loaded");
-
   // Load the sprite data file.
   std::string file_name = std::string("sprites/") + id + ".dat";
   SpriteData data;
   bool success = data.import_from_quest_file(file_name);
   if (success) {
-    // Get the imported data.
-    default_animation_name = data.get_default_animation_name();
-    for (const auto& kvp : data.get_animations()) {
-      add_animation(kvp.first, kvp.second);
-    }
+    load(data);
+  }
+}
+
+/**
+ * \brief Loads this animation set again from its file.
+ *
+ * Animations already created are kept alive until this object is destroyed,
+ * because sprites using this animation set may still point to them:
+ * sprites switch to the new animations when they notice that the revision
+ * changed.
+ */
+void SpriteAnimationSet::reload() {
+
+  if (!animations.empty()) {
+    retired_animations.push_back(std::move(animations));
+    animations.clear();
+  }
+  unloaded_animations.clear();
+  default_animation_name.clear();
+  max_size = Size();
+  max_bounding_box = Rectangle();
+  ++revision;
+
+  load();
+}
+
+/**
+ * \brief Returns the number of times this animation set was reloaded.
+ * \return The revision of this animation set.
+ */
+uint32_t SpriteAnimationSet::get_revision() const {
+  return revision;
+}
+
+/**
+ * \brief Declares the animations of this animation set.
+ *
+ * Animations are only created when they are first used.
+ *
+ * \param data The imported sprite data.
+ */
+void SpriteAnimationSet::load(const SpriteData& data) {
+
+  Debug::check_assertion(animations.empty() && unloaded_animations.empty(),
+      "Animation set already loaded");
+
+  default_animation_name = data.get_default_animation_name();
+  for (const auto& kvp : data.get_animations()) {
+    add_animation(kvp.first, kvp.second);
   }
 }
 
@@ -64,6 +123,8 @@ void SpriteAnimationSet::load() {
  * \brief Adds a new animation to this animation set.
  *
  * This function is called while loading the animation set.
+ * Only the sizes of the frames are computed here: the animation itself
+ * is created by load_animation() when it is needed.
  *
  * \param animation_name Name of this animation.
  * \param animation_data Properties of the animation to create.
@@ -72,26 +133,61 @@ void SpriteAnimationSet::add_animation(
     const std::string& animation_name,
     const SpriteAnimationData& animation_data) {
 
-  std::string src_image = animation_data.get_src_image();
-  uint32_t frame_delay = animation_data.get_frame_delay();
-  int frame_to_loop_on = animation_data.get_loop_on_frame();
-  std::vector<SpriteAnimationDirection> directions;
-
-  // Create directions
   for (const SpriteAnimationDirectionData& direction: animation_data.get_directions()) {
 
     Size size = direction.get_size();
     max_size.width = std::max(size.width, max_size.width);
     max_size.height = std::max(size.height, max_size.height);
     max_bounding_box |= direction.get_bounding_box();
+  }
+
+  unloaded_animations.emplace(Symbol(animation_name), animation_data);
+}
+
+/**
+ * \brief Creates an animation that was not used yet.
+ *
+ * Loads its source image and, if needed, its pixel masks.
+ *
+ * \param animation_name Name of the animation to create.
+ * \return The animation, or nullptr if there is no such animation.
+ */
+SpriteAnimation* SpriteAnimationSet::load_animation(const Symbol& animation_name) const {
+
+  const auto& it = animations.find(animation_name);
+  if (it != animations.end()) {
+    return &it->second;
+  }
+
+  const auto& data_it = unloaded_animations.find(animation_name);
+  if (data_it == unloaded_animations.end()) {
+    return nullptr;
+  }
 
+  const SpriteAnimationData& animation_data = data_it->second;
+  std::vector<SpriteAnimationDirection> directions;
+  for (const SpriteAnimationDirectionData& direction: animation_data.get_directions()) {
     directions.emplace_back(direction.get_all_frames(), direction.get_origin());
   }
 
-  animations.emplace(
+  SpriteAnimation& animation = animations.emplace(
     animation_name,
-    SpriteAnimation(src_image, directions, frame_delay, frame_to_loop_on)
-  );
+    SpriteAnimation(
+        animation_data.get_src_image(),
+        directions,
+        animation_data.get_frame_delay(),
+        animation_data.get_loop_on_frame()
+    )
+  ).first->second;
+  unloaded_animations.erase(data_it);
+
+  if (tileset != nullptr) {
+    animation.set_tileset(*tileset);
+  }
+  if (pixel_collisions_enabled) {
+    animation.enable_pixel_collisions();
+  }
+  return &animation;
 }
 
 /**
@@ -103,6 +199,7 @@ void SpriteAnimationSet::add_animation(
  */
 void SpriteAnimationSet::set_tileset(const Tileset& tileset) {
 
+  this->tileset = &tileset;
   for (auto& kvp: animations) {
     kvp.second.set_tileset(tileset);
   }
@@ -115,7 +212,18 @@ void SpriteAnimationSet::set_tileset(const Tileset& tileset) {
  */
 bool SpriteAnimationSet::has_animation(
     const std::string& animation_name) const {
-  return animations.find(animation_name) != animations.end();
+  return has_animation(Symbol::find(animation_name));
+}
+
+/**
+ * \brief Returns whether this animation set has an animation with the specified name.
+ * \param animation_name an animation name
+ * \return true if this animation exists
+ */
+bool SpriteAnimationSet::has_animation(
+    const Symbol& animation_name) const {
+  return animations.find(animation_name) != animations.end() ||
+      unloaded_animations.find(animation_name) != unloaded_animations.end();
 }
 
 /**
@@ -126,12 +234,14 @@ bool SpriteAnimationSet::has_animation(
 const SpriteAnimation& SpriteAnimationSet::get_animation(
     const std::string& animation_name) const {
 
-  Debug::check_assertion(has_animation(animation_name),
-      std::string("No animation '") + animation_name
-      + "' in animation set '" + id + "'"
-  );
+  const SpriteAnimation* animation = load_animation(Symbol::find(animation_name));
+  if (animation == nullptr) {
+    Debug::die(std::string("No animation '") + animation_name
+        + "' in animation set '" + id + "'"
+    );
+  }
 
-  return animations.find(animation_name)->second;
+  return *animation;
 }
 
 /**
@@ -142,12 +252,25 @@ const SpriteAnimation& SpriteAnimationSet::get_animation(
 SpriteAnimation& SpriteAnimationSet::get_animation(
     const std::string& animation_name) {
 
-  Debug::check_assertion(has_animation(animation_name),
-      std::string("No animation '") + animation_name
-      + "' in animation set '" + id + "'"
-  );
+  return get_animation(Symbol::find(animation_name));
+}
+
+/**
+ * \brief Returns an animation.
+ * \param animation_name Name of the animation to get.
+ * \return The specified animation.
+ */
+SpriteAnimation& SpriteAnimationSet::get_animation(
+    const Symbol& animation_name) {
+
+  SpriteAnimation* animation = load_animation(animation_name);
+  if (animation == nullptr) {
+    Debug::die(std::string("No animation '") + animation_name.get_name()
+        + "' in animation set '" + id + "'"
+    );
+  }
 
-  return animations.find(animation_name)->second;
+  return *animation;
 }
 
 /**
@@ -158,6 +281,38 @@ const std::string& SpriteAnimationSet::get_default_animation() const {
   return default_animation_name;
 }
 
+/**
+ * \brief Returns whether an animation was already created.
+ * \param animation_name Name of an animation.
+ * \return \c true if this animation exists and its images are loaded.
+ */
+bool SpriteAnimationSet::is_animation_loaded(const std::string& animation_name) const {
+
+  return animations.find(Symbol::find(animation_name)) != animations.end();
+}
+
+/**
+ * \brief Creates an animation now rather than the first time it is used.
+ *
+ * Does nothing if this animation is already created.
+ *
+ * \param animation_name Name of the animation to create.
+ */
+void SpriteAnimationSet::preload_animation(const std::string& animation_name) {
+
+  get_animation(animation_name);
+}
+
+/**
+ * \brief Creates all animations that were not used yet.
+ */
+void SpriteAnimationSet::preload_animations() {
+
+  while (!unloaded_animations.empty()) {
+    load_animation(unloaded_animations.begin()->first);
+  }
+}
+
 /**
  * \brief Enables the pixel-perfect collision detection for these animations.
  */
@@ -165,6 +320,7 @@ void SpriteAnimationSet::enable_pixel_collisions() {
 
   if (!are_pixel_collisions_enabled()) {
 
+    pixel_collisions_enabled = true;
     for (auto& kvp: animations) {
       kvp.second.enable_pixel_collisions();
     }
@@ -176,12 +332,7 @@ void SpriteAnimationSet::enable_pixel_collisions() {
  * \return true if the pixel-perfect collisions are enabled
  */
 bool SpriteAnimationSet::are_pixel_collisions_enabled() const {
-
-  if (animations.empty()) {
-    return false;
-  }
-
-  return animations.begin()->second.are_pixel_collisions_enabled();
+  return pixel_collisions_enabled;
 }
 
 /**
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/graphics/SpriteData.h"
 #include "solarus/lua/LuaTools.h"
@@ -760,4 +761,78 @@ void SpriteData::export_animation_to_lua(
   out << "}\n";
 }
 
+/**
+ * \copydoc LuaData::import_from_binary
+ */
+bool SpriteData::import_from_binary(BinaryReader& reader) {
+
+  SpriteData sprite;
+  const size_t num_animations = reader.read_count();
+  for (size_t i = 0; i < num_animations; ++i) {
+    const std::string& animation_name = reader.read_string();
+    const std::string& src_image = reader.read_string();
+    const uint32_t frame_delay = reader.read_uint();
+    const int frame_to_loop_on = reader.read_int();
+
+    std::deque<SpriteAnimationDirectionData> directions;
+    const size_t num_directions = reader.read_count();
+    for (size_t j = 0; j < num_directions; ++j) {
+      const Point& xy = reader.read_point();
+      const Size& size = reader.read_size();
+      const Point& origin = reader.read_point();
+      const int num_frames = reader.read_int();
+      const int num_columns = reader.read_int();
+      directions.emplace_back(xy, size, origin, num_frames, num_columns);
+    }
+
+    if (reader.has_failed() ||
+        !sprite.add_animation(
+          animation_name,
+          SpriteAnimationData(src_image, directions, frame_delay, frame_to_loop_on))) {
+      return false;
+    }
+  }
+
+  if (num_animations > 0 &&
+      !sprite.set_default_animation_name(reader.read_string())) {
+    return false;
+  }
+
+  if (reader.has_failed() || !reader.is_at_end()) {
+    return false;
+  }
+  *this = std::move(sprite);
+  return true;
+}
+
+/**
+ * \copydoc LuaData::export_to_binary
+ */
+bool SpriteData::export_to_binary(BinaryWriter& writer) const {
+
+  writer.write_uint(static_cast<uint32_t>(animations.size()));
+  for (const auto& kvp : animations) {
+    const SpriteAnimationData& animation = kvp.second;
+    writer.write_string(kvp.first);
+    writer.write_string(animation.get_src_image());
+    writer.write_uint(animation.get_frame_delay());
+    writer.write_int(animation.get_loop_on_frame());
+
+    writer.write_uint(static_cast<uint32_t>(animation.get_num_directions()));
+    for (const SpriteAnimationDirectionData& direction : animation.get_directions()) {
+      writer.write_point(direction.get_xy());
+      writer.write_size(direction.get_size());
+      writer.write_point(direction.get_origin());
+      writer.write_int(direction.get_num_frames());
+      writer.write_int(direction.get_num_columns());
+    }
+  }
+
+  if (!animations.empty()) {
+    writer.write_string(default_animation_name);
+  }
+
+  return true;
+}
+
 }
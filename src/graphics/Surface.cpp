@@ -19,6 +19,9 @@
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/FrameDamage.h"
+#include "solarus/graphics/ImageCache.h"
+#include "solarus/graphics/KtxImage.h"
 #include "solarus/graphics/SoftwarePixelFilter.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Transition.h"
@@ -28,7 +31,6 @@
 
 #include <algorithm>
 #include <iostream>
-#include <mutex>
 #include <sstream>
 
 #include <SDL_render.h>
@@ -36,18 +38,11 @@
 
 namespace Solarus {
 
-namespace {
-
-std::mutex image_files_cache_mutex;
-std::map<std::string, SurfaceImplPtr> image_files_cache;
-
-}
-
 /**
  *  \brief empty the surface cache
  */
 void Surface::empty_cache() {
-  image_files_cache.clear();
+  ImageCache::clear();
 }
 
 /**
@@ -64,7 +59,7 @@ Surface::Surface(int width, int height, bool premultiplied):
                          "Attempt to create a surface with an empty size");
 
   internal_surface = Video::get_renderer().create_texture(width,height);
-  internal_surface->set_premultiplied(premultiplied);
+  internal_surface->set_premultiplied(premultiplied || Video::is_premultiplied_alpha());
 }
 
 /**
@@ -76,9 +71,13 @@ Surface::Surface(int width, int height, bool premultiplied):
  * \param surf The internal surface data.
  */
 Surface::Surface(SDL_Surface_UniquePtr surf, bool premultiplied)
-  : internal_surface(Video::get_renderer().create_texture(std::move(surf)))
+  : internal_surface(nullptr)
 {
-  internal_surface->set_premultiplied(premultiplied);
+  if (!premultiplied && surf != nullptr && Video::is_premultiplied_alpha()) {
+    premultiply_alpha(*surf);
+  }
+  internal_surface = Video::get_renderer().create_texture(std::move(surf));
+  internal_surface->set_premultiplied(premultiplied || Video::is_premultiplied_alpha());
 }
 
 /**
@@ -90,7 +89,7 @@ Surface::Surface(SurfaceImplPtr impl, bool premultiplied):
   Drawable(),
   internal_surface(impl) //TODO refactor this...
 {
-  internal_surface->set_premultiplied(premultiplied);
+  internal_surface->set_premultiplied(premultiplied || Video::is_premultiplied_alpha());
 }
 
 /**
@@ -165,6 +164,23 @@ SurfacePtr Surface::create(SDL_Surface_UniquePtr surf, bool premultiplied) {
   return std::make_shared<Surface>(std::move(surf), premultiplied);
 }
 
+/**
+ * \brief Creates a surface from the specified SDL surface, allowing the
+ * renderer to pack it with other images.
+ *
+ * Use this for images that are only read, like the ones loaded from files.
+ * Packing is transparently undone if the surface is modified later.
+ *
+ * \param surf The internal surface data.
+ * \return The surface created.
+ */
+SurfacePtr Surface::create_packed(SDL_Surface_UniquePtr surf, bool premultiplied) {
+  if (!premultiplied && surf != nullptr && Video::is_premultiplied_alpha()) {
+    premultiply_alpha(*surf);
+  }
+  return Surface::create(Video::get_renderer().create_packed_texture(std::move(surf)), premultiplied);
+}
+
 /**
  * \brief Creates an SDL surface corresponding to the requested file.
  *
@@ -176,12 +192,12 @@ SurfacePtr Surface::create(SDL_Surface_UniquePtr surf, bool premultiplied) {
 SDL_Surface_UniquePtr Surface::create_sdl_surface_from_file(
     const std::string& file_name) {
 
-  if (!QuestFiles::data_file_exists(file_name)) {
+  QuestFiles::DataFileView view;
+  if (!view.open(file_name)) {
     return nullptr;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
-  SDL_RWops* rw = SDL_RWFromMem(const_cast<char*>(buffer.data()), (int) buffer.size());
+  SDL_RWops* rw = SDL_RWFromConstMem(view.get_data(), (int) view.get_size());
   SDL_Surface_UniquePtr surface = SDL_Surface_UniquePtr(IMG_Load_RW(rw, 0));
   SDL_RWclose(rw);
 
@@ -212,6 +228,40 @@ SDL_Surface_UniquePtr Surface::create_sdl_surface_from_file(
   return converted_surface;
 }
 
+/**
+ * \brief Multiplies the color of each pixel of an SDL surface by its alpha.
+ *
+ * Only 32-bit surfaces with an alpha channel are modified:
+ * other ones are opaque and thus already premultiplied.
+ *
+ * \param surface The SDL surface to premultiply.
+ */
+void Surface::premultiply_alpha(SDL_Surface& surface) {
+
+  const SDL_PixelFormat& format = *surface.format;
+  if (format.BytesPerPixel != 4 || format.Amask == 0) {
+    return;
+  }
+
+  SDL_LockSurface(&surface);
+  for (int y = 0; y < surface.h; ++y) {
+    uint32_t* pixel = reinterpret_cast<uint32_t*>(
+          static_cast<uint8_t*>(surface.pixels) + y * surface.pitch);
+    for (int x = 0; x < surface.w; ++x, ++pixel) {
+      const uint32_t alpha = (*pixel & format.Amask) >> format.Ashift;
+      if (alpha == 255) {
+        continue;
+      }
+      const uint32_t r = (((*pixel & format.Rmask) >> format.Rshift) * alpha + 127) / 255;
+      const uint32_t g = (((*pixel & format.Gmask) >> format.Gshift) * alpha + 127) / 255;
+      const uint32_t b = (((*pixel & format.Bmask) >> format.Bshift) * alpha + 127) / 255;
+      *pixel = (r << format.Rshift) | (g << format.Gshift) |
+          (b << format.Bshift) | (alpha << format.Ashift);
+    }
+  }
+  SDL_UnlockSurface(&surface);
+}
+
 /**
  * @brief create_sdl_surface_from_memory
  * @param data
@@ -228,12 +278,12 @@ SDL_Surface_UniquePtr Surface::create_sdl_surface_from_memory(
 }
 
 /**
- * \brief Creates a surface implemetation corresponding to the requested file.
- * \param file_name Name of the image file to load, relative to the base directory specified.
+ * \brief Returns the actual name of an image file.
+ * \param file_name Name of the image file, relative to the base directory specified.
  * \param base_directory The base directory to use.
- * \return The surface created.
+ * \return The file name relative to the data directory.
  */
-SurfaceImplPtr Surface::get_surface_from_file(
+std::string Surface::get_image_file_name(
     const std::string& file_name,
     ImageDirectory base_directory) {
 
@@ -249,24 +299,177 @@ SurfaceImplPtr Surface::get_surface_from_file(
   }
   std::string prefixed_file_name = prefix + file_name;
 
-  const std::string& actual_file_name = QuestFiles::get_actual_file_name(prefixed_file_name, language_specific);
+  return QuestFiles::get_actual_file_name(prefixed_file_name, language_specific);
+}
+
+/**
+ * \brief Returns the actual name of an image file for a given language.
+ *
+ * Unlike the other version, this one does not read the current language,
+ * so it can be called from any thread.
+ *
+ * \param file_name Name of the image file, relative to the base directory specified.
+ * \param base_directory The base directory to use.
+ * \param language Language of language-specific images.
+ * \return The file name relative to the data directory.
+ */
+std::string Surface::get_image_file_name(
+    const std::string& file_name,
+    ImageDirectory base_directory,
+    const std::string& language) {
+
+  std::string prefix;
+  bool language_specific = false;
+
+  if (base_directory == DIR_SPRITES) {
+    prefix = "sprites/";
+  }
+  else if (base_directory == DIR_LANGUAGE) {
+    language_specific = true;
+    prefix = "images/";
+  }
+  std::string prefixed_file_name = prefix + file_name;
+
+  return QuestFiles::get_actual_file_name(prefixed_file_name, language_specific, language);
+}
+
+/**
+ * \brief Puts an image decoded in advance into the image cache.
+ *
+ * This uploads the image to the renderer, so it must be called from the
+ * main thread. Does nothing if the image is already in the cache.
+ *
+ * \param actual_file_name Name of the image file, as returned by
+ * get_image_file_name().
+ * \param surface The decoded image.
+ */
+void Surface::add_preloaded_image(
+    const std::string& actual_file_name,
+    SDL_Surface_UniquePtr surface) {
+
+  if (surface == nullptr) {
+    return;
+  }
+
+  if (!ImageCache::has(actual_file_name)) {
+    SurfaceImplPtr texture = create_compressed_texture_from_file(actual_file_name);
+    if (texture == nullptr) {
+      if (Video::is_premultiplied_alpha()) {
+        premultiply_alpha(*surface);
+      }
+      texture = Video::get_renderer().create_packed_texture(std::move(surface));
+    }
+    texture->set_source_file(actual_file_name);
+    ImageCache::add(actual_file_name, texture);
+  }
+}
+
+/**
+ * \brief Loads again an image of the image cache from its file.
+ *
+ * If the image keeps its size, the new pixels are uploaded to the existing
+ * texture, so that all surfaces, sprites and tilesets using it show
+ * the new version. Otherwise, the image is only removed from the cache:
+ * surfaces created later will use the new version.
+ *
+ * \param actual_file_name Name of the image file, as returned by
+ * get_image_file_name().
+ * \return \c true if the texture was updated.
+ */
+bool Surface::reload_image(const std::string& actual_file_name) {
+
+  if (!ImageCache::has(actual_file_name)) {
+    return false;
+  }
+
+  SurfaceImplPtr texture = ImageCache::get(actual_file_name);
+  SDL_Surface_UniquePtr surface = create_sdl_surface_from_file(actual_file_name);
+  if (texture == nullptr || surface == nullptr) {
+    return false;
+  }
+
+  if (surface->w != texture->get_width() || surface->h != texture->get_height()) {
+    ImageCache::remove(actual_file_name);
+    return false;
+  }
+
+  if (Video::is_premultiplied_alpha()) {
+    premultiply_alpha(*surface);
+  }
+  SDL_SetSurfaceBlendMode(surface.get(), SDL_BLENDMODE_NONE);
+  SDL_BlitSurface(surface.get(), nullptr, texture->get_surface(), nullptr);
+  texture->upload_surface();
+  texture->set_source_file(actual_file_name);
+  FrameDamage::notify();
+  return true;
+}
+
+/**
+ * \brief Creates a surface implemetation corresponding to the requested file.
+ * \param file_name Name of the image file to load, relative to the base directory specified.
+ * \param base_directory The base directory to use.
+ * \return The surface created.
+ */
+SurfaceImplPtr Surface::get_surface_from_file(
+    const std::string& file_name,
+    ImageDirectory base_directory) {
+
+  const std::string& actual_file_name = get_image_file_name(file_name, base_directory);
   if (!QuestFiles::data_file_exists(actual_file_name)) {
     // File not found.
     return nullptr;
   }
 
-  SurfaceImplPtr texture;
+  SurfaceImplPtr texture = ImageCache::get(actual_file_name);
+  if (texture == nullptr) {
+    texture = create_compressed_texture_from_file(actual_file_name);
+  }
+  if (texture == nullptr) {
+    SDL_Surface_UniquePtr surface = create_sdl_surface_from_file(actual_file_name);
+    if (surface != nullptr && Video::is_premultiplied_alpha()) {
+      premultiply_alpha(*surface);
+    }
+    texture = Video::get_renderer().create_packed_texture(std::move(surface));
+    texture->set_source_file(actual_file_name);
+    ImageCache::add(actual_file_name, texture);
+  }
+  return texture;
+}
 
-  std::lock_guard<std::mutex> lock(image_files_cache_mutex);
+/**
+ * \brief Creates a texture from the precompressed version of an image file.
+ *
+ * The precompressed version is a KTX2 file with the same name as the image.
+ *
+ * \param actual_file_name Name of the image file, as returned by
+ * get_image_file_name().
+ * \return The texture, or nullptr if there is no precompressed version or
+ * if the renderer does not support its format.
+ */
+SurfaceImplPtr Surface::create_compressed_texture_from_file(
+    const std::string& actual_file_name) {
 
-  auto it = image_files_cache.find(actual_file_name);
-  if (it != image_files_cache.end()) {
-    texture = it->second;
-  } else {
-    texture = Video::get_renderer().create_texture(create_sdl_surface_from_file(actual_file_name));
-    image_files_cache[actual_file_name] = texture;
+  if (Video::is_premultiplied_alpha()) {
+    // Precompressed images are encoded with straight alpha.
+    return nullptr;
   }
-  return texture;
+
+  const std::string& compressed_file_name = KtxImage::get_file_name(actual_file_name);
+  if (!QuestFiles::data_file_exists(compressed_file_name)) {
+    return nullptr;
+  }
+
+  QuestFiles::DataFileView view;
+  if (!view.open(compressed_file_name)) {
+    return nullptr;
+  }
+
+  KtxImage image;
+  if (!image.load(view.get_data(), view.get_size())) {
+    Debug::warning("Ignoring invalid compressed image '" + compressed_file_name + "'");
+    return nullptr;
+  }
+  return Video::get_renderer().create_compressed_texture(image);
 }
 
 /**
@@ -309,6 +512,17 @@ const SurfaceImpl &Surface::get_impl() const {
   return *internal_surface.get();
 }
 
+/**
+ * \brief Returns the internal surface, which may be shared with other surfaces.
+ *
+ * Surfaces created from the same image file share their internal surface.
+ *
+ * \return The internal surface.
+ */
+const SurfaceImplPtr& Surface::get_shared_impl() const {
+  return internal_surface;
+}
+
 /**
  * \brief Returns a buffer of the raw pixels of this surface.
  *
@@ -320,6 +534,19 @@ std::string Surface::get_pixels() const {
   return internal_surface->get_pixels();
 }
 
+/**
+ * \brief Reads the raw pixels of this surface without stalling the
+ * current frame.
+ *
+ * The callback is called during a later update of the simulation,
+ * with pixels in the format of get_pixels().
+ *
+ * \param callback Function receiving the pixel buffer.
+ */
+void Surface::get_pixels_async(const std::function<void(const std::string&)>& callback) const {
+  Video::get_renderer().read_pixels_async(internal_surface, callback);
+}
+
 /**
  * @brief Set pixels of this surface from a RGBA buffer
  * @param buffer a string considerer as array of bytes with pixels in RGBA
@@ -375,6 +602,50 @@ void Surface::fill_with_color(const Color& color, const Rectangle& where) {
   Video::get_renderer().fill(*internal_surface,color,where);
 }
 
+/**
+ * \brief Draws a one pixel wide line with the specified color.
+ *
+ * Both ends are included.
+ *
+ * \param color A color.
+ * \param from The first pixel of the line.
+ * \param to The last pixel of the line.
+ */
+void Surface::draw_line(const Color& color, const Point& from, const Point& to) {
+  Video::get_renderer().draw_line(*internal_surface,color,from,to);
+}
+
+/**
+ * \brief Draws the outline of a rectangle with the specified color.
+ *
+ * The outline is one pixel wide and inside the rectangle.
+ * Each pixel is drawn once, even if the color is not opaque.
+ *
+ * \param color A color.
+ * \param where The rectangle to outline.
+ */
+void Surface::draw_rectangle(const Color& color, const Rectangle& where) {
+
+  const int x = where.get_x();
+  const int y = where.get_y();
+  const int width = where.get_width();
+  const int height = where.get_height();
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+
+  fill_with_color(color, Rectangle(x, y, width, 1));
+  if (height > 1) {
+    fill_with_color(color, Rectangle(x, y + height - 1, width, 1));
+  }
+  if (height > 2) {
+    fill_with_color(color, Rectangle(x, y + 1, 1, height - 2));
+    if (width > 1) {
+      fill_with_color(color, Rectangle(x + width - 1, y + 1, 1, height - 2));
+    }
+  }
+}
+
 /**
  * \brief Draws this surface on another surface.
  * \param dst_surface The destination surface.
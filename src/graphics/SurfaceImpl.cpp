@@ -1,13 +1,43 @@
 #include "solarus/graphics/SurfaceImpl.h"
 #include <solarus/core/Debug.h>
 #include <solarus/graphics/Video.h>
+#include <algorithm>
+#include <cstring>
 
 namespace Solarus {
 
+constexpr size_t SurfaceImpl::max_dirty_regions;
+
+namespace {
+
+/**
+ * @brief Returns the number of pixels of a rectangle
+ * @param rectangle a rectangle
+ * @return its area
+ */
+int64_t get_area(const Rectangle& rectangle) {
+  return static_cast<int64_t>(rectangle.get_width()) * rectangle.get_height();
+}
+
+}
+
 SurfaceImpl::~SurfaceImpl() {
   Video::invalidate(*this);
 }
 
+/**
+ * @copydoc SurfaceImpl::set_source_file
+ */
+void SurfaceImpl::set_source_file(const std::string& /* file_name */) {
+}
+
+/**
+ * @copydoc SurfaceImpl::has_software_copy
+ */
+bool SurfaceImpl::has_software_copy() const {
+  return true;
+}
+
 /**
  * @brief is_premultiplied
  * @return
@@ -50,15 +80,146 @@ void SurfaceImpl::set_pixels(const std::string& buffer) {
   auto surface = get_surface();
   if (surface->format->format == SDL_PIXELFORMAT_ABGR8888) {
     // No conversion needed.
+    // Only copy and upload the pixels that change: consecutive modified
+    // rows make one dirty region.
+    const int width = get_width();
+    const size_t row_size = static_cast<size_t>(width) * 4;
     char* pixels = static_cast<char*>(surface->pixels);
-    std::copy(buffer.begin(), buffer.end(), pixels);
-    upload_surface();
+    Rectangle band;
+    bool in_band = false;
+    for (int y = 0; y < get_height(); ++y) {
+      const size_t offset = y * row_size;
+      const size_t size = offset < buffer.size() ?
+          std::min(row_size, (buffer.size() - offset) / 4 * 4) : 0;
+      if (size == 0) {
+        break;
+      }
+      const char* src = buffer.data() + offset;
+      char* dst = pixels + y * surface->pitch;
+      if (std::memcmp(src, dst, size) == 0) {
+        if (in_band) {
+          add_dirty_region(band);
+          in_band = false;
+        }
+        continue;
+      }
+
+      int left = 0;
+      while (std::memcmp(src + left * 4, dst + left * 4, 4) == 0) {
+        ++left;
+      }
+      int right = static_cast<int>(size / 4);
+      while (std::memcmp(src + (right - 1) * 4, dst + (right - 1) * 4, 4) == 0) {
+        --right;
+      }
+      std::copy(src + left * 4, src + right * 4, dst + left * 4);
+
+      const Rectangle row(left, y, right - left, 1);
+      if (in_band) {
+        band |= row;
+      }
+      else {
+        band = row;
+        in_band = true;
+      }
+    }
+    if (in_band) {
+      add_dirty_region(band);
+    }
+    upload_dirty_regions();
     return;
   }
   //Should never happen
   Debug::error("Set pixel on a surface with bad format");
 }
 
+void SurfaceImpl::get_pixels(uint8_t* pixels, int pitch, const Rectangle& region) const {
+  SDL_Surface* surface = get_surface();
+  if (surface->format->format != SDL_PIXELFORMAT_ABGR8888) {
+    //Should never happen
+    Debug::error("Get pixels of a surface with bad format");
+    return;
+  }
+
+  const size_t row_size = static_cast<size_t>(region.get_width()) * 4;
+  const uint8_t* src = static_cast<const uint8_t*>(surface->pixels) +
+      region.get_y() * surface->pitch + region.get_x() * 4;
+  for (int y = 0; y < region.get_height(); ++y) {
+    std::copy(src, src + row_size, pixels);
+    src += surface->pitch;
+    pixels += pitch;
+  }
+}
+
+void SurfaceImpl::set_pixels(const uint8_t* pixels, int pitch, const Rectangle& region) {
+  SDL_Surface* surface = get_surface();
+  if (surface->format->format != SDL_PIXELFORMAT_ABGR8888) {
+    //Should never happen
+    Debug::error("Set pixel on a surface with bad format");
+    return;
+  }
+
+  const size_t row_size = static_cast<size_t>(region.get_width()) * 4;
+  uint8_t* dst = static_cast<uint8_t*>(surface->pixels) +
+      region.get_y() * surface->pitch + region.get_x() * 4;
+  for (int y = 0; y < region.get_height(); ++y) {
+    std::copy(pixels, pixels + row_size, dst);
+    pixels += pitch;
+    dst += surface->pitch;
+  }
+  add_dirty_region(region);
+  upload_dirty_regions();
+}
+
+void SurfaceImpl::add_dirty_region(const Rectangle& region) {
+
+  Rectangle merged = region.get_intersection(Rectangle(0, 0, get_width(), get_height()));
+  if (merged.is_flat()) {
+    return;
+  }
+
+  // Merge with regions close enough that the union wastes at most
+  // a quarter of the pixels uploaded.
+  bool merging = true;
+  while (merging) {
+    merging = false;
+    for (auto it = dirty_regions.begin(); it != dirty_regions.end(); ++it) {
+      const Rectangle united = merged | *it;
+      if (get_area(united) * 4 <= (get_area(merged) + get_area(*it)) * 5) {
+        merged = united;
+        dirty_regions.erase(it);
+        merging = true;
+        break;
+      }
+    }
+  }
+
+  dirty_regions.push_back(merged);
+  if (dirty_regions.size() > max_dirty_regions) {
+    for (const Rectangle& dirty_region : dirty_regions) {
+      merged |= dirty_region;
+    }
+    dirty_regions.assign(1, merged);
+  }
+}
+
+void SurfaceImpl::upload_dirty_regions() {
+
+  const Rectangle whole(0, 0, get_width(), get_height());
+  for (const Rectangle& region : dirty_regions) {
+    if (region == whole) {
+      upload_surface();
+      dirty_regions.clear();
+      return;
+    }
+  }
+
+  for (const Rectangle& region : dirty_regions) {
+    upload_region(region);
+  }
+  dirty_regions.clear();
+}
+
 void SurfaceImpl::apply_pixel_filter(const SoftwarePixelFilter& pixel_filter, SurfaceImpl& dst_surface) const {
   const int factor = pixel_filter.get_scaling_factor();
   Debug::check_assertion(dst_surface.get_width() == get_width() * factor,
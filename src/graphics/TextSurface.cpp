@@ -20,6 +20,7 @@
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
 #include "solarus/core/System.h"
+#include "solarus/graphics/GlyphAtlas.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Shader.h"
 #include "solarus/graphics/TextSurface.h"
@@ -28,11 +29,71 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <algorithm>
 #include <memory>
 #include <SDL_ttf.h>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Decodes the characters of a UTF-8 string from a position.
+ *
+ * Only characters of the basic multilingual plane are supported.
+ * An incomplete character at the end of the string is left for later.
+ *
+ * \param[in] text The string to decode.
+ * \param[in,out] position Index of the first byte to decode.
+ * Set to the index after the last complete character decoded.
+ * \param[out] code_points The code points decoded.
+ * \return \c false if the string is malformed or has characters outside of
+ * the basic multilingual plane.
+ */
+bool decode_utf8(
+    const std::string& text,
+    size_t& position,
+    std::vector<uint16_t>& code_points
+) {
+  code_points.clear();
+  while (position < text.size()) {
+    const uint8_t first_byte = static_cast<uint8_t>(text[position]);
+    size_t num_continuation_bytes = 0;
+    uint32_t code_point = 0;
+    if (first_byte < 0x80) {
+      code_point = first_byte;
+    }
+    else if ((first_byte & 0xE0) == 0xC0) {
+      code_point = first_byte & 0x1F;
+      num_continuation_bytes = 1;
+    }
+    else if ((first_byte & 0xF0) == 0xE0) {
+      code_point = first_byte & 0x0F;
+      num_continuation_bytes = 2;
+    }
+    else {
+      return false;
+    }
+
+    if (position + num_continuation_bytes >= text.size()) {
+      // Incomplete character, maybe the text is being typed.
+      return true;
+    }
+    for (size_t i = 1; i <= num_continuation_bytes; ++i) {
+      const uint8_t byte = static_cast<uint8_t>(text[position + i]);
+      if ((byte & 0xC0) != 0x80) {
+        return false;
+      }
+      code_point = (code_point << 6) | (byte & 0x3F);
+    }
+    code_points.push_back(static_cast<uint16_t>(code_point));
+    position += num_continuation_bytes + 1;
+  }
+  return true;
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates a text to draw with the default properties.
  *
@@ -71,7 +132,17 @@ TextSurface::TextSurface(int x, int y,
   font_size(11),
   x(x),
   y(y),
-  surface(nullptr),
+  glyph_surface(nullptr),
+  glyph_atlas(nullptr),
+  glyph_quads(),
+  size(),
+  laid_out_bytes(0),
+  num_characters(0),
+  pen_x(0),
+  line_min_x(0),
+  line_max_x(0),
+  last_code_point(0),
+  visible_characters(-1),
   text() {
 
   if (font_id.empty()) {
@@ -123,7 +194,7 @@ void TextSurface::set_horizontal_alignment(HorizontalAlignment horizontal_alignm
 
   this->horizontal_alignment = horizontal_alignment;
 
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -148,7 +219,7 @@ void TextSurface::set_vertical_alignment(VerticalAlignment vertical_alignment) {
 
   this->vertical_alignment = vertical_alignment;
 
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -169,7 +240,7 @@ void TextSurface::set_alignment(HorizontalAlignment horizontal_alignment,
   this->horizontal_alignment = horizontal_alignment;
   this->vertical_alignment = vertical_alignment;
 
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -295,7 +366,7 @@ void TextSurface::set_position(int x, int y) {
 
   this->x = x;
   this->y = y;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -317,7 +388,7 @@ void TextSurface::set_x(int x) {
   }
 
   this->x = x;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -339,7 +410,7 @@ void TextSurface::set_y(int y) {
   }
 
   this->y = y;
-  rebuild();
+  update_text_position();
 }
 
 /**
@@ -367,6 +438,7 @@ const std::string& TextSurface::get_text() const {
  * \brief Sets the string drawn.
  *
  * If the specified string is the same than the current text, nothing is done.
+ * If it starts with the current text, only the new characters are laid out.
  *
  * \param text The text to display.
  */
@@ -376,7 +448,13 @@ void TextSurface::set_text(const std::string& text) {
     return;
   }
 
+  const bool appended = text.size() > this->text.size() &&
+      text.compare(0, this->text.size(), this->text) == 0;
   this->text = text;
+  if (appended && append_glyphs()) {
+    update_text_position();
+    return;
+  }
   rebuild();
 }
 
@@ -391,17 +469,34 @@ void TextSurface::add_char(char c) {
   set_text(text + c);
 }
 
+/**
+ * \brief Returns how many characters of the text are drawn.
+ * \return The number of visible characters, or -1 if the whole text is drawn.
+ */
+int TextSurface::get_visible_characters() const {
+  return visible_characters;
+}
+
+/**
+ * \brief Sets how many characters of the text are drawn.
+ *
+ * This allows to reveal a text progressively without laying it out again.
+ * The size and the alignment of the text still take the whole text into
+ * account.
+ *
+ * \param visible_characters The number of visible characters,
+ * or -1 to draw the whole text.
+ */
+void TextSurface::set_visible_characters(int visible_characters) {
+  this->visible_characters = visible_characters;
+}
+
 /**
  * \brief Returns the width of the surface containing the text.
  * \return the width in pixels
  */
 int TextSurface::get_width() const {
-
-  if (surface == nullptr) {
-    return 0;
-  }
-
-  return surface->get_width();
+  return size.width;
 }
 
 /**
@@ -409,12 +504,7 @@ int TextSurface::get_width() const {
  * \return the height in pixels
  */
 int TextSurface::get_height() const {
-
-  if (surface == nullptr) {
-    return 0;
-  }
-
-  return surface->get_height();
+  return size.height;
 }
 
 /**
@@ -422,17 +512,26 @@ int TextSurface::get_height() const {
  * \return the size of the surface
  */
 Size TextSurface::get_size() const {
-  return { get_width(), get_height() };
+  return size;
 }
 
 /**
- * \brief Redraws the text surface.
+ * \brief Lays out the whole text again.
  *
  * This function is called when there is a change.
  */
 void TextSurface::rebuild() {
 
-  surface = nullptr;
+  glyph_surface = nullptr;
+  glyph_atlas = nullptr;
+  glyph_quads.clear();
+  size = Size();
+  laid_out_bytes = 0;
+  num_characters = 0;
+  pen_x = 0;
+  line_min_x = 0;
+  line_max_x = 0;
+  last_code_point = 0;
 
   if (font_id.empty()) {
     return;
@@ -441,6 +540,7 @@ void TextSurface::rebuild() {
   if (is_empty()) {
     // Empty string or only whitespaces: no surface to create.
     // Some fonts make TTF_Font fail if the string contains only whitespaces.
+    update_text_position();
     return;
   }
 
@@ -449,13 +549,27 @@ void TextSurface::rebuild() {
   );
 
   if (FontResource::is_bitmap_font(font_id)) {
-    rebuild_bitmap();
+    glyph_surface = FontResource::get_bitmap_font(font_id);
   }
   else {
+    glyph_atlas = FontResource::get_glyph_atlas(
+        font_id, font_size, font_hinting, font_kerning, rendering_mode, text_color
+    );
+  }
+
+  if (!append_glyphs()) {
     rebuild_ttf();
   }
 
-  // calculate the coordinates of the top-left corner
+  update_text_position();
+}
+
+/**
+ * \brief Computes the coordinates of the top-left corner of the text
+ * from its position, its alignment and its size.
+ */
+void TextSurface::update_text_position() {
+
   int x_left = 0, y_top = 0;
 
   switch (horizontal_alignment) {
@@ -465,11 +579,11 @@ void TextSurface::rebuild() {
     break;
 
   case HorizontalAlignment::CENTER:
-    x_left = x - surface->get_width() / 2;
+    x_left = x - size.width / 2;
     break;
 
   case HorizontalAlignment::RIGHT:
-    x_left = x - surface->get_width();
+    x_left = x - size.width;
     break;
   }
 
@@ -480,11 +594,11 @@ void TextSurface::rebuild() {
     break;
 
   case VerticalAlignment::MIDDLE:
-    y_top = y - surface->get_height() / 2;
+    y_top = y - size.height / 2;
     break;
 
   case VerticalAlignment::BOTTOM:
-    y_top = y - surface->get_height();
+    y_top = y - size.height;
     break;
   }
 
@@ -492,41 +606,46 @@ void TextSurface::rebuild() {
 }
 
 /**
- * \brief Redraws the text surface in the case of a bitmap font.
+ * \brief Lays out the characters of the text that are not laid out yet.
  *
- * This function is called when there is a change.
+ * Glyphs already laid out are kept, so that typing a text one character
+ * at a time only lays out the new ones.
+ *
+ * \return \c false if the text cannot be laid out incrementally
+ * and should be rebuilt.
  */
-void TextSurface::rebuild_bitmap() {
+bool TextSurface::append_glyphs() {
 
-  // First count the number of characters in the UTF-8 string.
-  int num_chars = 0;
-  for (unsigned i = 0; i < text.size(); i++) {
-    char current_char = text[i];
-    if ((current_char & 0xE0) == 0xC0) {
-      // This character uses two bytes.
-      ++i;
-    }
-    ++num_chars;
+  if (glyph_atlas != nullptr) {
+    return append_ttf_glyphs();
   }
+  if (glyph_surface != nullptr && FontResource::is_bitmap_font(font_id)) {
+    return append_bitmap_glyphs();
+  }
+  return false;
+}
+
+/**
+ * \brief Lays out new characters in the case of a bitmap font.
+ * \return \c true.
+ */
+bool TextSurface::append_bitmap_glyphs() {
 
   // Determine the letter size from the surface size.
-  const SurfacePtr& bitmap = FontResource::get_bitmap_font(font_id);
-  const Size& bitmap_size = bitmap->get_size();
+  const Size& bitmap_size = glyph_surface->get_size();
   int char_width = bitmap_size.width / 128;
   int char_height = bitmap_size.height / 16;
 
-  surface = Surface::create((char_width - 1) * num_chars + 1, char_height);
-
-  // Traverse the string again to draw the characters.
-  Point dst_position;
-  for (unsigned i = 0; i < text.size(); i++) {
+  // Traverse the new part of the UTF-8 string to place the characters.
+  size_t i = laid_out_bytes;
+  for (; i < text.size(); i++) {
     char first_byte = text[i];
     Rectangle src_position(0, 0, char_width, char_height);
     if ((first_byte & 0xE0) != 0xC0) {
       // This character uses one byte.
       src_position.set_xy(first_byte * char_width, 0);
     }
-    else {
+    else if (i + 1 < text.size()) {
       // This character uses two bytes.
       ++i;
       char second_byte = text[i];
@@ -534,19 +653,83 @@ void TextSurface::rebuild_bitmap() {
       src_position.set_xy((code_point % 128) * char_width,
           (code_point / 128) * char_height);
     }
-    bitmap->draw_region(src_position, surface, dst_position);
-    dst_position.x += char_width - 1;
+    else {
+      // Incomplete character, maybe the text is being typed.
+      break;
+    }
+    const Point dst_position(num_characters * (char_width - 1), 0);
+    glyph_quads.push_back({ src_position, dst_position, num_characters });
+    ++num_characters;
   }
+  laid_out_bytes = i;
+
+  size = Size(num_characters * (char_width - 1) + 1, char_height);
+  return true;
 }
 
 /**
- * \brief Redraws the text surface in the case of a normal font.
+ * \brief Lays out new characters in the case of a normal font.
  *
- * This function is called when there is a change.
+ * Glyphs come from the glyph atlas of the font and are placed like SDL_ttf
+ * places them when it renders a line.
+ *
+ * \return \c false if some glyphs are not available in the atlas.
+ */
+bool TextSurface::append_ttf_glyphs() {
+
+  size_t position = laid_out_bytes;
+  std::vector<uint16_t> code_points;
+  if (!decode_utf8(text, position, code_points)) {
+    return false;
+  }
+
+  GlyphAtlas& atlas = *glyph_atlas;
+  int height = std::max(size.height, TTF_FontHeight(&atlas.get_font()));
+  for (uint16_t code_point : code_points) {
+    const GlyphAtlas::Glyph* glyph = atlas.get_glyph(code_point);
+    if (glyph == nullptr) {
+      return false;
+    }
+    if (num_characters > 0) {
+      pen_x += atlas.get_kerning(last_code_point, code_point);
+    }
+
+    if (pen_x + glyph->min_x < line_min_x) {
+      // The line goes further on the left: move what is already laid out.
+      const int shift = line_min_x - (pen_x + glyph->min_x);
+      for (GlyphQuad& quad : glyph_quads) {
+        quad.position.x += shift;
+      }
+      line_min_x -= shift;
+    }
+    line_max_x = std::max(line_max_x, pen_x + std::max(glyph->advance, glyph->max_x));
+
+    if (!glyph->region.is_flat()) {
+      // Glyphs were rendered alone, shifted right if they go left of their pen.
+      const Point position(pen_x - line_min_x + std::min(0, glyph->min_x), 0);
+      glyph_quads.push_back({ glyph->region, position, num_characters });
+      height = std::max(height, glyph->region.get_height());
+    }
+
+    pen_x += glyph->advance;
+    last_code_point = code_point;
+    ++num_characters;
+  }
+  laid_out_bytes = position;
+
+  size = Size(line_max_x - line_min_x, height);
+  return true;
+}
+
+/**
+ * \brief Renders the whole text at once into its own surface.
+ *
+ * This is only done for texts that the glyph atlas cannot draw.
  */
 void TextSurface::rebuild_ttf() {
 
-  // create the text surface
+  glyph_atlas = nullptr;
+  glyph_quads.clear();
 
   TTF_Font& internal_font = FontResource::get_outline_font(font_id, font_size, font_hinting, font_kerning);
   SDL_Color internal_color;
@@ -578,34 +761,79 @@ void TextSurface::rebuild_ttf() {
        format->Bmask,
        format->Amask));
   SDL_BlitSurface(surface.get(),nullptr,full.get(),nullptr);
-  this->surface = Surface::create(std::move(full), true);
+  glyph_surface = Surface::create(std::move(full), true);
+  size = glyph_surface->get_size();
+  glyph_quads.push_back({ Rectangle(Point(), size), Point(), 0 });
+}
+
+/**
+ * \brief Returns the surface that contains the glyphs to draw.
+ * \return The glyph surface, or nullptr if there is nothing to draw.
+ */
+const SurfacePtr& TextSurface::get_glyph_surface() const {
+
+  if (glyph_atlas != nullptr) {
+    // The atlas may have been replaced by a larger one since the last rebuild.
+    return glyph_atlas->get_surface();
+  }
+  return glyph_surface;
 }
 
 /**
  * \brief Draws this text on the given surface
- * \param region The subrectangle to draw in this object.
  * \param dst_surface The destination surface.
  * \param infos draw informations.
  */
 void TextSurface::raw_draw(Surface& dst_surface,const DrawInfos& infos) const {
-  if (surface != nullptr) {
-    surface->raw_draw(
-        dst_surface,
-        DrawInfos(infos,infos.dst_position + text_position));
-  }
+  raw_draw_region(dst_surface, infos);
 }
 
 /**
  * \brief Draws a subrectangle of this text surface on another surface.
- * \param region The subrectangle to draw in this object.
+ *
+ * Each glyph in the region is drawn as a region of the glyph surface,
+ * transformed around the same origin as the whole text.
+ *
  * \param dst_surface The destination surface.
  * \param infos drawing infos
  */
 void TextSurface::raw_draw_region(Surface& dst_surface,const DrawInfos& infos) const {
-  if (surface != nullptr) {
+
+  const SurfacePtr& surface = get_glyph_surface();
+  if (surface == nullptr) {
+    return;
+  }
+
+  for (const GlyphQuad& quad : glyph_quads) {
+    if (visible_characters >= 0 && quad.character >= visible_characters) {
+      // Quads are in the order of the text.
+      break;
+    }
+    const Rectangle glyph_rectangle(quad.position, quad.region.get_size());
+    if (!glyph_rectangle.overlaps(infos.region)) {
+      continue;
+    }
+    const Rectangle& part = glyph_rectangle.get_intersection(infos.region);
+    const Point& offset = part.get_xy() - infos.region.get_xy();
+    const Rectangle src_region(
+        quad.region.get_xy() + part.get_xy() - quad.position,
+        part.get_size()
+    );
+    const Point dst_position = infos.dst_position + text_position + offset;
     surface->raw_draw_region(
         dst_surface,
-        DrawInfos(infos,infos.dst_position + text_position));
+        DrawInfos(
+            src_region,
+            dst_position,
+            infos.transformation_origin - offset,
+            infos.blend_mode,
+            infos.opacity,
+            infos.rotation,
+            infos.scale,
+            infos.color,
+            infos.proxy
+        )
+    );
   }
 }
 
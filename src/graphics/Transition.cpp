@@ -20,9 +20,19 @@
 #include "solarus/graphics/TransitionImmediate.h"
 #include "solarus/graphics/TransitionFade.h"
 #include "solarus/graphics/TransitionScrolling.h"
+#include "solarus/graphics/TransitionShader.h"
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Transition effects registered by name.
+ */
+std::map<std::string, Transition::Effect> effects;
+
+}
+
 const std::string EnumInfoTraits<Transition::Style>::pretty_name = "transition style";
 
 const EnumInfo<Transition::Style>::names_type EnumInfoTraits<Transition::Style>::names = {
@@ -86,6 +96,79 @@ Transition* Transition::create(
   return transition;
 }
 
+/**
+ * \brief Creates a transition drawn by a registered effect.
+ * \param effect_name Name of the effect.
+ * \param direction Direction of the transition.
+ * \param game The current game if any.
+ * \return The transition created, or nullptr if there is no such effect.
+ */
+Transition* Transition::create(
+    const std::string& effect_name,
+    Transition::Direction direction,
+    Game* game) {
+
+  const Effect* effect = get_effect(effect_name);
+  if (effect == nullptr) {
+    return nullptr;
+  }
+
+  const uint32_t duration = (direction == Direction::CLOSING) ?
+      effect->closing_duration : effect->opening_duration;
+  Transition* transition = new TransitionShader(direction, effect->shader, duration);
+  transition->game = game;
+
+  return transition;
+}
+
+/**
+ * \brief Returns a registered transition effect.
+ * \param effect_name Name of the effect.
+ * \return The effect, or nullptr if there is no effect with this name.
+ */
+const Transition::Effect* Transition::get_effect(const std::string& effect_name) {
+
+  const auto& it = effects.find(effect_name);
+  if (it == effects.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+/**
+ * \brief Registers a transition effect, replacing any effect with this name.
+ * \param effect_name Name of the effect.
+ * \param effect The effect.
+ */
+void Transition::set_effect(const std::string& effect_name, const Effect& effect) {
+
+  Debug::check_assertion(effect.shader != nullptr, "Missing transition shader");
+  effects[effect_name] = effect;
+}
+
+/**
+ * \brief Unregisters a transition effect if it exists.
+ *
+ * Transitions already created with this effect are not affected.
+ *
+ * \param effect_name Name of the effect.
+ */
+void Transition::remove_effect(const std::string& effect_name) {
+
+  effects.erase(effect_name);
+}
+
+/**
+ * \brief Unregisters all transition effects.
+ *
+ * This releases their shaders, so it must be done before the video system
+ * is closed.
+ */
+void Transition::clear_effects() {
+
+  effects.clear();
+}
+
 /**
  * \brief Returns the current game.
  *
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/System.h"
+#include "solarus/graphics/Shader.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/TransitionShader.h"
+#include <algorithm>
+#include <memory>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a shader transition effect.
+ * \param direction Direction of the transition (opening or closing).
+ * \param shader The shader that draws the effect.
+ * \param duration Duration of the transition in milliseconds.
+ */
+TransitionShader::TransitionShader(
+    Transition::Direction direction,
+    const ShaderPtr& shader,
+    uint32_t duration):
+  Transition(direction),
+  shader(shader),
+  duration(duration),
+  start_date(0),
+  started(false),
+  progress(0.0f) {
+
+  Debug::check_assertion(shader != nullptr, "Missing transition shader");
+}
+
+/**
+ * \brief Returns whether this transition effect needs the previous surface.
+ * \return \c true: the shader may blend both surfaces.
+ */
+bool TransitionShader::needs_previous_surface() const {
+  return true;
+}
+
+/**
+ * \brief Starts this transition effect.
+ */
+void TransitionShader::start() {
+
+  started = true;
+  start_date = System::now();
+  progress = (duration == 0) ? 1.0f : 0.0f;
+}
+
+/**
+ * \brief Returns whether the transition effect is started and not finished yet.
+ * \return true if the transition effect is started
+ */
+bool TransitionShader::is_started() const {
+
+  return started && !is_finished();
+}
+
+/**
+ * \brief Returns whether the transition effect is finished.
+ * \return true if the transition effect is finished
+ */
+bool TransitionShader::is_finished() const {
+
+  return progress >= 1.0f;
+}
+
+/**
+ * \brief Notifies the transition effect that it was just suspended
+ * or resumed.
+ * \param suspended true if suspended, false if resumed.
+ */
+void TransitionShader::notify_suspended(bool suspended) {
+
+  if (!suspended) {
+    start_date += System::now() - get_when_suspended();
+  }
+}
+
+/**
+ * \brief Updates this transition effect.
+ *
+ * This function is called repeatedly while the transition exists.
+ */
+void TransitionShader::update() {
+
+  if (!is_started() || is_suspended()) {
+    return;
+  }
+
+  const uint32_t elapsed = System::now() - start_date;
+  progress = std::min(1.0f, static_cast<float>(elapsed) / duration);
+}
+
+/**
+ * \brief Draws the transition effect on a surface.
+ *
+ * The shader gets the progress in PROGRESS_NAME, whether the transition
+ * is opening in OPENING_NAME and the previous surface if any in
+ * PREVIOUS_TEXTURE_NAME.
+ *
+ * \param dst_surface The destination surface.
+ * \param src_surface The surface to draw.
+ * \param infos Draw parameters.
+ */
+void TransitionShader::draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const {
+
+  shader->set_uniform_1f(PROGRESS_NAME, progress);
+  shader->set_uniform_1b(OPENING_NAME, get_direction() == Direction::OPENING);
+
+  Surface* previous_surface = get_previous_surface();
+  if (previous_surface != nullptr) {
+    shader->set_uniform_texture(
+          PREVIOUS_TEXTURE_NAME,
+          std::static_pointer_cast<Surface>(previous_surface->shared_from_this())
+    );
+  }
+
+  shader->draw(dst_surface, src_surface, infos);
+}
+
+}
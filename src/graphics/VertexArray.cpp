@@ -231,10 +231,39 @@ PrimitiveType VertexArray::get_primitive_type() const {
 }
 
 /**
- * @brief VertexArray::data
- * @return
+ * @brief set how often the vertices of this array are expected to change
+ *
+ * Static arrays are only uploaded when they were modified since the last
+ * draw. Stream arrays get a new buffer storage at each upload, so the
+ * driver does not wait for the previous draw to finish.
+ *
+ * @param usage the usage hint
+ */
+void VertexArray::set_usage(BufferUsage usage) {
+  if(usage != this->usage) {
+    this->usage = usage;
+    buffer_capacity = 0; //Reallocate with the new hint
+    buffer_dirty = true;
+  }
+}
+
+/**
+ * @brief get how often the vertices of this array are expected to change
+ * @return the usage hint
+ */
+BufferUsage VertexArray::get_usage() const {
+  return usage;
+}
+
+/**
+ * @brief get pointer to data contiguous in memory, to modify it
+ *
+ * The array is considered modified.
+ *
+ * @return pointer to vector storage
  */
 Vertex* VertexArray::data() {
+  buffer_dirty = true;
   return vertices.data();
 }
 
@@ -290,6 +319,7 @@ const Vertex* VertexArray::data() const {
  * @param v vertex to add
  */
 void VertexArray::add_vertex(const Vertex& v) {
+  buffer_dirty = true;
   vertices.push_back(v);
 }
 
@@ -307,6 +337,7 @@ size_t VertexArray::vertex_count() const {
  * @return vertex reference
  */
 Vertex& VertexArray::operator [](size_t index) {
+  buffer_dirty = true;
   return vertices.at(index);
 }
 
@@ -19,21 +19,31 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/PerfCounter.h"
+#include "solarus/core/PerfTrace.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
+#include "solarus/core/System.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/FrameRecorder.h"
 #include "solarus/graphics/Hq2xFilter.h"
 #include "solarus/graphics/Hq3xFilter.h"
 #include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/ImageCache.h"
+#include "solarus/graphics/PixelFilterExecutor.h"
 #include "solarus/graphics/Scale2xFilter.h"
 #include "solarus/graphics/Shader.h"
 #include "solarus/graphics/SoftwareVideoMode.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Transition.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/graphics/Renderer.h"
 #include "solarus/graphics/sdlrenderer/SDLRenderer.h"
+#include "solarus/graphics/softwarerenderer/SoftwareRenderer.h"
 #include "solarus/graphics/glrenderer/GlRenderer.h"
+#include "solarus/graphics/glrenderer/GlShader.h"
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <sstream>
 #include <utility>
@@ -64,8 +74,18 @@ struct VideoContext {
   const SoftwareVideoMode*
   default_video_mode = nullptr;         /**< Default software video mode. */
   SurfacePtr scaled_surface = nullptr;      /**< The screen surface used with software-scaled modes. */
+  ShaderPtr filter_shader = nullptr;        /**< GPU version of the filter of the video mode, or nullptr
+                                             * to filter on the CPU into scaled_surface. */
   SurfacePtr screen_surface = nullptr;      /**< Strange surface representing the window */
   ShaderPtr  current_shader = nullptr;      /**< Current fullscreen effect */
+  std::vector<ShaderPtr> post_effects;      /**< Shaders applied after the current one, in order. */
+  std::vector<SurfacePtr>
+  pass_surfaces;                        /**< Intermediate targets of shader passes, shared between passes. */
+  double min_shader_resolution = 1.0;       /**< Lowest render scale of a window-sized shader pass. */
+  double max_shader_resolution = 1.0;       /**< Highest render scale of a window-sized shader pass. */
+  double shader_resolution = 1.0;           /**< Current render scale of the window-sized shader pass. */
+  double shader_gpu_time = 0.0;             /**< Average GPU time of this pass in milliseconds. */
+  int frames_since_resolution_change = 0;   /**< Frames measured at the current render scale. */
 
   std::string opengl_version = "none";
   std::string shading_language_version = "none";
@@ -76,10 +96,43 @@ struct VideoContext {
   bool fullscreen_window = false;           /**< True if the window is in fullscreen. */
   bool visible_cursor = true;               /**< True if the mouse cursor is visible. */
   bool pc_render = false;                   /**< Whether rendering performance counter is used. */
+  bool premultiplied_alpha = false;         /**< Whether all images are stored with premultiplied alpha. */
+
+  VsyncMode vsync_mode = VsyncMode::ON;     /**< How frames are paced with the display. */
+  uint64_t last_present_date = 0;           /**< Real time of the last present in microseconds. */
+  double present_interval = 0.0;            /**< Average time between two presents in milliseconds. */
+  double present_jitter = 0.0;              /**< Average deviation from present_interval in milliseconds. */
 };
 
 VideoContext context;
 
+/**
+ * \brief Creates a shader that applies a software filter on the GPU.
+ * \param software_filter The filter.
+ * \return The shader, or nullptr if the filter has to run on the CPU.
+ */
+ShaderPtr create_filter_shader(const SoftwarePixelFilter& software_filter) {
+
+  if (dynamic_cast<GlRenderer*>(context.renderer.get()) == nullptr) {
+    // The SDL renderer keeps the software filters.
+    return nullptr;
+  }
+
+  const std::string& fragment_source = software_filter.get_fragment_shader_source();
+  if (fragment_source.empty()) {
+    return nullptr;
+  }
+
+  ShaderPtr shader = context.renderer->create_shader(
+        "", fragment_source, software_filter.get_scaling_factor());
+  if (shader == nullptr || !shader->is_valid()) {
+    Debug::warning("Cannot filter the video mode on the GPU: " +
+                   (shader != nullptr ? shader->get_error() : std::string()));
+    return nullptr;
+  }
+  return shader;
+}
+
 struct chain_end{};
 
 template<typename T = chain_end>
@@ -129,7 +182,43 @@ void create_window(const Arguments& args) {
   Debug::check_assertion(context.main_window != nullptr,
                          std::string("Cannot create the window: ") + SDL_GetError());
 
-  context.renderer = create_chain<GlRenderer,SDLRenderer>(context.main_window, force_software);
+  const std::string& batch_size_arg = args.get_argument_value("-gl-batch-size");
+  if (!batch_size_arg.empty()) {
+    std::istringstream iss(batch_size_arg);
+    int batch_size = 0;
+    if (iss >> batch_size && batch_size >= 0) {
+      GlRenderer::set_sprite_batch_size(static_cast<size_t>(batch_size));
+    }
+  }
+  const std::string& texture_atlas_arg = args.get_argument_value("-texture-atlas");
+  if (!texture_atlas_arg.empty()) {
+    GlRenderer::set_texture_atlas_enabled(texture_atlas_arg == "yes");
+  }
+  const std::string& image_copies_arg = args.get_argument_value("-image-copies");
+  if (!image_copies_arg.empty()) {
+    GlRenderer::set_image_copies_kept(image_copies_arg == "yes");
+  }
+  const std::string& instancing_arg = args.get_argument_value("-gl-instancing");
+  if (!instancing_arg.empty()) {
+    GlRenderer::set_sprite_instancing_enabled(instancing_arg == "yes");
+  }
+  context.premultiplied_alpha = args.get_argument_value("-premultiplied-alpha") == "yes";
+  const std::string& vsync_arg = args.get_argument_value("-vsync");
+  if (vsync_arg == "no" || vsync_arg == "off") {
+    Video::set_vsync_mode(VsyncMode::OFF);
+  }
+  else if (vsync_arg == "adaptive") {
+    Video::set_vsync_mode(VsyncMode::ADAPTIVE);
+  }
+  else if (vsync_arg == "latency") {
+    Video::set_vsync_mode(VsyncMode::LATENCY);
+  }
+  const std::string& shader_cache_arg = args.get_argument_value("-shader-cache");
+  if (!shader_cache_arg.empty()) {
+    GlShader::set_program_cache_enabled(shader_cache_arg == "yes");
+  }
+
+  context.renderer = create_chain<GlRenderer,SoftwareRenderer,SDLRenderer>(context.main_window, force_software);
 
   Debug::check_assertion(static_cast<bool>(context.renderer),
                          std::string("Cannot create the renderer: ") + SDL_GetError());
@@ -186,6 +275,74 @@ void initialize_software_video_modes() {
   Video::set_default_video_mode();
 }
 
+/**
+ * \brief Returns an intermediate target for a shader pass.
+ *
+ * Targets are kept from one frame to the next and shared by passes of the
+ * same size. A pass cannot read and write the same surface, so consecutive
+ * passes of the same size alternate between two targets.
+ *
+ * \param size Size of the target.
+ * \param source Surface read by the pass.
+ * \return A surface of this size other than the source.
+ */
+const SurfacePtr& get_pass_surface(const Size& size, const SurfacePtr& source) {
+
+  for (const SurfacePtr& surface : context.pass_surfaces) {
+    if (surface != source && surface->get_size() == size) {
+      return surface;
+    }
+  }
+  context.pass_surfaces.push_back(Surface::create(size));
+  return context.pass_surfaces.back();
+}
+
+/**
+ * \brief Adapts the render scale of the window-sized shader pass to the GPU
+ * time it takes.
+ *
+ * The pass should fit in half of a frame at the refresh rate of the display,
+ * leaving the rest of the frame to the quest.
+ * The cost of the pass is proportional to its number of pixels, that is,
+ * to the square of the render scale.
+ *
+ * \param gpu_time Last GPU time of the pass in milliseconds.
+ */
+void update_shader_resolution(double gpu_time) {
+
+  if (context.shader_gpu_time == 0.0) {
+    context.shader_gpu_time = gpu_time;
+  }
+  context.shader_gpu_time += (gpu_time - context.shader_gpu_time) * 0.1;
+  ++context.frames_since_resolution_change;
+  if (context.frames_since_resolution_change < 30) {
+    // Wait for measurements at the current scale.
+    return;
+  }
+
+  const int refresh_rate = Video::get_refresh_rate();
+  const double budget = 0.5 * 1000.0 / (refresh_rate > 0 ? refresh_rate : 60);
+  const double ratio = budget / std::max(context.shader_gpu_time, 0.001);
+  if (ratio > 0.8 && ratio < 1.5) {
+    // Close enough: don't change the size of the pass for a few percents.
+    return;
+  }
+
+  // Steps of 1/20 avoid recreating the target for tiny changes.
+  double scale = context.shader_resolution * std::sqrt(ratio);
+  scale = std::floor(scale * 20.0) / 20.0;
+  scale = std::min(std::max(scale, context.min_shader_resolution), context.max_shader_resolution);
+  if (scale == context.shader_resolution) {
+    return;
+  }
+
+  // Expect a cost proportional to the number of pixels until measured.
+  const double pixel_ratio = scale / context.shader_resolution;
+  context.shader_gpu_time *= pixel_ratio * pixel_ratio;
+  context.shader_resolution = scale;
+  context.frames_since_resolution_change = 0;
+}
+
 }  // Anonymous namespace.
 
 namespace Video {
@@ -196,8 +353,19 @@ namespace Video {
  * This method should be called when the program starts.
  * Options recognized:
  *   -no-video
+ *   -headless
  *   -perf-video-render=yes|no
+ *   -gl-batch-size=<sprites>
+ *   -texture-atlas=yes|no
+ *   -gl-instancing=yes|no
+ *   -sdl-batching=yes|no
+ *   -premultiplied-alpha=yes|no
+ *   -vsync=on|off|adaptive|latency
+ *   -shader-cache=yes|no
+ *   -filter-threads=N
  *   -quest-size=WIDTHxHEIGHT
+ *   -record-video=<file>
+ *   -record-video-fps=<frames per second>
  *
  * \param args Command-line arguments.
  */
@@ -214,9 +382,9 @@ void initialize(const Arguments& args) {
 
 
 
-  // Check the -no-video, -perf-video-render and the -quest-size options.
+  // Check the -no-video, -headless, -perf-video-render and the -quest-size options.
   const std::string& quest_size_string = args.get_argument_value("-quest-size");
-  context.disable_window = args.has_argument("-no-video");
+  context.disable_window = args.has_argument("-no-video") || args.has_argument("-headless");
   context.pc_render = args.get_argument_value("-perf-video-render") == "yes";
 
   context.geometry.wanted_quest_size = {
@@ -230,6 +398,43 @@ void initialize(const Arguments& args) {
     }
   }
 
+  const std::string& filter_threads_arg = args.get_argument_value("-filter-threads");
+  if (!filter_threads_arg.empty()) {
+    std::istringstream iss(filter_threads_arg);
+    int filter_threads = 0;
+    if (iss >> filter_threads && filter_threads >= 0) {
+      PixelFilterExecutor::set_num_threads(filter_threads);
+    }
+  }
+
+  const std::string& sdl_batching_arg = args.get_argument_value("-sdl-batching");
+  if (!sdl_batching_arg.empty()) {
+    SDLRenderer::set_batching_enabled(sdl_batching_arg == "yes");
+  }
+
+  const std::string& software_rasterizer_arg = args.get_argument_value("-software-rasterizer");
+  if (!software_rasterizer_arg.empty()) {
+    SoftwareRenderer::set_enabled(software_rasterizer_arg == "yes");
+  }
+
+  const std::string& image_cache_vram_arg = args.get_argument_value("-image-cache-vram");
+  const std::string& image_cache_ram_arg = args.get_argument_value("-image-cache-ram");
+  if (!image_cache_vram_arg.empty() || !image_cache_ram_arg.empty()) {
+    // Missing, invalid or negative values mean no limit.
+    const int64_t mib = 1024 * 1024;
+    int64_t vram_budget = 0;
+    int64_t ram_budget = 0;
+    std::istringstream vram_iss(image_cache_vram_arg);
+    if (!(vram_iss >> vram_budget) || vram_budget < 0) {
+      vram_budget = 0;
+    }
+    std::istringstream ram_iss(image_cache_ram_arg);
+    if (!(ram_iss >> ram_budget) || ram_budget < 0) {
+      ram_budget = 0;
+    }
+    ImageCache::set_budgets(vram_budget * mib, ram_budget * mib);
+  }
+
   // Create a pixel format anyway to make surface and color operations work,
   context.rgba_format = SDL_AllocFormat(SDL_PIXELFORMAT_ABGR8888);
 
@@ -238,6 +443,23 @@ void initialize(const Arguments& args) {
   }else {
     create_window(args);
   }
+
+  const std::string& record_arg = args.get_argument_value("-record-video");
+  if (!record_arg.empty()) {
+    const std::string& record_fps_arg = args.get_argument_value("-record-video-fps");
+    int frame_rate = FrameRecorder::default_frame_rate;
+    if (!record_fps_arg.empty()) {
+      std::istringstream iss(record_fps_arg);
+      int record_fps = 0;
+      if (iss >> record_fps && record_fps > 0) {
+        frame_rate = record_fps;
+      }
+      else {
+        Debug::error(std::string("Invalid video recording frame rate: '") + record_fps_arg + "'");
+      }
+    }
+    FrameRecorder::start(record_arg, frame_rate);
+  }
 }
 
 /**
@@ -249,6 +471,8 @@ void quit() {
     return;
   }
 
+  FrameRecorder::stop();
+
   if (is_fullscreen()) {
     // Get back on desktop before destroy the window.
     SDL_SetWindowFullscreen(context.main_window, 0);
@@ -266,6 +490,7 @@ void quit() {
   }
 
   Surface::empty_cache();
+  Transition::clear_effects();
 
   context = VideoContext();
 }
@@ -286,6 +511,93 @@ SDL_Window* get_window() {
   return context.main_window;
 }
 
+/**
+ * \brief Returns how frames are paced with the display.
+ * \return The vsync mode.
+ */
+VsyncMode get_vsync_mode() {
+  return context.vsync_mode;
+}
+
+/**
+ * \brief Sets how frames are paced with the display.
+ *
+ * Only the OpenGL renderer supports vsync modes other than ON.
+ * In LATENCY mode, vsync is off and the main loop paces frames itself
+ * with a high-resolution timer.
+ *
+ * \param vsync_mode The vsync mode.
+ */
+void set_vsync_mode(VsyncMode vsync_mode) {
+
+  context.vsync_mode = vsync_mode;
+  switch (vsync_mode) {
+  case VsyncMode::ON:
+    GlRenderer::set_swap_interval(1);
+    break;
+  case VsyncMode::ADAPTIVE:
+    GlRenderer::set_swap_interval(-1);
+    break;
+  case VsyncMode::OFF:
+  case VsyncMode::LATENCY:
+    GlRenderer::set_swap_interval(0);
+    break;
+  }
+}
+
+/**
+ * \brief Returns whether all images are stored with premultiplied alpha.
+ *
+ * In this mode, images are premultiplied when they are loaded and
+ * every surface is drawn with the same premultiplied blend equation,
+ * so that the blend and add modes do not break sprite batches.
+ * Pixels read from or written to surfaces are premultiplied too.
+ * This is set once with the -premultiplied-alpha option and cannot change
+ * once images are loaded.
+ *
+ * \return \c true if premultiplied alpha is used everywhere.
+ */
+bool is_premultiplied_alpha() {
+  return context.premultiplied_alpha;
+}
+
+/**
+ * \brief Returns the average time between two presents of frames.
+ * \return The average interval in milliseconds, or 0 if unknown yet.
+ */
+double get_present_interval() {
+  return context.present_interval;
+}
+
+/**
+ * \brief Returns the average deviation of the time between two presents
+ * from its average.
+ *
+ * This measures the present-to-present jitter: an irregular frame pacing
+ * shows as judder.
+ *
+ * \return The average deviation in milliseconds.
+ */
+double get_present_jitter() {
+  return context.present_jitter;
+}
+
+/**
+ * \brief Returns the refresh rate of the display showing the window.
+ * \return The refresh rate in Hz, or 0 if unknown.
+ */
+int get_refresh_rate() {
+
+  if (context.main_window == nullptr) {
+    return 0;
+  }
+  SDL_DisplayMode display_mode;
+  if (SDL_GetWindowDisplayMode(context.main_window, &display_mode) != 0) {
+    return 0;
+  }
+  return display_mode.refresh_rate;
+}
+
 /**
  * \brief Returns the main renderer.
  * \return The main renderer, or nullptr if there is no window.
@@ -349,10 +661,13 @@ void hide_window() {
  * \param quest_surface The quest surface to render on the screen.
  */
 void render(const SurfacePtr& quest_surface) {
+  PerfTrace::Scope trace_scope("video-render");
   if (context.pc_render) {
     PerfCounter::update("video-render");
   }
 
+  FrameRecorder::capture(*quest_surface);
+
   if (context.disable_window) {
     return;
   }
@@ -363,40 +678,104 @@ void render(const SurfacePtr& quest_surface) {
   // See if there is a filter to apply.
   SurfacePtr surface_to_render = quest_surface;
   const SoftwarePixelFilter* software_filter = context.video_mode->get_software_filter();
-  if (software_filter != nullptr) {
+  if (software_filter != nullptr &&
+      context.filter_shader == nullptr &&
+      context.current_shader == nullptr) {
     Debug::check_assertion(context.scaled_surface != nullptr,
                            "Missing destination surface for scaling");
     quest_surface->apply_pixel_filter(*software_filter, *context.scaled_surface);
     surface_to_render = context.scaled_surface;
   }
 
-  bool final_draw_with_shader = false;
-
+  // Apply the shader passes: the current shader or the GPU version of the
+  // software filter, then the post-processing effects, each one reading
+  // the result of the previous one.
+  std::vector<const Shader*> passes;
   if (context.current_shader != nullptr) {
-    float scale_factor = context.current_shader->get_data().get_scaling_factor();
-    //See if the shader must be draw to a intermediate surface
-    if(scale_factor > 0.f) {
-      context.current_shader->draw(
-            *context.scaled_surface.get(),
-            *quest_surface,
-            DrawInfos(Rectangle(quest_surface->get_size()),
-                      Point(),
-                      Point(),
-                      BlendMode::BLEND,
-                      255,0,
-                      Scale(scale_factor),
-                      null_proxy /*dont care about this anyway*/));
-      surface_to_render = context.scaled_surface;
-    } else { //Shader can be draw directly
-      final_draw_with_shader = true;
-    }
+    // The shader replaces the software filter.
+    passes.push_back(context.current_shader.get());
+  }
+  else if (context.filter_shader != nullptr) {
+    passes.push_back(context.filter_shader.get());
+  }
+  for (const ShaderPtr& shader : context.post_effects) {
+    passes.push_back(shader.get());
   }
 
-  const DrawProxy& proxy = final_draw_with_shader ?
-        static_cast<const DrawProxy&>(*context.current_shader) :
-        context.renderer->default_terminal();
+  if (context.pass_surfaces.size() > 2 * passes.size()) {
+    // Some scaling factors have changed: forget the targets of old sizes.
+    context.pass_surfaces.clear();
+  }
+
+  const DrawProxy* final_proxy = &context.renderer->default_terminal();
+  bool timed_final_proxy = false;
+  bool timed_pass = false;
+  for (size_t i = 0; i < passes.size(); ++i) {
+    const Shader& shader = *passes[i];
+    float scale_factor = shader.get_data().get_scaling_factor();
+    Size target_size;
+    if (scale_factor <= 0.f && i == passes.size() - 1) {
+      // The last shader draws at the size of the window.
+      // The quest shader gets a dynamic resolution if its bounds allow it.
+      const bool quest_shader = passes[i] == context.current_shader.get();
+      timed_pass = quest_shader &&
+          context.min_shader_resolution < context.max_shader_resolution;
+      if (!quest_shader || context.shader_resolution >= 1.0) {
+        // Draw it directly.
+        final_proxy = &shader;
+        timed_final_proxy = timed_pass;
+        break;
+      }
+      // Draw it at a fraction of the window size, then stretch the result.
+      const Size& output_size = get_output_size_no_bars();
+      target_size = Size(
+          std::max(1, static_cast<int>(output_size.width * context.shader_resolution)),
+          std::max(1, static_cast<int>(output_size.height * context.shader_resolution))
+      );
+    }
+    else {
+      target_size = Video::get_quest_size() * Scale(scale_factor > 0.f ? scale_factor : 1.f);
+    }
+
+    const SurfacePtr& target = get_pass_surface(
+          target_size,
+          surface_to_render
+    );
+    target->clear();
+    const bool timed = timed_pass && i == passes.size() - 1 &&
+        context.renderer->begin_gpu_timer();
+    shader.draw(
+          *target,
+          *surface_to_render,
+          DrawInfos(Rectangle(surface_to_render->get_size()),
+                    Point(),
+                    Point(),
+                    BlendMode::BLEND,
+                    255,0,
+                    target->get_size() / surface_to_render->get_size(),
+                    null_proxy /*dont care about this anyway*/));
+    if (timed) {
+      context.renderer->end_gpu_timer();
+    }
+    surface_to_render = target;
+  }
 
   context.screen_surface->clear();
+
+  // Fast path: an integer scale without shader nor filter is a plain copy.
+  if (passes.empty() && software_filter == nullptr) {
+    const Size& output_size = get_output_size_no_bars();
+    const Size& size = quest_surface->get_size();
+    if (output_size.width % size.width == 0 &&
+        output_size.height % size.height == 0 &&
+        output_size.width / size.width == output_size.height / size.height &&
+        context.renderer->blit_to_window(context.screen_surface->get_impl(), quest_surface->get_impl())) {
+      return;
+    }
+  }
+
+  const bool timed = timed_final_proxy && context.renderer->begin_gpu_timer();
+  const DrawProxy& proxy = *final_proxy;
   proxy.draw(
         *context.screen_surface,
         *surface_to_render,
@@ -408,13 +787,47 @@ void render(const SurfacePtr& quest_surface) {
           255,0,
           get_output_size_no_bars()/surface_to_render->get_size(),
           null_proxy));
+  if (timed) {
+    context.renderer->end_gpu_timer();
+  }
+
+  if (timed_pass) {
+    const double gpu_time = context.renderer->get_gpu_time();
+    if (gpu_time >= 0.0) {
+      update_shader_resolution(gpu_time);
+    }
+  }
 }
 
 /**
  * @brief present the final result to the screen
  */
 void finish() {
+  PerfTrace::Scope trace_scope("video-finish");
   context.renderer->present(context.main_window);
+
+  // Measure the regularity of presents.
+  const uint64_t now = System::get_real_time_us();
+  if (context.last_present_date != 0) {
+    const double interval = (now - context.last_present_date) / 1000.0;
+    if (context.present_interval == 0.0) {
+      context.present_interval = interval;
+    }
+    const double deviation = std::abs(interval - context.present_interval);
+    context.present_interval += (interval - context.present_interval) * 0.05;
+    context.present_jitter += (deviation - context.present_jitter) * 0.05;
+    if (context.pc_render && interval > context.present_interval * 1.5) {
+      PerfCounter::update("video-late-presents");
+    }
+  }
+  context.last_present_date = now;
+
+  if (context.pc_render) {
+    const Renderer::FrameStats& stats = context.renderer->get_last_frame_stats();
+    PerfCounter::update("video-draw-calls", stats.draw_calls);
+    PerfCounter::update("video-buffer-flushes", stats.buffer_flushes);
+    PerfCounter::update("video-sprites", stats.sprites);
+  }
 }
 
 void invalidate(const SurfaceImpl& texture) {
@@ -603,12 +1016,12 @@ const ShaderPtr& get_shader() {
  */
 void set_shader(const ShaderPtr& shader) {
   context.current_shader = shader;
+  context.pass_surfaces.clear();
+  context.shader_resolution = context.max_shader_resolution;
+  context.shader_gpu_time = 0.0;
+  context.frames_since_resolution_change = 0;
 
   if (shader != nullptr) {
-    float s = shader->get_data().get_scaling_factor();
-    if (s > 0.f) { // Create scaled surface if needed
-      context.scaled_surface = Surface::create(Video::get_quest_size() * Scale(s));
-    }
     if (!shader->get_id().empty()) {
       Logger::info("Shader: '" + shader->get_id() + "'");
     }
@@ -621,6 +1034,77 @@ void set_shader(const ShaderPtr& shader) {
   }
 }
 
+/**
+ * \brief Returns the bounds of the render scale of the current shader.
+ * \param[out] min_resolution The lowest render scale.
+ * \param[out] max_resolution The highest render scale.
+ */
+void get_shader_resolution_bounds(double& min_resolution, double& max_resolution) {
+  min_resolution = context.min_shader_resolution;
+  max_resolution = context.max_shader_resolution;
+}
+
+/**
+ * \brief Sets the bounds of the render scale of the current shader.
+ *
+ * This only affects a shader without scaling factor drawn last, that is,
+ * at the size of the window.
+ * When the bounds are different, the shader is drawn into an intermediate
+ * surface whose size is the window size times a render scale adapted to the
+ * GPU time of the shader, then stretched to the window.
+ * The quest surface read by the shader keeps its size.
+ * GPU time is only measured with the OpenGL renderer and timer queries:
+ * otherwise, the render scale stays at its upper bound.
+ *
+ * \param min_resolution The lowest render scale, between 0 and 1.
+ * \param max_resolution The highest render scale, between min_resolution and 1.
+ */
+void set_shader_resolution_bounds(double min_resolution, double max_resolution) {
+
+  Debug::check_assertion(min_resolution > 0.0 && min_resolution <= max_resolution && max_resolution <= 1.0,
+                         "Invalid shader resolution bounds");
+  context.min_shader_resolution = min_resolution;
+  context.max_shader_resolution = max_resolution;
+  context.shader_resolution = max_resolution;
+  context.shader_gpu_time = 0.0;
+  context.frames_since_resolution_change = 0;
+}
+
+/**
+ * \brief Returns the current render scale of the current shader.
+ * \return The render scale, 1 meaning the size of the window.
+ */
+double get_shader_resolution() {
+  return context.shader_resolution;
+}
+
+/**
+ * \brief Returns the post-processing effects applied after the current shader.
+ * \return The shaders, in the order they are applied.
+ */
+const std::vector<ShaderPtr>& get_post_effects() {
+  return context.post_effects;
+}
+
+/**
+ * \brief Sets the post-processing effects applied after the current shader.
+ *
+ * Each shader is a pass that reads the result of the previous one.
+ * Its scaling factor gives the size of its output relative to the quest
+ * size. Intermediate targets are shared between passes of the same size.
+ *
+ * \param shaders The shaders to apply in order, possibly empty.
+ */
+void set_post_effects(const std::vector<ShaderPtr>& shaders) {
+
+  for (const ShaderPtr& shader : shaders) {
+    Debug::check_assertion(shader != nullptr, "Missing post-processing shader");
+  }
+  context.post_effects = shaders;
+  context.pass_surfaces.clear();
+  Logger::info("Post-processing effects: " + std::to_string(shaders.size()));
+}
+
 /**
  * \brief Returns the current text of the window title bar.
  * \return The window title.
@@ -736,6 +1220,7 @@ bool set_video_mode(const SoftwareVideoMode& mode) {
   if (!context.disable_window) {
 
     context.scaled_surface = nullptr;
+    context.filter_shader = nullptr;
 
     Size render_size = context.geometry.quest_size;
 
@@ -743,8 +1228,11 @@ bool set_video_mode(const SoftwareVideoMode& mode) {
     if (software_filter != nullptr) {
       int factor = software_filter->get_scaling_factor();
       render_size = context.geometry.quest_size * factor;
-      context.scaled_surface = Surface::create(render_size);
-      context.scaled_surface->fill_with_color(Color::black);  // To initialize the internal surface.
+      context.filter_shader = create_filter_shader(*software_filter);
+      if (context.filter_shader == nullptr) {
+        context.scaled_surface = Surface::create(render_size);
+        context.scaled_surface->fill_with_color(Color::black);  // To initialize the internal surface.
+      }
     }
 
     if (mode_changed) {
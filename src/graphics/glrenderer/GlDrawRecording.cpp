@@ -0,0 +1,125 @@
+#include "solarus/graphics/glrenderer/GlDrawRecording.h"
+#include "solarus/graphics/glrenderer/GlRenderer.h"
+#include "solarus/graphics/glrenderer/GlShader.h"
+#include "solarus/graphics/glrenderer/GlTexture.h"
+#include "solarus/graphics/DrawProxies.h"
+#include "solarus/graphics/Surface.h"
+
+#include <cstring>
+
+namespace Solarus {
+
+/**
+ * @brief Creates an empty recording
+ * @param target the destination of the recorded draws
+ */
+GlDrawRecording::GlDrawRecording(GlTexture& target) :
+  target(target) {
+}
+
+/**
+ * @brief get the destination of the recorded draws
+ * @return the target texture
+ */
+GlTexture& GlDrawRecording::get_target() const {
+  return target;
+}
+
+/**
+ * @brief record a sprite instead of adding it to the batch
+ *
+ * The vertices are the same as GlRenderer::draw() would write.
+ *
+ * @param src the texture to draw
+ * @param shader the shader to use
+ * @param infos the draw parameters
+ */
+void GlDrawRecording::add_sprite(const GlTexture& src, GlShader& shader, const DrawInfos& infos) {
+  GlRenderer& renderer = GlRenderer::get();
+  const GlTexture* texture = &src;
+  const bool default_shader = &shader == &renderer.main_shader->as<GlShader>();
+  if(src.is_packed() && default_shader && !src.contains_region(infos.region)) {
+    //A wrapping region would sample the neighbouring images of the page
+    src.unpack();
+  }
+  const bool packed = src.is_packed() && default_shader;
+  if(packed) {
+    texture = &src.get_atlas_page();
+  }
+  const GlRenderer::GLBlendMode blend_mode = renderer.make_gl_blend_modes(target,&src,infos.blend_mode);
+  if(runs.empty() ||
+     runs.back().texture != texture ||
+     runs.back().shader != &shader ||
+     runs.back().blend_mode != blend_mode) {
+    runs.push_back(Run{texture,&shader,blend_mode,0});
+  }
+  if(sources.empty() || sources.back().texture != &src) {
+    sources.push_back(Source{&src,src.is_packed()});
+  }
+
+  vertices.resize(vertices.size() + 4);
+  Vertex* quad = &vertices[vertices.size() - 4];
+  if(packed) {
+    const Rectangle region(infos.region.get_xy() + src.get_atlas_position(), infos.region.get_size());
+    renderer.write_sprite(quad,DrawInfos(infos, region, infos.dst_position));
+  } else {
+    renderer.write_sprite(quad,infos);
+  }
+  runs.back().num_quads++;
+}
+
+/**
+ * @brief tell that something else than a sprite was drawn on the target
+ *
+ * The recording then cannot reproduce the result and is never drawn.
+ */
+void GlDrawRecording::set_incomplete() {
+  complete = false;
+}
+
+/**
+ * @copydoc DrawRecording::draw
+ *
+ * The recording is outdated if a texture drawn left the atlas since.
+ */
+bool GlDrawRecording::draw(Surface& dst_surface, const Point& offset) {
+  if(!complete || &dst_surface.get_impl().as<GlTexture>() != &target) {
+    return false;
+  }
+  for(const Source& source : sources) {
+    if(source.texture->is_packed() != source.packed) {
+      return false;
+    }
+  }
+
+  GlRenderer& renderer = GlRenderer::get();
+  const glm::vec2 translation(offset.x, offset.y);
+  const bool translated = offset.x != 0 || offset.y != 0;
+  const Vertex* vertex = vertices.data();
+  for(const Run& run : runs) {
+    if(renderer.set_state(run.texture,run.shader,&target,run.blend_mode)) {
+      glUniform1i(run.shader->get_builtin_locations().vcolor_only,false);
+    }
+    size_t remaining = run.num_quads;
+    while(remaining > 0) {
+      //Copy as many quads as the ring can take before a flush
+      const size_t num_quads = renderer.reserve_sprites(remaining);
+      std::memcpy(renderer.current_vertex, vertex, num_quads*4*sizeof(Vertex));
+      if(translated) {
+        for(size_t i = 0; i < num_quads*4; ++i) {
+          renderer.current_vertex[i].position += translation;
+        }
+      }
+      renderer.current_vertex += num_quads*4;
+      renderer.buffered_sprites += num_quads;
+      vertex += num_quads*4;
+      remaining -= num_quads;
+    }
+  }
+  if(!renderer.test_texture && !runs.empty()) {
+    renderer.test_texture = &target;
+  }
+  return true;
+}
+
+}
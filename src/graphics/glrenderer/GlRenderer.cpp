@@ -1,28 +1,183 @@
 #include <solarus/graphics/glrenderer/GlRenderer.h>
 #include <solarus/graphics/glrenderer/GlTexture.h>
+#include <solarus/graphics/glrenderer/GlTextureAtlas.h>
 #include <solarus/graphics/glrenderer/GlShader.h>
+#include <solarus/graphics/glrenderer/GlTileMesh.h>
+#include <solarus/graphics/glrenderer/GlDrawRecording.h>
 #include <solarus/graphics/Video.h>
 #include <solarus/graphics/Surface.h>
 #include <solarus/core/Debug.h>
 #include <solarus/core/Logger.h>
 #include <solarus/graphics/Shader.h>
 #include <solarus/graphics/DefaultShaders.h>
+#include <solarus/graphics/FrameDamage.h>
 #include <solarus/core/System.h>
 
 #include <glm/gtx/matrix_transform_2d.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
-
-
-#define SOLARUS_SPRITE_BUFFER_SIZE 64
+#include <string>
 
 namespace Solarus {
 
 using namespace glm;
 
 GlRenderer* GlRenderer::instance = nullptr;
+size_t GlRenderer::sprite_batch_size = GlRenderer::default_sprite_batch_size;
+bool GlRenderer::texture_atlas_enabled = true;
+bool GlRenderer::image_copies_kept = true;
+bool GlRenderer::sprite_instancing_enabled = true;
+int GlRenderer::swap_interval = 1;
+constexpr size_t GlRenderer::default_sprite_batch_size;
+constexpr size_t GlRenderer::max_sprite_batch_size;
+constexpr int GlRenderer::atlas_page_size;
+constexpr int GlRenderer::atlas_max_image_size;
+constexpr size_t GlRenderer::num_sections;
+
+namespace {
+
+#ifndef SOLARUS_GL_ES
+#define SOLARUS_GL_APIENTRYP APIENTRYP
+#else
+#define SOLARUS_GL_APIENTRYP GL_APIENTRYP
+#endif
+
+// Entry points of ARB_sync and of the buffer mappings of OpenGL ES 3.0,
+// which are not part of the functions loaded by glad or declared by
+// OpenGL ES 2 headers.
+typedef GLsync (SOLARUS_GL_APIENTRYP PFN_FENCE_SYNC)(GLenum condition, GLbitfield flags);
+typedef GLenum (SOLARUS_GL_APIENTRYP PFN_CLIENT_WAIT_SYNC)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (SOLARUS_GL_APIENTRYP PFN_DELETE_SYNC)(GLsync sync);
+typedef void* (SOLARUS_GL_APIENTRYP PFN_MAP_BUFFER_RANGE)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (SOLARUS_GL_APIENTRYP PFN_UNMAP_BUFFER)(GLenum target);
+
+PFN_FENCE_SYNC fence_sync = nullptr;
+PFN_CLIENT_WAIT_SYNC client_wait_sync = nullptr;
+PFN_DELETE_SYNC delete_sync = nullptr;
+PFN_MAP_BUFFER_RANGE map_buffer_range = nullptr;
+PFN_UNMAP_BUFFER unmap_buffer = nullptr;
+
+constexpr GLbitfield MAP_WRITE_BIT = 0x0002;
+constexpr GLbitfield MAP_INVALIDATE_RANGE_BIT = 0x0004;
+constexpr GLbitfield MAP_UNSYNCHRONIZED_BIT = 0x0020;
+constexpr GLenum SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+constexpr GLbitfield SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+constexpr GLenum TIMEOUT_EXPIRED = 0x911B;
+constexpr GLenum WAIT_FAILED = 0x911D;
+constexpr GLuint64 sync_timeout_ns = 1000000;
+
+}
+
+#ifndef SOLARUS_GL_ES
+namespace {
+
+// Entry point of ARB_buffer_storage, which is not part of the functions
+// loaded by glad.
+typedef void (APIENTRYP PFN_BUFFER_STORAGE)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+PFN_BUFFER_STORAGE buffer_storage = nullptr;
+
+constexpr GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+constexpr GLbitfield MAP_COHERENT_BIT = 0x0080;
+constexpr GLenum ALREADY_SIGNALED = 0x911A;
+constexpr GLenum CONDITION_SATISFIED = 0x911C;
+constexpr GLenum TIME_ELAPSED = 0x88BF;
+
+}
+#endif
+
+namespace {
+
+// Compressed formats, from EXT_texture_compression_s3tc,
+// ARB_texture_compression_bptc, ARB_ES3_compatibility and
+// KHR_texture_compression_astc_ldr.
+constexpr GLenum COMPRESSED_RGBA_S3TC_DXT1 = 0x83F1;
+constexpr GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+constexpr GLenum COMPRESSED_RGBA_BPTC_UNORM = 0x8E8C;
+constexpr GLenum COMPRESSED_RGBA8_ETC2_EAC = 0x9278;
+constexpr GLenum COMPRESSED_RGBA_ASTC_4x4 = 0x93B0;
+
+// Instanced drawing (OpenGL 3.3 and OpenGL ES 3.0), loaded at run time
+// because OpenGL ES 2 headers do not declare it.
+typedef void (SOLARUS_GL_APIENTRYP PFN_DRAW_ARRAYS_INSTANCED)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef void (SOLARUS_GL_APIENTRYP PFN_VERTEX_ATTRIB_DIVISOR)(GLuint index, GLuint divisor);
+
+#undef SOLARUS_GL_APIENTRYP
+
+PFN_DRAW_ARRAYS_INSTANCED draw_arrays_instanced = nullptr;
+PFN_VERTEX_ATTRIB_DIVISOR vertex_attrib_divisor = nullptr;
+
+/**
+ * @brief get the vertex source of the sprite shader
+ *
+ * Each instance is a sprite: the six vertices of its two triangles are
+ * computed from gl_VertexID, exactly like GlRenderer::write_sprite() does.
+ *
+ * @return the vertex source
+ */
+const std::string& get_instanced_vertex_source() {
+
+  static const std::string source = DefaultShaders::get_default_vertex_compat_header() +
+R"(
+uniform mat4 sol_mvp_matrix;
+uniform mat3 sol_uv_matrix;
+COMPAT_ATTRIBUTE vec2 sol_instance_position;
+COMPAT_ATTRIBUTE vec2 sol_instance_corner;
+COMPAT_ATTRIBUTE vec2 sol_instance_extent;
+COMPAT_ATTRIBUTE vec4 sol_instance_region;
+COMPAT_ATTRIBUTE float sol_instance_rotation;
+COMPAT_ATTRIBUTE vec4 sol_instance_color;
+COMPAT_VARYING vec2 sol_vtex_coord;
+COMPAT_VARYING vec4 sol_vcolor;
+
+// Corners of the two triangles, in the order of the sprite ring indices.
+const vec2 corners[6] = vec2[6](
+    vec2(0.0, 0.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0));
+
+void main() {
+    vec2 corner = corners[gl_VertexID];
+    float c = cos(sol_instance_rotation);
+    float s = sin(sol_instance_rotation);
+    vec2 offset = mat2(c, -s, s, c) * (sol_instance_corner + sol_instance_extent * corner);
+    gl_Position = sol_mvp_matrix * vec4(sol_instance_position + offset, 0.0, 1.0);
+    sol_vcolor = sol_instance_color;
+    vec2 tex_coord = sol_instance_region.xy + sol_instance_region.zw * corner;
+    sol_vtex_coord = (sol_uv_matrix * vec3(tex_coord, 1.0)).xy;
+}
+)";
+  return source;
+}
+
+/**
+ * @brief GL internal format of a KTX2 format
+ * @param format a format of KTX2 files
+ * @return the GL format, or 0 if there is no equivalent
+ */
+GLenum get_gl_compressed_format(KtxImage::Format format) {
+  switch(format) {
+  case KtxImage::FORMAT_BC1_RGBA:
+    return COMPRESSED_RGBA_S3TC_DXT1;
+  case KtxImage::FORMAT_BC3:
+    return COMPRESSED_RGBA_S3TC_DXT5;
+  case KtxImage::FORMAT_BC7:
+    return COMPRESSED_RGBA_BPTC_UNORM;
+  case KtxImage::FORMAT_ETC2_RGBA:
+    return COMPRESSED_RGBA8_ETC2_EAC;
+  case KtxImage::FORMAT_ASTC_4x4:
+    return COMPRESSED_RGBA_ASTC_4x4;
+  case KtxImage::FORMAT_UNDEFINED:
+    break;
+  }
+  return 0;
+}
+
+}
 
 
 /**
@@ -96,18 +251,44 @@ GlRenderer::GlRenderer(SDL_GLContext sdl_ctx) :
   Debug::check_assertion(!instance,"Creating two GL renderer");
   instance = this; //Set this renderer as the unique instance
 
-
-  create_vbo(SOLARUS_SPRITE_BUFFER_SIZE); //TODO check sprite buffer size
-
   std::string version((const char *)glGetString(GL_VERSION));
   is_es_context = version.find("OpenGL ES") != std::string::npos;
 
+  section_fences.fill(nullptr);
+  instance_locations.fill(-1);
+  create_vbo(sprite_batch_size);
+  async_reads = init_async_reads();
+  unpack_row_length = !is_es_context || Gl::getVersion().first >= 3;
+  window_blits = init_window_blits();
+  gpu_timers_supported = init_gpu_timers();
+  premultiplied_alpha = Video::is_premultiplied_alpha();
+  init_compressed_formats();
+
   //Create main shader
   main_shader = create_shader(DefaultShaders::get_default_vertex_source(),
                               DefaultShaders::get_default_fragment_source(),
                               0.0);
 
   Debug::check_assertion(static_cast<bool>(main_shader),"Failed to compile glRenderer main shader");
+
+  if(init_instancing()) {
+    sprite_shader = create_shader(get_instanced_vertex_source(),
+                                  DefaultShaders::get_default_fragment_source(),
+                                  0.0);
+    if(sprite_shader->is_valid()) {
+      create_instance_buffer();
+    } else {
+      Debug::warning("Failed to compile the instanced sprite shader");
+      sprite_shader.reset();
+    }
+  }
+
+  if(texture_atlas_enabled) {
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    const int page_size = std::min(atlas_page_size, static_cast<int>(max_texture_size));
+    atlas.reset(new GlTextureAtlas(page_size, std::min(atlas_max_image_size, page_size / 2)));
+  }
 }
 
 RendererPtr GlRenderer::create(SDL_Window* window, bool force_software) {
@@ -134,7 +315,7 @@ RendererPtr GlRenderer::create(SDL_Window* window, bool force_software) {
     }
   }
 
-  SDL_GL_SetSwapInterval(1);
+  apply_swap_interval();
   //Contex created, populate ctx
 
   if(not Gl::load()) {
@@ -185,6 +366,30 @@ SurfaceImplPtr GlRenderer::create_texture(SDL_Surface_UniquePtr&& surface) {
   return SurfaceImplPtr(new GlTexture(std::move(surface)));
 }
 
+/**
+ * \copydoc Renderer::create_packed_texture
+ */
+SurfaceImplPtr GlRenderer::create_packed_texture(SDL_Surface_UniquePtr&& surface) {
+  if(atlas) {
+    SurfaceImplPtr packed = atlas->pack(std::move(surface));
+    if(packed) {
+      return packed;
+    }
+  }
+  return create_texture(std::move(surface));
+}
+
+/**
+ * \copydoc Renderer::create_compressed_texture
+ */
+SurfaceImplPtr GlRenderer::create_compressed_texture(const KtxImage& image) {
+  const GLenum internal_format = get_compressed_format(image.get_format());
+  if(internal_format == 0) {
+    return nullptr;
+  }
+  return SurfaceImplPtr(new GlTexture(image,internal_format));
+}
+
 SurfaceImplPtr GlRenderer::create_window_surface(SDL_Window* /*w*/, int width, int height) {
   return SurfaceImplPtr(new GlTexture(width,height,true));
 }
@@ -197,6 +402,43 @@ ShaderPtr GlRenderer::create_shader(const std::string& vertex_source, const std:
   return std::make_shared<GlShader>(vertex_source, fragment_source, scaling_factor);
 }
 
+/**
+ * @brief create a tile mesh drawn with the tile shader
+ * @param image the image of the tiles
+ * @param quads the tiles
+ * @return the mesh, or nullptr if the tile shader could not be compiled
+ */
+TileMeshPtr GlRenderer::create_tile_mesh(const SurfacePtr& image, const std::vector<TileMesh::Quad>& quads) {
+  if(!tile_shader) {
+    tile_shader = create_shader(GlTileMesh::get_vertex_source(),
+                                GlTileMesh::get_fragment_source(),
+                                0.0);
+  }
+  if(!tile_shader->is_valid()) {
+    return nullptr;
+  }
+  return TileMeshPtr(new GlTileMesh(image, quads));
+}
+
+/**
+ * @brief start recording the sprites drawn on a surface
+ * @param dst the destination surface
+ * @return the recording
+ */
+DrawRecordingPtr GlRenderer::begin_recording(SurfaceImpl& dst) {
+  Debug::check_assertion(recording == nullptr, "A recording is already in progress");
+  GlDrawRecording* new_recording = new GlDrawRecording(dst.as<GlTexture>());
+  recording = new_recording;
+  return DrawRecordingPtr(new_recording);
+}
+
+/**
+ * @brief stop the recording in progress
+ */
+void GlRenderer::end_recording() {
+  recording = nullptr;
+}
+
 void GlRenderer::set_render_target(GlTexture* target) {
   if(target != current_target) {
     auto* fbo = target->targetable().fbo;
@@ -241,17 +483,39 @@ void GlRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos&
 void GlRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos, GlShader& shader) {
   const GlTexture& glsrc = src.as<GlTexture>();
   GlTexture& gldst = dst.as<GlTexture>();
-  set_state(&glsrc,&shader,&gldst,make_gl_blend_modes(gldst,&glsrc,infos.blend_mode));
-  glUniform1i(shader.get_uniform_location(VCOLOR_ONLY_NAME),false);
+  if(recording && &gldst == &recording->get_target()) {
+    recording->add_sprite(glsrc,shader,infos);
+    return;
+  }
+  const bool default_shader = &shader == &main_shader->as<GlShader>();
+  GlShader& batch_shader = default_shader ? get_sprite_shader() : shader;
+  if(glsrc.is_packed() && default_shader && !glsrc.contains_region(infos.region)) {
+    //A wrapping region would sample the neighbouring images of the page
+    glsrc.unpack();
+  }
+  if(glsrc.is_packed() && default_shader) {
+    //Draw from the atlas page so that images sharing it share the batch
+    const Rectangle region(infos.region.get_xy() + glsrc.get_atlas_position(), infos.region.get_size());
+    if(set_state(&glsrc.get_atlas_page(),&batch_shader,&gldst,make_gl_blend_modes(gldst,&glsrc,infos.blend_mode))) {
+      glUniform1i(batch_shader.get_builtin_locations().vcolor_only,false);
+    }
+    add_sprite(DrawInfos(infos, region, infos.dst_position));
+    return;
+  }
+  if(set_state(&glsrc,&batch_shader,&gldst,make_gl_blend_modes(gldst,&glsrc,infos.blend_mode))) {
+    glUniform1i(batch_shader.get_builtin_locations().vcolor_only,false);
+  }
   add_sprite(infos);
 }
 
 void GlRenderer::clear(SurfaceImpl& dst) {
   GlTexture* t = &dst.as<GlTexture>();
+  if(recording && t == &recording->get_target()) {
+    recording->set_incomplete();
+  }
   if(t == current_target) {
-    buffered_sprites = 0; //Trash pending batch, after all we'll clear
+    discard_batch(); //Trash pending batch, after all we'll clear
     glClear(GL_COLOR_BUFFER_BIT);
-    restart_batch();
   } else {
     //Switch to target
     set_state(current_texture,current_shader,t,current_blend_mode);
@@ -280,6 +544,20 @@ void GlRenderer::read_pixels(GlTexture* from, void* to) {
  * @param data pixel data (RGBA unsigned bytes)
  */
 void GlRenderer::put_pixels(GlTexture* to, void* data) {
+  put_pixels(to,data,to->get_width()*4,Rectangle(0,0,to->get_width(),to->get_height()));
+}
+
+/**
+ * @brief put a region of pixels into the given texture
+ *
+ * Without GL_UNPACK_ROW_LENGTH (OpenGL ES 2), whole rows are uploaded.
+ *
+ * @param to texture to upload pixel to
+ * @param data pixel data of the whole texture (RGBA unsigned bytes)
+ * @param pitch size of a row of \p data in bytes
+ * @param region region of the texture to upload
+ */
+void GlRenderer::put_pixels(GlTexture* to, const void* data, int pitch, const Rectangle& region) {
   if(current_target == to) {
     //Texture is attached, detach
     restart_batch(); //draw everything
@@ -287,37 +565,103 @@ void GlRenderer::put_pixels(GlTexture* to, void* data) {
     current_target = nullptr; //Set target as invalid
   }
   glBindTexture(GL_TEXTURE_2D,to->get_texture());
-  glTexSubImage2D(GL_TEXTURE_2D,
-                  0,
-                  0,0,
-                  to->get_width(),to->get_height(),
-                  GL_RGBA,GL_UNSIGNED_BYTE,
-                  data);
+  const uint8_t* rows = static_cast<const uint8_t*>(data) + region.get_y()*pitch;
+  if(unpack_row_length) {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH,pitch/4);
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    region.get_x(),region.get_y(),
+                    region.get_width(),region.get_height(),
+                    GL_RGBA,GL_UNSIGNED_BYTE,
+                    rows + region.get_x()*4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH,0);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    0,region.get_y(),
+                    to->get_width(),region.get_height(),
+                    GL_RGBA,GL_UNSIGNED_BYTE,
+                    rows);
+  }
+  frame_stats.texture_uploads++;
   GlRenderer::get().rebind_texture();
 }
 
 void GlRenderer::fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode) {
-  GlShader& ms = main_shader->as<GlShader>();
-  set_state(nullptr,&ms,&dst.as<GlTexture>(),make_gl_blend_modes(mode));
-  glUniform1i(ms.get_uniform_location(VCOLOR_ONLY_NAME),true); //Set color only as uniform
+  //Stretch a white texel tinted with the color, so that fills go in the
+  //same batch as the sprites around them
+  GlShader& ms = get_sprite_shader();
+  GlTexture& gldst = dst.as<GlTexture>();
+  if(recording && &gldst == &recording->get_target()) {
+    recording->set_incomplete();
+  }
+  const GlTexture& white = get_white_texture();
+  if(set_state(&white,&ms,&gldst,make_gl_blend_modes(gldst,&white,mode))) {
+    glUniform1i(ms.get_builtin_locations().vcolor_only,false);
+  }
   add_sprite(DrawInfos(
-               where,
+               GlTextureAtlas::get_white_texel(),
                where.get_top_left(),
                Point(),
                mode,
                255,
                0.0,
-               Scale(),
+               Scale(where.get_width(),where.get_height()),
                color,
                null_proxy
                ));
 }
 
+void GlRenderer::draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode) {
+  GlShader& ms = main_shader->as<GlShader>();
+  GlTexture& gldst = dst.as<GlTexture>();
+  if(recording && &gldst == &recording->get_target()) {
+    recording->set_incomplete();
+  }
+  const GlTexture& white = get_white_texture();
+  if(set_state(&white,&ms,&gldst,make_gl_blend_modes(gldst,&white,mode))) {
+    glUniform1i(ms.get_builtin_locations().vcolor_only,false);
+  }
+  add_line(from,to,color,mode);
+}
+
+/**
+ * @brief get a texture to draw untextured quads from
+ *
+ * This is the texture of the current batch if it is an atlas page, and
+ * otherwise a small texture of the renderer. Either way, the region
+ * GlTextureAtlas::get_white_texel() of the texture is opaque white.
+ *
+ * @return the texture
+ */
+const GlTexture& GlRenderer::get_white_texture() {
+  if(current_texture && current_texture->is_atlas_page()) {
+    return *current_texture;
+  }
+  if(!white_texture) {
+    SDL_PixelFormat* format = Video::get_pixel_format();
+    SDL_Surface_UniquePtr surface(SDL_CreateRGBSurface(
+          0,
+          GlTextureAtlas::white_size,
+          GlTextureAtlas::white_size,
+          32,
+          format->Rmask,
+          format->Gmask,
+          format->Bmask,
+          format->Amask));
+    Debug::check_assertion(surface != nullptr,
+                           std::string("Failed to create white surface ") + SDL_GetError());
+    SDL_FillRect(surface.get(),nullptr,0xFFFFFFFF);
+    white_texture = std::make_shared<GlTexture>(std::move(surface));
+  }
+  return white_texture->as<GlTexture>();
+}
+
 void GlRenderer::invalidate(const SurfaceImpl& surf) {
   const GlTexture* tex = &surf.as<GlTexture>();
 
   if(tex == current_target) { //current target goes down, ignore last write
-    buffered_sprites = 0; //Trash pending batch, after all dst is destroyed
+    discard_batch(); //Trash pending batch, after all dst is destroyed
     current_target = nullptr;
   }
 
@@ -326,7 +670,11 @@ void GlRenderer::invalidate(const SurfaceImpl& surf) {
     current_texture = nullptr;
   }
 
-  tex->release(); // actually free texture memory
+  if(tex->target) {
+    recycle_target_texture(*tex); // keep the texture memory for the next target of this size
+  } else {
+    tex->release(); // actually free texture memory
+  }
 }
 
 std::string GlRenderer::get_name() const {
@@ -336,6 +684,206 @@ std::string GlRenderer::get_name() const {
 void GlRenderer::present(SDL_Window* window) {
   restart_batch(); //Draw last batch that could be 'stuck'
   SDL_GL_SwapWindow(window);
+  last_frame_stats = frame_stats;
+  frame_stats = FrameStats();
+  ++frame_number;
+  reclaim_target_textures();
+}
+
+/**
+ * @brief get the draw calls and buffer flushes of the last presented frame
+ * @return the statistics
+ */
+Renderer::FrameStats GlRenderer::get_last_frame_stats() const {
+  return last_frame_stats;
+}
+
+/**
+ * @copydoc Renderer::begin_gpu_timer
+ *
+ * Queries are used in turn, so that reading the result of one never waits
+ * for the GPU.
+ */
+bool GlRenderer::begin_gpu_timer() {
+#ifdef SOLARUS_GL_ES
+  return false;
+#else
+  if(!gpu_timers_supported || gpu_timer_running) {
+    return false;
+  }
+  collect_gpu_timers();
+  if(pending_gpu_timers == num_gpu_timers) {
+    // The GPU is late: skip this measurement.
+    return false;
+  }
+  restart_batch();  // Sprites already buffered are not part of the measurement.
+  glBeginQuery(TIME_ELAPSED, gpu_timers[next_gpu_timer]);
+  gpu_timer_running = true;
+  return true;
+#endif
+}
+
+/**
+ * @copydoc Renderer::end_gpu_timer
+ */
+void GlRenderer::end_gpu_timer() {
+#ifndef SOLARUS_GL_ES
+  if(!gpu_timer_running) {
+    return;
+  }
+  restart_batch();  // Submit the sprites to measure.
+  glEndQuery(TIME_ELAPSED);
+  next_gpu_timer = (next_gpu_timer + 1) % num_gpu_timers;
+  ++pending_gpu_timers;
+  gpu_timer_running = false;
+#endif
+}
+
+/**
+ * @copydoc Renderer::get_gpu_time
+ */
+double GlRenderer::get_gpu_time() const {
+  return gpu_time;
+}
+
+#ifndef SOLARUS_GL_ES
+/**
+ * @brief read the results of the time elapsed queries that are finished
+ */
+void GlRenderer::collect_gpu_timers() {
+  while(pending_gpu_timers > 0) {
+    const size_t index = (next_gpu_timer + num_gpu_timers - pending_gpu_timers) % num_gpu_timers;
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(gpu_timers[index], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available) {
+      return;
+    }
+    GLuint elapsed_ns = 0;
+    glGetQueryObjectuiv(gpu_timers[index], GL_QUERY_RESULT, &elapsed_ns);
+    gpu_time = elapsed_ns / 1000000.0;
+    --pending_gpu_timers;
+  }
+}
+#endif
+
+/**
+ * @brief Set the number of sprites of the ring buffer
+ *
+ * Only affects renderers created after the call. The value is clamped to
+ * what 16-bit indices can address.
+ *
+ * @param num_sprites number of sprites, at least one per section
+ */
+void GlRenderer::set_sprite_batch_size(size_t num_sprites) {
+  sprite_batch_size = std::max(num_sections, std::min(num_sprites, max_sprite_batch_size));
+}
+
+/**
+ * @brief get the number of sprites of the ring buffer of the next renderer
+ * @return the number of sprites
+ */
+size_t GlRenderer::get_sprite_batch_size() {
+  return sprite_batch_size;
+}
+
+/**
+ * @brief Set whether images loaded from files are packed in a texture atlas
+ *
+ * Only affects renderers created after the call.
+ *
+ * @param enabled true to pack images
+ */
+void GlRenderer::set_texture_atlas_enabled(bool enabled) {
+  texture_atlas_enabled = enabled;
+}
+
+/**
+ * @brief Returns whether the next renderer packs images in a texture atlas
+ * @return true if images are packed
+ */
+bool GlRenderer::is_texture_atlas_enabled() {
+  return texture_atlas_enabled;
+}
+
+/**
+ * @brief Set whether sprites of the default shader are drawn with instancing
+ *
+ * Only affects renderers created after the call. Instancing is used only
+ * if the context supports it.
+ *
+ * @param enabled true to draw sprites with instancing
+ */
+void GlRenderer::set_sprite_instancing_enabled(bool enabled) {
+  sprite_instancing_enabled = enabled;
+}
+
+/**
+ * @brief Returns whether the next renderer draws sprites with instancing
+ * when the context supports it
+ * @return true if instancing is enabled
+ */
+bool GlRenderer::is_sprite_instancing_enabled() {
+  return sprite_instancing_enabled;
+}
+
+/**
+ * @brief Set whether images loaded from files keep a software copy of
+ * their pixels
+ *
+ * Without copies, the pixels of images loaded from files are only stored
+ * in video memory once uploaded. The file is decoded again the first time
+ * the pixels are read or modified, for example by pixel-precise collisions
+ * or by surface:get_pixels() and surface:set_pixels().
+ *
+ * @param kept false to free the copies after upload
+ */
+void GlRenderer::set_image_copies_kept(bool kept) {
+  image_copies_kept = kept;
+}
+
+/**
+ * @brief Returns whether images loaded from files keep a software copy of
+ * their pixels
+ * @return true if the copies are kept
+ */
+bool GlRenderer::are_image_copies_kept() {
+  return image_copies_kept;
+}
+
+/**
+ * @brief Sets how the next renderer synchronizes presenting with the display
+ *
+ * With 0, presenting never waits for the display and frames may tear.
+ * With -1 (adaptive vsync), frames are synchronized, but a late frame is
+ * presented immediately instead of stalling the simulation until the next
+ * refresh.
+ *
+ * @param swap_interval 1 for vsync, 0 for no vsync, -1 for adaptive vsync
+ */
+void GlRenderer::set_swap_interval(int swap_interval) {
+  GlRenderer::swap_interval = std::max(-1, std::min(swap_interval, 1));
+  if(instance) {
+    apply_swap_interval();
+  }
+}
+
+/**
+ * @brief Returns how the next renderer synchronizes presenting with the display
+ * @return 1 for vsync, 0 for no vsync, -1 for adaptive vsync
+ */
+int GlRenderer::get_swap_interval() {
+  return swap_interval;
+}
+
+/**
+ * @brief Sets the swap interval of the current OpenGL context
+ */
+void GlRenderer::apply_swap_interval() {
+  if(SDL_GL_SetSwapInterval(swap_interval) != 0 && swap_interval < 0) {
+    // Adaptive vsync is not supported: fall back to normal vsync.
+    Logger::info("Adaptive vsync not supported, using vsync");
+    SDL_GL_SetSwapInterval(1);
+  }
 }
 
 void GlRenderer::on_window_size_changed(const Rectangle& viewport) {
@@ -347,11 +895,72 @@ void GlRenderer::on_window_size_changed(const Rectangle& viewport) {
   }
 }
 
+/**
+ * @copydoc Renderer::blit_to_window
+ *
+ * Uses glBlitFramebuffer from the framebuffer of the render target to
+ * the default one, which skips a full-window draw and a shader bind.
+ */
+bool GlRenderer::blit_to_window(SurfaceImpl& window, const SurfaceImpl& src) {
+  GlTexture& glwindow = window.as<GlTexture>();
+  GlTexture& glsrc = const_cast<GlTexture&>(src.as<GlTexture>());
+  if(!window_blits || !glsrc.target || glwindow.fbo != &screen_fbo) {
+    return false;
+  }
+
+  //Draw what is pending, then attach the source to its framebuffer
+  restart_batch();
+  set_render_target(&glsrc);
+
+  //Render targets have their top row first, the window its bottom row
+  const int left = window_viewport.get_left();
+  const int bottom = window_viewport.get_top();
+  glBindFramebuffer(GL_READ_FRAMEBUFFER,glsrc.fbo->id);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER,screen_fbo.id);
+  glBlitFramebuffer(0,0,glsrc.get_width(),glsrc.get_height(),
+                    left,bottom + window_viewport.get_height(),
+                    left + window_viewport.get_width(),bottom,
+                    GL_COLOR_BUFFER_BIT,GL_NEAREST);
+  frame_stats.draw_calls++;
+
+  //Both framebuffers were rebound: make the window the current target
+  current_target = nullptr;
+  set_render_target(&glwindow);
+  return true;
+}
+
 const DrawProxy& GlRenderer::default_terminal() const {
   return static_cast<const DrawProxy&>(*main_shader.get());
 }
 
 GlRenderer::~GlRenderer() {
+  cancel_pixel_reads();
+  for(GLsync& fence : section_fences) {
+    if(fence) {
+      delete_sync(fence);
+      fence = nullptr;
+    }
+  }
+#ifndef SOLARUS_GL_ES
+  if(gpu_timers_supported) {
+    glDeleteQueries(num_gpu_timers, gpu_timers.data());
+  }
+  if(mapped_vertices) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    mapped_vertices = nullptr;
+  }
+#endif
+  for(const auto& kvp : target_pool) {
+    for(const PooledTarget& pooled : kvp.second) {
+      glDeleteTextures(1,&pooled.id);
+    }
+  }
+  target_pool.clear();
+  white_texture.reset();
+  if(instance_vbo) {
+    glDeleteBuffers(1,&instance_vbo);
+  }
   if(Gl::use_vao()) {
     Gl::DeleteVertexArrays(1,&vao); //TODO delete rest
   }
@@ -368,7 +977,7 @@ GlRenderer::~GlRenderer() {
  */
 GlRenderer::Fbo* GlRenderer::get_fbo(int width, int height, bool screen) {
   if(screen) return &screen_fbo;
-  uint_fast64_t key =  (static_cast<uint_fast64_t>(width) << 32) | static_cast<uint_fast64_t>(height);
+  uint_fast64_t key = get_size_key(width,height);
   int rw = key >> 32;
   int rh = key & 0xFFFFFFFF;
   Debug::check_assertion(rw == width,"recovered width does not match");
@@ -383,6 +992,339 @@ GlRenderer::Fbo* GlRenderer::get_fbo(int width, int height, bool screen) {
   return &fbos.insert({key,{fbo,view}}).first->second;
 }
 
+/**
+ * @brief compute the key of a size in the framebuffer cache and the pool
+ * of render targets
+ * @param width a width
+ * @param height a height
+ * @return the key
+ */
+uint_fast64_t GlRenderer::get_size_key(int width, int height) {
+  return (static_cast<uint_fast64_t>(width) << 32) | static_cast<uint_fast64_t>(height);
+}
+
+/**
+ * @brief get a GL texture for a new render target
+ *
+ * Reuses the texture of a render target of the same size destroyed
+ * recently if any, otherwise allocates one. The content is undefined.
+ *
+ * @param width width of the texture
+ * @param height height of the texture
+ * @return the texture
+ */
+GLuint GlRenderer::acquire_target_texture(int width, int height) {
+  auto it = target_pool.find(get_size_key(width,height));
+  if(it != target_pool.end() && !it->second.empty()) {
+    //Most recently released first: it is the most likely to be resident
+    GLuint id = it->second.back().id;
+    it->second.pop_back();
+    return id;
+  }
+
+  GLuint id;
+  glGenTextures(1,&id);
+  glBindTexture(GL_TEXTURE_2D,id);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+  GlTexture::set_texture_params();
+  return id;
+}
+
+/**
+ * @brief keep the GL texture of a destroyed render target for reuse
+ *
+ * Deletes it instead if enough textures of its size are already pooled.
+ *
+ * @param texture the render target being destroyed
+ */
+void GlRenderer::recycle_target_texture(const GlTexture& texture) {
+  std::vector<PooledTarget>& pooled = target_pool[get_size_key(texture.get_width(),texture.get_height())];
+  if(pooled.size() >= max_pooled_targets) {
+    texture.release();
+    return;
+  }
+  pooled.push_back({texture.tex_id,frame_number});
+}
+
+/**
+ * @brief delete the pooled render targets unused for pooled_target_lifetime
+ * frames
+ *
+ * Sizes needed only once, like during a transition, do not hold video
+ * memory for long.
+ */
+void GlRenderer::reclaim_target_textures() {
+  auto it = target_pool.begin();
+  while(it != target_pool.end()) {
+    std::vector<PooledTarget>& pooled = it->second;
+    //Released in order, so the oldest ones come first
+    size_t num_expired = 0;
+    while(num_expired < pooled.size() &&
+          frame_number - pooled[num_expired].released_frame > pooled_target_lifetime) {
+      glDeleteTextures(1,&pooled[num_expired].id);
+      ++num_expired;
+    }
+    pooled.erase(pooled.begin(),pooled.begin() + num_expired);
+    if(pooled.empty()) {
+      it = target_pool.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * @brief detect the compressed texture formats supported
+ *
+ * Some drivers only list part of the formats they support in
+ * GL_COMPRESSED_TEXTURE_FORMATS: extensions and versions are checked too.
+ */
+void GlRenderer::init_compressed_formats() {
+  GLint num_formats = 0;
+  glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS,&num_formats);
+  if(num_formats > 0) {
+    std::vector<GLint> formats(num_formats);
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS,formats.data());
+    compressed_formats.assign(formats.begin(),formats.end());
+  }
+
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  const bool has_gl_4_2 = !is_es_context && (major > 4 || (major == 4 && minor >= 2));
+  const bool has_gl_4_3 = !is_es_context && (major > 4 || (major == 4 && minor >= 3));
+  const bool has_es_3 = is_es_context && major >= 3;
+  const std::vector<std::pair<GLenum,bool>> implied_formats = {
+    { COMPRESSED_RGBA_S3TC_DXT1, SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc") == SDL_TRUE },
+    { COMPRESSED_RGBA_S3TC_DXT5, SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc") == SDL_TRUE },
+    { COMPRESSED_RGBA_BPTC_UNORM, has_gl_4_2 ||
+      SDL_GL_ExtensionSupported("GL_ARB_texture_compression_bptc") ||
+      SDL_GL_ExtensionSupported("GL_EXT_texture_compression_bptc") },
+    { COMPRESSED_RGBA8_ETC2_EAC, has_gl_4_3 || has_es_3 ||
+      SDL_GL_ExtensionSupported("GL_ARB_ES3_compatibility") },
+    { COMPRESSED_RGBA_ASTC_4x4, SDL_GL_ExtensionSupported("GL_KHR_texture_compression_astc_ldr") == SDL_TRUE },
+  };
+  for(const auto& implied : implied_formats) {
+    if(implied.second &&
+       std::find(compressed_formats.begin(),compressed_formats.end(),implied.first) == compressed_formats.end()) {
+      compressed_formats.push_back(implied.first);
+    }
+  }
+
+  std::string names;
+  for(KtxImage::Format format : {
+      KtxImage::FORMAT_BC1_RGBA,
+      KtxImage::FORMAT_BC3,
+      KtxImage::FORMAT_BC7,
+      KtxImage::FORMAT_ETC2_RGBA,
+      KtxImage::FORMAT_ASTC_4x4 }) {
+    if(get_compressed_format(format) != 0) {
+      names += (names.empty() ? "" : ", ") + KtxImage::get_format_name(format);
+    }
+  }
+  Logger::info("Compressed texture formats: " + (names.empty() ? std::string("none") : names));
+}
+
+/**
+ * @brief get the GL format to upload an image in a KTX2 format
+ * @param format a format of KTX2 files
+ * @return the GL internal format, or 0 if this format is not supported
+ */
+GLenum GlRenderer::get_compressed_format(KtxImage::Format format) const {
+  const GLenum gl_format = get_gl_compressed_format(format);
+  if(gl_format == 0 ||
+     std::find(compressed_formats.begin(),compressed_formats.end(),gl_format) == compressed_formats.end()) {
+    return 0;
+  }
+  return gl_format;
+}
+
+/**
+ * @brief detect and load pixel buffer objects and ARB_sync
+ * @return true if pixels can be read back asynchronously
+ */
+/**
+ * @brief check whether render targets can be blitted to the window
+ * @return true if glBlitFramebuffer is available and the window is not
+ * multisampled
+ */
+bool GlRenderer::init_window_blits() {
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  if(major < 3 && (is_es_context || !SDL_GL_ExtensionSupported("GL_ARB_framebuffer_object"))) {
+    return false;
+  }
+  if(!glBlitFramebuffer) {
+    return false;
+  }
+  GLint sample_buffers = 0;
+  glGetIntegerv(GL_SAMPLE_BUFFERS,&sample_buffers);
+  return sample_buffers == 0;
+}
+
+/**
+ * @brief create the time elapsed queries if they are supported
+ *
+ * Time elapsed queries need OpenGL 3.3 or ARB_timer_query.
+ *
+ * @return whether GPU time can be measured
+ */
+bool GlRenderer::init_gpu_timers() {
+#ifdef SOLARUS_GL_ES
+  return false;
+#else
+  if(is_es_context || !glGenQueries) {
+    return false;
+  }
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  const bool has_gl_3_3 = major > 3 || (major == 3 && minor >= 3);
+  if(!has_gl_3_3 && !SDL_GL_ExtensionSupported("GL_ARB_timer_query")) {
+    return false;
+  }
+  glGenQueries(num_gpu_timers, gpu_timers.data());
+  return true;
+#endif
+}
+
+bool GlRenderer::init_async_reads() {
+#ifdef SOLARUS_GL_ES
+  return false;
+#else
+  if(is_es_context) {
+    return false;
+  }
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  const bool has_gl_3_2 = major > 3 || (major == 3 && minor >= 2);
+  if(!has_gl_3_2 && !SDL_GL_ExtensionSupported("GL_ARB_sync")) {
+    return false;
+  }
+
+  if(!fence_sync) {
+    fence_sync = reinterpret_cast<PFN_FENCE_SYNC>(SDL_GL_GetProcAddress("glFenceSync"));
+    client_wait_sync = reinterpret_cast<PFN_CLIENT_WAIT_SYNC>(SDL_GL_GetProcAddress("glClientWaitSync"));
+    delete_sync = reinterpret_cast<PFN_DELETE_SYNC>(SDL_GL_GetProcAddress("glDeleteSync"));
+  }
+  return fence_sync && client_wait_sync && delete_sync && glMapBufferRange;
+#endif
+}
+
+/**
+ * @copydoc Renderer::read_pixels_async
+ *
+ * Dirty render targets are copied to a pixel buffer object, and the copy is
+ * fenced: the pixels are mapped once the GPU is done, a few frames later.
+ * Other surfaces already have their pixels in memory.
+ */
+void GlRenderer::read_pixels_async(const SurfaceImplPtr& surf, const PixelsCallback& callback) {
+#ifndef SOLARUS_GL_ES
+  GlTexture& texture = surf->as<GlTexture>();
+  if(async_reads && texture.target && texture.surface_dirty) {
+    //Make sure we draw everything before read
+    set_state(current_texture,current_shader,&texture,current_blend_mode,true);
+
+    const size_t size = static_cast<size_t>(texture.get_width()) * texture.get_height() * 4;
+    PixelRead read = { 0, nullptr, size, callback };
+    const auto free_it = std::find_if(free_pixel_buffers.begin(),free_pixel_buffers.end(),
+                                      [size](const PixelBuffer& buffer) {
+      return buffer.size == size;
+    });
+    if(free_it != free_pixel_buffers.end()) {
+      //Reuse the buffer of a previous read: repeated reads rotate a few buffers
+      read.pbo = free_it->pbo;
+      free_pixel_buffers.erase(free_it);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER,read.pbo);
+    } else {
+      glGenBuffers(1,&read.pbo);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER,read.pbo);
+      glBufferData(GL_PIXEL_PACK_BUFFER,size,nullptr,GL_STREAM_READ);
+    }
+    glReadPixels(0,0,
+                 texture.get_width(),texture.get_height(),
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+    read.fence = fence_sync(SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pixel_reads.push_back(std::move(read));
+    return;
+  }
+#endif
+  Renderer::read_pixels_async(surf, callback);
+}
+
+/**
+ * @copydoc Renderer::update_pixel_reads
+ */
+void GlRenderer::update_pixel_reads() {
+  Renderer::update_pixel_reads();
+
+#ifndef SOLARUS_GL_ES
+  //Collect the finished reads first: callbacks may request other reads
+  std::vector<std::pair<PixelsCallback, std::string>> finished;
+  auto it = pixel_reads.begin();
+  while(it != pixel_reads.end()) {
+    const GLenum result = client_wait_sync(it->fence, 0, 0);
+    if(result != ALREADY_SIGNALED && result != CONDITION_SATISFIED) {
+      ++it;
+      continue;
+    }
+
+    std::string pixels;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,it->pbo);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER,0,it->size,GL_MAP_READ_BIT);
+    if(data) {
+      pixels.assign(static_cast<const char*>(data),it->size);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+      Debug::warning("Failed to map the pixel buffer");
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+    if(free_pixel_buffers.size() < max_free_pixel_buffers) {
+      free_pixel_buffers.push_back({it->pbo,it->size});
+    } else {
+      glDeleteBuffers(1,&it->pbo);
+    }
+    delete_sync(it->fence);
+    finished.emplace_back(std::move(it->callback), std::move(pixels));
+    it = pixel_reads.erase(it);
+  }
+
+  for(const auto& read : finished) {
+    read.first(read.second);
+  }
+#endif
+}
+
+/**
+ * @copydoc Renderer::cancel_pixel_reads
+ */
+void GlRenderer::cancel_pixel_reads() {
+  Renderer::cancel_pixel_reads();
+
+#ifndef SOLARUS_GL_ES
+  for(PixelRead& read : pixel_reads) {
+    glDeleteBuffers(1,&read.pbo);
+    delete_sync(read.fence);
+  }
+  pixel_reads.clear();
+  delete_free_pixel_buffers();
+#endif
+}
+
+#ifndef SOLARUS_GL_ES
+/**
+ * @brief delete the pixel buffer objects kept for future reads
+ */
+void GlRenderer::delete_free_pixel_buffers() {
+  for(const PixelBuffer& buffer : free_pixel_buffers) {
+    glDeleteBuffers(1,&buffer.pbo);
+  }
+  free_pixel_buffers.clear();
+}
+#endif
+
 /**
  * @brief number of indices in the buffer
  * @return
@@ -408,17 +1350,343 @@ void GlRenderer::restart_batch() {
     if(test_texture != current_target) {
       Debug::warning("InCONSISTENT state");
     }
-    glBufferSubData(GL_ARRAY_BUFFER, 0, buffered_vertices()*sizeof(Vertex), vertex_buffer.data());
-    glDrawElements(GL_TRIANGLES, buffered_indices(), GL_UNSIGNED_SHORT, nullptr);
-    //Orphan buffer to refill faster
-    glBufferData(GL_ARRAY_BUFFER, vertex_buffer.size()*sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
-
+    if(is_instanced(current_shader)) {
+      //One record per sprite, the vertex shader expands the quads
+      glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+      upload_ring_range(batch_start*sizeof(SpriteInstance),
+                        buffered_sprites*sizeof(SpriteInstance),
+                        instances.data() + batch_start);
+      set_instance_attributes(batch_start);
+      draw_arrays_instanced(GL_TRIANGLES, 0, 6, buffered_sprites);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    } else {
+      if(!persistent_mapping) {
+        //Upload only the range of the ring used by this batch
+        upload_ring_range(batch_start*4*sizeof(Vertex),
+                          buffered_vertices()*sizeof(Vertex),
+                          vertex_buffer.data() + batch_start*4);
+      }
+      //Indices of the ring are absolute, offset them to the batch
+      glDrawElements(GL_TRIANGLES, buffered_indices(), GL_UNSIGNED_SHORT,
+                     reinterpret_cast<void*>(batch_start*6*sizeof(GLushort)));
+    }
+    frame_stats.draw_calls++;
+    frame_stats.sprites += buffered_sprites;
+    batch_start += buffered_sprites;
   }
   test_texture = nullptr;
-  //Done rendering, start actual batch
-  current_vertex = vertex_buffer.data();
-
+  //Done rendering, start actual batch right after the previous one
   buffered_sprites = 0; //Reset sprite count, lets accumulate sprites!
+  current_vertex = get_vertex_base() + batch_start*4;
+}
+
+/**
+ * @brief forget the sprites of the current batch without drawing them
+ */
+void GlRenderer::discard_batch() {
+  buffered_sprites = 0;
+  test_texture = nullptr;
+  current_vertex = get_vertex_base() + batch_start*4;
+}
+
+/**
+ * @brief get the start of the memory where vertices of the ring are written
+ * @return the mapped buffer or the CPU side copy of the ring
+ */
+Vertex* GlRenderer::get_vertex_base() {
+  return persistent_mapping ? mapped_vertices : vertex_buffer.data();
+}
+
+/**
+ * @brief tell whether the ring is divided in sections protected by fences
+ *
+ * The GPU may then still read the sections written during the previous
+ * frames while the next ones are written.
+ *
+ * @return true if the ring is persistently mapped or written with
+ * unsynchronized mappings
+ */
+bool GlRenderer::is_ring_fenced() const {
+  return persistent_mapping || unsynchronized_mapping;
+}
+
+/**
+ * @brief write a range of the ring bound to GL_ARRAY_BUFFER
+ *
+ * With unsynchronized mappings, the driver does not check whether the GPU
+ * still reads the buffer: section fences already guarantee that it does
+ * not read this range.
+ *
+ * @param offset offset of the range in bytes
+ * @param size size of the range in bytes
+ * @param data the bytes to write
+ */
+void GlRenderer::upload_ring_range(GLintptr offset, GLsizeiptr size, const void* data) {
+  if(unsynchronized_mapping) {
+    const GLbitfield flags = MAP_WRITE_BIT | MAP_INVALIDATE_RANGE_BIT | MAP_UNSYNCHRONIZED_BIT;
+    void* mapped = map_buffer_range(GL_ARRAY_BUFFER, offset, size, flags);
+    if(mapped) {
+      std::memcpy(mapped, data, size);
+      if(unmap_buffer(GL_ARRAY_BUFFER)) {
+        return;
+      }
+      //The data store was lost, write it again
+    }
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+}
+
+/**
+ * @brief make sure there is room in the ring for one more sprite
+ *
+ * Flushes the batch if the ring is full or if the next sprite starts a new
+ * section, and waits for the GPU to be done with the memory to overwrite.
+ */
+void GlRenderer::reserve_sprite() {
+  const size_t next = batch_start + buffered_sprites;
+  if(next >= buffer_size) {
+    restart_batch();
+    frame_stats.buffer_flushes++;
+    batch_start = 0;
+    if(is_ring_fenced()) {
+      enter_section(0);
+    } else {
+      //Orphan buffer to refill faster
+      glBufferData(GL_ARRAY_BUFFER, buffer_size*4*sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if(instance_vbo) {
+      glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+      glBufferData(GL_ARRAY_BUFFER, buffer_size*sizeof(SpriteInstance), nullptr, GL_DYNAMIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    }
+    current_vertex = get_vertex_base();
+    return;
+  }
+
+  if(is_ring_fenced() && next / section_size != current_section) {
+    restart_batch();
+    frame_stats.buffer_flushes++;
+    enter_section(next / section_size);
+  }
+}
+
+/**
+ * @brief make sure there is room in the ring for some more sprites
+ *
+ * Like reserve_sprite(), but also tells how many sprites can be written
+ * one after the other before the end of the ring or of the section.
+ *
+ * @param num_sprites number of sprites to write
+ * @return number of sprites that fit, between 1 and num_sprites
+ */
+size_t GlRenderer::reserve_sprites(size_t num_sprites) {
+  reserve_sprite();
+  const size_t next = batch_start + buffered_sprites;
+  size_t end = buffer_size;
+  if(is_ring_fenced()) {
+    end = std::min(end, (next / section_size + 1) * section_size);
+  }
+  return std::min(num_sprites, end - next);
+}
+
+/**
+ * @brief start writing sprites to another section of the fenced ring
+ *
+ * Fences the draw calls that read the section we leave and waits for those
+ * that read the section we enter.
+ *
+ * @param section index of the section to enter
+ */
+void GlRenderer::enter_section(size_t section) {
+  GLsync& previous_fence = section_fences[current_section];
+  if(previous_fence) {
+    delete_sync(previous_fence);
+  }
+  previous_fence = fence_sync(SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  current_section = section;
+  GLsync& fence = section_fences[current_section];
+  if(fence) {
+    GLenum result;
+    do {
+      result = client_wait_sync(fence, SYNC_FLUSH_COMMANDS_BIT, sync_timeout_ns);
+    } while(result == TIMEOUT_EXPIRED);
+    if(result == WAIT_FAILED) {
+      Debug::warning("Failed to wait for the sprite buffer");
+    }
+    delete_sync(fence);
+    fence = nullptr;
+  }
+}
+
+/**
+ * @brief detect and load ARB_buffer_storage and ARB_sync
+ * @return true if the sprite ring can be persistently mapped
+ */
+bool GlRenderer::init_buffer_storage() {
+#ifdef SOLARUS_GL_ES
+  return false;
+#else
+  if(is_es_context) {
+    return false;
+  }
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  const bool has_gl_4_4 = major > 4 || (major == 4 && minor >= 4);
+  const bool has_gl_3_2 = major > 3 || (major == 3 && minor >= 2);
+  if(!has_gl_4_4 &&
+     (!SDL_GL_ExtensionSupported("GL_ARB_buffer_storage") ||
+      (!has_gl_3_2 && !SDL_GL_ExtensionSupported("GL_ARB_sync")))) {
+    return false;
+  }
+
+  buffer_storage = reinterpret_cast<PFN_BUFFER_STORAGE>(SDL_GL_GetProcAddress("glBufferStorage"));
+  fence_sync = reinterpret_cast<PFN_FENCE_SYNC>(SDL_GL_GetProcAddress("glFenceSync"));
+  client_wait_sync = reinterpret_cast<PFN_CLIENT_WAIT_SYNC>(SDL_GL_GetProcAddress("glClientWaitSync"));
+  delete_sync = reinterpret_cast<PFN_DELETE_SYNC>(SDL_GL_GetProcAddress("glDeleteSync"));
+  return buffer_storage && fence_sync && client_wait_sync && delete_sync;
+#endif
+}
+
+/**
+ * @brief detect and load ARB_sync and buffer mapping for unsynchronized writes
+ *
+ * This is the fallback of persistent mapping when ARB_buffer_storage is
+ * missing, like with OpenGL ES 3 contexts.
+ *
+ * @return true if batches can be written to the ring with unsynchronized
+ * mappings
+ */
+bool GlRenderer::init_unsynchronized_mapping() {
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  const bool has_sync = is_es_context ?
+        major >= 3 :
+        major > 3 || (major == 3 && minor >= 2) || SDL_GL_ExtensionSupported("GL_ARB_sync");
+  const bool has_map_buffer_range = is_es_context ?
+        major >= 3 :
+        major >= 3 || SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range");
+  if(!has_sync || !has_map_buffer_range) {
+    return false;
+  }
+
+  if(!fence_sync) {
+    fence_sync = reinterpret_cast<PFN_FENCE_SYNC>(SDL_GL_GetProcAddress("glFenceSync"));
+    client_wait_sync = reinterpret_cast<PFN_CLIENT_WAIT_SYNC>(SDL_GL_GetProcAddress("glClientWaitSync"));
+    delete_sync = reinterpret_cast<PFN_DELETE_SYNC>(SDL_GL_GetProcAddress("glDeleteSync"));
+  }
+  map_buffer_range = reinterpret_cast<PFN_MAP_BUFFER_RANGE>(SDL_GL_GetProcAddress("glMapBufferRange"));
+  unmap_buffer = reinterpret_cast<PFN_UNMAP_BUFFER>(SDL_GL_GetProcAddress("glUnmapBuffer"));
+  return fence_sync && client_wait_sync && delete_sync && map_buffer_range && unmap_buffer;
+}
+
+/**
+ * @brief detect and load instanced drawing
+ * @return true if sprites can be drawn from instance records
+ */
+bool GlRenderer::init_instancing() {
+  if(!sprite_instancing_enabled) {
+    return false;
+  }
+  GLint major, minor;
+  std::tie(major,minor) = Gl::getVersion();
+  const bool supported = is_es_context ?
+        major >= 3 :
+        major > 3 || (major == 3 && minor >= 3);
+  if(!supported) {
+    return false;
+  }
+
+  draw_arrays_instanced = reinterpret_cast<PFN_DRAW_ARRAYS_INSTANCED>(SDL_GL_GetProcAddress("glDrawArraysInstanced"));
+  vertex_attrib_divisor = reinterpret_cast<PFN_VERTEX_ATTRIB_DIVISOR>(SDL_GL_GetProcAddress("glVertexAttribDivisor"));
+  return draw_arrays_instanced && vertex_attrib_divisor;
+}
+
+/**
+ * @brief create the instance ring, with as many records as the sprite ring
+ */
+void GlRenderer::create_instance_buffer() {
+  const GLuint program = sprite_shader->as<GlShader>().program;
+  instance_locations = {{
+    glGetAttribLocation(program, "sol_instance_position"),
+    glGetAttribLocation(program, "sol_instance_corner"),
+    glGetAttribLocation(program, "sol_instance_extent"),
+    glGetAttribLocation(program, "sol_instance_region"),
+    glGetAttribLocation(program, "sol_instance_rotation"),
+    glGetAttribLocation(program, "sol_instance_color")
+  }};
+
+  instances.resize(buffer_size);
+  glGenBuffers(1, &instance_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+  glBufferData(GL_ARRAY_BUFFER, buffer_size*sizeof(SpriteInstance), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  Logger::info("Sprite instancing: yes");
+}
+
+/**
+ * @brief tell whether a shader draws from the instance ring
+ * @param shader a shader or nullptr
+ * @return true if this is the instanced sprite shader
+ */
+bool GlRenderer::is_instanced(const GlShader* shader) const {
+  return sprite_shader && shader == &sprite_shader->as<GlShader>();
+}
+
+/**
+ * @brief get the shader that draws sprites of the default shader
+ * @return the instanced sprite shader if any, the main shader otherwise
+ */
+GlShader& GlRenderer::get_sprite_shader() {
+  return sprite_shader ? sprite_shader->as<GlShader>() : main_shader->as<GlShader>();
+}
+
+/**
+ * @brief enable or disable the per-instance attributes of the sprite shader
+ *
+ * Attributes are shared by all programs: their divisor must be reset
+ * before another shader uses the same locations for vertices.
+ *
+ * @param enable true when the sprite shader becomes current
+ */
+void GlRenderer::enable_instance_attributes(bool enable) {
+  for(GLint location : instance_locations) {
+    if(location == -1) {
+      continue;
+    }
+    if(enable) {
+      glEnableVertexAttribArray(location);
+      vertex_attrib_divisor(location, 1);
+    } else {
+      vertex_attrib_divisor(location, 0);
+      glDisableVertexAttribArray(location);
+    }
+  }
+}
+
+/**
+ * @brief point the per-instance attributes to a record of the instance ring
+ *
+ * Instanced draws cannot start at another instance than the first one
+ * before OpenGL 4.2, so the attributes are offset instead.
+ *
+ * @param first_instance index of the first record to draw
+ */
+void GlRenderer::set_instance_attributes(size_t first_instance) {
+  const size_t base = first_instance*sizeof(SpriteInstance);
+  auto set_attribute = [&](size_t index, GLint size, GLenum type, GLboolean normalized, size_t offset) {
+    const GLint location = instance_locations[index];
+    if(location != -1) {
+      glVertexAttribPointer(location, size, type, normalized, sizeof(SpriteInstance),
+                            reinterpret_cast<void*>(base + offset));
+    }
+  };
+  set_attribute(0, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, position));
+  set_attribute(1, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, corner));
+  set_attribute(2, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, extent));
+  set_attribute(3, 4, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(SpriteInstance, region));
+  set_attribute(4, 1, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, rotation));
+  set_attribute(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(SpriteInstance, color));
 }
 
 /**
@@ -427,11 +1695,17 @@ void GlRenderer::restart_batch() {
  */
 void GlRenderer::set_shader(GlShader* shader) {
   if(shader != current_shader) {
+    if(is_instanced(current_shader)) {
+      enable_instance_attributes(false);
+    }
     shader->bind();
     if(current_shader){
       current_shader->unbind();
     }
     current_shader = shader;
+    if(is_instanced(current_shader)) {
+      enable_instance_attributes(true);
+    }
   }
 }
 
@@ -472,8 +1746,9 @@ void GlRenderer::rebind_texture() {
  * @param shad the shader to use to draw
  * @param dst the texture to draw to
  * @param mode the blend mode to use
+ * @return true if the state changed and the batch was restarted
  */
-void GlRenderer::set_state(const GlTexture *src, GlShader* shad, GlTexture* dst, const GLBlendMode& mode, bool force) {
+bool GlRenderer::set_state(const GlTexture *src, GlShader* shad, GlTexture* dst, const GLBlendMode& mode, bool force) {
   if(src != current_texture ||
      shad != current_shader ||
      dst != current_target ||
@@ -486,21 +1761,21 @@ void GlRenderer::set_state(const GlTexture *src, GlShader* shad, GlTexture* dst,
     set_texture(src);
     set_blend_mode(mode);
 
-    if(!current_shader) return; //Dont upload uniform if there is no shader
+    if(!current_shader) return true; //Dont upload uniform if there is no shader
     //Resend mvp and uvm
-    glUniformMatrix4fv(current_shader->get_uniform_location(Shader::MVP_MATRIX_NAME),
+    glUniformMatrix4fv(current_shader->get_builtin_locations().mvp_matrix,
                        1,
                        GL_FALSE,
                        glm::value_ptr(dst->fbo->view));
     if(current_texture) {
-      glUniformMatrix3fv(current_shader->get_uniform_location(Shader::UV_MATRIX_NAME),
+      glUniformMatrix3fv(current_shader->get_builtin_locations().uv_matrix,
                          1,
                          GL_FALSE,
                          glm::value_ptr(current_texture->uv_transform));
       int sw = current_texture->get_width();
       int sh = current_texture->get_height();
       glUniform2f(
-            current_shader->get_uniform_location(Shader::INPUT_SIZE_NAME),
+            current_shader->get_builtin_locations().input_size,
             sw,sh);
     }
 
@@ -508,13 +1783,19 @@ void GlRenderer::set_state(const GlTexture *src, GlShader* shad, GlTexture* dst,
       int dw = current_target->get_width();
       int dh = current_target->get_height();
       glUniform2f(
-            current_shader->get_uniform_location(Shader::OUTPUT_SIZE_NAME),
+            current_shader->get_builtin_locations().output_size,
             dw,dh);
     }
     glUniform1i(
-          current_shader->get_uniform_location(Shader::TIME_NAME),
+          current_shader->get_builtin_locations().time,
           System::now());
+    if (current_shader->get_builtin_locations().time != -1) {
+      // Animated shader: the next frame differs.
+      FrameDamage::notify();
+    }
+    return true;
   }
+  return false;
 }
 
 /**
@@ -532,7 +1813,7 @@ void GlRenderer::set_blend_mode(GLBlendMode mode) {
 
     if(current_shader) {
       glUniform1i(
-            current_shader->get_uniform_location("sol_alpha_mult"),
+            current_shader->get_builtin_locations().alpha_mult,
             alpha_mult);
     }
   }
@@ -546,6 +1827,9 @@ void GlRenderer::set_blend_mode(GLBlendMode mode) {
  * @return the GLBlendMode aggregate
  */
 GlRenderer::GLBlendMode GlRenderer::make_gl_blend_modes(const GlTexture& dst, const GlTexture* src, BlendMode mode) {
+  if(premultiplied_alpha) {
+    return make_gl_blend_modes(mode);
+  }
   if(src && src->is_premultiplied() && dst.is_premultiplied()) {
     switch(mode) {
     case BlendMode::BLEND:
@@ -570,6 +1854,19 @@ GlRenderer::GLBlendMode GlRenderer::make_gl_blend_modes(BlendMode mode) {
   auto sym = [](GLenum src,GLenum dst) -> GLBlendMode {
     return GLBlendMode{src,dst,src,dst,false};
   };
+  if(premultiplied_alpha) {
+    // Everything is premultiplied: blend and add only differ by the vertex
+    // alpha (see add_sprite), so they share the same state.
+    switch(mode) {
+    case BlendMode::BLEND:
+    case BlendMode::ADD:
+      return sym(GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
+    case BlendMode::MULTIPLY:
+      return GLBlendMode{GL_DST_COLOR,GL_ONE_MINUS_SRC_ALPHA,GL_ONE,GL_ONE_MINUS_SRC_ALPHA,false};
+    case BlendMode::NONE:
+      return sym(GL_ONE,GL_ZERO);
+    }
+  }
   switch(mode) {
   case BlendMode::BLEND:
     return GLBlendMode{GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA,GL_ONE,GL_ONE,false};
@@ -589,6 +1886,9 @@ GlRenderer::GLBlendMode GlRenderer::make_gl_blend_modes(BlendMode mode) {
  */
 void GlRenderer::create_vbo(size_t num_sprites) {
   buffer_size = num_sprites;
+  section_size = buffer_size / num_sections;
+  buffer_size = section_size * num_sections;
+  num_sprites = buffer_size;
 
   if(Gl::use_vao()) {
     Gl::GenVertexArrays(1,&vao); //TODO for android ifndef this
@@ -614,14 +1914,40 @@ void GlRenderer::create_vbo(size_t num_sprites) {
   }
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indice_count*sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
 
-  //Give CPU side vertex buffer a size
-  vertex_buffer.resize(vertex_count);
-
   //Create GPU side buffer storage
   glGenBuffers(1, &vbo);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
-  glBufferData(GL_ARRAY_BUFFER, vertex_count*sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+#ifndef SOLARUS_GL_ES
+  if(init_buffer_storage()) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+    buffer_storage(GL_ARRAY_BUFFER, vertex_count*sizeof(Vertex), nullptr, flags);
+    mapped_vertices = static_cast<Vertex*>(
+          glMapBufferRange(GL_ARRAY_BUFFER, 0, vertex_count*sizeof(Vertex), flags));
+    if(mapped_vertices) {
+      persistent_mapping = true;
+    } else {
+      //Storage is immutable, start again with a regular buffer
+      Debug::warning("Failed to map the sprite buffer persistently");
+      glDeleteBuffers(1, &vbo);
+      glGenBuffers(1, &vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    }
+  }
+#endif
+
+  if(!persistent_mapping) {
+    //Give CPU side vertex buffer a size
+    vertex_buffer.resize(vertex_count);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count*sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    unsynchronized_mapping = init_unsynchronized_mapping();
+  }
+
+  Logger::info(std::string("Sprite batch: ") + std::to_string(buffer_size) + " sprites" +
+               (persistent_mapping ? " (persistent mapping)" :
+                unsynchronized_mapping ? " (unsynchronized mapping)" : ""));
+
+  current_vertex = get_vertex_base();
 }
 
 /**
@@ -641,13 +1967,27 @@ void GlRenderer::shader_about_to_change(GlShader* shader) {
  * @param infos the draw infos
  */
 void GlRenderer::add_sprite(const DrawInfos& infos) {
-  if(buffered_sprites >= buffer_size) {
-    restart_batch();
-  }
+  reserve_sprite();
 
   if(!test_texture)
     test_texture = current_target;
 
+  if(is_instanced(current_shader)) {
+    write_instance(instances[batch_start + buffered_sprites],infos);
+  } else {
+    write_sprite(current_vertex,infos);
+  }
+
+  current_vertex += 4; //Shift current quad index
+  buffered_sprites++;
+}
+
+/**
+ * @brief compute the four vertices of a sprite
+ * @param vertices where to write the vertices
+ * @param infos the draw infos
+ */
+void GlRenderer::write_sprite(Vertex* vertices, const DrawInfos& infos) const {
   vec2 trans = infos.transformation_origin;
   vec2 pos = infos.dst_position + infos.transformation_origin;
   vec2 scale = infos.scale;
@@ -666,24 +2006,107 @@ void GlRenderer::add_sprite(const DrawInfos& infos) {
     br = rot * br;
     tr = rot * tr;
   }
-  current_vertex[0].position = pos + tl;
-  current_vertex[1].position = pos + bl;
-  current_vertex[2].position = pos + br;
-  current_vertex[3].position = pos + tr;
+  vertices[0].position = pos + tl;
+  vertices[1].position = pos + bl;
+  vertices[2].position = pos + br;
+  vertices[3].position = pos + tr;
 
-  current_vertex[0].texcoords = infos.region.get_top_left();
-  current_vertex[1].texcoords = infos.region.get_bottom_left();
-  current_vertex[2].texcoords = infos.region.get_bottom_right();
-  current_vertex[3].texcoords = infos.region.get_top_right();
+  vertices[0].texcoords = infos.region.get_top_left();
+  vertices[1].texcoords = infos.region.get_bottom_left();
+  vertices[2].texcoords = infos.region.get_bottom_right();
+  vertices[3].texcoords = infos.region.get_top_right();
 
 
+  const Color color = make_vertex_color(infos.color,infos.opacity,infos.blend_mode);
   for(size_t i = 0; i < 4; ++i) {
-    current_vertex[i].color = infos.color;
-    current_vertex[i].color.a = (infos.color.a * infos.opacity) / 255; //modulate vcolor opacity with desired opacity
+    vertices[i].color = color;
   }
+}
 
-  current_vertex += 4; //Shift current quad index
+/**
+ * @brief compute the instance record of a sprite
+ *
+ * The sprite shader turns it into the same vertices as write_sprite().
+ *
+ * @param instance where to write the record
+ * @param infos the draw infos
+ */
+void GlRenderer::write_instance(SpriteInstance& instance, const DrawInfos& infos) const {
+  const vec2 trans = infos.transformation_origin;
+  const vec2 scale = infos.scale;
+  const vec2 size = infos.region.get_size();
+  instance.position = infos.dst_position + infos.transformation_origin;
+  instance.corner = -trans * scale;
+  instance.extent = size * scale;
+  instance.region[0] = infos.region.get_x();
+  instance.region[1] = infos.region.get_y();
+  instance.region[2] = infos.region.get_width();
+  instance.region[3] = infos.region.get_height();
+  instance.rotation = infos.should_use_ex() ? infos.rotation : 0.f;
+  instance.color = make_vertex_color(infos.color,infos.opacity,infos.blend_mode);
+}
+
+/**
+ * @brief add a one pixel wide line from the current white texel to the batch
+ *
+ * The line goes through the centers of both end pixels, which are included.
+ *
+ * @param from the first end pixel
+ * @param to the last end pixel
+ * @param color the color of the line
+ * @param mode the blend mode
+ */
+void GlRenderer::add_line(const Point& from, const Point& to, const Color& color, BlendMode mode) {
+  reserve_sprite();
+
+  if(!test_texture)
+    test_texture = current_target;
+
+  const vec2 a = vec2(from.x,from.y) + 0.5f;
+  const vec2 b = vec2(to.x,to.y) + 0.5f;
+  const float length = glm::length(b-a);
+  const vec2 dir = length > 0.f ? (b-a) / length : vec2(1.f,0.f);
+  const vec2 along = dir * 0.5f;
+  const vec2 across = vec2(-dir.y,dir.x) * 0.5f;
+  current_vertex[0].position = a - along - across;
+  current_vertex[1].position = a - along + across;
+  current_vertex[2].position = b + along + across;
+  current_vertex[3].position = b + along - across;
+
+  const Rectangle region = GlTextureAtlas::get_white_texel();
+  current_vertex[0].texcoords = region.get_top_left();
+  current_vertex[1].texcoords = region.get_bottom_left();
+  current_vertex[2].texcoords = region.get_bottom_right();
+  current_vertex[3].texcoords = region.get_top_right();
+
+  const Color vertex_color = make_vertex_color(color,255,mode);
+  for(size_t i = 0; i < 4; ++i) {
+    current_vertex[i].color = vertex_color;
+  }
+
+  current_vertex += 4;
   buffered_sprites++;
 }
 
+/**
+ * @brief compute the color of the vertices of a quad
+ * @param color the color modulation of the quad
+ * @param opacity the opacity of the quad
+ * @param mode the blend mode of the quad
+ * @return the vertex color, premultiplied if the renderer is
+ */
+Color GlRenderer::make_vertex_color(const Color& color, uint8_t opacity, BlendMode mode) const {
+  Color result = color;
+  result.a = (color.a * opacity) / 255; //modulate vcolor opacity with desired opacity
+  if(premultiplied_alpha) {
+    result.r = (result.r * result.a) / 255;
+    result.g = (result.g * result.a) / 255;
+    result.b = (result.b * result.a) / 255;
+    if(mode == BlendMode::ADD) {
+      result.a = 0; //Premultiplied source with no alpha: added to the destination
+    }
+  }
+  return result;
+}
+
 }
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/System.h"
@@ -32,15 +33,104 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/matrix_transform_2d.hpp>
 
+#include <SDL_video.h>
+
 #include <algorithm>
+#include <cstring>
+#include <iomanip>
 #include <sstream>
 
 namespace Solarus {
 
 namespace {
 std::string version_string;
+
+/**
+ * \brief Identifies program cache files.
+ */
+const std::string program_cache_magic = "SOLP";
+
+/**
+ * \brief Version of the format of program cache files.
+ */
+constexpr uint32_t program_cache_version = 1;
+
+/**
+ * \brief Directory of program cache files, relative to the quest write directory.
+ */
+const std::string program_cache_dir = "shader_cache";
+
+/**
+ * \brief Identifies the GPU and the driver that produced program binaries.
+ */
+std::string driver_string;
+
+// Program binaries (OpenGL 4.1, ARB_get_program_binary, OpenGL ES 3.0
+// or OES_get_program_binary), not provided by the GL loader.
+constexpr GLenum gl_program_binary_retrievable_hint = 0x8257;
+constexpr GLenum gl_program_binary_length = 0x8741;
+constexpr GLenum gl_num_program_binary_formats = 0x87FE;
+
+#ifndef SOLARUS_GL_ES
+#define SOLARUS_GL_APIENTRYP APIENTRYP
+#else
+#define SOLARUS_GL_APIENTRYP GL_APIENTRYP
+#endif
+
+using GetProgramBinary = void (SOLARUS_GL_APIENTRYP)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+using ProgramBinary = void (SOLARUS_GL_APIENTRYP)(GLuint, GLenum, const void*, GLsizei);
+using ProgramParameteri = void (SOLARUS_GL_APIENTRYP)(GLuint, GLenum, GLint);
+
+#undef SOLARUS_GL_APIENTRYP
+
+GetProgramBinary get_program_binary = nullptr;
+ProgramBinary program_binary = nullptr;
+ProgramParameteri program_parameter_i = nullptr;
+
+#ifndef SOLARUS_GL_ES
+// Uniform buffer objects (OpenGL 3.1), not provided by the GL loader.
+constexpr GLenum gl_uniform_buffer = 0x8A11;
+constexpr GLenum gl_uniform_block_index = 0x8A3A;
+constexpr GLenum gl_uniform_offset = 0x8A3B;
+constexpr GLenum gl_active_uniform_blocks = 0x8A36;
+constexpr GLenum gl_uniform_block_data_size = 0x8A40;
+
+using GetActiveUniformBlockiv = void (APIENTRYP)(GLuint, GLuint, GLenum, GLint*);
+using GetActiveUniformsiv = void (APIENTRYP)(GLuint, GLsizei, const GLuint*, GLenum, GLint*);
+using UniformBlockBinding = void (APIENTRYP)(GLuint, GLuint, GLuint);
+
+GetActiveUniformBlockiv get_active_uniform_block_iv = nullptr;
+GetActiveUniformsiv get_active_uniforms_iv = nullptr;
+UniformBlockBinding uniform_block_binding = nullptr;
+#endif
+
+/**
+ * \brief Returns the number of bytes of a uniform value in a uniform block.
+ * \param uniform A uniform value.
+ * \return Its size with the std140 layout.
+ */
+size_t get_block_size(const GlShader::Uniform& uniform) {
+
+  using T = GlShader::Uniform::Type;
+  switch (uniform.t) {
+    case T::U1B:
+    case T::U1I:
+    case T::U1F:
+      return 4;
+    case T::U2F:
+      return 8;
+    case T::U3F:
+      return 12;
+    case T::U4F:
+      return 16;
+  }
+  return 0;
 }
 
+}
+
+bool GlShader::program_cache_enabled = true;
+
 /**
  * \brief Initializes the GL 2D shader system.
  * \return \c true if GL 2D shaders are supported.
@@ -50,9 +140,132 @@ bool GlShader::initialize() {
 
   setup_version_string();
 
+#ifndef SOLARUS_GL_ES
+  get_active_uniform_block_iv = nullptr;
+  get_active_uniforms_iv = nullptr;
+  uniform_block_binding = nullptr;
+  const std::pair<GLint, GLint> version = Gl::getVersion();
+  if (version.first > 3 || (version.first == 3 && version.second >= 1)) {
+    get_active_uniform_block_iv = reinterpret_cast<GetActiveUniformBlockiv>(
+        SDL_GL_GetProcAddress("glGetActiveUniformBlockiv"));
+    get_active_uniforms_iv = reinterpret_cast<GetActiveUniformsiv>(
+        SDL_GL_GetProcAddress("glGetActiveUniformsiv"));
+    uniform_block_binding = reinterpret_cast<UniformBlockBinding>(
+        SDL_GL_GetProcAddress("glUniformBlockBinding"));
+  }
+  if (has_uniform_buffers()) {
+    Logger::info("Uniform blocks: yes");
+  }
+#endif
+
+  get_program_binary = nullptr;
+  program_binary = nullptr;
+  program_parameter_i = nullptr;
+  const std::pair<GLint, GLint> gl_version = Gl::getVersion();
+#ifndef SOLARUS_GL_ES
+  if (gl_version.first > 4 || (gl_version.first == 4 && gl_version.second >= 1) ||
+      SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+    get_program_binary = reinterpret_cast<GetProgramBinary>(
+        SDL_GL_GetProcAddress("glGetProgramBinary"));
+    program_binary = reinterpret_cast<ProgramBinary>(
+        SDL_GL_GetProcAddress("glProgramBinary"));
+    program_parameter_i = reinterpret_cast<ProgramParameteri>(
+        SDL_GL_GetProcAddress("glProgramParameteri"));
+  }
+#else
+  if (gl_version.first >= 3) {
+    get_program_binary = reinterpret_cast<GetProgramBinary>(
+        SDL_GL_GetProcAddress("glGetProgramBinary"));
+    program_binary = reinterpret_cast<ProgramBinary>(
+        SDL_GL_GetProcAddress("glProgramBinary"));
+    program_parameter_i = reinterpret_cast<ProgramParameteri>(
+        SDL_GL_GetProcAddress("glProgramParameteri"));
+  }
+  else if (SDL_GL_ExtensionSupported("GL_OES_get_program_binary")) {
+    get_program_binary = reinterpret_cast<GetProgramBinary>(
+        SDL_GL_GetProcAddress("glGetProgramBinaryOES"));
+    program_binary = reinterpret_cast<ProgramBinary>(
+        SDL_GL_GetProcAddress("glProgramBinaryOES"));
+  }
+#endif
+  if (get_program_binary != nullptr && program_binary != nullptr) {
+    // Some drivers expose the functions but no binary format.
+    GLint num_formats = 0;
+    glGetIntegerv(gl_num_program_binary_formats, &num_formats);
+    if (num_formats <= 0) {
+      get_program_binary = nullptr;
+      program_binary = nullptr;
+    }
+  }
+
+  driver_string.clear();
+  for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+    const GLubyte* value = glGetString(name);
+    if (value != nullptr) {
+      driver_string += reinterpret_cast<const char*>(value);
+    }
+    driver_string += '\n';
+  }
+
+  if (has_program_binaries()) {
+    Logger::info(std::string("Shader program cache: ") +
+                 (program_cache_enabled ? "yes" : "disabled"));
+  }
+
   return true;
 }
 
+/**
+ * \brief Returns whether uniform blocks of shaders are backed by buffers.
+ *
+ * This needs OpenGL 3.1. Otherwise, shaders cannot declare uniform blocks.
+ *
+ * \return \c true if uniform buffers are supported.
+ */
+bool GlShader::has_uniform_buffers() {
+#ifndef SOLARUS_GL_ES
+  return get_active_uniform_block_iv != nullptr &&
+      get_active_uniforms_iv != nullptr &&
+      uniform_block_binding != nullptr &&
+      glBindBufferBase != nullptr;
+#else
+  return false;
+#endif
+}
+
+/**
+ * \brief Returns whether linked programs can be saved and reloaded.
+ *
+ * This needs OpenGL 4.1, OpenGL ES 3.0 or an extension, and a driver that
+ * supports at least one binary format.
+ *
+ * \return \c true if program binaries are supported.
+ */
+bool GlShader::has_program_binaries() {
+  return get_program_binary != nullptr && program_binary != nullptr;
+}
+
+/**
+ * \brief Returns whether linked programs are cached in the quest write directory.
+ * \return \c true if the program cache is enabled.
+ */
+bool GlShader::is_program_cache_enabled() {
+  return program_cache_enabled;
+}
+
+/**
+ * \brief Sets whether linked programs are cached in the quest write directory.
+ *
+ * When enabled and supported by the driver, the binary of each program is
+ * saved the first time it is linked, and programs with the same sources are
+ * loaded from this binary next time instead of being compiled.
+ *
+ * \param enabled \c true to enable the program cache.
+ */
+void GlShader::set_program_cache_enabled(bool enabled) {
+  program_cache_enabled = enabled;
+}
+
 /**
  * \brief Uninitializes the GL shader system.
  */
@@ -90,6 +303,9 @@ GlShader::GlShader(const std::string& vertex_source,
  * \brief Destructor.
  */
 GlShader::~GlShader() {
+  for (const UniformBlock& block : uniform_blocks) {
+    glDeleteBuffers(1, &block.buffer);
+  }
   glDeleteShader(vertex_shader);
   glDeleteShader(fragment_shader);
   glDeleteProgram(program);
@@ -97,24 +313,97 @@ GlShader::~GlShader() {
 
 /**
  * \brief Compiles the shader program.
+ *
+ * The program is loaded from the program cache if it was already linked
+ * with the same sources and driver, and saved there otherwise.
  */
 void GlShader::compile() {
+
+  const std::string& vertex_source = get_sanitized_vertex_source();
+  const std::string& fragment_source = get_sanitized_fragment_source();
+
+  std::string cache_file_name;
+  if (program_cache_enabled &&
+      has_program_binaries() &&
+      !QuestFiles::get_quest_write_dir().empty()) {
+    cache_file_name = get_program_cache_file_name(vertex_source, fragment_source);
+  }
+
+  if (cache_file_name.empty() || !load_program_binary(cache_file_name)) {
+    if (!link_program(vertex_source, fragment_source, !cache_file_name.empty())) {
+      return;
+    }
+    if (!cache_file_name.empty()) {
+      save_program_binary(cache_file_name);
+    }
+  }
+
+  set_valid(true);
+
+  glUseProgram(program);
+
+  // Set up constant uniform variables.
+  GLint location = glGetUniformLocation(program, TEXTURE_NAME);
+  if (location >= 0) {
+    glUniform1i(location, 0);
+  }
+
+  const Size& quest_size = Video::get_quest_size();
+  location = glGetUniformLocation(program, INPUT_SIZE_NAME);
+  if (location >= 0) {
+    glUniform2f(location, quest_size.width, quest_size.height);
+  }
+
+  position_location = glGetAttribLocation(program, POSITION_NAME);
+  tex_coord_location = glGetAttribLocation(program, TEXCOORD_NAME);
+  color_location = glGetAttribLocation(program, COLOR_NAME);
+
+  builtin_locations.mvp_matrix = glGetUniformLocation(program, MVP_MATRIX_NAME);
+  builtin_locations.uv_matrix = glGetUniformLocation(program, UV_MATRIX_NAME);
+  builtin_locations.input_size = glGetUniformLocation(program, INPUT_SIZE_NAME);
+  builtin_locations.output_size = glGetUniformLocation(program, OUTPUT_SIZE_NAME);
+  builtin_locations.time = glGetUniformLocation(program, TIME_NAME);
+  builtin_locations.alpha_mult = glGetUniformLocation(program, "sol_alpha_mult");
+  builtin_locations.vcolor_only = glGetUniformLocation(program, "sol_vcolor_only");
+
+  find_uniform_blocks();
+
+  //glUseProgram(previous_program);
+  GlRenderer::get().rebind_shader();
+}
+
+/**
+ * \brief Compiles and links the program from its sources.
+ * \param vertex_source Vertex shader code.
+ * \param fragment_source Fragment shader code.
+ * \param retrievable Whether the binary of the program will be saved.
+ * \return \c true in case of success.
+ */
+bool GlShader::link_program(
+    const std::string& vertex_source,
+    const std::string& fragment_source,
+    bool retrievable) {
+
   GLint linked;
 
   // Create the vertex and fragment shaders.
-  vertex_shader = create_shader(GL_VERTEX_SHADER, get_sanitized_vertex_source().c_str());
-  fragment_shader = create_shader(GL_FRAGMENT_SHADER, get_sanitized_fragment_source().c_str());
+  vertex_shader = create_shader(GL_VERTEX_SHADER, vertex_source.c_str());
+  fragment_shader = create_shader(GL_FRAGMENT_SHADER, fragment_source.c_str());
 
   // Create a program object with both shaders.
   program = glCreateProgram();
   if (program == 0) {
     Debug::error(std::string("Could not create OpenGL program"));
-    return;
+    return false;
   }
 
   glAttachShader(program, vertex_shader);
   glAttachShader(program, fragment_shader);
 
+  if (retrievable && program_parameter_i != nullptr) {
+    program_parameter_i(program, gl_program_binary_retrievable_hint, GL_TRUE);
+  }
+
   glLinkProgram(program);
 
   // Check GL status.
@@ -132,31 +421,120 @@ void GlShader::compile() {
   if (!linked) {
     Debug::error(std::string("Failed to link shader '") + get_id() + std::string("':\n"));
     glDeleteProgram(program);
-    return;
+    program = 0;
+    return false;
   }
 
-  set_valid(true);
+  return true;
+}
 
-  glUseProgram(program);
+/**
+ * \brief Returns the name of the cache file of a program.
+ *
+ * The name depends on the sources and on the GPU and driver,
+ * so that binaries made by another driver are never loaded.
+ *
+ * \param vertex_source Vertex shader code.
+ * \param fragment_source Fragment shader code.
+ * \return Name of the cache file in the quest write directory.
+ */
+std::string GlShader::get_program_cache_file_name(
+    const std::string& vertex_source,
+    const std::string& fragment_source) {
+
+  std::string key = driver_string;
+  key += vertex_source;
+  key += '\0';
+  key += fragment_source;
+
+  std::ostringstream oss;
+  oss << program_cache_dir << '/'
+      << std::hex << std::setw(16) << std::setfill('0')
+      << get_fnv1a_hash(key.data(), key.size())
+      << ".bin";
+  return oss.str();
+}
 
-  // Set up constant uniform variables.
-  GLint location = glGetUniformLocation(program, TEXTURE_NAME);
-  if (location >= 0) {
-    glUniform1i(location, 0);
+/**
+ * \brief Attempts to create the program from a cache file.
+ * \param cache_file_name Name of the cache file in the quest write directory.
+ * \return \c true in case of success, \c false if the cache file does not
+ * exist, is corrupted, is outdated or was rejected by the driver.
+ */
+bool GlShader::load_program_binary(const std::string& cache_file_name) {
+
+  if (!QuestFiles::data_file_exists(cache_file_name)) {
+    return false;
   }
 
-  const Size& quest_size = Video::get_quest_size();
-  location = glGetUniformLocation(program, INPUT_SIZE_NAME);
-  if (location >= 0) {
-    glUniform2f(location, quest_size.width, quest_size.height);
+  const std::string& cache = QuestFiles::data_file_read(cache_file_name);
+  if (cache.compare(0, program_cache_magic.size(), program_cache_magic) != 0) {
+    return false;
   }
 
-  position_location = glGetAttribLocation(program, POSITION_NAME);
-  tex_coord_location = glGetAttribLocation(program, TEXCOORD_NAME);
-  color_location = glGetAttribLocation(program, COLOR_NAME);
+  BinaryReader header(cache, program_cache_magic.size());
+  const uint32_t version = header.read_uint();
+  const GLenum format = header.read_uint();
+  const uint64_t payload_hash = header.read_uint64();
+  const size_t position = header.get_position();
+  if (header.has_failed() ||
+      version != program_cache_version ||
+      position >= cache.size() ||
+      payload_hash != get_fnv1a_hash(cache.data() + position, cache.size() - position)) {
+    return false;
+  }
 
-  //glUseProgram(previous_program);
-  GlRenderer::get().rebind_shader();
+  program = glCreateProgram();
+  if (program == 0) {
+    return false;
+  }
+  program_binary(program, format, cache.data() + position, cache.size() - position);
+
+  // The driver may still reject it, for example after an update.
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    glDeleteProgram(program);
+    program = 0;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Saves the binary of the linked program into a cache file.
+ *
+ * Failures are silently ignored: the program will be linked again next time.
+ *
+ * \param cache_file_name Name of the cache file in the quest write directory.
+ */
+void GlShader::save_program_binary(const std::string& cache_file_name) const {
+
+  GLint length = 0;
+  glGetProgramiv(program, gl_program_binary_length, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::string payload(length, '\0');
+  GLsizei actual_length = 0;
+  GLenum format = 0;
+  get_program_binary(program, length, &actual_length, &format, &payload[0]);
+  if (actual_length <= 0) {
+    return;
+  }
+  payload.resize(actual_length);
+
+  BinaryWriter header;
+  header.write_uint(program_cache_version);
+  header.write_uint(format);
+  header.write_uint64(get_fnv1a_hash(payload.data(), payload.size()));
+
+  QuestFiles::data_file_mkdir(program_cache_dir);
+  QuestFiles::data_file_try_save(
+      cache_file_name,
+      program_cache_magic + header.get_buffer() + payload
+  );
 }
 
 /**
@@ -209,11 +587,25 @@ void GlShader::bind() {
   bound = true;
 
   //Upload uniforms that were postponed
-  for(const auto& u : pending_uniforms){
-    upload_uniform(u);
+  for(int handle : pending_uniforms) {
+    UniformSlot& slot = uniform_slots[handle];
+    upload_uniform(slot.location, slot.value);
+    slot.pending = false;
   }
   pending_uniforms.clear();
 
+#ifndef SOLARUS_GL_ES
+  //Upload the uniform blocks that changed and bind all of them
+  for(UniformBlock& block : uniform_blocks) {
+    if(block.dirty) {
+      glBindBuffer(gl_uniform_buffer, block.buffer);
+      glBufferSubData(gl_uniform_buffer, 0, block.data.size(), block.data.data());
+      block.dirty = false;
+    }
+    glBindBufferBase(gl_uniform_buffer, block.binding, block.buffer);
+  }
+#endif
+
   //Enable and paramatrize vertex attributes
   if(position_location != -1) {
     glEnableVertexAttribArray(position_location);
@@ -232,10 +624,13 @@ void GlShader::bind() {
   }
 
   //Bind correct uniform textures
-  for(const auto& kvp : uniform_textures) {
-    const GLuint texture_unit = kvp.second.unit;
+  for(int handle : texture_uniforms) {
+    const UniformSlot& slot = uniform_slots[handle];
+    const GLuint texture_unit = slot.texture_unit;
+    //Get the texture first: unpacking it from an atlas changes the bindings
+    const GLuint texture = slot.texture->get_impl().as<GlTexture>().get_texture();
     glActiveTexture(GL_TEXTURE0 + texture_unit);
-    glBindTexture(GL_TEXTURE_2D,kvp.second.surface->get_impl().as<GlTexture>().get_texture());
+    glBindTexture(GL_TEXTURE_2D,texture);
   }
 }
 
@@ -259,11 +654,126 @@ GLint GlShader::get_uniform_location(const std::string& uniform_name) const {
   return location;
 }
 
-void GlShader::set_uniform(const Uniform& uniform) {
-  if(!bound){
-    pending_uniforms.push_back(uniform);
+/**
+ * \brief Returns the locations of the uniforms set by the renderer.
+ * \return The built-in uniform locations.
+ */
+const GlShader::BuiltinLocations& GlShader::get_builtin_locations() const {
+  return builtin_locations;
+}
+
+/**
+ * \brief Creates a buffer for each uniform block of the program.
+ *
+ * Also finds the offset of each uniform of these blocks.
+ * Does nothing if uniform buffers are not supported.
+ */
+void GlShader::find_uniform_blocks() {
+
+#ifndef SOLARUS_GL_ES
+  if (!has_uniform_buffers()) {
+    return;
+  }
+
+  GLint num_blocks = 0;
+  glGetProgramiv(program, gl_active_uniform_blocks, &num_blocks);
+  for (GLint i = 0; i < num_blocks; ++i) {
+    GLint size = 0;
+    get_active_uniform_block_iv(program, i, gl_uniform_block_data_size, &size);
+
+    UniformBlock block;
+    block.binding = i;
+    block.data.assign(size, 0);
+    glGenBuffers(1, &block.buffer);
+    glBindBuffer(gl_uniform_buffer, block.buffer);
+    glBufferData(gl_uniform_buffer, size, block.data.data(), GL_DYNAMIC_DRAW);
+    uniform_block_binding(program, i, block.binding);
+    uniform_blocks.push_back(std::move(block));
+  }
+  if (num_blocks == 0) {
+    return;
+  }
+
+  GLint num_uniforms = 0;
+  GLint max_name_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+  std::string name(std::max(max_name_length, 1), '\0');
+  for (GLint i = 0; i < num_uniforms; ++i) {
+    const GLuint index = i;
+    GLint block_index = -1;
+    GLint offset = 0;
+    get_active_uniforms_iv(program, 1, &index, gl_uniform_block_index, &block_index);
+    get_active_uniforms_iv(program, 1, &index, gl_uniform_offset, &offset);
+    if (block_index < 0 || block_index >= num_blocks) {
+      continue;
+    }
+
+    GLsizei length = 0;
+    GLint array_size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(program, index, name.size(), &length, &array_size, &type, &name[0]);
+    std::string uniform_name = name.substr(0, length);
+    block_uniforms[uniform_name] = std::make_pair(block_index, offset);
+
+    // Arrays are named after their first element.
+    const size_t suffix = uniform_name.rfind("[0]");
+    if (suffix != std::string::npos && suffix + 3 == uniform_name.size()) {
+      uniform_name.resize(suffix);
+      block_uniforms[uniform_name] = std::make_pair(block_index, offset);
+    }
+  }
+#endif
+}
+
+/**
+ * \copydoc Shader::resolve_uniform
+ */
+void GlShader::resolve_uniform(int handle, const std::string& uniform_name) {
+
+  Debug::check_assertion(handle == static_cast<int>(uniform_slots.size()), "Wrong uniform handle");
+
+  UniformSlot slot;
+  slot.location = get_uniform_location(uniform_name);
+  if (slot.location == -1) {
+    const auto it = block_uniforms.find(uniform_name);
+    if (it != block_uniforms.end()) {
+      slot.block = it->second.first;
+      slot.offset = it->second.second;
+    }
+  }
+  uniform_slots.push_back(slot);
+}
+
+/**
+ * \brief Sets the value of a uniform.
+ *
+ * The value is uploaded now if the shader is bound, otherwise when it is
+ * bound. Only the last value set before binding is uploaded.
+ *
+ * \param handle Handle of the uniform.
+ * \param uniform The value.
+ */
+void GlShader::set_uniform(int handle, const Uniform& uniform) {
+
+  Debug::check_assertion(is_uniform_handle(handle), "Invalid uniform handle");
+  UniformSlot& slot = uniform_slots[handle];
+  if (slot.block != -1) {
+    write_block_uniform(slot, uniform);
+    return;
+  }
+  if (slot.location == -1) {
+    return; //Not an error, no uniform to set
+  }
+
+  if(!bound) {
+    slot.value = uniform;
+    if(!slot.pending) {
+      slot.pending = true;
+      pending_uniforms.push_back(handle);
+    }
   } else {
-    upload_uniform(uniform);
+    upload_uniform(slot.location, uniform);
   }
 }
 
@@ -271,13 +781,9 @@ void GlShader::draw(Surface& dst_surface, const Surface& src_surface, const Draw
   GlRenderer::get().draw(dst_surface.get_impl(),src_surface.get_impl(),infos,const_cast<GlShader&>(*this));
 }
 
-void GlShader::upload_uniform(const Uniform& u) {
+void GlShader::upload_uniform(GLint loc, const Uniform& u) {
   Debug::check_assertion(bound,"Trying to set uniform on an unbound shader");
   GlRenderer::get().shader_about_to_change(this); //Notify renderer that batch must be interupted
-  GLint loc = get_uniform_location(u.name);
-  if(loc == -1) {
-    return; //Not an error, no uniform to set
-  }
   using T = Uniform::Type;
   switch(u.t) {
     case T::U1B:
@@ -295,73 +801,127 @@ void GlShader::upload_uniform(const Uniform& u) {
   }
 }
 
-using UT = GlShader::Uniform::Type;
 /**
- * \copydoc Shader::set_uniform1f
+ * \brief Writes the value of a uniform of a uniform block in its buffer.
+ *
+ * The buffer is uploaded now if the shader is bound, otherwise when it is
+ * bound, once for all uniforms of the block that changed.
+ *
+ * \param slot The uniform.
+ * \param uniform The value.
  */
-void GlShader::set_uniform_1b(const std::string& uniform_name, bool value) {
-  set_uniform(Uniform(uniform_name,value));
+void GlShader::write_block_uniform(const UniformSlot& slot, const Uniform& uniform) {
+
+#ifndef SOLARUS_GL_ES
+  UniformBlock& block = uniform_blocks[slot.block];
+  const size_t size = get_block_size(uniform);
+  if (slot.offset < 0 || slot.offset + size > block.data.size()) {
+    return;
+  }
+
+  unsigned char* data = block.data.data() + slot.offset;
+  using T = Uniform::Type;
+  switch (uniform.t) {
+    case T::U1B:
+    {
+      const GLint value = uniform.b ? 1 : 0;
+      std::memcpy(data, &value, size);
+      break;
+    }
+    case T::U1I:
+      std::memcpy(data, &uniform.i, size);
+      break;
+    case T::U1F:
+      std::memcpy(data, &uniform.f, size);
+      break;
+    case T::U2F:
+      std::memcpy(data, glm::value_ptr(uniform.ff), size);
+      break;
+    case T::U3F:
+      std::memcpy(data, glm::value_ptr(uniform.fff), size);
+      break;
+    case T::U4F:
+      std::memcpy(data, glm::value_ptr(uniform.ffff), size);
+      break;
+  }
+
+  if (bound) {
+    GlRenderer::get().shader_about_to_change(this);
+    glBindBuffer(gl_uniform_buffer, block.buffer);
+    glBufferSubData(gl_uniform_buffer, slot.offset, size, data);
+  }
+  else {
+    block.dirty = true;
+  }
+#else
+  (void) slot;
+  (void) uniform;
+#endif
 }
 
+/**
+ * \copydoc Shader::set_uniform_1b
+ */
+void GlShader::set_uniform_1b(int handle, bool value) {
+  set_uniform(handle, Uniform(value));
+}
 
 /**
  * \copydoc Shader::set_uniform_1i
  */
-void GlShader::set_uniform_1i(const std::string& uniform_name, int value) {
-  set_uniform(Uniform(uniform_name,value));
+void GlShader::set_uniform_1i(int handle, int value) {
+  set_uniform(handle, Uniform(value));
 }
 
 /**
  * \copydoc Shader::set_uniform_1f
  */
-void GlShader::set_uniform_1f(const std::string& uniform_name, float value) {
-  set_uniform(Uniform(uniform_name,value));
+void GlShader::set_uniform_1f(int handle, float value) {
+  set_uniform(handle, Uniform(value));
 }
 
 /**
  * \copydoc Shader::set_uniform_2f
  */
-void GlShader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
-  set_uniform(Uniform(uniform_name,{value_1,value_2}));
+void GlShader::set_uniform_2f(int handle, float value_1, float value_2) {
+  set_uniform(handle, Uniform(glm::vec2(value_1, value_2)));
 }
 
 /**
  * \copydoc Shader::set_uniform_3f
  */
-void GlShader::set_uniform_3f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3) {
-  set_uniform(Uniform(uniform_name,{value_1,value_2,value_3}));
+void GlShader::set_uniform_3f(int handle, float value_1, float value_2, float value_3) {
+  set_uniform(handle, Uniform(glm::vec3(value_1, value_2, value_3)));
 }
 
 /**
  * \copydoc Shader::set_uniform_4f
  */
-void GlShader::set_uniform_4f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
-  set_uniform(Uniform(uniform_name,{value_1,value_2,value_3,value_4}));
+void GlShader::set_uniform_4f(int handle, float value_1, float value_2, float value_3, float value_4) {
+  set_uniform(handle, Uniform(glm::vec4(value_1, value_2, value_3, value_4)));
 }
 
 /**
  * \copydoc Shader::set_uniform_texture
  */
-bool GlShader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
-  const GLint location = get_uniform_location(uniform_name);
+bool GlShader::set_uniform_texture(int handle, const SurfacePtr& value) {
 
-  if (location == -1) {
+  Debug::check_assertion(is_uniform_handle(handle), "Invalid uniform handle");
+  UniformSlot& slot = uniform_slots[handle];
+  if (slot.location == -1) {
     // Not an error.
     return true;
   }
 
-  auto it = uniform_textures.find(uniform_name);
-  if(it != uniform_textures.end()) {
-    it->second.surface = value;
+  slot.texture = value;
+  if(slot.texture_unit != 0) {
     return true; //Nothing else to do
   }
 
-  GLuint texture_unit = ++current_texture_unit;
-  uniform_textures[uniform_name] = TextureUniform{value,texture_unit};
+  slot.texture_unit = ++current_texture_unit;
+  texture_uniforms.push_back(handle);
 
-  set_uniform(Uniform(uniform_name,(int)texture_unit));
+  set_uniform(handle, Uniform(static_cast<int>(slot.texture_unit)));
   return true;
 }
 
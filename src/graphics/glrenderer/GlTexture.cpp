@@ -1,11 +1,16 @@
 #include "solarus/graphics/glrenderer/GlTexture.h"
 #include "solarus/graphics/glrenderer/GlRenderer.h"
+#include "solarus/graphics/glrenderer/GlTextureAtlas.h"
 #include "solarus/core/Debug.h"
+#include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Video.h"
 
 #include <glm/gtx/matrix_transform_2d.hpp>
 #include <SDL_render.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace Solarus {
 
 inline glm::mat3 uv_view(int width, int height) {
@@ -16,47 +21,221 @@ inline glm::mat3 uv_view(int width, int height) {
 GlTexture::GlTexture(int width, int height, bool screen_tex)
   : target(true),
     uv_transform(uv_view(width,height)),
-    fbo(GlRenderer::get().get_fbo(width,height,screen_tex)) {
+    fbo(GlRenderer::get().get_fbo(width,height,screen_tex)),
+    width(width),
+    height(height) {
+  //Render targets are often short-lived: reuse the texture of a previous
+  //one and only allocate the backup surface when the pixels are read
+  tex_id = GlRenderer::get().acquire_target_texture(width,height);
+  GlRenderer::get().rebind_texture();
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
+}
+
+GlTexture::GlTexture(SDL_Surface_UniquePtr a_surface)
+  : target(false),
+    uv_transform(uv_view(a_surface->w,a_surface->h)),
+    surface(std::move(a_surface)),
+    width(surface->w),
+    height(surface->h) {
   glGenTextures(1,&tex_id);
-  glBindTexture(GL_TEXTURE_2D,tex_id);
-  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
 
+  glBindTexture(GL_TEXTURE_2D,tex_id);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,surface->pixels);
+  GlRenderer::get().frame_stats.texture_uploads++;
   set_texture_params();
-  SDL_PixelFormat* format = Video::get_pixel_format();
-  SDL_Surface* surf_ptr = SDL_CreateRGBSurface(
-        0,
-        width,
-        height,
-        32,
-        format->Rmask,
-        format->Gmask,
-        format->Bmask,
-        format->Amask);
-  Debug::check_assertion(surf_ptr != nullptr,
-                         std::string("Failed to create backup surface ") + SDL_GetError());
-  surface.reset(surf_ptr);
   GlRenderer::get().rebind_texture();
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
 }
 
-GlTexture::GlTexture(SDL_Surface_UniquePtr a_surface)
+/**
+ * @brief Creates an empty atlas page
+ *
+ * Pages have no software surface: they are only read by the renderer.
+ *
+ * @param page_size width and height of the page
+ */
+GlTexture::GlTexture(int page_size)
+  : target(false),
+    uv_transform(uv_view(page_size,page_size)),
+    width(page_size),
+    height(page_size),
+    page(true) {
+  glGenTextures(1,&tex_id);
+
+  //Start fully transparent so that padding between images stays clean
+  std::vector<uint32_t> pixels(static_cast<size_t>(page_size) * page_size, 0);
+  for(int y = 0; y < GlTextureAtlas::white_size; ++y) {
+    std::fill_n(pixels.begin() + y * page_size, GlTextureAtlas::white_size, 0xFFFFFFFF);
+  }
+  glBindTexture(GL_TEXTURE_2D,tex_id);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,pixels.data());
+  //Images never wrap inside a page: they are unpacked to be drawn with wrapping
+  set_texture_params(GL_CLAMP_TO_EDGE);
+  GlRenderer::get().rebind_texture();
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
+}
+
+/**
+ * @brief Creates a texture stored in a sub-rectangle of an atlas page
+ * @param a_surface pixels of the image
+ * @param page the atlas page to copy the pixels to
+ * @param position where to copy them in the page
+ */
+GlTexture::GlTexture(SDL_Surface_UniquePtr a_surface, const std::shared_ptr<GlTexture>& page, const Point& position)
   : target(false),
     uv_transform(uv_view(a_surface->w,a_surface->h)),
-    surface(std::move(a_surface)) {
-  int width = surface->w;
-  int height = surface->h;
+    surface(std::move(a_surface)),
+    width(surface->w),
+    height(surface->h),
+    atlas_page(page),
+    atlas_position(position) {
+
+  glBindTexture(GL_TEXTURE_2D,page->get_texture());
+  glTexSubImage2D(GL_TEXTURE_2D,0,
+                  position.x,position.y,
+                  width,height,
+                  GL_RGBA,GL_UNSIGNED_BYTE,
+                  surface->pixels);
+  GlRenderer::get().frame_stats.texture_uploads++;
+  GlRenderer::get().rebind_texture();
+}
+
+/**
+ * @brief Creates a texture from GPU-compressed pixels
+ *
+ * There is no software surface: it is decoded from the source file when
+ * the pixels are needed.
+ *
+ * @param image the compressed image
+ * @param internal_format GL format of the compressed blocks
+ */
+GlTexture::GlTexture(const KtxImage& image, GLenum internal_format)
+  : target(false),
+    uv_transform(uv_view(image.get_width(),image.get_height())),
+    width(image.get_width()),
+    height(image.get_height()),
+    compressed(true) {
   glGenTextures(1,&tex_id);
 
   glBindTexture(GL_TEXTURE_2D,tex_id);
-  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,surface->pixels);
+  glCompressedTexImage2D(GL_TEXTURE_2D,0,internal_format,
+                         width,height,0,
+                         static_cast<GLsizei>(image.get_data().size()),
+                         image.get_data().data());
+  GlRenderer::get().frame_stats.texture_uploads++;
   set_texture_params();
   GlRenderer::get().rebind_texture();
+  memory_tracker.set_bytes(static_cast<int64_t>(image.get_data().size()));
+}
+
+/**
+ * @brief Returns whether this texture is stored in an atlas page
+ * @return true if this texture is packed
+ */
+bool GlTexture::is_packed() const {
+  return atlas_page != nullptr;
 }
 
-void GlTexture::set_texture_params() {
+/**
+ * @brief Returns whether this texture is an atlas page
+ * @return true if images are packed in this texture
+ */
+bool GlTexture::is_atlas_page() const {
+  return page;
+}
+
+/**
+ * @brief Returns the atlas page this texture is packed in
+ *
+ * Must only be called if is_packed() is true.
+ *
+ * @return the page
+ */
+const GlTexture& GlTexture::get_atlas_page() const {
+  return *atlas_page;
+}
+
+/**
+ * @brief Returns the position of this texture in its atlas page
+ * @return the top-left corner of the image in the page
+ */
+const Point& GlTexture::get_atlas_position() const {
+  return atlas_position;
+}
+
+/**
+ * @brief Returns whether a source region is entirely inside this image
+ *
+ * Packed images can only be drawn from their atlas page for such regions:
+ * other ones wrap, which would sample the neighbouring images of the page.
+ *
+ * @param region a region of this image
+ * @return true if no pixel of the region is outside the image
+ */
+bool GlTexture::contains_region(const Rectangle& region) const {
+  return region.get_x() >= 0 && region.get_y() >= 0 &&
+      region.get_x() + region.get_width() <= width &&
+      region.get_y() + region.get_height() <= height;
+}
+
+/**
+ * @brief Moves this texture out of its atlas page
+ *
+ * Gives this texture its own GL texture, for uses that need to read or
+ * write it outside of the sub-rectangle: drawing on it, modifying its
+ * pixels, or sampling it from a custom shader.
+ * Does nothing if this texture is not packed.
+ */
+void GlTexture::unpack() const {
+  if(!atlas_page) {
+    return;
+  }
+
+  //Keep the page until the texture binding is restored, in case this was
+  //its last image and it has pending sprites to draw
+  std::shared_ptr<GlTexture> page = std::move(atlas_page);
+  atlas_page = nullptr;
+
+  glGenTextures(1,&tex_id);
+  glBindTexture(GL_TEXTURE_2D,tex_id);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,get_surface()->pixels);
+  GlRenderer::get().frame_stats.texture_uploads++;
+  set_texture_params();
+  GlRenderer::get().rebind_texture();
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
+}
+
+/**
+ * @brief Replaces the compressed pixels of this texture by uncompressed ones
+ *
+ * Needed to draw on it or to modify its pixels, which compressed formats
+ * do not allow. The pixels are decoded from the source file.
+ * Does nothing if this texture is not compressed.
+ */
+void GlTexture::decompress() const {
+  if(!compressed) {
+    return;
+  }
+  compressed = false;
+
+  SDL_Surface* pixels = get_surface();
+  Debug::check_assertion(pixels != nullptr, "Missing source file of compressed texture");
+  glBindTexture(GL_TEXTURE_2D,tex_id);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,pixels->pixels);
+  GlRenderer::get().frame_stats.texture_uploads++;
+  GlRenderer::get().rebind_texture();
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
+}
+
+/**
+ * @brief Sets the filtering and wrapping of the bound texture
+ * @param wrap the wrapping mode
+ */
+void GlTexture::set_texture_params(GLenum wrap) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
 }
 
 /**
@@ -66,14 +245,29 @@ void GlTexture::set_texture_params() {
  * to upload it to the texture for changes to be reflected
  */
 void GlTexture::upload_surface() {
+  decompress();
   SDL_Surface* surface = get_surface();
   GlRenderer::get().put_pixels(this,surface->pixels);
 }
 
+/**
+ * @brief upload a modified region of the surface
+ * @param region the region to upload
+ */
+void GlTexture::upload_region(const Rectangle& region) {
+  decompress();
+  SDL_Surface* surface = get_surface();
+  GlRenderer::get().put_pixels(this,surface->pixels,surface->pitch,region);
+}
+
 /**
  * \copydoc SurfaceImpl::get_texture
+ *
+ * A packed texture is unpacked first, since the caller will address it
+ * with its own coordinates.
  */
 GLuint GlTexture::get_texture() const {
+  unpack();
   return tex_id;
 }
 
@@ -81,6 +275,29 @@ GLuint GlTexture::get_texture() const {
  * \copydoc SurfaceImpl::get_surface
  */
 SDL_Surface* GlTexture::get_surface() const {
+  if (!surface && !source_file.empty()) {
+    //Software copy freed after upload: decode the image file again
+    surface = Surface::create_sdl_surface_from_file(source_file);
+    if (surface != nullptr && Video::is_premultiplied_alpha()) {
+      Surface::premultiply_alpha(*surface);
+    }
+  }
+  if (!surface && target) {
+    SDL_PixelFormat* format = Video::get_pixel_format();
+    SDL_Surface* surf_ptr = SDL_CreateRGBSurface(
+          0,
+          width,
+          height,
+          32,
+          format->Rmask,
+          format->Gmask,
+          format->Bmask,
+          format->Amask);
+    Debug::check_assertion(surf_ptr != nullptr,
+                           std::string("Failed to create backup surface ") + SDL_GetError());
+    surface.reset(surf_ptr);
+    surface_dirty = true;
+  }
   if (target and surface_dirty) {
     GlRenderer::get().read_pixels(const_cast<GlTexture*>(this),surface->pixels);
     surface_dirty = false;
@@ -88,7 +305,31 @@ SDL_Surface* GlTexture::get_surface() const {
   return surface.get();
 }
 
+/**
+ * \copydoc SurfaceImpl::set_source_file
+ *
+ * Frees the software copy of the pixels unless
+ * GlRenderer::are_image_copies_kept() is true.
+ */
+void GlTexture::set_source_file(const std::string& file_name) {
+  if (target) {
+    return;
+  }
+  source_file = file_name;
+  if (!GlRenderer::are_image_copies_kept()) {
+    surface = nullptr;
+  }
+}
+
+/**
+ * \copydoc SurfaceImpl::has_software_copy
+ */
+bool GlTexture::has_software_copy() const {
+  return surface != nullptr;
+}
+
 GlTexture& GlTexture::targetable()  {
+  decompress();
   surface_dirty = true; //Just tag the surface as outdated
   if(!fbo)
     fbo = GlRenderer::get().get_fbo(get_width(),get_height());
@@ -99,14 +340,14 @@ GlTexture& GlTexture::targetable()  {
  * \copydoc SurfaceImpl::get_width
  */
 int GlTexture::get_width() const {
-  return surface->w;
+  return width;
 }
 
 /**
  * \copydoc SurfaceImpl::get_height
  */
 int GlTexture::get_height() const {
-  return surface->h;
+  return height;
 }
 
 void GlTexture::release() const {
@@ -0,0 +1,121 @@
+#include "solarus/graphics/glrenderer/GlTextureAtlas.h"
+#include "solarus/graphics/glrenderer/GlTexture.h"
+
+#include <algorithm>
+
+namespace Solarus {
+
+constexpr int GlTextureAtlas::padding;
+constexpr int GlTextureAtlas::white_size;
+
+/**
+ * @brief Creates an empty atlas
+ * @param page_size width and height of the pages
+ * @param max_image_size images wider or taller than this are not packed
+ */
+GlTextureAtlas::GlTextureAtlas(int page_size, int max_image_size) :
+  page_size(page_size),
+  max_image_size(std::min(max_image_size, page_size - padding))
+{
+}
+
+/**
+ * @brief Copies an image into an atlas page
+ * @param surface the image to pack
+ * @return a texture referring to a sub-rectangle of a page, or nullptr if the
+ * image is too large, in which case \p surface is left untouched
+ */
+SurfaceImplPtr GlTextureAtlas::pack(SDL_Surface_UniquePtr&& surface) {
+  if(surface == nullptr ||
+     surface->w > max_image_size ||
+     surface->h > max_image_size) {
+    return nullptr;
+  }
+
+  //Forget the pages whose images are all gone
+  pages.erase(std::remove_if(pages.begin(), pages.end(), [](const Page& page) {
+    return page.texture.expired();
+  }), pages.end());
+
+  const Size size(surface->w, surface->h);
+  Point position;
+  for(Page& page : pages) {
+    if(allocate(page, size, position)) {
+      return SurfaceImplPtr(new GlTexture(std::move(surface), page.texture.lock(), position));
+    }
+  }
+
+  //No room left, start a new page
+  std::shared_ptr<GlTexture> texture(new GlTexture(page_size));
+  pages.push_back(Page{texture, {}, 0});
+  allocate(pages.back(), Size(white_size, white_size), position); //The white block, at 0,0
+  allocate(pages.back(), size, position);
+  return SurfaceImplPtr(new GlTexture(std::move(surface), texture, position));
+}
+
+/**
+ * @brief get the size of the pages
+ * @return the width and height of a page
+ */
+int GlTextureAtlas::get_page_size() const {
+  return page_size;
+}
+
+/**
+ * @brief get the maximum size of a packed image
+ * @return the maximum width and height
+ */
+int GlTextureAtlas::get_max_image_size() const {
+  return max_image_size;
+}
+
+/**
+ * @brief get a white pixel of the pages
+ *
+ * It is the center of the white block, so that filtering does not mix it
+ * with the neighboring pixels.
+ *
+ * @return the region of the pixel in a page
+ */
+Rectangle GlTextureAtlas::get_white_texel() {
+  return Rectangle(white_size / 2, white_size / 2, 1, 1);
+}
+
+/**
+ * @brief Finds room for an image in a page
+ *
+ * Uses the shelf that wastes the least height, or opens a new one.
+ *
+ * @param page the page to allocate in
+ * @param size the size of the image
+ * @param position set to the top-left corner of the allocated rectangle
+ * @return true if there was enough room in the page
+ */
+bool GlTextureAtlas::allocate(Page& page, const Size& size, Point& position) {
+  const int width = size.width + padding;
+  const int height = size.height + padding;
+
+  Shelf* best = nullptr;
+  for(Shelf& shelf : page.shelves) {
+    if(height <= shelf.height &&
+       shelf.width + width <= page_size &&
+       (best == nullptr || shelf.height < best->height)) {
+      best = &shelf;
+    }
+  }
+
+  if(best == nullptr) {
+    if(page.height + height > page_size) {
+      return false;
+    }
+    page.shelves.push_back(Shelf{page.height, height, 0});
+    page.height += height;
+    best = &page.shelves.back();
+  }
+
+  position = Point(best->width, best->y);
+  best->width += width;
+  return true;
+}
+
+}
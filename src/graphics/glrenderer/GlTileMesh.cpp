@@ -0,0 +1,273 @@
+#include "solarus/graphics/glrenderer/GlTileMesh.h"
+#include "solarus/graphics/glrenderer/GlRenderer.h"
+#include "solarus/graphics/glrenderer/GlShader.h"
+#include "solarus/graphics/glrenderer/GlTexture.h"
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/DefaultShaders.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/VertexArray.h"
+
+#include <string>
+
+namespace Solarus {
+
+constexpr size_t TileMesh::max_quads;
+constexpr int TileMesh::max_slots;
+constexpr int TileMesh::max_tile_size;
+constexpr int TileMesh::max_repeats;
+
+namespace {
+
+/**
+ * Bits of the flags stored in the green component of the vertex color.
+ */
+enum TileFlag : uint8_t {
+  PARALLAX = 1,
+  SELF_SCROLLING = 2,
+  RIGHT_CORNER = 4,
+  BOTTOM_CORNER = 8,
+  REPEAT = 16
+};
+
+}
+
+/**
+ * @brief Uploads the vertices of some tiles
+ *
+ * The red component of the vertex color is the slot, the green one the flags
+ * and the blue and alpha ones the width and height of the tile divided by 8.
+ * For quads that repeat their region, the red component is instead the index
+ * of the repeat, whose image origin and map position are sent as uniforms.
+ *
+ * @param image the image of the tiles
+ * @param quads the tiles
+ */
+GlTileMesh::GlTileMesh(const SurfacePtr& image, const std::vector<Quad>& quads) :
+  image(image),
+  num_quads(quads.size()) {
+
+  Debug::check_assertion(num_quads <= max_quads, "Too many tiles in a tile mesh");
+  slot_offsets.fill(0.f);
+  repeats.fill(0.f);
+  int num_repeats = 0;
+
+  std::vector<Vertex> vertices;
+  vertices.reserve(num_quads * 4);
+  for(const Quad& quad : quads) {
+    const Rectangle& region = quad.region;
+    Debug::check_assertion(quad.slot >= 0 && quad.slot < max_slots, "Wrong tile slot");
+    Debug::check_assertion(
+          region.get_width() % 8 == 0 && region.get_width() <= max_tile_size &&
+          region.get_height() % 8 == 0 && region.get_height() <= max_tile_size,
+          "Wrong tile size");
+
+    Debug::check_assertion(
+          quad.size.width % region.get_width() == 0 && quad.size.width > 0 &&
+          quad.size.height % region.get_height() == 0 && quad.size.height > 0,
+          "Wrong tile quad size");
+
+    uint8_t flags = 0;
+    if(quad.parallax) {
+      flags |= PARALLAX;
+    }
+    if(quad.self_scrolling) {
+      flags |= SELF_SCROLLING;
+    }
+    int index = quad.slot;
+    if(quad.size != region.get_size()) {
+      Debug::check_assertion(quad.slot == 0 && num_repeats < max_repeats, "Too many repeated tiles");
+      flags |= REPEAT;
+      index = num_repeats;
+      repeats[num_repeats * 4] = region.get_x();
+      repeats[num_repeats * 4 + 1] = region.get_y();
+      repeats[num_repeats * 4 + 2] = quad.position.x;
+      repeats[num_repeats * 4 + 3] = quad.position.y;
+      ++num_repeats;
+    }
+    const Color data(index, flags, region.get_width() / 8, region.get_height() / 8);
+    const Point bottom_right = quad.position + Point(quad.size.width, quad.size.height);
+
+    //Same corner order as the sprite ring
+    vertices.emplace_back(quad.position, data, region.get_top_left());
+    vertices.emplace_back(Point(quad.position.x, bottom_right.y), data, region.get_bottom_left());
+    vertices.emplace_back(bottom_right, data, region.get_bottom_right());
+    vertices.emplace_back(Point(bottom_right.x, quad.position.y), data, region.get_top_right());
+    vertices[vertices.size() - 3].color.g |= BOTTOM_CORNER;
+    vertices[vertices.size() - 2].color.g |= RIGHT_CORNER | BOTTOM_CORNER;
+    vertices[vertices.size() - 1].color.g |= RIGHT_CORNER;
+  }
+
+  std::vector<GLushort> indices(num_quads * 6);
+  static constexpr std::array<GLushort,6> quad{{0,1,2,2,3,0}};
+  for(size_t i = 0; i < num_quads; i++) {
+    for(size_t j = 0; j < quad.size(); j++) {
+      indices[i*6 + j] = i*4 + quad[j];
+    }
+  }
+
+  GlRenderer& renderer = GlRenderer::get();
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+  glGenBuffers(1, &ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+  //Give the sprite ring back to the renderer
+  glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ibo);
+}
+
+/**
+ * @brief Destroys the buffers
+ */
+GlTileMesh::~GlTileMesh() {
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &ibo);
+}
+
+/**
+ * @copydoc TileMesh::set_slot_offset
+ */
+void GlTileMesh::set_slot_offset(int slot, const Point& offset) {
+  Debug::check_assertion(slot > 0 && slot < max_slots, "Wrong tile slot");
+  slot_offsets[slot * 2] = offset.x;
+  slot_offsets[slot * 2 + 1] = offset.y;
+}
+
+/**
+ * @copydoc TileMesh::draw
+ */
+void GlTileMesh::draw(Surface& dst_surface, const Point& viewport, size_t first_quad, size_t num_quads) {
+  Debug::check_assertion(first_quad + num_quads <= this->num_quads, "Wrong range of tiles");
+  if(num_quads == 0) {
+    return;
+  }
+
+  GlRenderer& renderer = GlRenderer::get();
+  GlShader& shader = renderer.tile_shader->as<GlShader>();
+  const GlTexture& texture = image->get_impl().as<GlTexture>();
+  GlTexture& target = dst_surface.get_impl().as<GlTexture>();
+
+  //Like sprites, read from the atlas page if the image is packed
+  const GlTexture* source = &texture;
+  Point atlas_position;
+  if(texture.is_packed()) {
+    source = &texture.get_atlas_page();
+    atlas_position = texture.get_atlas_position();
+  }
+  renderer.set_state(source, &shader, &target, renderer.make_gl_blend_modes(target, &texture, BlendMode::BLEND));
+
+  glUniform2f(shader.get_uniform_location("sol_tile_viewport"), viewport.x, viewport.y);
+  glUniform2f(shader.get_uniform_location("sol_tile_atlas_position"), atlas_position.x, atlas_position.y);
+  glUniform2fv(shader.get_uniform_location("sol_tile_slot_offsets"), max_slots, slot_offsets.data());
+  glUniform4fv(shader.get_uniform_location("sol_tile_repeats"), max_repeats, repeats.data());
+
+  //Point the vertex attributes to the tiles, draw, and restore the sprite ring
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  shader.bind();
+  glDrawElements(GL_TRIANGLES, num_quads*6, GL_UNSIGNED_SHORT,
+                 reinterpret_cast<void*>(first_quad*6*sizeof(GLushort)));
+  glBindBuffer(GL_ARRAY_BUFFER, renderer.vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.ibo);
+  shader.bind();
+
+  renderer.frame_stats.draw_calls++;
+  renderer.frame_stats.sprites += num_quads;
+}
+
+/**
+ * @brief get the vertex source of the tile shader
+ *
+ * The image region of a tile is moved by the offset of its slot. Self
+ * scrolling tiles start their image at half their position on the
+ * destination modulo their size, exactly like SelfScrollingTilePattern.
+ * Repeated quads get their image origin and map position from their repeat:
+ * the fragment shader wraps the image coordinates in the region.
+ *
+ * @return the vertex source
+ */
+const std::string& GlTileMesh::get_vertex_source() {
+
+  static const std::string source = DefaultShaders::get_default_vertex_compat_header() +
+R"(
+uniform mat4 sol_mvp_matrix;
+uniform mat3 sol_uv_matrix;
+uniform vec2 sol_tile_viewport;
+uniform vec2 sol_tile_atlas_position;
+uniform vec2 sol_tile_slot_offsets[)" + std::to_string(max_slots) + R"(];
+uniform vec4 sol_tile_repeats[)" + std::to_string(max_repeats) + R"(];
+COMPAT_ATTRIBUTE vec2 sol_vertex;
+COMPAT_ATTRIBUTE vec2 sol_tex_coord;
+COMPAT_ATTRIBUTE vec4 sol_color;
+COMPAT_VARYING vec2 sol_vtex_origin;
+COMPAT_VARYING vec2 sol_vtex_scale;
+COMPAT_VARYING vec2 sol_vtex_local;
+COMPAT_VARYING vec2 sol_vtex_size;
+
+float get_flag(float flags, float bit) {
+    return mod(floor(flags / bit), 2.0);
+}
+
+void main() {
+    vec4 data = floor(sol_color * 255.0 + 0.5);
+    float flags = data.g;
+    vec2 size = data.ba * 8.0;
+    vec2 corner;
+    vec2 origin;
+    if (get_flag(flags, 16.0) > 0.5) {
+        vec4 repeat = sol_tile_repeats[int(data.r)];
+        corner = sol_vertex - repeat.zw;
+        origin = repeat.xy;
+    }
+    else {
+        corner = vec2(get_flag(flags, 4.0), get_flag(flags, 8.0)) * size;
+        origin = sol_tex_coord - corner + sol_tile_slot_offsets[int(data.r)];
+    }
+
+    vec2 dst = sol_vertex - corner - sol_tile_viewport;
+    vec2 local = corner;
+    if (get_flag(flags, 2.0) > 0.5) {
+        vec2 offset = dst - size * floor((dst + 0.5) / size);
+        offset += size * vec2(equal(offset, vec2(0.0))) * vec2(lessThan(dst, vec2(0.0)));
+        local += floor(offset / 2.0);
+    }
+    if (get_flag(flags, 1.0) > 0.5) {
+        dst += sign(sol_tile_viewport) * floor(abs(sol_tile_viewport) / 2.0);
+    }
+    origin += sol_tile_atlas_position;
+
+    gl_Position = sol_mvp_matrix * vec4(dst + corner, 0.0, 1.0);
+    sol_vtex_origin = (sol_uv_matrix * vec3(origin, 1.0)).xy;
+    sol_vtex_scale = vec2(sol_uv_matrix[0][0], sol_uv_matrix[1][1]);
+    sol_vtex_local = local;
+    sol_vtex_size = size;
+}
+)";
+  return source;
+}
+
+/**
+ * @brief get the fragment source of the tile shader
+ * @return the fragment source
+ */
+const std::string& GlTileMesh::get_fragment_source() {
+
+  static const std::string source = DefaultShaders::get_default_fragment_compat_header() +
+R"(
+uniform sampler2D sol_texture;
+COMPAT_VARYING vec2 sol_vtex_origin;
+COMPAT_VARYING vec2 sol_vtex_scale;
+COMPAT_VARYING vec2 sol_vtex_local;
+COMPAT_VARYING vec2 sol_vtex_size;
+
+void main() {
+    vec2 local = mod(sol_vtex_local, sol_vtex_size);
+    FragColor = COMPAT_TEXTURE(sol_texture, sol_vtex_origin + local * sol_vtex_scale);
+}
+)";
+  return source;
+}
+
+}
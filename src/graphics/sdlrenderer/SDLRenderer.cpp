@@ -8,10 +8,13 @@
 
 #include <SDL_render.h>
 #include <SDL_hints.h>
+#include <cmath>
+#include <utility>
 
 namespace Solarus {
 
 SDLRenderer* SDLRenderer::instance = nullptr;
+bool SDLRenderer::batching_enabled = true;
 
 void SDLRenderer::SurfaceDraw::draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& params) const {
   SDLRenderer::get().draw(dst_surface.get_impl(),src_surface.get_impl(),params);
@@ -103,6 +106,7 @@ ShaderPtr SDLRenderer::create_shader(const std::string& vertex_source, const std
 
 void SDLRenderer::set_render_target(SDL_Texture* target) {
   if(target != render_target || !valid_target) {
+    flush_batch();
     SDL_SetRenderTarget(renderer, target);
     render_target=target;
     valid_target = true;
@@ -120,8 +124,21 @@ void SDLRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos
   }
 
   SDL_BlendMode mode = make_sdl_blend_mode(dst,src,infos.blend_mode);
-  SOLARUS_CHECK_SDL_HIGHER(SDL_SetTextureBlendMode(ssrc.get_texture(),mode),-1);
-  SOLARUS_CHECK_SDL(SDL_SetTextureAlphaMod(ssrc.get_texture(),infos.opacity));
+#if SDL_VERSION_ATLEAST(2,0,18)
+  if(add_to_batch(ssrc,infos,mode)) {
+    sdst.surface_dirty = true;
+    return;
+  }
+  flush_batch();
+#endif
+  ssrc.set_blend_mode(mode);
+  if(Video::is_premultiplied_alpha()) {
+    //Premultiply the opacity too, adding means keeping the destination alpha
+    ssrc.set_color_mod(infos.opacity);
+    ssrc.set_alpha_mod(infos.blend_mode == BlendMode::ADD ? 0 : infos.opacity);
+  } else {
+    ssrc.set_alpha_mod(infos.opacity);
+  }
   if(infos.should_use_ex()) {
     SDL_Point origin= infos.sdl_origin();
     SOLARUS_CHECK_SDL(SDL_RenderCopyEx(renderer,ssrc.get_texture(),infos.region,dst_rect,infos.rotation,&origin,infos.flips()));
@@ -131,13 +148,156 @@ void SDLRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos
   sdst.surface_dirty = true;
 }
 
+#if SDL_VERSION_ATLEAST(2,0,18)
+/**
+ * @brief add a draw to the pending batch
+ *
+ * Draws the pending batch first if it uses another texture or blend mode.
+ *
+ * @param src source surface
+ * @param infos draw infos
+ * @param mode blend mode to use
+ * @return false if this draw cannot be batched and needs SDL_RenderCopyEx
+ */
+bool SDLRenderer::add_to_batch(const SDLSurfaceImpl& src, const DrawInfos& infos, SDL_BlendMode mode) {
+  const Rectangle& region = infos.region;
+  if(!batching_enabled ||
+     !src.get_texture() ||
+     std::fabs(infos.rotation) > 1e-3 ||
+     region.get_x() < 0 ||
+     region.get_y() < 0 ||
+     region.get_x() + region.get_width() > src.get_width() ||
+     region.get_y() + region.get_height() > src.get_height()) {
+    //SDL_RenderCopy clips the region to the texture, geometry would not
+    return false;
+  }
+
+  if(&src != batch_source || mode != batch_blend_mode) {
+    flush_batch();
+    batch_source = &src;
+    batch_blend_mode = mode;
+  }
+
+  const Rectangle dst_rect = infos.dst_rectangle();
+  const float x0 = dst_rect.get_x();
+  const float y0 = dst_rect.get_y();
+  const float x1 = x0 + dst_rect.get_width();
+  const float y1 = y0 + dst_rect.get_height();
+  float u0 = region.get_x() / static_cast<float>(src.get_width());
+  float v0 = region.get_y() / static_cast<float>(src.get_height());
+  float u1 = (region.get_x() + region.get_width()) / static_cast<float>(src.get_width());
+  float v1 = (region.get_y() + region.get_height()) / static_cast<float>(src.get_height());
+  if(infos.scale.x < 0.f) {
+    std::swap(u0,u1);
+  }
+  if(infos.scale.y < 0.f) {
+    std::swap(v0,v1);
+  }
+
+  //Opacity goes to the vertices: the alpha modulation of the texture is
+  //left to 255 while the batch is drawn
+  SDL_Color color = {255,255,255,infos.opacity};
+  if(Video::is_premultiplied_alpha()) {
+    //Premultiplied: blend and add share the blend mode and thus the batch
+    color = {infos.opacity,infos.opacity,infos.opacity,
+             infos.blend_mode == BlendMode::ADD ? Uint8(0) : infos.opacity};
+  }
+  const int first = static_cast<int>(batch_vertices.size());
+  batch_vertices.push_back({{x0,y0},color,{u0,v0}});
+  batch_vertices.push_back({{x1,y0},color,{u1,v0}});
+  batch_vertices.push_back({{x0,y1},color,{u0,v1}});
+  batch_vertices.push_back({{x1,y1},color,{u1,v1}});
+  batch_indices.insert(batch_indices.end(),{
+    first, first + 1, first + 2,
+    first + 2, first + 1, first + 3
+  });
+  return true;
+}
+#endif
+
+/**
+ * @brief submit the pending batch, if any, to the current render target
+ *
+ * Must be called before anything else uses the renderer, reads the
+ * render target or modifies the texture of the batch.
+ */
+void SDLRenderer::flush_batch() {
+#if SDL_VERSION_ATLEAST(2,0,18)
+  if(batch_vertices.empty()) {
+    return;
+  }
+  batch_source->set_blend_mode(batch_blend_mode);
+  batch_source->set_alpha_mod(255);
+  if(Video::is_premultiplied_alpha()) {
+    batch_source->set_color_mod(255);
+  }
+  SOLARUS_CHECK_SDL(SDL_RenderGeometry(renderer,
+                                       batch_source->get_texture(),
+                                       batch_vertices.data(),
+                                       static_cast<int>(batch_vertices.size()),
+                                       batch_indices.data(),
+                                       static_cast<int>(batch_indices.size())));
+  batch_vertices.clear();
+  batch_indices.clear();
+  batch_source = nullptr;
+#endif
+}
+
+/**
+ * @brief forget about a surface whose texture is being destroyed
+ *
+ * Draws the pending batch if it reads this texture, or discards it if it
+ * writes to it.
+ *
+ * @param surf the surface being destroyed
+ */
+void SDLRenderer::on_texture_destroyed(const SDLSurfaceImpl& surf) {
+  if(instance == nullptr) {
+    return;
+  }
+#if SDL_VERSION_ATLEAST(2,0,18)
+  if(surf.get_texture() != nullptr && surf.get_texture() == instance->render_target) {
+    instance->batch_vertices.clear();
+    instance->batch_indices.clear();
+    instance->batch_source = nullptr;
+  } else if(&surf == instance->batch_source) {
+    instance->flush_batch();
+  }
+#else
+  (void) surf;
+#endif
+}
+
+/**
+ * @brief set whether draws are batched with SDL_RenderGeometry
+ *
+ * Has no effect if SDL is older than 2.0.18.
+ *
+ * @param enabled true to batch draws
+ */
+void SDLRenderer::set_batching_enabled(bool enabled) {
+  if(instance != nullptr) {
+    instance->flush_batch();
+  }
+  batching_enabled = enabled;
+}
+
+/**
+ * @brief returns whether draws are batched with SDL_RenderGeometry
+ * @return true if draws are batched
+ */
+bool SDLRenderer::is_batching_enabled() {
+  return batching_enabled;
+}
+
 void SDLRenderer::clear(SurfaceImpl& dst) {
   SDLSurfaceImpl& sdst = dst.as<SDLSurfaceImpl>().targetable();
   set_render_target(sdst.get_texture());
+  flush_batch();
 
   SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(renderer,0,0,0,0));
   if(sdst.get_texture()) { //texture can be nullptr in case of the screen
-    SOLARUS_CHECK_SDL(SDL_SetTextureBlendMode(sdst.get_texture(),SDL_BLENDMODE_BLEND));
+    sdst.set_blend_mode(SDL_BLENDMODE_BLEND);
   }
   SOLARUS_CHECK_SDL(SDL_RenderClear(renderer));
 
@@ -147,14 +307,43 @@ void SDLRenderer::clear(SurfaceImpl& dst) {
 void SDLRenderer::fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode) {
   SDLSurfaceImpl& sdst = dst.as<SDLSurfaceImpl>().targetable();
   set_render_target(sdst.get_texture());
+  flush_batch();
 
+  set_draw_color(color,mode);
+  SOLARUS_CHECK_SDL(SDL_RenderFillRect(renderer,where));
+
+  sdst.surface_dirty = true;
+}
+
+void SDLRenderer::draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode) {
+  SDLSurfaceImpl& sdst = dst.as<SDLSurfaceImpl>().targetable();
+  set_render_target(sdst.get_texture());
+  flush_batch();
+
+  set_draw_color(color,mode);
+  SOLARUS_CHECK_SDL(SDL_RenderDrawLine(renderer,from.x,from.y,to.x,to.y));
+
+  sdst.surface_dirty = true;
+}
+
+/**
+ * @brief set the color and blend mode of the primitives drawn by SDL
+ * @param color the color
+ * @param mode the solarus blend mode
+ */
+void SDLRenderer::set_draw_color(const Color& color, BlendMode mode) {
   Uint8 r,g,b,a;
   color.get_components(r,g,b,a);
+  if(Video::is_premultiplied_alpha()) {
+    r = (r * a) / 255;
+    g = (g * a) / 255;
+    b = (b * a) / 255;
+    if(mode == BlendMode::ADD) {
+      a = 0;
+    }
+  }
   SOLARUS_CHECK_SDL(SDL_SetRenderDrawColor(renderer,r,g,b,a));
   SOLARUS_CHECK_SDL(SDL_SetRenderDrawBlendMode(renderer,make_sdl_blend_mode(mode)));
-  SOLARUS_CHECK_SDL(SDL_RenderFillRect(renderer,where));
-
-  sdst.surface_dirty = true;
 }
 
 void SDLRenderer::invalidate(const SurfaceImpl& surf) {
@@ -166,6 +355,7 @@ void SDLRenderer::invalidate(const SurfaceImpl& surf) {
 }
 
 void SDLRenderer::bind_as_gl_target(SurfaceImpl &surf) {
+  flush_batch();
   SDL_GL_BindTexture(surf.as<SDLSurfaceImpl>().get_texture(),nullptr,nullptr);
 }
 
@@ -180,6 +370,7 @@ std::string SDLRenderer::get_name() const {
 }
 
 void SDLRenderer::present(SDL_Window* /*window*/) {
+  flush_batch();
   SDL_RenderPresent(renderer);
 }
 
@@ -195,6 +386,9 @@ void SDLRenderer::on_window_size_changed(const Rectangle& viewport) {
  * @return a sdl blendmode taking premultiply into account
  */
 SDL_BlendMode SDLRenderer::make_sdl_blend_mode(const SurfaceImpl& dst_surface, const SurfaceImpl& src_surface, BlendMode blend_mode) {
+  if(Video::is_premultiplied_alpha()) {
+    return make_sdl_blend_mode(blend_mode);
+  }
   if(dst_surface.is_premultiplied()) { //TODO refactor this a bit
     switch(blend_mode) {
       case BlendMode::NONE:
@@ -237,6 +431,30 @@ SDL_BlendMode SDLRenderer::make_sdl_blend_mode(const SurfaceImpl& dst_surface, c
 }
 
 SDL_BlendMode SDLRenderer::make_sdl_blend_mode(BlendMode blend_mode) {
+  if(Video::is_premultiplied_alpha()) {
+    //Everything is premultiplied: blend and add only differ by the vertex alpha
+    switch (blend_mode) {
+    case BlendMode::BLEND:
+    case BlendMode::ADD:
+      return SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD);
+    case BlendMode::MULTIPLY:
+      return SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_DST_COLOR,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE,
+            SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+            SDL_BLENDOPERATION_ADD);
+    case BlendMode::NONE:
+      return SDL_BLENDMODE_NONE;
+    }
+  }
   switch (blend_mode) {
   case BlendMode::ADD:
     return SDL_BLENDMODE_ADD;
@@ -252,6 +470,7 @@ SDL_BlendMode SDLRenderer::make_sdl_blend_mode(BlendMode blend_mode) {
 
 SDLRenderer::~SDLRenderer() {
   SDL_DestroyRenderer(renderer);
+  instance = nullptr;
 }
 
 }
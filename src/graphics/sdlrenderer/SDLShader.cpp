@@ -22,6 +22,7 @@
 #include "solarus/graphics/sdlrenderer/SDLRenderer.h"
 #include "solarus/graphics/sdlrenderer/SDLSurfaceImpl.h"
 #include "solarus/graphics/Video.h"
+#include "solarus/graphics/FrameDamage.h"
 #include "solarus/graphics/Surface.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
@@ -49,6 +50,7 @@ bool SDLShader::initialize() {
   setup_version_string();
 
   //Init screen quad
+  screen_quad.set_usage(STATIC);
   screen_quad.add_quad(Rectangle(0,0,1,1),Rectangle(0,1,1,-1),Color::white);
 
   Logger::info("Using SDL GL_Context hack Shaders");
@@ -269,8 +271,17 @@ void SDLShader::render(const VertexArray& array, const Surface& texture, const g
   glGetIntegerv(GL_ARRAY_BUFFER_BINDING,&previous_buffer);
   glBindBuffer(GL_ARRAY_BUFFER,array.vertex_buffer);
   if(array.buffer_dirty) {
-    //Upload vertex buffer //TODO use glSubData if array size <= previous size
-    glBufferData(GL_ARRAY_BUFFER,array.vertex_count()*sizeof(Vertex),array.data(),GL_DYNAMIC_DRAW);
+    //Upload vertex buffer, in the existing storage unless the array grew
+    //or is streamed
+    const GLsizeiptr size = array.vertex_count()*sizeof(Vertex);
+    if(array.get_usage() != STREAM &&
+       array.vertex_count() > 0 &&
+       array.vertex_count() <= array.buffer_capacity) {
+      glBufferSubData(GL_ARRAY_BUFFER,0,size,array.data());
+    } else {
+      glBufferData(GL_ARRAY_BUFFER,size,array.data(),static_cast<GLenum>(array.get_usage()));
+      array.buffer_capacity = array.vertex_count();
+    }
     array.buffer_dirty = false;
   }
   glUniformMatrix4fv(get_uniform_location(Shader::MVP_MATRIX_NAME),1,GL_FALSE,glm::value_ptr(mvp_matrix));
@@ -326,11 +337,20 @@ GLint SDLShader::get_uniform_location(const std::string& uniform_name) const {
 }
 
 /**
- * \copydoc Shader::set_uniform1f
+ * \copydoc Shader::resolve_uniform
+ */
+void SDLShader::resolve_uniform(int handle, const std::string& uniform_name) {
+
+  Debug::check_assertion(handle == static_cast<int>(handle_locations.size()), "Wrong uniform handle");
+  handle_locations.push_back(get_uniform_location(uniform_name));
+}
+
+/**
+ * \copydoc Shader::set_uniform_1b
  */
-void SDLShader::set_uniform_1b(const std::string& uniform_name, bool value) {
+void SDLShader::set_uniform_1b(int handle, bool value) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = handle_locations[handle];
   if (location == -1) {
     return;
   }
@@ -345,9 +365,9 @@ void SDLShader::set_uniform_1b(const std::string& uniform_name, bool value) {
 /**
  * \copydoc Shader::set_uniform_1i
  */
-void SDLShader::set_uniform_1i(const std::string& uniform_name, int value) {
+void SDLShader::set_uniform_1i(int handle, int value) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = handle_locations[handle];
   if (location == -1) {
     return;
   }
@@ -362,9 +382,9 @@ void SDLShader::set_uniform_1i(const std::string& uniform_name, int value) {
 /**
  * \copydoc Shader::set_uniform_1f
  */
-void SDLShader::set_uniform_1f(const std::string& uniform_name, float value) {
+void SDLShader::set_uniform_1f(int handle, float value) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = handle_locations[handle];
   if (location == -1) {
     return;
   }
@@ -379,9 +399,9 @@ void SDLShader::set_uniform_1f(const std::string& uniform_name, float value) {
 /**
  * \copydoc Shader::set_uniform_2f
  */
-void SDLShader::set_uniform_2f(const std::string& uniform_name, float value_1, float value_2) {
+void SDLShader::set_uniform_2f(int handle, float value_1, float value_2) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = handle_locations[handle];
   if (location == -1) {
     return;
   }
@@ -397,9 +417,9 @@ void SDLShader::set_uniform_2f(const std::string& uniform_name, float value_1, f
  * \copydoc Shader::set_uniform_3f
  */
 void SDLShader::set_uniform_3f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3) {
+    int handle, float value_1, float value_2, float value_3) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = handle_locations[handle];
   if (location == -1) {
     return;
   }
@@ -415,9 +435,9 @@ void SDLShader::set_uniform_3f(
  * \copydoc Shader::set_uniform_4f
  */
 void SDLShader::set_uniform_4f(
-    const std::string& uniform_name, float value_1, float value_2, float value_3, float value_4) {
+    int handle, float value_1, float value_2, float value_3, float value_4) {
 
-  const GLint location = get_uniform_location(uniform_name);
+  const GLint location = handle_locations[handle];
   if (location == -1) {
     return;
   }
@@ -432,14 +452,15 @@ void SDLShader::set_uniform_4f(
 /**
  * \copydoc Shader::set_uniform_texture
  */
-bool SDLShader::set_uniform_texture(const std::string& uniform_name, const SurfacePtr& value) {
-  const GLint location = get_uniform_location(uniform_name);
+bool SDLShader::set_uniform_texture(int handle, const SurfacePtr& value) {
+  const GLint location = handle_locations[handle];
 
   if (location == -1) {
     // Not an error.
     return true;
   }
 
+  const std::string& uniform_name = get_uniform_name(handle);
   auto it = uniform_textures.find(uniform_name);
   if(it != uniform_textures.end()) {
     it->second.surface = value;
@@ -534,12 +555,14 @@ void SDLShader::render(const Surface &surface, const Rectangle& region, const Si
   //Set input size
   const Size& size = flip_y ? Video::get_output_size() : dst_size;
   set_uniform_1i(Shader::TIME_NAME, System::now());
+  FrameDamage::notify();
   set_uniform_2f(Shader::OUTPUT_SIZE_NAME, size.width, size.height);
   set_uniform_2f(Shader::INPUT_SIZE_NAME, region.get_width(), region.get_height());
   render(screen_quad,surface,viewport*dst*scale,uvm);
 }
 
 void SDLShader::draw(Surface& dst_surface, const Surface &src_surface, const DrawInfos &infos) const {
+    SDLRenderer::get().flush_batch();
     SDLRenderer::get().set_render_target(dst_surface.get_impl().as<SDLSurfaceImpl>().get_texture());
     auto r = SDLRenderer::get().renderer;
     SDL_BlendMode target = SDLRenderer::get().make_sdl_blend_mode(dst_surface.get_impl(),
@@ -572,6 +595,7 @@ void SDLShader::draw(Surface& dst_surface, const Surface &src_surface, const Dra
     //Set input size
     const Size& size = dst_size;
     that->set_uniform_1i(Shader::TIME_NAME, System::now());
+    FrameDamage::notify();
     that->set_uniform_2f(Shader::OUTPUT_SIZE_NAME, size.width, size.height);
     that->set_uniform_2f(Shader::INPUT_SIZE_NAME, region.get_width(), region.get_height());
     that->render(screen_quad,src_surface,viewport*transform,uvm);
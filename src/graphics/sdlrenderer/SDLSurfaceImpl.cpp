@@ -39,6 +39,7 @@ SDLSurfaceImpl::SDLSurfaceImpl(SDL_Renderer *renderer, int width, int height, bo
   Debug::check_assertion(surf_ptr != nullptr,
                          std::string("Failed to create backup surface ") + SDL_GetError());
   surface.reset(surf_ptr);
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
 }
 
 SDLSurfaceImpl::SDLSurfaceImpl(SDL_Renderer* renderer, SDL_Surface_UniquePtr surface)
@@ -47,6 +48,11 @@ SDLSurfaceImpl::SDLSurfaceImpl(SDL_Renderer* renderer, SDL_Surface_UniquePtr sur
   Debug::check_assertion(tex != nullptr,
         std::string("Failed to convert surface to texture") + SDL_GetError());
   texture.reset(tex);
+  memory_tracker.set_bytes(static_cast<int64_t>(this->surface->w) * this->surface->h * 4);
+}
+
+SDLSurfaceImpl::~SDLSurfaceImpl() {
+  SDLRenderer::on_texture_destroyed(*this);
 }
 
 /**
@@ -58,6 +64,7 @@ SDLSurfaceImpl::SDLSurfaceImpl(SDL_Renderer* renderer, SDL_Surface_UniquePtr sur
 void SDLSurfaceImpl::upload_surface() {
   Rectangle rect(0,0,get_width(),get_height());
   SDL_Surface* surface = get_surface();
+  SDLRenderer::get().flush_batch();
   SDL_UpdateTexture(get_texture(),
                     rect,
                     surface->pixels,
@@ -65,6 +72,23 @@ void SDLSurfaceImpl::upload_surface() {
                     );
 }
 
+/**
+ * @brief upload a modified region of the surface
+ * @param region the region to upload
+ */
+void SDLSurfaceImpl::upload_region(const Rectangle& region) {
+  SDL_Surface* surface = get_surface();
+  SDLRenderer::get().flush_batch();
+  const uint8_t* pixels = static_cast<const uint8_t*>(surface->pixels) +
+      region.get_y() * surface->pitch +
+      region.get_x() * surface->format->BytesPerPixel;
+  SDL_UpdateTexture(get_texture(),
+                    region,
+                    pixels,
+                    surface->pitch
+                    );
+}
+
 /**
  * \copydoc SurfaceImpl::get_texture
  */
@@ -78,6 +102,7 @@ SDL_Texture* SDLSurfaceImpl::get_texture() const {
 SDL_Surface* SDLSurfaceImpl::get_surface() const {
   if (target and surface_dirty) {
     SDLRenderer::get().set_render_target(get_texture());
+    SDLRenderer::get().flush_batch();
     SOLARUS_CHECK_SDL(SDL_RenderReadPixels(SDLRenderer::get().renderer,
                          NULL,
                          Video::get_pixel_format()->format,
@@ -89,6 +114,45 @@ SDL_Surface* SDLSurfaceImpl::get_surface() const {
   return surface.get();
 }
 
+/**
+ * @brief set the blend mode of the texture, unless it already has it
+ * @param mode the blend mode
+ */
+void SDLSurfaceImpl::set_blend_mode(SDL_BlendMode mode) const {
+  if(blend_mode_known && blend_mode == mode) {
+    return;
+  }
+  SOLARUS_CHECK_SDL_HIGHER(SDL_SetTextureBlendMode(get_texture(),mode),-1);
+  blend_mode = mode;
+  blend_mode_known = true;
+}
+
+/**
+ * @brief set the alpha modulation of the texture, unless it already has it
+ * @param alpha the alpha modulation
+ */
+void SDLSurfaceImpl::set_alpha_mod(Uint8 alpha) const {
+  if(alpha_mod_known && alpha_mod == alpha) {
+    return;
+  }
+  SOLARUS_CHECK_SDL(SDL_SetTextureAlphaMod(get_texture(),alpha));
+  alpha_mod = alpha;
+  alpha_mod_known = true;
+}
+
+/**
+ * @brief set a gray color modulation of the texture, unless it already has it
+ * @param color the modulation of the red, green and blue components
+ */
+void SDLSurfaceImpl::set_color_mod(Uint8 color) const {
+  if(color_mod_known && color_mod == color) {
+    return;
+  }
+  SOLARUS_CHECK_SDL(SDL_SetTextureColorMod(get_texture(),color,color,color));
+  color_mod = color;
+  color_mod_known = true;
+}
+
 SDLSurfaceImpl& SDLSurfaceImpl::targetable()  {
   if(target) {
     surface_dirty = true;
@@ -101,6 +165,9 @@ SDLSurfaceImpl& SDLSurfaceImpl::targetable()  {
     SDL_SetTextureBlendMode(get_texture(),SDL_BLENDMODE_NONE);
     SDL_RenderCopy(r.renderer,get_texture(),nullptr,nullptr);
     texture.reset(tex);
+    blend_mode_known = false;
+    alpha_mod_known = false;
+    color_mod_known = false;
   }
   return *this;
 }
@@ -0,0 +1,853 @@
+#include <solarus/graphics/softwarerenderer/SoftwareRenderer.h>
+#include <solarus/graphics/softwarerenderer/SoftwareShader.h>
+#include <solarus/graphics/softwarerenderer/SoftwareSurfaceImpl.h>
+#include <solarus/graphics/PixelFilterExecutor.h>
+#include <solarus/graphics/SoftwarePixelFilter.h>
+#include <solarus/graphics/Surface.h>
+#include <solarus/graphics/Video.h>
+#include <solarus/core/Debug.h>
+#include <solarus/core/Geometry.h>
+
+#include <SDL_video.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define SOLARUS_SOFTWARE_RENDERER_X86
+#  include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#  define SOLARUS_SOFTWARE_RENDERER_TARGET(x) __attribute__((target(x)))
+#else
+#  define SOLARUS_SOFTWARE_RENDERER_TARGET(x)
+#endif
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * @brief divides by 255 with rounding a product of 8-bit values
+ * @param x the product, at most 255 * 255 * 2
+ * @return the quotient
+ */
+inline uint32_t div_255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * @brief returns the source step between two destination pixels,
+ * in 16.16 fixed point
+ * @param src_size size of the source region
+ * @param dst_size size of the destination rectangle
+ * @return the step
+ */
+inline int64_t get_step(int src_size, int dst_size) {
+  return (static_cast<int64_t>(src_size) << 16) / dst_size;
+}
+
+/**
+ * @brief returns the source offset sampled by a destination pixel
+ *
+ * Pixels are sampled at their center, like SDL_RenderCopy does.
+ *
+ * @param dst_offset offset of the pixel in the destination rectangle
+ * @param step result of get_step()
+ * @return offset in the source region
+ */
+inline int get_source_offset(int dst_offset, int64_t step) {
+  return static_cast<int>((dst_offset * step + step / 2) >> 16);
+}
+
+#ifdef SOLARUS_SOFTWARE_RENDERER_X86
+
+/**
+ * @brief divides by 255 with rounding eight 16-bit products
+ */
+SOLARUS_SOFTWARE_RENDERER_TARGET("sse2")
+inline __m128i div_255_epu16(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/**
+ * @brief blends a row 4 pixels at a time with SSE2
+ *
+ * The alpha of pixels must be their last byte.
+ *
+ * @param dst the destination pixels
+ * @param src the source pixels
+ * @param num_pixels number of pixels of the row
+ * @param premultiplied whether the source colors are premultiplied
+ * @return number of pixels blended, the remaining ones are left to scalar code
+ */
+SOLARUS_SOFTWARE_RENDERER_TARGET("sse2")
+int blend_row_sse2(uint32_t* dst, const uint32_t* src, int num_pixels, bool premultiplied) {
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max = _mm_set1_epi16(255);
+  const __m128i color_lanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  const __m128i alpha_lanes = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const int alpha_bytes = 0x8888;
+
+  int i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const int transparent = _mm_movemask_epi8(_mm_cmpeq_epi8(s, zero));
+    if (premultiplied ? transparent == 0xFFFF : (transparent & alpha_bytes) == alpha_bytes) {
+      continue;
+    }
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(s, _mm_set1_epi8(-1))) & alpha_bytes) == alpha_bytes) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+      continue;
+    }
+
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    const __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+    const __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+    const __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+    const __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+    const __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inv_a_lo = _mm_sub_epi16(max, a_lo);
+    const __m128i inv_a_hi = _mm_sub_epi16(max, a_hi);
+
+    __m128i result_lo;
+    __m128i result_hi;
+    if (premultiplied) {
+      result_lo = _mm_add_epi16(s_lo, div_255_epu16(_mm_mullo_epi16(d_lo, inv_a_lo)));
+      result_hi = _mm_add_epi16(s_hi, div_255_epu16(_mm_mullo_epi16(d_hi, inv_a_hi)));
+    }
+    else {
+      // Colors are weighted by the source alpha, the alpha itself by 255.
+      const __m128i f_lo = _mm_or_si128(_mm_and_si128(a_lo, color_lanes), alpha_lanes);
+      const __m128i f_hi = _mm_or_si128(_mm_and_si128(a_hi, color_lanes), alpha_lanes);
+      result_lo = div_255_epu16(_mm_add_epi16(_mm_mullo_epi16(s_lo, f_lo), _mm_mullo_epi16(d_lo, inv_a_lo)));
+      result_hi = div_255_epu16(_mm_add_epi16(_mm_mullo_epi16(s_hi, f_hi), _mm_mullo_epi16(d_hi, inv_a_hi)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(result_lo, result_hi));
+  }
+  return i;
+}
+
+#endif
+
+}
+
+SoftwareRenderer* SoftwareRenderer::instance = nullptr;
+bool SoftwareRenderer::enabled = true;
+constexpr int SoftwareRenderer::min_pixels_per_job;
+
+void SoftwareRenderer::SurfaceDraw::draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& params) const {
+  SoftwareRenderer::get().draw(dst_surface.get_impl(),src_surface.get_impl(),params);
+}
+
+SoftwareRenderer::SoftwareRenderer() :
+  alpha_shift(Video::get_pixel_format()->Ashift) {
+  Debug::check_assertion(!instance,"Creating two software renderers");
+  instance = this; //Set this renderer as the unique instance
+}
+
+/**
+ * @brief creates the software renderer if software rendering is forced
+ * @param window the window, nullptr for window-less tests
+ * @param force_software whether software rendering is forced
+ * @return the renderer, or nullptr to let SDLRenderer draw
+ */
+RendererPtr SoftwareRenderer::create(SDL_Window* window, bool force_software) {
+  if(!window || !force_software || !enabled) {
+    return nullptr;
+  }
+  if(!SDL_GetWindowSurface(window)) {
+    return nullptr;
+  }
+  return RendererPtr(new SoftwareRenderer());
+}
+
+SurfaceImplPtr SoftwareRenderer::create_texture(int width, int height) {
+  return std::make_shared<SoftwareSurfaceImpl>(width, height);
+}
+
+SurfaceImplPtr SoftwareRenderer::create_texture(SDL_Surface_UniquePtr&& surface) {
+  return std::make_shared<SoftwareSurfaceImpl>(std::move(surface));
+}
+
+SurfaceImplPtr SoftwareRenderer::create_window_surface(SDL_Window* /*w*/, int width, int height) {
+  auto surface = std::make_shared<SoftwareSurfaceImpl>(width, height);
+  window_surface = surface.get();
+  return surface;
+}
+
+ShaderPtr SoftwareRenderer::create_shader(const std::string& shader_id) {
+  return std::make_shared<SoftwareShader>(shader_id);
+}
+
+ShaderPtr SoftwareRenderer::create_shader(const std::string& vertex_source, const std::string& fragment_source, double scaling_factor) {
+  return std::make_shared<SoftwareShader>(
+                     vertex_source,
+                     fragment_source,
+                     scaling_factor);
+}
+
+/**
+ * @brief set the surface written by the pending batch, flushing the batch
+ * if it writes another one
+ * @param target the surface to write
+ */
+void SoftwareRenderer::set_target(const SoftwareSurfaceImpl& target) {
+  if(&target == batch_target) {
+    return;
+  }
+  flush_batch();
+  batch_target = &target;
+  target.in_batch = true;
+}
+
+/**
+ * @brief remember that the pending batch reads a surface
+ * @param source the surface read, or nullptr
+ */
+void SoftwareRenderer::add_to_batch(const SoftwareSurfaceImpl* source) {
+  if(source != nullptr && !source->in_batch) {
+    source->in_batch = true;
+    batch_sources.push_back(source);
+  }
+}
+
+void SoftwareRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos) {
+  const SoftwareSurfaceImpl& sdst = dst.as<SoftwareSurfaceImpl>();
+  const SoftwareSurfaceImpl* ssrc = &src.as<SoftwareSurfaceImpl>();
+
+  Command command;
+  set_pixel_op(command, dst, src, infos.blend_mode, infos.opacity);
+  if(infos.opacity == 0 &&
+     (command.op == PixelOp::BLEND ||
+      command.op == PixelOp::PREMULTIPLIED_BLEND ||
+      command.op == PixelOp::ADD)) {
+    return;
+  }
+
+  const Rectangle dst_rect = infos.dst_rectangle();
+  command.region = infos.region;
+  command.dst = dst_rect;
+  command.flip_x = infos.scale.x < 0.f;
+  command.flip_y = infos.scale.y < 0.f;
+  if(dst_rect.is_flat() || command.region.is_flat()) {
+    return;
+  }
+
+  //Like SDL_RenderCopy, only draw the part of the region inside the source
+  const Rectangle clipped = command.region & Rectangle(0, 0, ssrc->get_width(), ssrc->get_height());
+  if(clipped.is_flat()) {
+    return;
+  }
+  if(!(clipped == command.region)) {
+    const double scale_x = dst_rect.get_width() / static_cast<double>(command.region.get_width());
+    const double scale_y = dst_rect.get_height() / static_cast<double>(command.region.get_height());
+    int left = clipped.get_x() - command.region.get_x();
+    int right = command.region.get_x() + command.region.get_width() - clipped.get_x() - clipped.get_width();
+    int top = clipped.get_y() - command.region.get_y();
+    int bottom = command.region.get_y() + command.region.get_height() - clipped.get_y() - clipped.get_height();
+    if(command.flip_x) {
+      std::swap(left, right);
+    }
+    if(command.flip_y) {
+      std::swap(top, bottom);
+    }
+    const int dst_left = static_cast<int>(std::lround(left * scale_x));
+    const int dst_right = static_cast<int>(std::lround(right * scale_x));
+    const int dst_top = static_cast<int>(std::lround(top * scale_y));
+    const int dst_bottom = static_cast<int>(std::lround(bottom * scale_y));
+    command.region = clipped;
+    command.dst = Rectangle(
+          dst_rect.get_x() + dst_left,
+          dst_rect.get_y() + dst_top,
+          dst_rect.get_width() - dst_left - dst_right,
+          dst_rect.get_height() - dst_top - dst_bottom);
+    if(command.dst.get_width() <= 0 || command.dst.get_height() <= 0) {
+      return;
+    }
+  }
+
+  const Rectangle target_rect(0, 0, sdst.get_width(), sdst.get_height());
+  if(std::fabs(infos.rotation) > 1e-3) {
+    //Rotate the corners of the destination around the origin, clockwise
+    const SDL_Point origin = infos.sdl_origin();
+    const double angle = infos.rotation * Geometry::PI / 180.0;
+    command.rotated = true;
+    command.center_x = dst_rect.get_x() + origin.x;
+    command.center_y = dst_rect.get_y() + origin.y;
+    command.cos_angle = std::cos(angle);
+    command.sin_angle = std::sin(angle);
+    double min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    for(int corner = 0; corner < 4; ++corner) {
+      const double x = command.dst.get_x() + ((corner & 1) ? command.dst.get_width() : 0) - command.center_x;
+      const double y = command.dst.get_y() + ((corner & 2) ? command.dst.get_height() : 0) - command.center_y;
+      const double rotated_x = command.center_x + x * command.cos_angle - y * command.sin_angle;
+      const double rotated_y = command.center_y + x * command.sin_angle + y * command.cos_angle;
+      min_x = std::min(min_x, rotated_x);
+      max_x = std::max(max_x, rotated_x);
+      min_y = std::min(min_y, rotated_y);
+      max_y = std::max(max_y, rotated_y);
+    }
+    command.bounds = Rectangle(
+          Point(static_cast<int>(std::floor(min_x)), static_cast<int>(std::floor(min_y))),
+          Point(static_cast<int>(std::ceil(max_x)), static_cast<int>(std::ceil(max_y)))) & target_rect;
+  } else {
+    command.bounds = command.dst & target_rect;
+  }
+  if(command.bounds.is_flat()) {
+    return;
+  }
+
+  if(ssrc == &sdst) {
+    //The batch would read the pixels it writes: draw a copy instead
+    flush_batch();
+    set_target(sdst);
+    SDL_Surface* pixels = sdst.surface.get();
+    SDL_Surface_UniquePtr copy(SDL_ConvertSurface(pixels, pixels->format, 0));
+    Debug::check_assertion(copy != nullptr,
+                           std::string("Failed to copy software surface ") + SDL_GetError());
+    auto copy_impl = std::make_shared<SoftwareSurfaceImpl>(std::move(copy));
+    batch_copies.push_back(copy_impl);
+    ssrc = copy_impl.get();
+  } else {
+    set_target(sdst);
+  }
+  command.source = ssrc;
+  add_to_batch(ssrc);
+  batch.push_back(command);
+  batch_pixels += static_cast<int64_t>(command.bounds.get_width()) * command.bounds.get_height();
+  frame_stats.sprites++;
+}
+
+void SoftwareRenderer::clear(SurfaceImpl& dst) {
+  const SoftwareSurfaceImpl& sdst = dst.as<SoftwareSurfaceImpl>();
+  if(&sdst == batch_target) {
+    //Everything pending is overwritten anyway
+    discard_batch();
+  }
+  set_target(sdst);
+
+  Command command;
+  command.op = PixelOp::COPY;
+  command.color = 0;
+  command.dst = Rectangle(0, 0, sdst.get_width(), sdst.get_height());
+  command.bounds = command.dst;
+  batch.push_back(command);
+  batch_pixels += static_cast<int64_t>(command.bounds.get_width()) * command.bounds.get_height();
+}
+
+void SoftwareRenderer::fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode) {
+  const SoftwareSurfaceImpl& sdst = dst.as<SoftwareSurfaceImpl>();
+
+  Command command;
+  set_color(command, color, mode);
+  command.dst = where;
+  command.bounds = where & Rectangle(0, 0, sdst.get_width(), sdst.get_height());
+  if(command.bounds.is_flat()) {
+    return;
+  }
+  set_target(sdst);
+  batch.push_back(command);
+  batch_pixels += static_cast<int64_t>(command.bounds.get_width()) * command.bounds.get_height();
+}
+
+void SoftwareRenderer::draw_line(SurfaceImpl& dst, const Color& color, const Point& from, const Point& to, BlendMode mode) {
+  const SoftwareSurfaceImpl& sdst = dst.as<SoftwareSurfaceImpl>();
+
+  Command command;
+  set_color(command, color, mode);
+  command.line = true;
+  command.dst = Rectangle(from.x, from.y, 1, 1);
+  command.line_end = to;
+  command.bounds = Rectangle(
+        Point(std::min(from.x, to.x), std::min(from.y, to.y)),
+        Point(std::max(from.x, to.x) + 1, std::max(from.y, to.y) + 1)) &
+      Rectangle(0, 0, sdst.get_width(), sdst.get_height());
+  if(command.bounds.is_flat()) {
+    return;
+  }
+  set_target(sdst);
+  batch.push_back(command);
+  batch_pixels += std::max(command.bounds.get_width(), command.bounds.get_height());
+}
+
+/**
+ * @brief choose how a draw combines pixels, like
+ * SDLRenderer::make_sdl_blend_mode() and the texture modulations of
+ * SDLRenderer::draw()
+ * @param command the draw
+ * @param dst written to surface
+ * @param src read from surface
+ * @param mode the solarus blend mode
+ * @param opacity the opacity of the draw
+ */
+void SoftwareRenderer::set_pixel_op(Command& command, const SurfaceImpl& dst, const SurfaceImpl& src, BlendMode mode, uint8_t opacity) const {
+  if(Video::is_premultiplied_alpha()) {
+    //Premultiply the opacity too, adding means keeping the destination alpha
+    command.color_mod = opacity;
+    command.alpha_mod = mode == BlendMode::ADD ? 0 : opacity;
+    switch(mode) {
+      case BlendMode::NONE:
+        command.op = PixelOp::COPY;
+        break;
+      case BlendMode::MULTIPLY:
+        command.op = PixelOp::PREMULTIPLIED_MULTIPLY;
+        break;
+      case BlendMode::BLEND:
+      case BlendMode::ADD:
+        command.op = PixelOp::PREMULTIPLIED_BLEND;
+        break;
+    }
+    return;
+  }
+
+  command.color_mod = 255;
+  command.alpha_mod = opacity;
+  switch(mode) {
+    case BlendMode::NONE:
+      command.op = PixelOp::COPY;
+      break;
+    case BlendMode::MULTIPLY:
+      command.op = PixelOp::MULTIPLY;
+      break;
+    case BlendMode::ADD:
+      command.op = PixelOp::ADD;
+      break;
+    case BlendMode::BLEND:
+      command.op = (!dst.is_premultiplied() && src.is_premultiplied()) ?
+            PixelOp::PREMULTIPLIED_BLEND : PixelOp::BLEND;
+      break;
+  }
+}
+
+/**
+ * @brief set the solid color of a fill or a line, like
+ * SDLRenderer::set_draw_color()
+ * @param command the fill or line
+ * @param color the color
+ * @param mode the solarus blend mode
+ */
+void SoftwareRenderer::set_color(Command& command, const Color& color, BlendMode mode) const {
+  Uint8 r,g,b,a;
+  color.get_components(r,g,b,a);
+  PixelOp op = PixelOp::BLEND;
+  if(Video::is_premultiplied_alpha()) {
+    r = (r * a) / 255;
+    g = (g * a) / 255;
+    b = (b * a) / 255;
+    if(mode == BlendMode::ADD) {
+      a = 0;
+    }
+    op = mode == BlendMode::NONE ? PixelOp::COPY :
+         mode == BlendMode::MULTIPLY ? PixelOp::PREMULTIPLIED_MULTIPLY :
+         PixelOp::PREMULTIPLIED_BLEND;
+  } else {
+    op = mode == BlendMode::NONE ? PixelOp::COPY :
+         mode == BlendMode::MULTIPLY ? PixelOp::MULTIPLY :
+         mode == BlendMode::ADD ? PixelOp::ADD :
+         PixelOp::BLEND;
+  }
+  command.op = op;
+  command.color = SDL_MapRGBA(Video::get_pixel_format(), r, g, b, a);
+}
+
+/**
+ * @brief execute the pending batch
+ *
+ * The rows written by the batch are split into bands, drawn in parallel
+ * unless the batch is small. Must be called before anything reads or
+ * modifies the surfaces of the batch.
+ */
+void SoftwareRenderer::flush_batch() {
+  if(batch.empty()) {
+    discard_batch();
+    return;
+  }
+
+#ifdef SOLARUS_SOFTWARE_RENDERER_X86
+  simd = alpha_shift == 24 &&
+      SoftwarePixelFilter::get_simd() != SoftwarePixelFilter::Simd::NONE;
+#endif
+
+  int first_row = INT_MAX;
+  int end_row = 0;
+  for(const Command& command : batch) {
+    first_row = std::min(first_row, command.bounds.get_y());
+    end_row = std::max(end_row, command.bounds.get_y() + command.bounds.get_height());
+  }
+
+  const int width = batch_target->get_width();
+  const PixelFilterExecutor::BandFunction band_function =
+      [this, width, first_row](int first_band_row, int num_rows) {
+    std::vector<uint32_t> row_buffer(width);
+    for(const Command& command : batch) {
+      execute(command, first_row + first_band_row, first_row + first_band_row + num_rows, row_buffer);
+    }
+  };
+  if(batch_pixels < min_pixels_per_job) {
+    band_function(0, end_row - first_row);
+  } else {
+    PixelFilterExecutor::run(end_row - first_row, band_function);
+  }
+  frame_stats.draw_calls++;
+
+  discard_batch();
+}
+
+/**
+ * @brief forget the pending batch without executing it
+ */
+void SoftwareRenderer::discard_batch() {
+  if(batch_target != nullptr) {
+    batch_target->in_batch = false;
+  }
+  for(const SoftwareSurfaceImpl* source : batch_sources) {
+    source->in_batch = false;
+  }
+  batch_target = nullptr;
+  batch.clear();
+  batch_sources.clear();
+  batch_pixels = 0;
+  std::vector<SurfaceImplPtr> copies;
+  copies.swap(batch_copies);
+}
+
+/**
+ * @brief execute a command on some rows of the target
+ * @param command the command
+ * @param first_row first row to write
+ * @param end_row row after the last one to write
+ * @param row_buffer buffer of at least the width of the target
+ */
+void SoftwareRenderer::execute(const Command& command, int first_row, int end_row, std::vector<uint32_t>& row_buffer) const {
+  if(command.line) {
+    execute_line(command, first_row, end_row);
+    return;
+  }
+  if(command.rotated) {
+    execute_rotated(command, first_row, end_row, row_buffer);
+    return;
+  }
+
+  const Rectangle& bounds = command.bounds;
+  const int y_begin = std::max(first_row, bounds.get_y());
+  const int y_end = std::min(end_row, bounds.get_y() + bounds.get_height());
+  const int x_begin = bounds.get_x();
+  const int width = bounds.get_width();
+
+  if(command.source == nullptr) {
+    std::fill(row_buffer.begin(), row_buffer.begin() + width, command.color);
+    for(int y = y_begin; y < y_end; ++y) {
+      blend_row(command, batch_target->get_row(y) + x_begin, row_buffer.data(), width);
+    }
+    return;
+  }
+
+  const Rectangle& region = command.region;
+  const Rectangle& dst = command.dst;
+  const int64_t step_x = get_step(region.get_width(), dst.get_width());
+  const int64_t step_y = get_step(region.get_height(), dst.get_height());
+  const bool resampled = command.flip_x || region.get_width() != dst.get_width();
+  for(int y = y_begin; y < y_end; ++y) {
+    const int offset_y = get_source_offset(y - dst.get_y(), step_y);
+    const int src_y = command.flip_y ?
+          region.get_y() + region.get_height() - 1 - offset_y :
+          region.get_y() + offset_y;
+    const uint32_t* src_row = command.source->get_row(src_y);
+    const uint32_t* src_pixels = src_row + region.get_x() + (x_begin - dst.get_x());
+    if(resampled) {
+      //Nearest neighbour: gather the source pixels of the row
+      int64_t position = (x_begin - dst.get_x()) * step_x + step_x / 2;
+      const int last_x = region.get_x() + region.get_width() - 1;
+      for(int i = 0; i < width; ++i) {
+        const int offset_x = static_cast<int>(position >> 16);
+        row_buffer[i] = src_row[command.flip_x ? last_x - offset_x : region.get_x() + offset_x];
+        position += step_x;
+      }
+      src_pixels = row_buffer.data();
+    }
+    blend_row(command, batch_target->get_row(y) + x_begin, src_pixels, width);
+  }
+}
+
+/**
+ * @brief execute a rotated draw on some rows of the target
+ *
+ * Each pixel of the bounds is rotated back into the destination rectangle
+ * to find its source pixel. The rotated rectangle is convex: the pixels it
+ * covers in a row are blended as one run.
+ *
+ * @param command the rotated draw
+ * @param first_row first row to write
+ * @param end_row row after the last one to write
+ * @param row_buffer buffer of at least the width of the target
+ */
+void SoftwareRenderer::execute_rotated(const Command& command, int first_row, int end_row, std::vector<uint32_t>& row_buffer) const {
+  const Rectangle& bounds = command.bounds;
+  const Rectangle& region = command.region;
+  const Rectangle& dst = command.dst;
+  const int y_begin = std::max(first_row, bounds.get_y());
+  const int y_end = std::min(end_row, bounds.get_y() + bounds.get_height());
+  const double scale_x = region.get_width() / static_cast<double>(dst.get_width());
+  const double scale_y = region.get_height() / static_cast<double>(dst.get_height());
+
+  for(int y = y_begin; y < y_end; ++y) {
+    const double dy = y + 0.5 - command.center_y;
+    int run_start = 0;
+    int run_length = 0;
+    for(int x = bounds.get_x(); x < bounds.get_x() + bounds.get_width(); ++x) {
+      const double dx = x + 0.5 - command.center_x;
+      const double u = command.center_x + dx * command.cos_angle + dy * command.sin_angle - dst.get_x();
+      const double v = command.center_y - dx * command.sin_angle + dy * command.cos_angle - dst.get_y();
+      if(u < 0.0 || v < 0.0 || u >= dst.get_width() || v >= dst.get_height()) {
+        if(run_length > 0) {
+          break;
+        }
+        continue;
+      }
+      if(run_length == 0) {
+        run_start = x;
+      }
+      const int offset_x = std::min(static_cast<int>(u * scale_x), region.get_width() - 1);
+      const int offset_y = std::min(static_cast<int>(v * scale_y), region.get_height() - 1);
+      const int src_x = command.flip_x ?
+            region.get_x() + region.get_width() - 1 - offset_x :
+            region.get_x() + offset_x;
+      const int src_y = command.flip_y ?
+            region.get_y() + region.get_height() - 1 - offset_y :
+            region.get_y() + offset_y;
+      row_buffer[run_length++] = command.source->get_row(src_y)[src_x];
+    }
+    if(run_length > 0) {
+      blend_row(command, batch_target->get_row(y) + run_start, row_buffer.data(), run_length);
+    }
+  }
+}
+
+/**
+ * @brief execute a line on some rows of the target, with Bresenham's algorithm
+ * @param command the line
+ * @param first_row first row to write
+ * @param end_row row after the last one to write
+ */
+void SoftwareRenderer::execute_line(const Command& command, int first_row, int end_row) const {
+  const Rectangle& bounds = command.bounds;
+  int x = command.dst.get_x();
+  int y = command.dst.get_y();
+  const int to_x = command.line_end.x;
+  const int to_y = command.line_end.y;
+  const int dx = std::abs(to_x - x);
+  const int dy = -std::abs(to_y - y);
+  const int step_x = x < to_x ? 1 : -1;
+  const int step_y = y < to_y ? 1 : -1;
+  int error = dx + dy;
+  while(true) {
+    if(y >= first_row && y < end_row &&
+       x >= bounds.get_x() && x < bounds.get_x() + bounds.get_width() &&
+       y >= bounds.get_y() && y < bounds.get_y() + bounds.get_height()) {
+      blend_pixels(command, batch_target->get_row(y) + x, &command.color, 1);
+    }
+    if(x == to_x && y == to_y) {
+      break;
+    }
+    const int error_2 = 2 * error;
+    if(error_2 >= dy) {
+      error += dy;
+      x += step_x;
+    }
+    if(error_2 <= dx) {
+      error += dx;
+      y += step_y;
+    }
+  }
+}
+
+/**
+ * @brief combine a row of source pixels with a row of the target
+ * @param command the command drawing the row
+ * @param dst the target pixels
+ * @param src the source pixels
+ * @param num_pixels number of pixels of the row
+ */
+void SoftwareRenderer::blend_row(const Command& command, uint32_t* dst, const uint32_t* src, int num_pixels) const {
+  if(command.color_mod == 255 && command.alpha_mod == 255) {
+    if(command.op == PixelOp::COPY) {
+      std::memcpy(dst, src, num_pixels * sizeof(uint32_t));
+      return;
+    }
+#ifdef SOLARUS_SOFTWARE_RENDERER_X86
+    if(simd && (command.op == PixelOp::BLEND || command.op == PixelOp::PREMULTIPLIED_BLEND)) {
+      const int done = blend_row_sse2(dst, src, num_pixels, command.op == PixelOp::PREMULTIPLIED_BLEND);
+      dst += done;
+      src += done;
+      num_pixels -= done;
+    }
+#endif
+  }
+  blend_pixels(command, dst, src, num_pixels);
+}
+
+/**
+ * @brief combine source pixels with target pixels one by one
+ * @param command the command drawing the pixels
+ * @param dst the target pixels
+ * @param src the source pixels
+ * @param num_pixels number of pixels
+ */
+void SoftwareRenderer::blend_pixels(const Command& command, uint32_t* dst, const uint32_t* src, int num_pixels) const {
+  const uint32_t color_mod = command.color_mod;
+  const uint32_t alpha_mod = command.alpha_mod;
+  for(int i = 0; i < num_pixels; ++i) {
+    const uint32_t s = src[i];
+    const uint32_t d = dst[i];
+    const uint32_t src_alpha = div_255(((s >> alpha_shift) & 0xFF) * alpha_mod);
+    const uint32_t dst_alpha = (d >> alpha_shift) & 0xFF;
+    const uint32_t inv_alpha = 255 - src_alpha;
+    if(command.op == PixelOp::BLEND && src_alpha == 0) {
+      continue;
+    }
+
+    uint32_t alpha = dst_alpha;
+    if(command.op == PixelOp::COPY) {
+      alpha = src_alpha;
+    } else if(command.op != PixelOp::ADD && command.op != PixelOp::MULTIPLY) {
+      alpha = src_alpha + div_255(dst_alpha * inv_alpha);
+    }
+    uint32_t result = std::min(alpha, 255u) << alpha_shift;
+
+    for(int shift = 0; shift < 32; shift += 8) {
+      if(shift == alpha_shift) {
+        continue;
+      }
+      const uint32_t src_color = div_255(((s >> shift) & 0xFF) * color_mod);
+      const uint32_t dst_color = (d >> shift) & 0xFF;
+      uint32_t color = 0;
+      switch(command.op) {
+        case PixelOp::COPY:
+          color = src_color;
+          break;
+        case PixelOp::BLEND:
+          color = div_255(src_color * src_alpha + dst_color * inv_alpha);
+          break;
+        case PixelOp::PREMULTIPLIED_BLEND:
+          color = src_color + div_255(dst_color * inv_alpha);
+          break;
+        case PixelOp::ADD:
+          color = dst_color + div_255(src_color * src_alpha);
+          break;
+        case PixelOp::MULTIPLY:
+          color = div_255(src_color * dst_color);
+          break;
+        case PixelOp::PREMULTIPLIED_MULTIPLY:
+          color = div_255(src_color * dst_color + dst_color * inv_alpha);
+          break;
+      }
+      result |= std::min(color, 255u) << shift;
+    }
+    dst[i] = result;
+  }
+}
+
+/**
+ * @brief forget about a surface being destroyed
+ *
+ * Executes the pending batch if it reads this surface, or discards it if
+ * it writes to it.
+ *
+ * @param surf the surface being destroyed
+ */
+void SoftwareRenderer::on_surface_destroyed(const SoftwareSurfaceImpl& surf) {
+  if(instance == nullptr) {
+    return;
+  }
+  if(&surf == instance->window_surface) {
+    instance->window_surface = nullptr;
+  }
+  if(!surf.in_batch) {
+    return;
+  }
+  if(&surf == instance->batch_target) {
+    instance->discard_batch();
+  } else {
+    instance->flush_batch();
+  }
+}
+
+/**
+ * @brief set whether the software renderer draws when software rendering
+ * is forced
+ *
+ * Otherwise, SDLRenderer draws with the software renderer of SDL.
+ *
+ * @param enabled true to use this renderer
+ */
+void SoftwareRenderer::set_enabled(bool enabled) {
+  SoftwareRenderer::enabled = enabled;
+}
+
+/**
+ * @brief returns whether the software renderer draws when software
+ * rendering is forced
+ * @return true if this renderer is used
+ */
+bool SoftwareRenderer::is_enabled() {
+  return enabled;
+}
+
+void SoftwareRenderer::invalidate(const SurfaceImpl& /*surf*/) {
+}
+
+void SoftwareRenderer::bind_as_gl_target(SurfaceImpl& /*surf*/) {
+  flush_batch();
+}
+
+void SoftwareRenderer::bind_as_gl_texture(const SurfaceImpl& /*surf*/) {
+  flush_batch();
+}
+
+std::string SoftwareRenderer::get_name() const {
+  return std::string("SoftwareRenderer : ") +
+      std::to_string(PixelFilterExecutor::get_num_threads()) + " threads";
+}
+
+Renderer::FrameStats SoftwareRenderer::get_last_frame_stats() const {
+  return last_frame_stats;
+}
+
+void SoftwareRenderer::present(SDL_Window* window) {
+  flush_batch();
+  last_frame_stats = frame_stats;
+  frame_stats = FrameStats();
+
+  SDL_Surface* window_pixels = SDL_GetWindowSurface(window);
+  if(window_pixels == nullptr) {
+    return;
+  }
+  SDL_FillRect(window_pixels, nullptr, SDL_MapRGB(window_pixels->format, 0, 0, 0));
+  if(window_surface != nullptr) {
+    SDL_Surface* screen = window_surface->surface.get();
+    SDL_Rect where = {viewport.get_x(), viewport.get_y(), viewport.get_width(), viewport.get_height()};
+    SDL_SetSurfaceBlendMode(screen, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(screen, nullptr, window_pixels, &where);
+  }
+  SDL_UpdateWindowSurface(window);
+}
+
+void SoftwareRenderer::on_window_size_changed(const Rectangle& viewport) {
+  this->viewport = viewport;
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+  discard_batch();
+  instance = nullptr;
+}
+
+}
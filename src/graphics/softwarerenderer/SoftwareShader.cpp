@@ -0,0 +1,90 @@
+#include "solarus/graphics/softwarerenderer/SoftwareShader.h"
+#include "solarus/graphics/softwarerenderer/SoftwareRenderer.h"
+#include "solarus/graphics/Surface.h"
+
+namespace Solarus {
+
+/**
+ * \brief Creates a shader from a shader resource file.
+ * \param shader_id Id of the shader resource.
+ */
+SoftwareShader::SoftwareShader(const std::string& shader_id):
+  Shader(shader_id) {
+  set_error("shaders unavailable");
+}
+
+/**
+ * \brief Creates a shader from vertex and fragment source.
+ * \param vertex_source Vertex shader code.
+ * \param fragment_source Fragment shader code.
+ * \param scaling_factor Scaling factor of the shader.
+ */
+SoftwareShader::SoftwareShader(const std::string& vertex_source,
+                               const std::string& fragment_source,
+                               double scaling_factor):
+  Shader(vertex_source, fragment_source, scaling_factor) {
+  set_error("shaders unavailable");
+}
+
+/**
+ * \copydoc Shader::set_uniform_1b
+ */
+void SoftwareShader::set_uniform_1b(int /* handle */, bool /* value */) {
+}
+
+/**
+ * \copydoc Shader::set_uniform_1i
+ */
+void SoftwareShader::set_uniform_1i(int /* handle */, int /* value */) {
+}
+
+/**
+ * \copydoc Shader::set_uniform_1f
+ */
+void SoftwareShader::set_uniform_1f(int /* handle */, float /* value */) {
+}
+
+/**
+ * \copydoc Shader::set_uniform_2f
+ */
+void SoftwareShader::set_uniform_2f(int /* handle */, float /* value_1 */, float /* value_2 */) {
+}
+
+/**
+ * \copydoc Shader::set_uniform_3f
+ */
+void SoftwareShader::set_uniform_3f(
+    int /* handle */, float /* value_1 */, float /* value_2 */, float /* value_3 */) {
+}
+
+/**
+ * \copydoc Shader::set_uniform_4f
+ */
+void SoftwareShader::set_uniform_4f(
+    int /* handle */, float /* value_1 */, float /* value_2 */, float /* value_3 */, float /* value_4 */) {
+}
+
+/**
+ * \copydoc Shader::set_uniform_texture
+ */
+bool SoftwareShader::set_uniform_texture(int /* handle */, const SurfacePtr& /* value */) {
+  return false;
+}
+
+/**
+ * \copydoc Shader::resolve_uniform
+ */
+void SoftwareShader::resolve_uniform(int /* handle */, const std::string& /* uniform_name */) {
+}
+
+/**
+ * \brief Draws a surface without any effect.
+ * \param dst_surface The destination surface.
+ * \param src_surface The surface to draw.
+ * \param infos The draw parameters.
+ */
+void SoftwareShader::draw(Surface& dst_surface, const Surface& src_surface, const DrawInfos& infos) const {
+  SoftwareRenderer::get().draw(dst_surface.get_impl(), src_surface.get_impl(), infos);
+}
+
+}
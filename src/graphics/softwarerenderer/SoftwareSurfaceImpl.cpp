@@ -0,0 +1,100 @@
+#include "solarus/graphics/softwarerenderer/SoftwareSurfaceImpl.h"
+#include "solarus/graphics/softwarerenderer/SoftwareRenderer.h"
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Video.h"
+#include <string>
+#include <utility>
+
+namespace Solarus {
+
+/**
+ * @brief Creates a transparent surface
+ * @param width width of the surface
+ * @param height height of the surface
+ */
+SoftwareSurfaceImpl::SoftwareSurfaceImpl(int width, int height) {
+  SDL_PixelFormat* format = Video::get_pixel_format();
+  SDL_Surface* surf_ptr = SDL_CreateRGBSurface(
+       0,
+       width,
+       height,
+       32,
+       format->Rmask,
+       format->Gmask,
+       format->Bmask,
+       format->Amask);
+  Debug::check_assertion(surf_ptr != nullptr,
+                         std::string("Failed to create software surface ") + SDL_GetError());
+  surface.reset(surf_ptr);
+  memory_tracker.set_bytes(static_cast<int64_t>(width) * height * 4);
+}
+
+/**
+ * @brief Creates a surface from pixels
+ * @param surface the pixels, converted to the pixel format of the renderer if needed
+ */
+SoftwareSurfaceImpl::SoftwareSurfaceImpl(SDL_Surface_UniquePtr surface)
+  : surface(std::move(surface)) {
+  SDL_PixelFormat* format = Video::get_pixel_format();
+  if(this->surface->format->format != format->format) {
+    SDL_Surface* converted = SDL_ConvertSurface(this->surface.get(), format, 0);
+    Debug::check_assertion(converted != nullptr,
+                           std::string("Failed to convert software surface ") + SDL_GetError());
+    this->surface.reset(converted);
+  }
+  memory_tracker.set_bytes(static_cast<int64_t>(this->surface->w) * this->surface->h * 4);
+}
+
+SoftwareSurfaceImpl::~SoftwareSurfaceImpl() {
+  SoftwareRenderer::on_surface_destroyed(*this);
+}
+
+/**
+ * \copydoc SurfaceImpl::get_surface
+ *
+ * Executes the pending draws first if they involve this surface.
+ */
+SDL_Surface* SoftwareSurfaceImpl::get_surface() const {
+  if(in_batch) {
+    SoftwareRenderer::get().flush_batch();
+  }
+  return surface.get();
+}
+
+/**
+ * @brief does nothing: the surface is the only copy of the pixels
+ */
+void SoftwareSurfaceImpl::upload_surface() {
+}
+
+/**
+ * @brief does nothing: the surface is the only copy of the pixels
+ * @param region the modified region
+ */
+void SoftwareSurfaceImpl::upload_region(const Rectangle& /* region */) {
+}
+
+/**
+ * @brief returns a row of pixels, without executing the pending draws
+ * @param y the row
+ * @return the first pixel of the row
+ */
+uint32_t* SoftwareSurfaceImpl::get_row(int y) const {
+  return reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch);
+}
+
+/**
+ * \copydoc SurfaceImpl::get_width
+ */
+int SoftwareSurfaceImpl::get_width() const {
+  return surface->w;
+}
+
+/**
+ * \copydoc SurfaceImpl::get_height
+ */
+int SoftwareSurfaceImpl::get_height() const {
+  return surface->h;
+}
+
+}
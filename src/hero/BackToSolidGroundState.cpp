@@ -105,9 +105,8 @@ void Hero::BackToSolidGroundState::start(const State* previous_state) {
   ));
   get_entities().set_entity_layer(hero, layer);
 
-  const std::set<std::shared_ptr<Boomerang>>& boomerangs =
-      get_entities().get_entities_by_type<Boomerang>();
-  for (const std::shared_ptr<Boomerang>& boomerang : boomerangs) {
+  for (const std::shared_ptr<Boomerang>& boomerang :
+      get_entities().get_entities_by_type<Boomerang>()) {
     boomerang->remove_from_map();
   }
 }
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
 #include "solarus/core/Geometry.h"
@@ -62,7 +63,7 @@ void Hero::BoomerangState::start(const State* previous_state) {
   const bool boomerang_exists = !get_map().get_entities().get_entities_by_type<Boomerang>().empty();
   if (boomerang_exists) {
     Hero& hero = get_entity();
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
   else {
     get_sprites().set_animation_boomerang(tunic_preparing_animation);
@@ -93,7 +94,7 @@ void Hero::BoomerangState::update() {
       boomerang_direction8 = direction_pressed8;
     }
     double angle = Geometry::degrees_to_radians(boomerang_direction8 * 45);
-    get_entities().add_entity(std::make_shared<Boomerang>(
+    get_entities().add_entity(make_pooled<Boomerang>(
         std::static_pointer_cast<Hero>(get_entity().shared_from_this()),
         max_distance,
         speed,
@@ -101,7 +102,7 @@ void Hero::BoomerangState::update() {
         sprite_name
     ));
 
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
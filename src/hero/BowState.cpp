@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/hero/BowState.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -53,8 +54,8 @@ void Hero::BowState::update() {
   Hero& hero = get_entity();
   if (get_sprites().is_animation_finished()) {
     Sound::play("bow");
-    get_entities().add_entity(std::make_shared<Arrow>(hero));
-    hero.set_state(std::make_shared<FreeState>(hero));
+    get_entities().add_entity(make_pooled<Arrow>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
@@ -149,7 +150,7 @@ void Hero::CarryingState::update() {
       if (carried_object->is_broken()) {
         carried_object = nullptr;
         Hero& hero = get_entity();
-        hero.set_state(std::make_shared<FreeState>(hero));
+        hero.set_state(make_pooled<FreeState>(hero));
       }
     }
   }
@@ -163,7 +164,7 @@ void Hero::CarryingState::notify_action_command_pressed() {
   if (get_commands_effects().get_action_key_effect() == CommandsEffects::ACTION_KEY_THROW) {
     throw_item();
     Hero& hero = get_entity();
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
@@ -42,6 +42,48 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Returns whether a kind of ground is traversable in custom states
+ * unless the state decides otherwise.
+ * \param ground A kind of ground.
+ * \return \c true if this kind of ground is traversable by default.
+ */
+bool get_default_can_traverse_ground(Ground ground) {
+
+  switch (ground) {
+
+    case Ground::EMPTY:
+    case Ground::TRAVERSABLE:
+    case Ground::GRASS:
+    case Ground::ICE:
+    case Ground::LADDER:
+    case Ground::DEEP_WATER:
+    case Ground::SHALLOW_WATER:
+    case Ground::HOLE:
+    case Ground::PRICKLE:
+    case Ground::LAVA:
+      return true;
+
+    case Ground::WALL:
+    case Ground::LOW_WALL:
+    case Ground::WALL_TOP_RIGHT:
+    case Ground::WALL_TOP_LEFT:
+    case Ground::WALL_BOTTOM_LEFT:
+    case Ground::WALL_BOTTOM_RIGHT:
+    case Ground::WALL_TOP_RIGHT_WATER:
+    case Ground::WALL_TOP_LEFT_WATER:
+    case Ground::WALL_BOTTOM_LEFT_WATER:
+    case Ground::WALL_BOTTOM_RIGHT_WATER:
+      return false;
+  }
+
+  return false;
+}
+
+}
+
 /**
  * \brief Constructor.
  * \param lua_context The Lua context.
@@ -90,6 +132,9 @@ CustomState::CustomState(
   can_traverse_entities_type(),
   can_traverse_grounds() {
 
+  for (size_t i = 0; i < num_grounds; ++i) {
+    can_traverse_grounds[i] = get_default_can_traverse_ground(static_cast<Ground>(i));
+  }
 }
 
 /**
@@ -568,10 +613,10 @@ const TraversableInfo& CustomState::get_can_traverse_entity_info(
     EntityType type) {
 
   // Find the obstacle settings.
-  const auto it = can_traverse_entities_type.find(type);
-  if (it != can_traverse_entities_type.end()) {
+  const TraversableInfo& info = can_traverse_entities_type[static_cast<size_t>(type)];
+  if (!info.is_empty()) {
     // This entity type overrides the general setting.
-    return it->second;
+    return info;
   }
 
   return can_traverse_entities_general;
@@ -605,12 +650,18 @@ void CustomState::set_can_traverse_entities(bool traversable) {
  * set_can_traverse_entities(EntityType, const ScopedLuaRef&).
  *
  * \param traversable_test_ref Lua ref to a function that will do the test.
+ * \param pure \c true if the function gives the same result for a given
+ * entity during a whole tick.
  */
-void CustomState::set_can_traverse_entities(const ScopedLuaRef& traversable_test_ref) {
+void CustomState::set_can_traverse_entities(
+    const ScopedLuaRef& traversable_test_ref,
+    bool pure
+) {
 
   can_traverse_entities_general = TraversableInfo(
       get_lua_context(),
-      traversable_test_ref
+      traversable_test_ref,
+      pure
   );
 }
 
@@ -646,7 +697,7 @@ void CustomState::set_can_traverse_entities(
     bool traversable
 ) {
 
-  can_traverse_entities_type[type] = TraversableInfo(
+  can_traverse_entities_type[static_cast<size_t>(type)] = TraversableInfo(
       get_lua_context(),
       traversable
   );
@@ -663,15 +714,19 @@ void CustomState::set_can_traverse_entities(
  *
  * \param type A type of entities.
  * \param traversable_test_ref Lua ref to a function that will do the test.
+ * \param pure \c true if the function gives the same result for a given
+ * entity during a whole tick.
  */
 void CustomState::set_can_traverse_entities(
     EntityType type,
-    const ScopedLuaRef& traversable_test_ref
+    const ScopedLuaRef& traversable_test_ref,
+    bool pure
 ) {
 
-  can_traverse_entities_type[type] = TraversableInfo(
+  can_traverse_entities_type[static_cast<size_t>(type)] = TraversableInfo(
       get_lua_context(),
-      traversable_test_ref
+      traversable_test_ref,
+      pure
   );
 }
 
@@ -688,7 +743,7 @@ void CustomState::set_can_traverse_entities(
  */
 void CustomState::reset_can_traverse_entities(EntityType type) {
 
-  can_traverse_entities_type.erase(type);
+  can_traverse_entities_type[static_cast<size_t>(type)] = TraversableInfo();
 }
 
 /**
@@ -878,42 +933,7 @@ bool CustomState::is_separator_obstacle(Separator& separator) {
  */
 bool CustomState::get_can_traverse_ground(Ground ground) const {
 
-  const auto& it = can_traverse_grounds.find(ground);
-
-  if (it != can_traverse_grounds.end()) {
-    // Return the boolean value that was set.
-    return it->second;
-  }
-
-  // Return a default value.
-  switch (ground) {
-
-    case Ground::EMPTY:
-    case Ground::TRAVERSABLE:
-    case Ground::GRASS:
-    case Ground::ICE:
-    case Ground::LADDER:
-    case Ground::DEEP_WATER:
-    case Ground::SHALLOW_WATER:
-    case Ground::HOLE:
-    case Ground::PRICKLE:
-    case Ground::LAVA:
-      return true;
-
-    case Ground::WALL:
-    case Ground::LOW_WALL:
-    case Ground::WALL_TOP_RIGHT:
-    case Ground::WALL_TOP_LEFT:
-    case Ground::WALL_BOTTOM_LEFT:
-    case Ground::WALL_BOTTOM_RIGHT:
-    case Ground::WALL_TOP_RIGHT_WATER:
-    case Ground::WALL_TOP_LEFT_WATER:
-    case Ground::WALL_BOTTOM_LEFT_WATER:
-    case Ground::WALL_BOTTOM_RIGHT_WATER:
-      return false;
-  }
-
-  return false;
+  return can_traverse_grounds[static_cast<size_t>(ground)];
 }
 
 /**
@@ -923,7 +943,10 @@ bool CustomState::get_can_traverse_ground(Ground ground) const {
  */
 void CustomState::set_can_traverse_ground(Ground ground, bool traversable) {
 
-  can_traverse_grounds[ground] = traversable;
+  can_traverse_grounds[static_cast<size_t>(ground)] = traversable;
+  if (has_entity()) {
+    get_entity().notify_ground_obstacles_changed();
+  }
 }
 
 /**
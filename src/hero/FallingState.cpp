@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/hero/BackToSolidGroundState.h"
@@ -80,7 +81,7 @@ void Hero::FallingState::update() {
     else {
       // normal hole that hurts the hero
       get_equipment().remove_life(2);
-      hero.set_state(std::make_shared<BackToSolidGroundState>(hero, true));
+      hero.set_state(make_pooled<BackToSolidGroundState>(hero, true));
     }
   }
 }
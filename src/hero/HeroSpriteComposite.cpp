@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Map.h"
+#include "solarus/core/Size.h"
+#include "solarus/entities/Camera.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/hero/HeroSpriteComposite.h"
+#include <algorithm>
+#include <functional>
+
+namespace Solarus {
+
+constexpr int HeroSpriteComposite::width;
+constexpr int HeroSpriteComposite::initial_height;
+constexpr int HeroSpriteComposite::max_height;
+
+/**
+ * \brief Compares two layers.
+ * \param other Another layer.
+ * \return \c true if they draw the same image at the same place.
+ */
+bool HeroSpriteComposite::Layer::operator==(const Layer& other) const {
+
+  return animation_set == other.animation_set &&
+      animation == other.animation &&
+      direction == other.direction &&
+      frame == other.frame &&
+      xy == other.xy;
+}
+
+/**
+ * \brief Returns a hash value of some layers.
+ * \param layers The layers.
+ * \return The hash value.
+ */
+size_t HeroSpriteComposite::LayersHash::operator()(const std::vector<Layer>& layers) const {
+
+  size_t hash = layers.size();
+  const auto combine = [&hash](size_t value) {
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  };
+  for (const Layer& layer : layers) {
+    combine(std::hash<const SpriteAnimationSet*>()(layer.animation_set));
+    combine(layer.animation.hash());
+    combine(static_cast<size_t>(layer.direction));
+    combine(static_cast<size_t>(layer.frame));
+    combine(static_cast<size_t>(layer.xy.x * 31 + layer.xy.y));
+  }
+  return hash;
+}
+
+/**
+ * \brief Creates an empty cache of merged frames.
+ */
+HeroSpriteComposite::HeroSpriteComposite():
+  surface(nullptr),
+  frames(),
+  layers(),
+  layer_sprites(),
+  row_position(),
+  row_height(0) {
+}
+
+/**
+ * \brief Draws the hero's sprites as one merged frame.
+ *
+ * The merged frame is created the first time this combination of sprites
+ * is seen.
+ *
+ * \param map The map where to draw.
+ * \param sprites The sprites of the hero, from back to front.
+ * \param xy Coordinates of the hero's origin point in the map.
+ * \param clipping_area Rectangle of the map where the drawing will be
+ * restricted. A flat rectangle means no restriction.
+ * \return \c false if these sprites cannot be merged: nothing was drawn
+ * and the sprites have to be drawn separately.
+ */
+bool HeroSpriteComposite::draw(
+    Map& map,
+    const std::vector<Entity::NamedSprite>& sprites,
+    const Point& xy,
+    const Rectangle& clipping_area) {
+
+  layers.clear();
+  layer_sprites.clear();
+  for (const Entity::NamedSprite& named_sprite : sprites) {
+    if (named_sprite.removed) {
+      continue;
+    }
+    Sprite& sprite = *named_sprite.sprite;
+    if (sprite.get_current_animation().empty() || sprite.is_animation_finished()) {
+      // Not visible.
+      continue;
+    }
+    if (!is_mergeable(sprite)) {
+      return false;
+    }
+    layers.push_back({
+        &sprite.get_animation_set(),
+        sprite.get_current_animation_symbol(),
+        sprite.get_current_direction(),
+        sprite.get_current_frame(),
+        sprite.get_xy()
+    });
+    layer_sprites.push_back(&sprite);
+  }
+
+  if (layers.empty()) {
+    return true;
+  }
+
+  const Frame* frame = get_frame();
+  if (frame == nullptr) {
+    return false;
+  }
+
+  const CameraPtr& camera = map.get_camera();
+  if (camera == nullptr) {
+    return true;
+  }
+
+  Rectangle src = frame->region;
+  Rectangle dst_box(xy + frame->offset, src.get_size());
+  if (!clipping_area.is_flat()) {
+    const Rectangle clipped_box = dst_box.get_intersection(clipping_area);
+    if (clipped_box.is_flat()) {
+      return true;
+    }
+    src = Rectangle(
+        src.get_xy() + clipped_box.get_xy() - dst_box.get_xy(),
+        clipped_box.get_size()
+    );
+    dst_box = clipped_box;
+  }
+
+  surface->draw_region(
+      src,
+      camera->get_surface(),
+      dst_box.get_xy() - camera->get_top_left_xy()
+  );
+  return true;
+}
+
+/**
+ * \brief Forgets all merged frames.
+ *
+ * This should be called when images of sprites change,
+ * like tileset-dependent sprites when the tileset changes.
+ */
+void HeroSpriteComposite::clear() {
+
+  surface = nullptr;
+  frames.clear();
+  row_position = Point();
+  row_height = 0;
+}
+
+/**
+ * \brief Returns whether a sprite can be drawn into a merged frame.
+ * \param sprite A visible sprite.
+ * \return \c true if the sprite is drawn without any effect.
+ */
+bool HeroSpriteComposite::is_mergeable(Sprite& sprite) {
+
+  const Scale& scale = sprite.get_scale();
+  return !sprite.is_blinking() &&
+      sprite.get_blend_mode() == BlendMode::BLEND &&
+      sprite.get_opacity() == 255 &&
+      sprite.get_color_modulation() == Color::white &&
+      sprite.get_rotation() == 0.0 &&
+      scale.x == 1.0f && scale.y == 1.0f &&
+      sprite.get_shader() == nullptr &&
+      sprite.get_transition() == nullptr;
+}
+
+/**
+ * \brief Returns the merged frame of the current layers.
+ * \return The merged frame, or nullptr if it does not fit in the surface.
+ */
+const HeroSpriteComposite::Frame* HeroSpriteComposite::get_frame() {
+
+  const auto it = frames.find(layers);
+  if (it != frames.end()) {
+    return &it->second;
+  }
+
+  Frame frame;
+  if (!add_frame(frame)) {
+    // The surface is full: start again with only the frames used from now.
+    clear();
+    if (!add_frame(frame)) {
+      return nullptr;
+    }
+  }
+  return &frames.emplace(layers, frame).first->second;
+}
+
+/**
+ * \brief Draws the current layers into the surface.
+ * \param[out] frame The frame added.
+ * \return \c false if the frame does not fit in the surface.
+ */
+bool HeroSpriteComposite::add_frame(Frame& frame) {
+
+  // Bounding box of the layers relative to the hero.
+  Point top_left = layer_sprites[0]->get_xy() - layer_sprites[0]->get_origin();
+  Point bottom_right = top_left;
+  for (const Sprite* sprite : layer_sprites) {
+    const Point sprite_top_left = sprite->get_xy() - sprite->get_origin();
+    const Size sprite_size = sprite->get_size();
+    top_left.x = std::min(top_left.x, sprite_top_left.x);
+    top_left.y = std::min(top_left.y, sprite_top_left.y);
+    bottom_right.x = std::max(bottom_right.x, sprite_top_left.x + sprite_size.width);
+    bottom_right.y = std::max(bottom_right.y, sprite_top_left.y + sprite_size.height);
+  }
+  const Rectangle box(top_left, bottom_right);
+  if (box.is_flat()) {
+    return false;
+  }
+
+  Point position;
+  if (!reserve(box.get_size(), position)) {
+    return false;
+  }
+
+  // Each sprite adds its own offset and removes its origin when drawn.
+  const Point dst_position = position - box.get_xy();
+  for (const Sprite* sprite : layer_sprites) {
+    sprite->draw(surface, dst_position - sprite->get_xy());
+  }
+
+  frame.region = Rectangle(position, box.get_size());
+  frame.offset = box.get_xy();
+  return true;
+}
+
+/**
+ * \brief Finds room for a frame in the surface.
+ *
+ * Frames are placed from left to right in rows.
+ * The surface is created or made taller if needed.
+ *
+ * \param[in] size Size of the frame.
+ * \param[out] position Where to put the frame.
+ * \return \c false if the surface is full.
+ */
+bool HeroSpriteComposite::reserve(const Size& size, Point& position) {
+
+  // Leave one pixel between frames so that filtering does not mix them.
+  constexpr int padding = 1;
+
+  if (size.width + padding > width) {
+    return false;
+  }
+
+  if (row_position.x + size.width + padding > width) {
+    // Start a new row.
+    row_position = Point(0, row_position.y + row_height);
+    row_height = 0;
+  }
+
+  const int bottom = row_position.y + size.height + padding;
+  const int height = surface != nullptr ? surface->get_height() : 0;
+  if (bottom > height) {
+    int new_height = std::max(height, initial_height);
+    while (new_height < bottom) {
+      new_height *= 2;
+    }
+    if (new_height > max_height) {
+      return false;
+    }
+    SurfacePtr new_surface = Surface::create(width, new_height);
+    if (surface != nullptr) {
+      surface->set_blend_mode(BlendMode::NONE);
+      surface->draw(new_surface);
+    }
+    surface = new_surface;
+  }
+
+  position = row_position;
+  row_position.x += size.width + padding;
+  row_height = std::max(row_height, size.height + padding);
+  return true;
+}
+
+}
@@ -80,6 +80,7 @@ HeroSprites::HeroSprites(Hero& hero, Equipment& equipment):
   walking(false),
   clipping_rectangle(Rectangle()),
   lifted_item(nullptr),
+  composite(nullptr),
   animation_callback_ref() {
 
 }
@@ -609,6 +610,36 @@ void HeroSprites::set_clipping_rectangle(const Rectangle& clipping_rectangle) {
   this->clipping_rectangle = clipping_rectangle;
 }
 
+/**
+ * \brief Returns whether the sprites are drawn as merged frames.
+ * \return \c true if the sprites are merged when possible.
+ */
+bool HeroSprites::is_composition_enabled() const {
+  return composite != nullptr;
+}
+
+/**
+ * \brief Sets whether the sprites are drawn as merged frames.
+ *
+ * When enabled, each combination of frames of the visible sprites is drawn
+ * once into a cached image, and the hero is then drawn with this image only.
+ *
+ * \param composition_enabled \c true to merge the sprites when possible.
+ */
+void HeroSprites::set_composition_enabled(bool composition_enabled) {
+
+  if (composition_enabled == is_composition_enabled()) {
+    return;
+  }
+
+  if (composition_enabled) {
+    composite = std::unique_ptr<HeroSpriteComposite>(new HeroSpriteComposite());
+  }
+  else {
+    composite = nullptr;
+  }
+}
+
 /**
  * \brief Returns whether the sprites have currently a walking animation.
  * \return true if the sprites are walking
@@ -824,7 +855,16 @@ void HeroSprites::draw_on_map() {
   if (camera == nullptr) {
     return;
   }
-  hero.draw_sprites(*camera, clipping_rectangle);
+  if (composite == nullptr ||
+      !composite->draw(
+          hero.get_map(),
+          hero.get_named_sprites(),
+          hero.get_displayed_xy() + hero.get_interpolation_offset(),
+          clipping_rectangle
+      )
+  ) {
+    hero.draw_sprites(*camera, clipping_rectangle);
+  }
   if (lifted_item != nullptr) {
     lifted_item->draw(*camera);
   }
@@ -888,6 +928,11 @@ void HeroSprites::notify_tileset_changed() {
   if (is_ground_visible()) {
     ground_sprite->set_tileset(hero.get_map().get_tileset());
   }
+
+  // Merged frames may contain tileset-dependent images.
+  if (composite != nullptr) {
+    composite->clear();
+  }
 }
 
 /**
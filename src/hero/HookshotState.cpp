@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Map.h"
 #include "solarus/hero/BackToSolidGroundState.h"
 #include "solarus/hero/FreeState.h"
@@ -224,7 +225,7 @@ void Hero::HookshotState::finish_movement() {
       // illegal position: get back to the start point
       // TODO: get back to the closest valid point from the destination instead
       Sound::play("hero_hurt");
-      hero.set_state(std::make_shared<BackToSolidGroundState>(hero, false, 0, true));
+      hero.set_state(make_pooled<BackToSolidGroundState>(hero, false, 0, true));
     }
   }
 }
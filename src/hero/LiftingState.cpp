@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Equipment.h"
@@ -105,7 +106,7 @@ void Hero::LiftingState::update() {
 
     std::shared_ptr<CarriedObject> carried_object = lifted_item;
     lifted_item = nullptr; // we do not take care of the carried object from this state anymore
-    hero.set_state(std::make_shared<CarryingState>(hero, carried_object));
+    hero.set_state(make_pooled<CarryingState>(hero, carried_object));
   }
 }
 
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/hero/BackToSolidGroundState.h"
 #include "solarus/hero/FreeState.h"
 #include "solarus/hero/HeroSprites.h"
@@ -65,7 +66,7 @@ void Hero::PlungingState::update() {
     if (hero.get_ground_below() == Ground::DEEP_WATER) {
 
       if (get_equipment().has_ability(Ability::SWIM)) {
-        hero.set_state(std::make_shared<SwimmingState>(hero));
+        hero.set_state(make_pooled<SwimmingState>(hero));
       }
       else {
         drown = 1;
@@ -75,12 +76,12 @@ void Hero::PlungingState::update() {
       drown = 4;
     }
     else {
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
 
     if (drown > 0) {
       get_equipment().remove_life(drown);
-      hero.set_state(std::make_shared<BackToSolidGroundState>(hero, true, 300));
+      hero.set_state(make_pooled<BackToSolidGroundState>(hero, true, 300));
     }
   }
 }
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
 #include "solarus/hero/FreeState.h"
@@ -78,7 +79,7 @@ void Hero::PullingState::update() {
     // stop pulling if the action key is released or if there is no more obstacle
     if (!get_commands().is_command_pressed(GameCommand::ACTION)
         || !hero.is_facing_obstacle()) {
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
 
     // stop pulling the obstacle if the player changes his direction
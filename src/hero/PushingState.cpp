@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
 #include "solarus/hero/FreeState.h"
@@ -75,7 +76,7 @@ void Hero::PushingState::update() {
 
     // stop pushing if there is no more obstacle
     if (!hero.is_facing_obstacle()) {
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
 
     // stop pushing if the player changes his direction
@@ -87,7 +88,7 @@ void Hero::PushingState::update() {
         hero.start_grabbing();
       }
       else {
-        hero.set_state(std::make_shared<FreeState>(hero));
+        hero.set_state(make_pooled<FreeState>(hero));
       }
     }
 
@@ -260,7 +261,7 @@ void Hero::PushingState::stop_moving_pushed_entity() {
 
     // Stop the animation pushing if his direction changed.
     if (get_commands().get_wanted_direction8() != pushing_direction4 * 2) {
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
   }
 }
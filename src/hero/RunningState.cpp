@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
@@ -113,7 +114,7 @@ void Hero::RunningState::update() {
       phase++;
     }
     else if (!is_pressing_running_key()) {
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
   }
   else if (hero.get_movement()->is_finished()) {
@@ -163,7 +164,7 @@ void Hero::RunningState::notify_direction_command_pressed(int direction4) {
   if (!is_bouncing()
       && direction4 != get_sprites().get_animation_direction()) {
     Hero& hero = get_entity();
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Geometry.h"
@@ -95,7 +96,7 @@ void Hero::SpinAttackState::update() {
   // check the animation
   Hero& hero = get_entity();
   if (get_sprites().is_animation_finished()) {
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 
   // check the movement if any
@@ -104,7 +105,7 @@ void Hero::SpinAttackState::update() {
 
     if (!being_pushed) {
       // end of a super spin attack
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
   }
 }
@@ -263,6 +264,7 @@ void Hero::SpinAttackState::notify_attacked_enemy(
     }
 
     being_pushed = true;
+    hero.notify_ground_obstacles_changed();
     double angle = victim.get_angle(hero, victim_sprite, nullptr);
     std::shared_ptr<StraightMovement> movement =
         std::make_shared<StraightMovement>(false, true);
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
@@ -183,10 +184,10 @@ void Hero::StairsState::update() {
       }
       hero.clear_movement();
       if (carried_object == nullptr) {
-        hero.set_state(std::make_shared<FreeState>(hero));
+        hero.set_state(make_pooled<FreeState>(hero));
       }
       else {
-        hero.set_state(std::make_shared<CarryingState>(hero, carried_object));
+        hero.set_state(make_pooled<CarryingState>(hero, carried_object));
       }
     }
   }
@@ -217,10 +218,10 @@ void Hero::StairsState::update() {
       }
 
       if (carried_object == nullptr) {
-        hero.set_state(std::make_shared<FreeState>(hero));
+        hero.set_state(make_pooled<FreeState>(hero));
       }
       else {
-        hero.set_state(std::make_shared<CarryingState>(hero, carried_object));
+        hero.set_state(make_pooled<CarryingState>(hero, carried_object));
       }
     }
     else { // movement not finished yet
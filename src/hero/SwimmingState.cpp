@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/System.h"
@@ -72,7 +73,7 @@ void Hero::SwimmingState::update() {
 
   Hero& hero = get_entity();
   if (hero.get_ground_below() != Ground::DEEP_WATER) {
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
   else if (fast_swimming && System::now() >= end_fast_swim_date) {
     fast_swimming = false;
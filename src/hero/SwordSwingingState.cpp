@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
@@ -84,10 +85,10 @@ void Hero::SwordSwingingState::update() {
       // if the player is still pressing the sword key, start loading the sword
       if (get_commands().is_command_pressed(GameCommand::ATTACK)
           && !attacked) {
-        hero.set_state(std::make_shared<SwordLoadingState>(hero, 1000));
+        hero.set_state(make_pooled<SwordLoadingState>(hero, 1000));
       }
       else {
-        hero.set_state(std::make_shared<FreeState>(hero));
+        hero.set_state(make_pooled<FreeState>(hero));
       }
     }
     else {
@@ -100,7 +101,7 @@ void Hero::SwordSwingingState::update() {
   if (hero.get_movement() != nullptr && hero.get_movement()->is_finished()) {
     hero.clear_movement();
     if (sword_finished) {
-      hero.set_state(std::make_shared<FreeState>(hero));
+      hero.set_state(make_pooled<FreeState>(hero));
     }
   }
 }
@@ -217,7 +218,7 @@ void Hero::SwordSwingingState::notify_obstacle_reached() {
   hero.clear_movement();
 
   if (sword_finished) {
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/GameCommands.h"
 #include "solarus/core/Geometry.h"
@@ -93,7 +94,7 @@ void Hero::SwordTappingState::update() {
 
       if (get_sprites().get_current_frame() >= 5) {
         // when the animation is ok, stop tapping the wall, go back to loading the sword
-        hero.set_state(std::make_shared<SwordLoadingState>(hero, 1000));
+        hero.set_state(make_pooled<SwordLoadingState>(hero, 1000));
       }
     }
     else {
@@ -117,7 +118,7 @@ void Hero::SwordTappingState::update() {
   }
   else if (hero.get_movement()->is_finished()) {
     // the hero was pushed by an enemy
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
@@ -190,7 +191,7 @@ void Hero::SwordTappingState::notify_obstacle_reached() {
   // the hero reached an obstacle while being pushed after hitting an enemy
   Hero& hero = get_entity();
   hero.clear_movement();
-  hero.set_state(std::make_shared<FreeState>(hero));
+  hero.set_state(make_pooled<FreeState>(hero));
 }
 
 /**
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Stream.h"
 #include "solarus/hero/FreeState.h"
@@ -68,7 +69,7 @@ void Hero::UsingItemState::update() {
   if (item_usage.is_finished() && is_current_state()) {
     // if the state was not modified by the item, return to the normal state
     Hero& hero = get_entity();
-    hero.set_state(std::make_shared<FreeState>(hero));
+    hero.set_state(make_pooled<FreeState>(hero));
   }
 }
 
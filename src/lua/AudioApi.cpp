@@ -16,6 +16,9 @@
  */
 #include "solarus/audio/Sound.h"
 #include "solarus/audio/Music.h"
+#include "solarus/audio/MusicQualityInfo.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
@@ -38,10 +41,19 @@ void LuaContext::register_audio_module() {
       { "set_sound_volume", audio_api_set_sound_volume },
       { "play_sound", audio_api_play_sound },
       { "preload_sounds", audio_api_preload_sounds },
+      { "get_sound_max_instances", audio_api_get_sound_max_instances },
+      { "set_sound_max_instances", audio_api_set_sound_max_instances },
+      { "get_sound_priority", audio_api_get_sound_priority },
+      { "set_sound_priority", audio_api_set_sound_priority },
       { "get_music_volume", audio_api_get_music_volume },
       { "set_music_volume", audio_api_set_music_volume },
       { "play_music", audio_api_play_music },
       { "stop_music", audio_api_stop_music },
+      { "preload_music", audio_api_preload_music },
+      { "get_music_fade_duration", audio_api_get_music_fade_duration },
+      { "set_music_fade_duration", audio_api_set_music_fade_duration },
+      { "get_music_quality", audio_api_get_music_quality },
+      { "set_music_quality", audio_api_set_music_quality },
       { "get_music", audio_api_get_music },
       { "get_music_format", audio_api_get_music_format },
       { "get_music_num_channels", audio_api_get_music_num_channels },
@@ -113,6 +125,83 @@ int LuaContext::audio_api_preload_sounds(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.audio.get_sound_max_instances().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::audio_api_get_sound_max_instances(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& sound_id = LuaTools::check_string(l, 1);
+
+    lua_pushinteger(l, Sound::get_voice_settings(sound_id).max_instances);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.set_sound_max_instances().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::audio_api_set_sound_max_instances(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& sound_id = LuaTools::check_string(l, 1);
+    int max_instances = LuaTools::check_int(l, 2);
+
+    if (!Sound::exists(sound_id)) {
+      LuaTools::error(l, std::string("No such sound: '") + sound_id + "'");
+    }
+    if (max_instances < 0) {
+      LuaTools::arg_error(l, 2, "The maximum number of instances cannot be negative");
+    }
+    Sound::VoiceSettings settings = Sound::get_voice_settings(sound_id);
+    settings.max_instances = max_instances;
+    Sound::set_voice_settings(sound_id, settings);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.get_sound_priority().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::audio_api_get_sound_priority(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& sound_id = LuaTools::check_string(l, 1);
+
+    lua_pushinteger(l, Sound::get_voice_settings(sound_id).priority);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.set_sound_priority().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::audio_api_set_sound_priority(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& sound_id = LuaTools::check_string(l, 1);
+    int priority = LuaTools::check_int(l, 2);
+
+    if (!Sound::exists(sound_id)) {
+      LuaTools::error(l, std::string("No such sound: '") + sound_id + "'");
+    }
+    Sound::VoiceSettings settings = Sound::get_voice_settings(sound_id);
+    settings.priority = priority;
+    Sound::set_voice_settings(sound_id, settings);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of sol.audio.get_music_volume().
  * \param l the Lua context that is calling this function
@@ -196,6 +285,90 @@ int LuaContext::audio_api_stop_music(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.audio.preload_music().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::audio_api_preload_music(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& music_id = LuaTools::check_string(l, 1);
+
+    if (!Music::exists(music_id)) {
+      LuaTools::arg_error(l, 1, std::string("No such music: '") + music_id + "'");
+    }
+
+    get().get_main_loop().get_resource_provider().preload(
+          ResourceType::MUSIC, music_id, ResourceProvider::PreloadPriority::HIGH
+    );
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.get_music_fade_duration().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::audio_api_get_music_fade_duration(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushinteger(l, Music::get_fade_duration());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.set_music_fade_duration().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::audio_api_set_music_fade_duration(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    int fade_duration = LuaTools::check_int(l, 1);
+
+    if (fade_duration < 0) {
+      LuaTools::arg_error(l, 1, "Fade duration cannot be negative");
+    }
+
+    Music::set_fade_duration(fade_duration);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.get_music_quality().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::audio_api_get_music_quality(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    push_string(l, enum_to_name(Music::get_quality()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.audio.set_music_quality().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::audio_api_set_music_quality(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    MusicQuality quality = LuaTools::check_enum<MusicQuality>(l, 1);
+
+    Music::set_quality(quality);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of sol.audio.get_music().
  * \param l The Lua context that is calling this function.
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/graphics/DrawList.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <memory>
+
+namespace Solarus {
+
+/**
+ * Name of the Lua table representing the draw list module.
+ */
+const std::string LuaContext::draw_list_module_name = "sol.draw_list";
+
+/**
+ * \brief Initializes the draw list features provided to Lua.
+ */
+void LuaContext::register_draw_list_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  // Functions of sol.draw_list.
+  const std::vector<luaL_Reg> functions = {
+      { "create", draw_list_api_create },
+  };
+
+  // Methods of the draw list type.
+  const std::vector<luaL_Reg> methods = {
+      { "add", draw_list_api_add },
+      { "clear", draw_list_api_clear },
+      { "get_num_surfaces", draw_list_api_get_num_surfaces },
+      { "draw", draw_list_api_draw },
+  };
+
+  const std::vector<luaL_Reg> metamethods = {
+      { "__gc", userdata_meta_gc },
+      { "__newindex", userdata_meta_newindex_as_table },
+      { "__index", userdata_meta_index_as_table },
+  };
+
+  register_type(draw_list_module_name, functions, methods, metamethods);
+}
+
+/**
+ * \brief Returns whether a value is a userdata of type draw list.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return \c true if the value at this index is a draw list.
+ */
+bool LuaContext::is_draw_list(lua_State* l, int index) {
+  return is_userdata(l, index, draw_list_module_name);
+}
+
+/**
+ * \brief Checks that the userdata at the specified index of the stack is a
+ * draw list and returns it.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return The draw list.
+ */
+std::shared_ptr<DrawList> LuaContext::check_draw_list(lua_State* l, int index) {
+  return std::static_pointer_cast<DrawList>(
+      check_userdata(l, index, draw_list_module_name)
+  );
+}
+
+/**
+ * \brief Pushes a draw list userdata onto the stack.
+ * \param l A Lua context.
+ * \param draw_list A draw list.
+ */
+void LuaContext::push_draw_list(lua_State* l, DrawList& draw_list) {
+  push_userdata(l, draw_list);
+}
+
+/**
+ * \brief Implementation of sol.draw_list.create().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::draw_list_api_create(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    std::shared_ptr<DrawList> draw_list = std::make_shared<DrawList>();
+
+    push_draw_list(l, *draw_list);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of draw_list:add().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::draw_list_api_add(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    DrawList& draw_list = *check_draw_list(l, 1);
+    SurfacePtr surface = check_surface(l, 2);
+    const int x = LuaTools::opt_int(l, 3, 0);
+    const int y = LuaTools::opt_int(l, 4, 0);
+
+    draw_list.add_surface(surface, Point(x, y));
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of draw_list:clear().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::draw_list_api_clear(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    DrawList& draw_list = *check_draw_list(l, 1);
+
+    draw_list.clear();
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of draw_list:get_num_surfaces().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::draw_list_api_get_num_surfaces(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const DrawList& draw_list = *check_draw_list(l, 1);
+
+    lua_pushinteger(l, draw_list.get_num_surfaces());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of draw_list:draw().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::draw_list_api_draw(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    DrawList& draw_list = *check_draw_list(l, 1);
+    SurfacePtr dst_surface = check_surface(l, 2);
+    const int x = LuaTools::opt_int(l, 3, 0);
+    const int y = LuaTools::opt_int(l, 4, 0);
+
+    draw_list.draw(dst_surface, Point(x, y));
+    return 0;
+  });
+}
+
+}
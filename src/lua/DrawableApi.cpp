@@ -69,7 +69,10 @@ DrawablePtr LuaContext::check_drawable(lua_State* l, int index) {
  */
 bool LuaContext::has_drawable(const DrawablePtr& drawable) {
 
-  return drawables.find(drawable) != drawables.end();
+  const int index = drawable->get_lua_index();
+  return index >= 0 &&
+      index < static_cast<int>(drawables.size()) &&
+      drawables[index] == drawable;
 }
 
 /**
@@ -81,11 +84,15 @@ void LuaContext::add_drawable(const DrawablePtr& drawable) {
   Debug::check_assertion(!has_drawable(drawable),
       "This drawable object is already registered");
 
-  drawables.insert(drawable);
+  drawable->set_lua_index(static_cast<int>(drawables.size()));
+  drawables.push_back(drawable);
 }
 
 /**
  * \brief Unregisters a drawable object created by Lua.
+ *
+ * It is removed at the next update.
+ *
  * \param drawable a drawable object
  */
 void LuaContext::remove_drawable(const DrawablePtr& drawable) {
@@ -93,7 +100,7 @@ void LuaContext::remove_drawable(const DrawablePtr& drawable) {
   Debug::check_assertion(has_drawable(drawable),
       "This drawable object was not created by Lua");
 
-  drawables_to_remove.insert(drawable);
+  drawables_to_remove.push_back(drawable);
 }
 
 /**
@@ -101,27 +108,56 @@ void LuaContext::remove_drawable(const DrawablePtr& drawable) {
  */
 void LuaContext::destroy_drawables() {
 
+  for (const DrawablePtr& drawable: drawables) {
+    drawable->set_lua_index(-1);
+  }
   drawables.clear();
   drawables_to_remove.clear();
 }
 
 /**
  * \brief Updates all drawable objects created by this script.
+ *
+ * They are updated in their creation order.
+ * Drawables created during the update are updated the next time.
  */
 void LuaContext::update_drawables() {
 
   // Update all drawables.
-  for (const DrawablePtr& drawable: drawables) {
-    if (has_drawable(drawable)) {
+  const size_t num_drawables = drawables.size();
+  for (size_t i = 0; i < num_drawables; ++i) {
+    // Updating may add drawables to the list and reallocate it,
+    // but drawables stay alive until the removal below.
+    Drawable* drawable = drawables[i].get();
+    if (drawable != nullptr) {
       drawable->update();
     }
   }
 
-  // Remove the ones that should be removed.
+  if (drawables_to_remove.empty()) {
+    return;
+  }
+
+  // Remove the ones that should be removed, keeping the order of the others.
   for (const DrawablePtr& drawable: drawables_to_remove) {
-    drawables.erase(drawable);
+    if (has_drawable(drawable)) {
+      drawables[drawable->get_lua_index()] = nullptr;
+      drawable->set_lua_index(-1);
+    }
   }
   drawables_to_remove.clear();
+
+  size_t num_kept = 0;
+  for (size_t i = 0; i < drawables.size(); ++i) {
+    if (drawables[i] != nullptr) {
+      drawables[i]->set_lua_index(static_cast<int>(num_kept));
+      if (i != num_kept) {
+        drawables[num_kept] = std::move(drawables[i]);
+      }
+      ++num_kept;
+    }
+  }
+  drawables.resize(num_kept);
 }
 
 /**
@@ -181,7 +217,7 @@ int LuaContext::drawable_api_get_blend_mode(lua_State* l) {
 
     BlendMode blend_mode = drawable.get_blend_mode();
 
-    push_string(l, enum_to_name(blend_mode));
+    push_interned_string(l, enum_to_name(blend_mode));
 
     return 1;
   });
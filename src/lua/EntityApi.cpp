@@ -55,6 +55,8 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
+#include <cmath>
+#include <cstdint>
 #include <sstream>
 
 namespace Solarus {
@@ -77,20 +79,76 @@ const std::map<EntityType, std::string>& get_entity_internal_type_names() {
 
   return result;
 }
+
 /**
- * \brief Returns a set of the Lua metatable names of all entity types.
- * \return The Lua metatable name of all entity types.
+ * \brief Checks that a table describes a collision test computed without
+ * calling Lua and returns it.
+ * \param l A Lua state.
+ * \param index Index of the table in the stack.
+ * \return The collision test.
  */
-const std::set<std::string>& get_entity_internal_type_names_set() {
+CustomEntity::NativeCollisionTest check_native_collision_test(lua_State* l, int index) {
 
-  static std::set<std::string> result;
-  if (result.empty()) {
-    for (const auto& kvp : EnumInfoTraits<EntityType>::names) {
-      result.insert(LuaContext::get_entity_internal_type_name(kvp.first));
+  static const std::map<CustomEntity::CollisionShape, std::string> shape_names = {
+      { CustomEntity::CollisionShape::CIRCLE, "circle" },
+      { CustomEntity::CollisionShape::DISTANCE, "distance" },
+      { CustomEntity::CollisionShape::CONE, "cone" }
+  };
+
+  CustomEntity::NativeCollisionTest test;
+  test.shape = LuaTools::check_enum_field<CustomEntity::CollisionShape>(
+      l, index, "shape", shape_names
+  );
+  test.radius = LuaTools::check_int_field(l, index, "radius");
+  test.other_radius = LuaTools::opt_int_field(l, index, "other_radius", 0);
+  test.angle = LuaTools::opt_number_field(l, index, "angle", -1.0);
+  test.aperture = LuaTools::opt_number_field(l, index, "aperture", Geometry::PI_OVER_2);
+  test.same_model = LuaTools::opt_boolean_field(l, index, "same_model", false);
+  if (test.radius < 0 || test.other_radius < 0) {
+    LuaTools::arg_error(l, index, "Collision test radius cannot be negative");
+  }
+
+  lua_getfield(l, index, "type");
+  test.filter_type = !lua_isnil(l, -1);
+  lua_pop(l, 1);
+  if (test.filter_type) {
+    test.type = LuaTools::check_enum_field<EntityType>(l, index, "type");
+  }
+
+  lua_getfield(l, index, "layers");
+  if (!lua_isnil(l, -1)) {
+    if (!lua_istable(l, -1)) {
+      LuaTools::arg_error(l, index, "Bad field 'layers' (table expected)");
+    }
+    const int num_layers = static_cast<int>(lua_objlen(l, -1));
+    for (int i = 1; i <= num_layers; ++i) {
+      lua_rawgeti(l, -1, i);
+      if (!lua_isnumber(l, -1)) {
+        LuaTools::arg_error(l, index, "Bad field 'layers' (table of integers expected)");
+      }
+      test.layers.push_back(static_cast<int>(lua_tointeger(l, -1)));
+      lua_pop(l, 1);
     }
   }
+  lua_pop(l, 1);
 
-  return result;
+  return test;
+}
+
+/**
+ * \brief Checks that a value is a bitfield of collision categories
+ * and returns it.
+ * \param l A Lua state.
+ * \param index Index of the value in the stack.
+ * \return The bitfield.
+ */
+uint32_t check_collision_bits(lua_State* l, int index) {
+
+  const double value = LuaTools::check_number(l, index);
+  if (value < 0 || value > UINT32_MAX || value != std::floor(value)) {
+    LuaTools::arg_error(l, index, "Collision bits must be an integer between 0 and 0xFFFFFFFF");
+  }
+  return static_cast<uint32_t>(value);
 }
 
 }
@@ -161,6 +219,14 @@ void LuaContext::register_entity_module() {
         { "set_property", entity_api_set_property },
         { "get_properties", entity_api_get_properties },
         { "set_properties", entity_api_set_properties },
+        { "get_update_policy", entity_api_get_update_policy },
+        { "set_update_policy", entity_api_set_update_policy },
+        { "is_interpolated", entity_api_is_interpolated },
+        { "set_interpolated", entity_api_set_interpolated },
+        { "get_collision_category", entity_api_get_collision_category },
+        { "set_collision_category", entity_api_set_collision_category },
+        { "get_collision_mask", entity_api_get_collision_mask },
+        { "set_collision_mask", entity_api_set_collision_mask },
     });
   }
 
@@ -217,6 +283,8 @@ void LuaContext::register_entity_module() {
     hero_methods.insert(hero_methods.end(), {
         { "get_carried_object", hero_api_get_carried_object },
         { "start_state", hero_api_start_state },
+        { "is_sprite_composition_enabled", hero_api_is_sprite_composition_enabled },
+        { "set_sprite_composition_enabled", hero_api_set_sprite_composition_enabled },
     });
   }
 
@@ -658,32 +726,10 @@ bool LuaContext::is_entity(lua_State* l, int index) {
 
   // We could return is_hero() || is_tile() || is_dynamic_tile() || ...
   // but this would be tedious, costly and error prone.
+  // Entity metatables are flagged when they are registered instead.
 
-  void* udata = lua_touserdata(l, index);
-  if (udata == nullptr) {
-    // This is not a userdata.
-    return false;
-  }
-
-  if (!lua_getmetatable(l, index)) {
-    // The userdata has no metatable.
-    return false;
-  }
-
-  // Get the name of the Solarus type from this userdata.
-  lua_pushstring(l, "__solarus_type");
-  lua_rawget(l, -2);
-  if (!lua_isstring(l, -1)) {
-    // This is probably a userdata from some library other than Solarus.
-    lua_pop(l, 2);
-    return false;
-  }
-
-  // Check if the type name is one of the entity type names.
-  const std::string& type_name = lua_tostring(l, -1);
-  lua_pop(l, 2);
-
-  return get_entity_internal_type_names_set().find(type_name) != get_entity_internal_type_names_set().end();
+  const UserdataType* type = get_userdata_type(l, index);
+  return type != nullptr && type->is_entity;
 }
 
 /**
@@ -729,14 +775,28 @@ void LuaContext::push_entity(lua_State* l, Entity& entity) {
  */
 void LuaContext::push_entity_iterator(lua_State* l, const EntityVector& entities) {
 
-  // Create a Lua table with the list of entities, preserving their order.
+  // Fill a Lua table with the list of entities, preserving their order.
+  // Reuse the table of a finished iterator if any.
+  lua_rawgeti(l, LUA_REGISTRYINDEX, get().entity_iterator_tables_ref);
+                                  // ... iterator_tables
+  const int num_tables = lua_objlen(l, -1);
+  if (num_tables > 0) {
+    lua_rawgeti(l, -1, num_tables);
+                                  // ... iterator_tables entities
+    lua_pushnil(l);
+    lua_rawseti(l, -3, num_tables);
+  }
+  else {
+    lua_createtable(l, entities.size(), 0);
+                                  // ... iterator_tables entities
+  }
+  lua_remove(l, -2);
+                                  // ... entities
   int i = 0;
-  lua_newtable(l);
   for (const EntityPtr& entity: entities) {
     ++i;
-    lua_pushinteger(l, i);
     push_entity(l, *entity);
-    lua_rawset(l, -3);
+    lua_rawseti(l, -2, i);
   }
 
   lua_pushinteger(l, entities.size());
@@ -865,7 +925,7 @@ int LuaContext::entity_api_get_type(lua_State* l) {
     const Entity& entity = *check_entity(l, 1);
 
     const std::string& type_name = enum_to_name(entity.get_type());
-    push_string(l, type_name);
+    push_interned_string(l, type_name);
     return 1;
   });
 }
@@ -1192,7 +1252,7 @@ int LuaContext::entity_api_get_ground_below(lua_State* l) {
 
     Ground ground = entity.get_ground_below();
 
-    push_string(l, enum_to_name(ground));
+    push_interned_string(l, enum_to_name(ground));
     return 1;
   });
 }
@@ -1877,6 +1937,70 @@ int LuaContext::entity_api_set_layer_independent_collisions(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of entity:get_collision_category().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_get_collision_category(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+
+    lua_pushnumber(l, entity.get_collision_category());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:set_collision_category().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_set_collision_category(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Entity& entity = *check_entity(l, 1);
+    uint32_t category = check_collision_bits(l, 2);
+
+    entity.set_collision_category(category);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of entity:get_collision_mask().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_get_collision_mask(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+
+    lua_pushnumber(l, entity.get_collision_mask());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:set_collision_mask().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_set_collision_mask(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Entity& entity = *check_entity(l, 1);
+    uint32_t mask = check_collision_bits(l, 2);
+
+    entity.set_collision_mask(mask);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of entity:test_obstacles().
  * \param l The Lua context that is calling this function.
@@ -1934,6 +2058,71 @@ int LuaContext::entity_api_set_optimization_distance(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of entity:get_update_policy().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_get_update_policy(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+
+    push_interned_string(l, enum_to_name(entity.get_update_policy()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:set_update_policy().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_set_update_policy(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Entity& entity = *check_entity(l, 1);
+    Entity::UpdatePolicy update_policy =
+        LuaTools::check_enum<Entity::UpdatePolicy>(l, 2);
+
+    entity.set_update_policy(update_policy);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of entity:is_interpolated().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_is_interpolated(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Entity& entity = *check_entity(l, 1);
+
+    lua_pushboolean(l, entity.is_interpolated());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of entity:set_interpolated().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::entity_api_set_interpolated(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Entity& entity = *check_entity(l, 1);
+    bool interpolated = LuaTools::opt_boolean(l, 2, true);
+
+    entity.set_interpolated(interpolated);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of entity:is_in_same_region().
  * \param l The Lua context that is calling this function.
@@ -2127,14 +2316,16 @@ int LuaContext::hero_api_teleport(lua_State* l) {
     Game& game = hero.get_game();
     const std::string& map_id = LuaTools::check_string(l, 2);
     const std::string& destination_name = LuaTools::opt_string(l, 3, "");
-    Transition::Style transition_style = LuaTools::opt_enum<Transition::Style>(
-        l, 4, game.get_default_transition_style());
+    const std::string& transition_effect = opt_transition_effect(l, 4);
+    Transition::Style transition_style = transition_effect.empty() ?
+        LuaTools::opt_enum<Transition::Style>(l, 4, game.get_default_transition_style()) :
+        game.get_default_transition_style();
 
     if (!CurrentQuest::resource_exists(ResourceType::MAP, map_id)) {
       LuaTools::arg_error(l, 2, std::string("No such map: '") + map_id + "'");
     }
 
-    game.set_current_map(map_id, destination_name, transition_style);
+    game.set_current_map(map_id, destination_name, transition_style, transition_effect);
 
     return 0;
   });
@@ -2533,6 +2724,38 @@ int LuaContext::hero_api_set_blinking(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of hero:is_sprite_composition_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::hero_api_is_sprite_composition_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Hero& hero = *check_hero(l, 1);
+
+    lua_pushboolean(l, hero.get_hero_sprites().is_composition_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of hero:set_sprite_composition_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::hero_api_set_sprite_composition_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Hero& hero = *check_hero(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    hero.get_hero_sprites().set_composition_enabled(enabled);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of hero:is_invincible().
  * \param l The Lua context that is calling this function.
@@ -3255,7 +3478,7 @@ int LuaContext::destination_api_get_starting_location_mode(lua_State* l) {
 
     StartingLocationMode mode = destination.get_starting_location_mode();
 
-    push_string(l, enum_to_name(mode));
+    push_interned_string(l, enum_to_name(mode));
     return 1;
   });
 }
@@ -3367,7 +3590,7 @@ int LuaContext::teletransporter_api_get_transition(lua_State* l) {
   return state_boundary_handle(l, [&] {
     const Teletransporter& teletransporter = *check_teletransporter(l, 1);
 
-    push_string(l, enum_to_name(teletransporter.get_transition_style()));
+    push_interned_string(l, enum_to_name(teletransporter.get_transition_style()));
     return 1;
   });
 }
@@ -4790,7 +5013,7 @@ int LuaContext::destructible_api_get_cut_method(lua_State* l) {
 
     Destructible::CutMethod cut_method = destructible.get_cut_method();
 
-    push_string(l, enum_to_name(cut_method));
+    push_interned_string(l, enum_to_name(cut_method));
     return 1;
   });
 }
@@ -4926,7 +5149,7 @@ int LuaContext::destructible_api_get_modified_ground(lua_State* l) {
 
     Ground modified_ground = destructible.get_modified_ground();
 
-    push_string(l, enum_to_name(modified_ground));
+    push_interned_string(l, enum_to_name(modified_ground));
     return 1;
   });
 }
@@ -5120,7 +5343,7 @@ int LuaContext::dynamic_tile_api_get_modified_ground(lua_State* l) {
 
     Ground modified_ground = dynamic_tile.get_modified_ground();
 
-    push_string(l, enum_to_name(modified_ground));
+    push_interned_string(l, enum_to_name(modified_ground));
     return 1;
   });
 }
@@ -5580,7 +5803,7 @@ int LuaContext::enemy_api_get_attack_consequence(lua_State* l) {
       reaction.callback.push(l);
     } else {
       // Return a string.
-      push_string(l, enum_to_name(reaction.type));
+      push_interned_string(l, enum_to_name(reaction.type));
     }
     return 1;
   });
@@ -5647,7 +5870,7 @@ int LuaContext::enemy_api_get_attack_consequence_sprite(lua_State* l) {
     }
     else {
       // Return a string.
-      push_string(l, enum_to_name(reaction.type));
+      push_interned_string(l, enum_to_name(reaction.type));
     }
     return 1;
   });
@@ -5867,7 +6090,7 @@ int LuaContext::enemy_api_get_attacking_collision_mode(lua_State* l) {
   return state_boundary_handle(l, [&] {
     const Enemy& enemy = *check_enemy(l, 1);
 
-    push_string(l, enum_to_name(enemy.get_attacking_collision_mode()));
+    push_interned_string(l, enum_to_name(enemy.get_attacking_collision_mode()));
     return 1;
   });
 }
@@ -6461,8 +6684,12 @@ int LuaContext::custom_entity_api_add_collision_test(lua_State* l) {
       const ScopedLuaRef& collision_test_ref = LuaTools::check_function(l, 2);
       entity.add_collision_test(collision_test_ref, callback_ref);
     }
+    else if (lua_istable(l, 2)) {
+      // Custom collision test computed without calling Lua.
+      entity.add_collision_test(check_native_collision_test(l, 2), callback_ref);
+    }
     else {
-      LuaTools::type_error(l, 2, "string or function");
+      LuaTools::type_error(l, 2, "string, function or table");
     }
 
     return 0;
@@ -6501,7 +6728,7 @@ int LuaContext::custom_entity_api_get_modified_ground(lua_State* l) {
       lua_pushnil(l);
     }
     else {
-      push_string(l, enum_to_name(modified_ground));
+      push_interned_string(l, enum_to_name(modified_ground));
     }
     return 1;
   });
@@ -6603,10 +6830,7 @@ int LuaContext::custom_entity_api_set_follow_streams(lua_State* l) {
  */
 void LuaContext::entity_on_update(Entity& entity) {
 
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(entity, method_name)) {
+  if (!userdata_has_field(entity, LuaEvent::ON_UPDATE)) {
     return;
   }
 
@@ -6625,7 +6849,7 @@ void LuaContext::entity_on_update(Entity& entity) {
  */
 void LuaContext::entity_on_suspended(Entity& entity, bool suspended) {
 
-  if (!userdata_has_field(entity, "on_suspended")) {
+  if (!userdata_has_field(entity, LuaEvent::ON_SUSPENDED)) {
     return;
   }
   run_on_main([this, &entity, suspended](lua_State* l){
@@ -6668,6 +6892,7 @@ void LuaContext::entity_on_removed(Entity& entity) {
       on_removed();
     }
     remove_timers(-1);  // Stop timers associated to this entity.
+    remove_tasks(-1);
     lua_pop(l, 1);
   });
 }
@@ -6720,7 +6945,7 @@ void LuaContext::entity_on_disabled(Entity& entity) {
  */
 void LuaContext::entity_on_pre_draw(Entity& entity, Camera& camera) {
 
-  if (!userdata_has_field(entity, "on_pre_draw")) {
+  if (!userdata_has_field(entity, LuaEvent::ON_PRE_DRAW)) {
     return;
   }
   run_on_main([this, &entity, &camera](lua_State* l){
@@ -6740,7 +6965,7 @@ void LuaContext::entity_on_pre_draw(Entity& entity, Camera& camera) {
  */
 void LuaContext::entity_on_post_draw(Entity& entity, Camera& camera) {
 
-  if (!userdata_has_field(entity, "on_post_draw")) {
+  if (!userdata_has_field(entity, LuaEvent::ON_POST_DRAW)) {
     return;
   }
   run_on_main([this, &entity, &camera](lua_State* l){
@@ -6754,6 +6979,7 @@ void LuaContext::entity_on_post_draw(Entity& entity, Camera& camera) {
  * \brief Calls the on_position_changed() method of a Lua map entity.
  *
  * Does nothing if the method is not defined.
+ * The event is also collected for sol.main.set_event_batch_handler() if set.
  *
  * \param entity A map entity.
  * \param xy The new coordinates.
@@ -6762,7 +6988,17 @@ void LuaContext::entity_on_post_draw(Entity& entity, Camera& camera) {
 void LuaContext::entity_on_position_changed(
     Entity& entity, const Point& xy, int layer) {
 
-  if (!userdata_has_field(entity, "on_position_changed")) {
+  EventBatch* batch = get_event_batch(BatchedEventType::POSITION_CHANGED);
+  if (batch != nullptr) {
+    BatchedEvent event;
+    event.object = entity.shared_from_this();
+    event.x = xy.x;
+    event.y = xy.y;
+    event.value = layer;
+    batch->events.push_back(std::move(event));
+  }
+
+  if (!userdata_has_field(entity, LuaEvent::ON_POSITION_CHANGED)) {
     return;
   }
   run_on_main([this, &entity, xy, layer](lua_State* l){
@@ -6776,6 +7012,7 @@ void LuaContext::entity_on_position_changed(
  * \brief Calls the on_obstacle_reached() method of a Lua map entity.
  *
  * Does nothing if the method is not defined.
+ * The event is also collected for sol.main.set_event_batch_handler() if set.
  *
  * \param entity A map entity.
  * \param movement The movement that reached an obstacle.
@@ -6783,6 +7020,14 @@ void LuaContext::entity_on_position_changed(
 void LuaContext::entity_on_obstacle_reached(
     Entity& entity, Movement& movement) {
 
+  EventBatch* batch = get_event_batch(BatchedEventType::OBSTACLE_REACHED);
+  if (batch != nullptr) {
+    BatchedEvent event;
+    event.object = entity.shared_from_this();
+    event.movement = std::static_pointer_cast<Movement>(movement.shared_from_this());
+    batch->events.push_back(std::move(event));
+  }
+
   if (!userdata_has_field(entity, "on_obstacle_reached")) {
     return;
   }
@@ -6819,6 +7064,7 @@ void LuaContext::entity_on_movement_started(
  * \brief Calls the on_movement_changed() method of a Lua map entity.
  *
  * Does nothing if the method is not defined.
+ * The event is also collected for sol.main.set_event_batch_handler() if set.
  *
  * \param entity A map entity.
  * \param movement Its movement.
@@ -6826,7 +7072,15 @@ void LuaContext::entity_on_movement_started(
 void LuaContext::entity_on_movement_changed(
     Entity& entity, Movement& movement) {
 
-  if (!userdata_has_field(entity, "on_movement_changed")) {
+  EventBatch* batch = get_event_batch(BatchedEventType::MOVEMENT_CHANGED);
+  if (batch != nullptr) {
+    BatchedEvent event;
+    event.object = entity.shared_from_this();
+    event.movement = std::static_pointer_cast<Movement>(movement.shared_from_this());
+    batch->events.push_back(std::move(event));
+  }
+
+  if (!userdata_has_field(entity, LuaEvent::ON_MOVEMENT_CHANGED)) {
     return;
   }
 
@@ -7520,6 +7774,7 @@ void LuaContext::enemy_on_restarted(Enemy& enemy) {
   run_on_main([this, &enemy](lua_State* l){
     push_enemy(l, enemy);
     remove_timers(-1);  // Stop timers associated to this enemy.
+    remove_tasks(-1);
     if (userdata_has_field(enemy, "on_restarted")) {
       on_restarted();
     }
@@ -7608,6 +7863,7 @@ void LuaContext::enemy_on_hurt(Enemy& enemy, EnemyAttack attack) {
   run_on_main([this, &enemy, attack](lua_State* l){
     push_enemy(l, enemy);
     remove_timers(-1);  // Stop timers associated to this enemy.
+    remove_tasks(-1);
     if (userdata_has_field(enemy, "on_hurt")) {
       on_hurt(attack);
     }
@@ -7626,6 +7882,7 @@ void LuaContext::enemy_on_dying(Enemy& enemy) {
   run_on_main([this, &enemy](lua_State* l){
     push_enemy(l, enemy);
     remove_timers(-1);  // Stop timers associated to this enemy.
+    remove_tasks(-1);
     if (userdata_has_field(enemy, "on_dying")) {
       on_dying();
     }
@@ -7663,6 +7920,7 @@ void LuaContext::enemy_on_immobilized(Enemy& enemy) {
   run_on_main([this, &enemy](lua_State* l){
     push_enemy(l, enemy);
     remove_timers(-1);  // Stop timers associated to this enemy.
+    remove_tasks(-1);
     if (userdata_has_field(enemy, "on_immobilized")) {
       on_immobilized();
     }
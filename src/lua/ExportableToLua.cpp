@@ -26,7 +26,9 @@ namespace Solarus {
 ExportableToLua::ExportableToLua():
   lua_context(nullptr),
   known_to_lua(false),
-  with_lua_table(false) {
+  with_lua_table(false),
+  lua_events(0),
+  lua_slot(0) {
 
 }
 
@@ -96,6 +98,65 @@ void ExportableToLua::set_with_lua_table(bool with_lua_table) {
   this->with_lua_table = with_lua_table;
 }
 
+/**
+ * \brief Returns whether an event is defined in the Lua table of this
+ * userdata.
+ *
+ * Only the table of the userdata is considered, not its metatable.
+ *
+ * \param event The event to test.
+ * \return \c true if the event was set on this userdata.
+ */
+bool ExportableToLua::has_lua_event(LuaEvent event) const {
+  return (lua_events & (1u << static_cast<int>(event))) != 0;
+}
+
+/**
+ * \brief Sets whether an event is defined in the Lua table of this userdata.
+ * \param event The event.
+ * \param defined \c true if a value is set for this event, \c false if it
+ * was set to nil.
+ */
+void ExportableToLua::set_lua_event(LuaEvent event, bool defined) {
+
+  const uint32_t bit = 1u << static_cast<int>(event);
+  if (defined) {
+    lua_events |= bit;
+  }
+  else {
+    lua_events &= ~bit;
+  }
+}
+
+/**
+ * \brief Forgets all events defined in the Lua table of this userdata.
+ */
+void ExportableToLua::clear_lua_events() {
+  lua_events = 0;
+}
+
+/**
+ * \brief Returns where the Lua context caches the userdata of this object.
+ *
+ * The slot stays reserved while this object lives, even if its userdata
+ * gets collected from Lua.
+ *
+ * \return Index of the userdata in the userdata slots of the Lua context,
+ * or 0 if no slot was reserved yet.
+ */
+int ExportableToLua::get_lua_slot() const {
+  return lua_slot;
+}
+
+/**
+ * \brief Sets where the Lua context caches the userdata of this object.
+ * \param lua_slot Index of the userdata in the userdata slots of the
+ * Lua context, or 0 to release it.
+ */
+void ExportableToLua::set_lua_slot(int lua_slot) {
+  this->lua_slot = lua_slot;
+}
+
 /**
  * \brief Returns the name identifying this type in Lua.
  * \return The name identifying this type in Lua.
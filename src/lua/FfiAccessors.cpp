@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/EntityTypeInfo.h"
+#include "solarus/graphics/PixelBuffer.h"
+#include "solarus/lua/ExportableToLuaPtr.h"
+#include "solarus/lua/FfiAccessors.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include "solarus/movements/StraightMovement.h"
+#include <lua.hpp>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Returns the C++ object of a userdata block.
+ * \param userdata Address of the userdata block, as passed by the FFI.
+ * \return The object.
+ */
+template<typename T>
+const T& get_object(const void* userdata) {
+
+  const ExportableToLuaPtr& object = *static_cast<const ExportableToLuaPtr*>(userdata);
+  return static_cast<const T&>(*object);
+}
+
+/**
+ * \brief Lua code that replaces hot accessors by FFI calls.
+ *
+ * Arguments: a table of C function pointers as light userdata,
+ * an array of entity metatables, the straight movement metatable
+ * and the pixel buffer metatable (or nil).
+ * Each replacement checks the metatable of its argument first,
+ * and falls back to the C API function otherwise so that errors
+ * are reported as usual.
+ * Returns whether the FFI library is available.
+ */
+const char* ffi_accessors_code =
+"local accessors, entity_metatables, straight_movement_metatable, pixel_buffer_metatable = ...\n"
+"local ffi_available, ffi = pcall(require, 'ffi')\n"
+"if not ffi_available then\n"
+"  return false\n"
+"end\n"
+"local getmetatable = getmetatable\n"
+"ffi.cdef[[\n"
+"typedef struct solarus_position { int x; int y; int layer; } solarus_position;\n"
+"typedef struct solarus_rectangle { int x; int y; int width; int height; } solarus_rectangle;\n"
+"]]\n"
+"local get_position = ffi.cast('void (*)(const void*, solarus_position*)', accessors.entity_get_position)\n"
+"local get_center_position = ffi.cast('void (*)(const void*, solarus_position*)', accessors.entity_get_center_position)\n"
+"local get_bounding_box = ffi.cast('void (*)(const void*, solarus_rectangle*)', accessors.entity_get_bounding_box)\n"
+"local get_speed = ffi.cast('int (*)(const void*)', accessors.straight_movement_get_speed)\n"
+"local get_angle = ffi.cast('double (*)(const void*)', accessors.straight_movement_get_angle)\n"
+"local get_pixel_buffer_data = ffi.cast('uint8_t* (*)(const void*)', accessors.pixel_buffer_get_data)\n"
+"local position = ffi.new('solarus_position')\n"
+"local rectangle = ffi.new('solarus_rectangle')\n"
+"\n"
+"for _, meta in ipairs(entity_metatables) do\n"
+"  local c_get_position = meta.get_position\n"
+"  meta.get_position = function(entity)\n"
+"    if getmetatable(entity) ~= meta then\n"
+"      return c_get_position(entity)\n"
+"    end\n"
+"    get_position(entity, position)\n"
+"    return position.x, position.y, position.layer\n"
+"  end\n"
+"  local c_get_center_position = meta.get_center_position\n"
+"  meta.get_center_position = function(entity)\n"
+"    if getmetatable(entity) ~= meta then\n"
+"      return c_get_center_position(entity)\n"
+"    end\n"
+"    get_center_position(entity, position)\n"
+"    return position.x, position.y, position.layer\n"
+"  end\n"
+"  local c_get_bounding_box = meta.get_bounding_box\n"
+"  meta.get_bounding_box = function(entity)\n"
+"    if getmetatable(entity) ~= meta then\n"
+"      return c_get_bounding_box(entity)\n"
+"    end\n"
+"    get_bounding_box(entity, rectangle)\n"
+"    return rectangle.x, rectangle.y, rectangle.width, rectangle.height\n"
+"  end\n"
+"end\n"
+"\n"
+"local meta = straight_movement_metatable\n"
+"local c_get_speed = meta.get_speed\n"
+"meta.get_speed = function(movement)\n"
+"  if getmetatable(movement) ~= meta then\n"
+"    return c_get_speed(movement)\n"
+"  end\n"
+"  return get_speed(movement)\n"
+"end\n"
+"local c_get_angle = meta.get_angle\n"
+"meta.get_angle = function(movement)\n"
+"  if getmetatable(movement) ~= meta then\n"
+"    return c_get_angle(movement)\n"
+"  end\n"
+"  return get_angle(movement)\n"
+"end\n"
+"\n"
+"meta = pixel_buffer_metatable\n"
+"if meta ~= nil then\n"
+"  local c_get_pointer = meta.get_pointer\n"
+"  meta.get_pointer = function(pixel_buffer)\n"
+"    if getmetatable(pixel_buffer) ~= meta then\n"
+"      return c_get_pointer(pixel_buffer)\n"
+"    end\n"
+"    return get_pixel_buffer_data(pixel_buffer)\n"
+"  end\n"
+"end\n"
+"return true\n";
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Replaces hot accessors of the Lua API by FFI calls.
+ *
+ * This is only done with LuaJIT when its FFI library is available.
+ * Otherwise, the C API functions stay in place.
+ */
+void LuaContext::register_ffi_accessors() {
+
+  if (!is_luajit()) {
+    return;
+  }
+
+  if (luaL_loadstring(current_l, ffi_accessors_code) != 0) {
+    Debug::error(std::string("Failed to load FFI accessors: ") + lua_tostring(current_l, -1));
+    lua_pop(current_l, 1);
+    return;
+  }
+                                  // code
+  lua_createtable(current_l, 0, 6);
+                                  // code accessors
+  lua_pushlightuserdata(current_l, reinterpret_cast<void*>(&solarus_entity_get_position));
+  lua_setfield(current_l, -2, "entity_get_position");
+  lua_pushlightuserdata(current_l, reinterpret_cast<void*>(&solarus_entity_get_center_position));
+  lua_setfield(current_l, -2, "entity_get_center_position");
+  lua_pushlightuserdata(current_l, reinterpret_cast<void*>(&solarus_entity_get_bounding_box));
+  lua_setfield(current_l, -2, "entity_get_bounding_box");
+  lua_pushlightuserdata(current_l, reinterpret_cast<void*>(&solarus_straight_movement_get_speed));
+  lua_setfield(current_l, -2, "straight_movement_get_speed");
+  lua_pushlightuserdata(current_l, reinterpret_cast<void*>(&solarus_straight_movement_get_angle));
+  lua_setfield(current_l, -2, "straight_movement_get_angle");
+  lua_pushlightuserdata(current_l, reinterpret_cast<void*>(&solarus_pixel_buffer_get_data));
+  lua_setfield(current_l, -2, "pixel_buffer_get_data");
+
+  lua_newtable(current_l);
+                                  // code accessors entity_metas
+  int i = 0;
+  for (const auto& kvp : EnumInfoTraits<EntityType>::names) {
+    luaL_getmetatable(current_l, get_entity_internal_type_name(kvp.first).c_str());
+                                  // code accessors entity_metas meta/nil
+    if (lua_isnil(current_l, -1)) {
+      lua_pop(current_l, 1);
+      continue;
+    }
+    ++i;
+    lua_rawseti(current_l, -2, i);
+                                  // code accessors entity_metas
+  }
+  luaL_getmetatable(current_l, movement_straight_module_name.c_str());
+                                  // code accessors entity_metas straight_meta
+  luaL_getmetatable(current_l, pixel_buffer_module_name.c_str());
+                                  // code accessors entity_metas straight_meta pixel_buffer_meta/nil
+
+  if (!LuaTools::call_function(current_l, 4, 1, "FFI accessors")) {
+    return;
+  }
+                                  // ffi_available
+  if (!lua_toboolean(current_l, -1)) {
+    // The FFI library may be disabled in this LuaJIT build.
+    Logger::info("LuaJIT FFI library not available: using the C API for all accessors");
+  }
+  lua_pop(current_l, 1);
+                                  // --
+}
+
+}
+
+using namespace Solarus;
+
+/**
+ * \brief Gets the position of an entity.
+ * \param entity Userdata block of an entity.
+ * \param[out] position Its position and layer.
+ */
+void solarus_entity_get_position(const void* entity, solarus_position* position) {
+
+  const Entity& object = get_object<Entity>(entity);
+  position->x = object.get_x();
+  position->y = object.get_y();
+  position->layer = object.get_layer();
+}
+
+/**
+ * \brief Gets the center position of an entity.
+ * \param entity Userdata block of an entity.
+ * \param[out] position Its center point and layer.
+ */
+void solarus_entity_get_center_position(const void* entity, solarus_position* position) {
+
+  const Entity& object = get_object<Entity>(entity);
+  const Point& center_point = object.get_center_point();
+  position->x = center_point.x;
+  position->y = center_point.y;
+  position->layer = object.get_layer();
+}
+
+/**
+ * \brief Gets the bounding box of an entity.
+ * \param entity Userdata block of an entity.
+ * \param[out] bounding_box Its bounding box.
+ */
+void solarus_entity_get_bounding_box(const void* entity, solarus_rectangle* bounding_box) {
+
+  const Rectangle& box = get_object<Entity>(entity).get_bounding_box();
+  bounding_box->x = box.get_x();
+  bounding_box->y = box.get_y();
+  bounding_box->width = box.get_width();
+  bounding_box->height = box.get_height();
+}
+
+/**
+ * \brief Returns the speed of a straight movement.
+ * \param movement Userdata block of a straight movement.
+ * \return Its speed in pixels per second.
+ */
+int solarus_straight_movement_get_speed(const void* movement) {
+  return static_cast<int>(get_object<StraightMovement>(movement).get_speed());
+}
+
+/**
+ * \brief Returns the angle of a straight movement.
+ * \param movement Userdata block of a straight movement.
+ * \return Its angle in radians.
+ */
+double solarus_straight_movement_get_angle(const void* movement) {
+  return get_object<StraightMovement>(movement).get_angle();
+}
+
+/**
+ * \brief Returns the pixels of a pixel buffer.
+ *
+ * Scripts writing pixels through this pointer must then mark the
+ * region modified with pixel_buffer:mark_dirty().
+ *
+ * \param pixel_buffer Userdata block of a pixel buffer.
+ * \return Its first RGBA pixel, valid as long as the buffer exists.
+ */
+uint8_t* solarus_pixel_buffer_get_data(const void* pixel_buffer) {
+  return const_cast<PixelBuffer&>(get_object<PixelBuffer>(pixel_buffer)).get_data();
+}
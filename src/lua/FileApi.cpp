@@ -14,11 +14,15 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/AsyncFileWriter.h"
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/JobSystem.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/core/SolarusFatal.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/core/Logger.h"
+#include <memory>
 #ifdef SOLARUS_LUA_WIN_UNICODE_WORKAROUND
 #  include <cerrno>
 #  include <cstdio>
@@ -34,6 +38,53 @@ namespace {
 }
 #endif
 
+namespace {
+
+/**
+ * \brief Result of an asynchronous file read.
+ */
+struct FileRead {
+  bool success = false;     /**< Whether the file could be read. */
+  std::string content;      /**< Content of the file if successful. */
+  std::string error;        /**< Error message otherwise. */
+};
+
+uint64_t next_file_read_id = 0;  /**< Id of the next asynchronous read,
+                                  * unique even across Lua contexts. */
+
+/**
+ * \brief Returns whether a file name stays inside the quest directories.
+ *
+ * Like PhysFS, this rejects absolute paths, drive letters, backslashes
+ * and ".." components.
+ *
+ * \param file_name A file name relative to the quest directories.
+ * \return \c true if the file name is safe.
+ */
+bool is_safe_file_name(const std::string& file_name) {
+
+  if (file_name.empty() ||
+      file_name[0] == '/' ||
+      file_name.find_first_of("\\:") != std::string::npos) {
+    return false;
+  }
+
+  size_t start = 0;
+  while (start <= file_name.size()) {
+    size_t end = file_name.find('/', start);
+    if (end == std::string::npos) {
+      end = file_name.size();
+    }
+    if (file_name.compare(start, end - start, "..") == 0) {
+      return false;
+    }
+    start = end + 1;
+  }
+  return true;
+}
+
+}
+
 /**
  * Name of the Lua table representing the file module.
  */
@@ -54,6 +105,8 @@ void LuaContext::register_file_module() {
     functions.insert(functions.end(), {
         { "is_dir", file_api_is_dir },
         { "list_dir", file_api_list_dir },
+        { "read_async", file_api_read_async },
+        { "write_async", file_api_write_async },
     });
   }
   register_functions(file_module_name, functions);
@@ -313,6 +366,116 @@ int LuaContext::file_api_list_dir(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.file.read_async().
+ *
+ * The file is read by an IO job, after the asynchronous writes requested
+ * before, and the callback is called by the main loop.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::file_api_read_async(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+    const ScopedLuaRef& callback_ref = LuaTools::check_function(l, 2);
+
+    if (!is_safe_file_name(file_name)) {
+      LuaTools::arg_error(l, 1, "Invalid file name: '" + file_name + "'");
+    }
+
+    const uint64_t id = next_file_read_id++;
+    get().file_read_callbacks.emplace(id, callback_ref);
+
+    const std::shared_ptr<FileRead> read = std::make_shared<FileRead>();
+    const JobSystem::JobPtr& job = JobSystem::add(JobSystem::Priority::IO, [file_name, read]() {
+      AsyncFileWriter::flush();
+      try {
+        if (!QuestFiles::data_file_exists(file_name) ||
+            QuestFiles::data_file_is_dir(file_name)) {
+          read->error = "Cannot find file '" + file_name +
+              "' in the quest write directory, in data/, data.solarus or in data.solarus.zip";
+          return;
+        }
+        read->content = QuestFiles::data_file_read(file_name);
+        read->success = true;
+      }
+      catch (const SolarusFatal& ex) {
+        read->error = ex.what();
+      }
+    });
+
+    JobSystem::add_main_thread([id, read]() {
+      if (lua_context == nullptr) {
+        // Lua was closed meanwhile.
+        return;
+      }
+      const auto it = lua_context->file_read_callbacks.find(id);
+      if (it == lua_context->file_read_callbacks.end()) {
+        return;
+      }
+      const ScopedLuaRef callback_ref = std::move(it->second);
+      lua_context->file_read_callbacks.erase(it);
+
+      lua_State* current_l = lua_context->get_internal_state();
+      push_ref(current_l, callback_ref);
+      if (read->success) {
+        push_string(current_l, read->content);
+        lua_context->call_function(1, 0, "file read callback");
+      }
+      else {
+        lua_pushnil(current_l);
+        push_string(current_l, read->error);
+        lua_context->call_function(2, 0, "file read callback");
+      }
+    }, { job });
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.file.write_async().
+ *
+ * The file is written in the quest write directory by the background
+ * writer of savegames: a crash never leaves it truncated.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::file_api_write_async(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+    const std::string& content = LuaTools::check_string(l, 2);
+    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 3);
+
+    if (!is_safe_file_name(file_name)) {
+      LuaTools::arg_error(l, 1, "Invalid file name: '" + file_name + "'");
+    }
+    if (QuestFiles::get_quest_write_dir().empty()) {
+      LuaTools::error(l,
+          "Cannot write file: no write directory was specified in quest.dat");
+    }
+
+    if (callback_ref.is_empty()) {
+      AsyncFileWriter::write(file_name, content, nullptr);
+    }
+    else {
+      AsyncFileWriter::write(file_name, content, [callback_ref](bool success) {
+        LuaContext& lua_context = LuaContext::get();
+        lua_State* current_l = lua_context.get_internal_state();
+        push_ref(current_l, callback_ref);
+        lua_pushboolean(current_l, success);
+        lua_context.call_function(1, 0, "file write callback");
+      });
+    }
+
+    return 0;
+  });
+}
+
 #ifdef SOLARUS_LUA_WIN_UNICODE_WORKAROUND
 namespace {
 
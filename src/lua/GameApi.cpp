@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/AbilityInfo.h"
+#include "solarus/core/AsyncFileWriter.h"
 #include "solarus/core/CommandsEffects.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
@@ -29,6 +30,28 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Checks that a value is a handle of a savegame value and returns it.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \param savegame The savegame the handle should come from.
+ * \return The handle.
+ */
+SavegameValueHandle check_value_handle(
+    lua_State* l, int index, const Savegame& savegame) {
+
+  const int slot = LuaTools::check_int(l, index);
+  const SavegameValueHandle handle(static_cast<uint32_t>(slot));
+  if (slot < 0 || !savegame.is_value_handle(handle)) {
+    LuaTools::arg_error(l, index, "Invalid savegame value handle");
+  }
+  return handle;
+}
+
+}
+
 /**
  * Name of the Lua table representing the game module.
  */
@@ -49,6 +72,9 @@ void LuaContext::register_game_module() {
   // Methods of the game type.
   const std::vector<luaL_Reg> methods = {
       { "save", game_api_save },
+      { "save_async", game_api_save_async },
+      { "get_save_format", game_api_get_save_format },
+      { "set_save_format", game_api_set_save_format },
       { "start", game_api_start },
       { "is_started", game_api_is_started },
       { "is_suspended", game_api_is_suspended },
@@ -67,6 +93,7 @@ void LuaContext::register_game_module() {
       { "get_hero", game_api_get_hero },
       { "get_value", game_api_get_value },
       { "set_value", game_api_set_value },
+      { "get_value_handle", game_api_get_value_handle },
       { "get_starting_location", game_api_get_starting_location },
       { "set_starting_location", game_api_set_starting_location },
       { "get_transition_style", game_api_get_transition_style },
@@ -150,6 +177,50 @@ void LuaContext::push_game(lua_State* l, Savegame& game) {
   push_userdata(l, game);
 }
 
+/**
+ * \brief Pushes a value of a savegame onto the stack.
+ * \param l A Lua context.
+ * \param savegame A savegame.
+ * \param key Name of the value. nil is pushed if it is not set.
+ */
+void LuaContext::push_savegame_value(lua_State* l, const Savegame& savegame, const std::string& key) {
+
+  if (savegame.is_boolean(key)) {
+    lua_pushboolean(l, savegame.get_boolean(key));
+  }
+  else if (savegame.is_integer(key)) {
+    lua_pushinteger(l, savegame.get_integer(key));
+  }
+  else if (savegame.is_string(key)) {
+    lua_pushstring(l, savegame.get_string(key).c_str());
+  }
+  else {
+    lua_pushnil(l);
+  }
+}
+
+/**
+ * \brief Pushes a value of a savegame onto the stack.
+ * \param l A Lua context.
+ * \param savegame A savegame.
+ * \param handle Handle of the value. nil is pushed if it is not set.
+ */
+void LuaContext::push_savegame_value(lua_State* l, const Savegame& savegame, SavegameValueHandle handle) {
+
+  if (savegame.is_boolean(handle)) {
+    lua_pushboolean(l, savegame.get_boolean(handle));
+  }
+  else if (savegame.is_integer(handle)) {
+    lua_pushinteger(l, savegame.get_integer(handle));
+  }
+  else if (savegame.is_string(handle)) {
+    lua_pushstring(l, savegame.get_string(handle).c_str());
+  }
+  else {
+    lua_pushnil(l);
+  }
+}
+
 /**
  * \brief Implementation of sol.game.exists().
  * \param l The Lua context that is calling this function.
@@ -164,6 +235,7 @@ int LuaContext::game_api_exists(lua_State* l) {
       LuaTools::error(l, "Cannot check savegame: no write directory was specified in quest.dat");
     }
 
+    AsyncFileWriter::flush();
     bool exists = QuestFiles::data_file_exists(file_name) &&
         !QuestFiles::data_file_is_dir(file_name);
 
@@ -186,6 +258,7 @@ int LuaContext::game_api_delete(lua_State* l) {
       LuaTools::error(l, "Cannot delete savegame: no write directory was specified in quest.dat");
     }
 
+    AsyncFileWriter::flush();
     QuestFiles::data_file_delete(file_name);
 
     return 0;
@@ -236,6 +309,69 @@ int LuaContext::game_api_save(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of game:save_async().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_save_async(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Savegame& savegame = *check_game(l, 1);
+    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 2);
+
+    if (QuestFiles::get_quest_write_dir().empty()) {
+      LuaTools::error(l, "Cannot save game: no write directory was specified in quest.dat");
+    }
+
+    if (callback_ref.is_empty()) {
+      savegame.save_async(nullptr);
+    }
+    else {
+      savegame.save_async([callback_ref](bool success) {
+        LuaContext& lua_context = LuaContext::get();
+        lua_State* current_l = lua_context.get_internal_state();
+        push_ref(current_l, callback_ref);
+        lua_pushboolean(current_l, success);
+        lua_context.call_function(1, 0, "save callback");
+      });
+    }
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of game:get_save_format().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_get_save_format(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Savegame& savegame = *check_game(l, 1);
+
+    push_interned_string(l, enum_to_name(savegame.get_format()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of game:set_save_format().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_set_save_format(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Savegame& savegame = *check_game(l, 1);
+    Savegame::Format format = LuaTools::check_enum<Savegame::Format>(l, 2);
+
+    savegame.set_format(format);
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of game:start().
  * \param l The Lua context that is calling this function.
@@ -621,6 +757,13 @@ int LuaContext::game_api_get_value(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
     Savegame& savegame = *check_game(l, 1);
+
+    if (lua_type(l, 2) == LUA_TNUMBER) {
+      // Value handle.
+      push_savegame_value(l, savegame, check_value_handle(l, 2, savegame));
+      return 1;
+    }
+
     const std::string& key = LuaTools::check_string(l, 2);
 
     if (!LuaTools::is_valid_lua_identifier(key)) {
@@ -630,19 +773,7 @@ int LuaContext::game_api_get_value(lua_State* l) {
           + " and cannot start with a digit");
     }
 
-    if (savegame.is_boolean(key)) {
-      lua_pushboolean(l, savegame.get_boolean(key));
-    }
-    else if (savegame.is_integer(key)) {
-      lua_pushinteger(l, savegame.get_integer(key));
-    }
-    else if (savegame.is_string(key)) {
-      lua_pushstring(l, savegame.get_string(key).c_str());
-    }
-    else {
-      lua_pushnil(l);
-    }
-
+    push_savegame_value(l, savegame, key);
     return 1;
   });
 }
@@ -656,7 +787,15 @@ int LuaContext::game_api_set_value(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
     Savegame& savegame = *check_game(l, 1);
-    const std::string& key = LuaTools::check_string(l, 2);
+
+    SavegameValueHandle handle;
+    if (lua_type(l, 2) == LUA_TNUMBER) {
+      // Value handle.
+      handle = check_value_handle(l, 2, savegame);
+    }
+    const std::string& key = handle.is_valid() ?
+        savegame.get_value_key(handle) :
+        LuaTools::check_string(l, 2);
 
     if (key[0] == '_') {
       LuaTools::arg_error(l, 3,
@@ -664,29 +803,32 @@ int LuaContext::game_api_set_value(lua_State* l) {
           + "': names prefixed by '_' are reserved for built-in variables");
     }
 
-    if (!LuaTools::is_valid_lua_identifier(key)) {
-      LuaTools::arg_error(l, 3,
-          std::string("Invalid savegame variable '") + key
-          + "': the name should only contain alphanumeric characters or '_'"
-          + " and cannot start with a digit");
+    if (!handle.is_valid()) {
+      if (!LuaTools::is_valid_lua_identifier(key)) {
+        LuaTools::arg_error(l, 3,
+            std::string("Invalid savegame variable '") + key
+            + "': the name should only contain alphanumeric characters or '_'"
+            + " and cannot start with a digit");
+      }
+      handle = savegame.get_value_handle(key);
     }
 
     switch (lua_type(l, 3)) {
 
     case LUA_TBOOLEAN:
-      savegame.set_boolean(key, lua_toboolean(l, 3));
+      savegame.set_boolean(handle, lua_toboolean(l, 3));
       break;
 
     case LUA_TNUMBER:
-      savegame.set_integer(key, int(lua_tointeger(l, 3)));
+      savegame.set_integer(handle, int(lua_tointeger(l, 3)));
       break;
 
     case LUA_TSTRING:
-      savegame.set_string(key, lua_tostring(l, 3));
+      savegame.set_string(handle, lua_tostring(l, 3));
       break;
 
     case LUA_TNIL:
-      savegame.unset(key);
+      savegame.unset(handle);
       break;
 
     default:
@@ -697,6 +839,29 @@ int LuaContext::game_api_set_value(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of game:get_value_handle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::game_api_get_value_handle(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Savegame& savegame = *check_game(l, 1);
+    const std::string& key = LuaTools::check_string(l, 2);
+
+    if (!LuaTools::is_valid_lua_identifier(key)) {
+      LuaTools::arg_error(l, 2,
+          std::string("Invalid savegame variable '") + key
+          + "': the name should only contain alphanumeric characters or '_'"
+          + " and cannot start with a digit");
+    }
+
+    lua_pushinteger(l, savegame.get_value_handle(key).get_slot());
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of game:get_starting_location().
  * \param l The Lua context that is calling this function.
@@ -757,7 +922,7 @@ int LuaContext::game_api_get_transition_style(lua_State* l) {
 
     Transition::Style transition_style = savegame.get_default_transition_style();
 
-    push_string(l, enum_to_name(transition_style));
+    push_interned_string(l, enum_to_name(transition_style));
 
     return 1;
   });
@@ -1411,7 +1576,7 @@ int LuaContext::game_api_get_command_keyboard_binding(lua_State* l) {
       lua_pushnil(l);
     }
     else {
-      push_string(l, key_name);
+      push_interned_string(l, key_name);
     }
     return 1;
   });
@@ -1660,6 +1825,7 @@ void LuaContext::game_on_finished(Game& game) {
     on_finished();
   }
   remove_timers(-1);  // Stop timers and menus associated to this game.
+  remove_tasks(-1);
   remove_menus(-1);
   lua_pop(current_l, 1);
 }
@@ -1674,16 +1840,37 @@ void LuaContext::game_on_finished(Game& game) {
 void LuaContext::game_on_update(Game& game) {
 
   push_game(current_l, game.get_savegame());
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(game.get_savegame(), method_name)) {
+  if (userdata_has_field(game.get_savegame(), LuaEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
   lua_pop(current_l, 1);
 }
 
+/**
+ * \brief Calls the on_value_changed() method of a Lua game for some values.
+ *
+ * Does nothing if the method is not defined.
+ *
+ * \param game A game.
+ * \param keys Savegame values that changed during this cycle.
+ */
+void LuaContext::game_on_values_changed(Game& game, const std::set<std::string>& keys) {
+
+  Savegame& savegame = game.get_savegame();
+  if (!userdata_has_field(savegame, "on_value_changed")) {
+    return;
+  }
+
+  run_on_main([this,&savegame,&keys](lua_State* l){
+    push_game(l, savegame);
+    for (const std::string& key : keys) {
+      on_value_changed(savegame, key);
+    }
+    lua_pop(l, 1);
+  });
+}
+
 /**
  * \brief Calls the on_draw() method of a Lua game if it is defined.
  *
@@ -1695,7 +1882,7 @@ void LuaContext::game_on_update(Game& game) {
 void LuaContext::game_on_draw(Game& game, const SurfacePtr& dst_surface) {
 
   push_game(current_l, game.get_savegame());
-  if (userdata_has_field(game.get_savegame(), "on_draw")) {
+  if (userdata_has_field(game.get_savegame(), LuaEvent::ON_DRAW)) {
     on_draw(dst_surface);
   }
   menus_on_draw(-1, dst_surface);
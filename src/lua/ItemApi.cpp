@@ -803,6 +803,7 @@ void LuaContext::item_on_finished(EquipmentItem& item) {
       on_finished();
     }
     remove_timers(-1);  // Stop timers and menus associated to this item.
+    remove_tasks(-1);
     remove_menus(-1);
     lua_pop(l, 1);
   });
@@ -817,10 +818,7 @@ void LuaContext::item_on_finished(EquipmentItem& item) {
  */
 void LuaContext::item_on_update(EquipmentItem& item) {
 
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(item, method_name)) {
+  if (!userdata_has_field(item, LuaEvent::ON_UPDATE)) {
     return;
   }
   run_on_main([this,&item](lua_State* l){
@@ -840,7 +838,7 @@ void LuaContext::item_on_update(EquipmentItem& item) {
  */
 void LuaContext::item_on_suspended(EquipmentItem& item, bool suspended) {
 
-  if (!userdata_has_field(item, "on_suspended")) {
+  if (!userdata_has_field(item, LuaEvent::ON_SUSPENDED)) {
     return;
   }
   run_on_main([this,&item,suspended](lua_State* l){
@@ -58,7 +58,7 @@ void LuaContext::push_dialog(lua_State* l, const Dialog& dialog) {
  */
 void LuaContext::register_language_module() {
 
-  const std::vector<luaL_Reg> functions = {
+  std::vector<luaL_Reg> functions = {
       { "get_language", language_api_get_language },
       { "set_language", language_api_set_language },
       { "get_language_name", language_api_get_language_name },
@@ -66,6 +66,11 @@ void LuaContext::register_language_module() {
       { "get_string", language_api_get_string },
       { "get_dialog", language_api_get_dialog }
   };
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    functions.insert(functions.end(), {
+        { "preload_language", language_api_preload_language },
+    });
+  }
 
   register_functions(language_module_name, functions);
 }
@@ -212,5 +217,24 @@ int LuaContext::language_api_get_dialog(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.language.preload_language().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::language_api_preload_language(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& language_code = LuaTools::check_string(l, 1);
+
+    if (!CurrentQuest::has_language(language_code)) {
+      LuaTools::arg_error(l, 1, std::string("No such language: '") + language_code + "'");
+    }
+    CurrentQuest::preload_language_async(language_code);
+
+    return 0;
+  });
+}
+
 }
 
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/lua/LuaAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace Solarus {
+
+constexpr size_t LuaAllocator::granularity;
+constexpr size_t LuaAllocator::max_small_size;
+constexpr size_t LuaAllocator::chunk_size;
+constexpr size_t LuaAllocator::num_classes;
+
+/**
+ * \brief Creates an allocator with empty pools.
+ */
+LuaAllocator::LuaAllocator():
+  pools(),
+  chunks(),
+  stats(),
+  frame_start_allocations(0) {
+
+}
+
+/**
+ * \brief Releases all chunks.
+ *
+ * The Lua state using this allocator must be closed before.
+ */
+LuaAllocator::~LuaAllocator() {
+
+  for (char* chunk: chunks) {
+    std::free(chunk);
+  }
+}
+
+/**
+ * \brief Returns the counters of this allocator.
+ * \return The counters.
+ */
+const LuaAllocator::Stats& LuaAllocator::get_stats() const {
+  return stats;
+}
+
+/**
+ * \brief Notifies the allocator that a new frame starts.
+ *
+ * Updates the number of allocations of the previous frame.
+ */
+void LuaAllocator::start_frame() {
+
+  stats.frame_allocations = stats.num_allocations - frame_start_allocations;
+  frame_start_allocations = stats.num_allocations;
+}
+
+/**
+ * \brief Allocation function of Lua states, with the semantics of lua_Alloc.
+ * \param ud The LuaAllocator.
+ * \param ptr Block to reallocate or free, or nullptr to allocate a new block.
+ * \param old_size Size of the block if ptr is not nullptr.
+ * \param new_size New size of the block, or 0 to free it.
+ * \return The new block, or nullptr if it was freed or if there is no memory.
+ */
+void* LuaAllocator::allocate(void* ud, void* ptr, size_t old_size, size_t new_size) {
+
+  LuaAllocator& allocator = *static_cast<LuaAllocator*>(ud);
+  if (ptr == nullptr) {
+    // Lua 5.4 gives the type of the object instead of a size here.
+    old_size = 0;
+  }
+  return allocator.reallocate(ptr, old_size, new_size);
+}
+
+/**
+ * \brief Returns the size class of a small block.
+ * \param size Size of the block, between 1 and max_small_size.
+ * \return Index of its pool.
+ */
+size_t LuaAllocator::get_class(size_t size) {
+  return (size - 1) / granularity;
+}
+
+/**
+ * \brief Takes a block from the pool of its size class.
+ * \param size Size of the block, between 1 and max_small_size.
+ * \return The block, or nullptr if there is no memory.
+ */
+void* LuaAllocator::allocate_small(size_t size) {
+
+  const size_t size_class = get_class(size);
+  Pool& pool = pools[size_class];
+  if (pool.free_list != nullptr) {
+    FreeBlock* block = pool.free_list;
+    pool.free_list = block->next;
+    return block;
+  }
+
+  const size_t block_size = (size_class + 1) * granularity;
+  if (pool.next_block == nullptr ||
+      static_cast<size_t>(pool.chunk_end - pool.next_block) < block_size) {
+    // The rest of the current chunk is too small: start a new one.
+    char* chunk = static_cast<char*>(std::malloc(chunk_size));
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    chunks.push_back(chunk);
+    stats.pool_bytes += chunk_size;
+    pool.next_block = chunk;
+    pool.chunk_end = chunk + chunk_size;
+  }
+
+  void* block = pool.next_block;
+  pool.next_block += block_size;
+  return block;
+}
+
+/**
+ * \brief Gives a block back to the pool of its size class.
+ * \param ptr The block.
+ * \param size Size of the block, between 1 and max_small_size.
+ */
+void LuaAllocator::free_small(void* ptr, size_t size) {
+
+  Pool& pool = pools[get_class(size)];
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  block->next = pool.free_list;
+  pool.free_list = block;
+}
+
+/**
+ * \brief Allocates, resizes or frees a block.
+ *
+ * Blocks keep their address as long as they stay in the same size class.
+ *
+ * \param ptr The block, or nullptr to allocate a new one.
+ * \param old_size Size of the block, 0 if ptr is nullptr.
+ * \param new_size New size of the block, 0 to free it.
+ * \return The new block, or nullptr if it was freed or if there is no memory.
+ * In this last case, the block is left unchanged.
+ */
+void* LuaAllocator::reallocate(void* ptr, size_t old_size, size_t new_size) {
+
+  const bool old_small = old_size <= max_small_size;
+  const bool new_small = new_size <= max_small_size;
+
+  if (new_size == 0) {
+    // Free the block.
+    if (ptr != nullptr) {
+      if (old_small) {
+        free_small(ptr, old_size);
+      }
+      else {
+        std::free(ptr);
+        stats.large_bytes -= old_size;
+      }
+      stats.live_bytes -= old_size;
+    }
+    return nullptr;
+  }
+
+  if (ptr != nullptr) {
+    if (old_small && new_small && get_class(old_size) == get_class(new_size)) {
+      // Same size class.
+      stats.live_bytes += static_cast<int64_t>(new_size) - static_cast<int64_t>(old_size);
+      return ptr;
+    }
+    if (!old_small && !new_small) {
+      void* block = std::realloc(ptr, new_size);
+      if (block == nullptr) {
+        return nullptr;
+      }
+      stats.large_bytes += static_cast<int64_t>(new_size) - static_cast<int64_t>(old_size);
+      stats.live_bytes += static_cast<int64_t>(new_size) - static_cast<int64_t>(old_size);
+      return block;
+    }
+  }
+
+  // Allocate a new block, and move the old one there if any.
+  void* block = nullptr;
+  if (new_small) {
+    block = allocate_small(new_size);
+  }
+  else {
+    block = std::malloc(new_size);
+  }
+  if (block == nullptr) {
+    return nullptr;
+  }
+  if (!new_small) {
+    stats.large_bytes += new_size;
+  }
+  stats.live_bytes += new_size;
+  ++stats.num_allocations;
+
+  if (ptr != nullptr) {
+    std::memcpy(block, ptr, std::min(old_size, new_size));
+    reallocate(ptr, old_size, 0);
+  }
+  return block;
+}
+
+}
@@ -15,12 +15,16 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/AbilityInfo.h"
+#include "solarus/core/AsyncFileWriter.h"
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/core/EquipmentItem.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/MemoryUsage.h"
+#include "solarus/core/PerfTrace.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
 #include "solarus/core/Timer.h"
@@ -32,6 +36,7 @@
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Door.h"
 #include "solarus/entities/Enemy.h"
+#include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/entities/EnemyAttack.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/Npc.h"
@@ -40,14 +45,77 @@
 #include "solarus/entities/ShopTreasure.h"
 #include "solarus/entities/Switch.h"
 #include "solarus/entities/Tileset.h"
+#include "solarus/graphics/Video.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
+#include "solarus/lua/LuaAllocator.h"
 #include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaProfiler.h"
 #include "solarus/lua/LuaTools.h"
+#include "solarus/lua/LuaWorkers.h"
 #include "solarus/core/Arguments.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
 #include <sstream>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Identifies script cache files.
+ */
+const std::string script_cache_magic = "SOLS";
+
+/**
+ * \brief Version of the format of script cache files.
+ *
+ * Increment it whenever the format changes:
+ * cache files of other versions are then ignored and regenerated.
+ */
+constexpr uint32_t script_cache_version = 1;
+
+/**
+ * \brief Directory of script cache files, relative to the quest write directory.
+ */
+const std::string script_cache_dir = "script_cache";
+
+/**
+ * \brief Lua names of the frequent events.
+ */
+const std::pair<const char*, LuaEvent> event_names[] = {
+    { "on_update", LuaEvent::ON_UPDATE },
+    { "on_suspended", LuaEvent::ON_SUSPENDED },
+    { "on_pre_draw", LuaEvent::ON_PRE_DRAW },
+    { "on_draw", LuaEvent::ON_DRAW },
+    { "on_post_draw", LuaEvent::ON_POST_DRAW },
+    { "on_position_changed", LuaEvent::ON_POSITION_CHANGED },
+    { "on_movement_changed", LuaEvent::ON_MOVEMENT_CHANGED },
+};
+
+/**
+ * \brief Maximum number of metatables followed when looking up an event
+ * inherited through __index tables.
+ */
+constexpr int max_inheritance_depth = 16;
+
+/**
+ * \brief Appends a piece of bytecode produced by lua_dump() to a string.
+ * \param l The Lua state.
+ * \param data The bytes to append.
+ * \param size Number of bytes.
+ * \param user_data The string to write.
+ * \return 0 to continue the dump.
+ */
+int append_bytecode(lua_State* /* l */, const void* data, size_t size, void* user_data) {
+
+  static_cast<std::string*>(user_data)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+}  // Anonymous namespace
+
 LuaContext* LuaContext::lua_context;
 
 /**
@@ -55,8 +123,22 @@ LuaContext* LuaContext::lua_context;
  * \param main_loop The Solarus main loop manager.
  */
 LuaContext::LuaContext(MainLoop& main_loop):
+  allocator(nullptr),
+  main_l(nullptr),
   current_l(nullptr),
-  main_loop(main_loop) {
+  main_loop(main_loop),
+  menus_iteration_depth(0),
+  pending_menu_moves(),
+  menu_metatable_ref(LUA_REFNIL),
+  next_timer_order(0),
+  task_frame(0),
+  next_task_wait_id(0),
+  running_task(nullptr),
+  lua_events_version(0),
+  userdata_slots_ref(LUA_REFNIL),
+  num_userdata_slots(0),
+  free_userdata_slots(),
+  entity_iterator_tables_ref(LUA_REFNIL) {
 
 }
 
@@ -108,7 +190,20 @@ MainLoop& LuaContext::get_main_loop() {
 void LuaContext::initialize(const Arguments& args) {
 
   // Create an execution context.
-  main_l = current_l = luaL_newstate();
+  lua_State* l = nullptr;
+  const std::string& pool_allocator_arg = args.get_argument_value("-lua-pool-allocator");
+  if (pool_allocator_arg.empty() || pool_allocator_arg == "yes") {
+    allocator = std::unique_ptr<LuaAllocator>(new LuaAllocator());
+    l = lua_newstate(&LuaAllocator::allocate, allocator.get());
+    if (l == nullptr) {
+      // 64-bit LuaJIT without GC64 only accepts its own allocator.
+      allocator = nullptr;
+    }
+  }
+  if (l == nullptr) {
+    l = luaL_newstate();
+  }
+  main_l = current_l = l;
   lua_atpanic(current_l, l_panic);
   luaL_openlibs(current_l);
 
@@ -116,6 +211,11 @@ void LuaContext::initialize(const Arguments& args) {
   find_lua_version();
   Logger::info(std::string("LuaJIT: ") + (luajit ? "yes" : "no") + " (" + lua_version + ")");
 
+  const std::string& script_cache_arg = args.get_argument_value("-script-cache");
+  script_cache_enabled = script_cache_arg.empty() || script_cache_arg == "yes";
+
+  initialize_garbage_collector(args);
+
   // Associate this LuaContext object to the lua_State pointer.
   lua_context = this;
 
@@ -134,6 +234,28 @@ void LuaContext::initialize(const Arguments& args) {
   lua_setfield(current_l, LUA_REGISTRYINDEX, "sol.all_userdata");
                                   // --
 
+  // Also keep each userdata at a fixed slot for fast access from C++.
+  lua_newtable(current_l);
+                                  // udata_slots
+  lua_newtable(current_l);
+                                  // udata_slots meta
+  lua_pushstring(current_l, "v");
+                                  // udata_slots meta "v"
+  lua_setfield(current_l, -2, "__mode");
+                                  // udata_slots meta
+  lua_setmetatable(current_l, -2);
+                                  // udata_slots
+  userdata_slots_ref = luaL_ref(current_l, LUA_REGISTRYINDEX);
+                                  // --
+  num_userdata_slots = 0;
+  free_userdata_slots.clear();
+
+  // Tables of finished entity iterators, to be reused.
+  lua_newtable(current_l);
+                                  // iterator_tables
+  entity_iterator_tables_ref = luaL_ref(current_l, LUA_REGISTRYINDEX);
+                                  // --
+
   // Allow userdata to be indexable if they want.
   lua_newtable(current_l);
                                   // udata_tables
@@ -147,6 +269,15 @@ void LuaContext::initialize(const Arguments& args) {
   // Register the C++ functions and types accessible by Lua.
   register_modules();
 
+  // Notice events defined on metatables of types without their __newindex.
+  lua_getglobal(current_l, "setmetatable");
+                                  // -- setmetatable
+  lua_pushcclosure(current_l, l_setmetatable, 1);
+                                  // -- l_setmetatable
+  lua_setglobal(current_l, "setmetatable");
+                                  // --
+  lua_register(current_l, "rawset", l_rawset);
+
   // Make require() able to load Lua files even from the
   // data.solarus or data.solarus.zip archive.
                                   // --
@@ -205,15 +336,30 @@ void LuaContext::exit() {
     // Destroy unfinished objects.
     destroy_menus();
     destroy_timers();
+    destroy_tasks();
     destroy_drawables();
+    clear_batched_events();
+    if (Video::is_initialized()) {
+      // Pending pixel reads hold Lua callbacks.
+      Video::get_renderer().cancel_pixel_reads();
+    }
+    // So do pending file reads and writes.
+    file_read_callbacks.clear();
+    AsyncFileWriter::cancel_callbacks();
+    // And jobs of Lua workers.
+    LuaWorkers::cancel_callbacks();
     userdata_close_lua();
 
     // Finalize Lua.
+    LuaProfiler::stop();
     lua_close(current_l);
     //lua_contexts.erase(l);
     lua_context = nullptr;
     current_l = nullptr;
     main_l = nullptr;
+    allocator = nullptr;
+    compiled_scripts.clear();
+    interned_strings.clear();
   }
 }
 
@@ -225,6 +371,10 @@ void LuaContext::exit() {
  */
 void LuaContext::update() {
 
+  if (allocator != nullptr) {
+    allocator->start_frame();
+  }
+
   // Make sure the stack does not leak.
   Debug::check_assertion(lua_gettop(main_l) == 0,
       "Non-empty stack before LuaContext::update()"
@@ -252,6 +402,11 @@ void LuaContext::update() {
   Debug::check_assertion(current_l == main_l,
                          "Not on the main lua thread after updating timers");
 
+  update_tasks();
+
+  Debug::check_assertion(current_l == main_l,
+                         "Not on the main lua thread after updating tasks");
+
   // Call sol.main.on_update().
   main_on_update();
 
@@ -262,8 +417,14 @@ void LuaContext::update() {
     cross_state_callbacks.pop();
   }
 
+  // Deliver high-frequency events collected during this cycle.
+  deliver_batched_events();
+
   current_l = main_l; //Ensure we run again on the main thread
 
+  MemoryUsage::set(MemoryUsage::Category::LUA,
+      int64_t(lua_gc(main_l, LUA_GCCOUNT, 0)) * 1024 + lua_gc(main_l, LUA_GCCOUNTB, 0));
+
   Debug::check_assertion(lua_gettop(main_l) == 0,
       "Non-empty stack after LuaContext::update()"
   );
@@ -396,8 +557,6 @@ void LuaContext::run_enemy(Enemy& enemy) {
     push_enemy(current_l, enemy);
     call_function(1, 0, file_name.c_str());
   }
-
-  // TODO parse Lua only once for each breed.
 }
 
 /**
@@ -427,8 +586,6 @@ void LuaContext::run_custom_entity(CustomEntity& custom_entity) {
     push_custom_entity(current_l, custom_entity);
     call_function(1, 0, file_name.c_str());
   }
-
-  // TODO parse Lua only once for each model.
 }
 
 /**
@@ -616,6 +773,92 @@ bool LuaContext::userdata_has_field(
   return it->second.find(key) != it->second.end();
 }
 
+/**
+ * \brief Returns whether a userdata defines one of the frequent events.
+ *
+ * This is equivalent to userdata_has_field() with the name of the event,
+ * but it does not do any Lua lookup nor string comparison: the userdata
+ * and their metatables remember which events were set on them.
+ *
+ * Events set on metatables with rawset() are also tracked, and types whose
+ * metatable got another metatable from scripts are looked up in Lua.
+ *
+ * \param userdata A userdata.
+ * \param event The event to test.
+ * \return \c true if this event may exist on the userdata.
+ * A false positive is possible if the event was removed from the metatable.
+ */
+bool LuaContext::userdata_has_field(
+    const ExportableToLua& userdata, LuaEvent event) const {
+
+  // First check the userdata itself.
+  if (userdata.has_lua_event(event)) {
+    return true;
+  }
+
+  // Then check the metatable of the type.
+  const std::string& type_name = userdata.get_lua_type_name();
+  if (!untracked_metatables.empty() &&
+      untracked_metatables.find(type_name) != untracked_metatables.end()) {
+    // Scripts replaced the metatable that tracks events, for example to
+    // inherit them from another table: look them up in Lua.
+    return userdata_has_inherited_metafield(userdata, get_lua_event_name(event));
+  }
+  const auto& it = metatable_events.find(type_name);
+  if (it == metatable_events.end()) {
+    return false;
+  }
+  return (it->second & (1u << static_cast<int>(event))) != 0;
+}
+
+/**
+ * \brief Returns a counter that changes whenever frequent events are set or
+ * removed on userdata or metatables.
+ *
+ * This allows C++ code to cache the result of userdata_has_field() for an
+ * event until this value changes.
+ *
+ * \return The current version of the events.
+ */
+uint32_t LuaContext::get_lua_events_version() const {
+  return lua_events_version;
+}
+
+/**
+ * \brief Returns the frequent event corresponding to a key if any.
+ * \param[in] key A string key set on a userdata or a metatable.
+ * \param[out] event The corresponding event.
+ * \return \c true if the key is the name of a tracked event.
+ */
+bool LuaContext::get_lua_event(const char* key, LuaEvent& event) {
+
+  if (key[0] != 'o' || key[1] != 'n' || key[2] != '_') {
+    return false;
+  }
+  for (const std::pair<const char*, LuaEvent>& event_name : event_names) {
+    if (std::strcmp(key, event_name.first) == 0) {
+      event = event_name.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Returns the Lua name of a frequent event.
+ * \param event An event.
+ * \return Its name.
+ */
+const char* LuaContext::get_lua_event_name(LuaEvent event) {
+
+  for (const std::pair<const char*, LuaEvent>& event_name : event_names) {
+    if (event_name.second == event) {
+      return event_name.first;
+    }
+  }
+  return "";
+}
+
 /**
  * \brief Returns whether the metatable of a userdata has the specified field.
  * \param userdata A userdata.
@@ -640,6 +883,57 @@ bool LuaContext::userdata_has_metafield(
   return found;
 }
 
+/**
+ * \brief Returns whether the metatable of a userdata has the specified field,
+ * including fields inherited through __index tables of its metatables.
+ *
+ * No Lua function is called: if an __index metamethod is a function,
+ * the field is considered to exist.
+ *
+ * \param userdata A userdata.
+ * \param key String key to test.
+ * \return \c true if this key may exist on the userdata's metatable.
+ */
+bool LuaContext::userdata_has_inherited_metafield(
+    const ExportableToLua& userdata, const char* key) const {
+
+  const int top = lua_gettop(current_l);
+  bool found = false;
+                                  // ...
+  luaL_getmetatable(current_l, userdata.get_lua_type_name().c_str());
+                                  // ... table
+  for (int depth = 0; depth < max_inheritance_depth; ++depth) {
+    if (lua_isfunction(current_l, -1)) {
+      found = true;
+      break;
+    }
+    if (!lua_istable(current_l, -1)) {
+      break;
+    }
+    lua_pushstring(current_l, key);
+                                  // ... table key
+    lua_rawget(current_l, -2);
+                                  // ... table field/nil
+    if (!lua_isnil(current_l, -1)) {
+      found = true;
+      break;
+    }
+    lua_pop(current_l, 1);
+                                  // ... table
+    if (!lua_getmetatable(current_l, -1)) {
+      break;
+    }
+                                  // ... table meta
+    lua_pushliteral(current_l, "__index");
+                                  // ... table meta "__index"
+    lua_rawget(current_l, -2);
+                                  // ... table meta __index/nil
+  }
+  lua_settop(current_l, top);
+                                  // ...
+  return found;
+}
+
 /**
  * \brief Gets a method of the object on top of the stack.
  *
@@ -666,6 +960,7 @@ bool LuaContext::find_method(const char* function_name) {
  * \param function_name Name of the function to find in the object.
  * This is not an const std::string& but a const char* on purpose to avoid
  * costly conversions as this function is called very often.
+ * It must be a string literal: see push_interned_string().
  *
  * \return true if the function was found.
  */
@@ -673,7 +968,9 @@ bool LuaContext::find_method(int index, const char* function_name) {
 
   index = LuaTools::get_positive_index(current_l, index);
                                   // ... object ...
-  lua_getfield(current_l, index, function_name);
+  push_interned_string(current_l, function_name);
+                                  // ... object ... function_name
+  lua_gettable(current_l, index);
                                   // ... object ... method/?
 
   bool exists = lua_isfunction(current_l, -1);
@@ -714,6 +1011,7 @@ bool LuaContext::call_function(
     int nb_results,
     const char* function_name
 ) {
+  PerfTrace::Scope trace_scope(function_name);
   return LuaTools::call_function(current_l, nb_arguments, nb_results, function_name);
 }
 
@@ -745,9 +1043,17 @@ bool LuaContext::load_file(const std::string& script_name) {
   }
 
   // Load the file.
-  // "@" tells Lua that the name is a file name, which is useful for better error messages.
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
-  int result = luaL_loadbuffer(current_l, buffer.data(), buffer.size(), ("@" + file_name).c_str());
+  int result = 0;
+  const auto it = compiled_scripts.find(file_name);
+  if (it != compiled_scripts.end()) {
+    // Already compiled during this run.
+    const std::string& bytecode = it->second;
+    result = luaL_loadbuffer(current_l, bytecode.data(), bytecode.size(), ("@" + file_name).c_str());
+  }
+  else {
+    const std::string& buffer = QuestFiles::data_file_read(file_name);
+    result = load_script_source(file_name, buffer);
+  }
 
   if (result != 0) {
     Debug::error(std::string("Failed to load script '")
@@ -758,6 +1064,159 @@ bool LuaContext::load_file(const std::string& script_name) {
   return true;
 }
 
+/**
+ * \brief Compiles the content of a script file and lets it on top of the
+ * stack as a function.
+ *
+ * The bytecode is kept in memory so that scripts loaded again,
+ * like the ones of enemies, are not parsed again during this run.
+ * If the quest has a write directory, the bytecode is also saved there
+ * and reused by next runs while the source and the Lua runtime are the same.
+ * Files that are already bytecode, for example precompiled when packaging
+ * the quest, are loaded directly.
+ *
+ * \param file_name Name of the script file, relative to the data directory.
+ * \param source Content of the file.
+ * \return The result of luaL_loadbuffer().
+ * In case of error, the error message is on top of the stack.
+ */
+int LuaContext::load_script_source(const std::string& file_name, const std::string& source) {
+
+  // "@" tells Lua that the name is a file name, which is useful for better error messages.
+  const std::string& chunk_name = "@" + file_name;
+  if (!script_cache_enabled ||
+      (!source.empty() && source[0] == LUA_SIGNATURE[0])) {
+    // Bytecode files of Lua and LuaJIT both start with the escape character.
+    return luaL_loadbuffer(current_l, source.data(), source.size(), chunk_name.c_str());
+  }
+
+  std::string cache_file_name;
+  std::string bytecode;
+  if (!QuestFiles::get_quest_write_dir().empty()) {
+    cache_file_name = get_script_cache_file_name(file_name, source);
+    if (read_script_cache(cache_file_name, bytecode)) {
+      if (luaL_loadbuffer(current_l, bytecode.data(), bytecode.size(), chunk_name.c_str()) == 0) {
+        compiled_scripts[file_name] = std::move(bytecode);
+        return 0;
+      }
+      // Rejected by the runtime: compile the source again.
+      lua_pop(current_l, 1);
+    }
+  }
+
+  const int result = luaL_loadbuffer(current_l, source.data(), source.size(), chunk_name.c_str());
+  if (result != 0) {
+    return result;
+  }
+
+  bytecode.clear();
+  if (dump_function(bytecode)) {
+    if (!cache_file_name.empty()) {
+      write_script_cache(cache_file_name, bytecode);
+    }
+    compiled_scripts[file_name] = std::move(bytecode);
+  }
+  return 0;
+}
+
+/**
+ * \brief Returns the name of the cache file of a script.
+ *
+ * The name depends on the source and on the Lua runtime,
+ * so that bytecode made by another runtime is never loaded.
+ *
+ * \param file_name Name of the script file.
+ * \param source Content of the script file.
+ * \return Name of the cache file in the quest write directory.
+ */
+std::string LuaContext::get_script_cache_file_name(
+    const std::string& file_name,
+    const std::string& source) const {
+
+  std::ostringstream key;
+  key << lua_version << '\0' << sizeof(void*) << '\0' << file_name << '\0' << source;
+  const std::string& key_string = key.str();
+
+  std::ostringstream oss;
+  oss << script_cache_dir << '/'
+      << std::hex << std::setw(16) << std::setfill('0')
+      << get_fnv1a_hash(key_string.data(), key_string.size())
+      << ".luac";
+  return oss.str();
+}
+
+/**
+ * \brief Reads the bytecode of a script from a cache file.
+ * \param[in] cache_file_name Name of the cache file in the quest write directory.
+ * \param[out] bytecode The bytecode read.
+ * \return \c true in case of success, \c false if the cache file does not
+ * exist, is corrupted or is outdated.
+ */
+bool LuaContext::read_script_cache(const std::string& cache_file_name, std::string& bytecode) {
+
+  if (!QuestFiles::data_file_exists(cache_file_name)) {
+    return false;
+  }
+
+  const std::string& cache = QuestFiles::data_file_read(cache_file_name);
+  if (cache.compare(0, script_cache_magic.size(), script_cache_magic) != 0) {
+    return false;
+  }
+
+  BinaryReader header(cache, script_cache_magic.size());
+  const uint32_t version = header.read_uint();
+  const uint64_t payload_hash = header.read_uint64();
+  const size_t position = header.get_position();
+  if (header.has_failed() ||
+      version != script_cache_version ||
+      position >= cache.size() ||
+      payload_hash != get_fnv1a_hash(cache.data() + position, cache.size() - position)) {
+    return false;
+  }
+
+  bytecode = cache.substr(position);
+  return true;
+}
+
+/**
+ * \brief Saves the bytecode of a script into a cache file.
+ *
+ * Failures are silently ignored: the script will be compiled again next time.
+ *
+ * \param cache_file_name Name of the cache file in the quest write directory.
+ * \param bytecode The bytecode to save.
+ */
+void LuaContext::write_script_cache(const std::string& cache_file_name, const std::string& bytecode) {
+
+  BinaryWriter header;
+  header.write_uint(script_cache_version);
+  header.write_uint64(get_fnv1a_hash(bytecode.data(), bytecode.size()));
+
+  QuestFiles::data_file_mkdir(script_cache_dir);
+  QuestFiles::data_file_try_save(
+      cache_file_name,
+      script_cache_magic + header.get_buffer() + bytecode
+  );
+}
+
+/**
+ * \brief Returns the bytecode of the function on top of the stack.
+ *
+ * Debug information is kept for error messages.
+ *
+ * \param[out] bytecode The bytecode.
+ * \return \c true in case of success.
+ */
+bool LuaContext::dump_function(std::string& bytecode) {
+
+#if LUA_VERSION_NUM >= 503
+  const int result = lua_dump(current_l, append_bytecode, &bytecode, 0);
+#else
+  const int result = lua_dump(current_l, append_bytecode, &bytecode);
+#endif
+  return result == 0 && !bytecode.empty();
+}
+
 /**
  * \brief Opens a Lua file and executes it.
  *
@@ -994,6 +1453,129 @@ void LuaContext::find_lua_version() {
   Debug::check_assertion(lua_gettop(current_l) == 0, "Non-empty Lua stack after find_lua_version()");
 }
 
+/**
+ * \brief Returns the name of a garbage collection mode.
+ * \param mode A garbage collection mode.
+ * \return Its name, as accepted by the -lua-gc option.
+ */
+const char* LuaContext::get_gc_mode_name(GcMode mode) {
+
+  switch (mode) {
+
+  case GcMode::AUTO:
+    return "auto";
+
+  case GcMode::FRAME:
+    return "frame";
+
+  case GcMode::GENERATIONAL:
+    return "generational";
+  }
+  return "";
+}
+
+/**
+ * \brief Sets up the garbage collector from the command-line options.
+ *
+ * The -lua-gc option can be "auto" (the default, the collector only runs
+ * when the allocator decides to), "frame" (the main loop also runs
+ * incremental steps while it has idle time) or "generational"
+ * (like frame, but with the generational collector of Lua 5.4).
+ *
+ * \param args Command-line arguments.
+ */
+void LuaContext::initialize_garbage_collector(const Arguments& args) {
+
+  gc_mode = GcMode::AUTO;
+  gc_stats = GcStats();
+  gc_memory_after_cycle = 0;
+
+  const std::string& gc_arg = args.get_argument_value("-lua-gc");
+  if (gc_arg == "frame") {
+    gc_mode = GcMode::FRAME;
+  }
+  else if (gc_arg == "generational") {
+#if LUA_VERSION_NUM >= 504
+    gc_mode = GcMode::GENERATIONAL;
+    lua_gc(main_l, LUA_GCGEN, 0, 0);
+#else
+    Debug::warning("Generational garbage collection needs Lua 5.4, using -lua-gc=frame instead");
+    gc_mode = GcMode::FRAME;
+#endif
+  }
+  else if (!gc_arg.empty() && gc_arg != "auto") {
+    Debug::warning("Unknown garbage collection mode '" + gc_arg + "', using -lua-gc=auto instead");
+  }
+
+  if (gc_mode != GcMode::AUTO) {
+    Logger::info(std::string("Lua garbage collection: ") + get_gc_mode_name(gc_mode));
+  }
+}
+
+/**
+ * \brief Returns the memory currently used by Lua.
+ * \return The memory in KiB.
+ */
+int LuaContext::get_memory_usage() const {
+
+  if (main_l == nullptr) {
+    return 0;
+  }
+  return lua_gc(main_l, LUA_GCCOUNT, 0);
+}
+
+/**
+ * \brief Runs garbage collection steps in the time left before the next frame.
+ *
+ * Does nothing in the auto mode.
+ * Steps are run during at most half of the idle time, and never more than
+ * max_gc_frame_time. Paying the collection debt here makes the allocator
+ * trigger fewer steps in the middle of the simulation.
+ * After a cycle completes, no new cycle is started before the memory
+ * in use grows by half, so that the next one starts here rather than when
+ * the allocator reaches its own threshold (twice the memory by default).
+ *
+ * \param idle_time Time in milliseconds until the next frame.
+ */
+void LuaContext::step_garbage_collector(uint32_t idle_time) {
+
+  gc_stats.frame_time = 0;
+  if (gc_mode == GcMode::AUTO || main_l == nullptr || idle_time == 0) {
+    return;
+  }
+
+  const int memory = lua_gc(main_l, LUA_GCCOUNT, 0);
+  if (gc_memory_after_cycle != 0 && 2 * memory < 3 * gc_memory_after_cycle) {
+    // Nothing to collect yet.
+    return;
+  }
+
+  PerfTrace::Scope trace_scope("lua-gc");
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point deadline = start + std::chrono::microseconds(
+        std::min<int64_t>(idle_time * 1000 / 2, max_gc_frame_time));
+
+  gc_memory_after_cycle = 0;
+  Clock::time_point now = start;
+  do {
+    const bool finished = lua_gc(main_l, LUA_GCSTEP, 0) != 0;
+    ++gc_stats.num_steps;
+    now = Clock::now();
+    if (finished || gc_mode == GcMode::GENERATIONAL) {
+      // In generational mode, a step is a whole minor collection.
+      ++gc_stats.num_cycles;
+      gc_memory_after_cycle = std::max(lua_gc(main_l, LUA_GCCOUNT, 0), 1);
+      break;
+    }
+  } while (now < deadline);
+
+  gc_stats.frame_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        now - start).count();
+  gc_stats.max_frame_time = std::max(gc_stats.max_frame_time, gc_stats.frame_time);
+  gc_stats.total_time += gc_stats.frame_time;
+}
+
 /**
  * \brief Defines some C++ functions into a Lua table.
  * \param module_name name of the table that will contain the functions
@@ -1054,6 +1636,16 @@ void LuaContext::register_type(
   luaL_newmetatable(current_l, module_name.c_str());
                                   // meta
 
+  // Remember the type of this metatable to recognize its userdata quickly.
+  bool is_entity_type = false;
+  for (const auto& kvp : EnumInfoTraits<EntityType>::names) {
+    if (module_name == get_entity_internal_type_name(kvp.first)) {
+      is_entity_type = true;
+      break;
+    }
+  }
+  userdata_types[lua_topointer(current_l, -1)] = { module_name, is_entity_type };
+
   // Store a metafield __solarus_type with the module name.
   lua_pushstring(current_l, module_name.c_str());
                                   // meta type_name
@@ -1074,6 +1666,16 @@ void LuaContext::register_type(
                                   // meta
   }
 
+  // Track the events that scripts define on the metatable.
+  lua_newtable(current_l);
+                                  // meta meta_meta
+  lua_pushcfunction(current_l, metatable_meta_newindex);
+                                  // meta meta_meta __newindex
+  lua_setfield(current_l, -2, "__newindex");
+                                  // meta meta_meta
+  lua_setmetatable(current_l, -2);
+                                  // meta
+
   // make metatable.__index = metatable,
   // unless if __index is already defined
   lua_getfield(current_l, -1, "__index");
@@ -1111,10 +1713,16 @@ void LuaContext::register_modules() {
   register_input_module();
   register_video_module();
   register_shader_module();
+  register_pixel_buffer_module();
+  register_draw_list_module();
+  register_random_module();
   register_file_module();
   register_menu_module();
   register_language_module();
   register_state_module();
+  register_task_module();
+  register_worker_module();
+  register_ffi_accessors();
 
   Debug::check_assertion(lua_gettop(current_l) == 0,
       "Lua stack is not empty after modules initialization");
@@ -1129,6 +1737,55 @@ void LuaContext::push_string(lua_State* l, const std::string& text) {
   lua_pushlstring(l, text.c_str(), text.size());
 }
 
+/**
+ * \brief Pushes a constant string onto the stack.
+ *
+ * The Lua string is created once and kept in the registry, so that
+ * next pushes don't hash the text again.
+ *
+ * \param l A Lua context.
+ * \param text A string whose storage lives as long as the program,
+ * like a string literal. Strings are identified by their address.
+ */
+void LuaContext::push_interned_string(lua_State* l, const char* text) {
+
+  std::unordered_map<const void*, int>& interned_strings = get().interned_strings;
+  const auto it = interned_strings.find(text);
+  if (it != interned_strings.end()) {
+    lua_rawgeti(l, LUA_REGISTRYINDEX, it->second);
+    return;
+  }
+
+  lua_pushstring(l, text);
+  lua_pushvalue(l, -1);
+  interned_strings.emplace(text, luaL_ref(l, LUA_REGISTRYINDEX));
+}
+
+/**
+ * \brief Pushes a constant string onto the stack.
+ *
+ * The Lua string is created once and kept in the registry, so that
+ * next pushes don't hash the text again.
+ *
+ * \param l A Lua context.
+ * \param text A string whose storage lives as long as the program,
+ * like names returned by enum_to_name(). Strings are identified by their
+ * address.
+ */
+void LuaContext::push_interned_string(lua_State* l, const std::string& text) {
+
+  std::unordered_map<const void*, int>& interned_strings = get().interned_strings;
+  const auto it = interned_strings.find(&text);
+  if (it != interned_strings.end()) {
+    lua_rawgeti(l, LUA_REGISTRYINDEX, it->second);
+    return;
+  }
+
+  push_string(l, text);
+  lua_pushvalue(l, -1);
+  interned_strings.emplace(&text, luaL_ref(l, LUA_REGISTRYINDEX));
+}
+
 /**
  * \brief Pushes a color onto the stack.
  * \param l A Lua context.
@@ -1157,9 +1814,35 @@ void LuaContext::push_color(lua_State* l, const Color& color) {
  */
 void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
 
+  lua_State* main = lua_context->main_l;
+
+  // Fast path: the userdata is still at its slot.
+  const int slot = userdata.get_lua_slot();
+  if (slot != 0) {
+    lua_rawgeti(main, LUA_REGISTRYINDEX, lua_context->userdata_slots_ref);
+                                  // ... udata_slots
+    lua_rawgeti(main, -1, slot);
+                                  // ... udata_slots udata/nil
+    const ExportableToLuaPtr* cached = static_cast<ExportableToLuaPtr*>(
+        lua_touserdata(main, -1));
+    if (cached != nullptr && cached->get() == &userdata) {
+      lua_remove(main, -2);
+                                  // ... udata
+      if (l != main) {
+        lua_xmove(main, l, 1);
+      }
+      return;
+    }
+    lua_pop(main, 2);
+                                  // ...
+    if (cached != nullptr) {
+      // The slot was reserved in a previous Lua state.
+      userdata.set_lua_slot(0);
+    }
+  }
+
   // See if this userdata already exists.
   //Look in main for the userdata table entry
-  lua_State* main = lua_context->main_l;
   lua_getfield(main, LUA_REGISTRYINDEX, "sol.all_userdata");
                                   // ... all_udata
   lua_pushlightuserdata(main, &userdata);
@@ -1237,6 +1920,9 @@ void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
                                   // ... udata
   }
 
+  // Remember the slot of the userdata for the next time.
+  lua_context->set_userdata_slot(main, userdata);
+
   //Check if target stack is different from main...
   if(l != main) {
     //Move ref to target stack
@@ -1244,11 +1930,70 @@ void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
   }
 }
 
+/**
+ * \brief Stores the userdata on top of the main stack at the slot of its
+ * object.
+ *
+ * A slot is reserved for the object if it does not have one yet.
+ *
+ * \param main The main Lua state, with the userdata on top of its stack.
+ * \param userdata The object of this userdata.
+ */
+void LuaContext::set_userdata_slot(lua_State* main, ExportableToLua& userdata) {
+
+  int slot = userdata.get_lua_slot();
+  if (slot == 0) {
+    if (!free_userdata_slots.empty()) {
+      slot = free_userdata_slots.back();
+      free_userdata_slots.pop_back();
+    }
+    else {
+      slot = ++num_userdata_slots;
+    }
+    userdata.set_lua_slot(slot);
+  }
+                                  // ... udata
+  lua_rawgeti(main, LUA_REGISTRYINDEX, userdata_slots_ref);
+                                  // ... udata udata_slots
+  lua_pushvalue(main, -2);
+                                  // ... udata udata_slots udata
+  lua_rawseti(main, -2, slot);
+                                  // ... udata udata_slots
+  lua_pop(main, 1);
+                                  // ... udata
+}
+
+/**
+ * \brief Returns the Solarus type of a value.
+ *
+ * The metatable of the value is identified by its address: no string is
+ * looked up in the Lua registry.
+ *
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return The type of the value, or nullptr if it is not a Solarus userdata.
+ */
+const LuaContext::UserdataType* LuaContext::get_userdata_type(lua_State* l, int index) {
+
+  if (lua_type(l, index) != LUA_TUSERDATA || !lua_getmetatable(l, index)) {
+    return nullptr;
+  }
+  const void* metatable = lua_topointer(l, -1);
+  lua_pop(l, 1);
+
+  const std::unordered_map<const void*, UserdataType>& types = lua_context->userdata_types;
+  const auto it = types.find(metatable);
+  if (it == types.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
 /**
  * \brief Get pointer to userdata if it is of the given type.
  *
- * This is luaL_testudata from the Lua auxiliary library.
- * It should be replaced when Lua 5.3/LuaJIT 2.1 or higher is required.
+ * This is luaL_testudata from the Lua auxiliary library,
+ * with metatables compared through get_userdata_type().
  *
  * \param l A Lua context.
  * \param index An index in the stack.
@@ -1259,21 +2004,11 @@ void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
 void* LuaContext::test_userdata(
     lua_State* l, int index, const char* module_name) {
 
-  index = LuaTools::get_positive_index(l, index);
-
-  void* udata = lua_touserdata(l, index);
-  if (udata == nullptr || !lua_getmetatable(l, index)) {
+  const UserdataType* type = get_userdata_type(l, index);
+  if (type == nullptr || type->module_name != module_name) {
     return nullptr;
   }
-  // ... udata ... meta(found)
-  lua_getfield(l, LUA_REGISTRYINDEX, module_name);
-  // ... udata ... meta(found) meta(expected)
-  if (lua_rawequal(l, -1, -2) == 0) {
-    udata = nullptr;
-  }
-  lua_pop(l, 2);
-  // ... udata ...
-  return udata;
+  return lua_touserdata(l, index);
 }
 
 /**
@@ -1324,32 +2059,13 @@ bool LuaContext::is_solarus_userdata(
     int index,
     std::string& module_name
 ) {
-  void* udata = lua_touserdata(l, index);
-  if (udata == nullptr) {
-    // This is not a userdata.
-    return false;
-  }
-
-  if (!lua_getmetatable(l, index)) {
-    // The userdata has no metatable.
-    return false;
-  }
-
-  // Get the name of the Solarus type from this userdata.
-  lua_pushstring(l, "__solarus_type");
-  lua_rawget(l, -2);
-  if (!lua_isstring(l, -1)) {
-    // This is probably a userdata from some library other than Solarus.
-    lua_pop(l, 2);
-    return false;
-  }
-
-  // Check if the type name is one of the entity type names.
-  module_name = lua_tostring(l, -1);
-  if (module_name.substr(0, 4) != "sol.") {
+  const UserdataType* type = get_userdata_type(l, index);
+  if (type == nullptr) {
+    // Not a userdata, or a userdata from some library other than Solarus.
     return false;
   }
 
+  module_name = type->module_name;
   return true;
 }
 
@@ -1388,6 +2104,13 @@ int LuaContext::userdata_meta_gc(lua_State* l) {
  */
 void LuaContext::notify_userdata_destroyed(ExportableToLua& userdata) {
 
+  const int slot = userdata.get_lua_slot();
+  if (slot != 0) {
+    // The userdata was collected: its weak entry is already cleared.
+    userdata.set_lua_slot(0);
+    free_userdata_slots.push_back(slot);
+  }
+
   if (userdata.is_with_lua_table()) {
     // Remove the table associated to this userdata.
     // Otherwise, if the same pointer gets reallocated, a new userdata will get
@@ -1426,10 +2149,22 @@ void LuaContext::userdata_close_lua() {
     ExportableToLua* userdata = static_cast<ExportableToLua*>(
         lua_touserdata(current_l, -2));
     userdata->set_lua_context(nullptr);
+    userdata->clear_lua_events();
+    userdata->set_lua_slot(0);
     lua_pop(current_l, 1);
   }
   lua_pop(current_l, 1);
   userdata_fields.clear();
+  userdata_types.clear();
+  metatable_events.clear();
+  untracked_metatables.clear();
+  ++lua_events_version;
+  luaL_unref(current_l, LUA_REGISTRYINDEX, userdata_slots_ref);
+  userdata_slots_ref = LUA_REFNIL;
+  num_userdata_slots = 0;
+  free_userdata_slots.clear();
+  luaL_unref(current_l, LUA_REGISTRYINDEX, entity_iterator_tables_ref);
+  entity_iterator_tables_ref = LUA_REFNIL;
 
   // Clear userdata tables.
   lua_pushnil(current_l);
@@ -1502,8 +2237,57 @@ int LuaContext::userdata_meta_newindex_as_table(lua_State* l) {
       // Assigning nil: remove the key from the list.
       get().userdata_fields[userdata.get()].erase(lua_tostring(l, 2));
     }
+
+    LuaEvent event;
+    if (get_lua_event(lua_tostring(l, 2), event)) {
+      userdata->set_lua_event(event, !lua_isnil(l, 3));
+      ++get().lua_events_version;
+      if (event == LuaEvent::ON_UPDATE && is_entity(l, 1)) {
+        // Wake up the entity if it only updates on demand.
+        std::static_pointer_cast<Entity>(userdata)->notify_hot_state_changed();
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * \brief Implementation of __newindex for the metatables of our types.
+ *
+ * Sets the field like a normal table does, and remembers if the key is
+ * a frequent event so that userdata_has_field() does not have to look it up.
+ * This is only called for keys that do not exist yet in the metatable:
+ * events removed later are still considered as maybe defined, which is
+ * harmless. Fields set with rawset() are tracked by l_rawset().
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::metatable_meta_newindex(lua_State* l) {
+
+  LuaTools::check_type(l, 1, LUA_TTABLE);
+  LuaTools::check_any(l, 2);
+  LuaTools::check_any(l, 3);
+
+  LuaEvent event;
+  if (lua_type(l, 2) == LUA_TSTRING &&
+      !lua_isnil(l, 3) &&
+      get_lua_event(lua_tostring(l, 2), event)) {
+
+    lua_getfield(l, 1, "__solarus_type");
+                                  // meta key value type_name/nil
+    if (lua_isstring(l, -1)) {
+      get().metatable_events[lua_tostring(l, -1)] |= 1u << static_cast<int>(event);
+      ++get().lua_events_version;
+    }
+    lua_pop(l, 1);
+                                  // meta key value
   }
 
+  lua_settop(l, 3);
+  lua_rawset(l, 1);
+                                  // meta
   return 0;
 }
 
@@ -1830,7 +2614,7 @@ bool LuaContext::on_key_pressed(const InputEvent& event) {
     const std::string& key_name = enum_to_name(event.get_keyboard_key());
     if (!key_name.empty()) { // This key exists in the Solarus API.
 
-      push_string(current_l, key_name);
+      push_interned_string(current_l, key_name);
       lua_newtable(current_l);
 
       if (event.is_with_shift()) {
@@ -1905,7 +2689,7 @@ bool LuaContext::on_key_released(const InputEvent& event) {
 
     const std::string& key_name = enum_to_name(event.get_keyboard_key());
     if (!key_name.empty()) { // This key exists in the Solarus API.
-      push_string(current_l, key_name);
+      push_interned_string(current_l, key_name);
       bool success = call_function(2, 1, "on_key_released");
       if (!success) {
         // Something was wrong in the script: don't propagate the input to other objects.
@@ -2052,7 +2836,7 @@ bool LuaContext::on_mouse_button_pressed(const InputEvent& event) {
       return handled;
     }
 
-    push_string(current_l, button_name);
+    push_interned_string(current_l, button_name);
     lua_pushinteger(current_l, mouse_xy.x);
     lua_pushinteger(current_l, mouse_xy.y);
 
@@ -2089,7 +2873,7 @@ bool LuaContext::on_mouse_button_released(const InputEvent& event) {
       return handled;
     }
 
-    push_string(current_l, button_name);
+    push_interned_string(current_l, button_name);
     lua_pushinteger(current_l, mouse_xy.x);
     lua_pushinteger(current_l, mouse_xy.y);
 
@@ -2216,7 +3000,7 @@ bool LuaContext::on_command_pressed(GameCommand command) {
   check_callback_thread();
   bool handled = false;
   if (find_method("on_command_pressed")) {
-    push_string(current_l, GameCommands::get_command_name(command));
+    push_interned_string(current_l, GameCommands::get_command_name(command));
     bool success = call_function(2, 1, "on_command_pressed");
     if (!success) {
       // Something was wrong in the script: don't propagate the command to other objects.
@@ -2238,7 +3022,7 @@ bool LuaContext::on_command_released(GameCommand command) {
   check_callback_thread();
   bool handled = false;
   if (find_method("on_command_released")) {
-    push_string(current_l, GameCommands::get_command_name(command));
+    push_interned_string(current_l, GameCommands::get_command_name(command));
     bool success = call_function(2, 1, "on_command_released");
     if (!success) {
       // Something was wrong in the script: don't propagate the command to other objects.
@@ -2338,6 +3122,23 @@ void LuaContext::on_changed() {
   }
 }
 
+/**
+ * \brief Calls the on_path_ready() method of the object on top of the stack.
+ * \param path The path computed, as a string of direction8 characters.
+ */
+void LuaContext::on_path_ready(const std::string& path) {
+  check_callback_thread();
+  if (find_method("on_path_ready")) {
+    lua_newtable(current_l);
+    for (size_t i = 0; i < path.size(); i++) {
+      int direction8 = path[i] - '0';
+      lua_pushinteger(current_l, direction8);
+      lua_rawseti(current_l, -2, static_cast<int>(i + 1));
+    }
+    call_function(2, 0, "on_path_ready");
+  }
+}
+
 /**
  * \brief Calls the on_started() method of the object on top of the stack.
  * \param destination The destination point used (nullptr if it is a special one).
@@ -2410,6 +3211,34 @@ void LuaContext::on_obtained_treasure(const Treasure& treasure) {
   }
 }
 
+/**
+ * \brief Calls the on_chunk_activated() method of the object on top of the stack.
+ * \param column Column of the chunk.
+ * \param row Row of the chunk.
+ */
+void LuaContext::on_chunk_activated(int column, int row) {
+  check_callback_thread();
+  if (find_method("on_chunk_activated")) {
+    lua_pushinteger(current_l, column);
+    lua_pushinteger(current_l, row);
+    call_function(3, 0, "on_chunk_activated");
+  }
+}
+
+/**
+ * \brief Calls the on_chunk_deactivated() method of the object on top of the stack.
+ * \param column Column of the chunk.
+ * \param row Row of the chunk.
+ */
+void LuaContext::on_chunk_deactivated(int column, int row) {
+  check_callback_thread();
+  if (find_method("on_chunk_deactivated")) {
+    lua_pushinteger(current_l, column);
+    lua_pushinteger(current_l, row);
+    call_function(3, 0, "on_chunk_deactivated");
+  }
+}
+
 /**
  * \brief Calls the on_state_changing() method of the object on top of the stack.
  * \param state_name Name of the current state.
@@ -2806,6 +3635,20 @@ void LuaContext::on_amount_changed(int amount) {
   }
 }
 
+/**
+ * \brief Calls the on_value_changed() method of the object on top of the stack.
+ * \param savegame The savegame whose value has changed.
+ * \param key Name of the value.
+ */
+void LuaContext::on_value_changed(const Savegame& savegame, const std::string& key) {
+  check_callback_thread();
+  if (find_method("on_value_changed")) {
+    push_string(current_l, key);
+    push_savegame_value(current_l, savegame, key);
+    call_function(3, 0, "on_value_changed");
+  }
+}
+
 /**
  * \brief Calls the on_obtaining() method of the object on top of the stack.
  * \param treasure The treasure being obtained.
@@ -2859,7 +3702,7 @@ void LuaContext::on_using() {
 void LuaContext::on_ability_used(Ability ability) {
   check_callback_thread();
   if (find_method("on_ability_used")) {
-    push_string(current_l, enum_to_name(ability));
+    push_interned_string(current_l, enum_to_name(ability));
     call_function(2, 0, "on_ability_used");
   }
 }
@@ -3232,7 +4075,7 @@ void LuaContext::on_attacked_enemy(
     } else if (reaction.type == EnemyReaction::ReactionType::LUA_CALLBACK) {
       reaction.callback.push(current_l);
     } else {
-      push_string(current_l, enum_to_name(reaction.type));
+      push_interned_string(current_l, enum_to_name(reaction.type));
     }
 
     call_function(5, 0, "on_attacked_enemy");
@@ -3250,7 +4093,7 @@ void LuaContext::on_ground_below_changed(Ground ground_below) {
       lua_pushnil(current_l);
     }
     else {
-      push_string(current_l, enum_to_name(ground_below));
+      push_interned_string(current_l, enum_to_name(ground_below));
     }
     call_function(2, 0, "on_ground_below_changed");
   }
@@ -3321,6 +4164,90 @@ int LuaContext::l_panic(lua_State* l) {
   Debug::die(error);
 }
 
+/**
+ * \brief Replacement of setmetatable() that notices when scripts change
+ * the metatable of the metatable of a type.
+ *
+ * That metatable tracks the events defined on the type.
+ * When scripts replace it, for example to inherit events from another table,
+ * userdata_has_field() looks up the events of this type in Lua instead.
+ *
+ * \param l The Lua context.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_setmetatable(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    // Call the original setmetatable() first.
+    const int num_arguments = lua_gettop(l);
+    lua_pushvalue(l, lua_upvalueindex(1));
+    for (int i = 1; i <= num_arguments; ++i) {
+      lua_pushvalue(l, i);
+    }
+    lua_call(l, num_arguments, 1);
+                                  // table metatable table
+
+    LuaContext& lua_context = get();
+    const auto& it = lua_context.userdata_types.find(lua_topointer(l, 1));
+    if (lua_istable(l, 1) && it != lua_context.userdata_types.end()) {
+      bool tracked = false;
+      if (lua_istable(l, 2)) {
+        lua_pushliteral(l, "__newindex");
+                                  // table metatable table "__newindex"
+        lua_rawget(l, 2);
+                                  // table metatable table __newindex/nil
+        tracked = lua_tocfunction(l, -1) == metatable_meta_newindex;
+        lua_pop(l, 1);
+                                  // table metatable table
+      }
+      if (tracked) {
+        lua_context.untracked_metatables.erase(it->second.module_name);
+      }
+      else {
+        lua_context.untracked_metatables.insert(it->second.module_name);
+      }
+      ++lua_context.lua_events_version;
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Replacement of rawset() that remembers the frequent events set on
+ * the metatables of types.
+ *
+ * Such fields bypass the __newindex of these metatables.
+ *
+ * \param l The Lua context.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_rawset(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTABLE);
+    LuaTools::check_any(l, 2);
+    LuaTools::check_any(l, 3);
+    lua_settop(l, 3);
+                                  // table key value
+
+    LuaEvent event;
+    if (lua_type(l, 2) == LUA_TSTRING &&
+        !lua_isnil(l, 3) &&
+        get_lua_event(lua_tostring(l, 2), event)) {
+      LuaContext& lua_context = get();
+      const auto& it = lua_context.userdata_types.find(lua_topointer(l, 1));
+      if (it != lua_context.userdata_types.end()) {
+        lua_context.metatable_events[it->second.module_name] |= 1u << static_cast<int>(event);
+        ++lua_context.lua_events_version;
+      }
+    }
+
+    lua_rawset(l, 1);
+                                  // table
+    return 1;
+  });
+}
+
 /**
  * \brief A loader that makes require() able to load Lua files
  * from the quest data directory or archive.
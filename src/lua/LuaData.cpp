@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/lua/LuaData.h"
@@ -25,6 +26,30 @@
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Identifies binary cache files.
+ */
+const std::string binary_cache_magic = "SOLB";
+
+/**
+ * \brief Version of the binary format of data objects.
+ *
+ * Increment it whenever an export_to_binary() function changes:
+ * cache files of other versions are then ignored and regenerated.
+ */
+constexpr uint32_t binary_cache_version = 1;
+
+/**
+ * \brief Directory of binary cache files, relative to the quest write directory.
+ */
+const std::string binary_cache_dir = "data_cache";
+
+}  // Anonymous namespace
+
+bool LuaData::binary_cache_enabled = true;
+
 /**
  * \brief Imports a Lua data file from memory to this object.
  * \param[in] buffer A memory area with the content of a data file
@@ -35,12 +60,28 @@ namespace Solarus {
 bool LuaData::import_from_buffer(
     const std::string& buffer,
     const std::string& file_name
+) {
+  return import_from_buffer(buffer.data(), buffer.size(), file_name);
+}
+
+/**
+ * \brief Imports a Lua data file from memory to this object.
+ * \param[in] data A memory area with the content of a data file
+ * encoded in UTF-8.
+ * \param[in] size Size of the memory area in bytes.
+ * \param[in] file_name Name of a file to use in error messages.
+ * \return \c true in case of success, \c false if the file could not be loaded.
+ */
+bool LuaData::import_from_buffer(
+    const char* data,
+    size_t size,
+    const std::string& file_name
 ) {
   // Read the file.
   lua_State* l = luaL_newstate();
-  if (luaL_loadbuffer(l, buffer.data(), buffer.size(), file_name.c_str()) != 0) {
+  if (luaL_loadbuffer(l, data, size, file_name.c_str()) != 0) {
     Debug::error(std::string("Failed to load data file: ") + lua_tostring(l, -1));
-    lua_pop(l, 1);
+    lua_close(l);
     return false;
   }
 
@@ -101,10 +142,124 @@ bool LuaData::import_from_quest_file(
     return false;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(
+  const std::string& actual_file_name = QuestFiles::get_actual_file_name(
       quest_file_name, language_specific
   );
-  return import_from_buffer(buffer, quest_file_name);
+  QuestFiles::DataFileView view;
+  if (!view.open(actual_file_name)) {
+    Debug::error(std::string("Cannot read quest file '") + quest_file_name + "'");
+    return false;
+  }
+  if (!binary_cache_enabled) {
+    return import_from_buffer(view.get_data(), view.get_size(), quest_file_name);
+  }
+
+  // Use the binary version if it was made from the same content.
+  // It may come from the quest write directory or from the quest data.
+  const std::string& cache_file_name = get_binary_cache_file_name(actual_file_name);
+  const uint64_t source_hash = get_fnv1a_hash(view.get_data(), view.get_size());
+  if (import_from_binary_cache(cache_file_name, source_hash)) {
+    return true;
+  }
+
+  if (!import_from_buffer(view.get_data(), view.get_size(), quest_file_name)) {
+    return false;
+  }
+  if (!QuestFiles::get_quest_write_dir().empty()) {
+    export_to_binary_cache(cache_file_name, source_hash);
+  }
+  return true;
+}
+
+/**
+ * \brief Attempts to load this object from a binary cache file.
+ * \param cache_file_name Name of the cache file in the quest write directory.
+ * \param source_hash Hash of the content of the original data file.
+ * \return \c true in case of success, \c false if the cache file does not
+ * exist, is corrupted, is outdated or if this object has no binary form.
+ */
+bool LuaData::import_from_binary_cache(
+    const std::string& cache_file_name,
+    uint64_t source_hash
+) {
+  if (!QuestFiles::data_file_exists(cache_file_name)) {
+    return false;
+  }
+
+  const std::string& cache = QuestFiles::data_file_read(cache_file_name);
+  if (cache.compare(0, binary_cache_magic.size(), binary_cache_magic) != 0) {
+    return false;
+  }
+
+  BinaryReader header(cache, binary_cache_magic.size());
+  const uint32_t version = header.read_uint();
+  const uint64_t cached_source_hash = header.read_uint64();
+  const uint64_t payload_hash = header.read_uint64();
+  if (header.has_failed() ||
+      version != binary_cache_version ||
+      cached_source_hash != source_hash ||
+      payload_hash != get_fnv1a_hash(
+          cache.data() + header.get_position(), cache.size() - header.get_position())) {
+    return false;
+  }
+
+  BinaryReader reader(cache, header.get_position());
+  return import_from_binary(reader);
+}
+
+/**
+ * \brief Saves this object into a binary cache file if it has a binary form.
+ *
+ * Failures are silently ignored: the cache will be regenerated next time.
+ *
+ * \param cache_file_name Name of the cache file in the quest write directory.
+ * \param source_hash Hash of the content of the original data file.
+ */
+void LuaData::export_to_binary_cache(
+    const std::string& cache_file_name,
+    uint64_t source_hash
+) const {
+  std::string cache;
+  if (!export_to_binary_cache(cache, source_hash)) {
+    return;
+  }
+
+  const size_t last_slash = cache_file_name.rfind('/');
+  QuestFiles::data_file_mkdir(cache_file_name.substr(0, last_slash));
+  QuestFiles::data_file_try_save(cache_file_name, cache);
+}
+
+/**
+ * \brief Saves this object into memory as the content of a binary cache file.
+ * \param[out] buffer The content of the cache file.
+ * \param source_hash Hash of the content of the original data file,
+ * as returned by get_fnv1a_hash().
+ * \return \c true in case of success, \c false if this object has no binary form.
+ */
+bool LuaData::export_to_binary_cache(std::string& buffer, uint64_t source_hash) const {
+
+  BinaryWriter payload;
+  if (!export_to_binary(payload)) {
+    return false;
+  }
+
+  BinaryWriter header;
+  header.write_uint(binary_cache_version);
+  header.write_uint64(source_hash);
+  header.write_uint64(get_fnv1a_hash(payload.get_buffer().data(), payload.get_buffer().size()));
+
+  buffer = binary_cache_magic + header.get_buffer() + payload.get_buffer();
+  return true;
+}
+
+/**
+ * \brief Returns the name of the binary cache file of a data file.
+ * \param actual_file_name Name of the data file relative to the data
+ * directory, as returned by QuestFiles::get_actual_file_name().
+ * \return Name of its binary cache file relative to the data directory.
+ */
+std::string LuaData::get_binary_cache_file_name(const std::string& actual_file_name) {
+  return binary_cache_dir + "/" + actual_file_name + ".bin";
 }
 
 /**
@@ -188,6 +343,54 @@ bool LuaData::export_to_lua(std::ostream& /* out */) const {
   return false;
 }
 
+/**
+ * \brief Loads this data from its binary form.
+ *
+ * Implementations must read all the data written by export_to_binary()
+ * and leave this object unchanged on failure.
+ *
+ * \param reader The binary data to read.
+ * \return \c true in case of success, \c false if the data is invalid or
+ * if this object has no binary form.
+ */
+bool LuaData::import_from_binary(BinaryReader& /* reader */) {
+
+  // Binary data is optional. Not implemented by default.
+  return false;
+}
+
+/**
+ * \brief Saves this data in binary form.
+ * \param writer The binary data to write.
+ * \return \c true in case of success, \c false if this object has no binary
+ * form.
+ */
+bool LuaData::export_to_binary(BinaryWriter& /* writer */) const {
+
+  // Binary data is optional. Not implemented by default.
+  return false;
+}
+
+/**
+ * \brief Returns whether quest files are cached in binary form.
+ * \return \c true if the binary cache is used.
+ */
+bool LuaData::is_binary_cache_enabled() {
+  return binary_cache_enabled;
+}
+
+/**
+ * \brief Sets whether quest files should be cached in binary form.
+ *
+ * Only data classes that implement export_to_binary() are cached,
+ * and only when the quest has a write directory.
+ *
+ * \param enabled \c true to use the binary cache.
+ */
+void LuaData::set_binary_cache_enabled(bool enabled) {
+  binary_cache_enabled = enabled;
+}
+
 /**
  * \brief Protects a string so that it can safely be enclosed in double quotes.
  *
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/lua/LuaProfiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <lua.hpp>
+
+namespace Solarus {
+
+constexpr int LuaProfiler::default_instruction_count;
+constexpr int LuaProfiler::default_max_lines;
+
+bool LuaProfiler::running = false;
+lua_State* LuaProfiler::profiled_l = nullptr;
+std::vector<LuaProfiler::Frame> LuaProfiler::frames;
+std::map<LuaProfiler::Key, LuaProfiler::Stats> LuaProfiler::stats;
+std::chrono::steady_clock::time_point LuaProfiler::last_sample_time;
+int64_t LuaProfiler::last_memory = 0;
+
+/**
+ * \brief Starts profiling a Lua state.
+ *
+ * Results of a previous run are discarded.
+ *
+ * \param l The Lua state to profile.
+ * \param instruction_count Number of virtual machine instructions between
+ * two samples.
+ */
+void LuaProfiler::start(lua_State* l, int instruction_count) {
+
+  stop();
+  stats.clear();
+
+  profiled_l = l;
+  frames.clear();
+  frames.push_back(Frame{ "(none)", "(unknown)" });
+  last_sample_time = std::chrono::steady_clock::now();
+  last_memory = get_memory();
+
+  lua_sethook(l, &LuaProfiler::hook, LUA_MASKCOUNT, std::max(1, instruction_count));
+  running = true;
+}
+
+/**
+ * \brief Stops profiling.
+ *
+ * Results are kept until the next start().
+ */
+void LuaProfiler::stop() {
+
+  if (!running) {
+    return;
+  }
+
+  if (frames.size() > 1) {
+    add_sample(false);
+  }
+  lua_sethook(profiled_l, nullptr, 0, 0);
+  running = false;
+  profiled_l = nullptr;
+  frames.clear();
+}
+
+/**
+ * \brief Returns a human-readable summary of the results.
+ * \param max_lines Maximum number of locations to show, the most expensive
+ * ones first.
+ * \return The report.
+ */
+std::string LuaProfiler::get_report(int max_lines) {
+
+  std::vector<std::pair<Key, Stats>> sorted(stats.begin(), stats.end());
+  std::sort(sorted.begin(), sorted.end(), [](
+      const std::pair<Key, Stats>& lhs,
+      const std::pair<Key, Stats>& rhs) {
+    return lhs.second.time > rhs.second.time;
+  });
+
+  int64_t total_time = 0;
+  int64_t total_allocated = 0;
+  uint32_t total_samples = 0;
+  for (const std::pair<Key, Stats>& element : sorted) {
+    total_time += element.second.time;
+    total_allocated += element.second.allocated;
+    total_samples += element.second.samples;
+  }
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1);
+  oss << "Lua profiler" << (running ? " (running)" : "") << ": "
+      << total_samples << " samples, "
+      << (total_time / 1000.0) << " ms, "
+      << (total_allocated / 1024.0) << " KiB allocated\n";
+  oss << std::setw(10) << "time (ms)"
+      << std::setw(8) << "%"
+      << std::setw(10) << "samples"
+      << std::setw(12) << "alloc (KiB)"
+      << "  event: location\n";
+
+  const int num_lines = std::min(max_lines, static_cast<int>(sorted.size()));
+  for (int i = 0; i < num_lines; ++i) {
+    const Key& key = sorted[i].first;
+    const Stats& element_stats = sorted[i].second;
+    const double percent = total_time > 0 ?
+          100.0 * element_stats.time / total_time : 0.0;
+    oss << std::setw(10) << (element_stats.time / 1000.0)
+        << std::setw(8) << percent
+        << std::setw(10) << element_stats.samples
+        << std::setw(12) << (element_stats.allocated / 1024.0)
+        << "  " << key.first << ": " << key.second << "\n";
+  }
+
+  return oss.str();
+}
+
+/**
+ * \brief The Lua hook called every few instructions.
+ * \param l The Lua state or coroutine running.
+ * \param ar Debug information of the running function.
+ */
+void LuaProfiler::hook(lua_State* l, lua_Debug* ar) {
+
+  if (!running || frames.empty()) {
+    return;
+  }
+
+  std::string& location = frames.back().location;
+  if (lua_getinfo(l, "Sl", ar) != 0) {
+    std::ostringstream oss;
+    oss << ar->short_src << ":" << ar->currentline;
+    location = oss.str();
+  }
+  add_sample(true);
+}
+
+/**
+ * \brief Starts attributing samples to an event.
+ * \param event_name Name of the event.
+ */
+void LuaProfiler::enter_event(const char* event_name) {
+
+  if (frames.size() > 1) {
+    // Close the time slice of the enclosing event.
+    add_sample(false);
+  }
+  else {
+    // The engine was running C++ code since the previous event.
+    last_sample_time = std::chrono::steady_clock::now();
+    last_memory = get_memory();
+  }
+  frames.push_back(Frame{ event_name, "(unknown)" });
+}
+
+/**
+ * \brief Goes back to attributing samples to the enclosing event.
+ */
+void LuaProfiler::leave_event() {
+
+  add_sample(false);
+  if (frames.size() > 1) {
+    frames.pop_back();
+  }
+}
+
+/**
+ * \brief Attributes the time and memory since the previous sample to the
+ * current event and location.
+ * \param count_sample Whether this is an actual sample from the hook.
+ */
+void LuaProfiler::add_sample(bool count_sample) {
+
+  if (frames.empty()) {
+    return;
+  }
+
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const int64_t memory = get_memory();
+  const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      now - last_sample_time
+  ).count();
+
+  const Frame& frame = frames.back();
+  Stats& location_stats = stats[Key(frame.event, frame.location)];
+  location_stats.time += elapsed;
+  if (memory > last_memory) {
+    // Decreases are garbage collections, not attributed to anyone.
+    location_stats.allocated += memory - last_memory;
+  }
+  if (count_sample) {
+    ++location_stats.samples;
+  }
+
+  last_sample_time = now;
+  last_memory = memory;
+}
+
+/**
+ * \brief Returns the memory currently used by the profiled Lua state.
+ * \return The memory in bytes.
+ */
+int64_t LuaProfiler::get_memory() {
+
+  if (profiled_l == nullptr) {
+    return 0;
+  }
+  return static_cast<int64_t>(lua_gc(profiled_l, LUA_GCCOUNT, 0)) * 1024 +
+      lua_gc(profiled_l, LUA_GCCOUNTB, 0);
+}
+
+}
@@ -14,11 +14,15 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/HitchDetector.h"
+#include "solarus/core/HotCounters.h"
 #include "solarus/core/Map.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/FrameDamage.h"
 #include "solarus/lua/LuaException.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaProfiler.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include <cctype>
 #include <sstream>
@@ -153,11 +157,43 @@ bool call_function(
     const char* function_name
 ) {
   Debug::check_assertion(lua_gettop(l) > nb_arguments, "Missing arguments");
+  LuaProfiler::EventScope profiler_scope(function_name);
+  FrameDamage::notify_lua_call();
+  SOLARUS_HOT_COUNT(LUA_CALLS);
   int base = lua_gettop(l) - nb_arguments;
+
+  // Time calls from C++ that are not nested in another one for the hitch
+  // detector, keeping the function below to find where the slowest one is.
+  static int call_depth = 0;
+  const bool timed = HitchDetector::is_enabled() && call_depth == 0;
+  uint64_t start_date = 0;
+  if (timed) {
+    lua_pushvalue(l, base);
+    lua_insert(l, base);
+    ++base;
+    start_date = System::get_real_time_us();
+  }
+
   lua_pushcfunction(l, &LuaContext::l_backtrace);
   lua_insert(l, base);
+  ++call_depth;
   int status = lua_pcall(l, nb_arguments, nb_results, base);
+  --call_depth;
   lua_remove(l, base);
+
+  if (timed) {
+    const uint64_t time = System::get_real_time_us() - start_date;
+    HitchDetector::add_time(HitchDetector::Phase::LUA, time);
+    if (HitchDetector::is_slowest_lua_call(time) && lua_isfunction(l, base - 1)) {
+      lua_Debug info;
+      lua_pushvalue(l, base - 1);
+      lua_getinfo(l, ">S", &info);
+      HitchDetector::set_slowest_lua_call(time, function_name,
+          std::string(info.short_src) + ":" + std::to_string(info.linedefined));
+    }
+    lua_remove(l, base - 1);
+  }
+
   if (status != 0) {
     Debug::check_assertion(lua_isstring(l, -1), "Missing error message");
     Debug::error(std::string("In ") + function_name + ": "
@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/lua/LuaWorkers.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <lua.hpp>
+
+namespace Solarus {
+
+bool LuaWorkers::started = false;
+std::vector<std::thread> LuaWorkers::threads;
+std::mutex LuaWorkers::mutex;
+std::condition_variable LuaWorkers::jobs_changed;
+std::deque<LuaWorkers::Job> LuaWorkers::jobs;
+bool LuaWorkers::stopping = false;
+std::vector<LuaWorkers::Result> LuaWorkers::results;
+uint64_t LuaWorkers::next_id = 0;
+std::map<uint64_t, LuaWorkers::Callback> LuaWorkers::callbacks;
+
+namespace {
+
+constexpr int max_depth = 64;             /**< Maximum nesting of tables in messages. */
+constexpr size_t max_functions = 32;      /**< Functions kept compiled by each worker. */
+
+/**
+ * \brief Tags of the values in a serialized message.
+ */
+enum Tag : char {
+  TAG_NIL = 'n',
+  TAG_FALSE = 'f',
+  TAG_TRUE = 't',
+  TAG_NUMBER = 'd',
+  TAG_STRING = 's',
+  TAG_TABLE = 'T',
+  TAG_END = 'e'
+};
+
+/**
+ * \brief Appends a value of the Lua stack to a serialized message.
+ * \param l A Lua state.
+ * \param index Absolute index of the value in the stack.
+ * \param buffer The message.
+ * \param error Set to an error message in case of failure.
+ * \param depth Nesting level of the value.
+ * \return \c true in case of success.
+ */
+bool serialize_value(lua_State* l, int index, std::string& buffer, std::string& error, int depth) {
+
+  switch (lua_type(l, index)) {
+
+  case LUA_TNONE:
+  case LUA_TNIL:
+    buffer.push_back(TAG_NIL);
+    return true;
+
+  case LUA_TBOOLEAN:
+    buffer.push_back(lua_toboolean(l, index) ? TAG_TRUE : TAG_FALSE);
+    return true;
+
+  case LUA_TNUMBER:
+  {
+    const double number = lua_tonumber(l, index);
+    char bytes[sizeof(number)];
+    std::memcpy(bytes, &number, sizeof(number));
+    buffer.push_back(TAG_NUMBER);
+    buffer.append(bytes, sizeof(number));
+    return true;
+  }
+
+  case LUA_TSTRING:
+  {
+    size_t size = 0;
+    const char* text = lua_tolstring(l, index, &size);
+    const uint32_t size32 = static_cast<uint32_t>(size);
+    char bytes[sizeof(size32)];
+    std::memcpy(bytes, &size32, sizeof(size32));
+    buffer.push_back(TAG_STRING);
+    buffer.append(bytes, sizeof(size32));
+    buffer.append(text, size);
+    return true;
+  }
+
+  case LUA_TTABLE:
+  {
+    if (depth >= max_depth) {
+      error = "tables are nested too deeply or are cyclic";
+      return false;
+    }
+    if (!lua_checkstack(l, 3)) {
+      error = "Lua stack overflow";
+      return false;
+    }
+    buffer.push_back(TAG_TABLE);
+    lua_pushnil(l);
+    while (lua_next(l, index) != 0) {
+      const int value_index = lua_gettop(l);
+      if (!serialize_value(l, value_index - 1, buffer, error, depth + 1) ||
+          !serialize_value(l, value_index, buffer, error, depth + 1)) {
+        lua_pop(l, 2);
+        return false;
+      }
+      lua_pop(l, 1);
+    }
+    buffer.push_back(TAG_END);
+    return true;
+  }
+
+  default:
+    error = std::string("values of type ") + luaL_typename(l, index) + " cannot be sent to workers";
+    return false;
+  }
+}
+
+/**
+ * \brief Pushes onto the Lua stack a value read from a serialized message.
+ * \param l A Lua state.
+ * \param buffer The message.
+ * \param position Position of the value in the message.
+ * Set to the position after the value.
+ * \param depth Nesting level of the value.
+ * \return \c true in case of success, \c false if the message is malformed
+ * (then nothing is pushed).
+ */
+bool deserialize_value(lua_State* l, const std::string& buffer, size_t& position, int depth) {
+
+  if (position >= buffer.size() || depth > max_depth || !lua_checkstack(l, 3)) {
+    return false;
+  }
+
+  const char tag = buffer[position++];
+  switch (tag) {
+
+  case TAG_NIL:
+    lua_pushnil(l);
+    return true;
+
+  case TAG_FALSE:
+  case TAG_TRUE:
+    lua_pushboolean(l, tag == TAG_TRUE);
+    return true;
+
+  case TAG_NUMBER:
+  {
+    double number = 0.0;
+    if (buffer.size() - position < sizeof(number)) {
+      return false;
+    }
+    std::memcpy(&number, &buffer[position], sizeof(number));
+    position += sizeof(number);
+    lua_pushnumber(l, number);
+    return true;
+  }
+
+  case TAG_STRING:
+  {
+    uint32_t size = 0;
+    if (buffer.size() - position < sizeof(size)) {
+      return false;
+    }
+    std::memcpy(&size, &buffer[position], sizeof(size));
+    position += sizeof(size);
+    if (buffer.size() - position < size) {
+      return false;
+    }
+    lua_pushlstring(l, &buffer[position], size);
+    position += size;
+    return true;
+  }
+
+  case TAG_TABLE:
+  {
+    lua_newtable(l);
+    while (position < buffer.size() && buffer[position] != TAG_END) {
+      if (!deserialize_value(l, buffer, position, depth + 1)) {
+        lua_pop(l, 1);
+        return false;
+      }
+      if (!deserialize_value(l, buffer, position, depth + 1)) {
+        lua_pop(l, 2);
+        return false;
+      }
+      if (lua_isnil(l, -2)) {
+        lua_pop(l, 2);
+        continue;
+      }
+      lua_rawset(l, -3);
+    }
+    if (position >= buffer.size()) {
+      lua_pop(l, 1);
+      return false;
+    }
+    ++position;  // TAG_END.
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief Creates the Lua state of a worker thread.
+ *
+ * Libraries that access files or the system are not available.
+ *
+ * \return The Lua state.
+ */
+lua_State* create_worker_state() {
+
+  lua_State* l = luaL_newstate();
+  luaL_openlibs(l);
+
+  for (const char* name : { "io", "package", "debug", "require", "module", "dofile", "loadfile" }) {
+    lua_pushnil(l);
+    lua_setglobal(l, name);
+  }
+
+  // Only keep time functions of os.
+  lua_getglobal(l, "os");
+                                  // os
+  lua_newtable(l);
+                                  // os safe_os
+  for (const char* name : { "clock", "date", "difftime", "time" }) {
+    lua_getfield(l, -2, name);
+    lua_setfield(l, -2, name);
+  }
+  lua_setglobal(l, "os");
+                                  // os
+  lua_pop(l, 1);
+                                  // --
+  return l;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Stops the worker threads.
+ *
+ * Jobs not started are dropped, and so are callbacks not called yet.
+ * Running jobs are finished first.
+ */
+void LuaWorkers::quit() {
+
+  if (!started) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobs_changed.notify_all();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  results.clear();
+  callbacks.clear();
+  stopping = false;
+  started = false;
+}
+
+/**
+ * \brief Returns the number of worker threads.
+ *
+ * One core is left to the main thread.
+ *
+ * \return The number of threads running jobs.
+ */
+int LuaWorkers::get_num_threads() {
+
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  return std::min(std::max(num_cores - 1, 1), 4);
+}
+
+/**
+ * \brief Starts the worker threads.
+ */
+void LuaWorkers::start() {
+
+  stopping = false;
+  started = true;
+  for (int i = 0; i < get_num_threads(); ++i) {
+    threads.emplace_back(&LuaWorkers::run_thread);
+  }
+}
+
+/**
+ * \brief Requests to call a Lua function in a worker thread.
+ *
+ * Jobs are started in the order they are submitted, but may finish in any
+ * order when there are several threads.
+ *
+ * \param code Lua source code or bytecode of the function.
+ * Source code receives the message in <tt>...</tt>.
+ * \param message Serialized argument of the function.
+ * \param callback Function to call from update() when the job is
+ * finished, or an empty function.
+ */
+void LuaWorkers::run(
+    const std::string& code,
+    const std::string& message,
+    const Callback& callback
+) {
+  if (!started) {
+    start();
+  }
+
+  const uint64_t id = next_id++;
+  if (callback) {
+    callbacks[id] = callback;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({ id, code, message });
+  }
+  jobs_changed.notify_one();
+}
+
+/**
+ * \brief Calls the callbacks of the jobs finished since the last call.
+ *
+ * This function must be called by the main thread.
+ */
+void LuaWorkers::update() {
+
+  if (!started) {
+    return;
+  }
+
+  std::vector<Result> finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.swap(results);
+  }
+
+  for (const Result& result : finished) {
+    const auto it = callbacks.find(result.id);
+    if (it == callbacks.end()) {
+      continue;
+    }
+    const Callback callback = std::move(it->second);
+    callbacks.erase(it);
+    callback(result.success, result.value);
+  }
+}
+
+/**
+ * \brief Drops all callbacks not called yet.
+ *
+ * Jobs submitted still run.
+ * Call this function when the objects used by callbacks are destroyed.
+ */
+void LuaWorkers::cancel_callbacks() {
+  callbacks.clear();
+}
+
+/**
+ * \brief Serializes a Lua value to send it to or from a worker.
+ * \param[in] l A Lua state.
+ * \param[in] index Index of the value in the stack.
+ * \param[out] buffer The serialized value.
+ * \param[out] error Why the value cannot be serialized, in case of failure.
+ * \return \c true in case of success.
+ */
+bool LuaWorkers::serialize(lua_State* l, int index, std::string& buffer, std::string& error) {
+
+  if (index < 0 && index > LUA_REGISTRYINDEX) {
+    index = lua_gettop(l) + index + 1;
+  }
+  buffer.clear();
+  return serialize_value(l, index, buffer, error, 0);
+}
+
+/**
+ * \brief Pushes onto the stack a value serialized by serialize().
+ * \param l A Lua state.
+ * \param buffer The serialized value.
+ * \return \c true in case of success, \c false if the buffer is malformed
+ * (then nothing is pushed).
+ */
+bool LuaWorkers::deserialize(lua_State* l, const std::string& buffer) {
+
+  size_t position = 0;
+  if (!deserialize_value(l, buffer, position, 0)) {
+    return false;
+  }
+  if (position != buffer.size()) {
+    lua_pop(l, 1);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Runs jobs until the workers are stopped.
+ *
+ * Each thread has its own Lua state and keeps the functions it compiled
+ * so that the same code is not compiled again for each job.
+ */
+void LuaWorkers::run_thread() {
+
+  lua_State* l = nullptr;
+  std::map<std::string, int> functions;
+
+  while (true) {
+
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobs_changed.wait(lock, []() { return stopping || !jobs.empty(); });
+      if (stopping) {
+        break;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+
+    if (l == nullptr) {
+      l = create_worker_state();
+    }
+
+    Result result = run_job(l, functions, job);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      results.push_back(std::move(result));
+    }
+  }
+
+  if (l != nullptr) {
+    lua_close(l);
+  }
+}
+
+/**
+ * \brief Calls the function of a job in a worker state.
+ * \param l The Lua state of the worker.
+ * \param functions Registry refs of the functions already compiled,
+ * indexed by their code.
+ * \param job The job to run.
+ * \return Its result.
+ */
+LuaWorkers::Result LuaWorkers::run_job(
+    lua_State* l,
+    std::map<std::string, int>& functions,
+    const Job& job
+) {
+  Result result = { job.id, false, "" };
+
+  const auto it = functions.find(job.code);
+  if (it != functions.end()) {
+    lua_rawgeti(l, LUA_REGISTRYINDEX, it->second);
+  }
+  else {
+    if (luaL_loadbuffer(l, job.code.data(), job.code.size(), "worker") != 0) {
+      result.value = lua_tostring(l, -1);
+      lua_settop(l, 0);
+      return result;
+    }
+    if (functions.size() >= max_functions) {
+      for (const auto& kvp : functions) {
+        luaL_unref(l, LUA_REGISTRYINDEX, kvp.second);
+      }
+      functions.clear();
+    }
+    lua_pushvalue(l, -1);
+    functions[job.code] = luaL_ref(l, LUA_REGISTRYINDEX);
+  }
+                                  // function
+  if (!deserialize(l, job.message)) {
+    result.value = "Invalid worker message";
+    lua_settop(l, 0);
+    return result;
+  }
+                                  // function message
+  if (lua_pcall(l, 1, 1, 0) != 0) {
+                                  // error
+    const char* error = lua_tostring(l, -1);
+    result.value = (error != nullptr) ? error : "Error in worker";
+  }
+  else {
+                                  // value
+    std::string error;
+    result.success = serialize(l, -1, result.value, error);
+    if (!result.success) {
+      result.value = "Invalid worker result: " + error;
+    }
+  }
+  lua_settop(l, 0);
+  return result;
+}
+
+}
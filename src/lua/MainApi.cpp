@@ -15,20 +15,36 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/FrameStats.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/MemoryUsage.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestDatabase.h"
 #include "solarus/core/QuestProperties.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Settings.h"
 #include "solarus/core/System.h"
+#include "solarus/graphics/ImageCache.h"
+#include "solarus/lua/LuaAllocator.h"
 #include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaProfiler.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
 
 namespace Solarus {
 
+/**
+ * \brief Lua names of the events that can be delivered in batches.
+ */
+const std::map<LuaContext::BatchedEventType, std::string> LuaContext::batched_event_names = {
+    { BatchedEventType::POSITION_CHANGED, "on_position_changed" },
+    { BatchedEventType::MOVEMENT_CHANGED, "on_movement_changed" },
+    { BatchedEventType::OBSTACLE_REACHED, "on_obstacle_reached" },
+    { BatchedEventType::FRAME_CHANGED, "on_frame_changed" },
+};
+
 /**
  * Name of the Lua table representing the main module of Solarus.
  */
@@ -66,6 +82,19 @@ void LuaContext::register_main_module() {
         { "add_resource", main_api_add_resource },
         { "remove_resource", main_api_remove_resource },
         { "get_game", main_api_get_game },
+        { "preload_map", main_api_preload_map },
+        { "start_profiler", main_api_start_profiler },
+        { "stop_profiler", main_api_stop_profiler },
+        { "get_profiler_report", main_api_get_profiler_report },
+        { "get_gc_stats", main_api_get_gc_stats },
+        { "get_memory_stats", main_api_get_memory_stats },
+        { "get_frame_stats", main_api_get_frame_stats },
+        { "get_image_cache_stats", main_api_get_image_cache_stats },
+        { "get_memory_report", main_api_get_memory_report },
+        { "get_map_cache_size", main_api_get_map_cache_size },
+        { "set_map_cache_size", main_api_set_map_cache_size },
+        { "get_event_batch_handler", main_api_get_event_batch_handler },
+        { "set_event_batch_handler", main_api_set_event_batch_handler },
     });
   }
   register_functions(main_module_name, functions);
@@ -530,6 +559,301 @@ int LuaContext::main_api_get_os(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.main.preload_map().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_preload_map(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    const std::string& map_id = LuaTools::check_string(l, 1);
+
+    if (!CurrentQuest::resource_exists(ResourceType::MAP, map_id)) {
+      LuaTools::arg_error(l, 1, std::string("No such map: '") + map_id + "'");
+    }
+
+    get().get_main_loop().get_resource_provider().preload(
+          ResourceType::MAP, map_id, ResourceProvider::PreloadPriority::HIGH
+    );
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.start_profiler().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_start_profiler(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    const int instruction_count = LuaTools::opt_int(
+          l, 1, LuaProfiler::default_instruction_count
+    );
+
+    if (instruction_count <= 0) {
+      LuaTools::arg_error(l, 1, "Instruction count must be positive");
+    }
+
+    // Hooks are per coroutine: always profile the main one.
+    LuaProfiler::start(get().main_l, instruction_count);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.stop_profiler().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_stop_profiler(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    LuaProfiler::stop();
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_profiler_report().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_profiler_report(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    const int max_lines = LuaTools::opt_int(
+          l, 1, LuaProfiler::default_max_lines
+    );
+
+    push_string(l, LuaProfiler::get_report(max_lines));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_gc_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_gc_stats(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const LuaContext& lua_context = get();
+    const GcStats& stats = lua_context.gc_stats;
+
+    lua_newtable(l);
+    push_string(l, get_gc_mode_name(lua_context.gc_mode));
+    lua_setfield(l, -2, "mode");
+    lua_pushinteger(l, lua_gc(lua_context.main_l, LUA_GCCOUNT, 0));
+    lua_setfield(l, -2, "memory");
+    lua_pushinteger(l, stats.frame_time);
+    lua_setfield(l, -2, "frame_time");
+    lua_pushinteger(l, stats.max_frame_time);
+    lua_setfield(l, -2, "max_frame_time");
+    lua_pushinteger(l, stats.total_time);
+    lua_setfield(l, -2, "total_time");
+    lua_pushinteger(l, stats.num_steps);
+    lua_setfield(l, -2, "num_steps");
+    lua_pushinteger(l, stats.num_cycles);
+    lua_setfield(l, -2, "num_cycles");
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_memory_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_memory_stats(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const LuaContext& lua_context = get();
+    const LuaAllocator* allocator = lua_context.allocator.get();
+
+    lua_newtable(l);
+    push_string(l, allocator != nullptr ? "pool" : "system");
+    lua_setfield(l, -2, "allocator");
+    lua_pushinteger(l, lua_gc(lua_context.main_l, LUA_GCCOUNT, 0) * 1024 +
+                    lua_gc(lua_context.main_l, LUA_GCCOUNTB, 0));
+    lua_setfield(l, -2, "memory");
+    if (allocator != nullptr) {
+      const LuaAllocator::Stats& stats = allocator->get_stats();
+      lua_pushinteger(l, stats.live_bytes);
+      lua_setfield(l, -2, "live_bytes");
+      lua_pushinteger(l, stats.pool_bytes);
+      lua_setfield(l, -2, "pool_bytes");
+      lua_pushinteger(l, stats.large_bytes);
+      lua_setfield(l, -2, "large_bytes");
+      lua_pushinteger(l, stats.num_allocations);
+      lua_setfield(l, -2, "num_allocations");
+      lua_pushinteger(l, stats.frame_allocations);
+      lua_setfield(l, -2, "frame_allocations");
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_image_cache_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_image_cache_stats(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const ImageCache::Stats stats = ImageCache::get_stats();
+
+    lua_createtable(l, 0, 9);
+    lua_pushinteger(l, stats.hits);
+    lua_setfield(l, -2, "hits");
+    lua_pushinteger(l, stats.misses);
+    lua_setfield(l, -2, "misses");
+    lua_pushinteger(l, stats.evictions);
+    lua_setfield(l, -2, "evictions");
+    lua_pushinteger(l, stats.num_images);
+    lua_setfield(l, -2, "num_images");
+    lua_pushinteger(l, stats.num_unreferenced);
+    lua_setfield(l, -2, "num_unreferenced");
+    lua_pushinteger(l, stats.vram_bytes);
+    lua_setfield(l, -2, "vram_bytes");
+    lua_pushinteger(l, stats.ram_bytes);
+    lua_setfield(l, -2, "ram_bytes");
+    lua_pushinteger(l, stats.vram_budget);
+    lua_setfield(l, -2, "vram_budget");
+    lua_pushinteger(l, stats.ram_budget);
+    lua_setfield(l, -2, "ram_budget");
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_memory_report().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_memory_report(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const int num_categories = static_cast<int>(MemoryUsage::Category::NUM_CATEGORIES);
+
+    lua_createtable(l, 0, num_categories + 1);
+    for (int i = 0; i < num_categories; ++i) {
+      const MemoryUsage::Category category = static_cast<MemoryUsage::Category>(i);
+      const MemoryUsage::Usage usage = MemoryUsage::get(category);
+      lua_createtable(l, 0, 3);
+      lua_pushinteger(l, usage.bytes);
+      lua_setfield(l, -2, "bytes");
+      lua_pushinteger(l, usage.peak_bytes);
+      lua_setfield(l, -2, "peak_bytes");
+      lua_pushinteger(l, usage.num_objects);
+      lua_setfield(l, -2, "num_objects");
+      lua_setfield(l, -2, MemoryUsage::get_category_name(category).c_str());
+    }
+    lua_pushinteger(l, MemoryUsage::get_total_bytes());
+    lua_setfield(l, -2, "total_bytes");
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_map_cache_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_map_cache_size(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushinteger(l, get().get_main_loop().get_resource_provider().get_map_cache_size());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.set_map_cache_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_set_map_cache_size(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const int map_cache_size = LuaTools::check_int(l, 1);
+    if (map_cache_size < 0) {
+      LuaTools::arg_error(l, 1, "Map cache size must be positive or zero");
+    }
+    get().get_main_loop().get_resource_provider().set_map_cache_size(map_cache_size);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.get_frame_stats().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_frame_stats(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const int num_frames = LuaTools::opt_int(l, 1, static_cast<int>(FrameStats::history_size));
+    if (num_frames < 0) {
+      LuaTools::arg_error(l, 1, "Number of frames must be positive");
+    }
+
+    const std::vector<FrameStats::Frame> frames = FrameStats::get_last_frames(num_frames);
+    lua_createtable(l, static_cast<int>(frames.size()), 0);
+    int i = 1;
+    for (const FrameStats::Frame& frame : frames) {
+      lua_createtable(l, 0, 15);
+      lua_pushinteger(l, frame.num_updates);
+      lua_setfield(l, -2, "num_updates");
+      lua_pushinteger(l, frame.update_time);
+      lua_setfield(l, -2, "update_time");
+      lua_pushinteger(l, frame.draw_time);
+      lua_setfield(l, -2, "draw_time");
+      lua_pushinteger(l, frame.present_time);
+      lua_setfield(l, -2, "present_time");
+      lua_pushinteger(l, frame.dropped_time);
+      lua_setfield(l, -2, "dropped_time");
+      lua_pushinteger(l, frame.draw_calls);
+      lua_setfield(l, -2, "draw_calls");
+      lua_pushinteger(l, frame.texture_uploads);
+      lua_setfield(l, -2, "texture_uploads");
+      lua_pushinteger(l, frame.entities_updated);
+      lua_setfield(l, -2, "entities_updated");
+      lua_pushinteger(l, frame.entities_drawn);
+      lua_setfield(l, -2, "entities_drawn");
+      lua_pushinteger(l, frame.lua_memory);
+      lua_setfield(l, -2, "lua_memory");
+      lua_pushinteger(l, frame.quadtree_queries);
+      lua_setfield(l, -2, "quadtree_queries");
+      lua_pushinteger(l, frame.obstacle_tests);
+      lua_setfield(l, -2, "obstacle_tests");
+      lua_pushinteger(l, frame.detector_checks);
+      lua_setfield(l, -2, "detector_checks");
+      lua_pushinteger(l, frame.lua_calls);
+      lua_setfield(l, -2, "lua_calls");
+      lua_pushinteger(l, frame.input_latency);
+      lua_setfield(l, -2, "input_latency");
+      if (frame.audio_buffer_fill >= 0) {
+        lua_pushinteger(l, frame.audio_buffer_fill);
+        lua_setfield(l, -2, "audio_buffer_fill");
+      }
+      lua_rawseti(l, -2, i);
+      ++i;
+    }
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of sol.main.get_game().
  * \param l The Lua context that is calling this function.
@@ -551,6 +875,159 @@ int LuaContext::main_api_get_game(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.main.get_event_batch_handler().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_get_event_batch_handler(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const BatchedEventType type = LuaTools::check_enum<BatchedEventType>(
+        l, 1, batched_event_names
+    );
+
+    EventBatch* batch = get().get_event_batch(type);
+    if (batch == nullptr) {
+      lua_pushnil(l);
+    }
+    else {
+      push_ref(l, batch->handler);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.main.set_event_batch_handler().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::main_api_set_event_batch_handler(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const BatchedEventType type = LuaTools::check_enum<BatchedEventType>(
+        l, 1, batched_event_names
+    );
+    ScopedLuaRef handler;
+    if (!lua_isnil(l, 2)) {
+      handler = LuaTools::check_function(l, 2);
+    }
+
+    EventBatch& batch = get().event_batches[static_cast<int>(type)];
+    batch.handler = handler;
+    if (handler.is_empty()) {
+      // Occurrences already collected are dropped.
+      batch.events.clear();
+    }
+    return 0;
+  });
+}
+
+/**
+ * \brief Returns the batch collecting an event type if it is batched.
+ * \param type A batched event type.
+ * \return The batch, or nullptr if no handler is set for this event:
+ * occurrences should not be collected then.
+ */
+LuaContext::EventBatch* LuaContext::get_event_batch(BatchedEventType type) {
+
+  EventBatch& batch = event_batches[static_cast<int>(type)];
+  if (batch.handler.is_empty()) {
+    return nullptr;
+  }
+  return &batch;
+}
+
+/**
+ * \brief Delivers the batched events collected during this cycle.
+ *
+ * Each handler is called once with an array of the occurrences of its
+ * event, in the order they happened.
+ * Occurrences raised by the handlers themselves are delivered at the
+ * next cycle.
+ */
+void LuaContext::deliver_batched_events() {
+
+  for (int i = 0; i < num_batched_event_types; ++i) {
+    deliver_event_batch(static_cast<BatchedEventType>(i));
+  }
+}
+
+/**
+ * \brief Calls the handler of a batched event with its pending occurrences.
+ * \param type A batched event type.
+ */
+void LuaContext::deliver_event_batch(BatchedEventType type) {
+
+  EventBatch* batch = get_event_batch(type);
+  if (batch == nullptr || batch->events.empty()) {
+    return;
+  }
+
+  std::vector<BatchedEvent> events;
+  events.swap(batch->events);
+  const ScopedLuaRef handler = batch->handler;
+
+  current_l = main_l;
+  push_ref(current_l, handler);
+                                  // ... handler
+  lua_createtable(current_l, static_cast<int>(events.size()), 0);
+                                  // ... handler events
+  int i = 1;
+  for (const BatchedEvent& event : events) {
+    switch (type) {
+
+    case BatchedEventType::POSITION_CHANGED:
+      lua_createtable(current_l, 4, 0);
+      push_userdata(current_l, *event.object);
+      lua_rawseti(current_l, -2, 1);
+      lua_pushinteger(current_l, event.x);
+      lua_rawseti(current_l, -2, 2);
+      lua_pushinteger(current_l, event.y);
+      lua_rawseti(current_l, -2, 3);
+      lua_pushinteger(current_l, event.value);
+      lua_rawseti(current_l, -2, 4);
+      break;
+
+    case BatchedEventType::MOVEMENT_CHANGED:
+    case BatchedEventType::OBSTACLE_REACHED:
+      lua_createtable(current_l, 2, 0);
+      push_userdata(current_l, *event.object);
+      lua_rawseti(current_l, -2, 1);
+      push_movement(current_l, *event.movement);
+      lua_rawseti(current_l, -2, 2);
+      break;
+
+    case BatchedEventType::FRAME_CHANGED:
+      lua_createtable(current_l, 3, 0);
+      push_userdata(current_l, *event.object);
+      lua_rawseti(current_l, -2, 1);
+      push_string(current_l, event.animation);
+      lua_rawseti(current_l, -2, 2);
+      lua_pushinteger(current_l, event.value);
+      lua_rawseti(current_l, -2, 3);
+      break;
+    }
+                                  // ... handler events event
+    lua_rawseti(current_l, -2, i);
+    ++i;
+  }
+                                  // ... handler events
+  call_function(1, 0, batched_event_names.at(type).c_str());
+}
+
+/**
+ * \brief Drops the pending batched events and their handlers.
+ */
+void LuaContext::clear_batched_events() {
+
+  for (EventBatch& batch : event_batches) {
+    batch.handler.clear();
+    batch.events.clear();
+  }
+}
+
 /**
  * \brief Calls sol.main.on_started() if it exists.
  *
@@ -575,6 +1052,7 @@ void LuaContext::main_on_finished() {
   push_main(current_l);
   on_finished();
   remove_timers(-1);  // Stop timers associated to sol.main.
+  remove_tasks(-1);
   remove_menus(-1);  // Stop menus associated to sol.main.
   lua_pop(current_l, 1);
 }
@@ -16,6 +16,7 @@
  */
 #include "solarus/audio/Music.h"
 #include "solarus/audio/Sound.h"
+#include "solarus/containers/PoolAllocator.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Equipment.h"
@@ -58,16 +59,70 @@
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/entities/Wall.h"
+#include "solarus/graphics/Sprite.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/movements/Movement.h"
+#include <array>
 #include <lua.hpp>
 #include <sstream>
+#include <vector>
 
 namespace Solarus {
 
 namespace {
 
+/**
+ * \brief A list of entities borrowed for the duration of a query.
+ *
+ * Queries reuse the same lists from one call to another instead of
+ * allocating new ones. One list is used for each level of nested
+ * queries, for example when a map:foreach_entity_in_rectangle()
+ * callback makes another query.
+ */
+class PooledEntityVector {
+
+  public:
+
+    PooledEntityVector():
+      entities(acquire()) {
+    }
+
+    ~PooledEntityVector() {
+      entities.clear();
+      --get_depth();
+    }
+
+    PooledEntityVector(const PooledEntityVector& other) = delete;
+    PooledEntityVector& operator=(const PooledEntityVector& other) = delete;
+
+    EntityVector& get() {
+      return entities;
+    }
+
+  private:
+
+    static constexpr size_t max_depth = 16;
+
+    static std::array<EntityVector, max_depth>& get_pool() {
+      static std::array<EntityVector, max_depth> pool;
+      return pool;
+    }
+
+    static size_t& get_depth() {
+      static size_t depth = 0;
+      return depth;
+    }
+
+    static EntityVector& acquire() {
+      size_t& depth = get_depth();
+      Debug::check_assertion(depth < max_depth, "Too many nested entity queries");
+      return get_pool()[depth++];
+    }
+
+    EntityVector& entities;    /**< The list borrowed. */
+};
+
 /**
  * \brief Lua equivalent of the deprecated map:move_camera() function.
  */
@@ -152,9 +207,31 @@ void LuaContext::register_map_module() {
       { "get_entities_by_type", map_api_get_entities_by_type },
       { "get_entities_in_rectangle", map_api_get_entities_in_rectangle },
       { "get_entities_in_region", map_api_get_entities_in_region },
+      { "get_entities_in_rectangle_count", map_api_get_entities_in_rectangle_count },
+      { "has_entities_in_rectangle", map_api_has_entities_in_rectangle },
+      { "get_first_entity_in_rectangle", map_api_get_first_entity_in_rectangle },
+      { "foreach_entity_in_rectangle", map_api_foreach_entity_in_rectangle },
+      { "get_region_at", map_api_get_region_at },
       { "get_hero", map_api_get_hero },
       { "set_entities_enabled", map_api_set_entities_enabled },
-      { "remove_entities", map_api_remove_entities }
+      { "remove_entities", map_api_remove_entities },
+      { "is_collision_batching_enabled", map_api_is_collision_batching_enabled },
+      { "set_collision_batching_enabled", map_api_set_collision_batching_enabled },
+      { "is_stream_field_enabled", map_api_is_stream_field_enabled },
+      { "set_stream_field_enabled", map_api_set_stream_field_enabled },
+      { "is_parallel_update_enabled", map_api_is_parallel_update_enabled },
+      { "set_parallel_update_enabled", map_api_set_parallel_update_enabled },
+      { "is_occlusion_culling_enabled", map_api_is_occlusion_culling_enabled },
+      { "set_occlusion_culling_enabled", map_api_set_occlusion_culling_enabled },
+      { "get_room_activation", map_api_get_room_activation },
+      { "set_room_activation", map_api_set_room_activation },
+      { "get_chunk_size", map_api_get_chunk_size },
+      { "set_chunk_size", map_api_set_chunk_size },
+      { "is_chunk_active", map_api_is_chunk_active },
+      { "preload_sprite_animations", map_api_preload_sprite_animations },
+      { "create_entities", map_api_create_entities },
+      { "get_ground_region", map_api_get_ground_region },
+      { "get_obstacle_region", map_api_get_obstacle_region }
   };
 
   const std::vector<luaL_Reg> metamethods = {
@@ -432,18 +509,10 @@ int LuaContext::l_create_tile(lua_State* l) {
     if (pattern == nullptr) {
       LuaTools::error(l, "No such pattern in tileset '" + tileset_id + "': '" + tile_pattern_id + "'");
     }
-    const Size& pattern_size = pattern->get_size();
-    Entities& entities = map.get_entities();
-
-    // If the tile is big, divide it in several smaller tiles so that
-    // most of them can still be optimized away.
-    // Otherwise, tiles expanded in big rectangles like a lake or a dungeon
-    // floor would be entirely redrawn at each frame when just one small
-    // animated tile overlaps them.
 
     TileInfo tile_info;
     tile_info.layer = layer;
-    tile_info.box = { Point(), pattern_size };
+    tile_info.box = { Point(x, y), pattern->get_size() };
     tile_info.pattern_id = tile_pattern_id;
     tile_info.pattern = pattern;
 
@@ -451,15 +520,9 @@ int LuaContext::l_create_tile(lua_State* l) {
       tile_info.tileset = &tileset;
     }
 
-    for (int current_y = y; current_y < y + size.height; current_y += pattern->get_height()) {
-      for (int current_x = x; current_x < x + size.width; current_x += pattern->get_width()) {
-        tile_info.box.set_xy(current_x, current_y);
-        // The tile will actually be created only if it cannot be optimized away.
-        entities.add_tile_info(
-            tile_info
-        );
-      }
-    }
+    // The tile is divided in tiles of the pattern size, and those will
+    // actually be created only if they cannot be optimized away.
+    map.get_entities().add_tile_infos(tile_info, size);
 
     return 0;
   });
@@ -1261,7 +1324,7 @@ int LuaContext::l_create_custom_entity(lua_State* l) {
     EntityData& data = *(static_cast<EntityData*>(lua_touserdata(l, 2)));
 
     Game& game = map.get_game();
-    EntityPtr entity = std::make_shared<CustomEntity>(
+    EntityPtr entity = make_pooled<CustomEntity>(
         game,
         data.get_name(),
         data.get_integer("direction"),
@@ -1295,7 +1358,7 @@ int LuaContext::l_create_bomb(lua_State* l) {
     Map& map = *check_map(l, 1);
     EntityData& data = *(static_cast<EntityData*>(lua_touserdata(l, 2)));
 
-    EntityPtr entity = std::make_shared<Bomb>(
+    EntityPtr entity = make_pooled<Bomb>(
         data.get_name(),
         entity_creation_check_layer(l, 1, data, map),
         data.get_xy()
@@ -1323,7 +1386,7 @@ int LuaContext::l_create_explosion(lua_State* l) {
     EntityData& data = *(static_cast<EntityData*>(lua_touserdata(l, 2)));
 
     const bool with_damage = true;
-    EntityPtr entity = std::make_shared<Explosion>(
+    EntityPtr entity = make_pooled<Explosion>(
         data.get_name(),
         entity_creation_check_layer(l, 1, data, map),
         data.get_xy(),
@@ -1351,7 +1414,7 @@ int LuaContext::l_create_fire(lua_State* l) {
     Map& map = *check_map(l, 1);
     EntityData& data = *(static_cast<EntityData*>(lua_touserdata(l, 2)));
 
-    EntityPtr entity = std::make_shared<Fire>(
+    EntityPtr entity = make_pooled<Fire>(
         data.get_name(),
         entity_creation_check_layer(l, 1, data, map),
         data.get_xy()
@@ -1519,14 +1582,16 @@ int LuaContext::l_hero_teleport(lua_State* l) {
     Game& game = hero.get_game();
     const std::string& map_id = LuaTools::check_string(l, 1);
     const std::string& destination_name = LuaTools::opt_string(l, 2, "");
-    Transition::Style transition_style = LuaTools::opt_enum<Transition::Style>(
-        l, 3, game.get_default_transition_style());
+    const std::string& transition_effect = opt_transition_effect(l, 3);
+    Transition::Style transition_style = transition_effect.empty() ?
+        LuaTools::opt_enum<Transition::Style>(l, 3, game.get_default_transition_style()) :
+        game.get_default_transition_style();
 
     if (!CurrentQuest::resource_exists(ResourceType::MAP, map_id)) {
       LuaTools::arg_error(l, 2, std::string("No such map: '") + map_id + "'");
     }
 
-    game.set_current_map(map_id, destination_name, transition_style);
+    game.set_current_map(map_id, destination_name, transition_style, transition_effect);
 
     return 0;
   });
@@ -1553,7 +1618,12 @@ int LuaContext::l_entity_iterator_next(lua_State* l) {
     int index = lua_tointeger(l, lua_upvalueindex(3));
 
     if (index > size) {
-      // Finished.
+      if (index == size + 1) {
+        // Just finished: give the empty table to the next iterator.
+        release_entity_iterator_table(l, table_index, size);
+        lua_pushinteger(l, index + 1);
+        lua_replace(l, lua_upvalueindex(3));
+      }
       return 0;
     }
 
@@ -1569,6 +1639,38 @@ int LuaContext::l_entity_iterator_next(lua_State* l) {
   });
 }
 
+/**
+ * \brief Empties the table of a finished entity iterator and keeps it
+ * for a future iterator.
+ *
+ * Only a few tables are kept.
+ *
+ * \param l A Lua context.
+ * \param table_index Index of the table in the stack.
+ * \param size Number of entities in the table.
+ */
+void LuaContext::release_entity_iterator_table(lua_State* l, int table_index, int size) {
+
+  static constexpr int max_tables = 16;
+
+  lua_rawgeti(l, LUA_REGISTRYINDEX, get().entity_iterator_tables_ref);
+                                  // ... iterator_tables
+  const int num_tables = lua_objlen(l, -1);
+  if (num_tables < max_tables) {
+    // Don't keep the entities alive.
+    for (int i = 1; i <= size; ++i) {
+      lua_pushnil(l);
+      lua_rawseti(l, table_index, i);
+    }
+    lua_pushvalue(l, table_index);
+                                  // ... iterator_tables entities
+    lua_rawseti(l, -2, num_tables + 1);
+                                  // ... iterator_tables
+  }
+  lua_pop(l, 1);
+                                  // ...
+}
+
 /**
  * \brief Generates a Lua error if a map is not in an existing game.
  * \param l A Lua context.
@@ -1582,6 +1684,26 @@ void LuaContext::check_map_has_game(lua_State* l, const Map& map) {
   }
 }
 
+/**
+ * \brief Returns the name of a transition effect passed instead of a
+ * transition style.
+ * \param l A Lua context.
+ * \param index Index of the transition style or effect name.
+ * \return The name of the registered transition effect at this index,
+ * or an empty string if the value is not the name of an effect.
+ */
+std::string LuaContext::opt_transition_effect(lua_State* l, int index) {
+
+  if (lua_type(l, index) != LUA_TSTRING) {
+    return "";
+  }
+  const std::string effect_name = lua_tostring(l, index);
+  if (Transition::get_effect(effect_name) == nullptr) {
+    return "";
+  }
+  return effect_name;
+}
+
 /**
  * \brief Implementation of map:get_game().
  * \param l The Lua context that is calling this function.
@@ -1929,7 +2051,123 @@ int LuaContext::map_api_get_ground(lua_State* l) {
 
     Ground ground = map.get_ground(layer, x, y, nullptr);
 
-    push_string(l, enum_to_name(ground));
+    push_interned_string(l, enum_to_name(ground));
+    return 1;
+  });
+}
+
+namespace {
+
+/**
+ * \brief Checks the rectangle and cell size of a region query.
+ * \param l A Lua state.
+ * \param index Index of the x coordinate, followed by y, width and height.
+ * \param cell_size_index Index of the optional cell size.
+ * \param[out] region The rectangle.
+ * \param[out] cell_size The cell size.
+ */
+void check_region_cells(
+    lua_State* l,
+    int index,
+    int cell_size_index,
+    Rectangle& region,
+    int& cell_size
+) {
+  region = Rectangle(
+      LuaTools::check_int(l, index),
+      LuaTools::check_int(l, index + 1),
+      LuaTools::check_int(l, index + 2),
+      LuaTools::check_int(l, index + 3)
+  );
+  cell_size = LuaTools::opt_int(l, cell_size_index, 8);
+
+  if (region.get_width() < 0 || region.get_height() < 0) {
+    LuaTools::arg_error(l, index + 2, "Region size cannot be negative");
+  }
+  if (cell_size <= 0) {
+    LuaTools::arg_error(l, cell_size_index, "Cell size must be positive");
+  }
+}
+
+}
+
+/**
+ * \brief Implementation of map:get_ground_region().
+ *
+ * Returns a string with one byte per cell, row by row,
+ * and a table giving the ground name of each byte value.
+ * The ground of a cell is the one at its center.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_ground_region(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    Rectangle region;
+    int cell_size = 0;
+    check_region_cells(l, 2, 7, region, cell_size);
+    int layer = LuaTools::check_layer(l, 6, map);
+
+    const int num_columns = (region.get_width() + cell_size - 1) / cell_size;
+    const int num_rows = (region.get_height() + cell_size - 1) / cell_size;
+    std::string cells;
+    cells.reserve(num_columns * num_rows);
+    for (int row = 0; row < num_rows; ++row) {
+      const int y = region.get_y() + row * cell_size + cell_size / 2;
+      for (int column = 0; column < num_columns; ++column) {
+        const int x = region.get_x() + column * cell_size + cell_size / 2;
+        const Ground ground = map.get_ground(layer, x, y, nullptr);
+        cells.push_back(static_cast<char>(ground));
+      }
+    }
+
+    push_string(l, cells);
+    lua_createtable(l, 0, static_cast<int>(EnumInfoTraits<Ground>::names.size()));
+    for (const auto& kvp : EnumInfoTraits<Ground>::names) {
+      push_interned_string(l, kvp.second);
+      lua_rawseti(l, -2, static_cast<int>(kvp.first));
+    }
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_obstacle_region().
+ *
+ * Returns a string with one byte per cell, row by row:
+ * 1 if the cell is an obstacle for the entity, 0 otherwise.
+ * The whole cell is tested, static tiles and dynamic entities included.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_obstacle_region(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    Entity& entity = *check_entity(l, 2);
+    Rectangle region;
+    int cell_size = 0;
+    check_region_cells(l, 3, 8, region, cell_size);
+    int layer = LuaTools::check_layer(l, 7, map);
+
+    const int num_columns = (region.get_width() + cell_size - 1) / cell_size;
+    const int num_rows = (region.get_height() + cell_size - 1) / cell_size;
+    std::string cells;
+    cells.reserve(num_columns * num_rows);
+    Rectangle cell(0, 0, cell_size, cell_size);
+    for (int row = 0; row < num_rows; ++row) {
+      cell.set_y(region.get_y() + row * cell_size);
+      for (int column = 0; column < num_columns; ++column) {
+        cell.set_x(region.get_x() + column * cell_size);
+        const bool obstacle = map.test_collision_with_obstacles(layer, cell, entity);
+        cells.push_back(obstacle ? 1 : 0);
+      }
+    }
+
+    push_string(l, cells);
     return 1;
   });
 }
@@ -2188,10 +2426,7 @@ int LuaContext::map_api_get_entities_count(lua_State* l) {
     Map& map = *check_map(l, 1);
     const std::string& prefix = LuaTools::check_string(l, 2);
 
-    const EntityVector& entities =
-        map.get_entities().get_entities_with_prefix(prefix);
-
-    lua_pushinteger(l, entities.size());
+    lua_pushinteger(l, map.get_entities().get_num_entities_with_prefix(prefix));
     return 1;
   });
 }
@@ -2245,16 +2480,144 @@ int LuaContext::map_api_get_entities_in_rectangle(lua_State* l) {
     const int width = LuaTools::check_int(l, 4);
     const int height = LuaTools::check_int(l, 5);
 
-    EntityVector entities;
+    PooledEntityVector entities;
     map.get_entities().get_entities_in_rectangle_z_sorted(
-        Rectangle(x, y, width, height), entities
+        Rectangle(x, y, width, height), entities.get()
     );
 
-    push_entity_iterator(l, entities);
+    push_entity_iterator(l, entities.get());
     return 1;
   });
 }
 
+/**
+ * \brief Implementation of map:get_entities_in_rectangle_count().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_entities_in_rectangle_count(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int width = LuaTools::check_int(l, 4);
+    const int height = LuaTools::check_int(l, 5);
+
+    int count = 0;
+    map.get_entities().visit_entities_in_rectangle(
+        Rectangle(x, y, width, height), [&count](const EntityPtr& /* entity */) {
+      ++count;
+      return true;
+    });
+
+    lua_pushinteger(l, count);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:has_entities_in_rectangle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_has_entities_in_rectangle(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int width = LuaTools::check_int(l, 4);
+    const int height = LuaTools::check_int(l, 5);
+
+    // Stop at the first entity found.
+    const bool found = !map.get_entities().visit_entities_in_rectangle(
+        Rectangle(x, y, width, height), [](const EntityPtr& /* entity */) {
+      return false;
+    });
+
+    lua_pushboolean(l, found);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_first_entity_in_rectangle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_first_entity_in_rectangle(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int width = LuaTools::check_int(l, 4);
+    const int height = LuaTools::check_int(l, 5);
+
+    // The first one in Z order, like map:get_entities_in_rectangle(),
+    // without sorting the others.
+    const EntityZOrderComparator comparator;
+    EntityPtr first;
+    map.get_entities().visit_entities_in_rectangle(
+        Rectangle(x, y, width, height), [&](const EntityPtr& entity) {
+      if (first == nullptr || comparator(entity, first)) {
+        first = entity;
+      }
+      return true;
+    });
+
+    if (first == nullptr) {
+      lua_pushnil(l);
+    }
+    else {
+      push_entity(l, *first);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:foreach_entity_in_rectangle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_foreach_entity_in_rectangle(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    const int width = LuaTools::check_int(l, 4);
+    const int height = LuaTools::check_int(l, 5);
+    LuaTools::check_type(l, 6, LUA_TFUNCTION);
+
+    // The callback may change entities: get them all first.
+    PooledEntityVector entities;
+    map.get_entities().get_entities_in_rectangle_z_sorted(
+        Rectangle(x, y, width, height), entities.get()
+    );
+
+    for (const EntityPtr& entity : entities.get()) {
+      if (entity->is_being_removed()) {
+        continue;
+      }
+      lua_pushvalue(l, 6);
+      push_entity(l, *entity);
+      if (!LuaTools::call_function(l, 1, 1, "foreach_entity_in_rectangle callback")) {
+        break;
+      }
+      const bool stop = lua_isboolean(l, -1) && !lua_toboolean(l, -1);
+      lua_pop(l, 1);
+      if (stop) {
+        // The callback returned false.
+        break;
+      }
+    }
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of map:get_entities_in_region().
  * \param l The Lua context that is calling this function.
@@ -2279,7 +2642,8 @@ int LuaContext::map_api_get_entities_in_region(lua_State* l) {
       LuaTools::type_error(l, 2, "entity or number");
     }
 
-    EntityVector entities;
+    PooledEntityVector pooled_entities;
+    EntityVector& entities = pooled_entities.get();
     map.get_entities().get_entities_in_region_z_sorted(
         xy, entities
     );
@@ -2297,6 +2661,34 @@ int LuaContext::map_api_get_entities_in_region(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:get_region_at().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_region_at(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    int x = LuaTools::check_int(l, 2);
+    int y = LuaTools::check_int(l, 3);
+
+    const SeparatorRegions& separator_regions = map.get_entities().get_separator_regions();
+    const int index = separator_regions.get_region_index_at(Point(x, y));
+    if (index == -1) {
+      lua_pushnil(l);
+      return 1;
+    }
+
+    const Rectangle& region = separator_regions.get_region(index);
+    lua_pushinteger(l, region.get_x());
+    lua_pushinteger(l, region.get_y());
+    lua_pushinteger(l, region.get_width());
+    lua_pushinteger(l, region.get_height());
+    return 4;
+  });
+}
+
 /**
  * \brief Implementation of map:get_hero().
  * \param l The Lua context that is calling this function.
@@ -2353,6 +2745,254 @@ int LuaContext::map_api_remove_entities(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:is_collision_batching_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_collision_batching_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    lua_pushboolean(l, map.get_entities().is_collision_batching_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_collision_batching_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_collision_batching_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    map.get_entities().set_collision_batching_enabled(enabled);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:is_stream_field_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_stream_field_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    lua_pushboolean(l, map.get_entities().is_stream_field_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_stream_field_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_stream_field_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    map.get_entities().set_stream_field_enabled(enabled);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:is_parallel_update_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_parallel_update_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    lua_pushboolean(l, map.get_entities().is_parallel_update_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_parallel_update_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_parallel_update_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    map.get_entities().set_parallel_update_enabled(enabled);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:is_occlusion_culling_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_occlusion_culling_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    lua_pushboolean(l, map.get_entities().is_occlusion_culling_enabled());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_occlusion_culling_enabled().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_occlusion_culling_enabled(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    bool enabled = LuaTools::opt_boolean(l, 2, true);
+
+    map.get_entities().set_occlusion_culling_enabled(enabled);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_room_activation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_room_activation(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    push_interned_string(l, enum_to_name(map.get_entities().get_room_activation()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_room_activation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_room_activation(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+    Entities::RoomActivation room_activation =
+        LuaTools::check_enum<Entities::RoomActivation>(l, 2);
+
+    map.get_entities().set_room_activation(room_activation);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:get_chunk_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_get_chunk_size(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+
+    if (!map.is_chunked()) {
+      lua_pushnil(l);
+      return 1;
+    }
+
+    lua_pushinteger(l, map.get_chunk_size().width);
+    lua_pushinteger(l, map.get_chunk_size().height);
+    lua_pushinteger(l, map.get_chunk_margin());
+    return 3;
+  });
+}
+
+/**
+ * \brief Implementation of map:set_chunk_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_set_chunk_size(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Map& map = *check_map(l, 1);
+
+    Size chunk_size;
+    int chunk_margin = 0;
+    if (!lua_isnil(l, 2)) {
+      chunk_size.width = LuaTools::check_int(l, 2);
+      chunk_size.height = LuaTools::check_int(l, 3);
+      chunk_margin = LuaTools::opt_int(l, 4, 1);
+      if (chunk_size.width <= 0 || chunk_size.height <= 0) {
+        LuaTools::arg_error(l, 2, "Chunk size must be positive");
+      }
+      if (chunk_margin < 0) {
+        LuaTools::arg_error(l, 4, "Chunk margin must be positive or zero");
+      }
+    }
+
+    map.set_chunk_size(chunk_size, chunk_margin);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of map:is_chunk_active().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_is_chunk_active(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Map& map = *check_map(l, 1);
+    int column = LuaTools::check_int(l, 2);
+    int row = LuaTools::check_int(l, 3);
+
+    lua_pushboolean(l, map.is_chunk_active(column, row));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of map:preload_sprite_animations().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_preload_sprite_animations(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    check_map(l, 1);
+    const std::string& sprite_id = LuaTools::check_string(l, 2);
+    std::vector<std::string> animation_names;
+    for (int i = 3; i <= lua_gettop(l); ++i) {
+      animation_names.push_back(LuaTools::check_string(l, i));
+    }
+
+    if (!CurrentQuest::resource_exists(ResourceType::SPRITE, sprite_id)) {
+      LuaTools::arg_error(l, 2, std::string("No such sprite: '") + sprite_id + "'");
+    }
+
+    Sprite::preload_animations(sprite_id, animation_names);
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of all entity creation functions: map_api_create_*.
  * \param l The Lua context that is calling this function.
@@ -2377,6 +3017,53 @@ int LuaContext::map_api_create_entity(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of map:create_entities().
+ *
+ * All descriptions are checked before creating any entity.
+ * The new entities are then inserted together in the quadtree
+ * the next time it is used.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::map_api_create_entities(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    Map& map = *check_map(l, 1);
+    LuaTools::check_type(l, 2, LUA_TTABLE);
+    if (!map.is_loaded()) {
+      LuaTools::arg_error(l, 1, "This map is not loaded");
+    }
+
+    std::vector<EntityData> entities_data;
+    const int num_entities = static_cast<int>(lua_objlen(l, 2));
+    entities_data.reserve(num_entities);
+    for (int i = 1; i <= num_entities; ++i) {
+      lua_rawgeti(l, 2, i);
+      const int index = lua_gettop(l);
+      LuaTools::check_type(l, index, LUA_TTABLE);
+      EntityType type = LuaTools::check_enum_field<EntityType>(l, index, "type");
+      if (!EntityTypeInfo::can_be_created_from_lua_api(type)) {
+        LuaTools::arg_error(l, 2, "Cannot create entities of type '" + enum_to_name(type) + "'");
+      }
+      entities_data.emplace_back(EntityData::check_entity_data(l, index, type));
+      lua_pop(l, 1);
+    }
+
+    lua_createtable(l, num_entities, 0);
+    int num_created = 0;
+    for (const EntityData& data : entities_data) {
+      if (get().create_map_entity_from_data(map, data)) {
+        lua_rawseti(l, -2, ++num_created);
+      }
+    }
+
+    return 1;
+  });
+}
+
 /**
  * \brief Calls the on_started() method of a Lua map.
  *
@@ -2410,6 +3097,7 @@ void LuaContext::map_on_finished(Map& map) {
     on_finished();
   }
   remove_timers(-1);  // Stop timers and menus associated to this map.
+  remove_tasks(-1);
   remove_menus(-1);
   lua_pop(current_l, 1);
 }
@@ -2424,10 +3112,7 @@ void LuaContext::map_on_finished(Map& map) {
 void LuaContext::map_on_update(Map& map) {
 
   push_map(current_l, map);
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(map, method_name)) {
+  if (userdata_has_field(map, LuaEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
@@ -2445,7 +3130,7 @@ void LuaContext::map_on_update(Map& map) {
 void LuaContext::map_on_draw(Map& map, const SurfacePtr& dst_surface) {
 
   push_map(current_l, map);
-  if (userdata_has_field(map, "on_draw")) {
+  if (userdata_has_field(map, LuaEvent::ON_DRAW)) {
     on_draw(dst_surface);
   }
   menus_on_draw(-1, dst_surface);
@@ -2532,7 +3217,7 @@ bool LuaContext::map_on_command_released(Map& map, GameCommand command) {
  */
 void LuaContext::map_on_suspended(Map& map, bool suspended) {
 
-  if (!userdata_has_field(map, "on_suspended")) {
+  if (!userdata_has_field(map, LuaEvent::ON_SUSPENDED)) {
     return;
   }
 
@@ -2599,5 +3284,45 @@ void LuaContext::map_on_obtained_treasure(Map& map, const Treasure& treasure) {
   lua_pop(current_l, 1);
 }
 
+/**
+ * \brief Calls the on_chunk_activated() method of a Lua map.
+ *
+ * Does nothing if the method is not defined.
+ *
+ * \param map A map.
+ * \param column Column of the chunk that became active.
+ * \param row Row of the chunk that became active.
+ */
+void LuaContext::map_on_chunk_activated(Map& map, int column, int row) {
+
+  if (!userdata_has_field(map, "on_chunk_activated")) {
+    return;
+  }
+
+  push_map(current_l, map);
+  on_chunk_activated(column, row);
+  lua_pop(current_l, 1);
+}
+
+/**
+ * \brief Calls the on_chunk_deactivated() method of a Lua map.
+ *
+ * Does nothing if the method is not defined.
+ *
+ * \param map A map.
+ * \param column Column of the chunk that became inactive.
+ * \param row Row of the chunk that became inactive.
+ */
+void LuaContext::map_on_chunk_deactivated(Map& map, int column, int row) {
+
+  if (!userdata_has_field(map, "on_chunk_deactivated")) {
+    return;
+  }
+
+  push_map(current_l, map);
+  on_chunk_deactivated(column, row);
+  lua_pop(current_l, 1);
+}
+
 }
 
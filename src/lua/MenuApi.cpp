@@ -19,7 +19,7 @@
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
-#include <list>
+#include <algorithm>
 #include <lua.hpp>
 
 namespace Solarus {
@@ -49,6 +49,124 @@ void LuaContext::register_menu_module() {
   }
 
   register_functions(menu_module_name, functions);
+
+  // Metatable given to menu tables to know the callbacks they define.
+  lua_newtable(current_l);
+                                  // menu_meta
+  lua_pushcfunction(current_l, menu_meta_newindex);
+                                  // menu_meta __newindex
+  lua_setfield(current_l, -2, "__newindex");
+                                  // menu_meta
+  menu_metatable_ref = luaL_ref(current_l, LUA_REGISTRYINDEX);
+                                  // --
+}
+
+/**
+ * \brief Returns the callbacks that a menu may have.
+ *
+ * Plain tables get a metatable whose __newindex records callbacks defined
+ * later. Menus with their own metatable may get methods from it at any
+ * time: all their callbacks are considered defined.
+ *
+ * \param l A Lua state.
+ * \param index Index of the menu table.
+ * \return The MenuEvent bits of the menu.
+ */
+uint32_t LuaContext::get_menu_events(lua_State* l, int index) {
+
+  static const char* const input_events[] = {
+      "on_key_pressed",
+      "on_key_released",
+      "on_character_pressed",
+      "on_joypad_button_pressed",
+      "on_joypad_button_released",
+      "on_joypad_axis_moved",
+      "on_joypad_hat_moved",
+      "on_mouse_pressed",
+      "on_mouse_released",
+      "on_finger_pressed",
+      "on_finger_released",
+      "on_finger_moved",
+  };
+
+  index = LuaTools::get_positive_index(l, index);
+  LuaContext& lua_context = get();
+
+  if (lua_getmetatable(l, index)) {
+                                  // ... meta
+    lua_rawgeti(l, LUA_REGISTRYINDEX, lua_context.menu_metatable_ref);
+                                  // ... meta menu_meta
+    const bool tracked = lua_rawequal(l, -1, -2);
+    lua_pop(l, 2);
+                                  // ...
+    if (!tracked) {
+      return MENU_ALL_EVENTS;
+    }
+  }
+  else {
+    lua_rawgeti(l, LUA_REGISTRYINDEX, lua_context.menu_metatable_ref);
+                                  // ... menu_meta
+    lua_setmetatable(l, index);
+                                  // ...
+  }
+
+  const auto has_field = [l, index](const char* name) {
+    lua_getfield(l, index, name);
+    const bool result = !lua_isnil(l, -1);
+    lua_pop(l, 1);
+    return result;
+  };
+
+  uint32_t events = 0;
+  if (has_field("on_update")) {
+    events |= MENU_ON_UPDATE;
+  }
+  if (has_field("on_draw")) {
+    events |= MENU_ON_DRAW;
+  }
+  if (has_field("on_command_pressed")) {
+    events |= MENU_ON_COMMAND_PRESSED;
+  }
+  if (has_field("on_command_released")) {
+    events |= MENU_ON_COMMAND_RELEASED;
+  }
+  for (const char* name : input_events) {
+    if (has_field(name)) {
+      events |= MENU_ON_INPUT;
+      break;
+    }
+  }
+  return events;
+}
+
+/**
+ * \brief __newindex function of menus.
+ *
+ * Records the callback defined if the table is a running menu.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::menu_meta_newindex(lua_State* l) {
+
+  LuaTools::check_type(l, 1, LUA_TTABLE);
+  LuaTools::check_any(l, 2);
+  LuaTools::check_any(l, 3);
+
+  lua_settop(l, 3);
+  lua_rawset(l, 1);
+                                  // menu
+
+  LuaContext& lua_context = get();
+  const void* pointer = lua_topointer(l, 1);
+  for (LuaMenuData& menu: lua_context.menus) {
+    if (menu.pointer == pointer) {
+      // Keys are only new once: recompute the events from the fields.
+      menu.events = get_menu_events(l, 1);
+      break;
+    }
+  }
+  return 0;
 }
 
 /**
@@ -69,24 +187,79 @@ void LuaContext::add_menu(
 
   ScopedLuaRef context = LuaTools::create_ref(current_l,context_index);
   Debug::check_assertion(!context.is_empty(), "creating context with empty context");
+  const void* context_pointer = lua_topointer(current_l, context_index);
+
+  push_ref(current_l, menu_ref);
+  const void* pointer = lua_topointer(current_l, -1);
+  lua_pop(current_l, 1);
 
-  if(std::count_if(menus.begin(), menus.end(),[&](const LuaMenuData& menu){
-                   return menu.ref == menu_ref;
-  })){
+  if (std::any_of(menus.begin(), menus.end(), [pointer](const LuaMenuData& menu) {
+    return menu.pointer == pointer;
+  })) {
     LuaTools::error(current_l, "Cannot start an already started menu");
   }
 
-  run_on_main([this, on_top, context, menu_ref](lua_State*) {
-    if (on_top) {
-      menus.emplace_back(menu_ref, context);
-    }
-    else {
-      menus.emplace_front(menu_ref, context);
+  run_on_main([this, on_top, context, menu_ref, pointer, context_pointer](lua_State* l) {
+    push_ref(l, menu_ref);
+    const uint32_t events = get_menu_events(l, -1);
+    lua_pop(l, 1);
+
+    menus.emplace_back(menu_ref, context, pointer, context_pointer, events);
+    if (!on_top) {
+      move_menu(pointer, false);
     }
     menu_on_started(menu_ref);
   });
 }
 
+/**
+ * \brief Moves a menu to the front or to the back of the others.
+ *
+ * If menus are being iterated, this is done when the loop is finished.
+ *
+ * \param menu Address of the menu table.
+ * \param to_front \c true to move it to the front, \c false to the back.
+ */
+void LuaContext::move_menu(const void* menu, bool to_front) {
+
+  if (menus_iteration_depth > 0) {
+    pending_menu_moves.emplace_back(menu, to_front);
+    return;
+  }
+
+  const auto it = std::find_if(menus.begin(), menus.end(), [menu](const LuaMenuData& data) {
+    return data.pointer == menu;
+  });
+  if (it == menus.end()) {
+    return;
+  }
+  if (to_front) {
+    std::rotate(it, it + 1, menus.end());
+  }
+  else {
+    std::rotate(menus.begin(), it, it + 1);
+  }
+}
+
+/**
+ * \brief Ends a loop on menus started by incrementing menus_iteration_depth.
+ *
+ * Menus moved during the loop are moved now if no other loop is in progress.
+ */
+void LuaContext::end_menus_iteration() {
+
+  --menus_iteration_depth;
+  if (menus_iteration_depth > 0 || pending_menu_moves.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<const void*, bool>> moves;
+  moves.swap(pending_menu_moves);
+  for (const std::pair<const void*, bool>& move: moves) {
+    move_menu(move.first, move.second);
+  }
+}
+
 /**
  * \brief Unregisters all menus associated to a context.
  *
@@ -101,14 +274,20 @@ void LuaContext::remove_menus(int context_index) {
     menu.recently_added = false;
   }
 
-  for (LuaMenuData& menu: menus) {
-    ScopedLuaRef menu_ref = menu.ref;
-    if (menu.context.equals(current_l,context_index) && !menu.recently_added) {
-      menu.ref.clear();
+  const void* context = lua_topointer(current_l, context_index);
+  ++menus_iteration_depth;
+  for (size_t i = 0; i < menus.size(); ++i) {
+    LuaMenuData& menu = menus[i];
+    if (menu.context_pointer == context && !menu.recently_added) {
+      ScopedLuaRef menu_ref = std::move(menu.ref);
       menu.context.clear();
+      menu.pointer = nullptr;
+      menu.context_pointer = nullptr;
+      menu.events = 0;
       menu_on_finished(menu_ref);
     }
   }
+  end_menus_iteration();
 }
 
 /**
@@ -124,17 +303,19 @@ void LuaContext::remove_menus() {
     menu.recently_added = false;
   }
 
-  for (LuaMenuData& menu: menus) {
-
-    if (!menu.recently_added) {
-      ScopedLuaRef menu_ref = menu.ref;
-      if (!menu_ref.is_empty()) {
-        menu.ref.clear();
-        menu.context.clear();
-        menu_on_finished(menu_ref);
-      }
+  ++menus_iteration_depth;
+  for (size_t i = 0; i < menus.size(); ++i) {
+    LuaMenuData& menu = menus[i];
+    if (!menu.recently_added && !menu.ref.is_empty()) {
+      ScopedLuaRef menu_ref = std::move(menu.ref);
+      menu.context.clear();
+      menu.pointer = nullptr;
+      menu.context_pointer = nullptr;
+      menu.events = 0;
+      menu_on_finished(menu_ref);
     }
   }
+  end_menus_iteration();
 }
 
 /**
@@ -143,6 +324,9 @@ void LuaContext::remove_menus() {
 void LuaContext::destroy_menus() {
 
   menus.clear();
+  pending_menu_moves.clear();
+  luaL_unref(current_l, LUA_REGISTRYINDEX, menu_metatable_ref);
+  menu_metatable_ref = LUA_REFNIL;
 }
 
 /**
@@ -153,22 +337,19 @@ void LuaContext::destroy_menus() {
  */
 void LuaContext::update_menus() {
 
+  Debug::check_assertion(menus_iteration_depth == 0, "Menus are being iterated");
+
   // Destroy the ones that should be removed.
-  for (auto it = menus.begin();
-      it != menus.end();
-      // No ++it (elements may be removed while traversing).
-  ) {
-    it->recently_added = false;
-    if (it->ref.is_empty()) {
-      // Empty ref on a menu means that we should remove.
-      // In this case, context must also be nullptr.
-      Debug::check_assertion(it->context.is_empty(), "Menu with context and no ref");
-      it = menus.erase(it);
-    }
-    else {
-      ++it;
-    }
+  for (LuaMenuData& menu: menus) {
+    menu.recently_added = false;
+    // Empty ref on a menu means that we should remove.
+    // In this case, context must also be nullptr.
+    Debug::check_assertion(!menu.ref.is_empty() || menu.context.is_empty(),
+        "Menu with context and no ref");
   }
+  menus.erase(std::remove_if(menus.begin(), menus.end(), [](const LuaMenuData& menu) {
+    return menu.ref.is_empty();
+  }), menus.end());
 }
 
 /**
@@ -179,19 +360,14 @@ void LuaContext::update_menus() {
  */
 bool LuaContext::is_menu(lua_State* l, int index) {
 
-  index = LuaTools::get_positive_index(l, index);
-
   if (!lua_istable(l, index)) {
     return false;
   }
 
+  const void* pointer = lua_topointer(l, index);
   LuaContext& lua_context = get();
-  for (LuaMenuData& menu: lua_context.menus) {
-    if (menu.ref.is_empty()) {
-      continue;
-    }
-
-    if(menu.ref.equals(l,index)) {
+  for (const LuaMenuData& menu: lua_context.menus) {
+    if (menu.pointer == pointer) {
       return true;
     }
   }
@@ -234,15 +410,18 @@ int LuaContext::menu_api_stop(lua_State* l) {
     //LuaContext& lua_context = get();
 
     LuaTools::check_type(l, 1, LUA_TTABLE);
-    ScopedLuaRef ref = LuaTools::create_ref(l,1);
-    run_on_main([ref](lua_State*){
+    const void* pointer = lua_topointer(l, 1);
+    run_on_main([pointer](lua_State*){
       LuaContext& lua_context = get();
-      std::list<LuaMenuData>& menus = lua_context.menus;
+      std::vector<LuaMenuData>& menus = lua_context.menus;
       for (LuaMenuData& menu: menus) {
-        if (menu.ref == ref) {
-          ScopedLuaRef menu_ref = menu.ref;  // Don't erase it immediately since we may be iterating over menus.
-          menu.ref.clear();
+        if (menu.pointer == pointer) {
+          // Don't erase it immediately since we may be iterating over menus.
+          ScopedLuaRef menu_ref = std::move(menu.ref);
           menu.context.clear();
+          menu.pointer = nullptr;
+          menu.context_pointer = nullptr;
+          menu.events = 0;
           lua_context.menu_on_finished(menu_ref);
           break;
         }
@@ -279,23 +458,9 @@ int LuaContext::menu_api_stop_all(lua_State* l) {
 int LuaContext::menu_api_is_started(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
-    LuaContext& lua_context = get();
-
     LuaTools::check_type(l, 1, LUA_TTABLE);
 
-    bool found = false;
-    std::list<LuaMenuData>& menus = lua_context.menus;
-    for (LuaMenuData& menu: menus) {
-      push_ref(l, menu.ref);
-      found = lua_equal(l, 1, -1);
-      lua_pop(l, 1);
-
-      if (found) {
-        break;
-      }
-    }
-
-    lua_pushboolean(l, found);
+    lua_pushboolean(l, is_menu(l, 1));
 
     return 1;
   });
@@ -313,21 +478,7 @@ int LuaContext::menu_api_bring_to_front(lua_State* l) {
 
     LuaTools::check_type(l, 1, LUA_TTABLE);
 
-    std::list<LuaMenuData>& menus = lua_context.menus;
-    for (auto it = menus.begin();
-         it != menus.end();
-         ++it
-    ) {
-      LuaMenuData menu = *it;
-      push_ref(l, menu.ref);
-      if (lua_equal(l, 1, -1)) {
-        menus.erase(it);
-        menus.push_back(menu);
-        lua_pop(l, 1);
-        break;
-      }
-      lua_pop(l, 1);
-    }
+    lua_context.move_menu(lua_topointer(l, 1), true);
 
     return 0;
   });
@@ -345,21 +496,7 @@ int LuaContext::menu_api_bring_to_back(lua_State* l) {
 
     LuaTools::check_type(l, 1, LUA_TTABLE);
 
-    std::list<LuaMenuData>& menus = lua_context.menus;
-    for (auto it = menus.begin();
-         it != menus.end();
-         ++it
-    ) {
-      LuaMenuData menu = *it;
-      push_ref(l, menu.ref);
-      if (lua_equal(l, 1, -1)) {
-        menus.erase(it);
-        menus.push_front(menu);
-        lua_pop(l, 1);
-        break;
-      }
-      lua_pop(l, 1);
-    }
+    lua_context.move_menu(lua_topointer(l, 1), false);
 
     return 0;
   });
@@ -386,110 +523,113 @@ void LuaContext::menu_on_finished(const ScopedLuaRef& menu_ref) {
   remove_menus(-1);  // First, stop children menus if any.
   on_finished();
   remove_timers(-1);  // Stop timers associated to this menu.
+  remove_tasks(-1);
   lua_pop(current_l, 1);
 }
 
 /**
  * \brief Calls the on_update() method of a Lua menu.
- * \param menu_ref A reference to the menu object.
+ *
+ * The menu is only pushed to Lua if it has an on_update() method.
+ *
+ * \param menu_index Index of the menu in the menus list.
  */
-void LuaContext::menu_on_update(const ScopedLuaRef& menu_ref) {
+void LuaContext::menu_on_update(size_t menu_index) {
   check_callback_thread();
-  push_ref(current_l, menu_ref);
-  on_update();
-  menus_on_update(-1);  // Update children menus if any.
-  lua_pop(current_l, 1);
+  const void* pointer = menus[menu_index].pointer;
+  if (menus[menu_index].events & MENU_ON_UPDATE) {
+    push_ref(current_l, menus[menu_index].ref);
+    on_update();
+    lua_pop(current_l, 1);
+  }
+  menus_on_update(pointer);  // Update children menus if any.
 }
 
 /**
  * \brief Calls the on_draw() method of a Lua menu.
- * \param menu_ref A reference to the menu object.
+ * \param menu_index Index of the menu in the menus list.
  * \param dst_surface The destination surface.
  */
 void LuaContext::menu_on_draw(
-    const ScopedLuaRef& menu_ref,
+    size_t menu_index,
     const SurfacePtr& dst_surface
 ) {
-  push_ref(current_l, menu_ref);
-  on_draw(dst_surface);
-  menus_on_draw(-1, dst_surface);  // Draw children menus if any.
-  lua_pop(current_l, 1);
+  const void* pointer = menus[menu_index].pointer;
+  if (menus[menu_index].events & MENU_ON_DRAW) {
+    push_ref(current_l, menus[menu_index].ref);
+    on_draw(dst_surface);
+    lua_pop(current_l, 1);
+  }
+  menus_on_draw(pointer, dst_surface);  // Draw children menus if any.
 }
 
 /**
  * \brief Calls an input callback method of a Lua menu.
- * \param menu_ref A reference to the menu object.
+ * \param menu_index Index of the menu in the menus list.
  * \param event The input event to forward.
  * \return \c true if the event was handled and should stop being propagated.
  */
 bool LuaContext::menu_on_input(
-    const ScopedLuaRef& menu_ref,
+    size_t menu_index,
     const InputEvent& event
 ) {
-  // Get the Lua menu.
-  push_ref(current_l, menu_ref);
-
   // Send the event to children menus first.
-  bool handled = menus_on_input(-1, event);
+  bool handled = menus_on_input(menus[menu_index].pointer, event);
 
-  if (!handled) {
+  // The list may have been modified by children menus.
+  if (!handled && (menus[menu_index].events & MENU_ON_INPUT)) {
     // Sent the event to this menu.
+    push_ref(current_l, menus[menu_index].ref);
     handled = on_input(event);
+    lua_pop(current_l, 1);
   }
 
-  // Remove the menu from the stack.
-  lua_pop(current_l, 1);
-
   return handled;
 }
 
 /**
  * \brief Calls the on_command_pressed() method of a Lua menu.
- * \param menu_ref A reference to the menu object.
+ * \param menu_index Index of the menu in the menus list.
  * \param command The game command just pressed.
  * \return \c true if the event was handled and should stop being propagated.
  */
 bool LuaContext::menu_on_command_pressed(
-    const ScopedLuaRef& menu_ref,
+    size_t menu_index,
     GameCommand command
 ) {
-  push_ref(current_l, menu_ref);
-
   // Send the event to children menus first.
-  bool handled = menus_on_command_pressed(-1, command);
+  bool handled = menus_on_command_pressed(menus[menu_index].pointer, command);
 
-  if (!handled) {
+  if (!handled && (menus[menu_index].events & MENU_ON_COMMAND_PRESSED)) {
     // Sent the event to this menu.
+    push_ref(current_l, menus[menu_index].ref);
     handled = on_command_pressed(command);
+    lua_pop(current_l, 1);
   }
 
-  lua_pop(current_l, 1);
-
   return handled;
 }
 
 /**
  * \brief Calls the on_command_released() method of a Lua menu.
- * \param menu_ref A reference to the menu object.
+ * \param menu_index Index of the menu in the menus list.
  * \param command The game command just released.
  * \return \c true if the event was handled and should stop being propagated.
  */
 bool LuaContext::menu_on_command_released(
-    const ScopedLuaRef& menu_ref,
+    size_t menu_index,
     GameCommand command
 ) {
-  push_ref(current_l, menu_ref);
-
   // Send the event to children menus first.
-  bool handled = menus_on_command_released(-1, command);
+  bool handled = menus_on_command_released(menus[menu_index].pointer, command);
 
-  if (!handled) {
+  if (!handled && (menus[menu_index].events & MENU_ON_COMMAND_RELEASED)) {
     // Sent the event to this menu.
+    push_ref(current_l, menus[menu_index].ref);
     handled = on_command_released(command);
+    lua_pop(current_l, 1);
   }
 
-  lua_pop(current_l, 1);
-
   return handled;
 }
 
@@ -498,11 +638,25 @@ bool LuaContext::menu_on_command_released(
  * \param context_index Index of an object with menus.
  */
 void LuaContext::menus_on_update(int context_index) {
-  for (LuaMenuData& menu: menus) {
-    if (menu.context.equals(current_l,context_index)) {
-      menu_on_update(menu.ref);
+  menus_on_update(lua_topointer(current_l, context_index));
+}
+
+/**
+ * \brief Calls the on_update() method of the menus associated to a context.
+ *
+ * Menus started during the loop are appended and updated too,
+ * like with the previous linked list.
+ *
+ * \param context Address of an object with menus.
+ */
+void LuaContext::menus_on_update(const void* context) {
+  ++menus_iteration_depth;
+  for (size_t i = 0; i < menus.size(); ++i) {
+    if (menus[i].context_pointer == context) {
+      menu_on_update(i);
     }
   }
+  end_menus_iteration();
 }
 
 /**
@@ -511,11 +665,22 @@ void LuaContext::menus_on_update(int context_index) {
  * \param dst_surface The destination surface to draw.
  */
 void LuaContext::menus_on_draw(int context_index, const SurfacePtr& dst_surface) {
-  for (LuaMenuData& menu: menus) {
-    if (menu.context.equals(current_l,context_index)) {
-      menu_on_draw(menu.ref, dst_surface);
+  menus_on_draw(lua_topointer(current_l, context_index), dst_surface);
+}
+
+/**
+ * \brief Calls the on_draw() method of the menus associated to a context.
+ * \param context Address of an object with menus.
+ * \param dst_surface The destination surface to draw.
+ */
+void LuaContext::menus_on_draw(const void* context, const SurfacePtr& dst_surface) {
+  ++menus_iteration_depth;
+  for (size_t i = 0; i < menus.size(); ++i) {
+    if (menus[i].context_pointer == context) {
+      menu_on_draw(i, dst_surface);
     }
   }
+  end_menus_iteration();
 }
 
 /**
@@ -525,14 +690,25 @@ void LuaContext::menus_on_draw(int context_index, const SurfacePtr& dst_surface)
  * \return \c true if the event was handled and should stop being propagated.
  */
 bool LuaContext::menus_on_input(int context_index, const InputEvent& event) {
+  return menus_on_input(lua_topointer(current_l, context_index), event);
+}
+
+/**
+ * \brief Calls the on_input() method of the menus associated to a context.
+ * \param context Address of an object with menus.
+ * \param event The input event to handle.
+ * \return \c true if the event was handled and should stop being propagated.
+ */
+bool LuaContext::menus_on_input(const void* context, const InputEvent& event) {
+
   bool handled = false;
-  std::list<LuaMenuData>::reverse_iterator it;
-  for (it = menus.rbegin(); it != menus.rend() && !handled; ++it) {
-    const ScopedLuaRef& menu_ref = it->ref;
-    if (it->context.equals(current_l,context_index)) {
-      handled = menu_on_input(menu_ref, event);
+  ++menus_iteration_depth;
+  for (size_t i = menus.size(); i > 0 && !handled; --i) {
+    if (menus[i - 1].context_pointer == context) {
+      handled = menu_on_input(i - 1, event);
     }
   }
+  end_menus_iteration();
 
   return handled;
 }
@@ -545,15 +721,26 @@ bool LuaContext::menus_on_input(int context_index, const InputEvent& event) {
  */
 bool LuaContext::menus_on_command_pressed(int context_index,
     GameCommand command) {
+  return menus_on_command_pressed(lua_topointer(current_l, context_index), command);
+}
+
+/**
+ * \brief Calls the on_command_pressed() method of the menus associated to a context.
+ * \param context Address of an object with menus.
+ * \param command The game command just pressed.
+ * \return \c true if the event was handled and should stop being propagated.
+ */
+bool LuaContext::menus_on_command_pressed(const void* context,
+    GameCommand command) {
 
   bool handled = false;
-  std::list<LuaMenuData>::reverse_iterator it;
-  for (it = menus.rbegin(); it != menus.rend() && !handled; ++it) {
-    const ScopedLuaRef& menu_ref = it->ref;
-    if (it->context.equals(current_l,context_index)) {
-      handled = menu_on_command_pressed(menu_ref, command);
+  ++menus_iteration_depth;
+  for (size_t i = menus.size(); i > 0 && !handled; --i) {
+    if (menus[i - 1].context_pointer == context) {
+      handled = menu_on_command_pressed(i - 1, command);
     }
   }
+  end_menus_iteration();
 
   return handled;
 }
@@ -566,15 +753,26 @@ bool LuaContext::menus_on_command_pressed(int context_index,
  */
 bool LuaContext::menus_on_command_released(int context_index,
     GameCommand command) {
+  return menus_on_command_released(lua_topointer(current_l, context_index), command);
+}
+
+/**
+ * \brief Calls the on_command_released() method of the menus associated to a context.
+ * \param context Address of an object with menus.
+ * \param command The game command just released.
+ * \return \c true if the event was handled and should stop being propagated.
+ */
+bool LuaContext::menus_on_command_released(const void* context,
+    GameCommand command) {
 
   bool handled = false;
-  std::list<LuaMenuData>::reverse_iterator it;
-  for (it = menus.rbegin(); it != menus.rend() && !handled; ++it) {
-    const ScopedLuaRef& menu_ref = it->ref;
-    if (it->context.equals(current_l,context_index)) {
-      handled = menu_on_command_released(menu_ref, command);
+  ++menus_iteration_depth;
+  for (size_t i = menus.size(); i > 0 && !handled; --i) {
+    if (menus[i - 1].context_pointer == context) {
+      handled = menu_on_command_released(i - 1, command);
     }
   }
+  end_menus_iteration();
 
   return handled;
 }
@@ -109,6 +109,8 @@ void LuaContext::register_movement_module() {
       { "set_ignore_suspend", movement_api_set_ignore_suspend },
       { "get_ignore_obstacles", movement_api_get_ignore_obstacles },
       { "set_ignore_obstacles", movement_api_set_ignore_obstacles },
+      { "get_coalesce_moves", movement_api_get_coalesce_moves },
+      { "set_coalesce_moves", movement_api_set_coalesce_moves },
       { "get_direction4", movement_api_get_direction4 }
   };
 
@@ -180,6 +182,12 @@ void LuaContext::register_movement_module() {
       { "is_smooth", target_movement_api_is_smooth },
       { "set_smooth", target_movement_api_set_smooth },
   };
+  if (CurrentQuest::is_format_at_least({ 1, 6 })) {
+    target_movement_methods.insert(target_movement_methods.end(), {
+        { "get_use_flow_field", target_movement_api_get_use_flow_field },
+        { "set_use_flow_field", target_movement_api_set_use_flow_field },
+    });
+  }
   target_movement_methods.insert(
         target_movement_methods.end(),
         movement_common_methods.begin(),
@@ -252,6 +260,8 @@ void LuaContext::register_movement_module() {
   if (CurrentQuest::is_format_at_least({ 1, 6 })) {
     path_finding_movement_methods.insert(path_finding_movement_methods.end(), {
         { "get_angle", path_finding_movement_api_get_angle },
+        { "get_use_flow_field", path_finding_movement_api_get_use_flow_field },
+        { "set_use_flow_field", path_finding_movement_api_set_use_flow_field },
     });
   }
   path_finding_movement_methods.insert(
@@ -791,6 +801,38 @@ int LuaContext::movement_api_set_ignore_obstacles(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of movement:get_coalesce_moves().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::movement_api_get_coalesce_moves(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    std::shared_ptr<Movement> movement = check_movement(l, 1);
+
+    lua_pushboolean(l, movement->are_moves_coalesced());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of movement:set_coalesce_moves().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::movement_api_set_coalesce_moves(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    std::shared_ptr<Movement> movement = check_movement(l, 1);
+    bool coalesce_moves = LuaTools::opt_boolean(l, 2, true);
+
+    movement->set_coalesce_moves(coalesce_moves);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of movement:get_direction4().
  * \param l The Lua context that is calling this function.
@@ -1199,6 +1241,36 @@ int LuaContext::target_movement_api_set_smooth(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of target_movement:get_use_flow_field().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::target_movement_api_get_use_flow_field(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const TargetMovement& movement = *check_target_movement(l, 1);
+    lua_pushboolean(l, movement.get_use_flow_field());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of target_movement:set_use_flow_field().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::target_movement_api_set_use_flow_field(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    TargetMovement& movement = *check_target_movement(l, 1);
+    bool use_flow_field = LuaTools::opt_boolean(l, 2, true);
+    movement.set_use_flow_field(use_flow_field);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Returns whether a value is a userdata of type path movement.
  * \param l A Lua context.
@@ -1524,6 +1596,36 @@ int LuaContext::path_finding_movement_api_set_speed(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of path_finding_movement:get_use_flow_field().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::path_finding_movement_api_get_use_flow_field(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const PathFindingMovement& movement = *check_path_finding_movement(l, 1);
+    lua_pushboolean(l, movement.get_use_flow_field());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of path_finding_movement:set_use_flow_field().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::path_finding_movement_api_set_use_flow_field(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PathFindingMovement& movement = *check_path_finding_movement(l, 1);
+    bool use_flow_field = LuaTools::opt_boolean(l, 2, true);
+    movement.set_use_flow_field(use_flow_field);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Returns whether a value is a userdata of type circle movement.
  * \param l A Lua context.
@@ -2206,7 +2308,7 @@ void LuaContext::movement_on_position_changed(
     }
     lua_pop(current_l, 2);
                                     // ... movement
-    if (userdata_has_field(movement, "on_position_changed")) {
+    if (userdata_has_field(movement, LuaEvent::ON_POSITION_CHANGED)) {
       on_position_changed(xy);
     }
     lua_pop(current_l, 1);
@@ -2273,5 +2375,25 @@ void LuaContext::movement_on_finished(Movement& movement) {
   });
 }
 
+/**
+ * \brief Calls the on_path_ready() method of a Lua movement.
+ *
+ * Does nothing if the method is not defined.
+ *
+ * \param movement A path finding movement.
+ * \param path The path computed, or an empty string if no path was found.
+ */
+void LuaContext::movement_on_path_ready(Movement& movement, const std::string& path) {
+
+  if (!userdata_has_field(movement, "on_path_ready")) {
+    return;
+  }
+
+  run_on_main([this,&movement,path](lua_State* l){
+    push_movement(l, movement);
+    on_path_ready(path);
+    lua_pop(l, 1);
+  });
 }
 
+}
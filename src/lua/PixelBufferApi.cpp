@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/graphics/Color.h"
+#include "solarus/graphics/PixelBuffer.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <memory>
+
+namespace Solarus {
+
+/**
+ * Name of the Lua table representing the pixel buffer module.
+ */
+const std::string LuaContext::pixel_buffer_module_name = "sol.pixel_buffer";
+
+namespace {
+
+/**
+ * \brief Checks an optional rectangle given as 4 integers.
+ * \param l A Lua context.
+ * \param index Index of the x coordinate in the stack.
+ * \param default_rectangle Rectangle to return if there is no x coordinate.
+ * \return The rectangle.
+ */
+Rectangle opt_rectangle(lua_State* l, int index, const Rectangle& default_rectangle) {
+
+  if (lua_isnoneornil(l, index)) {
+    return default_rectangle;
+  }
+  const int x = LuaTools::check_int(l, index);
+  const int y = LuaTools::check_int(l, index + 1);
+  const int width = LuaTools::check_int(l, index + 2);
+  const int height = LuaTools::check_int(l, index + 3);
+  return Rectangle(x, y, width, height);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Initializes the pixel buffer features provided to Lua.
+ */
+void LuaContext::register_pixel_buffer_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  // Functions of sol.pixel_buffer.
+  const std::vector<luaL_Reg> functions = {
+      { "create", pixel_buffer_api_create },
+  };
+
+  // Methods of the pixel buffer type.
+  const std::vector<luaL_Reg> methods = {
+      { "get_size", pixel_buffer_api_get_size },
+      { "get_pixel", pixel_buffer_api_get_pixel },
+      { "set_pixel", pixel_buffer_api_set_pixel },
+      { "fill", pixel_buffer_api_fill },
+      { "blit", pixel_buffer_api_blit },
+      { "read", pixel_buffer_api_read },
+      { "upload", pixel_buffer_api_upload },
+      { "get_dirty_region", pixel_buffer_api_get_dirty_region },
+      { "mark_dirty", pixel_buffer_api_mark_dirty },
+      { "get_pointer", pixel_buffer_api_get_pointer },
+  };
+
+  const std::vector<luaL_Reg> metamethods = {
+      { "__gc", userdata_meta_gc },
+      { "__newindex", userdata_meta_newindex_as_table },
+      { "__index", userdata_meta_index_as_table },
+  };
+
+  register_type(pixel_buffer_module_name, functions, methods, metamethods);
+}
+
+/**
+ * \brief Returns whether a value is a userdata of type pixel buffer.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return \c true if the value at this index is a pixel buffer.
+ */
+bool LuaContext::is_pixel_buffer(lua_State* l, int index) {
+  return is_userdata(l, index, pixel_buffer_module_name);
+}
+
+/**
+ * \brief Checks that the userdata at the specified index of the stack is a
+ * pixel buffer and returns it.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return The pixel buffer.
+ */
+std::shared_ptr<PixelBuffer> LuaContext::check_pixel_buffer(lua_State* l, int index) {
+  return std::static_pointer_cast<PixelBuffer>(
+      check_userdata(l, index, pixel_buffer_module_name)
+  );
+}
+
+/**
+ * \brief Pushes a pixel buffer userdata onto the stack.
+ * \param l A Lua context.
+ * \param pixel_buffer A pixel buffer.
+ */
+void LuaContext::push_pixel_buffer(lua_State* l, PixelBuffer& pixel_buffer) {
+  push_userdata(l, pixel_buffer);
+}
+
+/**
+ * \brief Implementation of sol.pixel_buffer.create().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_create(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    std::shared_ptr<PixelBuffer> pixel_buffer;
+    if (is_surface(l, 1)) {
+      const Surface& surface = *check_surface(l, 1);
+      pixel_buffer = std::make_shared<PixelBuffer>(surface.get_width(), surface.get_height());
+      pixel_buffer->read_from_surface(surface, Point());
+    }
+    else {
+      const int width = LuaTools::check_int(l, 1);
+      const int height = LuaTools::check_int(l, 2);
+      if (width <= 0) {
+        LuaTools::arg_error(l, 1, "Width must be positive");
+      }
+      if (height <= 0) {
+        LuaTools::arg_error(l, 2, "Height must be positive");
+      }
+      pixel_buffer = std::make_shared<PixelBuffer>(width, height);
+    }
+
+    push_pixel_buffer(l, *pixel_buffer);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_size().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_size(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    lua_pushinteger(l, pixel_buffer.get_width());
+    lua_pushinteger(l, pixel_buffer.get_height());
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_pixel().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_pixel(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+
+    if (!pixel_buffer.contains(x, y)) {
+      LuaTools::arg_error(l, 2, "Pixel outside the buffer");
+    }
+    // Return components rather than a table to avoid garbage.
+    uint8_t r, g, b, a;
+    pixel_buffer.get_pixel(x, y).get_components(r, g, b, a);
+    lua_pushinteger(l, r);
+    lua_pushinteger(l, g);
+    lua_pushinteger(l, b);
+    lua_pushinteger(l, a);
+    return 4;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:set_pixel().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_set_pixel(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const int x = LuaTools::check_int(l, 2);
+    const int y = LuaTools::check_int(l, 3);
+    Color color;
+    if (lua_istable(l, 4)) {
+      color = LuaTools::check_color(l, 4);
+    }
+    else {
+      color = Color(
+          LuaTools::check_int(l, 4),
+          LuaTools::check_int(l, 5),
+          LuaTools::check_int(l, 6),
+          LuaTools::opt_int(l, 7, 255)
+      );
+    }
+
+    if (!pixel_buffer.contains(x, y)) {
+      LuaTools::arg_error(l, 2, "Pixel outside the buffer");
+    }
+    pixel_buffer.set_pixel(x, y, color);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:fill().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_fill(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const Color& color = LuaTools::check_color(l, 2);
+    const Rectangle& where = opt_rectangle(l, 3, Rectangle(pixel_buffer.get_size()));
+
+    pixel_buffer.fill(color, where);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:blit().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_blit(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const PixelBuffer& src = *check_pixel_buffer(l, 2);
+    const int x = LuaTools::check_int(l, 3);
+    const int y = LuaTools::check_int(l, 4);
+    const Rectangle& src_region = opt_rectangle(l, 5, Rectangle(src.get_size()));
+
+    pixel_buffer.blit(src, src_region, Point(x, y));
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:read().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_read(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const Surface& surface = *check_surface(l, 2);
+    const int x = LuaTools::opt_int(l, 3, 0);
+    const int y = LuaTools::opt_int(l, 4, 0);
+
+    pixel_buffer.read_from_surface(surface, Point(x, y));
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:upload().
+ *
+ * Without a region, uploads the dirty region and clears it.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_upload(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    Surface& surface = *check_surface(l, 2);
+    const int x = LuaTools::opt_int(l, 3, 0);
+    const int y = LuaTools::opt_int(l, 4, 0);
+
+    if (lua_isnoneornil(l, 5)) {
+      const Rectangle& dirty_region = pixel_buffer.get_dirty_region();
+      pixel_buffer.upload_to_surface(surface, dirty_region, Point(x, y) + dirty_region.get_xy());
+      pixel_buffer.clear_dirty_region();
+    }
+    else {
+      const Rectangle& src_region = opt_rectangle(l, 5, Rectangle());
+      pixel_buffer.upload_to_surface(surface, src_region, Point(x, y) + src_region.get_xy());
+    }
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_dirty_region().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_dirty_region(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+
+    const Rectangle& dirty_region = pixel_buffer.get_dirty_region();
+    if (dirty_region.is_flat()) {
+      lua_pushnil(l);
+      return 1;
+    }
+    lua_pushinteger(l, dirty_region.get_x());
+    lua_pushinteger(l, dirty_region.get_y());
+    lua_pushinteger(l, dirty_region.get_width());
+    lua_pushinteger(l, dirty_region.get_height());
+    return 4;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:mark_dirty().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_mark_dirty(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PixelBuffer& pixel_buffer = *check_pixel_buffer(l, 1);
+    const Rectangle& region = opt_rectangle(l, 2, Rectangle(pixel_buffer.get_size()));
+
+    pixel_buffer.add_dirty_region(region);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of pixel_buffer:get_pointer().
+ *
+ * The pointer is a FFI cdata, so this C API version is only called when
+ * the FFI library is not available.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::pixel_buffer_api_get_pointer(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    check_pixel_buffer(l, 1);
+
+    LuaTools::error(l, "pixel_buffer:get_pointer() requires the LuaJIT FFI library");
+    return 0;
+  });
+}
+
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/RandomStream.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include <memory>
+
+namespace Solarus {
+
+/**
+ * Name of the Lua table representing the random module.
+ */
+const std::string LuaContext::random_module_name = "sol.random";
+
+namespace {
+
+/**
+ * \brief Pushes a random integer like math.random(m [, n]) does.
+ *
+ * With one bound m, the number is in [1, m].
+ * With two bounds m and n, it is in [m, n].
+ *
+ * \param l A Lua context.
+ * \param random_stream The stream to draw from.
+ * \param index Index of the first bound in the stack.
+ * \return Number of values pushed.
+ */
+int push_random_number(lua_State* l, RandomStream& random_stream, int index) {
+
+  int min = 1;
+  int max = LuaTools::check_int(l, index);
+  if (!lua_isnoneornil(l, index + 1)) {
+    min = max;
+    max = LuaTools::check_int(l, index + 1);
+  }
+  if (max < min) {
+    LuaTools::arg_error(l, index, "Interval is empty");
+  }
+  lua_pushinteger(l, random_stream.get_number(min, max + 1));
+  return 1;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Initializes the random number features provided to Lua.
+ */
+void LuaContext::register_random_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  // Functions of sol.random.
+  const std::vector<luaL_Reg> functions = {
+      { "create", random_api_create },
+      { "get_number", random_api_get_number },
+      { "get_real", random_api_get_real },
+  };
+
+  // Methods of the random stream type.
+  const std::vector<luaL_Reg> methods = {
+      { "get_seed", random_api_stream_get_seed },
+      { "set_seed", random_api_stream_set_seed },
+      { "get_number", random_api_stream_get_number },
+      { "get_real", random_api_stream_get_real },
+      { "get_numbers", random_api_stream_get_numbers },
+  };
+
+  const std::vector<luaL_Reg> metamethods = {
+      { "__gc", userdata_meta_gc },
+      { "__newindex", userdata_meta_newindex_as_table },
+      { "__index", userdata_meta_index_as_table },
+  };
+
+  register_type(random_module_name, functions, methods, metamethods);
+}
+
+/**
+ * \brief Returns whether a value is a userdata of type random stream.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return \c true if the value at this index is a random stream.
+ */
+bool LuaContext::is_random_stream(lua_State* l, int index) {
+  return is_userdata(l, index, random_module_name);
+}
+
+/**
+ * \brief Checks that the userdata at the specified index of the stack is a
+ * random stream and returns it.
+ * \param l A Lua context.
+ * \param index An index in the stack.
+ * \return The random stream.
+ */
+std::shared_ptr<RandomStream> LuaContext::check_random_stream(lua_State* l, int index) {
+  return std::static_pointer_cast<RandomStream>(
+      check_userdata(l, index, random_module_name)
+  );
+}
+
+/**
+ * \brief Pushes a random stream userdata onto the stack.
+ * \param l A Lua context.
+ * \param random_stream A random stream.
+ */
+void LuaContext::push_random_stream(lua_State* l, RandomStream& random_stream) {
+  push_userdata(l, random_stream);
+}
+
+/**
+ * \brief Implementation of sol.random.create().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_create(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    uint64_t seed = 0;
+    if (lua_isnoneornil(l, 1)) {
+      // Derive the seed from the engine seed to keep replays deterministic.
+      RandomStream& scripts_stream = Random::get_stream(Random::Subsystem::SCRIPTS);
+      seed = scripts_stream.next();
+    }
+    else {
+      seed = static_cast<uint32_t>(LuaTools::check_int(l, 1));
+    }
+
+    std::shared_ptr<RandomStream> random_stream = std::make_shared<RandomStream>(seed);
+    push_random_stream(l, *random_stream);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.random.get_number().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_get_number(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    return push_random_number(l, Random::get_stream(Random::Subsystem::SCRIPTS), 1);
+  });
+}
+
+/**
+ * \brief Implementation of sol.random.get_real().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_get_real(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushnumber(l, Random::get_stream(Random::Subsystem::SCRIPTS).get_real());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of random_stream:get_seed().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_stream_get_seed(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const RandomStream& random_stream = *check_random_stream(l, 1);
+
+    lua_pushnumber(l, static_cast<double>(random_stream.get_seed()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of random_stream:set_seed().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_stream_set_seed(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    RandomStream& random_stream = *check_random_stream(l, 1);
+    const uint32_t seed = static_cast<uint32_t>(LuaTools::check_int(l, 2));
+
+    random_stream.set_seed(seed);
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of random_stream:get_number().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_stream_get_number(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    RandomStream& random_stream = *check_random_stream(l, 1);
+
+    return push_random_number(l, random_stream, 2);
+  });
+}
+
+/**
+ * \brief Implementation of random_stream:get_real().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_stream_get_real(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    RandomStream& random_stream = *check_random_stream(l, 1);
+
+    lua_pushnumber(l, random_stream.get_real());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of random_stream:get_numbers().
+ *
+ * Returns an array of random integers in [1, m] or [m, n],
+ * or of random reals in [0, 1[ if no bound is given.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::random_api_stream_get_numbers(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    RandomStream& random_stream = *check_random_stream(l, 1);
+    const int count = LuaTools::check_int(l, 2);
+    if (count < 0) {
+      LuaTools::arg_error(l, 2, "Count must be positive or zero");
+    }
+
+    lua_createtable(l, count, 0);
+    if (lua_isnoneornil(l, 3)) {
+      std::vector<double> reals(count);
+      random_stream.get_reals(reals.data(), reals.size());
+      for (int i = 0; i < count; ++i) {
+        lua_pushnumber(l, reals[i]);
+        lua_rawseti(l, -2, i + 1);
+      }
+      return 1;
+    }
+
+    int min = 1;
+    int max = LuaTools::check_int(l, 3);
+    if (!lua_isnoneornil(l, 4)) {
+      min = max;
+      max = LuaTools::check_int(l, 4);
+    }
+    if (max < min) {
+      LuaTools::arg_error(l, 3, "Interval is empty");
+    }
+    std::vector<int> numbers(count);
+    random_stream.get_numbers(numbers.data(), numbers.size(), min, max + 1);
+    for (int i = 0; i < count; ++i) {
+      lua_pushinteger(l, numbers[i]);
+      lua_rawseti(l, -2, i + 1);
+    }
+    return 1;
+  });
+}
+
+}
@@ -15,6 +15,9 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/QuestDatabase.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/graphics/Shader.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
@@ -42,6 +45,7 @@ void LuaContext::register_shader_module() {
       { "create", shader_api_create },
       { "get_opengl_version", shader_api_get_opengl_version },
       { "get_shading_language_version", shader_api_get_shading_language_version },
+      { "preload", shader_api_preload },
   };
 
   // Methods of the shader type.
@@ -53,6 +57,7 @@ void LuaContext::register_shader_module() {
       { "get_fragment_source", shader_api_get_fragment_source },
       { "get_scaling_factor", shader_api_get_scaling_factor },
       { "set_scaling_factor", shader_api_set_scaling_factor },
+      { "get_uniform_handle", shader_api_get_uniform_handle },
       { "set_uniform", shader_api_set_uniform },
   };
 
@@ -167,6 +172,39 @@ int LuaContext::shader_api_get_shading_language_version(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.shader.preload().
+ *
+ * Without parameter, all shaders of the quest database are preloaded.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::shader_api_preload(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    ResourceProvider& resource_provider = get().get_main_loop().get_resource_provider();
+    if (lua_isnoneornil(l, 1)) {
+      const QuestDatabase::ResourceMap& shader_ids =
+          CurrentQuest::get_database().get_resource_elements(ResourceType::SHADER);
+      for (const auto& kvp : shader_ids) {
+        resource_provider.preload(ResourceType::SHADER, kvp.first);
+      }
+      return 0;
+    }
+
+    const std::string& shader_id = LuaTools::check_string(l, 1);
+    if (!CurrentQuest::resource_exists(ResourceType::SHADER, shader_id)) {
+      LuaTools::arg_error(l, 1, std::string("No such shader: '") + shader_id + "'");
+    }
+    resource_provider.preload(
+          ResourceType::SHADER, shader_id, ResourceProvider::PreloadPriority::HIGH
+    );
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of shader:get_id().
  * \param l The Lua context that is calling this function.
@@ -312,8 +350,29 @@ int LuaContext::shader_api_set_scaling_factor(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of shader:get_uniform_handle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::shader_api_get_uniform_handle(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    Shader& shader = *check_shader(l, 1);
+    const std::string& uniform_name = LuaTools::check_string(l, 2);
+
+    lua_pushinteger(l, shader.get_uniform_handle(uniform_name));
+    return 1;
+  });
+}
+
 /**
  * \brief Implementation of shader:set_uniform().
+ *
+ * The uniform is either a name or a handle returned by
+ * shader:get_uniform_handle().
+ *
  * \param l The Lua context that is calling this function.
  * \return Number of values to return to Lua.
  */
@@ -322,17 +381,26 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
   return state_boundary_handle(l, [&] {
 
     Shader& shader = *check_shader(l, 1);
-    const std::string& uniform_name = LuaTools::check_string(l, 2);
+    int handle = 0;
+    if (lua_type(l, 2) == LUA_TNUMBER) {
+      handle = LuaTools::check_int(l, 2);
+      if (!shader.is_uniform_handle(handle)) {
+        LuaTools::arg_error(l, 2, "Invalid uniform handle");
+      }
+    }
+    else {
+      handle = shader.get_uniform_handle(LuaTools::check_string(l, 2));
+    }
 
     if (lua_isboolean(l, 3)) {
       // Boolean.
       const bool value = lua_toboolean(l, 3);
-      shader.set_uniform_1b(uniform_name, value);
+      shader.set_uniform_1b(handle, value);
     }
     else if (lua_isnumber(l, 3)) {
       // Number.
       const float value = static_cast<float>(lua_tonumber(l, 3));
-      shader.set_uniform_1f(uniform_name, value);
+      shader.set_uniform_1f(handle, value);
     }
     else if (lua_istable(l, 3)) {
       // Table of 2, 3 or 4 numbers.
@@ -353,7 +421,7 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
       lua_rawgeti(l, 3, 3);
       if (lua_isnil(l, -1)) {
         // 2 numbers.
-        shader.set_uniform_2f(uniform_name, value_1, value_2);
+        shader.set_uniform_2f(handle, value_1, value_2);
         return 0;
       }
 
@@ -365,7 +433,7 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
       lua_rawgeti(l, 3, 4);
       if (lua_isnil(l, -1)) {
         // 3 numbers.
-        shader.set_uniform_3f(uniform_name, value_1, value_2, value_3);
+        shader.set_uniform_3f(handle, value_1, value_2, value_3);
         return 0;
       }
 
@@ -374,12 +442,12 @@ int LuaContext::shader_api_set_uniform(lua_State* l) {
         LuaTools::arg_error(l, 3, table_error_message);
       }
       const float value_4 = static_cast<float>(LuaTools::check_number(l, -1));
-      shader.set_uniform_4f(uniform_name, value_1, value_2, value_3, value_4);
+      shader.set_uniform_4f(handle, value_1, value_2, value_3, value_4);
     }
     else if (is_surface(l, 3)) {
       // Surface.
       const SurfacePtr& value = check_surface(l, 3);
-      bool success = shader.set_uniform_texture(uniform_name, value);
+      bool success = shader.set_uniform_texture(handle, value);
       if (!success) {
         LuaTools::arg_error(l, 3, "Cannot use this surface in a shader");
       }
@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/System.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/SpriteAnimationSet.h"
 #include "solarus/graphics/SpriteAnimation.h"
@@ -87,6 +88,10 @@ void LuaContext::register_sprite_module() {
       { "get_scale", drawable_api_get_scale },
       { "set_transformation_origin", drawable_api_set_transformation_origin },
       { "get_transformation_origin", drawable_api_get_transformation_origin },
+      { "get_animation_lod", sprite_api_get_animation_lod },
+      { "set_animation_lod", sprite_api_set_animation_lod },
+      { "get_palette", sprite_api_get_palette },
+      { "set_palette", sprite_api_set_palette },
     });
   }
 
@@ -218,14 +223,16 @@ int LuaContext::sprite_api_set_animation(lua_State* l) {
       callback_ref = LuaTools::create_ref(l, 3);
     }
 
-    if (!sprite.has_animation(animation_name)) {
+    // Only names of existing animations are interned.
+    const Symbol& animation_symbol = Symbol::find(animation_name);
+    if (!sprite.has_animation(animation_symbol)) {
       LuaTools::arg_error(l, 2,
           std::string("Animation '") + animation_name
           + "' does not exist in sprite '" + sprite.get_animation_set_id() + "'"
       );
     }
 
-    sprite.set_current_animation(animation_name);
+    sprite.set_current_animation(animation_symbol);
     sprite.set_finished_callback(callback_ref);
     sprite.restart_animation();
 
@@ -335,7 +342,13 @@ int LuaContext::sprite_api_get_num_directions(lua_State* l) {
 int LuaContext::sprite_api_get_frame(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
-    const Sprite& sprite = *check_sprite(l, 1);
+    Sprite& sprite = *check_sprite(l, 1);
+
+    // The frame of an off-screen lazy sprite may be late.
+    const uint32_t now = System::now();
+    if (sprite.is_update_deferred() && sprite.is_frame_advance_native(now)) {
+      sprite.advance_frames(now);
+    }
 
     lua_pushinteger(l, sprite.get_current_frame());
     return 1;
@@ -676,6 +689,84 @@ int LuaContext::sprite_api_synchronize(lua_State *l) {
   });
 }
 
+/**
+ * \brief Implementation of sprite:get_animation_lod().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::sprite_api_get_animation_lod(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Sprite& sprite = *check_sprite(l, 1);
+
+    push_interned_string(l, enum_to_name(sprite.get_animation_lod()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sprite:set_animation_lod().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::sprite_api_set_animation_lod(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Sprite& sprite = *check_sprite(l, 1);
+    AnimationLod animation_lod = LuaTools::check_enum<AnimationLod>(l, 2);
+
+    sprite.set_animation_lod(animation_lod);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sprite:get_palette().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::sprite_api_get_palette(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const Sprite& sprite = *check_sprite(l, 1);
+
+    const SurfacePtr& palette = sprite.get_palette();
+    if (palette != nullptr) {
+      push_surface(l, *palette);
+    }
+    else {
+      lua_pushnil(l);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sprite:set_palette().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::sprite_api_set_palette(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Sprite& sprite = *check_sprite(l, 1);
+    SurfacePtr palette = nullptr;
+    if (!lua_isnil(l, 2)) {
+      if (is_surface(l, 2)) {
+        palette = check_surface(l, 2);
+      }
+      else {
+        LuaTools::type_error(l, 2, "surface or nil");
+      }
+    }
+
+    sprite.set_palette(palette);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Calls the on_animation_finished() method of a Lua sprite.
  *
@@ -745,6 +836,7 @@ void LuaContext::sprite_on_direction_changed(Sprite& sprite,
  * \brief Calls the on_frame_changed() method of a Lua sprite.
  *
  * Does nothing if the method is not defined.
+ * The event is also collected for sol.main.set_event_batch_handler() if set.
  *
  * \param sprite A sprite whose frame has just changed.
  * \param animation Name of the current animation.
@@ -753,6 +845,15 @@ void LuaContext::sprite_on_direction_changed(Sprite& sprite,
 void LuaContext::sprite_on_frame_changed(Sprite& sprite,
     const std::string& animation, int frame) {
 
+  EventBatch* batch = get_event_batch(BatchedEventType::FRAME_CHANGED);
+  if (batch != nullptr) {
+    BatchedEvent event;
+    event.object = sprite.shared_from_this();
+    event.animation = animation;
+    event.value = frame;
+    batch->events.push_back(std::move(event));
+  }
+
   if (!userdata_has_field(sprite, "on_frame_changed")) {
     return;
   }
@@ -763,5 +864,19 @@ void LuaContext::sprite_on_frame_changed(Sprite& sprite,
   });
 }
 
+/**
+ * \brief Returns whether frame changes of a sprite are observed from Lua.
+ *
+ * This is the case if the sprite has an on_frame_changed() method
+ * or if frame changes are collected for sol.main.set_event_batch_handler().
+ *
+ * \param sprite A sprite.
+ * \return \c true if sprite_on_frame_changed() has something to do.
+ */
+bool LuaContext::is_sprite_frame_change_observed(const Sprite& sprite) {
+
+  return get_event_batch(BatchedEventType::FRAME_CHANGED) != nullptr ||
+      userdata_has_field(sprite, "on_frame_changed");
 }
 
+}
@@ -549,11 +549,12 @@ int LuaContext::state_api_set_can_traverse(lua_State* l) {
     else if (lua_isfunction(l, index)) {
       // Custom boolean function.
       const ScopedLuaRef& traversable_test_ref = LuaTools::check_function(l, index);
+      const bool pure = LuaTools::opt_boolean(l, index + 1, false);
       if (!type_specific) {
-        state.set_can_traverse_entities(traversable_test_ref);
+        state.set_can_traverse_entities(traversable_test_ref, pure);
       }
       else {
-        state.set_can_traverse_entities(type, traversable_test_ref);
+        state.set_can_traverse_entities(type, traversable_test_ref, pure);
       }
     }
     else {
@@ -1267,7 +1268,7 @@ int LuaContext::state_api_get_carried_object_action(lua_State* l) {
     const CustomState& state = *check_state(l, 1);
 
     CarriedObject::Behavior behavior = state.get_previous_carried_object_behavior();
-    push_string(l, enum_to_name(behavior));
+    push_interned_string(l, enum_to_name(behavior));
     return 1;
   });
 }
@@ -1331,6 +1332,7 @@ void LuaContext::state_on_finished(
       on_finished(next_state_name, next_state);
     }
     remove_timers(-1);  // Stop timers associated to this state.
+    remove_tasks(-1);
     lua_pop(current_l, 1);
   });
 }
@@ -1344,7 +1346,7 @@ void LuaContext::state_on_finished(
  */
 void LuaContext::state_on_update(CustomState& state) {
 
-  if (!userdata_has_field(state, "on_update")) {
+  if (!userdata_has_field(state, LuaEvent::ON_UPDATE)) {
     return;
   }
 
@@ -1365,7 +1367,7 @@ void LuaContext::state_on_update(CustomState& state) {
  */
 void LuaContext::state_on_suspended(CustomState& state, bool suspended) {
 
-  if (!userdata_has_field(state, "on_suspended")) {
+  if (!userdata_has_field(state, LuaEvent::ON_SUSPENDED)) {
     return;
   }
   run_on_main([this, &state, suspended](lua_State* l) {
@@ -1385,7 +1387,7 @@ void LuaContext::state_on_suspended(CustomState& state, bool suspended) {
  */
 void LuaContext::state_on_pre_draw(CustomState& state, Camera& camera) {
 
-  if (!userdata_has_field(state, "on_pre_draw")) {
+  if (!userdata_has_field(state, LuaEvent::ON_PRE_DRAW)) {
     return;
   }
   run_on_main([this, &state, &camera](lua_State* l) {
@@ -1405,7 +1407,7 @@ void LuaContext::state_on_pre_draw(CustomState& state, Camera& camera) {
  */
 void LuaContext::state_on_post_draw(CustomState& state, Camera& camera) {
 
-  if (!userdata_has_field(state, "on_post_draw")) {
+  if (!userdata_has_field(state, LuaEvent::ON_POST_DRAW)) {
     return;
   }
   run_on_main([this, &state, &camera](lua_State* l) {
@@ -1489,7 +1491,7 @@ void LuaContext::state_on_map_finished(CustomState& state) {
  */
 void LuaContext::state_on_position_changed(CustomState& state, const Point& xy, int layer) {
 
-  if (!userdata_has_field(state, "on_position_changed")) {
+  if (!userdata_has_field(state, LuaEvent::ON_POSITION_CHANGED)) {
     return;
   }
   run_on_main([this, &state, xy, layer](lua_State* l) {
@@ -1571,7 +1573,7 @@ void LuaContext::state_on_movement_started(CustomState& state, Movement& movemen
  */
 void LuaContext::state_on_movement_changed(CustomState& state, Movement& movement) {
 
-  if (!userdata_has_field(state, "on_movement_changed")) {
+  if (!userdata_has_field(state, LuaEvent::ON_MOVEMENT_CHANGED)) {
     return;
   }
 
@@ -66,6 +66,7 @@ void LuaContext::register_surface_module() {
       { "set_color_modulation", drawable_api_set_color_modulation },
       { "get_color_modulation", drawable_api_get_color_modulation },
       { "set_pixels", surface_api_set_pixels },
+      { "get_pixels_async", surface_api_get_pixels_async },
       { "set_shader", drawable_api_set_shader },
       { "get_shader", drawable_api_get_shader },
       { "set_rotation", drawable_api_set_rotation },
@@ -75,7 +76,9 @@ void LuaContext::register_surface_module() {
       { "set_transformation_origin", drawable_api_set_transformation_origin },
       { "get_transformation_origin", drawable_api_get_transformation_origin },
       { "gl_bind_as_texture", surface_api_gl_bind_as_texture},
-      { "gl_bind_as_target", surface_api_gl_bind_as_target}
+      { "gl_bind_as_target", surface_api_gl_bind_as_target},
+      { "draw_line", surface_api_draw_line },
+      { "draw_rectangle", surface_api_draw_rectangle }
     });
   }
 
@@ -221,6 +224,48 @@ int LuaContext::surface_api_fill_color(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of surface:draw_line().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::surface_api_draw_line(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Surface& surface = *check_surface(l, 1);
+    Color color = LuaTools::check_color(l, 2);
+    int x1 = LuaTools::check_int(l, 3);
+    int y1 = LuaTools::check_int(l, 4);
+    int x2 = LuaTools::check_int(l, 5);
+    int y2 = LuaTools::check_int(l, 6);
+
+    surface.draw_line(color, Point(x1, y1), Point(x2, y2));
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of surface:draw_rectangle().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::surface_api_draw_rectangle(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Surface& surface = *check_surface(l, 1);
+    Color color = LuaTools::check_color(l, 2);
+    int x = LuaTools::check_int(l, 3);
+    int y = LuaTools::check_int(l, 4);
+    int width = LuaTools::check_int(l, 5);
+    int height = LuaTools::check_int(l, 6);
+
+    surface.draw_rectangle(color, Rectangle(x, y, width, height));
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of surface:get_pixels().
  * \param l The Lua context that is calling this function.
@@ -237,6 +282,28 @@ int LuaContext::surface_api_get_pixels(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of surface:get_pixels_async().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::surface_api_get_pixels_async(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    Surface& surface = *check_surface(l, 1);
+    const ScopedLuaRef& callback_ref = LuaTools::check_function(l, 2);
+
+    surface.get_pixels_async([callback_ref](const std::string& pixels) {
+      LuaContext& lua_context = LuaContext::get();
+      lua_State* current_l = lua_context.get_internal_state();
+      push_ref(current_l, callback_ref);
+      push_string(current_l, pixels);
+      lua_context.call_function(1, 0, "surface pixels callback");
+    });
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of surface:set_pixels().
  * \param l The Lua context that is calling this function.
@@ -0,0 +1,572 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/Game.h"
+#include "solarus/core/MainLoop.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/Savegame.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include "solarus/movements/Movement.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * Name of the Lua table representing the task module.
+ */
+const std::string LuaContext::task_module_name = "sol.task";
+
+/**
+ * \brief Initializes the task features provided to Lua.
+ *
+ * Tasks are coroutines resumed by the engine when what they wait for
+ * happens. Like timers, they are attached to a context and stop with it.
+ */
+void LuaContext::register_task_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  // Functions of sol.task.
+  const std::vector<luaL_Reg> functions = {
+      { "start", task_api_start },
+      { "stop", task_api_stop },
+      { "is_running", task_api_is_running },
+      { "wait", task_api_wait },
+      { "wait_frames", task_api_wait_frames },
+      { "wait_movement", task_api_wait_movement },
+      { "wait_animation", task_api_wait_animation },
+      { "wait_dialog", task_api_wait_dialog },
+  };
+  register_functions(task_module_name, functions);
+}
+
+/**
+ * \brief Compares two entries of a task queue.
+ *
+ * Like for timers, the entry to wake up first is the greatest one.
+ *
+ * \param other Another entry.
+ * \return \c true if this entry wakes up after the other one.
+ */
+bool LuaContext::TaskQueueEntry::operator<(const TaskQueueEntry& other) const {
+
+  if (wake_date != other.wake_date) {
+    return wake_date > other.wake_date;
+  }
+  return wait_id > other.wait_id;
+}
+
+/**
+ * \brief Creates a task and runs it until it waits for something.
+ *
+ * The coroutine of the task is pushed onto the stack.
+ *
+ * \param context_index Index of the table or userdata the task is attached to.
+ * \param function_index Index of the function to run,
+ * followed by its arguments.
+ * \param nb_arguments Number of arguments of the function.
+ */
+void LuaContext::start_task(int context_index, int function_index, int nb_arguments) {
+
+  lua_State* l = current_l;
+  lua_State* thread = lua_newthread(l);
+                                  // ... thread
+  int slot = 0;
+  if (free_task_slots.empty()) {
+    slot = static_cast<int>(tasks.size());
+    tasks.emplace_back();
+  }
+  else {
+    slot = free_task_slots.back();
+    free_task_slots.pop_back();
+  }
+
+  LuaTaskData& task = tasks[slot];
+  task.thread_ref = LuaTools::create_ref(l, -1);
+  task.thread = thread;
+  task.context = LuaTools::create_ref(l, context_index);
+  task.wait = TaskWait::NONE;
+  task_slots[thread] = slot;
+
+  for (int i = 0; i <= nb_arguments; ++i) {
+    lua_pushvalue(l, function_index + i);
+  }
+                                  // ... thread function args
+  lua_xmove(l, thread, nb_arguments + 1);
+                                  // ... thread
+  resume_task(slot, nb_arguments);
+}
+
+/**
+ * \brief Resumes the coroutine of a task.
+ *
+ * The task is released when its function returns or raises an error.
+ *
+ * \param slot Index of the task.
+ * \param nb_arguments Number of values on the coroutine stack to give
+ * to the coroutine.
+ */
+void LuaContext::resume_task(int slot, int nb_arguments) {
+
+  LuaTaskData& task = tasks[slot];
+  const ScopedLuaRef thread_ref = task.thread_ref;  // Keep it alive while it runs.
+  lua_State* thread = task.thread;
+  task.wait = TaskWait::NONE;
+  task.movement = nullptr;
+  task.sprite = nullptr;
+  task.game = nullptr;
+
+  lua_State* previous_task = running_task;
+  lua_State* previous_l = current_l;
+  running_task = thread;
+  const int status = lua_resume(thread, nb_arguments);
+  running_task = previous_task;
+  current_l = previous_l;
+
+  if (status != 0 && status != LUA_YIELD) {
+    const char* error = lua_tostring(thread, -1);
+    Debug::error(std::string("In task: ") + (error != nullptr ? error : "unknown error"));
+  }
+
+  if (get_task_slot(thread) != slot) {
+    // Stopped while running.
+    return;
+  }
+
+  if (status != LUA_YIELD) {
+    // Finished.
+    release_task(slot);
+    return;
+  }
+
+  lua_settop(thread, 0);
+  if (tasks[slot].wait == TaskWait::NONE) {
+    // Plain coroutine.yield(): resume it at the next update.
+    schedule_task(slot, TaskWait::FRAMES, task_frame + 1);
+  }
+}
+
+/**
+ * \brief Frees the slot of a task.
+ *
+ * Its coroutine is not resumed anymore.
+ * It may still be running: it then stops at its next wait.
+ *
+ * \param slot Index of the task.
+ */
+void LuaContext::release_task(int slot) {
+
+  LuaTaskData& task = tasks[slot];
+  task_slots.erase(task.thread);
+  task = LuaTaskData();
+  free_task_slots.push_back(slot);
+}
+
+/**
+ * \brief Returns the index of the task running a coroutine.
+ * \param thread A coroutine.
+ * \return The index of its task, or -1 if it is not a task.
+ */
+int LuaContext::get_task_slot(lua_State* thread) const {
+
+  const auto it = task_slots.find(thread);
+  if (it == task_slots.end()) {
+    return -1;
+  }
+  return it->second;
+}
+
+/**
+ * \brief Records what a task waits for.
+ *
+ * Fields specific to the wait (movement, sprite or game) must already be set.
+ *
+ * \param slot Index of the task.
+ * \param wait What to wait for.
+ * \param wake_date Date or update number to wait for, if any.
+ */
+void LuaContext::schedule_task(int slot, TaskWait wait, uint32_t wake_date) {
+
+  LuaTaskData& task = tasks[slot];
+  task.wait = wait;
+  task.wait_id = next_task_wait_id++;
+  task.wake_date = wake_date;
+
+  const TaskQueueEntry entry = { wake_date, task.wait_id, slot };
+  switch (wait) {
+
+  case TaskWait::TIME:
+    task_time_queue.push_back(entry);
+    std::push_heap(task_time_queue.begin(), task_time_queue.end());
+    break;
+
+  case TaskWait::FRAMES:
+    task_frame_queue.push_back(entry);
+    std::push_heap(task_frame_queue.begin(), task_frame_queue.end());
+    break;
+
+  case TaskWait::MOVEMENT:
+  case TaskWait::ANIMATION:
+  case TaskWait::DIALOG:
+    task_event_waits.push_back(entry);
+    break;
+
+  case TaskWait::NONE:
+    break;
+  }
+}
+
+/**
+ * \brief Suspends the running task until something happens.
+ * \param l The coroutine of the task.
+ * \param wait What to wait for.
+ * \param wake_date Date or update number to wait for, if any.
+ * \return The value to return to Lua.
+ */
+int LuaContext::wait_task(lua_State* l, TaskWait wait, uint32_t wake_date) {
+
+  const int slot = get_task_slot(l);
+  if (slot == -1) {
+    if (l == running_task) {
+      // Stopped while running: it will not be resumed.
+      return lua_yield(l, 0);
+    }
+    LuaTools::error(l, "This function can only be called from a task");
+  }
+
+  schedule_task(slot, wait, wake_date);
+  return lua_yield(l, 0);
+}
+
+/**
+ * \brief Stops all tasks associated to a context.
+ *
+ * This function can be called safely from a task, even the one being stopped.
+ *
+ * \param context_index Index of a table or userdata containing tasks.
+ */
+void LuaContext::remove_tasks(int context_index) {
+
+  for (size_t slot = 0; slot < tasks.size(); ++slot) {
+    const LuaTaskData& task = tasks[slot];
+    if (task.thread != nullptr && task.context.equals(current_l, context_index)) {
+      release_task(static_cast<int>(slot));
+    }
+  }
+}
+
+/**
+ * \brief Destroys immediately all existing tasks.
+ */
+void LuaContext::destroy_tasks() {
+
+  tasks.clear();
+  free_task_slots.clear();
+  task_slots.clear();
+  task_time_queue.clear();
+  task_frame_queue.clear();
+  task_event_waits.clear();
+  tasks_to_resume.clear();
+}
+
+/**
+ * \brief Resumes the tasks whose wait is over.
+ *
+ * Tasks waiting for a date or a number of updates cost nothing until they
+ * wake up. Tasks waiting for a movement, an animation or a dialog are
+ * checked once per update.
+ * Tasks that wait again while being resumed are resumed at the next update
+ * at the earliest.
+ */
+void LuaContext::update_tasks() {
+
+  ++task_frame;
+  if (task_slots.empty()) {
+    task_time_queue.clear();
+    task_frame_queue.clear();
+    task_event_waits.clear();
+    return;
+  }
+
+  const auto is_current = [this](const TaskQueueEntry& entry) {
+    const LuaTaskData& task = tasks[entry.slot];
+    return task.wait != TaskWait::NONE && task.wait_id == entry.wait_id;
+  };
+
+  const uint32_t now = System::now();
+  while (!task_time_queue.empty() && task_time_queue.front().wake_date <= now) {
+    std::pop_heap(task_time_queue.begin(), task_time_queue.end());
+    tasks_to_resume.push_back(task_time_queue.back());
+    task_time_queue.pop_back();
+  }
+
+  while (!task_frame_queue.empty() && task_frame_queue.front().wake_date <= task_frame) {
+    std::pop_heap(task_frame_queue.begin(), task_frame_queue.end());
+    tasks_to_resume.push_back(task_frame_queue.back());
+    task_frame_queue.pop_back();
+  }
+
+  size_t num_kept = 0;
+  for (const TaskQueueEntry& entry : task_event_waits) {
+    if (!is_current(entry)) {
+      continue;
+    }
+    const LuaTaskData& task = tasks[entry.slot];
+    bool over = false;
+    switch (task.wait) {
+
+    case TaskWait::MOVEMENT:
+      over = task.movement->is_finished();
+      break;
+
+    case TaskWait::ANIMATION:
+      over = task.sprite->is_animation_finished();
+      break;
+
+    case TaskWait::DIALOG:
+      over = task.game->get_game() == nullptr ||
+          !task.game->get_game()->is_dialog_enabled();
+      break;
+
+    default:
+      break;
+    }
+
+    if (over) {
+      tasks_to_resume.push_back(entry);
+    }
+    else {
+      task_event_waits[num_kept++] = entry;
+    }
+  }
+  task_event_waits.resize(num_kept);
+
+  // Tasks resumed may stop other ones: check each entry again.
+  for (size_t i = 0; i < tasks_to_resume.size(); ++i) {
+    const TaskQueueEntry entry = tasks_to_resume[i];
+    if (is_current(entry)) {
+      resume_task(entry.slot, 0);
+    }
+  }
+  tasks_to_resume.clear();
+
+  // Don't let entries of stopped tasks accumulate.
+  if (task_time_queue.size() > 2 * task_slots.size() + 64) {
+    task_time_queue.erase(std::remove_if(task_time_queue.begin(), task_time_queue.end(),
+        [&is_current](const TaskQueueEntry& entry) { return !is_current(entry); }),
+        task_time_queue.end());
+    std::make_heap(task_time_queue.begin(), task_time_queue.end());
+  }
+  if (task_frame_queue.size() > 2 * task_slots.size() + 64) {
+    task_frame_queue.erase(std::remove_if(task_frame_queue.begin(), task_frame_queue.end(),
+        [&is_current](const TaskQueueEntry& entry) { return !is_current(entry); }),
+        task_frame_queue.end());
+    std::make_heap(task_frame_queue.begin(), task_frame_queue.end());
+  }
+}
+
+/**
+ * \brief Implementation of sol.task.start().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_start(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    // Parameters: [context] function args...
+    LuaContext& lua_context = get();
+
+    if (lua_type(l, 1) == LUA_TFUNCTION) {
+      // Same default context as timers:
+      // the current map during a game, sol.main otherwise.
+      Game* game = lua_context.get_main_loop().get_game();
+      if (game != nullptr && game->has_current_map()) {
+        push_map(l, game->get_current_map());
+      }
+      else {
+        push_main(l);
+      }
+      lua_insert(l, 1);
+    }
+    else if (!is_main(l, 1) &&
+        !is_menu(l, 1) &&
+        !is_game(l, 1) &&
+        !is_item(l, 1) &&
+        !is_map(l, 1) &&
+        !is_entity(l, 1) &&
+        !is_state(l, 1)) {
+      LuaTools::type_error(l, 1, "game, item, map, entity, state, menu or sol.main");
+    }
+    // Now the first parameter is the context.
+
+    if (is_entity(l, 1)) {
+      const Entity& entity = *check_entity(l, 1);
+      if (entity.is_being_removed()) {
+        LuaTools::arg_error(l, 1, "Cannot start a task on an entity that was removed");
+      }
+    }
+    LuaTools::check_type(l, 2, LUA_TFUNCTION);
+
+    lua_context.start_task(1, 2, lua_gettop(l) - 2);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.stop().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_stop(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTHREAD);
+    LuaContext& lua_context = get();
+
+    const int slot = lua_context.get_task_slot(lua_tothread(l, 1));
+    if (slot != -1) {
+      lua_context.release_task(slot);
+    }
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.is_running().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_is_running(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    LuaTools::check_type(l, 1, LUA_TTHREAD);
+
+    lua_pushboolean(l, get().get_task_slot(lua_tothread(l, 1)) != -1);
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.wait().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_wait(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const int delay = LuaTools::check_int(l, 1);
+    if (delay < 0) {
+      LuaTools::arg_error(l, 1, "Delay must be positive or zero");
+    }
+
+    return get().wait_task(l, TaskWait::TIME, System::now() + uint32_t(delay));
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.wait_frames().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_wait_frames(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const int num_frames = LuaTools::opt_int(l, 1, 1);
+    if (num_frames < 1) {
+      LuaTools::arg_error(l, 1, "Number of frames must be positive");
+    }
+
+    LuaContext& lua_context = get();
+    return lua_context.wait_task(l, TaskWait::FRAMES,
+        lua_context.task_frame + uint32_t(num_frames));
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.wait_movement().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_wait_movement(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::shared_ptr<Movement>& movement = check_movement(l, 1);
+    LuaContext& lua_context = get();
+
+    if (movement->is_finished()) {
+      return 0;
+    }
+    const int slot = lua_context.get_task_slot(l);
+    if (slot != -1) {
+      lua_context.tasks[slot].movement = movement;
+    }
+    return lua_context.wait_task(l, TaskWait::MOVEMENT, 0);
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.wait_animation().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_wait_animation(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const SpritePtr& sprite = check_sprite(l, 1);
+    LuaContext& lua_context = get();
+
+    if (sprite->is_animation_finished()) {
+      return 0;
+    }
+    const int slot = lua_context.get_task_slot(l);
+    if (slot != -1) {
+      lua_context.tasks[slot].sprite = sprite;
+    }
+    return lua_context.wait_task(l, TaskWait::ANIMATION, 0);
+  });
+}
+
+/**
+ * \brief Implementation of sol.task.wait_dialog().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::task_api_wait_dialog(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::shared_ptr<Savegame>& game = check_game(l, 1);
+    LuaContext& lua_context = get();
+
+    if (game->get_game() == nullptr || !game->get_game()->is_dialog_enabled()) {
+      return 0;
+    }
+    const int slot = lua_context.get_task_slot(l);
+    if (slot != -1) {
+      lua_context.tasks[slot].game = game;
+    }
+    return lua_context.wait_task(l, TaskWait::DIALOG, 0);
+  });
+}
+
+}
@@ -117,6 +117,8 @@ void LuaContext::register_text_surface_module() {
       { "get_scale", drawable_api_get_scale },
       { "set_transformation_origin", drawable_api_set_transformation_origin },
       { "get_transformation_origin", drawable_api_get_transformation_origin },
+      { "get_visible_characters", text_surface_api_get_visible_characters },
+      { "set_visible_characters", text_surface_api_set_visible_characters },
     });
 
     functions.insert(functions.end(),{
@@ -545,6 +547,49 @@ int LuaContext::text_surface_api_set_text_key(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of text_surface:get_visible_characters().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::text_surface_api_get_visible_characters(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const TextSurface& text_surface = *check_text_surface(l, 1);
+
+    const int visible_characters = text_surface.get_visible_characters();
+    if (visible_characters < 0) {
+      lua_pushnil(l);
+    }
+    else {
+      lua_pushinteger(l, visible_characters);
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of text_surface:set_visible_characters().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::text_surface_api_set_visible_characters(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    TextSurface& text_surface = *check_text_surface(l, 1);
+    int visible_characters = -1;
+    if (!lua_isnoneornil(l, 2)) {
+      visible_characters = LuaTools::check_int(l, 2);
+      if (visible_characters < 0) {
+        LuaTools::arg_error(l, 2, "The number of visible characters cannot be negative");
+      }
+    }
+    text_surface.set_visible_characters(visible_characters);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Implementation of text_surface:get_size().
  * \param l the Lua context that is calling this function
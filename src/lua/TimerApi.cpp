@@ -25,6 +25,7 @@
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <algorithm>
 #include <list>
 #include <sstream>
 
@@ -128,8 +129,10 @@ void LuaContext::add_timer(
   Debug::check_assertion(timers.find(timer) == timers.end(),
       "Duplicate timer in the system");
 
-  timers[timer].callback_ref = callback_ref;
-  timers[timer].context = context;
+  LuaTimerData& data = timers[timer];
+  data.callback_ref = callback_ref;
+  data.context = context;
+  data.order = next_timer_order++;
 
   Game* game = main_loop.get_game();
   if (game != nullptr) {
@@ -171,6 +174,70 @@ void LuaContext::add_timer(
       timer->set_suspended(initially_suspended);
     }
   }
+
+  schedule_timer(timer);
+}
+
+/**
+ * \brief Compares two entries of the timer queue.
+ *
+ * The heap functions of the standard library put the greatest element on top,
+ * so the entry that expires first is the greatest one.
+ *
+ * \param other Another entry.
+ * \return \c true if this entry expires after the other one.
+ */
+bool LuaContext::TimerQueueEntry::operator<(const TimerQueueEntry& other) const {
+
+  if (expiration_date != other.expiration_date) {
+    return expiration_date > other.expiration_date;
+  }
+  return order > other.order;
+}
+
+/**
+ * \brief Pushes a timer in the timer queue at its current expiration date.
+ *
+ * Does nothing if the timer is not registered, is suspended or is already
+ * scheduled at this date.
+ * Suspended timers are scheduled again when they are resumed.
+ *
+ * \param timer A timer.
+ */
+void LuaContext::schedule_timer(const TimerPtr& timer) {
+
+  const auto it = timers.find(timer);
+  if (it == timers.end() ||
+      it->second.callback_ref.is_empty() ||
+      timer->is_suspended()) {
+    return;
+  }
+
+  LuaTimerData& data = it->second;
+  const uint32_t expiration_date = timer->get_expiration_date();
+  if (data.scheduled && data.scheduled_date == expiration_date) {
+    return;
+  }
+
+  data.scheduled = true;
+  data.scheduled_date = expiration_date;
+  timer_queue.push_back({ expiration_date, data.order, timer });
+  std::push_heap(timer_queue.begin(), timer_queue.end());
+}
+
+/**
+ * \brief Rebuilds the timer queue without its outdated entries.
+ */
+void LuaContext::compact_timer_queue() {
+
+  timer_queue.clear();
+  for (const auto& kvp: timers) {
+    const LuaTimerData& data = kvp.second;
+    if (data.scheduled) {
+      timer_queue.push_back({ data.scheduled_date, data.order, kvp.first });
+    }
+  }
+  std::make_heap(timer_queue.begin(), timer_queue.end());
 }
 
 /**
@@ -210,24 +277,64 @@ void LuaContext::remove_timers(int context_index) {
  */
 void LuaContext::destroy_timers() {
   timers.clear();
+  timers_to_remove.clear();
+  timers_with_sound.clear();
+  timer_queue.clear();
 }
 
 /**
- * \brief Updates all timers currently running for this script.
+ * \brief Updates the timers currently running for this script.
+ *
+ * Only the timers that expire are visited, in the order of their expiration
+ * dates, and then of their creation for equal dates.
+ * Timers with a clock sound are also updated to play it.
  */
 void LuaContext::update_timers() {
 
-  // Update all timers.
-  for (const auto& kvp: timers) {
-
-    const TimerPtr& timer = kvp.first;
-    const ScopedLuaRef& callback_ref = kvp.second.callback_ref;
-    if (!callback_ref.is_empty()) {
-      // The timer is not being removed: update it.
+  // Play the clock sounds.
+  for (const TimerPtr& timer: timers_with_sound) {
+    const auto it = timers.find(timer);
+    if (it != timers.end() && !it->second.callback_ref.is_empty()) {
       timer->update();
-      if (timer->is_finished()) {
-        do_timer_callback(timer);
-      }
+    }
+  }
+
+  // Call the timers that expire.
+  const uint32_t now = System::now();
+  while (!timer_queue.empty() &&
+         timer_queue.front().expiration_date <= now) {
+
+    std::pop_heap(timer_queue.begin(), timer_queue.end());
+    TimerQueueEntry entry = std::move(timer_queue.back());
+    timer_queue.pop_back();
+
+    const TimerPtr timer = entry.timer.lock();
+    if (timer == nullptr) {
+      continue;
+    }
+    const auto it = timers.find(timer);
+    if (it == timers.end() ||
+        it->second.callback_ref.is_empty() ||
+        !it->second.scheduled ||
+        it->second.scheduled_date != entry.expiration_date) {
+      // Removed or rescheduled since this entry was pushed.
+      continue;
+    }
+
+    it->second.scheduled = false;
+    if (timer->is_suspended()) {
+      // Scheduled again when resumed.
+      continue;
+    }
+    if (timer->get_expiration_date() > now) {
+      // Delayed by a suspension.
+      schedule_timer(timer);
+      continue;
+    }
+
+    timer->update();
+    if (timer->is_finished()) {
+      do_timer_callback(timer);
     }
   }
 
@@ -238,11 +345,17 @@ void LuaContext::update_timers() {
     if (it != timers.end()) {
       timers.erase(it);
 
-      Debug::check_assertion(timers.find(timer) == timers.end(),
+      SOLARUS_ASSERT(timers.find(timer) == timers.end(),
           "Failed to remove timer");
     }
+    timers_with_sound.erase(timer);
   }
   timers_to_remove.clear();
+
+  // Don't let entries of stopped or rescheduled timers accumulate.
+  if (timer_queue.size() > 2 * timers.size() + 64) {
+    compact_timer_queue();
+  }
 }
 
 /**
@@ -262,6 +375,7 @@ void LuaContext::notify_timers_map_suspended(bool suspended) {
     }
     if (timer->is_suspended_with_map()) {
       timer->set_suspended(suspended);
+      schedule_timer(timer);
     }
     lua_pop(current_l, 1);
   }
@@ -286,6 +400,7 @@ void LuaContext::set_entity_timers_suspended_as_map(
 
       if (!suspended) {
         timer->set_suspended(false);
+        schedule_timer(timer);
       }
       else {
         // Suspend timers except the ones that ignore the map being suspended.
@@ -351,6 +466,9 @@ void LuaContext::do_timer_callback(const TimerPtr& timer) {
           // the main loop stepsize.
           do_timer_callback(timer);
         }
+        else {
+          schedule_timer(timer);
+        }
       }
       else {
         callback_ref.clear();
@@ -504,10 +622,17 @@ int LuaContext::timer_api_is_with_sound(lua_State* l) {
 int LuaContext::timer_api_set_with_sound(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
+    LuaContext& lua_context = get();
     const TimerPtr& timer = check_timer(l, 1);
     bool with_sound = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_with_sound(with_sound);
+    if (with_sound && lua_context.timers.find(timer) != lua_context.timers.end()) {
+      lua_context.timers_with_sound.insert(timer);
+    }
+    else {
+      lua_context.timers_with_sound.erase(timer);
+    }
 
     return 0;
   });
@@ -540,6 +665,7 @@ int LuaContext::timer_api_set_suspended(lua_State* l) {
     bool suspended = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_suspended(suspended);
+    get().schedule_timer(timer);
 
     return 0;
   });
@@ -582,6 +708,7 @@ int LuaContext::timer_api_set_suspended_with_map(lua_State* l) {
       // If the game is running, suspend/resume the timer like the map.
       timer->set_suspended(game->get_current_map().is_suspended());
     }
+    lua_context.schedule_timer(timer);
 
     return 0;
   });
@@ -638,6 +765,9 @@ int LuaContext::timer_api_set_remaining_time(lua_State* l) {
         // Execute the callback now.
         lua_context.do_timer_callback(timer);
       }
+      else {
+        lua_context.schedule_timer(timer);
+      }
     }
 
     return 0;
@@ -15,9 +15,13 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/CurrentQuest.h"
+#include "solarus/core/QuestFiles.h"
 #include "solarus/core/Size.h"
+#include "solarus/graphics/FrameRecorder.h"
 #include "solarus/graphics/SoftwareVideoMode.h"
+#include "solarus/graphics/Transition.h"
 #include "solarus/graphics/Video.h"
+#include "solarus/graphics/VsyncModeInfo.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
@@ -55,6 +59,19 @@ void LuaContext::register_video_module() {
     functions.insert(functions.end(), {
       { "get_shader", video_api_get_shader },
       { "set_shader", video_api_set_shader},
+      { "get_shader_resolution_bounds", video_api_get_shader_resolution_bounds },
+      { "set_shader_resolution_bounds", video_api_set_shader_resolution_bounds },
+      { "get_shader_resolution", video_api_get_shader_resolution },
+      { "get_post_effects", video_api_get_post_effects },
+      { "set_post_effects", video_api_set_post_effects },
+      { "get_transition_effect", video_api_get_transition_effect },
+      { "set_transition_effect", video_api_set_transition_effect },
+      { "get_vsync_mode", video_api_get_vsync_mode },
+      { "set_vsync_mode", video_api_set_vsync_mode },
+      { "get_present_jitter", video_api_get_present_jitter },
+      { "start_recording", video_api_start_recording },
+      { "stop_recording", video_api_stop_recording },
+      { "is_recording", video_api_is_recording },
     });
   }
   register_functions(video_module_name, functions);
@@ -416,6 +433,177 @@ int LuaContext::video_api_set_shader(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of sol.video.get_shader_resolution_bounds().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_shader_resolution_bounds(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    double min_resolution = 1.0;
+    double max_resolution = 1.0;
+    Video::get_shader_resolution_bounds(min_resolution, max_resolution);
+    lua_pushnumber(l, min_resolution);
+    lua_pushnumber(l, max_resolution);
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.set_shader_resolution_bounds().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_set_shader_resolution_bounds(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const double min_resolution = LuaTools::check_number(l, 1);
+    const double max_resolution = LuaTools::opt_number(l, 2, 1.0);
+
+    if (min_resolution <= 0.0 || min_resolution > 1.0) {
+      LuaTools::arg_error(l, 1, "Minimum resolution must be in ]0, 1]");
+    }
+    if (max_resolution < min_resolution || max_resolution > 1.0) {
+      LuaTools::arg_error(l, 2, "Maximum resolution must be in [minimum, 1]");
+    }
+
+    Video::set_shader_resolution_bounds(min_resolution, max_resolution);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.get_shader_resolution().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_shader_resolution(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushnumber(l, Video::get_shader_resolution());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.get_post_effects().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_post_effects(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    const std::vector<ShaderPtr>& shaders = Video::get_post_effects();
+
+    lua_createtable(l, shaders.size(), 0);
+    int i = 1;
+    for (const ShaderPtr& shader : shaders) {
+      push_shader(l, *shader);
+      lua_rawseti(l, -2, i);
+      ++i;
+    }
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.set_post_effects().
+ * \param l the Lua context that is calling this function
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::video_api_set_post_effects(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    std::vector<ShaderPtr> shaders;
+    if (!lua_isnil(l, 1)) {
+      LuaTools::check_type(l, 1, LUA_TTABLE);
+      const int num_shaders = static_cast<int>(lua_objlen(l, 1));
+      for (int i = 1; i <= num_shaders; ++i) {
+        lua_rawgeti(l, 1, i);
+        const int index = lua_gettop(l);
+        if (!is_shader(l, index)) {
+          LuaTools::arg_error(l, 1, "Post-processing effect " + std::to_string(i) + " is not a shader");
+        }
+        shaders.push_back(check_shader(l, index));
+        lua_pop(l, 1);
+      }
+    }
+
+    Video::set_post_effects(shaders);
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.get_transition_effect().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_transition_effect(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    const std::string& effect_name = LuaTools::check_string(l, 1);
+
+    const Transition::Effect* effect = Transition::get_effect(effect_name);
+    if (effect == nullptr) {
+      lua_pushnil(l);
+      return 1;
+    }
+    push_shader(l, *effect->shader);
+    lua_pushinteger(l, effect->closing_duration);
+    lua_pushinteger(l, effect->opening_duration);
+    return 3;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.set_transition_effect().
+ * \param l the Lua context that is calling this function
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::video_api_set_transition_effect(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+
+    const std::string& effect_name = LuaTools::check_string(l, 1);
+    bool is_style = false;
+    name_to_enum(effect_name, Transition::Style::IMMEDIATE, is_style);
+    if (is_style) {
+      LuaTools::arg_error(l, 1, "'" + effect_name + "' is a built-in transition style");
+    }
+
+    if (lua_isnil(l, 2)) {
+      Transition::remove_effect(effect_name);
+      return 0;
+    }
+
+    const ShaderPtr& shader = check_shader(l, 2);
+    const int closing_duration = LuaTools::opt_int(l, 3, 500);
+    const int opening_duration = LuaTools::opt_int(l, 4, closing_duration);
+    if (closing_duration < 0) {
+      LuaTools::arg_error(l, 3, "Invalid duration: must be positive or zero");
+    }
+    if (opening_duration < 0) {
+      LuaTools::arg_error(l, 4, "Invalid duration: must be positive or zero");
+    }
+
+    Transition::Effect effect;
+    effect.shader = shader;
+    effect.closing_duration = static_cast<uint32_t>(closing_duration);
+    effect.opening_duration = static_cast<uint32_t>(opening_duration);
+
+    Transition::set_effect(effect_name, effect);
+
+    return 0;
+  });
+}
+
 /**
  * \brief Calls sol.video.on_draw() if it exists.
  * \param screen The destination surface representing the screen.
@@ -430,5 +618,98 @@ void LuaContext::video_on_draw(const SurfacePtr &screen) {
   lua_pop(current_l, 1);
 }
 
+/**
+ * \brief Implementation of sol.video.get_vsync_mode().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_vsync_mode(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    push_interned_string(l, enum_to_name(Video::get_vsync_mode()));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.set_vsync_mode().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_set_vsync_mode(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    VsyncMode vsync_mode = LuaTools::check_enum<VsyncMode>(l, 1);
+
+    Video::set_vsync_mode(vsync_mode);
+
+    return 0;
+  });
 }
 
+/**
+ * \brief Implementation of sol.video.get_present_jitter().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_get_present_jitter(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushnumber(l, Video::get_present_jitter());
+    lua_pushnumber(l, Video::get_present_interval());
+    return 2;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.start_recording().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_start_recording(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const std::string& file_name = LuaTools::check_string(l, 1);
+    const int frame_rate = LuaTools::opt_int(l, 2, FrameRecorder::default_frame_rate);
+
+    if (frame_rate <= 0) {
+      LuaTools::arg_error(l, 2, "Frame rate must be positive");
+    }
+    if (QuestFiles::get_quest_write_dir().empty()) {
+      LuaTools::error(l,
+          "Cannot record frames: no write directory was specified in quest.dat");
+    }
+
+    const std::string& path = QuestFiles::get_full_quest_write_dir() + "/" + file_name;
+    lua_pushboolean(l, FrameRecorder::start(path, frame_rate));
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.stop_recording().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_stop_recording(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    FrameRecorder::stop();
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.video.is_recording().
+ * \param l the Lua context that is calling this function
+ * \return number of values to return to Lua
+ */
+int LuaContext::video_api_is_recording(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushboolean(l, FrameRecorder::is_recording());
+    return 1;
+  });
+}
+
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/lua/LuaContext.h"
+#include "solarus/lua/LuaTools.h"
+#include "solarus/lua/LuaWorkers.h"
+#include <lua.hpp>
+#include <string>
+
+namespace Solarus {
+
+/**
+ * Name of the Lua table representing the worker module.
+ */
+const std::string LuaContext::worker_module_name = "sol.worker";
+
+namespace {
+
+/**
+ * \brief Appends a chunk of bytecode produced by lua_dump() to a string.
+ */
+int write_bytecode(lua_State* /* l */, const void* data, size_t size, void* code) {
+  static_cast<std::string*>(code)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+}
+
+/**
+ * \brief Initializes the worker features provided to Lua.
+ */
+void LuaContext::register_worker_module() {
+
+  if (!CurrentQuest::is_format_at_least({ 1, 6 })) {
+    return;
+  }
+
+  // Functions of sol.worker.
+  const std::vector<luaL_Reg> functions = {
+      { "run", worker_api_run },
+      { "get_num_threads", worker_api_get_num_threads },
+  };
+  register_functions(worker_module_name, functions);
+}
+
+/**
+ * \brief Implementation of sol.worker.run().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::worker_api_run(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    std::string code;
+    if (lua_type(l, 1) == LUA_TSTRING) {
+      code = lua_tostring(l, 1);
+    }
+    else if (lua_type(l, 1) == LUA_TFUNCTION) {
+      if (lua_iscfunction(l, 1)) {
+        LuaTools::arg_error(l, 1, "C functions cannot run in workers");
+      }
+      if (lua_getupvalue(l, 1, 1) != nullptr) {
+        lua_pop(l, 1);
+        LuaTools::arg_error(l, 1, "Functions run in workers cannot have upvalues");
+      }
+      lua_pushvalue(l, 1);
+      lua_dump(l, write_bytecode, &code);
+      lua_pop(l, 1);
+    }
+    else {
+      LuaTools::type_error(l, 1, "string or function");
+    }
+
+    std::string message;
+    std::string error;
+    if (!LuaWorkers::serialize(l, 2, message, error)) {
+      LuaTools::arg_error(l, 2, "Invalid message: " + error);
+    }
+    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 3);
+
+    if (callback_ref.is_empty()) {
+      LuaWorkers::run(code, message, nullptr);
+    }
+    else {
+      LuaWorkers::run(code, message, [callback_ref](bool success, const std::string& value) {
+        LuaContext& lua_context = LuaContext::get();
+        lua_State* current_l = lua_context.get_internal_state();
+        push_ref(current_l, callback_ref);
+        if (success && LuaWorkers::deserialize(current_l, value)) {
+          lua_context.call_function(1, 0, "worker callback");
+        }
+        else {
+          lua_pushnil(current_l);
+          push_string(current_l, success ? "Invalid worker result" : value);
+          lua_context.call_function(2, 0, "worker callback");
+        }
+      });
+    }
+
+    return 0;
+  });
+}
+
+/**
+ * \brief Implementation of sol.worker.get_num_threads().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::worker_api_get_num_threads(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    lua_pushinteger(l, LuaWorkers::get_num_threads());
+    return 1;
+  });
+}
+
+}
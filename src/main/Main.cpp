@@ -59,12 +59,52 @@ void print_help(const Arguments& args) {
     << std::endl
     << "  -no-video                     disables displaying"
     << std::endl
+    << "  -headless                     runs as fast as possible without window, audio, input or drawing"
+    << std::endl
+    << "  -max-ticks=N                  stops after N updates of the simulation (default 0: no limit)"
+    << std::endl
+    << "  -random-seed=N                seeds the random number generator with N (default: current time)"
+    << std::endl
+    << "  -record-input=<file>          records input events and the random seed to a file"
+    << std::endl
+    << "  -replay-input=<file>          replays input events recorded with -record-input"
+    << std::endl
+    << "  -state-hash=yes|no            also records a hash of entity positions after each update, to detect when a replay diverges (default no)"
+    << std::endl
     << "  -quest-size=<width>x<height>  sets the size of the drawing area (if compatible with the quest)"
     << std::endl
+    << "  -record-video=<file>          records the frames drawn to a Y4M video, to PNG images if <file> ends with .png, or to the standard input of a command if <file> starts with |"
+    << std::endl
+    << "  -record-video-fps=<fps>       frame rate of the recording (default 60)"
+    << std::endl
     << "  -lua-console=yes|no           accepts standard input lines as Lua commands (default yes)"
     << std::endl
+    << "  -launcher-channel=<file>      exchanges frame statistics and Lua commands with a launcher through a shared file (default none)"
+    << std::endl
+    << "  -hot-reload=yes|no            reloads sprites, tilesets, images, sounds and shaders when their files change (default no)"
+    << std::endl
+    << "  -memory-log-period=<seconds>  logs the memory used by each subsystem every <seconds> seconds (default 0: never)"
+    << std::endl
+    << "  -hitch-threshold=<ms>         logs where the time went in frames longer than <ms> milliseconds (default 50, 0: never)"
+    << std::endl
+    << "  -hitch-log-size=<n>           keeps the last <n> hitches in hitches.log of the quest write directory (default 20)"
+    << std::endl
     << "  -turbo=yes|no                 runs as fast as possible rather than simulating real time (default no)"
     << std::endl
+    << "  -lazy-redraw=yes|no           skips drawing frames when nothing visible has changed (default no)"
+    << std::endl
+    << "  -frame-stats=yes|no           shows frame statistics over the screen, also toggled with Ctrl+F12 (default no)"
+    << std::endl
+    << "  -interpolation=yes|no         draws at the display refresh rate, moving entities between updates (default no)"
+    << std::endl
+    << "  -late-latch=yes|no            applies the direction pressed to the hero movement before moving rather than after (default no)"
+    << std::endl
+    << "  -lua-gc=<mode>                schedules the Lua garbage collector: auto, frame (steps in idle time) or generational (default auto)"
+    << std::endl
+    << "  -lua-pool-allocator=yes|no    allocates small Lua objects from pools instead of the system allocator (default yes)"
+    << std::endl
+    << "  -script-cache=yes|no          keeps compiled Lua scripts in memory and in the quest write directory (default yes)"
+    << std::endl
     << "  -lag=X                        slows down each frame of X milliseconds to simulate slower systems for debugging (default 0)"
     << std::endl
     << "  -cursor-visible=yes|no        sets the mouse cursor visibility on start (default leave unchanged)"
@@ -73,8 +113,12 @@ void print_help(const Arguments& args) {
     << std::endl
     << "  -suspend-unfocused=yes|no     suspends the simulation when the application window is not focused (default yes)"
     << std::endl
+    << "  -log-level=<level>            minimum severity of messages logged: debug, info, warning, error, fatal or none (default debug)"
+    << std::endl
     << "  -perf-sound-play=yes|no       enables performance reporting of sound playing (default no)"
     << std::endl
+    << "  -perf-trace=<file>            writes the duration of each subsystem to a Chrome trace JSON file (default none)"
+    << std::endl
     << "  -perf-video-render=yes|no     enables performance reporting of video rendering, i.e. FPS (default no)"
     << std::endl
     << "  -joypad-deadzone=<value>      sets the joypad axis deadzone between 0-32767 (default 10000)"
@@ -83,7 +127,57 @@ void print_help(const Arguments& args) {
     << std::endl
     << "  -s=<script>                   set a script to be executed before the main.lua of the quest."
     << std::endl
-    << "  -force-software-rendering     force the engine to use SDL software rendering. Disabling opengl."
+    << "  -force-software-rendering     force the engine to use software rendering. Disabling opengl."
+    << std::endl
+    << "  -gl-batch-size=<sprites>      sets the number of sprites of the OpenGL sprite batch (default 4096, max 16384)"
+    << std::endl
+    << "  -texture-atlas=yes|no         packs small images loaded from files into shared OpenGL textures (default yes)"
+    << std::endl
+    << "  -gl-instancing=yes|no         draws sprites as instances with OpenGL 3.3 or OpenGL ES 3 (default yes)"
+    << std::endl
+    << "  -sdl-batching=yes|no          groups draws of the SDL renderer fallback with SDL_RenderGeometry when SDL is 2.0.18 or later (default yes)"
+    << std::endl
+    << "  -software-rasterizer=yes|no   draws with the multithreaded rasterizer of Solarus rather than the SDL one when software rendering is forced (default yes)"
+    << std::endl
+    << "  -premultiplied-alpha=yes|no   premultiplies images when loading them, so that blend and add draws share one blend state (default no)"
+    << std::endl
+    << "  -image-copies=yes|no          keeps a copy in memory of images loaded from files, otherwise decodes them again when their pixels are read (default yes)"
+    << std::endl
+    << "  -image-cache-vram=<MiB>       video memory used by images loaded from files and no longer in use before they are freed (default 0: no limit)"
+    << std::endl
+    << "  -image-cache-ram=<MiB>        same for the main memory used by their software copies (default 0: no limit)"
+    << std::endl
+    << "  -vsync=<mode>                 paces OpenGL frames: on, off, adaptive (does not wait for late frames) or latency (no vsync, precise timer) (default on)"
+    << std::endl
+    << "  -filter-threads=N             number of threads of software video mode filters (default 0: one per core, up to 4)"
+    << std::endl
+    << "  -job-threads=N                number of worker threads shared by the engine subsystems (default 0: one per core minus one)"
+    << std::endl
+    << "  -map-prefetch-distance=<px>   preloads the destination of teletransporters closer than this to the hero (default 64, 0 to disable)"
+    << std::endl
+    << "  -data-cache=yes|no            caches maps, tilesets and sprites in binary in the quest write directory (default yes)"
+    << std::endl
+    << "  -shader-cache=yes|no          caches linked OpenGL shader programs in the quest write directory (default yes)"
+    << std::endl
+    << "  -sound-stream-threshold=<KiB> streams sounds whose decoded size is larger than this instead of decoding them in advance (default 1024)"
+    << std::endl
+    << "  -sound-cache-size=<MiB>       maximum size of decoded sounds kept in memory (default 32)"
+    << std::endl
+    << "  -sound-voices=<N>             number of sounds that can play at the same time (default 32)"
+    << std::endl
+    << "  -audio-thread=yes|no          runs the audio system on its own thread (default yes)"
+    << std::endl
+    << "  -music-prerender=yes|no       renders .spc and .it musics in advance on a background thread (default no)"
+    << std::endl
+    << "  -music-cache-size=<MiB>       maximum size of musics rendered in advance (default 32)"
+    << std::endl
+    << "  -music-resampling=<mode>      interpolation of .it musics: nearest, linear, spline or fir (default linear)"
+    << std::endl
+    << "  -music-quality=<tier>         rendering of .it musics: low, medium, high or auto (default: quest setting)"
+    << std::endl
+    << "  -startup-threads=N            number of threads initializing the engine in parallel with the main thread (default: one less than the number of cores, 0 to initialize serially)"
+    << std::endl
+    << "  -startup-report=yes|no        prints the duration of each initialization step (default no)"
     << std::endl;
 }
 
@@ -109,9 +203,37 @@ void print_help(const Arguments& args) {
  *   -help                             Shows a help message.
  *   -no-audio                         Disables sounds and musics.
  *   -no-video                         Disables displaying (used for unit tests).
+ *   -headless                         Runs as fast as possible without window, audio,
+ *                                     input or drawing (used for automated tests).
+ *   -max-ticks=N                      Stops after N updates of the simulation (default: 0, no limit).
+ *   -random-seed=N                    Seeds the random number generator with N (default: current time).
+ *   -record-input=<file>              Records input events and the random seed to a file.
+ *   -replay-input=<file>              Replays input events recorded with -record-input.
+ *   -state-hash=yes|no                Also records a hash of entity positions after each update,
+ *                                     to detect when a replay diverges (default: no).
  *   -quest-size=<width>x<height>      Sets the size of the drawing area (if compatible with the quest).
+ *   -record-video=<file>              Records the frames drawn to a Y4M video, to PNG images
+ *                                     if <file> ends with .png, or to the standard input
+ *                                     of a command if <file> starts with |.
+ *   -record-video-fps=<fps>           Frame rate of the recording (default: 60).
  *   -lua-console=yes|no               Accepts lines from standard input as Lua commands (default: yes).
+ *   -launcher-channel=<file>          Exchanges frame statistics and Lua commands with a launcher
+ *                                     through a file mapped in memory (default: none).
+ *   -hot-reload=yes|no                Reloads sprites, tilesets, images, sounds and shaders
+ *                                     when their files change (default: no).
+ *   -memory-log-period=<seconds>      Logs the memory used by each subsystem every <seconds> seconds
+ *                                     (default: 0, never).
+ *   -hitch-threshold=<ms>             Logs where the time went in frames longer than <ms> milliseconds
+ *                                     (default: 50, 0: never).
+ *   -hitch-log-size=<n>               Keeps the last <n> hitches in hitches.log of the quest write
+ *                                     directory (default: 20).
  *   -turbo=yes|no                     Runs as fast as possible rather than simulating real time (default: no).
+ *   -lazy-redraw=yes|no               Skips drawing frames when nothing visible has changed (default: no).
+ *   -frame-stats=yes|no               Shows frame statistics over the screen,
+ *                                     also toggled with Ctrl+F12 (default: no).
+ *   -interpolation=yes|no             Draws at the display refresh rate, moving entities between updates (default: no).
+ *   -late-latch=yes|no                Applies the direction pressed to the hero movement
+ *                                     before moving rather than after (default: no).
  *   -lag=X                            (Advanced) Artificially slows down each frame of X milliseconds
  *                                     to simulate slower systems for debugging (default: 0).
  *
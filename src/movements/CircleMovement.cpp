@@ -22,6 +22,9 @@
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/movements/CircleMovement.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <sstream>
 
 namespace Solarus {
@@ -36,15 +39,14 @@ CircleMovement::CircleMovement():
   current_angle(0.0),
   initial_angle(0.0),
   angle_increment(1),
-  next_angle_change_date(static_cast<double>(System::now())),
-  angle_change_delay(5.0),
-  angular_speed(1000.0 / Geometry::degrees_to_radians(angle_change_delay)),
+  angle_motion(),
+  angular_speed(1000.0 / Geometry::degrees_to_radians(5.0)),
   current_radius(0),
   wanted_radius(0),
   previous_radius(0),
   radius_increment(0),
-  next_radius_change_date(System::now()),
-  radius_change_delay(0),
+  radius_speed(0),
+  radius_motion(),
   duration(0),
   end_movement_date(0),
   max_rotations(0),
@@ -53,6 +55,8 @@ CircleMovement::CircleMovement():
   loop_delay(0),
   restart_date(System::now()) {
 
+  angle_motion.set_speed(200.0);  // One degree every 5 ms.
+  angle_motion.restart(System::now());
 }
 
 /**
@@ -122,7 +126,7 @@ void CircleMovement::set_radius(int radius) {
   }
 
   this->wanted_radius = radius;
-  if (radius_change_delay == 0) {
+  if (radius_speed == 0) {
     if (is_started()) {
       this->current_radius = wanted_radius;
     }
@@ -130,7 +134,7 @@ void CircleMovement::set_radius(int radius) {
   else {
     this->radius_increment = (radius > this->current_radius) ? 1 : -1;
     if (is_started()) {
-      this->next_radius_change_date = System::now();
+      radius_motion.restart(System::now());
     }
   }
   recompute_position();
@@ -142,7 +146,7 @@ void CircleMovement::set_radius(int radius) {
  */
 int CircleMovement::get_radius_speed() const {
 
-  return radius_change_delay == 0 ? 0 : 1000 / radius_change_delay;
+  return radius_speed;
 }
 
 /**
@@ -161,12 +165,8 @@ void CircleMovement::set_radius_speed(int radius_speed) {
     Debug::die(oss.str());
   }
 
-  if (radius_speed == 0) {
-    this->radius_change_delay = 0;
-  }
-  else {
-    this->radius_change_delay = 1000 / radius_speed;
-  }
+  this->radius_speed = radius_speed;
+  radius_motion.set_speed(radius_speed);
 
   set_radius(wanted_radius);
 }
@@ -192,8 +192,8 @@ void CircleMovement::set_angular_speed(double angular_speed) {
   }
 
   this->angular_speed = angular_speed;
-  this->angle_change_delay = 1000.0 / Geometry::radians_to_degrees(angular_speed);
-  this->next_angle_change_date = static_cast<double>(System::now());
+  angle_motion.set_speed(Geometry::radians_to_degrees(angular_speed));
+  angle_motion.restart(System::now());
   recompute_position();
 }
 
@@ -369,35 +369,45 @@ void CircleMovement::update() {
     start();
   }
 
-  // Update the angle.
+  // Update the angle: all 1-degree increments due are made at once.
   if (is_started()) {
-    while (now >= next_angle_change_date) {
-
-      current_angle += Geometry::degrees_to_radians(angle_increment);
-      current_angle = std::fmod(current_angle + Geometry::TWO_PI, Geometry::TWO_PI);
-      ++num_increments;
-      if (num_increments == 360) {
+    const int num_degrees = angle_motion.advance(now);
+    if (num_degrees > 0) {
+
+      const double increment = std::fmod(
+          Geometry::degrees_to_radians(angle_increment * num_degrees),
+          Geometry::TWO_PI
+      );
+      current_angle = std::fmod(current_angle + increment + Geometry::TWO_PI, Geometry::TWO_PI);
+      num_increments += num_degrees;
+      while (num_increments >= 360) {
         num_rotations++;
-        num_increments = 0;
+        num_increments -= 360;
 
         if (num_rotations == max_rotations) {
           stop();
         }
       }
-
-      next_angle_change_date += angle_change_delay;
       update_needed = true;
     }
   }
 
   // Update the radius.
-  while (current_radius != wanted_radius &&
-         now >= next_radius_change_date) {
-
-    current_radius += radius_increment;
-
-    next_radius_change_date += radius_change_delay;
-    update_needed = true;
+  if (current_radius != wanted_radius) {
+    if (radius_speed == 0) {
+      current_radius = wanted_radius;
+      update_needed = true;
+    }
+    else {
+      const int num_pixels = std::min(
+          std::abs(wanted_radius - current_radius),
+          radius_motion.advance(now)
+      );
+      if (num_pixels > 0) {
+        current_radius += radius_increment * num_pixels;
+        update_needed = true;
+      }
+    }
   }
 
   // The center may have moved.
@@ -442,8 +452,8 @@ void CircleMovement::set_suspended(bool suspended) {
 
   if (get_when_suspended() != 0) {
     uint32_t diff = System::now() - get_when_suspended();
-    next_angle_change_date += diff;
-    next_radius_change_date += diff;
+    angle_motion.shift(diff);
+    radius_motion.shift(diff);
     end_movement_date += diff;
     restart_date += diff;
   }
@@ -455,7 +465,7 @@ void CircleMovement::set_suspended(bool suspended) {
 void CircleMovement::start() {
 
   current_angle = initial_angle;
-  next_angle_change_date = System::now();
+  angle_motion.restart(System::now());
   num_increments = 0;
   num_rotations = 0;
 
@@ -463,11 +473,11 @@ void CircleMovement::start() {
     end_movement_date = System::now() + duration;
   }
 
-  if (radius_change_delay == 0) {
+  if (radius_speed == 0) {
     current_radius = wanted_radius;
   }
   else {
-    next_radius_change_date = System::now();
+    radius_motion.restart(System::now());
   }
   recompute_position();
 }
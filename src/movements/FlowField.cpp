@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Map.h"
+#include "solarus/core/PerfTrace.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/WalkabilityGrid.h"
+#include "solarus/movements/FlowField.h"
+#include "solarus/movements/PathFinding.h"
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace Solarus {
+
+constexpr int FlowField::radius;
+constexpr int FlowField::size;
+constexpr uint16_t FlowField::unreached;
+
+namespace {
+
+/**
+ * \brief Snaps a coordinate to the closest multiple of 8,
+ * like PathFinding does for its target.
+ * \param value A coordinate.
+ * \return The snapped coordinate.
+ */
+int snap_to_grid(int value) {
+
+  value += 4;
+  value += -value % 8;
+  return value;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates a flow field that is not computed yet.
+ * \param target The entity to reach.
+ * \param ground_obstacles Grounds that are obstacles,
+ * as returned by Entity::get_ground_obstacles().
+ */
+FlowField::FlowField(const EntityPtr& target, uint32_t ground_obstacles):
+  target(target),
+  ground_obstacles(ground_obstacles),
+  target_node(),
+  layer(0),
+  grid_version(0),
+  computed(false),
+  last_use_date(System::now()),
+  costs(),
+  directions() {
+
+}
+
+/**
+ * \brief Returns the entity to reach.
+ * \return The target.
+ */
+const EntityPtr& FlowField::get_target() const {
+  return target;
+}
+
+/**
+ * \brief Returns the grounds that are obstacles in this field.
+ * \return A bit set of grounds.
+ */
+uint32_t FlowField::get_ground_obstacles() const {
+  return ground_obstacles;
+}
+
+/**
+ * \brief Returns the last time this field was updated.
+ * \return The last date of update() in milliseconds.
+ */
+uint32_t FlowField::get_last_use_date() const {
+  return last_use_date;
+}
+
+/**
+ * \brief Computes the field again if the target or the terrain changed.
+ * \param map The map.
+ * \param source An entity that uses the field. Used for terrain tests
+ * that the walkability grid cannot answer.
+ */
+void FlowField::update(Map& map, Entity& source) {
+
+  last_use_date = System::now();
+
+  const Point& target_xy = target->get_bounding_box().get_xy();
+  const Point node(snap_to_grid(target_xy.x), snap_to_grid(target_xy.y));
+  const uint32_t version = map.get_entities().get_walkability_grid().get_version();
+
+  if (computed &&
+      node == target_node &&
+      target->get_layer() == layer &&
+      version == grid_version) {
+    return;
+  }
+
+  target_node = node;
+  layer = target->get_layer();
+  grid_version = version;
+  compute(map, source);
+  computed = true;
+}
+
+/**
+ * \brief Returns the direction to follow from a point.
+ * \param xy Top-left corner of an entity of size 16x16.
+ * \return The direction (0 to 7), or -1 if the target is reached,
+ * too far or not reachable.
+ */
+int FlowField::get_direction8(const Point& xy) const {
+
+  int index = 0;
+  if (!get_node_index(xy, index)) {
+    return -1;
+  }
+  return directions[index];
+}
+
+/**
+ * \brief Returns the path to follow from a point to the target.
+ * \param xy Top-left corner of an entity of size 16x16.
+ * \return The path, in the format of PathMovement, or an empty string
+ * if the target is reached, too far or not reachable.
+ */
+std::string FlowField::get_path(const Point& xy) const {
+
+  std::string path;
+  int index = 0;
+  if (!get_node_index(xy, index)) {
+    return path;
+  }
+
+  Point location = get_node_location(index);
+  while (directions[index] != -1) {
+    const int direction8 = directions[index];
+    path += static_cast<char>('0' + direction8);
+    location += PathFinding::get_neighbour_offset(direction8);
+    if (!get_node_index(location, index)) {
+      break;
+    }
+  }
+  return path;
+}
+
+/**
+ * \brief Returns the index of the node at a point.
+ * \param[in] xy A point of the map.
+ * \param[out] index Index of the closest node.
+ * \return \c false if the point is outside the window of the field.
+ */
+bool FlowField::get_node_index(const Point& xy, int& index) const {
+
+  if (!computed) {
+    return false;
+  }
+
+  const int column = (snap_to_grid(xy.x) - target_node.x) / 8 + radius;
+  const int row = (snap_to_grid(xy.y) - target_node.y) / 8 + radius;
+  if (column < 0 || column >= size || row < 0 || row >= size) {
+    return false;
+  }
+  index = row * size + column;
+  return true;
+}
+
+/**
+ * \brief Returns the location of a node.
+ * \param index Index of a node.
+ * \return Top-left corner of the node on the map.
+ */
+Point FlowField::get_node_location(int index) const {
+
+  return Point(
+      target_node.x + (index % size - radius) * 8,
+      target_node.y + (index / size - radius) * 8
+  );
+}
+
+/**
+ * \brief Runs Dijkstra's algorithm from the target.
+ * \param map The map.
+ * \param source An entity that uses the field.
+ */
+void FlowField::compute(Map& map, Entity& source) {
+
+  PerfTrace::Scope trace_scope("flow-field-compute");
+
+  costs.assign(size * size, unreached);
+  directions.assign(size * size, -1);
+
+  WalkabilityGrid& grid = map.get_entities().get_walkability_grid();
+  using Entry = std::pair<int, int>;  // Cost and index.
+  std::vector<Entry> open_list;
+
+  const int target_index = radius * size + radius;
+  costs[target_index] = 0;
+  open_list.emplace_back(0, target_index);
+
+  while (!open_list.empty()) {
+
+    std::pop_heap(open_list.begin(), open_list.end(), std::greater<Entry>());
+    const Entry entry = open_list.back();
+    open_list.pop_back();
+    if (entry.first != costs[entry.second]) {
+      // Outdated entry.
+      continue;
+    }
+
+    const Point location = get_node_location(entry.second);
+    const int column = entry.second % size;
+    const int row = entry.second / size;
+    for (int direction8 = 0; direction8 < 8; ++direction8) {
+
+      // Look for nodes that reach this one by going in this direction.
+      const Point& offset = PathFinding::get_neighbour_offset(direction8);
+      const int previous_column = column - offset.x / 8;
+      const int previous_row = row - offset.y / 8;
+      if (previous_column < 0 || previous_column >= size ||
+          previous_row < 0 || previous_row >= size) {
+        continue;
+      }
+      const int previous_index = previous_row * size + previous_column;
+      const Point previous_location = location - offset;
+
+      const int cost = entry.first + ((direction8 & 1) ? 11 : 8);
+      if (cost >= costs[previous_index]) {
+        continue;
+      }
+
+      Rectangle collision_box = PathFinding::get_transition_collision_box(direction8);
+      collision_box.add_xy(previous_location);
+      const WalkabilityGrid::Result result = grid.test_collision(layer, collision_box, ground_obstacles);
+      if (result == WalkabilityGrid::Result::OBSTACLE ||
+          (result == WalkabilityGrid::Result::UNKNOWN &&
+           map.test_collision_with_ground(layer, collision_box, source))) {
+        continue;
+      }
+
+      costs[previous_index] = static_cast<uint16_t>(cost);
+      directions[previous_index] = static_cast<int8_t>(direction8);
+      open_list.emplace_back(cost, previous_index);
+      std::push_heap(open_list.begin(), open_list.end(), std::greater<Entry>());
+    }
+  }
+}
+
+}
+
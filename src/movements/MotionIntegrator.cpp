@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/movements/MotionIntegrator.h"
+#include <cmath>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Progress that makes one whole unit.
+ */
+constexpr MotionIntegrator::Fixed unit_progress = 1000 * MotionIntegrator::one;
+
+}
+
+/**
+ * \brief Converts a number to fixed point.
+ * \param value The number to convert.
+ * \return The closest fixed-point value.
+ */
+MotionIntegrator::Fixed MotionIntegrator::to_fixed(double value) {
+  return std::llround(value * one);
+}
+
+/**
+ * \brief Converts a fixed-point value to a number.
+ * \param value The fixed-point value to convert.
+ * \return The corresponding number.
+ */
+double MotionIntegrator::to_double(Fixed value) {
+  return static_cast<double>(value) / one;
+}
+
+/**
+ * \brief Creates a stopped integrator.
+ */
+MotionIntegrator::MotionIntegrator():
+  speed(0),
+  progress(0),
+  date(0) {
+
+}
+
+/**
+ * \brief Returns the speed.
+ * \return The speed in units per second.
+ */
+double MotionIntegrator::get_speed() const {
+  return to_double(speed);
+}
+
+/**
+ * \brief Sets the speed.
+ *
+ * The time elapsed since the last call to advance() will be counted
+ * at the new speed.
+ *
+ * \param speed The speed in units per second.
+ */
+void MotionIntegrator::set_speed(double speed) {
+
+  Debug::check_assertion(speed >= 0.0, "Negative speed");
+  this->speed = to_fixed(speed);
+}
+
+/**
+ * \brief Returns the date up to which the motion is computed.
+ * \return The date in milliseconds.
+ */
+uint32_t MotionIntegrator::get_date() const {
+  return date;
+}
+
+/**
+ * \brief Starts counting units from a date.
+ *
+ * Like a step scheduled at this date, the first unit is due immediately.
+ *
+ * \param date The start date in milliseconds.
+ */
+void MotionIntegrator::restart(uint32_t date) {
+
+  this->date = date;
+  progress = speed > 0 ? unit_progress : 0;
+}
+
+/**
+ * \brief Integrates the speed until a date.
+ *
+ * A date earlier than the previous one counts as no time elapsed.
+ *
+ * \param now The current date in milliseconds.
+ * \return The number of whole units made since the previous call.
+ */
+int MotionIntegrator::advance(uint32_t now) {
+
+  const int32_t elapsed = static_cast<int32_t>(now - date);
+  if (elapsed > 0) {
+    progress += elapsed * speed;
+    date = now;
+  }
+
+  const Fixed units = progress / unit_progress;
+  progress -= units * unit_progress;
+  return static_cast<int>(units);
+}
+
+/**
+ * \brief Postpones the motion, typically after a suspension.
+ * \param delay The delay to add in milliseconds.
+ */
+void MotionIntegrator::shift(uint32_t delay) {
+  date += delay;
+}
+
+}
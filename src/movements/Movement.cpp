@@ -53,6 +53,12 @@ Movement::Movement(bool ignore_obstacles):
   last_collision_box_on_obstacle(-1, -1),
   default_ignore_obstacles(ignore_obstacles),
   current_ignore_obstacles(ignore_obstacles),
+  coalesce_moves(false),
+  coalescing(false),
+  coalesced_path(),
+  free_run_start(),
+  free_run_step(),
+  free_run_length(0),
   finished_callback_ref() {
 
 }
@@ -208,6 +214,15 @@ void Movement::set_xy(int x, int y) {
  */
 void Movement::set_xy(const Point& xy) {
 
+  if (coalescing && entity != nullptr) {
+    // Only move the entity for now: notifications happen in end_coalesced_moves().
+    entity->set_xy(xy);
+    this->xy = xy;
+    coalesced_path.push_back(xy);
+    last_move_date = System::now();
+    return;
+  }
+
   if (entity != nullptr) {
     // The object controlled is a map entity.
     entity->set_xy(xy);
@@ -282,6 +297,12 @@ void Movement::notify_position_changed() {
  */
 void Movement::notify_obstacle_reached() {
 
+  if (coalescing) {
+    // Make sure that the entity is up to date before calling any event.
+    end_coalesced_moves();
+    begin_coalesced_moves();
+  }
+
   LuaContext* lua_context = get_lua_context();
   if (lua_context != nullptr && are_lua_notifications_enabled()) {
     lua_context->movement_on_obstacle_reached(*this);
@@ -461,6 +482,15 @@ bool Movement::test_collision_with_obstacles(int dx, int dy) const {
     return false;
   }
 
+  if (free_run_length > 0) {
+    // See if this position was already found free by find_free_run().
+    const Point& offset = entity->get_xy() + Point(dx, dy) - free_run_start;
+    const int i = free_run_step.x != 0 ? offset.x * free_run_step.x : offset.y * free_run_step.y;
+    if (i >= 1 && i <= free_run_length && offset == free_run_step * i) {
+      return false;
+    }
+  }
+
   Map& map = entity->get_map();
 
   // place the collision box where we want to check the collisions
@@ -538,6 +568,118 @@ void Movement::restore_default_ignore_obstacles() {
   this->current_ignore_obstacles = default_ignore_obstacles;
 }
 
+/**
+ * \brief Returns whether the moves made during an update are coalesced.
+ * \return \c true if position changes are notified once per update.
+ */
+bool Movement::are_moves_coalesced() const {
+  return coalesce_moves;
+}
+
+/**
+ * \brief Sets whether the moves made during an update are coalesced.
+ *
+ * When a fast movement makes several one-pixel steps in the same update,
+ * each step normally notifies the entity, which updates the quadtree,
+ * checks collisions and the ground and calls Lua events.
+ * With coalesced moves, only obstacles are tested at each step.
+ * The entity is then notified once at its final position, after checking
+ * collisions with the detectors that its path crossed.
+ * The ground and the on_position_changed() events only see the final
+ * position.
+ *
+ * This only has an effect on movements applied to an entity.
+ *
+ * \param coalesce_moves \c true to coalesce moves.
+ */
+void Movement::set_coalesce_moves(bool coalesce_moves) {
+
+  if (!coalesce_moves) {
+    end_coalesced_moves();
+  }
+  this->coalesce_moves = coalesce_moves;
+}
+
+/**
+ * \brief Starts a sequence of moves that will be notified only once.
+ *
+ * Does nothing unless moves are coalesced and the movement controls
+ * an entity.
+ * Subclasses call this before making the steps of an update and then
+ * call end_coalesced_moves().
+ */
+void Movement::begin_coalesced_moves() {
+
+  coalescing = coalesce_moves && entity != nullptr;
+  coalesced_path.clear();
+  free_run_length = 0;
+}
+
+/**
+ * \brief Notifies the moves made since begin_coalesced_moves().
+ *
+ * Collisions are checked with detectors crossed at intermediate positions,
+ * and then the position change is notified normally.
+ */
+void Movement::end_coalesced_moves() {
+
+  if (!coalescing) {
+    return;
+  }
+
+  coalescing = false;
+  free_run_length = 0;
+  if (coalesced_path.empty()) {
+    return;
+  }
+
+  std::vector<Point> path;
+  path.swap(coalesced_path);
+  path.pop_back();  // The final position is checked by notify_position_changed().
+
+  if (entity != nullptr &&
+      !entity->is_being_removed() &&
+      !path.empty()) {
+    entity->check_collisions_along_path(path);
+  }
+
+  notify_position_changed();
+}
+
+/**
+ * \brief Finds with a single query how far the entity can go in a direction.
+ *
+ * Subsequent calls to test_collision_with_obstacles() for positions of this
+ * run then return \c false without testing the map again,
+ * until end_coalesced_moves() is called.
+ * This is only done while moves are coalesced: no event can be called
+ * between the steps, so obstacles cannot change in the meantime.
+ *
+ * \param step Translation of each step. Coordinates must be -1, 0 or 1.
+ * \param max_steps Number of steps to check.
+ */
+void Movement::find_free_run(const Point& step, int max_steps) {
+
+  free_run_length = 0;
+  if (!coalescing ||
+      entity == nullptr ||
+      current_ignore_obstacles ||
+      max_steps < 2) {
+    // Not worth it.
+    return;
+  }
+
+  free_run_start = entity->get_xy();
+  free_run_step = step;
+  free_run_length = entity->get_map().get_free_distance(
+      entity->get_layer(),
+      entity->get_bounding_box(),
+      step,
+      max_steps,
+      *entity
+  );
+}
+
 /**
  * \brief Returns the angle in radians of this movement.
  * \return The angle in radians.
@@ -17,12 +17,18 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Map.h"
+#include "solarus/entities/Entities.h"
 #include "solarus/entities/Entity.h"
+#include "solarus/entities/WalkabilityGrid.h"
 #include "solarus/movements/PathFinding.h"
+#include <algorithm>
 #include <limits>
 
 namespace Solarus {
 
+PathFinding::Workspace PathFinding::default_workspace;
+constexpr int PathFinding::margin;
+
 const Point PathFinding::neighbours_locations[] = {
   {  8,  0 },
   {  8, -8 },
@@ -56,9 +62,35 @@ PathFinding::PathFinding(
     Map& map,
     Entity& source_entity,
     Entity& target_entity):
+  PathFinding(map, source_entity, target_entity, default_workspace) {
+
+}
+
+/**
+ * \brief Constructor with a specific workspace.
+ * \param map the map
+ * \param source_entity the entity that will move from the starting point to the target
+ * (its position must be aligned on the map grid)
+ * \param target_entity the target entity (its size must be 16*16)
+ * \param workspace Memory to use for the search. No other search may use it
+ * until this one is finished.
+ */
+PathFinding::PathFinding(
+    Map& map,
+    Entity& source_entity,
+    Entity& target_entity,
+    Workspace& workspace):
   map(map),
   source_entity(source_entity),
-  target_entity(target_entity) {
+  target_entity(target_entity),
+  workspace(workspace),
+  columns(0),
+  rows(0),
+  ground_obstacles(0),
+  next_offset(0),
+  searching(false),
+  finished(true),
+  search_target_index(0) {
 
   Debug::check_assertion(source_entity.is_aligned_to_grid(),
       "The source must be aligned on the map grid");
@@ -71,241 +103,416 @@ PathFinding::PathFinding(
  */
 std::string PathFinding::compute_path() {
 
+  start();
+  int max_expansions = std::numeric_limits<int>::max();
+  step(max_expansions);
+  return best_path;
+}
+
+/**
+ * \brief Tries to find a path from the source point to the target point
+ * plus an offset.
+ * \param offset Translation to add to the target.
+ * \return the path found, or an empty string if no path was found
+ * (because there is no path or the target is too far)
+ */
+std::string PathFinding::compute_path(const Point& offset) {
+
+  start({ offset });
+  int max_expansions = std::numeric_limits<int>::max();
+  step(max_expansions);
+  return best_path;
+}
+
+/**
+ * \brief Starts an incremental search of a path between the source point
+ * and the target point.
+ *
+ * The positions of the source and of the target are taken now.
+ * Call step() to make the search progress.
+ */
+void PathFinding::start() {
+
   if (!target_entity.is_obstacle_for(source_entity)) {
     // No offset needed.
-    return compute_path(Point());
+    start({ Point() });
+    return;
   }
 
   // The target is not traversable: then try to compute a path to somewhere close.
-  const std::vector<Point> offsets = {
+  // The transitions tested by a search are reused by the next ones.
+  start({
       Point(target_entity.get_width(), 0),
       Point(0, -target_entity.get_height()),
       Point(-target_entity.get_width(), 0),
       Point(0, target_entity.get_height())
-  };
+  });
+}
 
-  std::string best_path;
-  size_t minimum_steps = std::numeric_limits<int>::max();
-  for (const Point& offset : offsets) {
-    std::string path = compute_path(offset);
-    if (!path.empty() && path.size() < minimum_steps) {
-      best_path = path;
-      minimum_steps = path.size();
+/**
+ * \brief Starts an incremental search towards the target plus some offsets.
+ *
+ * The shortest of the paths found is kept.
+ *
+ * \param offsets Translations to add to the target.
+ */
+void PathFinding::start(const std::vector<Point>& offsets) {
+
+  prepare_nodes();
+  ground_obstacles = source_entity.get_ground_obstacles();
+  source = source_entity.get_bounding_box().get_xy();
+  target = target_entity.get_bounding_box().get_xy();
+  this->offsets = offsets;
+  next_offset = 0;
+  searching = false;
+  finished = false;
+  best_path.clear();
+}
+
+/**
+ * \brief Makes the search progress.
+ * \param[in,out] max_expansions Maximum number of nodes to expand.
+ * Decreased by the number of nodes actually expanded.
+ * \return \c true if the search is finished.
+ */
+bool PathFinding::step(int& max_expansions) {
+
+  while (!finished) {
+
+    if (!searching) {
+      if (next_offset >= offsets.size()) {
+        finished = true;
+        break;
+      }
+      searching = begin_search(offsets[next_offset]);
+      ++next_offset;
+      continue;
     }
+
+    if (max_expansions <= 0) {
+      return false;
+    }
+    --max_expansions;
+    expand_next_node();
   }
 
-  return best_path;
+  return true;
 }
 
 /**
- * \brief Tries to find a path from the source point to the target point
- * plus an offset.
- * \param offset Translation to add to the target.
+ * \brief Returns whether the search started with start() is finished.
+ * \return \c true if the search is finished.
+ */
+bool PathFinding::is_finished() const {
+  return finished;
+}
+
+/**
+ * \brief Returns the result of a finished search.
  * \return the path found, or an empty string if no path was found
  * (because there is no path or the target is too far)
  */
-std::string PathFinding::compute_path(const Point& offset) {
+const std::string& PathFinding::get_path() const {
+  return best_path;
+}
+
+/**
+ * \brief Returns the translation from a node to its neighbour in a direction.
+ * \param direction A direction (0 to 7).
+ * \return The location of the neighbour relative to the node.
+ */
+const Point& PathFinding::get_neighbour_offset(int direction) {
+  return neighbours_locations[direction];
+}
+
+/**
+ * \brief Returns the area to test when going from a node to its neighbour.
+ * \param direction A direction (0 to 7).
+ * \return The area where there should be no obstacle,
+ * relative to the node.
+ */
+const Rectangle& PathFinding::get_transition_collision_box(int direction) {
+  return transition_collision_boxes[direction];
+}
 
-  Point source = source_entity.get_bounding_box().get_xy();
-  Point target = target_entity.get_bounding_box().get_xy() + offset;
+/**
+ * \brief Makes the node array ready for a new call to start().
+ *
+ * The array is only reallocated when the size of the map changes.
+ * Nodes of previous searches are ignored thanks to their stamps.
+ */
+void PathFinding::prepare_nodes() {
+
+  columns = map.get_width8() + 2 * margin;
+  rows = map.get_height8() + 2 * margin;
+  const size_t num_nodes = static_cast<size_t>(columns * rows);
+
+  ++workspace.current_transitions_search;
+  if (workspace.nodes.size() != num_nodes || workspace.current_transitions_search == 0) {
+    // New map size or stamp overflow: start again from clean nodes.
+    workspace.nodes.assign(num_nodes, Node());
+    workspace.current_search = 0;
+    workspace.current_transitions_search = 1;
+  }
+}
 
-  // std::cout << "will compute a path from " << source << " to " << target << std::endl;
+/**
+ * \brief Initializes the A* algorithm towards the target point plus an offset.
+ *
+ * prepare_nodes() must have been called before.
+ *
+ * \param offset Translation to add to the target.
+ * \return \c false if there is obviously no path
+ * (because the target is too far).
+ */
+bool PathFinding::begin_search(const Point& offset) {
 
-  target.x += 4;
-  target.x += -target.x % 8;
-  target.y += 4;
-  target.y += -target.y % 8;
-  const int target_index = get_square_index(target);
+  search_target = target + offset;
+  search_target.x += 4;
+  search_target.x += -search_target.x % 8;
+  search_target.y += 4;
+  search_target.y += -search_target.y % 8;
 
-  Debug::check_assertion(target.x % 8 == 0 && target.y % 8 == 0,
+  Debug::check_assertion(search_target.x % 8 == 0 && search_target.y % 8 == 0,
       "Could not snap the target to the map grid");
 
-  const int total_mdistance = Geometry::get_manhattan_distance(source, target);
+  const int total_mdistance = Geometry::get_manhattan_distance(source, search_target);
   if (total_mdistance > 200 || target_entity.get_layer() != source_entity.get_layer()) {
-    //std::cout << "too far, not computing a path\n";
-    return ""; // too far to compute a path
+    return false; // too far to compute a path
+  }
+
+  int source_index = 0;
+  if (!get_node_index(source, source_index) ||
+      !get_node_index(search_target, search_target_index)) {
+    // Too far outside the map to be reachable.
+    return false;
+  }
+
+  std::vector<Node>& nodes = workspace.nodes;
+  ++workspace.current_search;
+  if (workspace.current_search == 0) {
+    // Stamp overflow: forget all previous searches.
+    for (Node& node : nodes) {
+      node.search = 0;
+    }
+    workspace.current_search = 1;
   }
 
-  std::string path = "";
+  workspace.open_list.clear();
+  workspace.next_order = 0;
 
-  Node starting_node;
-  const int index = get_square_index(source);
-  starting_node.location = source;
-  starting_node.index = index;
+  Node& starting_node = nodes[source_index];
+  starting_node.search = workspace.current_search;
+  starting_node.closed = false;
   starting_node.previous_cost = 0;
   starting_node.heuristic = total_mdistance;
   starting_node.total_cost = total_mdistance;
   starting_node.direction = ' ';
   starting_node.parent_index = -1;
+  workspace.open_list.push_back({ starting_node.total_cost, workspace.next_order++, source_index });
+  return true;
+}
+
+/**
+ * \brief Runs one iteration of the A* algorithm.
+ *
+ * Picks the best node of the open list and adds its neighbours.
+ * Stops the current search if the target is reached or if there is no path.
+ */
+void PathFinding::expand_next_node() {
+
+  std::vector<Node>& nodes = workspace.nodes;
+  std::vector<OpenEntry>& open_list = workspace.open_list;
+  const uint32_t current_search = workspace.current_search;
 
-  open_list.clear();
-  closed_list.clear();
-  open_list_indices.clear();
+  if (open_list.empty()) {
+    // No path for this offset.
+    searching = false;
+    return;
+  }
 
-  open_list[index] = starting_node;
-  open_list_indices.push_front(index);
+  // pick the node with the lowest total cost in the open list
+  std::pop_heap(open_list.begin(), open_list.end());
+  const OpenEntry entry = open_list.back();
+  open_list.pop_back();
 
-  bool finished = false;
-  while (!finished) {
+  Node& current_node = nodes[entry.index];
+  if (current_node.closed || entry.total_cost != current_node.total_cost) {
+    // Outdated entry: this node was found again with a lower cost.
+    return;
+  }
+  current_node.closed = true;
 
-    // pick the node with the lowest total cost in the open list
-    const int index = open_list_indices.front();
-    Node* current_node = &open_list[index];
-    open_list_indices.pop_front();
-    closed_list[index] = *current_node;
-    open_list.erase(index);
-    current_node = &closed_list[index];
-
-    //std::cout << System::now() << " picking the lowest cost node in the open list ("
-    //  << (open_list_indices.size() + 1) << " elements): "
-    //  << current_node->location << ", index = " << current_node->index
-    //  << ", cost = " << current_node->previous_cost << " + " << current_node->heuristic << "\n";
-
-    if (index == target_index) {
-      //std::cout << "target node was added to the closed list\n";
-      finished = true;
-      path = rebuild_path(current_node);
-      //std::cout << "rebuild done\n";
+  if (entry.index == search_target_index) {
+    std::string path = rebuild_path(entry.index);
+    if (!path.empty() && (best_path.empty() || path.size() < best_path.size())) {
+      best_path = path;
+    }
+    searching = false;
+    return;
+  }
+
+  // look at the accessible nodes from it
+  const Point location = get_node_location(entry.index);
+  for (int i = 0; i < 8; i++) {
+
+    const Point new_location = location + neighbours_locations[i];
+    int new_index = 0;
+    if (!get_node_index(new_location, new_index)) {
+      // Outside the map: the transition cannot be valid.
+      continue;
+    }
+
+    Node& new_node = nodes[new_index];
+    const bool reached = new_node.search == current_search;
+    if (reached && new_node.closed) {
+      continue;
+    }
+
+    const int heuristic = Geometry::get_manhattan_distance(new_location, search_target);
+    if (heuristic >= 200 || !is_node_transition_valid(entry.index, i)) {
+      continue;
+    }
+
+    const int immediate_cost = (i & 1) ? 11 : 8;
+    const int previous_cost = current_node.previous_cost + immediate_cost;
+    if (!reached) {
+      // not in the open list: add it
+      new_node.search = current_search;
+      new_node.closed = false;
+      new_node.previous_cost = previous_cost;
+      new_node.heuristic = heuristic;
+      new_node.total_cost = previous_cost + heuristic;
+      new_node.parent_index = entry.index;
+      new_node.direction = '0' + i;
+    }
+    else if (previous_cost < new_node.previous_cost) {
+      // already in the open list: the current path is better
+      new_node.previous_cost = previous_cost;
+      new_node.total_cost = previous_cost + new_node.heuristic;
+      new_node.parent_index = entry.index;
+      new_node.direction = '0' + i;
     }
     else {
-      // look at the accessible nodes from it
-      //std::cout << System::now() << " looking for accessible states\n";
-      for (int i = 0; i < 8; i++) {
-
-        Node new_node;
-        const int immediate_cost = (i & 1) ? 11 : 8;
-        new_node.previous_cost = current_node->previous_cost + immediate_cost;
-        new_node.location = current_node->location;
-        new_node.location += neighbours_locations[i];
-        new_node.index = get_square_index(new_node.location);
-        //std::cout << "  node in direction " << i << ": index = " << new_node.index << std::endl;
-
-        const bool in_closed_list = (closed_list.find(new_node.index) != closed_list.end());
-        if (!in_closed_list && Geometry::get_manhattan_distance(new_node.location, target) < 200
-            && is_node_transition_valid(*current_node, i)) {
-          //std::cout << "  node in direction " << i << " is not in the closed list\n";
-          // not in the closed list: look in the open list
-
-          const bool in_open_list = open_list.find(new_node.index) != open_list.end();
-
-          if (!in_open_list) {
-            // not in the open list: add it
-            new_node.heuristic = Geometry::get_manhattan_distance(new_node.location, target);
-            new_node.total_cost = new_node.previous_cost + new_node.heuristic;
-            new_node.parent_index = index;
-            new_node.direction = '0' + i;
-            open_list[new_node.index] = new_node;
-            add_index_sorted(&open_list[new_node.index]);
-            //std::cout << "  node in direction " << i << " is not in the open list, adding it with cost "
-            //  << new_node.previous_cost << " (" << current_node->previous_cost << " + "
-            //  << immediate_cost << ") + " << new_node.heuristic << " and parent " << new_node.parent_index << "\n";
-          }
-          else {
-            //std::cout << "  node in direction " << i << " is already in the open list\n";
-            Node* existing_node = &open_list[new_node.index];
-            // already in the open list: see if the current path is better
-            if (new_node.previous_cost < existing_node->previous_cost) {
-              existing_node->previous_cost = new_node.previous_cost;
-              existing_node->total_cost = existing_node->previous_cost + existing_node->heuristic;
-              existing_node->parent_index = index;
-              open_list_indices.sort();
-            }
-          }
-        }
-        else {
-          //std::cout << "skipping node in direction " << i << ": already in closed list = "
-          //  << in_closed_list << ", too far from target = "
-          //  << (get_manhattan_distance(new_node.location, target) >= 200) << ", invalid transition = "
-          //  << (!is_node_transition_valid(*current_node, i)) << std::endl;
-        }
-      }
-      if (open_list_indices.empty()) {
-        finished = true;
-      }
+      continue;
     }
+    open_list.push_back({ new_node.total_cost, workspace.next_order++, new_index });
+    std::push_heap(open_list.begin(), open_list.end());
   }
-
-  //std::cout << "path found: " << path << ", open nodes: " << open_list.size() << ", closed nodes: " << closed_list.size() << std::endl;
-  return path;
 }
 
 /**
- * \brief Returns the index of the 8*8 square in the map
- * corresponding to the specified location.
- * \param location location of a node on the map
- * \return index of the square corresponding to the top-left part of the location
+ * \brief Returns the index of the node at the specified location.
+ * \param[in] location location of a node on the map, multiple of 8
+ * \param[out] index index of the node in the node array
+ * \return \c false if the location is too far outside the map to be in
+ * the node array
  */
-int PathFinding::get_square_index(const Point& location) const {
+bool PathFinding::get_node_index(const Point& location, int& index) const {
 
-  const int x8 = location.x / 8;
-  const int y8 = location.y / 8;
-  return y8 * map.get_width8() + x8;
+  const int column = location.x / 8 + margin;
+  const int row = location.y / 8 + margin;
+  if (column < 0 || column >= columns || row < 0 || row >= rows) {
+    return false;
+  }
+  index = row * columns + column;
+  return true;
 }
 
 /**
- * \brief Compares two nodes according to their total estimated cost.
- * \param other the other node
+ * \brief Returns the location of a node on the map.
+ * \param index index of the node in the node array
+ * \return the location of the node
  */
-bool PathFinding::Node::operator<(const Node& other) const {
-  return total_cost < other.total_cost;
+Point PathFinding::get_node_location(int index) const {
+
+  return Point(
+      (index % columns - margin) * 8,
+      (index / columns - margin) * 8
+  );
 }
 
 /**
- * \brief Adds the index of a node to the sorted list of indices of the open
- * list, making sure that the list remains sorted.
- * \param node The node.
+ * \brief Compares two entries of the open list.
+ * \param other the other entry
+ * \return \c true if this entry should be picked after the other one
  */
-void PathFinding::add_index_sorted(Node* node) {
-
-  bool inserted = false;
-  for (auto it = open_list_indices.begin();
-      it != open_list_indices.end() && !inserted;
-      ++it) {
-    const int index = *it;
-    const Node* current_node = &open_list[index];
-    if (current_node->total_cost >= node->total_cost) {
-      open_list_indices.insert(it, node->index);
-      inserted = true;
-    }
-  }
+bool PathFinding::OpenEntry::operator<(const OpenEntry& other) const {
 
-  if (!inserted) {
-    open_list_indices.push_back(node->index);
+  if (total_cost != other.total_cost) {
+    return total_cost > other.total_cost;
   }
+  return order < other.order;
 }
 
 /**
  * \brief Builds the string representation of the path found by the algorithm.
- * \param closed_list The closed list of A*.
- * \return final_node The final node of the path.
+ * \param final_index Index of the final node of the path.
+ * \return The path.
  */
-std::string PathFinding::rebuild_path(const Node* final_node) {
+std::string PathFinding::rebuild_path(int final_index) const {
 
-  const Node* current_node = final_node;
-  std::string path = "";
+  const std::vector<Node>& nodes = workspace.nodes;
+  std::string path;
+  const Node* current_node = &nodes[final_index];
   while (current_node->direction != ' ') {
-    path = current_node->direction + path;
-    current_node = &closed_list[current_node->parent_index];
-    //std::cout << "current_node: " << current_node->index << ", path = " << path << std::endl;
+    path += current_node->direction;
+    current_node = &nodes[current_node->parent_index];
   }
+  std::reverse(path.begin(), path.end());
   return path;
 }
 
 /**
  * \brief Returns whether a transition between two nodes is valid, i.e.
  * whether there is no collision with the map.
- * \param initial_node the first node
+ *
+ * The result is remembered until the next call to start().
+ *
+ * \param index index of the first node
  * \param direction the direction to take (0 to 7)
  * \return true if there is no collision for this transition
  */
-bool PathFinding::is_node_transition_valid(
-    const Node& initial_node, int direction) const {
+bool PathFinding::is_node_transition_valid(int index, int direction) {
 
-  Rectangle collision_box = transition_collision_boxes[direction];
-  collision_box.add_xy(initial_node.location);
+  Node& node = workspace.nodes[index];
+  if (node.transitions_search != workspace.current_transitions_search) {
+    node.transitions_search = workspace.current_transitions_search;
+    node.known_transitions = 0;
+    node.valid_transitions = 0;
+  }
 
-  return !map.test_collision_with_obstacles(source_entity.get_layer(), collision_box, source_entity);
-}
+  const uint8_t bit = static_cast<uint8_t>(1 << direction);
+  if ((node.known_transitions & bit) == 0) {
+    Rectangle collision_box = transition_collision_boxes[direction];
+    collision_box.add_xy(get_node_location(index));
+
+    // Most of the time, the walkability grid is enough to test the terrain.
+    const int layer = source_entity.get_layer();
+    bool collision = false;
+    switch (map.get_entities().get_walkability_grid().test_collision(
+        layer, collision_box, ground_obstacles)) {
+
+      case WalkabilityGrid::Result::FREE:
+        collision = map.test_collision_with_entities(layer, collision_box, source_entity);
+        break;
 
+      case WalkabilityGrid::Result::OBSTACLE:
+        collision = true;
+        break;
+
+      case WalkabilityGrid::Result::UNKNOWN:
+        collision = map.test_collision_with_obstacles(layer, collision_box, source_entity);
+        break;
+    }
+
+    node.known_transitions |= bit;
+    if (!collision) {
+      node.valid_transitions |= bit;
+    }
+  }
+
+  return (node.valid_transitions & bit) != 0;
 }
 
+}
@@ -15,12 +15,13 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/core/Debug.h"
+#include "solarus/core/Map.h"
 #include "solarus/core/Random.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
-#include "solarus/movements/PathFinding.h"
 #include "solarus/movements/PathFindingMovement.h"
+#include "solarus/movements/PathFindingScheduler.h"
 
 namespace Solarus {
 
@@ -31,10 +32,20 @@ namespace Solarus {
 PathFindingMovement::PathFindingMovement(int speed):
   PathMovement("", speed, false, false, true),
   target(),
-  next_recomputation_date(0) {
+  next_recomputation_date(0),
+  path_requested(false),
+  use_flow_field(false) {
 
 }
 
+/**
+ * \brief Returns the entity targeted by this movement.
+ * \return The target, or nullptr.
+ */
+const EntityPtr& PathFindingMovement::get_target() const {
+  return target;
+}
+
 /**
  * \brief Sets the entity to target with this movement.
  */
@@ -42,6 +53,30 @@ void PathFindingMovement::set_target(const EntityPtr& target) {
 
   this->target = target;
   next_recomputation_date = System::now() + 100;
+  path_requested = false;  // A path to the previous target is obsolete.
+}
+
+/**
+ * \brief Returns whether paths are sampled from a flow field.
+ * \return \c true if this movement uses a flow field.
+ */
+bool PathFindingMovement::get_use_flow_field() const {
+  return use_flow_field;
+}
+
+/**
+ * \brief Sets whether paths are sampled from a flow field.
+ *
+ * A flow field toward the target is shared by all entities of the map
+ * that chase the same target and have the same ground obstacles.
+ * Reading a path from it is immediate, but dynamic entities that are
+ * obstacles are ignored.
+ *
+ * \param use_flow_field \c true to use a flow field, \c false to compute
+ * paths with the A* algorithm.
+ */
+void PathFindingMovement::set_use_flow_field(bool use_flow_field) {
+  this->use_flow_field = use_flow_field;
 }
 
 /**
@@ -53,13 +88,14 @@ void PathFindingMovement::update() {
 
   if (target != nullptr && target->is_being_removed()) {
     target = nullptr;
+    path_requested = false;
   }
 
   if (is_suspended()) {
     return;
   }
 
-  if (PathMovement::is_finished()) {
+  if (PathMovement::is_finished() && !path_requested) {
 
     // there was a collision or the path was made
     if (target != nullptr
@@ -74,34 +110,76 @@ void PathFindingMovement::update() {
 }
 
 /**
- * \brief Calculates the direction and the speed of the movement
- * depending on the target.
+ * \brief Asks the path finding scheduler of the map to compute a path
+ * to the target.
+ *
+ * The entity stays still until notify_path_ready() is called.
+ * With a flow field, the path is known immediately.
  */
 void PathFindingMovement::recompute_movement() {
 
-  if (target != nullptr) {
-    PathFinding path_finding(get_entity()->get_map(), *get_entity(), *target);
-    std::string path = path_finding.compute_path();
+  Entity* entity = get_entity();
+  if (target != nullptr && entity != nullptr) {
+    if (use_flow_field) {
+      FlowField& flow_field = entity->get_map().get_flow_field(target, *entity);
+      notify_path_ready(flow_field.get_path(entity->get_top_left_xy()));
+      return;
+    }
 
-    uint32_t min_delay;
-    if (path.size() == 0) {
-      // the target is too far or there is no path
-      path = create_random_path();
+    entity->get_map().get_path_finding_scheduler().request(
+        std::static_pointer_cast<PathFindingMovement>(shared_from_this()),
+        std::static_pointer_cast<Entity>(entity->shared_from_this()),
+        target
+    );
+    path_requested = true;
+  }
+}
 
-      // no path was found: no need to try again very soon
-      // (note that the A* algorithm is very costly when it explores all nodes without finding a solution)
-      min_delay = 3000;
-    }
-    else {
-      // a path was found: we need to update it frequently (and the A* algorithm is much faster in general when there is a solution)
-      min_delay = 300;
-    }
-    // compute a new path every random delay to avoid
-    // having all path-finding entities of the map compute a path at the same time
-    next_recomputation_date = System::now() + min_delay + Random::get_number(200);
+/**
+ * \brief Notifies this movement that the path it requested was computed.
+ * \param path The path found, or an empty string if the target is too far
+ * or if there is no path.
+ */
+void PathFindingMovement::notify_path_ready(const std::string& path) {
 
-    set_path(path);
+  path_requested = false;
+
+  std::string new_path = path;
+  uint32_t min_delay;
+  if (new_path.size() == 0) {
+    // the target is too far or there is no path
+    new_path = create_random_path();
+
+    // no path was found: no need to try again very soon
+    // (note that the A* algorithm is very costly when it explores all nodes without finding a solution)
+    min_delay = 3000;
   }
+  else {
+    // a path was found: we need to update it frequently (and the A* algorithm is much faster in general when there is a solution)
+    min_delay = 300;
+  }
+  // compute a new path every random delay to avoid
+  // having all path-finding entities of the map compute a path at the same time
+  next_recomputation_date = System::now() + min_delay +
+      Random::get_stream(Random::Subsystem::MOVEMENTS).get_number(200);
+
+  set_path(new_path);
+
+  LuaContext* lua_context = get_lua_context();
+  if (lua_context != nullptr && are_lua_notifications_enabled()) {
+    lua_context->movement_on_path_ready(*this, path);
+  }
+}
+
+/**
+ * \brief Notifies this movement that the path it requested will not be
+ * computed.
+ *
+ * A new path will be requested at the next cycle if possible.
+ */
+void PathFindingMovement::notify_path_cancelled() {
+
+  path_requested = false;
 }
 
 /**
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Map.h"
+#include "solarus/core/PerfTrace.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/movements/PathFindingMovement.h"
+#include "solarus/movements/PathFindingScheduler.h"
+
+namespace Solarus {
+
+constexpr int PathFindingScheduler::max_expansions_per_cycle;
+
+/**
+ * \brief Creates a scheduler with no request.
+ * \param map The map where paths are computed.
+ */
+PathFindingScheduler::PathFindingScheduler(Map& map):
+  map(map),
+  requests(),
+  current_search(),
+  workspace() {
+
+}
+
+/**
+ * \brief Adds a path to compute.
+ *
+ * The movement will be notified with
+ * PathFindingMovement::notify_path_ready() when the path is computed.
+ *
+ * \param movement The movement that needs a path.
+ * \param source The entity to move (its position must be aligned on the map grid).
+ * \param target The entity to reach.
+ */
+void PathFindingScheduler::request(
+    const std::shared_ptr<PathFindingMovement>& movement,
+    const EntityPtr& source,
+    const EntityPtr& target) {
+
+  requests.push_back({ movement, source, target });
+}
+
+/**
+ * \brief Cancels all requests without notifying their movements.
+ */
+void PathFindingScheduler::clear() {
+
+  current_search = nullptr;
+  requests.clear();
+}
+
+/**
+ * \brief Returns the number of requests not delivered yet.
+ * \return The number of pending requests.
+ */
+int PathFindingScheduler::get_num_requests() const {
+  return static_cast<int>(requests.size());
+}
+
+/**
+ * \brief Returns whether a request can be processed now.
+ * \param request A request whose movement still exists.
+ * \return \c false if one of the entities is gone or if the source entity
+ * is no longer aligned on the map grid.
+ */
+bool PathFindingScheduler::is_request_valid(const Request& request) const {
+
+  return request.source->is_aligned_to_grid() &&
+      !request.source->is_being_removed() &&
+      !request.target->is_being_removed();
+}
+
+/**
+ * \brief Makes the current requests progress.
+ *
+ * Expands at most max_expansions_per_cycle nodes and delivers the paths
+ * that are finished.
+ */
+void PathFindingScheduler::update() {
+
+  if (requests.empty()) {
+    return;
+  }
+
+  PerfTrace::Scope trace_scope("path-finding-update");
+
+  int max_expansions = max_expansions_per_cycle;
+  while (!requests.empty() && max_expansions > 0) {
+
+    const Request& request = requests.front();
+    std::shared_ptr<PathFindingMovement> movement = request.movement.lock();
+    if (movement == nullptr || movement->get_target() != request.target) {
+      // Nobody is waiting for this path anymore.
+      current_search = nullptr;
+      requests.pop_front();
+      continue;
+    }
+
+    if (movement->get_entity() != request.source.get() ||
+        !is_request_valid(request)) {
+      // The movement will have to ask again.
+      current_search = nullptr;
+      requests.pop_front();
+      movement->notify_path_cancelled();
+      continue;
+    }
+
+    if (current_search == nullptr) {
+      current_search = std::unique_ptr<PathFinding>(new PathFinding(
+          map, *request.source, *request.target, workspace
+      ));
+      current_search->start();
+    }
+
+    if (!current_search->step(max_expansions)) {
+      // Out of budget for this cycle.
+      break;
+    }
+
+    // Pop the request before notifying the movement because
+    // the Lua event may make new requests.
+    const std::string path = current_search->get_path();
+    current_search = nullptr;
+    requests.pop_front();
+    movement->notify_path_ready(path);
+  }
+}
+
+}
+
@@ -287,10 +287,11 @@ void PathMovement::start_next_elementary_move() {
       // normal case: there is a next trajectory to do
 
       current_direction = remaining_path[0] - '0';
-      Debug::check_assertion(current_direction >= 0 && current_direction < 8,
-          std::string("Invalid path '") + initial_path + "' (bad direction '"
-          + remaining_path[0] + "')"
-      );
+      if (current_direction < 0 || current_direction >= 8) {
+        Debug::die(std::string("Invalid path '") + initial_path + "' (bad direction '"
+            + remaining_path[0] + "')"
+        );
+      }
 
       PixelMovement::set_delay(speed_to_delay(speed, current_direction));
       PixelMovement::set_trajectory(elementary_moves[current_direction]);
@@ -453,8 +454,9 @@ double PathMovement::get_angle() const {
  */
 std::string PathMovement::create_random_path() {
 
-  char c = '0' + (Random::get_number(4) * 2);
-  int length = Random::get_number(5) + 3;
+  RandomStream& random_stream = Random::get_stream(Random::Subsystem::MOVEMENTS);
+  char c = '0' + (random_stream.get_number(4) * 2);
+  int length = random_stream.get_number(5) + 3;
   std::string path = "";
   for (int i = 0; i < length; i++) {
     path += c;
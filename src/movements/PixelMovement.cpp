@@ -171,6 +171,7 @@ void PixelMovement::update() {
 
   uint32_t now = System::now();
 
+  begin_coalesced_moves();
   while (now >= next_move_date &&
       !is_suspended() &&
       !finished &&
@@ -184,6 +185,7 @@ void PixelMovement::update() {
       notify_obstacle_reached();
     }
   }
+  end_coalesced_moves();
 
   // Do this at last so that Movement::update() knows whether we are finished.
   Movement::update();
@@ -37,13 +37,30 @@ PlayerMovement::PlayerMovement(int moving_speed):
 
 }
 
+bool PlayerMovement::late_latch_enabled = false;
+
 /**
  * \brief Updates this movement.
  */
 void PlayerMovement::update() {
 
+  if (late_latch_enabled) {
+    // Use the direction pressed right now for this move
+    // rather than for the next one.
+    update_wanted_direction();
+  }
+
   StraightMovement::update();
 
+  update_wanted_direction();
+}
+
+/**
+ * \brief Follows the directional commands currently pressed if they have
+ * changed.
+ */
+void PlayerMovement::update_wanted_direction() {
+
   const Entity* entity = get_entity();
   if (entity == nullptr || !entity->is_on_map()) {
     return; // the entity is not ready yet
@@ -79,6 +96,29 @@ void PlayerMovement::update() {
   }
 }
 
+/**
+ * \brief Returns whether player movements read the wanted direction before
+ * moving at each update.
+ * \return \c true if late latch is enabled.
+ */
+bool PlayerMovement::is_late_latch_enabled() {
+  return late_latch_enabled;
+}
+
+/**
+ * \brief Sets whether player movements read the wanted direction before
+ * moving at each update.
+ *
+ * By default, the direction is read after moving, so a new direction only
+ * applies to the next update.
+ * With late latch, it applies one update sooner.
+ *
+ * \param late_latch_enabled \c true to enable late latch.
+ */
+void PlayerMovement::set_late_latch_enabled(bool late_latch_enabled) {
+  PlayerMovement::late_latch_enabled = late_latch_enabled;
+}
+
 /**
  * \brief Returns the direction this movement is trying to move towards.
  * \return the direction (0 to 7), or -1 if the player is not trying to go
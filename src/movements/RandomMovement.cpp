@@ -112,6 +112,7 @@ void RandomMovement::set_max_radius(int max_radius) {
  */
 void RandomMovement::set_next_direction() {
 
+  RandomStream& random_stream = Random::get_stream(Random::Subsystem::MOVEMENTS);
   set_speed(normal_speed);
 
   double angle;
@@ -120,7 +121,7 @@ void RandomMovement::set_next_direction() {
       || bounds.contains(get_xy())) {
 
     // we are inside the bounds (or there is no bound): pick a random direction
-    angle = Geometry::degrees_to_radians(Random::get_number(8) * 45 + 22.5);
+    angle = Geometry::degrees_to_radians(random_stream.get_number(8) * 45 + 22.5);
   }
   else {
 
@@ -129,7 +130,7 @@ void RandomMovement::set_next_direction() {
   }
   set_angle(angle);
 
-  next_direction_change_date = System::now() + 500 + Random::get_number(1500); // change again in 0.5 to 2 seconds
+  next_direction_change_date = System::now() + 500 + random_stream.get_number(1500); // change again in 0.5 to 2 seconds
 
   notify_movement_changed();
 }
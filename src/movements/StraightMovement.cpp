@@ -651,6 +651,15 @@ void StraightMovement::update() {
     bool x_move_now = x_move != 0 && now >= next_move_date_x;
     bool y_move_now = y_move != 0 && now >= next_move_date_y;
 
+    begin_coalesced_moves();
+    if (x_move_now && y_move == 0 && x_delay > 0) {
+      // Horizontal move: test obstacles for all steps of this update at once.
+      find_free_run(Point(x_move, 0), (now - next_move_date_x) / x_delay + 1);
+    }
+    else if (y_move_now && x_move == 0 && y_delay > 0) {
+      find_free_run(Point(0, y_move), (now - next_move_date_y) / y_delay + 1);
+    }
+
     while (x_move_now || y_move_now) { // while it's time to move
 
       if (is_smooth()) {
@@ -662,9 +671,11 @@ void StraightMovement::update() {
 
       now = System::now();
 
+      // Compare squared distances to avoid a square root at each step.
       if (!finished &&
           max_distance != 0 &&
-          Geometry::get_distance(initial_xy, get_xy()) >= max_distance) {
+          (max_distance < 0 ||
+           Geometry::get_distance2(initial_xy, get_xy()) >= max_distance * max_distance)) {
         set_finished();
       }
       else {
@@ -672,6 +683,7 @@ void StraightMovement::update() {
         y_move_now = y_move != 0 && now >= next_move_date_y;
       }
     }
+    end_coalesced_moves();
   }
 
   // Do this at last so that Movement::update() knows whether we are finished.
@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/core/Geometry.h"
+#include "solarus/core/Map.h"
 #include "solarus/core/System.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/lua/LuaContext.h"
@@ -72,7 +73,8 @@ TargetMovement::TargetMovement(
   moving_speed(moving_speed),
   next_recomputation_date(System::now()),
   finished(false),
-  recomputing_movement(false) {
+  recomputing_movement(false),
+  use_flow_field(false) {
 }
 
 /**
@@ -135,6 +137,28 @@ void TargetMovement::set_moving_speed(int moving_speed) {
   recompute_movement();
 }
 
+/**
+ * \brief Returns whether the direction is taken from a flow field.
+ * \return \c true if this movement uses a flow field.
+ */
+bool TargetMovement::get_use_flow_field() const {
+  return use_flow_field;
+}
+
+/**
+ * \brief Sets whether the direction is taken from a flow field.
+ *
+ * This only has an effect when the target is an entity of the same map.
+ * The movement then goes around walls instead of going straight to the
+ * target. Dynamic entities that are obstacles are ignored.
+ *
+ * \param use_flow_field \c true to use a flow field.
+ */
+void TargetMovement::set_use_flow_field(bool use_flow_field) {
+  this->use_flow_field = use_flow_field;
+  recompute_movement();
+}
+
 /**
  * \brief Updates the movement.
  */
@@ -176,6 +200,21 @@ void TargetMovement::recompute_movement() {
 
     double angle = Geometry::get_angle(get_xy(), target);
 
+    Entity* entity = get_entity();
+    if (use_flow_field &&
+        target_entity != nullptr &&
+        entity != nullptr &&
+        entity->is_on_map() &&
+        target_entity->is_on_map() &&
+        &target_entity->get_map() == &entity->get_map()) {
+      // Follow the flow field instead of going straight to the target.
+      FlowField& flow_field = entity->get_map().get_flow_field(target_entity, *entity);
+      const int direction8 = flow_field.get_direction8(entity->get_top_left_xy());
+      if (direction8 != -1) {
+        angle = direction8 * Geometry::PI_OVER_4;
+      }
+    }
+
     Point dxy = target - get_xy();
     sign_x = (dxy.x >= 0) ? 1 : -1;
     sign_y = (dxy.y >= 0) ? 1 : -1;
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2003 Maxim Stepin ( maxst@hiend3d.com )
+ *
+ * Copyright (C) 2010 Cameron Zemek ( grom@zeminvaders.net)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "hqx/common.h"
+#include "hqx/hqx.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define HQX_X86
+    #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define HQX_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__)
+    #define HQX_TARGET(x) __attribute__((target(x)))
+#else
+    #define HQX_TARGET(x)
+#endif
+
+/* Thresholds of yuv_diff, one byte per component */
+#define HQX_THRESHOLDS 0x00300706
+
+//   The pattern of a pixel w5 has one bit per neighbour that is different:
+//
+//   +----+----+----+
+//   |    |    |    |
+//   | w1 | w2 | w3 |      bit 0, 1, 2
+//   +----+----+----+
+//   |    |    |    |
+//   | w4 | w5 | w6 |      bit 3, -, 4
+//   +----+----+----+
+//   |    |    |    |
+//   | w7 | w8 | w9 |      bit 5, 6, 7
+//   +----+----+----+
+//
+//   Rows are given as YUV values with one extra pixel on each side.
+
+typedef void (*hqx_row_func)(const uint32_t *prev, const uint32_t *row, const uint32_t *next, int width, uint8_t *patterns);
+
+static inline uint8_t pattern_at(const uint32_t *prev, const uint32_t *row, const uint32_t *next, int i)
+{
+    uint32_t yuv = row[i];
+    return (uint8_t) (
+        yuv_diff(yuv, prev[i - 1]) |
+        yuv_diff(yuv, prev[i]) << 1 |
+        yuv_diff(yuv, prev[i + 1]) << 2 |
+        yuv_diff(yuv, row[i - 1]) << 3 |
+        yuv_diff(yuv, row[i + 1]) << 4 |
+        yuv_diff(yuv, next[i - 1]) << 5 |
+        yuv_diff(yuv, next[i]) << 6 |
+        yuv_diff(yuv, next[i + 1]) << 7);
+}
+
+static void row_patterns_scalar(const uint32_t *prev, const uint32_t *row, const uint32_t *next, int width, uint8_t *patterns)
+{
+    int i;
+    for (i = 0; i < width; i++)
+    {
+        patterns[i] = pattern_at(prev, row, next, i);
+    }
+}
+
+#ifdef HQX_X86
+
+/* Bit of the pattern if the component difference of a and center exceeds a threshold */
+#define HQX_DIFF_SSE2(a, bit) \
+    _mm_andnot_si128( \
+        _mm_cmpeq_epi32(_mm_subs_epu8(_mm_or_si128(_mm_subs_epu8(center, a), _mm_subs_epu8(a, center)), thresholds), zero), \
+        _mm_set1_epi32(bit))
+
+#define HQX_LOAD_SSE2(p) _mm_loadu_si128((const __m128i *) (p))
+
+HQX_TARGET("sse2")
+static void row_patterns_sse2(const uint32_t *prev, const uint32_t *row, const uint32_t *next, int width, uint8_t *patterns)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i thresholds = _mm_set1_epi32(HQX_THRESHOLDS);
+    int i;
+    for (i = 0; i + 4 <= width; i += 4)
+    {
+        const __m128i center = HQX_LOAD_SSE2(row + i);
+        __m128i pattern = HQX_DIFF_SSE2(HQX_LOAD_SSE2(prev + i - 1), 1);
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(prev + i), 2));
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(prev + i + 1), 4));
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(row + i - 1), 8));
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(row + i + 1), 16));
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(next + i - 1), 32));
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(next + i), 64));
+        pattern = _mm_or_si128(pattern, HQX_DIFF_SSE2(HQX_LOAD_SSE2(next + i + 1), 128));
+
+        pattern = _mm_packs_epi32(pattern, pattern);
+        pattern = _mm_packus_epi16(pattern, pattern);
+        int32_t bytes = _mm_cvtsi128_si32(pattern);
+        memcpy(patterns + i, &bytes, 4);
+    }
+    for (; i < width; i++)
+    {
+        patterns[i] = pattern_at(prev, row, next, i);
+    }
+}
+
+#define HQX_DIFF_AVX2(a, bit) \
+    _mm256_andnot_si256( \
+        _mm256_cmpeq_epi32(_mm256_subs_epu8(_mm256_or_si256(_mm256_subs_epu8(center, a), _mm256_subs_epu8(a, center)), thresholds), zero), \
+        _mm256_set1_epi32(bit))
+
+#define HQX_LOAD_AVX2(p) _mm256_loadu_si256((const __m256i *) (p))
+
+HQX_TARGET("avx2")
+static void row_patterns_avx2(const uint32_t *prev, const uint32_t *row, const uint32_t *next, int width, uint8_t *patterns)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i thresholds = _mm256_set1_epi32(HQX_THRESHOLDS);
+    int i;
+    for (i = 0; i + 8 <= width; i += 8)
+    {
+        const __m256i center = HQX_LOAD_AVX2(row + i);
+        __m256i pattern = HQX_DIFF_AVX2(HQX_LOAD_AVX2(prev + i - 1), 1);
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(prev + i), 2));
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(prev + i + 1), 4));
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(row + i - 1), 8));
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(row + i + 1), 16));
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(next + i - 1), 32));
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(next + i), 64));
+        pattern = _mm256_or_si256(pattern, HQX_DIFF_AVX2(HQX_LOAD_AVX2(next + i + 1), 128));
+
+        // Packing works within each 128-bit lane: each lane holds 4 patterns.
+        pattern = _mm256_packs_epi32(pattern, pattern);
+        pattern = _mm256_packus_epi16(pattern, pattern);
+        int32_t bytes = _mm_cvtsi128_si32(_mm256_castsi256_si128(pattern));
+        memcpy(patterns + i, &bytes, 4);
+        bytes = _mm_cvtsi128_si32(_mm256_extracti128_si256(pattern, 1));
+        memcpy(patterns + i + 4, &bytes, 4);
+    }
+    for (; i < width; i++)
+    {
+        patterns[i] = pattern_at(prev, row, next, i);
+    }
+}
+
+#endif
+
+#ifdef HQX_NEON
+
+#define HQX_DIFF_NEON(a, bit) \
+    vandq_u32( \
+        vtstq_u32(vreinterpretq_u32_u8(vcgtq_u8(vabdq_u8(center, vreinterpretq_u8_u32(a)), thresholds)), \
+                  vdupq_n_u32(0xFFFFFFFF)), \
+        vdupq_n_u32(bit))
+
+static void row_patterns_neon(const uint32_t *prev, const uint32_t *row, const uint32_t *next, int width, uint8_t *patterns)
+{
+    const uint8x16_t thresholds = vreinterpretq_u8_u32(vdupq_n_u32(HQX_THRESHOLDS));
+    int i;
+    for (i = 0; i + 4 <= width; i += 4)
+    {
+        const uint8x16_t center = vreinterpretq_u8_u32(vld1q_u32(row + i));
+        uint32x4_t pattern = HQX_DIFF_NEON(vld1q_u32(prev + i - 1), 1);
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(prev + i), 2));
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(prev + i + 1), 4));
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(row + i - 1), 8));
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(row + i + 1), 16));
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(next + i - 1), 32));
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(next + i), 64));
+        pattern = vorrq_u32(pattern, HQX_DIFF_NEON(vld1q_u32(next + i + 1), 128));
+
+        const uint16x4_t narrow = vmovn_u32(pattern);
+        const uint8x8_t bytes = vmovn_u16(vcombine_u16(narrow, narrow));
+        uint32_t value = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+        memcpy(patterns + i, &value, 4);
+    }
+    for (; i < width; i++)
+    {
+        patterns[i] = pattern_at(prev, row, next, i);
+    }
+}
+
+#endif
+
+static hqx_row_func row_patterns = row_patterns_scalar;
+
+HQX_API int HQX_CALLCONV hqxSetSimd(int simd)
+{
+    switch (simd)
+    {
+#ifdef HQX_X86
+        case HQX_SIMD_SSE2:
+            row_patterns = row_patterns_sse2;
+            return simd;
+        case HQX_SIMD_AVX2:
+            row_patterns = row_patterns_avx2;
+            return simd;
+#endif
+#ifdef HQX_NEON
+        case HQX_SIMD_NEON:
+            row_patterns = row_patterns_neon;
+            return simd;
+#endif
+        default:
+            row_patterns = row_patterns_scalar;
+            return HQX_SIMD_NONE;
+    }
+}
+
+/* Converts a row to YUV, repeating the first and last pixel on each side */
+static void yuv_row(const uint32_t *sp, int Xres, uint32_t *yuv)
+{
+    int i;
+    for (i = 0; i < Xres; i++)
+    {
+        yuv[i + 1] = rgb_to_yuv(sp[i]);
+    }
+    yuv[0] = yuv[1];
+    yuv[Xres + 1] = yuv[Xres];
+}
+
+uint8_t *hqx_patterns(const uint32_t *sp, int spL, int Xres, int Yres, int first_row, int num_rows)
+{
+    int j;
+    const int yuvL = Xres + 2;
+    const int end_row = first_row + num_rows;
+    uint8_t *patterns;
+    uint32_t *yuv;
+
+    if (Xres <= 0 || num_rows <= 0 || first_row < 0 || end_row > Yres)
+    {
+        return NULL;
+    }
+
+    patterns = (uint8_t *) malloc((size_t) Xres * num_rows);
+    // The YUV values of three consecutive rows, the one of row j in slot j % 3.
+    yuv = (uint32_t *) malloc(sizeof(uint32_t) * 3 * yuvL);
+    if (patterns == NULL || yuv == NULL)
+    {
+        free(patterns);
+        free(yuv);
+        return NULL;
+    }
+
+    if (first_row > 0)
+    {
+        yuv_row(sp + (first_row - 1) * spL, Xres, yuv + ((first_row - 1) % 3) * yuvL);
+    }
+    yuv_row(sp + first_row * spL, Xres, yuv + (first_row % 3) * yuvL);
+    for (j = first_row; j < end_row; j++)
+    {
+        if (j < Yres - 1)
+        {
+            yuv_row(sp + (j + 1) * spL, Xres, yuv + ((j + 1) % 3) * yuvL);
+        }
+
+        row_patterns(
+            yuv + ((j > 0 ? j - 1 : j) % 3) * yuvL + 1,
+            yuv + (j % 3) * yuvL + 1,
+            yuv + ((j < Yres - 1 ? j + 1 : j) % 3) * yuvL + 1,
+            Xres,
+            patterns + (size_t) (j - first_row) * Xres);
+    }
+
+    free(yuv);
+    return patterns;
+}
@@ -26,6 +26,16 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 	#error "Requires that int type have at least 32 bits"
 #endif
 
+// Vectorized echo FIR. Define SPC_DSP_NO_SIMD to use the portable code only.
+#if !defined (SPC_DSP_NO_SIMD) && (defined (__SSE2__) || defined (_M_X64) || \
+		(defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define SPC_DSP_SSE2 1
+	#include <emmintrin.h>
+#elif !defined (SPC_DSP_NO_SIMD) && (defined (__ARM_NEON) || defined (__ARM_NEON__))
+	#define SPC_DSP_NEON 1
+	#include <arm_neon.h>
+#endif
+
 
 // TODO: add to blargg_endian.h
 #define GET_LE16SA( addr )      ((BOOST::int16_t) GET_LE16( addr ))
@@ -181,6 +191,97 @@ inline void SPC_DSP::run_counter( int i )
 	(*m.counter_select [rate] & counter_mask [rate])
 
 
+//// Echo FIR
+
+// Whether run() uses the vectorized FIR when there is one
+static bool simd_enabled = true;
+
+void SPC_DSP::set_simd_enabled( bool enabled ) { simd_enabled = enabled; }
+
+// FIR coefficients, in the order of echo_hist_pos [0 to 7]
+struct echo_fir_t
+{
+	int taps [SPC_DSP::echo_hist_size];
+#if SPC_DSP_SSE2
+	// Pairs of taps, repeated for left and right after the shuffle in echo_fir_simd()
+	__m128i lo;
+	__m128i hi;
+#elif SPC_DSP_NEON
+	int32x4_t lo;
+	int32x4_t hi;
+#endif
+};
+
+static void load_echo_fir( echo_fir_t* fir, BOOST::uint8_t const* regs )
+{
+	// Newest sample uses the last coefficient
+	for ( int i = 0; i < SPC_DSP::echo_hist_size; i++ )
+		fir->taps [i] = (BOOST::int8_t) regs [SPC_DSP::r_fir + ((i + 7) & 7) * 0x10];
+	
+	#if SPC_DSP_SSE2
+		int const* const taps = fir->taps;
+		fir->lo = _mm_setr_epi16( (short) taps [0], (short) taps [1], (short) taps [0], (short) taps [1],
+				(short) taps [2], (short) taps [3], (short) taps [2], (short) taps [3] );
+		fir->hi = _mm_setr_epi16( (short) taps [4], (short) taps [5], (short) taps [4], (short) taps [5],
+				(short) taps [6], (short) taps [7], (short) taps [6], (short) taps [7] );
+	#elif SPC_DSP_NEON
+		fir->lo = vld1q_s32( (int32_t const*) fir->taps + 0 );
+		fir->hi = vld1q_s32( (int32_t const*) fir->taps + 4 );
+	#endif
+}
+
+// Both versions return the same sums for any history and coefficients
+
+static inline void echo_fir_scalar( echo_fir_t const* fir, int const (*hist) [2],
+		int* out_l, int* out_r )
+{
+	int l = 0;
+	int r = 0;
+	for ( int i = 0; i < SPC_DSP::echo_hist_size; i++ )
+	{
+		l += hist [i] [0] * fir->taps [i];
+		r += hist [i] [1] * fir->taps [i];
+	}
+	*out_l = l;
+	*out_r = r;
+}
+
+#if SPC_DSP_SSE2
+static inline void echo_fir_simd( echo_fir_t const* fir, int const (*hist) [2],
+		int* out_l, int* out_r )
+{
+	// History samples are 16-bit: pack them, then multiply-add
+	// consecutive taps of the same channel. Integer sums are exact,
+	// so the order of additions does not change the result.
+	__m128i const* const in = (__m128i const*) hist;
+	__m128i lo = _mm_packs_epi32( _mm_loadu_si128( in + 0 ), _mm_loadu_si128( in + 1 ) );
+	__m128i hi = _mm_packs_epi32( _mm_loadu_si128( in + 2 ), _mm_loadu_si128( in + 3 ) );
+	// L0 R0 L1 R1 -> L0 L1 R0 R1
+	lo = _mm_shufflehi_epi16( _mm_shufflelo_epi16( lo, _MM_SHUFFLE( 3, 1, 2, 0 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+	hi = _mm_shufflehi_epi16( _mm_shufflelo_epi16( hi, _MM_SHUFFLE( 3, 1, 2, 0 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+	__m128i sum = _mm_add_epi32( _mm_madd_epi16( lo, fir->lo ), _mm_madd_epi16( hi, fir->hi ) );
+	sum = _mm_add_epi32( sum, _mm_srli_si128( sum, 8 ) );
+	*out_l = _mm_cvtsi128_si32( sum );
+	*out_r = _mm_cvtsi128_si32( _mm_srli_si128( sum, 4 ) );
+}
+#elif SPC_DSP_NEON
+static inline void echo_fir_simd( echo_fir_t const* fir, int const (*hist) [2],
+		int* out_l, int* out_r )
+{
+	// Deinterleave left and right, then multiply-accumulate.
+	int32x4x2_t const lo = vld2q_s32( (int32_t const*) &hist [0] [0] );
+	int32x4x2_t const hi = vld2q_s32( (int32_t const*) &hist [4] [0] );
+	int32x4_t const sum_l = vmlaq_s32( vmulq_s32( lo.val [0], fir->lo ), hi.val [0], fir->hi );
+	int32x4_t const sum_r = vmlaq_s32( vmulq_s32( lo.val [1], fir->lo ), hi.val [1], fir->hi );
+	int32x2_t const sum = vpadd_s32(
+			vpadd_s32( vget_low_s32( sum_l ), vget_high_s32( sum_l ) ),
+			vpadd_s32( vget_low_s32( sum_r ), vget_high_s32( sum_r ) ) );
+	*out_l = vget_lane_s32( sum, 0 );
+	*out_r = vget_lane_s32( sum, 1 );
+}
+#endif
+
+
 //// Emulation
 
 void SPC_DSP::run( int clock_count )
@@ -202,6 +303,10 @@ void SPC_DSP::run( int clock_count )
 	if ( mvoll * mvolr < m.surround_threshold )
 		mvoll = -mvoll; // eliminate surround
 	
+	// Echo FIR coefficients. Registers are only written between calls to run().
+	echo_fir_t echo_fir;
+	load_echo_fir( &echo_fir, m.regs );
+	
 	do
 	{
 		// KON/KOFF reading
@@ -567,24 +672,12 @@ skip_brr:
 		echo_hist_pos [0] [0] = echo_hist_pos [8] [0] = echo_in_l;
 		echo_hist_pos [0] [1] = echo_hist_pos [8] [1] = echo_in_r;
 		
-		#define CALC_FIR_( i, in )  ((in) * (int8_t) REG(fir + i * 0x10))
-		echo_in_l = CALC_FIR_( 7, echo_in_l );
-		echo_in_r = CALC_FIR_( 7, echo_in_r );
-		
-		#define CALC_FIR( i, ch )   CALC_FIR_( i, echo_hist_pos [i + 1] [ch] )
-		#define DO_FIR( i )\
-			echo_in_l += CALC_FIR( i, 0 );\
-			echo_in_r += CALC_FIR( i, 1 );
-		DO_FIR( 0 );
-		DO_FIR( 1 );
-		DO_FIR( 2 );
-		#if defined (__MWERKS__) && __MWERKS__ < 0x3200
-			__eieio(); // keeps compiler from stupidly "caching" things in memory
-		#endif
-		DO_FIR( 3 );
-		DO_FIR( 4 );
-		DO_FIR( 5 );
-		DO_FIR( 6 );
+	#if SPC_DSP_SSE2 || SPC_DSP_NEON
+		if ( simd_enabled )
+			echo_fir_simd( &echo_fir, echo_hist_pos, &echo_in_l, &echo_in_r );
+		else
+	#endif
+			echo_fir_scalar( &echo_fir, echo_hist_pos, &echo_in_l, &echo_in_r );
 		
 		// Echo out
 		if ( !(REG(flg) & 0x20) )
@@ -0,0 +1,88 @@
+# Sources in the 'src/benchmarks' directory that are a benchmark with a main() function
+list(APPEND BENCHMARK_SOURCES
+  src/benchmarks/DataFiles.cpp
+  src/benchmarks/PathFinding.cpp
+  src/benchmarks/PixelBits.cpp
+  src/benchmarks/Quadtree.cpp
+  src/benchmarks/Scene.cpp
+)
+
+# Maps of the testing quest that are benchmark scenes
+list(APPEND BENCHMARK_SCENE_MAPS
+  "benchmarks/long_dialog"
+  "benchmarks/lua_events"
+  "benchmarks/many_enemies"
+  "benchmarks/particles"
+)
+
+# Directory of JSON results of an earlier run to compare with, if any
+set(SOLARUS_BENCHMARK_BASELINE_DIR "" CACHE PATH "Directory of baseline benchmark results")
+
+# Maximum slowdown allowed compared to the baseline
+set(SOLARUS_BENCHMARK_THRESHOLD "1.25" CACHE STRING "Maximum benchmark slowdown allowed compared to the baseline")
+
+set(BENCHMARK_OUTPUT_DIR "${CMAKE_CURRENT_BINARY_DIR}/benchmarks")
+set(BENCHMARK_COMMANDS "")
+set(BENCHMARK_TARGETS "")
+
+# Adds a command that runs a benchmark and writes its results to <output_name>.json
+function(_add_benchmark_command BENCHMARK_TARGET OUTPUT_NAME)
+  set(COMMAND_ARGS
+    -no-audio -no-video -turbo=yes
+    "-benchmark-output=${BENCHMARK_OUTPUT_DIR}/${OUTPUT_NAME}.json"
+    "-benchmark-threshold=${SOLARUS_BENCHMARK_THRESHOLD}"
+  )
+  if(SOLARUS_BENCHMARK_BASELINE_DIR)
+    list(APPEND COMMAND_ARGS "-benchmark-baseline=${SOLARUS_BENCHMARK_BASELINE_DIR}/${OUTPUT_NAME}.json")
+  endif()
+  list(APPEND BENCHMARK_COMMANDS
+    COMMAND "$<TARGET_FILE:${BENCHMARK_TARGET}>" ${COMMAND_ARGS} ${ARGN} "${CMAKE_CURRENT_SOURCE_DIR}/testing_quest"
+  )
+  set(BENCHMARK_COMMANDS ${BENCHMARK_COMMANDS} PARENT_SCOPE)
+endfunction(_add_benchmark_command)
+
+# Add all available benchmark executables
+foreach(BENCHMARK_SOURCE ${BENCHMARK_SOURCES})
+  # Generate benchmark name and executable target
+  # Example: source=PathFinding.cpp, name=path-finding, target=solarus-benchmark-path-finding
+  get_filename_component(BENCHMARK_NAME ${BENCHMARK_SOURCE} NAME_WE)
+  string(REGEX REPLACE "(.)([A-Z][a-z]+)" "\\1-\\2" BENCHMARK_NAME "${BENCHMARK_NAME}")
+  string(TOLOWER "${BENCHMARK_NAME}" BENCHMARK_NAME)
+  set(BENCHMARK_TARGET "solarus-benchmark-${BENCHMARK_NAME}")
+
+  # Add benchmark executable and link to solarus-testing library
+  add_executable(${BENCHMARK_TARGET} "")
+  target_sources(${BENCHMARK_TARGET}
+    PRIVATE
+      "${CMAKE_CURRENT_SOURCE_DIR}/${BENCHMARK_SOURCE}"
+  )
+  target_link_libraries(${BENCHMARK_TARGET}
+    PUBLIC
+      solarus-testing
+      SDL2::Main
+  )
+  set_target_properties(${BENCHMARK_TARGET} PROPERTIES
+    RUNTIME_OUTPUT_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/bin"
+  )
+  list(APPEND BENCHMARK_TARGETS ${BENCHMARK_TARGET})
+
+  if (${BENCHMARK_NAME} STREQUAL "scene")
+    # Scene benchmark: run each scene map
+    foreach(MAP_ID ${BENCHMARK_SCENE_MAPS})
+      string(REPLACE "/" "-" OUTPUT_NAME "${MAP_ID}")
+      _add_benchmark_command(${BENCHMARK_TARGET} "scene-${OUTPUT_NAME}" "-map=${MAP_ID}")
+    endforeach()
+  else()
+    _add_benchmark_command(${BENCHMARK_TARGET} "${BENCHMARK_NAME}")
+  endif()
+endforeach()
+
+# Target that runs all benchmarks, and fails if one regressed compared to the baseline
+add_custom_target(solarus-benchmarks
+  COMMAND ${CMAKE_COMMAND} -E make_directory "${BENCHMARK_OUTPUT_DIR}"
+  ${BENCHMARK_COMMANDS}
+  DEPENDS ${BENCHMARK_TARGETS}
+  WORKING_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}"
+  COMMENT "Running benchmarks, results in ${BENCHMARK_OUTPUT_DIR}"
+  VERBATIM
+)
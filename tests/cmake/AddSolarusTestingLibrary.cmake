@@ -3,9 +3,11 @@
 add_library(solarus-testing "")
 target_sources(solarus-testing
   PUBLIC
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/tools/Benchmark.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/tools/TestEnvironment.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/tools/TestEnvironment.inl"
   PRIVATE
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/tools/Benchmark.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/tools/TestEnvironment.cpp"
 )
 
@@ -2,11 +2,72 @@
 list(APPEND LUA_TEST_MAPS
   "all_entities"
   "basic_test"
+  "binary_savegame"
+  "collision_batching"
+  "collision_filters"
+  "create_entities"
+  "crystal_block_overlaps"
+  "custom_entity_native_collisions"
+  "draw_list_tests"
+  "drawable_list"
   "dynamic_tile_tests"
+  "enemy_attack_consequences"
+  "entity_name_reuse"
+  "entity_prefix_queries"
+  "entity_queries"
+  "entity_update_policy"
+  "ffi_accessors"
+  "file_async"
+  "flow_field"
+  "frame_stats"
+  "game_command_bindings"
+  "game_value_changed"
+  "ground_obstacle_bits"
+  "ground_observers"
+  "ground_regions"
+  "hero_sprite_composition"
+  "image_cache"
+  "item_updates"
   "jumper_tests"
+  "language_preload"
+  "lua_event_batching"
+  "lua_event_inheritance"
+  "lua_event_tracking"
+  "lua_profiler"
+  "lua_workers"
+  "map_cache"
+  "map_chunks"
+  "memory_report"
+  "menu_events"
+  "movement_coalesce_moves"
+  "movement_free_run"
+  "movement_system"
   "surface_tests"
+  "occlusion_culling"
   "oriented_collisions"
+  "parallel_update"
+  "path_finding_scheduler"
+  "pixel_buffer_tests"
+  "post_effects"
+  "preload_map"
+  "room_activation"
+  "save_async"
+  "savegame_value_handles"
+  "script_cache"
+  "separator_regions"
+  "shader_resolution"
+  "sound_voices"
+  "sprite_animation_lod"
+  "sprite_draw_region"
+  "sprite_palettes"
+  "sprite_schedule"
+  "stream_field"
+  "task_scheduler"
   "text_predict"
+  "timer_queue"
+  "transition_effects"
+  "userdata_slots"
+  "userdata_type_checks"
   "custom_state/can_traverse"
   "custom_state/can_traverse_ground"
   "custom_state/carried_object"
@@ -1,13 +1,38 @@
 # Sources in the 'src/tests' directory that are a test with a main() function
 list(APPEND TEST_SOURCES
+  src/tests/Assertions.cpp
+  src/tests/FlatQuadtree.cpp
+  src/tests/FlatStringMap.cpp
+  src/tests/Geometry.cpp
+  src/tests/HitchDetector.cpp
   src/tests/Initialization.cpp
+  src/tests/InputReplay.cpp
+  src/tests/JobSystem.cpp
+  src/tests/KtxImage.cpp
   src/tests/MapData.cpp
+  src/tests/MonotonicArena.cpp
+  src/tests/MotionIntegrator.cpp
+  src/tests/MpscQueue.cpp
   src/tests/LanguageData.cpp
+  src/tests/LauncherChannel.cpp
+  src/tests/LuaAllocator.cpp
   src/tests/PathFinding.cpp
   src/tests/PathMovement.cpp
+  src/tests/PcmCache.cpp
+  src/tests/PixelBits.cpp
+  src/tests/PixelFilters.cpp
   src/tests/PixelMovement.cpp
+  src/tests/PoolAllocator.cpp
   src/tests/Quadtree.cpp
+  src/tests/QuestDatabase.cpp
+  src/tests/QuestFileIndex.cpp
+  src/tests/RandomStream.cpp
+  src/tests/SpcDecoder.cpp
+  src/tests/SpriteAnimationSet.cpp
   src/tests/SpriteData.cpp
+  src/tests/SpscQueue.cpp
+  src/tests/StartupTasks.cpp
+  src/tests/Symbol.cpp
   src/tests/TilesetData.cpp
   src/tests/ShaderData.cpp
   src/tests/LuaMap.cpp
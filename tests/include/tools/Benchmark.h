@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BENCHMARK_H
+#define SOLARUS_BENCHMARK_H
+
+#include "solarus/core/Common.h"
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class TestEnvironment;
+
+/**
+ * \brief Measures the duration of benchmark cases and reports them.
+ *
+ * Results are written as JSON to the file given by -benchmark-output,
+ * or to the standard output.
+ * If -benchmark-baseline gives the JSON results of an earlier run,
+ * each case is compared to it and finish() fails when a case is slower
+ * than the baseline multiplied by -benchmark-threshold (default 1.25).
+ */
+class Benchmark {
+
+  public:
+
+    Benchmark(TestEnvironment& env, const std::string& name);
+
+    template<typename Function>
+    void run(const std::string& case_name, int iterations, Function function);
+
+    void add_result(const std::string& case_name, int iterations, double total_ms);
+    int finish();
+
+  private:
+
+    /**
+     * \brief Measured duration of a case.
+     */
+    struct Result {
+      std::string case_name;    /**< Name of the case. */
+      int iterations;           /**< Number of iterations measured. */
+      double total_ms;          /**< Total duration in milliseconds. */
+      double mean_us;           /**< Mean duration of an iteration in microseconds. */
+    };
+
+    bool load_baseline(const std::string& file_name);
+    std::string to_json() const;
+
+    std::string name;                     /**< Name of this benchmark. */
+    std::string output_file_name;         /**< JSON output file or empty for stdout. */
+    double threshold;                     /**< Maximum slowdown allowed compared to the baseline. */
+    std::vector<Result> results;          /**< Results of the cases run. */
+    std::map<std::string, double>
+        baseline;                         /**< Mean duration of each case in the baseline. */
+};
+
+/**
+ * \brief Runs a benchmark case and records its duration.
+ *
+ * The function is called a few times before measuring, to warm caches up.
+ *
+ * \param case_name Name of the case.
+ * \param iterations Number of calls to measure.
+ * \param function The function to call at each iteration.
+ */
+template<typename Function>
+void Benchmark::run(const std::string& case_name, int iterations, Function function) {
+
+  using Clock = std::chrono::steady_clock;
+
+  const int num_warmup_iterations = iterations < 10 ? 1 : iterations / 10;
+  for (int i = 0; i < num_warmup_iterations; ++i) {
+    function();
+  }
+
+  const Clock::time_point start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    function();
+  }
+  const std::chrono::duration<double, std::milli> duration = Clock::now() - start;
+  add_result(case_name, iterations, duration.count());
+}
+
+}
+
+#endif
+
@@ -60,6 +60,7 @@ class TestEnvironment {
     Hero& get_hero();
 
     void run_map(const std::string& map_id);
+    Map& start_map(const std::string& map_id);
 
     // Creating entities.
     template<typename T>
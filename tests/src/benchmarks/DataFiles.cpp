@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/graphics/SpriteData.h"
+#include "tools/Benchmark.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+/**
+ * \brief Measures parsing and writing quest data files.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env, "data-files");
+
+  const std::string map_file_name = "maps/all_entities.dat";
+  const std::string map_buffer = QuestFiles::data_file_read(map_file_name);
+  benchmark.run("map_import", 200, [&]() {
+    MapData map_data;
+    map_data.import_from_buffer(map_buffer, map_file_name);
+  });
+
+  MapData map_data;
+  map_data.import_from_buffer(map_buffer, map_file_name);
+  benchmark.run("map_export", 200, [&]() {
+    std::string exported_buffer;
+    map_data.export_to_buffer(exported_buffer);
+  });
+
+  const std::string sprite_file_name = "sprites/hero/tunic1.dat";
+  const std::string sprite_buffer = QuestFiles::data_file_read(sprite_file_name);
+  benchmark.run("sprite_import", 200, [&]() {
+    SpriteData sprite_data;
+    sprite_data.import_from_buffer(sprite_buffer, sprite_file_name);
+  });
+
+  return benchmark.finish();
+}
+
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/entities/CustomEntity.h"
+#include "solarus/entities/Hero.h"
+#include "solarus/movements/PathFinding.h"
+#include "tools/Benchmark.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+/**
+ * \brief Measures path finding searches across a map.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env, "path-finding");
+
+  CustomEntity& entity = *env.make_entity<CustomEntity>();
+  Hero& hero = env.get_hero();
+
+  entity.set_top_left_xy(16, 16);
+  entity.notify_position_changed();
+  hero.set_top_left_xy(280, 200);
+  hero.notify_position_changed();
+
+  size_t path_length = 0;
+  benchmark.run("compute_path", 200, [&]() {
+    PathFinding path_finder(env.get_map(), entity, hero);
+    path_length += path_finder.compute_path().size();
+  });
+
+  PathFinding::Workspace workspace;
+  benchmark.run("incremental_path", 200, [&]() {
+    PathFinding path_finder(env.get_map(), entity, hero, workspace);
+    path_finder.start();
+    bool finished = false;
+    while (!finished) {
+      int max_expansions = 64;
+      finished = path_finder.step(max_expansions);
+    }
+    path_length += path_finder.get_path().size();
+  });
+
+  return benchmark.finish();
+}
+
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/PixelBits.h"
+#include "tools/Benchmark.h"
+#include "tools/TestEnvironment.h"
+#include <random>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates an image with random opaque pixels.
+ * \param density Percentage of opaque pixels.
+ */
+PixelBits create_image(std::mt19937& random, const Size& size, int density) {
+
+  std::vector<bool> opaque_pixels(size.width * size.height);
+  for (size_t i = 0; i < opaque_pixels.size(); ++i) {
+    opaque_pixels[i] = static_cast<int>(random() % 100) < density;
+  }
+  return PixelBits(size, opaque_pixels);
+}
+
+}
+
+/**
+ * \brief Measures pixel-precise collisions of sprite-sized images.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env, "pixel-bits");
+
+  std::mt19937 random(42);
+  std::vector<PixelBits> images;
+  for (int i = 0; i < 64; ++i) {
+    images.push_back(create_image(random, Size(16 + random() % 48, 16 + random() % 48), 5 + random() % 30));
+  }
+
+  int num_collisions = 0;
+  size_t index = 0;
+  benchmark.run("aligned", 100000, [&]() {
+    const PixelBits& image1 = images[index % images.size()];
+    const PixelBits& image2 = images[(index * 7 + 1) % images.size()];
+    ++index;
+    if (image1.test_aligned_collision(image2,
+        Point(0, 0), Point(random() % 48, random() % 48))) {
+      ++num_collisions;
+    }
+  });
+
+  benchmark.run("oriented", 10000, [&]() {
+    const PixelBits& image1 = images[index % images.size()];
+    const PixelBits& image2 = images[(index * 7 + 1) % images.size()];
+    ++index;
+    const Transform transform1(Point(0, 0), Point(8, 8), Scale(1.0f, 1.0f), 0.0);
+    const Transform transform2(Point(random() % 48, random() % 48), Point(8, 8),
+        Scale(1.0f, 1.0f), (random() % 628) / 100.0);
+    if (image1.test_oriented_collision(image2, transform1, transform2)) {
+      ++num_collisions;
+    }
+  });
+
+  return benchmark.finish();
+}
+
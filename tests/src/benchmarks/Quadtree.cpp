@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/Quadtree.h"
+#include "solarus/core/Rectangle.h"
+#include "tools/Benchmark.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief An element with a bounding box, like a map entity.
+ */
+struct Element {
+  Rectangle bounding_box;
+};
+
+using ElementPtr = std::shared_ptr<Element>;
+
+}
+
+/**
+ * \brief Measures quadtree queries and moves with many elements.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Benchmark benchmark(env, "quadtree");
+
+  const Rectangle space(0, 0, 4096, 4096);
+  std::mt19937 random(42);
+  Quadtree<ElementPtr> quadtree(space);
+  std::vector<ElementPtr> elements;
+  for (int i = 0; i < 2000; ++i) {
+    ElementPtr element = std::make_shared<Element>();
+    element->bounding_box = Rectangle(random() % 4080, random() % 4080, 16, 16);
+    quadtree.add(element, element->bounding_box);
+    elements.push_back(element);
+  }
+
+  size_t num_found = 0;
+  benchmark.run("query_screen", 10000, [&]() {
+    const Rectangle where(random() % 3776, random() % 3856, 320, 240);
+    num_found += quadtree.get_elements(where).size();
+  });
+
+  benchmark.run("move", 100000, [&]() {
+    const ElementPtr& element = elements[random() % elements.size()];
+    Rectangle& box = element->bounding_box;
+    box.set_xy(
+        std::min(std::max(box.get_x() + static_cast<int>(random() % 17) - 8, 0), 4080),
+        std::min(std::max(box.get_y() + static_cast<int>(random() % 17) - 8, 0), 4080)
+    );
+    quadtree.move(element, box);
+  });
+
+  benchmark.run("add_remove", 10000, [&]() {
+    ElementPtr element = std::make_shared<Element>();
+    element->bounding_box = Rectangle(random() % 4080, random() % 4080, 16, 16);
+    quadtree.add(element, element->bounding_box);
+    quadtree.remove(element);
+  });
+
+  return benchmark.finish();
+}
+
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "tools/Benchmark.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+/**
+ * \brief Measures the simulation of whole scenes of the testing quest.
+ *
+ * Each scene is a map of the testing quest whose script creates the load:
+ * every iteration is one update of the main loop.
+ * The scene to run is given by -map, like Lua map tests.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  const std::string& map_id = env.get_arguments().get_argument_value("-map");
+  Benchmark benchmark(env, "scene/" + map_id);
+
+  env.start_map(map_id);
+  benchmark.run("step", 1000, [&]() {
+    env.step();
+  });
+
+  return benchmark.finish();
+}
+
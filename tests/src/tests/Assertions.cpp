@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/SolarusFatal.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+int num_conditions_evaluated = 0;
+int num_messages_built = 0;
+
+bool condition(bool value) {
+  ++num_conditions_evaluated;
+  return value;
+}
+
+std::string message() {
+  ++num_messages_built;
+  return "Expected failure";
+}
+
+/**
+ * \brief Returns whether a check stops the program.
+ */
+template<typename Function>
+bool fails(Function&& check) {
+
+  try {
+    check();
+  }
+  catch (const SolarusFatal& /* ex */) {
+    return true;
+  }
+  return false;
+}
+
+/**
+ * \brief Tests that messages are only built when a check fails.
+ */
+void test_lazy_messages(TestEnvironment& /* env */) {
+
+  num_conditions_evaluated = 0;
+  num_messages_built = 0;
+  SOLARUS_CHECK(condition(true), message());
+  SOLARUS_ASSERT(condition(true), message());
+  Debug::check_assertion(num_messages_built == 0, "Message built for a passing check");
+
+  const bool check_failed = fails([]() { SOLARUS_CHECK(condition(false), message()); });
+  const bool assert_failed = fails([]() { SOLARUS_ASSERT(condition(false), message()); });
+
+#if SOLARUS_ASSERT_LEVEL >= SOLARUS_ASSERT_LEVEL_FULL
+  Debug::check_assertion(check_failed && assert_failed, "Enabled checks should fail");
+  Debug::check_assertion(num_conditions_evaluated == 4, "Wrong number of conditions evaluated");
+  Debug::check_assertion(num_messages_built == 2, "Wrong number of messages built");
+#elif SOLARUS_ASSERT_LEVEL >= SOLARUS_ASSERT_LEVEL_CHEAP
+  Debug::check_assertion(check_failed && !assert_failed, "Only cheap checks should fail");
+  Debug::check_assertion(num_conditions_evaluated == 2, "Wrong number of conditions evaluated");
+  Debug::check_assertion(num_messages_built == 1, "Wrong number of messages built");
+#else
+  Debug::check_assertion(!check_failed && !assert_failed, "Disabled checks should not fail");
+  Debug::check_assertion(num_conditions_evaluated == 0, "Disabled conditions evaluated");
+  Debug::check_assertion(num_messages_built == 0, "Message built for a disabled check");
+#endif
+}
+
+}
+
+/**
+ * Tests for the assertion levels.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+  Debug::set_abort_on_die(false);  // Catch the failures expected.
+  Debug::set_show_popup_on_die(false);
+
+  test_lazy_messages(env);
+
+  Debug::set_abort_on_die(true);
+  return 0;
+}
@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/FlatQuadtree.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+using namespace Solarus;
+
+using Box = Solarus::Rectangle;
+
+namespace {
+
+class Element {
+
+  public:
+
+    Element() :
+        rectangle() {
+    }
+
+    explicit Element(const Box& rectangle) :
+        rectangle(rectangle) {
+    }
+
+    const Box& get_bounding_box() const {
+      return rectangle;
+    }
+
+    Box& get_bounding_box() {
+      return rectangle;
+    }
+
+  private:
+
+    Box rectangle;
+};
+
+using ElementPtr = std::shared_ptr<Element>;
+
+/**
+ * \brief Checks the number of elements of a quadtree.
+ */
+void check_num_elements(const FlatQuadtree<ElementPtr>& quadtree, int expected) {
+
+  if (quadtree.get_num_elements() != expected) {
+    std::ostringstream oss;
+    oss << "Wrong number of elements: expected " << expected << ", got " << quadtree.get_num_elements();
+    Debug::die(oss.str());
+  }
+}
+
+/**
+ * \brief Checks that an element was found after a quadtree query.
+ */
+void check_found(const std::vector<ElementPtr>& found_elements, ElementPtr& expected) {
+
+  Debug::check_assertion(
+      std::find(found_elements.begin(), found_elements.end(), expected) != found_elements.end(),
+      "Element not found"
+  );
+}
+
+/**
+ * \brief Creates an element with the given coordinates and adds it to a quatree.
+ */
+ElementPtr add(FlatQuadtree<ElementPtr>& quadtree, const Box& bounding_box) {
+
+  int num_elements = quadtree.get_num_elements();
+  ElementPtr element(std::make_shared<Element>(bounding_box));
+  Debug::check_assertion(quadtree.add(element, element->get_bounding_box()), "Failed to add element");
+  check_num_elements(quadtree, num_elements + 1);
+  return element;
+}
+
+/**
+ * \brief Removes an element from a quatree.
+ */
+void remove(FlatQuadtree<ElementPtr>& quadtree, const ElementPtr& element) {
+
+  int num_elements = quadtree.get_num_elements();
+  Debug::check_assertion(quadtree.remove(element), "Failed to remove element");
+  check_num_elements(quadtree, num_elements - 1);
+}
+
+/**
+ * \brief Moves an element to its new coordinates in a quatree.
+ */
+void move(FlatQuadtree<ElementPtr>& quadtree, const ElementPtr& element) {
+
+  Debug::check_assertion(quadtree.contains(element), "Element not in quadtree");
+
+  int num_elements = quadtree.get_num_elements();
+  Debug::check_assertion(quadtree.move(element, element->get_bounding_box()), "Failed to move element");
+
+  // The number of elements should be unchanged.
+  check_num_elements(quadtree, num_elements);
+}
+
+/**
+ * \brief Tests an empty quadtree.
+ */
+void test_empty(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  check_num_elements(quadtree, 0);
+}
+
+/**
+ * \brief Tests adding elements to a quadtree.
+ */
+void test_add(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  const std::vector<Box> rectangles = {
+      Box(100, 40, 16, 16),
+      Box(200, 10, 16, 16),
+      Box(250, 20, 16, 16),
+      Box(300, 30, 16, 16),
+      Box(300, 50, 16, 16),
+      Box(800, 40, 16, 16),
+      Box(500, 60, 16, 16),
+      Box(600, 100, 16, 16),
+      Box(400, 300, 16, 16),
+      Box(700, 400, 16, 16)
+  };
+
+  std::vector<ElementPtr> added_elements;
+  for (const Box& rectangle : rectangles) {
+    ElementPtr element = add(quadtree, rectangle);
+    added_elements.push_back(element);
+  }
+
+  Box region(220, 10, 100, 100);
+  std::vector<ElementPtr> found_elements;
+  quadtree.get_elements(region, found_elements);
+
+  Debug::check_assertion(found_elements.size() == 3, "Expected 3 elements found");
+  check_found(found_elements, added_elements[2]);
+  check_found(found_elements, added_elements[3]);
+  check_found(found_elements, added_elements[4]);
+}
+
+/**
+ * \brief Tests removing elements from a quadtree.
+ */
+void test_remove(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  // Get all elements.
+  std::vector<ElementPtr> elements;
+  quadtree.get_elements(quadtree.get_space(), elements);
+
+  // Remove some of them.
+  Debug::check_assertion(quadtree.get_num_elements() > 5, "Wrong number of elements");
+  remove(quadtree, elements[0]);
+}
+
+/**
+ * \brief Tests adding elements whose size overlaps several cells.
+ */
+void test_add_big_size(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  add(quadtree, Box(25, 25, 600, 600));
+  add(quadtree, Box(100, 0, 16, 960));
+}
+
+/**
+ * \brief Tests adding elements near the limit or outside the quadtree space.
+ */
+void test_add_limit(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  add(quadtree, Box(-16, 0, 16, 960));
+
+  // Try to add an element outside the quadtree space.
+  add(quadtree, Box(-160, 0, 16, 960));
+}
+
+/**
+ * \brief Tests adding an element partially outside the quadtree space, with the center outside.
+ */
+void test_add_center_outside(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  add(quadtree, Box(-480, 32, 640, 640));
+  add(quadtree, Box(1300, 32, 640, 640));
+}
+
+/**
+ * \brief Tests moving elements in a quadtree.
+ */
+void test_move(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  // Get all elements.
+  std::vector<ElementPtr> elements;
+  quadtree.get_elements(quadtree.get_space(), elements);
+
+  // Move some of them.
+  Debug::check_assertion(quadtree.get_num_elements() > 4, "Wrong number of elements");
+  ElementPtr element = elements[0];
+  element->get_bounding_box().set_xy(128, 256);
+  move(quadtree, element);
+}
+
+/**
+ * \brief Tests moving elements to outside and from outside a quadtree.
+ */
+void test_move_limit(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  // Get all elements.
+  std::vector<ElementPtr> elements;
+  quadtree.get_elements(quadtree.get_space(), elements);
+
+  // Move an element outside the bounds.
+  int num_elements = quadtree.get_num_elements();
+  Debug::check_assertion(num_elements > 4, "Wrong number of elements");
+
+  ElementPtr element = elements[0];
+  element->get_bounding_box().set_xy(-50000, -50000);
+  move(quadtree, element);
+  Debug::check_assertion(quadtree.get_num_elements() == num_elements, "Wrong number of elements");
+
+  // Come back in the bounds.
+  element->get_bounding_box().set_xy(42, 64);
+  move(quadtree, element);
+  Debug::check_assertion(quadtree.get_num_elements() == num_elements, "Wrong number of elements");
+}
+
+/**
+ * \brief Tests small moves that keep an element in the same cell,
+ * and moves whose merges are postponed.
+ */
+void test_move_in_place(TestEnvironment& /* env */) {
+
+  FlatQuadtree<ElementPtr> quadtree(Box(0, 0, 256, 256));
+  std::vector<ElementPtr> elements;
+  for (int i = 0; i < FlatQuadtree<ElementPtr>::max_in_cell + 1; ++i) {
+    elements.push_back(add(quadtree, Box(8 + 16 * i, 8, 8, 8)));
+  }
+
+  // Move an element by one pixel: it must still be found at its new place only.
+  ElementPtr element = elements[0];
+  element->get_bounding_box().set_xy(9, 9);
+  move(quadtree, element);
+  std::vector<ElementPtr> found_elements;
+  quadtree.get_elements(Box(16, 16, 1, 1), found_elements);
+  check_found(found_elements, element);
+  found_elements.clear();
+  quadtree.get_elements(Box(8, 8, 1, 1), found_elements);
+  Debug::check_assertion(found_elements.empty(), "Element found at its old place");
+
+  // Move everything far away, then merge.
+  for (const ElementPtr& moved_element : elements) {
+    moved_element->get_bounding_box().set_xy(200, 200);
+    move(quadtree, moved_element);
+  }
+  quadtree.rebalance();
+  found_elements.clear();
+  quadtree.get_elements(Box(0, 0, 128, 128), found_elements);
+  Debug::check_assertion(found_elements.empty(), "Element found at its old place");
+  found_elements.clear();
+  quadtree.get_elements(Box(200, 200, 8, 8), found_elements);
+  Debug::check_assertion(found_elements.size() == elements.size(), "Wrong number of elements found");
+}
+
+/**
+ * \brief Tests adding many elements at once.
+ */
+void test_add_elements(TestEnvironment& /* env */) {
+
+  FlatQuadtree<ElementPtr> quadtree(Box(0, 0, 256, 256));
+  ElementPtr existing = add(quadtree, Box(8, 8, 8, 8));
+
+  // Enough elements in the same cell to split it several times.
+  std::vector<std::pair<ElementPtr, Box>> new_elements;
+  new_elements.emplace_back(existing, existing->get_bounding_box());
+  for (int i = 0; i < 4 * FlatQuadtree<ElementPtr>::max_in_cell; ++i) {
+    ElementPtr element = std::make_shared<Element>(Box(4 * i, 4 * i, 8, 8));
+    new_elements.emplace_back(element, element->get_bounding_box());
+  }
+  ElementPtr outside = std::make_shared<Element>(Box(300, 300, 8, 8));
+  new_elements.emplace_back(outside, outside->get_bounding_box());
+
+  const int num_added = quadtree.add_elements(new_elements);
+  Debug::check_assertion(num_added == static_cast<int>(new_elements.size()) - 1,
+      "Wrong number of elements added");  // One of them was already there.
+  check_num_elements(quadtree, num_added + 1);
+  Debug::check_assertion(quadtree.contains(outside), "Element outside not added");
+
+  // Each element is found at its place only.
+  for (size_t i = 1; i < new_elements.size() - 1; ++i) {
+    std::vector<ElementPtr> found_elements;
+    quadtree.get_elements(new_elements[i].second, found_elements);
+    check_found(found_elements, new_elements[i].first);
+  }
+  std::vector<ElementPtr> found_elements;
+  quadtree.get_elements(Box(200, 0, 56, 56), found_elements);
+  Debug::check_assertion(found_elements.empty(), "Element found at a wrong place");
+
+  // The result is the same as adding them one by one.
+  remove(quadtree, new_elements[5].first);
+  move(quadtree, new_elements[6].first);
+  quadtree.rebalance();
+  check_num_elements(quadtree, num_added);
+}
+
+/**
+ * \brief Tests adding many elements at once to an empty quadtree.
+ */
+void test_build(TestEnvironment& /* env */) {
+
+  FlatQuadtree<ElementPtr> built(Box(0, 0, 640, 480));
+  FlatQuadtree<ElementPtr> incremental(Box(0, 0, 640, 480));
+
+  // Dense areas, large elements and elements crossing the border.
+  std::vector<std::pair<ElementPtr, Box>> new_elements;
+  for (int i = 0; i < 500; ++i) {
+    const Box box(
+        (i * 37) % 700 - 30,
+        (i * 53) % 520 - 20,
+        8 + (i % 7) * 12,
+        8 + (i % 5) * 20
+    );
+    ElementPtr element = std::make_shared<Element>(box);
+    new_elements.emplace_back(element, box);
+    incremental.add(element, box);
+  }
+  for (int i = 0; i < 100; ++i) {
+    const Box box(100 + i % 10, 100 + i / 10, 8, 8);
+    ElementPtr element = std::make_shared<Element>(box);
+    new_elements.emplace_back(element, box);
+    incremental.add(element, box);
+  }
+
+  const int num_added = built.add_elements(new_elements);
+  Debug::check_assertion(num_added == static_cast<int>(new_elements.size()),
+      "Wrong number of elements added");
+  check_num_elements(built, incremental.get_num_elements());
+
+  // Queries give the same results as adding elements one by one.
+  for (int y = -32; y < 512; y += 24) {
+    for (int x = -32; x < 672; x += 40) {
+      const Box where(x, y, 48, 32);
+      std::vector<ElementPtr> found_built;
+      std::vector<ElementPtr> found_incremental;
+      built.get_elements(where, found_built);
+      incremental.get_elements(where, found_incremental);
+      std::sort(found_built.begin(), found_built.end());
+      std::sort(found_incremental.begin(), found_incremental.end());
+      Debug::check_assertion(found_built == found_incremental, "Wrong elements found");
+    }
+  }
+
+  // The quadtree built still supports other operations.
+  for (size_t i = 0; i < new_elements.size(); i += 2) {
+    remove(built, new_elements[i].first);
+  }
+  for (size_t i = 1; i < new_elements.size(); i += 4) {
+    new_elements[i].first->get_bounding_box().add_xy(16, 16);
+    move(built, new_elements[i].first);
+  }
+  built.rebalance();
+  check_num_elements(built, static_cast<int>(new_elements.size() / 2));
+}
+
+/**
+ * \brief Tests that queries return each element once and can stop early.
+ */
+void test_visit(TestEnvironment& /* env */, FlatQuadtree<ElementPtr>& quadtree) {
+
+  // Elements overlapping several cells must be found only once.
+  std::vector<ElementPtr> elements;
+  quadtree.get_elements(quadtree.get_space(), elements);
+  Debug::check_assertion(static_cast<int>(elements.size()) == quadtree.get_num_elements() - 1,
+      "Wrong number of elements found");  // One of them is outside the space.
+  std::sort(elements.begin(), elements.end());
+  Debug::check_assertion(std::adjacent_find(elements.begin(), elements.end()) == elements.end(),
+      "Duplicate elements found");
+
+  // Stop after the first element.
+  int num_visited = 0;
+  bool finished = quadtree.visit_elements(quadtree.get_space(), [&num_visited](const ElementPtr&) {
+    ++num_visited;
+    return false;
+  });
+  Debug::check_assertion(!finished, "Visit should have been stopped");
+  Debug::check_assertion(num_visited == 1, "Wrong number of elements visited");
+}
+
+}
+
+/**
+ * Tests for the flat quadtree.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  int margin = 64;
+  Box space(-margin, -margin, 1280 + 2 * margin, 960 + 2 * margin);
+  FlatQuadtree<ElementPtr> quadtree(space);
+
+  test_empty(env, quadtree);
+  test_add(env, quadtree);
+  test_add_big_size(env, quadtree);
+  test_add_limit(env, quadtree);
+  test_add_center_outside(env, quadtree);
+  test_remove(env, quadtree);
+  test_move(env, quadtree);
+  test_move_limit(env, quadtree);
+  test_visit(env, quadtree);
+  test_move_in_place(env);
+  test_add_elements(env);
+  test_build(env);
+
+  return 0;
+}
+
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/FlatStringMap.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests finding keys.
+ */
+void test_find(TestEnvironment& /* env */) {
+
+  std::vector<FlatStringMap<int>::Entry> entries;
+  for (int i = 0; i < 1000; ++i) {
+    entries.emplace_back("key." + std::to_string(i), i);
+  }
+  const FlatStringMap<int> map(entries);
+  Debug::check_assertion(map.size() == 1000, "Wrong size");
+
+  for (int i = 0; i < 1000; ++i) {
+    const int* value = map.find("key." + std::to_string(i));
+    Debug::check_assertion(value != nullptr, "Missing key");
+    Debug::check_assertion(*value == i, "Wrong value");
+  }
+  Debug::check_assertion(map.find("key.1000") == nullptr, "Unexpected key");
+  Debug::check_assertion(map.find("") == nullptr, "Unexpected empty key");
+
+  // Entries keep their order.
+  for (size_t i = 0; i < entries.size(); ++i) {
+    Debug::check_assertion(map.get_entries()[i] == entries[i], "Wrong entry order");
+  }
+}
+
+/**
+ * \brief Tests empty maps and duplicate keys.
+ */
+void test_special_cases(TestEnvironment& /* env */) {
+
+  const FlatStringMap<std::string> empty_map;
+  Debug::check_assertion(empty_map.empty(), "Map should be empty");
+  Debug::check_assertion(empty_map.find("a") == nullptr, "Unexpected key in empty map");
+
+  const FlatStringMap<std::string> map({ { "a", "first" }, { "b", "other" }, { "a", "second" } });
+  Debug::check_assertion(map.size() == 3, "Wrong size");
+  Debug::check_assertion(*map.find("a") == "first", "The first duplicate should be found");
+  Debug::check_assertion(*map.find("b") == "other", "Wrong value");
+}
+
+}
+
+/**
+ * Tests for the flat string map.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_find(env);
+  test_special_cases(env);
+
+  return 0;
+}
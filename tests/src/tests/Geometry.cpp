@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Geometry.h"
+#include "tools/TestEnvironment.h"
+#include <cmath>
+#include <cstring>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Returns whether two doubles have the same bits, including the sign of zero.
+ */
+bool same_bits(double first, double second) {
+  return std::memcmp(&first, &second, sizeof(double)) == 0;
+}
+
+/**
+ * \brief Tests that get_angle() gives exactly what atan2 gives.
+ */
+void test_angle(TestEnvironment& /* env */) {
+
+  for (int dy = -20; dy <= 20; ++dy) {
+    for (int dx = -20; dx <= 20; ++dx) {
+      if (dx == 0 && dy == 0) {
+        continue;
+      }
+      double expected = std::atan2(-static_cast<double>(dy), static_cast<double>(dx));
+      if (expected < 0.0) {
+        expected += Geometry::TWO_PI;
+      }
+      const double angle = Geometry::get_angle(Point(10, 10), Point(10 + dx, 10 + dy));
+      Debug::check_assertion(same_bits(angle, expected), "Wrong angle");
+    }
+  }
+  Debug::check_assertion(Geometry::get_angle(Point(), Point()) == Geometry::PI_OVER_2,
+      "Wrong angle of a null vector");
+}
+
+/**
+ * \brief Tests that get_xy() gives exactly what cos and sin give.
+ */
+void test_xy(TestEnvironment& /* env */) {
+
+  const double angles[] = {
+      0.0,
+      Geometry::PI_OVER_4,
+      Geometry::PI_OVER_2,
+      Geometry::PI,
+      Geometry::THREE_PI_OVER_2,
+      1.0,
+      -0.0,
+      5.5
+  };
+  for (double angle : angles) {
+    for (int distance = -100; distance <= 100; ++distance) {
+      const Point expected(
+          static_cast<int>(distance * std::cos(angle)),
+          static_cast<int>(-distance * std::sin(angle))
+      );
+      Debug::check_assertion(Geometry::get_xy(angle, distance) == expected, "Wrong coordinates");
+    }
+  }
+}
+
+}
+
+/**
+ * Tests for the geometry functions.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_angle(env);
+  test_xy(env);
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/HitchDetector.h"
+#include "solarus/core/System.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests that a long frame is reported with its phases.
+ */
+void test_report(TestEnvironment& /* env */) {
+
+  HitchDetector::set_threshold(1);
+  HitchDetector::set_log_size(3);
+  HitchDetector::start_frame();
+  {
+    HitchDetector::Scope scope(HitchDetector::Phase::INPUT);
+    System::sleep(5);
+  }
+  HitchDetector::add_time(HitchDetector::Phase::STEP, 1000);
+  HitchDetector::set_slowest_lua_call(2000, "on_started", "maps/test.lua:12");
+  HitchDetector::finish_frame(nullptr);
+
+  const std::vector<std::string>& hitches = HitchDetector::get_last_hitches();
+  Debug::check_assertion(!hitches.empty(), "Hitch not reported");
+  const std::string& report = hitches.back();
+  Debug::check_assertion(report.find("input") != std::string::npos, "Missing input phase");
+  Debug::check_assertion(report.find("1 steps") != std::string::npos, "Missing steps");
+  Debug::check_assertion(report.find("on_started (maps/test.lua:12)") != std::string::npos,
+      "Missing slowest Lua callback");
+  Debug::check_assertion(hitches.size() <= 3, "Too many hitches kept");
+}
+
+/**
+ * \brief Tests that short frames and a disabled detector report nothing.
+ */
+void test_no_report(TestEnvironment& /* env */) {
+
+  HitchDetector::set_threshold(10000);
+  const size_t num_hitches = HitchDetector::get_last_hitches().size();
+  HitchDetector::start_frame();
+  HitchDetector::finish_frame(nullptr);
+  Debug::check_assertion(HitchDetector::get_last_hitches().size() == num_hitches,
+      "Short frame reported");
+
+  HitchDetector::set_threshold(0);
+  Debug::check_assertion(!HitchDetector::is_enabled(), "Detector not disabled");
+  HitchDetector::start_frame();
+  System::sleep(2);
+  HitchDetector::finish_frame(nullptr);
+  Debug::check_assertion(HitchDetector::get_last_hitches().size() == num_hitches,
+      "Frame reported by a disabled detector");
+}
+
+}
+
+/**
+ * Tests for the hitch detector.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_report(env);
+  test_no_report(env);
+
+  return 0;
+}
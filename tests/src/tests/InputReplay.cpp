@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/InputEvent.h"
+#include "solarus/core/InputReplay.h"
+#include "tools/TestEnvironment.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+const std::string file_name = "input_replay_test.txt";
+
+/**
+ * \brief Creates a keyboard event.
+ */
+SDL_Event make_key_event(Uint32 type, SDL_Keycode key) {
+
+  SDL_Event event;
+  std::memset(&event, 0, sizeof(event));
+  event.type = type;
+  event.key.state = (type == SDL_KEYDOWN) ? SDL_PRESSED : SDL_RELEASED;
+  event.key.keysym.sym = key;
+  return event;
+}
+
+/**
+ * \brief Creates a joypad button event.
+ */
+SDL_Event make_joypad_event(Uint8 button) {
+
+  SDL_Event event;
+  std::memset(&event, 0, sizeof(event));
+  event.type = SDL_JOYBUTTONDOWN;
+  event.jbutton.button = button;
+  event.jbutton.state = SDL_PRESSED;
+  return event;
+}
+
+/**
+ * \brief Creates a mouse motion event.
+ */
+SDL_Event make_mouse_event(Sint32 x, Sint32 y) {
+
+  SDL_Event event;
+  std::memset(&event, 0, sizeof(event));
+  event.type = SDL_MOUSEMOTION;
+  event.motion.x = x;
+  event.motion.y = y;
+  return event;
+}
+
+/**
+ * \brief Returns whether two events have the same bytes.
+ */
+bool same_event(const SDL_Event& event1, const SDL_Event& event2) {
+  return std::memcmp(&event1, &event2, sizeof(SDL_Event)) == 0;
+}
+
+/**
+ * \brief Checks that a replay gives back the recorded events at their ticks.
+ */
+void test_replay_events(TestEnvironment& /* env */) {
+
+  const std::vector<std::pair<uint32_t, SDL_Event>> recorded = {
+      { 10, make_key_event(SDL_KEYDOWN, SDLK_SPACE) },
+      { 10, make_key_event(SDL_KEYUP, SDLK_SPACE) },
+      { 30, make_joypad_event(3) },
+      { 50, make_mouse_event(120, -4) },
+  };
+
+  InputReplay recorder;
+  Debug::check_assertion(recorder.start_recording(file_name, 1234, false),
+      "Cannot start recording");
+  Debug::check_assertion(recorder.is_recording(), "Not recording");
+  for (const std::pair<uint32_t, SDL_Event>& kvp : recorded) {
+    recorder.record_event(kvp.first, *InputEvent::make_event(kvp.second));
+  }
+  recorder.stop();
+  Debug::check_assertion(!recorder.is_recording(), "Still recording");
+
+  InputReplay replay;
+  Debug::check_assertion(replay.start_replaying(file_name), "Cannot start replaying");
+  Debug::check_assertion(replay.is_replaying(), "Not replaying");
+  Debug::check_assertion(!replay.is_hashing(), "Hashing without recorded hashes");
+  Debug::check_assertion(replay.get_seed() == 1234, "Wrong replayed seed");
+
+  SDL_Event event;
+  Debug::check_assertion(!replay.pop_event(0, event), "Event replayed too early");
+  Debug::check_assertion(!replay.pop_event(9, event), "Event replayed too early");
+
+  // Both events of tick 10, in order.
+  Debug::check_assertion(replay.pop_event(10, event) && same_event(event, recorded[0].second),
+      "Wrong first event");
+  Debug::check_assertion(replay.pop_event(10, event) && same_event(event, recorded[1].second),
+      "Wrong second event");
+  Debug::check_assertion(!replay.pop_event(10, event), "Extra event at tick 10");
+  Debug::check_assertion(!replay.pop_event(29, event), "Event replayed too early");
+
+  Debug::check_assertion(replay.pop_event(30, event) && same_event(event, recorded[2].second),
+      "Wrong joypad event");
+  Debug::check_assertion(!replay.pop_event(30, event), "Extra event at tick 30");
+
+  // A late tick still gets the events it missed.
+  Debug::check_assertion(replay.pop_event(60, event) && same_event(event, recorded[3].second),
+      "Wrong mouse event");
+  Debug::check_assertion(!replay.pop_event(1000, event), "Extra event at the end");
+
+  replay.stop();
+  Debug::check_assertion(!replay.is_replaying(), "Still replaying");
+  std::remove(file_name.c_str());
+}
+
+/**
+ * \brief Checks that replaying detects a different state hash.
+ */
+void test_replay_hashes(TestEnvironment& /* env */) {
+
+  InputReplay recorder;
+  Debug::check_assertion(recorder.start_recording(file_name, 42, true),
+      "Cannot start recording");
+  Debug::check_assertion(recorder.is_hashing(), "Not recording hashes");
+  recorder.check_hash(10, 0x0123456789ABCDEFULL);
+  recorder.check_hash(20, 0xFEDCBA9876543210ULL);
+  recorder.check_hash(30, 7);
+  recorder.stop();
+
+  InputReplay replay;
+  Debug::check_assertion(replay.start_replaying(file_name), "Cannot start replaying");
+  Debug::check_assertion(replay.is_hashing(), "Recorded hashes not compared");
+  Debug::check_assertion(replay.get_seed() == 42, "Wrong replayed seed");
+
+  replay.check_hash(10, 0x0123456789ABCDEFULL);
+  Debug::check_assertion(!replay.has_diverged(), "Diverged with the same hash");
+  replay.check_hash(15, 99);  // No hash recorded for this tick.
+  Debug::check_assertion(!replay.has_diverged(), "Diverged on a tick without hash");
+  replay.check_hash(20, 0xFEDCBA9876543211ULL);
+  Debug::check_assertion(replay.has_diverged(), "Different hash not detected");
+  replay.check_hash(30, 7);
+  Debug::check_assertion(replay.has_diverged(), "Divergence forgotten");
+
+  replay.stop();
+  Debug::check_assertion(!replay.has_diverged(), "Divergence kept after stopping");
+  std::remove(file_name.c_str());
+}
+
+/**
+ * \brief Checks that invalid files are not replayed.
+ */
+void test_invalid_files(TestEnvironment& /* env */) {
+
+  InputReplay replay;
+  Debug::check_assertion(!replay.start_replaying("input_replay_missing.txt"),
+      "Missing file replayed");
+
+  {
+    std::ofstream output(file_name);
+    output << "solarus-replay 1\nseed 1\ne 10 0102\n";
+  }
+  Debug::check_assertion(!replay.start_replaying(file_name), "Truncated event replayed");
+  Debug::check_assertion(!replay.is_replaying(), "Replaying an invalid file");
+
+  {
+    std::ofstream output(file_name);
+    output << "not a replay\n";
+  }
+  Debug::check_assertion(!replay.start_replaying(file_name), "File without header replayed");
+  std::remove(file_name.c_str());
+}
+
+}
+
+/**
+ * \brief Tests recording and replaying input events.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_replay_events(env);
+  test_replay_hashes(env);
+  test_invalid_files(env);
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/JobSystem.h"
+#include "tools/TestEnvironment.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+using Priority = JobSystem::Priority;
+
+/**
+ * \brief Checks that a job only starts when its dependencies are done.
+ */
+void test_dependencies(TestEnvironment& /* env */) {
+
+  std::atomic<int> num_done(0);
+  std::vector<JobSystem::JobPtr> jobs;
+  for (int i = 0; i < 8; ++i) {
+    jobs.push_back(JobSystem::add(Priority::BACKGROUND, [&num_done]() {
+      ++num_done;
+    }));
+  }
+  jobs.push_back(JobSystem::add(Priority::IO, [&num_done]() {
+    ++num_done;
+  }));
+
+  int num_done_before_last = -1;
+  const JobSystem::JobPtr& last = JobSystem::add(Priority::FRAME, [&]() {
+    num_done_before_last = num_done;
+  }, jobs);
+  JobSystem::wait(last);
+
+  Debug::check_assertion(num_done_before_last == 9, "Job started before its dependencies");
+}
+
+/**
+ * \brief Checks that workers all waiting for jobs still run the
+ * dependencies that become ready meanwhile.
+ */
+void test_wait_in_all_workers(TestEnvironment& /* env */) {
+
+  const int num_workers = JobSystem::get_num_workers();
+  std::atomic<int> num_started(0);
+  std::atomic<int> num_chains_done(0);
+  std::vector<JobSystem::JobPtr> jobs;
+  for (int i = 0; i < num_workers; ++i) {
+    jobs.push_back(JobSystem::add(Priority::BACKGROUND, [&]() {
+      // Make sure that each worker runs one of these jobs.
+      ++num_started;
+      while (num_started < num_workers) {
+        std::this_thread::yield();
+      }
+
+      // The first link runs on an IO thread, so the next ones are
+      // queued by a thread that is not a worker.
+      JobSystem::JobPtr link = JobSystem::add(Priority::IO, []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      });
+      for (int j = 0; j < 3; ++j) {
+        link = JobSystem::add(Priority::BACKGROUND, []() {}, { link });
+      }
+      JobSystem::wait(link);
+      ++num_chains_done;
+    }));
+  }
+  for (const JobSystem::JobPtr& job : jobs) {
+    JobSystem::wait(job);
+  }
+
+  Debug::check_assertion(num_chains_done == num_workers, "Dependency chain not finished");
+}
+
+/**
+ * \brief Checks that continuations run on the main thread from update().
+ */
+void test_main_thread(TestEnvironment& /* env */) {
+
+  const std::thread::id main_thread = std::this_thread::get_id();
+  const JobSystem::JobPtr& job = JobSystem::add(Priority::BACKGROUND, []() {});
+  bool called = false;
+  const JobSystem::JobPtr& continuation = JobSystem::add_main_thread([&]() {
+    Debug::check_assertion(std::this_thread::get_id() == main_thread, "Not on the main thread");
+    called = true;
+  }, { job });
+
+  JobSystem::wait(job);
+  while (!JobSystem::is_done(continuation)) {
+    JobSystem::update();
+  }
+  Debug::check_assertion(called, "Continuation not called");
+}
+
+/**
+ * \brief Checks that parallel loops process each item once.
+ */
+void test_parallel_for(TestEnvironment& /* env */) {
+
+  std::vector<int> items(1000, 0);
+  JobSystem::parallel_for(static_cast<int>(items.size()), 10, [&items](int first_item, int num_items) {
+    for (int i = first_item; i < first_item + num_items; ++i) {
+      ++items[i];
+    }
+  });
+  for (int item : items) {
+    Debug::check_assertion(item == 1, "Item not processed exactly once");
+  }
+
+  std::future<int> future = JobSystem::async(Priority::BACKGROUND, []() {
+    return 42;
+  });
+  Debug::check_assertion(future.get() == 42, "Wrong async result");
+}
+
+}
+
+/**
+ * Tests for the job system.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_dependencies(env);
+  test_wait_in_all_workers(env);
+  test_main_thread(env);
+  test_parallel_for(env);
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/KtxImage.h"
+#include "tools/TestEnvironment.h"
+#include <cstdint>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Appends a little-endian integer to a buffer.
+ */
+void write_uint(std::vector<uint8_t>& buffer, uint64_t value, int size) {
+  for (int i = 0; i < size; ++i) {
+    buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+/**
+ * \brief Builds a KTX2 file with one level of compressed blocks.
+ */
+std::vector<uint8_t> make_ktx2(
+    uint32_t format, uint32_t width, uint32_t height,
+    uint32_t supercompression, size_t data_size) {
+
+  std::vector<uint8_t> file = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+  };
+  write_uint(file, format, 4);            // vkFormat
+  write_uint(file, 1, 4);                 // typeSize
+  write_uint(file, width, 4);
+  write_uint(file, height, 4);
+  write_uint(file, 0, 4);                 // pixelDepth
+  write_uint(file, 0, 4);                 // layerCount
+  write_uint(file, 1, 4);                 // faceCount
+  write_uint(file, 1, 4);                 // levelCount
+  write_uint(file, supercompression, 4);
+  write_uint(file, 0, 4);                 // dfdByteOffset
+  write_uint(file, 0, 4);                 // dfdByteLength
+  write_uint(file, 0, 4);                 // kvdByteOffset
+  write_uint(file, 0, 4);                 // kvdByteLength
+  write_uint(file, 0, 8);                 // sgdByteOffset
+  write_uint(file, 0, 8);                 // sgdByteLength
+  const uint64_t data_offset = file.size() + 24;
+  write_uint(file, data_offset, 8);
+  write_uint(file, data_size, 8);
+  write_uint(file, 0, 8);                 // uncompressedByteLength
+  for (size_t i = 0; i < data_size; ++i) {
+    file.push_back(static_cast<uint8_t>(i));
+  }
+  return file;
+}
+
+/**
+ * \brief Tests reading a valid file.
+ */
+void test_load(TestEnvironment& /* env */) {
+
+  // 10x6 pixels: 3x2 blocks of 16 bytes.
+  const std::vector<uint8_t> file = make_ktx2(KtxImage::FORMAT_BC7, 10, 6, 0, 96);
+  KtxImage image;
+  Debug::check_assertion(image.load(file.data(), file.size()), "Failed to load KTX2 file");
+  Debug::check_assertion(image.get_format() == KtxImage::FORMAT_BC7, "Wrong format");
+  Debug::check_assertion(image.get_width() == 10, "Wrong width");
+  Debug::check_assertion(image.get_height() == 6, "Wrong height");
+  Debug::check_assertion(image.get_data().size() == 96, "Wrong data size");
+  Debug::check_assertion(image.get_data()[95] == 95, "Wrong data");
+}
+
+/**
+ * \brief Tests that invalid or unsupported files are rejected.
+ */
+void test_invalid(TestEnvironment& /* env */) {
+
+  KtxImage image;
+  std::vector<uint8_t> file = make_ktx2(KtxImage::FORMAT_BC1_RGBA, 8, 8, 0, 32);
+  file[1] = 'X';
+  Debug::check_assertion(!image.load(file.data(), file.size()), "Wrong identifier accepted");
+
+  // R8G8B8A8_UNORM is not block-compressed.
+  file = make_ktx2(37, 8, 8, 0, 256);
+  Debug::check_assertion(!image.load(file.data(), file.size()), "Unsupported format accepted");
+
+  // Zstandard supercompression.
+  file = make_ktx2(KtxImage::FORMAT_ETC2_RGBA, 8, 8, 2, 64);
+  Debug::check_assertion(!image.load(file.data(), file.size()), "Supercompressed file accepted");
+
+  file = make_ktx2(KtxImage::FORMAT_ASTC_4x4, 8, 8, 0, 48);
+  Debug::check_assertion(!image.load(file.data(), file.size()), "Truncated file accepted");
+
+  Debug::check_assertion(image.get_format() == KtxImage::FORMAT_UNDEFINED, "Failed load modified the image");
+}
+
+/**
+ * \brief Tests the names of precompressed files.
+ */
+void test_file_name(TestEnvironment& /* env */) {
+
+  Debug::check_assertion(KtxImage::get_file_name("sprites/hero/tunic1.png") == "sprites/hero/tunic1.ktx2",
+      "Wrong name with extension");
+  Debug::check_assertion(KtxImage::get_file_name("images.v2/logo") == "images.v2/logo.ktx2",
+      "Wrong name without extension");
+}
+
+}
+
+/**
+ * Tests for reading KTX2 files.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_load(env);
+  test_invalid(env);
+  test_file_name(env);
+
+  return 0;
+}
+
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/LauncherChannel.h"
+#include "tools/TestEnvironment.h"
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+using Layout = LauncherChannel::Layout;
+using TelemetryRecord = LauncherChannel::TelemetryRecord;
+
+constexpr uint32_t ring_size = LauncherChannel::command_buffer_size;
+constexpr uint32_t capacity = LauncherChannel::telemetry_capacity;
+
+/**
+ * \brief Creates a layout like the one of a new file of the launcher.
+ */
+std::unique_ptr<Layout> create_layout() {
+
+  // Value-initialization fills the memory with zeros.
+  std::unique_ptr<Layout> layout(new Layout());
+  LauncherChannel::initialize_layout(*layout);
+  Debug::check_assertion(LauncherChannel::is_layout_valid(*layout), "Invalid layout");
+  return layout;
+}
+
+/**
+ * \brief Moves both command offsets of an empty ring.
+ */
+void set_command_offsets(Layout& layout, uint32_t offset) {
+
+  layout.command_write_offset.store(offset);
+  layout.command_read_offset.store(offset);
+}
+
+/**
+ * \brief Pushes frames whose statistics identify them.
+ */
+void push_frames(Layout& layout, int num_frames) {
+
+  for (int i = 0; i < num_frames; ++i) {
+    FrameStats::Frame stats;
+    stats.num_updates = i;
+    LauncherChannel::push_frame(layout, stats, 1000 + i);
+  }
+}
+
+/**
+ * \brief Checks commands whose header or text straddle the end of the ring.
+ */
+void test_commands_wrap_around(TestEnvironment& /* env */) {
+
+  std::unique_ptr<Layout> layout = create_layout();
+  const std::vector<std::string> commands = { "print('first')", "", "sol.main.exit()" };
+
+  // The size header is split, then the text is, then the counters wrap at 2^32.
+  for (uint32_t start : { ring_size - 2, ring_size - 10, std::numeric_limits<uint32_t>::max() - 20 }) {
+    set_command_offsets(*layout, start);
+    for (const std::string& command : commands) {
+      Debug::check_assertion(LauncherChannel::push_command(*layout, command),
+          "Cannot push a command");
+    }
+    Debug::check_assertion(LauncherChannel::pop_commands(*layout) == commands,
+        "Wrong commands at offset " + std::to_string(start));
+    Debug::check_assertion(LauncherChannel::pop_commands(*layout).empty(),
+        "Commands popped twice");
+    Debug::check_assertion(layout->command_read_offset.load() == layout->command_write_offset.load(),
+        "Commands left in the ring");
+  }
+}
+
+/**
+ * \brief Checks that commands are refused when the ring is full.
+ */
+void test_commands_full(TestEnvironment& /* env */) {
+
+  std::unique_ptr<Layout> layout = create_layout();
+  set_command_offsets(*layout, ring_size / 2);
+
+  // Larger than the ring.
+  Debug::check_assertion(!LauncherChannel::push_command(*layout, std::string(ring_size, 'x')),
+      "Command larger than the ring pushed");
+
+  // Exactly the size of the ring with its header.
+  const std::string big_command(ring_size - sizeof(uint32_t), 'x');
+  Debug::check_assertion(LauncherChannel::push_command(*layout, big_command),
+      "Cannot push a command that fills the ring");
+  Debug::check_assertion(!LauncherChannel::push_command(*layout, ""),
+      "Command pushed in a full ring");
+
+  std::vector<std::string> popped = LauncherChannel::pop_commands(*layout);
+  Debug::check_assertion(popped.size() == 1 && popped[0] == big_command,
+      "Wrong command popped from a full ring");
+
+  // Fill the ring with small commands.
+  int num_pushed = 0;
+  while (LauncherChannel::push_command(*layout, "abcd")) {
+    ++num_pushed;
+  }
+  Debug::check_assertion(num_pushed == static_cast<int>(ring_size / 8),
+      "Wrong number of commands in a full ring");
+  popped = LauncherChannel::pop_commands(*layout);
+  Debug::check_assertion(popped.size() == static_cast<size_t>(num_pushed),
+      "Commands lost in a full ring");
+  Debug::check_assertion(LauncherChannel::push_command(*layout, "abcd"),
+      "Cannot push after popping");
+}
+
+/**
+ * \brief Checks that a command with an invalid size empties the ring.
+ */
+void test_commands_corrupted(TestEnvironment& /* env */) {
+
+  std::unique_ptr<Layout> layout = create_layout();
+  set_command_offsets(*layout, ring_size - 2);
+  Debug::check_assertion(LauncherChannel::push_command(*layout, "print('ok')"),
+      "Cannot push a command");
+  Debug::check_assertion(LauncherChannel::push_command(*layout, "print('lost')"),
+      "Cannot push a command");
+
+  // Make the size of the first command larger than what was written.
+  const uint32_t size = 1000;
+  char header[sizeof(uint32_t)];
+  std::memcpy(header, &size, sizeof(uint32_t));
+  for (uint32_t i = 0; i < sizeof(uint32_t); ++i) {
+    layout->commands[(ring_size - 2 + i) % ring_size] = header[i];
+  }
+
+  Debug::check_assertion(LauncherChannel::pop_commands(*layout).empty(),
+      "Commands popped from a corrupted ring");
+  Debug::check_assertion(layout->command_read_offset.load() == layout->command_write_offset.load(),
+      "Corrupted commands left in the ring");
+
+  // The ring works again.
+  Debug::check_assertion(LauncherChannel::push_command(*layout, "print('again')"),
+      "Cannot push a command after a corruption");
+  Debug::check_assertion(LauncherChannel::pop_commands(*layout) ==
+      std::vector<std::string>({ "print('again')" }),
+      "Wrong command after a corruption");
+}
+
+/**
+ * \brief Checks that frames not read in time are dropped.
+ */
+void test_frames_overwritten(TestEnvironment& /* env */) {
+
+  std::unique_ptr<Layout> layout = create_layout();
+  std::vector<TelemetryRecord> frames;
+
+  push_frames(*layout, 10);
+  uint32_t next_frame = LauncherChannel::pop_frames(*layout, 0, frames);
+  Debug::check_assertion(next_frame == 10 && frames.size() == 10, "Wrong frames read");
+  for (uint32_t i = 0; i < 10; ++i) {
+    Debug::check_assertion(frames[i].frame_number == i &&
+        frames[i].date == 1000 + i &&
+        frames[i].stats.num_updates == static_cast<int>(i),
+        "Wrong frame " + std::to_string(i));
+  }
+
+  // More frames than the ring keeps: only the last ones are read.
+  frames.clear();
+  push_frames(*layout, capacity + 50);
+  next_frame = LauncherChannel::pop_frames(*layout, next_frame, frames);
+  Debug::check_assertion(next_frame == capacity + 60, "Wrong next frame");
+  Debug::check_assertion(frames.size() == capacity, "Overwritten frames read");
+  Debug::check_assertion(frames.front().frame_number == 60 &&
+      frames.back().frame_number == capacity + 59,
+      "Wrong frames kept");
+
+  // Nothing new.
+  frames.clear();
+  Debug::check_assertion(LauncherChannel::pop_frames(*layout, next_frame, frames) == next_frame &&
+      frames.empty(), "Frames read twice");
+
+  // Frame numbers wrap at 2^32.
+  layout->num_frames.store(std::numeric_limits<uint32_t>::max() - 2);
+  next_frame = layout->num_frames.load();
+  push_frames(*layout, 5);
+  next_frame = LauncherChannel::pop_frames(*layout, next_frame, frames);
+  Debug::check_assertion(next_frame == 2 && frames.size() == 5, "Wrong frames after wrapping");
+  Debug::check_assertion(frames[2].frame_number == std::numeric_limits<uint32_t>::max() &&
+      frames[3].frame_number == 0,
+      "Wrong frame numbers after wrapping");
+}
+
+}
+
+/**
+ * \brief Tests the rings of the launcher channel.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_commands_wrap_around(env);
+  test_commands_full(env);
+  test_commands_corrupted(env);
+  test_frames_overwritten(env);
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/lua/LuaAllocator.h"
+#include "tools/TestEnvironment.h"
+#include <cstring>
+#include <lua.hpp>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests allocating, resizing and freeing blocks directly.
+ */
+void test_blocks(TestEnvironment& /* env */) {
+
+  LuaAllocator allocator;
+
+  char* small = static_cast<char*>(LuaAllocator::allocate(&allocator, nullptr, 0, 20));
+  Debug::check_assertion(small != nullptr, "Allocation failed");
+  std::memset(small, 'a', 20);
+  Debug::check_assertion(allocator.get_stats().live_bytes == 20, "Wrong live bytes");
+
+  // Same size class: the block does not move.
+  char* same = static_cast<char*>(LuaAllocator::allocate(&allocator, small, 20, 30));
+  Debug::check_assertion(same == small, "Block moved within its size class");
+
+  // Larger than the pools: the content is kept.
+  char* large = static_cast<char*>(LuaAllocator::allocate(&allocator, same, 30, 1000));
+  Debug::check_assertion(large != nullptr, "Reallocation failed");
+  for (int i = 0; i < 20; ++i) {
+    Debug::check_assertion(large[i] == 'a', "Content lost when moving a block");
+  }
+  Debug::check_assertion(allocator.get_stats().large_bytes == 1000, "Wrong large bytes");
+
+  // Freed blocks are reused.
+  void* block = LuaAllocator::allocate(&allocator, nullptr, 0, 64);
+  LuaAllocator::allocate(&allocator, block, 64, 0);
+  void* reused = LuaAllocator::allocate(&allocator, nullptr, 0, 50);
+  Debug::check_assertion(reused == block, "Free block not reused");
+
+  LuaAllocator::allocate(&allocator, reused, 50, 0);
+  LuaAllocator::allocate(&allocator, large, 1000, 0);
+  Debug::check_assertion(allocator.get_stats().live_bytes == 0, "Memory still live");
+  Debug::check_assertion(allocator.get_stats().large_bytes == 0, "Large blocks still live");
+}
+
+/**
+ * \brief Tests running a Lua state with the allocator.
+ */
+void test_lua_state(TestEnvironment& /* env */) {
+
+  LuaAllocator allocator;
+  lua_State* l = lua_newstate(&LuaAllocator::allocate, &allocator);
+  if (l == nullptr) {
+    // Not supported by this Lua runtime.
+    return;
+  }
+  luaL_openlibs(l);
+  const int result = luaL_dostring(l,
+      "local t = {}\n"
+      "for i = 1, 10000 do t[i] = { i, tostring(i) } end\n"
+      "t = nil\n"
+      "collectgarbage()\n");
+  Debug::check_assertion(result == 0, "Lua code failed");
+  Debug::check_assertion(allocator.get_stats().num_allocations > 10000, "Allocations not counted");
+
+  allocator.start_frame();
+  Debug::check_assertion(allocator.get_stats().frame_allocations > 10000, "Frame allocations not counted");
+  allocator.start_frame();
+  Debug::check_assertion(allocator.get_stats().frame_allocations == 0, "Wrong frame allocations");
+
+  lua_close(l);
+  Debug::check_assertion(allocator.get_stats().live_bytes == 0, "Memory still live after lua_close()");
+}
+
+}
+
+/**
+ * Tests for the allocator of Lua states.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_blocks(env);
+  test_lua_state(env);
+
+  return 0;
+}
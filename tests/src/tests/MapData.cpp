@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestDatabase.h"
@@ -75,6 +76,21 @@ void check_map(TestEnvironment& /* env */, const std::string& map_id) {
     Debug::die("Map '" + map_id + "': exported file differs from the original one");
   }
 
+  // Check that the binary form gives the same data.
+  BinaryWriter writer;
+  success = map_data.export_to_binary(writer);
+  Debug::check_assertion(success, "Map binary export failed");
+
+  MapData binary_map_data;
+  BinaryReader reader(writer.get_buffer());
+  success = binary_map_data.import_from_binary(reader);
+  Debug::check_assertion(success, "Map binary import failed");
+
+  std::string binary_map_buffer;
+  success = binary_map_data.export_to_buffer(binary_map_buffer);
+  Debug::check_assertion(success && binary_map_buffer == imported_map_buffer,
+      "Map '" + map_id + "': binary data differs from the original one");
+
   // Then export and import every entity of the map.
   for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
     for (int j = 0; j < map_data.get_num_entities(layer); ++j) {
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/Grid.h"
+#include "solarus/containers/MonotonicArena.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <cstdint>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests that allocations are aligned and come from few blocks.
+ */
+void test_allocations(TestEnvironment& /* env */) {
+
+  MonotonicArena arena(1024);
+  for (int i = 0; i < 100; ++i) {
+    void* bytes = arena.allocate(3, 1);
+    void* value = arena.allocate(sizeof(double), alignof(double));
+    Debug::check_assertion(bytes != nullptr, "Allocation failed");
+    Debug::check_assertion(reinterpret_cast<uintptr_t>(value) % alignof(double) == 0,
+        "Wrong alignment");
+  }
+  Debug::check_assertion(arena.get_num_bytes_used() == 100 * (3 + sizeof(double)),
+      "Wrong number of bytes used");
+  Debug::check_assertion(arena.get_num_blocks() < 10, "Too many blocks");
+
+  // A request bigger than a block gets its own block.
+  arena.allocate(4096, 8);
+
+  arena.release();
+  Debug::check_assertion(arena.get_num_blocks() == 0, "Blocks not released");
+  Debug::check_assertion(arena.get_num_bytes_used() == 0, "Bytes not released");
+}
+
+/**
+ * \brief Tests containers using an arena.
+ */
+void test_containers(TestEnvironment& /* env */) {
+
+  MonotonicArena arena;
+  {
+    std::vector<int, ArenaAllocator<int>> values((ArenaAllocator<int>(arena)));
+    for (int i = 0; i < 1000; ++i) {
+      values.push_back(i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+      Debug::check_assertion(values[i] == i, "Wrong value");
+    }
+
+    Grid<int, ArenaAllocator<int>> grid(Size(640, 480), Size(64, 64), ArenaAllocator<int>(arena));
+    grid.add(42, Rectangle(0, 0, 16, 16));
+    Debug::check_assertion(grid.get_elements(0).size() == 1, "Element not in the grid");
+    Debug::check_assertion(grid.get_elements(0).get_allocator().get_arena() == &arena,
+        "Cell not in the arena");
+  }
+  Debug::check_assertion(arena.get_num_bytes_used() > 1000 * sizeof(int), "Arena not used");
+
+  // Without an arena, the global heap is used.
+  std::vector<int, ArenaAllocator<int>> values;
+  values.push_back(1);
+  Debug::check_assertion(values.get_allocator().get_arena() == nullptr, "Unexpected arena");
+}
+
+}
+
+/**
+ * Tests for the monotonic arena.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_allocations(env);
+  test_containers(env);
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/movements/MotionIntegrator.h"
+#include "tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests that small steps add up to the exact number of units.
+ */
+void test_accumulation(TestEnvironment& /* env */) {
+
+  MotionIntegrator motion;
+  motion.set_speed(60.0);
+  motion.restart(1000);
+
+  // The first unit is due at the start date.
+  Debug::check_assertion(motion.advance(1000) == 1, "First unit not due");
+
+  int num_units = 0;
+  for (uint32_t now = 1000; now <= 2000; now += 10) {
+    num_units += motion.advance(now);
+  }
+  Debug::check_assertion(num_units == 60, "Wrong number of units");
+
+  // Sub-unit speeds are not lost to rounding.
+  motion.set_speed(1.5);
+  motion.restart(0);
+  num_units = 0;
+  for (uint32_t now = 0; now <= 2000; now += 16) {
+    num_units += motion.advance(now);
+  }
+  Debug::check_assertion(num_units == 1 + 3, "Fractions lost");
+}
+
+/**
+ * \brief Tests that advancing in one call or many calls gives the same result.
+ */
+void test_determinism(TestEnvironment& /* env */) {
+
+  MotionIntegrator once;
+  MotionIntegrator often;
+  once.set_speed(37.3);
+  often.set_speed(37.3);
+  once.restart(0);
+  often.restart(0);
+
+  int num_units = 0;
+  for (uint32_t now = 0; now <= 5000; now += 7) {
+    num_units += often.advance(now);
+  }
+  Debug::check_assertion(once.advance(often.get_date()) == num_units,
+      "Result depends on the update rate");
+}
+
+/**
+ * \brief Tests postponing and stopping the motion.
+ */
+void test_shift_and_stop(TestEnvironment& /* env */) {
+
+  MotionIntegrator motion;
+  motion.set_speed(100.0);
+  motion.restart(0);
+  Debug::check_assertion(motion.advance(0) == 1, "First unit not due");
+
+  motion.shift(500);
+  Debug::check_assertion(motion.advance(400) == 0, "Motion not postponed");
+  Debug::check_assertion(motion.advance(600) == 10, "Wrong units after shift");
+
+  motion.set_speed(0.0);
+  motion.restart(600);
+  Debug::check_assertion(motion.advance(10000) == 0, "Stopped motion moved");
+}
+
+}
+
+/**
+ * Tests for the fixed-point motion integrator.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_accumulation(env);
+  test_determinism(env);
+  test_shift_and_stop(env);
+
+  return 0;
+}
@@ -47,6 +47,23 @@ void test_path_to_hero(TestEnvironment& env, Entity& entity) {
   const std::string expected_path = traversable ? "7777700" : "77777";
   Debug::check_assertion(path == expected_path,
       std::string("Unexpected path: '") + path + "', expected '" + expected_path + "'");
+
+  // The same search run incrementally with its own workspace.
+  PathFinding::Workspace workspace;
+  PathFinding incremental_path_finder(env.get_map(), entity, hero, workspace);
+  incremental_path_finder.start();
+  int num_steps = 0;
+  bool finished = false;
+  while (!finished) {
+    int max_expansions = 1;
+    finished = incremental_path_finder.step(max_expansions);
+    ++num_steps;
+  }
+  Debug::check_assertion(num_steps > 1, "Incremental search done in one step");
+  Debug::check_assertion(incremental_path_finder.is_finished(), "Search not finished");
+  Debug::check_assertion(incremental_path_finder.get_path() == path,
+      std::string("Unexpected incremental path: '") + incremental_path_finder.get_path() +
+      "', expected '" + path + "'");
 }
 
 /**
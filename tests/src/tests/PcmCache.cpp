@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/PcmCache.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+using Track = PcmCache::Track;
+
+constexpr size_t block_frames = Track::block_frames;
+
+/**
+ * \brief Creates stereo frames with a different signal on each channel.
+ */
+std::vector<int16_t> create_frames(size_t num_frames) {
+
+  const double pi = 3.14159265358979323846;
+  std::vector<int16_t> frames(num_frames * 2);
+  for (size_t i = 0; i < num_frames; ++i) {
+    const double t = static_cast<double>(i) / 32000;
+    frames[i * 2] = static_cast<int16_t>(std::lround(8000 * std::sin(2 * pi * 440 * t)));
+    frames[i * 2 + 1] = static_cast<int16_t>(std::lround(
+        4000 * std::sin(2 * pi * 1000 * t) + 2000 * std::sin(2 * pi * 150 * t)));
+  }
+  return frames;
+}
+
+/**
+ * \brief Creates a complete track from frames.
+ */
+std::shared_ptr<Track> create_track(const std::vector<int16_t>& frames) {
+
+  std::shared_ptr<Track> track = std::make_shared<Track>(32000);
+  // Append in chunks that do not match the blocks.
+  const size_t num_frames = frames.size() / 2;
+  for (size_t done = 0; done < num_frames; done += 700) {
+    const size_t count = std::min<size_t>(700, num_frames - done);
+    track->append(&frames[done * 2], count);
+  }
+  track->finish();
+  return track;
+}
+
+/**
+ * \brief Reads frames of a track.
+ */
+std::vector<int16_t> read_frames(const Track& track, size_t first_frame, size_t num_frames) {
+
+  std::vector<int16_t> frames(num_frames * 2);
+  track.read(first_frame, frames.data(), num_frames);
+  return frames;
+}
+
+/**
+ * \brief Checks that a track decodes close to the frames it was made of.
+ */
+void test_round_trip(TestEnvironment& /* env */) {
+
+  // The last block is not full.
+  const size_t num_frames = 5 * block_frames + 300;
+  const std::vector<int16_t> frames = create_frames(num_frames);
+  std::shared_ptr<Track> track = create_track(frames);
+
+  Debug::check_assertion(track->is_complete(), "Track not complete");
+  Debug::check_assertion(track->get_num_frames() == num_frames, "Wrong number of frames");
+  Debug::check_assertion(track->get_size() == 6 * Track::block_size, "Wrong track size");
+  Debug::check_assertion(track->get_size() < num_frames * 2 * sizeof(int16_t) / 3,
+      "Track not compressed");
+
+  const std::vector<int16_t> decoded = read_frames(*track, 0, num_frames);
+
+  // The step size needs a few frames to adapt at the start of the track.
+  const size_t warm_up_frames = 64;
+  int max_error = 0;
+  for (size_t i = warm_up_frames * 2; i < frames.size(); ++i) {
+    max_error = std::max(max_error, std::abs(decoded[i] - frames[i]));
+  }
+  Debug::check_assertion(max_error <= 256,
+      "ADPCM error too high: " + std::to_string(max_error));
+}
+
+/**
+ * \brief Checks reads starting on block boundaries and looping to the start.
+ */
+void test_block_boundaries(TestEnvironment& /* env */) {
+
+  // The track ends exactly at the end of a block.
+  const size_t num_frames = 3 * block_frames;
+  std::shared_ptr<Track> track = create_track(create_frames(num_frames));
+  Debug::check_assertion(track->get_size() == 3 * Track::block_size, "Wrong track size");
+
+  const std::vector<int16_t> all = read_frames(*track, 0, num_frames);
+
+  // Blocks decode independently: starting at a block gives the same frames.
+  for (size_t block = 0; block < 3; ++block) {
+    const size_t first_frame = block * block_frames;
+    const std::vector<int16_t> part = read_frames(*track, first_frame, block_frames);
+    Debug::check_assertion(std::equal(part.begin(), part.end(), all.begin() + first_frame * 2),
+        "Different frames when reading from block " + std::to_string(block));
+  }
+
+  // Reading past the end continues from the first block.
+  const std::vector<int16_t> looped = read_frames(*track, num_frames - 100, 300);
+  Debug::check_assertion(std::equal(looped.begin(), looped.begin() + 200, all.end() - 200) &&
+      std::equal(looped.begin() + 200, looped.end(), all.begin()),
+      "Wrong frames when looping at the end of a block");
+
+  // Positions past the end wrap around.
+  Debug::check_assertion(read_frames(*track, num_frames + block_frames, 50) ==
+      read_frames(*track, block_frames, 50),
+      "Wrong frames when starting after the end");
+
+  // The last block of a shorter track is padded but not played.
+  const size_t short_frames = block_frames + 10;
+  std::shared_ptr<Track> short_track = create_track(create_frames(short_frames));
+  const std::vector<int16_t> short_all = read_frames(*short_track, 0, short_frames);
+  const std::vector<int16_t> short_looped = read_frames(*short_track, block_frames, 20);
+  Debug::check_assertion(std::equal(short_looped.begin(), short_looped.begin() + 20, short_all.end() - 20) &&
+      std::equal(short_looped.begin() + 20, short_looped.end(), short_all.begin()),
+      "Padding frames played");
+}
+
+/**
+ * \brief Creates an SPC file whose program does nothing for one second.
+ */
+std::string create_spc_file() {
+
+  std::string data(0x10200, '\0');
+  const char signature[] = "SNES-SPC700 Sound File Data v0.30\x1A\x1A";
+  std::memcpy(&data[0], signature, sizeof(signature) - 1);
+  data[0x23] = 26;   // Has an ID666 tag.
+  data[0x24] = 30;   // Version.
+  data[0xA9] = '1';  // Length in seconds, in text.
+  return data;
+}
+
+/**
+ * \brief Waits until the cache is done with a music.
+ * \return The complete track, or nullptr if the music could not be cached.
+ */
+PcmCache::TrackPtr wait_track(const std::string& file_name, const std::string& data) {
+
+  for (int i = 0; i < 1000; ++i) {
+    PcmCache::TrackPtr track = PcmCache::get_track(
+        file_name, PcmCache::Source::SPC, data.data(), data.size());
+    if (track == nullptr || track->is_complete()) {
+      return track;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  Debug::die("Music not rendered in time: '" + file_name + "'");
+  return nullptr;
+}
+
+/**
+ * \brief Checks that musics are rendered within the byte budget.
+ */
+void test_budget(TestEnvironment& /* env */) {
+
+  const std::string data = create_spc_file();
+  const size_t track_size = 32 * Track::block_size;  // One second at 32 kHz.
+
+  // A track larger than the budget is not kept.
+  PcmCache::quit();
+  PcmCache::initialize(track_size - 1);
+  Debug::check_assertion(wait_track("musics/too_big.spc", data) == nullptr,
+      "Track larger than the budget");
+  Debug::check_assertion(PcmCache::get_track(
+      "musics/too_big.spc", PcmCache::Source::SPC, data.data(), data.size()) == nullptr,
+      "Track larger than the budget rendered again");
+  PcmCache::quit();
+
+  // Room for one track: the least recently used one is dropped.
+  PcmCache::initialize(track_size + track_size / 2);
+  std::weak_ptr<const Track> first = wait_track("musics/first.spc", data);
+  PcmCache::TrackPtr second = wait_track("musics/second.spc", data);
+  Debug::check_assertion(second != nullptr, "Track not rendered");
+  Debug::check_assertion(second->get_num_frames() == 32000, "Wrong number of frames");
+  Debug::check_assertion(second->get_sample_rate() == 32000, "Wrong sample rate");
+  Debug::check_assertion(second->get_size() == track_size, "Wrong track size");
+  Debug::check_assertion(first.expired(), "Track kept beyond the budget");
+  PcmCache::quit();
+}
+
+}
+
+/**
+ * \brief Tests the cache of rendered musics.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_round_trip(env);
+  test_block_boundaries(env);
+  test_budget(env);
+
+  return 0;
+}
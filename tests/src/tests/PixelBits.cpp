@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/PixelBits.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates an image with random opaque pixels.
+ * \param density Percentage of opaque pixels.
+ */
+PixelBits create_image(std::mt19937& random, const Size& size, int density) {
+
+  std::vector<bool> opaque_pixels(size.width * size.height);
+  for (size_t i = 0; i < opaque_pixels.size(); ++i) {
+    opaque_pixels[i] = static_cast<int>(random() % 100) < density;
+  }
+  return PixelBits(size, opaque_pixels);
+}
+
+/**
+ * \brief A random rotation and scaling.
+ */
+struct RandomTransform {
+
+  explicit RandomTransform(std::mt19937& random) :
+    position(random() % 64, random() % 64),
+    origin(random() % 16, random() % 16),
+    scale(0.25f + (random() % 300) / 100.0f, 0.25f + (random() % 300) / 100.0f),
+    rotation((random() % 4 == 0) ? 0.0 : (random() % 628) / 100.0) {
+  }
+
+  Transform get_transform() const {
+    return Transform(position, origin, scale, rotation);
+  }
+
+  Point position;
+  Point origin;
+  Scale scale;
+  double rotation;
+};
+
+/**
+ * \brief Creates an image with a few opaque rectangles,
+ * like a big sprite with empty areas.
+ */
+PixelBits create_sparse_image(std::mt19937& random, const Size& size) {
+
+  std::vector<bool> opaque_pixels(size.width * size.height);
+  const int num_rectangles = random() % 4;
+  for (int i = 0; i < num_rectangles; ++i) {
+    const int x = random() % size.width;
+    const int y = random() % size.height;
+    const int width = 1 + random() % 12;
+    const int height = 1 + random() % 12;
+    for (int j = y; j < std::min(y + height, size.height); ++j) {
+      for (int k = x; k < std::min(x + width, size.width); ++k) {
+        opaque_pixels[j * size.width + k] = (random() % 4) != 0;
+      }
+    }
+  }
+  return PixelBits(size, opaque_pixels);
+}
+
+/**
+ * \brief Checks that the aligned collision test, with its bounding boxes
+ * and blocks, gives the same result as projecting each pixel.
+ */
+void test_aligned_exact(TestEnvironment& /* env */) {
+
+  std::mt19937 random(42);
+  const Point origin;
+  const Scale scale;
+  int num_collisions = 0;
+  for (int i = 0; i < 5000; ++i) {
+    const PixelBits image1 = create_sparse_image(random, Size(1 + random() % 100, 1 + random() % 100));
+    const PixelBits image2 = create_sparse_image(random, Size(1 + random() % 40, 1 + random() % 40));
+    const Point location1(random() % 64, random() % 64);
+    const Point location2(random() % 100, random() % 100);
+    const Transform transform1(location1, origin, scale, 0.0);
+    const Transform transform2(location2, origin, scale, 0.0);
+
+    const bool expected = image1.test_oriented_collision_per_pixel(image2, transform1, transform2);
+    Debug::check_assertion(image1.test_aligned_collision(image2, location1, location2) == expected,
+        "Different aligned collision result for case " + std::to_string(i));
+    Debug::check_assertion(image2.test_aligned_collision(image1, location2, location1) == expected,
+        "Different symmetric aligned collision result for case " + std::to_string(i));
+    if (expected) {
+      ++num_collisions;
+    }
+  }
+
+  Debug::check_assertion(num_collisions > 20 && num_collisions < 4900,
+      "Unexpected number of collisions: " + std::to_string(num_collisions));
+}
+
+/**
+ * \brief Checks that the word-parallel oriented collision test gives the
+ * same result as the per-pixel one.
+ */
+void test_oriented_exact(TestEnvironment& /* env */) {
+
+  std::mt19937 random(42);
+  int num_collisions = 0;
+  for (int i = 0; i < 5000; ++i) {
+    // Widths larger than 64 to test rows of several words.
+    const int density = random() % 100;
+    const PixelBits image1 = create_image(random, Size(1 + random() % 90, 1 + random() % 40), density);
+    const PixelBits image2 = create_image(random, Size(1 + random() % 90, 1 + random() % 40), density / 3);
+    const RandomTransform transform1(random);
+    const RandomTransform transform2(random);
+
+    const bool expected = image1.test_oriented_collision_per_pixel(
+        image2, transform1.get_transform(), transform2.get_transform());
+    const bool result = image1.test_oriented_collision(
+        image2, transform1.get_transform(), transform2.get_transform());
+    Debug::check_assertion(result == expected,
+        "Different oriented collision result for case " + std::to_string(i));
+    if (expected) {
+      ++num_collisions;
+    }
+  }
+
+  // Make sure that both results were tested.
+  Debug::check_assertion(num_collisions > 500 && num_collisions < 4500,
+      "Unexpected number of collisions: " + std::to_string(num_collisions));
+}
+
+/**
+ * \brief Compares the speed of both oriented collision tests
+ * on large sprites.
+ */
+void benchmark_oriented(TestEnvironment& /* env */) {
+
+  using Clock = std::chrono::steady_clock;
+
+  std::mt19937 random(42);
+  std::vector<PixelBits> images;
+  std::vector<RandomTransform> transforms;
+  for (int i = 0; i < 200; ++i) {
+    images.push_back(create_image(random, Size(64 + random() % 64, 64 + random() % 64), 10 + random() % 30));
+    transforms.emplace_back(random);
+  }
+
+  std::chrono::duration<double, std::milli> per_pixel_time(0);
+  std::chrono::duration<double, std::milli> word_time(0);
+  for (size_t i = 0; i + 1 < images.size(); ++i) {
+    const Transform transform1 = transforms[i].get_transform();
+    const Transform transform2 = transforms[i + 1].get_transform();
+
+    Clock::time_point start = Clock::now();
+    const bool expected = images[i].test_oriented_collision_per_pixel(images[i + 1], transform1, transform2);
+    per_pixel_time += Clock::now() - start;
+
+    start = Clock::now();
+    const bool result = images[i].test_oriented_collision(images[i + 1], transform1, transform2);
+    word_time += Clock::now() - start;
+
+    Debug::check_assertion(result == expected, "Different oriented collision result");
+  }
+
+  Logger::info("Oriented pixel collisions: per pixel " +
+      std::to_string(per_pixel_time.count()) + " ms, by words " +
+      std::to_string(word_time.count()) + " ms");
+}
+
+}
+
+/**
+ * \brief Tests pixel-precise collisions.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_aligned_exact(env);
+  test_oriented_exact(env);
+  benchmark_oriented(env);
+
+  return 0;
+}
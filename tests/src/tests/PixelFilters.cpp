@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Hq2xFilter.h"
+#include "solarus/graphics/Hq3xFilter.h"
+#include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/PixelFilterExecutor.h"
+#include "solarus/graphics/Scale2xFilter.h"
+#include "tools/TestEnvironment.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates an image with a few colors, like in pixel art.
+ */
+std::vector<uint32_t> create_image(std::mt19937& random, int width, int height) {
+
+  // Similar colors are sometimes considered equal by hqx.
+  const uint32_t base = random();
+  std::vector<uint32_t> palette;
+  for (int i = 0; i < 6; ++i) {
+    palette.push_back((i % 2 == 0) ? random() : (base ^ (random() & 0x0F0F0F)));
+  }
+
+  std::vector<uint32_t> image(width * height);
+  for (uint32_t& pixel : image) {
+    pixel = palette[random() % palette.size()];
+  }
+  return image;
+}
+
+/**
+ * \brief Checks that a filter gives the same result with and without SIMD.
+ */
+void test_simd_exact(
+    TestEnvironment& /* env */,
+    const SoftwarePixelFilter& filter,
+    const std::string& name) {
+
+  std::mt19937 random(42);
+  const int factor = filter.get_scaling_factor();
+
+  // Various sizes, to test the pixels handled by scalar code at the end of rows.
+  for (int width = 1; width <= 21; width += 4) {
+    for (int height = 1; height <= 9; height += 4) {
+      const std::vector<uint32_t> image = create_image(random, width, height);
+      std::vector<uint32_t> scalar_result(width * height * factor * factor);
+      std::vector<uint32_t> simd_result(scalar_result.size());
+
+      SoftwarePixelFilter::set_simd_enabled(false);
+      filter.filter(image.data(), width, height, scalar_result.data());
+      SoftwarePixelFilter::set_simd_enabled(true);
+      filter.filter(image.data(), width, height, simd_result.data());
+
+      Debug::check_assertion(simd_result == scalar_result,
+          name + ": different result with SIMD for an image of size " +
+          std::to_string(width) + "x" + std::to_string(height));
+    }
+  }
+}
+
+/**
+ * \brief Checks that a filter gives the same result on one or several threads.
+ */
+void test_threads_exact(
+    TestEnvironment& /* env */,
+    const SoftwarePixelFilter& filter,
+    const std::string& name) {
+
+  std::mt19937 random(42);
+  const int factor = filter.get_scaling_factor();
+  const int width = 37;
+  const int height = 4 * PixelFilterExecutor::min_rows_per_band + 3;
+
+  const std::vector<uint32_t> image = create_image(random, width, height);
+  std::vector<uint32_t> single_result(width * height * factor * factor);
+  std::vector<uint32_t> multi_result(single_result.size());
+
+  PixelFilterExecutor::set_num_threads(1);
+  filter.filter(image.data(), width, height, single_result.data());
+  PixelFilterExecutor::set_num_threads(3);
+  filter.filter(image.data(), width, height, multi_result.data());
+  PixelFilterExecutor::set_num_threads(0);
+
+  Debug::check_assertion(multi_result == single_result,
+      name + ": different result with several threads");
+}
+
+}
+
+/**
+ * \brief Tests the software pixel filters.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_simd_exact(env, Scale2xFilter(), "scale2x");
+  test_simd_exact(env, Hq2xFilter(), "hq2x");
+  test_simd_exact(env, Hq3xFilter(), "hq3x");
+  test_simd_exact(env, Hq4xFilter(), "hq4x");
+  test_threads_exact(env, Scale2xFilter(), "scale2x");
+  test_threads_exact(env, Hq2xFilter(), "hq2x");
+  test_threads_exact(env, Hq3xFilter(), "hq3x");
+  test_threads_exact(env, Hq4xFilter(), "hq4x");
+
+  return 0;
+}
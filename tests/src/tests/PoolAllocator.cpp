@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/PoolAllocator.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Object whose construction and destruction are counted.
+ */
+class Counted: public std::enable_shared_from_this<Counted> {
+
+  public:
+
+    explicit Counted(const std::string& name):
+      name(name) {
+      ++num_alive;
+    }
+
+    ~Counted() {
+      --num_alive;
+    }
+
+    std::string name;
+    char payload[200];
+
+    static int num_alive;
+};
+
+int Counted::num_alive = 0;
+
+/**
+ * \brief Tests that destroyed objects give their memory to new ones.
+ */
+void test_recycling(TestEnvironment& /* env */) {
+
+  const Counted* first_address = nullptr;
+  {
+    std::shared_ptr<Counted> object = make_pooled<Counted>("first");
+    Debug::check_assertion(object->name == "first", "Wrong object");
+    Debug::check_assertion(object->shared_from_this() == object, "Wrong shared_from_this");
+    Debug::check_assertion(Counted::num_alive == 1, "Object not constructed");
+    first_address = object.get();
+  }
+  Debug::check_assertion(Counted::num_alive == 0, "Object not destroyed");
+
+  std::shared_ptr<Counted> object = make_pooled<Counted>("second");
+  Debug::check_assertion(object.get() == first_address, "Memory not recycled");
+  Debug::check_assertion(object->name == "second", "Object not reinitialized");
+}
+
+/**
+ * \brief Tests that the number of blocks kept is bounded.
+ */
+void test_max_free_blocks(TestEnvironment& /* env */) {
+
+  using FreeList = PoolFreeList<sizeof(Counted)>;
+  PoolAllocator<Counted> allocator;
+
+  std::vector<Counted*> blocks;
+  for (size_t i = 0; i < 2 * FreeList::max_free_blocks; ++i) {
+    blocks.push_back(allocator.allocate(1));
+  }
+  Debug::check_assertion(FreeList::get_num_free_blocks() == 0, "Free blocks not reused");
+
+  for (Counted* block : blocks) {
+    allocator.deallocate(block, 1);
+  }
+  Debug::check_assertion(FreeList::get_num_free_blocks() == FreeList::max_free_blocks,
+      "Wrong number of free blocks");
+}
+
+/**
+ * \brief Tests arrays, which bypass the pool.
+ */
+void test_arrays(TestEnvironment& /* env */) {
+
+  std::vector<int, PoolAllocator<int>> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(i);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    Debug::check_assertion(values[i] == i, "Wrong value");
+  }
+}
+
+}
+
+/**
+ * Tests for the pool allocator.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_recycling(env);
+  test_max_free_blocks(env);
+  test_arrays(env);
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/QuestDatabase.h"
+#include "solarus/core/ResourceType.h"
+#include "solarus/core/Symbol.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests looking up ids by string and by symbol.
+ */
+void test_resource_exists(TestEnvironment& /* env */) {
+
+  QuestDatabase database;
+  Debug::check_assertion(database.add(ResourceType::SOUND, "sword", "Sword"), "Add failed");
+  Debug::check_assertion(!database.add(ResourceType::SOUND, "sword", "Other"), "Duplicate added");
+
+  Debug::check_assertion(database.resource_exists(ResourceType::SOUND, "sword"), "Missing id");
+  Debug::check_assertion(database.resource_exists(ResourceType::SOUND, Symbol("sword")), "Missing symbol");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SPRITE, "sword"), "Wrong type");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SOUND, "quest_database_unknown_id"),
+      "Unknown id found");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SOUND, ""), "Empty id found");
+
+  Debug::check_assertion(database.rename(ResourceType::SOUND, "sword", "shield"), "Rename failed");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SOUND, "sword"), "Old id still found");
+  Debug::check_assertion(database.resource_exists(ResourceType::SOUND, "shield"), "New id not found");
+  Debug::check_assertion(database.get_description(ResourceType::SOUND, "shield") == "Sword",
+      "Description lost");
+
+  Debug::check_assertion(database.remove(ResourceType::SOUND, "shield"), "Remove failed");
+  Debug::check_assertion(!database.remove(ResourceType::SOUND, "shield"), "Removed twice");
+  Debug::check_assertion(!database.resource_exists(ResourceType::SOUND, Symbol("shield")),
+      "Removed id found");
+
+  database.add(ResourceType::MAP, "first_map", "");
+  database.clear();
+  Debug::check_assertion(!database.resource_exists(ResourceType::MAP, "first_map"), "Not cleared");
+}
+
+/**
+ * \brief Tests that file information is exported sorted by path.
+ */
+void test_file_info_export(TestEnvironment& /* env */) {
+
+  QuestDatabase database;
+  database.set_file_info("sprites/b.png", { "B", "CC0" });
+  database.set_file_info("maps/a.dat", { "A", "CC0" });
+  database.set_file_info("sounds/c.ogg", { "C", "CC0" });
+
+  std::string buffer;
+  Debug::check_assertion(database.export_to_buffer(buffer), "Export failed");
+  const size_t map_index = buffer.find("maps/a.dat");
+  const size_t sound_index = buffer.find("sounds/c.ogg");
+  const size_t sprite_index = buffer.find("sprites/b.png");
+  Debug::check_assertion(map_index != std::string::npos &&
+      map_index < sound_index && sound_index < sprite_index, "Files not sorted");
+
+  QuestDatabase imported;
+  Debug::check_assertion(imported.import_from_buffer(buffer, "project_db.dat"), "Import failed");
+  Debug::check_assertion(imported.get_file_info("sounds/c.ogg").author == "C", "Wrong file info");
+  Debug::check_assertion(imported.get_all_file_info().size() == 3, "Wrong number of files");
+}
+
+}
+
+/**
+ * \brief Tests for the quest database.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_resource_exists(env);
+  test_file_info_export(env);
+
+  return 0;
+}
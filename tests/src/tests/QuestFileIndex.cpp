@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/QuestFileIndex.h"
+#include "solarus/core/QuestFiles.h"
+#include "tools/TestEnvironment.h"
+#include <physfs.h>
+#include <cstdint>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Appends a little-endian integer to a buffer.
+ */
+void write_uint(std::string& buffer, uint32_t value, int num_bytes) {
+
+  for (int i = 0; i < num_bytes; ++i) {
+    buffer += static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+/**
+ * \brief Computes the CRC-32 of a zip entry.
+ */
+uint32_t get_crc32(const std::string& data) {
+
+  uint32_t crc = 0xFFFFFFFF;
+  for (char c : data) {
+    crc ^= static_cast<unsigned char>(c);
+    for (int i = 0; i < 8; ++i) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * \brief Creates a zip archive with one uncompressed file.
+ * \param prefix Bytes to put before the archive.
+ * \param name Name of the file in the archive.
+ * \param content Content of the file.
+ * \return The archive.
+ */
+std::string make_zip(const std::string& prefix, const std::string& name, const std::string& content) {
+
+  const uint32_t crc = get_crc32(content);
+  const uint32_t size = static_cast<uint32_t>(content.size());
+
+  std::string zip = prefix;
+  const uint32_t local_offset = static_cast<uint32_t>(zip.size());
+  write_uint(zip, 0x04034b50, 4);  // Signature.
+  write_uint(zip, 10, 2);          // Version needed.
+  write_uint(zip, 0, 2);           // Flags.
+  write_uint(zip, 0, 2);           // Stored.
+  write_uint(zip, 0, 4);           // Date and time.
+  write_uint(zip, crc, 4);
+  write_uint(zip, size, 4);
+  write_uint(zip, size, 4);
+  write_uint(zip, static_cast<uint32_t>(name.size()), 2);
+  write_uint(zip, 4, 2);           // Extra field only in the local header.
+  zip += name;
+  zip += std::string(4, '\0');
+  zip += content;
+
+  const uint32_t directory_offset = static_cast<uint32_t>(zip.size());
+  write_uint(zip, 0x02014b50, 4);  // Signature.
+  write_uint(zip, 10, 2);          // Version made by.
+  write_uint(zip, 10, 2);          // Version needed.
+  write_uint(zip, 0, 2);           // Flags.
+  write_uint(zip, 0, 2);           // Stored.
+  write_uint(zip, 0, 4);           // Date and time.
+  write_uint(zip, crc, 4);
+  write_uint(zip, size, 4);
+  write_uint(zip, size, 4);
+  write_uint(zip, static_cast<uint32_t>(name.size()), 2);
+  write_uint(zip, 0, 2);           // Extra field.
+  write_uint(zip, 0, 2);           // Comment.
+  write_uint(zip, 0, 2);           // Disk.
+  write_uint(zip, 0, 2);           // Internal attributes.
+  write_uint(zip, 0, 4);           // External attributes.
+  write_uint(zip, local_offset, 4);
+  zip += name;
+  const uint32_t directory_size = static_cast<uint32_t>(zip.size()) - directory_offset;
+
+  write_uint(zip, 0x06054b50, 4);  // Signature.
+  write_uint(zip, 0, 2);           // Disk.
+  write_uint(zip, 0, 2);           // Disk of the central directory.
+  write_uint(zip, 1, 2);           // Entries on this disk.
+  write_uint(zip, 1, 2);           // Entries.
+  write_uint(zip, directory_size, 4);
+  write_uint(zip, directory_offset, 4);
+  write_uint(zip, 0, 2);           // Comment.
+  return zip;
+}
+
+/**
+ * \brief Checks file name normalization.
+ */
+void test_normalize(TestEnvironment& /* env */) {
+
+  std::string name;
+  Debug::check_assertion(QuestFileIndex::normalize_file_name("maps/map.dat", name) &&
+      name == "maps/map.dat", "Wrong name");
+  Debug::check_assertion(QuestFileIndex::normalize_file_name("/maps//map.dat/", name) &&
+      name == "maps/map.dat", "Slashes not ignored");
+  Debug::check_assertion(!QuestFileIndex::normalize_file_name("maps/../quest.dat", name),
+      "Parent directory accepted");
+  Debug::check_assertion(!QuestFileIndex::normalize_file_name("./quest.dat", name),
+      "Current directory accepted");
+  Debug::check_assertion(!QuestFileIndex::normalize_file_name("", name),
+      "Empty name accepted");
+}
+
+/**
+ * \brief Checks that queries answered by the index match PhysFS.
+ */
+void test_queries(TestEnvironment& /* env */) {
+
+  Debug::check_assertion(QuestFiles::data_file_exists("quest.dat"), "Missing quest.dat");
+  Debug::check_assertion(!QuestFiles::data_file_is_dir("quest.dat"), "quest.dat is a directory");
+  Debug::check_assertion(QuestFiles::data_file_exists("maps"), "Missing maps directory");
+  Debug::check_assertion(QuestFiles::data_file_is_dir("maps"), "maps is not a directory");
+  Debug::check_assertion(QuestFiles::data_file_exists("/maps/"), "Slashes not ignored");
+  Debug::check_assertion(!QuestFiles::data_file_exists("maps/no_such_map.dat"), "Unexpected file");
+  Debug::check_assertion(!QuestFiles::data_file_is_dir("no_such_dir"), "Unexpected directory");
+
+  Debug::check_assertion(
+      QuestFiles::data_file_get_location("quest.dat") ==
+      QuestFiles::DataFileLocation::LOCATION_DATA_DIRECTORY,
+      "Wrong location");
+  Debug::check_assertion(
+      QuestFiles::data_file_get_location("no_such_file") ==
+      QuestFiles::DataFileLocation::LOCATION_NONE,
+      "Wrong location of a missing file");
+
+  // Read quest.dat through PhysFS to compare.
+  PHYSFS_file* file = PHYSFS_openRead("quest.dat");
+  Debug::check_assertion(file != nullptr, "Cannot open quest.dat");
+  std::string expected(static_cast<size_t>(PHYSFS_fileLength(file)), '\0');
+  PHYSFS_read(file, &expected[0], 1, static_cast<PHYSFS_uint32>(expected.size()));
+  PHYSFS_close(file);
+  Debug::check_assertion(QuestFiles::data_file_read("quest.dat") == expected,
+      "Wrong content");
+
+  // Files of the write directory shadow the data files.
+  QuestFiles::data_file_save("quest_file_index_test.txt", "written");
+  Debug::check_assertion(QuestFiles::data_file_exists("quest_file_index_test.txt"),
+      "Missing file of the write directory");
+  Debug::check_assertion(
+      QuestFiles::data_file_get_location("quest_file_index_test.txt") ==
+      QuestFiles::DataFileLocation::LOCATION_WRITE_DIRECTORY,
+      "Wrong location of a file of the write directory");
+  Debug::check_assertion(QuestFiles::data_file_read("quest_file_index_test.txt") == "written",
+      "Wrong content of a file of the write directory");
+  QuestFiles::data_file_delete("quest_file_index_test.txt");
+  Debug::check_assertion(!QuestFiles::data_file_exists("quest_file_index_test.txt"),
+      "Deleted file still exists");
+}
+
+/**
+ * \brief Checks direct reads of uncompressed archive entries.
+ */
+void test_archive(TestEnvironment& /* env */) {
+
+  const std::string content = "Stored entry content";
+  QuestFiles::data_file_save("quest_file_index_test.zip",
+      make_zip("Self-extracting prefix", "archive_test/stored.txt", content));
+  const std::string& archive_path =
+      QuestFiles::get_full_quest_write_dir() + "/quest_file_index_test.zip";
+  Debug::check_assertion(PHYSFS_addToSearchPath(archive_path.c_str(), 1) != 0,
+      "Cannot mount the archive");
+
+  QuestFileIndex index;
+  index.build();
+  Debug::check_assertion(index.get_num_entries() > 0, "Empty index");
+
+  const QuestFileIndex::Entry* directory = index.find("archive_test");
+  Debug::check_assertion(directory != nullptr && directory->directory,
+      "Missing archive directory");
+
+  const QuestFileIndex::Entry* entry = index.find("archive_test/stored.txt");
+  Debug::check_assertion(entry != nullptr, "Missing archive entry");
+  Debug::check_assertion(index.is_in_archive(*entry), "Entry not in the archive");
+  Debug::check_assertion(entry->stored, "Entry not stored");
+  Debug::check_assertion(entry->size == content.size(), "Wrong entry size");
+
+  std::string buffer;
+  Debug::check_assertion(index.read("archive_test/stored.txt", *entry, buffer),
+      "Cannot read the archive entry");
+  Debug::check_assertion(buffer == content, "Wrong archive entry content");
+
+  PHYSFS_removeFromSearchPath(archive_path.c_str());
+  QuestFiles::data_file_delete("quest_file_index_test.zip");
+}
+
+}
+
+/**
+ * Tests for the index of quest files.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_normalize(env);
+  test_queries(env);
+  test_archive(env);
+
+  return 0;
+}
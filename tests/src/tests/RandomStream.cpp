@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Random.h"
+#include "solarus/core/RandomStream.h"
+#include "tools/TestEnvironment.h"
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests that the same seed gives the same sequence.
+ */
+void test_determinism(TestEnvironment& /* env */) {
+
+  RandomStream first(42);
+  RandomStream second(42);
+  RandomStream other(43);
+  bool different = false;
+  for (int i = 0; i < 100; ++i) {
+    const uint32_t value = first.next();
+    Debug::check_assertion(second.next() == value, "Same seed, different sequence");
+    different = different || other.next() != value;
+  }
+  Debug::check_assertion(different, "Different seeds, same sequence");
+
+  first.set_seed(42);
+  second.set_seed(42);
+  Debug::check_assertion(first.next() == second.next(), "Reseeding failed");
+  Debug::check_assertion(first.get_seed() == 42, "Wrong seed");
+}
+
+/**
+ * \brief Tests the bounds of random numbers.
+ */
+void test_bounds(TestEnvironment& /* env */) {
+
+  RandomStream stream(7);
+  std::vector<int> counts(6, 0);
+  for (int i = 0; i < 6000; ++i) {
+    const int number = stream.get_number(-3, 3);
+    Debug::check_assertion(number >= -3 && number < 3, "Number out of bounds");
+    ++counts[number + 3];
+  }
+  for (int count : counts) {
+    Debug::check_assertion(count > 800 && count < 1200, "Bad distribution");
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    const double real = stream.get_real();
+    Debug::check_assertion(real >= 0.0 && real < 1.0, "Real out of bounds");
+  }
+
+  std::vector<int> numbers(100);
+  stream.get_numbers(numbers.data(), numbers.size(), 10, 11);
+  for (int number : numbers) {
+    Debug::check_assertion(number == 10, "Wrong number in batch");
+  }
+}
+
+/**
+ * \brief Tests that subsystems draw from independent streams.
+ */
+void test_subsystems(TestEnvironment& /* env */) {
+
+  Random::set_seed(1234);
+  const uint32_t expected = Random::get_stream(Random::Subsystem::ENEMIES).next();
+
+  Random::set_seed(1234);
+  for (int i = 0; i < 10; ++i) {
+    Random::get_stream(Random::Subsystem::MOVEMENTS).next();
+    Random::get_number(100);
+  }
+  Debug::check_assertion(Random::get_stream(Random::Subsystem::ENEMIES).next() == expected,
+      "Subsystem streams are not independent");
+  Debug::check_assertion(Random::get_seed() == 1234, "Wrong engine seed");
+}
+
+}
+
+/**
+ * Tests for random number streams.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_determinism(env);
+  test_bounds(env);
+  test_subsystems(env);
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/SpcDecoder.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+constexpr size_t ram_offset = 0x100;
+constexpr size_t dsp_offset = 0x10100;
+constexpr int program_address = 0x0200;
+
+/**
+ * \brief Creates an SPC file with random RAM and DSP registers.
+ *
+ * The program keeps writing random values to the FIR coefficients.
+ * The echo buffer never overlaps the program.
+ */
+std::string create_spc_file(std::mt19937& random, bool echo_writes) {
+
+  std::string data(0x10200, '\0');
+  const char signature[] = "SNES-SPC700 Sound File Data v0.30\x1A\x1A";
+  std::memcpy(&data[0], signature, sizeof(signature) - 1);
+  data[0x23] = 26;   // Has an ID666 tag.
+  data[0x24] = 30;   // Version.
+  data[0x25] = program_address & 0xFF;
+  data[0x26] = program_address >> 8;
+  data[0x2B] = static_cast<char>(0xEF);  // Stack pointer.
+
+  // Random samples, sample directory and echo buffer.
+  for (size_t i = 0; i < 0x10000; ++i) {
+    data[ram_offset + i] = static_cast<char>(random());
+  }
+  // No timer and no IPL ROM.
+  std::fill(&data[ram_offset + 0xF0], &data[ram_offset + 0x100], '\0');
+
+  std::vector<uint8_t> program;
+  for (int i = 0; i < 64; ++i) {
+    const uint8_t fir_register = 0x0F + (random() % 8) * 0x10;
+    program.insert(program.end(), { 0x8F, fir_register, 0xF2 });  // mov $F2, #register
+    program.insert(program.end(), { 0x8F, static_cast<uint8_t>(random()), 0xF3 });  // mov $F3, #value
+  }
+  program.insert(program.end(), {
+      0xCD, 0x00,  // mov x, #0
+      0x1D,        // dec x
+      0xD0, 0xFD,  // bne -3
+      0x5F, program_address & 0xFF, program_address >> 8  // jmp program_address
+  });
+  std::memcpy(&data[ram_offset + program_address], program.data(), program.size());
+
+  // Random voices, all keyed on.
+  for (size_t i = 0; i < 0x80; ++i) {
+    data[dsp_offset + i] = static_cast<char>(random());
+  }
+  data[dsp_offset + 0x4C] = static_cast<char>(0xFF);  // KON.
+  data[dsp_offset + 0x5C] = 0;  // KOFF.
+  data[dsp_offset + 0x6C] = static_cast<char>((random() & 0x1F) | (echo_writes ? 0x00 : 0x20));  // FLG.
+  data[dsp_offset + 0x6D] = static_cast<char>(0x08 + random() % 0x78);  // ESA, after the program.
+  data[dsp_offset + 0x7D] = static_cast<char>(random() & 0x0F);  // EDL.
+  return data;
+}
+
+/**
+ * \brief Decodes the beginning of an SPC file.
+ */
+std::vector<int16_t> decode(const std::string& data) {
+
+  SpcDecoder decoder;
+  decoder.load(reinterpret_cast<const int16_t*>(data.data()), data.size());
+
+  std::vector<int16_t> samples(16 * 4096);
+  for (size_t i = 0; i < samples.size(); i += 4096) {
+    decoder.decode(&samples[i], 4096);
+  }
+  return samples;
+}
+
+/**
+ * \brief Checks that the DSP gives the same samples with and without SIMD.
+ */
+void test_simd_exact(TestEnvironment& /* env */) {
+
+  std::mt19937 random(42);
+
+  for (int i = 0; i < 8; ++i) {
+    // With echo writes, the echo buffer gets the output of the FIR back.
+    const std::string data = create_spc_file(random, i % 2 == 0);
+
+    SpcDecoder::set_simd_enabled(false);
+    const std::vector<int16_t> scalar_samples = decode(data);
+    SpcDecoder::set_simd_enabled(true);
+    const std::vector<int16_t> simd_samples = decode(data);
+
+    Debug::check_assertion(std::any_of(scalar_samples.begin(), scalar_samples.end(),
+        [](int16_t sample) { return sample != 0; }),
+        "Silent SPC file " + std::to_string(i));
+    Debug::check_assertion(simd_samples == scalar_samples,
+        "Different samples with SIMD for SPC file " + std::to_string(i));
+  }
+}
+
+}
+
+/**
+ * \brief Tests the SPC decoder.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_simd_exact(env);
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Sprite.h"
+#include "solarus/graphics/SpriteAnimation.h"
+#include "solarus/graphics/SpriteAnimationSet.h"
+#include "tools/TestEnvironment.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests that only the animations used are created.
+ */
+void test_lazy_animations(TestEnvironment& /* env */) {
+
+  std::shared_ptr<Sprite> sprite = std::make_shared<Sprite>("entities/bomb");
+  const SpriteAnimationSet& animation_set = sprite->get_animation_set();
+
+  Debug::check_assertion(animation_set.is_animation_loaded("stopped"),
+      "Default animation not loaded");
+  Debug::check_assertion(!animation_set.is_animation_loaded("walking"),
+      "Unused animation loaded");
+  Debug::check_assertion(sprite->has_animation("walking"),
+      "Unloaded animation not found");
+  Debug::check_assertion(!sprite->has_animation("jumping"),
+      "Unexpected animation");
+
+  // The maximum size does not depend on which animations are loaded.
+  Debug::check_assertion(sprite->get_max_size() == Size(16, 24),
+      "Wrong maximum size");
+
+  sprite->set_current_animation("walking");
+  Debug::check_assertion(animation_set.is_animation_loaded("walking"),
+      "Animation not loaded when used");
+  Debug::check_assertion(sprite->get_nb_frames() == 3,
+      "Wrong number of frames");
+}
+
+/**
+ * \brief Tests that pixel collisions also apply to animations created later.
+ */
+void test_lazy_pixel_collisions(TestEnvironment& /* env */) {
+
+  std::shared_ptr<Sprite> sprite = std::make_shared<Sprite>("entities/arrow");
+  sprite->enable_pixel_collisions();
+  Debug::check_assertion(sprite->are_pixel_collisions_enabled(),
+      "Pixel collisions not enabled");
+
+  const SpriteAnimationSet& animation_set = sprite->get_animation_set();
+  Debug::check_assertion(!animation_set.is_animation_loaded("reached_obstacle"),
+      "Unused animation loaded");
+  Debug::check_assertion(animation_set.get_animation("reached_obstacle").are_pixel_collisions_enabled(),
+      "Pixel collisions not enabled on a new animation");
+}
+
+/**
+ * \brief Tests preloading animations before they are used.
+ */
+void test_preload(TestEnvironment& /* env */) {
+
+  Sprite::preload_animations("entities/crystal_block", { "orange_lowered" });
+  std::shared_ptr<Sprite> sprite = std::make_shared<Sprite>("entities/crystal_block");
+  const SpriteAnimationSet& animation_set = sprite->get_animation_set();
+  Debug::check_assertion(animation_set.is_animation_loaded("orange_lowered"),
+      "Animation not preloaded");
+  Debug::check_assertion(!animation_set.is_animation_loaded("orange_raised"),
+      "Animation preloaded without being requested");
+
+  // An empty list preloads everything.
+  Sprite::preload_animations("entities/items", std::vector<std::string>());
+  std::shared_ptr<Sprite> items_sprite = std::make_shared<Sprite>("entities/items");
+  for (const char* animation_name : { "bomb", "gem", "sword" }) {
+    Debug::check_assertion(items_sprite->get_animation_set().is_animation_loaded(animation_name),
+        "Animation not preloaded");
+  }
+}
+
+}
+
+/**
+ * Tests for the lazy creation of sprite animations.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_lazy_animations(env);
+  test_lazy_pixel_collisions(env);
+  test_preload(env);
+
+  return 0;
+}
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/QuestDatabase.h"
@@ -53,6 +54,21 @@ void check_sprite(TestEnvironment& /* env */, const std::string& sprite_id) {
         << "*** Exported sprite file:" << std::endl << exported_sprite_buffer << std::endl;
     Debug::die("Sprite '" + sprite_id + "': exported file differs from the original one");
   }
+
+  // Check that the binary form gives the same data.
+  BinaryWriter writer;
+  success = sprite_data.export_to_binary(writer);
+  Debug::check_assertion(success, "Sprite binary export failed");
+
+  SpriteData binary_sprite_data;
+  BinaryReader reader(writer.get_buffer());
+  success = binary_sprite_data.import_from_binary(reader);
+  Debug::check_assertion(success, "Sprite binary import failed");
+
+  std::string binary_sprite_buffer;
+  success = binary_sprite_data.export_to_buffer(binary_sprite_buffer);
+  Debug::check_assertion(success && binary_sprite_buffer == imported_sprite_buffer,
+      "Sprite '" + sprite_id + "': binary data differs from the original one");
 }
 
 }
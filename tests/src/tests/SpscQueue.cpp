@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/SpscQueue.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+#include <thread>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests pushing and popping from a single thread.
+ */
+void test_single_thread(TestEnvironment& /* env */) {
+
+  SpscQueue<std::string> queue(3);
+  Debug::check_assertion(queue.get_capacity() == 4, "Wrong capacity");
+  Debug::check_assertion(queue.is_empty(), "Queue should be empty");
+
+  std::string element;
+  Debug::check_assertion(!queue.pop(element), "Pop should fail on an empty queue");
+
+  for (int i = 0; i < 4; ++i) {
+    Debug::check_assertion(queue.push(std::to_string(i)), "Push failed");
+  }
+  element = "4";
+  Debug::check_assertion(!queue.push(std::move(element)), "Push should fail on a full queue");
+  Debug::check_assertion(element == "4", "Element should be unchanged when the queue is full");
+
+  // Elements come out in order, and the ring wraps around.
+  for (int i = 0; i < 10; ++i) {
+    Debug::check_assertion(queue.pop(element), "Pop failed");
+    Debug::check_assertion(element == std::to_string(i), "Wrong element popped");
+    Debug::check_assertion(queue.push(std::to_string(i + 4)), "Push failed");
+  }
+  for (int i = 10; i < 14; ++i) {
+    Debug::check_assertion(queue.pop(element), "Pop failed");
+    Debug::check_assertion(element == std::to_string(i), "Wrong element popped");
+  }
+  Debug::check_assertion(queue.is_empty(), "Queue should be empty");
+}
+
+/**
+ * \brief Tests a producer thread and a consumer thread.
+ */
+void test_two_threads(TestEnvironment& /* env */) {
+
+  constexpr int num_elements = 100000;
+  SpscQueue<int> queue(64);
+
+  std::thread producer([&queue]() {
+    for (int i = 0; i < num_elements; ++i) {
+      int element = i;
+      while (!queue.push(std::move(element))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  int element = 0;
+  while (expected < num_elements) {
+    if (queue.pop(element)) {
+      Debug::check_assertion(element == expected, "Wrong element popped");
+      ++expected;
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  Debug::check_assertion(queue.is_empty(), "Queue should be empty");
+}
+
+}
+
+/**
+ * Tests for the single producer single consumer queue.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_single_thread(env);
+  test_two_threads(env);
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/StartupTasks.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+using Affinity = StartupTasks::Affinity;
+
+/**
+ * \brief Checks that dependencies and affinities are respected.
+ */
+void test_order(TestEnvironment& /* env */, int num_threads) {
+
+  const std::thread::id main_thread = std::this_thread::get_id();
+  std::mutex mutex;
+  std::vector<std::string> done;
+  auto finish = [&](const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    done.push_back(name);
+  };
+  auto is_done = [&](const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::find(done.begin(), done.end(), name) != done.end();
+  };
+
+  StartupTasks tasks(num_threads);
+  tasks.add("a", Affinity::ANY_THREAD, {}, [&]() {
+    finish("a");
+  });
+  tasks.add("b", Affinity::MAIN_THREAD, {}, [&]() {
+    Debug::check_assertion(std::this_thread::get_id() == main_thread, "Not on the main thread");
+    finish("b");
+  });
+  tasks.add("c", Affinity::ANY_THREAD, { "a" }, [&]() {
+    Debug::check_assertion(is_done("a"), "Dependency not finished");
+    finish("c");
+  });
+  tasks.add("d", Affinity::MAIN_THREAD, { "b", "c" }, [&]() {
+    Debug::check_assertion(std::this_thread::get_id() == main_thread, "Not on the main thread");
+    Debug::check_assertion(is_done("b") && is_done("c"), "Dependencies not finished");
+    finish("d");
+  });
+  tasks.run();
+
+  Debug::check_assertion(done.size() == 4, "Missing tasks");
+  if (num_threads == 0) {
+    Debug::check_assertion(done == std::vector<std::string>({ "a", "b", "c", "d" }),
+        "Serial tasks not run in order");
+  }
+
+  const std::vector<std::string>& report = tasks.get_report();
+  Debug::check_assertion(report.size() == 5, "Wrong report");
+}
+
+/**
+ * \brief Checks that independent tasks run at the same time.
+ */
+void test_parallel(TestEnvironment& /* env */) {
+
+  // Each task waits for the other one.
+  std::atomic<int> num_started(0);
+  auto wait_for_both = [&]() {
+    ++num_started;
+    while (num_started < 2) {
+      std::this_thread::yield();
+    }
+  };
+
+  StartupTasks tasks(2);
+  tasks.add("main", Affinity::MAIN_THREAD, {}, wait_for_both);
+  tasks.add("worker", Affinity::ANY_THREAD, {}, wait_for_both);
+  tasks.run();
+  Debug::check_assertion(num_started == 2, "Tasks not run");
+}
+
+/**
+ * \brief Checks that an exception thrown by a task stops the startup.
+ */
+void test_error(TestEnvironment& /* env */) {
+
+  bool after_error_run = false;
+  StartupTasks tasks(2);
+  tasks.add("failing", Affinity::ANY_THREAD, {}, []() {
+    throw std::runtime_error("Startup error");
+  });
+  tasks.add("after", Affinity::MAIN_THREAD, { "failing" }, [&]() {
+    after_error_run = true;
+  });
+
+  bool thrown = false;
+  try {
+    tasks.run();
+  }
+  catch (const std::runtime_error& error) {
+    thrown = std::string(error.what()) == "Startup error";
+  }
+  Debug::check_assertion(thrown, "Exception not rethrown");
+  Debug::check_assertion(!after_error_run, "Dependent task run after an error");
+}
+
+}
+
+/**
+ * Tests for the startup task graph.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_order(env, 0);
+  test_order(env, 1);
+  test_order(env, 4);
+  test_parallel(env);
+  test_error(env);
+
+  return 0;
+}
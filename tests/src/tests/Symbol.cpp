@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Symbol.h"
+#include "tools/TestEnvironment.h"
+#include <string>
+#include <unordered_set>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Tests that equal strings give the same symbol.
+ */
+void test_interning(TestEnvironment& /* env */) {
+
+  const std::string walking = "walking";
+  const Symbol first(walking);
+  const Symbol second(std::string("walk") + "ing");
+  Debug::check_assertion(first == second, "Equal strings give different symbols");
+  Debug::check_assertion(&first.get_name() == &second.get_name(), "String not interned");
+  Debug::check_assertion(first.get_name() == walking, "Wrong symbol name");
+
+  const Symbol stopped("stopped");
+  Debug::check_assertion(first != stopped, "Different strings give the same symbol");
+
+  std::unordered_set<Symbol> symbols = { first, second, stopped };
+  Debug::check_assertion(symbols.size() == 2, "Wrong symbol hash");
+}
+
+/**
+ * \brief Tests the empty symbol and lookups without interning.
+ */
+void test_find(TestEnvironment& /* env */) {
+
+  Debug::check_assertion(Symbol().is_empty(), "Default symbol not empty");
+  Debug::check_assertion(Symbol() == Symbol(std::string()), "Several empty symbols");
+
+  const Symbol missing = Symbol::find("symbol_test_never_interned");
+  Debug::check_assertion(missing.is_empty(), "Unknown string found");
+
+  const Symbol jumping("jumping");
+  Debug::check_assertion(Symbol::find("jumping") == jumping, "Interned string not found");
+}
+
+}
+
+/**
+ * Tests for interned strings.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_interning(env);
+  test_find(env);
+
+  return 0;
+}
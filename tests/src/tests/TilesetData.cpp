@@ -15,6 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/entities/TilesetData.h"
+#include "solarus/core/BinaryData.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestDatabase.h"
@@ -52,6 +53,21 @@ void check_tileset(TestEnvironment& /* env */, const std::string& tileset_id) {
         << "*** Exported tileset file:" << std::endl << exported_tileset_buffer << std::endl;
     Debug::die("Tileset '" + tileset_id + "': exported file differs from the original one");
   }
+
+  // Check that the binary form gives the same data.
+  BinaryWriter writer;
+  success = tileset_data.export_to_binary(writer);
+  Debug::check_assertion(success, "Tileset binary export failed");
+
+  TilesetData binary_tileset_data;
+  BinaryReader reader(writer.get_buffer());
+  success = binary_tileset_data.import_from_binary(reader);
+  Debug::check_assertion(success, "Tileset binary import failed");
+
+  std::string binary_tileset_buffer;
+  success = binary_tileset_data.export_to_buffer(binary_tileset_buffer);
+  Debug::check_assertion(success && binary_tileset_buffer == imported_tileset_buffer,
+      "Tileset '" + tileset_id + "': binary data differs from the original one");
 }
 
 }
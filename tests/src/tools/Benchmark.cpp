@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Logger.h"
+#include "tools/Benchmark.h"
+#include "tools/TestEnvironment.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+namespace Solarus {
+
+/**
+ * \brief Creates a benchmark.
+ * \param env The test environment, whose arguments configure the output.
+ * \param name Name of the benchmark.
+ */
+Benchmark::Benchmark(TestEnvironment& env, const std::string& name):
+  name(name),
+  output_file_name(env.get_arguments().get_argument_value("-benchmark-output")),
+  threshold(1.25),
+  results(),
+  baseline() {
+
+  const std::string& threshold_arg = env.get_arguments().get_argument_value("-benchmark-threshold");
+  if (!threshold_arg.empty()) {
+    std::istringstream iss(threshold_arg);
+    iss >> threshold;
+  }
+
+  const std::string& baseline_arg = env.get_arguments().get_argument_value("-benchmark-baseline");
+  if (!baseline_arg.empty()) {
+    load_baseline(baseline_arg);
+  }
+}
+
+/**
+ * \brief Records the duration of a case measured by the caller.
+ * \param case_name Name of the case.
+ * \param iterations Number of iterations measured.
+ * \param total_ms Total duration in milliseconds.
+ */
+void Benchmark::add_result(const std::string& case_name, int iterations, double total_ms) {
+
+  Result result;
+  result.case_name = case_name;
+  result.iterations = iterations;
+  result.total_ms = total_ms;
+  result.mean_us = iterations > 0 ? total_ms * 1000.0 / iterations : 0.0;
+  results.push_back(result);
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(3)
+      << name << "/" << case_name << ": " << result.mean_us << " us ("
+      << iterations << " iterations)";
+  Logger::info(oss.str());
+}
+
+/**
+ * \brief Writes the results and compares them to the baseline if any.
+ * \return The exit code of the benchmark: 0 if no case regressed, 1 otherwise.
+ */
+int Benchmark::finish() {
+
+  const std::string json = to_json();
+  if (output_file_name.empty()) {
+    std::cout << json;
+  }
+  else {
+    std::ofstream out(output_file_name);
+    out << json;
+    if (!out) {
+      Logger::error("Cannot write benchmark results to '" + output_file_name + "'");
+      return 1;
+    }
+  }
+
+  int exit_code = 0;
+  for (const Result& result : results) {
+    const auto it = baseline.find(result.case_name);
+    if (it == baseline.end() || it->second <= 0.0) {
+      continue;
+    }
+    const double ratio = result.mean_us / it->second;
+    if (ratio > threshold) {
+      std::ostringstream oss;
+      oss << std::fixed << std::setprecision(2)
+          << name << "/" << result.case_name << " regressed: "
+          << ratio << "x the baseline (threshold " << threshold << "x)";
+      Logger::error(oss.str());
+      exit_code = 1;
+    }
+  }
+  return exit_code;
+}
+
+/**
+ * \brief Reads the mean duration of each case from earlier JSON results.
+ * \param file_name A file written by finish().
+ * \return \c false if the file could not be read.
+ */
+bool Benchmark::load_baseline(const std::string& file_name) {
+
+  std::ifstream in(file_name);
+  if (!in) {
+    Logger::error("Cannot read benchmark baseline '" + file_name + "'");
+    return false;
+  }
+
+  // finish() writes one case per line.
+  const std::regex case_regex(
+      "\"name\": \"([^\"]*)\".*\"mean_us\": ([0-9.eE+-]+)");
+  std::string line;
+  while (std::getline(in, line)) {
+    std::smatch match;
+    if (std::regex_search(line, match, case_regex)) {
+      baseline[match[1].str()] = std::stod(match[2].str());
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Returns the results as JSON, one case per line.
+ * \return The JSON text.
+ */
+std::string Benchmark::to_json() const {
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(3);
+  oss << "{\n"
+      << "  \"benchmark\": \"" << name << "\",\n"
+      << "  \"cases\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    oss << "    { \"name\": \"" << result.case_name << "\""
+        << ", \"iterations\": " << result.iterations
+        << ", \"total_ms\": " << result.total_ms
+        << ", \"mean_us\": " << result.mean_us
+        << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  oss << "  ]\n"
+      << "}\n";
+  return oss.str();
+}
+
+}
+
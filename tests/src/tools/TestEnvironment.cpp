@@ -120,6 +120,20 @@ void TestEnvironment::run_map(const std::string& map_id) {
   get_main_loop().run();
 }
 
+/**
+ * \brief Starts a game on the specified map without running the main loop.
+ *
+ * The simulation then only advances with step().
+ *
+ * \param map_id Id of the map to open.
+ * \return The map.
+ */
+Map& TestEnvironment::start_map(const std::string& map_id) {
+
+  this->map_id = map_id;
+  return get_map();
+}
+
 /**
  * \brief Creates a custom entity on the map and returns it.
  * \param xy Coordinates of the entity to create.
@@ -0,0 +1,18 @@
+-- Benchmark scene: a long dialog skipped through with the action command.
+local map = ...
+local game = map:get_game()
+
+local function start_dialog()
+
+  game:start_dialog("benchmark.long_dialog", start_dialog)
+end
+
+function map:on_started()
+
+  start_dialog()
+  sol.timer.start(map, 50, function()
+    game:simulate_command_pressed("action")
+    game:simulate_command_released("action")
+    return true
+  end)
+end
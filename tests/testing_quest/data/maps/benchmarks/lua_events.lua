@@ -0,0 +1,24 @@
+-- Benchmark scene: 1000 custom entities with Lua events called every tick.
+local map = ...
+
+local num_updates = 0
+
+function map:on_started()
+
+  local width, height = map:get_size()
+  for i = 1, 1000 do
+    local entity = map:create_custom_entity({
+      layer = 0,
+      x = 16 + (i * 37) % (width - 32),
+      y = 16 + (i * 53) % (height - 32),
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+    function entity:on_update()
+      num_updates = num_updates + 1
+    end
+    function entity:on_pre_draw()
+    end
+  end
+end
@@ -0,0 +1,19 @@
+-- Benchmark scene: 1000 enemies moving randomly on a big map.
+local map = ...
+
+function map:on_started()
+
+  local width, height = map:get_size()
+  for i = 1, 1000 do
+    local enemy = map:create_enemy({
+      breed = "test_enemy",
+      layer = 0,
+      x = 16 + (i * 37) % (width - 32),
+      y = 16 + (i * 53) % (height - 32),
+      direction = 0,
+    })
+    local movement = sol.movement.create("random")
+    movement:set_speed(32)
+    movement:start(enemy)
+  end
+end
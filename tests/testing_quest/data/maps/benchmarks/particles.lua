@@ -0,0 +1,50 @@
+-- Benchmark scene: a menu updating 2000 particles.
+local map = ...
+
+local num_particles = 2000
+local menu = {}
+local particles = {}
+local particle_surface = sol.surface.create(2, 2)
+particle_surface:fill_color({255, 255, 255})
+
+local function reset_particle(particle, index)
+
+  particle.x = 160
+  particle.y = 120
+  particle.dx = ((index * 37) % 200 - 100) / 100
+  particle.dy = ((index * 53) % 200 - 100) / 100
+  particle.life = 50 + index % 100
+end
+
+function menu:on_started()
+
+  for i = 1, num_particles do
+    particles[i] = {}
+    reset_particle(particles[i], i)
+  end
+end
+
+function menu:on_update()
+
+  for i, particle in ipairs(particles) do
+    particle.x = particle.x + particle.dx
+    particle.y = particle.y + particle.dy
+    particle.dy = particle.dy + 0.05
+    particle.life = particle.life - 1
+    if particle.life <= 0 then
+      reset_particle(particle, i)
+    end
+  end
+end
+
+function menu:on_draw(dst_surface)
+
+  for _, particle in ipairs(particles) do
+    particle_surface:draw(dst_surface, particle.x, particle.y)
+  end
+end
+
+function map:on_started()
+
+  sol.menu.start(map, menu)
+end
@@ -0,0 +1,79 @@
+local map = ...
+
+local function get_file_size(file_name)
+  local file = sol.file.open(file_name, "rb")
+  local size = file:seek("end")
+  file:close()
+  return size
+end
+
+local function read_magic(file_name)
+  local file = sol.file.open(file_name, "rb")
+  local magic = file:read(4)
+  file:close()
+  return magic
+end
+
+function map:on_opening_transition_finished()
+
+  -- Text savegames are converted by saving them in binary.
+  sol.game.delete("binary_savegame.dat")
+  local savegame = sol.game.load("binary_savegame.dat")
+  assert(savegame:get_save_format() == "text")
+  for i = 1, 100 do
+    savegame:set_value("treasure_" .. i, i % 2 == 0)
+  end
+  savegame:set_value("name", "Link")
+  savegame:save()
+  assert(read_magic("binary_savegame.dat") ~= "SOLG")
+
+  savegame = sol.game.load("binary_savegame.dat")
+  assert(savegame:get_value("treasure_2") == true)
+  assert(not pcall(savegame.set_save_format, savegame, "xml"))
+  savegame:set_save_format("binary")
+  assert(savegame:get_save_format() == "binary")
+  savegame:save()
+  assert(read_magic("binary_savegame.dat") == "SOLG")
+  local snapshot_size = get_file_size("binary_savegame.dat")
+
+  -- Later saves only append the values changed.
+  savegame:set_value("treasure_1", true)
+  savegame:set_value("treasure_3", nil)
+  savegame:set_value("new_value", 42)
+  savegame:save()
+  local journal_size = get_file_size("binary_savegame.dat") - snapshot_size
+  assert(journal_size > 0)
+  assert(journal_size < 64)
+
+  -- Nothing changed: nothing written.
+  savegame:save()
+  assert(get_file_size("binary_savegame.dat") == snapshot_size + journal_size)
+
+  local loaded = sol.game.load("binary_savegame.dat")
+  assert(loaded:get_save_format() == "binary")
+  assert(loaded:get_value("treasure_1") == true)
+  assert(loaded:get_value("treasure_2") == true)
+  assert(loaded:get_value("treasure_3") == nil)
+  assert(loaded:get_value("treasure_4") == true)
+  assert(loaded:get_value("new_value") == 42)
+  assert(loaded:get_value("name") == "Link")
+
+  -- Appending to a loaded file keeps the string table.
+  loaded:set_value("new_value", 43)
+  loaded:set_value("name", "Zelda")
+  loaded:save()
+  loaded = sol.game.load("binary_savegame.dat")
+  assert(loaded:get_value("new_value") == 43)
+  assert(loaded:get_value("name") == "Zelda")
+  assert(loaded:get_value("treasure_3") == nil)
+
+  -- Back to text.
+  loaded:set_save_format("text")
+  loaded:save()
+  assert(read_magic("binary_savegame.dat") ~= "SOLG")
+  loaded = sol.game.load("binary_savegame.dat")
+  assert(loaded:get_value("name") == "Zelda")
+
+  sol.game.delete("binary_savegame.dat")
+  sol.main.exit()
+end
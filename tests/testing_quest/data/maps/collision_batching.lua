@@ -0,0 +1,37 @@
+local map = ...
+
+local detected = {}
+
+local function on_collision(detector, other)
+
+  if other == mover and detected[#detected] ~= detector then
+    detected[#detected + 1] = detector
+  end
+end
+
+detector_1:add_collision_test("overlapping", on_collision)
+detector_2:add_collision_test("overlapping", on_collision)
+
+function map:on_started()
+
+  assert(not map:is_collision_batching_enabled())
+  map:set_collision_batching_enabled(true)
+  assert(map:is_collision_batching_enabled())
+end
+
+function map:on_opening_transition_finished()
+
+  local movement = sol.movement.create("straight")
+  movement:set_angle(0)
+  movement:set_speed(240)
+  movement:set_max_distance(160)
+  movement:start(mover, function()
+    -- Both detectors were notified, in Z order.
+    assert(detected[1] == detector_1)
+    assert(detected[2] == detector_2)
+
+    map:set_collision_batching_enabled(false)
+    assert(not map:is_collision_batching_enabled())
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,57 @@
+local map = ...
+
+local detected = {}
+
+local function on_collision(detector, other)
+
+  if other == mover then
+    detected[detector] = true
+  end
+end
+
+detector_1:add_collision_test("overlapping", on_collision)
+detector_2:add_collision_test("overlapping", on_collision)
+
+function map:on_started()
+
+  -- Each type has its own category.
+  local hero = map:get_hero()
+  assert(hero:get_collision_category() == 2 ^ 23)
+  assert(mover:get_collision_category() == 2 ^ 21)
+  assert(mover:get_collision_mask() == 0xFFFFFFFF)
+
+  -- Enemies only detect the types that react to them.
+  local enemy = map:create_enemy({
+    x = 280,
+    y = 200,
+    layer = 0,
+    direction = 0,
+    breed = "test_enemy",
+  })
+  local enemy_mask = enemy:get_collision_mask()
+  assert(enemy_mask % (2 ^ 24) >= 2 ^ 23)  -- Hero.
+  assert(enemy_mask % (2 ^ 22) < 2 ^ 21)   -- Custom entities.
+
+  -- Give the mover a category that the second detector ignores.
+  mover:set_collision_category(2 ^ 31)
+  assert(mover:get_collision_category() == 2 ^ 31)
+  detector_2:set_collision_mask(0xFFFFFFFF - 2 ^ 31)
+  assert(detector_2:get_collision_mask() == 0x7FFFFFFF)
+
+  assert(not pcall(mover.set_collision_mask, mover, -1))
+  assert(not pcall(mover.set_collision_mask, mover, 2 ^ 32))
+  assert(not pcall(mover.set_collision_mask, mover, 1.5))
+end
+
+function map:on_opening_transition_finished()
+
+  local movement = sol.movement.create("straight")
+  movement:set_angle(0)
+  movement:set_speed(240)
+  movement:set_max_distance(160)
+  movement:start(mover, function()
+    assert(detected[detector_1])
+    assert(not detected[detector_2])
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,65 @@
+local map = ...
+
+function map:on_started()
+
+  local descriptions = {}
+  for i = 1, 200 do
+    descriptions[#descriptions + 1] = {
+      type = "custom_entity",
+      name = "bulk",
+      x = (i * 37) % 320,
+      y = (i * 53) % 240,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+    }
+  end
+  descriptions[#descriptions + 1] = {
+    type = "block",
+    name = "bulk_block",
+    x = 160,
+    y = 120,
+    layer = 0,
+    direction = -1,
+    sprite = "blocks/block_brown",
+    pushable = false,
+    pullable = false,
+    max_moves = 0,
+  }
+
+  -- Entities are returned in order.
+  local entities = map:create_entities(descriptions)
+  assert(#entities == #descriptions)
+  assert(entities[1]:get_type() == "custom_entity")
+  assert(entities[#entities]:get_type() == "block")
+  local x, y = entities[10]:get_position()
+  assert(x == 370 % 320 and y == 530 % 240)
+  assert(map:get_entities_count("bulk") == #descriptions)
+
+  -- They are found by spatial queries.
+  local found = false
+  for entity in map:get_entities_in_rectangle(152, 112, 16, 16) do
+    if entity == entities[#entities] then
+      found = true
+    end
+  end
+  assert(found)
+
+  -- An empty list creates nothing.
+  assert(#map:create_entities({}) == 0)
+
+  -- Invalid descriptions create nothing.
+  assert(not pcall(map.create_entities, map, {
+    { type = "custom_entity", x = 0, y = 0, layer = 0, width = 16, height = 16, direction = 0 },
+    { type = "custom_entity", x = 0, y = 0, width = 16, height = 16, direction = 0 },
+  }))
+  assert(not pcall(map.create_entities, map, { { type = "hero", x = 0, y = 0, layer = 0 } }))
+  assert(map:get_entities_count("bulk") == #descriptions)
+
+  sol.timer.start(map, 10, function()
+    map:remove_entities("bulk")
+    assert(not map:has_entities("bulk"))
+    sol.main.exit()
+  end)
+end
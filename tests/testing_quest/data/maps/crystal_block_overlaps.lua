@@ -0,0 +1,54 @@
+local map = ...
+local hero = map:get_hero()
+
+function map:on_started()
+
+  map:set_crystal_state(false)
+  local block = map:create_crystal_block({
+    layer = 0,
+    x = 64,
+    y = 144,
+    width = 32,
+    height = 16,
+    subtype = 1,  -- Blue: raised.
+  })
+
+  -- Above the block.
+  hero:set_position(72, 141)
+end
+
+function map:on_opening_transition_finished()
+
+  assert(hero:test_obstacles(0, 8))
+
+  -- On the block.
+  hero:set_position(72, 157)
+  sol.timer.start(map, 50, function()
+    assert(not hero:test_obstacles(16, 0))
+
+    -- Lowered and raised again.
+    map:set_crystal_state(true)
+    sol.timer.start(map, 50, function()
+      map:set_crystal_state(false)
+      sol.timer.start(map, 50, function()
+        assert(not hero:test_obstacles(16, 0))
+
+        -- Away from the block, then the block moves below the hero.
+        hero:set_position(200, 141)
+        sol.timer.start(map, 50, function()
+          assert(not hero:test_obstacles(0, 8))
+          local blocks = {}
+          for entity in map:get_entities_by_type("crystal_block") do
+            blocks[#blocks + 1] = entity
+          end
+          assert(#blocks == 1)
+          blocks[1]:set_position(192, 144)
+          sol.timer.start(map, 50, function()
+            assert(hero:test_obstacles(0, 8))
+            sol.main.exit()
+          end)
+        end)
+      end)
+    end)
+  end)
+end
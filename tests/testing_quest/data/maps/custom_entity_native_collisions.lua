@@ -0,0 +1,60 @@
+local map = ...
+
+local function create_box(x, y, size)
+
+  local entity = map:create_custom_entity({
+    x = x,
+    y = y,
+    layer = 0,
+    width = size,
+    height = size,
+    direction = 0,
+  })
+  entity:set_origin(0, 0)
+  return entity
+end
+
+function map:on_started()
+
+  -- Centers: detector at 116,116, east at 132,116, west at 92,108.
+  local east = create_box(124, 108, 16)
+  local west = create_box(84, 100, 16)
+  local detector = create_box(100, 100, 32)
+
+  local hits = {}
+  local function add_test(name, test)
+    hits[name] = {}
+    detector:add_collision_test(test, function(entity, other)
+      assert(entity == detector)
+      hits[name][other] = true
+    end)
+  end
+
+  add_test("circle", { shape = "circle", radius = 10, other_radius = 8 })
+  add_test("distance", { shape = "distance", radius = 30 })
+  add_test("cone", { shape = "cone", radius = 20, angle = 0, aperture = math.pi / 2 })
+  add_test("cone_west", { shape = "cone", radius = 40, angle = math.pi, aperture = math.pi / 2 })
+  add_test("hero_only", { shape = "circle", radius = 100, type = "hero" })
+  add_test("other_layer", { shape = "circle", radius = 100, layers = { 1 } })
+  add_test("same_model", { shape = "circle", radius = 100, same_model = true })
+
+  assert(not pcall(detector.add_collision_test, detector, { shape = "square", radius = 1 }, function() end))
+  assert(not pcall(detector.add_collision_test, detector, { shape = "circle" }, function() end))
+
+  sol.timer.start(map, 10, function()
+
+    -- Moving the detector checks its collisions.
+    detector:set_position(101, 100)
+
+    assert(hits.circle[east] and not hits.circle[west])
+    assert(hits.distance[east] and hits.distance[west])
+    assert(hits.cone[east] and not hits.cone[west])
+    assert(hits.cone_west[west] and not hits.cone_west[east])
+    assert(next(hits.hero_only) == nil)
+    assert(next(hits.other_layer) == nil)
+    -- Entities without model have the same model.
+    assert(hits.same_model[east] and hits.same_model[west])
+
+    sol.main.exit()
+  end)
+end
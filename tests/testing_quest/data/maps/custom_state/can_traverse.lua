@@ -27,5 +27,16 @@ function map:on_opening_transition_finished()
     assert_equal(hero:test_obstacles(), true)
   end
 
+  -- A pure test function is called only once per entity during a tick.
+  local num_calls = 0
+  state:set_can_traverse("npc", function(state, other)
+    num_calls = num_calls + 1
+    return false
+  end, true)
+  hero:set_position(map:get_entity("npc"):get_position())
+  assert_equal(hero:test_obstacles(), true)
+  assert_equal(hero:test_obstacles(), true)
+  assert_equal(num_calls, 1)
+
   sol.main.exit()
 end
@@ -0,0 +1,107 @@
+local map = ...
+
+-- Returns the RGBA components of a pixel of a 16x16 surface.
+local function get_pixel(surface, x, y)
+  local index = (y * 16 + x) * 4 + 1
+  return surface:get_pixels():byte(index, index + 3)
+end
+
+-- Test for adding and removing surfaces.
+local function test_entries()
+
+  local draw_list = sol.draw_list.create()
+  assert_equal(sol.main.get_type(draw_list), "draw_list")
+  assert_equal(draw_list:get_num_surfaces(), 0)
+  draw_list:add(sol.surface.create(4, 4))
+  draw_list:add(sol.surface.create(4, 4), 8, 8)
+  assert_equal(draw_list:get_num_surfaces(), 2)
+  draw_list:clear()
+  assert_equal(draw_list:get_num_surfaces(), 0)
+end
+
+-- Test that replayed draws give the same result as direct ones.
+local function test_replay()
+
+  local red = sol.surface.create(4, 4)
+  red:fill_color({255, 0, 0, 255})
+  local blue = sol.surface.create(4, 4)
+  blue:fill_color({0, 0, 255, 255})
+
+  local draw_list = sol.draw_list.create()
+  draw_list:add(red, 2, 3)
+  draw_list:add(blue, 4, 3)  -- Drawn over red.
+
+  local dst_surface = sol.surface.create(16, 16)
+  for _ = 1, 3 do
+    dst_surface:clear()
+    draw_list:draw(dst_surface, 1, 1)
+    local r, g, b, a = get_pixel(dst_surface, 3, 4)
+    assert(r == 255 and b == 0 and a == 255)
+    r, g, b, a = get_pixel(dst_surface, 5, 4)
+    assert(r == 0 and b == 255 and a == 255)
+    r, g, b, a = get_pixel(dst_surface, 2, 2)
+    assert(a == 0)
+  end
+
+  -- Another position of the list.
+  dst_surface:clear()
+  draw_list:draw(dst_surface, 8, 8)
+  local r, g, b, a = get_pixel(dst_surface, 10, 11)
+  assert(r == 255 and a == 255)
+  r, g, b, a = get_pixel(dst_surface, 3, 4)
+  assert(a == 0)
+
+  -- Another destination.
+  local other_surface = sol.surface.create(16, 16)
+  draw_list:draw(other_surface)
+  r, g, b, a = get_pixel(other_surface, 2, 3)
+  assert(r == 255 and a == 255)
+end
+
+-- Test that changing how a surface is drawn is taken into account.
+local function test_invalidation()
+
+  local red = sol.surface.create(4, 4)
+  red:fill_color({255, 0, 0, 255})
+  local draw_list = sol.draw_list.create()
+  draw_list:add(red)
+
+  local dst_surface = sol.surface.create(16, 16)
+  draw_list:draw(dst_surface)
+
+  red:set_xy(8, 8)
+  dst_surface:clear()
+  draw_list:draw(dst_surface)
+  local r, g, b, a = get_pixel(dst_surface, 0, 0)
+  assert(a == 0)
+  r, g, b, a = get_pixel(dst_surface, 8, 8)
+  assert(r == 255 and a == 255)
+
+  red:set_opacity(0)
+  dst_surface:clear()
+  draw_list:draw(dst_surface)
+  r, g, b, a = get_pixel(dst_surface, 8, 8)
+  assert(a == 0)
+
+  -- Modified pixels are drawn without recording again.
+  red:set_opacity(255)
+  draw_list:draw(dst_surface)
+  red:fill_color({0, 255, 0, 255})
+  dst_surface:clear()
+  draw_list:draw(dst_surface)
+  r, g, b, a = get_pixel(dst_surface, 8, 8)
+  assert(r == 0 and g == 255 and a == 255)
+
+  -- Surfaces with a transition are drawn one by one.
+  red:fade_out(1000)
+  dst_surface:clear()
+  draw_list:draw(dst_surface)
+end
+
+function map:on_started()
+
+  test_entries()
+  test_replay()
+  test_invalidation()
+  sol.main.exit()
+end
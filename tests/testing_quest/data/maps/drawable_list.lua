@@ -0,0 +1,32 @@
+local map = ...
+
+function map:on_started()
+
+  -- A sprite that lives during the whole test.
+  local sprite = sol.sprite.create("hero/tunic1")
+  sprite:set_animation("boomerang1")
+  local finished = false
+  function sprite:on_animation_finished()
+    finished = true
+  end
+
+  -- Lots of short-lived drawables.
+  local num_waves = 0
+  sol.timer.start(map, 10, function()
+    for i = 1, 200 do
+      local surface = sol.surface.create(8, 8)
+      local particle = sol.sprite.create("hero/tunic1")
+      particle:set_animation("boomerang1")
+    end
+    collectgarbage()
+    num_waves = num_waves + 1
+    return num_waves < 20
+  end)
+
+  sol.timer.start(map, 500, function()
+    -- The remaining sprite is still updated.
+    assert(num_waves == 20)
+    assert(finished)
+    sol.main.exit()
+  end)
+end
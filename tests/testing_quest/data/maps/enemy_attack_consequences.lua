@@ -0,0 +1,43 @@
+local map = ...
+
+function map:on_started()
+
+  local enemy = map:create_enemy({
+    x = 160,
+    y = 120,
+    layer = 0,
+    direction = 0,
+    breed = "test_enemy",
+  })
+  local sprite_1 = enemy:get_sprite()
+  local sprite_2 = enemy:create_sprite("enemies/test_enemy")
+  local sprite_3 = enemy:create_sprite("enemies/test_enemy")
+
+  -- Default consequences.
+  assert_equal(enemy:get_attack_consequence("sword"), 1)
+  assert_equal(enemy:get_attack_consequence("explosion"), 2)
+  assert_equal(enemy:get_attack_consequence("hookshot"), "immobilized")
+  assert_equal(enemy:get_attack_consequence("script"), "ignored")
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_2, "fire"), 3)
+
+  -- Sprite overrides, set in any order.
+  enemy:set_attack_consequence_sprite(sprite_3, "explosion", "protected")
+  enemy:set_attack_consequence_sprite(sprite_1, "explosion", 5)
+  enemy:set_attack_consequence("explosion", "custom")
+  assert_equal(enemy:get_attack_consequence("explosion"), "custom")
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_1, "explosion"), 5)
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_2, "explosion"), "custom")
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_3, "explosion"), "protected")
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_3, "arrow"), 2)
+
+  local function callback() end
+  enemy:set_attack_consequence_sprite(sprite_1, "explosion", callback)
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_1, "explosion"), callback)
+
+  -- Resetting the defaults removes the overrides.
+  enemy:set_default_attack_consequences()
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_1, "explosion"), 2)
+  assert_equal(enemy:get_attack_consequence_sprite(sprite_3, "explosion"), 2)
+
+  sol.main.exit()
+end
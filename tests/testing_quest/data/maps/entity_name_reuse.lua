@@ -0,0 +1,40 @@
+local map = ...
+
+local function create_entity(name)
+
+  return map:create_custom_entity({
+    name = name,
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+function map:on_started()
+
+  local old_entity = create_entity("reused")
+  assert(map:get_entity("reused") == old_entity)
+
+  -- Take the name of an entity marked for removal in the same frame.
+  old_entity:remove()
+  assert(map:get_entity("reused") == nil)
+  local new_entity = create_entity("reused")
+  assert(new_entity:get_name() == "reused")
+  assert(map:get_entity("reused") == new_entity)
+
+  sol.timer.start(map, 100, function()
+    -- The old entity is really removed now: the name must stay registered.
+    assert(not old_entity:exists())
+    assert(map:get_entity("reused") == new_entity)
+    assert(map:has_entity("reused"))
+    local found = {}
+    for entity in map:get_entities("reused") do
+      found[#found + 1] = entity
+    end
+    assert(#found == 1 and found[1] == new_entity)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,65 @@
+local map = ...
+
+local function create_named(name)
+
+  return map:create_custom_entity({
+    name = name,
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+local function count_iterated(prefix)
+
+  local count = 0
+  for _ in map:get_entities(prefix) do
+    count = count + 1
+  end
+  return count
+end
+
+function map:on_started()
+
+  for _ = 1, 5 do
+    create_named("enemy")
+  end
+  create_named("enem")
+  create_named("enemies_boss")
+  create_named("torch")
+
+  -- Names sharing a longer prefix are not mixed up.
+  assert(map:get_entities_count("enemy") == 5)
+  assert(map:get_entities_count("enem") == 7)
+  assert(map:get_entities_count("enemies") == 1)
+  assert(map:get_entities_count("z") == 0)
+  assert(count_iterated("enemy") == 5)
+  assert(count_iterated("enem") == 7)
+  assert(map:has_entities("torch"))
+  assert(not map:has_entities("torches"))
+  assert(not map:has_entities("a"))
+
+  -- The empty prefix means all entities, the hero included.
+  assert(map:get_entities_count("") == count_iterated())
+
+  -- Removed entities are not found anymore.
+  map:remove_entities("enemy")
+  assert(map:get_entities_count("enemy") == 0)
+  assert(not map:has_entities("enemy"))
+  assert(map:get_entities_count("enem") == 2)
+
+  -- Their names can be given to new entities.
+  local enemy = create_named("enemy")
+  assert(enemy:get_name() == "enemy")
+  assert(map:get_entity("enemy") == enemy)
+  assert(map:get_entities_count("enemy") == 1)
+
+  sol.timer.start(map, 10, function()
+    assert(map:get_entities_count("enemy") == 1)
+    assert(map:has_entities("enemy"))
+    sol.main.exit()
+  end)
+end
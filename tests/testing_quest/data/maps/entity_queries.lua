@@ -0,0 +1,72 @@
+local map = ...
+
+local function create_block(name, x, y)
+
+  return map:create_custom_entity({
+    name = name,
+    x = x,
+    y = y,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+function map:on_started()
+
+  local first = create_block("query_1", 168, 29)
+  local second = create_block("query_2", 200, 29)
+  create_block("query_3", 232, 29)
+
+  -- Queries that don't build a list.
+  assert(map:get_entities_in_rectangle_count(160, 16, 96, 16) == 3)
+  assert(map:get_entities_in_rectangle_count(160, 16, 16, 16) == 1)
+  assert(map:has_entities_in_rectangle(160, 16, 16, 16))
+  assert(not map:has_entities_in_rectangle(160, 100, 16, 16))
+  assert(map:get_first_entity_in_rectangle(160, 16, 96, 16) == first)
+  assert(map:get_first_entity_in_rectangle(160, 100, 16, 16) == nil)
+
+  -- Same first entity as the iterator.
+  for entity in map:get_entities_in_rectangle(160, 16, 96, 16) do
+    assert(entity == first)
+    break
+  end
+
+  -- Callbacks are called in Z order and can stop the iteration.
+  local visited = {}
+  map:foreach_entity_in_rectangle(160, 16, 96, 16, function(entity)
+    visited[#visited + 1] = entity
+    return entity ~= second
+  end)
+  assert(#visited == 2)
+  assert(visited[1] == first)
+  assert(visited[2] == second)
+
+  -- Callbacks can make other queries and remove entities.
+  local num_removed = 0
+  map:foreach_entity_in_rectangle(160, 16, 96, 16, function(entity)
+    assert(map:get_entities_in_rectangle_count(160, 16, 96, 16) == 3)
+    for other in map:get_entities("query_") do
+      assert(other:get_name():sub(1, 6) == "query_")
+    end
+    entity:remove()
+    num_removed = num_removed + 1
+  end)
+  assert(num_removed == 3)
+
+  -- Nested iterators over reused tables stay independent.
+  local pairs_count = 0
+  for outer in map:get_entities_by_type("custom_entity") do
+    for inner in map:get_entities_by_type("custom_entity") do
+      pairs_count = pairs_count + 1
+    end
+  end
+  assert(pairs_count == 9)
+
+  sol.timer.start(map, 10, function()
+    assert(not map:has_entities_in_rectangle(160, 16, 96, 16))
+    assert(map:get_entities_count("query_") == 0)
+    sol.main.exit()
+  end)
+end
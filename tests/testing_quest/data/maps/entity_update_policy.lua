@@ -0,0 +1,70 @@
+local map = ...
+
+local meta = sol.main.get_metatable("custom_entity")
+
+local function step(delay, callback)
+  sol.timer.start(map, delay, callback)
+end
+
+-- Creates a custom entity more than one screen away from the camera.
+local function create_far_entity()
+
+  return map:create_custom_entity({
+    x = 1200,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+function map:on_started()
+
+  local entity = create_far_entity()
+  local updates = 0
+
+  assert(entity:get_update_policy() == "always")
+  entity:set_update_policy("on_demand")
+  assert(entity:get_update_policy() == "on_demand")
+  assert(not pcall(entity.set_update_policy, entity, "sometimes"))
+  assert(entity:get_update_policy() == "on_demand")
+
+  step(100, function()
+    -- Defining on_update() wakes up a sleeping entity.
+    function entity:on_update()
+      updates = updates + 1
+    end
+
+    step(100, function()
+      assert(updates > 0)
+
+      -- Far entities with the near_camera policy are not updated.
+      entity:set_update_policy("near_camera")
+      assert(entity:get_update_policy() == "near_camera")
+      updates = 0
+
+      step(100, function()
+        assert(updates == 0)
+
+        local other_entity = create_far_entity()
+        other_entity:set_update_policy("on_demand")
+        local meta_updates = 0
+
+        step(100, function()
+          -- on_update() defined on the metatable wakes them up too.
+          function meta:on_update()
+            if self == other_entity then
+              meta_updates = meta_updates + 1
+            end
+          end
+
+          step(100, function()
+            assert(meta_updates > 0)
+            sol.main.exit()
+          end)
+        end)
+      end)
+    end)
+  end)
+end
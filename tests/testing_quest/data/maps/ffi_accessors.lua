@@ -0,0 +1,41 @@
+local map = ...
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  -- Accessors give the same values, with or without the FFI.
+  local x, y, layer = entity:get_position()
+  assert(x == 160 and y == 120 and layer == 0)
+  entity:set_position(100, 80)
+  x, y, layer = entity:get_position()
+  assert(x == 100 and y == 80 and layer == 0)
+  x, y = entity:get_center_position()
+  assert(x == 100 and y == 75)
+  local box_x, box_y, box_width, box_height = entity:get_bounding_box()
+  assert(box_x == 92 and box_y == 67 and box_width == 16 and box_height == 16)
+
+  local hero = map:get_hero()
+  x, y = hero:get_position()
+  assert(x == 24 and y == 221)
+
+  local movement = sol.movement.create("straight")
+  movement:set_speed(88)
+  movement:set_angle(math.pi)
+  assert(movement:get_speed() == 88)
+  assert(math.abs(movement:get_angle() - math.pi) < 1e-9)
+
+  -- Wrong arguments are still reported.
+  assert(not pcall(entity.get_position, {}))
+  assert(not pcall(entity.get_position, movement))
+  assert(not pcall(movement.get_speed, entity))
+
+  sol.main.exit()
+end
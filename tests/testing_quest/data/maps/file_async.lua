@@ -0,0 +1,38 @@
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  assert(not pcall(sol.file.read_async, "../outside.txt", function() end))
+  assert(not pcall(sol.file.write_async, "/outside.txt", "content"))
+
+  local written = nil
+  local read_content = nil
+  local missing_content, missing_error = nil, nil
+
+  sol.file.write_async("file_async.txt", "first")
+  sol.file.write_async("file_async.txt", "second", function(success)
+    written = success
+  end)
+
+  -- Reads see the writes requested before them.
+  sol.file.read_async("file_async.txt", function(content)
+    read_content = content
+  end)
+  sol.file.read_async("file_async_missing.txt", function(content, error)
+    missing_content, missing_error = content, error
+  end)
+
+  -- Callbacks are called later.
+  assert(written == nil)
+  assert(read_content == nil)
+
+  sol.timer.start(map, 100, function()
+    assert(written == true)
+    assert(read_content == "second")
+    assert(missing_content == nil)
+    assert(type(missing_error) == "string")
+
+    sol.file.remove("file_async.txt")
+    sol.main.exit()
+  end)
+end
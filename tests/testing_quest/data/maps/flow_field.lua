@@ -0,0 +1,53 @@
+local map = ...
+local hero = map:get_hero()
+
+function map:on_started()
+
+  local chasers = {}
+  local num_paths_ready = 0
+
+  for i = 1, 3 do
+    chasers[i] = map:create_custom_entity({
+      x = 72 + 24 * i,
+      y = 93,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+
+    local movement = sol.movement.create("path_finding")
+    assert(not movement:get_use_flow_field())
+    movement:set_use_flow_field(true)
+    assert(movement:get_use_flow_field())
+    movement:set_target(hero)
+
+    function movement:on_path_ready(path)
+      -- Paths sampled from the flow field lead to the hero.
+      assert(#path > 0)
+      for _, direction8 in ipairs(path) do
+        assert(direction8 >= 0 and direction8 < 8)
+      end
+      num_paths_ready = num_paths_ready + 1
+      if num_paths_ready == #chasers then
+        sol.main.exit()
+      end
+    end
+
+    movement:start(chasers[i])
+  end
+
+  local target_movement = sol.movement.create("target")
+  assert(not target_movement:get_use_flow_field())
+  target_movement:set_use_flow_field()
+  assert(target_movement:get_use_flow_field())
+  target_movement:set_target(hero)
+  target_movement:start(map:create_custom_entity({
+    x = 232,
+    y = 157,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  }))
+end
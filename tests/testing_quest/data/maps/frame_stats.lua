@@ -0,0 +1,24 @@
+local map = ...
+
+local num_updates = 0
+function map:on_update()
+
+  num_updates = num_updates + 1
+  if num_updates == 10 then
+    assert(not pcall(sol.main.get_frame_stats, -1))
+
+    local frames = sol.main.get_frame_stats()
+    assert(#frames > 0)
+    local frame = frames[#frames]
+    assert(frame.num_updates >= 1)
+    assert(frame.update_time >= 0)
+    assert(frame.entities_updated >= 1)
+    assert(frame.lua_memory > 0)
+    assert(frame.lua_calls >= 0)
+    assert(frame.quadtree_queries >= 0)
+
+    assert(#sol.main.get_frame_stats(1) == 1)
+    assert(#sol.main.get_frame_stats(0) == 0)
+    sol.main.exit()
+  end
+end
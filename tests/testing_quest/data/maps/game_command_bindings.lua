@@ -0,0 +1,34 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_opening_transition_finished()
+
+  -- Keyboard: binding a key already used swaps the two commands.
+  game:set_command_keyboard_binding("action", "space")
+  game:set_command_keyboard_binding("attack", "c")
+  game:set_command_keyboard_binding("action", "c")
+  assert_equal(game:get_command_keyboard_binding("action"), "c")
+  assert_equal(game:get_command_keyboard_binding("attack"), "space")
+  game:set_command_keyboard_binding("attack", nil)
+  assert_equal(game:get_command_keyboard_binding("attack"), nil)
+
+  -- Joypad: same with each kind of joypad element.
+  game:set_command_joypad_binding("item_1", "button 3")
+  game:set_command_joypad_binding("item_2", "axis 1 -")
+  game:set_command_joypad_binding("item_1", "axis 1 -")
+  assert_equal(game:get_command_joypad_binding("item_1"), "axis 1 -")
+  assert_equal(game:get_command_joypad_binding("item_2"), "button 3")
+  game:set_command_joypad_binding("pause", "hat 0 left")
+  assert_equal(game:get_command_joypad_binding("pause"), "hat 0 left")
+  game:set_command_joypad_binding("pause", nil)
+  assert_equal(game:get_command_joypad_binding("pause"), nil)
+
+  -- Pressed state of commands.
+  assert(not game:is_command_pressed("item_2"))
+  game:simulate_command_pressed("item_2")
+  assert(game:is_command_pressed("item_2"))
+  game:simulate_command_released("item_2")
+  assert(not game:is_command_pressed("item_2"))
+
+  sol.main.exit()
+end
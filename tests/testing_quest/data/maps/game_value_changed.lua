@@ -0,0 +1,49 @@
+local map = ...
+local game = map:get_game()
+
+local changes = {}
+local changed_keys = {}
+
+function game:on_value_changed(key, value)
+  -- Each key is notified once per cycle.
+  assert(not changed_keys[key])
+  changes[key] = value
+  changed_keys[key] = true
+end
+
+function map:on_opening_transition_finished()
+
+  changes = {}
+  changed_keys = {}
+  game:set_value("test_counter", 1)
+  game:set_value("test_counter", 2)
+  game:set_value("test_flag", true)
+  game:set_value("test_name", "")
+  game:set_max_life(12)
+  game:set_life(10)
+
+  -- Changes are delivered after the update of the map.
+  assert(not changed_keys.test_counter)
+
+  sol.timer.start(map, 10, function()
+    assert_equal(changes.test_counter, 2)
+    assert_equal(changes.test_flag, true)
+    assert_equal(changes.test_name, "")
+    assert_equal(changes._current_life, 10)
+
+    -- Setting the same value again is not a change, unsetting one is.
+    changes = {}
+    changed_keys = {}
+    game:set_value("test_counter", 2)
+    game:set_value("test_flag", nil)
+
+    sol.timer.start(map, 10, function()
+      assert(not changed_keys.test_counter)
+      assert(changed_keys.test_flag)
+      assert_equal(changes.test_flag, nil)
+
+      game.on_value_changed = nil
+      sol.main.exit()
+    end)
+  end)
+end
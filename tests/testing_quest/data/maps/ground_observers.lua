@@ -0,0 +1,63 @@
+local map = ...
+
+local function create_box(x, y)
+
+  local entity = map:create_custom_entity({
+    x = x,
+    y = y,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  entity:set_origin(0, 0)
+  return entity
+end
+
+function map:on_started()
+
+  local observer = create_box(160, 120)
+  local num_changes = 0
+  function observer:on_ground_below_changed()
+    num_changes = num_changes + 1
+  end
+
+  local modifier = create_box(100, 100)
+  modifier:set_modified_ground("deep_water")
+
+  -- Wait for the observer to notice its event.
+  sol.timer.start(map, 10, function()
+
+    observer:set_position(161, 120)
+    observer:set_position(160, 120)
+    assert(observer:get_ground_below() == "traversable")
+
+    -- The modifier comes below the observer.
+    modifier:set_position(152, 112)
+    assert(observer:get_ground_below() == "deep_water")
+
+    -- The modifier leaves.
+    modifier:set_position(200, 112)
+    assert(observer:get_ground_below() == "traversable")
+
+    -- Disabling and enabling the modifier.
+    modifier:set_position(152, 112)
+    assert(observer:get_ground_below() == "deep_water")
+    modifier:set_enabled(false)
+    assert(observer:get_ground_below() == "traversable")
+    modifier:set_enabled(true)
+    assert(observer:get_ground_below() == "deep_water")
+
+    -- Moving while still covering the observer changes nothing.
+    local previous_num_changes = num_changes
+    modifier:set_position(150, 110)
+    assert(observer:get_ground_below() == "deep_water")
+    assert(num_changes == previous_num_changes)
+
+    -- The modifier disappears.
+    modifier:remove()
+    assert(observer:get_ground_below() == "traversable")
+
+    sol.main.exit()
+  end)
+end
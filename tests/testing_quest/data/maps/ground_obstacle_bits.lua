@@ -0,0 +1,50 @@
+local map = ...
+
+function map:on_started()
+
+  local walker = map:create_custom_entity({
+    x = 0,
+    y = 0,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  walker:set_origin(0, 0)
+
+  -- Returns whether the walker collides with obstacles at a position.
+  local function test(x, y)
+    walker:set_position(x, y)
+    return walker:test_obstacles(0, 0)
+  end
+
+  -- Wall tile at 160,96, tested with boxes not aligned on the grid.
+  assert(not test(144, 97))
+  assert(test(145, 97))
+  assert(not test(163, 80))
+  assert(test(163, 81))
+
+  -- Only the border of the box is tested.
+  assert(not test(92, 156))
+
+  -- Hole tile on the border: obstacle until the walker can traverse holes.
+  assert(test(90, 150))
+  walker:set_can_traverse_ground("hole", true)
+  assert(not test(90, 150))
+  walker:set_can_traverse_ground("hole", nil)
+  assert(test(90, 150))
+
+  -- Diagonal wall tile: needs a point by point test.
+  assert(not test(204, 161))
+  assert(test(210, 161))
+
+  -- Dynamic tile: the ground is modified there.
+  assert(not test(24, 41))
+  assert(test(25, 41))
+
+  -- Map border.
+  assert(not test(304, 224))
+  assert(test(305, 224))
+
+  sol.main.exit()
+end
@@ -0,0 +1,44 @@
+local map = ...
+
+function map:on_started()
+
+  wall_entity:set_origin(0, 0)
+  wall_entity:set_position(160, 112)
+  wall_entity:set_modified_ground("wall")
+
+  -- The region starts outside the map and crosses the wall entity.
+  local x, y, width, height, cell_size = -16, 80, 240, 100, 16
+  local cells, names = map:get_ground_region(x, y, width, height, 0, cell_size)
+  local num_columns = math.ceil(width / cell_size)
+  local num_rows = math.ceil(height / cell_size)
+  assert(#cells == num_columns * num_rows)
+
+  -- Each cell has the ground at its center.
+  for row = 0, num_rows - 1 do
+    for column = 0, num_columns - 1 do
+      local code = cells:byte(row * num_columns + column + 1)
+      local cell_x = x + column * cell_size + cell_size / 2
+      local cell_y = y + row * cell_size + cell_size / 2
+      assert(names[code] == map:get_ground(cell_x, cell_y, 0))
+    end
+  end
+  assert(names[cells:byte(1)] == "empty")
+  assert(names[cells:byte(3 * num_columns + 12)] == "wall")
+  assert(names[cells:byte(3 * num_columns + 2)] == "traversable")
+
+  -- Obstacles for the hero: outside the map and the wall entity.
+  local hero = map:get_hero()
+  local obstacles = map:get_obstacle_region(hero, x, y, width, height, 0, cell_size)
+  assert(#obstacles == #cells)
+  assert(obstacles:byte(1) == 1)
+  assert(obstacles:byte(3 * num_columns + 12) == 1)
+  assert(obstacles:byte(3 * num_columns + 2) == 0)
+
+  -- The cell size defaults to 8 pixels.
+  assert(#map:get_ground_region(0, 0, 32, 16, 0) == 8)
+  assert(#map:get_ground_region(0, 0, 0, 0, 0) == 0)
+  assert(not pcall(map.get_ground_region, map, 0, 0, 32, 16, 0, 0))
+  assert(not pcall(map.get_ground_region, map, 0, 0, -1, 16, 0))
+
+  sol.main.exit()
+end
@@ -0,0 +1,27 @@
+local map = ...
+local hero = map:get_hero()
+
+function map:on_started()
+
+  assert(not hero:is_sprite_composition_enabled())
+  hero:set_sprite_composition_enabled(true)
+  assert(hero:is_sprite_composition_enabled())
+
+  -- Draw merged frames of several animations.
+  hero:set_animation("walking")
+  sol.timer.start(map, 200, function()
+    hero:set_direction(1)
+    hero:set_animation("stopped")
+
+    -- Effects on a sprite make the hero drawn without merging.
+    local tunic = hero:get_sprite("tunic")
+    tunic:set_opacity(128)
+    hero:set_blinking(true, 100)
+    sol.timer.start(map, 200, function()
+      tunic:set_opacity(255)
+      hero:set_sprite_composition_enabled(false)
+      assert(not hero:is_sprite_composition_enabled())
+      sol.main.exit()
+    end)
+  end)
+end
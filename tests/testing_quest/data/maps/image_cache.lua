@@ -0,0 +1,61 @@
+local map = ...
+
+local stat_names = {
+  "hits",
+  "misses",
+  "evictions",
+  "num_images",
+  "num_unreferenced",
+  "vram_bytes",
+  "ram_bytes",
+  "vram_budget",
+  "ram_budget",
+}
+
+local function check_stats(stats)
+
+  assert(type(stats) == "table")
+  for _, name in ipairs(stat_names) do
+    assert(type(stats[name]) == "number")
+    assert(stats[name] == math.floor(stats[name]))
+    assert(stats[name] >= 0)
+  end
+  assert(stats.num_unreferenced <= stats.num_images)
+end
+
+function map:on_started()
+
+  local stats = sol.main.get_image_cache_stats()
+  check_stats(stats)
+
+  -- No budget by default.
+  assert(stats.vram_budget == 0)
+  assert(stats.ram_budget == 0)
+
+  -- Loading the same image twice finds it in the cache the second time.
+  local first = sol.surface.create("destructibles/vase.png")
+  assert(first ~= nil)
+  local after_first = sol.main.get_image_cache_stats()
+  check_stats(after_first)
+  assert(after_first.hits + after_first.misses > stats.hits + stats.misses)
+  assert(after_first.num_images >= 1)
+  assert(after_first.vram_bytes > 0)
+
+  local second = sol.surface.create("destructibles/vase.png")
+  assert(second ~= nil)
+  local after_second = sol.main.get_image_cache_stats()
+  check_stats(after_second)
+  assert(after_second.hits == after_first.hits + 1)
+  assert(after_second.num_images == after_first.num_images)
+  assert(after_second.evictions == after_first.evictions)
+
+  -- A missing file does not add anything to the cache.
+  assert(sol.surface.create("destructibles/no_such_image.png") == nil)
+  local after_missing = sol.main.get_image_cache_stats()
+  assert(after_missing.num_images == after_second.num_images)
+
+  -- Each call returns a new table.
+  assert(sol.main.get_image_cache_stats() ~= sol.main.get_image_cache_stats())
+
+  sol.main.exit()
+end
@@ -0,0 +1,25 @@
+local map = ...
+local game = map:get_game()
+
+local item = game:get_item("non_saved_item")
+local num_updates = 0
+
+function map:on_opening_transition_finished()
+
+  -- An on_update() defined after the item was started is called.
+  function item:on_update()
+    num_updates = num_updates + 1
+  end
+
+  sol.timer.start(map, 100, function()
+    assert(num_updates > 0)
+
+    -- Removing it stops the updates.
+    item.on_update = nil
+    local num_updates_before = num_updates
+    sol.timer.start(map, 100, function()
+      assert(num_updates == num_updates_before)
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,28 @@
+local map = ...
+
+function map:on_started()
+
+  assert_equal(sol.language.get_language(), "en")
+
+  -- Preloading returns immediately and the switch uses the result.
+  sol.language.preload_language("en")
+  sol.language.preload_language("en")
+  sol.language.set_language("en")
+  assert_equal(sol.language.get_language(), "en")
+  assert_equal(sol.language.get_string("a.1"), "test A1")
+  assert_equal(sol.language.get_string("b.2"), "test B2")
+  assert(sol.language.get_string("unknown") == nil)
+
+  local dialog = sol.language.get_dialog("_treasure.bomb.1")
+  assert(dialog ~= nil)
+  assert_equal(dialog.id, "_treasure.bomb.1")
+  assert(sol.language.get_dialog("unknown") == nil)
+
+  -- Without preloading, the texts are read when switching.
+  sol.language.set_language("en")
+  assert_equal(sol.language.get_string("a"), "test A")
+
+  assert(not pcall(sol.language.preload_language, "unknown"))
+
+  sol.main.exit()
+end
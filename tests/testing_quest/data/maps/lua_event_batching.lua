@@ -0,0 +1,89 @@
+local map = ...
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  -- Individual events keep working with batches.
+  local num_individual_events = 0
+  function entity:on_position_changed()
+    num_individual_events = num_individual_events + 1
+  end
+
+  local batches = {}
+  local function on_positions_changed(events)
+    local positions = {}
+    for _, event in ipairs(events) do
+      if event[1] == entity then
+        positions[#positions + 1] = event
+      end
+    end
+    batches[#batches + 1] = positions
+  end
+
+  local movements = {}
+  sol.main.set_event_batch_handler("on_position_changed", on_positions_changed)
+  sol.main.set_event_batch_handler("on_movement_changed", function(events)
+    for _, event in ipairs(events) do
+      if event[1] == entity then
+        movements[#movements + 1] = event[2]
+      end
+    end
+  end)
+  assert(sol.main.get_event_batch_handler("on_position_changed") == on_positions_changed)
+  assert(sol.main.get_event_batch_handler("on_frame_changed") == nil)
+  assert(not pcall(sol.main.set_event_batch_handler, "on_update", on_positions_changed))
+
+  sol.timer.start(map, 10, function()
+
+    -- Several changes in one cycle make a single batch.
+    batches = {}
+    entity:set_position(161, 120)
+    entity:set_position(162, 121, 0)
+    assert(#batches == 0)
+    assert(num_individual_events == 2)
+
+    sol.timer.start(map, 10, function()
+
+      assert(#batches == 1)
+      local positions = batches[1]
+      assert(#positions == 2)
+      assert(positions[1][2] == 161 and positions[1][3] == 120 and positions[1][4] == 0)
+      assert(positions[2][2] == 162 and positions[2][3] == 121 and positions[2][4] == 0)
+
+      -- Movement changes come with their movement.
+      local movement = sol.movement.create("straight")
+      movement:set_speed(60)
+      movement:set_angle(0)
+      movement:start(entity)
+
+      sol.timer.start(map, 100, function()
+
+        assert(#movements > 0)
+        for _, event_movement in ipairs(movements) do
+          assert(event_movement == movement)
+        end
+        movement:stop()
+
+        -- Without handler, nothing is collected anymore.
+        sol.main.set_event_batch_handler("on_position_changed", nil)
+        assert(sol.main.get_event_batch_handler("on_position_changed") == nil)
+        batches = {}
+        entity:set_position(170, 120)
+
+        sol.timer.start(map, 10, function()
+          assert(#batches == 0)
+          sol.main.set_event_batch_handler("on_movement_changed", nil)
+          sol.main.exit()
+        end)
+      end)
+    end)
+  end)
+end
@@ -0,0 +1,62 @@
+local map = ...
+
+local custom_entity_meta = sol.main.get_metatable("custom_entity")
+local sensor_meta = sol.main.get_metatable("sensor")
+local inherited_updates = 0
+local raw_updates = 0
+
+local function step(delay, callback)
+  sol.timer.start(map, delay, callback)
+end
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  local sensor = map:create_sensor({
+    x = 80,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+  })
+
+  -- Events inherited through a metatable set on the metatable of a type.
+  local base = {}
+  setmetatable(custom_entity_meta, { __index = base })
+  function base:on_update()
+    if self == entity then
+      inherited_updates = inherited_updates + 1
+    end
+  end
+
+  -- Events set with rawset() on the metatable of a type.
+  rawset(sensor_meta, "on_update", function(self)
+    if self == sensor then
+      raw_updates = raw_updates + 1
+    end
+  end)
+
+  step(100, function()
+    assert(inherited_updates > 0)
+    assert(raw_updates > 0)
+
+    -- Removed events are no longer called.
+    base.on_update = nil
+    rawset(sensor_meta, "on_update", nil)
+    local previous_inherited_updates = inherited_updates
+    local previous_raw_updates = raw_updates
+
+    step(100, function()
+      assert(inherited_updates == previous_inherited_updates)
+      assert(raw_updates == previous_raw_updates)
+      sol.main.exit()
+    end)
+  end)
+end
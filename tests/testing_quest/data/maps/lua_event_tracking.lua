@@ -0,0 +1,58 @@
+local map = ...
+
+local meta = sol.main.get_metatable("custom_entity")
+local entity
+local meta_updates = 0
+local own_updates = 0
+
+local function step(delay, callback)
+  sol.timer.start(map, delay, callback)
+end
+
+function map:on_started()
+
+  entity = map:create_custom_entity({
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  step(100, function()
+    -- Events defined on the metatable after the entity was created.
+    assert(meta_updates == 0)
+    function meta:on_update()
+      if self == entity then
+        meta_updates = meta_updates + 1
+      end
+    end
+
+    step(100, function()
+      assert(meta_updates > 0)
+
+      -- Events defined on the entity itself take precedence.
+      function entity:on_update()
+        own_updates = own_updates + 1
+      end
+      local previous_meta_updates = meta_updates
+
+      step(100, function()
+        assert(own_updates > 0)
+        assert(meta_updates == previous_meta_updates)
+
+        -- Removed events are no longer called.
+        entity.on_update = nil
+        meta.on_update = nil
+        local previous_own_updates = own_updates
+
+        step(100, function()
+          assert(own_updates == previous_own_updates)
+          assert(meta_updates == previous_meta_updates)
+          sol.main.exit()
+        end)
+      end)
+    end)
+  end)
+end
@@ -0,0 +1,35 @@
+local map = ...
+
+local function busy()
+
+  local t = {}
+  for i = 1, 10000 do
+    t[#t + 1] = { i }
+  end
+  return #t
+end
+
+function map:on_started()
+
+  assert(not pcall(sol.main.start_profiler, 0))
+  sol.main.start_profiler(10)
+end
+
+local num_updates = 0
+function map:on_update()
+
+  busy()
+  num_updates = num_updates + 1
+  if num_updates == 10 then
+    sol.main.stop_profiler()
+
+    local report = sol.main.get_profiler_report()
+    assert(type(report) == "string")
+    assert(report:find("on_update", 1, true) ~= nil)
+    assert(report:find("lua_profiler.lua", 1, true) ~= nil)
+
+    -- Results are kept after stopping.
+    assert(sol.main.get_profiler_report() == report)
+    sol.main.exit()
+  end
+end
@@ -0,0 +1,61 @@
+local map = ...
+
+-- Pure function: no upvalues, only its argument.
+local function sum_path(message)
+  local total = 0
+  for _, step in ipairs(message.steps) do
+    total = total + step.cost
+  end
+  return { total = total, name = message.name .. "!" }
+end
+
+function map:on_started()
+
+  assert(sol.worker.get_num_threads() >= 1)
+
+  -- Functions with upvalues or values that cannot be copied are rejected.
+  local upvalue = 1
+  assert(not pcall(sol.worker.run, function() return upvalue end, nil, nil))
+  assert(not pcall(sol.worker.run, sum_path, { entity = map:get_hero() }, nil))
+  local cyclic = {}
+  cyclic.self = cyclic
+  assert(not pcall(sol.worker.run, sum_path, cyclic, nil))
+
+  local num_done = 0
+  local function check_done()
+    num_done = num_done + 1
+    if num_done == 4 then
+      sol.main.exit()
+    end
+  end
+
+  -- Function values are sent as bytecode.
+  sol.worker.run(sum_path, {
+    name = "path",
+    steps = { { cost = 1 }, { cost = 2.5 }, { cost = 3 } },
+  }, function(result, error)
+    assert(error == nil)
+    assert(result.total == 6.5)
+    assert(result.name == "path!")
+    check_done()
+  end)
+
+  -- Strings are compiled and receive the message in "...".
+  sol.worker.run("local n = ... return n * 2, 'ignored'", 21, function(result)
+    assert(result == 42)
+    check_done()
+  end)
+
+  -- The worker state does not give access to files or the engine.
+  sol.worker.run("return io == nil and sol == nil and os.remove == nil", nil, function(result)
+    assert(result == true)
+    check_done()
+  end)
+
+  -- Errors are given to the callback.
+  sol.worker.run("error('failed')", nil, function(result, error)
+    assert(result == nil)
+    assert(error:match("failed"))
+    check_done()
+  end)
+end
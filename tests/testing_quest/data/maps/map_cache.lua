@@ -0,0 +1,24 @@
+local map = ...
+
+function map:on_started()
+
+  -- Two maps are kept by default.
+  assert(sol.main.get_map_cache_size() == 2)
+
+  sol.main.set_map_cache_size(5)
+  assert(sol.main.get_map_cache_size() == 5)
+
+  -- 0 keeps no map.
+  sol.main.set_map_cache_size(0)
+  assert(sol.main.get_map_cache_size() == 0)
+
+  -- Invalid sizes are errors and keep the previous value.
+  sol.main.set_map_cache_size(3)
+  assert(not pcall(sol.main.set_map_cache_size, -1))
+  assert(not pcall(sol.main.set_map_cache_size, "big"))
+  assert(not pcall(sol.main.set_map_cache_size))
+  assert(sol.main.get_map_cache_size() == 3)
+
+  sol.main.set_map_cache_size(2)
+  sol.main.exit()
+end
@@ -0,0 +1,71 @@
+local map = ...
+local game = map:get_game()
+
+local activated = {}
+local num_activations = 0
+local num_deactivations = 0
+
+function map:on_chunk_activated(column, row)
+
+  local key = column .. "," .. row
+  assert(not activated[key])
+  activated[key] = true
+  num_activations = num_activations + 1
+  assert(map:is_chunk_active(column, row))
+end
+
+function map:on_chunk_deactivated(column, row)
+
+  local key = column .. "," .. row
+  assert(activated[key])
+  activated[key] = nil
+  num_deactivations = num_deactivations + 1
+end
+
+function map:on_started()
+
+  assert(map:get_chunk_size() == nil)
+  assert(not map:is_chunk_active(0, 0))
+  assert(not pcall(map.set_chunk_size, map, 0, 120))
+
+  -- The map is 960x240: 6 columns and 2 rows of 160x120 chunks.
+  map:set_chunk_size(160, 120, 0)
+  local width, height, margin = map:get_chunk_size()
+  assert(width == 160)
+  assert(height == 120)
+  assert(margin == 0)
+
+  -- Chunks under the camera are activated right away.
+  assert(num_activations == 4)
+  assert(map:is_chunk_active(0, 0))
+  assert(map:is_chunk_active(1, 1))
+  assert(not map:is_chunk_active(2, 0))
+end
+
+local num_updates = 0
+function map:on_update()
+
+  num_updates = num_updates + 1
+  if num_updates == 1 then
+    local hero = map:get_hero()
+    hero:set_position(800, 125)
+  elseif num_updates == 3 then
+    -- The camera now shows the last two columns.
+    assert(not map:is_chunk_active(0, 0))
+    assert(not map:is_chunk_active(1, 1))
+    assert(map:is_chunk_active(4, 0))
+    assert(map:is_chunk_active(5, 1))
+    assert(num_deactivations == 4)
+    assert(num_activations == 8)
+
+    -- A margin keeps neighbor chunks active.
+    map:set_chunk_size(160, 120, 1)
+    assert(map:is_chunk_active(3, 0))
+    assert(not map:is_chunk_active(2, 0))
+
+    map:set_chunk_size(nil)
+    assert(map:get_chunk_size() == nil)
+    assert(next(activated) == nil)
+    sol.main.exit()
+  end
+end
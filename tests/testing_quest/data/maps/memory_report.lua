@@ -0,0 +1,67 @@
+local map = ...
+
+local category_names = {
+  "textures",
+  "sounds",
+  "musics",
+  "lua",
+  "map_data",
+  "tileset_data",
+  "entities",
+}
+
+local function is_integer(value)
+  return type(value) == "number" and value == math.floor(value)
+end
+
+local function check_report(report)
+
+  assert(type(report) == "table")
+  for _, name in ipairs(category_names) do
+    local usage = report[name]
+    assert(type(usage) == "table")
+    assert(is_integer(usage.bytes) and usage.bytes >= 0)
+    assert(is_integer(usage.peak_bytes) and usage.peak_bytes >= usage.bytes)
+    assert(is_integer(usage.num_objects) and usage.num_objects >= 0)
+  end
+  assert(is_integer(report.total_bytes))
+end
+
+function map:on_started()
+
+  local report = sol.main.get_memory_report()
+  check_report(report)
+
+  -- The current map, its tileset and its entities are counted.
+  assert(report.map_data.bytes > 0)
+  assert(report.tileset_data.bytes > 0)
+  assert(report.entities.num_objects > 0)
+
+  -- Creating entities increases their count.
+  local num_entities = report.entities.num_objects
+  for i = 1, 10 do
+    map:create_custom_entity({
+      x = 160,
+      y = 120,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+  end
+  report = sol.main.get_memory_report()
+  check_report(report)
+  assert(report.entities.num_objects >= num_entities + 10)
+
+  -- Each call returns a new table.
+  assert(sol.main.get_memory_report() ~= sol.main.get_memory_report())
+
+  sol.timer.start(map, 100, function()
+    -- The Lua heap is sampled by the main loop.
+    local report = sol.main.get_memory_report()
+    check_report(report)
+    assert(report.lua.bytes > 0)
+    assert(report.total_bytes >= report.lua.bytes)
+    sol.main.exit()
+  end)
+end
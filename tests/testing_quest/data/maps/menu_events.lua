@@ -0,0 +1,61 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  -- A plain menu that defines its callbacks once started.
+  local plain_menu = {}
+  sol.menu.start(map, plain_menu)
+  local num_draws = 0
+  function plain_menu:on_draw(dst_surface)
+    num_draws = num_draws + 1
+  end
+  local commands = {}
+  function plain_menu:on_command_pressed(command)
+    commands[#commands + 1] = command
+    return true
+  end
+
+  -- A menu whose methods come from a class.
+  local class = {}
+  class.__index = class
+  local num_updates = 0
+  function class:on_update()
+    num_updates = num_updates + 1
+  end
+  local class_menu = setmetatable({}, class)
+  sol.menu.start(map, class_menu)
+
+  -- A menu reordered while menus are being updated.
+  local moving_menu = {}
+  function moving_menu:on_update()
+    sol.menu.bring_to_back(self)
+  end
+  sol.menu.start(map, moving_menu)
+
+  -- A child menu that receives updates even though its parent has none.
+  local parent_menu = {}
+  local child_menu = {}
+  local num_child_updates = 0
+  function child_menu:on_update()
+    num_child_updates = num_child_updates + 1
+  end
+  sol.menu.start(map, parent_menu)
+  sol.menu.start(parent_menu, child_menu)
+
+  sol.timer.start(map, 100, function()
+    assert(sol.menu.is_started(plain_menu))
+    assert(sol.menu.is_started(class_menu))
+    assert(sol.menu.is_started(child_menu))
+    assert(num_draws > 0)
+    assert(num_updates > 0)
+    assert(num_child_updates > 0)
+
+    game:simulate_command_pressed("action")
+    assert(commands[1] == "action")
+
+    sol.menu.stop(parent_menu)
+    assert(not sol.menu.is_started(child_menu))
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,84 @@
+local map = ...
+
+local function create_projectile(y)
+
+  return map:create_custom_entity({
+    x = 16,
+    y = y,
+    layer = 0,
+    width = 8,
+    height = 8,
+    direction = 0,
+  })
+end
+
+-- Detector that only sees the projectile at x = 160 exactly.
+local function create_detector(y, projectile)
+
+  local detector = map:create_custom_entity({
+    x = 160,
+    y = y,
+    layer = 0,
+    width = 8,
+    height = 8,
+    direction = 0,
+  })
+  detector.num_detections = 0
+  detector:add_collision_test(function(detector, other)
+    local x = other:get_position()
+    return other == projectile and x == 160
+  end, function(detector)
+    detector.num_detections = detector.num_detections + 1
+  end)
+  return detector
+end
+
+local function start_projectile(projectile, coalesce_moves, callback)
+
+  projectile.num_position_changes = 0
+  function projectile:on_position_changed()
+    projectile.num_position_changes = projectile.num_position_changes + 1
+  end
+
+  local movement = sol.movement.create("straight")
+  assert(not movement:get_coalesce_moves())
+  movement:set_coalesce_moves(coalesce_moves)
+  assert(movement:get_coalesce_moves() == coalesce_moves)
+  movement:set_angle(0)
+  movement:set_speed(1000)
+  movement:set_max_distance(200)
+  movement:set_ignore_obstacles(true)
+  movement:start(projectile, callback)
+end
+
+function map:on_started()
+
+  local projectile = create_projectile(40)
+  local detector = create_detector(40, projectile)
+  local coalesced_projectile = create_projectile(80)
+  local coalesced_detector = create_detector(80, coalesced_projectile)
+
+  local num_finished = 0
+  local function check()
+    num_finished = num_finished + 1
+    if num_finished < 2 then
+      return
+    end
+
+    -- Both projectiles went as far and were detected when crossing x = 160.
+    local x = projectile:get_position()
+    local coalesced_x = coalesced_projectile:get_position()
+    assert(x == coalesced_x)
+    assert(x >= 216)
+    assert(detector.num_detections >= 1)
+    assert(coalesced_detector.num_detections >= 1)
+
+    -- Position changes were notified less often.
+    assert(projectile.num_position_changes >= 200)
+    assert(coalesced_projectile.num_position_changes < projectile.num_position_changes / 2)
+    sol.main.exit()
+  end
+
+  start_projectile(projectile, false, check)
+  start_projectile(coalesced_projectile, true, check)
+end
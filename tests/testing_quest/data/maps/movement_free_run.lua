@@ -0,0 +1,58 @@
+local map = ...
+
+local function create_box(x, y)
+
+  return map:create_custom_entity({
+    x = x,
+    y = y,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+end
+
+-- Moves an entity fast and returns where it stopped.
+local function move(x, y, angle, coalesce_moves, callback)
+
+  local mover = create_box(x, y)
+  local movement = sol.movement.create("straight")
+  movement:set_coalesce_moves(coalesce_moves)
+  movement:set_angle(angle)
+  movement:set_speed(1000)
+  movement:set_max_distance(300)
+  function movement:on_obstacle_reached()
+    movement:stop()
+    callback(mover:get_position())
+  end
+  movement:start(mover)
+end
+
+function map:on_started()
+
+  local wall = create_box(200, 96)
+  wall:set_traversable_by(false)
+
+  local results = {}
+  local function check(name, x, y)
+    results[name] = { x, y }
+    if results.wall == nil or results.coalesced_wall == nil or
+        results.border == nil or results.coalesced_border == nil then
+      return
+    end
+
+    -- Stopped just before the wall and before the map border.
+    assert(results.wall[1] == 184)
+    assert(results.coalesced_wall[1] == results.wall[1])
+    assert(results.coalesced_wall[2] == results.wall[2])
+    assert(results.coalesced_border[1] == results.border[1])
+    assert(results.coalesced_border[2] == results.border[2])
+    assert(results.border[2] <= 16)
+    sol.main.exit()
+  end
+
+  move(40, 96, 0, false, function(x, y) check("wall", x, y) end)
+  move(40, 96, 0, true, function(x, y) check("coalesced_wall", x, y) end)
+  move(120, 160, math.pi / 2, false, function(x, y) check("border", x, y) end)
+  move(160, 160, math.pi / 2, true, function(x, y) check("coalesced_border", x, y) end)
+end
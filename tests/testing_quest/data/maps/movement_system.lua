@@ -0,0 +1,65 @@
+local map = ...
+
+local function create_mover(x, y)
+
+  local entity = map:create_custom_entity({
+    x = x,
+    y = y,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  return entity
+end
+
+function map:on_started()
+
+  -- Straight and circle movements mixed, updated by type.
+  local straight_entities = {}
+  for i = 1, 20 do
+    local entity = create_mover(40, 8 + i * 8)
+    local movement = sol.movement.create("straight")
+    movement:set_speed(100)
+    movement:set_angle(0)
+    movement:set_max_distance(50)
+    movement:start(entity)
+    straight_entities[#straight_entities + 1] = entity
+  end
+
+  local circle_entity = create_mover(240, 120)
+  local circle_movement = sol.movement.create("circle")
+  circle_movement:set_center(240, 120)
+  circle_movement:set_radius(32)
+  circle_movement:start(circle_entity)
+
+  -- A movement stopped by another entity's callback is not updated anymore.
+  local stopped_entity = create_mover(40, 200)
+  local stopped_movement = sol.movement.create("straight")
+  stopped_movement:set_speed(100)
+  stopped_movement:set_angle(0)
+  stopped_movement:start(stopped_entity)
+  local stopped_x
+  function straight_entities[1]:on_position_changed(x)
+    if x >= 60 and stopped_x == nil then
+      stopped_entity:stop_movement()
+      stopped_x = stopped_entity:get_position()
+    end
+  end
+
+  sol.timer.start(map, 1000, function()
+
+    for _, entity in ipairs(straight_entities) do
+      local x = entity:get_position()
+      assert(x == 90)
+    end
+
+    local x, y = circle_entity:get_position()
+    assert(sol.main.get_distance(x, y, 240, 120) >= 31)
+    assert(sol.main.get_distance(x, y, 240, 120) <= 33)
+
+    assert(stopped_x ~= nil)
+    assert(stopped_entity:get_position() == stopped_x)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,74 @@
+local map = ...
+
+local num_hidden = 10
+local mover
+local num_updates = 0
+local max_drawn_without_culling
+
+-- Returns the maximum number of entities drawn in the last frames.
+local function get_max_entities_drawn()
+
+  local max_drawn = 0
+  for _, frame in ipairs(sol.main.get_frame_stats(3)) do
+    max_drawn = math.max(max_drawn, frame.entities_drawn)
+  end
+  return max_drawn
+end
+
+function map:on_started()
+
+  -- Entities under the opaque tiles of layer 1.
+  for i = 1, num_hidden do
+    local entity = map:create_custom_entity({
+      x = 16 + (i - 1) * 12,
+      y = 48 + (i - 1) * 8,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+      sprite = "16x16",
+    })
+    assert(entity:get_sprite() ~= nil)
+  end
+
+  -- A visible entity that moves to redraw the screen at each frame.
+  mover = map:create_custom_entity({
+    x = 240,
+    y = 64,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+    sprite = "16x16",
+  })
+
+  assert(not map:is_occlusion_culling_enabled())
+end
+
+function map:on_update()
+
+  num_updates = num_updates + 1
+  local x, y = mover:get_position()
+  mover:set_position(x, num_updates % 2 == 0 and 64 or 72)
+
+  if num_updates == 10 then
+    max_drawn_without_culling = get_max_entities_drawn()
+    map:set_occlusion_culling_enabled(true)
+    assert(map:is_occlusion_culling_enabled())
+  elseif num_updates == 20 then
+    -- Hidden entities are no longer drawn, other ones still are.
+    local max_drawn_with_culling = get_max_entities_drawn()
+    if max_drawn_without_culling > 0 then
+      assert_equal(max_drawn_with_culling, max_drawn_without_culling - num_hidden)
+    end
+
+    -- Changing the tileset computes opaque tiles again.
+    map:set_tileset("castle_grayscale")
+  elseif num_updates == 30 then
+    map:set_occlusion_culling_enabled(false)
+    assert(not map:is_occlusion_culling_enabled())
+  elseif num_updates == 40 then
+    assert_equal(get_max_entities_drawn(), max_drawn_without_culling)
+    sol.main.exit()
+  end
+end
@@ -0,0 +1,58 @@
+local map = ...
+
+local sprites = {}
+local observed_sprite
+local num_frame_changes = 0
+
+function map:on_started()
+
+  assert(not map:is_parallel_update_enabled())
+  map:set_parallel_update_enabled(true)
+  assert(map:is_parallel_update_enabled())
+
+  -- Enough sprites to be split among several threads.
+  for i = 1, 300 do
+    local entity = map:create_custom_entity({
+      x = 16 + (i % 18) * 16,
+      y = 32 + math.floor(i / 18) * 8,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+      sprite = "entities/boomerang1",
+    })
+    sprites[#sprites + 1] = entity:get_sprite()
+  end
+
+  -- This one is observed from Lua and stays on the main thread.
+  local entity = map:create_custom_entity({
+    x = 160,
+    y = 200,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+    sprite = "entities/boomerang1",
+  })
+  observed_sprite = entity:get_sprite()
+  function observed_sprite:on_frame_changed(animation, frame)
+    num_frame_changes = num_frame_changes + 1
+  end
+end
+
+function map:on_opening_transition_finished()
+
+  sol.timer.start(map, 500, function()
+    assert(num_frame_changes > 0)
+
+    -- Sprites advanced in parallel follow the same animation.
+    local frame = observed_sprite:get_frame()
+    for _, sprite in ipairs(sprites) do
+      assert_equal(sprite:get_frame(), frame)
+    end
+
+    map:set_parallel_update_enabled(false)
+    assert(not map:is_parallel_update_enabled())
+    sol.main.exit()
+  end)
+end
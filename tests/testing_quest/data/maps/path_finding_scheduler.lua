@@ -0,0 +1,31 @@
+local map = ...
+local hero = map:get_hero()
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    x = 104,
+    y = 93,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+
+  local movement = sol.movement.create("path_finding")
+  movement:set_target(hero)
+
+  function movement:on_path_ready(path)
+    -- The path is delivered after the movement started.
+    assert(type(path) == "table")
+    assert(#path > 0)
+    for _, direction8 in ipairs(path) do
+      assert(direction8 >= 0 and direction8 < 8)
+    end
+    -- The movement follows the path just computed.
+    assert(#movement:get_path() == #path)
+    sol.main.exit()
+  end
+
+  movement:start(entity)
+end
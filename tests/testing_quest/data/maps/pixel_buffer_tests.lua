@@ -0,0 +1,127 @@
+local map = ...
+
+-- Returns the RGBA components of a pixel of a 16x16 surface.
+local function get_surface_pixel(pixels, x, y)
+  local index = (y * 16 + x) * 4 + 1
+  return pixels:byte(index, index + 3)
+end
+
+-- Test for per-pixel access.
+local function test_pixels()
+
+  local buffer = sol.pixel_buffer.create(16, 8)
+  local width, height = buffer:get_size()
+  assert_equal(width, 16)
+  assert_equal(height, 8)
+
+  local r, g, b, a = buffer:get_pixel(3, 4)
+  assert(r == 0 and g == 0 and b == 0 and a == 0)
+  buffer:set_pixel(3, 4, 10, 20, 30)
+  r, g, b, a = buffer:get_pixel(3, 4)
+  assert(r == 10 and g == 20 and b == 30 and a == 255)
+  buffer:set_pixel(5, 6, {40, 50, 60, 70})
+  r, g, b, a = buffer:get_pixel(5, 6)
+  assert(r == 40 and g == 50 and b == 60 and a == 70)
+
+  local x, y, dirty_width, dirty_height = buffer:get_dirty_region()
+  assert(x == 3 and y == 4 and dirty_width == 3 and dirty_height == 3)
+
+  assert(not pcall(buffer.get_pixel, buffer, 16, 0))
+  assert(not pcall(buffer.set_pixel, buffer, 0, -1, 0, 0, 0))
+end
+
+-- Test for fill() and blit().
+local function test_fill_and_blit()
+
+  local buffer = sol.pixel_buffer.create(16, 16)
+  buffer:fill({255, 0, 0, 255})
+  buffer:fill({0, 0, 255, 255}, 12, 12, 10, 10)  -- Clipped.
+  local r, g, b = buffer:get_pixel(11, 11)
+  assert(r == 255 and b == 0)
+  r, g, b = buffer:get_pixel(15, 15)
+  assert(r == 0 and b == 255)
+
+  local other = sol.pixel_buffer.create(4, 4)
+  other:fill({0, 255, 0, 128})
+  buffer:blit(other, -2, 0)  -- Clipped.
+  r, g, b, a = buffer:get_pixel(1, 3)
+  assert(g == 255 and a == 128)
+  r, g, b, a = buffer:get_pixel(2, 0)
+  assert(r == 255 and g == 0)
+
+  -- Overlapping copy inside the same buffer.
+  buffer:blit(buffer, 0, 1, 0, 0, 16, 15)
+  r, g, b, a = buffer:get_pixel(1, 4)
+  assert(g == 255 and a == 128)
+  r, g, b, a = buffer:get_pixel(1, 0)
+  assert(g == 255 and a == 128)
+end
+
+-- Test for uploading to surfaces and reading from them.
+local function test_surfaces()
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({0, 0, 0, 255})
+
+  local buffer = sol.pixel_buffer.create(4, 4)
+  buffer:upload(surface)  -- Nothing modified yet.
+  local r, g, b, a = get_surface_pixel(surface:get_pixels(), 0, 0)
+  assert(r == 0 and a == 255)
+
+  buffer:set_pixel(1, 2, 200, 100, 50, 255)
+  buffer:upload(surface, 8, 4)
+  assert(buffer:get_dirty_region() == nil)
+  local pixels = surface:get_pixels()
+  r, g, b, a = get_surface_pixel(pixels, 9, 6)
+  assert(r == 200 and g == 100 and b == 50 and a == 255)
+  r, g, b, a = get_surface_pixel(pixels, 8, 4)
+  assert(r == 0 and a == 255)  -- Outside the dirty region.
+
+  -- Explicit region.
+  buffer:upload(surface, 0, 0, 0, 0, 4, 4)
+  r, g, b, a = get_surface_pixel(surface:get_pixels(), 0, 0)
+  assert(r == 0 and a == 0)
+
+  local copy = sol.pixel_buffer.create(surface)
+  r, g, b, a = copy:get_pixel(9, 6)
+  assert(r == 200 and g == 100 and b == 50 and a == 255)
+
+  local part = sol.pixel_buffer.create(2, 2)
+  part:read(surface, 8, 5)
+  r, g, b, a = part:get_pixel(1, 1)
+  assert(r == 200 and g == 100 and b == 50 and a == 255)
+end
+
+-- Test for direct access through the LuaJIT FFI.
+local function test_pointer()
+
+  local buffer = sol.pixel_buffer.create(4, 4)
+  local ffi_available = pcall(require, "ffi")
+  if not ffi_available then
+    assert(not pcall(buffer.get_pointer, buffer))
+    return
+  end
+
+  local pointer = buffer:get_pointer()
+  local index = (2 * 4 + 3) * 4  -- Pixel (3, 2).
+  pointer[index] = 1
+  pointer[index + 1] = 2
+  pointer[index + 2] = 3
+  pointer[index + 3] = 4
+  local r, g, b, a = buffer:get_pixel(3, 2)
+  assert(r == 1 and g == 2 and b == 3 and a == 4)
+
+  assert(buffer:get_dirty_region() == nil)
+  buffer:mark_dirty(3, 2, 1, 1)
+  local x, y, width, height = buffer:get_dirty_region()
+  assert(x == 3 and y == 2 and width == 1 and height == 1)
+end
+
+function map:on_started()
+
+  test_pixels()
+  test_fill_and_blit()
+  test_surfaces()
+  test_pointer()
+  sol.main.exit()
+end
@@ -0,0 +1,33 @@
+local map = ...
+
+local sepia = sol.shader.create("sepia")
+local scale2x = sol.shader.create("scale2x")
+
+function map:on_started()
+
+  assert(#sol.video.get_post_effects() == 0)
+  assert(not pcall(sol.video.set_post_effects, { sepia, "scale2x" }))
+
+  sol.video.set_post_effects({ scale2x, sepia, sepia })
+  local effects = sol.video.get_post_effects()
+  assert(#effects == 3)
+  assert(effects[1] == scale2x)
+  assert(effects[2] == sepia)
+  assert(effects[3] == sepia)
+end
+
+local num_updates = 0
+function map:on_update()
+
+  num_updates = num_updates + 1
+  if num_updates == 10 then
+    -- Changing the scaling factor of a pass must not break rendering.
+    scale2x:set_scaling_factor(3)
+    sol.video.set_shader(sepia)
+  elseif num_updates == 20 then
+    sol.video.set_post_effects(nil)
+    assert(#sol.video.get_post_effects() == 0)
+    sol.video.set_shader(nil)
+    sol.main.exit()
+  end
+end
@@ -0,0 +1,16 @@
+local map = ...
+local hero = map:get_hero()
+
+function map:on_started()
+
+  assert(not pcall(sol.main.preload_map, "not_a_map"))
+
+  -- Requesting the same map twice is harmless.
+  sol.main.preload_map("basic_test")
+  sol.main.preload_map("basic_test")
+
+  -- Give some time to the workers, then use the preloaded map.
+  sol.timer.start(map, 100, function()
+    hero:teleport("basic_test")
+  end)
+end
@@ -0,0 +1,67 @@
+local map = ...
+
+local function create_mover(x, y)
+
+  local entity = map:create_custom_entity({
+    x = x,
+    y = y,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  local movement = sol.movement.create("straight")
+  movement:set_speed(64)
+  movement:set_angle(3 * math.pi / 2)
+  movement:start(entity)
+  return entity
+end
+
+function map:on_started()
+
+  -- Three rooms side by side.
+  for x = 312, 632, 320 do
+    map:create_separator({
+      x = x,
+      y = 0,
+      layer = 0,
+      width = 16,
+      height = 240,
+    })
+  end
+
+  assert(map:get_room_activation() == "none")
+  map:set_room_activation("room")
+  assert(map:get_room_activation() == "room")
+
+  local near_entity = create_mover(160, 40)
+  local adjacent_entity = create_mover(480, 40)
+  local far_entity = create_mover(800, 40)
+
+  -- Only the room of the camera is active.
+  sol.timer.start(map, 500, function()
+    local _, near_y = near_entity:get_position()
+    local _, adjacent_y = adjacent_entity:get_position()
+    local _, far_y = far_entity:get_position()
+    assert(near_y > 40)
+    assert(adjacent_y == 40)
+    assert(far_y == 40)
+
+    -- Then also rooms next to it.
+    map:set_room_activation("adjacent_rooms")
+    sol.timer.start(map, 500, function()
+      local _, adjacent_y = adjacent_entity:get_position()
+      local _, far_y = far_entity:get_position()
+      assert(adjacent_y > 40)
+      assert(far_y == 40)
+
+      -- Back to the usual behavior.
+      map:set_room_activation("none")
+      sol.timer.start(map, 500, function()
+        local _, far_y = far_entity:get_position()
+        assert(far_y > 40)
+        sol.main.exit()
+      end)
+    end)
+  end)
+end
@@ -0,0 +1,38 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_opening_transition_finished()
+
+  sol.game.delete("save_async.dat")
+  local savegame = sol.game.load("save_async.dat")
+
+  local results = {}
+  local function on_saved(success)
+    results[#results + 1] = success
+  end
+
+  -- Values are copied when saving: later changes are not saved.
+  savegame:set_value("counter", 1)
+  savegame:save_async(on_saved)
+  savegame:set_value("counter", 2)
+  savegame:save_async(on_saved)
+  savegame:set_value("counter", 3)
+  savegame:save_async()
+
+  -- Callbacks are called later.
+  assert(#results == 0)
+
+  -- Reading the file waits for pending writes.
+  assert(sol.game.exists("save_async.dat"))
+  local loaded = sol.game.load("save_async.dat")
+  assert(loaded:get_value("counter") == 3)
+
+  sol.timer.start(map, 10, function()
+    assert(#results == 2)
+    assert(results[1] and results[2])
+
+    sol.game.delete("save_async.dat")
+    assert(not sol.game.exists("save_async.dat"))
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,35 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  -- Handles of values not set yet.
+  local handle = game:get_value_handle("value_handle_test")
+  assert(game:get_value_handle("value_handle_test") == handle)
+  assert(game:get_value(handle) == nil)
+
+  -- Values set by handle or by key are the same.
+  game:set_value(handle, 42)
+  assert(game:get_value("value_handle_test") == 42)
+  game:set_value("value_handle_test", "text")
+  assert(game:get_value(handle) == "text")
+  game:set_value(handle, true)
+  assert(game:get_value(handle) == true)
+
+  -- The handle remains valid when the value is unset.
+  game:set_value(handle, nil)
+  assert(game:get_value("value_handle_test") == nil)
+  game:set_value(handle, 7)
+  assert(game:get_value("value_handle_test") == 7)
+
+  -- Built-in values can be read but not written.
+  local life = game:get_value_handle("_current_life")
+  assert(game:get_value(life) == game:get_life())
+  assert(not pcall(game.set_value, game, life, 1))
+
+  assert(not pcall(game.get_value, game, -1))
+  assert(not pcall(game.get_value, game, 1000000))
+  assert(not pcall(game.get_value_handle, game, "1_invalid"))
+
+  sol.main.exit()
+end
@@ -0,0 +1,35 @@
+local map = ...
+
+function map:on_started()
+
+  -- Loading a script again gives a new function with the same debug information.
+  local first = sol.main.load_file("enemies/test_enemy")
+  local second = sol.main.load_file("enemies/test_enemy")
+  assert(first ~= nil)
+  assert(second ~= nil)
+  assert(first ~= second)
+  assert(debug.getinfo(first, "S").source == "@enemies/test_enemy.lua")
+  assert(debug.getinfo(second, "S").source == "@enemies/test_enemy.lua")
+
+  -- Changing the environment of one of them does not change the other one.
+  setfenv(first, {})
+  assert(getfenv(second) == _G)
+
+  -- Each enemy still runs its own instance of the breed script.
+  local enemies = {}
+  for i = 1, 50 do
+    enemies[#enemies + 1] = map:create_enemy({
+      x = 16 + (i % 10) * 24,
+      y = 32 + math.floor(i / 10) * 32,
+      layer = 0,
+      direction = 0,
+      breed = "test_enemy",
+    })
+  end
+  for _, enemy in ipairs(enemies) do
+    local width, height = enemy:get_size()
+    assert(width == 16 and height == 16)
+  end
+
+  sol.main.exit()
+end
@@ -0,0 +1,62 @@
+local map = ...
+
+local function assert_region(x, y, expected_x, expected_y, expected_width, expected_height)
+
+  local region_x, region_y, region_width, region_height = map:get_region_at(x, y)
+  assert(region_x == expected_x)
+  assert(region_y == expected_y)
+  assert(region_width == expected_width)
+  assert(region_height == expected_height)
+end
+
+function map:on_started()
+
+  -- Without separators, the whole map is one region.
+  assert_region(10, 10, 0, 0, 320, 240)
+  assert(map:get_region_at(-1, 10) == nil)
+  assert(map:get_region_at(10, 240) == nil)
+
+  -- A vertical separator cuts the map in two rooms.
+  map:create_separator({
+    x = 152,
+    y = 0,
+    layer = 0,
+    width = 16,
+    height = 240,
+  })
+  assert_region(10, 10, 0, 0, 160, 240)
+  assert_region(159, 10, 0, 0, 160, 240)
+  assert_region(160, 10, 160, 0, 160, 240)
+
+  -- An horizontal separator cuts the west room in two.
+  local separator = map:create_separator({
+    x = 0,
+    y = 112,
+    layer = 0,
+    width = 160,
+    height = 16,
+  })
+  assert_region(10, 10, 0, 0, 160, 120)
+  assert_region(10, 120, 0, 120, 160, 120)
+  assert_region(300, 200, 160, 0, 160, 240)
+
+  -- Entities in a region are the ones of its rectangle.
+  local hero = map:get_hero()
+  local found_hero = false
+  for entity in map:get_entities_in_region(10, 200) do
+    if entity == hero then
+      found_hero = true
+    end
+  end
+  assert(found_hero)
+  for entity in map:get_entities_in_region(10, 10) do
+    assert(entity ~= hero)
+  end
+
+  -- Removing a separator merges its rooms again.
+  separator:remove()
+  sol.timer.start(map, 10, function()
+    assert_region(10, 10, 0, 0, 160, 240)
+    sol.main.exit()
+  end)
+end
@@ -0,0 +1,37 @@
+local map = ...
+
+local sepia = sol.shader.create("sepia")
+
+function map:on_started()
+
+  local min_resolution, max_resolution = sol.video.get_shader_resolution_bounds()
+  assert(min_resolution == 1)
+  assert(max_resolution == 1)
+  assert(sol.video.get_shader_resolution() == 1)
+
+  assert(not pcall(sol.video.set_shader_resolution_bounds, 0))
+  assert(not pcall(sol.video.set_shader_resolution_bounds, 0.5, 0.25))
+  assert(not pcall(sol.video.set_shader_resolution_bounds, 0.5, 2))
+
+  sol.video.set_shader_resolution_bounds(0.5, 0.75)
+  min_resolution, max_resolution = sol.video.get_shader_resolution_bounds()
+  assert(min_resolution == 0.5)
+  assert(max_resolution == 0.75)
+  assert(sol.video.get_shader_resolution() == 0.75)
+
+  sol.video.set_shader(sepia)
+end
+
+local num_updates = 0
+function map:on_update()
+
+  num_updates = num_updates + 1
+  local resolution = sol.video.get_shader_resolution()
+  assert(resolution >= 0.5 and resolution <= 0.75)
+  if num_updates == 20 then
+    sol.video.set_shader(nil)
+    sol.video.set_shader_resolution_bounds(1, 1)
+    assert(sol.video.get_shader_resolution() == 1)
+    sol.main.exit()
+  end
+end
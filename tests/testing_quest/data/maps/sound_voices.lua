@@ -0,0 +1,26 @@
+local map = ...
+
+function map:on_started()
+
+  assert(sol.audio.get_sound_max_instances("arrow_hit") == 0)
+  assert(sol.audio.get_sound_priority("arrow_hit") == 0)
+
+  sol.audio.set_sound_max_instances("arrow_hit", 2)
+  sol.audio.set_sound_priority("arrow_hit", 5)
+  assert(sol.audio.get_sound_max_instances("arrow_hit") == 2)
+  assert(sol.audio.get_sound_priority("arrow_hit") == 5)
+
+  -- Other sounds keep their settings.
+  assert(sol.audio.get_sound_max_instances("bird_chirp") == 0)
+  assert(sol.audio.get_sound_priority("bird_chirp") == 0)
+
+  assert(not pcall(sol.audio.set_sound_max_instances, "arrow_hit", -1))
+  assert(not pcall(sol.audio.set_sound_priority, "not_a_sound", 1))
+
+  -- Playing more instances than allowed is not an error.
+  for i = 1, 4 do
+    sol.audio.play_sound("arrow_hit")
+  end
+
+  sol.main.exit()
+end
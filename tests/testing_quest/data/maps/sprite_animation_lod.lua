@@ -0,0 +1,39 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_opening_transition_finished()
+
+  -- Far from the camera.
+  local entity = map:create_custom_entity({
+    x = 1200,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  local lazy_sprite = entity:create_sprite("hero/tunic1", "lazy")
+  local full_sprite = entity:create_sprite("hero/tunic1", "full")
+  lazy_sprite:set_animation("walking")
+  full_sprite:set_animation("walking")
+
+  assert_equal(lazy_sprite:get_animation_lod(), "default")
+  full_sprite:set_animation_lod("full")
+  assert_equal(full_sprite:get_animation_lod(), "full")
+  lazy_sprite:set_animation_lod("lazy")
+  assert_equal(lazy_sprite:get_animation_lod(), "lazy")
+
+  -- The frame of the off-screen lazy sprite catches up when asked.
+  sol.timer.start(map, 1000, function()
+    assert_equal(lazy_sprite:get_frame(), full_sprite:get_frame())
+
+    -- Also when the entity becomes visible again.
+    sol.timer.start(map, 770, function()
+      entity:set_position(160, 120)
+      sol.timer.start(map, 10, function()
+        assert_equal(lazy_sprite:get_frame(), full_sprite:get_frame())
+        sol.main.exit()
+      end)
+    end)
+  end)
+end
@@ -0,0 +1,45 @@
+local map = ...
+
+-- Returns the RGBA bytes of a pixel of a 32x32 surface.
+local function get_pixel(pixels, x, y)
+  local index = (y * 32 + x) * 4 + 1
+  return pixels:sub(index, index + 3)
+end
+
+-- Checks that sprite:draw_region() draws exactly the part of the frame
+-- inside the region, at the place where sprite:draw() would draw it.
+local function check_region(sprite, full_pixels, blank_pixels, x, y, width, height)
+
+  local surface = sol.surface.create(32, 32)
+  sprite:draw_region(x, y, width, height, surface, 8, 13)
+  local pixels = surface:get_pixels()
+
+  for pixel_y = 0, 31 do
+    for pixel_x = 0, 31 do
+      -- Coordinates relative to the origin point of the sprite.
+      local region_x, region_y = pixel_x - 8, pixel_y - 13
+      local inside = region_x >= x and region_x < x + width
+          and region_y >= y and region_y < y + height
+      local expected = inside and get_pixel(full_pixels, pixel_x, pixel_y)
+          or get_pixel(blank_pixels, pixel_x, pixel_y)
+      assert_equal(get_pixel(pixels, pixel_x, pixel_y), expected)
+    end
+  end
+end
+
+function map:on_started()
+
+  local sprite = sol.sprite.create("16x16")
+  local full = sol.surface.create(32, 32)
+  sprite:draw(full, 8, 13)
+  local full_pixels = full:get_pixels()
+  local blank_pixels = sol.surface.create(32, 32):get_pixels()
+
+  check_region(sprite, full_pixels, blank_pixels, -4, -10, 8, 6)     -- Inside the frame.
+  check_region(sprite, full_pixels, blank_pixels, -12, -20, 10, 10)  -- Over the upper-left corner.
+  check_region(sprite, full_pixels, blank_pixels, 0, 0, 20, 20)      -- Over the lower-right corner.
+  check_region(sprite, full_pixels, blank_pixels, -20, -20, 48, 48)  -- Bigger than the frame.
+  check_region(sprite, full_pixels, blank_pixels, 20, 20, 4, 4)      -- Outside the frame.
+
+  sol.main.exit()
+end
@@ -0,0 +1,37 @@
+local map = ...
+
+function map:on_started()
+
+  local palette_1 = sol.surface.create(4, 1)
+  palette_1:fill_color({ 255, 0, 0 })
+  local palette_2 = sol.surface.create(4, 1)
+  palette_2:fill_color({ 0, 0, 255 })
+
+  local sprite_1 = sol.sprite.create("16x16")
+  local sprite_2 = sol.sprite.create("16x16")
+  assert(sprite_1:get_palette() == nil)
+
+  -- Sprites with the same palette share the palette shader.
+  sprite_1:set_palette(palette_1)
+  sprite_2:set_palette(palette_1)
+  assert(sprite_1:get_palette() == palette_1)
+  assert(sprite_1:get_shader() ~= nil)
+  assert(sprite_1:get_shader() == sprite_2:get_shader())
+
+  sprite_2:set_palette(palette_2)
+  assert(sprite_2:get_palette() == palette_2)
+  assert(sprite_2:get_shader() ~= sprite_1:get_shader())
+
+  local surface = sol.surface.create(32, 32)
+  sprite_1:draw(surface, 8, 8)
+  sprite_2:draw(surface, 24, 24)
+
+  -- Removing the palette removes the shader.
+  sprite_1:set_palette(nil)
+  assert(sprite_1:get_palette() == nil)
+  assert(sprite_1:get_shader() == nil)
+
+  assert(not pcall(sprite_1.set_palette, sprite_1, 1))
+
+  sol.main.exit()
+end
@@ -0,0 +1,61 @@
+local map = ...
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+    sprite = "hero/tunic1",
+  })
+  local sprite = entity:get_sprite()
+  sprite:set_animation("walking")  -- 8 frames of 70 ms.
+
+  local follower = entity:create_sprite("hero/tunic1", "follower")
+  follower:set_animation("walking")
+  follower:synchronize(sprite)
+
+  local frames = {}
+  function sprite:on_frame_changed(animation, frame)
+    frames[#frames + 1] = frame
+  end
+
+  sol.timer.start(map, 350, function()
+    -- Frames change on time and in order.
+    assert(#frames >= 4 and #frames <= 6)
+    for i = 2, #frames do
+      assert(frames[i] == (frames[i - 1] + 1) % 8)
+    end
+    assert(follower:get_frame() == sprite:get_frame())
+
+    -- Paused sprites do not change.
+    sprite:set_paused(true)
+    local num_frames = #frames
+    local frame = sprite:get_frame()
+    sol.timer.start(map, 200, function()
+      assert(#frames == num_frames)
+      assert(sprite:get_frame() == frame)
+
+      -- A new frame delay applies from the next frame.
+      sprite:set_paused(false)
+      sprite:set_frame_delay(10)
+      sol.timer.start(map, 200, function()
+        assert(#frames >= num_frames + 10)
+        assert(follower:get_frame() == sprite:get_frame())
+
+        -- Setting a frame restarts the schedule.
+        sprite:set_frame_delay(1000)
+        sprite:set_frame(0)
+        num_frames = #frames
+        sol.timer.start(map, 500, function()
+          assert(#frames == num_frames)
+          assert(sprite:get_frame() == 0)
+          sol.main.exit()
+        end)
+      end)
+    end)
+  end)
+end
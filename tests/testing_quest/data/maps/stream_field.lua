@@ -0,0 +1,53 @@
+local map = ...
+
+local streams = {}
+local mover
+
+function map:on_started()
+
+  -- A conveyor belt of 10 streams going to the right.
+  for i = 0, 9 do
+    local stream = map:create_stream({
+      x = 24 + i * 16,
+      y = 125,
+      layer = 0,
+      direction = 0,
+      speed = 240,
+      allow_movement = true,
+      allow_attack = true,
+      allow_item = true,
+    })
+    streams[#streams + 1] = stream
+  end
+
+  mover = map:create_custom_entity({
+    x = 20,
+    y = 125,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  mover:set_follow_streams(true)
+
+  assert(not map:is_stream_field_enabled())
+  map:set_stream_field_enabled(true)
+  assert(map:is_stream_field_enabled())
+end
+
+function map:on_opening_transition_finished()
+
+  -- Moving the entity makes it sample the field.
+  mover:set_position(24, 125)
+
+  sol.timer.start(map, 1500, function()
+    -- The entity crossed all streams and stopped after the last one.
+    local x = mover:get_position()
+    assert(x >= 24 + 9 * 16)
+    assert(x <= 24 + 11 * 16)
+
+    map:set_stream_field_enabled(false)
+    assert(not map:is_stream_field_enabled())
+    sol.main.exit()
+  end)
+end
@@ -31,7 +31,95 @@ local function test_set_pixels()
   assert_equal(a, 255)
 end
 
+-- Test for sol.surface.set_pixels() with only a few pixels changed.
+local function test_set_pixels_partial()
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({255, 0, 0, 255})
+
+  local pixels = surface:get_pixels()
+  local index = (5 * 16 + 7) * 4  -- Pixel (7, 5).
+  pixels = pixels:sub(1, index) .. string.char(0, 0, 255, 255) .. pixels:sub(index + 5)
+  surface:set_pixels(pixels)
+
+  -- Draw the surface to check what was uploaded.
+  local copy = sol.surface.create(16, 16)
+  surface:draw(copy)
+  local copy_pixels = copy:get_pixels()
+  assert_equal(copy_pixels, pixels)
+  local r, g, b, a = copy_pixels:byte(index + 1, index + 4)
+  assert_equal(r, 0)
+  assert_equal(b, 255)
+  r, g, b, a = copy_pixels:byte(1, 4)
+  assert_equal(r, 255)
+  assert_equal(b, 0)
+end
+
+-- Test for sol.surface.get_pixels_async().
+local function test_get_pixels_async(callback)
+
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({32, 16, 8, 255})
+
+  local called = false
+  surface:get_pixels_async(function(pixels)
+    called = true
+    assert_equal(#pixels, 16 * 16 * 4)
+    local r, g, b, a = pixels:byte(1, 4)
+    assert_equal(r, 32)
+    assert_equal(g, 16)
+    assert_equal(b, 8)
+    assert_equal(a, 255)
+    callback()
+  end)
+  assert(not called)  -- The callback is called later.
+end
+
+-- Returns the RGBA bytes of a pixel of a 16x16 surface.
+local function get_pixel(pixels, x, y)
+  local index = (y * 16 + x) * 4 + 1
+  return pixels:sub(index, index + 3)
+end
+
+local red = string.char(255, 0, 0, 255)
+local transparent = string.char(0, 0, 0, 0)
+
+-- Test for sol.surface.draw_rectangle().
+local function test_draw_rectangle()
+
+  local surface = sol.surface.create(16, 16)
+  surface:draw_rectangle({255, 0, 0, 255}, 2, 3, 10, 6)
+  local pixels = surface:get_pixels()
+  for y = 0, 15 do
+    for x = 0, 15 do
+      local inside = x >= 2 and x < 12 and y >= 3 and y < 9
+      local border = inside and (x == 2 or x == 11 or y == 3 or y == 8)
+      assert_equal(get_pixel(pixels, x, y), border and red or transparent)
+    end
+  end
+end
+
+-- Test for sol.surface.draw_line() with horizontal and vertical lines.
+local function test_draw_line()
+
+  local surface = sol.surface.create(16, 16)
+  surface:draw_line({255, 0, 0, 255}, 1, 4, 9, 4)
+  surface:draw_line({255, 0, 0, 255}, 13, 2, 13, 12)
+  local pixels = surface:get_pixels()
+  for y = 0, 15 do
+    for x = 0, 15 do
+      local on_line = (y == 4 and x >= 1 and x <= 9)
+          or (x == 13 and y >= 2 and y <= 12)
+      assert_equal(get_pixel(pixels, x, y), on_line and red or transparent)
+    end
+  end
+end
+
 test_get_pixels()
+test_draw_rectangle()
+test_draw_line()
 test_set_pixels()
-
-sol.main.exit()
+test_set_pixels_partial()
+test_get_pixels_async(function()
+  sol.main.exit()
+end)
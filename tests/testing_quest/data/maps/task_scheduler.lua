@@ -0,0 +1,77 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  -- Waits only work in tasks.
+  assert(not pcall(sol.task.wait, 10))
+
+  local steps = {}
+
+  -- Tasks run until their first wait.
+  local frames_task = sol.task.start(function(first)
+    steps[#steps + 1] = first
+    sol.task.wait_frames(2)
+    steps[#steps + 1] = "frames"
+    coroutine.yield()
+    steps[#steps + 1] = "yield"
+  end, "start")
+  assert(steps[1] == "start")
+  assert(sol.task.is_running(frames_task))
+
+  -- Stopped tasks are never resumed.
+  local stopped = false
+  local stopped_task = sol.task.start(function()
+    sol.task.wait(10)
+    stopped = true
+  end)
+  sol.task.stop(stopped_task)
+  assert(not sol.task.is_running(stopped_task))
+
+  -- Many tasks waiting for a date.
+  local num_woken = 0
+  for i = 1, 1000 do
+    sol.task.start(map, function()
+      sol.task.wait(i % 50)
+      num_woken = num_woken + 1
+    end)
+  end
+
+  sol.task.start(map, function()
+
+    local entity = map:create_custom_entity({
+      x = 160,
+      y = 120,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+    local movement = sol.movement.create("target")
+    movement:set_target(170, 120)
+    movement:set_speed(128)
+    movement:start(entity)
+    sol.task.wait_movement(movement)
+    local x, y = entity:get_position()
+    assert(x == 170 and y == 120)
+
+    game:start_dialog("a")
+    sol.task.wait_dialog(game)
+    assert(not game:is_dialog_enabled())
+
+    sol.task.wait(100)
+    assert(num_woken == 1000)
+    assert(not stopped)
+    assert(steps[2] == "frames" and steps[3] == "yield")
+    assert(not sol.task.is_running(frames_task))
+    sol.main.exit()
+  end)
+
+  -- Close the dialog from another task.
+  sol.task.start(map, function()
+    while not game:is_dialog_enabled() do
+      sol.task.wait_frames()
+    end
+    game:stop_dialog()
+  end)
+end
@@ -0,0 +1,36 @@
+local map = ...
+
+function map:on_opening_transition_finished()
+
+  local calls = {}
+  local function record(name)
+    return function()
+      calls[#calls + 1] = name
+    end
+  end
+
+  -- Timers are called in the order of their expiration dates,
+  -- and in the order of their creation for equal dates.
+  sol.timer.start(map, 300, record("c"))
+  sol.timer.start(map, 100, record("a"))
+  sol.timer.start(map, 200, record("b1"))
+  sol.timer.start(map, 200, record("b2"))
+
+  -- Stopped and rescheduled timers.
+  local stopped = sol.timer.start(map, 150, record("stopped"))
+  stopped:stop()
+  local moved = sol.timer.start(map, 400, record("moved"))
+  moved:set_remaining_time(250)
+
+  -- A suspended timer is delayed by its suspension.
+  local suspended = sol.timer.start(map, 50, record("suspended"))
+  suspended:set_suspended(true)
+  sol.timer.start(map, 100, function()
+    suspended:set_suspended(false)
+  end)
+
+  sol.timer.start(map, 500, function()
+    assert_equal(table.concat(calls, " "), "a suspended b1 b2 moved c")
+    sol.main.exit()
+  end)
+end
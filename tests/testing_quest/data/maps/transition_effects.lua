@@ -0,0 +1,33 @@
+local map = ...
+local game = map:get_game()
+
+function map:on_started()
+
+  if sol.video.get_transition_effect("dissolve") ~= nil then
+    return
+  end
+
+  local dissolve = sol.shader.create("dissolve")
+  assert(not pcall(sol.video.set_transition_effect, "fade", dissolve))
+  assert(not pcall(sol.video.set_transition_effect, "dissolve", dissolve, -1))
+
+  sol.video.set_transition_effect("dissolve", dissolve, 100, 200)
+  local shader, closing_duration, opening_duration = sol.video.get_transition_effect("dissolve")
+  assert(shader == dissolve)
+  assert(closing_duration == 100)
+  assert(opening_duration == 200)
+end
+
+local num_openings = 0
+function map:on_opening_transition_finished()
+
+  num_openings = num_openings + 1
+  if num_openings == 1 then
+    -- Go to the same map with the effect.
+    game:get_hero():teleport(map:get_id(), "_same", "dissolve")
+  else
+    sol.video.set_transition_effect("dissolve", nil)
+    assert(sol.video.get_transition_effect("dissolve") == nil)
+    sol.main.exit()
+  end
+end
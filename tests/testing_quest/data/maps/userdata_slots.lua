@@ -0,0 +1,51 @@
+local map = ...
+
+function map:on_started()
+
+  local entity = map:create_custom_entity({
+    name = "slot_entity",
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+    sprite = "hero/tunic1",
+  })
+  entity.value = 42
+
+  -- The same object always gives the same userdata.
+  assert(map:get_entity("slot_entity") == entity)
+  assert(entity:get_sprite() == entity:get_sprite())
+
+  -- A userdata collected from Lua is created again with its fields.
+  entity = nil
+  collectgarbage()
+  collectgarbage()
+  entity = map:get_entity("slot_entity")
+  assert(entity ~= nil)
+  assert(entity.value == 42)
+  assert(map:get_entity("slot_entity") == entity)
+
+  -- Many objects created and destroyed reuse their slots.
+  for i = 1, 200 do
+    local other = map:create_custom_entity({
+      x = 160,
+      y = 120,
+      layer = 0,
+      width = 16,
+      height = 16,
+      direction = 0,
+    })
+    other:remove()
+  end
+
+  sol.timer.start(map, 10, function()
+    collectgarbage()
+    for other in map:get_entities_by_type("custom_entity") do
+      assert(other == entity)
+      assert(other.value == 42)
+    end
+    sol.main.exit()
+  end)
+end
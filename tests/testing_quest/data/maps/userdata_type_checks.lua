@@ -0,0 +1,39 @@
+local map = ...
+
+function map:on_started()
+
+  local hero = map:get_hero()
+  local entity = map:create_custom_entity({
+    x = 160,
+    y = 120,
+    layer = 0,
+    width = 16,
+    height = 16,
+    direction = 0,
+  })
+  local sprite = sol.sprite.create("hero/tunic1")
+  local movement = sol.movement.create("straight")
+  local file = sol.file.open("userdata_type_checks.txt", "w")
+
+  -- Entity methods accept all entity types.
+  assert(hero:get_distance(entity) == entity:get_distance(hero))
+  assert(sol.main.get_type(hero) == "hero")
+  assert(sol.main.get_type(entity) == "custom_entity")
+  assert(sol.main.get_type(sprite) == "sprite")
+
+  -- Other userdata are rejected, including the ones from other libraries.
+  assert(not pcall(hero.get_distance, hero, sprite))
+  assert(not pcall(hero.get_distance, hero, file))
+  assert(not pcall(sprite.get_animation, movement))
+  assert(not pcall(sprite.get_animation, file))
+  local success, message = pcall(sprite.get_animation, hero)
+  assert(not success and message:match("sprite expected, got hero"))
+
+  -- Movements are checked by their exact type.
+  assert(movement:get_speed() ~= nil)
+  assert(not pcall(movement.get_speed, sol.movement.create("random")))
+
+  file:close()
+  sol.file.remove("userdata_type_checks.txt")
+  sol.main.exit()
+end
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2019 Solarus - http://www.solarus-games.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#if __VERSION__ >= 130
+#define COMPAT_VARYING in
+#define COMPAT_TEXTURE texture
+out vec4 FragColor;
+#else
+#define COMPAT_VARYING varying
+#define FragColor gl_FragColor
+#define COMPAT_TEXTURE texture2D
+#endif
+
+#ifdef GL_ES
+precision mediump float;
+#define COMPAT_PRECISION mediump
+#else
+#define COMPAT_PRECISION
+#endif
+
+uniform sampler2D sol_texture;
+uniform sampler2D sol_texture;
+uniform sampler2D sol_previous_texture;
+uniform float sol_transition_progress;
+uniform bool sol_transition_opening;
+COMPAT_VARYING vec2 sol_vtex_coord;
+COMPAT_VARYING vec4 sol_vcolor;
+
+// Dissolve transition: pixels switch in a pseudo-random order.
+// A closing transition dissolves to black, an opening one dissolves
+// from the previous image.
+float noise(vec2 coord) {
+    return fract(sin(dot(coord, vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+void main() {
+    vec4 texel = COMPAT_TEXTURE(sol_texture, sol_vtex_coord);
+    bool switched = noise(floor(gl_FragCoord.xy)) < sol_transition_progress;
+
+    if (sol_transition_opening) {
+        FragColor = switched ? texel : COMPAT_TEXTURE(sol_previous_texture, sol_vtex_coord);
+    }
+    else {
+        FragColor = switched ? vec4(0.0, 0.0, 0.0, 1.0) : texel;
+    }
+}
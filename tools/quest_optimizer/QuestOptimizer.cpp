@@ -0,0 +1,478 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file QuestOptimizer.cpp
+ * \brief Packs the data of a quest into an archive optimized for loading.
+ *
+ * Usage: solarus-quest-optimizer [options] path/to/quest output_archive
+ *
+ * The archive is to be used as data.solarus instead of the data directory.
+ * Compared to zipping the data directory by hand:
+ * - Lua scripts are precompiled to bytecode. The bytecode only works with
+ *   the Lua runtime this tool is built with: build it with the same Lua
+ *   or LuaJIT as the engine that will run the quest.
+ * - Maps, tilesets and sprites get their binary form next to them,
+ *   in the same format as the binary cache of the engine.
+ * - Files are stored without compression, so that the engine reads them
+ *   directly from the disk, in the order the engine loads them.
+ * KTX2 images made by tools/texture_compressor are packed like other files.
+ *
+ * Options:
+ *   -no-bytecode      keeps Lua scripts as source code
+ *   -no-binary-data   does not add the binary form of data files
+ */
+#include "solarus/core/BinaryData.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/lua/LuaData.h"
+#include <lua.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief A file to write in the archive.
+ */
+struct ArchiveFile {
+  std::string name;           /**< Name of the file in the archive. */
+  std::string content;        /**< Content of the file. */
+  int rank = 0;               /**< Loading order of its resource type. */
+  std::string source_name;    /**< Name of the data file it comes from. */
+  uint32_t crc = 0;           /**< CRC-32 of the content. */
+  uint32_t offset = 0;        /**< Offset of its local header in the archive. */
+};
+
+/**
+ * \brief Top-level directories in the order the engine usually reads them.
+ *
+ * "*" stands for other directories, like the ones of custom scripts.
+ */
+const std::vector<std::string> directory_order = {
+    "scripts",
+    "languages",
+    "fonts",
+    "shaders",
+    "*",
+    "sprites",
+    "tilesets",
+    "maps",
+    "images",
+    "sounds",
+    "musics"
+};
+
+/**
+ * \brief Root files in the order the engine reads them, before other ones.
+ */
+const std::vector<std::string> root_file_order = {
+    "quest.dat",
+    "project_db.dat",
+    "main.lua"
+};
+
+constexpr size_t max_entries = 0xFFFF;  /**< Zip archives without Zip64 have fewer entries. */
+
+/**
+ * \brief Returns the loading order of a data file.
+ * \param file_name Name of a data file.
+ * \return A rank: files with lower ranks are read first.
+ */
+int get_rank(const std::string& file_name) {
+
+  const size_t slash = file_name.find('/');
+  if (slash == std::string::npos) {
+    // Root files come first.
+    const auto it = std::find(root_file_order.begin(), root_file_order.end(), file_name);
+    return static_cast<int>(it - root_file_order.end()) - 1;
+  }
+
+  auto it = std::find(directory_order.begin(), directory_order.end(), file_name.substr(0, slash));
+  if (it == directory_order.end()) {
+    it = std::find(directory_order.begin(), directory_order.end(), "*");
+  }
+  return static_cast<int>(it - directory_order.begin());
+}
+
+/**
+ * \brief Returns whether a file name has an extension.
+ * \param file_name A file name.
+ * \param extension The extension, including the dot.
+ * \return \c true if the file name ends with this extension.
+ */
+bool has_extension(const std::string& file_name, const std::string& extension) {
+
+  return file_name.size() > extension.size() &&
+      file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/**
+ * \brief Lists the data files of the quest recursively.
+ * \param dir_name A directory of the quest data, or an empty string.
+ * \param[out] file_names The files found.
+ */
+void list_files(const std::string& dir_name, std::vector<std::string>& file_names) {
+
+  for (const std::string& name : QuestFiles::data_file_list_dir(dir_name)) {
+    const std::string& file_name = dir_name.empty() ? name : dir_name + "/" + name;
+    if (QuestFiles::data_file_is_dir(file_name)) {
+      list_files(file_name, file_names);
+    }
+    else {
+      file_names.push_back(file_name);
+    }
+  }
+}
+
+/**
+ * \brief Function called by lua_dump() to write bytecode.
+ */
+int append_bytecode(lua_State* /* l */, const void* data, size_t size, void* bytecode) {
+
+  static_cast<std::string*>(bytecode)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+/**
+ * \brief Compiles a Lua script to bytecode.
+ * \param file_name Name of the script, used in error messages of the engine.
+ * \param source The source code.
+ * \param[out] bytecode The bytecode.
+ * \return \c true in case of success.
+ */
+bool compile_script(const std::string& file_name, const std::string& source, std::string& bytecode) {
+
+  if (!source.empty() && source[0] == LUA_SIGNATURE[0]) {
+    // Already bytecode.
+    bytecode = source;
+    return true;
+  }
+
+  std::unique_ptr<lua_State, void (*)(lua_State*)> l(luaL_newstate(), lua_close);
+  // The chunk name must be the one used by the engine.
+  if (luaL_loadbuffer(l.get(), source.data(), source.size(), ("@" + file_name).c_str()) != 0) {
+    std::cerr << "Error: " << lua_tostring(l.get(), -1) << std::endl;
+    return false;
+  }
+
+  bytecode.clear();
+#if LUA_VERSION_NUM >= 503
+  const int result = lua_dump(l.get(), append_bytecode, &bytecode, 0);
+#else
+  const int result = lua_dump(l.get(), append_bytecode, &bytecode);
+#endif
+  return result == 0 && !bytecode.empty();
+}
+
+/**
+ * \brief Makes the binary cache file of a data file if it has a binary form.
+ * \param file_name Name of the data file.
+ * \param content Content of the data file.
+ * \param[out] cache Content of the cache file.
+ * \return \c true if the cache file was made.
+ */
+bool make_binary_data(const std::string& file_name, const std::string& content, std::string& cache) {
+
+  std::unique_ptr<LuaData> data;
+  if (file_name.compare(0, 5, "maps/") == 0) {
+    data.reset(new MapData());
+  }
+  else if (file_name.compare(0, 9, "tilesets/") == 0) {
+    data.reset(new TilesetData());
+  }
+  else if (file_name.compare(0, 8, "sprites/") == 0) {
+    data.reset(new SpriteData());
+  }
+  else {
+    return false;
+  }
+
+  if (!data->import_from_buffer(content, file_name)) {
+    std::cerr << "Warning: cannot parse '" << file_name << "', no binary form added" << std::endl;
+    return false;
+  }
+  return data->export_to_binary_cache(
+      cache, get_fnv1a_hash(content.data(), content.size()));
+}
+
+/**
+ * \brief Computes the CRC-32 of some data, as stored in zip archives.
+ * \param data The data.
+ * \return Its CRC-32.
+ */
+uint32_t get_crc32(const std::string& data) {
+
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> result;
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t value = i;
+      for (int j = 0; j < 8; ++j) {
+        value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+      }
+      result[i] = value;
+    }
+    return result;
+  }();
+
+  uint32_t crc = 0xFFFFFFFF;
+  for (const char c : data) {
+    crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+/**
+ * \brief Appends a little-endian 16-bit integer to a buffer.
+ */
+void write_uint16(std::string& buffer, uint16_t value) {
+  buffer.push_back(static_cast<char>(value & 0xFF));
+  buffer.push_back(static_cast<char>(value >> 8));
+}
+
+/**
+ * \brief Appends a little-endian 32-bit integer to a buffer.
+ */
+void write_uint32(std::string& buffer, uint32_t value) {
+  write_uint16(buffer, static_cast<uint16_t>(value & 0xFFFF));
+  write_uint16(buffer, static_cast<uint16_t>(value >> 16));
+}
+
+/**
+ * \brief Appends the fields common to the local and central headers of a file.
+ */
+void write_common_header(std::string& buffer, const ArchiveFile& file) {
+
+  write_uint16(buffer, 20);      // Version needed: 2.0.
+  write_uint16(buffer, 0);       // Flags.
+  write_uint16(buffer, 0);       // Method: stored.
+  write_uint16(buffer, 0);       // Time.
+  write_uint16(buffer, 0x21);    // Date: 1980-01-01, for reproducible archives.
+  write_uint32(buffer, file.crc);
+  write_uint32(buffer, static_cast<uint32_t>(file.content.size()));
+  write_uint32(buffer, static_cast<uint32_t>(file.content.size()));
+  write_uint16(buffer, static_cast<uint16_t>(file.name.size()));
+  write_uint16(buffer, 0);       // Extra field length.
+}
+
+/**
+ * \brief Writes a zip archive whose files are stored without compression.
+ * \param archive_file_name Path of the archive to create.
+ * \param files The files, in the order to write them.
+ * \return \c true in case of success.
+ */
+bool write_archive(const std::string& archive_file_name, std::vector<ArchiveFile>& files) {
+
+  if (files.size() >= max_entries) {
+    std::cerr << "Error: too many files for a zip archive" << std::endl;
+    return false;
+  }
+
+  std::ofstream out(archive_file_name, std::ios::binary);
+  if (!out) {
+    std::cerr << "Error: cannot write '" << archive_file_name << "'" << std::endl;
+    return false;
+  }
+
+  uint64_t offset = 0;
+  std::string header;
+  for (ArchiveFile& file : files) {
+    if (offset + 30 + file.name.size() + file.content.size() > 0xFFFFFFFF) {
+      std::cerr << "Error: the archive would exceed 4 GiB" << std::endl;
+      return false;
+    }
+    file.crc = get_crc32(file.content);
+    file.offset = static_cast<uint32_t>(offset);
+
+    header.clear();
+    write_uint32(header, 0x04034B50);
+    write_common_header(header, file);
+    header += file.name;
+    out.write(header.data(), header.size());
+    out.write(file.content.data(), file.content.size());
+    offset += header.size() + file.content.size();
+  }
+
+  // The central directory is the index of the archive.
+  std::string directory;
+  for (const ArchiveFile& file : files) {
+    write_uint32(directory, 0x02014B50);
+    write_uint16(directory, 20);   // Version made by: MS-DOS, 2.0.
+    write_common_header(directory, file);
+    write_uint16(directory, 0);    // Comment length.
+    write_uint16(directory, 0);    // Disk number.
+    write_uint16(directory, 0);    // Internal attributes.
+    write_uint32(directory, 0);    // External attributes.
+    write_uint32(directory, file.offset);
+    directory += file.name;
+  }
+  if (offset + directory.size() > 0xFFFFFFFF) {
+    std::cerr << "Error: the archive would exceed 4 GiB" << std::endl;
+    return false;
+  }
+
+  std::string end_record;
+  write_uint32(end_record, 0x06054B50);
+  write_uint16(end_record, 0);     // Disk number.
+  write_uint16(end_record, 0);     // Disk of the central directory.
+  write_uint16(end_record, static_cast<uint16_t>(files.size()));
+  write_uint16(end_record, static_cast<uint16_t>(files.size()));
+  write_uint32(end_record, static_cast<uint32_t>(directory.size()));
+  write_uint32(end_record, static_cast<uint32_t>(offset));
+  write_uint16(end_record, 0);     // Comment length.
+
+  out.write(directory.data(), directory.size());
+  out.write(end_record.data(), end_record.size());
+  return static_cast<bool>(out);
+}
+
+/**
+ * \brief Prints how to use this program.
+ * \param program_name Name of the executable.
+ */
+void print_usage(const std::string& program_name) {
+
+  std::cout << "Usage: " << program_name << " [options] path/to/quest output_archive"
+            << std::endl << std::endl
+            << "Packs the data of a quest into an archive optimized for loading,"
+            << " to be used as data.solarus." << std::endl << std::endl
+            << "Options:" << std::endl
+            << "  -no-bytecode      keeps Lua scripts as source code" << std::endl
+            << "  -no-binary-data   does not add the binary form of data files" << std::endl;
+}
+
+}
+
+/**
+ * \brief Entry point of the quest optimizer.
+ * \param argc Number of command-line arguments.
+ * \param argv Command-line arguments.
+ * \return 0 in case of success.
+ */
+int main(int argc, char** argv) {
+
+  bool bytecode_enabled = true;
+  bool binary_data_enabled = true;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-no-bytecode") {
+      bytecode_enabled = false;
+    }
+    else if (arg == "-no-binary-data") {
+      binary_data_enabled = false;
+    }
+    else if (!arg.empty() && arg[0] == '-') {
+      print_usage(argv[0]);
+      return 1;
+    }
+    else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  const std::string& quest_path = paths[0];
+  const std::string& archive_file_name = paths[1];
+
+  if (!QuestFiles::open_quest(argv[0], quest_path)) {
+    std::cerr << "Error: no quest was found in '" << quest_path << "'" << std::endl;
+    return 1;
+  }
+  // Only pack the quest data, not savegames or caches of the write directory.
+  QuestFiles::set_quest_write_dir("");
+
+  std::vector<std::string> file_names;
+  list_files("", file_names);
+
+  std::vector<ArchiveFile> files;
+  int num_scripts = 0;
+  int num_binary_data = 0;
+  bool success = true;
+  for (const std::string& file_name : file_names) {
+    if (file_name.compare(0, 11, "data_cache/") == 0) {
+      // Binary data made by an earlier run is made again.
+      continue;
+    }
+
+    ArchiveFile file;
+    file.name = file_name;
+    file.source_name = file_name;
+    file.rank = get_rank(file_name);
+    file.content = QuestFiles::data_file_read(file_name);
+
+    if (bytecode_enabled && has_extension(file_name, ".lua")) {
+      std::string bytecode;
+      if (!compile_script(file_name, file.content, bytecode)) {
+        success = false;
+        continue;
+      }
+      file.content = std::move(bytecode);
+      ++num_scripts;
+    }
+    else if (binary_data_enabled && has_extension(file_name, ".dat")) {
+      ArchiveFile cache;
+      if (make_binary_data(file_name, file.content, cache.content)) {
+        cache.name = LuaData::get_binary_cache_file_name(file_name);
+        cache.source_name = file_name;
+        cache.rank = file.rank;
+        files.push_back(std::move(cache));
+        ++num_binary_data;
+      }
+    }
+    files.push_back(std::move(file));
+  }
+  QuestFiles::close_quest();
+
+  if (!success) {
+    std::cerr << "Error: some scripts could not be compiled" << std::endl;
+    return 1;
+  }
+
+  // Put the binary form of a data file right after it:
+  // the engine reads the source to check that the cache is up to date.
+  std::stable_sort(files.begin(), files.end(), [](const ArchiveFile& first, const ArchiveFile& second) {
+    if (first.rank != second.rank) {
+      return first.rank < second.rank;
+    }
+    if (first.source_name != second.source_name) {
+      return first.source_name < second.source_name;
+    }
+    return first.name == first.source_name && second.name != second.source_name;
+  });
+
+  if (!write_archive(archive_file_name, files)) {
+    return 1;
+  }
+
+  std::cout << "Wrote " << files.size() << " files to '" << archive_file_name << "' ("
+            << num_scripts << " scripts compiled, "
+            << num_binary_data << " data files converted)" << std::endl;
+  return 0;
+}
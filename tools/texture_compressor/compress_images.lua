@@ -0,0 +1,86 @@
+#!/usr/bin/lua
+
+-- Creates GPU-compressed versions of the PNG images of a quest.
+-- Usage: ./compress_images.lua path/to/your/quest format [encoder_command]
+--
+-- Each data/.../name.png gets a data/.../name.ktx2 file next to it.
+-- The engine uses the KTX2 file instead of the PNG when the GPU supports
+-- its format, and the PNG otherwise, so the PNG files must be kept.
+--
+-- Formats:
+--   bc1    BC1 (DXT1), desktop GPUs, 1-bit alpha
+--   bc3    BC3 (DXT5), desktop GPUs
+--   bc7    BC7, recent desktop GPUs (OpenGL 4.2)
+--   etc2   ETC2 RGBA, OpenGL ES 3 GPUs
+--   astc   ASTC 4x4, recent mobile GPUs
+--
+-- Compression is done by an external encoder that can write KTX2 files
+-- without supercompression. The default one is PVRTexToolCLI.
+-- Another one can be given as a command where %i, %o and %f are replaced
+-- by the input file, the output file and the format name.
+
+local formats = {
+  bc1 = "BC1",
+  bc3 = "BC3",
+  bc7 = "BC7",
+  etc2 = "ETC2_RGBA",
+  astc = "ASTC_4x4",
+}
+
+local default_encoder_command = "PVRTexToolCLI -i %i -o %o -f %f,UBN,lRGB"
+
+if #arg < 2 or #arg > 3 or formats[arg[2]] == nil then
+  print("Usage: " .. arg[0] .. " path/to/your/quest bc1|bc3|bc7|etc2|astc [encoder_command]")
+  os.exit(1)
+end
+
+local quest_path = arg[1] .. "/data/"
+local format = formats[arg[2]]
+local encoder_command = arg[3] or default_encoder_command
+
+-- Quotes a file name for the shell.
+local function quote(file_name)
+  return "'" .. file_name:gsub("'", "'\\''") .. "'"
+end
+
+-- Returns the list of PNG files of the quest.
+local function get_png_files()
+
+  local files = {}
+  local find = io.popen("find " .. quote(quest_path) .. " -type f -name '*.png'")
+  for file_name in find:lines() do
+    files[#files + 1] = file_name
+  end
+  find:close()
+  table.sort(files)
+  return files
+end
+
+local num_converted = 0
+local num_errors = 0
+
+print("*** Compressing images of quest " .. arg[1] .. " to " .. format .. " ***")
+
+for _, png_file_name in ipairs(get_png_files()) do
+
+  local ktx2_file_name = png_file_name:gsub("%.png$", ".ktx2")
+  local command = encoder_command:gsub("%%[iof]", {
+    ["%i"] = quote(png_file_name),
+    ["%o"] = quote(ktx2_file_name),
+    ["%f"] = format,
+  })
+
+  local success = os.execute(command .. " > /dev/null")
+  if success == true or success == 0 then
+    num_converted = num_converted + 1
+  else
+    io.stderr:write("[ERROR] " .. png_file_name .. ": encoder failed\n")
+    os.remove(ktx2_file_name)
+    num_errors = num_errors + 1
+  end
+end
+
+print("*** " .. num_converted .. " image(s) compressed, " .. num_errors .. " error(s). ***")
+if num_errors > 0 then
+  os.exit(1)
+end